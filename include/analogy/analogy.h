@@ -96,10 +96,18 @@ int a4l_get_rnginfo(a4l_desc_t *dsc,
 
 #define a4l_is_rng_global(x) ((x)->flags & A4L_RNG_GLOBAL)
 
+/* Output layout of the scan conversion routines */
+#define A4L_SCAN_PLANAR 0x1
+
 int a4l_snd_command(a4l_desc_t *dsc, a4l_cmd_t *cmd);
     
 int a4l_snd_cancel(a4l_desc_t *dsc, unsigned int idx_subd);
 
+int a4l_attach_reader(a4l_desc_t *dsc, unsigned int idx_subd);
+
+int a4l_snd_grptrig(a4l_desc_t *dsc,
+		    a4l_grpmbr_t *members, unsigned int nb_members);
+
 int a4l_set_bufsize(a4l_desc_t *dsc,
 		    unsigned int idx_subd, unsigned long size);
 
@@ -110,6 +118,16 @@ int a4l_set_wakesize(a4l_desc_t *dsc, unsigned long size);
 
 int a4l_get_wakesize(a4l_desc_t *dsc, unsigned long *size);
 
+int a4l_set_wakeperiod(a4l_desc_t *dsc, unsigned long period);
+
+int a4l_get_wakeperiod(a4l_desc_t *dsc, unsigned long *period);
+
+int a4l_get_errpos(a4l_desc_t *dsc, unsigned long *pos);
+
+int a4l_set_bufflags(a4l_desc_t *dsc, unsigned long flags);
+
+int a4l_get_bufflags(a4l_desc_t *dsc, unsigned long *flags);
+
 int a4l_mark_bufrw(a4l_desc_t *dsc,
 		   unsigned int idx_subd,
 		   unsigned long cur, unsigned long *newp);
@@ -120,6 +138,9 @@ int a4l_poll(a4l_desc_t *dsc,
 int a4l_mmap(a4l_desc_t *dsc,
 	     unsigned int idx_subd, unsigned long size, void **ptr);
 
+int a4l_mmap_stamps(a4l_desc_t *dsc,
+		    unsigned int idx_subd, a4l_bufstps_t **ptr);
+
 int a4l_async_read(a4l_desc_t *dsc,
 		   void *buf, size_t nbyte, unsigned long ms_timeout);
 
@@ -130,6 +151,10 @@ int a4l_snd_insnlist(a4l_desc_t *dsc, a4l_insnlst_t *arg);
 
 int a4l_snd_insn(a4l_desc_t *dsc, a4l_insn_t *arg);
 
+int a4l_snd_insnprg(a4l_desc_t *dsc, a4l_insnprg_t *arg);
+
+int a4l_run_insnprg(a4l_desc_t *dsc);
+
 /* --- Level 2 API (supposed to be used) --- */
 
 int a4l_sync_write(a4l_desc_t *dsc,
@@ -174,6 +199,12 @@ int a4l_ftoraw(a4l_chinfo_t *chan,
 int a4l_dtoraw(a4l_chinfo_t *chan,
 	       a4l_rnginfo_t *rng, void *dst, double *src, int cnt);
 
+int a4l_rawtof_scan(a4l_chinfo_t **chans, a4l_rnginfo_t **rngs,
+		    int nchans, float *dst, void *src, int nscans, int flags);
+
+int a4l_rawtod_scan(a4l_chinfo_t **chans, a4l_rnginfo_t **rngs,
+		    int nchans, double *dst, void *src, int nscans, int flags);
+
 #endif /* !DOXYGEN_CPP */
 
 #ifdef __cplusplus
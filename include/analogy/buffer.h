@@ -54,9 +54,19 @@
 #define A4L_BUF_MAP_NR 9
 #define A4L_BUF_MAP (1 << A4L_BUF_MAP_NR)
 
+#define A4L_BUF_SHARED_NR 10
+#define A4L_BUF_SHARED (1 << A4L_BUF_SHARED_NR)
+
 struct a4l_subdevice;
 
 /* Buffer descriptor structure */
+/* Physically contiguous chunk of an asynchronous buffer */
+struct a4l_buf_chunk {
+	unsigned long addr;
+	unsigned long size;
+};
+typedef struct a4l_buf_chunk a4l_bufchk_t;
+
 struct a4l_buffer {
 
 	/* Added by the structure update */
@@ -70,6 +80,15 @@ struct a4l_buffer {
 	/* Tab containing buffer's pages pointers */
 	unsigned long *pg_list;
 
+	/* Scatter-gather list: the physically contiguous chunks
+	   composing the buffer, in buffer order; drivers may program
+	   their DMA descriptors from it */
+	a4l_bufchk_t *sg_list;
+	unsigned long sg_count;
+
+	/* Allocation options (A4L_BUF_CONTIG) */
+	unsigned long alloc_flags;
+
 	/* RT/NRT synchronization element */
 	a4l_sync_t sync;
 
@@ -82,6 +101,12 @@ struct a4l_buffer {
 	/* Status + events occuring during transfer */
 	unsigned long flags;
 
+	/* Position (in bytes) in the stream of the first sample lost
+	   or sent without data, valid once A4L_BUF_ERROR is set; it
+	   survives the cancellation so that it can be retrieved
+	   afterwards */
+	unsigned long err_count;
+
 	/* Command on progress */
 	a4l_cmd_t *cur_cmd;
 
@@ -91,6 +116,31 @@ struct a4l_buffer {
 	/* Theshold below which the user process should not be
 	   awakened */
 	unsigned long wake_count;
+
+	/* Period (ns) after which the user process is awakened
+	   whatever the amount of available data, 0 if disabled */
+	unsigned long wake_period;
+	/* Date of the next period-based wake-up */
+	nanosecs_abs_t wake_date;
+
+	/* Event stamps ring, allocated when first mapped */
+	struct a4l_buf_stamps *stamps;
+
+	/* Serializes the munge operations, which the producer side
+	   performs as well when secondary readers are attached */
+	a4l_lock_t lock;
+
+	/* Secondary readers of the running command's stream */
+	struct list_head readers;
+	/* Count of readers copying from the buffer pages */
+	atomic_t rdr_holds;
+
+	/* Secondary reader side: the buffer read, NULL once its
+	   command is over, and the link in its readers list; the
+	   counters and flags of this buffer then hold the reader's
+	   own position and events */
+	struct a4l_buffer *shared;
+	struct list_head rdr_link;
 };
 typedef struct a4l_buffer a4l_buf_t;
 
@@ -129,13 +179,15 @@ static inline int __produce(a4l_cxt_t *cxt,
 	return ret;
 }
 
-/* The function __consume is an inline function which copies data from
-   the asynchronous buffer and takes care of the non-contiguous issue
-   when looping. This function is used in read and write operations */
-static inline int __consume(a4l_cxt_t *cxt,
-			    a4l_buf_t *buf, void *pout, unsigned long count)
+/* The function __consume_from is an inline function which copies data
+   from the asynchronous buffer, starting at the absolute position
+   pos, and takes care of the non-contiguous issue when looping. This
+   function is used in read and write operations */
+static inline int __consume_from(a4l_cxt_t *cxt, a4l_buf_t *buf,
+				 unsigned long pos,
+				 void *pout, unsigned long count)
 {
-	unsigned long start_ptr = (buf->cns_count % buf->size);
+	unsigned long start_ptr = (pos % buf->size);
 	unsigned long tmp_cnt = count;
 	int ret = 0;
 
@@ -162,6 +214,12 @@ static inline int __consume(a4l_cxt_t *cxt,
 	return ret;
 }
 
+static inline int __consume(a4l_cxt_t *cxt,
+			    a4l_buf_t *buf, void *pout, unsigned long count)
+{
+	return __consume_from(cxt, buf, buf->cns_count, pout, count);
+}
+
 /* The function __munge is an inline function which calls the
    subdevice specific munge callback on contiguous windows within the
    whole buffer. This function is used in read and write operations */
@@ -240,10 +298,22 @@ static inline int __handle_event(a4l_buf_t * buf)
    writer has not overtaken the reader because it was not able to
    overtake the n-1 value. */
 
+/* Only the first error is recorded: the following ones are
+   consequences of it */
+static inline void __set_error(a4l_buf_t * buf, unsigned long count)
+{
+	if (!test_bit(A4L_BUF_ERROR_NR, &buf->flags)) {
+		buf->err_count = count;
+		set_bit(A4L_BUF_ERROR_NR, &buf->flags);
+	}
+}
+
 static inline int __pre_abs_put(a4l_buf_t * buf, unsigned long count)
 {
+	/* The data located after the consumer's position recorded the
+	   last time may have been overwritten */
 	if (count - buf->tmp_count > buf->size) {
-		set_bit(A4L_BUF_ERROR_NR, &buf->flags);
+		__set_error(buf, buf->tmp_count);
 		return -EPIPE;
 	}
 
@@ -283,7 +353,7 @@ static inline int __pre_abs_get(a4l_buf_t * buf, unsigned long count)
 	was not greater a few cycles before; in such case, the DMA
 	channel would have retrieved the wrong data */
 	if ((long)(count - buf->tmp_count) > 0) {
-		set_bit(A4L_BUF_ERROR_NR, &buf->flags);
+		__set_error(buf, buf->tmp_count);
 		return -EPIPE;
 	}
 
@@ -399,6 +469,8 @@ int a4l_setup_buffer(a4l_cxt_t *cxt, a4l_cmd_t *cmd);
 
 int a4l_cancel_buffer(a4l_cxt_t *cxt);
 
+int a4l_check_preload(struct a4l_subdevice *subd);
+
 int a4l_buf_prepare_absput(struct a4l_subdevice *subd,
 			   unsigned long count);
 
@@ -447,11 +519,13 @@ int a4l_get_chan(struct a4l_subdevice *subd);
 /* --- IOCTL / FOPS functions --- */
 
 int a4l_ioctl_mmap(a4l_cxt_t * cxt, void *arg);
+int a4l_ioctl_mmapstamp(a4l_cxt_t * cxt, void *arg);
 int a4l_ioctl_bufcfg(a4l_cxt_t * cxt, void *arg);
 int a4l_ioctl_bufcfg2(a4l_cxt_t * cxt, void *arg);
 int a4l_ioctl_bufinfo(a4l_cxt_t * cxt, void *arg);
 int a4l_ioctl_bufinfo2(a4l_cxt_t * cxt, void *arg);
 int a4l_ioctl_poll(a4l_cxt_t * cxt, void *arg);
+int a4l_ioctl_bufshare(a4l_cxt_t * cxt, void *arg);
 ssize_t a4l_read_buffer(a4l_cxt_t * cxt, void *bufdata, size_t nbytes);
 ssize_t a4l_write_buffer(a4l_cxt_t * cxt, const void *bufdata, size_t nbytes);
 int a4l_select(a4l_cxt_t *cxt,
@@ -468,12 +542,40 @@ struct a4l_mmap_arg {
 };
 typedef struct a4l_mmap_arg a4l_mmap_t;
 
+/* Event stamps ring (MMAPSTAMP ioctl): each time the driver reports
+   new data, the date and the count of bytes transferred so far by
+   the device (i.e. the byte position in the stream, starting from 0
+   with each command) are recorded. The head index is reset when a
+   command starts, then only advanced once the record is complete; a
+   reader may copy record #i, then re-read the head: if (head - i) >=
+   nr_stamps, the record may have been overwritten meanwhile */
+#define A4L_BUF_NR_STAMPS 128
+
+struct a4l_buf_stamp {
+	/* Date of the driver event (ns, Xenomai clock) */
+	unsigned long long date;
+	/* Bytes transferred by the device at that date */
+	unsigned long long pos;
+};
+typedef struct a4l_buf_stamp a4l_bufstp_t;
+
+struct a4l_buf_stamps {
+	volatile unsigned int head;
+	unsigned int nr_stamps;
+	unsigned long long reserved;
+	a4l_bufstp_t stamps[A4L_BUF_NR_STAMPS];
+};
+typedef struct a4l_buf_stamps a4l_bufstps_t;
+
 /* Constants related with buffer size
    (might be used with BUFCFG ioctl) */
 #define A4L_BUF_MAXSIZE 0x1000000
 #define A4L_BUF_DEFSIZE 0x10000
 #define A4L_BUF_DEFMAGIC 0xffaaff55
 
+/* Buffer allocation flags (BUFCFG2) */
+#define A4L_BUF_CONTIG 0x1
+
 /* BUFCFG ioctl argument structure */
 struct a4l_buffer_config {
 	/* NOTE: with the last buffer implementation, the field
@@ -496,10 +598,22 @@ struct a4l_buffer_info {
 };
 typedef struct a4l_buffer_info a4l_bufinfo_t;
 
+#define A4L_BUF_NOERR (~0UL)
+
 /* BUFCFG2 / BUFINFO2 ioctl argument structure */
 struct a4l_buffer_config2 {
 	unsigned long wake_count;
-	unsigned long reserved[3];
+	/* Allocation flags, applied to the current buffer which gets
+	   reallocated if needed; BUFINFO2 returns the flags actually
+	   honored */
+	unsigned long flags;
+	/* Period (ns) after which any pending data triggers a
+	   wake-up, even below wake_count; 0 disables it */
+	unsigned long wake_period;
+	/* BUFINFO2 only: position (in bytes) in the stream of the
+	   first sample lost or sent without data by the last command,
+	   A4L_BUF_NOERR if none; ignored by BUFCFG2 */
+	unsigned long err_count;
 };
 typedef struct a4l_buffer_config2 a4l_bufcfg2_t;
 
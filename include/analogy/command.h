@@ -237,6 +237,39 @@ struct a4l_cmd_desc {
 };
 typedef struct a4l_cmd_desc a4l_cmd_t;
 
+/**
+ * Maximum count of commands started by a group trigger
+ */
+#define A4L_GRP_MAX_MEMBERS 16
+
+/**
+ * @brief Group trigger member
+ *
+ * Designates a command armed with start_src set to TRIG_INT, possibly
+ * on another device.
+ *
+ * @see a4l_snd_grptrig()
+ */
+struct a4l_grptrig_member {
+	int fd;
+	       /**< File descriptor of the device running the command */
+	unsigned int idx_subd;
+			   /**< Subdevice processing the command */
+	unsigned int trignum;
+			  /**< Trigger number passed to the driver */
+	unsigned long long date;
+			     /**< Date (ns) at which the command was
+				triggered, filled on return */
+};
+typedef struct a4l_grptrig_member a4l_grpmbr_t;
+
+/* GRPTRIG ioctl argument structure */
+struct a4l_grptrig {
+	unsigned int nb_members;
+	a4l_grpmbr_t *members;
+};
+typedef struct a4l_grptrig a4l_grptrig_t;
+
 	  /*! @} async1_lib */
 
 #if defined(__KERNEL__) && !defined(DOXYGEN_CPP)
@@ -247,6 +280,7 @@ void a4l_free_cmddesc(a4l_cmd_t * desc);
 /* --- Upper layer functions --- */
 int a4l_check_cmddesc(a4l_cxt_t * cxt, a4l_cmd_t * desc);
 int a4l_ioctl_cmd(a4l_cxt_t * cxt, void *arg);
+int a4l_ioctl_grptrig(a4l_cxt_t * cxt, void *arg);
 
 #endif /* __KERNEL__ && !DOXYGEN_CPP */
 
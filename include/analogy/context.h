@@ -29,6 +29,7 @@
 
 struct a4l_device;
 struct a4l_buffer;
+struct a4l_kernel_instruction_program;
 
 struct a4l_device_context {
 
@@ -43,6 +44,12 @@ struct a4l_device_context {
 	   from asynchronous acquisition operations on a specific
 	   subdevice */
 	struct a4l_buffer *buffer;
+
+	/* Precompiled instruction list, if any */
+	struct a4l_kernel_instruction_program *insnprg;
+
+	/* Protects insnprg against concurrent runs and replacements */
+	rtdm_lock_t insnprg_lock;
 };
 typedef struct a4l_device_context a4l_cxt_t;
 
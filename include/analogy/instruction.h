@@ -193,6 +193,26 @@ struct a4l_instruction_list {
 };
 typedef struct a4l_instruction_list a4l_insnlst_t;
 
+/*!
+ * @brief Structure describing a precompiled instruction list
+ * @see a4l_snd_insnprg()
+ */
+
+struct a4l_instruction_program {
+	unsigned int count;
+			/**< Instructions count */
+	a4l_insn_t *insns;
+			  /**< Tab containing the instructions; on
+			     return, their data pointers are moved into
+			     the shared data area */
+	void *data;
+		   /**< Shared data area, filled on return */
+	unsigned long size;
+			  /**< Size of the shared data area, filled on
+			     return */
+};
+typedef struct a4l_instruction_program a4l_insnprg_t;
+
 	  /*! @} sync1_lib */
 
 #if defined(__KERNEL__) && !defined(DOXYGEN_CPP)
@@ -214,11 +234,27 @@ struct a4l_kernel_instruction_list {
 };
 typedef struct a4l_kernel_instruction_list a4l_kilst_t;
 
+#define A4L_INSNPRG_BUSY_NR 0
+
+struct a4l_kernel_instruction_program {
+	unsigned long status;
+	/* One for the context, plus one per user mapping of data */
+	atomic_t refcnt;
+	unsigned int count;
+	a4l_kinsn_t *insns;
+	void *data;
+	unsigned long size;
+};
+typedef struct a4l_kernel_instruction_program a4l_kiprg_t;
+
 /* Instruction related functions */
 
 /* Upper layer functions */
 int a4l_ioctl_insnlist(a4l_cxt_t * cxt, void *arg);
 int a4l_ioctl_insn(a4l_cxt_t * cxt, void *arg);
+int a4l_ioctl_insnprg(a4l_cxt_t * cxt, void *arg);
+int a4l_ioctl_insnprgrun(a4l_cxt_t * cxt, void *arg);
+void a4l_free_insnprg(a4l_cxt_t * cxt);
 
 #endif /* __KERNEL__ && !DOXYGEN_CPP */
 
@@ -29,7 +29,7 @@
 
 #include <rtdm/rtdm_driver.h>
 
-#define NB_IOCTL_FUNCTIONS 17
+#define NB_IOCTL_FUNCTIONS 22
 
 #endif /* __KERNEL__ */
 
@@ -57,6 +57,12 @@
 #define A4L_BUFCFG2 _IOR(CIO,15,a4l_bufcfg_t)
 #define A4L_BUFINFO2 _IOWR(CIO,16,a4l_bufcfg_t)
 
+#define A4L_GRPTRIG _IOWR(CIO,17,a4l_grptrig_t)
+#define A4L_MMAPSTAMP _IOWR(CIO,18,a4l_mmap_t)
+#define A4L_INSNPRG _IOWR(CIO,19,a4l_insnprg_t)
+#define A4L_INSNPRGRUN _IO(CIO,20)
+#define A4L_BUFSHARE _IOR(CIO,21,unsigned int)
+
 #endif /* !DOXYGEN_CPP */
 
 #endif /* __ANALOGY_IOCTL__ */
@@ -132,6 +132,13 @@
  * acquisition)
  */
 #define A4L_SUBD_CMD 0x1000
+/**
+ * The subdevice has no pacer of its own, but its instruction handlers
+ * are fast and safe to be called from a real-time timer; the Analogy
+ * core runs commands on it by calling them at the scan period (the
+ * core sets A4L_SUBD_CMD and A4L_SUBD_MMAP by itself)
+ */
+#define A4L_SUBD_SWCMD 0x2000
 /**
  * The subdevice support mmap operations (technically, any driver can
  * do it; however, the developer might want that his driver must be
@@ -171,6 +178,7 @@
 
 struct a4l_device;
 struct a4l_buffer;
+struct a4l_swcmd;
 
 /*!
  * @brief Structure describing the subdevice
@@ -225,6 +233,9 @@ struct a4l_subdevice {
 	int (*trigger) (struct a4l_subdevice *, lsampl_t);
 					      /**< Callback for trigger operation */
 
+	struct a4l_swcmd *swcmd;
+				/**< Software pacer of the running command */
+
 	char priv[0];
 		  /**< Private data */
 };
@@ -283,6 +294,7 @@ a4l_chan_t *a4l_get_chfeat(a4l_subd_t * sb, int idx);
 a4l_rng_t *a4l_get_rngfeat(a4l_subd_t * sb, int chidx, int rngidx);
 int a4l_check_chanlist(a4l_subd_t * subd,
 		       unsigned char nb_chan, unsigned int *chans);
+int a4l_get_bitfield_size(a4l_subd_t * subd);
 
 #define a4l_subd_is_input(x) ((A4L_SUBD_MASK_READ & (x)->flags) != 0)
 /* The following macro considers that a DIO subdevice is firstly an
@@ -290,6 +302,11 @@ int a4l_check_chanlist(a4l_subd_t * subd,
 #define a4l_subd_is_output(x) \
 	((A4L_SUBD_MASK_WRITE & (x)->flags) != 0 || \
 	 (A4L_SUBD_DIO & (x)->flags) != 0)
+/* Digital subdevices sample all their channels as one bitfield */
+#define a4l_subd_is_digital(x) \
+	(((x)->flags & A4L_SUBD_TYPES) == A4L_SUBD_DI || \
+	 ((x)->flags & A4L_SUBD_TYPES) == A4L_SUBD_DO || \
+	 ((x)->flags & A4L_SUBD_TYPES) == A4L_SUBD_DIO)
 
 /* --- Upper layer functions --- */
 
@@ -303,6 +320,10 @@ int a4l_ioctl_rnginfo(a4l_cxt_t * cxt, void *arg);
 int a4l_ioctl_nbchaninfo(a4l_cxt_t * cxt, void *arg);
 int a4l_ioctl_nbrnginfo(a4l_cxt_t * cxt, void *arg);
 
+/* --- Software-paced commands --- */
+
+int a4l_setup_swcmd(a4l_subd_t * subd);
+
 #endif /* __KERNEL__ */
 
 #endif /* !DOXYGEN_CPP */
@@ -67,6 +67,22 @@ static inline void xnarch_enter_root(xnarchtcb_t * rootcb)
 	rthal_unmute_pic();
 }
 
+#ifdef CONFIG_XENO_OPT_STATS
+/*
+ * Count of switches which did [1] or did not [0] have to change the
+ * address space, the latter sparing the page table switch and, on
+ * VIVT caches, the cache flush.
+ */
+#define XNARCH_HAVE_MM_SWITCH_STATS
+static unsigned long xnarch_mm_switches[XNARCH_NR_CPUS][2];
+#define xnarch_count_mm_switch(cross) \
+	(xnarch_mm_switches[rthal_processor_id()][cross]++)
+#define xnarch_mm_switch_count(cpu, cross) \
+	(xnarch_mm_switches[cpu][cross])
+#else /* !CONFIG_XENO_OPT_STATS */
+#define xnarch_count_mm_switch(cross)	do { } while (0)
+#endif /* !CONFIG_XENO_OPT_STATS */
+
 static inline void xnarch_switch_to(xnarchtcb_t *out_tcb, xnarchtcb_t *in_tcb)
 {
 	struct task_struct *prev = out_tcb->active_task;
@@ -83,13 +99,19 @@ static inline void xnarch_switch_to(xnarchtcb_t *out_tcb, xnarchtcb_t *in_tcb)
 		rthal_set_foreign_stack(&rthal_domain);
 	}
 
+	/*
+	 * Threads of the same process, and kernel threads which
+	 * borrow the current mm, need no page table or ASID work.
+	 */
 	if (prev_mm != in_tcb->active_mm) {
+		xnarch_count_mm_switch(1);
 		/* Switch to new user-space thread? */
 		if (in_tcb->active_mm)
 			wrap_switch_mm(prev_mm, in_tcb->active_mm, next);
 		if (!next->mm)
 			enter_lazy_tlb(prev_mm, next);
-	}
+	} else
+		xnarch_count_mm_switch(0);
 
 	/* Kernel-to-kernel context switch. */
 	rthal_thread_switch(prev, out_tcb->tip, in_tcb->tip);
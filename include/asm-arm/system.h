@@ -221,6 +221,17 @@ static inline int xnarch_fault_fpu_p(struct xnarch_fltinfo *fi)
 
 #define xnarch_fault_notify(fi) (!xnarch_fault_bp_p(fi))
 
+/* Frame tail of user code built with frame pointers (profiler). */
+#define XNARCH_HAVE_USER_FRAMES
+struct xnarch_user_frame {
+	unsigned long next;	/* Caller's frame pointer. */
+	unsigned long sp;
+	unsigned long ret;	/* Return address. */
+};
+#define xnarch_user_sp(regs)	((regs)->ARM_sp)
+#define xnarch_user_fp(regs)	((regs)->ARM_fp)
+#define xnarch_user_frame_addr(fp)	((fp) - sizeof(struct xnarch_user_frame))
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -405,8 +405,74 @@ static inline void xnarch_init_llmulshft(const unsigned m_in,
 #define xnarch_nodiv_llimd           rthal_nodiv_llimd
 #define xnarch_llmulshft             rthal_llmulshft
 
-unsigned long long xnarch_divrem_billion(unsigned long long value,
-					 unsigned long *rem);
+/*
+ * Precomputed factors for scaling values by m / d on hot paths,
+ * without any division at run time. xnarch_conv_scale() uses a
+ * multiply-shift sequence, which is the fastest but keeps 31 bits of
+ * precision only. xnarch_conv_scale_exact() is accurate to the last
+ * unit, using the 64bit reciprocal when the architecture has fast
+ * 64x64 multiplication. xnarch_conv_divrem() returns the quotient and
+ * remainder of a division by d, for factors set up with m == 1.
+ */
+typedef struct xnarch_conv {
+	unsigned mult;
+	unsigned shift;
+	unsigned m;
+	unsigned d;
+#ifdef XNARCH_HAVE_NODIV_LLIMD
+	rthal_u32frac_t frac;
+#endif
+} xnarch_conv_t;
+
+static inline void xnarch_init_conv(xnarch_conv_t *const c,
+				    const unsigned m,
+				    const unsigned d)
+{
+	c->m = m;
+	c->d = d;
+	xnarch_init_llmulshft(m, d, &c->mult, &c->shift);
+#ifdef XNARCH_HAVE_NODIV_LLIMD
+	xnarch_init_u32frac(&c->frac, m, d);
+#endif
+}
+
+static inline long long xnarch_conv_scale(const xnarch_conv_t *c,
+					  long long op)
+{
+	return xnarch_llmulshft(op, c->mult, c->shift);
+}
+
+static inline long long xnarch_conv_scale_exact(const xnarch_conv_t *c,
+						long long op)
+{
+#ifdef XNARCH_HAVE_NODIV_LLIMD
+	return xnarch_nodiv_llimd(op, c->frac.frac, c->frac.integ);
+#else
+	return xnarch_llimd(op, c->m, c->d);
+#endif
+}
+
+static inline unsigned long long
+xnarch_conv_divrem(const xnarch_conv_t *c, unsigned long long op,
+		   unsigned long *rem)
+{
+#ifdef XNARCH_HAVE_NODIV_LLIMD
+	unsigned long long q, r;
+
+	/* The reciprocal is rounded down, q may be short by one. */
+	q = xnarch_nodiv_ullimd(op, c->frac.frac, c->frac.integ);
+	r = op - q * c->d;
+	if (r >= c->d) {
+		++q;
+		r -= c->d;
+	}
+	if (rem)
+		*rem = r;
+	return q;
+#else
+	return xnarch_ulldiv(op, c->d, rem);
+#endif
+}
 
 /*@}*/
 
@@ -240,6 +240,9 @@ void __xnlock_spin(xnlock_t *lock /*, */ XNLOCK_DBG_CONTEXT_ARGS)
 {
 	unsigned int spin_limit;
 	int cpu = xnarch_current_cpu();
+#ifdef XNLOCK_CONTENTION_STATS
+	unsigned long long start = rthal_rdtsc();
+#endif
 
 	xnlock_dbg_prepare_spin(&spin_limit);
 
@@ -249,6 +252,17 @@ void __xnlock_spin(xnlock_t *lock /*, */ XNLOCK_DBG_CONTEXT_ARGS)
 			xnlock_dbg_spinning(lock, cpu, &spin_limit /*, */
 					    XNLOCK_DBG_PASS_CONTEXT);
 		} while(atomic_read(&lock->owner) != ~0);
+
+#ifdef XNLOCK_CONTENTION_STATS
+	/* We own the lock now. */
+	start = rthal_rdtsc() - start;
+	lock->contended++;
+	lock->spin_tsc += start;
+	if (lock->stat)
+		/* __xnlock_get() is inlined into the contending site. */
+		xnlock_stat_record(lock->stat, start,
+				   __builtin_return_address(0));
+#endif
 }
 EXPORT_SYMBOL_GPL(__xnlock_spin);
 #endif /* CONFIG_SMP */
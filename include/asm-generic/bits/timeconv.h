@@ -21,99 +21,54 @@
 
 #include <asm/xenomai/arith.h>
 
-static unsigned long long clockfreq;
-
-#ifdef XNARCH_HAVE_LLMULSHFT
-static unsigned int tsc_scale, tsc_shift;
-#ifdef XNARCH_HAVE_NODIV_LLIMD
-static rthal_u32frac_t tsc_frac;
-static rthal_u32frac_t bln_frac;
-#endif
-#endif
-
-#ifdef XNARCH_HAVE_LLMULSHFT
-long long xnarch_tsc_to_ns(long long ticks)
-{
-	return xnarch_llmulshft(ticks, tsc_scale, tsc_shift);
-}
-
-long long xnarch_tsc_to_ns_rounded(long long ticks)
-{
-	unsigned int shift = tsc_shift - 1;
-	return (xnarch_llmulshft(ticks, tsc_scale, shift) + 1) / 2;
-}
-
-#ifdef XNARCH_HAVE_NODIV_LLIMD
-long long xnarch_ns_to_tsc(long long ns)
-{
-	return xnarch_nodiv_llimd(ns, tsc_frac.frac, tsc_frac.integ);
-}
-
-unsigned long long xnarch_divrem_billion(unsigned long long value,
-					 unsigned long *rem)
-{
-	unsigned long long q;
-	unsigned r;
-
-	q = xnarch_nodiv_ullimd(value, bln_frac.frac, bln_frac.integ);
-	r = value - q * 1000000000;
-	if (r >= 1000000000) {
-		++q;
-		r -= 1000000000;
-	}
-	*rem = r;
-	return q;
-}
-#else /* !XNARCH_HAVE_NODIV_LLIMD */
-long long xnarch_ns_to_tsc(long long ns)
-{
-	return xnarch_llimd(ns, 1 << tsc_shift, tsc_scale);
-}
-#endif /* !XNARCH_HAVE_NODIV_LLIMD */
-
-#else  /* !XNARCH_HAVE_LLMULSHFT */
+/*
+ * tsc -> ns uses the multiply-shift factors, ns -> tsc their exact
+ * inverse, so that round trips remain consistent.
+ */
+#ifdef __KERNEL__
+xnarch_conv_t xnarch_tsc2ns_conv;
+xnarch_conv_t xnarch_ns2tsc_conv;
+xnarch_conv_t xnarch_bln_conv;
+#else /* !__KERNEL__ */
+static xnarch_conv_t xnarch_tsc2ns_conv;
+static xnarch_conv_t xnarch_ns2tsc_conv;
+static xnarch_conv_t xnarch_bln_conv;
 
 long long xnarch_tsc_to_ns(long long ticks)
 {
-	return xnarch_llimd(ticks, 1000000000, clockfreq);
+	return xnarch_conv_scale(&xnarch_tsc2ns_conv, ticks);
 }
 
 long long xnarch_tsc_to_ns_rounded(long long ticks)
 {
-	return (xnarch_llimd(ticks, 1000000000, clockfreq/2) + 1) / 2;
+	unsigned int shift = xnarch_tsc2ns_conv.shift - 1;
+	return (xnarch_llmulshft(ticks, xnarch_tsc2ns_conv.mult, shift) + 1) / 2;
 }
 
 long long xnarch_ns_to_tsc(long long ns)
 {
-	return xnarch_llimd(ns, clockfreq, 1000000000);
+	return xnarch_conv_scale_exact(&xnarch_ns2tsc_conv, ns);
 }
-#endif /* !XNARCH_HAVE_LLMULSHFT */
 
-#ifndef XNARCH_HAVE_NODIV_LLIMD
 unsigned long long xnarch_divrem_billion(unsigned long long value,
 					 unsigned long *rem)
 {
-	return xnarch_ulldiv(value, 1000000000, rem);
-
+	return xnarch_conv_divrem(&xnarch_bln_conv, value, rem);
 }
-#endif /* !XNARCH_HAVE_NODIV_LLIMD */
+#endif /* !__KERNEL__ */
 
 static void xnarch_init_timeconv(unsigned long long freq)
 {
-	clockfreq = freq;
-#ifdef XNARCH_HAVE_LLMULSHFT
-	xnarch_init_llmulshft(1000000000, freq, &tsc_scale, &tsc_shift);
-#ifdef XNARCH_HAVE_NODIV_LLIMD
-	xnarch_init_u32frac(&tsc_frac, 1 << tsc_shift, tsc_scale);
-	xnarch_init_u32frac(&bln_frac, 1, 1000000000);
-#endif
-#endif
+	xnarch_init_conv(&xnarch_tsc2ns_conv, 1000000000, freq);
+	xnarch_init_conv(&xnarch_ns2tsc_conv,
+			 1 << xnarch_tsc2ns_conv.shift, xnarch_tsc2ns_conv.mult);
+	xnarch_init_conv(&xnarch_bln_conv, 1, 1000000000);
 }
 
 #ifdef __KERNEL__
-EXPORT_SYMBOL_GPL(xnarch_tsc_to_ns);
-EXPORT_SYMBOL_GPL(xnarch_ns_to_tsc);
-EXPORT_SYMBOL_GPL(xnarch_divrem_billion);
+EXPORT_SYMBOL_GPL(xnarch_tsc2ns_conv);
+EXPORT_SYMBOL_GPL(xnarch_ns2tsc_conv);
+EXPORT_SYMBOL_GPL(xnarch_bln_conv);
 #endif /* __KERNEL__ */
 
 #endif /* !_XENO_ASM_GENERIC_BITS_TIMECONV_H */
@@ -1,6 +1,7 @@
 #ifndef _XENO_ASM_GENERIC_CURRENT_H
 #define _XENO_ASM_GENERIC_CURRENT_H
 
+#include <errno.h>
 #include <pthread.h>
 #include <nucleus/thread.h>
 
@@ -28,9 +29,28 @@ static inline unsigned long xeno_get_current_mode(void)
 	return xeno_current_mode ? *xeno_current_mode : XNRELAX;
 }
 
+static inline struct xnthread_user_window *xeno_get_current_window(void)
+{
+	/* The mode variable is the first word of the state window. */
+	return (struct xnthread_user_window *)xeno_current_mode;
+}
+
+static inline xnhandle_t xeno_get_current_and_mode(unsigned long *mode)
+{
+	*mode = xeno_get_current_mode();
+
+	return xeno_current;
+}
+
 #else /* ! HAVE___THREAD */
 extern pthread_key_t xeno_current_key;
 
+/*
+ * Value of the current key for threads known not to be Xenomai
+ * threads, so that they do not issue a syscall on each lookup.
+ */
+#define XENO_CURRENT_NONE	((void *)-1L)
+
 xnhandle_t xeno_slow_get_current(void);
 
 unsigned long xeno_slow_get_current_mode(void);
@@ -39,6 +59,9 @@ static inline xnhandle_t xeno_get_current(void)
 {
 	void *val = pthread_getspecific(xeno_current_key);
 
+	if (unlikely(val == XENO_CURRENT_NONE))
+		return XN_NO_HANDLE;
+
 	return (xnhandle_t)val ?: xeno_slow_get_current();
 }
 
@@ -47,6 +70,9 @@ static inline xnhandle_t xeno_get_current_fast(void)
 {
 	void *val = pthread_getspecific(xeno_current_key);
 
+	if (val == XENO_CURRENT_NONE)
+		return XN_NO_HANDLE;
+
 	return (xnhandle_t)val ?: XN_NO_HANDLE;
 }
 
@@ -59,8 +85,97 @@ static inline unsigned long xeno_get_current_mode(void)
 	return mode ? *mode : XNRELAX;
 }
 
+static inline struct xnthread_user_window *xeno_get_current_window(void)
+{
+	return pthread_getspecific(xeno_current_mode_key);
+}
+
+/*
+ * The kernel publishes the handle in the state window, so that a
+ * single TSD lookup yields both.
+ */
+static inline xnhandle_t xeno_get_current_and_mode(unsigned long *mode)
+{
+	struct xnthread_user_window *window;
+
+	window = pthread_getspecific(xeno_current_mode_key);
+	if (likely(window && window->handle != XN_NO_HANDLE)) {
+		*mode = window->state;
+		return window->handle;
+	}
+
+	*mode = XNRELAX;
+
+	return xeno_get_current();
+}
+
 #endif /* ! HAVE___THREAD */
 
+/*
+ * Take a consistent snapshot of the state window of the current
+ * thread, without issuing any syscall. Returns zero on success, or
+ * -EPERM if the caller is not a Xenomai thread.
+ */
+static inline int xeno_read_current_window(struct xnthread_user_window *snap)
+{
+	struct xnthread_user_window *window = xeno_get_current_window();
+	unsigned seq;
+
+	if (window == NULL)
+		return -EPERM;
+
+	do {
+		seq = xnread_seqcount_begin(&window->seq);
+		*snap = *window;
+	} while (xnread_seqcount_retry(&window->seq, seq));
+
+	return 0;
+}
+
+int xeno_slow_sched_unlock(void);
+
+/*
+ * Lock the scheduler for the current thread, without issuing any
+ * syscall: the nucleus won't preempt it while it runs in primary
+ * mode, until the count drops back to zero. Returns -EPERM if the
+ * caller is not a Xenomai thread or runs in secondary mode, in which
+ * case it should fall back to the skin syscall.
+ */
+static inline int xeno_sched_lock(void)
+{
+	struct xnthread_user_window *window = xeno_get_current_window();
+
+	if (window == NULL || (window->state & XNRELAX))
+		return -EPERM;
+
+	window->schedlck++;
+	__asm__ __volatile__("": : :"memory");
+
+	return 0;
+}
+
+/*
+ * Drop a lock taken by xeno_sched_lock(), entering the nucleus only
+ * if it deferred a rescheduling meanwhile. Returns -EPERM if the
+ * window holds no lock.
+ */
+static inline int xeno_sched_unlock(void)
+{
+	struct xnthread_user_window *window = xeno_get_current_window();
+
+	if (window == NULL || window->schedlck == 0)
+		return -EPERM;
+
+	__asm__ __volatile__("": : :"memory");
+	if (--window->schedlck == 0) {
+		__asm__ __volatile__("": : :"memory");
+		if (window->schedpend)
+			return xeno_slow_sched_unlock();
+	}
+
+	return 0;
+}
+
 void xeno_init_current_keys(void);
 
 void xeno_set_current(void);
@@ -446,6 +446,13 @@ struct rthal_apc_desc {
 	unsigned long hits[RTHAL_NR_CPUS];
 };
 
+/* Per-CPU APC drain accounting, times in TSC units. */
+struct rthal_apc_stats {
+	unsigned long batches;
+	unsigned long long drain_time;
+	unsigned long long drain_max;
+};
+
 typedef int (*rthal_trap_handler_t)(unsigned trapno,
 				    rthal_pipeline_stage_t *stage,
 				    void *data);
@@ -472,6 +479,8 @@ extern struct rthal_apc_desc rthal_apc_table[RTHAL_NR_APCS];
 
 extern unsigned long rthal_apc_pending[RTHAL_NR_CPUS];
 
+extern struct rthal_apc_stats rthal_apc_stats[RTHAL_NR_CPUS];
+
 extern unsigned int rthal_apc_virq;
 
 extern unsigned long rthal_apc_pending[RTHAL_NR_CPUS];
@@ -530,10 +539,18 @@ int rthal_apc_alloc(const char *name,
 
 void rthal_apc_free(int apc);
 
+/*
+ * Must be called with hw interrupts off. The virq is only kicked for
+ * the first APC of a batch: as long as the pending mask is non-zero,
+ * the dispatcher is bound to run and pick up any bit we add.
+ */
 static inline void __rthal_apc_schedule(int apc)
 {
 	int cpu = rthal_processor_id();
-	if (!__test_and_set_bit(apc, &rthal_apc_pending[cpu]))
+	unsigned long pending = rthal_apc_pending[cpu];
+
+	rthal_apc_pending[cpu] = pending | (1UL << apc);
+	if (pending == 0)
 		rthal_schedule_irq_root(rthal_apc_virq);
 }
 
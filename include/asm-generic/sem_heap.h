@@ -3,4 +3,20 @@
 
 extern unsigned long xeno_sem_heap[2];
 
+extern unsigned long xeno_sem_heap_mapsz[2];
+
+void xeno_sem_heap_map(unsigned int shared, unsigned long off);
+
+/*
+ * Semaphore heaps may grow in kernel space; map the extent covering
+ * the given offset on first access if it is not mapped yet.
+ */
+static inline void *xeno_sem_heap_addr(unsigned int shared, unsigned long off)
+{
+	if (off >= xeno_sem_heap_mapsz[shared])
+		xeno_sem_heap_map(shared, off);
+
+	return (void *)(xeno_sem_heap[shared] + off);
+}
+
 #endif /* SEM_HEAP_H */
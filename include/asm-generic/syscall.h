@@ -36,6 +36,10 @@
 #define __xn_sys_current	8	/* threadh = xnthread_handle(cur) */
 #define __xn_sys_current_info	9	/* r = xnshadow_current_info(&info) */
 #define __xn_sys_mayday        10	/* request mayday fixup */
+#define __xn_sys_heap_extent   11	/* r = xnheap_mapped_extent(heap,index,&area) */
+#define __xn_sys_sched_unlock  12	/* xnpod_schedule() deferred by the window lock */
+#define __xn_sys_heap_alloc    13	/* r = xnheap_alloc(malloc_heap,size), &offset */
+#define __xn_sys_heap_free     14	/* r = xnheap_free(malloc_heap,offset) */
 
 #define XENOMAI_LINUX_DOMAIN  0
 #define XENOMAI_XENO_DOMAIN   1
@@ -122,6 +126,7 @@ extern int nkerrptd;
 
 #define __xn_copy_from_user(dstP, srcP, n)	__copy_from_user_inatomic(dstP, srcP, n)
 #define __xn_copy_to_user(dstP, srcP, n)	__copy_to_user_inatomic(dstP, srcP, n)
+#define __xn_copy_from_user_nocache(dstP, srcP, n)	wrap_copy_from_user_nocache(dstP, srcP, n)
 #define __xn_put_user(src, dstP)		__put_user(src, dstP)
 #define __xn_get_user(dst, srcP)		__get_user(dst, srcP)
 #define __xn_strncpy_from_user(dstP, srcP, n)	wrap_strncpy_from_user(dstP, srcP, n)
@@ -133,6 +138,41 @@ static inline int __xn_safe_copy_from_user(void *dst, const void __user *src,
 		__xn_copy_from_user(dst, src, size)) ? -EFAULT : 0;
 }
 
+static inline int __xn_safe_copy_from_user_nocache(void *dst,
+						   const void __user *src,
+						   size_t size)
+{
+	return (!access_rok(src, size) ||
+		__xn_copy_from_user_nocache(dst, src, size)) ? -EFAULT : 0;
+}
+
+/*
+ * Bulk payloads (message queues, pipes, buffers) reaching the
+ * configured size are streamed with non-temporal stores when the
+ * architecture provides such a copy routine, so that they do not
+ * evict the working set of the real-time threads from the caches.
+ * Smaller transfers go through the regular copy routine.
+ */
+static inline int __xn_nocache_copy_p(size_t size)
+{
+#ifdef CONFIG_XENO_OPT_BUFD_NOCACHE_THRESHOLD
+	return CONFIG_XENO_OPT_BUFD_NOCACHE_THRESHOLD > 0 &&
+		size >= CONFIG_XENO_OPT_BUFD_NOCACHE_THRESHOLD;
+#else
+	return 0;
+#endif
+}
+
+static inline int __xn_safe_copy_from_user_bulk(void *dst,
+						const void __user *src,
+						size_t size)
+{
+	if (__xn_nocache_copy_p(size))
+		return __xn_safe_copy_from_user_nocache(dst, src, size);
+
+	return __xn_safe_copy_from_user(dst, src, size);
+}
+
 static inline int __xn_safe_copy_to_user(void __user *dst, const void *src,
 					 size_t size)
 {
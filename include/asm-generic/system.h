@@ -93,6 +93,43 @@ static inline unsigned xnarch_current_cpu(void)
 	return rthal_processor_id();
 }
 
+#if defined(CONFIG_SMP) && defined(CONFIG_XENO_OPT_STATS)
+/*
+ * Contention accounting: the slow acquisition path counts the
+ * contended acquisitions and the time spent spinning. All counters
+ * are updated once the lock is held, so they need no atomic ops.
+ * Locks attached to a profile (see xnlock_stat_attach()) also get a
+ * histogram of their spin times, and their top contending sites.
+ */
+#define XNLOCK_CONTENTION_STATS
+#define XNLOCK_STAT_BUCKETS	20	/* log2(ns), last one is >= 2^18 ns */
+#define XNLOCK_STAT_SITES	4
+
+struct xnlockstat {
+	void *lock;
+	char name[32];
+	unsigned long hist[XNLOCK_STAT_BUCKETS];
+	struct {
+		void *ip;
+		unsigned long count;
+	} sites[XNLOCK_STAT_SITES];
+};
+
+#define XNLOCK_STAT_FIELDS			\
+	unsigned long acquired;			\
+	unsigned long contended;		\
+	unsigned long long spin_tsc;		\
+	struct xnlockstat *stat;
+
+#define xnlock_stat_acquired(lock)	((lock)->acquired++)
+
+void xnlock_stat_record(struct xnlockstat *stat,
+			unsigned long long spin, void *ip);
+#else
+#define XNLOCK_STAT_FIELDS
+#define xnlock_stat_acquired(lock)	do { } while (0)
+#endif
+
 #if XENO_DEBUG(XNLOCK)
 
 typedef struct {
@@ -114,6 +151,7 @@ typedef struct {
 	int cpu;
 	unsigned long long spin_time;
 	unsigned long long lock_date;
+	XNLOCK_STAT_FIELDS
 
 } xnlock_t;
 
@@ -205,7 +243,10 @@ static inline int xnlock_dbg_release(xnlock_t *lock)
 
 #else /* !XENO_DEBUG(XNLOCK) */
 
-typedef struct { atomic_t owner; } xnlock_t;
+typedef struct {
+	atomic_t owner;
+	XNLOCK_STAT_FIELDS
+} xnlock_t;
 
 #define XNARCH_LOCK_UNLOCKED		(xnlock_t) { { ~0 } }
 
@@ -279,8 +320,10 @@ typedef struct xnarch_heapcb {
 
 	unsigned long numaps;	/* # of active user-space mappings. */
 	int kmflags;		/* Kernel memory flags (0 if vmalloc()). */
+	int node;		/* Memory node backing the heap, -1 if any. */
 	void *heapbase;		/* Shared heap memory base. */
 	void (*release)(struct xnheap *heap); /* callback upon last unmap */
+	unsigned long faults;	/* # of faults real-time threads took over mappings. */
 
 } xnarch_heapcb_t;
 
@@ -298,7 +341,21 @@ static inline unsigned long long xnarch_get_clock_freq(void)
 	return RTHAL_CLOCK_FREQ;
 }
 
+#ifdef CONFIG_XENO_OPT_TSC_SYNC
+/*
+ * Per-CPU corrections of the TSC skew, maintained by the nucleus
+ * (see nucleus/tscsync.c), so that time stamps taken on different
+ * CPUs are consistent.
+ */
+extern long xnarch_tsc_offset[];
+
+static inline unsigned long long xnarch_get_cpu_tsc(void)
+{
+	return rthal_rdtsc() + xnarch_tsc_offset[xnarch_current_cpu()];
+}
+#else /* !CONFIG_XENO_OPT_TSC_SYNC */
 #define xnarch_get_cpu_tsc			rthal_rdtsc
+#endif /* !CONFIG_XENO_OPT_TSC_SYNC */
 
 static inline void xnarch_begin_panic(void)
 {
@@ -361,6 +418,7 @@ static inline int __xnlock_get(xnlock_t *lock /*, */ XNLOCK_DBG_CONTEXT_ARGS)
 	if (unlikely(atomic_cmpxchg(&lock->owner, ~0, cpu) != ~0))
 		__xnlock_spin(lock /*, */ XNLOCK_DBG_PASS_CONTEXT);
 
+	xnlock_stat_acquired(lock);
 	xnlock_dbg_acquired(lock, cpu, &start /*, */ XNLOCK_DBG_PASS_CONTEXT);
 
 	return 0;
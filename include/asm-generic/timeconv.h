@@ -19,14 +19,52 @@
 #ifndef _XENO_ASM_GENERIC_TIMECONV_H
 #define _XENO_ASM_GENERIC_TIMECONV_H
 
-#ifndef __KERNEL__
+#ifdef __KERNEL__
+
+#include <asm/xenomai/arith.h>
+
+/*
+ * Conversions are inlined in kernel space, since they sit on the
+ * timer hot paths.
+ */
+extern xnarch_conv_t xnarch_tsc2ns_conv;
+extern xnarch_conv_t xnarch_ns2tsc_conv;
+extern xnarch_conv_t xnarch_bln_conv;
+
+static inline long long xnarch_tsc_to_ns(long long ticks)
+{
+	return xnarch_conv_scale(&xnarch_tsc2ns_conv, ticks);
+}
+
+static inline long long xnarch_tsc_to_ns_rounded(long long ticks)
+{
+	unsigned int shift = xnarch_tsc2ns_conv.shift - 1;
+	return (xnarch_llmulshft(ticks, xnarch_tsc2ns_conv.mult, shift) + 1) / 2;
+}
+
+static inline long long xnarch_ns_to_tsc(long long ns)
+{
+	return xnarch_conv_scale_exact(&xnarch_ns2tsc_conv, ns);
+}
+
+static inline unsigned long long
+xnarch_divrem_billion(unsigned long long value, unsigned long *rem)
+{
+	return xnarch_conv_divrem(&xnarch_bln_conv, value, rem);
+}
+
+#else /* !__KERNEL__ */
+
 extern xnsysinfo_t sysinfo;
 
 void xeno_init_timeconv(int muxid);
-#endif
 
 long long xnarch_tsc_to_ns(long long ticks);
 long long xnarch_tsc_to_ns_rounded(long long ticks);
 long long xnarch_ns_to_tsc(long long ns);
+unsigned long long xnarch_divrem_billion(unsigned long long value,
+					 unsigned long *rem);
+
+#endif /* !__KERNEL__ */
 
 #endif /* !_XENO_ASM_GENERIC_TIMECONV_H */
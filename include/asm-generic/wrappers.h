@@ -504,6 +504,14 @@ static inline void *kzalloc(size_t size, int flags)
 #define IRQF_SHARED			SA_SHIRQ
 #endif /* < 2.6.18 */
 
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,20)
+#define wrap_copy_from_user_nocache(to, from, n)	\
+	__copy_from_user_inatomic(to, from, n)
+#else /* >= 2.6.20 */
+#define wrap_copy_from_user_nocache(to, from, n)	\
+	__copy_from_user_inatomic_nocache(to, from, n)
+#endif /* >= 2.6.20 */
+
 #if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,26)
 #define clamp(val, min, max) ({			\
 	typeof(val) __val = (val);		\
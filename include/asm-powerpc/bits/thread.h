@@ -54,7 +54,7 @@ static inline void xnarch_init_tcb(xnarchtcb_t *tcb)
 	(tcb)->stackbase = NULL; \
 	__err = 0; \
     } else { \
-       (tcb)->stackbase = xnheap_alloc(&kstacks, stacksize);	\
+       (tcb)->stackbase = xnheap_alloc_stack(stacksize);	\
 	__err = (tcb)->stackbase ? 0 : -ENOMEM; \
     } \
     __err; \
@@ -63,7 +63,7 @@ static inline void xnarch_init_tcb(xnarchtcb_t *tcb)
 #define xnarch_free_stack(tcb) \
 do { \
       if ((tcb)->stackbase) \
-	  xnheap_free(&kstacks, (tcb)->stackbase);	\
+	  xnheap_free_stack((tcb)->stackbase, (tcb)->stacksize);	\
 } while(0)
 
 #endif /* !_XENO_ASM_POWERPC_BITS_THREAD_H */
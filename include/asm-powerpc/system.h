@@ -109,6 +109,7 @@ typedef struct xnarch_fltinfo {
 /* The following predicates are only usable over a regular Linux stack
    context. */
 #define xnarch_fault_pf_p(fi)   ((fi)->exception == IPIPE_TRAP_ACCESS)
+#define xnarch_fault_addr(fi)   ((fi)->regs->dar)
 #ifdef CONFIG_PPC64
 #define xnarch_fault_bp_p(fi)   ((current->ptrace & PT_PTRACED) && \
 				 ((fi)->exception == IPIPE_TRAP_IABR || \
@@ -186,6 +186,24 @@ static inline unsigned long long xnarch_ulldiv(unsigned long long ull,
     return ull / uld;
 }
 
+typedef struct xnarch_conv {
+    unsigned long d;
+} xnarch_conv_t;
+
+static inline void xnarch_init_conv(xnarch_conv_t *c,
+				    unsigned m,
+				    unsigned d)
+{
+    c->d = d;
+}
+
+static inline unsigned long long xnarch_conv_divrem(const xnarch_conv_t *c,
+						    unsigned long long op,
+						    unsigned long *rem)
+{
+    return xnarch_ulldiv(op, c->d, rem);
+}
+
 static inline unsigned long ffnz(unsigned long word)
 {
 #if __WORDSIZE == 32
@@ -211,6 +229,8 @@ typedef int atomic_counter_t;
 typedef unsigned long atomic_flags_t;
 
 #define xnarch_memory_barrier()
+#define xnarch_read_memory_barrier()
+#define xnarch_write_memory_barrier()
 #define xnarch_atomic_set(pcounter,i)          (*(pcounter) = (i))
 #define xnarch_atomic_get(pcounter)            (*(pcounter))
 #define xnarch_atomic_inc(pcounter)            (++(*(pcounter)))
@@ -88,10 +88,69 @@ typedef struct xnarch_fltinfo {
 #define xnarch_fault_pc(fi)     ((fi)->regs->x86reg_ip)
 #define xnarch_fault_fpu_p(fi)  ((fi)->vector == 7)
 #define xnarch_fault_pf_p(fi)   ((fi)->vector == 14)
+#define xnarch_fault_addr(fi)   read_cr2()
 #define xnarch_fault_bp_p(fi)   ((current->ptrace & PT_PTRACED) &&	\
 				 ((fi)->vector == 1 || (fi)->vector == 3))
 #define xnarch_fault_notify(fi) (!xnarch_fault_bp_p(fi))
 
+/* Frame record of user code built with frame pointers (profiler). */
+#define XNARCH_HAVE_USER_FRAMES
+struct xnarch_user_frame {
+	unsigned long next;	/* Caller's frame pointer. */
+	unsigned long ret;	/* Return address. */
+};
+#define xnarch_user_sp(regs)	((regs)->x86reg_sp)
+#define xnarch_user_fp(regs)	((regs)->x86reg_bp)
+#define xnarch_user_frame_addr(fp)	(fp)
+
+#ifdef CONFIG_XENO_OPT_CACHE_PARTITION
+/*
+ * L3 Cache Allocation Technology. The class of service (CLOS) the
+ * CPU fills the L3 cache on behalf of is held in the upper half of
+ * IA32_PQR_ASSOC, each class being allowed the ways set in its
+ * IA32_L3_QOS_MASK_n register.
+ */
+#include <asm/msr.h>
+#include <asm/processor.h>
+
+#define XNARCH_HAVE_CACHE_PARTITION
+#define XNARCH_MSR_PQR_ASSOC		0xc8f
+#define XNARCH_MSR_L3_QOS_MASK(clos)	(0xc90 + (clos))
+
+/* Returns the number of classes, zero if L3 CAT is unavailable. */
+static inline int xnarch_cacheclass_probe(unsigned int *cbm_len)
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (boot_cpu_data.x86_vendor != X86_VENDOR_INTEL ||
+	    boot_cpu_data.cpuid_level < 0x10)
+		return 0;
+
+	cpuid_count(0x7, 0, &eax, &ebx, &ecx, &edx);
+	if (!(ebx & (1 << 15)))	/* PQE */
+		return 0;
+
+	cpuid_count(0x10, 0, &eax, &ebx, &ecx, &edx);
+	if (!(ebx & (1 << 1)))	/* L3 CAT */
+		return 0;
+
+	cpuid_count(0x10, 1, &eax, &ebx, &ecx, &edx);
+	*cbm_len = (eax & 0x1f) + 1;
+
+	return (edx & 0xffff) + 1;
+}
+
+#define xnarch_read_cacheclass(lo, hi)	rdmsr(XNARCH_MSR_PQR_ASSOC, lo, hi)
+#define xnarch_write_cacheclass(lo, hi)	wrmsr(XNARCH_MSR_PQR_ASSOC, lo, hi)
+#define xnarch_read_cachemask(clos, mask)				\
+	do {								\
+		u32 __hi;						\
+		rdmsr(XNARCH_MSR_L3_QOS_MASK(clos), mask, __hi);	\
+	} while (0)
+#define xnarch_write_cachemask(clos, mask)			\
+	wrmsr(XNARCH_MSR_L3_QOS_MASK(clos), mask, 0)
+#endif /* CONFIG_XENO_OPT_CACHE_PARTITION */
+
 static inline void *xnarch_alloc_host_mem(unsigned long bytes)
 {
 	if (bytes > 128*1024)
@@ -38,6 +38,18 @@ typedef struct rt_alarm_placeholder {
     xnhandle_t opaque;
 } RT_ALARM_PLACEHOLDER;
 
+typedef struct rt_alarm_expiry {
+
+    xnhandle_t alarm;		/* !< Registry handle of the alarm. */
+
+    unsigned long overruns;	/* !< Expiries coalesced into this one. */
+
+} RT_ALARM_EXPIRY;
+
+typedef struct rt_alarm_group_placeholder {
+    xnhandle_t opaque;
+} RT_ALARM_GROUP_PLACEHOLDER;
+
 #if defined(__KERNEL__) || defined(__XENO_SIM__)
 
 #include <nucleus/timer.h>
@@ -45,6 +57,9 @@ typedef struct rt_alarm_placeholder {
 #include <native/ppd.h>
 
 #define XENO_ALARM_MAGIC 0x55550909
+#define XENO_ALARM_GROUP_MAGIC 0x55550e0e
+
+struct rt_alarm_group;
 
 typedef struct rt_alarm {
 
@@ -60,6 +75,18 @@ typedef struct rt_alarm {
 
     unsigned long expiries;	/* !< Number of expiries. */
 
+    struct rt_alarm_group *group; /* !< Group the alarm posts to, if any. */
+
+    xnholder_t glink;		/* !< Link in group's alarm queue. */
+
+#define glink2alarm(ln)	container_of(ln, RT_ALARM, glink)
+
+    xnholder_t plink;		/* !< Link in group's pending queue. */
+
+#define plink2alarm(ln)	container_of(ln, RT_ALARM, plink)
+
+    unsigned long gpending;	/* !< Expiries not collected by the group yet. */
+
 #ifdef CONFIG_XENO_OPT_PERVASIVE
     pid_t cpid;			/* !< Creator's pid. */
 
@@ -76,6 +103,32 @@ typedef struct rt_alarm {
 
 } RT_ALARM;
 
+typedef struct rt_alarm_group {
+
+    unsigned magic;   /* !< Magic code - must be first */
+
+    xnhandle_t handle;	/* !< Handle in registry -- zero if unregistered. */
+
+    xnqueue_t alarmq;		/* !< Attached alarms. */
+
+    xnqueue_t pendq;		/* !< Alarms with uncollected expiries. */
+
+    xnsynch_t synch_base;	/* !< Base synchronization object. */
+
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+    pid_t cpid;			/* !< Creator's pid. */
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+
+    xnholder_t rlink;		/* !< Link in resource queue. */
+
+#define rlink2alarm_group(ln)	container_of(ln, RT_ALARM_GROUP, rlink)
+
+    xnqueue_t *rqueue;		/* !< Backpointer to resource queue. */
+
+    char name[XNOBJECT_NAME_LEN]; /* !< Symbolic name. */
+
+} RT_ALARM_GROUP;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -91,11 +144,17 @@ static inline void __native_alarm_flush_rq(xnqueue_t *rq)
 	xeno_flush_rq(RT_ALARM, rq, alarm);
 }
 
+static inline void __native_alarm_group_flush_rq(xnqueue_t *rq)
+{
+	xeno_flush_rq(RT_ALARM_GROUP, rq, alarm_group);
+}
+
 #else /* !CONFIG_XENO_OPT_NATIVE_ALARM */
 
 #define __native_alarm_pkg_init()		({ 0; })
 #define __native_alarm_pkg_cleanup()		do { } while(0)
 #define __native_alarm_flush_rq(rq)		do { } while(0)
+#define __native_alarm_group_flush_rq(rq)	do { } while(0)
 
 #endif /* !CONFIG_XENO_OPT_NATIVE_ALARM */
 
@@ -104,6 +163,9 @@ int rt_alarm_create(RT_ALARM *alarm,
 		    rt_alarm_t handler,
 		    void *cookie);
 
+int rt_alarm_group_create(RT_ALARM_GROUP *group,
+			  const char *name);
+
 #ifdef CONFIG_XENO_OPT_PERVASIVE
 
 void rt_alarm_handler(RT_ALARM *alarm,
@@ -119,6 +181,8 @@ void rt_alarm_handler(RT_ALARM *alarm,
 
 typedef RT_ALARM_PLACEHOLDER RT_ALARM;
 
+typedef RT_ALARM_GROUP_PLACEHOLDER RT_ALARM_GROUP;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -126,6 +190,9 @@ extern "C" {
 int rt_alarm_create(RT_ALARM *alarm,
 		    const char *name);
 
+int rt_alarm_group_create(RT_ALARM_GROUP *group,
+			  const char *name);
+
 int rt_alarm_wait(RT_ALARM *alarm);
 
 #ifdef __cplusplus
@@ -153,6 +220,16 @@ int rt_alarm_stop(RT_ALARM *alarm);
 int rt_alarm_inquire(RT_ALARM *alarm,
 		     RT_ALARM_INFO *info);
 
+int rt_alarm_group_delete(RT_ALARM_GROUP *group);
+
+int rt_alarm_attach(RT_ALARM *alarm,
+		    RT_ALARM_GROUP *group);
+
+int rt_alarm_group_wait(RT_ALARM_GROUP *group,
+			RT_ALARM_EXPIRY *buf,
+			int nr,
+			RTIME timeout);
+
 #ifdef __cplusplus
 }
 #endif
@@ -46,6 +46,7 @@ typedef struct rt_buffer_placeholder {
 
 #include <nucleus/synch.h>
 #include <nucleus/heap.h>
+#include <nucleus/select.h>
 #include <native/ppd.h>
 
 #define XENO_BUFFER_MAGIC 0x55550c0c
@@ -63,6 +64,11 @@ typedef struct rt_buffer {
 	off_t rdoff;		/* !< Read offset. */
 	off_t wroff;		/* !< Write offset. */
 	size_t fillsz;		/* !< Filled space. */
+	size_t rsvsz;		/* !< Reserved, uncommitted space. */
+	size_t holesz;		/* !< Aborted space past the filled one. */
+	xnqueue_t rsvq;		/* !< Pending reservations, in offset order. */
+	DECLARE_XNSELECT(read_select); /* !< Selector bindings for input. */
+	DECLARE_XNSELECT(write_select); /* !< Selector bindings for output. */
 
 	u_long wrtoken;		/* !< Write token. */
 	u_long rdtoken;		/* !< Read token. */
@@ -79,6 +85,21 @@ typedef struct rt_buffer {
 
 } RT_BUFFER;
 
+typedef struct rt_buffer_rsv {
+
+	void *ptr[2];		/* !< Reserved segments. */
+	size_t len[2];		/* !< Segment lengths, len[1] is zero unless wrapped. */
+
+	/* Internal. */
+	size_t size;
+	off_t off;
+	int done;
+	int aborted;
+	xnholder_t link;
+#define link2rsv(ln)	container_of(ln, RT_BUFFER_RSV, link)
+
+} RT_BUFFER_RSV;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -102,6 +123,22 @@ ssize_t rt_buffer_read_inner(RT_BUFFER *bf, struct xnbufd *bufd,
 ssize_t rt_buffer_write_inner(RT_BUFFER *bf, struct xnbufd *bufd,
 			      xntmode_t timeout_mode, RTIME timeout);
 
+int rt_buffer_reserve_inner(RT_BUFFER *bf, size_t len, RT_BUFFER_RSV *rsv,
+			    xntmode_t timeout_mode, RTIME timeout);
+
+int rt_buffer_reserve(RT_BUFFER *bf, size_t len, RT_BUFFER_RSV *rsv,
+		      RTIME timeout);
+
+int rt_buffer_reserve_until(RT_BUFFER *bf, size_t len, RT_BUFFER_RSV *rsv,
+			    RTIME timeout);
+
+int rt_buffer_commit(RT_BUFFER *bf, RT_BUFFER_RSV *rsv);
+
+#ifdef CONFIG_XENO_OPT_SELECT
+int rt_buffer_select_bind(RT_BUFFER *bf, struct xnselector *selector,
+			  unsigned type, unsigned index);
+#endif /* CONFIG_XENO_OPT_SELECT */
+
 #else /* !CONFIG_XENO_OPT_NATIVE_BUFFER */
 
 #define __native_buffer_pkg_init()		({ 0; })
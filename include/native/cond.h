@@ -65,6 +65,8 @@ typedef struct rt_cond {
 
     xnqueue_t *rqueue;		/* !< Backpointer to resource queue. */
 
+    struct rt_mutex *mutex;	/* !< Mutex all waiters use, if any. */
+
 } RT_COND;
 
 #ifdef __cplusplus
@@ -77,9 +79,11 @@ int __native_cond_pkg_init(void);
 
 void __native_cond_pkg_cleanup(void);
 
+extern xnobjpool_t __native_cond_pool;
+
 static inline void __native_cond_flush_rq(xnqueue_t *rq)
 {
-	xeno_flush_rq(RT_COND, rq, cond);
+	xeno_flush_rq_pool(RT_COND, rq, cond, &__native_cond_pool);
 }
 
 int rt_cond_wait_prologue(RT_COND *cond, RT_MUTEX *mutex, unsigned *plockcnt,
@@ -0,0 +1,181 @@
+/**
+ * @file
+ * This file is part of the Xenomai project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef _XENO_CYCLIC_H
+#define _XENO_CYCLIC_H
+
+#include <native/types.h>
+#include <native/task.h>
+
+#define CY_MAX_SLOTS	256	/* Highest number of minor frames. */
+
+typedef struct rt_cyclic_info {
+
+    RTIME minor;		/* !< Duration of a minor frame. */
+
+    int nslots;			/* !< Number of minor frames. */
+
+    int slot;			/* !< Current minor frame, -1 if stopped. */
+
+    unsigned long frames;	/* !< Number of completed major frames. */
+
+    unsigned long overruns;	/* !< Number of overruns. */
+
+    int last_overrun;		/* !< Slot which overran last, -1 if none. */
+
+    char name[XNOBJECT_NAME_LEN]; /* !< Symbolic name. */
+
+} RT_CYCLIC_INFO;
+
+typedef struct rt_cyclic_placeholder {
+    xnhandle_t opaque;
+} RT_CYCLIC_PLACEHOLDER;
+
+#if defined(__KERNEL__) || defined(__XENO_SIM__)
+
+#include <nucleus/timer.h>
+#include <nucleus/synch.h>
+#include <native/ppd.h>
+
+#define XENO_CYCLIC_MAGIC 0x55550d0d
+
+struct rt_cyclic_slot {
+
+    xnhandle_t threadh;		/* !< Task released by the slot, if any. */
+
+    rt_cyclic_t handler;	/* !< Handler called by the slot, if any. */
+
+    void *cookie;		/* !< Opaque cookie. */
+
+    int busy;			/* !< Released task still running. */
+
+    unsigned long overruns;	/* !< Overruns charged to the slot. */
+
+    unsigned long pending;	/* !< Overruns not reported yet. */
+};
+
+typedef struct rt_cyclic {
+
+    unsigned magic;   /* !< Magic code - must be first */
+
+    xntimer_t timer_base; /* !< Minor frame timer. */
+
+    xnsynch_t synch_base; /* !< Tasks waiting for their slot. */
+
+    xnhandle_t handle;	/* !< Handle in registry -- zero if unregistered. */
+
+    RTIME minor;		/* !< Duration of a minor frame. */
+
+    int nslots;			/* !< Number of minor frames. */
+
+    int slot;			/* !< Current minor frame, -1 if stopped. */
+
+    struct rt_cyclic_slot *slots; /* !< Minor frame table. */
+
+    unsigned long frames;	/* !< Number of completed major frames. */
+
+    unsigned long overruns;	/* !< Number of overruns. */
+
+    int last_overrun;		/* !< Slot which overran last. */
+
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+    pid_t cpid;			/* !< Creator's pid. */
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+
+    xnholder_t rlink;		/* !< Link in resource queue. */
+
+#define rlink2cyclic(ln)	container_of(ln, RT_CYCLIC, rlink)
+
+    xnqueue_t *rqueue;		/* !< Backpointer to resource queue. */
+
+    char name[XNOBJECT_NAME_LEN]; /* !< Symbolic name. */
+
+} RT_CYCLIC;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef CONFIG_XENO_OPT_NATIVE_CYCLIC
+
+int __native_cyclic_pkg_init(void);
+
+void __native_cyclic_pkg_cleanup(void);
+
+static inline void __native_cyclic_flush_rq(xnqueue_t *rq)
+{
+	xeno_flush_rq(RT_CYCLIC, rq, cyclic);
+}
+
+#else /* !CONFIG_XENO_OPT_NATIVE_CYCLIC */
+
+#define __native_cyclic_pkg_init()		({ 0; })
+#define __native_cyclic_pkg_cleanup()		do { } while(0)
+#define __native_cyclic_flush_rq(rq)		do { } while(0)
+
+#endif /* !CONFIG_XENO_OPT_NATIVE_CYCLIC */
+
+int rt_cyclic_attach_handler(RT_CYCLIC *cyclic,
+			     int slot,
+			     rt_cyclic_t handler,
+			     void *cookie);
+
+#ifdef __cplusplus
+}
+#endif
+
+#else /* !(__KERNEL__ || __XENO_SIM__) */
+
+typedef RT_CYCLIC_PLACEHOLDER RT_CYCLIC;
+
+#endif /* __KERNEL__ || __XENO_SIM__ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Public interface. */
+
+int rt_cyclic_create(RT_CYCLIC *cyclic,
+		     const char *name,
+		     RTIME minor,
+		     int nslots);
+
+int rt_cyclic_delete(RT_CYCLIC *cyclic);
+
+int rt_cyclic_attach(RT_CYCLIC *cyclic,
+		     int slot,
+		     RT_TASK *task);
+
+int rt_cyclic_start(RT_CYCLIC *cyclic,
+		    RTIME value);
+
+int rt_cyclic_stop(RT_CYCLIC *cyclic);
+
+int rt_cyclic_wait(RT_CYCLIC *cyclic,
+		   unsigned long *overruns_r);
+
+int rt_cyclic_inquire(RT_CYCLIC *cyclic,
+		      RT_CYCLIC_INFO *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !_XENO_CYCLIC_H */
@@ -24,15 +24,20 @@
 
 #include <nucleus/synch.h>
 #include <native/types.h>
+#include <asm/xenomai/atomic.h>
 
 /* Creation flags. */
 #define EV_PRIO  XNSYNCH_PRIO	/* Pend by task priority order. */
 #define EV_FIFO  XNSYNCH_FIFO	/* Pend by FIFO order. */
+#define EV_COUNT 0x100		/* Count the posts of each flag. */
 
 /* Operation flags. */
 #define EV_ANY  0x1	/* Disjunctive wait. */
 #define EV_ALL  0x0	/* Conjunctive wait. */
 
+/* Number of flags in a group. */
+#define EV_NBITS  (sizeof(unsigned long) * 8)
+
 typedef struct rt_event_info {
 
     unsigned long value; /* !< Current event group value. */
@@ -43,23 +48,105 @@ typedef struct rt_event_info {
 
 } RT_EVENT_INFO;
 
+#if defined(__KERNEL__) || defined(__XENO_SIM__) || defined(CONFIG_XENO_FASTSYNCH)
+
+/*
+ * Event group state, which lives in the semaphore heap when fast
+ * synchronization is available. The flags may be posted and cleared
+ * from user-space with compare-and-swap; the waiter count is only
+ * updated by the kernel under nklock, and tells a user-space poster
+ * whether a wakeup call is needed after a lockless update.
+ */
+struct rt_event_state {
+	xnarch_atomic_t value;	 /* !< Event flags. */
+	xnarch_atomic_t nwaiters; /* !< Tasks sleeping on the group. */
+	int mode;		 /* !< Creation mode. */
+};
+
+static inline int __rt_event_test(unsigned long value,
+				  unsigned long mask, int mode)
+{
+	return (mode & EV_ANY) ? (value & mask) != 0 : (value & mask) == mask;
+}
+
+/* Post flags, returning the updated value. */
+static inline unsigned long __rt_event_post(struct rt_event_state *state,
+					    unsigned long mask)
+{
+	unsigned long cur, old;
+
+	cur = xnarch_atomic_get(&state->value);
+	for (;;) {
+		old = xnarch_atomic_cmpxchg(&state->value, cur, cur | mask);
+		if (old == cur)
+			break;
+		cur = old;
+	}
+	/* Order the update before the waiter check. */
+	xnarch_memory_barrier();
+
+	return cur | mask;
+}
+
+/* Clear flags, returning the previous value. */
+static inline unsigned long __rt_event_clear(struct rt_event_state *state,
+					     unsigned long mask)
+{
+	unsigned long cur, old;
+
+	cur = xnarch_atomic_get(&state->value);
+	for (;;) {
+		old = xnarch_atomic_cmpxchg(&state->value, cur, cur & ~mask);
+		if (old == cur)
+			return cur;
+		cur = old;
+	}
+}
+
+#endif /* __KERNEL__ || __XENO_SIM__ || CONFIG_XENO_FASTSYNCH */
+
 typedef struct rt_event_placeholder {
+
     xnhandle_t opaque;
+
+#ifdef CONFIG_XENO_FASTSYNCH
+    struct rt_event_state *state;
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 } RT_EVENT_PLACEHOLDER;
 
 #if (defined(__KERNEL__) || defined(__XENO_SIM__)) && !defined(DOXYGEN_CPP)
 
+#include <nucleus/select.h>
 #include <native/ppd.h>
 
 #define XENO_EVENT_MAGIC 0x55550404
 
+#define RT_EVENT_EXPORTED	XNSYNCH_SPARE0	/* Event registered by name */
+
 typedef struct rt_event {
 
     unsigned magic;   /* !< Magic code - must be first */
 
     xnsynch_t synch_base; /* !< Base synchronization object. */
 
-    unsigned long value; /* !< Event group value. */
+    struct rt_event_state *state; /* !< Event flags and waiter count. */
+
+    xnpqueue_t bitq[EV_NBITS]; /* !< Sleepers indexed by missing flag. */
+
+    unsigned long bitmask; /* !< Flags which bitq may be non-empty. */
+
+    xnpqueue_t anyq;	/* !< Disjunctive sleepers on several flags. */
+
+    unsigned long anymask; /* !< Flags awaited by anyq sleepers. */
+
+    unsigned long *counts; /* !< Post counts, EV_COUNT groups only. */
+
+    DECLARE_XNSELECT(read_select); /* !< Selector bindings, ready on any flag. */
+
+#ifndef CONFIG_XENO_FASTSYNCH
+    struct rt_event_state statebuf; /* !< Storage for the state. */
+#endif /* !CONFIG_XENO_FASTSYNCH */
 
     xnhandle_t handle;	/* !< Handle in registry -- zero if unregistered. */
 
@@ -87,16 +174,31 @@ int __native_event_pkg_init(void);
 
 void __native_event_pkg_cleanup(void);
 
+extern xnobjpool_t __native_event_pool;
+
 static inline void __native_event_flush_rq(xnqueue_t *rq)
 {
-	xeno_flush_rq(RT_EVENT, rq, event);
+	xeno_flush_rq_pool(RT_EVENT, rq, event, &__native_event_pool);
 }
 
+int rt_event_create_inner(RT_EVENT *event, const char *name,
+			  unsigned long ivalue, int mode, int global);
+
 int rt_event_wait_inner(RT_EVENT *event,
 			unsigned long mask,
 			unsigned long *mask_r,
+			unsigned long *counts,
 			int mode, xntmode_t timeout_mode, RTIME timeout);
 
+void __native_event_forget(struct rt_task *task);
+
+#ifdef CONFIG_XENO_OPT_SELECT
+int rt_event_select_bind(RT_EVENT *event, struct xnselector *selector,
+			 unsigned type, unsigned index);
+
+void __native_event_select_update(RT_EVENT *event);
+#endif /* CONFIG_XENO_OPT_SELECT */
+
 #else /* !CONFIG_XENO_OPT_NATIVE_EVENT */
 
 #define __native_event_pkg_init()		({ 0; })
@@ -125,6 +227,9 @@ static inline int rt_event_unbind (RT_EVENT *event)
 
 {
     event->opaque = XN_NO_HANDLE;
+#ifdef CONFIG_XENO_FASTSYNCH
+    event->state = NULL;
+#endif /* CONFIG_XENO_FASTSYNCH */
     return 0;
 }
 
@@ -162,6 +267,13 @@ int rt_event_wait_until(RT_EVENT *event,
 			int mode,
 			RTIME timeout);
 
+int rt_event_wait_count(RT_EVENT *event,
+			unsigned long mask,
+			unsigned long *mask_r,
+			unsigned long *counts,
+			int mode,
+			RTIME timeout);
+
 int rt_event_clear(RT_EVENT *event,
 		   unsigned long mask,
 		   unsigned long *mask_r);
@@ -35,6 +35,11 @@
 #define H_SHARED   (H_MAPPABLE|H_SINGLE) /* I.e. shared memory segment. */
 #define H_NONCACHED 0x800
 #define H_DMA32     0x1000      /* Use memory suitable for DMA32. */
+#define H_MAGAZINE  0x2000      /* Use per-CPU block caches. */
+#define H_HUGE      0x4000      /* Use huge pages if available. */
+#define H_TLSF      0x8000      /* Use the TLSF allocator. */
+#define H_PREFAULT  0x10000     /* Prefault user-space mappings. */
+#define H_UCACHE    0x20000     /* Use per-thread user-space block caches. */
 
 /** Structure containing heap-information useful to users.
  *
@@ -58,12 +63,25 @@ typedef struct rt_heap_info {
 
 } RT_HEAP_INFO;
 
+/** Structure containing extended heap-information.
+ *
+ *  @see rt_heap_inquire_ext()
+ */
+typedef struct rt_heap_xinfo {
+
+    RT_HEAP_INFO info;		/* !< Same as rt_heap_inquire(). */
+
+    struct xnheap_xstats stats;	/* !< Usage and fragmentation figures. */
+
+} RT_HEAP_XINFO;
+
 typedef struct rt_heap_placeholder {
 	xnhandle_t opaque;
 	void *opaque2;
 	caddr_t mapbase;
 	size_t mapsize;
 	unsigned long area;
+	int mode;
 } RT_HEAP_PLACEHOLDER;
 
 #if defined(__KERNEL__) || defined(__XENO_SIM__)
@@ -176,6 +194,9 @@ int rt_heap_free(RT_HEAP *heap,
 int rt_heap_inquire(RT_HEAP *heap,
 		    RT_HEAP_INFO *info);
 
+int rt_heap_inquire_ext(RT_HEAP *heap,
+			RT_HEAP_XINFO *xinfo);
+
 #ifdef __cplusplus
 }
 #endif
@@ -42,13 +42,50 @@ typedef struct rt_intr_info {
 
 } RT_INTR_INFO;
 
+/*
+ * Interrupt state of objects created from user-space, which lives in
+ * a semaphore heap mapped by the creator, and by the processes
+ * binding to the object if it has a name. The top half updates it
+ * on every hit; user-space consumes the pending count without
+ * issuing any syscall, see rt_intr_poll().
+ */
+typedef struct rt_intr_window {
+
+    xnarch_atomic_t pending;	/* !< Hits not consumed yet. */
+
+    unsigned long hits;		/* !< Hits since creation. */
+
+    unsigned long long date;	/* !< TSC date of the last hit. */
+
+    unsigned cpu;		/* !< CPU which took the last hit. */
+
+} RT_INTR_WINDOW;
+
 typedef struct rt_intr_placeholder {
     xnhandle_t opaque;
+    RT_INTR_WINDOW *window;
 } RT_INTR_PLACEHOLDER;
 
+#if defined(__KERNEL__) || defined(__XENO_SIM__) || defined(CONFIG_XENO_FASTSYNCH)
+/* Grab all pending hits, returns their count. */
+static inline int __rt_intr_consume(RT_INTR_WINDOW *win)
+{
+    unsigned long pending;
+
+    do {
+	pending = xnarch_atomic_get(&win->pending);
+	if (pending == 0)
+	    return 0;
+    } while (xnarch_atomic_cmpxchg(&win->pending, pending, 0) != pending);
+
+    return (int)pending;
+}
+#endif /* __KERNEL__ || __XENO_SIM__ || CONFIG_XENO_FASTSYNCH */
+
 #if (defined(__KERNEL__) || defined(__XENO_SIM__)) && !defined(DOXYGEN_CPP)
 
 #include <nucleus/synch.h>
+#include <nucleus/heap.h>
 #include <native/ppd.h>
 
 #define XENO_INTR_MAGIC 0x55550a0a
@@ -79,7 +116,9 @@ typedef struct rt_intr {
 #ifdef CONFIG_XENO_OPT_PERVASIVE
     int mode;			/* !< Interrupt control mode. */
 
-    int pending;		/* !< Pending hits to process. */
+    RT_INTR_WINDOW *window;	/* !< Shared state, user-space objects only. */
+
+    xnheap_t *wheap;		/* !< Heap the window lives in. */
 
     xnsynch_t synch_base;	/* !< Base synchronization object. */
 
@@ -164,6 +203,8 @@ int rt_intr_create(RT_INTR *intr,
 int rt_intr_wait(RT_INTR *intr,
 		 RTIME timeout);
 
+int rt_intr_poll(RT_INTR *intr);
+
 #ifdef __cplusplus
 }
 #endif
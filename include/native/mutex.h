@@ -98,9 +98,11 @@ int __native_mutex_pkg_init(void);
 
 void __native_mutex_pkg_cleanup(void);
 
+extern xnobjpool_t __native_mutex_pool;
+
 static inline void __native_mutex_flush_rq(xnqueue_t *rq)
 {
-	xeno_flush_rq(RT_MUTEX, rq, mutex);
+	xeno_flush_rq_pool(RT_MUTEX, rq, mutex, &__native_mutex_pool);
 }
 
 int rt_mutex_acquire_inner(RT_MUTEX *mutex, RTIME timeout,
@@ -147,13 +149,18 @@ static inline int rt_mutex_unbind (RT_MUTEX *mutex)
 extern "C" {
 #endif
 
-int rt_mutex_create_inner(RT_MUTEX *mutex, const char *name, int global);
+int rt_mutex_create_inner(RT_MUTEX *mutex, const char *name, int global,
+			  int ceiling);
 
 /* Public interface. */
 
 int rt_mutex_create(RT_MUTEX *mutex,
 		    const char *name);
 
+int rt_mutex_create_ceiling(RT_MUTEX *mutex,
+			    const char *name,
+			    int ceiling);
+
 int rt_mutex_delete(RT_MUTEX *mutex);
 
 int rt_mutex_acquire(RT_MUTEX *mutex,
@@ -43,12 +43,14 @@ typedef struct rt_pipe_placeholder {
 
 #ifdef __KERNEL__
 
+#include <nucleus/timer.h>
 #include <native/ppd.h>
 
 #define XENO_PIPE_MAGIC  0x55550202
 
 #define P_SYNCWAIT  0
 #define P_ATOMIC    1
+#define P_PUSHREQ   2
 
 typedef xnpipe_mh_t RT_PIPE_MSG;
 
@@ -75,6 +77,12 @@ typedef struct rt_pipe {
 
     size_t fillsz;		/* !< Bytes written to the buffer.  */
 
+    size_t fillthr;		/* !< Batching threshold, zero if none. */
+
+    RTIME flushdly;		/* !< Batching delay, TM_INFINITE if none. */
+
+    xntimer_t flush_timer;	/* !< Pushes out batched stream data. */
+
     u_long status;		/* !< Status information. */
 
     xnhandle_t handle;		/* !< Handle in registry -- zero if unregistered. */
@@ -126,6 +134,10 @@ ssize_t rt_pipe_stream(RT_PIPE *pipe,
 		       const void *buf,
 		       size_t size);
 
+int rt_pipe_batch(RT_PIPE *pipe,
+		  size_t threshold,
+		  RTIME delay);
+
 #ifdef __KERNEL__
 
 ssize_t rt_pipe_receive(RT_PIPE *pipe,
@@ -149,6 +161,11 @@ int rt_pipe_flush(RT_PIPE *pipe,
 int rt_pipe_monitor(RT_PIPE *pipe,
 		    int (*fn)(RT_PIPE *pipe, int event, long arg));
 
+#ifdef CONFIG_XENO_OPT_SELECT
+int rt_pipe_select_bind(RT_PIPE *pipe, struct xnselector *selector,
+			unsigned type, unsigned index);
+#endif /* CONFIG_XENO_OPT_SELECT */
+
 #else /* !__KERNEL__ */
 
 int rt_pipe_bind(RT_PIPE *pipe,
@@ -0,0 +1,81 @@
+/**
+ * @file
+ * This file is part of the Xenomai project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef _XENO_POOL_H
+#define _XENO_POOL_H
+
+#include <native/types.h>
+
+/*
+ * Worker pools are a user-space facility: one real-time worker task
+ * per selected CPU, each pulling work items from its own deque and
+ * stealing from the others when it runs dry. Items are only queued
+ * and dequeued with atomic operations; workers block on a semaphore
+ * when every deque is empty.
+ */
+
+/* Workers are pinned with T_CPU(), which covers CPUs 0-7. */
+#define RT_POOL_MAX_WORKERS  8
+
+typedef struct rt_pool_work {
+
+    void (*handler)(void *cookie); /* !< Work handler. */
+
+    void *cookie;		/* !< Argument passed to the handler. */
+
+} RT_POOL_WORK;
+
+typedef struct rt_pool_placeholder {
+
+    struct rt_pool_control *ctl;
+
+} RT_POOL;
+
+static inline void rt_pool_init_work(RT_POOL_WORK *work,
+				     void (*handler)(void *cookie),
+				     void *cookie)
+{
+    work->handler = handler;
+    work->cookie = cookie;
+}
+
+#if !defined(__KERNEL__) && !defined(__XENO_SIM__)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int rt_pool_create(RT_POOL *pool,
+		   const char *name,
+		   int prio,
+		   unsigned long cpumask,
+		   int depth);
+
+int rt_pool_delete(RT_POOL *pool);
+
+int rt_pool_submit(RT_POOL *pool,
+		   RT_POOL_WORK *work);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !(__KERNEL__ || __XENO_SIM__) */
+
+#endif /* !_XENO_POOL_H */
@@ -33,6 +33,7 @@ typedef struct xeno_resource_holder {
 #define ppd2rholder(a)	container_of(a, struct xeno_resource_holder, ppd)
 
 	xnqueue_t alarmq;
+	xnqueue_t alarm_groupq;
 	xnqueue_t condq;
 	xnqueue_t eventq;
 	xnqueue_t heapq;
@@ -43,6 +44,8 @@ typedef struct xeno_resource_holder {
 	xnqueue_t semq;
 	xnqueue_t ioregionq;
 	xnqueue_t bufferq;
+	xnqueue_t ringq;
+	xnqueue_t cyclicq;
 
 } xeno_rholder_t;
 
@@ -62,10 +65,10 @@ static inline xeno_rholder_t *xeno_get_rholder(void)
 	return ppd2rholder(ppd);
 }
 
-#define __xeno_release_obj(obj)			\
+#define __xeno_release_obj(obj, pool)		\
 	do {					\
 		if ((obj)->cpid)		\
-			xnfree(obj);		\
+			xnobjpool_free(pool, obj); \
 	} while(0)
 
 #else /* !CONFIG_XENO_OPT_PERVASIVE */
@@ -75,7 +78,7 @@ static inline xeno_rholder_t *xeno_get_rholder(void)
 	return &__native_global_rholder;
 }
 
-#define __xeno_release_obj(obj)		do { } while(0)
+#define __xeno_release_obj(obj, pool)	do { } while(0)
 
 #endif /* !CONFIG_XENO_OPT_PERVASIVE */
 
@@ -87,7 +90,7 @@ static inline xeno_rholder_t *xeno_get_rholder(void)
 #define __xeno_trace_release(__name, __obj, __err)
 #endif /* !XENO_DEBUG(NATIVE) */
 
-#define __xeno_flush_rq(__type, __rq, __name, __release)		\
+#define __xeno_flush_rq(__type, __rq, __name, __release, __pool)	\
 	do {								\
 		int rt_##__name##_delete(__type *);			\
 		xnholder_t *holder, *nholder;				\
@@ -111,7 +114,7 @@ static inline xeno_rholder_t *xeno_get_rholder(void)
 				}					\
 			} else {					\
 				if (__release)				\
-					__xeno_release_obj(obj);	\
+					__xeno_release_obj(obj, __pool); \
 				xnlock_get_irqsave(&nklock, s);		\
 			}						\
 		}							\
@@ -119,9 +122,13 @@ static inline xeno_rholder_t *xeno_get_rholder(void)
 	} while(0)
 
 #define xeno_flush_rq(__type, __rq, __name)  \
-	__xeno_flush_rq(__type, __rq, __name, 1)
+	__xeno_flush_rq(__type, __rq, __name, 1, NULL)
 
 #define xeno_flush_rq_norelease(__type, __rq, __name)  \
-	__xeno_flush_rq(__type, __rq, __name, 0)
+	__xeno_flush_rq(__type, __rq, __name, 0, NULL)
+
+/* Release the flushed objects to their descriptor pool. */
+#define xeno_flush_rq_pool(__type, __rq, __name, __pool)  \
+	__xeno_flush_rq(__type, __rq, __name, 1, __pool)
 
 #endif /* !_XENO_PPD_H */
@@ -31,6 +31,9 @@
 #define Q_FIFO   XNSYNCH_FIFO	/* Pend by FIFO order. */
 #define Q_DMA    0x100		/* Use memory suitable for DMA. */
 #define Q_SHARED 0x200		/* Use mappable shared memory. */
+#define Q_MAGAZINE 0x400	/* Use per-CPU buffer caches. */
+#define Q_HUGE   0x800		/* Use huge pages if available. */
+#define Q_TLSF   0x1000		/* Use the TLSF allocator. */
 
 #define Q_UNLIMITED 0		/* No size limit. */
 
@@ -57,6 +60,14 @@ typedef struct rt_queue_info {
 
 } RT_QUEUE_INFO;
 
+typedef struct rt_queue_msgv {
+
+    void *buf;			/* !< Message buffer address. */
+
+    size_t size;		/* !< Payload size of the message (in bytes). */
+
+} RT_QUEUE_MSGV;
+
 typedef struct rt_queue_placeholder {
 	xnhandle_t opaque;
 	void *opaque2;
@@ -67,6 +78,7 @@ typedef struct rt_queue_placeholder {
 
 #if defined(__KERNEL__) || defined(__XENO_SIM__)
 
+#include <nucleus/select.h>
 #include <native/ppd.h>
 
 #define XENO_QUEUE_MAGIC 0x55550707
@@ -79,6 +91,8 @@ typedef struct rt_queue {
 
     xnqueue_t pendq;	/* !< Pending message queue. */
 
+    DECLARE_XNSELECT(read_select); /* !< Selector bindings for input. */
+
     xnheap_t bufpool;	/* !< Message buffer pool. */
 
     int mode;		/* !< Creation mode. */
@@ -131,9 +145,17 @@ static inline void __native_queue_flush_rq(xnqueue_t *rq)
 ssize_t rt_queue_receive_inner(RT_QUEUE *q, void **bufp,
 			       xntmode_t timeout_mode, RTIME timeout);
 
+int rt_queue_receive_batch_inner(RT_QUEUE *q, RT_QUEUE_MSGV *msgv, int nmsg,
+				 xntmode_t timeout_mode, RTIME timeout);
+
 int rt_queue_delete_inner(RT_QUEUE *q,
 			  void __user *mapaddr);
 
+#ifdef CONFIG_XENO_OPT_SELECT
+int rt_queue_select_bind(RT_QUEUE *q, struct xnselector *selector,
+			 unsigned type, unsigned index);
+#endif /* CONFIG_XENO_OPT_SELECT */
+
 #else /* !CONFIG_XENO_OPT_NATIVE_QUEUE */
 
 #define __native_queue_pkg_init()		({ 0; })
@@ -186,6 +208,10 @@ void *rt_queue_alloc(RT_QUEUE *q,
 int rt_queue_free(RT_QUEUE *q,
 		  void *buf);
 
+int rt_queue_free_batch(RT_QUEUE *q,
+			RT_QUEUE_MSGV *msgv,
+			int nmsg);
+
 int rt_queue_send(RT_QUEUE *q,
 		  void *buf,
 		  size_t size,
@@ -204,6 +230,16 @@ ssize_t rt_queue_receive_until(RT_QUEUE *q,
 			       void **bufp,
 			       RTIME timeout);
 
+int rt_queue_receive_batch(RT_QUEUE *q,
+			   RT_QUEUE_MSGV *msgv,
+			   int nmsg,
+			   RTIME timeout);
+
+int rt_queue_receive_batch_until(RT_QUEUE *q,
+				 RT_QUEUE_MSGV *msgv,
+				 int nmsg,
+				 RTIME timeout);
+
 ssize_t rt_queue_read(RT_QUEUE *q,
 		      void *bufp,
 		      size_t size,
@@ -0,0 +1,388 @@
+/**
+ * @file
+ * This file is part of the Xenomai project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef _XENO_RING_H
+#define _XENO_RING_H
+
+#include <nucleus/synch.h>
+#include <nucleus/heap.h>
+#include <native/types.h>
+#include <asm/xenomai/atomic.h>
+
+/* Creation flags. */
+#define R_PRIO   XNSYNCH_PRIO	/* Pend by task priority order. */
+#define R_FIFO   XNSYNCH_FIFO	/* Pend by FIFO order. */
+#define R_SHARED 0x200		/* Use mappable shared memory. */
+
+typedef struct rt_ring_info {
+
+    int nreaders;		/* !< Number of tasks waiting for data. */
+
+    int nwriters;		/* !< Number of tasks waiting for space. */
+
+    int mode;			/* !< Creation mode. */
+
+    size_t nslots;		/* !< Number of slots. */
+
+    size_t slotsz;		/* !< Payload size of a slot (in bytes). */
+
+    size_t count;		/* !< Number of slots in use. */
+
+    char name[XNOBJECT_NAME_LEN]; /* !< Symbolic name. */
+
+} RT_RING_INFO;
+
+typedef struct rt_ring_placeholder {
+	xnhandle_t opaque;
+	void *opaque2;
+	caddr_t mapbase;
+	size_t mapsize;
+	unsigned long area;
+	unsigned long ctloff;	/* !< Offset of the control block. */
+	unsigned long nslots;
+	unsigned long slotsz;
+} RT_RING_PLACEHOLDER;
+
+/*
+ * Shared ring layout. Producers and consumers claim positions by
+ * moving the tail and head indices with compare-and-swap, each slot
+ * carrying a sequence number which tells whether it is free for the
+ * writer of a given position, or filled for its reader (bounded
+ * MPMC scheme). The waiter counts are only updated by the kernel
+ * under nklock; they tell the other side whether a wakeup call is
+ * needed after a lockless transfer.
+ *
+ * The geometry is not part of the shared memory, which user-space
+ * may write to: the kernel keeps its own copy, and user-space gets
+ * one in the ring placeholder. Positions are free-running counters
+ * masked into the slot array, hence a power-of-two slot count.
+ */
+struct rt_ring_ctl {
+	xnarch_atomic_t head;	/* !< Next position to read. */
+	xnarch_atomic_t tail;	/* !< Next position to write. */
+	xnarch_atomic_t rwaiters; /* !< Readers sleeping on empty ring. */
+	xnarch_atomic_t wwaiters; /* !< Writers sleeping on full ring. */
+};
+
+struct rt_ring_geom {
+	unsigned long mask;	/* !< Number of slots, minus one. */
+	unsigned long slotsz;	/* !< Payload size of a slot. */
+	unsigned long stride;	/* !< Slot size, header included. */
+};
+
+struct rt_ring_slot {
+	xnarch_atomic_t seq;
+	unsigned long size;
+};
+
+#define __rt_ring_stride(slotsz)					\
+	((sizeof(struct rt_ring_slot) + (slotsz) + sizeof(long) - 1)	\
+	 & ~(sizeof(long) - 1))
+
+#define __rt_ring_memsz(slotsz, nslots) \
+	(sizeof(struct rt_ring_ctl) + (nslots) * __rt_ring_stride(slotsz))
+
+#if defined(__KERNEL__) || defined(__XENO_SIM__) || defined(CONFIG_XENO_FASTSYNCH)
+
+static inline void __rt_ring_set_geom(struct rt_ring_geom *geom,
+				      size_t slotsz, size_t nslots)
+{
+	geom->mask = nslots - 1;
+	geom->slotsz = slotsz;
+	geom->stride = __rt_ring_stride(slotsz);
+}
+
+static inline struct rt_ring_slot *
+__rt_ring_slot(struct rt_ring_ctl *ctl, const struct rt_ring_geom *geom,
+	       unsigned long pos)
+{
+	return (struct rt_ring_slot *)
+		((char *)(ctl + 1) + (pos & geom->mask) * geom->stride);
+}
+
+static inline void *__rt_ring_data(struct rt_ring_slot *slot)
+{
+	return slot + 1;
+}
+
+static inline void __rt_ring_init(struct rt_ring_ctl *ctl,
+				  const struct rt_ring_geom *geom)
+{
+	unsigned long pos;
+
+	xnarch_atomic_set(&ctl->head, 0);
+	xnarch_atomic_set(&ctl->tail, 0);
+	xnarch_atomic_set(&ctl->rwaiters, 0);
+	xnarch_atomic_set(&ctl->wwaiters, 0);
+
+	for (pos = 0; pos <= geom->mask; pos++)
+		xnarch_atomic_set(&__rt_ring_slot(ctl, geom, pos)->seq, pos);
+}
+
+/*
+ * Bound on the compare-and-swap retries of the reservation helpers,
+ * so that the kernel never spins under nklock on indices user-space
+ * keeps on changing.
+ */
+#define __RT_RING_MAX_RETRIES  64
+
+/*
+ * Claim the next free slot for writing. Returns zero on success,
+ * -EWOULDBLOCK if the ring is full, or -EIO if the shared indices
+ * are inconsistent with the ring size, or kept on moving. The slot
+ * must be published by __rt_ring_commit_put() once filled.
+ */
+static inline int
+__rt_ring_reserve_put(struct rt_ring_ctl *ctl, const struct rt_ring_geom *geom,
+		      struct rt_ring_slot **slotp, unsigned long *posp)
+{
+	struct rt_ring_slot *slot;
+	unsigned long pos, seq;
+	int retries;
+	long dif;
+
+	for (retries = 0; retries < __RT_RING_MAX_RETRIES; retries++) {
+		pos = xnarch_atomic_get(&ctl->tail);
+		if (pos - (unsigned long)xnarch_atomic_get(&ctl->head)
+		    > geom->mask + 1)
+			return -EIO;
+		slot = __rt_ring_slot(ctl, geom, pos);
+		seq = xnarch_atomic_get(&slot->seq);
+		xnarch_read_memory_barrier();
+		dif = (long)(seq - pos);
+		if (dif == 0) {
+			if ((unsigned long)xnarch_atomic_cmpxchg(&ctl->tail, pos,
+								 pos + 1) == pos) {
+				*slotp = slot;
+				*posp = pos;
+				return 0;
+			}
+		} else if (dif < 0)
+			return -EWOULDBLOCK;
+	}
+
+	return -EIO;
+}
+
+static inline void __rt_ring_commit_put(struct rt_ring_ctl *ctl,
+					struct rt_ring_slot *slot,
+					unsigned long pos, size_t size)
+{
+	slot->size = size;
+	xnarch_write_memory_barrier();
+	xnarch_atomic_set(&slot->seq, pos + 1);
+	/* Order the publication before the waiter check. */
+	xnarch_memory_barrier();
+}
+
+/*
+ * Claim the next filled slot for reading. Returns zero on success,
+ * -EWOULDBLOCK if the ring is empty, or -EIO as
+ * __rt_ring_reserve_put() does. The slot must be released by
+ * __rt_ring_commit_get() once consumed.
+ */
+static inline int
+__rt_ring_reserve_get(struct rt_ring_ctl *ctl, const struct rt_ring_geom *geom,
+		      struct rt_ring_slot **slotp, unsigned long *posp)
+{
+	struct rt_ring_slot *slot;
+	unsigned long pos, seq;
+	int retries;
+	long dif;
+
+	for (retries = 0; retries < __RT_RING_MAX_RETRIES; retries++) {
+		pos = xnarch_atomic_get(&ctl->head);
+		if ((unsigned long)xnarch_atomic_get(&ctl->tail) - pos
+		    > geom->mask + 1)
+			return -EIO;
+		slot = __rt_ring_slot(ctl, geom, pos);
+		seq = xnarch_atomic_get(&slot->seq);
+		xnarch_read_memory_barrier();
+		dif = (long)(seq - (pos + 1));
+		if (dif == 0) {
+			if ((unsigned long)xnarch_atomic_cmpxchg(&ctl->head, pos,
+								 pos + 1) == pos) {
+				*slotp = slot;
+				*posp = pos;
+				return 0;
+			}
+		} else if (dif < 0)
+			return -EWOULDBLOCK;
+	}
+
+	return -EIO;
+}
+
+static inline void __rt_ring_commit_get(const struct rt_ring_geom *geom,
+					struct rt_ring_slot *slot,
+					unsigned long pos)
+{
+	xnarch_memory_barrier();
+	xnarch_atomic_set(&slot->seq, pos + geom->mask + 1);
+	/* Order the release before the waiter check. */
+	xnarch_memory_barrier();
+}
+
+#endif /* __KERNEL__ || __XENO_SIM__ || CONFIG_XENO_FASTSYNCH */
+
+/* Wakeup targets for the signaling call. */
+#define R_WAKE_READERS  0
+#define R_WAKE_WRITERS  1
+
+#if defined(__KERNEL__) || defined(__XENO_SIM__)
+
+#include <nucleus/bufd.h>
+#include <native/ppd.h>
+
+#define XENO_RING_MAGIC 0x5555070a
+
+typedef struct rt_ring {
+
+    unsigned magic;   /* !< Magic code - must be first */
+
+    xnsynch_t rsynch_base; /* !< Readers waiting for data. */
+
+    xnsynch_t wsynch_base; /* !< Writers waiting for space. */
+
+    xnheap_t bufpool;	/* !< Ring memory. */
+
+    struct rt_ring_ctl *ctl; /* !< Shared control block and slots. */
+
+    struct rt_ring_geom geom; /* !< Private copy of the geometry. */
+
+    int copiers;	/* !< Tasks copying a slot with nklock released. */
+
+    int mode;		/* !< Creation mode. */
+
+    xnhandle_t handle;	/* !< Handle in registry -- zero if unregistered. */
+
+    char name[XNOBJECT_NAME_LEN]; /* !< Symbolic name. */
+
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+    pid_t cpid;			/* !< Creator's pid. */
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+
+    xnholder_t rlink;		/* !< Link in resource queue. */
+
+#define rlink2ring(ln)	container_of(ln, RT_RING, rlink)
+
+    xnqueue_t *rqueue;		/* !< Backpointer to resource queue. */
+
+} RT_RING;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef CONFIG_XENO_OPT_NATIVE_RING
+
+int __native_ring_pkg_init(void);
+
+void __native_ring_pkg_cleanup(void);
+
+static inline void __native_ring_flush_rq(xnqueue_t *rq)
+{
+	xeno_flush_rq_norelease(RT_RING, rq, ring);
+}
+
+ssize_t rt_ring_write_inner(RT_RING *ring, struct xnbufd *bufd,
+			    xntmode_t timeout_mode, RTIME timeout);
+
+ssize_t rt_ring_read_inner(RT_RING *ring, struct xnbufd *bufd,
+			   xntmode_t timeout_mode, RTIME timeout);
+
+int rt_ring_wakeup_inner(RT_RING *ring, int which);
+
+int rt_ring_delete_inner(RT_RING *ring,
+			 void __user *mapaddr);
+
+#else /* !CONFIG_XENO_OPT_NATIVE_RING */
+
+#define __native_ring_pkg_init()		({ 0; })
+#define __native_ring_pkg_cleanup()		do { } while(0)
+#define __native_ring_flush_rq(rq)		do { } while(0)
+
+#endif /* !CONFIG_XENO_OPT_NATIVE_RING */
+
+#ifdef __cplusplus
+}
+#endif
+
+#else /* !(__KERNEL__ || __XENO_SIM__) */
+
+typedef RT_RING_PLACEHOLDER RT_RING;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int rt_ring_bind(RT_RING *ring,
+		 const char *name,
+		 RTIME timeout);
+
+int rt_ring_unbind(RT_RING *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __KERNEL__ || __XENO_SIM__ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Public interface. */
+
+int rt_ring_create(RT_RING *ring,
+		   const char *name,
+		   size_t slotsz,
+		   size_t nslots,
+		   int mode);
+
+int rt_ring_delete(RT_RING *ring);
+
+ssize_t rt_ring_write(RT_RING *ring,
+		      const void *buf,
+		      size_t size,
+		      RTIME timeout);
+
+ssize_t rt_ring_write_until(RT_RING *ring,
+			    const void *buf,
+			    size_t size,
+			    RTIME timeout);
+
+ssize_t rt_ring_read(RT_RING *ring,
+		     void *buf,
+		     size_t size,
+		     RTIME timeout);
+
+ssize_t rt_ring_read_until(RT_RING *ring,
+			   void *buf,
+			   size_t size,
+			   RTIME timeout);
+
+int rt_ring_inquire(RT_RING *ring,
+		    RT_RING_INFO *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !_XENO_RING_H */
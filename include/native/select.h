@@ -0,0 +1,133 @@
+/**
+ * @file
+ * This file is part of the Xenomai project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef _XENO_SELECT_H
+#define _XENO_SELECT_H
+
+#include <native/types.h>
+
+/* Item types */
+#define RT_SELECT_FD     0	/* RTDM file descriptor */
+#define RT_SELECT_QUEUE  1	/* Message queue */
+#define RT_SELECT_EVENT  2	/* Event flag group */
+#define RT_SELECT_SEM    3	/* Counting semaphore */
+#define RT_SELECT_BUFFER 4	/* Buffer */
+#define RT_SELECT_PIPE   5	/* Message pipe */
+
+/* Events */
+#define RT_SELECT_IN   0x1	/* Input ready */
+#define RT_SELECT_OUT  0x2	/* Output ready (buffers and RTDM only) */
+
+/* Maximum number of items per rt_select() call */
+#define RT_SELECT_MAX  64
+
+typedef struct rt_select_item {
+
+    int type;			/* !< Item type (RT_SELECT_*). */
+
+    xnhandle_t handle;		/* !< Object handle, or RTDM descriptor. */
+
+    unsigned events;		/* !< Events to wait for. */
+
+    unsigned revents;		/* !< Events which occurred. */
+
+} RT_SELECT_ITEM;
+
+/*
+ * Fill an item from an object descriptor, e.g.
+ * rt_select_set(&items[0], RT_SELECT_QUEUE, &q, RT_SELECT_IN).
+ */
+#define rt_select_set(item, _type, obj, _events)	\
+    do {						\
+	(item)->type = (_type);				\
+	(item)->handle = (obj)->opaque;			\
+	(item)->events = (_events);			\
+	(item)->revents = 0;				\
+    } while (0)
+
+#define rt_select_set_fd(item, fd, _events)		\
+    do {						\
+	(item)->type = RT_SELECT_FD;			\
+	(item)->handle = (fd);				\
+	(item)->events = (_events);			\
+	(item)->revents = 0;				\
+    } while (0)
+
+#if defined(__KERNEL__) || defined(__XENO_SIM__)
+
+#include <nucleus/select.h>
+
+struct rt_task;
+
+/* Per-task selector, and the items bound to it. */
+struct rt_select_cache {
+
+    struct xnselector *selector;
+
+    int nbound;
+
+    RT_SELECT_ITEM bound[RT_SELECT_MAX];
+
+    RT_SELECT_ITEM items[RT_SELECT_MAX];
+
+    fd_set in_fds[2];
+
+    fd_set out_fds[2];
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef CONFIG_XENO_OPT_NATIVE_SELECT
+
+int rt_select_inner(struct rt_task *task,
+		    RT_SELECT_ITEM __user *u_items,
+		    int nitems,
+		    RTIME timeout);
+
+void __native_select_cleanup(struct rt_task *task);
+
+#else /* !CONFIG_XENO_OPT_NATIVE_SELECT */
+
+#define __native_select_cleanup(task)	do { } while(0)
+
+#endif /* !CONFIG_XENO_OPT_NATIVE_SELECT */
+
+#ifdef __cplusplus
+}
+#endif
+
+#else /* !(__KERNEL__ || __XENO_SIM__) */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int rt_select(RT_SELECT_ITEM *items,
+	      int nitems,
+	      RTIME timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __KERNEL__ || __XENO_SIM__ */
+
+#endif /* !_XENO_SELECT_H */
@@ -41,25 +41,40 @@ typedef struct rt_sem_info {
 } RT_SEM_INFO;
 
 typedef struct rt_sem_placeholder {
+
     xnhandle_t opaque;
+
+#ifdef CONFIG_XENO_FASTSYNCH
+    xnarch_atomic_t *fastcnt;
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 } RT_SEM_PLACEHOLDER;
 
 #if (defined(__KERNEL__) || defined(__XENO_SIM__)) && !defined(DOXYGEN_CPP)
 
+#include <nucleus/select.h>
 #include <native/ppd.h>
 
 #define XENO_SEM_MAGIC 0x55550303
 
+#define RT_SEM_EXPORTED	XNSYNCH_SPARE0	/* Semaphore registered by name */
+
 typedef struct rt_sem {
 
     unsigned magic;   /* !< Magic code - must be first */
 
     xnsynch_t synch_base; /* !< Base synchronization object. */
 
-    unsigned long count; /* !< Current semaphore value. */
+    xnarch_atomic_t *fastcnt; /* !< Semaphore value and waiter flag. */
+
+#ifndef CONFIG_XENO_FASTSYNCH
+    xnarch_atomic_t count; /* !< Storage for the value. */
+#endif /* !CONFIG_XENO_FASTSYNCH */
 
     int mode;		/* !< Creation mode. */
 
+    DECLARE_XNSELECT(read_select); /* !< Selector bindings, ready on units. */
+
     xnhandle_t handle;	/* !< Handle in registry -- zero if unregistered. */
 
     char name[XNOBJECT_NAME_LEN]; /* !< Symbolic name. */
@@ -86,14 +101,26 @@ int __native_sem_pkg_init(void);
 
 void __native_sem_pkg_cleanup(void);
 
+extern xnobjpool_t __native_sem_pool;
+
 static inline void __native_sem_flush_rq(xnqueue_t *rq)
 {
-	xeno_flush_rq(RT_SEM, rq, sem);
+	xeno_flush_rq_pool(RT_SEM, rq, sem, &__native_sem_pool);
 }
 
+int rt_sem_create_inner(RT_SEM *sem, const char *name,
+			unsigned long icount, int mode, int global);
+
 int rt_sem_p_inner(RT_SEM *sem,
 		   xntmode_t timeout_mode, RTIME timeout);
 
+#ifdef CONFIG_XENO_OPT_SELECT
+int rt_sem_select_bind(RT_SEM *sem, struct xnselector *selector,
+		       unsigned type, unsigned index);
+
+void __native_sem_select_update(RT_SEM *sem);
+#endif /* CONFIG_XENO_OPT_SELECT */
+
 #else /* !CONFIG_XENO_OPT_NATIVE_SEM */
 
 #define __native_sem_pkg_init()		({ 0; })
@@ -122,6 +149,9 @@ static inline int rt_sem_unbind (RT_SEM *sem)
 
 {
     sem->opaque = XN_NO_HANDLE;
+#ifdef CONFIG_XENO_FASTSYNCH
+    sem->fastcnt = NULL;
+#endif /* CONFIG_XENO_FASTSYNCH */
     return 0;
 }
 
@@ -128,6 +128,34 @@
 #define __native_buffer_inquire     102
 #define __native_queue_flush        103
 #define __native_cond_wait_epilogue 104
+#define __native_ring_create        105
+#define __native_ring_bind          106
+#define __native_ring_delete        107
+#define __native_ring_write         108
+#define __native_ring_read          109
+#define __native_ring_wakeup        110
+#define __native_ring_inquire       111
+#define __native_queue_receive_batch 112
+#define __native_queue_free_batch   113
+#define __native_task_set_edf       114
+#define __native_heap_inquire_ext   115
+#define __native_task_start_batch   116
+#define __native_event_wait_count   117
+#define __native_mutex_create_ceiling 118
+#define __native_cyclic_create      119
+#define __native_cyclic_delete      120
+#define __native_cyclic_attach      121
+#define __native_cyclic_start       122
+#define __native_cyclic_stop        123
+#define __native_cyclic_wait        124
+#define __native_cyclic_inquire     125
+#define __native_pipe_batch         126
+#define __native_heap_xfer          127
+#define __native_alarm_group_create 128
+#define __native_alarm_group_delete 129
+#define __native_alarm_attach       130
+#define __native_alarm_group_wait   131
+#define __native_select             132
 
 struct rt_arg_bulk {
 
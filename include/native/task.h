@@ -49,6 +49,9 @@
 #define T_NOSIG    XNASDI     /**< See #XNASDI    */ 
 #define T_WARNSW   XNTRAPSW   /**< See #XNTRAPSW  */ 
 #define T_RPIOFF   XNRPIOFF   /**< See #XNRPIOFF  */ 
+#define T_BALANCE  XNBALANCE  /**< See #XNBALANCE (mode bit, not a creation flag) */
+#define T_FPUEAGER XNFPUEAGER /**< See #XNFPUEAGER (mode bit, not a creation flag) */
+#define T_PREREL   XNPREREL   /**< See #XNPREREL (mode bit, not a creation flag) */
 
 /* Pseudo-status bits (no conflict with other T_* bits) */
 #define T_CONFORMING  0x00000200
@@ -99,7 +102,7 @@ typedef struct rt_task_info {
 
 } RT_TASK_INFO;
 
-#define RT_MCB_FSTORE_LIMIT  64
+#define RT_MCB_FSTORE_LIMIT  256
 
 /** Structure used in passing messages between tasks.
   @see rt_task_send(), rt_task_reply(), rt_task_receive()
@@ -151,6 +154,7 @@ typedef struct rt_task {
 	struct {
 	    int mode;
 	    unsigned long mask;
+	    unsigned long *counts;
 	} event;
 
 #ifdef CONFIG_XENO_OPT_NATIVE_MPS
@@ -162,11 +166,22 @@ typedef struct rt_task {
 
     } wait_args;
 
+    xnpholder_t evlink;		/* !< Link in an event group index. */
+
+    xnpqueue_t *evq;		/* !< Index queue evlink is on, or NULL. */
+
+#ifdef CONFIG_XENO_OPT_NATIVE_SELECT
+    struct rt_select_cache *selcache; /* !< rt_select() state, or NULL. */
+#endif /* CONFIG_XENO_OPT_NATIVE_SELECT */
+
 #ifdef CONFIG_XENO_OPT_NATIVE_MPS
     xnsynch_t mrecv,
 	      msendq;
 
     int flowgen;		/* !< Flow id. generator. */
+
+    /* !< Staging area for user-space transactions. */
+    char mbox[RT_MCB_FSTORE_LIMIT] ____cacheline_aligned;
 #endif /* CONFIG_XENO_OPT_NATIVE_MPS */
 
 } RT_TASK;
@@ -243,6 +258,30 @@ int rt_task_join(RT_TASK *task);
 
 #endif /* __KERNEL__ || __XENO_SIM__ */
 
+/** Structure describing a task created or started as part of a batch.
+ *
+ *  @see rt_task_create_batch(), rt_task_start_batch()
+ */
+typedef struct rt_task_spec {
+
+    RT_TASK *task; /**< Descriptor of the task. */
+
+    const char *name; /**< Symbolic name of the task. */
+
+    int stksize; /**< Stack size (bytes). */
+
+    int prio; /**< Base priority. */
+
+    int mode; /**< Creation mode. */
+
+    void (*entry)(void *cookie); /**< Entry point of the task. */
+
+    void *cookie; /**< Argument passed to the entry point. */
+
+    int err; /**< Creation status of the task. */
+
+} RT_TASK_SPEC;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -259,6 +298,13 @@ int rt_task_start(RT_TASK *task,
 		  void (*fun)(void *cookie),
 		  void *cookie);
 
+int rt_task_create_batch(RT_TASK_SPEC *specv,
+			 int count);
+
+int rt_task_start_batch(RT_TASK_SPEC *specv,
+			int count,
+			RTIME date);
+
 int rt_task_suspend(RT_TASK *task);
 
 int rt_task_resume(RT_TASK *task);
@@ -297,6 +343,10 @@ RT_TASK *rt_task_self(void);
 int rt_task_slice(RT_TASK *task,
 		  RTIME quantum);
 
+int rt_task_set_edf(RT_TASK *task,
+		    RTIME runtime,
+		    RTIME period);
+
 ssize_t rt_task_send(RT_TASK *task,
 		     RT_TASK_MCB *mcb_s,
 		     RT_TASK_MCB *mcb_r,
@@ -71,6 +71,12 @@ struct rt_alarm;
 typedef void (*rt_alarm_t)(struct rt_alarm *alarm,
 			   void *cookie);
 
+struct rt_cyclic;
+
+typedef void (*rt_cyclic_t)(struct rt_cyclic *cyclic,
+			    int slot,
+			    void *cookie);
+
 typedef xnisr_t rt_isr_t;
 
 typedef xniack_t rt_iack_t;
@@ -42,6 +42,9 @@
 				    __FILE__, __LINE__, (#cond));	\
 	} while(0)
 
+/* Break the build if @cond is true. */
+#define XENO_BUILD_BUG_ON(cond)	((void)sizeof(char[1 - 2 * !!(cond)]))
+
 #ifndef CONFIG_XENO_OPT_DEBUG_QUEUES
 #define CONFIG_XENO_OPT_DEBUG_QUEUES 0
 #endif /* CONFIG_XENO_OPT_DEBUG_QUEUES */
@@ -0,0 +1,70 @@
+/*!\file budget.h
+ * \brief Per-thread CPU budget enforcement.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _XENO_NUCLEUS_BUDGET_H
+#define _XENO_NUCLEUS_BUDGET_H
+
+/* Actions upon budget overrun. */
+#define XNBUDGET_NOTIFY		0	/* Only count the overrun */
+#define XNBUDGET_DEMOTE		1	/* Lower the priority until replenished */
+#define XNBUDGET_SUSPEND	2	/* Hold the thread until replenished */
+
+#if defined(__KERNEL__) && defined(CONFIG_XENO_OPT_SCHED_BUDGET)
+
+#include <nucleus/sched.h>
+
+void __xnbudget_switch(struct xnsched *sched,
+		       struct xnthread *prev, struct xnthread *next);
+
+/*
+ * Called from the rescheduling procedure, nklock held. Like the
+ * round-robin budget, the CPU time of threads with a budget is
+ * timed by a per-CPU one-shot timer armed at switch-in, and charged
+ * at switch-out.
+ */
+static inline void xnbudget_switch(struct xnsched *sched,
+				   struct xnthread *prev,
+				   struct xnthread *next)
+{
+	if (unlikely(xntimer_running_p(&sched->bgtimer) || next->budget.quota))
+		__xnbudget_switch(sched, prev, next);
+}
+
+void xnbudget_init_thread(struct xnthread *thread);
+
+void xnbudget_destroy_thread(struct xnthread *thread);
+
+void xnbudget_init_sched(struct xnsched *sched);
+
+void xnbudget_destroy_sched(struct xnsched *sched);
+
+int xnbudget_set(struct xnthread *thread, xnticks_t quota,
+		 xnticks_t period, int action, int demote_prio);
+
+int xnbudget_mount(void);
+
+void xnbudget_umount(void);
+
+#else /* !(__KERNEL__ && CONFIG_XENO_OPT_SCHED_BUDGET) */
+
+#define xnbudget_switch(sched, prev, next)	do { } while (0)
+
+#endif /* !(__KERNEL__ && CONFIG_XENO_OPT_SCHED_BUDGET) */
+
+#endif /* !_XENO_NUCLEUS_BUDGET_H */
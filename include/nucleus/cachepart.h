@@ -0,0 +1,64 @@
+/*!\file cachepart.h
+ * \brief Cache partitioning for real-time CPUs and threads.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _XENO_NUCLEUS_CACHEPART_H
+#define _XENO_NUCLEUS_CACHEPART_H
+
+#if defined(__KERNEL__) && defined(CONFIG_XENO_OPT_CACHE_PARTITION)
+
+#include <nucleus/sched.h>
+
+void __xncachepart_switch(struct xnsched *sched, int clos);
+
+/*
+ * Called from the rescheduling procedure, nklock held. The root
+ * thread runs with the class Linux set, real-time threads with
+ * their own class if any, or the default class of their CPU. -1
+ * stands for the class Linux set, so that nothing is ever written
+ * to the hardware unless some class was configured.
+ */
+static inline void xncachepart_switch(struct xnsched *sched,
+				      struct xnthread *next)
+{
+	int clos = -1;
+
+	if (!xnthread_test_state(next, XNROOT))
+		clos = next->cacheclass >= 0 ? next->cacheclass : sched->cpdefault;
+
+	if (clos != sched->cpcurrent)
+		__xncachepart_switch(sched, clos);
+}
+
+int xncachepart_set_mask(int clos, unsigned long mask);
+
+int xncachepart_set_cpu(int cpu, int clos);
+
+int xncachepart_set_thread(struct xnthread *thread, int clos);
+
+void xncachepart_mount(void);
+
+void xncachepart_umount(void);
+
+#else /* !(__KERNEL__ && CONFIG_XENO_OPT_CACHE_PARTITION) */
+
+#define xncachepart_switch(sched, next)	do { } while (0)
+
+#endif /* !(__KERNEL__ && CONFIG_XENO_OPT_CACHE_PARTITION) */
+
+#endif /* !_XENO_NUCLEUS_CACHEPART_H */
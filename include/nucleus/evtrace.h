@@ -0,0 +1,119 @@
+/*!\file evtrace.h
+ * \brief Binary event tracer for the nucleus.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _XENO_NUCLEUS_EVTRACE_H
+#define _XENO_NUCLEUS_EVTRACE_H
+
+/* Event identifiers. */
+#define XNEVT_SWITCH	1	/* thread: incoming, arg: outgoing handle */
+#define XNEVT_TIMER	2	/* thread: none, arg: timer cookie */
+#define XNEVT_IRQ	3	/* thread: none, arg: IRQ number */
+#define XNEVT_SLEEP	4	/* thread: sleeper, arg: synch cookie */
+#define XNEVT_RELAX	5	/* thread: relaxing, arg: SIGDEBUG reason */
+
+#define XNEVTRACE_MAGIC	0x45565452	/* "EVTR" */
+
+/*
+ * Events bearing on a kernel object carry a cookie, i.e. a keyed
+ * hash of its address which stays the same until the next boot, but
+ * never the address itself.
+ *
+ * The trace area lives in a mapped heap which user-space may map via
+ * the sys_heap_info syscall (XNHEAP_SYS_EVTRACE) and /dev/rtheap.
+ * The offset of the area descriptor within that heap is reported by
+ * /proc/xenomai/evtrace. Rings immediately follow the descriptor, one
+ * per CPU, each made of a head index followed by nr_recs records.
+ *
+ * The head index is only advanced by the owner CPU, once the record
+ * is complete. A reader may copy record #i, then re-read the head:
+ * if (head - i) >= nr_recs, the record may have been overwritten
+ * while being copied and must be discarded.
+ */
+struct xnevtrace_rec {
+	unsigned long long tsc;
+	unsigned int event;
+	unsigned int thread;	/* Thread handle, zero if none. */
+	unsigned long long arg;
+};
+
+struct xnevtrace_ring {
+	volatile unsigned int head;	/* Index of the next record. */
+	unsigned int pad;
+	struct xnevtrace_rec recs[0];
+};
+
+struct xnevtrace_area {
+	unsigned int magic;
+	unsigned int nr_cpus;
+	unsigned int nr_recs;		/* Records per ring, power of 2. */
+	unsigned int ring_size;		/* Bytes between rings. */
+	unsigned long long tsc_freq;
+	struct xnevtrace_ring rings[0];
+};
+
+#define xnevtrace_ring(area, cpu)					\
+	((struct xnevtrace_ring *)((char *)(area)->rings +		\
+				   (cpu) * (area)->ring_size))
+
+#ifdef __KERNEL__
+
+#include <nucleus/types.h>
+
+#ifdef CONFIG_XENO_OPT_EVTRACE
+
+struct xnthread;
+
+extern int xnevtrace_enabled;
+
+void __xnevtrace_log(unsigned int event, struct xnthread *thread,
+		     unsigned long long arg);
+
+static inline void xnevtrace_log(unsigned int event, struct xnthread *thread,
+				 unsigned long long arg)
+{
+	if (unlikely(xnevtrace_enabled))
+		__xnevtrace_log(event, thread, arg);
+}
+
+void __xnevtrace_log_obj(unsigned int event, struct xnthread *thread,
+			 const void *obj);
+
+static inline void xnevtrace_log_obj(unsigned int event,
+				     struct xnthread *thread, const void *obj)
+{
+	if (unlikely(xnevtrace_enabled))
+		__xnevtrace_log_obj(event, thread, obj);
+}
+
+struct xnheap *xnevtrace_heap(void);
+
+int xnevtrace_mount(void);
+
+void xnevtrace_umount(void);
+
+#else /* !CONFIG_XENO_OPT_EVTRACE */
+
+#define xnevtrace_log(event, thread, arg)	do { } while (0)
+#define xnevtrace_log_obj(event, thread, obj)	do { } while (0)
+
+#endif /* !CONFIG_XENO_OPT_EVTRACE */
+
+#endif /* __KERNEL__ */
+
+#endif /* !_XENO_NUCLEUS_EVTRACE_H */
@@ -62,6 +62,23 @@
 #define XNHEAP_PLIST   2
 
 #define XNHEAP_GFP_NONCACHED (1 << __GFP_BITS_SHIFT)
+/* Pass XNHEAP_MAGAZINE down from xnheap_init_mapped(). */
+#define XNHEAP_GFP_MAGAZINE  (1 << (__GFP_BITS_SHIFT + 1))
+/* Back a mapped heap with physically contiguous huge pages if possible. */
+#define XNHEAP_GFP_HUGE      (1 << (__GFP_BITS_SHIFT + 2))
+/* Pass XNHEAP_TLSF down from xnheap_init_mapped(). */
+#define XNHEAP_GFP_TLSF      (1 << (__GFP_BITS_SHIFT + 3))
+
+#ifdef HPAGE_SHIFT
+#define XNHEAP_HUGE_PAGE_SHIFT  HPAGE_SHIFT
+#else
+#define XNHEAP_HUGE_PAGE_SHIFT  21 /* i.e. 2Mb */
+#endif
+#define XNHEAP_HUGE_PAGE_SIZE   (1UL << XNHEAP_HUGE_PAGE_SHIFT)
+
+/* Creation flags for xnheap_init(). */
+#define XNHEAP_MAGAZINE  0x1	/* Enable per-CPU block magazines. */
+#define XNHEAP_TLSF      0x2	/* Use the TLSF allocator. */
 
 struct xnpagemap {
 	unsigned int type : 8;	  /* PFREE, PCONT, PLIST or log2 */
@@ -82,6 +99,62 @@ typedef struct xnextent {
 
 } xnextent_t;
 
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+
+/*
+ * Refill/drain batch size for magazines, i.e. half of the depth so
+ * that a CPU which alternates allocations and releases does not
+ * bounce on the heap lock.
+ */
+#define XNHEAP_MAGAZINE_BATCH  (CONFIG_XENO_OPT_HEAP_MAGAZINE_DEPTH / 2)
+
+struct xnheap_magazine {
+	int count;
+	caddr_t slots[CONFIG_XENO_OPT_HEAP_MAGAZINE_DEPTH];
+	unsigned long hits;
+	unsigned long misses;
+};
+
+#endif /* CONFIG_XENO_OPT_HEAP_MAGAZINES */
+
+#ifdef CONFIG_XENO_OPT_HEAP_TLSF
+
+/*
+ * Two-level segregated fit: free blocks are indexed by the log2 of
+ * their size (first level), then by XNHEAP_TLSF_SLCOUNT linear
+ * subdivisions of that power of two (second level). Sizes below
+ * XNHEAP_TLSF_SMALL all map to the first row, in steps of
+ * XNHEAP_MINALIGNSZ.
+ */
+#define XNHEAP_TLSF_SLLOG2   4
+#define XNHEAP_TLSF_SLCOUNT  (1 << XNHEAP_TLSF_SLLOG2)
+#define XNHEAP_TLSF_FLSHIFT  (XNHEAP_TLSF_SLLOG2 + 4) /* log2(MINALIGNSZ) */
+#define XNHEAP_TLSF_SMALL    (1 << XNHEAP_TLSF_FLSHIFT)
+#define XNHEAP_TLSF_FLCOUNT  (31 - XNHEAP_TLSF_FLSHIFT + 1) /* < MAXEXTSZ */
+
+struct xnheap_tlsf_block;
+
+struct xnheap_tlsf {
+	unsigned int fl_bitmap;
+	unsigned int sl_bitmap[XNHEAP_TLSF_FLCOUNT];
+	struct xnheap_tlsf_block *
+		freelist[XNHEAP_TLSF_FLCOUNT][XNHEAP_TLSF_SLCOUNT];
+};
+
+/*
+ * The control block is laid at the start of the initial extent,
+ * creators should add this to the size they want available.
+ */
+#define XNHEAP_TLSF_OVERHEAD \
+	((sizeof(struct xnheap_tlsf) + XNHEAP_MINALIGNSZ - 1) & \
+	 ~(XNHEAP_MINALIGNSZ - 1))
+
+#else /* !CONFIG_XENO_OPT_HEAP_TLSF */
+
+#define XNHEAP_TLSF_OVERHEAD	0
+
+#endif /* !CONFIG_XENO_OPT_HEAP_TLSF */
+
 typedef struct xnheap {
 
 	xnholder_t link;
@@ -107,12 +180,39 @@ typedef struct xnheap {
 
 	xnholder_t *idleq[XNARCH_NR_CPUS];
 
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+	struct xnheap_magazine *magazines; /* [nrcpus][nmags] */
+	int nmags;	/* One per sub-page bucket */
+	int nrcpus;
+#endif
+
+#ifdef CONFIG_XENO_OPT_HEAP_TLSF
+	struct xnheap_tlsf *tlsf; /* In the initial extent, NULL if unused */
+#endif
+
+#ifdef CONFIG_XENO_OPT_SEM_HEAP_AUTOGROW
+	struct {
+		int maxext;	/* Extent limit, zero if growth is off */
+		int pending;	/* Growth request queued */
+		int kmflags;	/* Allocation flags for added extents */
+		xnholder_t link; /* Link in growth queue */
+	} grow;
+#endif
+
 	xnarch_heapcb_t archdep;
 
 	XNARCH_DECL_DISPLAY_CONTEXT();
 
 	xnholder_t stat_link;	/* Link in heapq */
 
+	/* Updated locklessly, may miss a few counts on SMP. */
+	struct {
+		unsigned long allocs;
+		unsigned long frees;
+		unsigned long failures;
+		xnticks_t maxalloc; /* TSC, with CONFIG_XENO_OPT_STATS */
+	} stats;
+
 	char label[XNOBJECT_NAME_LEN+16];
 
 } xnheap_t;
@@ -127,8 +227,19 @@ extern xnheap_t kstacks;
 #define xnheap_page_size(heap)		((heap)->pagesize)
 #define xnheap_page_count(heap)		((heap)->npages)
 #define xnheap_usable_mem(heap)		((heap)->maxcont * countq(&(heap)->extents))
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+#define xnheap_magazines_p(heap)	((heap)->magazines != NULL)
+#define xnheap_used_mem(heap)		((heap)->ubytes - xnheap_cached_mem(heap))
+#else
+#define xnheap_magazines_p(heap)	0
 #define xnheap_used_mem(heap)		((heap)->ubytes)
+#endif
 #define xnheap_max_contiguous(heap)	((heap)->maxcont)
+#ifdef CONFIG_XENO_OPT_HEAP_TLSF
+#define xnheap_tlsf_p(heap)		((heap)->tlsf != NULL)
+#else
+#define xnheap_tlsf_p(heap)		0
+#endif
 
 static inline size_t xnheap_align(size_t size, size_t al)
 {
@@ -182,6 +293,28 @@ static inline size_t xnheap_rounded_size(size_t hsize, size_t psize)
 	return xnheap_align(hsize, psize);
 }
 
+#ifdef __KERNEL__
+#include <linux/cache.h>
+
+/*
+ * Size to request from a semaphore heap for a synchronization word
+ * user-space updates atomically. Padded words get a cache line of
+ * their own: bucketed blocks are aligned on their size, and pages
+ * on the page size, so rounding the request up to a cache line is
+ * enough.
+ */
+static inline u_long xnheap_synch_size(u_long size, int padded)
+{
+#ifdef CONFIG_XENO_OPT_SEM_HEAP_PADDED
+	padded = 1;
+#endif
+	if (padded && size < L1_CACHE_BYTES)
+		size = L1_CACHE_BYTES;
+
+	return size;
+}
+#endif /* __KERNEL__ */
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -206,15 +339,47 @@ void xnheap_destroy_mapped(xnheap_t *heap,
 			   void (*release)(struct xnheap *heap),
 			   void __user *mapaddr);
 
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+
+struct xnvfile_regular_iterator;
+
+void xnheap_account_fault(unsigned long addr);
+
+void xnheap_show_faults(struct xnvfile_regular_iterator *it);
+
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+
 #define xnheap_base_memory(heap) \
 	((unsigned long)((heap)->archdep.heapbase))
 
+#ifdef CONFIG_XENO_OPT_SEM_HEAP_AUTOGROW
+
+int xnheap_set_autogrow(xnheap_t *heap, int maxext);
+
+/*
+ * Extents of a growing heap are mapped back to back in user-space,
+ * so that offsets run across them in the order they were added.
+ */
+unsigned long xnheap_mapped_offset(xnheap_t *heap, void *ptr);
+
+caddr_t xnheap_mapped_address(xnheap_t *heap, unsigned long off);
+
+#else /* !CONFIG_XENO_OPT_SEM_HEAP_AUTOGROW */
+
+#define xnheap_set_autogrow(heap, maxext)	({ 0; })
+
 #define xnheap_mapped_offset(heap,ptr) \
 	(((caddr_t)(ptr)) - (caddr_t)xnheap_base_memory(heap))
 
 #define xnheap_mapped_address(heap,off) \
 	((caddr_t)xnheap_base_memory(heap) + (off))
 
+#endif /* !CONFIG_XENO_OPT_SEM_HEAP_AUTOGROW */
+
+int xnheap_mapped_extent(xnheap_t *heap,
+			 int index,
+			 unsigned long *areap);
+
 #define xnheap_mapped_p(heap) \
 	(xnheap_base_memory(heap) != 0)
 
@@ -225,7 +390,8 @@ void xnheap_destroy_mapped(xnheap_t *heap,
 int xnheap_init(xnheap_t *heap,
 		void *heapaddr,
 		u_long heapsize,
-		u_long pagesize);
+		u_long pagesize,
+		int flags);
 
 void xnheap_set_label(xnheap_t *heap, const char *name, ...);
 
@@ -272,6 +438,62 @@ static inline void xnheap_finalize_free(xnheap_t *heap)
 int xnheap_check_block(xnheap_t *heap,
 		       void *block);
 
+void xnheap_get_xstats(xnheap_t *heap,
+		       struct xnheap_xstats *xs);
+
+/*
+ * Object pools keep a stock of fixed-size blocks from the system
+ * heap, prefilled at creation time, so that object control blocks
+ * can be obtained and released in O(1) without contending on the
+ * heap in steady state. Pooled blocks are regular system heap
+ * blocks, which xnfree() may release as well.
+ */
+typedef struct xnobjpool {
+
+	xnholder_t link;	/* Link in poolq */
+
+#define link2objpool(ln)	container_of(ln, xnobjpool_t, link)
+
+	caddr_t freelist;	/* Free blocks */
+	u_long objsize;
+	int nfree;		/* Number of blocks in free list */
+	int capacity;		/* Maximum number of free blocks held */
+	int nused;		/* Number of blocks handed out */
+	unsigned long hits;	/* Allocations served from the free list */
+	unsigned long misses;	/* Allocations from the system heap */
+
+	DECLARE_XNLOCK(lock);
+
+	char name[XNOBJECT_NAME_LEN];
+
+} xnobjpool_t;
+
+void xnobjpool_init(xnobjpool_t *pool,
+		    const char *name,
+		    u_long objsize,
+		    int capacity);
+
+void xnobjpool_destroy(xnobjpool_t *pool);
+
+void *xnobjpool_alloc(xnobjpool_t *pool);
+
+void xnobjpool_free(xnobjpool_t *pool,
+		    void *obj);
+
+#if CONFIG_XENO_OPT_SYS_STACKPOOLSZ > 0
+void xnheap_init_stacks(void);
+
+void xnheap_flush_stacks(void);
+
+void *xnheap_alloc_stack(u_long size);
+
+void xnheap_free_stack(void *stackbase, u_long size);
+#endif
+
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+u_long xnheap_cached_mem(xnheap_t *heap);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -286,6 +508,10 @@ int xnheap_check_block(xnheap_t *heap,
 #define XNHEAP_PROC_SHARED_HEAP  1
 #define XNHEAP_SYS_HEAP          2
 #define XNHEAP_SYS_STACKPOOL     3
+#define XNHEAP_SYS_EVTRACE       4
+#define XNHEAP_SYS_STATMAP       5
+#define XNHEAP_SYS_PROFILE       6
+#define XNHEAP_PROC_MALLOC_HEAP  7
 
 struct xnheap_desc {
 	unsigned long handle;
@@ -294,4 +520,31 @@ struct xnheap_desc {
 	unsigned long used;
 };
 
+/* Returned by the sys_heap_extent syscall. */
+struct xnheap_ext_desc {
+	unsigned long area;	/* Mapping offset of the extent, zero if absent */
+	unsigned long size;	/* Extent size */
+	unsigned int nrext;	/* Current number of extents */
+	unsigned int maxext;	/* Extent limit */
+};
+
+/* Free chunk size classes, 2^3 to 2^31 bytes. */
+#define XNHEAP_XSTATS_CLASSES  29
+
+/* Filled in by xnheap_get_xstats(). */
+struct xnheap_xstats {
+	unsigned long allocs;	/* Successful allocations */
+	unsigned long frees;	/* Successful releases */
+	unsigned long failures;	/* Failed allocations */
+	unsigned long long maxalloc; /* Worst xnheap_alloc() time (ns) */
+	unsigned long largest;	/* Largest free contiguous chunk (bytes) */
+	/* Page states, zero for TLSF heaps. */
+	unsigned long pfree;	/* Free pages */
+	unsigned long plist;	/* Pages heading a multi-page block */
+	unsigned long pcont;	/* Continuation pages of such blocks */
+	unsigned long pbucket;	/* Pages split into bucket blocks */
+	/* Free chunks in [2^(n+3), 2^(n+4)) bytes. */
+	unsigned long freechunks[XNHEAP_XSTATS_CLASSES];
+};
+
 #endif /* !_XENO_NUCLEUS_HEAP_H */
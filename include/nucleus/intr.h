@@ -33,6 +33,12 @@
 /* Creation flags. */
 #define XN_ISR_SHARED	 0x1
 #define XN_ISR_EDGE	 0x2
+#define XN_ISR_THREADED	 0x4
+
+/* Priority of the IRQ thread, passed along with XN_ISR_THREADED. */
+#define XN_ISR_PRIO_SHIFT	20
+#define XN_ISR_PRIO_MASK	(0x1ff << XN_ISR_PRIO_SHIFT)
+#define XN_ISR_PRIO(prio)	(((prio) << XN_ISR_PRIO_SHIFT) & XN_ISR_PRIO_MASK)
 
 /* Operational flags. */
 #define XN_ISR_ATTACHED	 0x10000
@@ -43,11 +49,18 @@
 #include <nucleus/stat.h>
 
 struct xnsched;
+struct xnthread;
+struct xntimer;
+struct xnintr_thread;
 
 typedef struct xnintr {
 
 #ifdef CONFIG_XENO_OPT_SHIRQ
     struct xnintr *next; /* !< Next object in the IRQ-sharing chain. */
+
+    xnisr_t claim;	/* !< Optional claim check (shared IRQs). */
+
+    unsigned long shirq_hits; /* !< Receipts claimed since the last election. */
 #endif /* CONFIG_XENO_OPT_SHIRQ */
 
     unsigned unhandled;	/* !< Number of consequent unhandled interrupts */
@@ -64,8 +77,21 @@ typedef struct xnintr {
 
     const char *name;	/* !< Symbolic name. */
 
+    struct xnintr_thread *irqthread; /* !< IRQ thread (XN_ISR_THREADED). */
+
+    unsigned long pending; /* !< IRQs pending for the IRQ thread. */
+
+#ifdef CONFIG_SMP
+    struct xnthread *consumer; /* !< Thread the IRQ affinity follows (xnintr_bind()). */
+
+    struct xntimer *ctimer; /* !< Timer following the consumer too, if any. */
+
+    struct xnintr *cnext; /* !< Next object bound to the same consumer. */
+#endif /* CONFIG_SMP */
+
     struct {
 	xnstat_counter_t hits;	  /* !< Number of handled receipts since attachment. */
+	xnstat_counter_t xwakeups; /* !< Receipts which woke up a thread on another CPU. */
 	xnstat_exectime_t account; /* !< Runtime accounting entity */
 	xnstat_exectime_t sum; /* !< Accumulated accounting entity */
     } stat[XNARCH_NR_CPUS];
@@ -98,6 +124,8 @@ extern "C" {
 
 int xnintr_mount(void);
 
+void xnintr_umount(void);
+
 void xnintr_clock_handler(void);
 
 void xnintr_host_tick(struct xnsched *sched);
@@ -129,6 +157,20 @@ int xnintr_disable(xnintr_t *intr);
 void xnintr_affinity(xnintr_t *intr,
 		     xnarch_cpumask_t cpumask);
 
+void xnintr_set_claim(xnintr_t *intr,
+		      xnisr_t claim);
+
+void xnintr_bind(xnintr_t *intr,
+		 struct xnthread *thread,
+		 struct xntimer *timer);
+
+#ifdef CONFIG_SMP
+void xnintr_follow_consumer(struct xnthread *thread,
+			    struct xnsched *sched);
+
+void xnintr_release_consumer(struct xnthread *thread);
+#endif /* CONFIG_SMP */
+
 int xnintr_query_init(xnintr_iterator_t *iterator);
 
 int xnintr_query_next(int irq, xnintr_iterator_t *iterator,
@@ -0,0 +1,55 @@
+/*!\file latprof.h
+ * \brief Power management latency profile.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _XENO_NUCLEUS_LATPROF_H
+#define _XENO_NUCLEUS_LATPROF_H
+
+#if defined(__KERNEL__) && defined(CONFIG_XENO_OPT_LATPROF)
+
+#include <nucleus/sched.h>
+
+void __xnlatprof_engage(struct xnsched *sched);
+
+/*
+ * Called from the rescheduling procedure, nklock held. Switching to
+ * a real-time thread engages the profile of the CPU if need be,
+ * switching back to the root thread stamps the beginning of a
+ * potentially idle period, the profile being released by the Linux
+ * side once the CPU has stayed idle long enough.
+ */
+static inline void xnlatprof_switch(struct xnsched *sched,
+				    struct xnthread *next)
+{
+	if (xnthread_test_state(next, XNROOT))
+		sched->lpidle = jiffies;
+	else if (!sched->lpstate)
+		__xnlatprof_engage(sched);
+}
+
+void xnlatprof_mount(void);
+
+void xnlatprof_umount(void);
+
+#else /* !(__KERNEL__ && CONFIG_XENO_OPT_LATPROF) */
+
+#define xnlatprof_switch(sched, next)	do { } while (0)
+
+#endif /* !(__KERNEL__ && CONFIG_XENO_OPT_LATPROF) */
+
+#endif /* !_XENO_NUCLEUS_LATPROF_H */
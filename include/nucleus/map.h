@@ -30,6 +30,18 @@
 
 #define XNMAP_MAX_KEYS	(BITS_PER_LONG * BITS_PER_LONG)
 
+/* Growable maps index their objects by chunks of one page. */
+#define XNMAP_CHUNK_KEYS	(PAGE_SIZE / sizeof(void *))
+
+struct xnmap_chunk {
+
+    int nfree;
+#define __IDMAP_LONGS	((XNMAP_CHUNK_KEYS+BITS_PER_LONG-1)/BITS_PER_LONG)
+    unsigned long freemap[__IDMAP_LONGS];
+#undef __IDMAP_LONGS
+    void *objarray[XNMAP_CHUNK_KEYS];
+};
+
 typedef struct xnmap {
 
     int nkeys;
@@ -37,6 +49,11 @@ typedef struct xnmap {
     int offset;
     unsigned long himask;
     unsigned long himap;
+    /* Growable maps only. */
+    int reserve;
+    struct xnmap_chunk **chunks;
+    unsigned long *chunkmap;	/* Chunks which may draw keys. */
+    /* Fixed-size maps only, not allocated for growable maps. */
 #define __IDMAP_LONGS	((XNMAP_MAX_KEYS+BITS_PER_LONG-1)/BITS_PER_LONG)
     unsigned long lomap[__IDMAP_LONGS];
 #undef __IDMAP_LONGS
@@ -48,6 +65,10 @@ xnmap_t *xnmap_create(int nkeys,
 		      int reserve,
 		      int offset);
 
+xnmap_t *xnmap_create_growable(int nkeys,
+			       int reserve,
+			       int offset);
+
 void xnmap_delete(xnmap_t *map);
 
 int xnmap_enter(xnmap_t *map,
@@ -57,10 +78,23 @@ int xnmap_enter(xnmap_t *map,
 int xnmap_remove(xnmap_t *map,
 		 int key);
 
+static inline void *__xnmap_fetch(xnmap_t *map, int ofkey)
+{
+	struct xnmap_chunk *chunk;
+
+	if (likely(map->chunks == NULL))
+		return map->objarray[ofkey];
+
+	chunk = map->chunks[(unsigned)ofkey / XNMAP_CHUNK_KEYS];
+	if (chunk == NULL)
+		return NULL;
+
+	return chunk->objarray[(unsigned)ofkey % XNMAP_CHUNK_KEYS];
+}
+
 static inline void *xnmap_fetch_nocheck(xnmap_t *map, int key)
 {
-	int ofkey = key - map->offset;
-	return map->objarray[ofkey];
+	return __xnmap_fetch(map, key - map->offset);
 }
 
 static inline void *xnmap_fetch(xnmap_t *map, int key)
@@ -70,7 +104,7 @@ static inline void *xnmap_fetch(xnmap_t *map, int key)
 	if (ofkey < 0 || ofkey >= map->nkeys)
 		return NULL;
 
-	return map->objarray[ofkey];
+	return __xnmap_fetch(map, ofkey);
 }
 
 /*@}*/
@@ -40,4 +40,6 @@ extern xnqueue_t xnmod_glink_queue;
 
 extern u_long xnmod_sysheap_size;
 
+extern u_long xnmod_htick_nohz_mask;
+
 #endif /* !_XENO_NUCLEUS_MODULE_H */
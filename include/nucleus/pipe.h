@@ -29,6 +29,9 @@
 #define XNPIPEIOC_OFLUSH	_IO(XNPIPE_IOCTL_BASE,2)
 #define XNPIPEIOC_FLUSH		XNPIPEIOC_OFLUSH
 #define XNPIPEIOC_SETSIG	_IO(XNPIPE_IOCTL_BASE,3)
+#define XNPIPEIOC_MAP_RING	_IOR(XNPIPE_IOCTL_BASE,4,struct xnpipe_ring_info)
+#define XNPIPEIOC_RELEASE	_IO(XNPIPE_IOCTL_BASE,5)
+#define XNPIPEIOC_SET_WMARK	_IOW(XNPIPE_IOCTL_BASE,6,struct xnpipe_wmark)
 
 #define XNPIPE_NORMAL  0x0
 #define XNPIPE_URGENT  0x1
@@ -38,11 +41,55 @@
 
 #define XNPIPE_MINOR_AUTO  -1
 
+/*
+ * Mapped ring mode. When the kernel side attached a descriptor ring
+ * to the pipe, the Linux reader may switch to this mode by issuing
+ * XNPIPEIOC_MAP_RING, then map the message pool through
+ * /dev/rtheap using the returned information. Outgoing messages are
+ * published to the ring instead of being copied by read(); the
+ * reader consumes them in place by moving the tail index, and hands
+ * the consumed buffers back in batches, either explicitly with
+ * XNPIPEIOC_RELEASE, or implicitly when polling the pipe. Indices
+ * are free-running, the slot of a given index is index % nslots.
+ */
+struct xnpipe_ring_desc {
+	unsigned long offset;	/* Message data, from the pool base. */
+	unsigned long size;	/* Message size (in bytes). */
+};
+
+struct xnpipe_ring {
+	unsigned long nslots;
+	unsigned long head;	/* Next slot to publish (kernel). */
+	unsigned long tail;	/* Next slot to consume (reader). */
+	struct xnpipe_ring_desc desc[0];
+};
+
+/*
+ * Wakeup coalescing. With a non-zero watermark, a Linux reader
+ * waiting for data is only woken up once the output sent since it
+ * started waiting reaches either threshold, or when the latency delay
+ * has elapsed since the first of those messages was sent. Zero
+ * thresholds disable coalescing.
+ */
+struct xnpipe_wmark {
+	unsigned long bytes;	/* Byte threshold, 0 if unused. */
+	unsigned long msgs;	/* Message threshold, 0 if unused. */
+	unsigned long latency;	/* Max wakeup delay (ns), mandatory. */
+};
+
+struct xnpipe_ring_info {
+	unsigned long handle;	/* Pool handle for /dev/rtheap. */
+	unsigned long size;	/* Size of the pool mapping. */
+	unsigned long area;	/* Mapping offset for mmap(). */
+	unsigned long ringoff;	/* Offset of the ring in the mapping. */
+};
+
 #ifdef __KERNEL__
 
 #include <nucleus/queue.h>
 #include <nucleus/synch.h>
 #include <nucleus/thread.h>
+#include <nucleus/select.h>
 #include <linux/types.h>
 #include <linux/poll.h>
 
@@ -54,6 +101,7 @@
 #define XNPIPE_USER_WREAD_READY  0x20
 #define XNPIPE_USER_WSYNC        0x40
 #define XNPIPE_USER_WSYNC_READY  0x80
+#define XNPIPE_USER_RING         0x100
 
 #define XNPIPE_USER_ALL_WAIT \
 (XNPIPE_USER_WREAD|XNPIPE_USER_WSYNC)
@@ -75,6 +123,7 @@ static inline xnpipe_mh_t *link2mh(struct xnholder *ln)
 }
 
 struct xnpipe_state;
+struct xnheap;
 
 struct xnpipe_operations {
 	void (*output)(struct xnpipe_mh *mh, void *xstate);
@@ -94,6 +143,7 @@ struct xnpipe_state {
 	struct xnqueue inq;		/* From user-space to kernel */
 	struct xnqueue outq;		/* From kernel to user-space */
 	struct xnsynch synchbase;
+	DECLARE_XNSELECT(rselect);	/* Ready while inq is not empty */
 	struct xnpipe_operations ops;
 	void *xstate;		/* Extra state managed by caller */
 
@@ -105,6 +155,22 @@ struct xnpipe_state {
 	int wcount;			/* number of waiters on this minor */
 	size_t ionrd;
 
+	/* Mapped ring mode */
+	struct xnheap *rpool;		/* Mappable pool holding messages */
+	struct xnpipe_ring *ring;	/* Descriptor ring shared with reader */
+	struct xnpipe_mh **rmh;		/* Messages published to the ring */
+	unsigned long rnslots;
+	unsigned long rhead;		/* Published messages */
+	unsigned long rreap;		/* Released messages */
+
+	/* Wakeup coalescing */
+	struct xnpipe_wmark wmark;
+	xntimer_t wtimer;		/* Max latency timer */
+	size_t wbytes;			/* Output pending the wakeup */
+	unsigned long wmsgs;
+	unsigned long nsent;		/* Messages sent to waiting readers */
+	unsigned long nwakeups;		/* Wakeups issued for them */
+
 };
 
 extern struct xnpipe_state xnpipe_states[];
@@ -136,6 +202,15 @@ ssize_t xnpipe_recv(int minor,
 
 int xnpipe_flush(int minor, int mode);
 
+int xnpipe_attach_ring(int minor, struct xnheap *pool, unsigned nslots);
+
+int xnpipe_set_wmark(int minor, const struct xnpipe_wmark *wmark);
+
+#ifdef CONFIG_XENO_OPT_SELECT
+int xnpipe_select_bind(int minor, struct xnselector *selector,
+		       unsigned type, unsigned index);
+#endif /* CONFIG_XENO_OPT_SELECT */
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
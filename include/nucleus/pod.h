@@ -68,7 +68,15 @@ struct xnpod {
 
 	xnflags_t status;	/*!< Status bitmask. */
 
+#ifdef CONFIG_SMP
+	xnarch_cpumask_t ipipend;	/*!< CPUs with a rescheduling IPI in flight. */
+#endif
+
+#ifdef CONFIG_XENO_OPT_NUMA
+	xnsched_t *sched[XNARCH_NR_CPUS];	/*!< Per-cpu scheduler slots, node-local. */
+#else
 	xnsched_t sched[XNARCH_NR_CPUS];	/*!< Per-cpu scheduler slots. */
+#endif
 
 	xnqueue_t threadq;	/*!< All existing threads. */
 #ifdef CONFIG_XENO_OPT_VFILE
@@ -77,12 +85,11 @@ struct xnpod {
 	xnqueue_t tstartq,	/*!< Thread start hook queue. */
 	 tswitchq,		/*!< Thread switch hook queue. */
 	 tdeleteq;		/*!< Thread delete hook queue. */
+	xnflags_t hooks;	/*!< Non-empty hook queues (XNHOOK_BIT). */
+	unsigned long hookgen;	/*!< Hook removal count. */
 
 	atomic_counter_t timerlck;	/*!< Timer lock depth.  */
 
-	xntimer_t tslicer;	/*!< Time-slicing timer for aperiodic mode  */
-	int tsliced;		/*!< Number of threads using the slicer */
-
 	int refcnt;		/*!< Reference count.  */
 
 #ifdef __XENO_SIM__
@@ -94,10 +101,28 @@ typedef struct xnpod xnpod_t;
 
 DECLARE_EXTERN_XNLOCK(nklock);
 
+#ifdef XNLOCK_CONTENTION_STATS
+void xnlock_stat_attach(xnlock_t *lock, const char *name, ...);
+
+void xnlock_stat_detach(xnlock_t *lock);
+#else /* !XNLOCK_CONTENTION_STATS */
+static inline void xnlock_stat_attach(xnlock_t *lock, const char *name, ...)
+{
+}
+
+static inline void xnlock_stat_detach(xnlock_t *lock)
+{
+}
+#endif /* !XNLOCK_CONTENTION_STATS */
+
 extern u_long nklatency;
 
 extern u_long nktimerlat;
 
+extern u_long nkcoalesce;
+
+extern xnticks_t nkvtick;
+
 extern xnarch_cpumask_t nkaffinity;
 
 extern xnpod_t nkpod_struct;
@@ -110,15 +135,35 @@ static inline int xnpod_init_proc(void) { return 0; }
 static inline void xnpod_cleanup_proc(void) {}
 #endif /* !CONFIG_XENO_OPT_VFILE */
 
+#ifdef CONFIG_XENO_OPT_NUMA
+int xnpod_alloc_scheds(void);
+void xnpod_free_scheds(void);
+#else /* !CONFIG_XENO_OPT_NUMA */
+static inline int xnpod_alloc_scheds(void) { return 0; }
+static inline void xnpod_free_scheds(void) {}
+#endif /* !CONFIG_XENO_OPT_NUMA */
+
 static inline int xnpod_mount(void)
 {
+	int ret;
+
+	ret = xnpod_alloc_scheds();
+	if (ret)
+		return ret;
+
 	xnsched_register_classes();
-	return xnpod_init_proc();
+
+	ret = xnpod_init_proc();
+	if (ret)
+		xnpod_free_scheds();
+
+	return ret;
 }
 
 static inline void xnpod_umount(void)
 {
 	xnpod_cleanup_proc();
+	xnpod_free_scheds();
 }
 
 #ifdef __cplusplus
@@ -138,8 +183,13 @@ void __xnpod_schedule(struct xnsched *sched);
 
 	/* -- Beginning of the exported interface */
 
+#ifdef CONFIG_XENO_OPT_NUMA
+#define xnpod_sched_slot(cpu) \
+    (nkpod->sched[cpu])
+#else
 #define xnpod_sched_slot(cpu) \
     (&nkpod->sched[cpu])
+#endif
 
 #define xnpod_current_sched() \
     xnpod_sched_slot(xnarch_current_cpu())
@@ -333,18 +383,16 @@ static inline void xnpod_unlock_sched(void)
 	xnlock_put_irqrestore(&nklock, s);
 }
 
-void xnpod_fire_callouts(xnqueue_t *hookq,
-			 xnthread_t *thread);
+void xnpod_fire_callouts(int type, xnthread_t *thread);
 
-static inline void xnpod_run_hooks(struct xnqueue *q,
-				   struct xnthread *thread, const char *type)
+/*
+ * Hooks are seldom used, so this should boil down to testing a bit
+ * of a static variable, with the callout code out of line.
+ */
+static inline void xnpod_run_hooks(int type, struct xnthread *thread)
 {
-	if (!emptyq_p(q)) {
-		trace_mark(xn_nucleus, thread_callout,
-			   "thread %p thread_name %s hook %s",
-			   thread, xnthread_name(thread), type);
-		xnpod_fire_callouts(q, thread);
-	}
+	if (unlikely(testbits(nkpod_struct.hooks, XNHOOK_BIT(type))))
+		xnpod_fire_callouts(type, thread);
 }
 
 int xnpod_set_thread_periodic(xnthread_t *thread,
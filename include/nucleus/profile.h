@@ -0,0 +1,107 @@
+/*!\file profile.h
+ * \brief Sampling profiler for the nucleus.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _XENO_NUCLEUS_PROFILE_H
+#define _XENO_NUCLEUS_PROFILE_H
+
+#define XNPROFILE_MAGIC		0x50524f46	/* "PROF" */
+
+/* Sample flags. */
+#define XNPROFILE_ROOT		0x1	/* Linux was running. */
+#define XNPROFILE_KERNEL	0x2	/* Kernel-based thread, no PC. */
+
+/*
+ * The sample area lives in a mapped heap which user-space may map
+ * via the sys_heap_info syscall (XNHEAP_SYS_PROFILE) and
+ * /dev/rtheap. The offset of the area descriptor within that heap is
+ * reported by /proc/xenomai/profile. Rings immediately follow the
+ * descriptor, one per CPU, each made of a head index followed by
+ * nr_recs records of rec_size bytes.
+ *
+ * A record holds the user-space PC the sampled thread was
+ * interrupted at, followed by up to max_depth return addresses
+ * found by walking its frame pointers, innermost first. The ring
+ * protocol is the same as the event tracer's: if (head - i) >=
+ * nr_recs once record #i was copied, it may have been overwritten
+ * meanwhile and must be discarded.
+ */
+struct xnprofile_rec {
+	unsigned long long tsc;
+	int pid;		/* Host PID of shadows, zero otherwise. */
+	unsigned int thread;	/* Thread handle. */
+	unsigned int flags;
+	unsigned int depth;	/* Valid entries in pcs[]. */
+	char name[16];
+	unsigned long long pcs[0];
+};
+
+struct xnprofile_ring {
+	volatile unsigned int head;	/* Index of the next record. */
+	unsigned int pad;
+	char recs[0];
+};
+
+struct xnprofile_area {
+	unsigned int magic;
+	unsigned int nr_cpus;
+	unsigned int nr_recs;		/* Records per ring, power of 2. */
+	unsigned int rec_size;		/* Bytes between records. */
+	unsigned int ring_size;		/* Bytes between rings. */
+	unsigned int max_depth;		/* Return addresses per record. */
+	unsigned int frequency;		/* Sampling rate (Hz), zero if off. */
+	unsigned int pad;
+	unsigned long long tsc_freq;
+	struct xnprofile_ring rings[0];
+};
+
+#define xnprofile_ring(area, cpu)					\
+	((struct xnprofile_ring *)((char *)(area)->rings +		\
+				   (cpu) * (area)->ring_size))
+
+#define xnprofile_rec(area, ring, n)					\
+	((struct xnprofile_rec *)((ring)->recs +			\
+				  ((n) & ((area)->nr_recs - 1)) *	\
+				  (area)->rec_size))
+
+#ifdef __KERNEL__
+
+#ifdef CONFIG_XENO_OPT_PROFILE
+
+struct xnthread;
+struct xntimer;
+
+void xnprofile_attach(struct xnthread *thread);
+
+void xnprofile_tick(struct xntimer *timer);
+
+struct xnheap *xnprofile_heap(void);
+
+int xnprofile_mount(void);
+
+void xnprofile_umount(void);
+
+#else /* !CONFIG_XENO_OPT_PROFILE */
+
+#define xnprofile_attach(thread)	do { } while (0)
+
+#endif /* !CONFIG_XENO_OPT_PROFILE */
+
+#endif /* __KERNEL__ */
+
+#endif /* !_XENO_NUCLEUS_PROFILE_H */
@@ -28,6 +28,17 @@
 
 #define XNOBJECT_SELF  XN_NO_HANDLE
 
+/*
+ * Registry handles carry the slot number in their low bits, and a
+ * generation count in the upper ones which is bumped each time the
+ * slot is released. A stale handle referring to a recycled slot thus
+ * never validates. The spare bits used by the fast synchronization
+ * support are kept clear.
+ */
+#define XNOBJECT_SLOT_BITS	16
+#define XNOBJECT_SLOT_MASK	((xnhandle_t)((1UL << XNOBJECT_SLOT_BITS) - 1))
+#define XNOBJECT_GEN_MASK	((xnhandle_t)0x0fffffff & ~XNOBJECT_SLOT_MASK)
+
 #if defined(__KERNEL__) || defined(__XENO_SIM__)
 
 #include <nucleus/synch.h>
@@ -37,7 +48,9 @@ struct xnpnode;
 
 typedef struct xnobject {
 	void *objaddr;
+	xnhandle_t handle;	  /* !< Current handle to this slot. */
 	const char *key;	  /* !< Hash key. */
+	unsigned int hash;	  /* !< Hash value of the key. */
 	struct xnsynch safesynch; /* !< Safe synchronization object. */
 	u_long safelock;	  /* !< Safe lock count. */
 	u_long cstamp;		  /* !< Creation stamp. */
@@ -71,6 +84,7 @@ void xnregistry_cleanup(void);
 
 #define XNOBJECT_PNODE_RESERVED1 ((struct xnvfile *)1)
 #define XNOBJECT_PNODE_RESERVED2 ((struct xnvfile *)2)
+#define XNOBJECT_PNODE_RESERVED3 ((struct xnvfile *)3)
 
 struct xnptree {
 	const char *dirname;
@@ -140,32 +154,56 @@ struct xnpnode_link {
 
 #endif /* !CONFIG_XENO_OPT_VFILE */
 
-extern struct xnobject *registry_obj_slots;
-
 /* Public interface. */
 
 extern struct xnobject *registry_obj_slots;
 
+static inline struct xnobject *__xnregistry_slot(xnhandle_t handle)
+{
+	xnhandle_t slot = handle & XNOBJECT_SLOT_MASK;
+
+	if (likely(slot && slot < CONFIG_XENO_OPT_REGISTRY_NRSLOTS))
+		return &registry_obj_slots[slot];
+
+	return NULL;
+}
+
 static inline struct xnobject *xnregistry_validate(xnhandle_t handle)
 {
-	struct xnobject *object;
+	struct xnobject *object = __xnregistry_slot(handle);
 	/*
 	 * Careful: a removed object which is still in flight to be
 	 * unexported carries a NULL objaddr, so we have to check this
 	 * as well.
 	 */
-	if (likely(handle && handle < CONFIG_XENO_OPT_REGISTRY_NRSLOTS)) {
-		object = &registry_obj_slots[handle];
-		return object->objaddr ? object : NULL;
-	}
+	if (likely(object && object->handle == handle && object->objaddr))
+		return object;
 
 	return NULL;
 }
 
+/*
+ * Lockless lookup. Writers update the slots under nklock, bumping
+ * the handle generation before clearing objaddr on removal. Reading
+ * the handle again after objaddr detects a slot which was released
+ * and recycled meanwhile, so nklock is not needed here.
+ */
 static inline void *xnregistry_lookup(xnhandle_t handle)
 {
-	struct xnobject *object = xnregistry_validate(handle);
-	return object ? object->objaddr : NULL;
+	struct xnobject *object = __xnregistry_slot(handle);
+	void *objaddr;
+
+	if (unlikely(object == NULL || object->handle != handle))
+		return NULL;
+
+	xnarch_read_memory_barrier();
+	objaddr = object->objaddr;
+	xnarch_read_memory_barrier();
+
+	if (unlikely(object->handle != handle))
+		return NULL;
+
+	return objaddr;
 }
 
 int xnregistry_enter(const char *key,
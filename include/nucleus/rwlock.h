@@ -0,0 +1,148 @@
+/*!\file rwlock.h
+ * \brief Reader-writer spinlock.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _XENO_NUCLEUS_RWLOCK_H
+#define _XENO_NUCLEUS_RWLOCK_H
+
+#ifdef __KERNEL__
+
+#include <asm/xenomai/system.h>
+
+/*
+ * Reader-writer spinlock, for read-mostly data which readers on
+ * several CPUs may consult concurrently. Like xnlock, it may be
+ * grabbed from any domain, and must be held with interrupts off;
+ * unlike xnlock, it is not recursive.
+ *
+ * The lock word holds the count of readers, plus a bit telling that
+ * a writer owns the lock, and another one telling that a writer is
+ * spinning for it. New readers stay away while the latter is set,
+ * so that writers cannot be starved by a steady flow of readers.
+ */
+
+#ifdef CONFIG_SMP
+
+#define XNRWLOCK_WRITER		0x80000000
+#define XNRWLOCK_WAITING	0x40000000
+#define XNRWLOCK_READERS	0x3fffffff
+
+typedef struct xnrwlock {
+	atomic_t value;
+} xnrwlock_t;
+
+#define XNARCH_RWLOCK_UNLOCKED	(xnrwlock_t) { ATOMIC_INIT(0) }
+
+static inline void xnrwlock_init(xnrwlock_t *lock)
+{
+	*lock = XNARCH_RWLOCK_UNLOCKED;
+}
+
+static inline void xnrwlock_read_get(xnrwlock_t *lock)
+{
+	int v;
+
+	for (;;) {
+		v = atomic_read(&lock->value);
+		if (likely((v & (XNRWLOCK_WRITER|XNRWLOCK_WAITING)) == 0) &&
+		    atomic_cmpxchg(&lock->value, v, v + 1) == v)
+			break;
+		cpu_relax();
+	}
+}
+
+static inline void xnrwlock_read_put(xnrwlock_t *lock)
+{
+	/* Make our reads complete before the writer may step in. */
+	xnarch_memory_barrier();
+	atomic_dec(&lock->value);
+}
+
+static inline void xnrwlock_write_get(xnrwlock_t *lock)
+{
+	int v;
+
+	for (;;) {
+		v = atomic_read(&lock->value);
+		if ((v & ~XNRWLOCK_WAITING) == 0) {
+			if (atomic_cmpxchg(&lock->value, v,
+					   XNRWLOCK_WRITER) == v)
+				break;
+		} else if ((v & XNRWLOCK_WAITING) == 0)
+			/* Hold off new readers. */
+			atomic_cmpxchg(&lock->value, v, v | XNRWLOCK_WAITING);
+		cpu_relax();
+	}
+}
+
+static inline void xnrwlock_write_put(xnrwlock_t *lock)
+{
+	/*
+	 * Make sure all data written inside the lock is visible to
+	 * other CPUs before we release the lock. This clears the
+	 * waiting bit as well, other writers spinning for the lock
+	 * will raise it again.
+	 */
+	xnarch_memory_barrier();
+	atomic_set(&lock->value, 0);
+}
+
+#else /* !CONFIG_SMP */
+
+typedef struct xnrwlock {
+} xnrwlock_t;
+
+#define XNARCH_RWLOCK_UNLOCKED	(xnrwlock_t) { }
+
+#define xnrwlock_init(lock)		do { } while (0)
+#define xnrwlock_read_get(lock)		do { } while (0)
+#define xnrwlock_read_put(lock)		do { } while (0)
+#define xnrwlock_write_get(lock)	do { } while (0)
+#define xnrwlock_write_put(lock)	do { } while (0)
+
+#endif /* !CONFIG_SMP */
+
+#define DEFINE_XNRWLOCK(lock)	xnrwlock_t lock = XNARCH_RWLOCK_UNLOCKED
+
+#define xnrwlock_read_get_irqsave(lock, x)		\
+	do {						\
+		rthal_local_irq_save(x);		\
+		xnrwlock_read_get(lock);		\
+	} while (0)
+
+#define xnrwlock_read_put_irqrestore(lock, x)		\
+	do {						\
+		xnrwlock_read_put(lock);		\
+		rthal_local_irq_restore(x);		\
+	} while (0)
+
+#define xnrwlock_write_get_irqsave(lock, x)		\
+	do {						\
+		rthal_local_irq_save(x);		\
+		xnrwlock_write_get(lock);		\
+	} while (0)
+
+#define xnrwlock_write_put_irqrestore(lock, x)		\
+	do {						\
+		xnrwlock_write_put(lock);		\
+		rthal_local_irq_restore(x);		\
+	} while (0)
+
+#endif /* __KERNEL__ */
+
+#endif /* !_XENO_NUCLEUS_RWLOCK_H */
@@ -0,0 +1,67 @@
+/*!\file sched-edf.h
+ * \brief Definitions for the EDF scheduling class.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _XENO_NUCLEUS_SCHED_EDF_H
+#define _XENO_NUCLEUS_SCHED_EDF_H
+
+#ifndef _XENO_NUCLEUS_SCHED_H
+#error "please don't include nucleus/sched-edf.h directly"
+#endif
+
+#ifdef CONFIG_XENO_OPT_SCHED_EDF
+
+/* Bandwidth values are fixed-point fractions of a CPU. */
+#define XNSCHED_EDF_BW_SHIFT	20
+#define XNSCHED_EDF_BW_UNIT	(1UL << XNSCHED_EDF_BW_SHIFT)
+
+extern struct xnsched_class xnsched_class_edf;
+
+struct xnthread *xnsched_edf_pick(struct xnsched *sched);
+
+struct xnsched_edf_data {
+	xnticks_t budget;	/* !< Runtime left in the current period */
+	xnticks_t deadline;	/* !< Absolute deadline of the server */
+	xnticks_t run_start;	/* !< Date the budget started being consumed */
+	unsigned long bw;	/* !< Reserved bandwidth (runtime / period) */
+	int running;		/* !< Budget is being consumed */
+	int throttled;		/* !< Budget exhausted, waiting for replenishment */
+	int queued;		/* !< Linked to the runnable queue */
+	unsigned long throttles; /* !< Number of budget exhaustions */
+	struct xntimer drop_timer;
+	struct xntimer repl_timer;
+	struct xnsched_edf_param param;
+	struct xnthread *thread;
+};
+
+struct xnsched_edf {
+	struct xnqueue runnable;	/* !< Runnable threads, by deadline */
+	unsigned long bw;		/* !< Bandwidth reserved on this CPU */
+};
+
+static inline int xnsched_edf_init_tcb(struct xnthread *thread)
+{
+	thread->pedf = NULL;
+	thread->edf_deadline = 0;
+
+	return 0;
+}
+
+#endif /* !CONFIG_XENO_OPT_SCHED_EDF */
+
+#endif /* !_XENO_NUCLEUS_SCHED_EDF_H */
@@ -64,6 +64,14 @@ static inline int xnsched_idle_init_tcb(struct xnthread *thread)
 	return 0;
 }
 
+#if defined(__KERNEL__) && defined(CONFIG_XENO_OPT_POLL_IDLE)
+
+void xnsched_poll_idle_mount(void);
+
+void xnsched_poll_idle_umount(void);
+
+#endif /* __KERNEL__ && CONFIG_XENO_OPT_POLL_IDLE */
+
 #endif /* __KERNEL__ || __XENO_SIM__ */
 
 #endif /* !_XENO_NUCLEUS_SCHED_IDLE_H */
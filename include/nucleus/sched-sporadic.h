@@ -33,6 +33,8 @@
 
 extern struct xnsched_class xnsched_class_sporadic;
 
+struct xnthread *xnsched_sporadic_pick(struct xnsched *sched);
+
 struct xnsched_sporadic_repl {
 	xntime_t date;
 	xntime_t amount;
@@ -44,7 +46,8 @@ struct xnsched_sporadic_data {
 	int repl_in;
 	int repl_out;
 	int repl_pending;
-	struct xntimer repl_timer;
+	struct xnholder rlink;	/* !< Link in the replenishment queue */
+	struct xnsched *repl_sched; /* !< CPU queuing our replenishments */
 	struct xntimer drop_timer;
 	struct xnsched_sporadic_repl repl_data[CONFIG_XENO_OPT_SCHED_SPORADIC_MAXREPL];
 	struct xnsched_sporadic_param param;
@@ -52,6 +55,13 @@ struct xnsched_sporadic_data {
 };
 
 struct xnsched_sporadic {
+	struct xnqueue replq;	/* !< Threads by next replenishment date */
+	struct xntimer repl_timer; /* !< Serves the replenishment queue */
+	int repl_busy;		/* !< Queue being processed */
+	unsigned long repl_shots; /* !< Replenishment timer shots */
+	unsigned long repl_count; /* !< Replenishments applied */
+	xnticks_t repl_late_sum; /* !< Cumulated replenishment delay */
+	xnticks_t repl_late_max; /* !< Worst replenishment delay */
 #if XENO_DEBUG(NUCLEUS)
 	unsigned long drop_retries;
 #endif
@@ -31,9 +31,14 @@
 
 extern struct xnsched_class xnsched_class_tp;
 
+struct xnthread *xnsched_tp_pick(struct xnsched *sched);
+
 struct xnsched_tp_window {
 	xnticks_t w_offset;
 	int w_part;
+	unsigned long w_switches; /* !< Number of switches to this window */
+	unsigned long w_overruns; /* !< Number of late switches skipping this window */
+	xnticks_t w_maxdrift;	  /* !< Worst switch latency (ns) */
 };
 
 struct xnsched_tp_schedule {
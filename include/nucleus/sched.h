@@ -35,6 +35,7 @@
 #include <nucleus/schedqueue.h>
 #include <nucleus/sched-tp.h>
 #include <nucleus/sched-sporadic.h>
+#include <nucleus/sched-edf.h>
 #include <nucleus/vfile.h>
 
 /* Sched status flags */
@@ -48,10 +49,60 @@
 #define XNINIRQ		0x00004000	/* In IRQ handling context */
 #define XNHDEFER	0x00002000	/* Host tick deferred */
 #define XNINLOCK	0x00001000	/* Scheduler locked */
+#define XNHNOHZ		0x00000800	/* No host tick under real-time load */
 
 /* Sched RPI status flags */
 #define XNRPICK		0x80000000	/* Check RPI state */
 
+#ifdef CONFIG_XENO_OPT_STATS_SWITCH
+
+#define XNSCHED_CSW_PRIMARY	0	/* Switch between real-time threads */
+#define XNSCHED_CSW_ROOT	1	/* Switch from/to the root thread */
+#define XNSCHED_CSW_TYPES	2
+#define XNSCHED_CSW_BUCKETS	32	/* log2-scaled duration buckets */
+
+struct xnsched_cswhist {
+	unsigned long long start;	/*!< TSC stamp of the pending switch. */
+	int type;			/*!< Type of the pending switch. */
+	unsigned long gen;		/*!< Last reset generation applied. */
+	unsigned long hits[XNSCHED_CSW_TYPES][XNSCHED_CSW_BUCKETS];
+};
+
+#endif /* CONFIG_XENO_OPT_STATS_SWITCH */
+
+/* Stamps of the wakeup path, see xnsched_stamp_phase(). */
+#define XNSCHED_PHASE_IRQ	0	/* Clock handler entry */
+#define XNSCHED_PHASE_TIMER	1	/* Last timer handler run */
+#define XNSCHED_PHASE_SCHED	2	/* Rescheduling procedure entry */
+#define XNSCHED_PHASE_SWITCH	3	/* Incoming thread resumed */
+#define XNSCHED_NR_PHASES	4
+
+#ifdef CONFIG_XENO_HW_FPU
+
+struct xnsched_fpustat {
+	unsigned long saves;		/*!< FPU contexts saved. */
+	unsigned long restores;		/*!< FPU contexts restored. */
+	unsigned long faults;		/*!< First-use faults handled. */
+	unsigned long inits;		/*!< Contexts initialized ahead of use. */
+};
+
+#endif /* CONFIG_XENO_HW_FPU */
+
+#ifdef CONFIG_XENO_OPT_STATS_TIMERS
+
+#define XNSCHED_TMQ_BUCKETS	16	/* log2-scaled queue depth buckets */
+
+struct xnsched_tmstat {
+	unsigned long depth;		/*!< Current timer queue depth. */
+	unsigned long ticks;		/*!< Timer interrupts handled. */
+	unsigned long fired;		/*!< Timer handlers run. */
+	xnticks_t handler_time;		/*!< Time spent in handlers (TSC). */
+	xnticks_t max_late;		/*!< Worst lateness past expiry (TSC). */
+	unsigned long depth_hist[XNSCHED_TMQ_BUCKETS]; /*!< Depth at tick time. */
+};
+
+#endif /* CONFIG_XENO_OPT_STATS_TIMERS */
+
 struct xnsched_rt {
 	xnsched_queue_t runnable;	/*!< Runnable thread queue. */
 #ifdef CONFIG_XENO_OPT_PRIOCPL
@@ -61,16 +112,39 @@ struct xnsched_rt {
 
 /*!
  * \brief Scheduling information structure.
+ *
+ * Per-CPU slots start on a cache line boundary, so that a CPU
+ * updating its own slot does not invalidate the lines other CPUs
+ * read from theirs.
  */
 
 typedef struct xnsched {
 
+	/*
+	 * Fields up to the real-time class context are touched by
+	 * every pass through the rescheduling procedure, keep them
+	 * first.
+	 */
 	xnflags_t status;		/*!< Scheduler specific status bitmask. */
 	xnflags_t lflags;		/*!< Scheduler specific local flags bitmask. */
 	int cpu;
+	volatile unsigned inesting;	/*!< Interrupt nesting level. */
 	struct xnthread *curr;		/*!< Current thread. */
+	struct xnthread *zombie;
+#ifdef CONFIG_XENO_HW_UNLOCKED_SWITCH
+	struct xnthread *last;
+#endif
+#ifdef CONFIG_XENO_HW_FPU
+	struct xnthread *fpuholder;	/*!< Thread owning the current FPU context. */
+#endif
 #ifdef CONFIG_SMP
 	xnarch_cpumask_t resched;	/*!< Mask of CPUs needing rescheduling. */
+	xnstat_counter_t ipisent;	/*!< Rescheduling IPIs sent. */
+	xnstat_counter_t ipiskip;	/*!< IPIs saved, target already notified. */
+#endif
+#ifdef CONFIG_XENO_OPT_STATS
+	xnticks_t last_account_switch;	/*!< Last account switch date (ticks). */
+	xnstat_exectime_t *current_account;	/*!< Currently active account */
 #endif
 
 	struct xnsched_rt rt;		/*!< Context of built-in real-time class. */
@@ -80,19 +154,30 @@ typedef struct xnsched {
 #ifdef CONFIG_XENO_OPT_SCHED_SPORADIC
 	struct xnsched_sporadic pss;	/*!< Context of sporadic scheduling class. */
 #endif
+#ifdef CONFIG_XENO_OPT_SCHED_EDF
+	struct xnsched_edf edf;		/*!< Context of EDF scheduling class. */
+#endif
 
 	xntimerq_t timerqueue;		/* !< Core timer queue. */
-	volatile unsigned inesting;	/*!< Interrupt nesting level. */
+	xntimerq_t rtimerqueue;		/* !< Realtime-absolute one-shot timers. */
+	xnqueue_t rtpq;			/* !< Realtime-absolute periodic timers. */
 	struct xntimer htimer;		/*!< Host timer. */
-	struct xnthread *zombie;
-	struct xnthread rootcb;		/*!< Root thread control block. */
-
-#ifdef CONFIG_XENO_HW_UNLOCKED_SWITCH
-	struct xnthread *last;
+	struct xntimer rrbtimer;	/*!< Round-robin budget timer. */
+	xnticks_t rrbstamp;		/*!< Date the budget timer was armed at (ns). */
+#ifdef CONFIG_XENO_OPT_SCHED_BUDGET
+	struct xntimer bgtimer;		/*!< CPU budget timer. */
+	xnticks_t bgstamp;		/*!< Date the CPU budget timer was armed at (ns). */
 #endif
 
+	/* Fields below are seldom touched on the hot paths. */
+
+
 #ifdef CONFIG_XENO_HW_FPU
-	struct xnthread *fpuholder;	/*!< Thread owning the current FPU context. */
+	struct xnsched_fpustat fpustat;	/*!< FPU switch events. */
+#endif
+
+#ifdef CONFIG_XENO_OPT_STATS_TIMERS
+	struct xnsched_tmstat tmstat;	/*!< Timer cost figures. */
 #endif
 
 #ifdef CONFIG_XENO_OPT_WATCHDOG
@@ -100,23 +185,62 @@ typedef struct xnsched {
 	int wdcount;		/*!< Watchdog tick count. */
 #endif
 
+#ifdef CONFIG_XENO_OPT_PROFILE
+	struct xntimer proftimer;	/*!< Sampling profiler timer. */
+#endif
+
 #ifdef CONFIG_XENO_OPT_STATS
-	xnticks_t last_account_switch;	/*!< Last account switch date (ticks). */
-	xnstat_exectime_t *current_account;	/*!< Currently active account */
+	xnstat_exectime_t *sampled_account;	/*!< Account the clock IRQ preempted */
+	struct xntimer stimer;		/*!< Exectime sampling timer. */
+#endif
+
+#ifdef CONFIG_XENO_OPT_STATS_SWITCH
+	struct xnsched_cswhist cswhist;	/*!< Context switch latency histogram. */
+#endif
+
+#ifdef CONFIG_XENO_OPT_STATS_PHASES
+	xnticks_t phase_stamps[XNSCHED_NR_PHASES]; /*!< Wakeup path stamps (TSC). */
+#endif
+
+#ifdef CONFIG_XENO_OPT_LATPROF
+	int lpstate;		/*!< Latency profile requested. */
+	unsigned long lpidle;	/*!< Last switch to root (jiffies). */
+#endif
+
+#ifdef CONFIG_XENO_OPT_CACHE_PARTITION
+	int cpdefault;		/*!< Default cache class, -1 for Linux's. */
+	int cpcurrent;		/*!< Cache class in effect. */
+	u32 cplinux[2];		/*!< Class register saved from Linux. */
+	unsigned long cpgen;	/*!< Way masks generation loaded. */
 #endif
 
 #ifdef CONFIG_XENO_OPT_PRIOCPL
 	DECLARE_XNLOCK(rpilock);	/*!< RPI lock */
 	xnflags_t rpistatus;
+	int rpicount;		/*!< Threads linked to the RPI queue. */
+#ifdef CONFIG_XENO_OPT_STATS
+	struct xnsched_rpistat {
+		unsigned long switches;	/* Linux switches tracked */
+		unsigned long fastpath;	/* ... not grabbing the RPI lock */
+		unsigned long locked;	/* RPI lock acquisitions */
+		unsigned long renices;	/* Root thread renices */
+		unsigned long remote;	/* Remote RPI slot cleanups */
+	} rpistat;
+#endif /* CONFIG_XENO_OPT_STATS */
 #endif
 
 #ifdef CONFIG_XENO_OPT_PERVASIVE
 	struct task_struct *gatekeeper;
 	struct semaphore gksync;
 	struct xnthread *gktarget;
+#ifdef CONFIG_XENO_OPT_DIRECT_HARDEN
+	struct xnthread *gkdirect; /*!< Thread pending direct harden. */
 #endif
+#endif
+
+	struct xnthread rootcb;		/*!< Root thread control block. */
 
-} xnsched_t;
+} ____cacheline_aligned_in_smp xnsched_t;
 
 union xnsched_policy_param;
 
@@ -141,6 +265,8 @@ struct xnsched_class {
 	int (*sched_declare)(struct xnthread *thread,
 			     const union xnsched_policy_param *p);
 	void (*sched_forget)(struct xnthread *thread);
+	int (*sched_chkparam)(struct xnthread *thread,
+			      const union xnsched_policy_param *p);
 #ifdef CONFIG_XENO_OPT_PRIOCPL
 	struct xnthread *(*sched_push_rpi)(struct xnsched *sched,
 					   struct xnthread *thread);
@@ -210,6 +336,15 @@ static inline void xnsched_finalize_zombie(struct xnsched *sched)
 		__xnsched_finalize_zombie(sched);
 }
 
+#ifdef CONFIG_XENO_OPT_SCHED_REAPER
+void xnsched_kick_reaper(struct xnsched *sched);
+int xnsched_reaper_init(void);
+void xnsched_reaper_cleanup(void);
+#else /* !CONFIG_XENO_OPT_SCHED_REAPER */
+static inline int xnsched_reaper_init(void) { return 0; }
+static inline void xnsched_reaper_cleanup(void) { }
+#endif /* !CONFIG_XENO_OPT_SCHED_REAPER */
+
 #ifdef CONFIG_XENO_HW_UNLOCKED_SWITCH
 
 struct xnsched *xnsched_finish_unlocked_switch(struct xnsched *sched);
@@ -252,6 +387,88 @@ static inline void xnsched_reset_watchdog(struct xnsched *sched)
 }
 #endif /* CONFIG_XENO_OPT_WATCHDOG */
 
+#ifdef CONFIG_XENO_OPT_STATS_SWITCH
+
+extern unsigned long xnsched_cswhist_gen;
+
+/*
+ * Stamp the outgoing side of a context switch. Each CPU only ever
+ * updates its own histogram, with hw interrupts off, so no locking
+ * is required; resets are requested by bumping xnsched_cswhist_gen,
+ * and applied lazily by the owner CPU on its next sample.
+ */
+static inline void xnsched_cswhist_start(struct xnsched *sched,
+					 struct xnthread *prev,
+					 struct xnthread *next)
+{
+	struct xnsched_cswhist *h = &sched->cswhist;
+
+	h->type = (xnthread_test_state(prev, XNROOT) ||
+		   xnthread_test_state(next, XNROOT)) ?
+		XNSCHED_CSW_ROOT : XNSCHED_CSW_PRIMARY;
+	h->start = xnarch_get_cpu_tsc();
+}
+
+static inline void xnsched_cswhist_end(struct xnsched *sched)
+{
+	struct xnsched_cswhist *h = &sched->cswhist;
+	unsigned long long delta;
+	int bucket;
+
+	if (h->start == 0)
+		return;
+
+	delta = xnarch_get_cpu_tsc() - h->start;
+	h->start = 0;
+
+	if (unlikely(h->gen != xnsched_cswhist_gen)) {
+		memset(h->hits, 0, sizeof(h->hits));
+		h->gen = xnsched_cswhist_gen;
+	}
+
+	/* Bucket #n counts durations in [2^(n-1), 2^n) TSC ticks. */
+	bucket = delta >> 32 ? XNSCHED_CSW_BUCKETS - 1 : fls((u32)delta);
+	if (bucket >= XNSCHED_CSW_BUCKETS)
+		bucket = XNSCHED_CSW_BUCKETS - 1;
+
+	h->hits[h->type][bucket]++;
+}
+
+#else /* !CONFIG_XENO_OPT_STATS_SWITCH */
+
+static inline void xnsched_cswhist_start(struct xnsched *sched,
+					 struct xnthread *prev,
+					 struct xnthread *next)
+{
+}
+
+static inline void xnsched_cswhist_end(struct xnsched *sched)
+{
+}
+
+#endif /* !CONFIG_XENO_OPT_STATS_SWITCH */
+
+#ifdef CONFIG_XENO_OPT_STATS_PHASES
+
+/*
+ * Stamp a step of the wakeup path, interrupts off. Each stamp is
+ * overwritten by the next pass, readers are expected to check that
+ * the stamps they use are ordered and recent enough to belong to
+ * the wakeup they measure.
+ */
+static inline void xnsched_stamp_phase(struct xnsched *sched, int phase)
+{
+	sched->phase_stamps[phase] = xnarch_get_cpu_tsc();
+}
+
+#else /* !CONFIG_XENO_OPT_STATS_PHASES */
+
+static inline void xnsched_stamp_phase(struct xnsched *sched, int phase)
+{
+}
+
+#endif /* !CONFIG_XENO_OPT_STATS_PHASES */
+
 #include <nucleus/sched-idle.h>
 #include <nucleus/sched-rt.h>
 
@@ -265,6 +482,23 @@ void xnsched_init(struct xnsched *sched, int cpu);
 
 void xnsched_destroy(struct xnsched *sched);
 
+void xnsched_rrb_arm(struct xnsched *sched, struct xnthread *thread);
+
+#ifdef CONFIG_XENO_OPT_STATS
+int xnsched_set_sampling(xnticks_t period);
+#endif /* CONFIG_XENO_OPT_STATS */
+
+void __xnsched_rrb_switch(struct xnsched *sched,
+			  struct xnthread *prev, struct xnthread *next);
+
+#ifdef CONFIG_XENO_OPT_SCHED_BALANCE
+int xnsched_balance_init(void);
+void xnsched_balance_cleanup(void);
+#else /* !CONFIG_XENO_OPT_SCHED_BALANCE */
+static inline int xnsched_balance_init(void) { return 0; }
+static inline void xnsched_balance_cleanup(void) { }
+#endif /* !CONFIG_XENO_OPT_SCHED_BALANCE */
+
 struct xnthread *xnsched_pick_next(struct xnsched *sched);
 
 void xnsched_putback(struct xnthread *thread);
@@ -276,6 +510,8 @@ int xnsched_set_policy(struct xnthread *thread,
 void xnsched_track_policy(struct xnthread *thread,
 			  struct xnthread *target);
 
+void xnsched_protect_priority(struct xnthread *thread, int prio);
+
 void xnsched_migrate(struct xnthread *thread,
 		     struct xnsched *sched);
 
@@ -336,6 +572,11 @@ static inline int xnsched_init_tcb(struct xnthread *thread)
 	if (ret)
 		return ret;
 #endif /* CONFIG_XENO_OPT_SCHED_SPORADIC */
+#ifdef CONFIG_XENO_OPT_SCHED_EDF
+	ret = xnsched_edf_init_tcb(thread);
+	if (ret)
+		return ret;
+#endif /* CONFIG_XENO_OPT_SCHED_EDF */
 	return ret;
 }
 
@@ -349,7 +590,7 @@ static inline struct xnsched_class *xnsched_root_class(struct xnsched *sched)
 	return sched->rootcb.sched_class;
 }
 
-static inline void xnsched_tick(struct xnthread *curr, struct xntbase *tbase)
+static inline int xnsched_rr_p(struct xnthread *curr, struct xntbase *tbase)
 {
 	struct xnsched_class *sched_class = curr->sched_class;
 	/*
@@ -357,20 +598,55 @@ static inline void xnsched_tick(struct xnthread *curr, struct xntbase *tbase)
 	 * consumes its time slice when it runs within its own
 	 * scheduling class, which excludes temporary PIP boosts.
 	 */
-	if (xnthread_time_base(curr) == tbase &&
-	    sched_class != &xnsched_class_idle &&
-	    sched_class == curr->base_class &&
-	    xnthread_test_state(curr, XNTHREAD_BLOCK_BITS|XNLOCK|XNRRB) == XNRRB)
-		sched_class->sched_tick(curr);
+	return xnthread_time_base(curr) == tbase &&
+		sched_class != &xnsched_class_idle &&
+		sched_class == curr->base_class &&
+		xnthread_test_state(curr, XNTHREAD_BLOCK_BITS|XNLOCK|XNRRB) == XNRRB;
+}
+
+static inline void xnsched_tick(struct xnthread *curr, struct xntbase *tbase)
+{
+	if (xnsched_rr_p(curr, tbase))
+		curr->sched_class->sched_tick(curr);
+}
+
+/*
+ * Round-robin threads of the master time base have their budget
+ * timed by a per-CPU one-shot timer, armed at switch-in.
+ */
+static inline int xnsched_rrb_p(struct xnthread *thread)
+{
+	return xnthread_test_state(thread, XNRRB) &&
+		!xntbase_periodic_p(xnthread_time_base(thread));
+}
+
+static inline void xnsched_rrb_switch(struct xnsched *sched,
+				      struct xnthread *prev,
+				      struct xnthread *next)
+{
+	if (unlikely(xntimer_running_p(&sched->rrbtimer) || xnsched_rrb_p(next)))
+		__xnsched_rrb_switch(sched, prev, next);
 }
 
 #ifdef CONFIG_XENO_OPT_SCHED_CLASSES
 
+/*
+ * With static class dispatch, the built-in real-time class, which
+ * most threads belong to, is served by direct calls.
+ */
+#ifdef CONFIG_XENO_OPT_SCHED_STATIC
+#define xnsched_static_rt_p(sched_class)  ((sched_class) == &xnsched_class_rt)
+#else
+#define xnsched_static_rt_p(sched_class)  0
+#endif
+
 static inline void xnsched_enqueue(struct xnthread *thread)
 {
 	struct xnsched_class *sched_class = thread->sched_class;
 
-	if (sched_class != &xnsched_class_idle)
+	if (xnsched_static_rt_p(sched_class))
+		__xnsched_rt_enqueue(thread);
+	else if (sched_class != &xnsched_class_idle)
 		sched_class->sched_enqueue(thread);
 }
 
@@ -378,7 +654,9 @@ static inline void xnsched_dequeue(struct xnthread *thread)
 {
 	struct xnsched_class *sched_class = thread->sched_class;
 
-	if (sched_class != &xnsched_class_idle)
+	if (xnsched_static_rt_p(sched_class))
+		__xnsched_rt_dequeue(thread);
+	else if (sched_class != &xnsched_class_idle)
 		sched_class->sched_dequeue(thread);
 }
 
@@ -386,7 +664,9 @@ static inline void xnsched_requeue(struct xnthread *thread)
 {
 	struct xnsched_class *sched_class = thread->sched_class;
 
-	if (sched_class != &xnsched_class_idle)
+	if (xnsched_static_rt_p(sched_class))
+		__xnsched_rt_requeue(thread);
+	else if (sched_class != &xnsched_class_idle)
 		sched_class->sched_requeue(thread);
 }
 
@@ -42,6 +42,13 @@ struct xnsched_sporadic_param {
 	int current_prio;
 };
 
+struct xnsched_edf_param {
+	xnticks_t runtime;	/* budget per period. */
+	xnticks_t period;
+	xnticks_t deadline;	/* absolute, for PIP tracking only. */
+	int prio;		/* preemption level. */
+};
+
 union xnsched_policy_param {
 	struct xnsched_idle_param idle;
 	struct xnsched_rt_param rt;
@@ -51,6 +58,9 @@ union xnsched_policy_param {
 #ifdef CONFIG_XENO_OPT_SCHED_SPORADIC
 	struct xnsched_sporadic_param pss;
 #endif
+#ifdef CONFIG_XENO_OPT_SCHED_EDF
+	struct xnsched_edf_param edf;
+#endif
 };
 
 #endif /* !_XENO_NUCLEUS_SCHEDPARAM_H */
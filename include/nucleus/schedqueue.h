@@ -41,7 +41,12 @@ struct xnsched_mlq {
 
 	int loprio, hiprio, elems;
 	unsigned long himap, lomap[__MLQ_LONGS];
-	struct xnqueue queue[XNSCHED_MLQ_LEVELS];
+	/*
+	 * Bare list heads, packed into a single array: the bitmaps
+	 * tell us which levels are busy, so there is no point in
+	 * maintaining a full queue descriptor per level.
+	 */
+	struct xnholder heads[XNSCHED_MLQ_LEVELS];
 
 };
 
@@ -49,17 +54,8 @@ struct xnsched_mlq {
 
 void initmlq(struct xnsched_mlq *q, int loprio, int hiprio);
 
-void addmlq(struct xnsched_mlq *q,
-	    struct xnpholder *holder, int idx, int lifo);
-
-void removemlq(struct xnsched_mlq *q, struct xnpholder *holder);
-
 struct xnpholder *findmlqh(struct xnsched_mlq *q, int prio);
 
-struct xnpholder *getheadmlq(struct xnsched_mlq *q);
-
-struct xnpholder *getmlq(struct xnsched_mlq *q);
-
 struct xnpholder *nextmlq(struct xnsched_mlq *q,
 			  struct xnpholder *h);
 
@@ -96,6 +92,94 @@ static inline int ffsmlq(struct xnsched_mlq *q)
 	return hi * BITS_PER_LONG + lo;	/* Result is undefined if none set. */
 }
 
+static inline void __clrmlq(struct xnsched_mlq *q, int idx)
+{
+	int hi = idx / BITS_PER_LONG;
+	int lo = idx % BITS_PER_LONG;
+
+	__clrbits(q->lomap[hi], 1UL << lo);
+	if (q->lomap[hi] == 0)
+		__clrbits(q->himap, 1UL << hi);
+}
+
+/*
+ * The queuing routines below sit on the rescheduling path, so we
+ * want them inlined.
+ */
+static inline void addmlq(struct xnsched_mlq *q,
+			  struct xnpholder *h, int idx, int lifo)
+{
+	struct xnholder *head = &q->heads[idx];
+	int hi = idx / BITS_PER_LONG;
+	int lo = idx % BITS_PER_LONG;
+
+	if (lifo)
+		ath(head, &h->plink);
+	else
+		ath(head->last, &h->plink);
+
+	h->prio = idx;
+	q->elems++;
+	__setbits(q->himap, 1UL << hi);
+	__setbits(q->lomap[hi], 1UL << lo);
+}
+
+static inline void removemlq(struct xnsched_mlq *q, struct xnpholder *h)
+{
+	struct xnholder *head = &q->heads[h->prio];
+
+	dth(&h->plink);
+	q->elems--;
+
+	if (head->next == head)
+		__clrmlq(q, h->prio);
+}
+
+static inline struct xnpholder *getheadmlq(struct xnsched_mlq *q)
+{
+	struct xnholder *head;
+
+	if (emptymlq_p(q))
+		return NULL;
+
+	head = &q->heads[ffsmlq(q)];
+
+	XENO_ASSERT(QUEUES, head->next != head,
+		    xnpod_fatal
+		    ("corrupted multi-level queue, qslot=%p at %s:%d", q,
+		     __FILE__, __LINE__);
+		);
+
+	return (struct xnpholder *)head->next;
+}
+
+static inline struct xnpholder *getmlq(struct xnsched_mlq *q)
+{
+	struct xnholder *head, *h;
+	int idx;
+
+	if (emptymlq_p(q))
+		return NULL;
+
+	idx = ffsmlq(q);
+	head = &q->heads[idx];
+	h = head->next;
+
+	XENO_ASSERT(QUEUES, h != head,
+		    xnpod_fatal
+		    ("corrupted multi-level queue, qslot=%p at %s:%d", q,
+		     __FILE__, __LINE__);
+	    );
+
+	dth(h);
+	q->elems--;
+
+	if (head->next == head)
+		__clrmlq(q, idx);
+
+	return (struct xnpholder *)h;
+}
+
 static inline void insertmlql(struct xnsched_mlq *q,
 			      struct xnpholder *holder, int prio)
 {
@@ -43,6 +43,15 @@ struct xnselector {
 	} fds [XNSELECT_MAX_TYPES];
 	xnholder_t destroy_link;
 	xnqueue_t bindings; /* only used by xnselector_destroy */
+	xnqueue_t readyq; /* bindings with pending events */
+	unsigned long long cookie; /* cookie of bindings created next */
+};
+
+/* Event returned by xnselect_wait_ready(). */
+struct xnselect_event {
+	unsigned index;
+	unsigned types; /* mask of (1 << XNSELECT_*) bits */
+	unsigned long long cookie;
 };
 
 #define __NFDBITS__	(8 * sizeof(unsigned long))
@@ -97,8 +106,11 @@ struct xnselect_binding {
 	struct xnselect *fd;
 	unsigned type;
 	unsigned bit_index;
+	unsigned ready;
+	unsigned long long cookie;
 	xnholder_t link;  /* link in selected fds list. */
 	xnholder_t slink; /* link in selector list */
+	xnholder_t rlink; /* link in selector ready queue */
 };
 
 #ifdef __cplusplus
@@ -144,6 +156,27 @@ int xnselect(struct xnselector *selector,
 	     int nfds,
 	     xnticks_t timeout, xntmode_t timeout_mode);
 
+/**
+ * Set the cookie of the bindings created next for a selector.
+ *
+ * The cookie is returned along with the events of these bindings by
+ * xnselect_wait_ready().
+ */
+static inline void
+xnselector_set_cookie(struct xnselector *selector, unsigned long long cookie)
+{
+	selector->cookie = cookie;
+}
+
+int xnselect_unbind(struct xnselector *selector,
+		    unsigned type,
+		    unsigned index);
+
+int xnselect_wait_ready(struct xnselector *selector,
+			struct xnselect_event *events,
+			int maxevents,
+			xnticks_t timeout, xntmode_t timeout_mode);
+
 void xnselector_destroy(struct xnselector *selector);
 
 int xnselect_mount(void);
@@ -97,6 +97,23 @@ void xnshadow_send_sig(struct xnthread *thread,
 
 void xnshadow_rpi_check(void);
 
+void __xnshadow_publish(struct xnthread *thread);
+
+void xnshadow_rename(struct xnthread *thread);
+
+/* Refresh the state window of a shadow, nklock held. */
+#define xnshadow_publish(thread)				\
+	do {							\
+		if ((thread)->u_window)				\
+			__xnshadow_publish(thread);		\
+	} while (0)
+
+#ifdef CONFIG_XENO_OPT_DIRECT_HARDEN
+void xnshadow_finish_harden(struct xnsched *sched);
+
+void xnshadow_kick_harden(struct xnsched *sched);
+#endif /* CONFIG_XENO_OPT_DIRECT_HARDEN */
+
 #ifdef RTHAL_HAVE_RETURN_EVENT
 #define XNARCH_HAVE_MAYDAY  1
 void xnshadow_call_mayday(struct xnthread *thread);
@@ -111,7 +128,11 @@ static inline void xnshadow_call_mayday(struct xnthread *thread)
 }
 #endif
 
-#endif /* CONFIG_XENO_OPT_PERVASIVE */
+#else /* !CONFIG_XENO_OPT_PERVASIVE */
+
+#define xnshadow_publish(thread)	do { } while (0)
+
+#endif /* !CONFIG_XENO_OPT_PERVASIVE */
 
 #if defined(CONFIG_XENO_OPT_PERVASIVE) && defined(CONFIG_XENO_OPT_VFILE)
 void xnshadow_init_proc(void);
@@ -31,17 +31,31 @@ typedef struct xnstat_exectime {
 
 	xnticks_t total; /* Accumulated execution time */
 
+	xnticks_t last;	 /* Date of last accumulation */
+
 } xnstat_exectime_t;
 
 /* Return current date which can be passed to other xnstat services for
    immediate or lazy accounting. */
 #define xnstat_exectime_now() xnarch_get_cpu_tsc()
 
+/* Non-zero when the execution times are sampled by a low-rate per-CPU
+   timer, instead of being accounted for on each switch (see
+   xnsched_set_sampling()). Switch counts remain exact. */
+extern int xnstat_sampling;
+
+#define xnstat_sampling_p() unlikely(xnstat_sampling)
+
+/* Date for lazy switches, which sampled accounting does not need. */
+#define xnstat_exectime_lazy_now() \
+	(xnstat_sampling_p() ? 0 : xnarch_get_cpu_tsc())
+
 /* Accumulate exectime of the current account until the given date. */
 #define xnstat_exectime_update(sched, date) \
 do { \
 	(sched)->current_account->total += \
 		date - (sched)->last_account_switch; \
+	(sched)->current_account->last = date; \
 	(sched)->last_account_switch = date; \
 	/* All changes must be committed before changing the current_account \
 	   reference in sched (required for xnintr_sync_stat_references) */ \
@@ -102,6 +116,26 @@ static inline void xnstat_counter_set(xnstat_counter_t *c, unsigned long value)
 	c->counter = value;
 }
 
+#ifdef CONFIG_XENO_OPT_STATS_MODESW
+
+#define XNSTAT_MSW_REASONS	8	/* SIGDEBUG_* reason codes */
+#define XNSTAT_MSW_BUCKETS	20	/* log2-scaled duration buckets */
+
+typedef struct xnstat_modesw {
+	unsigned long harden[XNSTAT_MSW_BUCKETS];
+	unsigned long relax[XNSTAT_MSW_REASONS][XNSTAT_MSW_BUCKETS];
+} xnstat_modesw_t;
+
+/* Bucket #n counts durations in [2^(n-1), 2^n) TSC ticks. */
+static inline int xnstat_modesw_bucket(unsigned long long delta)
+{
+	int bucket = delta >> 32 ? XNSTAT_MSW_BUCKETS - 1 : fls((u32)delta);
+
+	return bucket < XNSTAT_MSW_BUCKETS ? bucket : XNSTAT_MSW_BUCKETS - 1;
+}
+
+#endif /* CONFIG_XENO_OPT_STATS_MODESW */
+
 #else /* !CONFIG_XENO_OPT_STATS */
 typedef struct xnstat_exectime {
 #ifdef __XENO_SIM__
@@ -110,6 +144,8 @@ typedef struct xnstat_exectime {
 } xnstat_exectime_t;
 
 #define xnstat_exectime_now()					({ 0; })
+#define xnstat_sampling_p()					(0)
+#define xnstat_exectime_lazy_now()				({ 0; })
 #define xnstat_exectime_update(sched, date)			do { } while (0)
 #define xnstat_exectime_set_current(sched, new_account)		({ (void)sched; NULL; })
 #define xnstat_exectime_get_current(sched)			({ (void)sched; NULL; })
@@ -134,7 +170,8 @@ typedef struct xnstat_counter {
    new_account, and return the previous one. */
 #define xnstat_exectime_switch(sched, new_account) \
 ({ \
-	xnstat_exectime_update(sched, xnstat_exectime_now()); \
+	if (!xnstat_sampling_p()) \
+		xnstat_exectime_update(sched, xnstat_exectime_now()); \
 	xnstat_exectime_set_current(sched, new_account); \
 })
 
@@ -142,7 +179,8 @@ typedef struct xnstat_counter {
    to new_account, and return the previous one. */
 #define xnstat_exectime_lazy_switch(sched, new_account, date) \
 ({ \
-	xnstat_exectime_update(sched, date); \
+	if (!xnstat_sampling_p()) \
+		xnstat_exectime_update(sched, date); \
 	xnstat_exectime_set_current(sched, new_account); \
 })
 
@@ -0,0 +1,96 @@
+/*!\file statmap.h
+ * \brief Mappable thread statistics.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _XENO_NUCLEUS_STATMAP_H
+#define _XENO_NUCLEUS_STATMAP_H
+
+#include <nucleus/types.h>
+#include <nucleus/seqlock.h>
+
+#define XNSTATMAP_MAGIC	0x53544d50	/* "STMP" */
+
+/*
+ * The statistics area lives in a mapped heap which user-space may
+ * map via the sys_heap_info syscall (XNHEAP_SYS_STATMAP) and
+ * /dev/rtheap. The offset of the area descriptor within that heap is
+ * reported by /proc/xenomai/statmap. An array of nr_slots slots
+ * immediately follows the descriptor.
+ *
+ * Each thread is given a slot when created, which is refreshed when
+ * the thread is switched out and on every timer interrupt it is
+ * running through, so that the figures of a CPU-bound thread do not
+ * go stale. A slot is free when its serial number is zero; the
+ * serial number changes each time the slot is given to a new thread,
+ * so that readers may tell threads apart across samples. Readers
+ * must copy a slot within a read section of its sequence counter.
+ */
+struct xnstatmap_slot {
+	xnseqcount_t seq;
+	unsigned int serial;
+	int pid;		/* Host PID of shadows, zero otherwise. */
+	unsigned int cpu;
+	unsigned long long exectime;	/* In TSC ticks. */
+	unsigned long long csw;	/* Context switches. */
+	unsigned long long ssw;	/* Primary -> secondary mode switches. */
+	unsigned long long pf;	/* Page faults. */
+	char name[XNOBJECT_NAME_LEN];
+};
+
+struct xnstatmap_area {
+	unsigned int magic;
+	unsigned int nr_slots;
+	unsigned long long tsc_freq;
+	struct xnstatmap_slot slots[0];
+};
+
+#ifdef __KERNEL__
+
+#ifdef CONFIG_XENO_OPT_STATS_MAP
+
+#include <nucleus/thread.h>
+
+void xnstatmap_attach(struct xnthread *thread);
+
+void xnstatmap_detach(struct xnthread *thread);
+
+void __xnstatmap_publish(struct xnthread *thread);
+
+static inline void xnstatmap_publish(struct xnthread *thread)
+{
+	if (thread->stat.map)
+		__xnstatmap_publish(thread);
+}
+
+struct xnheap *xnstatmap_heap(void);
+
+int xnstatmap_mount(void);
+
+void xnstatmap_umount(void);
+
+#else /* !CONFIG_XENO_OPT_STATS_MAP */
+
+#define xnstatmap_attach(thread)	do { } while (0)
+#define xnstatmap_detach(thread)	do { } while (0)
+#define xnstatmap_publish(thread)	do { } while (0)
+
+#endif /* !CONFIG_XENO_OPT_STATS_MAP */
+
+#endif /* __KERNEL__ */
+
+#endif /* !_XENO_NUCLEUS_STATMAP_H */
@@ -31,6 +31,8 @@
 #define XNSYNCH_PIP     0x2
 #define XNSYNCH_DREORD  0x4
 #define XNSYNCH_OWNER   0x8
+#define XNSYNCH_SPIN    0x20
+#define XNSYNCH_PP      0x40
 
 #ifndef CONFIG_XENO_OPT_DEBUG_SYNCH_RELAX
 #define CONFIG_XENO_OPT_DEBUG_SYNCH_RELAX 0
@@ -68,6 +70,70 @@ static inline int xnsynch_fast_release(xnarch_atomic_t *fastlock,
 		cur_ownerh);
 }
 
+/*
+ * Fast lock API for priority-protected objects (XNSYNCH_PP). Their
+ * lock word is followed by a second one, holding the handle the
+ * owner should publish in the pp_pending field of its state window,
+ * for the nucleus to apply the ceiling only if the owner happens to
+ * be switched out while holding the lock. When set, this handle
+ * also tells that the ceiling is pending, i.e. not applied yet, in
+ * which case the owner may drop the lock without entering the
+ * nucleus. Since a thread may have a single ceiling pending, nested
+ * locks, as well as objects the nucleus could not give any handle
+ * to (XN_NO_HANDLE), go through the nucleus, which
+ * xnsynch_fast_pp_acquire() tells by returning -ENOSYS.
+ */
+#define XNSYNCH_FASTPP_SIZE		(2 * sizeof(xnarch_atomic_t))
+#define xnsynch_fast_pp_handle(fastlock) \
+	((xnhandle_t)xnarch_atomic_get((fastlock) + 1))
+
+static inline int xnsynch_fast_pp_acquire(xnarch_atomic_t *fastlock,
+					  xnhandle_t new_ownerh,
+					  xnhandle_t *pp_pending)
+{
+	xnhandle_t pph = xnsynch_fast_pp_handle(fastlock);
+	int err;
+
+	if (xnhandle_mask_spare(xnarch_atomic_get(fastlock)) == new_ownerh)
+		return -EBUSY;
+
+	if (pph == XN_NO_HANDLE || *pp_pending != XN_NO_HANDLE)
+		return -ENOSYS;
+
+	/*
+	 * Publish the ceiling before grabbing the lock, the nucleus
+	 * only applies it once it sees us owning the lock.
+	 */
+	*pp_pending = pph;
+	err = xnsynch_fast_acquire(fastlock, new_ownerh);
+	if (err)
+		*pp_pending = XN_NO_HANDLE;
+
+	return err;
+}
+
+static inline int xnsynch_fast_pp_release(xnarch_atomic_t *fastlock,
+					  xnhandle_t cur_ownerh,
+					  xnhandle_t *pp_pending)
+{
+	xnhandle_t pph = xnsynch_fast_pp_handle(fastlock);
+
+	/*
+	 * Once applied, the ceiling must be dropped by the nucleus,
+	 * which also raises the claim bit so that the lockless
+	 * release below fails, should we race with it.
+	 */
+	if (pph == XN_NO_HANDLE || *pp_pending != pph)
+		return 0;
+
+	if (!xnsynch_fast_release(fastlock, cur_ownerh))
+		return 0;
+
+	*pp_pending = XN_NO_HANDLE;
+
+	return 1;
+}
+
 #else /* !CONFIG_XENO_FASTSYNCH */
 
 static inline int xnsynch_fast_acquire(xnarch_atomic_t *fastlock,
@@ -84,9 +150,120 @@ static inline int xnsynch_fast_release(xnarch_atomic_t *fastlock,
 
 #endif	/* !CONFIG_XENO_FASTSYNCH */
 
+#if defined(__KERNEL__) || defined(__XENO_SIM__) || defined(CONFIG_XENO_FASTSYNCH)
+
+/*
+ * Fast counter API, for semaphores. The counter word holds the
+ * semaphore value, and a flag telling whether some thread may be
+ * sleeping on the semaphore, in which case posting it must go
+ * through the nucleus. The waiter flag is only raised and cleared
+ * by the nucleus under nklock, and the value is never positive
+ * while the flag is raised; user-space may change the value
+ * concurrently as long as the flag is clear.
+ */
+#define XNSYNCH_FCNT_WAITERS  0x80000000UL
+#define XNSYNCH_FCNT_MASK     0x7fffffffUL
+
+static inline unsigned long xnsynch_fast_count_get(xnarch_atomic_t *fastcnt)
+{
+	return (unsigned long)xnarch_atomic_get(fastcnt) & XNSYNCH_FCNT_MASK;
+}
+
+/* Take a unit, or return -EAGAIN if none is available. */
+static inline int xnsynch_fast_count_down(xnarch_atomic_t *fastcnt)
+{
+	unsigned long cur, old;
+
+	cur = xnarch_atomic_get(fastcnt);
+	for (;;) {
+		if ((cur & XNSYNCH_FCNT_MASK) == 0)
+			return -EAGAIN;
+		old = xnarch_atomic_cmpxchg(fastcnt, cur, cur - 1);
+		if (old == cur)
+			return 0;
+		cur = old;
+	}
+}
+
+/*
+ * Give a unit back, or return -EBUSY if waiters have to be woken up
+ * by the nucleus instead, or -EOVERFLOW if the value would exceed
+ * @a max.
+ */
+static inline int xnsynch_fast_count_up(xnarch_atomic_t *fastcnt,
+					unsigned long max)
+{
+	unsigned long cur, old;
+
+	cur = xnarch_atomic_get(fastcnt);
+	for (;;) {
+		if (cur & XNSYNCH_FCNT_WAITERS)
+			return -EBUSY;
+		if (cur >= max)
+			return -EOVERFLOW;
+		old = xnarch_atomic_cmpxchg(fastcnt, cur, cur + 1);
+		if (old == cur)
+			return 0;
+		cur = old;
+	}
+}
+
+/*
+ * Fast barrier API. The barrier word holds the number of threads
+ * which arrived in the current cycle, the cycle number, and a flag
+ * telling whether some of them sleep in the nucleus. Arrivals are
+ * counted from user-space; the last one starts the next cycle, and
+ * only has to enter the nucleus if the flag was raised.
+ */
+#define XNSYNCH_FBAR_WAITERS  0x1UL
+#define XNSYNCH_FBAR_SHIFT    1
+#define XNSYNCH_FBAR_MASK     0xfffeUL
+#define XNSYNCH_FBAR_MAX      (XNSYNCH_FBAR_MASK >> XNSYNCH_FBAR_SHIFT)
+#define XNSYNCH_FBAR_CYCLE    0x10000UL
+
+#define xnsynch_fast_barrier_cycle(v) \
+	((v) & ~(XNSYNCH_FBAR_MASK | XNSYNCH_FBAR_WAITERS))
+
+/*
+ * Arrive at the barrier, returning the current cycle in @a cyclep.
+ * Returns -EAGAIN if the caller has to wait for the cycle to
+ * complete, 0 if it completed the cycle, or -EBUSY if it did and
+ * the sleepers have to be released by the nucleus.
+ */
+static inline int xnsynch_fast_barrier_arrive(xnarch_atomic_t *fastbar,
+					      unsigned long count,
+					      unsigned long *cyclep)
+{
+	unsigned long cur, old, new, arrived;
+
+	cur = xnarch_atomic_get(fastbar);
+	for (;;) {
+		arrived = ((cur & XNSYNCH_FBAR_MASK) >> XNSYNCH_FBAR_SHIFT) + 1;
+		if (arrived >= count)
+			new = xnsynch_fast_barrier_cycle(cur) + XNSYNCH_FBAR_CYCLE;
+		else
+			new = (cur & ~XNSYNCH_FBAR_MASK) |
+				(arrived << XNSYNCH_FBAR_SHIFT);
+		old = xnarch_atomic_cmpxchg(fastbar, cur, new);
+		if (old == cur)
+			break;
+		cur = old;
+	}
+
+	*cyclep = xnsynch_fast_barrier_cycle(cur);
+
+	if (arrived < count)
+		return -EAGAIN;
+
+	return (cur & XNSYNCH_FBAR_WAITERS) ? -EBUSY : 0;
+}
+
+#endif /* __KERNEL__ || __XENO_SIM__ || CONFIG_XENO_FASTSYNCH */
+
 #if defined(__KERNEL__) || defined(__XENO_SIM__)
 
 #define XNSYNCH_CLAIMED 0x10	/* Claimed by other thread(s) w/ PIP */
+#define XNSYNCH_CEILING 0x80	/* Ceiling applied to the owner w/ PP */
 
 #define XNSYNCH_FLCLAIM XN_HANDLE_SPARE3 /* Corresponding bit in fast lock */
 
@@ -127,6 +304,16 @@ typedef struct xnsynch {
 
     void (*cleanup)(struct xnsynch *synch); /* Cleanup handler */
 
+    int ceiling;	/* Priority ceiling (XNSYNCH_PP) */
+
+#if defined(CONFIG_XENO_OPT_PERVASIVE) && defined(CONFIG_XENO_FASTSYNCH)
+    xnhandle_t pph;	/* Handle user-space publishes for lazy ceiling */
+#endif /* CONFIG_XENO_OPT_PERVASIVE && CONFIG_XENO_FASTSYNCH */
+
+#ifdef CONFIG_SMP
+    xnticks_t spin_budget; /* Adaptive spin budget (TSC ticks) */
+#endif /* CONFIG_SMP */
+
     XNARCH_DECL_DISPLAY_CONTEXT();
 
 } xnsynch_t;
@@ -157,6 +344,89 @@ typedef struct xnsynch {
 	(((fastlock) & ~XNSYNCH_FLCLAIM) | ((enable) ? XNSYNCH_FLCLAIM : 0))
 #define xnsynch_fast_mask_claimed(fastlock) ((fastlock) & ~XNSYNCH_FLCLAIM)
 
+/*
+ * Nucleus side of the fast counter API, all called with nklock
+ * held. xnsynch_fast_count_wait() takes a unit, or raises the
+ * waiter flag and returns -EAGAIN, in which case the caller should
+ * sleep on the semaphore. xnsynch_fast_count_post() gives a unit
+ * back when nobody sleeps on the semaphore, and
+ * xnsynch_fast_count_settle() drops a stale waiter flag once the
+ * last sleeper is gone.
+ */
+static inline int xnsynch_fast_count_wait(xnarch_atomic_t *fastcnt)
+{
+	unsigned long cur, old, new;
+
+	cur = xnarch_atomic_get(fastcnt);
+	for (;;) {
+		if (cur & XNSYNCH_FCNT_MASK)
+			new = cur - 1;
+		else if (cur & XNSYNCH_FCNT_WAITERS)
+			return -EAGAIN;
+		else
+			new = cur | XNSYNCH_FCNT_WAITERS;
+		old = xnarch_atomic_cmpxchg(fastcnt, cur, new);
+		if (old == cur)
+			return (new & XNSYNCH_FCNT_WAITERS) ? -EAGAIN : 0;
+		cur = old;
+	}
+}
+
+static inline int xnsynch_fast_count_post(xnarch_atomic_t *fastcnt,
+					  unsigned long max)
+{
+	unsigned long cur, old;
+
+	cur = xnarch_atomic_get(fastcnt);
+	for (;;) {
+		if ((cur & XNSYNCH_FCNT_MASK) >= max)
+			return -EOVERFLOW;
+		old = xnarch_atomic_cmpxchg(fastcnt, cur,
+					    (cur & XNSYNCH_FCNT_MASK) + 1);
+		if (old == cur)
+			return 0;
+		cur = old;
+	}
+}
+
+static inline void xnsynch_fast_count_settle(xnarch_atomic_t *fastcnt)
+{
+	unsigned long cur, old;
+
+	cur = xnarch_atomic_get(fastcnt);
+	while (cur & XNSYNCH_FCNT_WAITERS) {
+		old = xnarch_atomic_cmpxchg(fastcnt, cur,
+					    cur & ~XNSYNCH_FCNT_WAITERS);
+		if (old == cur)
+			break;
+		cur = old;
+	}
+}
+
+/*
+ * Called with nklock held by a thread which arrived at the barrier
+ * during @a cycle: raise the waiter flag and return -EAGAIN if the
+ * caller should sleep, or return 0 if the cycle is over.
+ */
+static inline int xnsynch_fast_barrier_wait(xnarch_atomic_t *fastbar,
+					    unsigned long cycle)
+{
+	unsigned long cur, old;
+
+	cur = xnarch_atomic_get(fastbar);
+	for (;;) {
+		if (xnsynch_fast_barrier_cycle(cur) != cycle)
+			return 0;
+		if (cur & XNSYNCH_FBAR_WAITERS)
+			return -EAGAIN;
+		old = xnarch_atomic_cmpxchg(fastbar, cur,
+					    cur | XNSYNCH_FBAR_WAITERS);
+		if (old == cur)
+			return -EAGAIN;
+		cur = old;
+	}
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -186,12 +456,31 @@ void xnsynch_init(struct xnsynch *synch, xnflags_t flags,
 
 #define xnsynch_destroy(synch)	xnsynch_flush(synch, XNRMID)
 
+#ifdef CONFIG_SMP
+void xnsynch_set_spin_budget(struct xnsynch *synch, xnticks_t ns);
+#else /* !CONFIG_SMP */
+static inline void xnsynch_set_spin_budget(struct xnsynch *synch,
+					   xnticks_t ns)
+{
+}
+#endif /* !CONFIG_SMP */
+
 static inline void xnsynch_set_owner(struct xnsynch *synch,
 				     struct xnthread *thread)
 {
 	synch->owner = thread;
 }
 
+/*
+ * The ceiling of a priority-protected object is a priority level of
+ * the RT scheduling class. It should not be changed while the
+ * object is owned.
+ */
+static inline void xnsynch_set_ceiling(struct xnsynch *synch, int prio)
+{
+	synch->ceiling = prio;
+}
+
 static inline void xnsynch_register_cleanup(struct xnsynch *synch,
 					    void (*handler)(struct xnsynch *))
 {
@@ -211,6 +500,8 @@ xnflags_t xnsynch_acquire(struct xnsynch *synch,
 			  xnticks_t timeout,
 			  xntmode_t timeout_mode);
 
+void xnsynch_protect_owner(struct xnsynch *synch);
+
 struct xnthread *xnsynch_release(struct xnsynch *synch);
 
 struct xnthread *xnsynch_peek_pendq(struct xnsynch *synch);
@@ -223,6 +514,32 @@ void xnsynch_requeue_sleeper(struct xnthread *thread);
 
 void xnsynch_forget_sleeper(struct xnthread *thread);
 
+int xnsynch_requeue_sleepers(struct xnsynch *from, struct xnsynch *to,
+			     int nr);
+
+int xnsynch_accept_handoff(struct xnsynch *synch);
+
+#if defined(CONFIG_XENO_OPT_PERVASIVE) && defined(CONFIG_XENO_FASTSYNCH)
+
+int xnsynch_mount(void);
+
+void xnsynch_umount(void);
+
+void xnsynch_commit_ceiling(struct xnthread *curr);
+
+#else /* !(CONFIG_XENO_OPT_PERVASIVE && CONFIG_XENO_FASTSYNCH) */
+
+static inline int xnsynch_mount(void)
+{
+	return 0;
+}
+
+static inline void xnsynch_umount(void)
+{
+}
+
+#endif /* !(CONFIG_XENO_OPT_PERVASIVE && CONFIG_XENO_FASTSYNCH) */
+
 #ifdef __cplusplus
 }
 #endif
@@ -7,6 +7,9 @@
 struct xnsys_ppd {
 	xnshadow_ppd_t ppd;
 	xnheap_t sem_heap;
+#if CONFIG_XENO_OPT_MALLOC_HEAPSZ > 0
+	xnheap_t *malloc_heap;
+#endif
 #ifdef XNARCH_HAVE_MAYDAY
 	unsigned long mayday_addr;
 #endif
@@ -23,6 +23,7 @@
 #define _XENO_NUCLEUS_THREAD_H
 
 #include <nucleus/types.h>
+#include <nucleus/seqlock.h>
 
 /*! @ingroup nucleus
   @defgroup nucleus_state_flags Thread state flags.
@@ -63,6 +64,9 @@
 #define XNSHADOW  0x00200000 /**< Shadow thread */
 #define XNROOT    0x00400000 /**< Root thread (that is, Linux/IDLE) */
 #define XNOTHER   0x00800000 /**< Non real-time shadow (prio=0) */
+#define XNBALANCE 0x01000000 /**< Subject to CPU load balancing */
+#define XNFPUEAGER 0x02000000 /**< Eager FPU context switching */
+#define XNPREREL  0x04000000 /**< Pre-released periodic wakeups */
 
 /*! @} */ /* Ends doxygen comment group: nucleus_state_flags */
 
@@ -84,11 +88,14 @@
   't' -> Mode switches trapped.
   'o' -> Priority coupling off.
   'f' -> FPU enabled (for kernel threads).
+  'B' -> Subject to CPU load balancing.
+  'e' -> Eager FPU context switching.
+  'p' -> Pre-released periodic wakeups.
 */
-#define XNTHREAD_STATE_LABELS  "SWDRU....X.HbTlr..tof.."
+#define XNTHREAD_STATE_LABELS  "SWDRU....X.HbTlr..tof...Bep"
 
 #define XNTHREAD_BLOCK_BITS   (XNSUSP|XNPEND|XNDELAY|XNDORMANT|XNRELAX|XNMIGRATE|XNHELD)
-#define XNTHREAD_MODE_BITS    (XNLOCK|XNRRB|XNASDI|XNTRAPSW|XNRPIOFF)
+#define XNTHREAD_MODE_BITS    (XNLOCK|XNRRB|XNASDI|XNTRAPSW|XNRPIOFF|XNBALANCE|XNFPUEAGER|XNPREREL)
 
 /* These state flags are available to the real-time interfaces */
 #define XNTHREAD_STATE_SPARE0  0x10000000
@@ -118,6 +125,7 @@
 #define XNCANPND  0x00000400 /**< Cancellation request is pending */
 #define XNAMOK    0x00000800 /**< Runaway, watchdog signal pending (shadow only) */
 #define XNSWREP   0x00001000 /**< Mode switch already reported */
+#define XNDIRECT  0x00002000 /**< Switching to primary mode without the gatekeeper */
 
 /* These information flags are available to the real-time interfaces */
 #define XNTHREAD_INFO_SPARE0  0x10000000
@@ -153,12 +161,61 @@ typedef struct xnthread_info {
 
 } xnthread_info_t;
 
+/*!
+  @brief Thread state window shared with user-space.
+
+  Each shadow thread owns such window in the private semaphore heap
+  of its process, which the nucleus refreshes on context switches,
+  clock ticks, priority changes and periodic releases, so that the
+  thread may inquire about its own state without issuing any
+  syscall. The state word mirrors the thread mode variable and may
+  be read directly; the other figures must be copied within a read
+  section of the sequence counter.
+
+  The scheduler lock count is owned by user-space, which may bump it
+  to prevent the thread from being preempted while running in
+  primary mode. The nucleus raises the pending flag when it had to
+  defer a rescheduling because of it, in which case user-space
+  should issue the __xn_sys_sched_unlock syscall once the count
+  drops back to zero.
+*/
+struct xnthread_user_window {
+
+	unsigned long state; /**< Thread state; must remain first. */
+
+	xnhandle_t handle; /**< Registry handle, set before user-space reads it. */
+
+	xnhandle_t pp_pending; /**< Priority ceiling the nucleus should apply lazily. */
+
+	unsigned long schedlck; /**< Scheduler lock count, updated by user-space. */
+
+	unsigned long schedpend; /**< Rescheduling deferred by schedlck. */
+
+	xnseqcount_t seq; /**< Guards the fields below. */
+
+	int bprio;  /**< Base priority. */
+	int cprio; /**< Current priority. */
+	int cpu; /**< CPU the thread last ran on. */
+
+	unsigned long overruns; /**< Periodic overruns, accumulated. */
+	unsigned long modeswitches; /**< Number of primary->secondary mode switches. */
+	unsigned long ctxswitches; /**< Number of context switches. */
+	unsigned long pagefaults; /**< Number of triggered page faults. */
+
+	unsigned long long relpoint; /**< Time of next release. */
+	unsigned long long exectime; /**< Primary mode execution time (TSC), until switchdate. */
+	unsigned long long switchdate; /**< TSC date the thread was last switched in. */
+
+	char name[XNOBJECT_NAME_LEN];  /**< Symbolic name of the thread. */
+};
+
 #if defined(__KERNEL__) || defined(__XENO_SIM__)
 
 #include <nucleus/stat.h>
 #include <nucleus/timer.h>
 #include <nucleus/registry.h>
 #include <nucleus/schedparam.h>
+#include <nucleus/shadow.h>
 
 #ifdef __XENO_SIM__
 /* Pseudo-status (must not conflict with other bits) */
@@ -176,6 +233,7 @@ struct xnsched_class;
 struct xnsched_tpslot;
 union xnsched_policy_param;
 struct xnbufd;
+struct xnstatmap_slot;
 
 struct xnthread_operations {
 	int (*get_denormalized_prio)(struct xnthread *, int coreprio);
@@ -208,7 +266,15 @@ typedef struct xnthread {
 
 	xnarchtcb_t tcb;		/* Architecture-dependent block -- Must be first */
 
-	xnflags_t state;		/* Thread state flags */
+	/*
+	 * The fields up to signals are those the rescheduling
+	 * procedure and the suspend/resume paths touch for most
+	 * threads. Keep them together, so that they span no more than
+	 * two cache lines; xnsched_init() checks this at build time.
+	 * The group starts on a cache line, whatever the size of the
+	 * arch TCB, so that it may not straddle a third one.
+	 */
+	xnflags_t state ____cacheline_aligned_in_smp; /* Thread state flags */
 
 	xnflags_t info;			/* Thread information flags */
 
@@ -218,18 +284,6 @@ typedef struct xnthread {
 
 	struct xnsched_class *base_class; /* Base scheduling class */
 
-#ifdef CONFIG_XENO_OPT_SCHED_TP
-	struct xnsched_tpslot *tps;	/* Current partition slot for TP scheduling */
-	struct xnholder tp_link;	/* Link in per-sched TP thread queue */
-#endif
-#ifdef CONFIG_XENO_OPT_SCHED_SPORADIC
-	struct xnsched_sporadic_data *pss; /* Sporadic scheduling data. */
-#endif
-
-	unsigned idtag;			/* Unique ID tag */
-
-	xnarch_cpumask_t affinity;	/* Processor affinity. */
-
 	int bprio;			/* Base priority (before PIP boost) */
 
 	int cprio;			/* Current priority */
@@ -240,33 +294,27 @@ typedef struct xnthread {
 
 	xnpholder_t plink;		/* Thread holder in synchronization queue(s) */
 
-#ifdef CONFIG_XENO_OPT_PRIOCPL
-	xnpholder_t xlink;		/* Thread holder in the RPI queue (shadow only) */
-
-	struct xnsched *rpi;		/* Backlink pointer to the RPI slot (shadow only) */
-#endif /* CONFIG_XENO_OPT_PRIOCPL */
-
-	xnholder_t glink;		/* Thread holder in global queue */
-
 #define link2thread(ln, fld)	container_of(ln, struct xnthread, fld)
 
-	xnpqueue_t claimq;		/* Owned resources claimed by others (PIP) */
-
 	struct xnsynch *wchan;		/* Resource the thread pends on */
 
 	struct xnsynch *wwake;		/* Wait channel the thread was resumed from */
 
-	int hrescnt;			/* Held resources count */
+	xnsigmask_t signals;		/* Pending core signals */
 
-	xntimer_t rtimer;		/* Resource timer */
+	/* Timed waits and resource ownership. */
 
-	xntimer_t ptimer;		/* Periodic timer */
+	int hrescnt;			/* Held resources count */
 
-	xnsigmask_t signals;		/* Pending core signals */
+	xnpqueue_t claimq;		/* Owned resources claimed by others (PIP) */
 
-	xnticks_t rrperiod;		/* Allotted round-robin period (ticks) */
+	xntimer_t rtimer;		/* Resource timer */
 
-	xnticks_t rrcredit;		/* Remaining round-robin time credit (ticks) */
+#ifdef CONFIG_XENO_OPT_TIMER_LAZY
+	xnticks_t rtdate;		/* Deadline rtimer is late on (ns), XN_INFINITE if exact */
+
+	int rtstale;			/* rtimer outlived the timed wait */
+#endif /* CONFIG_XENO_OPT_TIMER_LAZY */
 
 	union {
 		struct {
@@ -285,18 +333,112 @@ typedef struct xnthread {
 	/* Active wait context - Obsoletes wait_u. */
 	struct xnthread_wait_context *wcontext;
 
+	/* Policy-specific data. */
+
+	xnticks_t rrperiod;		/* Allotted round-robin period (ticks) */
+
+	xnticks_t rrcredit;		/* Remaining round-robin time credit (ticks) */
+
+	xnticks_t rrbudget;		/* Remaining round-robin budget (ns), 0 for a full slice */
+
+#ifdef CONFIG_XENO_OPT_TIMING_TICKLESS
+	int rrtracked;			/* Counted as round-robin by its periodic time base */
+#endif /* CONFIG_XENO_OPT_TIMING_TICKLESS */
+
+#ifdef CONFIG_XENO_OPT_SCHED_TP
+	struct xnsched_tpslot *tps;	/* Current partition slot for TP scheduling */
+	struct xnholder tp_link;	/* Link in per-sched TP thread queue */
+#endif
+#ifdef CONFIG_XENO_OPT_SCHED_SPORADIC
+	struct xnsched_sporadic_data *pss; /* Sporadic scheduling data. */
+#endif
+#ifdef CONFIG_XENO_OPT_SCHED_EDF
+	struct xnsched_edf_data *pedf;	/* EDF scheduling data. */
+	xnticks_t edf_deadline;		/* Current, possibly inherited, EDF deadline */
+#endif
+
+#ifdef CONFIG_XENO_OPT_PRIOCPL
+	xnpholder_t xlink;		/* Thread holder in the RPI queue (shadow only) */
+
+	struct xnsched *rpi;		/* Backlink pointer to the RPI slot (shadow only) */
+#endif /* CONFIG_XENO_OPT_PRIOCPL */
+
+	/* Fields below are seldom touched on the hot paths. */
+
+	xntimer_t ptimer;		/* Periodic timer */
+
+	xnticks_t prerelease;		/* Periodic timer advance (raw ticks) */
+
+	unsigned idtag;			/* Unique ID tag */
+
+	xnarch_cpumask_t affinity;	/* Processor affinity. */
+
+#ifdef CONFIG_XENO_OPT_SCHED_BALANCE
+	xnarch_cpumask_t lb_affinity;	/* CPUs the load balancer may pick */
+
+	xnticks_t lb_lastexec;		/* Execution time at last balancing pass */
+
+	xnticks_t lb_load;		/* Execution time over last balancing period */
+#endif /* CONFIG_XENO_OPT_SCHED_BALANCE */
+
+	xnholder_t glink;		/* Thread holder in global queue */
+
 	struct {
 		xnstat_counter_t ssw;	/* Primary -> secondary mode switch count */
 		xnstat_counter_t csw;	/* Context switches (includes secondary -> primary switches) */
 		xnstat_counter_t pf;	/* Number of page faults */
 		xnstat_exectime_t account; /* Execution time accounting entity */
 		xnstat_exectime_t lastperiod; /* Interval marker for execution time reports */
+#ifdef CONFIG_XENO_OPT_STATS_SYSCALL
+		unsigned long syscalls;	/* Number of syscalls issued */
+		xnticks_t systime;	/* Time spent in syscalls (TSC) */
+#endif /* CONFIG_XENO_OPT_STATS_SYSCALL */
+#ifdef CONFIG_XENO_OPT_STATS_SYNCH
+		unsigned long acquires;	/* Calls to xnsynch_acquire() */
+		unsigned long sleeps;	/* Calls to xnsynch_sleep_on() */
+		unsigned long boosts;	/* Priority raises due to PI */
+		unsigned long chain_max; /* Longest PI chain walked */
+		xnticks_t chain_time;	/* Longest PI chain walk (TSC) */
+#endif /* CONFIG_XENO_OPT_STATS_SYNCH */
+#ifdef CONFIG_XENO_OPT_STATS_MODESW
+		xnstat_modesw_t msw;	/* Mode switch latency histograms */
+#endif /* CONFIG_XENO_OPT_STATS_MODESW */
+#ifdef CONFIG_XENO_OPT_STATS_MAP
+		struct xnstatmap_slot *map; /* Mirror in the mappable area */
+#endif /* CONFIG_XENO_OPT_STATS_MAP */
 	} stat;
 
+#ifdef CONFIG_XENO_OPT_PROFILE
+	unsigned long u_stkend;		/* End of the locked user stack area */
+#endif /* CONFIG_XENO_OPT_PROFILE */
+
+#ifdef CONFIG_XENO_OPT_CACHE_PARTITION
+	int cacheclass;			/* Cache class, -1 for the CPU default */
+#endif /* CONFIG_XENO_OPT_CACHE_PARTITION */
+
+#ifdef CONFIG_XENO_OPT_SCHED_BUDGET
+	struct xnbudget {
+		xnticks_t quota;	/* CPU time allowed per period (ns), 0 for none */
+		xnticks_t period;	/* Replenishment period (ns) */
+		xnticks_t left;		/* Time left in the current period (ns) */
+		int action;		/* Action upon overrun (XNBUDGET_*) */
+		int demote_prio;	/* Priority to demote to */
+		int saved_prio;		/* Base priority to restore, -1 if not demoted */
+		int held;		/* Held until replenished */
+		unsigned long overruns;	/* Periods the quota was overrun in */
+		xntimer_t rtimer;	/* Replenishment timer */
+	} budget;
+#endif /* CONFIG_XENO_OPT_SCHED_BUDGET */
+
 #ifdef CONFIG_XENO_OPT_SELECT
 	struct xnselector *selector;    /* For select. */
+	struct xnselector *eselector;   /* Persistent interest set. */
 #endif /* CONFIG_XENO_OPT_SELECT */
 
+#ifdef CONFIG_SMP
+	struct xnintr *bound_intrs;	/* Interrupts following this thread */
+#endif /* CONFIG_SMP */
+
 	int errcode;			/* Local errno */
 
 	xnasr_t asr;			/* Asynchronous service routine */
@@ -330,6 +472,10 @@ typedef struct xnthread {
 
 #ifdef CONFIG_XENO_OPT_PERVASIVE
 	unsigned long *u_mode;	/* Thread mode variable shared with userland. */
+	struct xnthread_user_window *u_window; /* State window, u_mode is its first word. */
+	/* Per-process data of the process, by skin (see xnshadow_ppd_get). */
+	struct mm_struct *ppd_mm;
+	struct xnshadow_ppd_t *ppd_cache[XENOMAI_MUX_NR];
 #endif /* CONFIG_XENO_OPT_PERVASIVE */
 
     XNARCH_DECL_DISPLAY_CONTEXT();
@@ -340,10 +486,17 @@ typedef struct xnthread {
 #define XNHOOK_THREAD_SWITCH 2
 #define XNHOOK_THREAD_DELETE 3
 
+#define XNHOOK_BIT(type)     (1 << (type))
+
 typedef struct xnhook {
 	xnholder_t link;
 #define link2hook(ln)		container_of(ln, xnhook_t, link)
 	void (*routine)(struct xnthread *thread);
+#ifdef CONFIG_XENO_OPT_STATS
+	unsigned long calls;	/* Number of invocations */
+	xnticks_t exectime;	/* Cumulated execution time (raw ticks) */
+	xnticks_t maxtime;	/* Longest execution time (raw ticks) */
+#endif /* CONFIG_XENO_OPT_STATS */
 } xnhook_t;
 
 #define xnthread_name(thread)               ((thread)->name)
@@ -369,7 +522,8 @@ typedef struct xnhook {
 #define xnthread_archtcb(thread)           (&((thread)->tcb))
 #define xnthread_asr_level(thread)         ((thread)->asrlevel)
 #define xnthread_pending_signals(thread)  ((thread)->signals)
-#define xnthread_timeout(thread)           xntimer_get_timeout(&(thread)->rtimer)
+#define xnthread_timeout(thread)	\
+    (xnthread_rtimer_running_p(thread) ? xnthread_rtimeout(thread) : XN_INFINITE)
 #define xnthread_stack_size(thread)        xnarch_stack_size(xnthread_archtcb(thread))
 #define xnthread_stack_base(thread)        xnarch_stack_base(xnthread_archtcb(thread))
 #define xnthread_stack_end(thread)         xnarch_stack_end(xnthread_archtcb(thread))
@@ -417,6 +571,33 @@ static inline unsigned xnthread_get_magic(struct xnthread *t)
 	return t->ops ? t->ops->get_magic() : 0;
 }
 
+#ifdef CONFIG_XENO_OPT_TIMER_LAZY
+
+/*
+ * A timed wait ending early leaves the resource timer queued, see
+ * xnthread_start_rtimer(). Such stale timer must be ignored by
+ * anyone looking for an outstanding timeout.
+ */
+#define xnthread_rtimer_running_p(thread) \
+    (xntimer_running_p(&(thread)->rtimer) && !(thread)->rtstale)
+
+#else /* !CONFIG_XENO_OPT_TIMER_LAZY */
+
+#define xnthread_rtimer_running_p(thread) xntimer_running_p(&(thread)->rtimer)
+
+static inline void xnthread_stop_rtimer(struct xnthread *thread)
+{
+	xntimer_stop(&thread->rtimer);
+}
+
+/* Time left until the deadline of the current or last timed wait. */
+static inline xnticks_t xnthread_rtimeout(struct xnthread *thread)
+{
+	return xntimer_get_timeout_stopped(&thread->rtimer);
+}
+
+#endif /* !CONFIG_XENO_OPT_TIMER_LAZY */
+
 static inline
 struct xnthread_wait_context *xnthread_get_wait_context(struct xnthread *thread)
 {
@@ -454,6 +635,17 @@ int *xnthread_get_errno_location(struct xnthread *thread);
 
 xnticks_t xnthread_get_timeout(struct xnthread *thread, xnticks_t tsc_ns);
 
+int xnthread_start_rtimer(struct xnthread *thread,
+			  xnticks_t timeout, xntmode_t timeout_mode);
+
+#ifdef CONFIG_XENO_OPT_TIMER_LAZY
+
+void xnthread_stop_rtimer(struct xnthread *thread);
+
+xnticks_t xnthread_rtimeout(struct xnthread *thread);
+
+#endif /* CONFIG_XENO_OPT_TIMER_LAZY */
+
 xnticks_t xnthread_get_period(struct xnthread *thread);
 
 void xnthread_prepare_wait(struct xnthread_wait_context *wc);
@@ -53,6 +53,7 @@ typedef struct xntbops {
 #define XNTBSET  0x00000002	/* Time set in time base. */
 #define XNTBLCK  0x00000004	/* Time base is locked. */
 #define XNTBISO  0x00000008	/* Time base uses private wallclock offset */
+#define XNTBIDLE 0x00000010	/* Periodic time base is not ticking. */
 
 typedef struct xntbase {
 
@@ -66,6 +67,8 @@ typedef struct xntbase {
 
 	u_long tickvalue;	/*!< Tick duration (ns, 1 if aperiodic). */
 
+	xnarch_conv_t tickconv;	/*!< Precomputed ns to ticks divisor. */
+
 	u_long ticks2sec;	/*!< Number of ticks per second. */
 
 	u_long status;		/*!< Status information. */
@@ -108,9 +111,18 @@ static inline xnticks_t xntbase_get_wallclock_offset(xntbase_t *base)
 	return base->wallclock_offset;
 }
 
+#ifdef CONFIG_XENO_OPT_TIMING_TICKLESS
+void xntbase_wakeup(xntbase_t *base);
+#endif /* CONFIG_XENO_OPT_TIMING_TICKLESS */
+
 static inline void xntbase_set_hook(xntbase_t *base, void (*hook)(void))
 {
 	base->hook = hook;
+#ifdef CONFIG_XENO_OPT_TIMING_TICKLESS
+	/* The hook wants every tick. */
+	if (testbits(base->status, XNTBIDLE))
+		xntbase_wakeup(base);
+#endif /* CONFIG_XENO_OPT_TIMING_TICKLESS */
 }
 
 static inline int xntbase_timeset_p(xntbase_t *base)
@@ -141,14 +153,17 @@ static inline xntime_t xntbase_ticks2ns(xntbase_t *base, xnticks_t ticks)
 	return ticks * xntbase_get_tickval(base);
 }
 
-static inline xnticks_t xntbase_ns2ticks(xntbase_t *base, xntime_t t)
+static inline int xntbase_master_p(xntbase_t *base)
 {
-	return xnarch_ulldiv(t, xntbase_get_tickval(base), NULL);
+	return base == &nktbase;
 }
 
-static inline int xntbase_master_p(xntbase_t *base)
+static inline xnticks_t xntbase_ns2ticks(xntbase_t *base, xntime_t t)
 {
-	return base == &nktbase;
+	if (xntbase_master_p(base))
+		return t;
+
+	return xnarch_conv_divrem(&base->tickconv, t, NULL);
 }
 
 static inline int xntbase_periodic_p(xntbase_t *base)
@@ -156,14 +171,41 @@ static inline int xntbase_periodic_p(xntbase_t *base)
 	return !xntbase_master_p(base);
 }
 
+#ifdef CONFIG_XENO_OPT_TIMING_TICKLESS
+
+xnticks_t xntbase_catch_up(xntbase_t *base);
+
+static inline xnticks_t xntbase_read_jiffies(xntbase_t *base)
+{
+	/*
+	 * An idle periodic time base stops ticking; the elapsed
+	 * ticks are accounted for lazily, when the clock is read.
+	 */
+	if (unlikely(testbits(base->status, XNTBIDLE)))
+		return xntbase_catch_up(base);
+
+	return base->jiffies;
+}
+
+#else /* !CONFIG_XENO_OPT_TIMING_TICKLESS */
+
+static inline xnticks_t xntbase_read_jiffies(xntbase_t *base)
+{
+	return base->jiffies;
+}
+
+#endif /* !CONFIG_XENO_OPT_TIMING_TICKLESS */
+
 static inline xnticks_t xntbase_get_jiffies(xntbase_t *base)
 {
-	return xntbase_periodic_p(base) ? base->jiffies : xnarch_get_cpu_time();
+	return xntbase_periodic_p(base) ?
+		xntbase_read_jiffies(base) : xnarch_get_cpu_time();
 }
 
 static inline xnticks_t xntbase_get_rawclock(xntbase_t *base)
 {
-	return xntbase_periodic_p(base) ? base->jiffies : xnarch_get_cpu_tsc();
+	return xntbase_periodic_p(base) ?
+		xntbase_read_jiffies(base) : xnarch_get_cpu_tsc();
 }
 
 int xntbase_alloc(const char *name,
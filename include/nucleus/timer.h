@@ -42,6 +42,10 @@
 #define XNTIMER_REALTIME  0x00000008
 #define XNTIMER_FIRED     0x00000010
 #define XNTIMER_NOBLCK	  0x00000020
+#define XNTIMER_KGRAVITY  0x00000040	/* Wakes up a kernel thread */
+#define XNTIMER_UGRAVITY  0x00000080	/* Wakes up a user-space thread */
+
+#define XNTIMER_GRAVITY_MASK  (XNTIMER_KGRAVITY|XNTIMER_UGRAVITY)
 
 /* These flags are available to the real-time interfaces */
 #define XNTIMER_SPARE0  0x01000000
@@ -245,6 +249,261 @@ xntimerq_it_next(xntimerq_t *q, xntimerq_it_t *it, xntimerh_t *holder)
 	return next;
 }
 
+#elif defined(CONFIG_XENO_OPT_TIMER_HWHEEL)
+
+/*
+ * Hierarchical timer wheel. Level 0 slots span 2 ** date_shift CPU
+ * ticks each and are kept sorted, so that the earliest timer is
+ * always found at the head of the first busy slot of level 0 once
+ * the upper levels have been cascaded. Upper level slots are plain
+ * unsorted queues, each of them spanning a full turn of the level
+ * below. Timers which are too far in the future for the wheel go to
+ * a sorted overflow queue.
+ */
+
+#define XNTIMER_HWHEEL_BITS   5
+#define XNTIMER_HWHEEL_SLOTS  (1 << XNTIMER_HWHEEL_BITS)
+#define XNTIMER_HWHEEL_MASK   (XNTIMER_HWHEEL_SLOTS - 1)
+#define XNTIMER_HWHEEL_LEVELS CONFIG_XENO_OPT_TIMER_HWHEEL_LEVELS
+#define XNTIMER_HWHEEL_RANGE  (1ULL << (XNTIMER_HWHEEL_BITS * XNTIMER_HWHEEL_LEVELS))
+
+typedef struct xntimerh {
+	xntlholder_t tlink;
+	xnqueue_t *slot;	/* Queue the timer is linked to. */
+	int level;		/* Wheel level, XNTIMER_HWHEEL_LEVELS for overflow. */
+} xntimerh_t;
+
+#define link2hwholder(ln)	container_of(ln, xntimerh_t, tlink.link)
+
+#define xntimerh_date(h)       xntlholder_date(&(h)->tlink)
+#define xntimerh_prio(h)       xntlholder_prio(&(h)->tlink)
+#define xntimerh_init(h)       xntlholder_init(&(h)->tlink)
+
+typedef struct xntimerq {
+	unsigned date_shift;
+	xnticks_t clock;	/* Wheel position, in level 0 slot units. */
+	xntimerh_t *head;	/* Cached earliest timer, NULL if unknown. */
+	unsigned long map[XNTIMER_HWHEEL_LEVELS]; /* Busy slots. */
+	unsigned count[XNTIMER_HWHEEL_LEVELS + 1]; /* Timers per level. */
+	xnqueue_t slots[XNTIMER_HWHEEL_LEVELS][XNTIMER_HWHEEL_SLOTS];
+	xnqueue_t overflow;
+} xntimerq_t;
+
+typedef struct xntimerq_it {
+	xntimerh_t *head;
+	int level;
+	int n;
+} xntimerq_it_t;
+
+static inline xnticks_t __xntimerq_index(xntimerq_t *q, xntimerh_t *h)
+{
+	xnticks_t idx = xntimerh_date(h) >> q->date_shift;
+
+	/* Any overdue timer is due now. */
+	return (xnsticks_t)(idx - q->clock) < 0 ? q->clock : idx;
+}
+
+static inline void __xntimerq_place(xntimerq_t *q, xntimerh_t *h)
+{
+	xnticks_t idx = __xntimerq_index(q, h), delta = idx - q->clock;
+	int level, slot;
+
+	for (level = 0; level < XNTIMER_HWHEEL_LEVELS; level++)
+		if (delta < (1ULL << ((level + 1) * XNTIMER_HWHEEL_BITS)))
+			break;
+
+	h->level = level;
+	q->count[level]++;
+
+	if (level == XNTIMER_HWHEEL_LEVELS) {
+		h->slot = &q->overflow;
+		xntlist_insert(&q->overflow, &h->tlink);
+		return;
+	}
+
+	slot = (idx >> (level * XNTIMER_HWHEEL_BITS)) & XNTIMER_HWHEEL_MASK;
+	h->slot = &q->slots[level][slot];
+	q->map[level] |= (1UL << slot);
+
+	if (level == 0)
+		xntlist_insert(h->slot, &h->tlink);
+	else
+		appendq(h->slot, &h->tlink.link);
+}
+
+static inline int __xntimerq_lt(xntimerh_t *h1, xntimerh_t *h2)
+{
+	return (xnsticks_t)(xntimerh_date(h1) - xntimerh_date(h2)) < 0 ||
+		(xntimerh_date(h1) == xntimerh_date(h2) &&
+		 xntimerh_prio(h1) > xntimerh_prio(h2));
+}
+
+static inline void xntimerq_insert(xntimerq_t *q, xntimerh_t *h)
+{
+	__xntimerq_place(q, h);
+
+	if (q->head && __xntimerq_lt(h, q->head))
+		q->head = h;
+}
+
+static inline void xntimerq_remove(xntimerq_t *q, xntimerh_t *h)
+{
+	int level = h->level;
+
+	removeq(h->slot, &h->tlink.link);
+	q->count[level]--;
+
+	if (level < XNTIMER_HWHEEL_LEVELS && emptyq_p(h->slot))
+		q->map[level] &= ~(1UL << (h->slot - q->slots[level]));
+
+	if (q->head == h)
+		q->head = NULL;
+}
+
+#define xntimerq_destroy(q)    do { } while (0)
+
+void xntimerq_init(xntimerq_t *q);
+
+xntimerh_t *xntimerq_head(xntimerq_t *q);
+
+xntimerh_t *xntimerq_it_begin(xntimerq_t *q, xntimerq_it_t *it);
+
+xntimerh_t *xntimerq_it_next(xntimerq_t *q, xntimerq_it_t *it,
+			     xntimerh_t *holder);
+
+#elif defined(CONFIG_XENO_OPT_TIMER_DHEAP)
+
+/*
+ * 4-ary heap. Queue slots hold a copy of the timer date along with
+ * the holder pointer, so that sifting only dereferences a holder for
+ * breaking ties between equal dates. Slots live in chunks of
+ * XNTIMER_DHEAP_CHUNK entries, shifted by XNTIMER_DHEAP_BIAS so that
+ * the four children of any node are contiguous within a chunk, which
+ * makes each sibling group fill a single cache line on 64bit
+ * platforms. The first chunk is part of the queue descriptor, more
+ * chunks are obtained from the system heap on behalf of Linux when
+ * the queue is about to fill up, up to
+ * CONFIG_XENO_OPT_TIMER_DHEAP_CAPACITY timers.
+ */
+
+#define XNTIMER_DHEAP_SHIFT   8
+#define XNTIMER_DHEAP_CHUNK   (1 << XNTIMER_DHEAP_SHIFT)
+#define XNTIMER_DHEAP_MASK    (XNTIMER_DHEAP_CHUNK - 1)
+#define XNTIMER_DHEAP_BIAS    3
+#define XNTIMER_DHEAP_LOWAT   (XNTIMER_DHEAP_CHUNK / 4)
+#define XNTIMER_DHEAP_CHUNKS						\
+	((CONFIG_XENO_OPT_TIMER_DHEAP_CAPACITY + XNTIMER_DHEAP_BIAS +	\
+	  XNTIMER_DHEAP_MASK) >> XNTIMER_DHEAP_SHIFT)
+
+typedef struct xntimerh {
+	xnticks_t date;
+	int prio;
+	unsigned pos;		/* Heap index, ~0U when not queued. */
+} xntimerh_t;
+
+#define xntimerh_date(h)       ((h)->date)
+#define xntimerh_prio(h)       ((h)->prio)
+#define xntimerh_init(h)       do { (h)->pos = ~0U; } while (0)
+
+struct xntimerslot {
+	xnticks_t date;
+	xntimerh_t *h;
+};
+
+typedef struct xntimerq {
+	unsigned last;		/* Number of queued timers. */
+	unsigned capacity;
+	unsigned nchunks;
+	int gpending;		/* Growth requested. */
+	xnholder_t glink;
+	struct xntimerslot *chunks[XNTIMER_DHEAP_CHUNKS];
+	struct xntimerslot first[XNTIMER_DHEAP_CHUNK];
+} xntimerq_t;
+
+typedef struct {} xntimerq_it_t;
+
+static inline struct xntimerslot *__xntimerq_slot(xntimerq_t *q, unsigned i)
+{
+	i += XNTIMER_DHEAP_BIAS;
+	return &q->chunks[i >> XNTIMER_DHEAP_SHIFT][i & XNTIMER_DHEAP_MASK];
+}
+
+static inline int __xntimerq_lt(struct xntimerslot *s1, struct xntimerslot *s2)
+{
+	return (xnsticks_t)(s1->date - s2->date) < 0 ||
+		(s1->date == s2->date && s1->h->prio > s2->h->prio);
+}
+
+static inline void
+__xntimerq_set(xntimerq_t *q, unsigned i, struct xntimerslot *s)
+{
+	*__xntimerq_slot(q, i) = *s;
+	s->h->pos = i;
+}
+
+static inline void __xntimerq_up(xntimerq_t *q, unsigned i, struct xntimerslot s)
+{
+	struct xntimerslot *p;
+	unsigned parent;
+
+	while (i > 0) {
+		parent = (i - 1) >> 2;
+		p = __xntimerq_slot(q, parent);
+		if (!__xntimerq_lt(&s, p))
+			break;
+		__xntimerq_set(q, i, p);
+		i = parent;
+	}
+
+	__xntimerq_set(q, i, &s);
+}
+
+void __xntimerq_grow(xntimerq_t *q);
+
+static inline int xntimerq_insert(xntimerq_t *q, xntimerh_t *h)
+{
+	struct xntimerslot s;
+
+	if (q->capacity - q->last <= XNTIMER_DHEAP_LOWAT) {
+		__xntimerq_grow(q);
+		if (q->last == q->capacity) {
+			h->pos = ~0U;
+			return -EBUSY;
+		}
+	}
+
+	s.date = h->date;
+	s.h = h;
+	__xntimerq_up(q, q->last++, s);
+
+	return 0;
+}
+
+static inline xntimerh_t *xntimerq_head(xntimerq_t *q)
+{
+	return q->last ? __xntimerq_slot(q, 0)->h : NULL;
+}
+
+#define xntimerq_it_begin(q, i)   ((void) (i), xntimerq_head(q))
+
+static inline xntimerh_t *
+xntimerq_it_next(xntimerq_t *q, xntimerq_it_t *it, xntimerh_t *holder)
+{
+	unsigned pos = holder->pos + 1;
+
+	return pos < q->last ? __xntimerq_slot(q, pos)->h : NULL;
+}
+
+void xntimerq_init(xntimerq_t *q);
+
+void xntimerq_destroy(xntimerq_t *q);
+
+void xntimerq_remove(xntimerq_t *q, xntimerh_t *h);
+
+int xntimerq_grow_init(void);
+
+void xntimerq_grow_cleanup(void);
+
 #else /* CONFIG_XENO_OPT_TIMER_LIST */
 
 typedef xntlholder_t xntimerh_t;
@@ -268,6 +527,11 @@ typedef struct {} xntimerq_it_t;
 
 #endif /* CONFIG_XENO_OPT_TIMER_LIST */
 
+#ifndef CONFIG_XENO_OPT_TIMER_DHEAP
+static inline int xntimerq_grow_init(void) { return 0; }
+static inline void xntimerq_grow_cleanup(void) { }
+#endif /* !CONFIG_XENO_OPT_TIMER_DHEAP */
+
 struct xnsched;
 
 typedef struct xntimer {
@@ -284,7 +548,7 @@ typedef struct xntimer {
 #define plink2timer(ln) container_of(ln, xntimer_t, plink)
 #endif /* CONFIG_XENO_OPT_TIMING_PERIODIC */
 
-	xnholder_t adjlink;
+	xnholder_t adjlink;	/* Link in realtime periodic timers list. */
 
 #define adjlink2timer(ln) container_of(ln, xntimer_t, adjlink)
 
@@ -294,6 +558,10 @@ typedef struct xntimer {
 
 	xnticks_t pexpect;	/* !< Date of next periodic release point (raw ticks). */
 
+	xnticks_t slack;	/* !< Tolerated expiry delay (raw ticks). */
+
+	xnticks_t gravity;	/* !< Shot anticipation (raw ticks). */
+
 	struct xnsched *sched;	/* !< Sched structure to which the timer is
 				   attached. */
 
@@ -313,6 +581,12 @@ typedef struct xntimer {
 
 	xnstat_counter_t fired; /* !< Number of timer events. */
 
+#ifdef CONFIG_XENO_OPT_STATS_TIMERS
+	xnticks_t handler_time;	/* !< Time spent running the handler (TSC). */
+
+	xnticks_t max_late;	/* !< Worst lateness past expiry (TSC). */
+#endif /* CONFIG_XENO_OPT_STATS_TIMERS */
+
 	XNARCH_DECL_DISPLAY_CONTEXT();
 
 } xntimer_t;
@@ -326,6 +600,12 @@ typedef struct xntimed_slave {
 		xnqueue_t wheel[XNTIMER_WHEELSIZE]; /*!< BSDish timer wheel. */
 	} cascade[XNARCH_NR_CPUS];
 
+#ifdef CONFIG_XENO_OPT_TIMING_TICKLESS
+	int nr_timers;		/* !< Timers queued in all wheels. */
+	int nr_rrthreads;	/* !< Threads undergoing round-robin. */
+	xnticks_t idle_date;	/* !< Date of tick #jiffies when idle (ns). */
+#endif /* CONFIG_XENO_OPT_TIMING_TICKLESS */
+
 #define timer2slave(t) \
     ((xntslave_t *)(((char *)t) - offsetof(xntslave_t, cascade[xnsched_cpu((t)->sched)].timer)))
 #define base2slave(b) \
@@ -357,6 +637,24 @@ typedef struct xntimed_slave {
 	do { xntimerh_prio(&(t)->aplink) = (p); } while(0)
 #endif /* !CONFIG_XENO_OPT_TIMING_PERIODIC */
 
+/*
+ * Timers are shot ahead of their nominal date by the gravity of
+ * their wakeup class, i.e. the typical latency of the event they
+ * trigger: nkigravity for handlers running in IRQ context (default),
+ * nkkgravity for kernel thread wakeups (XNTIMER_KGRAVITY), nklatency
+ * for user-space thread wakeups (XNTIMER_UGRAVITY). The class is
+ * sampled when the timer is started.
+ */
+extern u_long nkigravity;
+
+extern u_long nkkgravity;
+
+static inline void xntimer_set_gravity(xntimer_t *timer, int gravity)
+{
+	__clrbits(timer->status, XNTIMER_GRAVITY_MASK);
+	__setbits(timer->status, gravity);
+}
+
 static inline int xntimer_active_p (xntimer_t *timer)
 {
 	return timer->sched != NULL;
@@ -655,6 +953,12 @@ void xntslave_stop(xntslave_t *slave);
 
 void xntslave_adjust(xntslave_t *slave, xnsticks_t delta);
 
+#ifdef CONFIG_XENO_OPT_TIMING_TICKLESS
+void xntslave_resume(xntslave_t *slave);
+
+void xntslave_set_rr(xntslave_t *slave, int on);
+#endif /* CONFIG_XENO_OPT_TIMING_TICKLESS */
+
 #else /* !CONFIG_XENO_OPT_TIMING_PERIODIC */
 
 int xntimer_start_aperiodic(xntimer_t *timer,
@@ -713,7 +1017,7 @@ static inline xnticks_t xntimer_get_interval(xntimer_t *timer)
 
 static inline xnticks_t xntimer_get_raw_expiry (xntimer_t *timer)
 {
-	return xntimerh_date(&timer->aplink);
+	return xntimer_get_raw_expiry_aperiodic(timer);
 }
 
 #endif /* CONFIG_XENO_OPT_TIMING_PERIODIC */
@@ -728,6 +1032,10 @@ unsigned long xntimer_get_overruns(xntimer_t *timer, xnticks_t now);
 
 void xntimer_freeze(void);
 
+void xntimer_set_slack(xntimer_t *timer, xnticks_t slack);
+
+int xntimer_calibrate_gravity(void);
+
 void xntimer_tick_aperiodic(void);
 
 void xntimer_tick_periodic(xntimer_t *timer);
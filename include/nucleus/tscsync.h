@@ -0,0 +1,31 @@
+/*!\file tscsync.h
+ * \brief TSC skew compensation.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _XENO_NUCLEUS_TSCSYNC_H
+#define _XENO_NUCLEUS_TSCSYNC_H
+
+#if defined(__KERNEL__) && defined(CONFIG_XENO_OPT_TSC_SYNC)
+
+void xntscsync_mount(void);
+
+void xntscsync_umount(void);
+
+#endif /* __KERNEL__ && CONFIG_XENO_OPT_TSC_SYNC */
+
+#endif /* !_XENO_NUCLEUS_TSCSYNC_H */
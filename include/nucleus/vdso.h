@@ -26,6 +26,16 @@
 #include <nucleus/types.h>
 #include <nucleus/hostrt.h>
 
+/*
+ * Wallclock offset of the master time base, so that CLOCK_REALTIME
+ * can be read from user-space as the converted TSC value plus this
+ * offset, using the same conversion factors as CLOCK_MONOTONIC.
+ */
+struct xnvdso_clock_data {
+	xnseqcount_t seqcount;
+	unsigned long long wallclock_offset; /* In nanoseconds. */
+};
+
 /*
  * Data shared between Xenomai kernel/userland and the Linux kernel/userland
  * on the global semaphore heap. The features element indicates which data are
@@ -35,6 +45,8 @@ struct xnvdso {
 	unsigned long long features;
 
 	struct xnvdso_hostrt_data hostrt_data;
+
+	struct xnvdso_clock_data clock_data;
 	/*
 	 * Embed further domain specific structures that
 	 * describe the shared data here
@@ -52,10 +64,11 @@ struct xnvdso {
 #define XNVDSO_FEATURES	(XNVDSO_FEAT_A | XNVDSO_FEAT_B | XVDSO_FEAT_C)
 */
 #define XNVDSO_FEAT_HOST_REALTIME	0x0000000000000001ULL
+#define XNVDSO_FEAT_WALLCLOCK		0x0000000000000002ULL
 #ifdef CONFIG_XENO_OPT_HOSTRT
-#define XNVDSO_FEATURES XNVDSO_FEAT_HOST_REALTIME
+#define XNVDSO_FEATURES (XNVDSO_FEAT_HOST_REALTIME | XNVDSO_FEAT_WALLCLOCK)
 #else
-#define XNVDSO_FEATURES 0
+#define XNVDSO_FEATURES XNVDSO_FEAT_WALLCLOCK
 #endif /* CONFIG_XENO_OPT_HOSTRT */
 
 extern struct xnvdso *nkvdso;
@@ -70,5 +83,33 @@ static inline int xnvdso_test_feature(unsigned long long feature)
 	return testbits(nkvdso->features, feature);
 }
 
+static inline unsigned long long xnvdso_get_wallclock_offset(void)
+{
+	struct xnvdso_clock_data *clock_data = &nkvdso->clock_data;
+	unsigned long long offset;
+	unsigned seq;
+
+	do {
+		seq = xnread_seqcount_begin(&clock_data->seqcount);
+		offset = clock_data->wallclock_offset;
+	} while (xnread_seqcount_retry(&clock_data->seqcount, seq));
+
+	return offset;
+}
+
+#if defined(__KERNEL__) && !defined(__XENO_SIM__)
+/* Writers must be serialized, e.g. by holding nklock. */
+static inline void xnvdso_set_wallclock_offset(unsigned long long offset)
+{
+	struct xnvdso_clock_data *clock_data = &nkvdso->clock_data;
+
+	xnwrite_seqcount_begin(&clock_data->seqcount);
+	clock_data->wallclock_offset = offset;
+	xnwrite_seqcount_end(&clock_data->seqcount);
+}
+#else /* !__KERNEL__ || __XENO_SIM__ */
+#define xnvdso_set_wallclock_offset(offset)	do { } while (0)
+#endif /* !__KERNEL__ || __XENO_SIM__ */
+
 extern void xnheap_init_vdso(void);
 #endif /* _XENO_NUCLEUS_VDSO_H */
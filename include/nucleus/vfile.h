@@ -416,9 +416,38 @@ struct xnvfile_snapshot_ops {
 	 * data collection phase succeeds whenever all records can be
 	 * fetched via the @ref snapshot_next "next() handler", while
 	 * the revision tag remains unchanged, which indicates that a
-	 * consistent snapshot of the object state was taken.
+	 * consistent snapshot of the object state was taken. See the
+	 * @ref snapshot_resume "resume() handler" for bounding the
+	 * number of restarts.
 	 */
 	int (*next)(struct xnvfile_snapshot_iterator *it, void *data);
+	/**
+	 * @anchor snapshot_resume
+	 * This handler moves the seek pointer past the last record
+	 * collected, after the revision tag was touched while
+	 * collecting data. It is used by the vfile core once the
+	 * collection has been restarted XNVFILE_SNAPSHOT_RETRIES
+	 * times in a row: from that point, the core stops dropping
+	 * the records already collected upon revision change, and
+	 * asks this handler to find its way back into the updated
+	 * data set instead. Each record is still fetched atomically
+	 * by the @ref snapshot_next "next() handler", but the whole
+	 * set may mix records from different revisions, and may miss
+	 * records added after the collection started.
+	 *
+	 * @param it A pointer to the current snapshot iterator.
+	 *
+	 * @return zero if the collection may go on, or a negative
+	 * error code, which aborts the data collection and is passed
+	 * back to the reader.
+	 *
+	 * @note This handler is optional; if none is given, or if a
+	 * @ref snapshot_begin "begin() handler" is present, the data
+	 * collection restarts from scratch until a consistent
+	 * snapshot is obtained. It is called with the vfile lock
+	 * held.
+	 */
+	int (*resume)(struct xnvfile_snapshot_iterator *it);
 	/**
 	 * @anchor snapshot_show
 	 * This handler should format and output a record from the
@@ -517,8 +546,15 @@ struct xnvfile_snapshot {
 	size_t datasz;
 	struct xnvfile_rev_tag *tag;
 	struct xnvfile_snapshot_ops *ops;
+	int flags;
 };
 
+/* The vfile honours "since <revision>" queries, see it->since. */
+#define XNVFILE_SNAPSHOT_DELTA	0x1
+
+/* Restarts allowed before falling back to ->resume(). */
+#define XNVFILE_SNAPSHOT_RETRIES  4
+
 /**
  * @brief Snapshot-driven vfile iterator
  * @anchor snapshot_iterator
@@ -536,6 +572,17 @@ struct xnvfile_snapshot_iterator {
 	struct xnvfile_snapshot *vfile;
 	/** Buffer release handler. */
 	void (*endfn)(struct xnvfile_snapshot_iterator *it, void *buf);
+	/**
+	 * Revision passed by the reader with a "since" query, for
+	 * vfiles which support XNVFILE_SNAPSHOT_DELTA. Zero unless
+	 * @a delta is set.
+	 */
+	unsigned long long since;
+	/** Non-zero if the reader only wants records changed since
+	 * @a since. */
+	int delta;
+	/** Non-zero while the data collection is deferred. */
+	int pending;
 	/**
 	 * Start of private area. Use xnvfile_iterator_priv() to
 	 * address it.
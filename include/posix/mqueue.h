@@ -159,4 +159,28 @@ int __real_mq_notify(mqd_t mqdes, const struct sigevent *notification);
 
 #endif /* !(__KERNEL__ || __XENO_SIM__ || !CONFIG_XENO_HAVE_MQUEUE_H) */
 
+/* mq_attr.mq_flags bit at creation: exchange messages in place. */
+#define MQ_ZEROCOPY_NP 0x40000000
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void *mq_alloc_np(mqd_t qd);
+
+int mq_send_np(mqd_t qd,
+	       void *buf,
+	       size_t len,
+	       unsigned prio);
+
+ssize_t mq_receive_np(mqd_t qd,
+		      void **bufp,
+		      unsigned *prio);
+
+int mq_release_np(mqd_t qd, void *buf);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* _XENO_POSIX_MQUEUE_H */
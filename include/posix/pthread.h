@@ -64,6 +64,8 @@
 
 #define PTHREAD_CANCELED  ((void *)-2)
 
+#define PTHREAD_BARRIER_SERIAL_THREAD (-1)
+
 #define PTHREAD_DESTRUCTOR_ITERATIONS 4
 #define PTHREAD_KEYS_MAX 128
 
@@ -88,6 +90,7 @@ typedef struct pse51_threadattr {
 	char *name;
 	int fp;
 	xnarch_cpumask_t affinity;
+	int sigqueue;
 
 } pthread_attr_t;
 
@@ -127,6 +130,13 @@ typedef struct
   struct _pthread_fastlock __m_lock;
 } pthread_mutex_t;
 
+/* Same size as the NPTL barrier on 64-bit. */
+typedef union
+{
+  char __size[32];
+  long __align;
+} pthread_barrier_t;
+
 #endif /* __KERNEL__ */
 
 #else /* !(__KERNEL__ || __XENO_SIM__) */
@@ -155,6 +165,7 @@ struct timespec;
 #define PTHREAD_WARNSW     XNTRAPSW
 #define PTHREAD_LOCK_SCHED XNLOCK
 #define PTHREAD_RPIOFF     XNRPIOFF
+#define PTHREAD_PREREL     XNPREREL
 #define PTHREAD_PRIMARY    XNTHREAD_STATE_SPARE1
 
 #define PTHREAD_INOAUTOENA  XN_ISR_NOENABLE
@@ -164,10 +175,13 @@ struct timespec;
 #define PTHREAD_IDISABLE    1
 
 struct pse51_mutexattr {
-	unsigned magic: 24;
+	unsigned magic: 16;
 	unsigned type: 2;
 	unsigned protocol: 2;
 	unsigned pshared: 1;
+	unsigned spin: 1;
+	unsigned padded: 1;
+	unsigned prioceiling: 8;
 };
 
 struct pse51_condattr {
@@ -176,6 +190,39 @@ struct pse51_condattr {
 	unsigned pshared: 1;
 };
 
+struct pse51_barrierattr {
+	unsigned magic: 24;
+	unsigned pshared: 1;
+};
+
+struct pse51_barrier;
+
+union __xeno_barrier {
+	pthread_barrier_t native_barrier;
+	struct __shadow_barrier {
+		unsigned magic;
+		struct pse51_barrier *barrier;
+#ifdef CONFIG_XENO_FASTSYNCH
+		unsigned state_offset;	/* Barrier word offset in the semaphore heap. */
+		unsigned pshared: 1;
+		unsigned count: 31;
+#endif /* CONFIG_XENO_FASTSYNCH */
+	} shadow_barrier;
+};
+
+/*
+ * Spinlocks live in the semaphore heap; pthread_spinlock_t holds the
+ * offset of their state, the lowest bit telling which heap.
+ */
+struct pse51_spin_state {
+	xnarch_atomic_t owner;	/* Owner handle, XN_NO_HANDLE if free. */
+	unsigned long acquired;	/* Acquisitions. */
+	unsigned long contended; /* Acquisitions which had to spin. */
+};
+
+#define PSE51_SPIN_SHARED   0x1
+#define PSE51_SPIN_INVALID  (~0U)
+
 struct pse51_cond;
 
 union __xeno_cond {
@@ -183,6 +230,13 @@ union __xeno_cond {
 	struct __shadow_cond {
 		unsigned magic;
 		struct pse51_cond *cond;
+#ifdef CONFIG_XENO_FASTSYNCH
+		union {
+			unsigned nwaiters_offset;
+			xnarch_atomic_t *nwaiters;
+		};
+		struct pse51_condattr attr;
+#endif /* CONFIG_XENO_FASTSYNCH */
 	} shadow_cond;
 };
 
@@ -195,6 +249,8 @@ typedef struct pse51_mutexattr pthread_mutexattr_t;
 
 typedef struct pse51_condattr pthread_condattr_t;
 
+typedef struct pse51_barrierattr pthread_barrierattr_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -269,6 +325,12 @@ int pthread_attr_getaffinity_np (const pthread_attr_t *attr,
 int pthread_attr_setaffinity_np (pthread_attr_t *attr,
 				 xnarch_cpumask_t mask);
 
+int pthread_attr_getsigqueue_np(const pthread_attr_t *attr,
+				int *count);
+
+int pthread_attr_setsigqueue_np(pthread_attr_t *attr,
+				int count);
+
 int pthread_create(pthread_t *tid,
 		   const pthread_attr_t *attr,
 		   void *(*start) (void *),
@@ -318,6 +380,12 @@ int pthread_mutexattr_getprotocol(const pthread_mutexattr_t *attr,
 int pthread_mutexattr_setprotocol(pthread_mutexattr_t *attr,
 				  int proto);
 
+int pthread_mutexattr_getprioceiling(const pthread_mutexattr_t *attr,
+				     int *prioceiling);
+
+int pthread_mutexattr_setprioceiling(pthread_mutexattr_t *attr,
+				     int prioceiling);
+
 int pthread_mutexattr_getpshared(const pthread_mutexattr_t *attr, int *pshared);
 
 int pthread_mutexattr_setpshared(pthread_mutexattr_t *attr, int pshared);
@@ -366,6 +434,24 @@ int pthread_cond_signal(pthread_cond_t *cond);
 
 int pthread_cond_broadcast(pthread_cond_t *cond);
 
+int pthread_barrierattr_init(pthread_barrierattr_t *attr);
+
+int pthread_barrierattr_destroy(pthread_barrierattr_t *attr);
+
+int pthread_barrierattr_getpshared(const pthread_barrierattr_t *attr,
+				   int *pshared);
+
+int pthread_barrierattr_setpshared(pthread_barrierattr_t *attr,
+				   int pshared);
+
+int pthread_barrier_init(pthread_barrier_t *barrier,
+			 const pthread_barrierattr_t *attr,
+			 unsigned count);
+
+int pthread_barrier_destroy(pthread_barrier_t *barrier);
+
+int pthread_barrier_wait(pthread_barrier_t *barrier);
+
 int pthread_cancel(pthread_t thread);
 
 void pthread_cleanup_push(void (*routine)(void *),
@@ -406,6 +492,18 @@ int pthread_set_mode_np(int clrmask,
 int pthread_set_name_np(pthread_t thread,
 			const char *name);
 
+int pthread_mutexattr_getspin_np(const pthread_mutexattr_t *attr,
+				 int *spin);
+
+int pthread_mutexattr_setspin_np(pthread_mutexattr_t *attr,
+				 int spin);
+
+int pthread_mutexattr_getpadded_np(const pthread_mutexattr_t *attr,
+				   int *padded);
+
+int pthread_mutexattr_setpadded_np(pthread_mutexattr_t *attr,
+				   int padded);
+
 int pthread_intr_attach_np(pthread_intr_t *intr,
 			   unsigned irq,
 			   xnisr_t isr,
@@ -434,6 +532,12 @@ int pthread_mutexattr_getprotocol(const pthread_mutexattr_t *attr,
 
 int pthread_mutexattr_setprotocol(pthread_mutexattr_t *attr,
 				  int proto);
+
+int pthread_mutexattr_getprioceiling(const pthread_mutexattr_t *attr,
+				     int *prioceiling);
+
+int pthread_mutexattr_setprioceiling(pthread_mutexattr_t *attr,
+				     int prioceiling);
 #endif
 
 #ifndef CONFIG_XENO_HAVE_PTHREAD_CONDATTR_SETCLOCK
@@ -456,6 +560,20 @@ int pthread_set_mode_np(int clrmask,
 int pthread_set_name_np(pthread_t thread,
 			const char *name);
 
+int pthread_inquire_np(struct xnthread_info *info);
+
+int pthread_mutexattr_getspin_np(const pthread_mutexattr_t *attr,
+				 int *spin);
+
+int pthread_mutexattr_setspin_np(pthread_mutexattr_t *attr,
+				 int spin);
+
+int pthread_mutexattr_getpadded_np(const pthread_mutexattr_t *attr,
+				   int *padded);
+
+int pthread_mutexattr_setpadded_np(pthread_mutexattr_t *attr,
+				   int padded);
+
 int pthread_intr_attach_np(pthread_intr_t *intr,
 			   unsigned irq,
 			   int mode);
@@ -476,6 +594,10 @@ int pthread_setschedparam_ex(pthread_t tid,
 			     int pol,
 			     const struct sched_param_ex *par);
 
+int pthread_spin_getstats_np(pthread_spinlock_t *lock,
+			     unsigned long *acquired,
+			     unsigned long *contended);
+
 int __real_pthread_create(pthread_t *tid,
 			  const pthread_attr_t *attr,
 			  void *(*start) (void *),
@@ -507,6 +629,12 @@ int __real_pthread_mutexattr_getprotocol(const pthread_mutexattr_t *attr,
 
 int __real_pthread_mutexattr_setprotocol(pthread_mutexattr_t *attr,
 					 int proto);
+
+int __real_pthread_mutexattr_getprioceiling(const pthread_mutexattr_t *attr,
+					    int *prioceiling);
+
+int __real_pthread_mutexattr_setprioceiling(pthread_mutexattr_t *attr,
+					    int prioceiling);
 #endif
 
 int __real_pthread_mutexattr_getpshared(const pthread_mutexattr_t *attr,
@@ -560,6 +688,16 @@ int __real_pthread_cond_signal(pthread_cond_t *cond);
 
 int __real_pthread_cond_broadcast(pthread_cond_t *cond);
 
+int __real_pthread_spin_init(pthread_spinlock_t *lock, int pshared);
+
+int __real_pthread_spin_destroy(pthread_spinlock_t *lock);
+
+int __real_pthread_spin_lock(pthread_spinlock_t *lock);
+
+int __real_pthread_spin_trylock(pthread_spinlock_t *lock);
+
+int __real_pthread_spin_unlock(pthread_spinlock_t *lock);
+
 int __real_pthread_kill(pthread_t tid, int sig);
 
 #ifdef __cplusplus
@@ -90,11 +90,23 @@ struct __sched_tp_param {
 	int __sched_partition;
 };
 
+#ifndef SCHED_EDF
+#define SCHED_EDF		12
+#define sched_edf_runtime	sched_u.edf.__sched_runtime
+#define sched_edf_period	sched_u.edf.__sched_period
+#endif	/* !SCHED_EDF */
+
+struct __sched_edf_param {
+	struct timespec __sched_runtime;
+	struct timespec __sched_period;
+};
+
 struct sched_param_ex {
 	int sched_priority;
 	union {
 		struct __sched_ss_param ss;
 		struct __sched_tp_param tp;
+		struct __sched_edf_param edf;
 	} sched_u;
 };
 
@@ -109,8 +121,41 @@ struct __sched_config_tp {
 	struct sched_tp_window windows[];
 };
 
+/* Pseudo-policy of sched_setconfig_np() for cache partitioning. */
+#ifndef SCHED_CACHE
+#define SCHED_CACHE		13
+#endif	/* !SCHED_CACHE */
+
+#define SCHED_CACHE_MASK	0	/* Set the cache ways of a class */
+#define SCHED_CACHE_CPU		1	/* Set the default class of a CPU */
+#define SCHED_CACHE_SELF	2	/* Set the class of the caller */
+
+struct __sched_config_cache {
+	int op;
+	int clos;
+	unsigned long mask;
+};
+
+/* Pseudo-policy of sched_setconfig_np() for CPU budgets. */
+#ifndef SCHED_BUDGET
+#define SCHED_BUDGET		14
+#endif	/* !SCHED_BUDGET */
+
+#define SCHED_BUDGET_NOTIFY	0	/* Only count overruns */
+#define SCHED_BUDGET_DEMOTE	1	/* Lower the priority until replenished */
+#define SCHED_BUDGET_SUSPEND	2	/* Hold the thread until replenished */
+
+struct __sched_config_budget {
+	struct timespec quota;
+	struct timespec period;
+	int action;
+	int demote_prio;
+};
+
 union sched_config {
 	struct __sched_config_tp tp;
+	struct __sched_config_cache cache;
+	struct __sched_config_budget budget;
 };
 
 #define sched_tp_confsz(nr_win) \
@@ -67,6 +67,10 @@ union __xeno_sem {
     struct __shadow_sem {
 	unsigned magic;
 	struct pse51_sem *sem;
+#ifdef CONFIG_XENO_FASTSYNCH
+	unsigned value_offset;	/* Counter offset in the semaphore heap. */
+	unsigned pshared;
+#endif /* CONFIG_XENO_FASTSYNCH */
     } shadow_sem;
 };
 
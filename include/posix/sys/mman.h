@@ -96,4 +96,14 @@ int __real_munmap(void *addr, size_t len);
 
 #endif /* !(__KERNEL__ || __XENO_SIM__) */
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int shm_physaddr_np(void *addr, size_t len, unsigned long long *physp);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* _XENO_POSIX_SYS_MMAN_H */
@@ -16,6 +16,19 @@ extern int __real_select (int __nfds, fd_set *__restrict __readfds,
 			  fd_set *__restrict __exceptfds,
 			  struct timeval *__restrict __timeout);
 
+struct epoll_event;
+
+/*
+ * Persistent interest set of the calling thread, with epoll(7)
+ * semantics: EPOLLIN, EPOLLOUT and EPOLLPRI events are supported,
+ * and readiness is level-triggered. Only RTDM and message queue
+ * descriptors may be registered.
+ */
+int epoll_ctl_np(int op, int fd, struct epoll_event *event);
+
+int epoll_wait_np(struct epoll_event *events, int maxevents,
+		  const struct timespec *timeout);
+
 #ifdef __cplusplus
 }
 #endif
@@ -105,6 +105,29 @@
 #define __pse51_thread_setschedparam_ex	78
 #define __pse51_thread_getschedparam_ex	79
 #define __pse51_sched_setconfig_np	80
+#define __pse51_mutexattr_getspin_np	81
+#define __pse51_mutexattr_setspin_np	82
+#define __pse51_epoll_ctl_np		83
+#define __pse51_epoll_wait_np		84
+#define __pse51_mq_alloc_np		85
+#define __pse51_mq_send_np		86
+#define __pse51_mq_receive_np		87
+#define __pse51_mq_release_np		88
+#define __pse51_timer_evq_create_np	89
+#define __pse51_timer_evq_wait_np	90
+#define __pse51_timer_evq_destroy_np	91
+#define __pse51_mutexattr_getprioceiling 92
+#define __pse51_mutexattr_setprioceiling 93
+#define __pse51_shm_physaddr_np		94
+#define __pse51_mutexattr_getpadded_np	95
+#define __pse51_mutexattr_setpadded_np	96
+#define __pse51_barrier_init		97
+#define __pse51_barrier_destroy		98
+#define __pse51_barrier_arrive		99
+#define __pse51_barrier_sleep		100
+#define __pse51_barrier_release		101
+#define __pse51_spin_init		102
+#define __pse51_spin_destroy		103
 
 #ifdef __KERNEL__
 
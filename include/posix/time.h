@@ -150,4 +150,33 @@ int __real_timer_getoverrun(timer_t timerid);
 
 #endif /* !(__KERNEL__ || __XENO_SIM__) */
 
+/* sigev_notify value: post expiries to the event queue of the thread
+   arming the timer instead of sending a signal. */
+#define SIGEV_EVQ_NP 0x100
+
+struct timer_event_np {
+	timer_t timerid;
+	int overruns;		/* Expiries since the event was posted. */
+};
+
+#if !(defined(__KERNEL__) || defined(__XENO_SIM__))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int timer_evq_create_np(unsigned nevents);
+
+int timer_evq_wait_np(int evq,
+		      struct timer_event_np *ev,
+		      const struct timespec *abstime);
+
+int timer_evq_destroy_np(int evq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !(__KERNEL__ || __XENO_SIM__) */
+
 #endif /* _XENO_POSIX_TIME_H */
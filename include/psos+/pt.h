@@ -28,20 +28,12 @@
 
 #define pt_align_mask   (sizeof(void *)-1)
 
-#define pt_bitmap_pos(pt,n) \
-pt->bitmap[((n) / (sizeof(u_long) * 8))]
-
-#define pt_block_pos(n) \
-(1L << ((n) % (sizeof(u_long) * 8)))
-
+/* Atomic, both return the previous state of the bit. */
 #define pt_bitmap_setbit(pt,n) \
-(pt_bitmap_pos(pt,n) |= pt_block_pos(n))
+test_and_set_bit((n), (pt)->bitmap)
 
 #define pt_bitmap_clrbit(pt,n) \
-(pt_bitmap_pos(pt,n) &= ~pt_block_pos(n))
-
-#define pt_bitmap_tstbit(pt,n) \
-(pt_bitmap_pos(pt,n) & pt_block_pos(n))
+test_and_clear_bit((n), (pt)->bitmap)
 
 typedef struct psospt {
 
@@ -61,9 +53,11 @@ typedef struct psospt {
 
     u_long nblks;		/* Number of data blocks */
 
-    u_long ublks;		/* Number of used blocks */
+    atomic_long_t ublks;	/* Number of used blocks */
+
+    xnarch_atomic_t freehead;	/* Free block stack: tag | (index + 1) */
 
-    void *freelist;		/* Free block list head */
+    u_long idxmask;		/* Index bits of freehead */
 
     char *data;			/* Pointer to the user space behind the bitmap */
 
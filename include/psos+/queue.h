@@ -36,6 +36,15 @@
 
 #define PSOS_QUEUE_MIN_ALLOC  64
 
+/* Size classes for unlimited variable-size queues (Q_NOCACHE):
+   powers of two from 16 bytes to 32k, larger messages are obtained
+   from region #0 individually. Each queue keeps a magazine of free
+   buffers per class, refilled PSOS_QUEUE_MAG_ALLOC buffers at a
+   time. */
+#define PSOS_QUEUE_MIN_CLASS  4
+#define PSOS_QUEUE_NR_CLASSES 12
+#define PSOS_QUEUE_MAG_ALLOC  8
+
 typedef struct psosmbuf {
 
     xnholder_t link;
@@ -44,6 +53,10 @@ typedef struct psosmbuf {
 
     u_long len;
 
+    int class;		/* Size class, -1 if not class-allocated */
+
+    int refcnt;		/* Receivers sharing this buffer */
+
     char data[1];
 
 } psosmbuf_t;
@@ -72,6 +85,8 @@ typedef struct psosqueue {
     xnqueue_t inq,		/* Incoming message queue */
 	      freeq;		/* Free (cache) message queue */
 
+    xnqueue_t classq[PSOS_QUEUE_NR_CLASSES]; /* Size-class magazines */
+
     xnholder_t rlink;		/* !< Link in resource queue. */
 
 #define rlink2q(ln)		container_of(ln, psosqueue_t, rlink)
@@ -34,6 +34,10 @@ static inline void rt_print_auto_init(int enable)
 {
 }
 
+static inline void rt_print_deferred_format(int enable)
+{
+}
+
 static inline const char *rt_print_buffer_name(void)
 {
 	return "<unknown>";
@@ -43,8 +47,41 @@ static inline const char *rt_print_buffer_name(void)
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <xeno_config.h>
 
+/* Output streams, as recorded in binary log files. */
+#define RT_PRINT_STREAM_SYSLOG	0
+#define RT_PRINT_STREAM_STDOUT	1
+#define RT_PRINT_STREAM_STDERR	2
+#define RT_PRINT_STREAM_OTHER	3
+
+#define RT_PRINT_RECORD_MAGIC	0x52545052	/* "RTPR" */
+
+/*
+ * Header of each entry in a binary log file, followed by len bytes
+ * of text, padded to the next 8-byte boundary. A zero magic marks
+ * the end of the log.
+ */
+struct rt_print_record {
+	uint32_t magic;
+	uint32_t seq_no;
+	uint32_t len;
+	uint16_t stream;
+	int16_t priority;
+};
+
+typedef struct rt_print_sink rt_print_sink_t;
+
+struct rt_print_sink_ops {
+	/* stream is NULL for rt_syslog() entries. */
+	void (*output)(void *cookie, const char *buffer_name,
+		       FILE *stream, int priority, uint32_t seq_no,
+		       const char *data, size_t len);
+	void (*sync)(void *cookie);
+	void (*close)(void *cookie);
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -64,8 +101,16 @@ void rt_vsyslog(int priority, const char *format, va_list args);
 int rt_print_init(size_t buffer_size, const char *name);
 void rt_print_cleanup(void);
 void rt_print_auto_init(int enable);
+void rt_print_deferred_format(int enable);
 const char *rt_print_buffer_name(void);
 void rt_print_flush_buffers(void);
+
+rt_print_sink_t *rt_print_sink_create(const struct rt_print_sink_ops *ops,
+				      void *cookie);
+rt_print_sink_t *rt_print_sink_file(const char *path, size_t window);
+rt_print_sink_t *rt_print_sink_socket(const char *path);
+void rt_print_sink_destroy(rt_print_sink_t *sink);
+int rt_print_route(const char *pattern, rt_print_sink_t *sink);
 #ifdef CONFIG_XENO_FORTIFY
 int __rt_vfprintf_chk(FILE *stream, int level, const char *fmt, va_list args);
 void __rt_vsyslog_chk(int priority, int level, const char *fmt, va_list args);
@@ -73,6 +118,14 @@ void __rt_vsyslog_chk(int priority, int level, const char *fmt, va_list args);
 
 void assert_nrt(void);
 
+int xeno_malloc_init(void);
+void *xeno_malloc(size_t size);
+void *xeno_calloc(size_t nmemb, size_t size);
+void *xeno_realloc(void *ptr, size_t size);
+void *xeno_memalign(size_t align, size_t size);
+void xeno_free(void *ptr);
+void xeno_malloc_wrap(int enable);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
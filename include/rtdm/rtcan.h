@@ -533,6 +533,107 @@ typedef struct can_frame {
 	uint8_t data[8] __attribute__ ((aligned(8)));
 } can_frame_t;
 
+/*!
+ * @anchor CAN_RX_SLOT_xxx   @name Receive ring slot status
+ * Owner of a slot of a receive ring, see @ref RTCAN_RTIOC_RX_RING
+ * @{ */
+#define CAN_RX_SLOT_KERNEL	0  /**< Free, may be filled by the kernel */
+#define CAN_RX_SLOT_USER	1  /**< Filled, to be consumed by the user */
+/** @} */
+
+/**
+ * Slot of a receive ring
+ */
+struct can_rx_slot {
+	/** Owner of the slot, see @ref CAN_RX_SLOT_xxx */
+	volatile uint32_t status;
+
+	/** Interface index the frame was received on */
+	uint32_t ifindex;
+
+	/** Reception timestamp, in nanoseconds */
+	nanosecs_abs_t timestamp;
+
+	/** Received frame */
+	can_frame_t frame;
+};
+
+/**
+ * Receive ring mapped by @ref RTCAN_RTIOC_RX_RING
+ */
+struct can_rx_ring {
+	/** Number of slots (power of 2) */
+	uint32_t nr_slots;
+
+	/** Count of frames waking up @ref RTCAN_RTIOC_RX_RING_WAIT */
+	uint32_t watermark;
+
+	/** Frames dropped because the next slot was still in use */
+	volatile uint32_t dropped;
+
+	uint32_t reserved;
+
+	/** Slots, filled in order and wrapping around */
+	struct can_rx_slot slots[0];
+};
+
+/**
+ * Argument of @ref RTCAN_RTIOC_RX_RING
+ */
+struct can_rx_ring_req {
+	/** [in] Number of slots, power of 2 up to 65536 */
+	uint32_t nr_slots;
+
+	/** [in] Wake-up watermark, between 1 and nr_slots */
+	uint32_t watermark;
+
+	/** [out] Address of the mapped ring */
+	struct can_rx_ring *ring;
+
+	/** [out] Size of the mapping */
+	size_t size;
+};
+
+/**
+ * Gateway route, see @ref SIOCADDCANROUTE
+ *
+ * A frame received on @c src_ifindex is forwarded to @c dst_ifindex if
+ * its ID matches, in the sense of struct can_filter without
+ * @ref CAN_INV_FILTER:
+ *
+ * @code
+ * if ((received_can_id & can_mask) == can_id)
+ *    forward-frame;
+ * @endcode
+ *
+ * The ID of the forwarded frame may be rewritten on the way:
+ *
+ * @code
+ * forwarded_can_id = (received_can_id & ~mod_mask) | (mod_id & mod_mask);
+ * @endcode
+ *
+ * A frame matching several routes is forwarded once per route.
+ */
+struct can_route {
+	/** Interface index of the input bus */
+	int src_ifindex;
+
+	/** Interface index of the output bus */
+	int dst_ifindex;
+
+	/** CAN ID to match */
+	can_id_t can_id;
+
+	/** Mask applied to the received ID before matching */
+	can_id_t can_mask;
+
+	/** ID bits to rewrite, 0 to forward the ID unmodified */
+	can_id_t mod_mask;
+
+	/** New value of the rewritten bits */
+	can_id_t mod_id;
+};
+
 /*!
  * @anchor RTCAN_TIMESTAMPS   @name Timestamp switches
  * Arguments to pass to @ref RTCAN_RTIOC_TAKE_TIMESTAMP
@@ -1040,6 +1141,162 @@ typedef struct can_frame {
  * Rescheduling: never.
  */
 #define RTCAN_RTIOC_SND_TIMEOUT	_IOW(RTIOC_TYPE_CAN, 0x0B, nanosecs_rel_t)
+
+/**
+ * Switch a socket to receive ring mode
+ *
+ * Allocates a ring of fixed-size frame slots and maps it into the
+ * caller's address space. From then on, the frames accepted by the
+ * socket are stored into the ring instead of the socket buffer, each
+ * with its reception timestamp, and the @ref Recv "receive functions"
+ * do not return them anymore.
+ *
+ * The slots are filled in order. The kernel only fills a slot whose
+ * status is @ref CAN_RX_SLOT_KERNEL, then sets it to
+ * @ref CAN_RX_SLOT_USER; otherwise the frame is dropped and counted
+ * in the dropped field of the ring. The application consumes the
+ * slots in the same order, as long as their status is
+ * @ref CAN_RX_SLOT_USER, and hands each of them back by resetting the
+ * status to @ref CAN_RX_SLOT_KERNEL, after a memory barrier.
+ *
+ * @param [in,out] arg Pointer to struct can_rx_ring_req
+ *
+ * @return 0 on success, otherwise:
+ * - -EFAULT: It was not possible to access user space memory area at the
+ *            specified address.
+ * - -EINVAL: Invalid number of slots or watermark.
+ * - -EBUSY: The socket is already in receive ring mode.
+ * - -ENOMEM: Not enough memory to allocate the ring.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - User-space task (non-RT)
+ *
+ * Rescheduling: possible.
+ */
+#define RTCAN_RTIOC_RX_RING	_IOWR(RTIOC_TYPE_CAN, 0x0C, struct can_rx_ring_req)
+
+/**
+ * Wait for frames in the receive ring
+ *
+ * Blocks until the count of frames stored into the receive ring since
+ * the previous call reaches the watermark set with
+ * @ref RTCAN_RTIOC_RX_RING, or until the reception timeout (see
+ * @ref RTCAN_RTIOC_RCV_TIMEOUT) elapses. The ring should be scanned
+ * in either case, since a timeout may hide frames below the watermark.
+ *
+ * @return The count of frames stored since the previous call on
+ * success, otherwise:
+ * - -EINVAL: The socket is not in receive ring mode.
+ * - -ETIMEDOUT: The reception timeout elapsed.
+ * - -EWOULDBLOCK: Non-blocking timeout and no frame.
+ * - -EINTR: Blocking was interrupted.
+ * - -EBADF: The socket was closed.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - User-space task (RT)
+ *
+ * Rescheduling: possible.
+ */
+#define RTCAN_RTIOC_RX_RING_WAIT _IO(RTIOC_TYPE_CAN, 0x0D)
+
+/**
+ * Add a gateway route
+ *
+ * Frames received on the input bus and matching the route are sent on
+ * the output bus by the stack itself, without going through any
+ * socket. Forwarding is performed by the receive task of the input
+ * device, which is started on demand, see @ref SIOCSCANRXCPU. Frames
+ * which cannot be handed over to the output controller within a few
+ * milliseconds are dropped and counted in
+ * /proc/rtcan/&lt;device&gt;/info.
+ *
+ * @param [in] arg Pointer to struct can_route
+ *
+ * @return 0 on success, otherwise:
+ * - -EFAULT: It was not possible to access user space memory area at the
+ *            specified address.
+ * - -ENODEV: No device with the specified input or output index exists.
+ * - -EINVAL: Input and output bus are the same.
+ * - -ENOSPC: The route table of the input device is full.
+ * - -EOPNOTSUPP: Gateway support is not enabled.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - User-space task (non-RT)
+ *
+ * Rescheduling: possible.
+ */
+#define SIOCADDCANROUTE		_IOW(RTIOC_TYPE_CAN, 0x0E, struct can_route)
+
+/**
+ * Remove a gateway route
+ *
+ * @param [in] arg Pointer to struct can_route, all fields must match
+ *                 those of the route to remove.
+ *
+ * @return 0 on success, otherwise:
+ * - -EFAULT: It was not possible to access user space memory area at the
+ *            specified address.
+ * - -ENODEV: No device with the specified input index exists.
+ * - -ENOENT: No such route.
+ * - -EOPNOTSUPP: Gateway support is not enabled.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - User-space task (non-RT)
+ *
+ * Rescheduling: possible.
+ */
+#define SIOCDELCANROUTE		_IOW(RTIOC_TYPE_CAN, 0x0F, struct can_route)
+
+/**
+ * Bind the receive processing of a device to a CPU
+ *
+ * By default, received frames are dispatched to the sockets from the
+ * interrupt handler of the controller. This request moves the dispatch
+ * to a receive task of the device running on the given CPU, so that
+ * the load of several busses can be spread over several cores. A
+ * receive task is also started on any CPU when a route is added for
+ * the device.
+ *
+ * @param [in] arg Pointer to interface request structure buffer
+ *                 (<TT>struct ifreq</TT> from linux/if.h).
+ *                 <TT>ifr_name</TT> must hold a valid CAN interface name,
+ *                 <TT>ifr_ifru</TT> must be filled with an int holding the
+ *                 CPU number, or -1 to dispatch from the interrupt handler
+ *                 again.
+ *
+ * @return 0 on success, otherwise:
+ * - -EFAULT: It was not possible to access user space memory area at the
+ *            specified address.
+ * - -ENODEV: No device with specified name exists.
+ * - -EINVAL: The CPU is not available to real-time tasks.
+ * - -EBUSY: Routes are defined for this device, a receive task is
+ *           required.
+ * - -EOPNOTSUPP: Gateway support is not enabled.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - User-space task (non-RT)
+ *
+ * Rescheduling: possible.
+ */
+#define SIOCSCANRXCPU		_IOW(RTIOC_TYPE_CAN, 0x10, struct ifreq)
 /** @} */
 
 #define CAN_ERR_DLC  8	/* dlc for error frames */
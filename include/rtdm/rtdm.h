@@ -121,6 +121,7 @@ typedef int64_t nanosecs_rel_t;
 #define RTDM_CLASS_RTMAC		5
 #define RTDM_CLASS_TESTING		6
 #define RTDM_CLASS_RTIPC		7
+#define RTDM_CLASS_FILE			8
 /*
 #define RTDM_CLASS_USB			?
 #define RTDM_CLASS_FIREWIRE		?
@@ -236,6 +237,115 @@ struct _rtdm_setsockaddr_args {
 #define _RTIOC_SHUTDOWN		_IOW(RTIOC_TYPE_COMMON, 0x28,		\
 				     int)
 
+/**
+ * Message vector entry for rt_dev_recvmmsg() and rt_dev_sendmmsg().
+ */
+struct rtdm_mmsghdr {
+	/** Message descriptor */
+	struct msghdr msg_hdr;
+	/** Number of bytes transferred for this message */
+	unsigned int msg_len;
+};
+
+/**
+ * Request vector entry for rt_dev_ioctlv().
+ */
+struct rtdm_ioctl_vec {
+	/** IOCTL request number */
+	unsigned int request;
+	/** Request argument */
+	void *arg;
+	/** Value returned by the request, or the error code which stopped
+	 *  the vector */
+	int result;
+};
+
+/*!
+ * @anchor RTDM_AIO_xxx @name RTDM_AIO_xxx
+ * Asynchronous I/O request codes
+ * @{ */
+#define RTDM_AIO_READ			0
+#define RTDM_AIO_WRITE			1
+/** First code available for driver-specific requests */
+#define RTDM_AIO_DRIVER			0x100
+/** @} RTDM_AIO_xxx */
+
+/** Upper limit for the number of entries of an asynchronous I/O ring */
+#define RTDM_AIO_MAX_ENTRIES		4096
+
+/**
+ * Asynchronous I/O request, posted to the submission ring.
+ */
+struct rtdm_aio_sqe {
+	/** Opaque value, passed back with the completion */
+	unsigned long long user_data;
+	/** Driver-defined position, e.g. a device offset */
+	unsigned long long offset;
+	/** User buffer */
+	void *buf;
+	/** Length of the user buffer */
+	size_t len;
+	/** Request code, see @ref RTDM_AIO_xxx */
+	unsigned int opcode;
+	/** Driver-defined request flags */
+	unsigned int flags;
+};
+
+/**
+ * Asynchronous I/O completion, posted to the completion ring.
+ */
+struct rtdm_aio_cqe {
+	/** Value of the user_data field of the request */
+	unsigned long long user_data;
+	/** Result of the request, a negative error code on failure */
+	long res;
+	/** Driver-defined completion flags */
+	unsigned int flags;
+};
+
+/**
+ * Ring indexes. The producer of a ring only writes its tail, the
+ * consumer only writes its head; both run freely, entry n being
+ * stored in slot n & mask.
+ */
+struct rtdm_aio_ring {
+	unsigned int head;
+	unsigned int tail;
+	unsigned int mask;
+	unsigned int entries;
+};
+
+/**
+ * Header of the memory area shared with the caller of
+ * rt_dev_aio_setup(). The request and completion arrays follow, at
+ * the offsets returned in struct rtdm_aio_params.
+ */
+struct rtdm_aio_area {
+	/** Submission ring, produced by the application */
+	struct rtdm_aio_ring sq;
+	/** Completion ring, produced by RTDM */
+	struct rtdm_aio_ring cq;
+};
+
+/**
+ * Parameters of rt_dev_aio_setup().
+ */
+struct rtdm_aio_params {
+	/** Size of the submission ring, a power of two (in) */
+	unsigned int sq_entries;
+	/** Size of the completion ring, a power of two not smaller than
+	 *  sq_entries, twice sq_entries if zero (in/out) */
+	unsigned int cq_entries;
+	/** Address of the shared area (out) */
+	void *area;
+	/** Size of the shared area (out) */
+	size_t size;
+	/** Offset of the request array in the shared area (out) */
+	size_t sq_off;
+	/** Offset of the completion array in the shared area (out) */
+	size_t cq_off;
+};
+
 #ifdef __KERNEL__
 int __rt_dev_open(rtdm_user_info_t *user_info, const char *path, int oflag);
 int __rt_dev_socket(rtdm_user_info_t *user_info, int protocol_family,
@@ -250,6 +360,19 @@ ssize_t __rt_dev_recvmsg(rtdm_user_info_t *user_info, int fd,
 			 struct msghdr *msg, int flags);
 ssize_t __rt_dev_sendmsg(rtdm_user_info_t *user_info, int fd,
 			 const struct msghdr *msg, int flags);
+int __rt_dev_recvmmsg(rtdm_user_info_t *user_info, int fd,
+		      struct rtdm_mmsghdr *msgvec, unsigned int vlen,
+		      int flags);
+int __rt_dev_sendmmsg(rtdm_user_info_t *user_info, int fd,
+		      struct rtdm_mmsghdr *msgvec, unsigned int vlen,
+		      int flags);
+int __rt_dev_ioctlv(rtdm_user_info_t *user_info, int fd,
+		    struct rtdm_ioctl_vec *vec, unsigned int vlen);
+int __rt_dev_aio_setup(rtdm_user_info_t *user_info, int fd,
+		       struct rtdm_aio_params *params);
+int __rt_dev_aio_enter(rtdm_user_info_t *user_info, int fd,
+		       unsigned int to_submit, unsigned int min_complete,
+		       nanosecs_rel_t timeout);
 #endif /* __KERNEL__ */
 
 /* Define RTDM_NO_DEFAULT_USER_API to switch off the default rt_dev_xxx
@@ -270,6 +393,9 @@ ssize_t __rt_dev_sendmsg(rtdm_user_info_t *user_info, int fd,
 #define rt_dev_ioctl(fd, request, ...)				\
 	__rt_dev_ioctl(NULL, fd, request, __VA_ARGS__)
 
+#define rt_dev_ioctlv(fd, vec, vlen)				\
+	__rt_dev_ioctlv(NULL, fd, vec, vlen)
+
 #define rt_dev_read(fd, buf, nbyte)				\
 	__rt_dev_read(NULL, fd, buf, nbyte)
 
@@ -282,6 +408,12 @@ ssize_t __rt_dev_sendmsg(rtdm_user_info_t *user_info, int fd,
 #define rt_dev_sendmsg(fd, msg, flags)				\
 	__rt_dev_sendmsg(NULL, fd, msg, flags)
 
+#define rt_dev_recvmmsg(fd, msgvec, vlen, flags)		\
+	__rt_dev_recvmmsg(NULL, fd, msgvec, vlen, flags)
+
+#define rt_dev_sendmmsg(fd, msgvec, vlen, flags)		\
+	__rt_dev_sendmmsg(NULL, fd, msgvec, vlen, flags)
+
 static inline ssize_t rt_dev_recvfrom(int fd, void *buf, size_t len, int flags,
 				      struct sockaddr *from,
 				      socklen_t *fromlen)
@@ -316,10 +448,18 @@ int rt_dev_open(const char *path, int oflag, ...);
 int rt_dev_socket(int protocol_family, int socket_type, int protocol);
 int rt_dev_close(int fd);
 int rt_dev_ioctl(int fd, int request, ...);
+int rt_dev_ioctlv(int fd, struct rtdm_ioctl_vec *vec, unsigned int vlen);
 ssize_t rt_dev_read(int fd, void *buf, size_t nbyte);
 ssize_t rt_dev_write(int fd, const void *buf, size_t nbyte);
 ssize_t rt_dev_recvmsg(int fd, struct msghdr *msg, int flags);
 ssize_t rt_dev_sendmsg(int fd, const struct msghdr *msg, int flags);
+int rt_dev_recvmmsg(int fd, struct rtdm_mmsghdr *msgvec, unsigned int vlen,
+		    int flags);
+int rt_dev_sendmmsg(int fd, struct rtdm_mmsghdr *msgvec, unsigned int vlen,
+		    int flags);
+int rt_dev_aio_setup(int fd, struct rtdm_aio_params *params);
+int rt_dev_aio_enter(int fd, unsigned int to_submit,
+		     unsigned int min_complete, nanosecs_rel_t timeout);
 
 ssize_t rt_dev_recvfrom(int fd, void *buf, size_t len, int flags,
 			struct sockaddr *from, socklen_t *fromlen);
@@ -38,6 +38,8 @@
 #include <nucleus/heap.h>
 #include <nucleus/pod.h>
 #include <nucleus/synch.h>
+#include <nucleus/rwlock.h>
+#include <nucleus/seqlock.h>
 #include <nucleus/select.h>
 #include <nucleus/vfile.h>
 #include <rtdm/rtdm.h>
@@ -70,6 +72,13 @@ enum rtdm_selecttype;
  *  application. */
 #define RTDM_EXCLUSIVE			0x0001
 
+/** If set, device contexts are taken from a per-device cache of
+ *  CONFIG_XENO_OPT_RTDM_CONTEXT_CACHE preallocated entries, so that
+ *  instances are created and released at constant cost from any
+ *  context. Instances created by the non-RT handlers may then be
+ *  closed by the RT close handler as well, if the driver provides one. */
+#define RTDM_CONTEXT_CACHE		0x0002
+
 /** If set, the device is addressed via a clear-text name. */
 #define RTDM_NAMED_DEVICE		0x0010
 
@@ -231,6 +240,31 @@ typedef int (*rtdm_ioctl_handler_t)(struct rtdm_dev_context *context,
 				    rtdm_user_info_t *user_info,
 				    unsigned int request, void __user *arg);
 
+/**
+ * Vectored IOCTL handler
+ *
+ * @param[in] context Context structure associated with opened device instance
+ * @param[in] user_info Opaque pointer to information about user mode caller,
+ * NULL if kernel mode call
+ * @param[in,out] vec Vector of requests as passed by the user, automatically
+ * mirrored to safe kernel memory in case of user mode call. The request
+ * arguments still point to user memory in that case.
+ * @param[in] vlen Number of entries in @a vec
+ *
+ * The requests are processed in order, the value returned by each one
+ * being stored in the result field of its entry. Processing stops at
+ * the first failing request, its error code being stored likewise.
+ *
+ * @return The number of requests which succeeded. If the very first
+ * request fails, its error code is returned instead, which may be -ENOSYS
+ * to request that this handler be called again from the opposite
+ * realtime/non-realtime context.
+ */
+typedef int (*rtdm_ioctlv_handler_t)(struct rtdm_dev_context *context,
+				     rtdm_user_info_t *user_info,
+				     struct rtdm_ioctl_vec *vec,
+				     unsigned int vlen);
+
 /**
  * Select binding handler
  *
@@ -326,6 +360,80 @@ typedef ssize_t (*rtdm_recvmsg_handler_t)(struct rtdm_dev_context *context,
 typedef ssize_t (*rtdm_sendmsg_handler_t)(struct rtdm_dev_context *context,
 					  rtdm_user_info_t *user_info,
 					  const struct msghdr *msg, int flags);
+
+/**
+ * Receive multiple messages handler
+ *
+ * @param[in] context Context structure associated with opened device instance
+ * @param[in] user_info Opaque pointer to information about user mode caller,
+ * NULL if kernel mode call
+ * @param[in,out] msgvec Vector of message descriptors as passed by the user,
+ * automatically mirrored to safe kernel memory in case of user mode call
+ * @param[in] vlen Number of entries in @a msgvec
+ * @param[in] flags Message flags as passed by the user
+ *
+ * Only the first message should be waited for according to @a flags, the
+ * next ones are only received if already pending. The number of bytes
+ * received for each message is returned in the msg_len field of its
+ * descriptor.
+ *
+ * @return On success, the number of messages received. On failure return
+ * either -ENOSYS, to request that this handler be called again from the
+ * opposite realtime/non-realtime context, or another negative error code.
+ *
+ * @see @c recvmmsg() in the Linux manual pages */
+typedef int (*rtdm_recvmmsg_handler_t)(struct rtdm_dev_context *context,
+				       rtdm_user_info_t *user_info,
+				       struct rtdm_mmsghdr *msgvec,
+				       unsigned int vlen, int flags);
+
+/**
+ * Transmit multiple messages handler
+ *
+ * @param[in] context Context structure associated with opened device instance
+ * @param[in] user_info Opaque pointer to information about user mode caller,
+ * NULL if kernel mode call
+ * @param[in,out] msgvec Vector of message descriptors as passed by the user,
+ * automatically mirrored to safe kernel memory in case of user mode call
+ * @param[in] vlen Number of entries in @a msgvec
+ * @param[in] flags Message flags as passed by the user
+ *
+ * The number of bytes transmitted for each message is returned in the
+ * msg_len field of its descriptor.
+ *
+ * @return On success, the number of messages transmitted. On failure return
+ * either -ENOSYS, to request that this handler be called again from the
+ * opposite realtime/non-realtime context, or another negative error code.
+ *
+ * @see @c sendmmsg() in the Linux manual pages */
+typedef int (*rtdm_sendmmsg_handler_t)(struct rtdm_dev_context *context,
+				       rtdm_user_info_t *user_info,
+				       struct rtdm_mmsghdr *msgvec,
+				       unsigned int vlen, int flags);
+
+/**
+ * Asynchronous I/O submission handler
+ *
+ * @param[in] context Context structure associated with opened device instance
+ * @param[in] user_info Opaque pointer to information about user mode caller
+ * @param[in] sqe Request taken from the submission ring, copied to safe
+ * kernel memory
+ *
+ * The handler starts the request and returns without waiting for it.
+ * The driver posts the outcome later by calling rtdm_aio_complete(),
+ * typically from its interrupt handler, or right away from the
+ * handler itself for requests it can serve synchronously. Since the
+ * completion may happen outside of the caller's context, a request
+ * buffer would usually designate an area the driver has mapped to
+ * user-space beforehand, e.g. via rtdm_mmap_to_user().
+ *
+ * @return 0 if the request was started, in which case it must be
+ * completed eventually. Otherwise a negative error code, which RTDM
+ * posts as the result of the request.
+ */
+typedef int (*rtdm_submit_handler_t)(struct rtdm_dev_context *context,
+				     rtdm_user_info_t *user_info,
+				     const struct rtdm_aio_sqe *sqe);
 /** @} Operation Handler Prototypes */
 
 typedef int (*rtdm_rt_handler_t)(struct rtdm_dev_context *context,
@@ -347,6 +455,13 @@ struct rtdm_operations {
 	/** IOCTL from non-real-time context (optional) */
 	rtdm_ioctl_handler_t ioctl_nrt;
 
+	/** Vectored IOCTL from real-time context (optional, defaults to
+	 *  looping over ioctl_rt) */
+	rtdm_ioctlv_handler_t ioctlv_rt;
+	/** Vectored IOCTL from non-real-time context (optional, defaults to
+	 *  looping over ioctl_nrt) */
+	rtdm_ioctlv_handler_t ioctlv_nrt;
+
 	/** Select binding handler for any context (optional) */
 	rtdm_select_bind_handler_t select_bind;
 	/** @} Common Operations */
@@ -375,12 +490,37 @@ struct rtdm_operations {
 	rtdm_sendmsg_handler_t sendmsg_rt;
 	/** Transmit message handler for non-real-time context (optional) */
 	rtdm_sendmsg_handler_t sendmsg_nrt;
+
+	/** Receive multiple messages handler for real-time context (optional,
+	 *  defaults to looping over recvmsg_rt) */
+	rtdm_recvmmsg_handler_t recvmmsg_rt;
+	/** Receive multiple messages handler for non-real-time context
+	 *  (optional, defaults to looping over recvmsg_nrt) */
+	rtdm_recvmmsg_handler_t recvmmsg_nrt;
+
+	/** Transmit multiple messages handler for real-time context (optional,
+	 *  defaults to looping over sendmsg_rt) */
+	rtdm_sendmmsg_handler_t sendmmsg_rt;
+	/** Transmit multiple messages handler for non-real-time context
+	 *  (optional, defaults to looping over sendmsg_nrt) */
+	rtdm_sendmmsg_handler_t sendmmsg_nrt;
 	/** @} Message-Oriented Device Operations */
+
+	/*! @name Asynchronous I/O Operations
+	 * @{ */
+	/** Request submission handler for real-time context (optional,
+	 *  asynchronous I/O rings are not available without it) */
+	rtdm_submit_handler_t submit_rt;
+	/** @} Asynchronous I/O Operations */
 };
 
+struct rtdm_aio;
+
 struct rtdm_devctx_reserved {
 	void *owner;
 	struct list_head cleanup;
+	struct rtdm_aio *aio;
+	unsigned long long close_date;
 };
 
 /**
@@ -450,6 +590,7 @@ struct rtdm_dev_reserved {
 	struct list_head entry;
 	atomic_t refcount;
 	struct rtdm_dev_context *exclusive_context;
+	xnobjpool_t context_pool;
 };
 
 /**
@@ -545,12 +686,15 @@ int rtdm_dev_unregister(struct rtdm_device *device, unsigned int poll_delay);
 #define rtdm_socket		rt_dev_socket
 #define rtdm_close		rt_dev_close
 #define rtdm_ioctl		rt_dev_ioctl
+#define rtdm_ioctlv		rt_dev_ioctlv
 #define rtdm_read		rt_dev_read
 #define rtdm_write		rt_dev_write
 #define rtdm_recvmsg		rt_dev_recvmsg
 #define rtdm_recv		rt_dev_recv
 #define rtdm_recvfrom		rt_dev_recvfrom
 #define rtdm_sendmsg		rt_dev_sendmsg
+#define rtdm_recvmmsg		rt_dev_recvmmsg
+#define rtdm_sendmmsg		rt_dev_sendmmsg
 #define rtdm_send		rt_dev_send
 #define rtdm_sendto		rt_dev_sendto
 #define rtdm_bind		rt_dev_bind
@@ -564,6 +708,12 @@ int rtdm_dev_unregister(struct rtdm_device *device, unsigned int poll_delay);
 
 struct rtdm_dev_context *rtdm_context_get(int fd);
 
+/* --- asynchronous I/O services --- */
+
+void rtdm_aio_complete(struct rtdm_dev_context *context,
+		       unsigned long long user_data, long res);
+unsigned int rtdm_aio_inflight(struct rtdm_dev_context *context);
+
 #ifndef DOXYGEN_CPP /* Avoid static inline tags for RTDM in doxygen */
 
 #define CONTEXT_IS_LOCKED(context) \
@@ -844,6 +994,268 @@ typedef unsigned long rtdm_lockctx_t;
 	rthal_local_irq_restore(context)
 /** @} Spinlock with Preemption Deactivation */
 
+/*!
+ * @name Reader-Writer Spinlock with Preemption Deactivation
+ *
+ * Readers holding such lock may run concurrently on different CPUs,
+ * which suits read-mostly data consulted over hot paths. Writers are
+ * given precedence over new readers. The lock is not recursive.
+ * @{
+ */
+
+/**
+ * Static lock initialisation
+ */
+#define RTDM_RWLOCK_UNLOCKED	XNARCH_RWLOCK_UNLOCKED
+
+/** Lock variable */
+typedef xnrwlock_t rtdm_rwlock_t;
+
+/**
+ * Dynamic lock initialisation
+ *
+ * @param lock Address of lock variable
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+#define rtdm_rwlock_init(lock)	xnrwlock_init(lock)
+
+/**
+ * Acquire lock for reading and disable preemption
+ *
+ * @param lock Address of lock variable
+ * @param context name of local variable to store the context in
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+#define rtdm_read_lock_irqsave(lock, context)			\
+	do {							\
+		xnrwlock_read_get_irqsave(lock, context);	\
+		__xnpod_lock_sched();				\
+	} while (0)
+
+/**
+ * Release read lock and restore preemption state
+ *
+ * @param lock Address of lock variable
+ * @param context name of local variable which stored the context
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: possible.
+ */
+#define rtdm_read_unlock_irqrestore(lock, context)		\
+	do {							\
+		__xnpod_unlock_sched();				\
+		xnrwlock_read_put_irqrestore(lock, context);	\
+	} while (0)
+
+/**
+ * Acquire lock for writing and disable preemption
+ *
+ * @param lock Address of lock variable
+ * @param context name of local variable to store the context in
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+#define rtdm_write_lock_irqsave(lock, context)			\
+	do {							\
+		xnrwlock_write_get_irqsave(lock, context);	\
+		__xnpod_lock_sched();				\
+	} while (0)
+
+/**
+ * Release write lock and restore preemption state
+ *
+ * @param lock Address of lock variable
+ * @param context name of local variable which stored the context
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: possible.
+ */
+#define rtdm_write_unlock_irqrestore(lock, context)		\
+	do {							\
+		__xnpod_unlock_sched();				\
+		xnrwlock_write_put_irqrestore(lock, context);	\
+	} while (0)
+/** @} Reader-Writer Spinlock with Preemption Deactivation */
+
+/*!
+ * @name Sequence Lock
+ *
+ * Readers of data protected by a sequence lock never write to shared
+ * memory: they snapshot the data, then retry if a writer updated it
+ * meanwhile. Writers serialize on a spinlock. This suits small,
+ * read-mostly data which readers copy out, such as calibration
+ * parameters; readers must not follow pointers which writers may
+ * invalidate.
+ *
+ * @code
+ * do {
+ *         seq = rtdm_read_seqbegin(&sl);
+ *         copy = shared;
+ * } while (rtdm_read_seqretry(&sl, seq));
+ * @endcode
+ * @{
+ */
+
+/** Sequence lock variable */
+typedef struct {
+	xnseqcount_t seq;
+	rtdm_lock_t lock;
+} rtdm_seqlock_t;
+
+/**
+ * Dynamic lock initialisation
+ *
+ * @param sl Address of lock variable
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+#define rtdm_seqlock_init(sl)				\
+	do {						\
+		xnseqcount_init(&(sl)->seq);		\
+		rtdm_lock_init(&(sl)->lock);		\
+	} while (0)
+
+/**
+ * Start a read section
+ *
+ * @param sl Address of lock variable
+ *
+ * @return A sequence value to be passed to rtdm_read_seqretry().
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+#define rtdm_read_seqbegin(sl)		xnread_seqcount_begin(&(sl)->seq)
+
+/**
+ * Check whether a read section has to be retried
+ *
+ * @param sl Address of lock variable
+ * @param start Sequence value returned by rtdm_read_seqbegin()
+ *
+ * @return Non-zero if a writer updated the data during the read
+ * section, in which case the data read is invalid.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+#define rtdm_read_seqretry(sl, start)	xnread_seqcount_retry(&(sl)->seq, start)
+
+/**
+ * Start a write section
+ *
+ * @param sl Address of lock variable
+ * @param context name of local variable to store the context in
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+#define rtdm_write_seqlock_irqsave(sl, context)			\
+	do {							\
+		rtdm_lock_get_irqsave(&(sl)->lock, context);	\
+		xnwrite_seqcount_begin(&(sl)->seq);		\
+	} while (0)
+
+/**
+ * End a write section
+ *
+ * @param sl Address of lock variable
+ * @param context name of local variable which stored the context
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: possible.
+ */
+#define rtdm_write_sequnlock_irqrestore(sl, context)			\
+	do {								\
+		xnwrite_seqcount_end(&(sl)->seq);			\
+		rtdm_lock_put_irqrestore(&(sl)->lock, context);	\
+	} while (0)
+/** @} Sequence Lock */
+
 /** @} rtdmsync */
 
 /* --- Interrupt management services --- */
@@ -864,6 +1276,12 @@ typedef xnintr_t rtdm_irq_t;
 /** Mark IRQ as edge-triggered, relevant for correct handling of shared
  *  edge-triggered IRQs */
 #define RTDM_IRQTYPE_EDGE		XN_ISR_EDGE
+/** Run the handler over a dedicated real-time thread, cannot be
+ *  combined with RTDM_IRQTYPE_SHARED */
+#define RTDM_IRQTYPE_THREADED		XN_ISR_THREADED
+/** Priority of the IRQ thread, to be or'ed to RTDM_IRQTYPE_THREADED
+ *  (defaults to RTDM_TASK_HIGHEST_PRIORITY if omitted) */
+#define RTDM_IRQTYPE_PRIO(prio)		XN_ISR_PRIO(prio)
 /** @} RTDM_IRQTYPE_xxx */
 
 /**
@@ -884,6 +1302,8 @@ typedef int (*rtdm_irq_handler_t)(rtdm_irq_t *irq_handle);
 #define RTDM_IRQ_NONE			XN_ISR_NONE
 /** Denote handled interrupt */
 #define RTDM_IRQ_HANDLED		XN_ISR_HANDLED
+/** Leave the IRQ line disabled on return, see rtdm_irqpoll_check() */
+#define RTDM_IRQ_NOENABLE		XN_ISR_NOENABLE
 /** @} RTDM_IRQ_xxx */
 
 /**
@@ -926,6 +1346,18 @@ static inline int rtdm_irq_disable(rtdm_irq_t *irq_handle)
 {
 	return xnintr_disable(irq_handle);
 }
+
+static inline void rtdm_irq_set_claim(rtdm_irq_t *irq_handle,
+				      rtdm_irq_handler_t claim)
+{
+	xnintr_set_claim(irq_handle, claim);
+}
+
+static inline void rtdm_irq_bind(rtdm_irq_t *irq_handle,
+				 xnthread_t *task, xntimer_t *timer)
+{
+	xnintr_bind(irq_handle, task, timer);
+}
 #endif /* !DOXYGEN_CPP */
 
 /* --- non-real-time signalling services --- */
@@ -1043,8 +1475,87 @@ static inline void rtdm_timer_stop_in_handler(rtdm_timer_t *timer)
 {
 	xntimer_stop(timer);
 }
+
+static inline void rtdm_timer_set_slack(rtdm_timer_t *timer,
+					nanosecs_rel_t slack)
+{
+	xntimer_set_slack(timer, slack);
+}
+#endif /* !DOXYGEN_CPP */
+
+/*!
+ * @addtogroup rtdmtimer
+ * @{
+ */
+
+struct rtdm_group_timer;
+
+/**
+ * Group timer handler
+ *
+ * @param[in] timer Group timer handle as passed to rtdm_group_timer_init()
+ */
+typedef void (*rtdm_group_timer_handler_t)(struct rtdm_group_timer *timer);
+
+/**
+ * Timer group statistics
+ */
+struct rtdm_timer_group_stats {
+	/** Shots of the group timer */
+	unsigned long ticks;
+	/** Handlers of member timers run */
+	unsigned long fired;
+	/** Periods skipped because the group fell behind */
+	unsigned long overruns;
+	/** Worst delay between the due date and the dispatch of a member */
+	nanosecs_rel_t maxlate;
+};
+
+/** @} rtdmtimer */
+
+#ifndef DOXYGEN_CPP /* Avoid broken doxygen output */
+typedef struct rtdm_timer_group {
+	xntimer_t master;	/* Single timer driving the members */
+	xnqueue_t members;	/* Started member timers, by phase */
+	xnholder_t *cursor;	/* Next member due in the current cycle */
+	nanosecs_rel_t period;
+	nanosecs_abs_t cycle;	/* Start date of the current cycle */
+	nanosecs_rel_t pos;	/* Phase last dispatched in the cycle */
+	int status;
+#define RTDM_TGROUP_RUNNING	0x1
+#define RTDM_TGROUP_DISPATCH	0x2
+	struct rtdm_timer_group_stats stats;
+} rtdm_timer_group_t;
+
+typedef struct rtdm_group_timer {
+	xnholder_t link;
+#define link2gtimer(ln)	container_of(ln, struct rtdm_group_timer, link)
+	rtdm_timer_group_t *group; /* NULL unless started */
+	nanosecs_rel_t phase;
+	rtdm_group_timer_handler_t handler;
+} rtdm_group_timer_t;
 #endif /* !DOXYGEN_CPP */
 
+int rtdm_timer_group_init(rtdm_timer_group_t *group, nanosecs_rel_t period,
+			  nanosecs_rel_t slack, const char *name);
+
+void rtdm_timer_group_destroy(rtdm_timer_group_t *group);
+
+int rtdm_timer_group_start(rtdm_timer_group_t *group, nanosecs_abs_t start);
+
+void rtdm_timer_group_stop(rtdm_timer_group_t *group);
+
+void rtdm_timer_group_get_stats(rtdm_timer_group_t *group,
+				struct rtdm_timer_group_stats *stats);
+
+void rtdm_group_timer_init(rtdm_group_timer_t *timer,
+			   rtdm_group_timer_handler_t handler);
+
+int rtdm_group_timer_start(rtdm_group_timer_t *timer,
+			   rtdm_timer_group_t *group, nanosecs_rel_t phase);
+
+void rtdm_group_timer_stop(rtdm_group_timer_t *timer);
+
 /* --- task services --- */
 /*!
  * @addtogroup rtdmtask
@@ -1081,6 +1592,9 @@ typedef void (*rtdm_task_proc_t)(void *arg);
 int rtdm_task_init(rtdm_task_t *task, const char *name,
 		   rtdm_task_proc_t task_proc, void *arg,
 		   int priority, nanosecs_rel_t period);
+int rtdm_task_init_cpu(rtdm_task_t *task, const char *name,
+		       rtdm_task_proc_t task_proc, void *arg,
+		       int priority, nanosecs_rel_t period, int cpu);
 int __rtdm_task_sleep(xnticks_t timeout, xntmode_t mode);
 void rtdm_task_busy_sleep(nanosecs_rel_t delay);
 
@@ -1254,6 +1768,170 @@ static inline void rtdm_mutex_destroy(rtdm_mutex_t *mutex)
 }
 #endif /* !DOXYGEN_CPP */
 
+/* --- reader-writer mutex services --- */
+
+typedef struct {
+	xnsynch_t synch_base;	/* Writer ownership, PI-protected. */
+	xnsynch_t drain;	/* Writer waiting for readers to leave. */
+	int readers;
+} rtdm_rwmutex_t;
+
+void rtdm_rwmutex_init(rtdm_rwmutex_t *rwmutex);
+int rtdm_rwmutex_timedrdlock(rtdm_rwmutex_t *rwmutex, nanosecs_rel_t timeout,
+			     rtdm_toseq_t *timeout_seq);
+int rtdm_rwmutex_timedwrlock(rtdm_rwmutex_t *rwmutex, nanosecs_rel_t timeout,
+			     rtdm_toseq_t *timeout_seq);
+void rtdm_rwmutex_unlock(rtdm_rwmutex_t *rwmutex);
+
+#ifndef DOXYGEN_CPP /* Avoid static inline tags for RTDM in doxygen */
+static inline int rtdm_rwmutex_rdlock(rtdm_rwmutex_t *rwmutex)
+{
+	return rtdm_rwmutex_timedrdlock(rwmutex, 0, NULL);
+}
+
+static inline int rtdm_rwmutex_wrlock(rtdm_rwmutex_t *rwmutex)
+{
+	return rtdm_rwmutex_timedwrlock(rwmutex, 0, NULL);
+}
+
+static inline void rtdm_rwmutex_destroy(rtdm_rwmutex_t *rwmutex)
+{
+	trace_mark(xn_rtdm, rwmutex_destroy, "rwmutex %p", rwmutex);
+
+	__rtdm_synch_flush(&rwmutex->drain, XNRMID);
+	__rtdm_synch_flush(&rwmutex->synch_base, XNRMID);
+}
+#endif /* !DOXYGEN_CPP */
+
+/* --- interrupt polling services --- */
+
+/*!
+ * @addtogroup rtdmirq
+ * @{
+ */
+
+struct rtdm_irqpoll;
+
+/**
+ * Polling handler
+ *
+ * @param[in] poll Polling context as passed to rtdm_irqpoll_init()
+ *
+ * @return A positive value if the device had pending events, 0
+ * otherwise
+ */
+typedef int (*rtdm_irqpoll_handler_t)(struct rtdm_irqpoll *poll);
+
+/**
+ * Interrupt polling statistics
+ */
+struct rtdm_irqpoll_stats {
+	/** Interrupts checked by rtdm_irqpoll_check() */
+	unsigned long irqs;
+	/** Runs of the polling handler */
+	unsigned long polls;
+	/** Switches from interrupt to polling mode */
+	unsigned long to_poll;
+	/** Switches from polling back to interrupt mode */
+	unsigned long to_irq;
+};
+
+/** Length of the window the interrupt rate is measured over (ns) */
+#define RTDM_IRQPOLL_WINDOW		10000000
+/** Consecutive idle polls before returning to interrupt mode */
+#define RTDM_IRQPOLL_IDLE		4
+
+/** @} rtdmirq */
+
+#ifndef DOXYGEN_CPP /* Avoid broken doxygen output */
+typedef struct rtdm_irqpoll {
+	rtdm_irq_t *irq_handle;
+	rtdm_irqpoll_handler_t handler;
+	const char *name;
+	rtdm_lock_t lock;
+	unsigned int limit;	/* IRQs allowed per window */
+	unsigned int count;	/* IRQs in the current window */
+	nanosecs_abs_t window;	/* Start date of the current window */
+	nanosecs_rel_t period;
+	int polling;
+	rtdm_task_t task;
+	rtdm_event_t wakeup;
+	struct rtdm_irqpoll_stats stats;
+	struct list_head link;
+} rtdm_irqpoll_t;
+#endif /* !DOXYGEN_CPP */
+
+int rtdm_irqpoll_init(rtdm_irqpoll_t *poll, rtdm_irq_t *irq_handle,
+		      rtdm_irqpoll_handler_t handler, unsigned int max_rate,
+		      nanosecs_rel_t period, int priority, const char *name);
+
+void rtdm_irqpoll_destroy(rtdm_irqpoll_t *poll);
+
+int rtdm_irqpoll_check(rtdm_irqpoll_t *poll);
+
+void rtdm_irqpoll_get_stats(rtdm_irqpoll_t *poll,
+			    struct rtdm_irqpoll_stats *stats);
+
+/* --- object caches --- */
+
+/*!
+ * @addtogroup util
+ * @{
+ */
+
+/**
+ * Object cache statistics
+ */
+struct rtdm_cache_stats {
+	/** Size of the cached objects */
+	size_t objsize;
+	/** Free objects held by the cache */
+	unsigned long cached;
+	/** Objects handed out by rtdm_cache_alloc() */
+	unsigned long allocs;
+	/** Objects returned via rtdm_cache_free() */
+	unsigned long frees;
+	/** Per-CPU lists refilled from the depot or the system heap */
+	unsigned long refills;
+	/** Per-CPU lists drained to the depot or the system heap */
+	unsigned long drains;
+	/** Allocations which could not be served */
+	unsigned long failures;
+};
+
+/** Number of objects moved at once between a per-CPU list and the
+ * shared depot or the system heap */
+#define RTDM_CACHE_BATCH		16
+
+/** @} util */
+
+#ifndef DOXYGEN_CPP /* Avoid broken doxygen output */
+struct rtdm_cache_cpu;
+
+typedef struct rtdm_cache {
+	size_t objsize;
+	unsigned int capacity;	/* Free objects kept in the depot */
+	struct rtdm_cache_cpu *cpus;
+	void *depot;		/* Shared free list */
+	unsigned int ndepot;
+	rtdm_lock_t lock;	/* Protects the depot */
+	const char *name;
+	struct list_head link;
+} rtdm_cache_t;
+#endif /* !DOXYGEN_CPP */
+
+int rtdm_cache_create(rtdm_cache_t *cache, const char *name,
+		      size_t objsize, unsigned int capacity);
+
+void rtdm_cache_destroy(rtdm_cache_t *cache);
+
+void *rtdm_cache_alloc(rtdm_cache_t *cache);
+
+void rtdm_cache_free(rtdm_cache_t *cache, void *obj);
+
+void rtdm_cache_get_stats(rtdm_cache_t *cache,
+			  struct rtdm_cache_stats *stats);
+
 /* --- utility functions --- */
 
 #define rtdm_printk(format, ...)	printk(format, ##__VA_ARGS__)
@@ -0,0 +1,210 @@
+/**
+ * @file
+ * Real-Time Driver Model for Xenomai, file data device profile header
+ *
+ * Xenomai is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * @ingroup rtfile
+ */
+
+/*!
+ * @ingroup profiles
+ * @defgroup rtfile File Data Devices
+ *
+ * File data devices serve the contents of regular files or block
+ * device ranges to real-time tasks, without switching them to
+ * secondary mode. The data is preloaded into kernel memory from
+ * non-RT context by @ref RTFILE_RTIOC_LOAD, then read from primary
+ * mode with @c read, @ref RTFILE_RTIOC_SEEK, or mapped with
+ * @ref RTFILE_RTIOC_MMAP.
+ *
+ * Reloads happen in the background, either on request or when the
+ * file is found to have changed. A new image is read aside and
+ * replaces the previous one atomically. Each open instance keeps
+ * reading the image it started with until it seeks, and mappings keep
+ * the image they were created on, so that readers never observe a
+ * partially updated file.
+ *
+ * @b Profile @b Revision: 1
+ * @n
+ * @n
+ * @par Device Characteristics
+ * @ref rtdm_device.device_flags "Device Flags": @c RTDM_NAMED_DEVICE @n
+ * @n
+ * @ref rtdm_device.device_name "Device Name": @c "rtfile<N>", N >= 0 @n
+ * @n
+ * @ref rtdm_device.device_class "Device Class": @c RTDM_CLASS_FILE @n
+ * @n
+ *
+ * @par Supported Operations
+ * @b Open @n
+ * Environments: non-RT (RT optional)@n
+ * Specific return values: none @n
+ * @n
+ * @b Close @n
+ * Environments: non-RT (RT optional)@n
+ * Specific return values: none @n
+ * @n
+ * @b Read @n
+ * Environments: RT (non-RT optional)@n
+ * Specific return values:
+ * - -ENODATA (no file loaded on the device)
+ * .
+ * @n
+ * @b IOCTL @n
+ * Mandatory Environments: see @ref FILEIOCTLs below @n
+ * Specific return values: see @ref FILEIOCTLs below @n
+ *
+ * @{
+ */
+
+#ifndef _RTFILE_H
+#define _RTFILE_H
+
+#include <rtdm/rtdm.h>
+
+#define RTFILE_PROFILE_VER		1
+
+/** Load parameters, see @ref RTFILE_RTIOC_LOAD. */
+typedef struct rtfile_load {
+	/** Path of a regular file or a block device. */
+	const char *path;
+	/** Start of the range to load, in bytes. */
+	unsigned long long offset;
+	/** Length of the range, 0 for up to the end of file. */
+	unsigned long long length;
+	/** Change detection period in milliseconds, 0 to disable. */
+	unsigned int watch_ms;
+} rtfile_load_t;
+
+/** Seek request, see @ref RTFILE_RTIOC_SEEK. */
+typedef struct rtfile_seek {
+	/** Offset, then resulting position on return. */
+	long long offset;
+	/** SEEK_SET, SEEK_CUR or SEEK_END. */
+	int whence;
+} rtfile_seek_t;
+
+/** Device state, see @ref RTFILE_RTIOC_INFO. */
+typedef struct rtfile_info {
+	/** Size of the image the caller reads from. */
+	unsigned long long size;
+	/** Generation of that image. */
+	unsigned long generation;
+	/** Generation of the latest image loaded. */
+	unsigned long latest;
+	/** Successful (re)loads. */
+	unsigned long loads;
+	/** Failed background reloads. */
+	unsigned long failures;
+} rtfile_info_t;
+
+/** Mapping descriptor, see @ref RTFILE_RTIOC_MMAP. */
+typedef struct rtfile_mmap {
+	/** Address of the mapping. */
+	void *ptr;
+	/** Size of the file data. */
+	unsigned long long size;
+	/** Generation of the mapped image. */
+	unsigned long generation;
+} rtfile_mmap_t;
+
+#define RTIOC_TYPE_FILE			RTDM_CLASS_FILE
+
+/*!
+ * @name Sub-Classes of RTDM_CLASS_FILE
+ * @{ */
+#define RTDM_SUBCLASS_FILECACHE		0
+/** @} */
+
+/*!
+ * @anchor FILEIOCTLs @name IOCTLs
+ * File data device IOCTLs
+ * @{ */
+
+/**
+ * Load a file, or a range of it, replacing any previous one.
+ *
+ * @param[in] arg Pointer to a @ref rtfile_load structure.
+ *
+ * @return 0 on success, otherwise:
+ * - -EINVAL (invalid range)
+ * - -EFBIG (range larger than the driver limit)
+ * - -ENOMEM (out of memory)
+ * - any error from opening or reading the file
+ *
+ * Environments: non-RT only.
+ */
+#define RTFILE_RTIOC_LOAD		_IOW(RTIOC_TYPE_FILE, 0x00, struct rtfile_load)
+
+/**
+ * Reload the file now, whether it changed or not.
+ *
+ * @return 0 on success, -ENODATA if no file is loaded, or any error
+ * from reading the file.
+ *
+ * Environments: non-RT only.
+ */
+#define RTFILE_RTIOC_RELOAD		_IO(RTIOC_TYPE_FILE, 0x01)
+
+/**
+ * Drop the file. Readers and mappings keep their image until they
+ * release it.
+ *
+ * Environments: non-RT only.
+ */
+#define RTFILE_RTIOC_UNLOAD		_IO(RTIOC_TYPE_FILE, 0x02)
+
+/**
+ * Set the read position. Seeking switches the caller to the latest
+ * image.
+ *
+ * @param[in,out] arg Pointer to a @ref rtfile_seek structure.
+ *
+ * @return 0 on success, otherwise:
+ * - -EINVAL (invalid whence or resulting position)
+ * - -ENODATA (no file loaded)
+ *
+ * Environments: RT or non-RT.
+ */
+#define RTFILE_RTIOC_SEEK		_IOWR(RTIOC_TYPE_FILE, 0x10, struct rtfile_seek)
+
+/**
+ * Get the device state.
+ *
+ * @param[out] arg Pointer to a @ref rtfile_info structure.
+ *
+ * Environments: RT or non-RT.
+ */
+#define RTFILE_RTIOC_INFO		_IOR(RTIOC_TYPE_FILE, 0x11, struct rtfile_info)
+
+/**
+ * Map the latest image read-only into the caller's address space.
+ * The image stays valid until unmapped, even across reloads.
+ *
+ * @param[out] arg Pointer to a @ref rtfile_mmap structure.
+ *
+ * @return 0 on success, -ENODATA if no file is loaded, or any error
+ * from rtdm_mmap_to_user().
+ *
+ * Environments: non-RT only.
+ */
+#define RTFILE_RTIOC_MMAP		_IOR(RTIOC_TYPE_FILE, 0x12, struct rtfile_mmap)
+
+/** @} */
+
+/** @} */
+
+#endif /* !_RTFILE_H */
@@ -285,7 +285,9 @@ int getsockopt__AF_RTIPC(int sockfd, int level, int optname,
  *
  * @return In addition to the standard error codes for @c sendmsg(2),
  * the following specific error code may be returned:
- * none.
+ * - -ENOBUFS (@ref IPCPROTO_IDDP multicast group over quota, see
+ *   @ref IDDP_MULTICAST)
+ * .
  *
  * @par Calling context:
  * RT
@@ -464,6 +466,67 @@ struct sockaddr_ipc {
 	rtipc_port_t sipc_port;
 };
 
+/**
+ * Zero-copy buffer descriptor.
+ *
+ * Describes a datagram received on an IDDP socket running in
+ * zero-copy mode (see @ref IDDP_ZEROCOPY).
+ */
+struct rtipc_zcbuf {
+	/** Offset of the datagram data in the mapped pool. */
+	unsigned long offset;
+	/** Length of the datagram data. */
+	size_t len;
+};
+
+/**
+ * Pool mapping information structure.
+ *
+ * Gives the information needed to map the local pool of an IDDP
+ * socket running in zero-copy mode (see @ref IDDP_ZEROCOPY).
+ */
+struct rtipc_pool_info {
+	/** Pool handle, to be passed to the heap device. */
+	unsigned long handle;
+	/** Size of the memory area to map. */
+	size_t size;
+	/** Mapping offset of the memory area. */
+	unsigned long area;
+};
+
+/**
+ * Pool accounting structure.
+ *
+ * Reports the memory consumption of an XDDP or IDDP socket wrt the
+ * pool it draws its buffers from (see @ref XDDP_POOLSTAT, @ref
+ * IDDP_POOLSTAT).
+ */
+struct rtipc_pool_stats {
+	/** Current size of the local pool, zero if the system heap is used. */
+	size_t poolsz;
+	/** Memory currently held for the socket's buffers. */
+	size_t used;
+	/** Highest value of @a used since the socket was created. */
+	size_t peak;
+	/** Number of buffer allocations which could not be served. */
+	unsigned long failures;
+};
+
+/**
+ * Wakeup watermark structure.
+ *
+ * Defines when the non real-time reader of an XDDP port may be woken
+ * up (see @ref XDDP_WMARK).
+ */
+struct xddp_wmark {
+	/** Byte threshold, 0 if unused. */
+	unsigned long bytes;
+	/** Message threshold, 0 if unused. */
+	unsigned long msgs;
+	/** Maximum wakeup delay (in nanoseconds). */
+	unsigned long latency;
+};
+
 #define SOL_XDDP		311
 /**
  * @anchor sockopts_xddp @name XDDP socket options
@@ -582,7 +645,7 @@ struct sockaddr_ipc {
  *
  * - -EFAULT (Invalid data address given)
  * - -ENOMEM (Not enough memory)
- * - -EINVAL (@a optlen is invalid)
+ * - -EINVAL (@a optlen is invalid, or the mapped ring is enabled)
  * .
  *
  * @par Calling context:
@@ -628,6 +691,133 @@ struct sockaddr_ipc {
  * RT/non-RT, kernel space only
  */
 #define XDDP_MONITOR		4
+/**
+ * XDDP mapped ring configuration
+ *
+ * By default, the non real-time endpoint gets each datagram copied
+ * by a read(2) call on /dev/rtp@em N. Setting a non-zero ring size
+ * enables the mapped ring mode instead: the local pool is made
+ * mappable, and a ring of descriptors is set up in it at binding
+ * time, so that the Linux reader may consume the datagrams in place.
+ *
+ * The reader switches to this mode by issuing the XNPIPEIOC_MAP_RING
+ * request on /dev/rtp@em N, then maps the pool through /dev/rtheap
+ * according to the returned information (see nucleus/pipe.h). From
+ * that point, read(2) is not available on the pipe anymore;
+ * datagrams are published to the ring as they are sent, consumed by
+ * moving the ring tail, and handed back to the pool in batches,
+ * either by XNPIPEIOC_RELEASE or upon the next poll(2) call.
+ *
+ * The mapped ring requires a local pool (see @ref XDDP_POOLSZ), and
+ * excludes the streaming mode (see @ref XDDP_BUFSZ). It is not
+ * allowed to configure the ring after the socket was bound.
+ *
+ * @param [in] level @ref sockopts_xddp "SOL_XDDP"
+ * @param [in] optname @b XDDP_RING
+ * @param [in] optval Pointer to a variable of type size_t, containing
+ * the number of descriptors in the ring, zero disabling the mode
+ * @param [in] optlen sizeof(size_t)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EALREADY (socket already bound)
+ * - -EINVAL (@a optlen is invalid, or a streaming buffer is set)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define XDDP_RING		5
+/**
+ * XDDP wakeup watermark configuration
+ *
+ * By default, the non real-time reader sleeping on /dev/rtp@em N is
+ * woken up for each datagram sent to the port. Setting a watermark
+ * coalesces those wakeups: the reader is only woken up once the data
+ * sent since it went to sleep reaches the byte or message threshold,
+ * or when the latency delay has elapsed since the first of those
+ * datagrams was sent, whichever comes first. Zero thresholds restore
+ * the default behavior.
+ *
+ * The same setting is available to the non real-time side through
+ * the XNPIPEIOC_SET_WMARK request on /dev/rtp@em N. The resulting
+ * coalescing ratio is reported by /proc/xenomai/pipes.
+ *
+ * @param [in] level @ref sockopts_xddp "SOL_XDDP"
+ * @param [in] optname @b XDDP_WMARK
+ * @param [in] optval Pointer to a variable of type struct xddp_wmark
+ * @param [in] optlen sizeof(struct xddp_wmark)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EINVAL (@a optlen is invalid, or a threshold is set with a
+ *   zero latency)
+ * - -ENOTCONN (socket not bound)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define XDDP_WMARK		6
+/**
+ * XDDP elastic pool configuration
+ *
+ * Turns the local pool of the socket (see @ref XDDP_POOLSZ) into an
+ * elastic pool, which is extended by chunks of the initial pool size
+ * from a non real-time worker, before it runs out of memory, until
+ * its size reaches the given limit. A zero limit, the default, keeps
+ * the pool size fixed. Extensions are triggered when less than a
+ * quarter of a chunk remains available, or upon allocation failure;
+ * senders may still stall until the extension is effective.
+ *
+ * This setting has no effect on sockets drawing from the system
+ * heap, nor on local pools shared with user-space.
+ *
+ * It is not allowed to change the limit after the socket was bound.
+ *
+ * @param [in] level @ref sockopts_xddp "SOL_XDDP"
+ * @param [in] optname @b XDDP_POOLMAX
+ * @param [in] optval Pointer to a variable of type size_t, containing
+ * the maximum size the local pool may grow to
+ * @param [in] optlen sizeof(size_t)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EALREADY (socket already bound)
+ * - -EINVAL (@a optlen invalid)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define XDDP_POOLMAX		7
+/**
+ * XDDP pool accounting
+ *
+ * Returns the memory consumption of the socket, i.e. the current and
+ * peak amount of memory held for its buffers, and the number of
+ * buffer allocations which failed. The same figures are reported for
+ * all sockets by /proc/xenomai/rtipc/pools. This option may only be
+ * read.
+ *
+ * @param [in] level @ref sockopts_xddp "SOL_XDDP"
+ * @param [in] optname @b XDDP_POOLSTAT
+ * @param [out] optval Pointer to a struct rtipc_pool_stats
+ * @param [in] optlen sizeof(struct rtipc_pool_stats)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EINVAL (@a optlen invalid)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define XDDP_POOLSTAT		8
 /** @} */
 
 /**
@@ -745,6 +935,196 @@ struct sockaddr_ipc {
  * RT/non-RT
  */
 #define IDDP_POOLSZ		2
+/**
+ * IDDP zero-copy receive mode
+ *
+ * In zero-copy mode, received datagrams are not copied to the
+ * caller's buffer. Instead, @c recvmsg(2) and @c read(2) store a
+ * struct rtipc_zcbuf descriptor into the first I/O vector cell or
+ * the user buffer, giving the location of the datagram in the local
+ * pool, and return the datagram length. Datagrams are never read
+ * partially in this mode. The buffer shall be handed back to the pool
+ * with the @ref IDDP_RTIOC_RELEASE request once consumed.
+ *
+ * The local pool must be configured via @ref IDDP_POOLSZ, and is made
+ * shareable with user-space when the socket is bound. Once bound,
+ * getsockopt() on this option returns a struct rtipc_pool_info,
+ * which can be used to map the pool by opening the heap device
+ * (/dev/rtheap), issuing ioctl(fd, 0, @a handle) then mmap(NULL, @a
+ * size, PROT_READ, MAP_SHARED, fd, @a area).
+ *
+ * It is not allowed to change this mode after the socket was bound.
+ *
+ * @param [in] level @ref sockopts_iddp "SOL_IDDP"
+ * @param [in] optname @b IDDP_ZEROCOPY
+ * @param [in] optval Pointer to an int variable, non-zero to enable
+ * zero-copy receive mode, zero to disable it. When getting this
+ * option, pointer to a struct rtipc_pool_info
+ * @param [in] optlen sizeof(int), or sizeof(struct rtipc_pool_info)
+ * when getting this option
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EALREADY (socket already bound)
+ * - -EINVAL (@a optlen is invalid, or zero-copy mode is not active
+ * on a bound socket when getting this option)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define IDDP_ZEROCOPY		3
+/**
+ * IDDP elastic pool configuration
+ *
+ * Turns the local pool of the socket (see @ref IDDP_POOLSZ) into an
+ * elastic pool, which is extended by chunks of the initial pool size
+ * from a non real-time worker, before it runs out of memory, until
+ * its size reaches the given limit. A zero limit, the default, keeps
+ * the pool size fixed. Extensions are triggered when less than a
+ * quarter of a chunk remains available, or upon allocation failure;
+ * senders may still stall until the extension is effective.
+ *
+ * This setting has no effect on sockets drawing from the system
+ * heap, nor on local pools shared with user-space.
+ *
+ * It is not allowed to change the limit after the socket was bound.
+ *
+ * @param [in] level @ref sockopts_iddp "SOL_IDDP"
+ * @param [in] optname @b IDDP_POOLMAX
+ * @param [in] optval Pointer to a variable of type size_t, containing
+ * the maximum size the local pool may grow to
+ * @param [in] optlen sizeof(size_t)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EALREADY (socket already bound)
+ * - -EINVAL (@a optlen invalid)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define IDDP_POOLMAX		4
+/**
+ * IDDP pool accounting
+ *
+ * Returns the memory consumption of the socket, i.e. the current and
+ * peak amount of memory held for its buffers, and the number of
+ * buffer allocations which failed. The same figures are reported for
+ * all sockets by /proc/xenomai/rtipc/pools. This option may only be
+ * read.
+ *
+ * @param [in] level @ref sockopts_iddp "SOL_IDDP"
+ * @param [in] optname @b IDDP_POOLSTAT
+ * @param [out] optval Pointer to a struct rtipc_pool_stats
+ * @param [in] optlen sizeof(struct rtipc_pool_stats)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EINVAL (@a optlen invalid)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define IDDP_POOLSTAT		5
+/**
+ * IDDP multicast group
+ *
+ * Turns the socket into a multicast group, once bound. Datagrams
+ * sent to the port of a group socket are copied once, then delivered
+ * to every socket which joined the group (see @ref IDDP_JOIN), as
+ * regular datagrams from the sender's port. The storage is released
+ * when the last member has read the data. Datagrams sent to a group
+ * without members are dropped.
+ *
+ * Multicast datagrams are always drawn from Xenomai's system pool, so
+ * a group socket may not run in zero-copy mode. The storage unread
+ * datagrams may hold there is bounded by a per-group quota, which
+ * defaults to CONFIG_XENO_OPT_IDDP_MCAST_QUOTA kilobytes, or the size
+ * set with @ref IDDP_POOLSZ on the group socket, which gets no local
+ * pool. Sending to a group over quota fails with -ENOBUFS. A group
+ * socket receives no data by itself, reading from it returns
+ * -EOPNOTSUPP. Closing a group socket detaches its members,
+ * which keep the datagrams already queued to them.
+ *
+ * It is not allowed to change this mode after the socket was bound.
+ *
+ * @param [in] level @ref sockopts_iddp "SOL_IDDP"
+ * @param [in] optname @b IDDP_MULTICAST
+ * @param [in] optval Pointer to an int variable, non-zero to make the
+ * socket a multicast group, zero otherwise
+ * @param [in] optlen sizeof(int)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EALREADY (socket already bound)
+ * - -EINVAL (@a optlen invalid)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define IDDP_MULTICAST		6
+/**
+ * IDDP multicast group membership
+ *
+ * Makes a bound socket a member of the multicast group bound to the
+ * given port (see @ref IDDP_MULTICAST), or leaves the current group
+ * if the port number is -1. A socket may be member of a single group
+ * at a time; it still receives the datagrams sent to its own port
+ * meanwhile. Sockets running in zero-copy mode may not join a group.
+ * When getting this option, the port of the current group is
+ * returned, or -1.
+ *
+ * @param [in] level @ref sockopts_iddp "SOL_IDDP"
+ * @param [in] optname @b IDDP_JOIN
+ * @param [in] optval Pointer to a variable of type int, containing
+ * the port number of the group
+ * @param [in] optlen sizeof(int)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EINVAL (@a optlen or port number invalid, socket unbound,
+ * running in zero-copy mode or being a group itself)
+ * - -ECONNREFUSED (no multicast group bound at this port)
+ * - -EISCONN (socket already member of a group)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define IDDP_JOIN		7
+/** @} */
+
+/**
+ * @anchor ioctls_iddp @name IDDP I/O control requests
+ * @{ */
+/**
+ * Release a zero-copy IDDP buffer
+ *
+ * Hands a datagram received in zero-copy mode back to the local pool
+ * of the socket (see @ref IDDP_ZEROCOPY).
+ *
+ * @param [in] arg Pointer to the struct rtipc_zcbuf descriptor
+ * returned by the receive call
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EINVAL (the descriptor does not match any outstanding buffer)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define IDDP_RTIOC_RELEASE	_IOW(RTDM_CLASS_RTIPC, 0x00, struct rtipc_zcbuf)
 /** @} */
 
 #define SOL_BUFP		313
@@ -814,6 +1194,108 @@ struct sockaddr_ipc {
  * RT/non-RT
  */
 #define BUFP_BUFSZ		2
+/**
+ * BUFP fan-out mode
+ *
+ * Turns the buffer of a BUFP socket into a ring shared by multiple
+ * readers, each of them being a distinct socket subscribed to the
+ * ring (see @ref BUFP_SUBSCRIBE). Data written to the port is copied
+ * once into the ring, and every subscriber consumes it through its
+ * own read cursor. Data written while no reader is subscribed is
+ * discarded; a new subscriber only receives the data written after
+ * it subscribed. The socket owning the ring may not read from it.
+ *
+ * The following values are accepted:
+ *
+ * - BUFP_FANOUT_BLOCK: writers wait for the slowest reader to free
+ * enough room in the ring.
+ *
+ * - BUFP_FANOUT_DROP: writers never wait for readers; a reader which
+ * lags so much that the incoming data would not fit in the ring
+ * drops all the data it has not consumed yet, resuming from the
+ * current write position (see @ref BUFP_DROPPED).
+ *
+ * - 0 disables the fan-out mode, which is the default.
+ *
+ * It is not allowed to change the fan-out mode after the socket was
+ * bound.
+ *
+ * @param [in] level @ref sockopts_bufp "SOL_BUFP"
+ * @param [in] optname @b BUFP_FANOUT
+ * @param [in] optval Pointer to a variable of type int, containing
+ * the fan-out mode
+ * @param [in] optlen sizeof(int)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EALREADY (socket already bound)
+ * - -EINVAL (@a optlen is invalid or *@a optval is not a valid mode)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define BUFP_FANOUT		3
+/**
+ * BUFP fan-out subscription
+ *
+ * Subscribes an unbound BUFP socket to the ring of a BUFP port
+ * running in fan-out mode (see @ref BUFP_FANOUT). Once subscribed,
+ * the socket receives the data sent to that port, until either end
+ * is closed. Reading from a subscriber whose ring went away returns
+ * -ECONNRESET.
+ *
+ * @param [in] level @ref sockopts_bufp "SOL_BUFP"
+ * @param [in] optname @b BUFP_SUBSCRIBE
+ * @param [in] optval Pointer to a variable of type int, containing
+ * the port number to subscribe to, or -1 for the default destination
+ * set by connect(), which allows subscribing to a labeled port (see
+ * @ref BUFP_LABEL)
+ * @param [in] optlen sizeof(int)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EINVAL (@a optlen or port number invalid)
+ * - -ECONNREFUSED (no port bound in fan-out mode at this address)
+ * - -EISCONN (socket already bound or subscribed)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define BUFP_SUBSCRIBE		4
+/**
+ * BUFP fan-out drop count
+ *
+ * Returns the number of bytes a subscriber dropped since it
+ * subscribed, when lagging behind a ring in BUFP_FANOUT_DROP mode.
+ * This option can only be read.
+ *
+ * @param [in] level @ref sockopts_bufp "SOL_BUFP"
+ * @param [in] optname @b BUFP_DROPPED
+ * @param [out] optval Pointer to a variable of type unsigned long
+ * @param [in] optlen sizeof(unsigned long)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EINVAL (@a optlen invalid)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define BUFP_DROPPED		5
+/** @} */
+
+/**
+ * @anchor BUFP_FANOUT_MODES @name BUFP fan-out modes
+ * Values of the @ref BUFP_FANOUT socket option.
+ * @{ */
+#define BUFP_FANOUT_BLOCK	1
+#define BUFP_FANOUT_DROP	2
 /** @} */
 
 /**
@@ -61,6 +61,7 @@
  * - -EAGAIN (no data available in non-blocking mode)
  * - -EBADF (device has been closed while reading)
  * - -EIO (hardware error or broken bit stream)
+ * - -EBUSY (the rings are mapped, see @ref RTSER_RTIOC_MAP_RING)
  * .
  * @n
  * @b Write @n
@@ -70,6 +71,7 @@
  * - -EINTR (interrupted explicitly or by signal)
  * - -EAGAIN (no data written in non-blocking mode)
  * - -EBADF (device has been closed while writing)
+ * - -EBUSY (the rings are mapped, see @ref RTSER_RTIOC_MAP_RING)
  *
  * @{
  */
@@ -247,6 +249,17 @@
  * @{ */
 #define RTSER_BREAK_CLR			0x00
 #define RTSER_BREAK_SET			0x01
+/** @} */
+
+/*!
+ * @anchor RTSER_RING_xxx   @name RTSER_RING_xxx
+ * Mapped ring synchronisation, see @ref RTSER_RTIOC_SYNC_RING
+ * @{ */
+/** start transmitting the bytes queued in the TX ring */
+#define RTSER_RING_KICK_TX		0x01
+/** wait for the RX ring to reach its watermark */
+#define RTSER_RING_WAIT_RX		0x02
+/** @} */
 
 
 /**
@@ -326,6 +339,54 @@ typedef struct rtser_event {
 	nanosecs_abs_t	rxpend_timestamp;
 } rtser_event_t;
 
+/**
+ * Control block at the start of a mapped ring area
+ *
+ * All indices are free-running byte counters, the offset of a byte
+ * into its ring is obtained by masking the index with the ring size
+ * minus one. The driver only advances @c rx_tail and @c tx_head, the
+ * application only @c rx_head and @c tx_tail.
+ */
+typedef struct rtser_ring_ctl {
+	/** next RX byte to be consumed by the application */
+	volatile unsigned int rx_head;
+
+	/** next RX byte to be stored by the driver */
+	volatile unsigned int rx_tail;
+
+	/** next TX byte to be sent by the driver */
+	volatile unsigned int tx_head;
+
+	/** next TX byte to be queued by the application */
+	volatile unsigned int tx_tail;
+
+	/** size of the RX ring in bytes (power of 2) */
+	unsigned int	rx_size;
+
+	/** size of the TX ring in bytes (power of 2) */
+	unsigned int	tx_size;
+
+	/** offset of the RX ring from the start of the control block */
+	unsigned int	rx_offset;
+
+	/** offset of the TX ring from the start of the control block */
+	unsigned int	tx_offset;
+} rtser_ring_ctl_t;
+
+/**
+ * Mapped ring request, see @ref RTSER_RTIOC_MAP_RING
+ */
+typedef struct rtser_ring_map {
+	/** [in] pending RX bytes which wake up @ref RTSER_RING_WAIT_RX */
+	int		rx_watermark;
+
+	/** [out] length of the mapped area */
+	size_t		size;
+
+	/** [out] user address of the control block */
+	struct rtser_ring_ctl *ctl;
+} rtser_ring_map_t;
+
 
 #define RTIOC_TYPE_SERIAL		RTDM_CLASS_SERIAL
 
@@ -507,6 +568,89 @@ typedef struct rtser_event {
  */
 #define RTSER_RTIOC_BREAK_CTL	\
 	_IOR(RTIOC_TYPE_SERIAL, 0x06, int)
+
+/**
+ * Map the RX and TX rings into the caller's address space
+ *
+ * Switches the device to mapped-ring mode: received bytes are stored
+ * straight into the shared RX ring and transmitted bytes are fetched from
+ * the shared TX ring, the application moving data in and out by updating
+ * the indices of struct rtser_ring_ctl. read() and write() fail with
+ * -EBUSY while the rings are mapped. Pending data is purged.
+ *
+ * @param[in,out] arg Pointer to a mapping request (struct rtser_ring_map)
+ *
+ * @return 0 on success, otherwise:
+ *
+ * - -EBUSY is returned if the rings are already mapped, or a reader or
+ * writer is currently blocked on the device.
+ *
+ * - -EINVAL is returned if the watermark is not within the RX ring size.
+ *
+ * - -ENOMEM is returned if the ring area could not be allocated or mapped.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - User-space task (non-RT)
+ *
+ * Rescheduling: possible.
+ */
+#define RTSER_RTIOC_MAP_RING	\
+	_IOWR(RTIOC_TYPE_SERIAL, 0x07, struct rtser_ring_map)
+
+/**
+ * Unmap the RX and TX rings, returning to copy mode
+ *
+ * @return 0 on success, otherwise:
+ *
+ * - -EINVAL is returned if the rings are not mapped.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - User-space task (non-RT)
+ *
+ * Rescheduling: possible.
+ */
+#define RTSER_RTIOC_UNMAP_RING	\
+	_IO(RTIOC_TYPE_SERIAL, 0x08)
+
+/**
+ * Synchronise with the mapped rings
+ *
+ * @param[in] arg Mask of @ref RTSER_RING_xxx operations (int).
+ * @c RTSER_RING_KICK_TX starts transmitting the bytes queued since the last
+ * kick, @c RTSER_RING_WAIT_RX then blocks until at least the configured
+ * watermark of bytes is pending in the RX ring, honouring the receive
+ * timeout.
+ *
+ * @return Number of pending RX bytes on success, otherwise:
+ *
+ * - -EINVAL is returned if the rings are not mapped.
+ *
+ * - -EBUSY is returned if another task is already waiting on the RX ring.
+ *
+ * - -ETIMEDOUT, -EAGAIN or -EINTR are returned if the wait ended before
+ * the watermark was reached.
+ *
+ * - -EIO or -EPIPE are returned on line errors, like read() does.
+ *
+ * - -EBADF is returned if the device has just been closed.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel-based task
+ * - User-space task (RT)
+ *
+ * Rescheduling: possible.
+ */
+#define RTSER_RTIOC_SYNC_RING	\
+	_IOW(RTIOC_TYPE_SERIAL, 0x09, int)
 /** @} */
 
 /*!
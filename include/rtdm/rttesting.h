@@ -29,7 +29,7 @@
  * Feel free to comment on this profile via the Xenomai mailing list
  * (xenomai@xenomai.org) or directly to the author (jan.kiszka@web.de).
  *
- * @b Profile @b Revision: 2
+ * @b Profile @b Revision: 7
  * @n
  * @n
  * @par Device Characteristics
@@ -62,7 +62,7 @@
 
 #include <rtdm/rtdm.h>
 
-#define RTTST_PROFILE_VER		2
+#define RTTST_PROFILE_VER		7
 
 typedef struct rttst_bench_res {
 	long long avg;
@@ -97,8 +97,101 @@ typedef struct rttst_tmbench_config {
 	int histogram_size;
 	int histogram_bucketsize;
 	int freeze_max;
+	int flags;
+	int cpu;	/* Only with RTTST_TMBENCH_CPU. */
 } rttst_tmbench_config_t;
 
+/* Possible values for struct rttst_tmbench_config::flags. */
+#define RTTST_TMBENCH_HDR		0x1 /* Record a log-linear histogram. */
+#define RTTST_TMBENCH_CPU		0x2 /* Pin the task to config.cpu. */
+#define RTTST_TMBENCH_PHASES		0x4 /* Break latencies down. */
+
+/*
+ * Latency phases, as stamped by the nucleus on the way from the
+ * timer interrupt to the sampling code. The handler mode only goes
+ * through the first three, the time from the timer handler to the
+ * sample being charged to RTTST_PHASE_HANDLER.
+ */
+#define RTTST_PHASE_IRQ			0 /* Due date to clock handler. */
+#define RTTST_PHASE_CLOCK		1 /* Clock handler to timer handler. */
+#define RTTST_PHASE_HANDLER		2 /* Timer handler to rescheduling. */
+#define RTTST_PHASE_SWITCH		3 /* Rescheduling to resumption. */
+#define RTTST_PHASE_WAKEUP		4 /* Resumption to sampling code. */
+#define RTTST_NR_PHASES			5
+
+#define RTTST_PHASE_BUCKETS		32 /* log2-scaled, in ns */
+
+typedef struct rttst_phase_stats {
+	unsigned long long samples;	/* Samples broken down. */
+	unsigned long long skipped;	/* Samples with unusable stamps. */
+	/*
+	 * Bucket #n counts durations in [2^(n-1), 2^n) ns. The timer
+	 * is programmed ahead of the due date to compensate for the
+	 * intrinsic latency, so that RTTST_PHASE_IRQ may be negative;
+	 * such durations are counted in bucket #0.
+	 */
+	unsigned long long counts[RTTST_NR_PHASES][RTTST_PHASE_BUCKETS];
+	long long sum[RTTST_NR_PHASES];
+	long max[RTTST_NR_PHASES];
+	/* Breakdown of the worst latency seen. */
+	long worst;
+	long worst_phases[RTTST_NR_PHASES];
+} rttst_phase_stats_t;
+
+/* Sample taken in user-space, both dates are TSC values. */
+typedef struct rttst_phase_sample {
+	unsigned long long date;	/* Expected wakeup date. */
+	unsigned long long now;		/* Actual sampling date. */
+} rttst_phase_sample_t;
+
+/*
+ * Log-linear ("HDR") latency histogram. Values below
+ * 2^RTTST_HDR_SUB_BITS ns are counted exactly, larger ones in buckets
+ * which width doubles with each power of two, which bounds the
+ * relative error to 2^-(RTTST_HDR_SUB_BITS - 1), i.e. below 1.6%. Any
+ * value up to 2^32 - 1 ns is covered, larger ones are clamped.
+ */
+#define RTTST_HDR_SUB_BITS		7
+#define RTTST_HDR_HALF			(1 << (RTTST_HDR_SUB_BITS - 1))
+#define RTTST_HDR_BUCKETS \
+	((32 - RTTST_HDR_SUB_BITS + 2) * RTTST_HDR_HALF)
+
+typedef struct rttst_hdr_histogram {
+	unsigned long long total;
+	unsigned long long counts[RTTST_HDR_BUCKETS];
+} rttst_hdr_histogram_t;
+
+static inline int rttst_hdr_index(long long ns)
+{
+	unsigned long v;
+	int shift;
+
+	if (ns <= 0)
+		return 0;	/* Early wakeups count as zero latency. */
+
+	v = ns > 0xffffffffLL ? 0xffffffffUL : (unsigned long)ns;
+	if (v < (1UL << RTTST_HDR_SUB_BITS))
+		return v;
+
+	shift = (31 - __builtin_clz(v)) - (RTTST_HDR_SUB_BITS - 1);
+
+	return shift * RTTST_HDR_HALF + (v >> shift);
+}
+
+/* Highest value (ns) equivalent to the given bucket. */
+static inline unsigned long long rttst_hdr_value(int idx)
+{
+	int shift;
+
+	if (idx < (1 << RTTST_HDR_SUB_BITS))
+		return idx;
+
+	shift = idx / RTTST_HDR_HALF - 1;
+
+	return ((unsigned long long)(idx - shift * RTTST_HDR_HALF + 1)
+		<< shift) - 1;
+}
+
 #define RTTST_IRQBENCH_USER_TASK	0
 #define RTTST_IRQBENCH_KERNEL_TASK	1
 #define RTTST_IRQBENCH_HANDLER		2
@@ -114,6 +207,7 @@ typedef struct rttst_irqbench_config {
 	unsigned int port_type;
 	unsigned long port_ioaddr;
 	unsigned int port_irq;
+	int cpu;		/* CPU to route the IRQ to, -1 for any. */
 } rttst_irqbench_config_t;
 
 typedef struct rttst_irqbench_stats {
@@ -141,6 +235,62 @@ struct rttst_swtest_error {
 	unsigned fp_val;
 };
 
+struct rttst_swtest_xcpu {
+	unsigned from_cpu;	/* CPU of the waking task. */
+	unsigned to_cpu;	/* CPU of the woken task. */
+	unsigned long count;	/* Round trips. */
+	unsigned long period_us; /* Pause between round trips, 0 for none. */
+	/* Results, round trip times in ns. */
+	unsigned long long rtt_min;
+	unsigned long long rtt_max;
+	unsigned long long rtt_sum;
+};
+
+/* Dates of the background timers armed by the timer queue benchmark. */
+#define RTTST_TQBENCH_RANDOM		0 /* One-shot, random over span. */
+#define RTTST_TQBENCH_PERIODIC		1 /* Period of span, random phase. */
+
+/* Timer queue implementations, see CONFIG_XENO_OPT_TIMER_*. */
+#define RTTST_TQBENCH_LIST		0
+#define RTTST_TQBENCH_HEAP		1
+#define RTTST_TQBENCH_WHEEL		2
+#define RTTST_TQBENCH_HWHEEL		3
+
+#define RTTST_TQBENCH_MAX_TIMERS	1000000
+#define RTTST_TQBENCH_MAX_PROBES	1024
+
+typedef struct rttst_tqbench_config {
+	unsigned long nr_timers;	/* Background timers. */
+	int cpu;			/* CPU all timers are queued on. */
+	int mode;
+	nanosecs_rel_t delay;		/* First background date. */
+	nanosecs_rel_t span;
+	int probes;			/* Timers elapsing at the same date. */
+	int loops;			/* Probe rounds. */
+	unsigned int seed;
+} rttst_tqbench_config_t;
+
+/* All values in ns. */
+typedef struct rttst_tqbench_stat {
+	long long min;
+	long long avg;
+	long long max;
+} rttst_tqbench_stat_t;
+
+typedef struct rttst_tqbench_res {
+	struct rttst_tqbench_stat start;	/* xntimer_start() */
+	struct rttst_tqbench_stat stop;		/* xntimer_stop() */
+	struct rttst_tqbench_stat expiry;	/* Per timer, within a tick. */
+	struct rttst_tqbench_stat head;		/* Lateness of the head timer. */
+	unsigned long fired;	/* Background expiries during the run. */
+	int backend;
+} rttst_tqbench_res_t;
+
+typedef struct rttst_tqbench_run {
+	struct rttst_tqbench_config config;
+	struct rttst_tqbench_res res;
+} rttst_tqbench_run_t;
+
 #define RTTST_RTDM_NORMAL_CLOSE		0
 #define RTTST_RTDM_DEFER_CLOSE_HANDLER	1
 #define RTTST_RTDM_DEFER_CLOSE_CONTEXT	2
@@ -158,6 +308,8 @@ struct rttst_swtest_error {
 #define RTDM_SUBCLASS_SWITCHTEST	2
 /** subclase name: "rtdm" */
 #define RTDM_SUBCLASS_RTDMTEST		3
+/** subclass name: "timerqbench" */
+#define RTDM_SUBCLASS_TIMERQBENCH	4
 /** @} */
 
 /*!
@@ -173,6 +325,19 @@ struct rttst_swtest_error {
 #define RTTST_RTIOC_TMBENCH_STOP \
 	_IOWR(RTIOC_TYPE_TESTING, 0x11, struct rttst_overall_bench_res)
 
+#define RTTST_RTIOC_TMBENCH_GET_HDR \
+	_IOR(RTIOC_TYPE_TESTING, 0x12, struct rttst_hdr_histogram)
+
+#define RTTST_RTIOC_TMBENCH_ROTATE_HDR \
+	_IOR(RTIOC_TYPE_TESTING, 0x13, struct rttst_hdr_histogram)
+
+#define RTTST_RTIOC_TMBENCH_GET_PHASES \
+	_IOR(RTIOC_TYPE_TESTING, 0x14, struct rttst_phase_stats)
+
+/* Primary mode only, right after the sample was taken. */
+#define RTTST_RTIOC_TMBENCH_PHASE_SAMPLE \
+	_IOW(RTIOC_TYPE_TESTING, 0x15, struct rttst_phase_sample)
+
 #define RTTST_RTIOC_IRQBENCH_START \
 	_IOW(RTIOC_TYPE_TESTING, 0x20, struct rttst_irqbench_config)
 
@@ -188,6 +353,9 @@ struct rttst_swtest_error {
 #define RTTST_RTIOC_IRQBENCH_REPLY_IRQ \
 	_IO(RTIOC_TYPE_TESTING, 0x24)
 
+#define RTTST_RTIOC_IRQBENCH_GET_HDR \
+	_IOR(RTIOC_TYPE_TESTING, 0x25, struct rttst_hdr_histogram)
+
 #define RTTST_RTIOC_SWTEST_SET_TASKS_COUNT \
 	_IOW(RTIOC_TYPE_TESTING, 0x30, unsigned long)
 
@@ -215,8 +383,17 @@ struct rttst_swtest_error {
 #define RTTST_RTIOC_SWTEST_SET_PAUSE \
 	_IOW(RTIOC_TYPE_TESTING, 0x38, unsigned long)
 
+#define RTTST_RTIOC_SWTEST_XCPU_RUN \
+	_IOWR(RTIOC_TYPE_TESTING, 0x39, struct rttst_swtest_xcpu)
+
+#define RTTST_RTIOC_SWTEST_XCPU_GET_HDR \
+	_IOR(RTIOC_TYPE_TESTING, 0x3a, struct rttst_hdr_histogram)
+
 #define RTTST_RTIOC_RTDM_DEFER_CLOSE \
 	_IOW(RTIOC_TYPE_TESTING, 0x40, unsigned long)
+
+#define RTTST_RTIOC_TQBENCH_RUN \
+	_IOWR(RTIOC_TYPE_TESTING, 0x50, struct rttst_tqbench_run)
 /** @} */
 
 /** @} */
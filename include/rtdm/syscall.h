@@ -35,6 +35,11 @@
 #define __rtdm_write		6
 #define __rtdm_recvmsg		7
 #define __rtdm_sendmsg		8
+#define __rtdm_recvmmsg		9
+#define __rtdm_sendmmsg		10
+#define __rtdm_aio_setup	11
+#define __rtdm_aio_enter	12
+#define __rtdm_ioctlv		13
 
 #ifdef __KERNEL__
 
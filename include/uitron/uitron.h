@@ -216,6 +216,16 @@ typedef struct t_msg {
     VB   msgcont[1];
 } T_MSG;
 
+/*
+ * Messages sent to TA_MPRI mailboxes are embedded in a T_MSG_PRI,
+ * and &msgque is passed to snd_msg(). The priority sits ahead of the
+ * message, so that the T_MSG layout stays unchanged.
+ */
+typedef struct t_msg_pri {
+    PRI    msgpri;  /* message priority, 1 is the most urgent */
+    T_MSG  msgque;
+} T_MSG_PRI;
+
 typedef struct t_rmbx {
     VP        exinf;    /* extended information */
     BOOL_ID   wtsk;     /* indicates whether or not there is a
@@ -91,6 +91,9 @@ volatile int rthal_sync_op;
 
 unsigned long rthal_apc_pending[RTHAL_NR_CPUS];
 
+struct rthal_apc_stats rthal_apc_stats[RTHAL_NR_CPUS];
+EXPORT_SYMBOL_GPL(rthal_apc_stats);
+
 unsigned int rthal_apc_virq;
 
 unsigned long rthal_critical_enter(void (*synch) (void))
@@ -327,11 +330,12 @@ rthal_trap_handler_t rthal_trap_catch(rthal_trap_handler_t handler)
 static void rthal_apc_handler(unsigned virq, void *arg)
 {
     void (*handler) (void *), *cookie;
-    int cpu;
-
-    rthal_spin_lock(&rthal_apc_lock);
+    unsigned long long start, delta;
+    unsigned long pending, flags;
+    int cpu, apc;
 
     cpu = rthal_processor_id();
+    start = rthal_rdtsc();
 
     /* <!> This loop is not protected against a handler becoming
        unavailable while processing the pending queue; the software
@@ -341,18 +345,33 @@ static void rthal_apc_handler(unsigned virq, void *arg)
        invoked on the same CPU than the code which called
        rthal_apc_schedule(). */
 
-    while (rthal_apc_pending[cpu] != 0) {
-	int apc = ffnz(rthal_apc_pending[cpu]);
-	clear_bit(apc, &rthal_apc_pending[cpu]);
-	handler = rthal_apc_table[apc].handler;
-	cookie = rthal_apc_table[apc].cookie;
-	rthal_apc_table[apc].hits[cpu]++;
-	rthal_spin_unlock(&rthal_apc_lock);
-	handler(cookie);
-	rthal_spin_lock(&rthal_apc_lock);
+    for (;;) {
+	/* Only the local CPU posts to this mask, and it always does
+	   so with hw interrupts off: masking them is enough to grab
+	   the current batch, no lock is needed. */
+	rthal_local_irq_save(flags);
+	pending = rthal_apc_pending[cpu];
+	rthal_apc_pending[cpu] = 0;
+	rthal_local_irq_restore(flags);
+
+	if (pending == 0)
+	    break;
+
+	do {
+	    apc = ffnz(pending);
+	    pending &= ~(1UL << apc);
+	    handler = rthal_apc_table[apc].handler;
+	    cookie = rthal_apc_table[apc].cookie;
+	    rthal_apc_table[apc].hits[cpu]++;
+	    handler(cookie);
+	} while (pending);
     }
 
-    rthal_spin_unlock(&rthal_apc_lock);
+    delta = rthal_rdtsc() - start;
+    rthal_apc_stats[cpu].batches++;
+    rthal_apc_stats[cpu].drain_time += delta;
+    if (delta > rthal_apc_stats[cpu].drain_max)
+	rthal_apc_stats[cpu].drain_max = delta;
 }
 
 #ifdef CONFIG_PREEMPT_RT
@@ -26,6 +26,7 @@
 #include <linux/fs.h>
 #include <linux/mman.h>
 #include <linux/vmalloc.h>
+#include <linux/delay.h>
 #include <asm/errno.h>
 #include <rtdm/rtdm_driver.h>
 #include <analogy/context.h>
@@ -37,25 +38,80 @@
 
 /* The buffer charactistic is very close to the Comedi one: it is
    allocated with vmalloc() and all physical addresses of the pages which
-   compose the virtual buffer are hold in a table */
+   compose the virtual buffer are hold in a table. On demand
+   (A4L_BUF_CONTIG), the buffer is rather made of physically
+   contiguous pages, so that DMA engines can fill it from a single
+   descriptor and the kernel accesses it through the linear
+   mapping. In any case, the pages are also described as a list of
+   physically contiguous chunks (scatter-gather list) */
+
+static inline struct page *__buf_to_page(a4l_buf_t *buf_desc, char *vaddr)
+{
+	return (buf_desc->alloc_flags & A4L_BUF_CONTIG) ?
+		virt_to_page(vaddr) : vmalloc_to_page(vaddr);
+}
 
 void a4l_free_buffer(a4l_buf_t * buf_desc)
 {
+	/* Secondary readers may still be copying from the pages they
+	   got before the command was over */
+	while (atomic_read(&buf_desc->rdr_holds) != 0)
+		msleep(1);
+
 	if (buf_desc->pg_list != NULL) {
 		rtdm_free(buf_desc->pg_list);
 		buf_desc->pg_list = NULL;
 	}
 
+	if (buf_desc->sg_list != NULL) {
+		rtdm_free(buf_desc->sg_list);
+		buf_desc->sg_list = NULL;
+		buf_desc->sg_count = 0;
+	}
+
 	if (buf_desc->buf != NULL) {
 		char *vaddr, *vabase = buf_desc->buf;
 		for (vaddr = vabase; vaddr < vabase + buf_desc->size;
 		     vaddr += PAGE_SIZE)
-			ClearPageReserved(vmalloc_to_page(vaddr));
-		vfree(buf_desc->buf);
+			ClearPageReserved(__buf_to_page(buf_desc, vaddr));
+		if (buf_desc->alloc_flags & A4L_BUF_CONTIG)
+			free_pages((unsigned long)buf_desc->buf,
+				   get_order(buf_desc->size));
+		else
+			vfree(buf_desc->buf);
 		buf_desc->buf = NULL;
 	}
 }
 
+static int a4l_build_sg_list(a4l_buf_t *buf_desc)
+{
+	unsigned long i, n, nr_pages = buf_desc->size >> PAGE_SHIFT;
+
+	/* Count the chunks first, to allocate the list at once */
+	for (i = 1, n = nr_pages ? 1 : 0; i < nr_pages; i++)
+		if (buf_desc->pg_list[i] != buf_desc->pg_list[i - 1] + PAGE_SIZE)
+			n++;
+
+	buf_desc->sg_list = rtdm_malloc(n * sizeof(a4l_bufchk_t));
+	if (buf_desc->sg_list == NULL)
+		return -ENOMEM;
+
+	for (i = 0, n = 0; i < nr_pages; i++) {
+		if (i > 0 &&
+		    buf_desc->pg_list[i] == buf_desc->pg_list[i - 1] + PAGE_SIZE) {
+			buf_desc->sg_list[n - 1].size += PAGE_SIZE;
+			continue;
+		}
+		buf_desc->sg_list[n].addr = buf_desc->pg_list[i];
+		buf_desc->sg_list[n].size = PAGE_SIZE;
+		n++;
+	}
+
+	buf_desc->sg_count = n;
+
+	return 0;
+}
+
 int a4l_alloc_buffer(a4l_buf_t *buf_desc, int buf_size)
 {
 	int ret = 0;
@@ -64,7 +120,21 @@ int a4l_alloc_buffer(a4l_buf_t *buf_desc, int buf_size)
 	buf_desc->size = buf_size;
 	buf_desc->size = PAGE_ALIGN(buf_desc->size);
 
-	buf_desc->buf = vmalloc_32(buf_desc->size);
+	buf_desc->buf = NULL;
+	if ((buf_desc->alloc_flags & A4L_BUF_CONTIG) &&
+	    get_order(buf_desc->size) < MAX_ORDER)
+		/* Keep the DMA constraints of vmalloc_32() */
+		buf_desc->buf = (void *)
+			__get_free_pages(GFP_KERNEL | GFP_DMA32 | __GFP_NOWARN,
+					 get_order(buf_desc->size));
+
+	/* Fall back to a virtually contiguous buffer when no large
+	   enough physical block is available */
+	if (buf_desc->buf == NULL) {
+		buf_desc->alloc_flags &= ~A4L_BUF_CONTIG;
+		buf_desc->buf = vmalloc_32(buf_desc->size);
+	}
+
 	if (buf_desc->buf == NULL) {
 		ret = -ENOMEM;
 		goto out_virt_contig_alloc;
@@ -74,7 +144,7 @@ int a4l_alloc_buffer(a4l_buf_t *buf_desc, int buf_size)
 
 	for (vaddr = vabase; vaddr < vabase + buf_desc->size;
 	     vaddr += PAGE_SIZE)
-		SetPageReserved(vmalloc_to_page(vaddr));
+		SetPageReserved(__buf_to_page(buf_desc, vaddr));
 
 	buf_desc->pg_list = rtdm_malloc(((buf_desc->size) >> PAGE_SHIFT) *
 					sizeof(unsigned long));
@@ -86,7 +156,10 @@ int a4l_alloc_buffer(a4l_buf_t *buf_desc, int buf_size)
 	for (vaddr = vabase; vaddr < vabase + buf_desc->size;
 	     vaddr += PAGE_SIZE)
 		buf_desc->pg_list[(vaddr - vabase) >> PAGE_SHIFT] =
-			(unsigned long) page_to_phys(vmalloc_to_page(vaddr));
+			(unsigned long) page_to_phys(__buf_to_page(buf_desc,
+								   vaddr));
+
+	ret = a4l_build_sg_list(buf_desc);
 
 out_virt_contig_alloc:
 	if (ret != 0)
@@ -118,6 +191,9 @@ static void a4l_reinit_buffer(a4l_buf_t *buf_desc)
 void a4l_init_buffer(a4l_buf_t *buf_desc)
 {
 	memset(buf_desc, 0, sizeof(a4l_buf_t));
+	buf_desc->err_count = A4L_BUF_NOERR;
+	a4l_lock_init(&buf_desc->lock);
+	INIT_LIST_HEAD(&buf_desc->readers);
 	a4l_init_sync(&buf_desc->sync);
 	a4l_reinit_buffer(buf_desc);
 }
@@ -125,12 +201,202 @@ void a4l_init_buffer(a4l_buf_t *buf_desc)
 void a4l_cleanup_buffer(a4l_buf_t *buf_desc)
 {
 	a4l_cleanup_sync(&buf_desc->sync);
+
+	if (buf_desc->stamps != NULL) {
+		ClearPageReserved(virt_to_page(buf_desc->stamps));
+		free_page((unsigned long)buf_desc->stamps);
+		buf_desc->stamps = NULL;
+	}
+}
+
+/* --- Secondary readers --- */
+
+/* A context may read the stream of an input command sent by another
+   context: it gets its own position in the buffer of the latter, and
+   its own synchronization element. The producer is only
+   flow-controlled by the primary consumer, whatever the latter
+   released may be overwritten; so, a reader lagging behind the
+   primary consumer is overrun: it is moved forward to the oldest
+   valid data, and the next read fails with -EPIPE. The state of a
+   reader lives in the buffer of its own context, whose pages are not
+   used meanwhile. */
+
+/* Protects the readers lists and the shared pointers */
+static a4l_lock_t a4l_rdr_lock = RTDM_LOCK_UNLOCKED;
+
+/* Munge the data up to the absolute count, one page at a time so as
+   to bound the masking section */
+static void __munge_to(a4l_subd_t *subd, a4l_buf_t *buf, unsigned long count)
+{
+	unsigned long flags, tmp_cnt;
+
+	do {
+		a4l_lock_irqsave(&buf->lock, flags);
+
+		tmp_cnt = (long)(count - buf->mng_count) > 0 ?
+			count - buf->mng_count : 0;
+		if (tmp_cnt > PAGE_SIZE)
+			tmp_cnt = PAGE_SIZE;
+
+		if (tmp_cnt != 0) {
+			__munge(subd, subd->munge, buf, tmp_cnt);
+			buf->mng_count += tmp_cnt;
+		}
+
+		a4l_unlock_irqrestore(&buf->lock, flags);
+	} while (tmp_cnt != 0);
+}
+
+static inline unsigned long __count_to_get_shared(a4l_buf_t *rdr,
+						  a4l_buf_t *buf)
+{
+	unsigned long limit = buf->prd_count;
+
+	if (buf->end_count != 0 && (long)(limit - buf->end_count) > 0)
+		limit = buf->end_count;
+
+	return (long)(limit - rdr->cns_count) > 0 ? limit - rdr->cns_count : 0;
+}
+
+static inline int __end_of_shared(a4l_buf_t *rdr, a4l_buf_t *buf)
+{
+	return buf->end_count != 0 &&
+		(long)(rdr->cns_count - buf->end_count) >= 0;
+}
+
+/* Must be called with a4l_rdr_lock held, so that the command
+   cannot end meanwhile: returns -ENOENT if it did, -EPIPE if the
+   reader was overrun, in which case it skips the lost data */
+static int __check_shared(a4l_buf_t *rdr, a4l_buf_t *buf)
+{
+	if (rdr->shared != buf)
+		return -ENOENT;
+
+	if ((long)(rdr->cns_count - buf->cns_count) < 0) {
+		__set_error(rdr, rdr->cns_count);
+		rdr->cns_count = buf->cns_count;
+		return -EPIPE;
+	}
+
+	return 0;
+}
+
+/* Returns the shared buffer, with a hold on its pages, or NULL once
+   the command is over */
+static a4l_buf_t *__hold_shared(a4l_buf_t *rdr)
+{
+	unsigned long flags;
+	a4l_buf_t *buf;
+
+	a4l_lock_irqsave(&a4l_rdr_lock, flags);
+	buf = rdr->shared;
+	if (buf != NULL)
+		atomic_inc(&buf->rdr_holds);
+	a4l_unlock_irqrestore(&a4l_rdr_lock, flags);
+
+	return buf;
+}
+
+static inline void __release_shared(a4l_buf_t *buf)
+{
+	smp_mb();
+	atomic_dec(&buf->rdr_holds);
+}
+
+/* Called by the producer side: the readers must get munged data, so
+   munging cannot wait for the primary consumer anymore */
+static void __signal_readers(a4l_subd_t *subd,
+			     a4l_buf_t *buf, unsigned long evts)
+{
+	unsigned long flags;
+	a4l_buf_t *rdr;
+
+	if (evts == 0 && subd->munge != NULL)
+		__munge_to(subd, buf, buf->prd_count);
+
+	a4l_lock_irqsave(&a4l_rdr_lock, flags);
+	list_for_each_entry(rdr, &buf->readers, rdr_link)
+		if (evts != 0 ||
+		    __count_to_get_shared(rdr, buf) >= rdr->wake_count)
+			a4l_signal_sync(&rdr->sync);
+	a4l_unlock_irqrestore(&a4l_rdr_lock, flags);
+}
+
+/* Called by the primary side once the command is over; the readers
+   which did not get the whole acquisition are told they missed
+   data */
+static void __detach_readers(a4l_buf_t *buf)
+{
+	unsigned long flags;
+	a4l_buf_t *rdr;
+
+	a4l_lock_irqsave(&a4l_rdr_lock, flags);
+
+	while (!list_empty(&buf->readers)) {
+		rdr = list_entry(buf->readers.next, a4l_buf_t, rdr_link);
+		list_del(&rdr->rdr_link);
+
+		if (test_bit(A4L_BUF_ERROR_NR, &buf->flags) ||
+		    (buf->end_count != 0 && !__end_of_shared(rdr, buf)))
+			__set_error(rdr, rdr->cns_count);
+
+		rdr->shared = NULL;
+		a4l_signal_sync(&rdr->sync);
+	}
+
+	a4l_unlock_irqrestore(&a4l_rdr_lock, flags);
+}
+
+static int a4l_unshare_buffer(a4l_buf_t *rdr)
+{
+	unsigned long flags;
+
+	a4l_lock_irqsave(&a4l_rdr_lock, flags);
+
+	if (rdr->shared != NULL) {
+		list_del(&rdr->rdr_link);
+		rdr->shared = NULL;
+	}
+
+	a4l_unlock_irqrestore(&a4l_rdr_lock, flags);
+
+	clear_bit(A4L_BUF_ERROR_NR, &rdr->flags);
+	clear_bit(A4L_BUF_SHARED_NR, &rdr->flags);
+	rdr->cns_count = 0;
+
+	return 0;
+}
+
+static unsigned long a4l_get_scan_size(a4l_subd_t *subd, a4l_cmd_t *cmd)
+{
+	unsigned long size = 0;
+	int i;
+
+	/* A scan of a digital subdevice is a single bitfield, whatever
+	   the channels of the command */
+	if (a4l_subd_is_digital(subd)) {
+		i = a4l_get_bitfield_size(subd);
+		return i < 0 ? 0 : i;
+	}
+
+	for (i = 0; i < cmd->nb_chan; i++) {
+		a4l_chan_t *chft;
+		chft = a4l_get_chfeat(subd, CR_CHAN(cmd->chan_descs[i]));
+		size += chft->nb_bits / 8;
+	}
+
+	return size;
 }
 
 int a4l_setup_buffer(a4l_cxt_t *cxt, a4l_cmd_t *cmd)
 {
 	a4l_buf_t *buf_desc = cxt->buffer;
-	int i;
+
+	if (test_bit(A4L_BUF_SHARED_NR, &buf_desc->flags)) {
+		__a4l_err("a4l_setup_buffer: context already reading "
+			  "another one's buffer\n");
+		return -EBUSY;
+	}
 
 	/* Retrieve the related subdevice */
 	buf_desc->subd = a4l_get_subd(cxt->dev, cmd->idx_subd);
@@ -156,16 +422,22 @@ int a4l_setup_buffer(a4l_cxt_t *cxt, a4l_cmd_t *cmd)
 	/* Link the subdevice with the context's buffer */
 	buf_desc->subd->buf = buf_desc;
 
+	/* Restart the event stamps along with the counters */
+	if (buf_desc->stamps != NULL)
+		buf_desc->stamps->head = 0;
+
+	/* Forget the error position of the previous command */
+	buf_desc->err_count = A4L_BUF_NOERR;
+
+	/* Arm the period-based wake-up, if any */
+	if (buf_desc->wake_period)
+		buf_desc->wake_date =
+			rtdm_clock_read_monotonic() + buf_desc->wake_period;
+
 	/* Computes the count to reach, if need be */
-	if (cmd->stop_src == TRIG_COUNT) {
-		for (i = 0; i < cmd->nb_chan; i++) {
-			a4l_chan_t *chft;
-			chft = a4l_get_chfeat(buf_desc->subd,
-					      CR_CHAN(cmd->chan_descs[i]));
-			buf_desc->end_count += chft->nb_bits / 8;
-		}
-		buf_desc->end_count *= cmd->stop_arg;
-	}
+	if (cmd->stop_src == TRIG_COUNT)
+		buf_desc->end_count =
+			a4l_get_scan_size(buf_desc->subd, cmd) * cmd->stop_arg;
 
 	__a4l_dbg(1, core_dbg,
 		  "a4l_setup_buffer: end_count=%lu\n", buf_desc->end_count);
@@ -180,6 +452,9 @@ int a4l_cancel_buffer(a4l_cxt_t *cxt)
 
 	int err = 0;
 
+	if (test_bit(A4L_BUF_SHARED_NR, &buf_desc->flags))
+		return a4l_unshare_buffer(buf_desc);
+
 	if (!subd || !test_bit(A4L_SUBD_BUSY_NR, &subd->status))
 		return 0;
 
@@ -192,12 +467,29 @@ int a4l_cancel_buffer(a4l_cxt_t *cxt)
 		__a4l_err("a4l_cancel: cancel handler failed (err=%d)\n", err);
 	}
 
+	/* Tell where the transfer broke, the position itself is kept
+	   for BUFINFO2 until the next command */
+	if (test_bit(A4L_BUF_ERROR_NR, &buf_desc->flags) &&
+	    buf_desc->cur_cmd != NULL) {
+		unsigned long scan_size =
+			a4l_get_scan_size(subd, buf_desc->cur_cmd);
+
+		__a4l_err("a4l_cancel: %s at byte %lu (scan %lu)\n",
+			  a4l_subd_is_input(subd) ? "overrun" : "underrun",
+			  buf_desc->err_count,
+			  scan_size ? buf_desc->err_count / scan_size : 0);
+	}
+
 	if (buf_desc->cur_cmd != NULL) {
 		a4l_free_cmddesc(buf_desc->cur_cmd);
 		rtdm_free(buf_desc->cur_cmd);
 		buf_desc->cur_cmd = NULL;
 	}
 
+	/* No reader may attach anymore, let go the attached ones
+	   before the counters are reset */
+	__detach_readers(buf_desc);
+
 	a4l_reinit_buffer(buf_desc);
 
 	clear_bit(A4L_SUBD_BUSY_NR, &subd->status);
@@ -206,6 +498,26 @@ int a4l_cancel_buffer(a4l_cxt_t *cxt)
 	return err;
 }
 
+/* Called before the start trigger of a command: an output transfer
+   cannot start on an empty buffer, the driver would load its FIFO or
+   program its DMA with whatever the buffer contains */
+int a4l_check_preload(a4l_subd_t *subd)
+{
+	a4l_buf_t *buf = subd->buf;
+
+	if (buf == NULL || !a4l_subd_is_output(subd) ||
+	    !test_bit(A4L_SUBD_BUSY_NR, &subd->status))
+		return 0;
+
+	if (__count_to_get(buf) == 0) {
+		__a4l_err("a4l_check_preload: no data written "
+			  "before the start trigger\n");
+		return -EPIPE;
+	}
+
+	return 0;
+}
+
 /* --- Munge related function --- */
 
 int a4l_get_chan(a4l_subd_t *subd)
@@ -413,11 +725,25 @@ int a4l_buf_get(a4l_subd_t *subd, void *bufdata, unsigned long count)
 	return err;
 }
 
+static void __stamp(a4l_subd_t *subd, a4l_buf_t *buf)
+{
+	a4l_bufstps_t *stps = buf->stamps;
+	a4l_bufstp_t *stp;
+	unsigned int head = stps->head;
+
+	stp = &stps->stamps[head & (A4L_BUF_NR_STAMPS - 1)];
+	stp->date = a4l_get_rawtime();
+	stp->pos = a4l_subd_is_input(subd) ? buf->prd_count : buf->cns_count;
+	/* Publish the record before the new head */
+	smp_wmb();
+	stps->head = head + 1;
+}
+
 int a4l_buf_evt(a4l_subd_t *subd, unsigned long evts)
 {
 	a4l_buf_t *buf = subd->buf;
 	int tmp;
-	unsigned long wake = 0, count = ULONG_MAX;
+	unsigned long wake = 0, count = ULONG_MAX, events = evts;
 
 	/* Warning: here, there may be a condition race : the cancel
 	   function is called by the user side and a4l_buf_evt and all
@@ -431,14 +757,45 @@ int a4l_buf_evt(a4l_subd_t *subd, unsigned long evts)
 
 	/* Here we save the data count available for the user side */
 	if (evts == 0) {
+		if (buf->stamps != NULL)
+			__stamp(subd, buf);
+
 		count = a4l_subd_is_input(subd) ? 
 			__count_to_get(buf) : __count_to_put(buf);
 		wake = __count_to_end(buf) < buf->wake_count ? 
 			__count_to_end(buf) : buf->wake_count;
+
+		/* With a wake-up period, the events are aggregated
+		   until either the threshold is reached or the period
+		   elapsed; if no threshold was set, only the period
+		   and the end of the acquisition may wake up */
+		if (buf->wake_period) {
+			nanosecs_abs_t now = rtdm_clock_read_monotonic();
+
+			if (buf->wake_count == 0)
+				wake = __count_to_end(buf);
+
+			if (count > 0 && now >= buf->wake_date) {
+				wake = 0;
+				/* Keep the cadence, unless we lag
+				   behind by more than a period */
+				buf->wake_date += buf->wake_period;
+				if (buf->wake_date <= now)
+					buf->wake_date =
+						now + buf->wake_period;
+			}
+		}
 	} else {
 		/* Even if it is a little more complex, atomic
 		   operations are used so as to prevent any kind of
 		   corner case */
+		if (evts & A4L_BUF_ERROR)
+			/* Input: the first sample the driver could not
+			   store; output: the first one it could not
+			   send */
+			__set_error(buf, a4l_subd_is_input(subd) ?
+				    buf->prd_count : buf->cns_count);
+
 		while ((tmp = ffs(evts) - 1) != -1) {
 			set_bit(tmp, &buf->flags);
 			clear_bit(tmp, &evts);
@@ -449,6 +806,9 @@ int a4l_buf_evt(a4l_subd_t *subd, unsigned long evts)
 		/* Notify the user-space side */
 		a4l_signal_sync(&buf->sync);
 
+	if (!list_empty(&buf->readers))
+		__signal_readers(subd, buf, events);
+
 	return 0;
 }
 
@@ -542,6 +902,58 @@ int a4l_ioctl_mmap(a4l_cxt_t *cxt, void *arg)
 				      arg, &map_cfg, sizeof(a4l_mmap_t));
 }
 
+/* The ioctl MMAPSTAMP maps the event stamps ring (read-only),
+   allocating it on first use; the stamps are only recorded once
+   someone asked for them */
+
+int a4l_ioctl_mmapstamp(a4l_cxt_t *cxt, void *arg)
+{
+	a4l_dev_t *dev = a4l_get_dev(cxt);
+	a4l_buf_t *buf = cxt->buffer;
+	a4l_bufstps_t *stps;
+	a4l_mmap_t map_cfg;
+	int ret;
+
+	if (rtdm_in_rt_context())
+		return -ENOSYS;
+
+	if (!test_bit(A4L_DEV_ATTACHED_NR, &dev->flags)) {
+		__a4l_err("a4l_ioctl_mmapstamp: cannot mmap on "
+			  "an unattached device\n");
+		return -EINVAL;
+	}
+
+	if (rtdm_safe_copy_from_user(cxt->user_info,
+				     &map_cfg, arg, sizeof(a4l_mmap_t)) != 0)
+		return -EFAULT;
+
+	if (buf->stamps == NULL) {
+		stps = (a4l_bufstps_t *)get_zeroed_page(GFP_KERNEL);
+		if (stps == NULL)
+			return -ENOMEM;
+		SetPageReserved(virt_to_page(stps));
+		stps->nr_stamps = A4L_BUF_NR_STAMPS;
+		/* The stamps are logged as soon as the pointer is
+		   visible */
+		smp_wmb();
+		buf->stamps = stps;
+	}
+
+	ret = rtdm_mmap_to_user(cxt->user_info,
+				buf->stamps, PAGE_SIZE, PROT_READ,
+				&map_cfg.ptr, NULL, NULL);
+	if (ret < 0) {
+		__a4l_err("a4l_ioctl_mmapstamp: internal error, "
+			  "rtdm_mmap_to_user failed (err=%d)\n", ret);
+		return ret;
+	}
+
+	map_cfg.size = PAGE_SIZE;
+
+	return rtdm_safe_copy_to_user(cxt->user_info,
+				      arg, &map_cfg, sizeof(a4l_mmap_t));
+}
+
 /* --- IOCTL / FOPS functions --- */
 
 int a4l_ioctl_cancel(a4l_cxt_t * cxt, void *arg)
@@ -557,6 +969,10 @@ int a4l_ioctl_cancel(a4l_cxt_t * cxt, void *arg)
 		return -EINVAL;
 	}
 
+	/* A secondary reader only detaches itself */
+	if (test_bit(A4L_BUF_SHARED_NR, &cxt->buffer->flags))
+		return a4l_cancel_buffer(cxt);
+
 	if (cxt->buffer->subd == NULL) {
 		__a4l_err("a4l_ioctl_cancel: "
 			  "no acquisition to cancel on this context\n");
@@ -580,6 +996,69 @@ int a4l_ioctl_cancel(a4l_cxt_t * cxt, void *arg)
 	return a4l_cancel_buffer(cxt);
 }
 
+/* The ioctl BUFSHARE turns the context into a secondary reader of the
+   input command running on a subdevice; it starts with the oldest
+   data the primary consumer did not release yet. Reading, polling
+   and selecting then apply to the shared stream, cancelling only
+   detaches the reader */
+
+int a4l_ioctl_bufshare(a4l_cxt_t * cxt, void *arg)
+{
+	unsigned int idx_subd = (unsigned long)arg;
+	a4l_dev_t *dev = a4l_get_dev(cxt);
+	a4l_buf_t *rdr = cxt->buffer, *buf;
+	unsigned long flags;
+	a4l_subd_t *subd;
+	int ret = 0;
+
+	if (!test_bit(A4L_DEV_ATTACHED_NR, &dev->flags)) {
+		__a4l_err("a4l_ioctl_bufshare: unattached device\n");
+		return -EINVAL;
+	}
+
+	if (idx_subd >= dev->transfer.nb_subd) {
+		__a4l_err("a4l_ioctl_bufshare: bad subdevice index\n");
+		return -EINVAL;
+	}
+
+	subd = dev->transfer.subds[idx_subd];
+	if (!a4l_subd_is_input(subd)) {
+		__a4l_err("a4l_ioctl_bufshare: only the input streams "
+			  "can be shared\n");
+		return -EINVAL;
+	}
+
+	if (rdr->subd != NULL || test_bit(A4L_BUF_SHARED_NR, &rdr->flags)) {
+		__a4l_err("a4l_ioctl_bufshare: context already busy\n");
+		return -EBUSY;
+	}
+
+	a4l_flush_sync(&rdr->sync);
+	clear_bit(A4L_BUF_ERROR_NR, &rdr->flags);
+	rdr->err_count = A4L_BUF_NOERR;
+
+	a4l_lock_irqsave(&a4l_rdr_lock, flags);
+
+	/* The command is freed before its readers are detached */
+	buf = subd->buf;
+	if (buf == NULL || buf->cur_cmd == NULL)
+		ret = -ENOENT;
+	else {
+		rdr->cns_count = buf->cns_count;
+		rdr->shared = buf;
+		list_add_tail(&rdr->rdr_link, &buf->readers);
+		set_bit(A4L_BUF_SHARED_NR, &rdr->flags);
+	}
+
+	a4l_unlock_irqrestore(&a4l_rdr_lock, flags);
+
+	if (ret < 0)
+		__a4l_err("a4l_ioctl_bufshare: no command in progress "
+			  "on subdevice %u\n", idx_subd);
+
+	return ret;
+}
+
 /* The ioctl BUFCFG is only useful for changing the size of the
    asynchronous buffer.
    (BUFCFG = free of the current buffer + allocation of a new one) */
@@ -646,6 +1125,7 @@ int a4l_ioctl_bufcfg2(a4l_cxt_t * cxt, void *arg)
 	a4l_dev_t *dev = a4l_get_dev(cxt);
 	a4l_buf_t *buf = cxt->buffer;
 	a4l_bufcfg2_t buf_cfg;
+	unsigned long size;
 
 	/* Basic checking */
 	if (!test_bit(A4L_DEV_ATTACHED_NR, &dev->flags)) {
@@ -666,8 +1146,33 @@ int a4l_ioctl_bufcfg2(a4l_cxt_t * cxt, void *arg)
 	}
 
 	buf->wake_count = buf_cfg.wake_count;
+	buf->wake_period = buf_cfg.wake_period;
 
-	return 0;
+	if ((buf_cfg.flags & A4L_BUF_CONTIG) ==
+	    (buf->alloc_flags & A4L_BUF_CONTIG))
+		return 0;
+
+	/* The allocation mode changed, reallocate the buffer; the
+	   same restrictions as BUFCFG apply */
+	if (rtdm_in_rt_context())
+		return -ENOSYS;
+
+	if (buf->subd && test_bit(A4L_SUBD_BUSY_NR, &buf->subd->status)) {
+		__a4l_err("a4l_ioctl_bufcfg2: acquisition in progress\n");
+		return -EBUSY;
+	}
+
+	if (test_bit(A4L_BUF_MAP_NR, &buf->flags)) {
+		__a4l_err("a4l_ioctl_bufcfg2: please unmap before "
+			  "configuring buffer\n");
+		return -EPERM;
+	}
+
+	size = buf->size;
+	a4l_free_buffer(buf);
+	buf->alloc_flags = buf_cfg.flags & A4L_BUF_CONTIG;
+
+	return size ? a4l_alloc_buffer(buf, size) : 0;
 }
 
 /* The BUFINFO ioctl provides two basic roles:
@@ -724,6 +1229,10 @@ int a4l_ioctl_bufinfo(a4l_cxt_t * cxt, void *arg)
 			a4l_cancel_buffer(cxt);
 			return ret;
 		}
+
+		/* Performs the munge if need be */
+		if (subd->munge != NULL)
+			__munge_to(subd, buf, buf->cns_count + tmp_cnt);
 	} else if (a4l_subd_is_output(subd)) {
 
 		if (ret < 0) {
@@ -757,7 +1266,7 @@ int a4l_ioctl_bufinfo(a4l_cxt_t * cxt, void *arg)
 	}
 
 	/* Performs the munge if need be */
-	if (subd->munge != NULL) {
+	if (a4l_subd_is_output(subd) && subd->munge != NULL) {
 
 		/* Call the munge callback */
 		__munge(subd, subd->munge, buf, tmp_cnt);
@@ -796,7 +1305,11 @@ int a4l_ioctl_bufinfo2(a4l_cxt_t * cxt, void *arg)
 		return -EINVAL;
 	}
 
+	memset(&buf_cfg, 0, sizeof(buf_cfg));
 	buf_cfg.wake_count = buf->wake_count;
+	buf_cfg.flags = buf->alloc_flags;
+	buf_cfg.wake_period = buf->wake_period;
+	buf_cfg.err_count = buf->err_count;
 
 	if (rtdm_safe_copy_to_user(cxt->user_info,
 				   arg, &buf_cfg, sizeof(a4l_bufcfg2_t)) != 0)
@@ -805,6 +1318,104 @@ int a4l_ioctl_bufinfo2(a4l_cxt_t * cxt, void *arg)
 	return 0;
 }
 
+/* Read path of the secondary readers: the overruns are reported once,
+   the reader going on with the oldest valid data afterwards */
+static ssize_t a4l_read_shared(a4l_cxt_t *cxt, void *bufdata, size_t nbytes)
+{
+	a4l_buf_t *rdr = cxt->buffer, *buf;
+	unsigned long flags, tmp_cnt;
+	ssize_t count = 0;
+	int ret, bulk;
+
+	while (count < nbytes) {
+
+		/* Report a former overrun before any further data */
+		if (test_bit(A4L_BUF_ERROR_NR, &rdr->flags)) {
+			if (count == 0) {
+				clear_bit(A4L_BUF_ERROR_NR, &rdr->flags);
+				count = -EPIPE;
+			}
+			break;
+		}
+
+		/* Once the command is over, the end of the stream is
+		   reached */
+		buf = __hold_shared(rdr);
+		if (buf == NULL)
+			break;
+
+		a4l_lock_irqsave(&a4l_rdr_lock, flags);
+		ret = __check_shared(rdr, buf);
+		tmp_cnt = __count_to_get_shared(rdr, buf);
+		if (ret == 0 && tmp_cnt == 0 && __end_of_shared(rdr, buf))
+			ret = -ENOENT;
+		a4l_unlock_irqrestore(&a4l_rdr_lock, flags);
+
+		if (ret < 0) {
+			__release_shared(buf);
+			if (ret == -ENOENT)
+				break;
+			continue;
+		}
+
+		if (tmp_cnt > nbytes - count)
+			tmp_cnt = nbytes - count;
+
+		if (tmp_cnt > 0) {
+
+			/* Read the data after the counters... */
+			smp_rmb();
+			ret = __consume_from(cxt, buf, rdr->cns_count,
+					     bufdata + count, tmp_cnt);
+			/* ...and check them again afterwards, the
+			   producer may have overwritten the data
+			   meanwhile */
+			smp_rmb();
+
+			if (ret == 0) {
+				a4l_lock_irqsave(&a4l_rdr_lock, flags);
+				ret = __check_shared(rdr, buf);
+				a4l_unlock_irqrestore(&a4l_rdr_lock, flags);
+			}
+
+			bulk = test_bit(A4L_BUF_BULK_NR, &buf->flags);
+			__release_shared(buf);
+
+			if (ret == -ENOENT)
+				break;
+			if (ret == -EPIPE)
+				continue;
+			if (ret < 0) {
+				count = ret;
+				break;
+			}
+
+			rdr->cns_count += tmp_cnt;
+			count += tmp_cnt;
+
+			/* As for the primary consumer, only the bulk
+			   mode goes on until the request is complete */
+			if (!bulk)
+				break;
+		} else {
+			__release_shared(buf);
+
+			if (count > 0)
+				break;
+
+			ret = a4l_wait_sync(&rdr->sync, rtdm_in_rt_context());
+			if (ret < 0) {
+				if (ret == -ERESTARTSYS)
+					ret = -EINTR;
+				count = ret;
+				break;
+			}
+		}
+	}
+
+	return count;
+}
+
 /* The function a4l_read_buffer can be considered as the kernel entry
    point of the RTDM syscall read. This syscall is supposed to be used
    only during asynchronous acquisitions */
@@ -814,6 +1425,7 @@ ssize_t a4l_read_buffer(a4l_cxt_t * cxt, void *bufdata, size_t nbytes)
 	a4l_buf_t *buf = cxt->buffer;
 	a4l_subd_t *subd = buf->subd;
 	ssize_t count = 0;
+	int woken = 0;
 
 	/* Basic checkings */
 
@@ -822,6 +1434,9 @@ ssize_t a4l_read_buffer(a4l_cxt_t * cxt, void *bufdata, size_t nbytes)
 		return -EINVAL;
 	}
 
+	if (test_bit(A4L_BUF_SHARED_NR, &buf->flags))
+		return a4l_read_shared(cxt, bufdata, nbytes);
+
 	if (!subd || !test_bit(A4L_SUBD_BUSY_NR, &subd->status)) {
 		__a4l_err("a4l_read: idle subdevice on this context\n");
 		return -ENOENT;
@@ -860,15 +1475,20 @@ ssize_t a4l_read_buffer(a4l_cxt_t * cxt, void *bufdata, size_t nbytes)
 			goto out_a4l_read;
 		}
 
+		/* Until the first wake-up, do not return less data
+		   than the wake-up threshold, so that the caller is
+		   not scheduled once per driver event */
+		if (tmp_cnt > 0 && count == 0 && !woken && ret != -ENOENT &&
+		    tmp_cnt < buf->wake_count &&
+		    tmp_cnt < nbytes && tmp_cnt < __count_to_end(buf))
+			tmp_cnt = 0;
+
 		if (tmp_cnt > 0) {
 
 			/* Performs the munge if need be */
-			if (subd->munge != NULL) {
-				__munge(subd, subd->munge, buf, tmp_cnt);
-
-				/* Updates munge count */
-				buf->mng_count += tmp_cnt;
-			}
+			if (subd->munge != NULL)
+				__munge_to(subd, buf,
+					   buf->cns_count + tmp_cnt);
 
 			/* Performs the copy */
 			ret = __consume(cxt, buf, bufdata + count, tmp_cnt);
@@ -899,6 +1519,7 @@ ssize_t a4l_read_buffer(a4l_cxt_t * cxt, void *bufdata, size_t nbytes)
 				count = ret;
 				goto out_a4l_read;
 			}
+			woken = 1;
 		}
 	}
 
@@ -1014,6 +1635,15 @@ int a4l_select(a4l_cxt_t *cxt,
 		return -EINVAL;
 	}
 
+	/* Secondary readers wait for their own events */
+	if (test_bit(A4L_BUF_SHARED_NR, &buf->flags)) {
+		if (type != RTDM_SELECTTYPE_READ) {
+			__a4l_err("a4l_select: wrong select argument\n");
+			return -EINVAL;
+		}
+		return a4l_select_sync(&buf->sync, selector, type, fd_index);
+	}
+
 	if (!subd || !test_bit(A4L_SUBD_BUSY, &subd->status)) {
 		__a4l_err("a4l_select: idle subdevice on this context\n");
 		return -ENOENT;
@@ -1044,9 +1674,60 @@ int a4l_select(a4l_cxt_t *cxt,
 	return a4l_select_sync(&(buf->sync), selector, type, fd_index);
 }
 
+/* Returns the data amount available to a secondary reader, -ENOENT
+   once the stream is over, -EPIPE to report an overrun */
+static long __poll_shared(a4l_buf_t *rdr)
+{
+	unsigned long flags;
+	long ret = -ENOENT;
+
+	a4l_lock_irqsave(&a4l_rdr_lock, flags);
+	if (rdr->shared != NULL && __check_shared(rdr, rdr->shared) == 0) {
+		ret = __count_to_get_shared(rdr, rdr->shared);
+		if (ret == 0 && __end_of_shared(rdr, rdr->shared))
+			ret = -ENOENT;
+	}
+	a4l_unlock_irqrestore(&a4l_rdr_lock, flags);
+
+	if (test_and_clear_bit(A4L_BUF_ERROR_NR, &rdr->flags))
+		ret = -EPIPE;
+
+	return ret;
+}
+
+static int a4l_poll_shared(a4l_cxt_t *cxt, a4l_poll_t *poll)
+{
+	a4l_buf_t *rdr = cxt->buffer;
+	long tmp_cnt;
+	int ret;
+
+	a4l_flush_sync(&rdr->sync);
+
+	tmp_cnt = __poll_shared(rdr);
+	if (tmp_cnt == 0 && poll->arg != A4L_NONBLOCK) {
+		if (poll->arg == A4L_INFINITE)
+			ret = a4l_wait_sync(&rdr->sync, rtdm_in_rt_context());
+		else
+			ret = a4l_timedwait_sync(&rdr->sync,
+						 rtdm_in_rt_context(),
+						 (unsigned long long)poll->arg *
+						 NSEC_PER_MSEC);
+		if (ret == -ERESTARTSYS)
+			return -EINTR;
+		tmp_cnt = __poll_shared(rdr);
+	}
+
+	if (tmp_cnt == -EPIPE)
+		return -EPIPE;
+
+	poll->arg = tmp_cnt < 0 ? 0 : tmp_cnt;
+
+	return 0;
+}
+
 int a4l_ioctl_poll(a4l_cxt_t * cxt, void *arg)
 {
-	int ret = 0;
+	int ret = 0, ready;
 	unsigned long tmp_cnt = 0;
 	a4l_dev_t *dev = a4l_get_dev(cxt);
 	a4l_buf_t *buf = cxt->buffer;
@@ -1063,15 +1744,22 @@ int a4l_ioctl_poll(a4l_cxt_t * cxt, void *arg)
 		return -EINVAL;
 	}
 
+	if (rtdm_safe_copy_from_user(cxt->user_info,
+				     &poll, arg, sizeof(a4l_poll_t)) != 0)
+		return -EFAULT;
+
+	if (test_bit(A4L_BUF_SHARED_NR, &buf->flags)) {
+		ret = a4l_poll_shared(cxt, &poll);
+		if (ret < 0)
+			return ret;
+		goto out_poll;
+	}
+
 	if (!subd || !test_bit(A4L_SUBD_BUSY_NR, &subd->status)) {
 		__a4l_err("a4l_poll: idle subdevice on this context\n");
 		return -ENOENT;
 	}
 
-	if (rtdm_safe_copy_from_user(cxt->user_info,
-				     &poll, arg, sizeof(a4l_poll_t)) != 0)
-		return -EFAULT;
-
 	/* Checks the buffer events */
 	a4l_flush_sync(&buf->sync);
 	ret = __handle_event(buf);
@@ -1104,7 +1792,15 @@ int a4l_ioctl_poll(a4l_cxt_t * cxt, void *arg)
 		tmp_cnt = __count_to_put(buf);
 	}
 
-	if (poll.arg == A4L_NONBLOCK || tmp_cnt != 0)
+	/* As with read, the wake-up threshold is a watermark: unless
+	   the acquisition is ending, less input data than that is not
+	   worth returning */
+	ready = tmp_cnt != 0;
+	if (ready && a4l_subd_is_input(subd) && ret != -ENOENT &&
+	    tmp_cnt < buf->wake_count && tmp_cnt < __count_to_end(buf))
+		ready = 0;
+
+	if (poll.arg == A4L_NONBLOCK || ready)
 		goto out_poll;
 
 	if (poll.arg == A4L_INFINITE)
@@ -376,4 +376,121 @@ out_ioctl_cmd:
 	return ret;
 }
 
+/* The ioctl GRPTRIG fires the start triggers of several commands
+   armed with TRIG_INT, possibly on several devices, within a single
+   interrupt-free section; thus, boards sharing their conversion
+   clock (i.e. through RTSI) begin acquiring on the same clock
+   edge. The trigger dates are returned so that the streams can be
+   aligned afterwards. */
+
+static a4l_lock_t a4l_grptrig_lock = A4L_LOCK_UNLOCKED;
+
+int a4l_ioctl_grptrig(a4l_cxt_t * cxt, void *arg)
+{
+	struct rtdm_dev_context *rtdm_cxt = rtdm_private_to_context(cxt);
+	struct rtdm_dev_context *mbr_cxts[A4L_GRP_MAX_MEMBERS];
+	a4l_subd_t *subds[A4L_GRP_MAX_MEMBERS];
+	a4l_grpmbr_t mbrs[A4L_GRP_MAX_MEMBERS];
+	a4l_grptrig_t grp;
+	unsigned int i, n = 0;
+	unsigned long flags;
+	int ret = 0;
+
+	if (rtdm_safe_copy_from_user(cxt->user_info,
+				     &grp, arg, sizeof(a4l_grptrig_t)) != 0)
+		return -EFAULT;
+
+	if (grp.nb_members == 0 || grp.nb_members > A4L_GRP_MAX_MEMBERS) {
+		__a4l_err("a4l_ioctl_grptrig: wrong count of members (%u)\n",
+			  grp.nb_members);
+		return -EINVAL;
+	}
+
+	if (rtdm_safe_copy_from_user(cxt->user_info,
+				     mbrs, grp.members,
+				     grp.nb_members * sizeof(a4l_grpmbr_t)) != 0)
+		return -EFAULT;
+
+	/* Resolve and check every member before firing anything */
+	for (n = 0; n < grp.nb_members; n++) {
+		a4l_cxt_t *mbr_cxt;
+		a4l_buf_t *buf;
+
+		mbr_cxts[n] = rtdm_context_get(mbrs[n].fd);
+		if (mbr_cxts[n] == NULL) {
+			ret = -EBADF;
+			goto out_grptrig;
+		}
+
+		/* Only Analogy devices may be grouped */
+		if (mbr_cxts[n]->ops != rtdm_cxt->ops) {
+			__a4l_err("a4l_ioctl_grptrig: "
+				  "fd %d is not an Analogy device\n",
+				  mbrs[n].fd);
+			rtdm_context_unlock(mbr_cxts[n]);
+			ret = -EINVAL;
+			goto out_grptrig;
+		}
+
+		mbr_cxt = (a4l_cxt_t *)rtdm_context_to_private(mbr_cxts[n]);
+		buf = mbr_cxt->buffer;
+		subds[n] = buf->subd;
+
+		if (subds[n] == NULL || buf->cur_cmd == NULL ||
+		    !test_bit(A4L_SUBD_BUSY_NR, &subds[n]->status) ||
+		    subds[n]->idx != mbrs[n].idx_subd) {
+			__a4l_err("a4l_ioctl_grptrig: no command on "
+				  "subdevice %u of fd %d\n",
+				  mbrs[n].idx_subd, mbrs[n].fd);
+			rtdm_context_unlock(mbr_cxts[n]);
+			ret = -ENOENT;
+			goto out_grptrig;
+		}
+
+		if (buf->cur_cmd->start_src != TRIG_INT ||
+		    subds[n]->trigger == NULL) {
+			__a4l_err("a4l_ioctl_grptrig: command on subdevice "
+				  "%u of fd %d cannot be triggered\n",
+				  mbrs[n].idx_subd, mbrs[n].fd);
+			rtdm_context_unlock(mbr_cxts[n]);
+			ret = -EINVAL;
+			goto out_grptrig;
+		}
+
+		/* Check now so that no member gets started alone */
+		ret = a4l_check_preload(subds[n]);
+		if (ret < 0) {
+			rtdm_context_unlock(mbr_cxts[n]);
+			goto out_grptrig;
+		}
+	}
+
+	a4l_lock_irqsave(&a4l_grptrig_lock, flags);
+
+	for (i = 0; i < n; i++) {
+		mbrs[i].date = a4l_get_time();
+		ret = subds[i]->trigger(subds[i], mbrs[i].trignum);
+		if (ret < 0)
+			break;
+		ret = 0;
+	}
+
+	a4l_unlock_irqrestore(&a4l_grptrig_lock, flags);
+
+	if (ret < 0)
+		__a4l_err("a4l_ioctl_grptrig: trigger failed on "
+			  "subdevice %u of fd %d (err=%d)\n",
+			  mbrs[i].idx_subd, mbrs[i].fd, ret);
+	else if (rtdm_safe_copy_to_user(cxt->user_info,
+					grp.members, mbrs,
+					n * sizeof(a4l_grpmbr_t)) != 0)
+		ret = -EFAULT;
+
+out_grptrig:
+	while (n-- > 0)
+		rtdm_context_unlock(mbr_cxts[n]);
+
+	return ret;
+}
+
 #endif /* !DOXYGEN_CPP */
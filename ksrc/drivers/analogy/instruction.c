@@ -26,6 +26,7 @@
 #include <linux/version.h>
 #include <linux/ioport.h>
 #include <linux/mman.h>
+#include <linux/vmalloc.h>
 #include <asm/div64.h>
 #include <asm/io.h>
 #include <asm/errno.h>
@@ -93,6 +94,7 @@ int a4l_do_insn_trig(a4l_cxt_t * cxt, a4l_kinsn_t * dsc)
 	a4l_dev_t *dev = a4l_get_dev(cxt);
 	unsigned int trignum;
 	unsigned int *data = (unsigned int*)dsc->data;
+	int ret;
 
 	/* Basic checkings */
 	if (dsc->data_size > 1) {
@@ -117,6 +119,11 @@ int a4l_do_insn_trig(a4l_cxt_t * cxt, a4l_kinsn_t * dsc)
 		return -EINVAL;
 	}
 
+	/* An output command must have some data to preload */
+	ret = a4l_check_preload(subd);
+	if (ret < 0)
+		return ret;
+
 	/* Performs the trigger */
 	return subd->trigger(subd, trignum);
 }
@@ -425,4 +432,272 @@ err_ioctl_ilst:
 	return ret;
 }
 
+/* The instruction programs spare the per-cycle costs of INSNLIST:
+   the list is copied and checked once by INSNPRG, its data buffers
+   are gathered in an area shared with user-space, then INSNPRGRUN
+   performs the whole list on that area, with no copy and no
+   allocation; the results are left in place. A program is freed
+   once both the context dropped it and user-space unmapped its
+   area */
+
+static void __free_insnprg(a4l_kiprg_t *prg)
+{
+	char *vaddr;
+
+	if (prg->data != NULL) {
+		for (vaddr = prg->data;
+		     vaddr < (char *)prg->data + prg->size; vaddr += PAGE_SIZE)
+			ClearPageReserved(vmalloc_to_page(vaddr));
+		vfree(prg->data);
+	}
+
+	if (prg->insns != NULL)
+		rtdm_free(prg->insns);
+
+	rtdm_free(prg);
+}
+
+static void __put_insnprg(a4l_kiprg_t *prg)
+{
+	if (atomic_dec_and_test(&prg->refcnt))
+		__free_insnprg(prg);
+}
+
+static void a4l_insnprg_map(struct vm_area_struct *area)
+{
+	a4l_kiprg_t *prg = area->vm_private_data;
+	atomic_inc(&prg->refcnt);
+}
+
+static void a4l_insnprg_unmap(struct vm_area_struct *area)
+{
+	__put_insnprg(area->vm_private_data);
+}
+
+static struct vm_operations_struct a4l_insnprg_vm_ops = {
+	.open = a4l_insnprg_map,
+	.close = a4l_insnprg_unmap,
+};
+
+void a4l_free_insnprg(a4l_cxt_t * cxt)
+{
+	a4l_kiprg_t *prg;
+	unsigned long flags;
+
+	a4l_lock_irqsave(&cxt->insnprg_lock, flags);
+	prg = cxt->insnprg;
+	cxt->insnprg = NULL;
+	a4l_unlock_irqrestore(&cxt->insnprg_lock, flags);
+
+	if (prg != NULL)
+		__put_insnprg(prg);
+}
+
+int a4l_ioctl_insnprg(a4l_cxt_t * cxt, void *arg)
+{
+	unsigned long off, *offs = NULL;
+	a4l_dev_t *dev = a4l_get_dev(cxt);
+	unsigned long flags;
+	a4l_kiprg_t *kprg;
+	a4l_insnprg_t prg;
+	char *vaddr;
+	int i, ret;
+
+	/* The shared area is allocated and mapped here */
+	if (rtdm_in_rt_context())
+		return -ENOSYS;
+
+	/* Basic checking */
+	if (!test_bit(A4L_DEV_ATTACHED_NR, &dev->flags)) {
+		__a4l_err("a4l_ioctl_insnprg: unattached device\n");
+		return -EINVAL;
+	}
+
+	if (rtdm_safe_copy_from_user(cxt->user_info,
+				     &prg, arg, sizeof(a4l_insnprg_t)) != 0)
+		return -EFAULT;
+
+	/* Replace the current program, unless it is running or its
+	   area is still mapped */
+	a4l_lock_irqsave(&cxt->insnprg_lock, flags);
+	kprg = cxt->insnprg;
+	if (kprg != NULL &&
+	    (atomic_read(&kprg->refcnt) > 1 ||
+	     test_and_set_bit(A4L_INSNPRG_BUSY_NR, &kprg->status))) {
+		a4l_unlock_irqrestore(&cxt->insnprg_lock, flags);
+		return -EBUSY;
+	}
+	cxt->insnprg = NULL;
+	a4l_unlock_irqrestore(&cxt->insnprg_lock, flags);
+
+	if (kprg != NULL)
+		__put_insnprg(kprg);
+
+	/* An empty program only drops the former one */
+	if (prg.count == 0)
+		return 0;
+
+	kprg = rtdm_malloc(sizeof(a4l_kiprg_t));
+	if (kprg == NULL)
+		return -ENOMEM;
+	memset(kprg, 0, sizeof(a4l_kiprg_t));
+	atomic_set(&kprg->refcnt, 1);
+
+	kprg->count = prg.count;
+	kprg->insns = rtdm_malloc(prg.count * sizeof(a4l_kinsn_t));
+	offs = rtdm_malloc(prg.count * sizeof(unsigned long));
+	if (kprg->insns == NULL || offs == NULL) {
+		ret = -ENOMEM;
+		goto err_insnprg;
+	}
+
+	/* Recover the instructions and lay their data out */
+	for (i = 0, off = 0; i < prg.count; i++) {
+		a4l_kinsn_t *insn = &kprg->insns[i];
+
+		ret = rtdm_safe_copy_from_user(cxt->user_info, insn,
+					       &prg.insns[i],
+					       sizeof(a4l_insn_t));
+		if (ret != 0)
+			goto err_insnprg;
+
+		if (insn->data_size != 0 && insn->data == NULL) {
+			__a4l_err("a4l_ioctl_insnprg: "
+				  "no data pointer specified\n");
+			ret = -EINVAL;
+			goto err_insnprg;
+		}
+
+		insn->__udata = insn->data;
+		offs[i] = off;
+		off += ALIGN(insn->data_size, sizeof(unsigned long long));
+	}
+
+	kprg->size = PAGE_ALIGN(off ? off : 1);
+	kprg->data = vmalloc_32(kprg->size);
+	if (kprg->data == NULL) {
+		ret = -ENOMEM;
+		goto err_insnprg;
+	}
+
+	memset(kprg->data, 0, kprg->size);
+	for (vaddr = kprg->data;
+	     vaddr < (char *)kprg->data + kprg->size; vaddr += PAGE_SIZE)
+		SetPageReserved(vmalloc_to_page(vaddr));
+
+	/* Load the initial data of the write instructions */
+	for (i = 0; i < prg.count; i++) {
+		a4l_kinsn_t *insn = &kprg->insns[i];
+
+		insn->data = (char *)kprg->data + offs[i];
+		if (insn->data_size != 0 &&
+		    (insn->type & A4L_INSN_MASK_WRITE) != 0) {
+			ret = rtdm_safe_copy_from_user(cxt->user_info,
+						       insn->data,
+						       insn->__udata,
+						       insn->data_size);
+			if (ret != 0)
+				goto err_insnprg;
+		}
+	}
+
+	ret = rtdm_mmap_to_user(cxt->user_info,
+				kprg->data, kprg->size,
+				PROT_READ | PROT_WRITE,
+				&prg.data, &a4l_insnprg_vm_ops, kprg);
+	if (ret < 0) {
+		__a4l_err("a4l_ioctl_insnprg: internal error, "
+			  "rtdm_mmap_to_user failed (err=%d)\n", ret);
+		goto err_insnprg;
+	}
+
+	/* The initial mapping does not go through vm_ops->open */
+	atomic_inc(&kprg->refcnt);
+
+	/* Point the user instructions at their data in the shared
+	   area */
+	for (i = 0; i < prg.count; i++) {
+		void *udata = (char *)prg.data + offs[i];
+
+		ret = rtdm_safe_copy_to_user(cxt->user_info,
+					     &prg.insns[i].data,
+					     &udata, sizeof(void *));
+		if (ret != 0)
+			goto err_insnprg;
+	}
+
+	prg.size = kprg->size;
+	ret = rtdm_safe_copy_to_user(cxt->user_info,
+				     arg, &prg, sizeof(a4l_insnprg_t));
+	if (ret != 0)
+		goto err_insnprg;
+
+	rtdm_free(offs);
+
+	a4l_lock_irqsave(&cxt->insnprg_lock, flags);
+	if (cxt->insnprg == NULL) {
+		cxt->insnprg = kprg;
+		kprg = NULL;
+	}
+	a4l_unlock_irqrestore(&cxt->insnprg_lock, flags);
+
+	/* Somebody else registered a program meanwhile */
+	if (kprg != NULL) {
+		__put_insnprg(kprg);
+		return -EBUSY;
+	}
+
+	return 0;
+
+err_insnprg:
+	if (offs != NULL)
+		rtdm_free(offs);
+	/* A mapped area is released upon unmapping */
+	__put_insnprg(kprg);
+
+	return ret;
+}
+
+int a4l_ioctl_insnprgrun(a4l_cxt_t * cxt, void *arg)
+{
+	a4l_dev_t *dev = a4l_get_dev(cxt);
+	unsigned long flags;
+	a4l_kiprg_t *prg;
+	int i, ret = 0;
+
+	if (!rtdm_in_rt_context() && rtdm_rt_capable(cxt->user_info))
+		return -ENOSYS;
+
+	/* Basic checking */
+	if (!test_bit(A4L_DEV_ATTACHED_NR, &dev->flags)) {
+		__a4l_err("a4l_ioctl_insnprgrun: unattached device\n");
+		return -EINVAL;
+	}
+
+	/* The busy bit keeps the program from being replaced until
+	   the run is over */
+	a4l_lock_irqsave(&cxt->insnprg_lock, flags);
+	prg = cxt->insnprg;
+	if (prg == NULL)
+		ret = -ENOENT;
+	else if (test_and_set_bit(A4L_INSNPRG_BUSY_NR, &prg->status))
+		ret = -EBUSY;
+	a4l_unlock_irqrestore(&cxt->insnprg_lock, flags);
+
+	if (ret)
+		return ret;
+
+	/* Performs the instructions in place */
+	for (i = 0; i < prg->count && ret >= 0; i++) {
+		if ((prg->insns[i].type & A4L_INSN_MASK_SPECIAL) != 0)
+			ret = a4l_do_special_insn(cxt, &prg->insns[i]);
+		else
+			ret = a4l_do_insn(cxt, &prg->insns[i]);
+	}
+
+	clear_bit(A4L_INSNPRG_BUSY_NR, &prg->status);
+
+	return ret < 0 ? ret : 0;
+}
+
 #endif /* !DOXYGEN_CPP */
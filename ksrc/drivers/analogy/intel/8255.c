@@ -32,7 +32,7 @@ static a4l_chdesc_t chandesc_8255 = {
 	.mode = A4L_CHAN_GLOBAL_CHANDESC,
 	.length = 24,
 	.chans = {
-		{A4L_CHAN_AREF_GROUND, sizeof(sampl_t)},
+		{A4L_CHAN_AREF_GROUND, 1},
 	},
 };
 
@@ -208,12 +208,15 @@ void a4l_subdev_8255_init(a4l_subd_t *subd)
 	/* Subdevice filling part */
 
 	subd->flags = A4L_SUBD_DIO;
-	subd->flags |= A4L_SUBD_CMD;
 	subd->chan_desc = &chandesc_8255;
 	subd->insn_bits = subd_8255_insn_bits;
 	subd->insn_config = subd_8255_insn_config;
 
-	if(subd_8255->have_irq) {
+	/* Without interrupt line, commands are paced by the core */
+	if(!subd_8255->have_irq)
+		subd->flags |= A4L_SUBD_SWCMD;
+	else {
+		subd->flags |= A4L_SUBD_CMD;
 		subd->cmd_mask = &cmd_mask_8255;
 		subd->do_cmdtest = subd_8255_cmdtest;
 		subd->do_cmd = subd_8255_cmd;
@@ -304,7 +304,7 @@ static a4l_chdesc_t parport_chan_desc_intr = {
 
 static void setup_subd_a(a4l_subd_t *subd)
 {
-	subd->flags = A4L_SUBD_DIO;
+	subd->flags = A4L_SUBD_DIO | A4L_SUBD_SWCMD;
 	subd->chan_desc = &parport_chan_desc_a;
 	subd->rng_desc = &range_digital;
 	subd->insn_bits = parport_insn_a;
@@ -313,7 +313,7 @@ static void setup_subd_a(a4l_subd_t *subd)
 
 static void setup_subd_b(a4l_subd_t *subd)
 {
-	subd->flags = A4L_SUBD_DI;
+	subd->flags = A4L_SUBD_DI | A4L_SUBD_SWCMD;
 	subd->chan_desc = &parport_chan_desc_b;
 	subd->rng_desc = &range_digital;
 	subd->insn_bits = parport_insn_b;
@@ -321,7 +321,7 @@ static void setup_subd_b(a4l_subd_t *subd)
 
 static void setup_subd_c(a4l_subd_t *subd)
 {
-	subd->flags = A4L_SUBD_DO;
+	subd->flags = A4L_SUBD_DO | A4L_SUBD_SWCMD;
 	subd->chan_desc = &parport_chan_desc_c;
 	subd->rng_desc = &range_digital;
 	subd->insn_bits = parport_insn_c;
@@ -748,7 +748,9 @@ static void handle_gpct_interrupt(a4l_dev_t *dev, unsigned short counter_index)
 #if (defined(CONFIG_XENO_DRIVERS_ANALOGY_NI_MITE) || \
      defined(CONFIG_XENO_DRIVERS_ANALOGY_NI_MITE_MODULE))
 	struct ni_gpct *counter = devpriv->counter_dev->counters[counter_index];
-	a4l_ni_tio_handle_interrupt(counter, dev);
+	a4l_ni_tio_handle_interrupt(counter,
+				    a4l_get_subd(dev,
+						 NI_GPCT_SUBDEV(counter_index)));
 #endif /* CONFIG_XENO_DRIVERS_ANALOGY_NI_MITE */
 }
 
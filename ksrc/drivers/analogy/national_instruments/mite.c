@@ -401,7 +401,9 @@ int a4l_mite_buf_change(struct mite_dma_descriptor_ring *ring, a4l_subd_t *subd)
 	if (buf->size == 0) {
 		return 0;
 	}
-	n_links = buf->size >> PAGE_SHIFT;
+	/* One descriptor per physically contiguous chunk of the
+	   buffer */
+	n_links = buf->sg_count;
 
 	MDPRINTK("ring->pcidev=%p, n_links=0x%04x\n", ring->pcidev, n_links);
 
@@ -416,8 +418,8 @@ int a4l_mite_buf_change(struct mite_dma_descriptor_ring *ring, a4l_subd_t *subd)
 	ring->n_links = n_links;
 
 	for (i = 0; i < n_links; i++) {
-		ring->descriptors[i].count = cpu_to_le32(PAGE_SIZE);
-		ring->descriptors[i].addr = cpu_to_le32(buf->pg_list[i]);
+		ring->descriptors[i].count = cpu_to_le32(buf->sg_list[i].size);
+		ring->descriptors[i].addr = cpu_to_le32(buf->sg_list[i].addr);
 		ring->descriptors[i].next =
 			cpu_to_le32(ring->descriptors_dma_addr +
 				    (i + 1) * sizeof(struct mite_dma_descriptor));
@@ -935,12 +935,32 @@ static int ni_660x_cmd(a4l_subd_t *s, a4l_cmd_t* cmd)
 		return retval;
 	}
 
+	/* The samples are written by the MITE straight into the
+	   buffer, one link per physically contiguous chunk */
+	retval = a4l_mite_buf_change(mite_ring(private(s->dev), counter), s);
+	if (retval) {
+		a4l_err(s->dev, 
+			"%s: dma ring configuration failed\n", __FUNCTION__);
+		goto out_release;
+	}
+
 	a4l_ni_tio_acknowledge_and_confirm (counter, NULL, NULL, NULL, NULL);
 	retval = a4l_ni_tio_cmd(counter, cmd);
+	if (retval == 0)
+		return 0;
+
+out_release:
+	ni_660x_release_mite_channel(s->dev, counter);
 
 	return retval;
 }
 
+static int ni_660x_inttrig(a4l_subd_t *s, lsampl_t trignum)
+{
+	struct ni_gpct *counter = subdev_priv->counter;
+	return a4l_ni_tio_input_inttrig(counter, trignum);
+}
+
 static int ni_660x_cmdtest(a4l_subd_t *s, a4l_cmd_t *cmd)
 {
 	struct ni_gpct *counter = subdev_priv->counter;
@@ -976,34 +996,36 @@ static void set_tio_counterswap(a4l_dev_t *dev, int chipset)
 static void ni_660x_handle_gpct_interrupt(a4l_dev_t *dev,
 					  a4l_subd_t *s)
 {
-   a4l_buf_t *buf = s->buf;
-
-   a4l_ni_tio_handle_interrupt(subdev_priv->counter, dev);
-   if ( test_bit(A4L_BUF_EOA_NR, &buf->flags) && 
-        test_bit(A4L_BUF_ERROR_NR, &buf->flags) && 
-        test_bit(A4L_BUF_EOA_NR, &buf->flags))
-	   ni_660x_cancel(s);
-   else
-	   a4l_buf_evt(s, 0);
+	a4l_buf_t *buf = s->buf;
+
+	/* Only the counters running a command are concerned */
+	if (buf == NULL || !test_bit(A4L_SUBD_BUSY_NR, &s->status))
+		return;
+
+	a4l_ni_tio_handle_interrupt(subdev_priv->counter, s);
+
+	/* Stop the counter and its DMA channel right away, the buffer
+	   is cleaned up once the user side cancels the command */
+	if (test_bit(A4L_BUF_ERROR_NR, &buf->flags))
+		ni_660x_cancel(s);
 }
 
 static int ni_660x_interrupt(unsigned int irq, void *d)
 {
 	a4l_dev_t *dev = d;
 	unsigned long flags;
+	unsigned int i;
 
-	if (test_bit(A4L_DEV_ATTACHED_NR, &dev->flags))
+	if (!test_bit(A4L_DEV_ATTACHED_NR, &dev->flags))
 		return -ENOENT;
 
 	/* Lock to avoid race with comedi_poll */
 	a4l_lock_irqsave(&private(dev)->interrupt_lock, flags);
 	smp_mb();
 	
-	while (&dev->subdvsq != dev->subdvsq.next) {
-		struct list_head *this = dev->subdvsq.next;
-		a4l_subd_t *tmp = list_entry(this, a4l_subd_t, list);
-		ni_660x_handle_gpct_interrupt(dev, tmp);
-	}
+	for (i = 0; i < ni_660x_num_counters(dev); i++)
+		ni_660x_handle_gpct_interrupt(dev,
+			a4l_get_subd(dev, NI_660X_GPCT_SUBDEV(i)));
    
 	a4l_unlock_irqrestore(&private(dev)->interrupt_lock, flags);
 	return 0;
@@ -1141,7 +1163,6 @@ static int ni_660x_attach(a4l_dev_t *dev, a4l_lnkdesc_t *arg)
 	}
 
 	s->flags          = A4L_SUBD_DIO;
-	s->flags         |= A4L_SUBD_CMD;
 	s->chan_desc      = &chandesc_ni660x;
 	s->rng_desc       = &range_digital;
 	s->insn_bits      = ni_660x_dio_insn_bits;
@@ -1183,14 +1204,25 @@ static int ni_660x_attach(a4l_dev_t *dev, a4l_lnkdesc_t *arg)
 				return -ENOMEM;
 
 			s->flags             = A4L_SUBD_COUNTER;
-			s->chan_desc         = rtdm_malloc (sizeof (a4l_chdesc_t));
+			s->flags            |= A4L_SUBD_CMD;
+			s->chan_desc         = rtdm_malloc (sizeof (a4l_chdesc_t) +
+							    sizeof (a4l_chan_t));
+			if (s->chan_desc == NULL)
+				return -ENOMEM;
+			/* Each sample is a 32 bits count, either an edge
+			   count or a period, latched on the gate */
+			s->chan_desc->mode   = A4L_CHAN_GLOBAL_CHANDESC;
 			s->chan_desc->length = 3;
+			s->chan_desc->chans[0].flags = 0;
+			s->chan_desc->chans[0].nb_bits = 32;
 			s->insn_read         = ni_660x_GPCT_rinsn;
 			s->insn_write        = ni_660x_GPCT_winsn;
 			s->insn_config       = ni_660x_GPCT_insn_config;
+			s->cmd_mask          = &a4l_ni_tio_cmd_mask;
 			s->do_cmd            = &ni_660x_cmd;
 			s->do_cmdtest        = &ni_660x_cmdtest;
 			s->cancel            = &ni_660x_cancel;
+			s->trigger           = &ni_660x_inttrig;
 
 			subdev_priv->counter = private(dev)->counter_dev->counters[i];
 			
@@ -1181,7 +1181,7 @@ int a4l_ni_tio_cmd(struct ni_gpct *counter, a4l_cmd_t *cmd);
 int a4l_ni_tio_cmdtest(struct ni_gpct *counter, a4l_cmd_t *cmd);
 int a4l_ni_tio_cancel(struct ni_gpct *counter);
 
-void a4l_ni_tio_handle_interrupt(struct ni_gpct *counter, a4l_dev_t *dev);
+void a4l_ni_tio_handle_interrupt(struct ni_gpct *counter, a4l_subd_t *subd);
 void a4l_ni_tio_set_mite_channel(struct ni_gpct *counter,
 			     struct mite_channel *mite_chan);
 void a4l_ni_tio_acknowledge_and_confirm(struct ni_gpct *counter,
@@ -1604,8 +1604,9 @@ static void ni_tio_configure_dma(struct ni_gpct *counter,
 	}
 }
 
-/* TODO: a4l_ni_tio_input_inttrig is left unused because the trigger
-   callback cannot be changed at run time */
+/* Trigger callback of the counter subdevices: with start_src set to
+   TRIG_INT, the command only configures the counter and the DMA
+   channel, both are armed here */
 int a4l_ni_tio_input_inttrig(struct ni_gpct *counter, lsampl_t trignum)
 {
 	unsigned long flags;
@@ -1615,6 +1616,7 @@ int a4l_ni_tio_input_inttrig(struct ni_gpct *counter, lsampl_t trignum)
 	if (trignum != 0)
 		return -EINVAL;
 
+	/* No DMA channel means no command in progress */
 	a4l_lock_irqsave(&counter->lock, flags);
 	if (counter->mite_chan)
 		a4l_mite_dma_arm(counter->mite_chan);
@@ -1623,14 +1625,8 @@ int a4l_ni_tio_input_inttrig(struct ni_gpct *counter, lsampl_t trignum)
 	a4l_unlock_irqrestore(&counter->lock, flags);
 	if (retval < 0)
 		return retval;
-	retval = ni_tio_arm(counter, 1, NI_GPCT_ARM_IMMEDIATE);
 
-	/* TODO: disable trigger until a command is recorded.
-	   Null trig at beginning prevent ao start trigger from executing
-	   more than once per command (and doing things like trying to
-	   allocate the ao dma channel multiple times) */
-
-	return retval;
+	return ni_tio_arm(counter, 1, NI_GPCT_ARM_IMMEDIATE);
 }
 
 static int ni_tio_input_cmd(struct ni_gpct *counter, a4l_cmd_t *cmd)
@@ -1664,6 +1660,7 @@ static int ni_tio_input_cmd(struct ni_gpct *counter, a4l_cmd_t *cmd)
 	case TRIG_EXT:
 		a4l_mite_dma_arm(counter->mite_chan);
 		retval = ni_tio_arm(counter, 1, cmd->start_arg);
+		break;
 	case TRIG_OTHER:
 		a4l_mite_dma_arm(counter->mite_chan);
 		break;
@@ -1899,16 +1896,16 @@ void a4l_ni_tio_acknowledge_and_confirm(struct ni_gpct *counter,
 	}
 }
 
-/* TODO: to be adapted after a4l_buf_evt review */
-void a4l_ni_tio_handle_interrupt(struct ni_gpct *counter, a4l_dev_t *dev)
+/* All the samples the MITE wrote since the last interrupt are
+   committed into the buffer at once, the reader is then notified
+   according to the wake-up settings of the buffer */
+void a4l_ni_tio_handle_interrupt(struct ni_gpct *counter, a4l_subd_t *subd)
 {
 	unsigned gpct_mite_status;
 	unsigned long flags;
 	int gate_error;
 	int tc_error;
 	int perm_stale_data;
-	a4l_subd_t *subd =
-		a4l_get_subd(dev, NI_GPCT_SUBDEV(counter->counter_index));
 
 	a4l_ni_tio_acknowledge_and_confirm(counter, &gate_error, &tc_error,
 		&perm_stale_data, NULL);
@@ -1945,6 +1942,8 @@ void a4l_ni_tio_handle_interrupt(struct ni_gpct *counter, a4l_dev_t *dev)
 	}
 	a4l_mite_sync_input_dma(counter->mite_chan, subd);
 	a4l_unlock_irqrestore(&counter->lock, flags);
+
+	a4l_buf_evt(subd, 0);
 }
 
 void a4l_ni_tio_set_mite_channel(struct ni_gpct *counter,
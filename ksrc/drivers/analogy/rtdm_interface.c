@@ -52,7 +52,12 @@ int (*a4l_ioctl_functions[NB_IOCTL_FUNCTIONS]) (a4l_cxt_t *, void *) = {
 	a4l_ioctl_nbchaninfo, 
 	a4l_ioctl_nbrnginfo,
 	a4l_ioctl_bufcfg2,
-	a4l_ioctl_bufinfo2
+	a4l_ioctl_bufinfo2,
+	a4l_ioctl_grptrig,
+	a4l_ioctl_mmapstamp,
+	a4l_ioctl_insnprg,
+	a4l_ioctl_insnprgrun,
+	a4l_ioctl_bufshare
 };
 
 #ifdef CONFIG_PROC_FS
@@ -148,6 +153,10 @@ int a4l_open(struct rtdm_dev_context *context,
 	   (thanks to minor index) */
 	a4l_set_dev(cxt);
 
+	/* No precompiled instruction list yet */
+	cxt->insnprg = NULL;
+	a4l_lock_init(&cxt->insnprg_lock);
+
 	/* Initialize the buffer structure */
 	cxt->buffer = rtdm_malloc(sizeof(a4l_buf_t));
 	a4l_init_buffer(cxt->buffer);
@@ -174,6 +183,9 @@ int a4l_close(struct rtdm_dev_context *context, rtdm_user_info_t * user_info)
 		return err;
 	}
 
+	/* Drop the precompiled instruction list, if any */
+	a4l_free_insnprg(cxt);
+
 	/* Free the buffer which was linked with this context and... */
 	a4l_free_buffer(cxt->buffer);
 
@@ -628,7 +628,7 @@ static void setup_subd_gpct(a4l_subd_t *subd)
 /* Analog input subdevice */
 static void setup_subd_ai(a4l_subd_t *subd)
 {
-	subd->flags = A4L_SUBD_AI;
+	subd->flags = A4L_SUBD_AI | A4L_SUBD_SWCMD;
 	subd->chan_desc = &s526_chan_desc_ai;
 	subd->rng_desc = &a4l_range_bipolar10;
 	subd->insn_read = s526_ai_rinsn;
@@ -638,7 +638,7 @@ static void setup_subd_ai(a4l_subd_t *subd)
 /* Analog output subdevice */
 static void setup_subd_ao(a4l_subd_t *subd)
 {
-	subd->flags = A4L_SUBD_AO;
+	subd->flags = A4L_SUBD_AO | A4L_SUBD_SWCMD;
 	subd->chan_desc = &s526_chan_desc_ao;
 	subd->rng_desc = &a4l_range_bipolar10;
 	subd->insn_write = s526_ao_winsn;
@@ -648,7 +648,7 @@ static void setup_subd_ao(a4l_subd_t *subd)
 /* Digital i/o subdevice */
 static void setup_subd_dio(a4l_subd_t *subd)
 {
-	subd->flags = A4L_SUBD_DIO;
+	subd->flags = A4L_SUBD_DIO | A4L_SUBD_SWCMD;
 	subd->chan_desc = &s526_chan_desc_dio;
 	subd->rng_desc = &range_digital;
 	subd->insn_bits = s526_dio_insn_bits;
@@ -123,6 +123,29 @@ int a4l_check_chanlist(a4l_subd_t *subd,
 	return 0;
 }
 
+/* The size of one element of a digital subdevice, rounded like
+   a4l_sizeof_subd() does in the library */
+int a4l_get_bitfield_size(a4l_subd_t *subd)
+{
+	int i, bits = 0;
+
+	if (subd->chan_desc->mode == A4L_CHAN_GLOBAL_CHANDESC)
+		bits = subd->chan_desc->length *
+			subd->chan_desc->chans[0].nb_bits;
+	else
+		for (i = 0; i < subd->chan_desc->length; i++)
+			bits += subd->chan_desc->chans[i].nb_bits;
+
+	if (bits <= 8)
+		return 1;
+	if (bits <= 16)
+		return 2;
+	if (bits <= 32)
+		return 4;
+
+	return -EINVAL;
+}
+
 /* --- Upper layer functions --- */
 
 a4l_subd_t * a4l_alloc_subd(int sizeof_priv,
@@ -150,6 +173,13 @@ int a4l_add_subd(a4l_dev_t * dev, a4l_subd_t * subd)
 	if (dev == NULL || subd == NULL)
 		return -EINVAL;
 
+	/* Subdevices without pacer may still run commands */
+	if (subd->flags & A4L_SUBD_SWCMD) {
+		int err = a4l_setup_swcmd(subd);
+		if (err < 0)
+			return err;
+	}
+
 	list_add_tail(&subd->list, &dev->subdvsq);
 
 	subd->dev = dev;
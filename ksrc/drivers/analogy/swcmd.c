@@ -0,0 +1,370 @@
+/**
+ * @file
+ * Analogy for Linux, software-paced commands
+ *
+ * Xenomai is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DOXYGEN_CPP
+
+#include <linux/module.h>
+#include <asm/errno.h>
+
+#include <analogy/context.h>
+#include <analogy/device.h>
+
+/* Boards without pacer clock only provide synchronous instructions;
+   when a driver sets A4L_SUBD_SWCMD on such a subdevice, the core
+   runs commands on it by calling the instruction handlers from a
+   real-time timer, once per scan. Each scan goes through the
+   asynchronous buffer with a single put (or get) and a single event,
+   so that the wake-up size, the wake-up period, the stamps and mmap
+   work as they would with a DMA-capable board.
+
+   The handlers run in the timer interrupt: they must not sleep,
+   and should not busy-wait for long. */
+
+/* Shortest scan period, every scan costs a timer interrupt */
+#define A4L_SWCMD_MIN_PERIOD 10000
+
+struct a4l_swcmd {
+	rtdm_timer_t timer;
+	a4l_subd_t *subd;
+	nanosecs_rel_t period;
+	int started;
+	/* Scans left if the command has a stop count, 0 otherwise */
+	unsigned long scans;
+	unsigned long scan_size;
+	/* Element size of a digital subdevice, 0 for the others */
+	int bits_size;
+	/* Channels of the command, as an insn_bits mask */
+	unsigned long mask;
+	/* Scan in progress, at most one lsampl_t per channel */
+	lsampl_t scan[0];
+};
+
+static a4l_cmd_t a4l_swcmd_mask = {
+	.idx_subd = 0,
+	.start_src = TRIG_NOW | TRIG_INT,
+	.scan_begin_src = TRIG_TIMER,
+	.convert_src = TRIG_NOW,
+	.scan_end_src = TRIG_COUNT,
+	.stop_src = TRIG_COUNT | TRIG_NONE,
+};
+
+/* Bitfields are exchanged with insn_bits on the width of the
+   subdevice's element */
+
+static inline unsigned long __get_bits(void *data, int size, int idx)
+{
+	switch (size) {
+	case 1:
+		return ((uint8_t *)data)[idx];
+	case 2:
+		return ((uint16_t *)data)[idx];
+	default:
+		return ((uint32_t *)data)[idx];
+	}
+}
+
+static inline void __set_bits(void *data, int size, int idx,
+			      unsigned long value)
+{
+	switch (size) {
+	case 1:
+		((uint8_t *)data)[idx] = value;
+		break;
+	case 2:
+		((uint16_t *)data)[idx] = value;
+		break;
+	default:
+		((uint32_t *)data)[idx] = value;
+	}
+}
+
+static int __swcmd_bits(struct a4l_swcmd *sw,
+			unsigned long mask, unsigned long *bits)
+{
+	a4l_subd_t *subd = sw->subd;
+	uint32_t data[2];
+	a4l_kinsn_t insn;
+	int ret;
+
+	__set_bits(data, sw->bits_size, 0, mask);
+	__set_bits(data, sw->bits_size, 1, *bits);
+
+	insn.type = A4L_INSN_BITS;
+	insn.idx_subd = subd->idx;
+	insn.chan_desc = 0;
+	insn.data_size = 2 * sw->bits_size;
+	insn.data = data;
+	insn.__udata = NULL;
+
+	ret = subd->insn_bits(subd, &insn);
+	if (ret < 0)
+		return ret;
+
+	*bits = __get_bits(data, sw->bits_size, 1);
+
+	return 0;
+}
+
+static int __swcmd_read_scan(struct a4l_swcmd *sw, a4l_cmd_t *cmd)
+{
+	a4l_subd_t *subd = sw->subd;
+	unsigned long bits = 0, offset = 0;
+	a4l_kinsn_t insn;
+	lsampl_t sample;
+	int i, ret;
+
+	if (sw->bits_size) {
+		ret = __swcmd_bits(sw, 0, &bits);
+		if (ret < 0)
+			return ret;
+		__set_bits(sw->scan, sw->bits_size, 0, bits);
+		goto put_scan;
+	}
+
+	insn.type = A4L_INSN_READ;
+	insn.idx_subd = subd->idx;
+	insn.data = &sample;
+	insn.__udata = NULL;
+
+	for (i = 0; i < cmd->nb_chan; i++) {
+		a4l_chan_t *chft =
+			a4l_get_chfeat(subd, CR_CHAN(cmd->chan_descs[i]));
+
+		insn.chan_desc = cmd->chan_descs[i];
+		insn.data_size = chft->nb_bits / 8;
+		ret = subd->insn_read(subd, &insn);
+		if (ret < 0)
+			return ret;
+		memcpy((char *)sw->scan + offset, &sample, insn.data_size);
+		offset += insn.data_size;
+	}
+
+put_scan:
+	/* A full buffer is an overrun, as with a hardware FIFO */
+	return a4l_buf_put(subd, sw->scan, sw->scan_size);
+}
+
+static int __swcmd_write_scan(struct a4l_swcmd *sw, a4l_cmd_t *cmd)
+{
+	a4l_subd_t *subd = sw->subd;
+	unsigned long bits, offset = 0;
+	a4l_kinsn_t insn;
+	lsampl_t sample;
+	int i, ret;
+
+	/* An empty buffer is an underrun */
+	ret = a4l_buf_get(subd, sw->scan, sw->scan_size);
+	if (ret < 0)
+		return ret;
+
+	if (sw->bits_size) {
+		bits = __get_bits(sw->scan, sw->bits_size, 0);
+		return __swcmd_bits(sw, sw->mask, &bits);
+	}
+
+	insn.type = A4L_INSN_WRITE;
+	insn.idx_subd = subd->idx;
+	insn.data = &sample;
+	insn.__udata = NULL;
+
+	for (i = 0; i < cmd->nb_chan; i++) {
+		a4l_chan_t *chft =
+			a4l_get_chfeat(subd, CR_CHAN(cmd->chan_descs[i]));
+
+		insn.chan_desc = cmd->chan_descs[i];
+		insn.data_size = chft->nb_bits / 8;
+		memcpy(&sample, (char *)sw->scan + offset, insn.data_size);
+		ret = subd->insn_write(subd, &insn);
+		if (ret < 0)
+			return ret;
+		offset += insn.data_size;
+	}
+
+	return 0;
+}
+
+/* Called with nklock held, which serializes it with the timer
+   destruction in a4l_swcmd_cancel() */
+static void a4l_swcmd_tick(rtdm_timer_t *timer)
+{
+	struct a4l_swcmd *sw = container_of(timer, struct a4l_swcmd, timer);
+	a4l_subd_t *subd = sw->subd;
+	a4l_cmd_t *cmd = a4l_get_cmd(subd);
+	int ret;
+
+	if (cmd == NULL) {
+		rtdm_timer_stop_in_handler(timer);
+		return;
+	}
+
+	if (a4l_subd_is_input(subd))
+		ret = __swcmd_read_scan(sw, cmd);
+	else
+		ret = __swcmd_write_scan(sw, cmd);
+
+	if (ret < 0) {
+		rtdm_timer_stop_in_handler(timer);
+		a4l_buf_evt(subd, A4L_BUF_ERROR);
+		return;
+	}
+
+	a4l_buf_evt(subd, 0);
+
+	if (sw->scans != 0 && --sw->scans == 0) {
+		rtdm_timer_stop_in_handler(timer);
+		a4l_buf_evt(subd, A4L_BUF_EOA);
+	}
+}
+
+static int a4l_swcmd_start(struct a4l_swcmd *sw)
+{
+	sw->started = 1;
+
+	return rtdm_timer_start(&sw->timer, sw->period, sw->period,
+				RTDM_TIMERMODE_RELATIVE);
+}
+
+static int a4l_swcmd_cmdtest(a4l_subd_t *subd, a4l_cmd_t *cmd)
+{
+	if (cmd->scan_begin_arg < A4L_SWCMD_MIN_PERIOD) {
+		__a4l_err("a4l_swcmd_cmdtest: scan period too short "
+			  "(%u < %u ns)\n",
+			  cmd->scan_begin_arg, A4L_SWCMD_MIN_PERIOD);
+		return -EINVAL;
+	}
+
+	if (cmd->scan_end_arg != cmd->nb_chan)
+		return -EINVAL;
+
+	if (cmd->stop_src == TRIG_COUNT && cmd->stop_arg == 0)
+		return -EINVAL;
+
+	/* Output data can only be written once the command is sent,
+	   the first scan would underrun */
+	if (!a4l_subd_is_input(subd) && cmd->start_src != TRIG_INT) {
+		__a4l_err("a4l_swcmd_cmdtest: output commands "
+			  "must start on TRIG_INT\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int a4l_swcmd_cmd(a4l_subd_t *subd, a4l_cmd_t *cmd)
+{
+	struct a4l_swcmd *sw;
+	int i, ret;
+
+	sw = rtdm_malloc(sizeof(*sw) + cmd->nb_chan * sizeof(lsampl_t));
+	if (sw == NULL)
+		return -ENOMEM;
+
+	memset(sw, 0, sizeof(*sw));
+	sw->subd = subd;
+	sw->period = cmd->scan_begin_arg;
+
+	if (cmd->stop_src == TRIG_COUNT)
+		sw->scans = cmd->stop_arg;
+
+	if (a4l_subd_is_digital(subd)) {
+		sw->bits_size = a4l_get_bitfield_size(subd);
+		sw->scan_size = sw->bits_size;
+		for (i = 0; i < cmd->nb_chan; i++)
+			sw->mask |= 1UL << CR_CHAN(cmd->chan_descs[i]);
+	} else
+		for (i = 0; i < cmd->nb_chan; i++)
+			sw->scan_size += a4l_get_chfeat(subd,
+				CR_CHAN(cmd->chan_descs[i]))->nb_bits / 8;
+
+	rtdm_timer_init(&sw->timer, a4l_swcmd_tick, "a4l_swcmd");
+
+	subd->swcmd = sw;
+
+	if (cmd->start_src == TRIG_NOW) {
+		ret = a4l_swcmd_start(sw);
+		if (ret < 0) {
+			subd->swcmd = NULL;
+			rtdm_timer_destroy(&sw->timer);
+			rtdm_free(sw);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static int a4l_swcmd_trigger(a4l_subd_t *subd, lsampl_t trignum)
+{
+	struct a4l_swcmd *sw = subd->swcmd;
+
+	if (sw == NULL || trignum != 0)
+		return -EINVAL;
+
+	if (sw->started)
+		return -EBUSY;
+
+	return a4l_swcmd_start(sw);
+}
+
+static int a4l_swcmd_cancel(a4l_subd_t *subd)
+{
+	struct a4l_swcmd *sw = subd->swcmd;
+
+	if (sw == NULL)
+		return 0;
+
+	subd->swcmd = NULL;
+	rtdm_timer_destroy(&sw->timer);
+	rtdm_free(sw);
+
+	return 0;
+}
+
+int a4l_setup_swcmd(a4l_subd_t *subd)
+{
+	int (*hdlr)(a4l_subd_t *, a4l_kinsn_t *);
+
+	if (a4l_subd_is_digital(subd)) {
+		hdlr = subd->insn_bits;
+		if (a4l_get_bitfield_size(subd) < 0) {
+			__a4l_err("a4l_setup_swcmd: bitfield too wide\n");
+			return -EINVAL;
+		}
+	} else if (a4l_subd_is_input(subd))
+		hdlr = subd->insn_read;
+	else
+		hdlr = subd->insn_write;
+
+	if (hdlr == NULL || subd->do_cmd != NULL) {
+		__a4l_err("a4l_setup_swcmd: subdevice cannot "
+			  "be software-paced\n");
+		return -EINVAL;
+	}
+
+	subd->flags |= A4L_SUBD_CMD | A4L_SUBD_MMAP;
+	subd->cmd_mask = &a4l_swcmd_mask;
+	subd->do_cmdtest = a4l_swcmd_cmdtest;
+	subd->do_cmd = a4l_swcmd_cmd;
+	subd->trigger = a4l_swcmd_trigger;
+	subd->cancel = a4l_swcmd_cancel;
+
+	return 0;
+}
+
+#endif /* !DOXYGEN_CPP */
@@ -7,9 +7,15 @@
 #define DIO_SUBD 1
 #define AO_SUBD 2
 #define AI2_SUBD 3
+#define HRAI_SUBD 4
 
 #define TRANSFER_SIZE 0x1000
 
+/* Default period of the bursts of the high-rate AI (ns) */
+#define HRAI_BURST_PERIOD 100000
+/* Shortest scan period accepted by the high-rate AI (ns) */
+#define HRAI_MIN_SCAN_PERIOD 100
+
 /* --- Driver related structures --- */
 
 struct fake_priv {
@@ -17,14 +23,17 @@ struct fake_priv {
 	   (they should be relocated in ai_priv) */
 	unsigned long amplitude_div;
 	unsigned long quanta_cnt;
+	unsigned long burst_ns;
 
-	/* Task descriptor */
+	/* Task descriptors */
 	a4l_task_t task;
+	a4l_task_t hrai_task;
 
 	/* Statuses of the asynchronous subdevices */
 	int ai_running;
 	int ao_running;
 	int ai2_running;
+	int hrai_running;
 };
 
 struct ai_priv {
@@ -49,6 +58,18 @@ struct ao_ai2_priv {
 	uint16_t insn_value;
 };
 
+struct hrai_priv {
+	/* Specific timing fields */
+	unsigned long scan_period_ns;
+	unsigned long reminder_ns;
+	unsigned long long last_ns;
+
+	/* Tag of the next sample */
+	uint32_t seq;
+	/* Scans lost because the buffer was full */
+	unsigned long dropped;
+};
+
 struct dio_priv {
 	/* Bits status */
 	uint16_t bits_values;
@@ -66,6 +87,14 @@ static a4l_chdesc_t analog_chandesc = {
 	},
 };
 
+static a4l_chdesc_t hrai_chandesc = {
+	.mode = A4L_CHAN_GLOBAL_CHANDESC,
+	.length = 16,
+	.chans = {
+		{A4L_CHAN_AREF_GROUND, 32},
+	},
+};
+
 static a4l_chdesc_t dio_chandesc = {
 	.mode = A4L_CHAN_GLOBAL_CHANDESC,
 	.length = 16,
@@ -105,6 +134,15 @@ static a4l_cmd_t ao_cmd_mask = {
 	.stop_src = TRIG_COUNT | TRIG_NONE,
 };
 
+static a4l_cmd_t hrai_cmd_mask = {
+	.idx_subd = 0,
+	.start_src = TRIG_NOW,
+	.scan_begin_src = TRIG_TIMER,
+	.convert_src = TRIG_NOW,
+	.scan_end_src = TRIG_COUNT,
+	.stop_src = TRIG_COUNT | TRIG_NONE,
+};
+
 /* --- Analog input simulation --- */
 
 /* --- Values generation for 1st AI --- */
@@ -223,6 +261,80 @@ int ai2_push_values(a4l_subd_t *subd)
 	return err;
 }
 
+/* --- Bursts for the high-rate AI --- */
+
+/* The high-rate AI behaves like a DMA-driven board: the scans due
+   since the previous burst are written in one go right into the
+   buffer, then published with a single commit and event. Every 32-bit
+   sample carries its index in the acquisition, so that the reader can
+   check the stream is contiguous; when the buffer is full, the scans
+   are dropped but their indexes are consumed all the same. */
+
+int hrai_push_burst(a4l_subd_t *subd)
+{
+	struct hrai_priv *priv = (struct hrai_priv *)subd->priv;
+	a4l_cmd_t *cmd = a4l_get_cmd(subd);
+	a4l_buf_t *buf = subd->buf;
+	unsigned long scan_size, scans, room, count, idx, words, i;
+	uint32_t *data = (uint32_t *)buf->buf;
+	uint64_t now_ns, elapsed_ns;
+	int err;
+
+	if (!cmd)
+		return -EPIPE;
+
+	now_ns = a4l_get_time();
+	elapsed_ns = now_ns - priv->last_ns + priv->reminder_ns;
+	priv->last_ns = now_ns;
+	priv->reminder_ns = do_div(elapsed_ns, priv->scan_period_ns);
+	scans = (unsigned long)elapsed_ns;
+	if (scans == 0)
+		return 0;
+
+	/* Nothing more to produce once the acquisition is complete */
+	if (buf->end_count != 0 && buf->prd_count == buf->end_count)
+		return 0;
+
+	scan_size = cmd->nb_chan * sizeof(uint32_t);
+	room = a4l_buf_count(subd);
+	if (buf->end_count != 0 && buf->end_count - buf->prd_count < room)
+		room = buf->end_count - buf->prd_count;
+	room /= scan_size;
+
+	count = scans < room ? scans : room;
+	if (count < scans) {
+		priv->dropped += scans - count;
+		a4l_dbg(1, drv_dbg, subd->dev,
+			"hrai_push_burst: %lu scans dropped\n",
+			scans - count);
+	}
+
+	if (count != 0) {
+		err = a4l_buf_prepare_put(subd, count * scan_size);
+		if (err < 0)
+			return err;
+
+		/* Samples are word-aligned, as is the buffer size */
+		words = buf->size / sizeof(uint32_t);
+		idx = (buf->prd_count % buf->size) / sizeof(uint32_t);
+		for (i = 0; i < count * cmd->nb_chan; i++) {
+			data[idx] = priv->seq++;
+			if (++idx == words)
+				idx = 0;
+		}
+
+		err = a4l_buf_commit_put(subd, count * scan_size);
+		if (err < 0)
+			return err;
+
+		a4l_buf_evt(subd, 0);
+	}
+
+	priv->seq += (scans - count) * cmd->nb_chan;
+
+	return 0;
+}
+
 /* --- Global task part --- */
 
 /* One task is enough for all the asynchronous subdevices, it is just
@@ -257,6 +369,28 @@ static void task_proc(void *arg)
 	}
 }
 
+/* The high-rate AI gets a task of its own, since it wakes up much
+   more often than the others */
+
+static void hrai_task_proc(void *arg)
+{
+	a4l_dev_t *dev = (a4l_dev_t *)arg;
+	a4l_subd_t *subd = (a4l_subd_t *)a4l_get_subd(dev, HRAI_SUBD);
+
+	struct fake_priv *priv = (struct fake_priv *)dev->priv;
+
+	while (1) {
+
+		int running;
+
+		RTDM_EXECUTE_ATOMICALLY(running = priv->hrai_running);
+		if (running && hrai_push_burst(subd) < 0)
+			break;
+
+		a4l_task_sleep(running ? priv->burst_ns : TASK_PERIOD);
+	}
+}
+
 /* --- Asynchronous AI functions --- */
 
 static int ai_cmd(a4l_subd_t *subd, a4l_cmd_t *cmd)
@@ -315,6 +449,51 @@ static void ai_munge(a4l_subd_t *subd, void *buf, unsigned long size)
 		((uint16_t *)buf)[i] += 1;
 }
 
+/* --- Asynchronous high-rate AI functions --- */
+
+static int hrai_cmd(a4l_subd_t *subd, a4l_cmd_t *cmd)
+{
+	struct fake_priv *priv = (struct fake_priv *)subd->dev->priv;
+	struct hrai_priv *hrai_priv = (struct hrai_priv *)subd->priv;
+
+	hrai_priv->scan_period_ns = cmd->scan_begin_arg;
+	hrai_priv->reminder_ns = 0;
+	hrai_priv->seq = 0;
+	hrai_priv->dropped = 0;
+
+	a4l_dbg(1, drv_dbg, subd->dev,
+		"hrai_cmd: scan_period=%luns burst_period=%luns\n",
+		hrai_priv->scan_period_ns, priv->burst_ns);
+
+	hrai_priv->last_ns = a4l_get_time();
+
+	RTDM_EXECUTE_ATOMICALLY(priv->hrai_running = 1);
+
+	return 0;
+}
+
+static int hrai_cmdtest(a4l_subd_t *subd, a4l_cmd_t *cmd)
+{
+	if (cmd->scan_begin_src == TRIG_TIMER &&
+	    cmd->scan_begin_arg < HRAI_MIN_SCAN_PERIOD)
+		return -EINVAL;
+
+	return 0;
+}
+
+static int hrai_cancel(a4l_subd_t *subd)
+{
+	struct fake_priv *priv = (struct fake_priv *)subd->dev->priv;
+	struct hrai_priv *hrai_priv = (struct hrai_priv *)subd->priv;
+
+	RTDM_EXECUTE_ATOMICALLY(priv->hrai_running = 0);
+
+	a4l_info(subd->dev, "hrai_cancel: (subd=%d) %lu scans dropped\n",
+		 subd->idx, hrai_priv->dropped);
+
+	return 0;
+}
+
 /* --- Asynchronous A0 functions --- */
 
 int ao_cmd(a4l_subd_t *subd, a4l_cmd_t *cmd)
@@ -515,6 +694,20 @@ void setup_ai2_subd(a4l_subd_t *subd)
 	subd->insn_read = ai2_insn_read;
 }
 
+void setup_hrai_subd(a4l_subd_t *subd)
+{
+	/* Fill the subdevice structure */
+	subd->flags |= A4L_SUBD_AI;
+	subd->flags |= A4L_SUBD_CMD;
+	subd->flags |= A4L_SUBD_MMAP;
+	subd->rng_desc = &analog_rngdesc;
+	subd->chan_desc = &hrai_chandesc;
+	subd->do_cmd = hrai_cmd;
+	subd->do_cmdtest = hrai_cmdtest;
+	subd->cancel = hrai_cancel;
+	subd->cmd_mask = &hrai_cmd_mask;
+}
+
 /* --- Attach / detach functions ---  */
 
 int test_attach(a4l_dev_t *dev, a4l_lnkdesc_t *arg)
@@ -530,20 +723,29 @@ int test_attach(a4l_dev_t *dev, a4l_lnkdesc_t *arg)
 	/* Set default values for attach parameters */
 	priv->amplitude_div = 1;
 	priv->quanta_cnt = 1;
+	priv->burst_ns = HRAI_BURST_PERIOD;
 
 	if (arg->opts_size >= sizeof(unsigned long)) {
 		unsigned long *args = (unsigned long *)arg->opts;
 		priv->amplitude_div = args[0];
 
-		if (arg->opts_size == 2 * sizeof(unsigned long))
+		if (arg->opts_size >= 2 * sizeof(unsigned long))
 			priv->quanta_cnt = (args[1] > 7 || args[1] == 0) ?
 				1 : args[1];
+
+		/* The third parameter is the burst period (ns) of the
+		   high-rate AI */
+		if (arg->opts_size >= 3 * sizeof(unsigned long) &&
+		    args[2] >= 1000)
+			priv->burst_ns = args[2];
 	}
 
 	a4l_dbg(1, drv_dbg, dev,
 		"amplitude divisor = %lu\n", priv->amplitude_div);
 	a4l_dbg(1, drv_dbg, dev,
 		"quanta count = %lu\n", priv->quanta_cnt);
+	a4l_dbg(1, drv_dbg, dev,
+		"burst period = %luns\n", priv->burst_ns);
 
 	/* Add the AI subdevice to the device */
 	subd = a4l_alloc_subd(sizeof(struct ai_priv), setup_ai_subd);
@@ -598,12 +800,31 @@ int test_attach(a4l_dev_t *dev, a4l_lnkdesc_t *arg)
 
 	a4l_dbg(1, drv_dbg, dev, "AI2 subdevice registered\n");
 
+	/* Add the high-rate AI subdevice to the device */
+	subd = a4l_alloc_subd(sizeof(struct hrai_priv), setup_hrai_subd);
+	if(subd == NULL)
+		return -ENOMEM;
+
+	memset(subd->priv, 0, sizeof(struct hrai_priv));
+	ret = a4l_add_subd(dev, subd);
+	if(ret != HRAI_SUBD)
+		return (ret < 0) ? ret : -EINVAL;
+
+	a4l_dbg(1, drv_dbg, dev, "high-rate AI subdevice registered\n");
+
 	ret = a4l_task_init(&priv->task, 
 			    "Fake AI task", 
 			    task_proc, 
 			    dev, A4L_TASK_HIGHEST_PRIORITY);
 
-	a4l_dbg(1, drv_dbg, dev, "AI2 subdevice registered\n");
+	ret = a4l_task_init(&priv->hrai_task,
+			    "Fake high-rate AI task",
+			    hrai_task_proc,
+			    dev, A4L_TASK_HIGHEST_PRIORITY);
+	if (ret < 0) {
+		a4l_task_destroy(&priv->task);
+		return ret;
+	}
 
 	a4l_dbg(1, drv_dbg, dev, "attach procedure complete\n");
 
@@ -614,6 +835,7 @@ int test_detach(a4l_dev_t *dev)
 {
 	struct fake_priv *priv = (struct fake_priv *)dev->priv;
 
+	a4l_task_destroy(&priv->hrai_task);
 	a4l_task_destroy(&priv->task);
 
 	a4l_dbg(1, drv_dbg, dev, "detach procedure complete\n");
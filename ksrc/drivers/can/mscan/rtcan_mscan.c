@@ -163,6 +163,7 @@ static inline void rtcan_mscan_err_interrupt(struct rtcan_device *dev,
 			/* Disable receiver interrupts */
 			out_8(&regs->canrier, 0);
 			/* Wake up waiting senders */
+			rtcan_tx_flush(dev);
 			rtdm_sem_destroy(&dev->tx_sem);
 			break;
 
@@ -207,6 +208,8 @@ static int rtcan_mscan_interrupt(rtdm_irq_t *irq_handle)
 
 	rtdm_lock_get(&dev->device_lock);
 
+	rtcan_lat_isr_enter(dev);
+
 	canrflg = in_8(&regs->canrflg);
 
 	ret = RTDM_IRQ_HANDLED;
@@ -215,8 +218,8 @@ static int rtcan_mscan_interrupt(rtdm_irq_t *irq_handle)
 	if ((in_8(&regs->cantier) & MSCAN_TXIE0) &&
 	    (in_8(&regs->cantflg) & MSCAN_TXE0)) {
 		out_8(&regs->cantier, 0);
-		/* Wake up a sender */
-		rtdm_sem_up(&dev->tx_sem);
+
+		rtcan_lat_tx_complete(dev);
 
 		if (rtcan_loopback_pending(dev)) {
 
@@ -228,6 +231,9 @@ static int rtcan_mscan_interrupt(rtdm_irq_t *irq_handle)
 
 			rtcan_loopback(dev);
 		}
+
+		/* Refill from the TX queue or wake up a sender */
+		rtcan_tx_done(dev);
 	}
 
 	/* Wakeup interrupt?  */
@@ -372,6 +378,7 @@ static int rtcan_mscan_mode_stop(struct rtcan_device *dev,
 	/* Volatile state could have changed while we slept busy. */
 	dev->state = CAN_STATE_STOPPED;
 	/* Wake up waiting senders */
+	rtcan_tx_flush(dev);
 	rtdm_sem_destroy(&dev->tx_sem);
 
 out:
@@ -178,6 +178,7 @@ struct rtcan_device *rtcan_dev_alloc(int sizeof_priv, int sizeof_board_priv)
     /* Init TX Semaphore, will be destroyed forthwith
      * when setting stop mode */
     rtdm_sem_init(&dev->tx_sem, 0);
+    INIT_LIST_HEAD(&dev->tx_queue);
 #ifdef RTCAN_USE_REFCOUNT
     atomic_set(&dev->refcount, 0);
 #endif
@@ -270,6 +271,8 @@ int rtcan_dev_unregister(struct rtcan_device *dev)
     if (CAN_STATE_OPERATING(dev->state))
 	return -EBUSY;
 
+    rtcan_gw_cleanup(dev);
+
     down(&rtcan_devices_nrt_lock);
 
     rtcan_dev_remove_proc(dev);
@@ -42,6 +42,23 @@
  * for reception at the same time using Bind */
 #define RTCAN_MAX_RECEIVERS  CONFIG_XENO_DRIVERS_CAN_MAX_RECEIVERS
 
+/* Number of buckets of the exact-ID reception index (must be 2^N) */
+#define RTCAN_RECV_HASH_BITS 6
+#define RTCAN_RECV_HASH_SIZE (1 << RTCAN_RECV_HASH_BITS)
+
+/* Number of TX priority bands reported in /proc, by the 3 most
+ * significant ID bits */
+#define RTCAN_TX_PRIO_BANDS  8
+
+/* Depth of the per-device receive FIFO feeding the receive task
+ * (must be 2^N) and size of the per-device route table */
+#define RTCAN_RX_FIFO_SIZE   64
+#define RTCAN_GW_MAX_ROUTES  16
+
+/* Number of buckets of the latency histograms. Bucket N counts delays
+ * below 2^N ns, the last one all longer delays. */
+#define RTCAN_LAT_BUCKETS    24
+
 /* Suppress handling of refcount if module support is not enabled
  * or modules cannot be unloaded */
 
@@ -68,6 +85,12 @@ struct can_bittiming_const {
 	__u32 brp_inc;
 };
 
+struct rtcan_lat_hist {
+    unsigned int        buckets[RTCAN_LAT_BUCKETS];
+    unsigned int        count;
+    nanosecs_rel_t      max;
+};
+
 struct rtcan_device {
     unsigned int        version;
 
@@ -100,6 +123,15 @@ struct rtcan_device {
      * destroyed if it goes into reset mode. */
     rtdm_sem_t          tx_sem;
 
+    /* Senders waiting for the controller, ordered by arbitration
+     * priority, and per-band queue statistics. Protected by
+     * device_lock. */
+    struct list_head    tx_queue;
+    int                 tx_refill;
+    unsigned int        tx_queued[RTCAN_TX_PRIO_BANDS];
+    unsigned int        tx_queued_max[RTCAN_TX_PRIO_BANDS];
+    unsigned int        tx_refills;
+
     /* Baudrate of this device. Protected by device_lock in all device
      * structures. */
     unsigned int        can_sys_clock;
@@ -137,6 +169,12 @@ struct rtcan_device {
 #ifdef CONFIG_XENO_DRIVERS_CAN_BUS_ERR
     void                (*do_enable_bus_err)(struct rtcan_device *dev);
 #endif
+    /* Optional. Programs the hardware acceptance filter with a filter
+     * covering all registered receivers. Called with device_lock held
+     * before the controller is started. */
+    int                 (*do_set_filter)(struct rtcan_device *dev,
+					 can_filter_t *filter,
+					 rtdm_lockctx_t *lock_ctx);
 
     /* Reception list head. This list contains all filters which have been
      * registered via a bind call. */
@@ -153,11 +191,56 @@ struct rtcan_device {
     /* Indicates the length of the empty list */
     int                             free_entries;
 
+    /* Index of the reception list, rebuilt whenever it changes. Filters
+     * matching on all standard ID bits are hashed by CAN ID, all others
+     * are chained in recv_masked and checked for every frame. */
+    struct rtcan_recv               *recv_hash[RTCAN_RECV_HASH_SIZE];
+    struct rtcan_recv               *recv_masked;
+
     /* A few statistics counters */
     unsigned int tx_count;
     unsigned int rx_count;
     unsigned int err_count;
 
+#ifdef CONFIG_XENO_DRIVERS_CAN_GW
+    /* Receive task, running if rx_task_on is set, on rx_cpu or on any
+     * CPU if negative. Protected by nrt_lock. */
+    rtdm_task_t         rx_task;
+    rtdm_event_t        rx_event;
+    int                 rx_task_on;
+    int                 rx_cpu;
+
+    /* Set while received frames are queued for the receive task instead
+     * of being dispatched from the IRQ handler. The FIFO, its indexes
+     * and the route table are protected by rtcan_recv_list_lock. */
+    int                 rx_deferred;
+    unsigned int        rx_fifo_head;
+    unsigned int        rx_fifo_tail;
+    unsigned int        rx_overruns;
+    struct rtcan_skb    rx_fifo[RTCAN_RX_FIFO_SIZE];
+
+    struct can_route    routes[RTCAN_GW_MAX_ROUTES];
+    int                 nr_routes;
+
+    /* Frames forwarded from this device, and those which could not be
+     * handed over to the output controller */
+    unsigned int        gw_forwarded;
+    unsigned int        gw_dropped;
+#endif /* CONFIG_XENO_DRIVERS_CAN_GW */
+
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+    /* Date the IRQ handler was entered, and date the frame being
+     * transmitted was sent by its owner, 0 if none. The histograms
+     * collect the delays from interrupt entry to delivery to the
+     * sockets, from delivery to dequeue by the receivers, and from
+     * send to TX-complete interrupt. Protected by device_lock. */
+    nanosecs_abs_t      isr_stamp;
+    nanosecs_abs_t      tx_stamp;
+    struct rtcan_lat_hist lat_isr_rcv;
+    struct rtcan_lat_hist lat_rcv_deq;
+    struct rtcan_lat_hist lat_tx;
+#endif /* CONFIG_XENO_DRIVERS_CAN_LATENCY */
+
 #ifdef CONFIG_PROC_FS
     struct proc_dir_entry *proc_root;
 #endif
@@ -171,6 +254,14 @@ struct rtcan_device {
 extern struct semaphore rtcan_devices_nrt_lock;
 
 
+static inline unsigned int rtcan_recv_hashfn(uint32_t can_id)
+{
+    can_id &= CAN_SFF_MASK;
+    return (can_id ^ (can_id >> RTCAN_RECV_HASH_BITS)) &
+	(RTCAN_RECV_HASH_SIZE - 1);
+}
+
+
 void rtcan_dev_free(struct rtcan_device *dev);
 
 int rtcan_dev_register(struct rtcan_device *dev);
@@ -190,6 +281,53 @@ struct rtcan_device *rtcan_dev_get_by_index(int ifindex);
 #define rtcan_dev_dereference(dev)    do {} while(0)
 #endif
 
+#ifdef CONFIG_XENO_DRIVERS_CAN_GW
+void rtcan_gw_queue(struct rtcan_device *dev, struct rtcan_skb *skb);
+int rtcan_gw_add_route(struct can_route *route);
+int rtcan_gw_del_route(struct can_route *route);
+int rtcan_gw_set_rx_cpu(struct rtcan_device *dev, int cpu);
+void rtcan_gw_cleanup(struct rtcan_device *dev);
+#else /* !CONFIG_XENO_DRIVERS_CAN_GW */
+#define rtcan_gw_cleanup(dev)	do { } while (0)
+#endif /* !CONFIG_XENO_DRIVERS_CAN_GW */
+
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+/* Called with device_lock held */
+static inline void rtcan_lat_account(struct rtcan_lat_hist *hist,
+				     nanosecs_rel_t delay)
+{
+    unsigned int bucket = 0;
+
+    if (delay > 0)
+	bucket = delay >= (1 << (RTCAN_LAT_BUCKETS - 1)) ?
+	    RTCAN_LAT_BUCKETS - 1 : fls((u32)delay);
+
+    hist->buckets[bucket]++;
+    hist->count++;
+    if (delay > hist->max)
+	hist->max = delay;
+}
+
+/* Called by the drivers on IRQ entry, with device_lock held */
+static inline void rtcan_lat_isr_enter(struct rtcan_device *dev)
+{
+    dev->isr_stamp = rtdm_clock_read();
+}
+
+/* Called by the drivers on TX-complete interrupt, before signaling
+ * rtcan_tx_done(), with device_lock held */
+static inline void rtcan_lat_tx_complete(struct rtcan_device *dev)
+{
+    if (dev->tx_stamp) {
+	rtcan_lat_account(&dev->lat_tx, rtdm_clock_read() - dev->tx_stamp);
+	dev->tx_stamp = 0;
+    }
+}
+#else /* !CONFIG_XENO_DRIVERS_CAN_LATENCY */
+#define rtcan_lat_isr_enter(dev)	do { } while (0)
+#define rtcan_lat_tx_complete(dev)	do { } while (0)
+#endif /* !CONFIG_XENO_DRIVERS_CAN_LATENCY */
+
 #ifdef CONFIG_PROC_FS
 int rtcan_dev_create_proc(struct rtcan_device* dev);
 void rtcan_dev_remove_proc(struct rtcan_device* dev);
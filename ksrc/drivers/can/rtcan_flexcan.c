@@ -465,6 +465,7 @@ static void flexcan_do_state(struct rtcan_device *dev,
 	case CAN_STATE_BUS_OFF:
 		cf->can_id |= CAN_ERR_BUSOFF;
 		/* Wake up waiting senders */
+		rtcan_tx_flush(dev);
 		rtdm_sem_destroy(&dev->tx_sem);
 		break;
 	default:
@@ -568,8 +569,6 @@ static int flexcan_interrupt(rtdm_irq_t *irq_handle)
 	if (reg_iflag1 & (1 << FLEXCAN_TX_BUF_ID)) {
 		flexcan_write((1 << FLEXCAN_TX_BUF_ID), &regs->iflag1);
 
-		/* Wake up a sender */
-		rtdm_sem_up(&dev->tx_sem);
 		if (rtcan_loopback_pending(dev)) {
 			if (recv_lock_free) {
 				recv_lock_free = 0;
@@ -578,6 +577,8 @@ static int flexcan_interrupt(rtdm_irq_t *irq_handle)
 			}
 			rtcan_loopback(dev);
 		}
+		/* Refill from the TX queue or wake up a sender */
+		rtcan_tx_done(dev);
 		ret = RTDM_IRQ_HANDLED;
 	}
 
@@ -846,6 +847,7 @@ static int flexcan_mode_stop(struct rtcan_device *dev, rtdm_lockctx_t *lock_ctx)
 	flexcan_chip_stop(dev);
 
 	/* Wake up waiting senders */
+	rtcan_tx_flush(dev);
 	rtdm_sem_destroy(&dev->tx_sem);
 
 	rtdm_irq_free(&dev->irq_handle);
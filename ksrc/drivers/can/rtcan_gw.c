@@ -0,0 +1,359 @@
+/*
+ * Per-device receive tasks and gateway routing for RT-Socket-CAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * When a receive task is running for a device, rtcan_rcv() only stamps
+ * the frames and pushes them to the device FIFO from the IRQ handler.
+ * The task then dispatches them to the sockets and forwards them
+ * according to the route table, so the processing of each bus can be
+ * moved to a CPU of its own. Forwarding takes the device_lock of the
+ * output device, which must not nest into rtcan_recv_list_lock, hence
+ * is done with no lock held.
+ */
+
+#include <linux/module.h>
+
+#include <rtdm/rtdm_driver.h>
+
+#include <rtdm/rtcan.h>
+#include "rtcan_socket.h"
+#include "rtcan_list.h"
+#include "rtcan_dev.h"
+#include "rtcan_raw.h"
+#include "rtcan_internal.h"
+
+/* How long a forwarded frame may wait for the output controller */
+#define RTCAN_GW_TX_TIMEOUT  10000000 /* ns */
+
+static int rx_prio = RTDM_TASK_HIGHEST_PRIORITY - 1;
+module_param(rx_prio, int, 0444);
+MODULE_PARM_DESC(rx_prio, "Priority of the per-device receive tasks");
+
+struct rtcan_gw_out {
+    int ifindex;
+    can_id_t can_id;
+};
+
+
+/* Called with rtcan_recv_list_lock held */
+void rtcan_gw_queue(struct rtcan_device *dev, struct rtcan_skb *skb)
+{
+    if (dev->rx_fifo_head - dev->rx_fifo_tail >= RTCAN_RX_FIFO_SIZE) {
+	dev->rx_overruns++;
+	return;
+    }
+
+    memcpy(&dev->rx_fifo[dev->rx_fifo_head & (RTCAN_RX_FIFO_SIZE - 1)],
+	   skb, sizeof(*skb));
+    dev->rx_fifo_head++;
+
+    rtdm_event_signal(&dev->rx_event);
+}
+
+
+/* Collect the outputs of a frame, called with rtcan_recv_list_lock held */
+static int rtcan_gw_match(struct rtcan_device *dev,
+			  struct rtcan_rb_frame *frame,
+			  struct rtcan_gw_out *out)
+{
+    can_id_t can_id = frame->can_id;
+    struct can_route *route;
+    int i, n = 0;
+
+    if (can_id & CAN_ERR_FLAG)
+	return 0;
+
+    for (i = 0; i < dev->nr_routes; i++) {
+	route = &dev->routes[i];
+	if ((can_id & route->can_mask) != route->can_id)
+	    continue;
+	out[n].ifindex = route->dst_ifindex;
+	out[n].can_id = (can_id & ~route->mod_mask) |
+	    (route->mod_id & route->mod_mask);
+	n++;
+    }
+
+    return n;
+}
+
+
+static void rtcan_gw_forward(struct rtcan_device *dev,
+			     struct rtcan_skb *skb,
+			     struct rtcan_gw_out *out, int n)
+{
+    struct rtcan_rb_frame *rb_frame = &skb->rb_frame;
+    struct rtcan_device *dst;
+    can_frame_t frame;
+    int i;
+
+    memset(&frame, 0, sizeof(frame));
+    frame.can_dlc = rb_frame->can_dlc & RTCAN_HAS_NO_TIMESTAMP;
+    memcpy(frame.data, rb_frame->data,
+	   skb->rb_frame_size - EMPTY_RB_FRAME_SIZE);
+
+    for (i = 0; i < n; i++) {
+	frame.can_id = out[i].can_id;
+
+	dst = rtcan_dev_get_by_index(out[i].ifindex);
+	if (dst == NULL) {
+	    dev->gw_dropped++;
+	    continue;
+	}
+
+	if (rtcan_tx_frame(dst, &frame, RTCAN_GW_TX_TIMEOUT))
+	    dev->gw_dropped++;
+	else
+	    dev->gw_forwarded++;
+
+	rtcan_dev_dereference(dst);
+    }
+}
+
+
+static void rtcan_gw_rx_task(void *arg)
+{
+    struct rtcan_device *dev = arg;
+    struct rtcan_gw_out out[RTCAN_GW_MAX_ROUTES];
+    struct rtcan_skb skb;
+    rtdm_lockctx_t lock_ctx;
+    int stop, n;
+
+    do {
+	/* Drain the FIFO once more when the event is destroyed */
+	stop = rtdm_event_wait(&dev->rx_event);
+
+	for (;;) {
+	    rtdm_lock_get_irqsave(&rtcan_recv_list_lock, lock_ctx);
+
+	    if (dev->rx_fifo_tail == dev->rx_fifo_head) {
+		rtdm_lock_put_irqrestore(&rtcan_recv_list_lock, lock_ctx);
+		break;
+	    }
+
+	    memcpy(&skb,
+		   &dev->rx_fifo[dev->rx_fifo_tail & (RTCAN_RX_FIFO_SIZE - 1)],
+		   sizeof(skb));
+	    dev->rx_fifo_tail++;
+
+	    rtdm_lock_get(&rtcan_socket_lock);
+	    __rtcan_rcv(dev, &skb);
+	    rtdm_lock_put(&rtcan_socket_lock);
+
+	    n = rtcan_gw_match(dev, &skb.rb_frame, out);
+
+	    rtdm_lock_put_irqrestore(&rtcan_recv_list_lock, lock_ctx);
+
+	    if (n > 0)
+		rtcan_gw_forward(dev, &skb, out, n);
+	}
+    } while (!stop);
+}
+
+
+/* Called with nrt_lock held */
+static int rtcan_gw_start(struct rtcan_device *dev, int cpu)
+{
+    rtdm_lockctx_t lock_ctx;
+    int ret;
+
+    rtdm_event_init(&dev->rx_event, 0);
+    dev->rx_fifo_head = dev->rx_fifo_tail = 0;
+
+    if (cpu < 0)
+	ret = rtdm_task_init(&dev->rx_task, dev->name, rtcan_gw_rx_task,
+			     dev, rx_prio, 0);
+    else
+	ret = rtdm_task_init_cpu(&dev->rx_task, dev->name, rtcan_gw_rx_task,
+				 dev, rx_prio, 0, cpu);
+    if (ret) {
+	rtdm_event_destroy(&dev->rx_event);
+	return ret;
+    }
+
+    dev->rx_task_on = 1;
+    dev->rx_cpu = cpu;
+
+    rtdm_lock_get_irqsave(&rtcan_recv_list_lock, lock_ctx);
+    dev->rx_deferred = 1;
+    rtdm_lock_put_irqrestore(&rtcan_recv_list_lock, lock_ctx);
+
+    return 0;
+}
+
+
+/* Called with nrt_lock held */
+static void rtcan_gw_stop(struct rtcan_device *dev)
+{
+    rtdm_lockctx_t lock_ctx;
+
+    if (!dev->rx_task_on)
+	return;
+
+    rtdm_lock_get_irqsave(&rtcan_recv_list_lock, lock_ctx);
+    dev->rx_deferred = 0;
+    rtdm_lock_put_irqrestore(&rtcan_recv_list_lock, lock_ctx);
+
+    /* Wakes up the task, which drains the FIFO and exits */
+    rtdm_event_destroy(&dev->rx_event);
+    rtdm_task_join_nrt(&dev->rx_task, 100);
+
+    dev->rx_task_on = 0;
+}
+
+
+int rtcan_gw_set_rx_cpu(struct rtcan_device *dev, int cpu)
+{
+    int ret = 0;
+
+    if (cpu >= XNARCH_NR_CPUS || (cpu >= 0 && !xnarch_cpu_supported(cpu)))
+	return -EINVAL;
+
+    down(&dev->nrt_lock);
+
+    if (cpu < 0) {
+	if (dev->nr_routes > 0)
+	    ret = -EBUSY;
+	else
+	    rtcan_gw_stop(dev);
+    } else if (!dev->rx_task_on || dev->rx_cpu != cpu) {
+	rtcan_gw_stop(dev);
+	ret = rtcan_gw_start(dev, cpu);
+    }
+
+    up(&dev->nrt_lock);
+
+    return ret;
+}
+
+
+int rtcan_gw_add_route(struct can_route *route)
+{
+    struct rtcan_device *dev, *dst;
+    rtdm_lockctx_t lock_ctx;
+    int ret = 0;
+
+    if (route->src_ifindex == route->dst_ifindex)
+	return -EINVAL;
+
+    if ((dst = rtcan_dev_get_by_index(route->dst_ifindex)) == NULL)
+	return -ENODEV;
+    rtcan_dev_dereference(dst);
+
+    if ((dev = rtcan_dev_get_by_index(route->src_ifindex)) == NULL)
+	return -ENODEV;
+
+    down(&dev->nrt_lock);
+
+    if (dev->nr_routes >= RTCAN_GW_MAX_ROUTES) {
+	ret = -ENOSPC;
+	goto out;
+    }
+
+    /* Forwarding is done by the receive task */
+    if (!dev->rx_task_on) {
+	ret = rtcan_gw_start(dev, -1);
+	if (ret)
+	    goto out;
+    }
+
+    rtdm_lock_get_irqsave(&rtcan_recv_list_lock, lock_ctx);
+    dev->routes[dev->nr_routes] = *route;
+    dev->routes[dev->nr_routes].can_id &= route->can_mask;
+    dev->nr_routes++;
+    rtdm_lock_put_irqrestore(&rtcan_recv_list_lock, lock_ctx);
+
+ out:
+    up(&dev->nrt_lock);
+    rtcan_dev_dereference(dev);
+
+    return ret;
+}
+
+
+static inline int rtcan_gw_route_equal(struct can_route *a,
+				       struct can_route *b)
+{
+    return a->dst_ifindex == b->dst_ifindex &&
+	a->can_id == (b->can_id & b->can_mask) &&
+	a->can_mask == b->can_mask &&
+	a->mod_mask == b->mod_mask &&
+	a->mod_id == b->mod_id;
+}
+
+
+/* Called with rtcan_recv_list_lock held */
+static void __rtcan_gw_del_route(struct rtcan_device *dev, int i)
+{
+    dev->routes[i] = dev->routes[--dev->nr_routes];
+}
+
+
+int rtcan_gw_del_route(struct can_route *route)
+{
+    struct rtcan_device *dev;
+    rtdm_lockctx_t lock_ctx;
+    int i, ret = -ENOENT;
+
+    if ((dev = rtcan_dev_get_by_index(route->src_ifindex)) == NULL)
+	return -ENODEV;
+
+    rtdm_lock_get_irqsave(&rtcan_recv_list_lock, lock_ctx);
+    for (i = 0; i < dev->nr_routes; i++)
+	if (rtcan_gw_route_equal(&dev->routes[i], route)) {
+	    __rtcan_gw_del_route(dev, i);
+	    ret = 0;
+	    break;
+	}
+    rtdm_lock_put_irqrestore(&rtcan_recv_list_lock, lock_ctx);
+
+    rtcan_dev_dereference(dev);
+
+    return ret;
+}
+
+
+/*
+ * Stop the receive task of a device being unregistered and drop all
+ * routes from or to it.
+ */
+void rtcan_gw_cleanup(struct rtcan_device *dev)
+{
+    struct rtcan_device *other;
+    rtdm_lockctx_t lock_ctx;
+    int ifindex, i;
+
+    down(&dev->nrt_lock);
+    rtdm_lock_get_irqsave(&rtcan_recv_list_lock, lock_ctx);
+    dev->nr_routes = 0;
+    rtdm_lock_put_irqrestore(&rtcan_recv_list_lock, lock_ctx);
+    rtcan_gw_stop(dev);
+    up(&dev->nrt_lock);
+
+    for (ifindex = 1; ifindex <= RTCAN_MAX_DEVICES; ifindex++) {
+	if ((other = rtcan_dev_get_by_index(ifindex)) == NULL)
+	    continue;
+
+	rtdm_lock_get_irqsave(&rtcan_recv_list_lock, lock_ctx);
+	for (i = other->nr_routes - 1; i >= 0; i--)
+	    if (other->routes[i].dst_ifindex == dev->ifindex)
+		__rtcan_gw_del_route(other, i);
+	rtdm_lock_put_irqrestore(&rtcan_recv_list_lock, lock_ctx);
+
+	rtcan_dev_dereference(other);
+    }
+}
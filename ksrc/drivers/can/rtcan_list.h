@@ -43,6 +43,9 @@ struct rtcan_recv {
 					     */
     struct rtcan_recv       *next;          /* pointer to next list element
 					     */
+    struct rtcan_recv       *hnext;         /* pointer to next element in
+					     *   the same hash bucket, or in
+					     *   the masked filter chain */
 };
 
 
@@ -60,6 +63,28 @@ struct tx_wait_queue {
 };
 
 
+/*
+ *  Element in a device TX queue.
+ *
+ *  Senders finding the controller busy are queued by arbitration priority
+ *  on the device, each one holding its own element. The TX-complete path
+ *  hands the frame of the first element over to the controller and wakes
+ *  the sender up with the result.
+ */
+struct rtcan_tx_req {
+    struct list_head        list;           /* List pointers */
+    u32                     key;            /* Arbitration key */
+    can_frame_t             *frame;         /* Frame to send */
+    struct rtcan_socket     *sock;          /* Sending socket */
+    rtdm_event_t            done;           /* Signaled once handled */
+    int                     pending;        /* Still queued */
+    int                     ret;            /* Result if handled */
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+    nanosecs_abs_t          stamp;          /* Date of the send request */
+#endif
+};
+
+
 /* Spinlock for all reception lists and also for some members in
  * struct rtcan_socket */
 extern rtdm_lock_t rtcan_recv_list_lock;
@@ -183,7 +183,11 @@ static int rtcan_read_proc_sockets(struct seq_file *p, void *data)
      *  0 rtcan0               1 0x00010 1234567890 1234567890 1234567890 12345
      */
     seq_printf(p, "fd Name___________ Filter ErrMask RX_Timeout_ns "
-		  "TX_Timeout_ns RX_BufFull TX_Lo\n");
+		  "TX_Timeout_ns RX_BufFull TX_Lo");
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+    seq_printf(p, " RX_QMax");
+#endif
+    seq_printf(p, "\n");
 
     rtdm_lock_get_irqsave(&rtcan_recv_list_lock, lock_ctx);
 
@@ -204,10 +208,14 @@ static int rtcan_read_proc_sockets(struct seq_file *p, void *data)
 			       tx_timeout, sizeof(tx_timeout));
 	rtcan_get_timeout_name(sock->rx_timeout,
 			       rx_timeout, sizeof(rx_timeout));
-	seq_printf(p, "%2d %-15s %6d 0x%05x %13s %13s %10d %5d\n",
+	seq_printf(p, "%2d %-15s %6d 0x%05x %13s %13s %10d %5d",
 		   context->fd, name, sock->flistlen, sock->err_mask,
 		   rx_timeout, tx_timeout, sock->rx_buf_full,
 		   rtcan_loopback_enabled(sock));
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+	seq_printf(p, " %7u", sock->rx_queued_max);
+#endif
+	seq_printf(p, "\n");
     }
 
     rtdm_lock_put_irqrestore(&rtcan_recv_list_lock, lock_ctx);
@@ -235,6 +243,7 @@ static int rtcan_read_proc_info(struct seq_file *p, void *data)
     struct rtcan_device *dev = p->private;
     char state_name[20], baudrate_name[20];
     char ctrlmode_name[80], bittime_name[80];
+    int i;
 
     if (down_interruptible(&rtcan_devices_nrt_lock))
 	return -ERESTARTSYS;
@@ -259,6 +268,26 @@ static int rtcan_read_proc_info(struct seq_file *p, void *data)
     seq_printf(p, "TX-Counter %d\n", dev->tx_count);
     seq_printf(p, "RX-Counter %d\n", dev->rx_count);
     seq_printf(p, "Errors     %d\n", dev->err_count);
+    seq_printf(p, "TX-Refills %d\n", dev->tx_refills);
+    seq_printf(p, "TX-Queued ");
+    for (i = 0; i < RTCAN_TX_PRIO_BANDS; i++)
+	seq_printf(p, " %u", dev->tx_queued[i]);
+    seq_printf(p, "\nTX-Max    ");
+    for (i = 0; i < RTCAN_TX_PRIO_BANDS; i++)
+	seq_printf(p, " %u", dev->tx_queued_max[i]);
+    seq_printf(p, "\n");
+#ifdef CONFIG_XENO_DRIVERS_CAN_GW
+    if (!dev->rx_task_on)
+	seq_printf(p, "RX-CPU     irq\n");
+    else if (dev->rx_cpu < 0)
+	seq_printf(p, "RX-CPU     any\n");
+    else
+	seq_printf(p, "RX-CPU     %d\n", dev->rx_cpu);
+    seq_printf(p, "RX-Overrun %u\n", dev->rx_overruns);
+    seq_printf(p, "GW-Routes  %d\n", dev->nr_routes);
+    seq_printf(p, "GW-Fwd     %u\n", dev->gw_forwarded);
+    seq_printf(p, "GW-Dropped %u\n", dev->gw_dropped);
+#endif /* CONFIG_XENO_DRIVERS_CAN_GW */
 #ifdef RTCAN_USE_REFCOUNT
     seq_printf(p, "Refcount   %d\n", atomic_read(&dev->refcount));
 #endif
@@ -282,6 +311,50 @@ static const struct file_operations rtcan_proc_info_ops = {
 
 
 
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+static int rtcan_read_proc_latency(struct seq_file *p, void *data)
+{
+    struct rtcan_device *dev = p->private;
+    int i;
+
+    /* Bucket_ns_ ISR-Rcv___ Rcv-Deq___ TX-Done___
+     *  <      512       1234       1234       1234
+     */
+    seq_printf(p, "Bucket_ns_ ISR-Rcv___ Rcv-Deq___ TX-Done___\n");
+
+    for (i = 0; i < RTCAN_LAT_BUCKETS; i++) {
+	if (i < RTCAN_LAT_BUCKETS - 1)
+	    seq_printf(p, "< %8u", 1U << i);
+	else
+	    seq_printf(p, ">=%8u", 1U << (i - 1));
+	seq_printf(p, " %10u %10u %10u\n", dev->lat_isr_rcv.buckets[i],
+		   dev->lat_rcv_deq.buckets[i], dev->lat_tx.buckets[i]);
+    }
+
+    seq_printf(p, "Count      %10u %10u %10u\n", dev->lat_isr_rcv.count,
+	       dev->lat_rcv_deq.count, dev->lat_tx.count);
+    seq_printf(p, "Max_ns     %10llu %10llu %10llu\n",
+	       (unsigned long long)dev->lat_isr_rcv.max,
+	       (unsigned long long)dev->lat_rcv_deq.max,
+	       (unsigned long long)dev->lat_tx.max);
+
+    return 0;
+}
+
+static int rtcan_proc_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, rtcan_read_proc_latency, PDE_DATA(inode));
+}
+
+static const struct file_operations rtcan_proc_latency_ops = {
+	.open		= rtcan_proc_latency_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif /* CONFIG_XENO_DRIVERS_CAN_LATENCY */
+
+
 static int rtcan_read_proc_filter(struct seq_file *p, void *data)
 {
     struct rtcan_device *dev = p->private;
@@ -360,6 +433,9 @@ void rtcan_dev_remove_proc(struct rtcan_device* dev)
 
     remove_proc_entry("info", dev->proc_root);
     remove_proc_entry("filters", dev->proc_root);
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+    remove_proc_entry("latency", dev->proc_root);
+#endif
     remove_proc_entry(dev->name, rtcan_proc_root);
 
     dev->proc_root = NULL;
@@ -380,6 +456,10 @@ int rtcan_dev_create_proc(struct rtcan_device* dev)
 		     &rtcan_proc_info_ops, dev);
     proc_create_data("filters", S_IFREG | S_IRUGO | S_IWUSR, dev->proc_root,
 		     &rtcan_proc_filter_ops, dev);
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+    proc_create_data("latency", S_IFREG | S_IRUGO, dev->proc_root,
+		     &rtcan_proc_latency_ops, dev);
+#endif
     return 0;
 
 }
@@ -54,6 +54,15 @@
  */
 #define RTCAN_GET_TIMESTAMP         RTDM_USER_CONTEXT_FLAG
 
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+/* Frames are always stamped in the receive buffers, for measuring the
+ * delay until they are dequeued */
+#define rtcan_want_timestamp(context)	1
+#else
+#define rtcan_want_timestamp(context)					\
+    test_bit(RTCAN_GET_TIMESTAMP, &(context)->context_flags)
+#endif
+
 
 MODULE_AUTHOR("RT-Socket-CAN Development Team");
 MODULE_DESCRIPTION("RTDM CAN raw socket device driver");
@@ -74,6 +83,41 @@ static inline int rtcan_accept_msg(uint32_t can_id, can_filter_t *filter)
 }
 
 
+/* Store a frame into the next slot of a socket's receive ring. Frames
+ * are always stamped, the timestamp being taken anyway on reception. */
+static void rtcan_rcv_deliver_ring(struct rtcan_socket *sock,
+				   struct rtcan_skb *skb)
+{
+    struct rtcan_rb_frame *frame = &skb->rb_frame;
+    struct can_rx_ring *ring = sock->rx_ring;
+    struct can_rx_slot *slot;
+
+    slot = &ring->slots[sock->rx_ring_head & (sock->rx_ring_slots - 1)];
+    if (slot->status != CAN_RX_SLOT_KERNEL) {
+	/* The application lags behind, drop the frame. */
+	ring->dropped++;
+	sock->rx_buf_full++;
+	return;
+    }
+
+    slot->ifindex = frame->can_ifindex;
+    memcpy(&slot->timestamp, (void *)frame + skb->rb_frame_size,
+	   RTCAN_TIMESTAMP_SIZE);
+    slot->frame.can_id = frame->can_id;
+    slot->frame.can_dlc = frame->can_dlc & RTCAN_HAS_NO_TIMESTAMP;
+    memcpy(slot->frame.data, frame->data,
+	   skb->rb_frame_size - EMPTY_RB_FRAME_SIZE);
+
+    /* Publish the slot contents before handing it over. */
+    smp_wmb();
+    slot->status = CAN_RX_SLOT_USER;
+    sock->rx_ring_head++;
+
+    if (++sock->rx_ring_pending == sock->rx_ring_wm)
+	rtdm_sem_up(&sock->recv_sem);
+}
+
+
 static void rtcan_rcv_deliver(struct rtcan_recv *recv_listener,
 			      struct rtcan_skb *skb)
 {
@@ -83,9 +127,14 @@ static void rtcan_rcv_deliver(struct rtcan_recv *recv_listener,
     struct rtcan_socket *sock = recv_listener->sock;
     struct rtdm_dev_context *context = rtcan_socket_context(sock);
 
+    if (sock->rx_ring) {
+	rtcan_rcv_deliver_ring(sock, skb);
+	return;
+    }
+
     cpy_size = skb->rb_frame_size;
     /* Check if socket wants to receive a timestamp */
-    if (test_bit(RTCAN_GET_TIMESTAMP, &context->context_flags)) {
+    if (rtcan_want_timestamp(context)) {
 	cpy_size += RTCAN_TIMESTAMP_SIZE;
 	frame->can_dlc |= RTCAN_HAS_TIMESTAMP;
     } else
@@ -119,6 +168,11 @@ static void rtcan_rcv_deliver(struct rtcan_recv *recv_listener,
 	/*Notify the delivery of the message */
 	rtdm_sem_up(&sock->recv_sem);
 
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+	if (++sock->rx_queued > sock->rx_queued_max)
+	    sock->rx_queued_max = sock->rx_queued;
+#endif
+
     } else {
 	/* Overflow of socket's ring buffer! */
 	sock->rx_buf_full++;
@@ -128,17 +182,44 @@ static void rtcan_rcv_deliver(struct rtcan_recv *recv_listener,
 }
 
 
-void rtcan_rcv(struct rtcan_device *dev, struct rtcan_skb *skb)
+static inline void rtcan_rcv_chain(struct rtcan_recv *recv_listener,
+				   struct rtcan_skb *skb,
+				   struct rtcan_socket *skip_sock)
+{
+    uint32_t can_id = skb->rb_frame.can_id;
+
+    while (recv_listener != NULL) {
+	if (recv_listener->sock != skip_sock &&
+	    rtcan_accept_msg(can_id, &recv_listener->can_filter)) {
+	    recv_listener->match_count++;
+	    rtcan_rcv_deliver(recv_listener, skb);
+	}
+	recv_listener = recv_listener->hnext;
+    }
+}
+
+
+/* Deliver a frame to all matching filters, looking up the exact-ID
+ * filters by hash and scanning the masked ones. */
+static void rtcan_rcv_filter(struct rtcan_device *dev, struct rtcan_skb *skb,
+			     struct rtcan_socket *skip_sock)
+{
+    uint32_t can_id = skb->rb_frame.can_id;
+
+    rtcan_rcv_chain(dev->recv_hash[rtcan_recv_hashfn(can_id)], skb,
+		    skip_sock);
+    rtcan_rcv_chain(dev->recv_masked, skb, skip_sock);
+}
+
+
+/* Dispatch a stamped frame to the sockets, called with
+ * rtcan_recv_list_lock and rtcan_socket_lock held. */
+void __rtcan_rcv(struct rtcan_device *dev, struct rtcan_skb *skb)
 {
-    nanosecs_abs_t timestamp = rtdm_clock_read();
     /* Entry in reception list, begin with head */
     struct rtcan_recv *recv_listener = dev->recv_list;
     struct rtcan_rb_frame *frame = &skb->rb_frame;
 
-    /* Copy timestamp to skb */
-    memcpy((void *)&skb->rb_frame + skb->rb_frame_size,
-	   &timestamp, RTCAN_TIMESTAMP_SIZE);
-
     if ((frame->can_id & CAN_ERR_FLAG)) {
 	dev->err_count++;
 	while (recv_listener != NULL) {
@@ -150,16 +231,36 @@ void rtcan_rcv(struct rtcan_device *dev, struct rtcan_skb *skb)
 	}
     } else {
 	dev->rx_count++;
-	while (recv_listener != NULL) {
-	    if (rtcan_accept_msg(frame->can_id, &recv_listener->can_filter)) {
-		recv_listener->match_count++;
-		rtcan_rcv_deliver(recv_listener, skb);
-	    }
-	    recv_listener = recv_listener->next;
-	}
+	rtcan_rcv_filter(dev, skb, NULL);
     }
 }
 
+
+void rtcan_rcv(struct rtcan_device *dev, struct rtcan_skb *skb)
+{
+    nanosecs_abs_t timestamp = rtdm_clock_read();
+
+    /* Copy timestamp to skb */
+    memcpy((void *)&skb->rb_frame + skb->rb_frame_size,
+	   &timestamp, RTCAN_TIMESTAMP_SIZE);
+
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+    /* Only drivers stamping their IRQ entry are accounted */
+    if (dev->isr_stamp)
+	rtcan_lat_account(&dev->lat_isr_rcv, timestamp - dev->isr_stamp);
+#endif
+
+#ifdef CONFIG_XENO_DRIVERS_CAN_GW
+    /* Leave the dispatch to the receive task of the device */
+    if (dev->rx_deferred) {
+	rtcan_gw_queue(dev, skb);
+	return;
+    }
+#endif /* CONFIG_XENO_DRIVERS_CAN_GW */
+
+    __rtcan_rcv(dev, skb);
+}
+
 #ifdef CONFIG_XENO_DRIVERS_CAN_LOOPBACK
 
 void rtcan_tx_push(struct rtcan_device *dev, struct rtcan_socket *sock,
@@ -184,22 +285,12 @@ void rtcan_tx_push(struct rtcan_device *dev, struct rtcan_socket *sock,
 void rtcan_loopback(struct rtcan_device *dev)
 {
     nanosecs_abs_t timestamp = rtdm_clock_read();
-    /* Entry in reception list, begin with head */
-    struct rtcan_recv *recv_listener = dev->recv_list;
-    struct rtcan_rb_frame *frame = &dev->tx_skb.rb_frame;
 
     memcpy((void *)&dev->tx_skb.rb_frame + dev->tx_skb.rb_frame_size,
 	   &timestamp, RTCAN_TIMESTAMP_SIZE);
 
-    while (recv_listener != NULL) {
-	dev->rx_count++;
-	if ((dev->tx_socket != recv_listener->sock) &&
-	    rtcan_accept_msg(frame->can_id, &recv_listener->can_filter)) {
-	    recv_listener->match_count++;
-	    rtcan_rcv_deliver(recv_listener, &dev->tx_skb);
-	}
-	recv_listener = recv_listener->next;
-    }
+    dev->rx_count++;
+    rtcan_rcv_filter(dev, &dev->tx_skb, dev->tx_socket);
     dev->tx_socket = NULL;
 }
 
@@ -208,6 +299,198 @@ EXPORT_SYMBOL_GPL(rtcan_loopback);
 #endif /* CONFIG_XENO_DRIVERS_CAN_LOOPBACK */
 
 
+/*
+ * Bus arbitration key of a frame, lower keys win. The base ID goes
+ * first, then RTR (SFF) or SRR (EFF), IDE, the extended ID bits and
+ * finally RTR (EFF), as they appear on the wire.
+ */
+static inline u32 rtcan_tx_key(can_frame_t *frame)
+{
+    u32 id = frame->can_id;
+    u32 rtr = !!(id & CAN_RTR_FLAG);
+
+    if (id & CAN_EFF_FLAG)
+	return ((id & CAN_EFF_MASK) >> 18) << 21 | 1 << 20 | 1 << 19 |
+	    (id & 0x3ffff) << 1 | rtr;
+
+    return (id & CAN_SFF_MASK) << 21 | rtr << 20;
+}
+
+static inline unsigned int rtcan_tx_band(u32 key)
+{
+    return key >> (32 - 3);
+}
+
+/* Called with device_lock held */
+static void rtcan_tx_enqueue(struct rtcan_device *dev,
+			     struct rtcan_tx_req *req)
+{
+    struct list_head *pos;
+    unsigned int band;
+
+    req->key = rtcan_tx_key(req->frame);
+    req->pending = 1;
+
+    /* FIFO among equal keys */
+    list_for_each(pos, &dev->tx_queue)
+	if (list_entry(pos, struct rtcan_tx_req, list)->key > req->key)
+	    break;
+    list_add_tail(&req->list, pos);
+
+    band = rtcan_tx_band(req->key);
+    if (++dev->tx_queued[band] > dev->tx_queued_max[band])
+	dev->tx_queued_max[band] = dev->tx_queued[band];
+}
+
+/* Called with device_lock held */
+static void rtcan_tx_dequeue(struct rtcan_device *dev,
+			     struct rtcan_tx_req *req)
+{
+    list_del(&req->list);
+    req->pending = 0;
+    dev->tx_queued[rtcan_tx_band(req->key)]--;
+}
+
+/*
+ * Release the controller after a transmission completed, called with
+ * device_lock held by the drivers instead of signaling the TX semaphore,
+ * once the loopback frame was delivered. If senders are queued, the frame
+ * with the highest bus priority is handed over to the controller right
+ * away, otherwise the TX semaphore is signaled. Drivers completing the
+ * transmission from their xmit handler may call this recursively.
+ */
+void rtcan_tx_done(struct rtcan_device *dev)
+{
+    struct rtcan_tx_req *req;
+
+    /* Nested call, counted for the outer loop */
+    if (dev->tx_refill++ > 0)
+	return;
+
+    do {
+	if (list_empty(&dev->tx_queue)) {
+	    rtdm_sem_up(&dev->tx_sem);
+	    continue;
+	}
+
+	req = list_entry(dev->tx_queue.next, struct rtcan_tx_req, list);
+	rtcan_tx_dequeue(dev, req);
+
+	if (!CAN_STATE_OPERATING(dev->state)) {
+	    req->ret = dev->state == CAN_STATE_SLEEPING ? -ECOMM : -ENETDOWN;
+	    /* Controller still free */
+	    dev->tx_refill++;
+	} else {
+	    /* Frames sent on behalf of the stack have no socket */
+	    if (req->sock && rtcan_loopback_enabled(req->sock))
+		rtcan_tx_push(dev, req->sock, req->frame);
+
+	    dev->tx_count++;
+	    dev->tx_refills++;
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+	    dev->tx_stamp = req->stamp;
+#endif
+	    req->ret = dev->hard_start_xmit(dev, req->frame);
+	    if (req->ret == 0)
+		req->ret = sizeof(can_frame_t);
+	    else
+		dev->tx_refill++;
+	}
+
+	rtdm_event_signal(&req->done);
+
+    } while (--dev->tx_refill > 0);
+}
+
+EXPORT_SYMBOL_GPL(rtcan_tx_done);
+
+/*
+ * Fail all queued senders, called with device_lock held by the drivers
+ * before destroying the TX semaphore.
+ */
+void rtcan_tx_flush(struct rtcan_device *dev)
+{
+    struct rtcan_tx_req *req;
+
+    while (!list_empty(&dev->tx_queue)) {
+	req = list_entry(dev->tx_queue.next, struct rtcan_tx_req, list);
+	rtcan_tx_dequeue(dev, req);
+	req->ret = -ENETDOWN;
+	rtdm_event_signal(&req->done);
+    }
+}
+
+EXPORT_SYMBOL_GPL(rtcan_tx_flush);
+
+/*
+ * Send a frame on behalf of the stack, without any socket involved,
+ * queuing up by bus priority for at most @timeout if the controller is
+ * busy. Must be called from a real-time task if it may block.
+ */
+int rtcan_tx_frame(struct rtcan_device *dev, can_frame_t *frame,
+		   nanosecs_rel_t timeout)
+{
+    struct rtcan_tx_req tx_req;
+    rtdm_lockctx_t lock_ctx;
+    int ret;
+
+    rtdm_lock_get_irqsave(&dev->device_lock, lock_ctx);
+
+    ret = rtdm_sem_timeddown(&dev->tx_sem, RTDM_TIMEOUT_NONE, NULL);
+
+    if (ret == -EWOULDBLOCK && timeout != RTDM_TIMEOUT_NONE) {
+	tx_req.frame = frame;
+	tx_req.sock = NULL;
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+	tx_req.stamp = rtdm_clock_read();
+#endif
+	rtdm_event_init(&tx_req.done, 0);
+	rtcan_tx_enqueue(dev, &tx_req);
+
+	rtdm_lock_put_irqrestore(&dev->device_lock, lock_ctx);
+
+	ret = rtdm_event_timedwait(&tx_req.done, timeout, NULL);
+
+	rtdm_lock_get_irqsave(&dev->device_lock, lock_ctx);
+	if (tx_req.pending)
+	    rtcan_tx_dequeue(dev, &tx_req);
+	else
+	    ret = tx_req.ret;
+	rtdm_lock_put_irqrestore(&dev->device_lock, lock_ctx);
+
+	rtdm_event_destroy(&tx_req.done);
+
+	if (ret == -EIDRM)
+	    ret = -ENETDOWN;
+	return ret < 0 ? ret : 0;
+    }
+
+    if (ret != 0) {
+	rtdm_lock_put_irqrestore(&dev->device_lock, lock_ctx);
+	return ret == -EIDRM ? -ENETDOWN : ret;
+    }
+
+    if (!CAN_STATE_OPERATING(dev->state)) {
+	if (dev->state == CAN_STATE_SLEEPING) {
+	    ret = -ECOMM;
+	    /* Hand the guard over again */
+	    rtcan_tx_done(dev);
+	} else
+	    ret = -ENETDOWN;
+    } else {
+	dev->tx_count++;
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+	dev->tx_stamp = rtdm_clock_read();
+#endif
+	ret = dev->hard_start_xmit(dev, frame);
+    }
+
+    rtdm_lock_put_irqrestore(&dev->device_lock, lock_ctx);
+
+    return ret;
+}
+
+
 int rtcan_raw_socket(struct rtdm_dev_context *context,
 		     rtdm_user_info_t *user_info, int protocol)
 {
@@ -411,6 +694,130 @@ static int rtcan_raw_setsockopt(struct rtdm_dev_context *context,
 }
 
 
+static int rtcan_raw_rx_ring(struct rtdm_dev_context *context,
+			     rtdm_user_info_t *user_info, void *arg)
+{
+    struct rtcan_socket *sock = (struct rtcan_socket *)&context->dev_private;
+    struct can_rx_ring_req req;
+    struct rtcan_rx_mapping *map;
+    struct can_rx_ring *ring;
+    rtdm_lockctx_t lock_ctx;
+    void *uaddr;
+    size_t size;
+    int ret;
+
+    /* Mapping memory requires a Linux context. */
+    if (rtdm_in_rt_context())
+	return -ENOSYS;
+
+    if (user_info) {
+	if (!rtdm_rw_user_ok(user_info, arg, sizeof(req)) ||
+	    rtdm_copy_from_user(user_info, &req, arg, sizeof(req)))
+	    return -EFAULT;
+    } else
+	memcpy(&req, arg, sizeof(req));
+
+    if (req.nr_slots == 0 || req.nr_slots > 65536 ||
+	(req.nr_slots & (req.nr_slots - 1)) != 0)
+	return -EINVAL;
+
+    if (req.watermark == 0)
+	req.watermark = 1;
+    else if (req.watermark > req.nr_slots)
+	return -EINVAL;
+
+    if (sock->rx_ring)
+	return -EBUSY;
+
+    size = PAGE_ALIGN(sizeof(struct can_rx_ring) +
+		      req.nr_slots * sizeof(struct can_rx_slot));
+    map = rtcan_rx_ring_alloc(size);
+    if (map == NULL)
+	return -ENOMEM;
+
+    ring = map->ring;
+    ring->nr_slots = req.nr_slots;
+    ring->watermark = req.watermark;
+
+    if (user_info) {
+	ret = rtcan_rx_ring_mmap(user_info, map, &uaddr);
+	if (ret) {
+	    rtcan_rx_ring_put(map);
+	    return ret;
+	}
+    } else
+	uaddr = ring;
+
+    rtdm_lock_get_irqsave(&rtcan_socket_lock, lock_ctx);
+    if (sock->rx_ring) {
+	rtdm_lock_put_irqrestore(&rtcan_socket_lock, lock_ctx);
+	if (user_info)
+	    rtdm_munmap(user_info, uaddr, size);
+	rtcan_rx_ring_put(map);
+	return -EBUSY;
+    }
+    sock->rx_ring_map = map;
+    sock->rx_ring_slots = req.nr_slots;
+    sock->rx_ring_wm = req.watermark;
+    sock->rx_ring_head = 0;
+    sock->rx_ring_pending = 0;
+    sock->rx_ring = ring;
+    rtdm_lock_put_irqrestore(&rtcan_socket_lock, lock_ctx);
+
+    req.ring = uaddr;
+    req.size = size;
+
+    if (user_info) {
+	if (rtdm_copy_to_user(user_info, arg, &req, sizeof(req)))
+	    return -EFAULT;
+    } else
+	memcpy(arg, &req, sizeof(req));
+
+    return 0;
+}
+
+
+static int rtcan_raw_rx_ring_wait(struct rtdm_dev_context *context)
+{
+    struct rtcan_socket *sock = (struct rtcan_socket *)&context->dev_private;
+    rtdm_lockctx_t lock_ctx;
+    int ret;
+
+    rtdm_lock_get_irqsave(&rtcan_socket_lock, lock_ctx);
+
+    if (sock->rx_ring == NULL) {
+	rtdm_lock_put_irqrestore(&rtcan_socket_lock, lock_ctx);
+	return -EINVAL;
+    }
+
+    if (sock->rx_ring_pending >= sock->rx_ring_wm) {
+	ret = sock->rx_ring_pending;
+	sock->rx_ring_pending = 0;
+	rtdm_lock_put_irqrestore(&rtcan_socket_lock, lock_ctx);
+
+	/* Consume the token posted when the watermark was reached. */
+	rtdm_sem_timeddown(&sock->recv_sem, RTDM_TIMEOUT_NONE, NULL);
+	return ret;
+    }
+
+    rtdm_lock_put_irqrestore(&rtcan_socket_lock, lock_ctx);
+
+    ret = rtdm_sem_timeddown(&sock->recv_sem, sock->rx_timeout, NULL);
+    if (ret) {
+	if (ret == -EIDRM)
+	    ret = -EBADF;
+	return ret;
+    }
+
+    rtdm_lock_get_irqsave(&rtcan_socket_lock, lock_ctx);
+    ret = sock->rx_ring_pending;
+    sock->rx_ring_pending = 0;
+    rtdm_lock_put_irqrestore(&rtcan_socket_lock, lock_ctx);
+
+    return ret;
+}
+
+
 int rtcan_raw_ioctl(struct rtdm_dev_context *context,
 		    rtdm_user_info_t *user_info,
 		    unsigned int request, void *arg)
@@ -482,6 +889,14 @@ int rtcan_raw_ioctl(struct rtdm_dev_context *context,
 	break;
     }
 
+    case RTCAN_RTIOC_RX_RING:
+	ret = rtcan_raw_rx_ring(context, user_info, arg);
+	break;
+
+    case RTCAN_RTIOC_RX_RING_WAIT:
+	ret = rtcan_raw_rx_ring_wait(context);
+	break;
+
     case RTCAN_RTIOC_RCV_TIMEOUT:
     case RTCAN_RTIOC_SND_TIMEOUT: {
 	/* Do some work these requests have in common. */
@@ -539,6 +954,27 @@ int rtcan_raw_ioctl(struct rtdm_dev_context *context,
     recv_buf_index = (recv_buf_index + len) & (RTCAN_RXBUF_SIZE - 1);
 
 
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+/* Account the delay from delivery to dequeue of a frame */
+static void rtcan_lat_dequeue(int ifindex, nanosecs_abs_t timestamp)
+{
+    nanosecs_abs_t now = rtdm_clock_read();
+    struct rtcan_device *dev;
+    rtdm_lockctx_t lock_ctx;
+
+    dev = rtcan_dev_get_by_index(ifindex);
+    if (dev == NULL)
+	return;
+
+    rtdm_lock_get_irqsave(&dev->device_lock, lock_ctx);
+    rtcan_lat_account(&dev->lat_rcv_deq, now - timestamp);
+    rtdm_lock_put_irqrestore(&dev->device_lock, lock_ctx);
+
+    rtcan_dev_dereference(dev);
+}
+#endif /* CONFIG_XENO_DRIVERS_CAN_LATENCY */
+
+
 ssize_t rtcan_raw_recvmsg(struct rtdm_dev_context *context,
 			  rtdm_user_info_t *user_info,
 			  struct msghdr *msg, int flags)
@@ -685,8 +1121,9 @@ ssize_t rtcan_raw_recvmsg(struct rtdm_dev_context *context,
     }
 
 
-    /* Is a timestamp available and is the caller actually interested? */
-    if (msg->msg_controllen && (can_dlc & RTCAN_HAS_TIMESTAMP)) {
+    /* Fetch the timestamp if available, even if the caller is not
+     * interested, so that the ring buffer index skips it. */
+    if (can_dlc & RTCAN_HAS_TIMESTAMP) {
 	/* Copy timestamp */
 	MEMCPY_FROM_RING_BUF(&timestamp, RTCAN_TIMESTAMP_SIZE);
     }
@@ -698,14 +1135,27 @@ ssize_t rtcan_raw_recvmsg(struct rtdm_dev_context *context,
     if (flags & MSG_PEEK)
 	/* Next one, please! */
 	rtdm_sem_up(&sock->recv_sem);
-    else
+    else {
 	/* Adjust begin of first message in the ring buffer. */
 	sock->recv_head = recv_buf_index;
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+	sock->rx_queued--;
+#endif
+    }
 
 
     /* Release lock */
     rtdm_lock_put_irqrestore(&rtcan_socket_lock, lock_ctx);
 
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+    if (!(flags & MSG_PEEK))
+	rtcan_lat_dequeue(ifindex, timestamp);
+
+    /* Frames are stamped for us, not necessarily for the caller */
+    if (!test_bit(RTCAN_GET_TIMESTAMP, &context->context_flags))
+	can_dlc &= RTCAN_HAS_NO_TIMESTAMP;
+#endif
+
 
     /* Create CAN socket address to give back */
     if (msg->msg_namelen) {
@@ -797,9 +1247,13 @@ ssize_t rtcan_raw_sendmsg(struct rtdm_dev_context *context,
     rtdm_lockctx_t lock_ctx;
     nanosecs_rel_t timeout = 0;
     struct tx_wait_queue tx_wait;
+    struct rtcan_tx_req tx_req;
     struct rtcan_device *dev;
     int ifindex = 0;
     int ret  = 0;
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+    nanosecs_abs_t tx_stamp = rtdm_clock_read();
+#endif
 
 
     if (flags & MSG_OOB)   /* Mirror BSD error message compatibility */
@@ -907,35 +1361,79 @@ ssize_t rtcan_raw_sendmsg(struct rtdm_dev_context *context,
 
     timeout = (flags & MSG_DONTWAIT) ? RTDM_TIMEOUT_NONE : sock->tx_timeout;
 
-    tx_wait.rt_task = rtdm_task_current();
+    if (unlikely(test_bit(RTDM_CLOSING, &context->context_flags))) {
+	ret = -EBADF;
+	goto send_out1;
+    }
 
-    /* If socket was not closed recently, register the task at the
-     * socket's TX wait queue and decrement the TX semaphore. This must be
-     * atomic. Finally, the task must be deregistered again (also atomic). */
-    RTDM_EXECUTE_ATOMICALLY(
-	if (likely(!test_bit(RTDM_CLOSING, &context->context_flags))) {
+    rtdm_lock_get_irqsave(&dev->device_lock, lock_ctx);
 
-	    list_add(&tx_wait.tx_wait_list, &sock->tx_wait_head);
+    /* Try to pass the guard in order to access the controller. As long
+     * as senders are queued, the guard is handed over to them by the
+     * TX-complete path, so this cannot overtake them. */
+    ret = rtdm_sem_timeddown(&dev->tx_sem, RTDM_TIMEOUT_NONE, NULL);
+
+    if (ret == -EWOULDBLOCK && timeout != RTDM_TIMEOUT_NONE) {
+	/* Queue up by priority, the frame is sent from the TX-complete
+	 * path as soon as the controller is ours. */
+	tx_req.frame = frame;
+	tx_req.sock = sock;
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+	tx_req.stamp = tx_stamp;
+#endif
+	rtdm_event_init(&tx_req.done, 0);
+	rtcan_tx_enqueue(dev, &tx_req);
 
-	    /* Try to pass the guard in order to access the controller */
-	    ret = rtdm_sem_timeddown(&dev->tx_sem, timeout, NULL);
+	rtdm_lock_put_irqrestore(&dev->device_lock, lock_ctx);
 
-	    /* Only dequeue task again if socket isn't being closed i.e. if
-	     * this task was not unblocked within the close() function. */
-	    if (likely(tx_wait.tx_wait_list.next != LIST_POISON1))
-		/* Dequeue this task from the TX wait queue */
-		list_del(&tx_wait.tx_wait_list);
-	    else
+	tx_wait.rt_task = rtdm_task_current();
+
+	/* If socket was not closed recently, register the task at the
+	 * socket's TX wait queue and wait for the frame to be handled.
+	 * This must be atomic. Finally, the task must be deregistered
+	 * again (also atomic). */
+	RTDM_EXECUTE_ATOMICALLY(
+	    if (likely(!test_bit(RTDM_CLOSING, &context->context_flags))) {
+
+		list_add(&tx_wait.tx_wait_list, &sock->tx_wait_head);
+
+		ret = rtdm_event_timedwait(&tx_req.done, timeout, NULL);
+
+		/* Only dequeue task again if socket isn't being closed
+		 * i.e. if this task was not unblocked within the close()
+		 * function. */
+		if (likely(tx_wait.tx_wait_list.next != LIST_POISON1))
+		    /* Dequeue this task from the TX wait queue */
+		    list_del(&tx_wait.tx_wait_list);
+		else
+		    /* The socket was closed. */
+		    ret = -EBADF;
+
+	    } else
 		/* The socket was closed. */
 		ret = -EBADF;
+	    );
 
-	} else
-	/* The socket was closed. */
-	ret = -EBADF;
-	);
+	rtdm_lock_get_irqsave(&dev->device_lock, lock_ctx);
+	if (tx_req.pending)
+	    /* Timed out or unblocked before our turn */
+	    rtcan_tx_dequeue(dev, &tx_req);
+	else
+	    /* Handled meanwhile, whatever woke us up */
+	    ret = tx_req.ret;
+	rtdm_lock_put_irqrestore(&dev->device_lock, lock_ctx);
+
+	rtdm_event_destroy(&tx_req.done);
+
+	if (ret == -EIDRM)
+	    ret = -ENETDOWN;
+	goto send_out1;
+    }
 
     /* Error code returned? */
     if (ret != 0) {
+	rtdm_lock_put_irqrestore(&dev->device_lock, lock_ctx);
+
 	/* Which error code? */
 	switch (ret) {
 	case -EIDRM:
@@ -956,26 +1454,27 @@ ssize_t rtcan_raw_sendmsg(struct rtdm_dev_context *context,
 
     /* We got access */
 
-
-    /* Push message onto stack for loopback when TX done */
-    if (rtcan_loopback_enabled(sock))
-	rtcan_tx_push(dev, sock, frame);
-
-    rtdm_lock_get_irqsave(&dev->device_lock, lock_ctx);
-
     /* Controller should be operating */
     if (!CAN_STATE_OPERATING(dev->state)) {
 	if (dev->state == CAN_STATE_SLEEPING) {
 	    ret = -ECOMM;
+	    /* Hand the guard over again */
+	    rtcan_tx_done(dev);
 	    rtdm_lock_put_irqrestore(&dev->device_lock, lock_ctx);
-	    rtdm_sem_up(&dev->tx_sem);
 	    goto send_out1;
 	}
 	ret = -ENETDOWN;
 	goto send_out2;
     }
 
+    /* Push message onto stack for loopback when TX done */
+    if (rtcan_loopback_enabled(sock))
+	rtcan_tx_push(dev, sock, frame);
+
     dev->tx_count++;
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+    dev->tx_stamp = tx_stamp;
+#endif
     ret = dev->hard_start_xmit(dev, frame);
 
     /* Return number of bytes sent upon successful completion */
@@ -990,6 +1489,48 @@ ssize_t rtcan_raw_sendmsg(struct rtdm_dev_context *context,
 }
 
 
+static int rtcan_raw_recvmmsg(struct rtdm_dev_context *context,
+			      rtdm_user_info_t *user_info,
+			      struct rtdm_mmsghdr *msgvec, unsigned int vlen,
+			      int flags)
+{
+    unsigned int n;
+    ssize_t ret;
+
+    for (n = 0; n < vlen; n++) {
+	ret = rtcan_raw_recvmsg(context, user_info, &msgvec[n].msg_hdr, flags);
+	if (ret < 0)
+	    /* Report the error with the next call if we got frames. */
+	    return n > 0 ? n : ret;
+	msgvec[n].msg_len = ret;
+
+	/* Only wait for the first frame, then drain what is pending. */
+	flags |= MSG_DONTWAIT;
+    }
+
+    return n;
+}
+
+
+static int rtcan_raw_sendmmsg(struct rtdm_dev_context *context,
+			      rtdm_user_info_t *user_info,
+			      struct rtdm_mmsghdr *msgvec, unsigned int vlen,
+			      int flags)
+{
+    unsigned int n;
+    ssize_t ret;
+
+    for (n = 0; n < vlen; n++) {
+	ret = rtcan_raw_sendmsg(context, user_info, &msgvec[n].msg_hdr, flags);
+	if (ret < 0)
+	    return n > 0 ? n : ret;
+	msgvec[n].msg_len = ret;
+    }
+
+    return n;
+}
+
+
 static struct rtdm_device rtcan_proto_raw_dev = {
     struct_version:     RTDM_DEVICE_STRUCT_VER,
 
@@ -1018,6 +1559,12 @@ static struct rtdm_device rtcan_proto_raw_dev = {
 
 	sendmsg_rt:     rtcan_raw_sendmsg,
 	sendmsg_nrt:    NULL,
+
+	recvmmsg_rt:    rtcan_raw_recvmmsg,
+	recvmmsg_nrt:   NULL,
+
+	sendmmsg_rt:    rtcan_raw_sendmmsg,
+	sendmmsg_nrt:   NULL,
     },
 
     device_class:       RTDM_CLASS_CAN,
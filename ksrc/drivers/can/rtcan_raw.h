@@ -29,10 +29,23 @@ int rtcan_raw_check_filter(struct rtcan_socket *sock,
 			   int ifindex, struct rtcan_filter_list *flist);
 int rtcan_raw_add_filter(struct rtcan_socket *sock, int ifindex);
 void rtcan_raw_remove_filter(struct rtcan_socket *sock);
+#ifdef CONFIG_XENO_DRIVERS_CAN_HW_FILTER
+void rtcan_raw_program_filter(struct rtcan_device *dev,
+			      rtdm_lockctx_t *lock_ctx);
+#else
+#define rtcan_raw_program_filter(dev, lock_ctx)
+#endif
 
 void rtcan_rcv(struct rtcan_device *rtcandev, struct rtcan_skb *skb);
 
 void rtcan_loopback(struct rtcan_device *rtcandev);
+
+void rtcan_tx_done(struct rtcan_device *dev);
+void rtcan_tx_flush(struct rtcan_device *dev);
+int rtcan_tx_frame(struct rtcan_device *dev, can_frame_t *frame,
+		   nanosecs_rel_t timeout);
+
+void __rtcan_rcv(struct rtcan_device *dev, struct rtcan_skb *skb);
 #ifdef CONFIG_XENO_DRIVERS_CAN_LOOPBACK
 #define rtcan_loopback_enabled(sock) (sock->loopback)
 #define rtcan_loopback_pending(dev) (dev->tx_socket)
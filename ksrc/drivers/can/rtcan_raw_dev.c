@@ -319,8 +319,11 @@ static inline int rtcan_raw_ioctl_dev_set(struct rtcan_device *dev,
     case SIOCSCANMODE:
 	mode = (can_mode_t *)&ifr->ifr_ifru;
 	if (dev->do_set_mode &&
-	    !(*mode == CAN_MODE_START && CAN_STATE_OPERATING(dev->state)))
+	    !(*mode == CAN_MODE_START && CAN_STATE_OPERATING(dev->state))) {
+	    if (*mode == CAN_MODE_START)
+		rtcan_raw_program_filter(dev, &lock_ctx);
 	    ret = dev->do_set_mode(dev, *mode, &lock_ctx);
+	}
 	break;
 
     case SIOCSCANCTRLMODE:
@@ -358,8 +361,10 @@ static inline int rtcan_raw_ioctl_dev_set(struct rtcan_device *dev,
     }
 
  out:
-    if (started)
+    if (started) {
+	rtcan_raw_program_filter(dev, &lock_ctx);
 	dev->do_set_mode(dev, CAN_MODE_START, &lock_ctx);
+    }
 
     rtdm_lock_put_irqrestore(&dev->device_lock, lock_ctx);
 
@@ -429,6 +434,56 @@ int rtcan_raw_ioctl_dev(struct rtdm_dev_context *context,
 	rtcan_dev_dereference(dev);
 	break;
 
+#ifdef CONFIG_XENO_DRIVERS_CAN_GW
+    case SIOCSCANRXCPU:
+
+	/* Starting receive tasks requires a Linux context */
+	if (rtdm_in_rt_context())
+	    return -ENOSYS;
+
+	if (user_info) {
+	    if (!rtdm_read_user_ok(user_info, arg,
+				   sizeof(struct ifreq)) ||
+		rtdm_copy_from_user(user_info, &ifr_buf, arg,
+				    sizeof(struct ifreq)))
+		return -EFAULT;
+
+	    ifr = &ifr_buf;
+	} else
+	    ifr = (struct ifreq *)arg;
+
+	if ((dev = rtcan_dev_get_by_name(ifr->ifr_name)) == NULL)
+	    return -ENODEV;
+	ret = rtcan_gw_set_rx_cpu(dev, *(int *)&ifr->ifr_ifru);
+	rtcan_dev_dereference(dev);
+	break;
+
+    case SIOCADDCANROUTE:
+    case SIOCDELCANROUTE: {
+	struct can_route route_buf, *route;
+
+	if (rtdm_in_rt_context())
+	    return -ENOSYS;
+
+	if (user_info) {
+	    if (!rtdm_read_user_ok(user_info, arg,
+				   sizeof(struct can_route)) ||
+		rtdm_copy_from_user(user_info, &route_buf, arg,
+				    sizeof(struct can_route)))
+		return -EFAULT;
+
+	    route = &route_buf;
+	} else
+	    route = (struct can_route *)arg;
+
+	if (request == SIOCADDCANROUTE)
+	    ret = rtcan_gw_add_route(route);
+	else
+	    ret = rtcan_gw_del_route(route);
+	break;
+    }
+#endif /* CONFIG_XENO_DRIVERS_CAN_GW */
+
     default:
 	ret = -EOPNOTSUPP;
 	break;
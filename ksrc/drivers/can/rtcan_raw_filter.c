@@ -68,6 +68,89 @@ static inline void rtcan_raw_mount_filter(can_filter_t *recv_filter,
 }
 
 
+/*
+ * A filter is hashed if it is not inverted and all standard ID bits
+ * take part in the comparison: any frame it accepts then lands in the
+ * bucket of the filter ID.
+ */
+static inline int rtcan_raw_filter_hashable(can_filter_t *filter)
+{
+    return !(filter->can_mask & CAN_INV_FILTER) &&
+	(filter->can_mask & CAN_SFF_MASK) == CAN_SFF_MASK;
+}
+
+
+static void rtcan_raw_index_filter(struct rtcan_device *dev)
+{
+    struct rtcan_recv *r, **head;
+
+    memset(dev->recv_hash, 0, sizeof(dev->recv_hash));
+    dev->recv_masked = NULL;
+
+    for (r = dev->recv_list; r != NULL; r = r->next) {
+	if (rtcan_raw_filter_hashable(&r->can_filter))
+	    head = &dev->recv_hash[rtcan_recv_hashfn(r->can_filter.can_id)];
+	else
+	    head = &dev->recv_masked;
+	r->hnext = *head;
+	*head = r;
+    }
+}
+
+
+#ifdef CONFIG_XENO_DRIVERS_CAN_HW_FILTER
+/*
+ * Compute a single id/mask pair accepting at least every frame one of
+ * the registered filters accepts. Only the bits all filters compare
+ * with the same value are kept in the mask. Inverted filters or an
+ * empty list give the accept-all filter.
+ */
+static void rtcan_raw_merge_filter(struct rtcan_device *dev,
+				   can_filter_t *filter)
+{
+    struct rtcan_recv *r = dev->recv_list;
+
+    filter->can_id = filter->can_mask = 0;
+
+    if (r == NULL || (r->can_filter.can_mask & CAN_INV_FILTER))
+	return;
+
+    *filter = r->can_filter;
+    for (r = r->next; r != NULL; r = r->next) {
+	if ((r->can_filter.can_mask & CAN_INV_FILTER)) {
+	    filter->can_id = filter->can_mask = 0;
+	    return;
+	}
+	filter->can_mask &= r->can_filter.can_mask &
+	    ~(r->can_filter.can_id ^ filter->can_id);
+	filter->can_id &= filter->can_mask;
+    }
+}
+
+
+/*
+ * Called with device_lock held before starting the controller. Controllers
+ * can reprogram their acceptance registers in reset mode only, so this is
+ * the point where the bound filters are handed over to the hardware.
+ */
+void rtcan_raw_program_filter(struct rtcan_device *dev,
+			      rtdm_lockctx_t *lock_ctx)
+{
+    can_filter_t filter;
+
+    if (!dev->do_set_filter)
+	return;
+
+    rtdm_lock_get(&rtcan_recv_list_lock);
+    rtcan_raw_merge_filter(dev, &filter);
+    rtdm_lock_put(&rtcan_recv_list_lock);
+
+    if (dev->do_set_filter(dev, &filter, lock_ctx))
+	RTCAN_RTDM_DBG("%s: acceptance filter not programmed\n", dev->name);
+}
+#endif /* CONFIG_XENO_DRIVERS_CAN_HW_FILTER */
+
+
 int rtcan_raw_check_filter(struct rtcan_socket *sock, int ifindex,
 			   struct rtcan_filter_list *flist)
 {
@@ -191,6 +274,7 @@ int rtcan_raw_add_filter(struct rtcan_socket *sock, int ifindex)
 	/* Adjust rececption list pointer */
 	dev->recv_list = first;
 
+	rtcan_raw_index_filter(dev);
 	rtcan_raw_print_filter(dev);
 	rtcan_dev_dereference(dev);
     }
@@ -250,6 +334,7 @@ void rtcan_raw_remove_filter(struct rtcan_socket *sock)
 	/* Increase free entries counter by length of old filter list */
 	dev->free_entries += sock->flistlen;
 
+	rtcan_raw_index_filter(dev);
 	rtcan_raw_print_filter(dev);
 	rtcan_dev_dereference(dev);
     }
@@ -28,12 +28,99 @@
  * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
  */
 
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+
 #include "rtcan_socket.h"
 #include "rtcan_list.h"
 
 
 LIST_HEAD(rtcan_socket_list);
 
+/*
+ * Receive rings are mapped to user-space, so they are built from
+ * reserved pages. The socket holds one reference on the ring, and
+ * each mapping another one, so that closing the socket does not pull
+ * the pages from under a process still mapping them.
+ */
+struct rtcan_rx_mapping *rtcan_rx_ring_alloc(size_t size)
+{
+    struct rtcan_rx_mapping *map;
+    char *vaddr;
+
+    map = kmalloc(sizeof(*map), GFP_KERNEL);
+    if (map == NULL)
+	return NULL;
+
+    map->ring = vmalloc_32(size);
+    if (map->ring == NULL) {
+	kfree(map);
+	return NULL;
+    }
+
+    memset(map->ring, 0, size);
+    for (vaddr = (char *)map->ring; vaddr < (char *)map->ring + size;
+	 vaddr += PAGE_SIZE)
+	SetPageReserved(vmalloc_to_page(vaddr));
+
+    map->size = size;
+    atomic_set(&map->refcnt, 1);
+
+    return map;
+}
+
+
+void rtcan_rx_ring_put(struct rtcan_rx_mapping *map)
+{
+    char *vaddr;
+
+    if (!atomic_dec_and_test(&map->refcnt))
+	return;
+
+    for (vaddr = (char *)map->ring; vaddr < (char *)map->ring + map->size;
+	 vaddr += PAGE_SIZE)
+	ClearPageReserved(vmalloc_to_page(vaddr));
+    vfree(map->ring);
+    kfree(map);
+}
+
+
+static void rtcan_rx_ring_vm_open(struct vm_area_struct *vma)
+{
+    struct rtcan_rx_mapping *map = vma->vm_private_data;
+
+    atomic_inc(&map->refcnt);
+}
+
+
+static void rtcan_rx_ring_vm_close(struct vm_area_struct *vma)
+{
+    rtcan_rx_ring_put(vma->vm_private_data);
+}
+
+
+static struct vm_operations_struct rtcan_rx_ring_vm_ops = {
+    .open  = rtcan_rx_ring_vm_open,
+    .close = rtcan_rx_ring_vm_close,
+};
+
+
+int rtcan_rx_ring_mmap(rtdm_user_info_t *user_info,
+		       struct rtcan_rx_mapping *map, void **uaddr)
+{
+    int ret;
+
+    ret = rtdm_mmap_to_user(user_info, map->ring, map->size,
+			    PROT_READ | PROT_WRITE, uaddr,
+			    &rtcan_rx_ring_vm_ops, map);
+    /* The initial mapping does not go through the open handler. */
+    if (ret == 0)
+	atomic_inc(&map->refcnt);
+
+    return ret;
+}
+
+
 void rtcan_socket_init(struct rtdm_dev_context *context)
 {
     struct rtcan_socket *sock = (struct rtcan_socket *)&context->dev_private;
@@ -49,6 +136,12 @@ void rtcan_socket_init(struct rtdm_dev_context *context)
     sock->flist = NULL;
     sock->err_mask = 0;
     sock->rx_buf_full = 0;
+    sock->rx_ring = NULL;
+    sock->rx_ring_map = NULL;
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+    sock->rx_queued = 0;
+    sock->rx_queued_max = 0;
+#endif
 #ifdef CONFIG_XENO_DRIVERS_CAN_LOOPBACK
     sock->loopback = 1;
 #endif
@@ -68,6 +161,7 @@ void rtcan_socket_cleanup(struct rtdm_dev_context *context)
 {
     struct rtcan_socket *sock = (struct rtcan_socket *)&context->dev_private;
     struct tx_wait_queue *tx_waiting;
+    struct rtcan_rx_mapping *map;
     rtdm_lockctx_t lock_ctx;
     int tx_list_empty;
 
@@ -103,4 +197,14 @@ void rtcan_socket_cleanup(struct rtdm_dev_context *context)
 	sock->socket_list.next = NULL;
     }
     rtdm_lock_put_irqrestore(&rtcan_recv_list_lock, lock_ctx);
+
+    rtdm_lock_get_irqsave(&rtcan_socket_lock, lock_ctx);
+    map = sock->rx_ring_map;
+    sock->rx_ring = NULL;
+    sock->rx_ring_map = NULL;
+    rtdm_lock_put_irqrestore(&rtcan_socket_lock, lock_ctx);
+
+    /* Pages remain until the last user-space mapping goes away. */
+    if (map)
+	rtcan_rx_ring_put(map);
 }
@@ -114,6 +114,13 @@ struct rtcan_filter_list {
     struct can_filter flist[1];
 };
 
+/* Receive ring allocation, shared by the socket and its mappings */
+struct rtcan_rx_mapping {
+    atomic_t            refcnt;
+    size_t              size;
+    struct can_rx_ring  *ring;
+};
+
 /*
  * Internal CAN socket structure.
  *
@@ -151,6 +158,25 @@ struct rtcan_socket {
     /* Semaphore for receivers and incoming messages */
     rtdm_sem_t          recv_sem;
 
+    /* Receive ring mapped to user-space, NULL if the socket uses the
+     * ring buffer above. The ring pointer and the following fields are
+     * protected by rtcan_socket_lock in all socket structures. */
+    struct can_rx_ring  *rx_ring;
+
+    /* Reference-counted allocation backing rx_ring */
+    struct rtcan_rx_mapping *rx_ring_map;
+
+    /* Kernel copies of the ring geometry, the header being writable by
+     * user-space */
+    unsigned int        rx_ring_slots;
+    unsigned int        rx_ring_wm;
+
+    /* Index of the next slot to fill */
+    unsigned int        rx_ring_head;
+
+    /* Frames stored since the last RTCAN_RTIOC_RX_RING_WAIT */
+    unsigned int        rx_ring_pending;
+
 
     /* All senders waiting to be able to send
      * via this socket are queued here */
@@ -170,6 +196,13 @@ struct rtcan_socket {
 
     uint32_t            rx_buf_full;
 
+#ifdef CONFIG_XENO_DRIVERS_CAN_LATENCY
+    /* Frames in the ring buffer and highest count seen. Protected by
+     * rtcan_socket_lock in all socket structures. */
+    unsigned int        rx_queued;
+    unsigned int        rx_queued_max;
+#endif
+
     struct rtcan_filter_list *flist;
 
 #ifdef CONFIG_XENO_DRIVERS_CAN_LOOPBACK
@@ -203,5 +236,10 @@ extern struct list_head rtcan_socket_list;
 extern void rtcan_socket_init(struct rtdm_dev_context *context);
 extern void rtcan_socket_cleanup(struct rtdm_dev_context *context);
 
+extern struct rtcan_rx_mapping *rtcan_rx_ring_alloc(size_t size);
+extern void rtcan_rx_ring_put(struct rtcan_rx_mapping *map);
+extern int rtcan_rx_ring_mmap(rtdm_user_info_t *user_info,
+			      struct rtcan_rx_mapping *map, void **uaddr);
+
 
 #endif  /* __RTCAN_SOCKET_H_ */
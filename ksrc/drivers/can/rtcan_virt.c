@@ -54,9 +54,6 @@ static int rtcan_virt_start_xmit(struct rtcan_device *tx_dev,
 	struct rtcan_rb_frame *rx_frame = &skb.rb_frame;
 	rtdm_lockctx_t lock_ctx;
 
-	/* we can transmit immediately again */
-	rtdm_sem_up(&tx_dev->tx_sem);
-
 	skb.rb_frame_size = EMPTY_RB_FRAME_SIZE;
 
 	rx_frame->can_dlc = tx_frame->can_dlc;
@@ -85,6 +82,9 @@ static int rtcan_virt_start_xmit(struct rtcan_device *tx_dev,
 	rtdm_lock_put(&rtcan_socket_lock);
 	rtdm_lock_put_irqrestore(&rtcan_recv_list_lock, lock_ctx);
 
+	/* we can transmit immediately again */
+	rtcan_tx_done(tx_dev);
+
 	return 0;
 }
 
@@ -98,6 +98,7 @@ static int rtcan_virt_set_mode(struct rtcan_device *dev, can_mode_t mode,
 	case CAN_MODE_STOP:
 		dev->state = CAN_STATE_STOPPED;
 		/* Wake up waiting senders */
+		rtcan_tx_flush(dev);
 		rtdm_sem_destroy(&dev->tx_sem);
 		break;
 
@@ -246,6 +246,7 @@ static inline void rtcan_sja_err_interrupt(struct rtcan_device *dev,
 	       recovery) */
 	    chip->write_reg(dev, SJA_IER, SJA_IER_EIE);
 	    /* Wake up waiting senders */
+	    rtcan_tx_flush(dev);
 	    rtdm_sem_destroy(&dev->tx_sem);
 	}
 
@@ -294,6 +295,8 @@ static int rtcan_sja_interrupt(rtdm_irq_t *irq_handle)
     /* Take spinlock protecting HW register access and device structures. */
     rtdm_lock_get(&dev->device_lock);
 
+    rtcan_lat_isr_enter(dev);
+
     /* Loop as long as the device reports an event */
     while ((irq_source = chip->read_reg(dev, SJA_IR))) {
 	ret = RTDM_IRQ_HANDLED;
@@ -325,8 +328,7 @@ static int rtcan_sja_interrupt(rtdm_irq_t *irq_handle)
 
 	/* Transmit Interrupt? */
 	if (irq_source & SJA_IR_TI) {
-	    /* Wake up a sender */
-	    rtdm_sem_up(&dev->tx_sem);
+	    rtcan_lat_tx_complete(dev);
 
 	    if (rtcan_loopback_pending(dev)) {
 
@@ -338,6 +340,9 @@ static int rtcan_sja_interrupt(rtdm_irq_t *irq_handle)
 
 		rtcan_loopback(dev);
 	    }
+
+	    /* Refill from the TX queue or wake up a sender */
+	    rtcan_tx_done(dev);
 	}
 
 	/* Receive Interrupt? */
@@ -396,6 +401,7 @@ static inline int rtcan_sja_is_operating(struct rtcan_device *dev,
 	/* Disable the controller's interrupts */
 	chip->write_reg(dev, SJA_IER, 0x00);
 	/* Wake up waiting senders */
+	rtcan_tx_flush(dev);
 	rtdm_sem_destroy(&dev->tx_sem);
     }
 
@@ -451,6 +457,7 @@ static int rtcan_sja_mode_stop(struct rtcan_device *dev,
 	/* Volatile state could have changed while we slept busy. */
 	dev->state = CAN_STATE_STOPPED;
 	/* Wake up waiting senders */
+	rtcan_tx_flush(dev);
 	rtdm_sem_destroy(&dev->tx_sem);
     } else {
 	ret = -EAGAIN;
@@ -464,6 +471,58 @@ static int rtcan_sja_mode_stop(struct rtcan_device *dev,
 
 
 
+#ifdef CONFIG_XENO_DRIVERS_CAN_HW_FILTER
+/*
+ * Program the acceptance filter in single filter mode. The 32 bit code
+ * and mask words map to ACR0..3/AMR0..3, with a set AMR bit meaning
+ * "don't care". Standard frames use the upper 12 bits (ID.10-0, RTR),
+ * extended frames the upper 30 bits (ID.28-0, RTR). A filter which does
+ * not pin down the frame format cannot be expressed and opens the
+ * acceptance filter completely.
+ */
+static int rtcan_sja_set_filter(struct rtcan_device *dev,
+				can_filter_t *filter,
+				rtdm_lockctx_t *lock_ctx)
+{
+    struct rtcan_sja1000 *chip = (struct rtcan_sja1000 *)dev->priv;
+    u32 code = 0, care = 0;
+    int i;
+
+    /* Acceptance registers are only accessible in reset mode */
+    if (!(chip->read_reg(dev, SJA_MOD) & SJA_MOD_RM))
+	return -EBUSY;
+
+    if (filter->can_mask & CAN_EFF_FLAG) {
+	if (filter->can_id & CAN_EFF_FLAG) {
+	    code = (filter->can_id & CAN_EFF_MASK) << 3;
+	    care = (filter->can_mask & CAN_EFF_MASK) << 3;
+	    if (filter->can_mask & CAN_RTR_FLAG) {
+		care |= 1 << 2;
+		if (filter->can_id & CAN_RTR_FLAG)
+		    code |= 1 << 2;
+	    }
+	} else {
+	    code = (filter->can_id & CAN_SFF_MASK) << 21;
+	    care = (filter->can_mask & CAN_SFF_MASK) << 21;
+	    if (filter->can_mask & CAN_RTR_FLAG) {
+		care |= 1 << 20;
+		if (filter->can_id & CAN_RTR_FLAG)
+		    code |= 1 << 20;
+	    }
+	}
+    }
+
+    chip->write_reg(dev, SJA_MOD, SJA_MOD_RM | SJA_MOD_AFM);
+    for (i = 0; i < 4; i++) {
+	chip->write_reg(dev, SJA_ACR0 + i, (code >> (24 - 8 * i)) & 0xFF);
+	chip->write_reg(dev, SJA_AMR0 + i, (~care >> (24 - 8 * i)) & 0xFF);
+    }
+
+    return 0;
+}
+#endif /* CONFIG_XENO_DRIVERS_CAN_HW_FILTER */
+
+
 /*
  * Set controller into operating mode.
  *
@@ -486,6 +545,9 @@ static int rtcan_sja_mode_start(struct rtcan_device *dev,
 	mod_reg |= SJA_MOD_LOM;
     if (dev->ctrl_mode & CAN_CTRLMODE_LOOPBACK)
 	mod_reg |= SJA_MOD_STM;
+#ifdef CONFIG_XENO_DRIVERS_CAN_HW_FILTER
+    mod_reg |= SJA_MOD_AFM;
+#endif
 
     switch (dev->state) {
 
@@ -771,6 +833,9 @@ int rtcan_sja1000_register(struct rtcan_device *dev)
     dev->do_get_state = rtcan_sja_get_state;
     dev->do_set_bit_time = rtcan_sja_set_bit_time;
     dev->do_enable_bus_err = rtcan_sja_enable_bus_err;
+#ifdef CONFIG_XENO_DRIVERS_CAN_HW_FILTER
+    dev->do_set_filter = rtcan_sja_set_filter;
+#endif
 #ifndef CONFIG_XENO_DRIVERS_CAN_CALC_BITTIME_OLD
     dev->bittiming_const = &sja1000_bittiming_const;
 #endif
@@ -54,6 +54,15 @@ struct bufp_socket {
 	nanosecs_rel_t rx_timeout;
 	nanosecs_rel_t tx_timeout;
 
+	/* Fan-out mode, ring side. */
+	int fanout;
+	int nrcopy;		/* Readers copying from bufmem. */
+	struct list_head readers;
+	/* Fan-out mode, reader side. */
+	struct bufp_socket *ring;
+	struct list_head rnext;
+	unsigned long dropped;
+
 	struct rtipc_private *priv;
 };
 
@@ -127,6 +136,86 @@ static void __bufp_cleanup_handler(struct rtipc_wait_context *wc)
 	rtipc_leave_atomic(bufwc->lockctx);
 }
 
+/*
+ * Fan-out mode: the ring socket owns the buffer and the write
+ * cursor, each subscriber has its own read cursor and fill count in
+ * rdoff/fillsz. All the accesses to those fields are serialized by
+ * the nucleus lock.
+ */
+static size_t __bufp_fillsz(struct bufp_socket *sk)
+{
+	struct bufp_socket *rsk;
+	size_t fillsz = 0;
+
+	if (!sk->fanout)
+		return sk->fillsz;
+
+	/* The slowest reader defines the room left in the ring. */
+	list_for_each_entry(rsk, &sk->readers, rnext)
+		if (rsk->fillsz > fillsz)
+			fillsz = rsk->fillsz;
+
+	return fillsz;
+}
+
+static void __bufp_drop_laggards(struct bufp_socket *sk, size_t len)
+{
+	struct bufp_socket *rsk;
+
+	list_for_each_entry(rsk, &sk->readers, rnext) {
+		if (rsk->fillsz + len <= sk->bufsz)
+			continue;
+		rsk->dropped += rsk->fillsz;
+		rsk->fillsz = 0;
+		rsk->rdoff = sk->wroff;
+		/* Invalidate any read in progress. */
+		rsk->rdtoken++;
+	}
+}
+
+static void __bufp_wakeup_reader(struct bufp_socket *sk)
+{
+	struct bufp_wait_context *bufwc;
+	struct rtipc_wait_context *wc;
+	xnthread_t *waiter;
+
+	/*
+	 * Wake up all threads pending on the input wait queue, if we
+	 * accumulated enough data to feed the leading one.
+	 */
+	waiter = rtipc_peek_wait_head(&sk->i_event);
+	if (waiter == NULL)
+		return;
+
+	wc = rtipc_get_wait_context(waiter);
+	XENO_BUGON(NUCLEUS, wc == NULL);
+	bufwc = container_of(wc, struct bufp_wait_context, wc);
+	if (bufwc->len <= sk->fillsz)
+		rtdm_event_pulse(&sk->i_event);
+}
+
+static void __bufp_wakeup_writer(struct bufp_socket *sk)
+{
+	struct bufp_wait_context *bufwc;
+	struct rtipc_wait_context *wc;
+	xnthread_t *waiter;
+
+	/*
+	 * Wake up all threads pending on the output wait queue, if
+	 * enough room was freed for the leading one to post its
+	 * message.
+	 */
+	waiter = rtipc_peek_wait_head(&sk->o_event);
+	if (waiter == NULL)
+		return;
+
+	wc = rtipc_get_wait_context(waiter);
+	XENO_BUGON(NUCLEUS, wc == NULL);
+	bufwc = container_of(wc, struct bufp_wait_context, wc);
+	if (bufwc->len + __bufp_fillsz(sk) <= sk->bufsz)
+		rtdm_event_pulse(&sk->o_event);
+}
+
 static int bufp_socket(struct rtipc_private *priv,
 		       rtdm_user_info_t *user_info)
 {
@@ -146,6 +235,11 @@ static int bufp_socket(struct rtipc_private *priv,
 	sk->handle = 0;
 	sk->rx_timeout = RTDM_TIMEOUT_INFINITE;
 	sk->tx_timeout = RTDM_TIMEOUT_INFINITE;
+	sk->fanout = 0;
+	sk->nrcopy = 0;
+	INIT_LIST_HEAD(&sk->readers);
+	sk->ring = NULL;
+	sk->dropped = 0;
 	*sk->label = 0;
 	rtdm_event_init(&sk->i_event, 0);
 	rtdm_event_init(&sk->o_event, 0);
@@ -157,7 +251,31 @@ static int bufp_socket(struct rtipc_private *priv,
 static int bufp_close(struct rtipc_private *priv,
 		      rtdm_user_info_t *user_info)
 {
-	struct bufp_socket *sk = priv->state;
+	struct bufp_socket *sk = priv->state, *rsk, *tmp;
+	int busy;
+
+	RTDM_EXECUTE_ATOMICALLY(
+		if (sk->ring) {
+			/* We may have been the slowest reader. */
+			list_del(&sk->rnext);
+			__bufp_wakeup_writer(sk->ring);
+			sk->ring = NULL;
+		}
+		/* Disconnect our own subscribers, if any. */
+		list_for_each_entry_safe(rsk, tmp, &sk->readers, rnext) {
+			list_del(&rsk->rnext);
+			rsk->ring = NULL;
+			rtdm_event_pulse(&rsk->i_event);
+		}
+		busy = sk->nrcopy;
+	);
+
+	/*
+	 * Former subscribers may still be copying data from our
+	 * buffer, have the close call retried later in that case.
+	 */
+	if (busy)
+		return -EAGAIN;
 
 	rtdm_event_destroy(&sk->i_event);
 	rtdm_event_destroy(&sk->o_event);
@@ -177,12 +295,11 @@ static int bufp_close(struct rtipc_private *priv,
 }
 
 static ssize_t __bufp_readbuf(struct bufp_socket *sk,
+			      struct bufp_socket *ring,
 			      struct xnbufd *bufd,
 			      int flags)
 {
-	struct bufp_wait_context wait, *bufwc;
-	struct rtipc_wait_context *wc;
-	xnthread_t *waiter;
+	struct bufp_wait_context wait;
 	rtdm_toseq_t toseq;
 	ssize_t len, ret;
 	size_t rbytes, n;
@@ -197,6 +314,12 @@ static ssize_t __bufp_readbuf(struct bufp_socket *sk,
 
 redo:
 	for (;;) {
+		/* A subscriber may have lost its ring meanwhile. */
+		if (ring != sk && sk->ring != ring) {
+			ret = -ECONNRESET;
+			break;
+		}
+
 		/*
 		 * We should be able to read a complete message of the
 		 * requested length, or block.
@@ -215,20 +338,24 @@ redo:
 		rbytes = len;
 
 		do {
-			if (rdoff + rbytes > sk->bufsz)
-				n = sk->bufsz - rdoff;
+			if (rdoff + rbytes > ring->bufsz)
+				n = ring->bufsz - rdoff;
 			else
 				n = rbytes;
 			/*
 			 * Release the lock while retrieving the data
-			 * to keep latency low.
+			 * to keep latency low. A ring may not go away
+			 * while subscribers are copying from it.
 			 */
+			if (ring != sk)
+				ring->nrcopy++;
 			rtipc_leave_atomic(wait.lockctx);
-			ret = xnbufd_copy_from_kmem(bufd, sk->bufmem + rdoff, n);
-			if (ret < 0)
-				return ret;
-
+			ret = xnbufd_copy_from_kmem(bufd, ring->bufmem + rdoff, n);
 			rtipc_enter_atomic(wait.lockctx);
+			if (ring != sk)
+				ring->nrcopy--;
+			if (ret < 0)
+				goto out;
 			/*
 			 * In case we were preempted while retrieving
 			 * the message, we have to re-read the whole
@@ -239,7 +366,7 @@ redo:
 				goto redo;
 			}
 
-			rdoff = (rdoff + n) % sk->bufsz;
+			rdoff = (rdoff + n) % ring->bufsz;
 			rbytes -= n;
 		} while (rbytes > 0);
 
@@ -247,20 +374,7 @@ redo:
 		sk->rdoff = rdoff;
 		ret = len;
 
-		/*
-		 * Wake up all threads pending on the output wait
-		 * queue, if we freed enough room for the leading one
-		 * to post its message.
-		 */
-		waiter = rtipc_peek_wait_head(&sk->o_event);
-		if (waiter == NULL)
-			goto out;
-
-		wc = rtipc_get_wait_context(waiter);
-		XENO_BUGON(NUCLEUS, wc == NULL);
-		bufwc = container_of(wc, struct bufp_wait_context, wc);
-		if (bufwc->len + sk->fillsz <= sk->bufsz)
-			rtdm_event_pulse(&sk->o_event);
+		__bufp_wakeup_writer(ring);
 		/*
 		 * We cannot fail anymore once some data has been
 		 * copied via the buffer descriptor, so no need to
@@ -281,7 +395,7 @@ redo:
 		 * pathological use of the buffer. We must allow for a
 		 * short read to prevent a deadlock.
 		 */
-		if (sk->fillsz > 0 && rtipc_peek_wait_head(&sk->o_event)) {
+		if (sk->fillsz > 0 && rtipc_peek_wait_head(&ring->o_event)) {
 			len = sk->fillsz;
 			goto redo;
 		}
@@ -312,13 +426,24 @@ static ssize_t __bufp_recvmsg(struct rtipc_private *priv,
 			      struct iovec *iov, int iovlen, int flags,
 			      struct sockaddr_ipc *saddr)
 {
-	struct bufp_socket *sk = priv->state;
+	struct bufp_socket *sk = priv->state, *ring;
 	ssize_t len, wrlen, vlen, ret;
 	struct xnbufd bufd;
+	size_t bufsz;
 	int nvec;
 
-	if (!test_bit(_BUFP_BOUND, &sk->status))
-		return -EAGAIN;
+	RTDM_EXECUTE_ATOMICALLY(
+		ring = sk->ring ?: sk;
+		bufsz = ring->bufsz;
+	);
+
+	if (ring == sk) {
+		if (!test_bit(_BUFP_BOUND, &sk->status))
+			return -EAGAIN;
+		/* Only subscribers may read from a fan-out ring. */
+		if (sk->fanout)
+			return -EOPNOTSUPP;
+	}
 
 	len = rtipc_get_iov_flatlen(iov, iovlen);
 	if (len == 0)
@@ -328,7 +453,7 @@ static ssize_t __bufp_recvmsg(struct rtipc_private *priv,
 	 * is no point in waiting for messages which are larger than
 	 * what the buffer can hold.
 	 */
-	if (len > sk->bufsz)
+	if (len > bufsz)
 		return -EINVAL;
 
 	/*
@@ -342,13 +467,13 @@ static ssize_t __bufp_recvmsg(struct rtipc_private *priv,
 #ifdef CONFIG_XENO_OPT_PERVASIVE
 		if (user_info) {
 			xnbufd_map_uread(&bufd, iov[nvec].iov_base, vlen);
-			ret = __bufp_readbuf(sk, &bufd, flags);
+			ret = __bufp_readbuf(sk, ring, &bufd, flags);
 			xnbufd_unmap_uread(&bufd);
 		} else
 #endif
 		{
 			xnbufd_map_kread(&bufd, iov[nvec].iov_base, vlen);
-			ret = __bufp_readbuf(sk, &bufd, flags);
+			ret = __bufp_readbuf(sk, ring, &bufd, flags);
 			xnbufd_unmap_kread(&bufd);
 		}
 		if (ret < 0)
@@ -431,9 +556,8 @@ static ssize_t __bufp_writebuf(struct bufp_socket *rsk,
 			       struct xnbufd *bufd,
 			       int flags)
 {
-	struct bufp_wait_context wait, *bufwc;
-	struct rtipc_wait_context *wc;
-	xnthread_t *waiter;
+	struct bufp_socket *reader;
+	struct bufp_wait_context wait;
 	rtdm_toseq_t toseq;
 	ssize_t len, ret;
 	size_t wbytes, n;
@@ -448,11 +572,18 @@ static ssize_t __bufp_writebuf(struct bufp_socket *rsk,
 
 redo:
 	for (;;) {
+		/*
+		 * In drop mode, lagging subscribers make room for
+		 * the new data instead of blocking us.
+		 */
+		if (rsk->fanout == BUFP_FANOUT_DROP)
+			__bufp_drop_laggards(rsk, len);
+
 		/*
 		 * We should be able to write the entire message at
 		 * once or block.
 		 */
-		if (rsk->fillsz + len > rsk->bufsz)
+		if (__bufp_fillsz(rsk) + len > rsk->bufsz)
 			goto wait;
 
 		/*
@@ -493,24 +624,19 @@ redo:
 			wbytes -= n;
 		} while (wbytes > 0);
 
-		rsk->fillsz += len;
 		rsk->wroff = wroff;
 		ret = len;
 
-		/*
-		 * Wake up all threads pending on the input wait
-		 * queue, if we accumulated enough data to feed the
-		 * leading one.
-		 */
-		waiter = rtipc_peek_wait_head(&rsk->i_event);
-		if (waiter == NULL)
-			goto out;
-
-		wc = rtipc_get_wait_context(waiter);
-		XENO_BUGON(NUCLEUS, wc == NULL);
-		bufwc = container_of(wc, struct bufp_wait_context, wc);
-		if (bufwc->len <= rsk->fillsz)
-			rtdm_event_pulse(&rsk->i_event);
+		if (rsk->fanout) {
+			/* Publish the data to every subscriber. */
+			list_for_each_entry(reader, &rsk->readers, rnext) {
+				reader->fillsz += len;
+				__bufp_wakeup_reader(reader);
+			}
+		} else {
+			rsk->fillsz += len;
+			__bufp_wakeup_reader(rsk);
+		}
 		/*
 		 * We cannot fail anymore once some data has been
 		 * copied via the buffer descriptor, so no need to
@@ -701,8 +827,11 @@ static int __bufp_bind_socket(struct rtipc_private *priv,
 		return -EINVAL;
 
 	RTDM_EXECUTE_ATOMICALLY(
-		if (test_bit(_BUFP_BOUND, &sk->status) ||
-		    __test_and_set_bit(_BUFP_BINDING, &sk->status))
+		if (sk->ring)
+			/* Subscribers have no buffer of their own. */
+			ret = -EISCONN;
+		else if (test_bit(_BUFP_BOUND, &sk->status) ||
+			 __test_and_set_bit(_BUFP_BINDING, &sk->status))
 			ret = -EADDRINUSE;
 	);
 	if (ret)
@@ -822,6 +951,51 @@ set_assoc:
 	return 0;
 }
 
+static int __bufp_subscribe(struct bufp_socket *sk, int port)
+{
+	struct rtdm_dev_context *rcontext;
+	struct bufp_socket *rsk;
+	int ret = 0;
+	void *p;
+
+	if (port == -1)
+		port = sk->peer.sipc_port;
+
+	if (port < 0 || port >= CONFIG_XENO_OPT_BUFP_NRPORT)
+		return -EINVAL;
+
+	p = xnmap_fetch_nocheck(portmap, port);
+	if (p == NULL)
+		return -ECONNREFUSED;
+
+	rcontext = rtdm_context_get(rtipc_map2fd(p));
+	if (rcontext == NULL)
+		return -ECONNREFUSED;
+
+	rsk = rtipc_context_to_state(rcontext);
+
+	RTDM_EXECUTE_ATOMICALLY(
+		if (test_bit(_BUFP_BOUND, &sk->status) ||
+		    test_bit(_BUFP_BINDING, &sk->status) || sk->ring)
+			ret = -EISCONN;
+		else if (!test_bit(_BUFP_BOUND, &rsk->status) ||
+			 rsk->fanout == 0)
+			ret = -ECONNREFUSED;
+		else {
+			/* Start reading from the current write position. */
+			sk->rdoff = rsk->wroff;
+			sk->fillsz = 0;
+			sk->rdtoken++;
+			sk->ring = rsk;
+			list_add_tail(&sk->rnext, &rsk->readers);
+		}
+	);
+
+	rtdm_context_unlock(rcontext);
+
+	return ret;
+}
+
 static int __bufp_setsockopt(struct bufp_socket *sk,
 			     rtdm_user_info_t *user_info,
 			     void *arg)
@@ -829,7 +1003,7 @@ static int __bufp_setsockopt(struct bufp_socket *sk,
 	struct _rtdm_setsockopt_args sopt;
 	struct rtipc_port_label plabel;
 	struct timeval tv;
-	int ret = 0;
+	int ret = 0, val;
 	size_t len;
 
 	if (rtipc_get_arg(user_info, &sopt, arg, sizeof(sopt)))
@@ -889,6 +1063,33 @@ static int __bufp_setsockopt(struct bufp_socket *sk,
 		);
 		break;
 
+	case BUFP_FANOUT:
+		if (sopt.optlen != sizeof(val))
+			return -EINVAL;
+		if (rtipc_get_arg(user_info, &val,
+				  sopt.optval, sizeof(val)))
+			return -EFAULT;
+		if (val != 0 && val != BUFP_FANOUT_BLOCK &&
+		    val != BUFP_FANOUT_DROP)
+			return -EINVAL;
+		RTDM_EXECUTE_ATOMICALLY(
+			if (test_bit(_BUFP_BOUND, &sk->status) ||
+			    test_bit(_BUFP_BINDING, &sk->status))
+				ret = -EALREADY;
+			else
+				sk->fanout = val;
+		);
+		break;
+
+	case BUFP_SUBSCRIBE:
+		if (sopt.optlen != sizeof(val))
+			return -EINVAL;
+		if (rtipc_get_arg(user_info, &val,
+				  sopt.optval, sizeof(val)))
+			return -EFAULT;
+		ret = __bufp_subscribe(sk, val);
+		break;
+
 	case BUFP_LABEL:
 		if (sopt.optlen < sizeof(plabel))
 			return -EINVAL;
@@ -922,6 +1123,7 @@ static int __bufp_getsockopt(struct bufp_socket *sk,
 {
 	struct _rtdm_getsockopt_args sopt;
 	struct rtipc_port_label plabel;
+	unsigned long dropped;
 	struct timeval tv;
 	socklen_t len;
 	int ret = 0;
@@ -976,6 +1178,15 @@ static int __bufp_getsockopt(struct bufp_socket *sk,
 			return -EFAULT;
 		break;
 
+	case BUFP_DROPPED:
+		if (len != sizeof(dropped))
+			return -EINVAL;
+		dropped = sk->dropped;
+		if (rtipc_put_arg(user_info, sopt.optval,
+				  &dropped, sizeof(dropped)))
+			return -EFAULT;
+		break;
+
 	default:
 		ret = -EINVAL;
 	}
@@ -1053,7 +1264,7 @@ static int bufp_ioctl(struct rtipc_private *priv,
 
 static int bufp_init(void)
 {
-	portmap = xnmap_create(CONFIG_XENO_OPT_BUFP_NRPORT, 0, 0);
+	portmap = xnmap_create_growable(CONFIG_XENO_OPT_BUFP_NRPORT, 0, 0);
 	if (portmap == NULL)
 		return -ENOMEM;
 
@@ -32,11 +32,37 @@
 
 #define IDDP_SOCKET_MAGIC 0xa37a37a8
 
+struct iddp_mcast;
+
 struct iddp_message {
 	struct list_head next;
 	int from;
 	size_t rdoff;
 	size_t len;
+	struct iddp_mcast *mcast; /* Shared data if multicast, or NULL. */
+	char data[];
+};
+
+/*
+ * Storage a group may hold in the system heap for datagrams its
+ * members did not read yet. Each pending datagram references the
+ * quota, which may thus outlive the group socket.
+ */
+struct iddp_mcquota {
+	int refs;
+	size_t used;
+	size_t limit;
+};
+
+/*
+ * A multicast datagram is stored once, followed by one message
+ * header per member it was queued to. The storage goes back to the
+ * system heap when the last member is done with the data.
+ */
+struct iddp_mcast {
+	int refs;
+	size_t size;
+	struct iddp_mcquota *quota;
 	char data[];
 };
 
@@ -54,6 +80,7 @@ struct iddp_socket {
 	size_t poolsz;
 	rtdm_sem_t insem;
 	struct list_head inq;
+	struct list_head zcq;	/* Zero-copy buffers held by the user. */
 	u_long status;
 	xnhandle_t handle;
 	char label[XNOBJECT_NAME_LEN];
@@ -61,6 +88,13 @@ struct iddp_socket {
 	nanosecs_rel_t rx_timeout;
 	nanosecs_rel_t tx_timeout;
 	unsigned long stalls;	/* Buffer stall counter. */
+	struct rtipc_pool pool;	/* Memory accounting. */
+
+	struct iddp_socket *group; /* Group joined, if any. */
+	struct list_head gnext;	   /* In the member list of the group. */
+	struct list_head members;  /* Group members, if multicast. */
+	int nmembers;
+	struct iddp_mcquota *mcquota; /* Pending storage, if multicast. */
 
 	struct rtipc_private *priv;
 };
@@ -78,6 +112,8 @@ static int poolwait;
 
 #define _IDDP_BINDING  0
 #define _IDDP_BOUND    1
+#define _IDDP_ZEROCOPY 2
+#define _IDDP_MULTICAST 3
 
 #ifdef CONFIG_XENO_OPT_VFILE
 
@@ -121,9 +157,38 @@ static inline void __iddp_init_mbuf(struct iddp_message *mbuf, size_t len)
 {
 	mbuf->rdoff = 0;
 	mbuf->len = len;
+	mbuf->mcast = NULL;
 	INIT_LIST_HEAD(&mbuf->next);
 }
 
+static inline char *__iddp_mbuf_data(struct iddp_message *mbuf)
+{
+	return mbuf->mcast ? mbuf->mcast->data : mbuf->data;
+}
+
+static int __iddp_wait_buffer(struct iddp_socket *sk,
+			      rtdm_event_t *evt, int *wait,
+			      nanosecs_rel_t timeout,
+			      rtdm_toseq_t *timeout_seq)
+{
+	int ret;
+
+	RTDM_EXECUTE_ATOMICALLY(
+		/*
+		 * membars are implicitly issued when required
+		 * by this construct.
+		 */
+		++sk->stalls;
+		(*wait)++;
+		ret = rtdm_event_timedwait(evt, timeout, timeout_seq);
+		(*wait)--;
+		if (unlikely(ret == -EIDRM))
+			ret = -ECONNRESET;
+	);
+
+	return ret;
+}
+
 static struct iddp_message *
 __iddp_alloc_mbuf(struct iddp_socket *sk, size_t len,
 		  nanosecs_rel_t timeout, int flags, int *pret)
@@ -138,8 +203,10 @@ __iddp_alloc_mbuf(struct iddp_socket *sk, size_t len,
 		mbuf = xnheap_alloc(sk->bufpool, len + sizeof(*mbuf));
 		if (mbuf) {
 			__iddp_init_mbuf(mbuf, len);
+			rtipc_pool_charge(&sk->pool, len + sizeof(*mbuf));
 			break;
 		}
+		rtipc_pool_fail(&sk->pool);
 		if (flags & MSG_DONTWAIT) {
 			ret = -EAGAIN;
 			break;
@@ -151,20 +218,8 @@ __iddp_alloc_mbuf(struct iddp_socket *sk, size_t len,
 		 * memory pressure on the pool, but in this case, the
 		 * pool size should be adjusted.
 		 */
-		RTDM_EXECUTE_ATOMICALLY(
-			/*
-			 * membars are implicitly issued when required
-			 * by this construct.
-			 */
-			++sk->stalls;
-			(*sk->poolwait)++;
-			ret = rtdm_event_timedwait(sk->poolevt,
-						   timeout,
-						   &timeout_seq);
-			(*sk->poolwait)--;
-			if (unlikely(ret == -EIDRM))
-				ret = -ECONNRESET;
-		);
+		ret = __iddp_wait_buffer(sk, sk->poolevt, sk->poolwait,
+					 timeout, &timeout_seq);
 		if (ret)
 			break;
 	}
@@ -177,6 +232,7 @@ __iddp_alloc_mbuf(struct iddp_socket *sk, size_t len,
 static void __iddp_free_mbuf(struct iddp_socket *sk,
 			     struct iddp_message *mbuf)
 {
+	rtipc_pool_credit(&sk->pool, mbuf->len + sizeof(*mbuf));
 	xnheap_free(sk->bufpool, mbuf);
 	RTDM_EXECUTE_ATOMICALLY(
 		/* Wake up sleepers if any. */
@@ -185,12 +241,139 @@ static void __iddp_free_mbuf(struct iddp_socket *sk,
 	);
 }
 
+static void __iddp_put_quota(struct iddp_mcquota *quota, size_t size)
+{
+	int refs;
+
+	RTDM_EXECUTE_ATOMICALLY(
+		quota->used -= size;
+		refs = --quota->refs;
+	);
+	if (refs == 0)
+		xnfree(quota);
+}
+
+/*
+ * Multicast datagrams are always drawn from the system heap, since
+ * members may still hold them after the group socket is gone. The
+ * group quota bounds what slow members may keep pending there.
+ */
+static struct iddp_mcast *
+__iddp_alloc_mcast(struct iddp_socket *gsk, size_t len, int nr,
+		   nanosecs_rel_t timeout, int flags, int *pret)
+{
+	struct iddp_mcquota *quota = gsk->mcquota;
+	struct iddp_message *mbuf;
+	rtdm_toseq_t timeout_seq;
+	struct iddp_mcast *mc;
+	size_t size;
+	int ret = 0;
+
+	size = sizeof(*mc) + ALIGN(len, __alignof__(*mbuf)) +
+		nr * sizeof(*mbuf);
+
+	RTDM_EXECUTE_ATOMICALLY(
+		if (quota->used + size > quota->limit)
+			ret = -ENOBUFS;
+		else {
+			quota->used += size;
+			quota->refs++;
+		}
+	);
+	if (ret) {
+		*pret = ret;
+		return NULL;
+	}
+
+	rtdm_toseq_init(&timeout_seq, timeout);
+
+	for (;;) {
+		mc = xnheap_alloc(&kheap, size);
+		if (mc)
+			break;
+		if (flags & MSG_DONTWAIT) {
+			ret = -EAGAIN;
+			break;
+		}
+		ret = __iddp_wait_buffer(gsk, &poolevt, &poolwait,
+					 timeout, &timeout_seq);
+		if (ret)
+			break;
+	}
+
+	if (mc) {
+		mc->size = size;
+		mc->quota = quota;
+	} else
+		__iddp_put_quota(quota, size);
+
+	*pret = ret;
+
+	return mc;
+}
+
+static inline struct iddp_message *
+__iddp_mcast_link(struct iddp_mcast *mc, size_t len, int n)
+{
+	struct iddp_message *mbuf;
+
+	mbuf = (struct iddp_message *)
+		(mc->data + ALIGN(len, __alignof__(*mbuf)));
+
+	return mbuf + n;
+}
+
+static void __iddp_put_mcast(struct iddp_mcast *mc, int nr)
+{
+	int refs;
+
+	RTDM_EXECUTE_ATOMICALLY(
+		refs = mc->refs -= nr;
+	);
+	if (refs > 0)
+		return;
+
+	__iddp_put_quota(mc->quota, mc->size);
+	xnheap_free(&kheap, mc);
+	RTDM_EXECUTE_ATOMICALLY(
+		if (poolwait > 0)
+			rtdm_event_pulse(&poolevt);
+	);
+}
+
+static void __iddp_put_mbuf(struct iddp_socket *sk,
+			    struct iddp_message *mbuf)
+{
+	if (mbuf->mcast)
+		__iddp_put_mcast(mbuf->mcast, 1);
+	else
+		__iddp_free_mbuf(sk, mbuf);
+}
+
 static void __iddp_flush_pool(struct xnheap *heap,
 			      void *poolmem, u_long poolsz, void *cookie)
 {
 	xnarch_free_host_mem(poolmem, poolsz);
 }
 
+static void __iddp_pool_grown(struct rtipc_pool *pool)
+{
+	struct iddp_socket *sk = container_of(pool, struct iddp_socket, pool);
+
+	RTDM_EXECUTE_ATOMICALLY(
+		if (*sk->poolwait > 0)
+			rtdm_event_pulse(sk->poolevt);
+	);
+}
+
+static void __iddp_release_pool(struct xnheap *heap)
+{
+	struct iddp_socket *sk;
+
+	sk = container_of(heap, struct iddp_socket, privpool);
+	kfree(sk);
+}
+
 static int iddp_socket(struct rtipc_private *priv,
 		       rtdm_user_info_t *user_info)
 {
@@ -210,22 +393,125 @@ static int iddp_socket(struct rtipc_private *priv,
 	sk->stalls = 0;
 	*sk->label = 0;
 	INIT_LIST_HEAD(&sk->inq);
+	INIT_LIST_HEAD(&sk->zcq);
+	INIT_LIST_HEAD(&sk->members);
+	sk->nmembers = 0;
+	sk->mcquota = NULL;
+	sk->group = NULL;
 	rtdm_sem_init(&sk->insem, 0);
 	rtdm_event_init(&sk->privevt, 0);
+	rtipc_pool_init(&sk->pool, "iddp", &sk->name);
+	sk->pool.grown = __iddp_pool_grown;
 	sk->priv = priv;
 
 	return 0;
 }
 
+static void __iddp_leave_group(struct iddp_socket *sk)
+{
+	RTDM_EXECUTE_ATOMICALLY(
+		if (sk->group) {
+			list_del(&sk->gnext);
+			sk->group->nmembers--;
+			sk->group = NULL;
+		}
+	);
+}
+
+static void __iddp_detach_members(struct iddp_socket *gsk)
+{
+	struct iddp_socket *sk, *tmp;
+
+	/* Members keep the datagrams already queued to them. */
+	RTDM_EXECUTE_ATOMICALLY(
+		list_for_each_entry_safe(sk, tmp, &gsk->members, gnext) {
+			list_del(&sk->gnext);
+			sk->group = NULL;
+		}
+		gsk->nmembers = 0;
+	);
+}
+
+static int __iddp_join_group(struct iddp_socket *sk, int port)
+{
+	struct rtdm_dev_context *gcontext;
+	struct iddp_socket *gsk;
+	int ret = 0;
+	void *p;
+
+	if (port < 0) {
+		__iddp_leave_group(sk);
+		return 0;
+	}
+
+	if (port >= CONFIG_XENO_OPT_IDDP_NRPORT)
+		return -EINVAL;
+
+	/*
+	 * Multicast datagrams live in the system heap, zero-copy
+	 * receivers could not map them.
+	 */
+	if (!test_bit(_IDDP_BOUND, &sk->status) ||
+	    test_bit(_IDDP_ZEROCOPY, &sk->status) ||
+	    test_bit(_IDDP_MULTICAST, &sk->status))
+		return -EINVAL;
+
+	p = xnmap_fetch_nocheck(portmap, port);
+	if (p == NULL)
+		return -ECONNREFUSED;
+
+	gcontext = rtdm_context_get(rtipc_map2fd(p));
+	if (gcontext == NULL)
+		return -ECONNREFUSED;
+
+	gsk = rtipc_context_to_state(gcontext);
+
+	RTDM_EXECUTE_ATOMICALLY(
+		if (!test_bit(_IDDP_MULTICAST, &gsk->status) ||
+		    !test_bit(_IDDP_BOUND, &gsk->status))
+			ret = -ECONNREFUSED;
+		else if (sk->group)
+			ret = -EISCONN;
+		else {
+			list_add_tail(&sk->gnext, &gsk->members);
+			gsk->nmembers++;
+			sk->group = gsk;
+		}
+	);
+
+	rtdm_context_unlock(gcontext);
+
+	return ret;
+}
+
 static int iddp_close(struct rtipc_private *priv,
 		      rtdm_user_info_t *user_info)
 {
 	struct iddp_socket *sk = priv->state;
-	struct iddp_message *mbuf;
+	struct iddp_message *mbuf, *tmp;
 
 	if (sk->name.sipc_port > -1)
 		xnmap_remove(portmap, sk->name.sipc_port);
 
+	if (test_bit(_IDDP_MULTICAST, &sk->status)) {
+		__iddp_detach_members(sk);
+		if (sk->mcquota)
+			__iddp_put_quota(sk->mcquota, 0);
+	} else
+		__iddp_leave_group(sk);
+
+	/*
+	 * Drop our references to multicast datagrams, which the pool
+	 * flush below would not release.
+	 */
+	list_for_each_entry_safe(mbuf, tmp, &sk->inq, next) {
+		if (mbuf->mcast) {
+			list_del(&mbuf->next);
+			__iddp_put_mcast(mbuf->mcast, 1);
+		}
+	}
+
+	rtipc_pool_cleanup(&sk->pool);
 	rtdm_sem_destroy(&sk->insem);
 	rtdm_event_destroy(&sk->privevt);
 
@@ -233,7 +519,15 @@ static int iddp_close(struct rtipc_private *priv,
 		xnregistry_remove(sk->handle);
 
 	if (sk->bufpool != &kheap) {
-		xnheap_destroy(&sk->privpool, __iddp_flush_pool, NULL);
+		if (test_bit(_IDDP_ZEROCOPY, &sk->status))
+			/*
+			 * The pool may still be mapped, in which case
+			 * the socket is released with the last mapping.
+			 */
+			xnheap_destroy_mapped(&sk->privpool,
+					      __iddp_release_pool, NULL);
+		else
+			xnheap_destroy(&sk->privpool, __iddp_flush_pool, NULL);
 		return 0;
 	}
 
@@ -249,6 +543,110 @@ static int iddp_close(struct rtipc_private *priv,
 	return 0;
 }
 
+static ssize_t __iddp_recvmsg_zc(struct iddp_socket *sk,
+				 rtdm_user_info_t *user_info,
+				 struct iovec *iov, int flags,
+				 struct sockaddr_ipc *saddr)
+{
+	struct rtipc_zcbuf zcbuf;
+	struct iddp_message *mbuf;
+	nanosecs_rel_t timeout;
+	struct xnbufd bufd;
+	int ret;
+
+	/* The buffer descriptor goes to the first vector cell. */
+	if (iov[0].iov_len < sizeof(zcbuf))
+		return -EINVAL;
+
+	timeout = (flags & MSG_DONTWAIT) ? RTDM_TIMEOUT_NONE : sk->rx_timeout;
+	ret = rtdm_sem_timeddown(&sk->insem, timeout, NULL);
+	if (unlikely(ret)) {
+		if (ret == -EIDRM)
+			return -ECONNRESET;
+		return ret;
+	}
+
+	RTDM_EXECUTE_ATOMICALLY(
+		/*
+		 * Hand over the heading message as a whole, it stays
+		 * on the zero-copy queue until the user releases it.
+		 */
+		mbuf = list_entry(sk->inq.next, struct iddp_message, next);
+		list_move_tail(&mbuf->next, &sk->zcq);
+		if (saddr) {
+			saddr->sipc_family = AF_RTIPC;
+			saddr->sipc_port = mbuf->from;
+		}
+	);
+
+	zcbuf.offset = xnheap_mapped_offset(sk->bufpool, mbuf->data);
+	zcbuf.len = mbuf->len;
+
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+	if (user_info) {
+		xnbufd_map_uread(&bufd, iov[0].iov_base, sizeof(zcbuf));
+		ret = xnbufd_copy_from_kmem(&bufd, &zcbuf, sizeof(zcbuf));
+		xnbufd_unmap_uread(&bufd);
+	} else
+#endif
+	{
+		xnbufd_map_kread(&bufd, iov[0].iov_base, sizeof(zcbuf));
+		ret = xnbufd_copy_from_kmem(&bufd, &zcbuf, sizeof(zcbuf));
+		xnbufd_unmap_kread(&bufd);
+	}
+	if (ret < 0) {
+		/* The user will never know about this buffer, drop it. */
+		RTDM_EXECUTE_ATOMICALLY(
+			list_del(&mbuf->next);
+		);
+		__iddp_free_mbuf(sk, mbuf);
+		return ret;
+	}
+
+	iov[0].iov_base += sizeof(zcbuf);
+	iov[0].iov_len -= sizeof(zcbuf);
+
+	return zcbuf.len;
+}
+
+static int __iddp_release_zcbuf(struct iddp_socket *sk,
+				rtdm_user_info_t *user_info,
+				void *arg)
+{
+	struct iddp_message *mbuf, *pos;
+	struct rtipc_zcbuf zcbuf;
+
+	if (rtipc_get_arg(user_info, &zcbuf, arg, sizeof(zcbuf)))
+		return -EFAULT;
+
+	if (!test_bit(_IDDP_ZEROCOPY, &sk->status) ||
+	    !test_bit(_IDDP_BOUND, &sk->status))
+		return -EINVAL;
+
+	/*
+	 * Never trust the user-provided offset, only release buffers
+	 * we handed out previously.
+	 */
+	RTDM_EXECUTE_ATOMICALLY(
+		mbuf = NULL;
+		list_for_each_entry(pos, &sk->zcq, next) {
+			if ((unsigned long)
+			    xnheap_mapped_offset(sk->bufpool, pos->data) ==
+			    zcbuf.offset) {
+				list_del(&pos->next);
+				mbuf = pos;
+				break;
+			}
+		}
+	);
+	if (mbuf == NULL)
+		return -EINVAL;
+
+	__iddp_free_mbuf(sk, mbuf);
+
+	return 0;
+}
+
 static ssize_t __iddp_recvmsg(struct rtipc_private *priv,
 			      rtdm_user_info_t *user_info,
 			      struct iovec *iov, int iovlen, int flags,
@@ -260,10 +658,20 @@ static ssize_t __iddp_recvmsg(struct rtipc_private *priv,
 	struct iddp_message *mbuf;
 	nanosecs_rel_t timeout;
 	struct xnbufd bufd;
+	char *data;
 
 	if (!test_bit(_IDDP_BOUND, &sk->status))
 		return -EAGAIN;
 
+	/* Group sockets only relay datagrams to their members. */
+	if (test_bit(_IDDP_MULTICAST, &sk->status))
+		return -EOPNOTSUPP;
+
+	if (test_bit(_IDDP_ZEROCOPY, &sk->status))
+		return iovlen > 0 ?
+			__iddp_recvmsg_zc(sk, user_info, iov, flags, saddr) :
+			-EINVAL;
+
 	maxlen = rtipc_get_iov_flatlen(iov, iovlen);
 	if (maxlen == 0)
 		return 0;
@@ -282,6 +690,7 @@ static ssize_t __iddp_recvmsg(struct rtipc_private *priv,
 		mbuf = list_entry(sk->inq.next, struct iddp_message, next);
 		rdoff = mbuf->rdoff;
 		len = mbuf->len - rdoff;
+		data = __iddp_mbuf_data(mbuf);
 		if (saddr) {
 			saddr->sipc_family = AF_RTIPC;
 			saddr->sipc_port = mbuf->from;
@@ -306,13 +715,13 @@ static ssize_t __iddp_recvmsg(struct rtipc_private *priv,
 #ifdef CONFIG_XENO_OPT_PERVASIVE
 		if (user_info) {
 			xnbufd_map_uread(&bufd, iov[nvec].iov_base, vlen);
-			ret = xnbufd_copy_from_kmem(&bufd, mbuf->data + rdoff, vlen);
+			ret = xnbufd_copy_from_kmem(&bufd, data + rdoff, vlen);
 			xnbufd_unmap_uread(&bufd);
 		} else
 #endif
 		{
 			xnbufd_map_kread(&bufd, iov[nvec].iov_base, vlen);
-			ret = xnbufd_copy_from_kmem(&bufd, mbuf->data + rdoff, vlen);
+			ret = xnbufd_copy_from_kmem(&bufd, data + rdoff, vlen);
 			xnbufd_unmap_kread(&bufd);
 		}
 		if (ret < 0)
@@ -324,7 +733,7 @@ static ssize_t __iddp_recvmsg(struct rtipc_private *priv,
 	}
 
 	if (dofree)
-		__iddp_free_mbuf(sk, mbuf);
+		__iddp_put_mbuf(sk, mbuf);
 
 	return ret ?: len;
 }
@@ -383,6 +792,102 @@ static ssize_t iddp_read(struct rtipc_private *priv,
 	return __iddp_recvmsg(priv, user_info, &iov, 1, 0, NULL);
 }
 
+static int __iddp_copy_iov(rtdm_user_info_t *user_info, char *dst,
+			   struct iovec *iov, int iovlen, ssize_t len)
+{
+	ssize_t rdlen, vlen;
+	int nvec, wroff, ret = 0;
+	struct xnbufd bufd;
+
+	/* Move "len" bytes to dst from the vector cells */
+	for (nvec = 0, rdlen = len, wroff = 0;
+	     nvec < iovlen && rdlen > 0; nvec++) {
+		if (iov[nvec].iov_len == 0)
+			continue;
+		vlen = rdlen >= iov[nvec].iov_len ? iov[nvec].iov_len : rdlen;
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+		if (user_info) {
+			xnbufd_map_uread(&bufd, iov[nvec].iov_base, vlen);
+			ret = xnbufd_copy_to_kmem(dst + wroff, &bufd, vlen);
+			xnbufd_unmap_uread(&bufd);
+		} else
+#endif
+		{
+			xnbufd_map_kread(&bufd, iov[nvec].iov_base, vlen);
+			ret = xnbufd_copy_to_kmem(dst + wroff, &bufd, vlen);
+			xnbufd_unmap_kread(&bufd);
+		}
+		if (ret < 0)
+			return ret;
+		iov[nvec].iov_base += vlen;
+		iov[nvec].iov_len -= vlen;
+		rdlen -= vlen;
+		wroff += vlen;
+	}
+
+	return 0;
+}
+
+/*
+ * Send to a group socket: the data is copied once, then a message
+ * header referring to it is queued to every member.
+ */
+static ssize_t __iddp_sendmsg_mcast(struct iddp_socket *sk,
+				    struct iddp_socket *gsk,
+				    rtdm_user_info_t *user_info,
+				    struct iovec *iov, int iovlen,
+				    ssize_t len, int flags)
+{
+	struct iddp_message *mbuf;
+	struct iddp_socket *msk;
+	struct iddp_mcast *mc;
+	int nr, n, ret;
+
+	RTDM_EXECUTE_ATOMICALLY(
+		nr = gsk->nmembers;
+	);
+	/* Like any datagram nobody listens to, drop it silently. */
+	if (nr == 0)
+		return len;
+
+	mc = __iddp_alloc_mcast(gsk, len, nr, sk->tx_timeout, flags, &ret);
+	if (unlikely(ret))
+		return ret;
+
+	ret = __iddp_copy_iov(user_info, mc->data, iov, iovlen, len);
+	if (ret < 0) {
+		__iddp_put_mcast(mc, 0);
+		return ret;
+	}
+
+	/*
+	 * Members which joined in the meantime will only get the next
+	 * datagrams.
+	 */
+	n = 0;
+	RTDM_EXECUTE_ATOMICALLY(
+		list_for_each_entry(msk, &gsk->members, gnext) {
+			if (n >= nr)
+				break;
+			mbuf = __iddp_mcast_link(mc, len, n++);
+			__iddp_init_mbuf(mbuf, len);
+			mbuf->mcast = mc;
+			mbuf->from = sk->name.sipc_port;
+			if (flags & MSG_OOB)
+				list_add(&mbuf->next, &msk->inq);
+			else
+				list_add_tail(&mbuf->next, &msk->inq);
+			rtdm_sem_up(&msk->insem);
+		}
+		mc->refs = n;
+	);
+
+	if (n == 0)
+		__iddp_put_mcast(mc, 0);
+
+	return len;
+}
+
 static ssize_t __iddp_sendmsg(struct rtipc_private *priv,
 			      rtdm_user_info_t *user_info,
 			      struct iovec *iov, int iovlen, int flags,
@@ -391,9 +896,8 @@ static ssize_t __iddp_sendmsg(struct rtipc_private *priv,
 	struct iddp_socket *sk = priv->state, *rsk;
 	struct rtdm_dev_context *rcontext;
 	struct iddp_message *mbuf;
-	ssize_t len, rdlen, vlen;
-	int nvec, wroff, ret;
-	struct xnbufd bufd;
+	ssize_t len;
+	int ret;
 	void *p;
 
 	len = rtipc_get_iov_flatlen(iov, iovlen);
@@ -414,38 +918,23 @@ static ssize_t __iddp_sendmsg(struct rtipc_private *priv,
 		return -ECONNREFUSED;
 	}
 
-	mbuf = __iddp_alloc_mbuf(rsk, len, flags, sk->tx_timeout, &ret);
-	if (unlikely(ret)) {
+	if (test_bit(_IDDP_MULTICAST, &rsk->status)) {
+		ret = __iddp_sendmsg_mcast(sk, rsk, user_info,
+					   iov, iovlen, len, flags);
 		rtdm_context_unlock(rcontext);
 		return ret;
 	}
 
-	/* Now, move "len" bytes to mbuf->data from the vector cells */
-	for (nvec = 0, rdlen = len, wroff = 0;
-	     nvec < iovlen && rdlen > 0; nvec++) {
-		if (iov[nvec].iov_len == 0)
-			continue;
-		vlen = rdlen >= iov[nvec].iov_len ? iov[nvec].iov_len : rdlen;
-#ifdef CONFIG_XENO_OPT_PERVASIVE
-		if (user_info) {
-			xnbufd_map_uread(&bufd, iov[nvec].iov_base, vlen);
-			ret = xnbufd_copy_to_kmem(mbuf->data + wroff, &bufd, vlen);
-			xnbufd_unmap_uread(&bufd);
-		} else
-#endif
-		{
-			xnbufd_map_kread(&bufd, iov[nvec].iov_base, vlen);
-			ret = xnbufd_copy_to_kmem(mbuf->data + wroff, &bufd, vlen);
-			xnbufd_unmap_kread(&bufd);
-		}
-		if (ret < 0)
-			goto fail;
-		iov[nvec].iov_base += vlen;
-		iov[nvec].iov_len -= vlen;
-		rdlen -= vlen;
-		wroff += vlen;
+	mbuf = __iddp_alloc_mbuf(rsk, len, sk->tx_timeout, flags, &ret);
+	if (unlikely(ret)) {
+		rtdm_context_unlock(rcontext);
+		return ret;
 	}
 
+	ret = __iddp_copy_iov(user_info, mbuf->data, iov, iovlen, len);
+	if (ret < 0)
+		goto fail;
+
 	RTDM_EXECUTE_ATOMICALLY(
 		mbuf->from = sk->name.sipc_port;
 		if (flags & MSG_OOB)
@@ -548,6 +1037,11 @@ static int __iddp_bind_socket(struct rtipc_private *priv,
 	    sa->sipc_port >= CONFIG_XENO_OPT_IDDP_NRPORT)
 		return -EINVAL;
 
+	/* Group sockets hold no datagram, thus need no local pool. */
+	if (test_bit(_IDDP_MULTICAST, &sk->status) &&
+	    test_bit(_IDDP_ZEROCOPY, &sk->status))
+		return -EINVAL;
+
 	RTDM_EXECUTE_ATOMICALLY(
 		if (test_bit(_IDDP_BOUND, &sk->status) ||
 		    __test_and_set_bit(_IDDP_BINDING, &sk->status))
@@ -570,7 +1064,37 @@ static int __iddp_bind_socket(struct rtipc_private *priv,
 	 * setsockopt() before we got there.
 	 */
 	poolsz = sk->poolsz;
-	if (poolsz > 0) {
+	if (test_bit(_IDDP_MULTICAST, &sk->status)) {
+		/* The pool size is the quota of the group instead. */
+		sk->mcquota = xnmalloc(sizeof(*sk->mcquota));
+		if (sk->mcquota == NULL) {
+			ret = -ENOMEM;
+			goto fail;
+		}
+		sk->mcquota->refs = 1;
+		sk->mcquota->used = 0;
+		sk->mcquota->limit = poolsz ?:
+			CONFIG_XENO_OPT_IDDP_MCAST_QUOTA * 1024;
+		poolsz = 0;
+	} else if (test_bit(_IDDP_ZEROCOPY, &sk->status)) {
+		/*
+		 * Zero-copy mode requires a local pool user-space
+		 * can map.
+		 */
+		if (poolsz == 0) {
+			ret = -EINVAL;
+			goto fail;
+		}
+		poolsz = xnheap_rounded_size(poolsz, PAGE_SIZE);
+		ret = xnheap_init_mapped(&sk->privpool, poolsz, 0);
+		if (ret)
+			goto fail;
+		xnheap_set_label(&sk->privpool, "ippd: %d", port);
+
+		sk->poolevt = &sk->privevt;
+		sk->poolwait = &sk->privwait;
+		sk->bufpool = &sk->privpool;
+	} else if (poolsz > 0) {
 		poolsz = xnheap_rounded_size(poolsz, XNHEAP_PAGE_SIZE);
 		poolmem = xnarch_alloc_host_mem(poolsz);
 		if (poolmem == NULL) {
@@ -579,7 +1103,7 @@ static int __iddp_bind_socket(struct rtipc_private *priv,
 		}
 
 		ret = xnheap_init(&sk->privpool,
-				  poolmem, poolsz, XNHEAP_PAGE_SIZE);
+				  poolmem, poolsz, XNHEAP_PAGE_SIZE, 0);
 		if (ret) {
 			xnarch_free_host_mem(poolmem, poolsz);
 			goto fail;
@@ -600,14 +1124,26 @@ static int __iddp_bind_socket(struct rtipc_private *priv,
 		ret = xnregistry_enter(sk->label, sk,
 				       &sk->handle, &__iddp_pnode.node);
 		if (ret) {
-			if (poolsz > 0)
+			if (test_bit(_IDDP_ZEROCOPY, &sk->status))
+				xnheap_destroy_mapped(&sk->privpool,
+						      NULL, NULL);
+			else if (poolsz > 0)
 				xnheap_destroy(&sk->privpool,
 					       __iddp_flush_pool, NULL);
+			if (sk->mcquota) {
+				xnfree(sk->mcquota);
+				sk->mcquota = NULL;
+			}
 			goto fail;
 		}
 	}
 
 	RTDM_EXECUTE_ATOMICALLY(
+		/* Only private pools Linux alone maps may grow. */
+		sk->pool.heap = sk->bufpool;
+		if (sk->bufpool == &kheap ||
+		    test_bit(_IDDP_ZEROCOPY, &sk->status))
+			sk->pool.maxsz = 0;
 		__clear_bit(_IDDP_BINDING, &sk->status);
 		__set_bit(_IDDP_BOUND, &sk->status);
 	);
@@ -692,7 +1228,7 @@ static int __iddp_setsockopt(struct iddp_socket *sk,
 	struct _rtdm_setsockopt_args sopt;
 	struct rtipc_port_label plabel;
 	struct timeval tv;
-	int ret = 0;
+	int ret = 0, val;
 	size_t len;
 
 	if (rtipc_get_arg(user_info, &sopt, arg, sizeof(sopt)))
@@ -752,6 +1288,21 @@ static int __iddp_setsockopt(struct iddp_socket *sk,
 		);
 		break;
 
+	case IDDP_POOLMAX:
+		if (sopt.optlen != sizeof(len))
+			return -EINVAL;
+		if (rtipc_get_arg(user_info, &len,
+				  sopt.optval, sizeof(len)))
+			return -EFAULT;
+		RTDM_EXECUTE_ATOMICALLY(
+			if (test_bit(_IDDP_BOUND, &sk->status) ||
+			    test_bit(_IDDP_BINDING, &sk->status))
+				ret = -EALREADY;
+			else
+				sk->pool.maxsz = len;
+		);
+		break;
+
 	case IDDP_LABEL:
 		if (sopt.optlen < sizeof(plabel))
 			return -EINVAL;
@@ -772,6 +1323,50 @@ static int __iddp_setsockopt(struct iddp_socket *sk,
 		);
 		break;
 
+	case IDDP_ZEROCOPY:
+		if (sopt.optlen != sizeof(val))
+			return -EINVAL;
+		if (rtipc_get_arg(user_info, &val,
+				  sopt.optval, sizeof(val)))
+			return -EFAULT;
+		RTDM_EXECUTE_ATOMICALLY(
+			/* The pool type is decided at binding time. */
+			if (test_bit(_IDDP_BOUND, &sk->status) ||
+			    test_bit(_IDDP_BINDING, &sk->status))
+				ret = -EALREADY;
+			else if (val)
+				__set_bit(_IDDP_ZEROCOPY, &sk->status);
+			else
+				__clear_bit(_IDDP_ZEROCOPY, &sk->status);
+		);
+		break;
+
+	case IDDP_MULTICAST:
+		if (sopt.optlen != sizeof(val))
+			return -EINVAL;
+		if (rtipc_get_arg(user_info, &val,
+				  sopt.optval, sizeof(val)))
+			return -EFAULT;
+		RTDM_EXECUTE_ATOMICALLY(
+			if (test_bit(_IDDP_BOUND, &sk->status) ||
+			    test_bit(_IDDP_BINDING, &sk->status))
+				ret = -EALREADY;
+			else if (val)
+				__set_bit(_IDDP_MULTICAST, &sk->status);
+			else
+				__clear_bit(_IDDP_MULTICAST, &sk->status);
+		);
+		break;
+
+	case IDDP_JOIN:
+		if (sopt.optlen != sizeof(val))
+			return -EINVAL;
+		if (rtipc_get_arg(user_info, &val,
+				  sopt.optval, sizeof(val)))
+			return -EFAULT;
+		ret = __iddp_join_group(sk, val);
+		break;
+
 	default:
 		ret = -EINVAL;
 	}
@@ -785,9 +1380,11 @@ static int __iddp_getsockopt(struct iddp_socket *sk,
 {
 	struct _rtdm_getsockopt_args sopt;
 	struct rtipc_port_label plabel;
+	struct rtipc_pool_stats stats;
+	struct rtipc_pool_info pinfo;
 	struct timeval tv;
 	socklen_t len;
-	int ret = 0;
+	int ret = 0, val;
 
 	if (rtipc_get_arg(user_info, &sopt, arg, sizeof(sopt)))
 		return -EFAULT;
@@ -839,6 +1436,40 @@ static int __iddp_getsockopt(struct iddp_socket *sk,
 			return -EFAULT;
 		break;
 
+	case IDDP_ZEROCOPY:
+		if (len != sizeof(pinfo))
+			return -EINVAL;
+		if (!test_bit(_IDDP_ZEROCOPY, &sk->status) ||
+		    !test_bit(_IDDP_BOUND, &sk->status))
+			return -EINVAL;
+		pinfo.handle = (unsigned long)&sk->privpool;
+		pinfo.size = xnheap_extentsize(&sk->privpool);
+		pinfo.area = xnheap_base_memory(&sk->privpool);
+		if (rtipc_put_arg(user_info, sopt.optval,
+				  &pinfo, sizeof(pinfo)))
+			return -EFAULT;
+		break;
+
+	case IDDP_POOLSTAT:
+		if (len != sizeof(stats))
+			return -EINVAL;
+		rtipc_pool_get_stats(&sk->pool, &stats);
+		if (rtipc_put_arg(user_info, sopt.optval,
+				  &stats, sizeof(stats)))
+			return -EFAULT;
+		break;
+
+	case IDDP_JOIN:
+		if (len != sizeof(val))
+			return -EINVAL;
+		RTDM_EXECUTE_ATOMICALLY(
+			val = sk->group ? sk->group->name.sipc_port : -1;
+		);
+		if (rtipc_put_arg(user_info, sopt.optval,
+				  &val, sizeof(val)))
+			return -EFAULT;
+		break;
+
 	default:
 		ret = -EINVAL;
 	}
@@ -888,6 +1519,10 @@ static int __iddp_ioctl(struct rtipc_private *priv,
 		ret = __iddp_getsockopt(sk, user_info, arg);
 		break;
 
+	case IDDP_RTIOC_RELEASE:
+		ret = __iddp_release_zcbuf(sk, user_info, arg);
+		break;
+
 	case _RTIOC_LISTEN:
 	case _RTIOC_ACCEPT:
 		ret = -EOPNOTSUPP;
@@ -916,7 +1551,7 @@ static int iddp_ioctl(struct rtipc_private *priv,
 
 static int iddp_init(void)
 {
-	portmap = xnmap_create(CONFIG_XENO_OPT_IDDP_NRPORT, 0, 0);
+	portmap = xnmap_create_growable(CONFIG_XENO_OPT_IDDP_NRPORT, 0, 0);
 	if (portmap == NULL)
 		return -ENOMEM;
 
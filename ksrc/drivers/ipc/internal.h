@@ -21,7 +21,9 @@
 #ifndef _RTIPC_INTERNAL_H
 #define _RTIPC_INTERNAL_H
 
+#include <linux/list.h>
 #include <nucleus/registry.h>
+#include <nucleus/heap.h>
 #include <rtdm/rtdm.h>
 #include <rtdm/rtdm_driver.h>
 
@@ -110,6 +112,92 @@ int rtipc_put_sockaddr(rtdm_user_info_t *user_info, void *arg,
 
 ssize_t rtipc_get_iov_flatlen(struct iovec *iov, int iovlen);
 
+/*
+ * Memory accounting of a socket wrt the pool it draws its buffers
+ * from, either the system heap or a local pool. Local pools may be
+ * elastic, in which case they are extended by a Linux worker before
+ * they run dry, up to a configured limit.
+ */
+struct rtipc_pool {
+	struct xnheap *heap;	/* Pool the socket draws from. */
+	size_t used;		/* Bytes held on behalf of the socket. */
+	size_t peak;		/* High watermark of the above. */
+	unsigned long failures;	/* Failed allocations. */
+	size_t maxsz;		/* Growth limit, zero if fixed. */
+	int refill;		/* Extension pending. */
+	const char *proto;
+	const struct sockaddr_ipc *name;
+	void (*grown)(struct rtipc_pool *pool);
+	struct list_head next;	/* In the pool list. */
+	struct list_head rnext;	/* In the refill queue. */
+};
+
+void rtipc_pool_init(struct rtipc_pool *pool, const char *proto,
+		     const struct sockaddr_ipc *name);
+
+void rtipc_pool_cleanup(struct rtipc_pool *pool);
+
+void rtipc_pool_get_stats(struct rtipc_pool *pool,
+			  struct rtipc_pool_stats *stats);
+
+void __rtipc_pool_refill(struct rtipc_pool *pool); /* nklock held */
+
+static inline size_t rtipc_pool_size(struct rtipc_pool *pool)
+{
+	return xnheap_extentsize(pool->heap) * countq(&pool->heap->extents);
+}
+
+/* Whether an elastic pool should be extended, nklock held. */
+static inline int __rtipc_pool_low_p(struct rtipc_pool *pool)
+{
+	size_t size;
+
+	if (pool->maxsz == 0 || pool->refill)
+		return 0;
+
+	size = rtipc_pool_size(pool);
+	if (size + xnheap_extentsize(pool->heap) > pool->maxsz)
+		return 0;
+
+	/* Refill as less than a quarter of an extent remains free. */
+	return xnheap_used_mem(pool->heap) +
+		xnheap_extentsize(pool->heap) / 4 > size;
+}
+
+static inline void rtipc_pool_charge(struct rtipc_pool *pool, size_t size)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	pool->used += size;
+	if (pool->used > pool->peak)
+		pool->peak = pool->used;
+	if (__rtipc_pool_low_p(pool))
+		__rtipc_pool_refill(pool);
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+static inline void rtipc_pool_credit(struct rtipc_pool *pool, size_t size)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	pool->used -= size;
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+static inline void rtipc_pool_fail(struct rtipc_pool *pool)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	pool->failures++;
+	if (pool->maxsz && !pool->refill &&
+	    rtipc_pool_size(pool) + xnheap_extentsize(pool->heap) <= pool->maxsz)
+		__rtipc_pool_refill(pool);
+	xnlock_put_irqrestore(&nklock, s);
+}
+
 extern struct rtipc_protocol xddp_proto_driver;
 
 extern struct rtipc_protocol iddp_proto_driver;
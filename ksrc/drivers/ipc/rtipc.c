@@ -20,6 +20,8 @@
 
 #include <linux/module.h>
 #include <linux/init.h>
+#include <linux/workqueue.h>
+#include <nucleus/vfile.h>
 #include <rtdm/rtipc.h>
 #include "internal.h"
 
@@ -131,6 +133,178 @@ ssize_t rtipc_get_iov_flatlen(struct iovec *iov, int iovlen)
 	return len;
 }
 
+/* Protects the pool list, and pools against concurrent refills. */
+static DEFINE_BINARY_SEMAPHORE(pool_sem);
+
+static LIST_HEAD(pool_list);
+
+static LIST_HEAD(refill_queue);	/* nklock protected. */
+
+static rtdm_nrtsig_t refill_nrtsig;
+
+void rtipc_pool_init(struct rtipc_pool *pool, const char *proto,
+		     const struct sockaddr_ipc *name)
+{
+	pool->heap = &kheap;
+	pool->used = 0;
+	pool->peak = 0;
+	pool->failures = 0;
+	pool->maxsz = 0;
+	pool->refill = 0;
+	pool->proto = proto;
+	pool->name = name;
+	pool->grown = NULL;
+	INIT_LIST_HEAD(&pool->rnext);
+
+	down(&pool_sem);
+	list_add_tail(&pool->next, &pool_list);
+	up(&pool_sem);
+}
+
+/* Must be called before the local pool is destroyed. */
+void rtipc_pool_cleanup(struct rtipc_pool *pool)
+{
+	spl_t s;
+
+	down(&pool_sem);
+
+	xnlock_get_irqsave(&nklock, s);
+	pool->maxsz = 0;
+	if (pool->refill) {
+		list_del(&pool->rnext);
+		pool->refill = 0;
+	}
+	xnlock_put_irqrestore(&nklock, s);
+
+	list_del(&pool->next);
+
+	up(&pool_sem);
+}
+
+void rtipc_pool_get_stats(struct rtipc_pool *pool,
+			  struct rtipc_pool_stats *stats)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	stats->poolsz = pool->heap != &kheap ? rtipc_pool_size(pool) : 0;
+	stats->used = pool->used;
+	stats->peak = pool->peak;
+	stats->failures = pool->failures;
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+void __rtipc_pool_refill(struct rtipc_pool *pool) /* nklock held */
+{
+	pool->refill = 1;
+	list_add_tail(&pool->rnext, &refill_queue);
+	rtdm_nrtsig_pend(&refill_nrtsig);
+}
+
+static DECLARE_WORK_FUNC(refill_work_fn)
+{
+	struct rtipc_pool *pool;
+	size_t extsz;
+	void *mem;
+	spl_t s;
+
+	down(&pool_sem);
+
+	for (;;) {
+		xnlock_get_irqsave(&nklock, s);
+		if (list_empty(&refill_queue)) {
+			xnlock_put_irqrestore(&nklock, s);
+			break;
+		}
+		pool = list_entry(refill_queue.next, struct rtipc_pool, rnext);
+		list_del_init(&pool->rnext);
+		xnlock_put_irqrestore(&nklock, s);
+
+		/* Extents of a heap must all have the same size. */
+		extsz = xnheap_extentsize(pool->heap);
+		mem = xnarch_alloc_host_mem(extsz);
+		if (mem && xnheap_extend(pool->heap, mem, extsz)) {
+			xnarch_free_host_mem(mem, extsz);
+			mem = NULL;
+		}
+
+		if (mem && pool->grown)
+			pool->grown(pool);
+
+		xnlock_get_irqsave(&nklock, s);
+		pool->refill = 0;
+		xnlock_put_irqrestore(&nklock, s);
+	}
+
+	up(&pool_sem);
+}
+
+static DECLARE_WORK_NODATA(refill_work, &refill_work_fn);
+
+static void refill_handler(rtdm_nrtsig_t nrt_sig, void *arg)
+{
+	schedule_work(&refill_work);
+}
+
+#ifdef CONFIG_XENO_OPT_VFILE
+
+static struct xnvfile_directory rtipc_vfroot;
+
+static int pools_vfile_show(struct xnvfile_regular_iterator *it, void *data)
+{
+	struct rtipc_pool_stats stats;
+	struct rtipc_pool *pool;
+
+	xnvfile_printf(it, "%-5s %-5s %-10s %-10s %-10s %-10s %s\n",
+		       "PROTO", "PORT", "POOLSZ", "USED", "PEAK",
+		       "MAXSZ", "FAILURES");
+
+	down(&pool_sem);
+
+	list_for_each_entry(pool, &pool_list, next) {
+		rtipc_pool_get_stats(pool, &stats);
+		xnvfile_printf(it, "%-5s %-5d %-10lu %-10lu %-10lu %-10lu %lu\n",
+			       pool->proto, pool->name->sipc_port,
+			       (unsigned long)stats.poolsz,
+			       (unsigned long)stats.used,
+			       (unsigned long)stats.peak,
+			       (unsigned long)pool->maxsz,
+			       stats.failures);
+	}
+
+	up(&pool_sem);
+
+	return 0;
+}
+
+static struct xnvfile_regular_ops pools_vfile_ops = {
+	.show = pools_vfile_show,
+};
+
+static struct xnvfile_regular pools_vfile = {
+	.ops = &pools_vfile_ops,
+};
+
+static void rtipc_init_vfile(void)
+{
+	xnvfile_init_dir("rtipc", &rtipc_vfroot, &nkvfroot);
+	xnvfile_init_regular("pools", &pools_vfile, &rtipc_vfroot);
+}
+
+static void rtipc_cleanup_vfile(void)
+{
+	xnvfile_destroy_regular(&pools_vfile);
+	xnvfile_destroy_dir(&rtipc_vfroot);
+}
+
+#else /* !CONFIG_XENO_OPT_VFILE */
+
+static inline void rtipc_init_vfile(void) { }
+
+static inline void rtipc_cleanup_vfile(void) { }
+
+#endif /* !CONFIG_XENO_OPT_VFILE */
+
 static int rtipc_socket(struct rtdm_dev_context *context,
 			rtdm_user_info_t *user_info, int protocol)
 {
@@ -192,6 +366,48 @@ static ssize_t rtipc_sendmsg(struct rtdm_dev_context *context,
 	return p->proto->proto_ops.sendmsg(p, user_info, msg, flags);
 }
 
+static int rtipc_recvmmsg(struct rtdm_dev_context *context,
+			  rtdm_user_info_t *user_info,
+			  struct rtdm_mmsghdr *msgvec, unsigned int vlen,
+			  int flags)
+{
+	struct rtipc_private *p = rtdm_context_to_private(context);
+	unsigned int n;
+	ssize_t ret;
+
+	for (n = 0; n < vlen; n++) {
+		ret = p->proto->proto_ops.recvmsg(p, user_info,
+						  &msgvec[n].msg_hdr, flags);
+		if (ret < 0)
+			return n > 0 ? n : ret;
+		msgvec[n].msg_len = ret;
+		/* Only wait for the first datagram. */
+		flags |= MSG_DONTWAIT;
+	}
+
+	return n;
+}
+
+static int rtipc_sendmmsg(struct rtdm_dev_context *context,
+			  rtdm_user_info_t *user_info,
+			  struct rtdm_mmsghdr *msgvec, unsigned int vlen,
+			  int flags)
+{
+	struct rtipc_private *p = rtdm_context_to_private(context);
+	unsigned int n;
+	ssize_t ret;
+
+	for (n = 0; n < vlen; n++) {
+		ret = p->proto->proto_ops.sendmsg(p, user_info,
+						  &msgvec[n].msg_hdr, flags);
+		if (ret < 0)
+			return n > 0 ? n : ret;
+		msgvec[n].msg_len = ret;
+	}
+
+	return n;
+}
+
 static ssize_t rtipc_read(struct rtdm_dev_context *context,
 			  rtdm_user_info_t *user_info,
 			  void *buf, size_t len)
@@ -230,6 +446,8 @@ static struct rtdm_device device = {
 		.recvmsg_nrt	=	NULL,
 		.sendmsg_rt	=	rtipc_sendmsg,
 		.sendmsg_nrt	=	NULL,
+		.recvmmsg_rt	=	rtipc_recvmmsg,
+		.sendmmsg_rt	=	rtipc_sendmmsg,
 		.ioctl_rt	=	rtipc_ioctl,
 		.ioctl_nrt	=	rtipc_ioctl,
 		.read_rt	=	rtipc_read,
@@ -251,6 +469,10 @@ int __init __rtipc_init(void)
 {
 	int ret, n;
 
+	ret = rtdm_nrtsig_init(&refill_nrtsig, refill_handler, NULL);
+	if (ret)
+		return ret;
+
 	for (n = 0; n < IPCPROTO_MAX; n++) {
 		if (protocols[n] && protocols[n]->proto_init) {
 			ret = protocols[n]->proto_init();
@@ -259,7 +481,15 @@ int __init __rtipc_init(void)
 		}
 	}
 
-	return rtdm_dev_register(&device);
+	rtipc_init_vfile();
+
+	ret = rtdm_dev_register(&device);
+	if (ret) {
+		rtipc_cleanup_vfile();
+		rtdm_nrtsig_destroy(&refill_nrtsig);
+	}
+
+	return ret;
 }
 
 void __exit __rtipc_exit(void)
@@ -268,10 +498,15 @@ void __exit __rtipc_exit(void)
 
 	rtdm_dev_unregister(&device, 1000);
 
+	rtipc_cleanup_vfile();
+
 	for (n = 0; n < IPCPROTO_MAX; n++) {
 		if (protocols[n] && protocols[n]->proto_exit)
 			protocols[n]->proto_exit();
 	}
+
+	rtdm_nrtsig_destroy(&refill_nrtsig);
+	flush_scheduled_work();
 }
 
 module_init(__rtipc_init);
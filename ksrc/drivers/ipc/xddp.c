@@ -55,8 +55,10 @@ struct xddp_socket {
 
 	nanosecs_rel_t timeout;	/* connect()/recvmsg() timeout */
 	size_t reqbufsz;	/* Requested streaming buffer size */
+	size_t ringsz;		/* Slots of the mapped ring, 0 if none */
 
 	int (*monitor)(int s, int event, long arg);
+	struct rtipc_pool pool;	/* Memory accounting. */
 	struct rtipc_private *priv;
 };
 
@@ -116,6 +118,25 @@ static void __xddp_flush_pool(xnheap_t *heap,
 	xnarch_free_host_mem(poolmem, poolsz);
 }
 
+/* Pipe messages are allocated with their header. */
+static inline size_t __xddp_mh_size(struct xnpipe_mh *mh)
+{
+	return xnpipe_m_size(mh) + sizeof(*mh);
+}
+
+static void __xddp_release_mapped(xnheap_t *heap)
+{
+	kfree(container_of(heap, struct xddp_socket, privpool));
+}
+
+static void __xddp_destroy_pool(struct xddp_socket *sk)
+{
+	if (sk->ringsz)
+		xnheap_destroy_mapped(&sk->privpool, NULL, NULL);
+	else
+		xnheap_destroy(&sk->privpool, __xddp_flush_pool, NULL);
+}
+
 static void *__xddp_alloc_handler(size_t size, void *skarg) /* nklock free */
 {
 	struct xddp_socket *sk = skarg;
@@ -123,7 +144,10 @@ static void *__xddp_alloc_handler(size_t size, void *skarg) /* nklock free */
 
 	/* Try to allocate memory for the incoming message. */
 	buf = xnheap_alloc(sk->bufpool, size);
-	if (unlikely(buf == NULL)) {
+	if (likely(buf != NULL))
+		rtipc_pool_charge(&sk->pool, size);
+	else {
+		rtipc_pool_fail(&sk->pool);
 		if (sk->monitor)
 			sk->monitor(sk->fd, XDDP_EVTNOBUF, size);
 		if (size > xnheap_max_contiguous(sk->bufpool))
@@ -135,8 +159,10 @@ static void *__xddp_alloc_handler(size_t size, void *skarg) /* nklock free */
 
 static int __xddp_resize_streambuf(struct xddp_socket *sk) /* sk->lock held */
 {
-	if (sk->buffer)
+	if (sk->buffer) {
+		rtipc_pool_credit(&sk->pool, sk->curbufsz);
 		xnheap_free(sk->bufpool, sk->buffer);
+	}
 
 	if (sk->reqbufsz == 0) {
 		sk->buffer = NULL;
@@ -146,10 +172,12 @@ static int __xddp_resize_streambuf(struct xddp_socket *sk) /* sk->lock held */
 
 	sk->buffer = xnheap_alloc(sk->bufpool, sk->reqbufsz);
 	if (sk->buffer == NULL) {
+		rtipc_pool_fail(&sk->pool);
 		sk->curbufsz = 0;
 		return -ENOMEM;
 	}
 
+	rtipc_pool_charge(&sk->pool, sk->reqbufsz);
 	sk->curbufsz = sk->reqbufsz;
 
 	return 0;
@@ -161,6 +189,7 @@ static void __xddp_free_handler(void *buf, void *skarg) /* nklock free */
 	rtdm_lockctx_t lockctx;
 
 	if (buf != sk->buffer) {
+		rtipc_pool_credit(&sk->pool, __xddp_mh_size(buf));
 		xnheap_free(sk->bufpool, buf);
 		return;
 	}
@@ -212,8 +241,21 @@ static void __xddp_release_handler(void *skarg) /* nklock free */
 {
 	struct xddp_socket *sk = skarg;
 
-	if (sk->bufpool == &sk->privpool)
+	rtipc_pool_cleanup(&sk->pool);
+
+	if (sk->bufpool == &sk->privpool) {
+		/*
+		 * The Linux reader may still map the pool in ring
+		 * mode, in which case the socket is freed when the
+		 * last mapping goes away.
+		 */
+		if (sk->ringsz) {
+			xnheap_destroy_mapped(&sk->privpool,
+					      __xddp_release_mapped, NULL);
+			return;
+		}
 		xnheap_destroy(&sk->privpool, __xddp_flush_pool, NULL);
+	}
 
 	kfree(sk);
 }
@@ -238,8 +280,10 @@ static int xddp_socket(struct rtipc_private *priv,
 	sk->timeout = RTDM_TIMEOUT_INFINITE;
 	sk->curbufsz = 0;
 	sk->reqbufsz = 0;
+	sk->ringsz = 0;
 	sk->monitor = NULL;
 	rtdm_lock_init(&sk->lock);
+	rtipc_pool_init(&sk->pool, "xddp", &sk->name);
 	sk->priv = priv;
 
 	return 0;
@@ -252,8 +296,12 @@ static int xddp_close(struct rtipc_private *priv,
 
 	sk->monitor = NULL;
 
-	if (!test_bit(_XDDP_BOUND, &sk->status))
+	if (!test_bit(_XDDP_BOUND, &sk->status)) {
+		/* No pipe, hence no release handler to run. */
+		rtipc_pool_cleanup(&sk->pool);
+		kfree(sk);
 		return 0;
+	}
 
 	portmap[sk->name.sipc_port] = -1;
 
@@ -325,6 +373,8 @@ static ssize_t __xddp_recvmsg(struct rtipc_private *priv,
 	}
 
 out:
+	if (mbuf)
+		rtipc_pool_credit(&sk->pool, __xddp_mh_size(&mbuf->mh));
 	xnheap_free(sk->bufpool, mbuf);
 
 	return ret ?: len;
@@ -539,9 +589,11 @@ static ssize_t __xddp_sendmsg(struct rtipc_private *priv,
 nostream:
 	mbuf = xnheap_alloc(rsk->bufpool, sublen + sizeof(*mbuf));
 	if (unlikely(mbuf == NULL)) {
+		rtipc_pool_fail(&rsk->pool);
 		ret = -ENOMEM;
 		goto fail_unlock;
 	}
+	rtipc_pool_charge(&rsk->pool, sublen + sizeof(*mbuf));
 
 	/*
 	 * Move "sublen" bytes to mbuf->data from the vector cells
@@ -577,6 +629,7 @@ nostream:
 
 	if (unlikely(ret < 0)) {
 	fail_freebuf:
+		rtipc_pool_credit(&rsk->pool, sublen + sizeof(*mbuf));
 		xnheap_free(rsk->bufpool, mbuf);
 	fail_unlock:
 		rtdm_context_unlock(rcontext);
@@ -692,7 +745,26 @@ static int __xddp_bind_socket(struct rtipc_private *priv,
 		return ret;
 
 	poolsz = sk->poolsz;
-	if (poolsz > 0) {
+	if (sk->ringsz > 0) {
+		/*
+		 * The mapped ring requires a local pool, which the
+		 * Linux reader maps in order to consume the messages
+		 * in place.
+		 */
+		if (poolsz == 0) {
+			ret = -EINVAL;
+			goto fail;
+		}
+		poolsz = xnheap_rounded_size(poolsz + sizeof(struct xnpipe_ring) +
+					     sk->ringsz * sizeof(struct xnpipe_ring_desc),
+					     PAGE_SIZE);
+		ret = xnheap_init_mapped(&sk->privpool, poolsz,
+					 XNARCH_SHARED_HEAP_FLAGS);
+		if (ret)
+			goto fail;
+
+		sk->bufpool = &sk->privpool;
+	} else if (poolsz > 0) {
 		poolsz = xnheap_rounded_size(poolsz + sk->reqbufsz, XNHEAP_PAGE_SIZE);
 		poolmem = xnarch_alloc_host_mem(poolsz);
 		if (poolmem == NULL) {
@@ -701,7 +773,7 @@ static int __xddp_bind_socket(struct rtipc_private *priv,
 		}
 
 		ret = xnheap_init(&sk->privpool,
-				  poolmem, poolsz, XNHEAP_PAGE_SIZE);
+				  poolmem, poolsz, XNHEAP_PAGE_SIZE, 0);
 		if (ret) {
 			xnarch_free_host_mem(poolmem, poolsz);
 			goto fail;
@@ -717,6 +789,7 @@ static int __xddp_bind_socket(struct rtipc_private *priv,
 			ret = -ENOMEM;
 			goto fail_freeheap;
 		}
+		rtipc_pool_charge(&sk->pool, sk->reqbufsz);
 		sk->curbufsz = sk->reqbufsz;
 	}
 
@@ -735,7 +808,7 @@ static int __xddp_bind_socket(struct rtipc_private *priv,
 			ret = -EADDRINUSE;
 	fail_freeheap:
 		if (sk->bufpool == &sk->privpool)
-			xnheap_destroy(&sk->privpool, __xddp_flush_pool, NULL);
+			__xddp_destroy_pool(sk);
 	fail:
 		clear_bit(_XDDP_BINDING, &sk->status);
 		return ret;
@@ -743,6 +816,15 @@ static int __xddp_bind_socket(struct rtipc_private *priv,
 
 	sk->minor = ret;
 	sa->sipc_port = ret;
+
+	if (sk->ringsz > 0) {
+		ret = xnpipe_attach_ring(sk->minor, sk->bufpool, sk->ringsz);
+		if (ret) {
+			/* The release handler will cleanup the pool for us. */
+			xnpipe_disconnect(sk->minor);
+			return ret;
+		}
+	}
 	sk->name = *sa;
 	/* Set default destination if unset at binding time. */
 	if (sk->peer.sipc_port < 0)
@@ -762,6 +844,10 @@ static int __xddp_bind_socket(struct rtipc_private *priv,
 	}
 
 	RTDM_EXECUTE_ATOMICALLY(
+		/* Only private pools Linux alone maps may grow. */
+		sk->pool.heap = sk->bufpool;
+		if (sk->bufpool == &kheap || sk->ringsz > 0)
+			sk->pool.maxsz = 0;
 		portmap[sk->minor] = sk->fd;
 		__clear_bit(_XDDP_BINDING, &sk->status);
 		__set_bit(_XDDP_BOUND, &sk->status);
@@ -842,6 +928,8 @@ static int __xddp_setsockopt(struct xddp_socket *sk,
 	int (*monitor)(int s, int event, long arg);
 	struct _rtdm_setsockopt_args sopt;
 	struct rtipc_port_label plabel;
+	struct xnpipe_wmark pwmark;
+	struct xddp_wmark wmark;
 	rtdm_lockctx_t lockctx;
 	struct timeval tv;
 	int ret = 0;
@@ -881,6 +969,9 @@ static int __xddp_setsockopt(struct xddp_socket *sk,
 				  sopt.optval, sizeof(len)))
 			return -EFAULT;
 		if (len > 0) {
+			/* Streaming would alter published messages. */
+			if (sk->ringsz)
+				return -EINVAL;
 			len += sizeof(struct xddp_message);
 			if (sk->bufpool &&
 			    len > xnheap_max_contiguous(sk->bufpool)) {
@@ -913,6 +1004,52 @@ static int __xddp_setsockopt(struct xddp_socket *sk,
 		);
 		break;
 
+	case XDDP_POOLMAX:
+		if (sopt.optlen != sizeof(len))
+			return -EINVAL;
+		if (rtipc_get_arg(user_info, &len,
+				  sopt.optval, sizeof(len)))
+			return -EFAULT;
+		RTDM_EXECUTE_ATOMICALLY(
+			if (test_bit(_XDDP_BOUND, &sk->status) ||
+			    test_bit(_XDDP_BINDING, &sk->status))
+				ret = -EALREADY;
+			else
+				sk->pool.maxsz = len;
+		);
+		break;
+
+	case XDDP_RING:
+		if (sopt.optlen != sizeof(len))
+			return -EINVAL;
+		if (rtipc_get_arg(user_info, &len,
+				  sopt.optval, sizeof(len)))
+			return -EFAULT;
+		RTDM_EXECUTE_ATOMICALLY(
+			if (test_bit(_XDDP_BOUND, &sk->status) ||
+			    test_bit(_XDDP_BINDING, &sk->status))
+				ret = -EALREADY;
+			else if (len > 0 && sk->reqbufsz > 0)
+				ret = -EINVAL;
+			else
+				sk->ringsz = len;
+		);
+		break;
+
+	case XDDP_WMARK:
+		if (sopt.optlen != sizeof(wmark))
+			return -EINVAL;
+		if (rtipc_get_arg(user_info, &wmark,
+				  sopt.optval, sizeof(wmark)))
+			return -EFAULT;
+		if (!test_bit(_XDDP_BOUND, &sk->status))
+			return -ENOTCONN;
+		pwmark.bytes = wmark.bytes;
+		pwmark.msgs = wmark.msgs;
+		pwmark.latency = wmark.latency;
+		ret = xnpipe_set_wmark(sk->minor, &pwmark);
+		break;
+
 	case XDDP_MONITOR:
 		/* Monitoring is available from kernel-space only. */
 		if (user_info)
@@ -954,6 +1091,7 @@ static int __xddp_getsockopt(struct xddp_socket *sk,
 			     void *arg)
 {
 	struct _rtdm_getsockopt_args sopt;
+	struct rtipc_pool_stats stats;
 	struct rtipc_port_label plabel;
 	struct timeval tv;
 	socklen_t len;
@@ -1000,6 +1138,15 @@ static int __xddp_getsockopt(struct xddp_socket *sk,
 			return -EFAULT;
 		break;
 
+	case XDDP_POOLSTAT:
+		if (len != sizeof(stats))
+			return -EINVAL;
+		rtipc_pool_get_stats(&sk->pool, &stats);
+		if (rtipc_put_arg(user_info, sopt.optval,
+				  &stats, sizeof(stats)))
+			return -EFAULT;
+		break;
+
 	default:
 		ret = -EINVAL;
 	}
@@ -0,0 +1,782 @@
+/*
+ * Real-time access to file data.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+#include <linux/mutex.h>
+
+#include <rtdm/rtfile.h>
+#include <rtdm/rtdm_driver.h>
+
+MODULE_DESCRIPTION("RTDM file data driver");
+MODULE_LICENSE("GPL");
+
+#define RTFILE_MAX_DEVICES	32
+
+static unsigned int devices = 4;
+module_param(devices, uint, 0400);
+MODULE_PARM_DESC(devices, "Number of rtfile devices (max. 32)");
+
+static unsigned int max_size_kb = 16384;
+module_param(max_size_kb, uint, 0400);
+MODULE_PARM_DESC(max_size_kb, "Maximum size of a loaded range, in KiB");
+
+/*
+ * A loaded copy of the file data. Images are never modified once
+ * published: a reload reads the file into a fresh image, then swaps
+ * it with the current one. Replaced images stay around until the last
+ * reader or mapping referring to them is gone, then are freed from
+ * Linux context.
+ */
+struct rtfile_image {
+	struct list_head next;	/* In slot->retired */
+	struct rtfile_slot *slot;
+	void *data;
+	size_t size;
+	size_t mapsize;
+	unsigned long generation;
+	int refs;		/* Protected by slot->lock */
+};
+
+struct rtfile_slot {
+	struct rtdm_device dev;
+	rtdm_lock_t lock;
+	struct rtfile_image *cur;
+	struct list_head retired;
+	unsigned long generation;
+	unsigned long loads;
+	unsigned long failures;
+
+	/* Load parameters and file state, protected by mutex. */
+	struct mutex mutex;
+	char *path;
+	loff_t offset;
+	loff_t length;
+	unsigned int watch_ms;
+	loff_t isize;
+	struct timespec mtime;
+
+	struct delayed_work watch_work;
+	struct work_struct reap_work;
+	rtdm_nrtsig_t reap_sig;
+};
+
+struct rtfile_context {
+	struct rtfile_slot *slot;
+	struct rtfile_image *img;	/* Image we read from, if any */
+	loff_t pos;
+};
+
+static struct rtfile_slot *slots;
+
+static struct rtfile_image *rtfile_image_alloc(size_t size)
+{
+	struct rtfile_image *img;
+
+	img = kmalloc(sizeof(*img), GFP_KERNEL);
+	if (img == NULL)
+		return NULL;
+
+	/* Always back the image with whole pages, so that it can be
+	   mapped, even when empty. */
+	img->mapsize = PAGE_ALIGN(size ?: 1);
+	img->data = vmalloc(img->mapsize);
+	if (img->data == NULL) {
+		kfree(img);
+		return NULL;
+	}
+
+	memset(img->data + size, 0, img->mapsize - size);
+	img->size = size;
+	img->refs = 0;
+
+	return img;
+}
+
+static void rtfile_image_free(struct rtfile_image *img)
+{
+	vfree(img->data);
+	kfree(img);
+}
+
+/* Called with slot->lock held. */
+static inline void rtfile_image_get(struct rtfile_image *img)
+{
+	img->refs++;
+}
+
+/* Called with slot->lock held, any context. */
+static inline void rtfile_image_put(struct rtfile_image *img)
+{
+	struct rtfile_slot *slot = img->slot;
+
+	if (--img->refs == 0 && img != slot->cur)
+		rtdm_nrtsig_pend(&slot->reap_sig);
+}
+
+/* Free the retired images nobody refers to anymore. */
+static void rtfile_reap(struct rtfile_slot *slot)
+{
+	struct rtfile_image *img, *tmp;
+	rtdm_lockctx_t c;
+	LIST_HEAD(dead);
+
+	rtdm_lock_get_irqsave(&slot->lock, c);
+	list_for_each_entry_safe(img, tmp, &slot->retired, next)
+		if (img->refs == 0)
+			list_move(&img->next, &dead);
+	rtdm_lock_put_irqrestore(&slot->lock, c);
+
+	list_for_each_entry_safe(img, tmp, &dead, next)
+		rtfile_image_free(img);
+}
+
+static void rtfile_reap_work(struct work_struct *work)
+{
+	rtfile_reap(container_of(work, struct rtfile_slot, reap_work));
+}
+
+static void rtfile_reap_sig(rtdm_nrtsig_t nrt_sig, void *arg)
+{
+	struct rtfile_slot *slot = arg;
+
+	schedule_work(&slot->reap_work);
+}
+
+/* Publish a new image, or none. */
+static void rtfile_publish(struct rtfile_slot *slot, struct rtfile_image *img)
+{
+	struct rtfile_image *old;
+	rtdm_lockctx_t c;
+
+	rtdm_lock_get_irqsave(&slot->lock, c);
+	old = slot->cur;
+	if (img) {
+		img->slot = slot;
+		img->generation = ++slot->generation;
+		slot->loads++;
+	}
+	slot->cur = img;
+	if (old)
+		list_add_tail(&old->next, &slot->retired);
+	rtdm_lock_put_irqrestore(&slot->lock, c);
+
+	rtfile_reap(slot);
+}
+
+/*
+ * (Re)load the file, with slot->mutex held. Unless forced, nothing is
+ * read when the file size and modification time did not change.
+ */
+static int rtfile_load(struct rtfile_slot *slot, int force)
+{
+	struct rtfile_image *img;
+	struct timespec mtime;
+	struct inode *inode;
+	struct file *file;
+	loff_t isize, len, done;
+	int ret;
+
+	file = filp_open(slot->path, O_RDONLY | O_LARGEFILE, 0);
+	if (IS_ERR(file))
+		return PTR_ERR(file);
+
+	/* For block devices, the size is that of the device inode. */
+	inode = file->f_mapping->host;
+	isize = i_size_read(inode);
+	mtime = file->f_path.dentry->d_inode->i_mtime;
+
+	if (!force && slot->cur && isize == slot->isize &&
+	    timespec_equal(&mtime, &slot->mtime)) {
+		ret = 0;
+		goto out;
+	}
+
+	len = slot->length ?: isize - slot->offset;
+	if (slot->offset > isize || len < 0 || slot->offset + len > isize) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (len > (loff_t)max_size_kb * 1024) {
+		ret = -EFBIG;
+		goto out;
+	}
+
+	img = rtfile_image_alloc(len);
+	if (img == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (done = 0; done < len; done += ret) {
+		ret = kernel_read(file, slot->offset + done,
+				  img->data + done,
+				  min_t(loff_t, len - done, 1 << 20));
+		if (ret <= 0) {
+			ret = ret ?: -EIO;
+			goto fail;
+		}
+	}
+
+	/* Do not publish an update which raced with a writer; the next
+	   check will pick the final contents. */
+	if (!timespec_equal(&file->f_path.dentry->d_inode->i_mtime, &mtime) ||
+	    i_size_read(inode) != isize) {
+		ret = -EAGAIN;
+		goto fail;
+	}
+
+	slot->isize = isize;
+	slot->mtime = mtime;
+	rtfile_publish(slot, img);
+	ret = 0;
+	goto out;
+
+  fail:
+	rtfile_image_free(img);
+  out:
+	filp_close(file, NULL);
+
+	return ret;
+}
+
+static void rtfile_watch_work(struct work_struct *work)
+{
+	struct rtfile_slot *slot =
+		container_of(work, struct rtfile_slot, watch_work.work);
+	rtdm_lockctx_t c;
+	int ret;
+
+	mutex_lock(&slot->mutex);
+
+	if (slot->path == NULL || slot->watch_ms == 0) {
+		mutex_unlock(&slot->mutex);
+		return;
+	}
+
+	ret = rtfile_load(slot, 0);
+	if (ret) {
+		rtdm_lock_get_irqsave(&slot->lock, c);
+		slot->failures++;
+		rtdm_lock_put_irqrestore(&slot->lock, c);
+	}
+
+	schedule_delayed_work(&slot->watch_work,
+			      msecs_to_jiffies(slot->watch_ms));
+
+	mutex_unlock(&slot->mutex);
+}
+
+static void rtfile_unload(struct rtfile_slot *slot)
+{
+	cancel_delayed_work_sync(&slot->watch_work);
+
+	mutex_lock(&slot->mutex);
+	kfree(slot->path);
+	slot->path = NULL;
+	slot->watch_ms = 0;
+	rtfile_publish(slot, NULL);
+	mutex_unlock(&slot->mutex);
+}
+
+static int rtfile_ioctl_load(struct rtfile_slot *slot,
+			     rtdm_user_info_t *user_info, void __user *arg)
+{
+	struct rtfile_load load;
+	char *path, *oldpath;
+	loff_t oldoffset, oldlength;
+	int ret;
+
+	if (user_info) {
+		ret = rtdm_safe_copy_from_user(user_info, &load, arg,
+					       sizeof(load));
+		if (ret)
+			return ret;
+	} else
+		memcpy(&load, arg, sizeof(load));
+
+	if ((long long)load.offset < 0 || (long long)load.length < 0)
+		return -EINVAL;
+
+	path = kmalloc(PATH_MAX, GFP_KERNEL);
+	if (path == NULL)
+		return -ENOMEM;
+
+	if (user_info) {
+		ret = rtdm_strncpy_from_user(user_info, path, load.path,
+					     PATH_MAX);
+		if (ret < 0)
+			goto fail;
+		if (ret == PATH_MAX) {
+			ret = -ENAMETOOLONG;
+			goto fail;
+		}
+	} else {
+		strncpy(path, load.path, PATH_MAX);
+		path[PATH_MAX - 1] = '\0';
+	}
+
+	cancel_delayed_work_sync(&slot->watch_work);
+
+	mutex_lock(&slot->mutex);
+
+	oldpath = slot->path;
+	oldoffset = slot->offset;
+	oldlength = slot->length;
+
+	slot->path = path;
+	slot->offset = load.offset;
+	slot->length = load.length;
+
+	ret = rtfile_load(slot, 1);
+	if (ret) {
+		/* Keep serving the previous file. */
+		slot->path = oldpath;
+		slot->offset = oldoffset;
+		slot->length = oldlength;
+		oldpath = path;
+	} else
+		slot->watch_ms = load.watch_ms;
+
+	if (slot->path && slot->watch_ms)
+		schedule_delayed_work(&slot->watch_work,
+				      msecs_to_jiffies(slot->watch_ms));
+
+	mutex_unlock(&slot->mutex);
+
+	kfree(oldpath);
+
+	return ret;
+
+  fail:
+	kfree(path);
+	return ret;
+}
+
+static void rtfile_vm_open(struct vm_area_struct *vma)
+{
+	struct rtfile_image *img = vma->vm_private_data;
+	rtdm_lockctx_t c;
+
+	rtdm_lock_get_irqsave(&img->slot->lock, c);
+	rtfile_image_get(img);
+	rtdm_lock_put_irqrestore(&img->slot->lock, c);
+}
+
+static void rtfile_vm_close(struct vm_area_struct *vma)
+{
+	struct rtfile_image *img = vma->vm_private_data;
+	rtdm_lockctx_t c;
+
+	rtdm_lock_get_irqsave(&img->slot->lock, c);
+	rtfile_image_put(img);
+	rtdm_lock_put_irqrestore(&img->slot->lock, c);
+}
+
+static struct vm_operations_struct rtfile_vm_ops = {
+	.open = rtfile_vm_open,
+	.close = rtfile_vm_close,
+};
+
+static int rtfile_ioctl_mmap(struct rtfile_slot *slot,
+			     rtdm_user_info_t *user_info, void __user *arg)
+{
+	struct rtfile_image *img;
+	struct rtfile_mmap map;
+	rtdm_lockctx_t c;
+	int ret;
+
+	if (user_info == NULL)
+		return -EINVAL;
+
+	rtdm_lock_get_irqsave(&slot->lock, c);
+	img = slot->cur;
+	if (img)
+		rtfile_image_get(img);
+	rtdm_lock_put_irqrestore(&slot->lock, c);
+
+	if (img == NULL)
+		return -ENODATA;
+
+	/* The initial mapping does not go through vm_ops->open(), the
+	   reference we hold is handed over to it. */
+	ret = rtdm_mmap_to_user(user_info, img->data, img->mapsize,
+				PROT_READ, &map.ptr, &rtfile_vm_ops, img);
+	if (ret) {
+		rtdm_lock_get_irqsave(&slot->lock, c);
+		rtfile_image_put(img);
+		rtdm_lock_put_irqrestore(&slot->lock, c);
+		return ret;
+	}
+
+	map.size = img->size;
+	map.generation = img->generation;
+
+	return rtdm_safe_copy_to_user(user_info, arg, &map, sizeof(map));
+}
+
+static int rtfile_ioctl_seek(struct rtfile_context *ctx,
+			     rtdm_user_info_t *user_info, void __user *arg)
+{
+	struct rtfile_slot *slot = ctx->slot;
+	struct rtfile_image *img;
+	struct rtfile_seek seek;
+	rtdm_lockctx_t c;
+	loff_t pos;
+	int ret;
+
+	if (user_info) {
+		ret = rtdm_safe_copy_from_user(user_info, &seek, arg,
+					       sizeof(seek));
+		if (ret)
+			return ret;
+	} else
+		memcpy(&seek, arg, sizeof(seek));
+
+	rtdm_lock_get_irqsave(&slot->lock, c);
+
+	img = slot->cur;
+	if (img == NULL) {
+		rtdm_lock_put_irqrestore(&slot->lock, c);
+		return -ENODATA;
+	}
+
+	switch (seek.whence) {
+	case SEEK_SET:
+		pos = seek.offset;
+		break;
+	case SEEK_CUR:
+		pos = ctx->pos + seek.offset;
+		break;
+	case SEEK_END:
+		pos = img->size + seek.offset;
+		break;
+	default:
+		pos = -1;
+	}
+
+	if (pos < 0) {
+		rtdm_lock_put_irqrestore(&slot->lock, c);
+		return -EINVAL;
+	}
+
+	/* Move to the latest image. */
+	if (ctx->img != img) {
+		rtfile_image_get(img);
+		if (ctx->img)
+			rtfile_image_put(ctx->img);
+		ctx->img = img;
+	}
+	ctx->pos = pos;
+
+	rtdm_lock_put_irqrestore(&slot->lock, c);
+
+	seek.offset = pos;
+
+	if (user_info)
+		return rtdm_safe_copy_to_user(user_info, arg, &seek,
+					      sizeof(seek));
+
+	memcpy(arg, &seek, sizeof(seek));
+
+	return 0;
+}
+
+static int rtfile_ioctl_info(struct rtfile_context *ctx,
+			     rtdm_user_info_t *user_info, void __user *arg)
+{
+	struct rtfile_slot *slot = ctx->slot;
+	struct rtfile_image *img;
+	struct rtfile_info info;
+	rtdm_lockctx_t c;
+
+	memset(&info, 0, sizeof(info));
+
+	rtdm_lock_get_irqsave(&slot->lock, c);
+	img = ctx->img ?: slot->cur;
+	if (img) {
+		info.size = img->size;
+		info.generation = img->generation;
+	}
+	if (slot->cur)
+		info.latest = slot->cur->generation;
+	info.loads = slot->loads;
+	info.failures = slot->failures;
+	rtdm_lock_put_irqrestore(&slot->lock, c);
+
+	if (user_info)
+		return rtdm_safe_copy_to_user(user_info, arg, &info,
+					      sizeof(info));
+
+	memcpy(arg, &info, sizeof(info));
+
+	return 0;
+}
+
+static int rtfile_ioctl_rt(struct rtdm_dev_context *context,
+			   rtdm_user_info_t *user_info,
+			   unsigned int request, void __user *arg)
+{
+	struct rtfile_context *ctx =
+		(struct rtfile_context *)context->dev_private;
+
+	switch (request) {
+	case RTFILE_RTIOC_SEEK:
+		return rtfile_ioctl_seek(ctx, user_info, arg);
+
+	case RTFILE_RTIOC_INFO:
+		return rtfile_ioctl_info(ctx, user_info, arg);
+
+	default:
+		/* Loading and mapping need Linux services. */
+		return -ENOSYS;
+	}
+}
+
+static int rtfile_ioctl_nrt(struct rtdm_dev_context *context,
+			    rtdm_user_info_t *user_info,
+			    unsigned int request, void __user *arg)
+{
+	struct rtfile_context *ctx =
+		(struct rtfile_context *)context->dev_private;
+	struct rtfile_slot *slot = ctx->slot;
+	int ret;
+
+	switch (request) {
+	case RTFILE_RTIOC_LOAD:
+		return rtfile_ioctl_load(slot, user_info, arg);
+
+	case RTFILE_RTIOC_RELOAD:
+		mutex_lock(&slot->mutex);
+		ret = slot->path ? rtfile_load(slot, 1) : -ENODATA;
+		mutex_unlock(&slot->mutex);
+		return ret;
+
+	case RTFILE_RTIOC_UNLOAD:
+		rtfile_unload(slot);
+		return 0;
+
+	case RTFILE_RTIOC_MMAP:
+		return rtfile_ioctl_mmap(slot, user_info, arg);
+
+	case RTFILE_RTIOC_SEEK:
+		return rtfile_ioctl_seek(ctx, user_info, arg);
+
+	case RTFILE_RTIOC_INFO:
+		return rtfile_ioctl_info(ctx, user_info, arg);
+
+	default:
+		return -ENOTTY;
+	}
+}
+
+static ssize_t rtfile_read(struct rtdm_dev_context *context,
+			   rtdm_user_info_t *user_info, void *buf,
+			   size_t nbyte)
+{
+	struct rtfile_context *ctx =
+		(struct rtfile_context *)context->dev_private;
+	struct rtfile_slot *slot = ctx->slot;
+	struct rtfile_image *img;
+	rtdm_lockctx_t c;
+	loff_t pos;
+
+	if (user_info && !rtdm_rw_user_ok(user_info, buf, nbyte))
+		return -EFAULT;
+
+	/* Stick to the image we started with until the next seek. */
+	rtdm_lock_get_irqsave(&slot->lock, c);
+	img = ctx->img;
+	if (img == NULL) {
+		img = slot->cur;
+		if (img == NULL) {
+			rtdm_lock_put_irqrestore(&slot->lock, c);
+			return -ENODATA;
+		}
+		rtfile_image_get(img);
+		ctx->img = img;
+	}
+	pos = ctx->pos;
+	if (pos >= img->size)
+		nbyte = 0;
+	else if (nbyte > img->size - pos)
+		nbyte = img->size - pos;
+	ctx->pos = pos + nbyte;
+	rtdm_lock_put_irqrestore(&slot->lock, c);
+
+	if (nbyte == 0)
+		return 0;
+
+	/* Our reference keeps the image alive while copying. */
+	if (user_info) {
+		if (rtdm_copy_to_user(user_info, buf, img->data + pos, nbyte))
+			return -EFAULT;
+	} else
+		memcpy(buf, img->data + pos, nbyte);
+
+	return nbyte;
+}
+
+static int rtfile_open(struct rtdm_dev_context *context,
+		       rtdm_user_info_t *user_info, int oflags)
+{
+	struct rtfile_context *ctx =
+		(struct rtfile_context *)context->dev_private;
+
+	ctx->slot = container_of(context->device, struct rtfile_slot, dev);
+	ctx->img = NULL;
+	ctx->pos = 0;
+
+	return 0;
+}
+
+static int rtfile_close(struct rtdm_dev_context *context,
+			rtdm_user_info_t *user_info)
+{
+	struct rtfile_context *ctx =
+		(struct rtfile_context *)context->dev_private;
+	struct rtfile_slot *slot = ctx->slot;
+	rtdm_lockctx_t c;
+
+	rtdm_lock_get_irqsave(&slot->lock, c);
+	if (ctx->img)
+		rtfile_image_put(ctx->img);
+	ctx->img = NULL;
+	rtdm_lock_put_irqrestore(&slot->lock, c);
+
+	return 0;
+}
+
+static struct rtdm_device device_tmpl = {
+	.struct_version		= RTDM_DEVICE_STRUCT_VER,
+
+	.device_flags		= RTDM_NAMED_DEVICE,
+	.context_size		= sizeof(struct rtfile_context),
+	.device_name		= "",
+
+	.open_nrt		= rtfile_open,
+
+	.ops = {
+		.close_nrt	= rtfile_close,
+
+		.ioctl_rt	= rtfile_ioctl_rt,
+		.ioctl_nrt	= rtfile_ioctl_nrt,
+
+		.read_rt	= rtfile_read,
+		.read_nrt	= rtfile_read,
+	},
+
+	.device_class		= RTDM_CLASS_FILE,
+	.device_sub_class	= RTDM_SUBCLASS_FILECACHE,
+	.profile_version	= RTFILE_PROFILE_VER,
+	.driver_name		= "xeno_rtfile",
+	.driver_version		= RTDM_DRIVER_VER(0, 1, 0),
+	.peripheral_name	= "File data cache",
+	.provider_name		= "Xenomai",
+};
+
+static void rtfile_cleanup_slot(struct rtfile_slot *slot)
+{
+	struct rtfile_image *img, *tmp;
+
+	rtfile_unload(slot);
+	rtdm_nrtsig_destroy(&slot->reap_sig);
+	cancel_work_sync(&slot->reap_work);
+
+	/* Images still mapped by some process are leaked. */
+	list_for_each_entry_safe(img, tmp, &slot->retired, next) {
+		if (img->refs) {
+			printk(KERN_WARNING "rtfile: %s still mapped, leaking "
+			       "%zu bytes\n", slot->dev.device_name,
+			       img->mapsize);
+			continue;
+		}
+		list_del(&img->next);
+		rtfile_image_free(img);
+	}
+}
+
+static void __rtfile_exit(int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		rtdm_dev_unregister(&slots[i].dev, 1000);
+		rtfile_cleanup_slot(&slots[i]);
+	}
+
+	kfree(slots);
+}
+
+static int __init __rtfile_init(void)
+{
+	struct rtfile_slot *slot;
+	int err, i;
+
+	if (devices == 0 || devices > RTFILE_MAX_DEVICES)
+		return -EINVAL;
+
+	slots = kcalloc(devices, sizeof(*slots), GFP_KERNEL);
+	if (slots == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < devices; i++) {
+		slot = &slots[i];
+		memcpy(&slot->dev, &device_tmpl, sizeof(struct rtdm_device));
+		snprintf(slot->dev.device_name, RTDM_MAX_DEVNAME_LEN,
+			 "rtfile%d", i);
+		slot->dev.device_id = i;
+		slot->dev.proc_name = slot->dev.device_name;
+
+		rtdm_lock_init(&slot->lock);
+		INIT_LIST_HEAD(&slot->retired);
+		mutex_init(&slot->mutex);
+		INIT_DELAYED_WORK(&slot->watch_work, rtfile_watch_work);
+		INIT_WORK(&slot->reap_work, rtfile_reap_work);
+
+		err = rtdm_nrtsig_init(&slot->reap_sig, rtfile_reap_sig, slot);
+		if (err)
+			goto fail;
+
+		err = rtdm_dev_register(&slot->dev);
+		if (err) {
+			rtdm_nrtsig_destroy(&slot->reap_sig);
+			goto fail;
+		}
+	}
+
+	return 0;
+
+  fail:
+	__rtfile_exit(i);
+
+	return err;
+}
+
+static void __exit __rtfile_cleanup(void)
+{
+	__rtfile_exit(devices);
+}
+
+module_init(__rtfile_init);
+module_exit(__rtfile_cleanup);
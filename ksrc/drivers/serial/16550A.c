@@ -19,6 +19,8 @@
 #include <linux/version.h>
 #include <linux/module.h>
 #include <linux/ioport.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
 #include <asm/io.h>
 
 #include <rtdm/rtserial.h>
@@ -70,10 +72,18 @@
 #define LSR			5	/* Line Status Register */
 #define MSR			6	/* Modem Status Register */
 
+struct rt_16550_ring {
+	struct rtser_ring_ctl *ctl;	/* shared area, vmalloc'ed */
+	size_t size;			/* length of the shared area */
+	atomic_t refcount;		/* device context + user mappings */
+};
+
 struct rt_16550_context {
 	struct rtser_config config;	/* current device configuration */
 
 	rtdm_irq_t irq_handle;		/* device IRQ handle */
+	rtdm_irqpoll_t irq_poll;	/* polling fallback on IRQ storms */
+	int polled;			/* irq_poll is in use */
 	rtdm_lock_t lock;		/* lock to protect context struct */
 
 	unsigned long base_addr;	/* hardware IO base address */
@@ -88,6 +98,7 @@ struct rt_16550_context {
 	int in_nwait;			/* bytes the user waits for */
 	rtdm_event_t in_event;		/* raised to unblock reader */
 	char in_buf[IN_BUFFER_SIZE];	/* RX ring buffer */
+	char *in_data;			/* active RX ring storage */
 	volatile unsigned long in_lock;	/* single-reader lock */
 	uint64_t *in_history;		/* RX timestamp buffer */
 
@@ -96,8 +107,13 @@ struct rt_16550_context {
 	size_t out_npend;		/* pending bytes in TX ring */
 	rtdm_event_t out_event;		/* raised to unblock writer */
 	char out_buf[OUT_BUFFER_SIZE];	/* TX ring buffer */
+	char *out_data;			/* active TX ring storage */
 	rtdm_mutex_t out_lock;		/* single-writer mutex */
 
+	struct rt_16550_ring *ring;	/* mapped rings, NULL in copy mode */
+	struct rtser_ring_ctl *ring_ctl; /* shared indices of mapped rings */
+	int ring_watermark;		/* RX bytes waking up ring waiter */
+
 	uint64_t last_timestamp;	/* timestamp of last event */
 	int ioc_events;			/* recorded events */
 	rtdm_event_t ioc_event;		/* raised to unblock event waiter */
@@ -124,16 +140,28 @@ static unsigned long irqtype[MAX_DEVICES] = {
 };
 static unsigned int baud_base[MAX_DEVICES];
 static int tx_fifo[MAX_DEVICES];
+static unsigned int irq_poll_rate[MAX_DEVICES];
+static unsigned int irq_poll_period = 1000;
+static unsigned int irq_poll_prio = 50;
 static unsigned int start_index;
 
 compat_module_param_array(irq, uint, MAX_DEVICES, 0400);
 compat_module_param_array(baud_base, uint, MAX_DEVICES, 0400);
 compat_module_param_array(tx_fifo, int, MAX_DEVICES, 0400);
+compat_module_param_array(irq_poll_rate, uint, MAX_DEVICES, 0400);
 
 MODULE_PARM_DESC(irq, "IRQ numbers of the serial devices");
 MODULE_PARM_DESC(baud_base, "Maximum baud rate of the serial device "
 		 "(internal clock rate / 16)");
 MODULE_PARM_DESC(tx_fifo, "Transmitter FIFO size");
+MODULE_PARM_DESC(irq_poll_rate, "Interrupt rate (per second) above which "
+		 "the device is polled, 0 to disable");
+
+module_param(irq_poll_period, uint, 0400);
+MODULE_PARM_DESC(irq_poll_period, "Polling period (us)");
+
+module_param(irq_poll_prio, uint, 0400);
+MODULE_PARM_DESC(irq_poll_prio, "Priority of the polling tasks");
 
 module_param(start_index, uint, 0400);
 MODULE_PARM_DESC(start_index, "First device instance number to be used");
@@ -151,20 +179,28 @@ static inline int rt_16550_rx_interrupt(struct rt_16550_context *ctx,
 	unsigned long base = ctx->base_addr;
 	int mode = rt_16550_io_mode_from_ctx(ctx);
 	int rbytes = 0;
+	int stored = 0;
 	int lsr = 0;
 	int c;
 
 	do {
 		c = rt_16550_reg_in(mode, base, RHR);	/* read input char */
 
-		ctx->in_buf[ctx->in_tail] = c;
-		if (ctx->in_history)
-			ctx->in_history[ctx->in_tail] = *timestamp;
-		ctx->in_tail = (ctx->in_tail + 1) & (IN_BUFFER_SIZE - 1);
-
-		if (++ctx->in_npend > IN_BUFFER_SIZE) {
+		if (ctx->ring_ctl && ctx->in_npend >= IN_BUFFER_SIZE)
+			/* Never overwrite what the application may read. */
 			lsr |= RTSER_SOFT_OVERRUN_ERR;
-			ctx->in_npend--;
+		else {
+			ctx->in_data[ctx->in_tail] = c;
+			if (ctx->in_history)
+				ctx->in_history[ctx->in_tail] = *timestamp;
+			ctx->in_tail =
+			    (ctx->in_tail + 1) & (IN_BUFFER_SIZE - 1);
+			stored++;
+
+			if (++ctx->in_npend > IN_BUFFER_SIZE) {
+				lsr |= RTSER_SOFT_OVERRUN_ERR;
+				ctx->in_npend--;
+			}
 		}
 
 		rbytes++;
@@ -175,6 +211,12 @@ static inline int rt_16550_rx_interrupt(struct rt_16550_context *ctx,
 			 RTSER_LSR_BREAK_IND));
 	} while (testbits(lsr, RTSER_LSR_DATA));
 
+	if (ctx->ring_ctl) {
+		/* Publish the data before the index. */
+		smp_wmb();
+		ctx->ring_ctl->rx_tail += stored;
+	}
+
 	/* save new errors */
 	ctx->status |= lsr;
 
@@ -203,11 +245,35 @@ static inline void rt_16550_tx_interrupt(struct rt_16550_context *ctx)
 		for (count = ctx->tx_fifo;
 		     (count > 0) && (ctx->out_npend > 0);
 		     count--, ctx->out_npend--) {
-			c = ctx->out_buf[ctx->out_head++];
+			c = ctx->out_data[ctx->out_head++];
 			rt_16550_reg_out(mode, base, THR, c);
 			ctx->out_head &= (OUT_BUFFER_SIZE - 1);
 		}
 	}
+
+	if (ctx->ring_ctl) {
+		/* The sent bytes must be read before they are released. */
+		smp_mb();
+		ctx->ring_ctl->tx_head += ctx->tx_fifo - count;
+	}
+}
+
+/* Called with ctx->lock held. */
+static inline void rt_16550_ring_pull(struct rt_16550_context *ctx)
+{
+	struct rtser_ring_ctl *ring = ctx->ring_ctl;
+
+	/* Catch up with the indices the application has moved. */
+	ctx->in_npend = ring->rx_tail - ring->rx_head;
+	if (ctx->in_npend > IN_BUFFER_SIZE)
+		ctx->in_npend = IN_BUFFER_SIZE;
+
+	ctx->out_npend = ring->tx_tail - ring->tx_head;
+	if (ctx->out_npend > OUT_BUFFER_SIZE)
+		ctx->out_npend = OUT_BUFFER_SIZE;
+
+	/* Queued TX bytes must not be read ahead of tx_tail. */
+	smp_rmb();
 }
 
 static inline void rt_16550_stat_interrupt(struct rt_16550_context *ctx)
@@ -220,11 +286,11 @@ static inline void rt_16550_stat_interrupt(struct rt_16550_context *ctx)
 			 RTSER_LSR_FRAMING_ERR | RTSER_LSR_BREAK_IND));
 }
 
-static int rt_16550_interrupt(rtdm_irq_t * irq_context)
+/* Called with ctx->lock held. */
+static int rt_16550_service(struct rt_16550_context *ctx)
 {
-	struct rt_16550_context *ctx;
-	unsigned long base;
-	int mode;
+	unsigned long base = ctx->base_addr;
+	int mode = rt_16550_io_mode_from_ctx(ctx);
 	int iir;
 	uint64_t timestamp = rtdm_clock_read();
 	int rbytes = 0;
@@ -232,11 +298,8 @@ static int rt_16550_interrupt(rtdm_irq_t * irq_context)
 	int modem;
 	int ret = RTDM_IRQ_NONE;
 
-	ctx = rtdm_irq_get_arg(irq_context, struct rt_16550_context);
-	base = ctx->base_addr;
-	mode = rt_16550_io_mode_from_ctx(ctx);
-
-	rtdm_lock_get(&ctx->lock);
+	if (ctx->ring_ctl)
+		rt_16550_ring_pull(ctx);
 
 	while (1) {
 		iir = rt_16550_reg_in(mode, base, IIR) & IIR_MASK;
@@ -294,11 +357,40 @@ static int rt_16550_interrupt(rtdm_irq_t * irq_context)
 	/* update interrupt mask */
 	rt_16550_reg_out(mode, base, IER, ctx->ier_status);
 
+	return ret;
+}
+
+static int rt_16550_interrupt(rtdm_irq_t * irq_context)
+{
+	struct rt_16550_context *ctx;
+	int ret;
+
+	ctx = rtdm_irq_get_arg(irq_context, struct rt_16550_context);
+
+	rtdm_lock_get(&ctx->lock);
+	ret = rt_16550_service(ctx);
 	rtdm_lock_put(&ctx->lock);
 
+	if (ctx->polled && ret == RTDM_IRQ_HANDLED)
+		ret |= rtdm_irqpoll_check(&ctx->irq_poll);
+
 	return ret;
 }
 
+static int rt_16550_poll(rtdm_irqpoll_t *poll)
+{
+	struct rt_16550_context *ctx =
+		container_of(poll, struct rt_16550_context, irq_poll);
+	rtdm_lockctx_t lock_ctx;
+	int ret;
+
+	rtdm_lock_get_irqsave(&ctx->lock, lock_ctx);
+	ret = rt_16550_service(ctx);
+	rtdm_lock_put_irqrestore(&ctx->lock, lock_ctx);
+
+	return ret == RTDM_IRQ_HANDLED;
+}
+
 static int rt_16550_set_config(struct rt_16550_context *ctx,
 			       const struct rtser_config *config,
 			       uint64_t **in_history_ptr)
@@ -433,6 +525,271 @@ static int rt_16550_set_config(struct rt_16550_context *ctx,
 	return err;
 }
 
+static void rt_16550_ring_put(struct rt_16550_ring *ring)
+{
+	if (atomic_dec_and_test(&ring->refcount)) {
+		vfree(ring->ctl);
+		kfree(ring);
+	}
+}
+
+static void rt_16550_ring_vmopen(struct vm_area_struct *vma)
+{
+	struct rt_16550_ring *ring = vma->vm_private_data;
+
+	atomic_inc(&ring->refcount);
+}
+
+static void rt_16550_ring_vmclose(struct vm_area_struct *vma)
+{
+	rt_16550_ring_put(vma->vm_private_data);
+}
+
+static struct vm_operations_struct rt_16550_ring_vmops = {
+	.open = rt_16550_ring_vmopen,
+	.close = rt_16550_ring_vmclose,
+};
+
+#define RT_16550_RING_CTL_SIZE	PAGE_ALIGN(sizeof(struct rtser_ring_ctl))
+
+/*
+ * Called with ctx->lock held. The offsets published in the control
+ * block are for user-space only: it may have rewritten them since the
+ * area was mapped.
+ */
+static void rt_16550_ring_switch(struct rt_16550_context *ctx,
+				 struct rt_16550_ring *ring)
+{
+	struct rtser_ring_ctl *ctl = ring ? ring->ctl : NULL;
+
+	ctx->ring = ring;
+	ctx->ring_ctl = ctl;
+	ctx->in_data = ctl ? (char *)ctl + RT_16550_RING_CTL_SIZE : ctx->in_buf;
+	ctx->out_data = ctl ?
+		(char *)ctl + RT_16550_RING_CTL_SIZE + IN_BUFFER_SIZE :
+		ctx->out_buf;
+
+	ctx->in_head = 0;
+	ctx->in_tail = 0;
+	ctx->in_npend = 0;
+	ctx->in_nwait = 0;
+	ctx->ioc_events &= ~RTSER_EVENT_RXPEND;
+
+	ctx->out_head = 0;
+	ctx->out_tail = 0;
+	ctx->out_npend = 0;
+}
+
+static int rt_16550_map_ring(struct rt_16550_context *ctx,
+			     rtdm_user_info_t *user_info, void *arg)
+{
+	size_t ctl_size = RT_16550_RING_CTL_SIZE;
+	struct rt_16550_ring *ring;
+	struct rtser_ring_map map;
+	rtdm_lockctx_t lock_ctx;
+	void *uaddr = NULL;
+	int err;
+
+	/* The mapping is done by Linux on behalf of a user process. */
+	if (rtdm_in_rt_context())
+		return -ENOSYS;
+	if (!user_info)
+		return -EINVAL;
+
+	err = rtdm_safe_copy_from_user(user_info, &map, arg,
+				       sizeof(struct rtser_ring_map));
+	if (err)
+		return err;
+
+	if (map.rx_watermark <= 0 || map.rx_watermark > IN_BUFFER_SIZE)
+		return -EINVAL;
+
+	ring = kmalloc(sizeof(*ring), GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+
+	ring->size = PAGE_ALIGN(ctl_size + IN_BUFFER_SIZE + OUT_BUFFER_SIZE);
+	ring->ctl = vmalloc(ring->size);
+	if (!ring->ctl) {
+		kfree(ring);
+		return -ENOMEM;
+	}
+
+	memset(ring->ctl, 0, ring->size);
+	ring->ctl->rx_size = IN_BUFFER_SIZE;
+	ring->ctl->tx_size = OUT_BUFFER_SIZE;
+	ring->ctl->rx_offset = ctl_size;
+	ring->ctl->tx_offset = ctl_size + IN_BUFFER_SIZE;
+
+	/* One reference for the context, one for the user mapping. */
+	atomic_set(&ring->refcount, 2);
+
+	/* Keep readers and ring waiters away while switching modes. */
+	if (test_and_set_bit(0, &ctx->in_lock)) {
+		err = -EBUSY;
+		goto free_out;
+	}
+
+	if (ctx->ring) {
+		err = -EBUSY;
+		goto unlock_out;
+	}
+
+	err = rtdm_mmap_to_user(user_info, ring->ctl, ring->size,
+				PROT_READ | PROT_WRITE, &uaddr,
+				&rt_16550_ring_vmops, ring);
+	if (err)
+		goto unlock_out;
+
+	rtdm_lock_get_irqsave(&ctx->lock, lock_ctx);
+	ctx->ring_watermark = map.rx_watermark;
+	rt_16550_ring_switch(ctx, ring);
+	rtdm_lock_put_irqrestore(&ctx->lock, lock_ctx);
+
+	clear_bit(0, &ctx->in_lock);
+
+	map.size = ring->size;
+	map.ctl = uaddr;
+
+	return rtdm_safe_copy_to_user(user_info, arg, &map,
+				      sizeof(struct rtser_ring_map));
+
+      unlock_out:
+	clear_bit(0, &ctx->in_lock);
+
+      free_out:
+	vfree(ring->ctl);
+	kfree(ring);
+
+	return err;
+}
+
+static int rt_16550_unmap_ring(struct rt_16550_context *ctx)
+{
+	struct rt_16550_ring *ring;
+	rtdm_lockctx_t lock_ctx;
+
+	if (rtdm_in_rt_context())
+		return -ENOSYS;
+
+	if (test_and_set_bit(0, &ctx->in_lock))
+		return -EBUSY;
+
+	ring = ctx->ring;
+	if (ring) {
+		rtdm_lock_get_irqsave(&ctx->lock, lock_ctx);
+		rt_16550_ring_switch(ctx, NULL);
+		rtdm_lock_put_irqrestore(&ctx->lock, lock_ctx);
+	}
+
+	clear_bit(0, &ctx->in_lock);
+
+	if (!ring)
+		return -EINVAL;
+
+	/*
+	 * The user mapping keeps the area alive until the application
+	 * munmaps it.
+	 */
+	rt_16550_ring_put(ring);
+
+	return 0;
+}
+
+static int rt_16550_sync_ring(struct rt_16550_context *ctx, int ops)
+{
+	int mode = rt_16550_io_mode_from_ctx(ctx);
+	unsigned long base = ctx->base_addr;
+	rtdm_toseq_t timeout_seq;
+	rtdm_lockctx_t lock_ctx;
+	int ret;
+
+	if (testbits(ops, RTSER_RING_WAIT_RX) && !rtdm_in_rt_context())
+		return -ENOSYS;
+
+	/* Ring waiters exclude each other like readers do. */
+	if (test_and_set_bit(0, &ctx->in_lock))
+		return -EBUSY;
+
+	rtdm_toseq_init(&timeout_seq, ctx->config.rx_timeout);
+
+	rtdm_lock_get_irqsave(&ctx->lock, lock_ctx);
+
+	if (!ctx->ring_ctl) {
+		ret = -EINVAL;
+		goto unlock_out;
+	}
+
+	rt_16550_ring_pull(ctx);
+
+	if (testbits(ops, RTSER_RING_KICK_TX) && ctx->out_npend > 0 &&
+	    !testbits(ctx->ier_status, IER_TX)) {
+		/* unmask tx interrupt */
+		ctx->ier_status |= IER_TX;
+		rt_16550_reg_out(mode, base, IER, ctx->ier_status);
+	}
+
+	while (1) {
+		ret = ctx->in_npend;
+
+		if (!testbits(ops, RTSER_RING_WAIT_RX))
+			break;
+
+		/* switch on error interrupt - the user is ready to listen */
+		if (!testbits(ctx->ier_status, IER_STAT)) {
+			ctx->ier_status |= IER_STAT;
+			rt_16550_reg_out(mode, base, IER, ctx->ier_status);
+		}
+
+		if (ctx->status) {
+			if (testbits(ctx->status, RTSER_LSR_BREAK_IND))
+				ret = -EPIPE;
+			else
+				ret = -EIO;
+			ctx->saved_errors = ctx->status &
+			    (RTSER_LSR_OVERRUN_ERR | RTSER_LSR_PARITY_ERR |
+			     RTSER_LSR_FRAMING_ERR | RTSER_SOFT_OVERRUN_ERR);
+			ctx->status = 0;
+			break;
+		}
+
+		if (ctx->in_npend >= ctx->ring_watermark)
+			break;
+
+		if (ctx->config.rx_timeout < 0) {
+			ret = -EAGAIN;
+			break;
+		}
+
+		ctx->in_nwait = ctx->ring_watermark - ctx->in_npend;
+
+		rtdm_lock_put_irqrestore(&ctx->lock, lock_ctx);
+
+		ret = rtdm_event_timedwait(&ctx->in_event,
+					   ctx->config.rx_timeout,
+					   &timeout_seq);
+		if (ret == -EIDRM)
+			/* Device has been closed - return immediately. */
+			return -EBADF;
+
+		rtdm_lock_get_irqsave(&ctx->lock, lock_ctx);
+
+		if (ret < 0) {
+			ctx->in_nwait = 0;
+			break;
+		}
+
+		rt_16550_ring_pull(ctx);
+	}
+
+      unlock_out:
+	rtdm_lock_put_irqrestore(&ctx->lock, lock_ctx);
+
+	clear_bit(0, &ctx->in_lock);
+
+	return ret;
+}
+
 void rt_16550_cleanup_ctx(struct rt_16550_context *ctx)
 {
 	rtdm_event_destroy(&ctx->in_event);
@@ -469,10 +826,15 @@ int rt_16550_open(struct rtdm_dev_context *context,
 	ctx->in_nwait = 0;
 	ctx->in_lock = 0;
 	ctx->in_history = NULL;
+	ctx->in_data = ctx->in_buf;
 
 	ctx->out_head = 0;
 	ctx->out_tail = 0;
 	ctx->out_npend = 0;
+	ctx->out_data = ctx->out_buf;
+
+	ctx->ring = NULL;
+	ctx->ring_ctl = NULL;
 
 	ctx->ioc_events = 0;
 	ctx->ioc_event_lock = 0;
@@ -481,17 +843,25 @@ int rt_16550_open(struct rtdm_dev_context *context,
 
 	rt_16550_set_config(ctx, &default_config, &dummy);
 
+	ctx->polled = 0;
+	if (irq_poll_rate[dev_id]) {
+		err = rtdm_irqpoll_init(&ctx->irq_poll, &ctx->irq_handle,
+					rt_16550_poll, irq_poll_rate[dev_id],
+					irq_poll_period * 1000ULL,
+					irq_poll_prio,
+					context->device->proc_name);
+		if (err)
+			goto cleanup_out;
+		ctx->polled = 1;
+	}
+
 	err = rtdm_irq_request(&ctx->irq_handle, irq[dev_id],
 			       rt_16550_interrupt, irqtype[dev_id],
 			       context->device->proc_name, ctx);
 	if (err) {
-		/* reset DTR and RTS */
-		rt_16550_reg_out(rt_16550_io_mode_from_ctx(ctx), ctx->base_addr,
-				 MCR, 0);
-
-		rt_16550_cleanup_ctx(ctx);
-
-		return err;
+		if (ctx->polled)
+			rtdm_irqpoll_destroy(&ctx->irq_poll);
+		goto cleanup_out;
 	}
 
 	rtdm_lock_get_irqsave(&ctx->lock, lock_ctx);
@@ -504,6 +874,14 @@ int rt_16550_open(struct rtdm_dev_context *context,
 	rtdm_lock_put_irqrestore(&ctx->lock, lock_ctx);
 
 	return 0;
+
+cleanup_out:
+	/* reset DTR and RTS */
+	rt_16550_reg_out(rt_16550_io_mode_from_ctx(ctx), ctx->base_addr, MCR, 0);
+
+	rt_16550_cleanup_ctx(ctx);
+
+	return err;
 }
 
 int rt_16550_close(struct rtdm_dev_context *context,
@@ -538,6 +916,12 @@ int rt_16550_close(struct rtdm_dev_context *context,
 
 	rtdm_irq_free(&ctx->irq_handle);
 
+	if (ctx->polled)
+		rtdm_irqpoll_destroy(&ctx->irq_poll);
+
+	if (ctx->ring)
+		rt_16550_ring_put(ctx->ring);
+
 	rt_16550_cleanup_ctx(ctx);
 
 	kfree(in_history);
@@ -763,16 +1147,30 @@ int rt_16550_ioctl(struct rtdm_dev_context *context,
 
 		rtdm_lock_get_irqsave(&ctx->lock, lock_ctx);
 		if ((long)arg & RTDM_PURGE_RX_BUFFER) {
-			ctx->in_head = 0;
-			ctx->in_tail = 0;
+			if (ctx->ring_ctl) {
+				/* The application owns the head index. */
+				ctx->ring_ctl->rx_tail = ctx->ring_ctl->rx_head;
+				ctx->in_tail = ctx->ring_ctl->rx_tail &
+					(IN_BUFFER_SIZE - 1);
+			} else {
+				ctx->in_head = 0;
+				ctx->in_tail = 0;
+			}
 			ctx->in_npend = 0;
 			ctx->status = 0;
 			fcr |= FCR_FIFO | FCR_RESET_RX;
 			rt_16550_reg_in(mode, base, RHR);
 		}
 		if ((long)arg & RTDM_PURGE_TX_BUFFER) {
-			ctx->out_head = 0;
-			ctx->out_tail = 0;
+			if (ctx->ring_ctl) {
+				/* The application owns the tail index. */
+				ctx->ring_ctl->tx_head = ctx->ring_ctl->tx_tail;
+				ctx->out_head = ctx->ring_ctl->tx_head &
+					(OUT_BUFFER_SIZE - 1);
+			} else {
+				ctx->out_head = 0;
+				ctx->out_tail = 0;
+			}
 			ctx->out_npend = 0;
 			fcr |= FCR_FIFO | FCR_RESET_TX;
 		}
@@ -785,6 +1183,18 @@ int rt_16550_ioctl(struct rtdm_dev_context *context,
 		break;
 	}
 
+	case RTSER_RTIOC_MAP_RING:
+		err = rt_16550_map_ring(ctx, user_info, arg);
+		break;
+
+	case RTSER_RTIOC_UNMAP_RING:
+		err = rt_16550_unmap_ring(ctx);
+		break;
+
+	case RTSER_RTIOC_SYNC_RING:
+		err = rt_16550_sync_ring(ctx, (long)arg);
+		break;
+
 	default:
 		err = -ENOTTY;
 	}
@@ -824,6 +1234,12 @@ ssize_t rt_16550_read(struct rtdm_dev_context * context,
 	if (test_and_set_bit(0, &ctx->in_lock))
 		return -EBUSY;
 
+	/* The application reads mapped rings directly. */
+	if (ctx->ring) {
+		clear_bit(0, &ctx->in_lock);
+		return -EBUSY;
+	}
+
 	rtdm_lock_get_irqsave(&ctx->lock, lock_ctx);
 
 	while (1) {
@@ -990,6 +1406,13 @@ ssize_t rt_16550_write(struct rtdm_dev_context * context,
 	while (nbyte > 0) {
 		rtdm_lock_get_irqsave(&ctx->lock, lock_ctx);
 
+		/* The application writes mapped rings directly. */
+		if (ctx->ring) {
+			rtdm_lock_put_irqrestore(&ctx->lock, lock_ctx);
+			ret = -EBUSY;
+			break;
+		}
+
 		free = OUT_BUFFER_SIZE - ctx->out_npend;
 
 		if (free > 0) {
@@ -1039,6 +1462,14 @@ ssize_t rt_16550_write(struct rtdm_dev_context * context,
 
 			rtdm_lock_get_irqsave(&ctx->lock, lock_ctx);
 
+			/* Rings mapped while we were copying? */
+			if (ctx->ring) {
+				rtdm_lock_put_irqrestore(&ctx->lock, lock_ctx);
+				written -= block;
+				ret = -EBUSY;
+				break;
+			}
+
 			ctx->out_tail =
 			    (ctx->out_tail + block) & (OUT_BUFFER_SIZE - 1);
 			ctx->out_npend += block;
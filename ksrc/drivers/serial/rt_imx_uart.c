@@ -93,6 +93,7 @@
 #define UCR2_STPB	(1<<6)	/* Stop */
 #define UCR2_WS		(1<<5)	/* Word size */
 #define UCR2_RTSEN	(1<<4)	/* Request to send interrupt enable */
+#define UCR2_ATEN	(1<<3)	/* Aging timer enable */
 #define UCR2_TXEN	(1<<2)	/* Transmitter enabled */
 #define UCR2_RXEN	(1<<1)	/* Receiver enabled */
 #define UCR2_SRST	(1<<0)	/* SW reset */
@@ -123,6 +124,7 @@
 #define UCR4_OREN	(1<<1)	/* Receiver overrun interrupt enable */
 #define UCR4_DREN	(1<<0)	/* Recv data ready interrupt enable */
 #define UFCR_RXTL_SHF	0	/* Receiver trigger level shift */
+#define UFCR_RXTL_MASK	0x3F	/* Receiver trigger is 6 bits wide */
 #define UFCR_RFDIV	(7<<7)	/* Reference freq divider mask */
 #define UFCR_RFDIV_REG(x)	(((x) < 7 ? 6 - (x) : 6) << 7)
 #define UFCR_TXTL_SHF	10	/* Transmitter trigger level shift */
@@ -243,6 +245,9 @@ struct rt_imx_uart_ctx {
 	struct rt_imx_uart_port *port;
 };
 
+/* RX trigger levels, indexed by RTSER_FIFO_DEPTH_xxx */
+static const int rx_trigger_levels[] = { 1, 4, 8, 14 };
+
 static const struct rtser_config default_config = {
 	.config_mask = 0xFFFF,
 	.baud_rate = RTSER_DEF_BAUD,
@@ -397,11 +402,15 @@ static int rt_imx_uart_int(rtdm_irq_t *irq_context)
 	ucr1 = readl(ctx->port->membase + UCR1);
 
 	/*
-	 * Read if there is data available
+	 * Read if there is data available, i.e. the trigger level was
+	 * reached or the line went idle with data left in the FIFO
 	 */
-	if (usr1 & USR1_RRDY) {
+	if (usr1 & (USR1_RRDY | USR1_AGTIM)) {
+		if (usr1 & USR1_AGTIM)
+			writel(USR1_AGTIM, ctx->port->membase + USR1);
 		rbytes += rt_imx_uart_rx_chars(ctx, &timestamp);
-		events |= RTSER_EVENT_RXPEND;
+		if (rbytes)
+			events |= RTSER_EVENT_RXPEND;
 		ret = RTDM_IRQ_HANDLED;
 	}
 
@@ -554,6 +563,8 @@ static int rt_imx_uart_set_config(struct rt_imx_uart_ctx *ctx,
 		ctx->config.parity = config->parity & PARITY_MASK;
 	if (testbits(config->config_mask, RTSER_SET_STOP_BITS))
 		ctx->config.stop_bits = config->stop_bits & STOP_BITS_MASK;
+	if (testbits(config->config_mask, RTSER_SET_FIFO_DEPTH))
+		ctx->config.fifo_depth = config->fifo_depth & FIFO_MASK;
 
 	/* Timeout manipulation is not atomic. The user is supposed to take
 	   care not to use and change timeouts at the same time. */
@@ -611,11 +622,13 @@ static int rt_imx_uart_set_config(struct rt_imx_uart_ctx *ctx,
 					   RTSER_SET_PARITY |
 					   RTSER_SET_DATA_BITS |
 					   RTSER_SET_STOP_BITS |
+					   RTSER_SET_FIFO_DEPTH |
 					   RTSER_SET_EVENT_MASK |
 					   RTSER_SET_HANDSHAKE))) {
 		struct rt_imx_uart_port *port = ctx->port;
 		unsigned int ucr2, old_ucr1, old_txrxen;
 		unsigned int baud = ctx->config.baud_rate;
+		int rxtl = rx_trigger_levels[ctx->config.fifo_depth >> 6];
 		unsigned int div, ufcr;
 		unsigned long num, denom;
 		uint64_t tdiv64;
@@ -632,6 +645,14 @@ static int rt_imx_uart_set_config(struct rt_imx_uart_ctx *ctx,
 			}
 		}
 
+		/*
+		 * Above a single byte, the aging timer flushes what is
+		 * left in the RX FIFO once the line is idle for 8
+		 * character times.
+		 */
+		if (rxtl > 1)
+			ucr2 |= UCR2_ATEN;
+
 		if (ctx->config.stop_bits == RTSER_2_STOPB)
 			ucr2 |= UCR2_STPB;
 		if (ctx->config.parity == RTSER_ODD_PARITY ||
@@ -673,7 +694,8 @@ static int rt_imx_uart_set_config(struct rt_imx_uart_ctx *ctx,
 		denom -= 1;
 
 		ufcr = readl(port->membase + UFCR);
-		ufcr = (ufcr & (~UFCR_RFDIV)) | UFCR_RFDIV_REG(div);
+		ufcr = (ufcr & ~(UFCR_RFDIV | UFCR_RXTL_MASK)) |
+			UFCR_RFDIV_REG(div) | rxtl << UFCR_RXTL_SHF;
 
 		if (port->use_dcedte)
 			ufcr |= UFCR_DCEDTE;
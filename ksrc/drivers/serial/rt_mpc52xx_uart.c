@@ -43,6 +43,11 @@ MODULE_LICENSE("GPL");
 #define FIFO_MASK		0xC0
 #define EVENT_MASK		0x0F
 
+#define PSC_FIFO_SIZE		512
+
+/* idle line detection, in character times */
+#define RX_IDLE_CHARS		4
+
 
 struct rt_mpc52xx_uart_port {
 	const struct device *dev;
@@ -88,6 +93,10 @@ struct rt_mpc52xx_uart_ctx {
 	unsigned int imr_status;	/* interrupt mask register cache */
 	int tx_empty;			/* shift register empty flag */
 
+	int rx_trigger;			/* RX FIFO alarm level */
+	nanosecs_rel_t rx_idle;		/* idle line timeout */
+	rtdm_timer_t rx_timer;		/* idle line timer */
+
 	struct rt_mpc52xx_uart_port *port; /* Port related data */
 };
 
@@ -107,6 +116,9 @@ static const struct rtser_config default_config = {
 	.rs485 = RTSER_DEF_RS485,
 };
 
+/* RX trigger levels, indexed by RTSER_FIFO_DEPTH_xxx */
+static const int rx_trigger_levels[] = { 1, 4, 8, 14 };
+
 /* lookup table for matching device nodes to index numbers */
 static struct device_node *rt_mpc52xx_uart_nodes[MPC52xx_PSC_MAXNUM];
 
@@ -118,6 +130,13 @@ static inline void psc_fifo_init(struct rt_mpc52xx_uart_ctx *ctx)
 	out_be16(&ctx->port->fifo->tfalarm, 0x80);
 }
 
+/* raise the FIFO alarm once @level bytes are received */
+static inline void psc_set_rx_alarm(struct rt_mpc52xx_uart_ctx *ctx,
+				    int level)
+{
+	out_be16(&ctx->port->fifo->rfalarm, PSC_FIFO_SIZE - level);
+}
+
 static inline int psc_raw_rx_rdy(struct rt_mpc52xx_uart_ctx *ctx)
 {
 	return in_be16(&ctx->port->psc->mpc52xx_psc_status) &
@@ -350,6 +369,21 @@ static inline int rt_mpc52xx_uart_tx_interrupt(struct rt_mpc52xx_uart_ctx *ctx)
 	return ctx->out_npend;
 }
 
+/*
+ * The PSC has no receiver timeout, so the FIFO alarm is only raised to
+ * the trigger level while data is flowing. Once the line went idle,
+ * this timer lowers it to a single byte again, so that the interrupt
+ * handler flushes what is left in the FIFO right away and the next
+ * burst is noticed on its first byte.
+ */
+static void rt_mpc52xx_uart_rx_timer(rtdm_timer_t *timer)
+{
+	struct rt_mpc52xx_uart_ctx *ctx =
+		container_of(timer, struct rt_mpc52xx_uart_ctx, rx_timer);
+
+	psc_set_rx_alarm(ctx, 1);
+}
+
 static int rt_mpc52xx_uart_interrupt(rtdm_irq_t *irq_context)
 {
 	struct rt_mpc52xx_uart_ctx *ctx;
@@ -358,6 +392,7 @@ static int rt_mpc52xx_uart_interrupt(rtdm_irq_t *irq_context)
 	int events = 0;
 	int ret = RTDM_IRQ_NONE;
 	int goon = 1;
+	int rx_arm = 0;
 	int n;
 
 	ctx = rtdm_irq_get_arg(irq_context, struct rt_mpc52xx_uart_ctx);
@@ -372,6 +407,10 @@ static int rt_mpc52xx_uart_interrupt(rtdm_irq_t *irq_context)
 			if (n) {
 				rbytes += n;
 				events |= RTSER_EVENT_RXPEND;
+				if (ctx->rx_trigger > 1) {
+					psc_set_rx_alarm(ctx, ctx->rx_trigger);
+					rx_arm = 1;
+				}
 			}
 		}
 		if (psc_tx_rdy(ctx))
@@ -445,6 +484,10 @@ static int rt_mpc52xx_uart_interrupt(rtdm_irq_t *irq_context)
 
 	rtdm_lock_put(&ctx->lock);
 
+	if (rx_arm)
+		rtdm_timer_start(&ctx->rx_timer, ctx->rx_idle, 0,
+				 RTDM_TIMERMODE_RELATIVE);
+
 	return ret;
 }
 
@@ -469,10 +512,13 @@ static int rt_mpc52xx_uart_set_config(struct rt_mpc52xx_uart_ctx *ctx,
 		ctx->config.stop_bits = config->stop_bits & STOP_BITS_MASK;
 	if (testbits(config->config_mask, RTSER_SET_HANDSHAKE))
 		ctx->config.handshake = config->handshake;
+	if (testbits(config->config_mask, RTSER_SET_FIFO_DEPTH))
+		ctx->config.fifo_depth = config->fifo_depth & FIFO_MASK;
 
 	if (testbits(config->config_mask, RTSER_SET_PARITY |
 		     RTSER_SET_DATA_BITS | RTSER_SET_STOP_BITS |
-		     RTSER_SET_BAUD | RTSER_SET_HANDSHAKE)) {
+		     RTSER_SET_BAUD | RTSER_SET_HANDSHAKE |
+		     RTSER_SET_FIFO_DEPTH)) {
 		struct mpc52xx_psc *psc = ctx->port->psc;
 		unsigned char mr1 = 0, mr2 = 0;
 		unsigned int divisor;
@@ -514,6 +560,17 @@ static int rt_mpc52xx_uart_set_config(struct rt_mpc52xx_uart_ctx *ctx,
 		else
 			mr2 |= MPC52xx_PSC_MODE_ONE_STOP;
 
+		/*
+		 * Interrupt on FIFO alarm instead of each received
+		 * byte when a trigger level is set.
+		 */
+		ctx->rx_trigger = rx_trigger_levels[ctx->config.fifo_depth >> 6];
+		if (ctx->rx_trigger > 1)
+			mr1 |= MPC52xx_PSC_MODE_FFULL;
+		ctx->rx_idle = RX_IDLE_CHARS * 11 * 1000000 /
+			ctx->config.baud_rate * 1000;
+		psc_set_rx_alarm(ctx, 1);
+
 		if (ctx->config.handshake == RTSER_RTSCTS_HAND) {
 			mr1 |= MPC52xx_PSC_MODE_RXRTS;
 			mr2 |= MPC52xx_PSC_MODE_TXCTS;
@@ -636,6 +693,7 @@ void rt_mpc52xx_uart_cleanup_ctx(struct rt_mpc52xx_uart_ctx *ctx)
 	rtdm_event_destroy(&ctx->out_event);
 	rtdm_event_destroy(&ctx->ioc_event);
 	rtdm_mutex_destroy(&ctx->out_lock);
+	rtdm_timer_destroy(&ctx->rx_timer);
 }
 
 static int rt_mpc52xx_uart_open(struct rtdm_dev_context *context,
@@ -655,6 +713,9 @@ static int rt_mpc52xx_uart_open(struct rtdm_dev_context *context,
 	rtdm_event_init(&ctx->out_event, 0);
 	rtdm_event_init(&ctx->ioc_event, 0);
 	rtdm_mutex_init(&ctx->out_lock);
+	rtdm_timer_init(&ctx->rx_timer, rt_mpc52xx_uart_rx_timer,
+			context->device->device_name);
+	ctx->rx_trigger = 1;
 
 	ctx->in_head = 0;
 	ctx->in_tail = 0;
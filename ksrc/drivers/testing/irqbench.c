@@ -65,6 +65,8 @@ struct rt_irqbench_context {
 	unsigned int port_irq;
 	unsigned int toggle;
 	struct rttst_irqbench_stats stats;
+	nanosecs_abs_t irq_date;
+	struct rttst_hdr_histogram *hdr;
 	rtdm_irq_t irq_handle;
 	rtdm_event_t irq_event;
 	rtdm_task_t irq_task;
@@ -82,6 +84,7 @@ MODULE_AUTHOR("jan.kiszka@web.de");
 
 static inline int rt_irqbench_check_irq(struct rt_irqbench_context *ctx)
 {
+	nanosecs_abs_t date = rtdm_clock_read_monotonic();
 	int status;
 
 	switch (ctx->port_type) {
@@ -103,6 +106,7 @@ static inline int rt_irqbench_check_irq(struct rt_irqbench_context *ctx)
 		break;
 	}
 	ctx->stats.irqs_received++;
+	ctx->irq_date = date;
 	return 1;
 }
 
@@ -122,6 +126,14 @@ static inline void rt_irqbench_hwreply(struct rt_irqbench_context *ctx)
 	}
 	xntrace_special(0xBE, 0);
 	ctx->stats.irqs_acknowledged++;
+
+	/* Account for the IRQ-to-reply delay. */
+	if (ctx->irq_date && ctx->hdr) {
+		ctx->hdr->counts[rttst_hdr_index(rtdm_clock_read_monotonic() -
+						 ctx->irq_date)]++;
+		ctx->hdr->total++;
+		ctx->irq_date = 0;
+	}
 }
 
 static void rt_irqbench_task(void *arg)
@@ -175,6 +187,16 @@ static inline void do_rt_irqbench_domain_entry(void)
 
 static RTHAL_DECLARE_DOMAIN(rt_irqbench_domain_entry);
 
+static void rt_irqbench_set_affinity(struct rt_irqbench_context *ctx, int cpu)
+{
+	xnarch_cpumask_t cpumask = xnarch_cpumask_of_cpu(cpu);
+
+	if (ctx->mode == RTTST_IRQBENCH_HARD_IRQ)
+		xnarch_set_irq_affinity(ctx->port_irq, cpumask);
+	else
+		xnintr_affinity(&ctx->irq_handle, cpumask);
+}
+
 static int rt_irqbench_stop(struct rt_irqbench_context *ctx)
 {
 	if (ctx->mode < 0)
@@ -215,6 +237,7 @@ static int rt_irqbench_open(struct rtdm_dev_context *context,
 
 	ctx = (struct rt_irqbench_context *)context->dev_private;
 	ctx->mode = -1;
+	ctx->hdr = NULL;
 	rtdm_event_init(&ctx->irq_event, 0);
 	sema_init(&ctx->nrt_mutex, 1);
 
@@ -230,6 +253,8 @@ static int rt_irqbench_close(struct rtdm_dev_context *context,
 	down(&ctx->nrt_mutex);
 	rt_irqbench_stop(ctx);
 	rtdm_event_destroy(&ctx->irq_event);
+	kfree(ctx->hdr);
+	ctx->hdr = NULL;
 	up(&ctx->nrt_mutex);
 
 	return 0;
@@ -261,13 +286,35 @@ static int rt_irqbench_ioctl_nrt(struct rtdm_dev_context *context,
 		if (config->port_type > RTTST_IRQBENCH_PARPORT)
 			return -EINVAL;
 
+		if (config->cpu >= 0 &&
+		    (config->cpu >= XNARCH_NR_CPUS ||
+		     !xnarch_cpu_supported(config->cpu)))
+			return -EINVAL;
+
 		down(&ctx->nrt_mutex);
 
 		if (test_bit(RTDM_CLOSING, &context->context_flags))
 			goto unlock_start_out;
 
+		if (ctx->mode >= 0) {
+			err = -EBUSY;
+			goto unlock_start_out;
+		}
+
+		if (ctx->hdr == NULL) {
+			ctx->hdr = kzalloc(sizeof(*ctx->hdr), GFP_KERNEL);
+			if (ctx->hdr == NULL) {
+				err = -ENOMEM;
+				goto unlock_start_out;
+			}
+		} else
+			memset(ctx->hdr, 0, sizeof(*ctx->hdr));
+
+		ctx->irq_date = 0;
+
 		ctx->port_type = config->port_type;
 		ctx->port_ioaddr = config->port_ioaddr;
+		ctx->port_irq = config->port_irq;
 
 		/* Initialise hardware */
 		switch (ctx->port_type) {
@@ -348,7 +395,6 @@ static int rt_irqbench_ioctl_nrt(struct rtdm_dev_context *context,
 			if (err)
 				break;
 
-			ctx->port_irq = config->port_irq;
 			err =
 			    rthal_virtualize_irq(&ctx->domain,
 						 config->port_irq,
@@ -382,6 +428,9 @@ static int rt_irqbench_ioctl_nrt(struct rtdm_dev_context *context,
 
 			memset(&ctx->stats, 0, sizeof(ctx->stats));
 
+			if (config->cpu >= 0)
+				rt_irqbench_set_affinity(ctx, config->cpu);
+
 			/* Arm IRQ */
 			switch (ctx->port_type) {
 			case RTTST_IRQBENCH_SERPORT:
@@ -414,6 +463,24 @@ static int rt_irqbench_ioctl_nrt(struct rtdm_dev_context *context,
 			*(struct rttst_irqbench_stats *)arg = ctx->stats;
 		break;
 
+	case RTTST_RTIOC_IRQBENCH_GET_HDR:
+		/*
+		 * The histogram may be sampled while the benchmark
+		 * runs, in which case the counts may lag behind by a
+		 * few IRQs.
+		 */
+		down(&ctx->nrt_mutex);
+		if (ctx->hdr == NULL)
+			err = -ENODATA;
+		else if (user_info)
+			err = rtdm_safe_copy_to_user(user_info, arg, ctx->hdr,
+						     sizeof(*ctx->hdr));
+		else
+			memcpy((struct rttst_hdr_histogram *)arg, ctx->hdr,
+			       sizeof(*ctx->hdr));
+		up(&ctx->nrt_mutex);
+		break;
+
 	case RTTST_RTIOC_IRQBENCH_WAIT_IRQ:
 		err = -ENOSYS;
 		break;
@@ -450,6 +517,7 @@ static int rt_irqbench_ioctl_rt(struct rtdm_dev_context *context,
 	case RTTST_RTIOC_IRQBENCH_START:
 	case RTTST_RTIOC_IRQBENCH_STOP:
 	case RTTST_RTIOC_IRQBENCH_GET_STATS:
+	case RTTST_RTIOC_IRQBENCH_GET_HDR:
 		err = -ENOSYS;
 		break;
 
@@ -480,7 +548,7 @@ static struct rtdm_device device = {
 	.device_sub_class  = RTDM_SUBCLASS_IRQBENCH,
 	.profile_version   = RTTST_PROFILE_VER,
 	.driver_name       = "xeno_irqbench",
-	.driver_version    = RTDM_DRIVER_VER(0, 1, 1),
+	.driver_version    = RTDM_DRIVER_VER(0, 2, 0),
 	.peripheral_name   = "IRQ Latency Benchmark",
 	.provider_name     = "Jan Kiszka",
 	.proc_name         = device.device_name,
@@ -97,6 +97,7 @@ static int __init klat_mod_init(void)
 	pkt.config.warmup_loops = 1;
 	pkt.config.histogram_size = 0;
 	pkt.config.freeze_max = freeze_max;
+	pkt.config.flags = 0;
 
 	for (dev_nr = 0; dev_nr < DEV_NR_MAX; dev_nr++) {
 		snprintf(devname, sizeof(devname),
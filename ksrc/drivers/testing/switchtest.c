@@ -17,6 +17,25 @@ typedef struct {
 	unsigned last_switch;
 } rtswitch_task_t;
 
+/*
+ * Cross-CPU ping-pong: the waker stamps the TSC and signals the wakee
+ * pinned to another CPU, which goes through the remote rescheduling
+ * path (i.e. the reschedule IPI). The wakee records how long it took
+ * to resume, then signals the waker back.
+ */
+struct rtswitch_xcpu {
+	rtdm_task_t waker;
+	rtdm_task_t wakee;
+	rtdm_event_t waker_synch;
+	rtdm_event_t wakee_synch;
+	unsigned long count;
+	nanosecs_rel_t period;
+	int stop;
+	unsigned long long stamp;
+	unsigned long long rtt_min, rtt_max, rtt_sum;
+	struct rttst_hdr_histogram hdr;
+};
+
 typedef struct rtswitch_context {
 	rtswitch_task_t *tasks;
 	unsigned tasks_count;
@@ -34,6 +53,8 @@ typedef struct rtswitch_context {
 
 	rtswitch_task_t *utask;
 	rtdm_nrtsig_t wake_utask;
+
+	struct rtswitch_xcpu *xcpu;
 } rtswitch_context_t;
 
 static unsigned int start_index;
@@ -498,6 +519,125 @@ static int rtswitch_create_ktask(rtswitch_context_t *ctx,
 	return err;
 }
 
+static void rtswitch_xcpu_waker(void *arg)
+{
+	struct rtswitch_xcpu *x = arg;
+	unsigned long long t0, rtt;
+	unsigned long n;
+
+	for (n = 0; n < x->count; n++) {
+		if (x->period && rtdm_task_sleep(x->period))
+			break;
+
+		t0 = xnarch_get_cpu_tsc();
+		x->stamp = t0;
+		rtdm_event_signal(&x->wakee_synch);
+
+		if (rtdm_event_wait(&x->waker_synch))
+			break;
+
+		rtt = xnarch_get_cpu_tsc() - t0;
+		if (rtt < x->rtt_min)
+			x->rtt_min = rtt;
+		if (rtt > x->rtt_max)
+			x->rtt_max = rtt;
+		x->rtt_sum += rtt;
+	}
+
+	x->count = n;
+	x->stop = 1;
+	rtdm_event_signal(&x->wakee_synch);
+}
+
+static void rtswitch_xcpu_wakee(void *arg)
+{
+	struct rtswitch_xcpu *x = arg;
+	long long ns;
+
+	for (;;) {
+		if (rtdm_event_wait(&x->wakee_synch) || x->stop)
+			break;
+
+		/* Clamp the readings of slightly skewed TSCs. */
+		ns = xnarch_tsc_to_ns(xnarch_get_cpu_tsc() - x->stamp);
+		if (ns < 0)
+			ns = 0;
+		x->hdr.counts[rttst_hdr_index(ns)]++;
+		x->hdr.total++;
+
+		rtdm_event_signal(&x->waker_synch);
+	}
+}
+
+static int rtswitch_xcpu_run(rtswitch_context_t *ctx,
+			     struct rttst_swtest_xcpu *arg)
+{
+	struct rtswitch_xcpu *x;
+	int err;
+
+	if (arg->count == 0 ||
+	    arg->from_cpu >= xnarch_num_online_cpus() ||
+	    arg->to_cpu >= xnarch_num_online_cpus() ||
+	    !xnarch_cpu_supported(arg->from_cpu) ||
+	    !xnarch_cpu_supported(arg->to_cpu))
+		return -EINVAL;
+
+	x = vmalloc(sizeof(*x));
+	if (x == NULL)
+		return -ENOMEM;
+
+	memset(x, 0, sizeof(*x));
+	x->count = arg->count;
+	x->period = (nanosecs_rel_t)arg->period_us * 1000;
+	x->rtt_min = ~0ULL;
+	rtdm_event_init(&x->waker_synch, 0);
+	rtdm_event_init(&x->wakee_synch, 0);
+
+	err = rtdm_task_init_cpu(&x->wakee, "swtest-wakee", rtswitch_xcpu_wakee,
+				 x, RTDM_TASK_HIGHEST_PRIORITY, 0, arg->to_cpu);
+	if (err)
+		goto out;
+
+	err = rtdm_task_init_cpu(&x->waker, "swtest-waker", rtswitch_xcpu_waker,
+				 x, RTDM_TASK_HIGHEST_PRIORITY, 0,
+				 arg->from_cpu);
+	if (err) {
+		x->stop = 1;
+		rtdm_event_signal(&x->wakee_synch);
+		rtdm_task_join_nrt(&x->wakee, 100);
+		goto out;
+	}
+
+	rtdm_task_join_nrt(&x->waker, 100);
+	rtdm_task_join_nrt(&x->wakee, 100);
+
+	arg->count = x->count;
+	if (x->count) {
+		arg->rtt_min = xnarch_tsc_to_ns(x->rtt_min);
+		arg->rtt_max = xnarch_tsc_to_ns(x->rtt_max);
+		arg->rtt_sum = xnarch_tsc_to_ns(x->rtt_sum);
+	} else
+		arg->rtt_min = arg->rtt_max = arg->rtt_sum = 0;
+
+  out:
+	rtdm_event_destroy(&x->wakee_synch);
+	rtdm_event_destroy(&x->waker_synch);
+
+	if (err) {
+		vfree(x);
+		return err;
+	}
+
+	/* Keep the histogram for RTTST_RTIOC_SWTEST_XCPU_GET_HDR. */
+	down(&ctx->lock);
+	if (ctx->xcpu)
+		vfree(ctx->xcpu);
+	ctx->xcpu = x;
+	up(&ctx->lock);
+
+	return 0;
+}
+
 static void rtswitch_utask_waker(rtdm_nrtsig_t sig, void *arg)
 {
 	rtswitch_context_t *ctx = (rtswitch_context_t *)arg;
@@ -517,6 +657,7 @@ static int rtswitch_open(struct rtdm_dev_context *context,
 	ctx->failed = 0;
 	ctx->error.last_switch.from = ctx->error.last_switch.to = -1;
 	ctx->pause_us = 0;
+	ctx->xcpu = NULL;
 
 	err = rtdm_nrtsig_init(&ctx->wake_utask, rtswitch_utask_waker, ctx);
 	if (err)
@@ -545,6 +686,8 @@ static int rtswitch_close(struct rtdm_dev_context *context,
 		}
 		vfree(ctx->tasks);
 	}
+	if (ctx->xcpu)
+		vfree(ctx->xcpu);
 	rtdm_timer_destroy(&ctx->wake_up_delay);
 	rtdm_nrtsig_destroy(&ctx->wake_utask);
 
@@ -559,6 +702,7 @@ static int rtswitch_ioctl_nrt(struct rtdm_dev_context *context,
 	rtswitch_context_t *ctx = (rtswitch_context_t *) context->dev_private;
 	struct rttst_swtest_task task;
 	struct rttst_swtest_dir fromto;
+	struct rttst_swtest_xcpu xcpu;
 	unsigned long count;
 	int err;
 
@@ -650,6 +794,39 @@ static int rtswitch_ioctl_nrt(struct rtdm_dev_context *context,
 
 		return 0;
 
+	case RTTST_RTIOC_SWTEST_XCPU_RUN:
+		if (!rtdm_rw_user_ok(user_info, arg, sizeof(xcpu)))
+			return -EFAULT;
+
+		rtdm_copy_from_user(user_info, &xcpu, arg, sizeof(xcpu));
+
+		err = rtswitch_xcpu_run(ctx, &xcpu);
+
+		if (!err)
+			rtdm_copy_to_user(user_info,
+					  arg,
+					  &xcpu,
+					  sizeof(xcpu));
+
+		return err;
+
+	case RTTST_RTIOC_SWTEST_XCPU_GET_HDR:
+		if (!rtdm_rw_user_ok(user_info, arg, sizeof(ctx->xcpu->hdr)))
+			return -EFAULT;
+
+		err = -ENODATA;
+		down(&ctx->lock);
+		if (ctx->xcpu) {
+			rtdm_copy_to_user(user_info,
+					  arg,
+					  &ctx->xcpu->hdr,
+					  sizeof(ctx->xcpu->hdr));
+			err = 0;
+		}
+		up(&ctx->lock);
+
+		return err;
+
 	default:
 		return -ENOTTY;
 	}
@@ -668,6 +845,8 @@ static int rtswitch_ioctl_rt(struct rtdm_dev_context *context,
 	case RTTST_RTIOC_SWTEST_REGISTER_UTASK:
 	case RTTST_RTIOC_SWTEST_CREATE_KTASK:
 	case RTTST_RTIOC_SWTEST_GET_SWITCHES_COUNT:
+	case RTTST_RTIOC_SWTEST_XCPU_RUN:
+	case RTTST_RTIOC_SWTEST_XCPU_GET_HDR:
 		return -ENOSYS;
 
 	case RTTST_RTIOC_SWTEST_PEND:
@@ -739,7 +918,7 @@ static struct rtdm_device device = {
 	device_sub_class: RTDM_SUBCLASS_SWITCHTEST,
 	profile_version: RTTST_PROFILE_VER,
 	driver_name: "xeno_switchtest",
-	driver_version: RTDM_DRIVER_VER(0, 1, 1),
+	driver_version: RTDM_DRIVER_VER(0, 1, 2),
 	peripheral_name: "Context Switch Test",
 	provider_name: "Gilles Chanteperdrix",
 	proc_name: device.device_name,
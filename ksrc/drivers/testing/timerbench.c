@@ -23,6 +23,7 @@
 
 #include <rtdm/rttesting.h>
 #include <rtdm/rtdm_driver.h>
+#include <nucleus/pod.h>
 
 struct rt_tmbench_context {
 	int mode;
@@ -35,6 +36,15 @@ struct rt_tmbench_context {
 	long *histogram_avg;
 	int histogram_size;
 	int bucketsize;
+	struct rttst_hdr_histogram *hdr;
+	struct rttst_hdr_histogram *hdr_spare;
+	rtdm_lock_t hdr_lock;
+
+#ifdef CONFIG_XENO_OPT_STATS_PHASES
+	int phased;
+	struct rttst_phase_stats phases;
+	rtdm_lock_t phase_lock;
+#endif /* CONFIG_XENO_OPT_STATS_PHASES */
 
 	rtdm_task_t timer_task;
 
@@ -67,11 +77,131 @@ static inline void add_histogram(struct rt_tmbench_context *ctx,
 		  inabs : ctx->histogram_size - 1]++;
 }
 
+static inline void add_hdr(struct rt_tmbench_context *ctx, long dt)
+{
+	rtdm_lockctx_t lock_ctx;
+
+	/* Serializes with rt_tmbench_rotate_hdr(). */
+	rtdm_lock_get_irqsave(&ctx->hdr_lock, lock_ctx);
+	ctx->hdr->counts[rttst_hdr_index(dt)]++;
+	ctx->hdr->total++;
+	rtdm_lock_put_irqrestore(&ctx->hdr_lock, lock_ctx);
+}
+
 static inline long long slldiv(long long s, unsigned d)
 {
 	return s >= 0 ? xnarch_ulldiv(s, d, NULL) : -xnarch_ulldiv(-s, d, NULL);
 }
 
+#ifdef CONFIG_XENO_OPT_STATS_PHASES
+
+static inline int phase_bucket(long ns)
+{
+	int bucket;
+
+	if (ns <= 0)
+		return 0;
+
+	bucket = (u64)ns >> 32 ? RTTST_PHASE_BUCKETS - 1 : fls((u32)ns);
+
+	return bucket < RTTST_PHASE_BUCKETS ? bucket : RTTST_PHASE_BUCKETS - 1;
+}
+
+/*
+ * Break the latency of a sample down using the stamps the nucleus
+ * left on the current CPU on its way from the timer interrupt. The
+ * due date and sampling date are in ns; @switched tells whether the
+ * sampling code was woken up, or ran from the timer handler.
+ *
+ * The stamps are only meaningful if nothing went through the same
+ * path meanwhile: a timer firing in the same tick after ours moves
+ * the timer stamp forward, a later tick all of them. Samples which
+ * stamps are out of order, or older than a period, are skipped.
+ */
+static void account_phases(struct rt_tmbench_context *ctx,
+			   uint64_t date, uint64_t now, int switched)
+{
+	struct rttst_phase_stats *st = &ctx->phases;
+	uint64_t stamps[RTTST_NR_PHASES + 1];
+	long dt[RTTST_NR_PHASES];
+	rtdm_lockctx_t lock_ctx;
+	struct xnsched *sched;
+	int n, i;
+
+	memset(dt, 0, sizeof(dt));
+
+	rtdm_lock_get_irqsave(&ctx->phase_lock, lock_ctx);
+
+	sched = xnpod_current_sched();
+	stamps[0] = date;
+	stamps[1] = xnarch_tsc_to_ns(sched->phase_stamps[XNSCHED_PHASE_IRQ]);
+	stamps[2] = xnarch_tsc_to_ns(sched->phase_stamps[XNSCHED_PHASE_TIMER]);
+	n = 3;
+	if (switched) {
+		stamps[n++] =
+			xnarch_tsc_to_ns(sched->phase_stamps[XNSCHED_PHASE_SCHED]);
+		stamps[n++] =
+			xnarch_tsc_to_ns(sched->phase_stamps[XNSCHED_PHASE_SWITCH]);
+	}
+	stamps[n] = now;
+
+	/* The due date is the only one which may follow the others. */
+	for (i = 1; i < n; i++)
+		if ((int64_t)(stamps[i + 1] - stamps[i]) < 0)
+			goto skip;
+
+	if (now - stamps[1] >= ctx->period)
+		goto skip;
+
+	for (i = 0; i < n; i++) {
+		dt[i] = (long)(stamps[i + 1] - stamps[i]);
+		st->counts[i][phase_bucket(dt[i])]++;
+		st->sum[i] += dt[i];
+		if (dt[i] > st->max[i])
+			st->max[i] = dt[i];
+	}
+
+	st->samples++;
+	if ((long)(now - date) > st->worst) {
+		st->worst = (long)(now - date);
+		memcpy(st->worst_phases, dt, sizeof(dt));
+	}
+
+	rtdm_lock_put_irqrestore(&ctx->phase_lock, lock_ctx);
+
+	return;
+
+  skip:
+	st->skipped++;
+	rtdm_lock_put_irqrestore(&ctx->phase_lock, lock_ctx);
+}
+
+static void reset_phases(struct rt_tmbench_context *ctx)
+{
+	rtdm_lockctx_t lock_ctx;
+
+	rtdm_lock_get_irqsave(&ctx->phase_lock, lock_ctx);
+	memset(&ctx->phases, 0, sizeof(ctx->phases));
+	ctx->phases.worst = -10000000;
+	rtdm_lock_put_irqrestore(&ctx->phase_lock, lock_ctx);
+}
+
+static inline void sample_phases(struct rt_tmbench_context *ctx,
+				 uint64_t now, int switched)
+{
+	if (ctx->phased && !ctx->warmup)
+		account_phases(ctx, ctx->date, now, switched);
+}
+
+#else /* !CONFIG_XENO_OPT_STATS_PHASES */
+
+static inline void sample_phases(struct rt_tmbench_context *ctx,
+				 uint64_t now, int switched)
+{
+}
+
+#endif /* !CONFIG_XENO_OPT_STATS_PHASES */
+
 static void eval_inner_loop(struct rt_tmbench_context *ctx, long dt)
 {
 	if (dt > ctx->curr.max)
@@ -93,12 +223,20 @@ static void eval_inner_loop(struct rt_tmbench_context *ctx, long dt)
 	if (!ctx->warmup && ctx->histogram_size)
 		add_histogram(ctx, ctx->histogram_avg, dt);
 
+	if (!ctx->warmup && ctx->hdr)
+		add_hdr(ctx, dt);
+
 	/* Evaluate overruns and adjust next release date.
 	   Beware of signedness! */
 	while (dt > 0 && (unsigned long)dt > ctx->period) {
 		ctx->curr.overruns++;
 		ctx->date += ctx->period;
 		dt -= ctx->period;
+		/* Account for the samples the missed periods would have
+		   taken, so that the tail is not under-reported
+		   (coordinated omission). */
+		if (!ctx->warmup && ctx->hdr)
+			add_hdr(ctx, dt);
 	}
 }
 
@@ -142,6 +280,7 @@ static void eval_outer_loop(struct rt_tmbench_context *ctx)
 static void timer_task_proc(void *arg)
 {
 	struct rt_tmbench_context *ctx = arg;
+	uint64_t now;
 	int count;
 
 	/* first event: one millisecond from now. */
@@ -161,9 +300,9 @@ static void timer_task_proc(void *arg)
 			if (err)
 				return;
 
-			eval_inner_loop(ctx,
-					(long)(rtdm_clock_read_monotonic() -
-					       ctx->date));
+			now = rtdm_clock_read_monotonic();
+			sample_phases(ctx, now, 1);
+			eval_inner_loop(ctx, (long)(now - ctx->date));
 		}
 		eval_outer_loop(ctx);
 	}
@@ -173,11 +312,13 @@ static void timer_proc(rtdm_timer_t *timer)
 {
 	struct rt_tmbench_context *ctx =
 	    container_of(timer, struct rt_tmbench_context, timer);
+	uint64_t now;
 	int err;
 
 	do {
-		eval_inner_loop(ctx, (long)(rtdm_clock_read_monotonic() -
-					    ctx->date));
+		now = rtdm_clock_read_monotonic();
+		sample_phases(ctx, now, 0);
+		eval_inner_loop(ctx, (long)(now - ctx->date));
 
 		ctx->start_time = rtdm_clock_read_monotonic();
 		err = rtdm_timer_start_in_handler(&ctx->timer, ctx->date, 0,
@@ -198,6 +339,14 @@ static int rt_tmbench_open(struct rtdm_dev_context *context,
 	ctx = (struct rt_tmbench_context *)context->dev_private;
 
 	ctx->mode = RTTST_TMBENCH_INVALID;
+	ctx->hdr = NULL;
+	ctx->hdr_spare = NULL;
+	rtdm_lock_init(&ctx->hdr_lock);
+#ifdef CONFIG_XENO_OPT_STATS_PHASES
+	ctx->phased = 0;
+	rtdm_lock_init(&ctx->phase_lock);
+	reset_phases(ctx);
+#endif /* CONFIG_XENO_OPT_STATS_PHASES */
 	sema_init(&ctx->nrt_mutex, 1);
 
 	return 0;
@@ -227,6 +376,12 @@ static int rt_tmbench_close(struct rtdm_dev_context *context,
 		ctx->histogram_size = 0;
 	}
 
+	/* The HDR histogram survives TMBENCH_STOP, drop it now. */
+	kfree(ctx->hdr);
+	kfree(ctx->hdr_spare);
+	ctx->hdr = NULL;
+	ctx->hdr_spare = NULL;
+
 	up(&ctx->nrt_mutex);
 
 	return 0;
@@ -252,6 +407,17 @@ static int rt_tmbench_start(struct rtdm_dev_context *context,
 		config = &config_buf;
 	}
 
+	if ((config->flags & RTTST_TMBENCH_CPU) &&
+	    (config->mode != RTTST_TMBENCH_TASK ||
+	     config->cpu < 0 || config->cpu >= XNARCH_NR_CPUS ||
+	     !xnarch_cpu_supported(config->cpu)))
+		return -EINVAL;
+
+#ifndef CONFIG_XENO_OPT_STATS_PHASES
+	if (config->flags & RTTST_TMBENCH_PHASES)
+		return -EOPNOTSUPP;
+#endif /* !CONFIG_XENO_OPT_STATS_PHASES */
+
 	down(&ctx->nrt_mutex);
 
 	ctx->period = config->period;
@@ -279,6 +445,22 @@ static int rt_tmbench_start(struct rtdm_dev_context *context,
 		ctx->bucketsize = config->histogram_bucketsize;
 	}
 
+	kfree(ctx->hdr);
+	kfree(ctx->hdr_spare);
+	ctx->hdr = NULL;
+	ctx->hdr_spare = NULL;
+
+	if (config->flags & RTTST_TMBENCH_HDR) {
+		ctx->hdr = kzalloc(sizeof(*ctx->hdr), GFP_KERNEL);
+		if (!ctx->hdr) {
+			if (ctx->histogram_size > 0)
+				kfree(ctx->histogram_min);
+			ctx->histogram_size = 0;
+			up(&ctx->nrt_mutex);
+			return -ENOMEM;
+		}
+	}
+
 	ctx->result.overall.min = 10000000;
 	ctx->result.overall.max = -10000000;
 	ctx->result.overall.avg = 0;
@@ -293,13 +475,27 @@ static int rt_tmbench_start(struct rtdm_dev_context *context,
 	ctx->curr.overruns = 0;
 	ctx->mode = RTTST_TMBENCH_INVALID;
 
+#ifdef CONFIG_XENO_OPT_STATS_PHASES
+	ctx->phased = !!(config->flags & RTTST_TMBENCH_PHASES);
+	if (ctx->phased)
+		reset_phases(ctx);
+#endif /* CONFIG_XENO_OPT_STATS_PHASES */
+
 	rtdm_event_init(&ctx->result_event, 0);
 
 	if (config->mode == RTTST_TMBENCH_TASK) {
 		if (!test_bit(RTDM_CLOSING, &context->context_flags)) {
-			err = rtdm_task_init(&ctx->timer_task, "timerbench",
-					     timer_task_proc, ctx,
-					     config->priority, 0);
+			if (config->flags & RTTST_TMBENCH_CPU)
+				err = rtdm_task_init_cpu(&ctx->timer_task,
+							 "timerbench",
+							 timer_task_proc, ctx,
+							 config->priority, 0,
+							 config->cpu);
+			else
+				err = rtdm_task_init(&ctx->timer_task,
+						     "timerbench",
+						     timer_task_proc, ctx,
+						     config->priority, 0);
 			if (!err)
 				ctx->mode = RTTST_TMBENCH_TASK;
 		}
@@ -407,6 +603,147 @@ static int rt_tmbench_stop(struct rt_tmbench_context *ctx,
 	return err;
 }
 
+/*
+ * The HDR histogram is only retrieved once the benchmark is stopped,
+ * so that the copy does not race with the sampling code.
+ */
+static int rt_tmbench_get_hdr(struct rt_tmbench_context *ctx,
+			      rtdm_user_info_t *user_info,
+			      struct rttst_hdr_histogram __user *user_hdr)
+{
+	int err = 0;
+
+	down(&ctx->nrt_mutex);
+
+	if (ctx->mode >= 0)
+		err = -EBUSY;
+	else if (ctx->hdr == NULL)
+		err = -ENODATA;
+	else if (user_info)
+		err = rtdm_safe_copy_to_user(user_info, user_hdr, ctx->hdr,
+					     sizeof(*ctx->hdr));
+	else
+		memcpy((struct rttst_hdr_histogram *)user_hdr, ctx->hdr,
+		       sizeof(*ctx->hdr));
+
+	up(&ctx->nrt_mutex);
+
+	return err;
+}
+
+/*
+ * Hand over the HDR histogram collected so far and restart it from
+ * zero, without stopping the benchmark. This allows for monitoring
+ * over rolling windows.
+ */
+static int rt_tmbench_rotate_hdr(struct rt_tmbench_context *ctx,
+				 rtdm_user_info_t *user_info,
+				 struct rttst_hdr_histogram __user *user_hdr)
+{
+	struct rttst_hdr_histogram *hdr;
+	rtdm_lockctx_t lock_ctx;
+	int err = 0;
+
+	down(&ctx->nrt_mutex);
+
+	if (ctx->hdr == NULL) {
+		err = -ENODATA;
+		goto out;
+	}
+
+	if (ctx->hdr_spare == NULL) {
+		ctx->hdr_spare = kzalloc(sizeof(*ctx->hdr_spare), GFP_KERNEL);
+		if (ctx->hdr_spare == NULL) {
+			err = -ENOMEM;
+			goto out;
+		}
+	}
+
+	rtdm_lock_get_irqsave(&ctx->hdr_lock, lock_ctx);
+	hdr = ctx->hdr;
+	ctx->hdr = ctx->hdr_spare;
+	rtdm_lock_put_irqrestore(&ctx->hdr_lock, lock_ctx);
+
+	/* The sampling code no longer refers to the old histogram. */
+	if (user_info)
+		err = rtdm_safe_copy_to_user(user_info, user_hdr, hdr,
+					     sizeof(*hdr));
+	else
+		memcpy((struct rttst_hdr_histogram *)user_hdr, hdr,
+		       sizeof(*hdr));
+
+	memset(hdr, 0, sizeof(*hdr));
+	ctx->hdr_spare = hdr;
+  out:
+	up(&ctx->nrt_mutex);
+
+	return err;
+}
+
+/*
+ * Phase statistics may be read while sampling goes on, e.g. from a
+ * user-space benchmark feeding them through TMBENCH_PHASE_SAMPLE.
+ */
+static int rt_tmbench_get_phases(struct rt_tmbench_context *ctx,
+				 rtdm_user_info_t *user_info,
+				 struct rttst_phase_stats __user *user_stats)
+{
+#ifdef CONFIG_XENO_OPT_STATS_PHASES
+	struct rttst_phase_stats *stats;
+	rtdm_lockctx_t lock_ctx;
+	int err = 0;
+
+	stats = kmalloc(sizeof(*stats), GFP_KERNEL);
+	if (stats == NULL)
+		return -ENOMEM;
+
+	rtdm_lock_get_irqsave(&ctx->phase_lock, lock_ctx);
+	memcpy(stats, &ctx->phases, sizeof(*stats));
+	rtdm_lock_put_irqrestore(&ctx->phase_lock, lock_ctx);
+
+	if (user_info)
+		err = rtdm_safe_copy_to_user(user_info, user_stats, stats,
+					     sizeof(*stats));
+	else
+		memcpy((struct rttst_phase_stats *)user_stats, stats,
+		       sizeof(*stats));
+
+	kfree(stats);
+
+	return err;
+#else /* !CONFIG_XENO_OPT_STATS_PHASES */
+	return -EOPNOTSUPP;
+#endif /* !CONFIG_XENO_OPT_STATS_PHASES */
+}
+
+/*
+ * Break down a sample taken by the caller, right after it was woken
+ * up. Dates are TSC values.
+ */
+static int rt_tmbench_phase_sample(struct rt_tmbench_context *ctx,
+				   rtdm_user_info_t *user_info,
+				   struct rttst_phase_sample __user *user_sample)
+{
+#ifdef CONFIG_XENO_OPT_STATS_PHASES
+	struct rttst_phase_sample sample;
+
+	if (user_info) {
+		if (rtdm_safe_copy_from_user(user_info, &sample, user_sample,
+					     sizeof(sample)) < 0)
+			return -EFAULT;
+	} else
+		memcpy(&sample, (struct rttst_phase_sample *)user_sample,
+		       sizeof(sample));
+
+	account_phases(ctx, xnarch_tsc_to_ns(sample.date),
+		       xnarch_tsc_to_ns(sample.now), 1);
+
+	return 0;
+#else /* !CONFIG_XENO_OPT_STATS_PHASES */
+	return -EOPNOTSUPP;
+#endif /* !CONFIG_XENO_OPT_STATS_PHASES */
+}
+
 static int rt_tmbench_ioctl_nrt(struct rtdm_dev_context *context,
 				rtdm_user_info_t *user_info,
 				unsigned int request, void __user *arg)
@@ -425,7 +762,20 @@ static int rt_tmbench_ioctl_nrt(struct rtdm_dev_context *context,
 		err = rt_tmbench_stop(ctx, user_info, arg);
 		break;
 
+	case RTTST_RTIOC_TMBENCH_GET_HDR:
+		err = rt_tmbench_get_hdr(ctx, user_info, arg);
+		break;
+
+	case RTTST_RTIOC_TMBENCH_ROTATE_HDR:
+		err = rt_tmbench_rotate_hdr(ctx, user_info, arg);
+		break;
+
+	case RTTST_RTIOC_TMBENCH_GET_PHASES:
+		err = rt_tmbench_get_phases(ctx, user_info, arg);
+		break;
+
 	case RTTST_RTIOC_INTERM_BENCH_RES:
+	case RTTST_RTIOC_TMBENCH_PHASE_SAMPLE:
 		err = -ENOSYS;
 		break;
 
@@ -465,8 +815,15 @@ static int rt_tmbench_ioctl_rt(struct rtdm_dev_context *context,
 
 		break;
 
+	case RTTST_RTIOC_TMBENCH_PHASE_SAMPLE:
+		err = rt_tmbench_phase_sample(ctx, user_info, arg);
+		break;
+
 	case RTTST_RTIOC_TMBENCH_START:
 	case RTTST_RTIOC_TMBENCH_STOP:
+	case RTTST_RTIOC_TMBENCH_GET_HDR:
+	case RTTST_RTIOC_TMBENCH_ROTATE_HDR:
+	case RTTST_RTIOC_TMBENCH_GET_PHASES:
 		err = -ENOSYS;
 		break;
 
@@ -497,7 +854,7 @@ static struct rtdm_device device = {
 	.device_sub_class	= RTDM_SUBCLASS_TIMERBENCH,
 	.profile_version	= RTTST_PROFILE_VER,
 	.driver_name		= "xeno_timerbench",
-	.driver_version		= RTDM_DRIVER_VER(0, 2, 1),
+	.driver_version		= RTDM_DRIVER_VER(0, 2, 4),
 	.peripheral_name	= "Timer Latency Benchmark",
 	.provider_name		= "Jan Kiszka",
 	.proc_name		= device.device_name,
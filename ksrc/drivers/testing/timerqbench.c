@@ -0,0 +1,502 @@
+/*
+ * Xenomai is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <linux/module.h>
+#include <linux/vmalloc.h>
+#include <linux/delay.h>
+#include <linux/sched.h>
+
+#include <rtdm/rttesting.h>
+#include <rtdm/rtdm_driver.h>
+#include <nucleus/pod.h>
+#include <nucleus/timer.h>
+
+/*
+ * Timer queue scalability benchmark. A run loads the timer queue of
+ * one CPU with a given number of background timers, then measures:
+ *
+ * - the cost of xntimer_start() and xntimer_stop() on that queue,
+ *   as seen from the caller, nklock held;
+ * - the cost of processing each expiry, from a set of probe timers
+ *   all elapsing at the same date, thus within the same tick;
+ * - the lateness of the first probe handler past the due date,
+ *   i.e. of the head timer.
+ *
+ * The queue implementation is chosen when building the nucleus, so
+ * comparing them takes one kernel build per implementation. Runs
+ * execute from the Linux domain, each operation being measured with
+ * interrupts off.
+ */
+
+#define TQBENCH_PROBE_DELAY	1000000	/* ns */
+#define TQBENCH_PROBE_TIMEOUT	1000	/* ms */
+
+struct rt_tqbench_context {
+	struct semaphore nrt_mutex;
+	/* Updated by timer handlers, nklock held. */
+	unsigned long fired;
+	int probe_hits;
+	xnticks_t probe_first;
+	xnticks_t probe_last;
+};
+
+struct tqbench_timer {
+	xntimer_t timer;
+	struct rt_tqbench_context *ctx;
+};
+
+struct tqbench_acc {
+	long long min;
+	long long max;
+	long long sum;
+	unsigned long count;
+};
+
+static unsigned int start_index;
+
+module_param(start_index, uint, 0400);
+MODULE_PARM_DESC(start_index, "First device instance number to be used");
+
+MODULE_LICENSE("GPL");
+
+static inline long long slldiv(long long s, unsigned d)
+{
+	return s >= 0 ? xnarch_ulldiv(s, d, NULL) : -xnarch_ulldiv(-s, d, NULL);
+}
+
+static inline long long tsc_delta_ns(xnticks_t from, xnticks_t to)
+{
+	xnsticks_t delta = to - from;
+
+	return delta >= 0 ? (long long)xnarch_tsc_to_ns(delta) :
+		-(long long)xnarch_tsc_to_ns(-delta);
+}
+
+static void acc_init(struct tqbench_acc *acc)
+{
+	acc->min = LLONG_MAX;
+	acc->max = LLONG_MIN;
+	acc->sum = 0;
+	acc->count = 0;
+}
+
+static void acc_add(struct tqbench_acc *acc, long long v)
+{
+	if (v < acc->min)
+		acc->min = v;
+	if (v > acc->max)
+		acc->max = v;
+	acc->sum += v;
+	acc->count++;
+}
+
+static void acc_put(struct tqbench_acc *acc, struct rttst_tqbench_stat *stat)
+{
+	if (acc->count == 0) {
+		memset(stat, 0, sizeof(*stat));
+		return;
+	}
+
+	stat->min = acc->min;
+	stat->max = acc->max;
+	stat->avg = slldiv(acc->sum, acc->count);
+}
+
+/* xorshift32, so that runs are reproducible from their seed. */
+static inline u32 tqbench_rand(u32 *state)
+{
+	u32 x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+
+	return x;
+}
+
+/* Random value in [0, span), span may exceed 32 bits. */
+static inline u64 tqbench_rand_span(u32 *state, u64 span)
+{
+	u32 r = tqbench_rand(state);
+
+	return (span >> 32) * r + (((span & 0xffffffffULL) * r) >> 32);
+}
+
+static void tqbench_background_handler(xntimer_t *timer)
+{
+	struct tqbench_timer *t = container_of(timer, struct tqbench_timer, timer);
+
+	t->ctx->fired++;
+}
+
+static void tqbench_probe_handler(xntimer_t *timer)
+{
+	struct tqbench_timer *t = container_of(timer, struct tqbench_timer, timer);
+	struct rt_tqbench_context *ctx = t->ctx;
+	xnticks_t now = xnarch_get_cpu_tsc();
+
+	if (ctx->probe_hits++ == 0)
+		ctx->probe_first = now;
+	ctx->probe_last = now;
+}
+
+static inline int tqbench_backend(void)
+{
+#if defined(CONFIG_XENO_OPT_TIMER_HEAP)
+	return RTTST_TQBENCH_HEAP;
+#elif defined(CONFIG_XENO_OPT_TIMER_WHEEL)
+	return RTTST_TQBENCH_WHEEL;
+#elif defined(CONFIG_XENO_OPT_TIMER_HWHEEL)
+	return RTTST_TQBENCH_HWHEEL;
+#else
+	return RTTST_TQBENCH_LIST;
+#endif
+}
+
+static int tqbench_check_config(struct rttst_tqbench_config *config)
+{
+	if (config->cpu < 0 || config->cpu >= XNARCH_NR_CPUS ||
+	    !xnarch_cpu_supported(config->cpu))
+		return -EINVAL;
+
+	if (config->nr_timers > RTTST_TQBENCH_MAX_TIMERS ||
+	    config->probes < 1 || config->probes > RTTST_TQBENCH_MAX_PROBES ||
+	    config->loops < 1 || config->delay < 0 || config->span <= 0)
+		return -EINVAL;
+
+	if (config->mode != RTTST_TQBENCH_RANDOM &&
+	    config->mode != RTTST_TQBENCH_PERIODIC)
+		return -EINVAL;
+
+#ifdef CONFIG_XENO_OPT_TIMER_HEAP
+	/* Leave room in the fixed-size heap for the system timers. */
+	if (config->nr_timers + config->probes >
+	    CONFIG_XENO_OPT_TIMER_HEAP_CAPACITY / 2)
+		return -ENOSPC;
+#endif /* CONFIG_XENO_OPT_TIMER_HEAP */
+
+	return 0;
+}
+
+static void tqbench_init_timers(struct rt_tqbench_context *ctx,
+				struct tqbench_timer *timers, unsigned long nr,
+				void (*handler)(xntimer_t *), int cpu)
+{
+	unsigned long n;
+
+	for (n = 0; n < nr; n++) {
+		timers[n].ctx = ctx;
+		xntimer_init(&timers[n].timer, &nktbase, handler);
+		xntimer_set_name(&timers[n].timer, "timerqbench");
+		xntimer_set_sched(&timers[n].timer, xnpod_sched_slot(cpu));
+		if ((n & 1023) == 1023)
+			cond_resched();
+	}
+}
+
+static void tqbench_destroy_timers(struct tqbench_timer *timers,
+				   unsigned long nr)
+{
+	unsigned long n;
+
+	for (n = 0; n < nr; n++) {
+		xntimer_destroy(&timers[n].timer);
+		if ((n & 1023) == 1023)
+			cond_resched();
+	}
+}
+
+static int tqbench_probe(struct rt_tqbench_context *ctx,
+			 struct tqbench_timer *probes, int nr,
+			 struct tqbench_acc *expiry, struct tqbench_acc *head)
+{
+	xnticks_t due, first, last;
+	xnticks_t date;
+	int n, hits, waited;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	ctx->probe_hits = 0;
+	date = xnarch_tsc_to_ns(xnarch_get_cpu_tsc()) + TQBENCH_PROBE_DELAY;
+	due = xnarch_ns_to_tsc(date);
+	for (n = 0; n < nr; n++)
+		xntimer_start(&probes[n].timer, date, XN_INFINITE, XN_ABSOLUTE);
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	for (waited = 0; waited <= TQBENCH_PROBE_TIMEOUT; waited++) {
+		msleep(1);
+
+		xnlock_get_irqsave(&nklock, s);
+		hits = ctx->probe_hits;
+		first = ctx->probe_first;
+		last = ctx->probe_last;
+		xnlock_put_irqrestore(&nklock, s);
+
+		if (hits == nr)
+			break;
+	}
+
+	if (hits < nr) {
+		xnlock_get_irqsave(&nklock, s);
+		for (n = 0; n < nr; n++)
+			xntimer_stop(&probes[n].timer);
+		xnlock_put_irqrestore(&nklock, s);
+		return -ETIMEDOUT;
+	}
+
+	acc_add(head, tsc_delta_ns(due, first));
+	if (nr > 1)
+		acc_add(expiry, slldiv(tsc_delta_ns(first, last), nr - 1));
+
+	return 0;
+}
+
+static int rt_tqbench_run(struct rt_tqbench_context *ctx,
+			  struct rttst_tqbench_config *config,
+			  struct rttst_tqbench_res *res)
+{
+	struct tqbench_acc start, stop, expiry, head;
+	struct tqbench_timer *timers = NULL, *probes;
+	xnticks_t t0, t1, value, interval;
+	unsigned long n, nr = config->nr_timers;
+	u32 seed = config->seed ?: 1;
+	int loop, err;
+	spl_t s;
+
+	err = tqbench_check_config(config);
+	if (err)
+		return err;
+
+	if (nr > 0) {
+		timers = vmalloc(nr * sizeof(*timers));
+		if (timers == NULL)
+			return -ENOMEM;
+	}
+
+	probes = kmalloc(config->probes * sizeof(*probes), GFP_KERNEL);
+	if (probes == NULL) {
+		vfree(timers);
+		return -ENOMEM;
+	}
+
+	acc_init(&start);
+	acc_init(&stop);
+	acc_init(&expiry);
+	acc_init(&head);
+
+	xnlock_get_irqsave(&nklock, s);
+	ctx->fired = 0;
+	xnlock_put_irqrestore(&nklock, s);
+
+	tqbench_init_timers(ctx, timers, nr,
+			    tqbench_background_handler, config->cpu);
+	tqbench_init_timers(ctx, probes, config->probes,
+			    tqbench_probe_handler, config->cpu);
+
+	interval = config->mode == RTTST_TQBENCH_PERIODIC ?
+		config->span : XN_INFINITE;
+
+	for (n = 0; n < nr; n++) {
+		value = config->delay + tqbench_rand_span(&seed, config->span);
+
+		xnlock_get_irqsave(&nklock, s);
+		t0 = xnarch_get_cpu_tsc();
+		xntimer_start(&timers[n].timer, value, interval, XN_RELATIVE);
+		t1 = xnarch_get_cpu_tsc();
+		xnlock_put_irqrestore(&nklock, s);
+
+		acc_add(&start, tsc_delta_ns(t0, t1));
+
+		if ((n & 1023) == 1023) {
+			if (signal_pending(current)) {
+				err = -EINTR;
+				goto stop;
+			}
+			cond_resched();
+		}
+	}
+
+	for (loop = 0; loop < config->loops; loop++) {
+		if (signal_pending(current)) {
+			err = -EINTR;
+			goto stop;
+		}
+		err = tqbench_probe(ctx, probes, config->probes,
+				    &expiry, &head);
+		if (err)
+			goto stop;
+	}
+
+  stop:
+	for (n = 0; n < nr; n++) {
+		xnlock_get_irqsave(&nklock, s);
+		if (xntimer_running_p(&timers[n].timer)) {
+			t0 = xnarch_get_cpu_tsc();
+			xntimer_stop(&timers[n].timer);
+			t1 = xnarch_get_cpu_tsc();
+			xnlock_put_irqrestore(&nklock, s);
+			acc_add(&stop, tsc_delta_ns(t0, t1));
+		} else
+			xnlock_put_irqrestore(&nklock, s);
+
+		if ((n & 1023) == 1023)
+			cond_resched();
+	}
+
+	tqbench_destroy_timers(probes, config->probes);
+	tqbench_destroy_timers(timers, nr);
+	kfree(probes);
+	vfree(timers);
+
+	if (err)
+		return err;
+
+	acc_put(&start, &res->start);
+	acc_put(&stop, &res->stop);
+	acc_put(&expiry, &res->expiry);
+	acc_put(&head, &res->head);
+
+	xnlock_get_irqsave(&nklock, s);
+	res->fired = ctx->fired;
+	xnlock_put_irqrestore(&nklock, s);
+
+	res->backend = tqbench_backend();
+
+	return 0;
+}
+
+static int rt_tqbench_open(struct rtdm_dev_context *context,
+			   rtdm_user_info_t *user_info, int oflags)
+{
+	struct rt_tqbench_context *ctx;
+
+	ctx = (struct rt_tqbench_context *)context->dev_private;
+	sema_init(&ctx->nrt_mutex, 1);
+
+	return 0;
+}
+
+static int rt_tqbench_close(struct rtdm_dev_context *context,
+			    rtdm_user_info_t *user_info)
+{
+	/* Runs are synchronous, nothing may be left over. */
+	return 0;
+}
+
+static int rt_tqbench_ioctl_nrt(struct rtdm_dev_context *context,
+				rtdm_user_info_t *user_info,
+				unsigned int request, void __user *arg)
+{
+	struct rttst_tqbench_run __user *user_run = arg;
+	struct rt_tqbench_context *ctx;
+	struct rttst_tqbench_run run;
+	int err;
+
+	ctx = (struct rt_tqbench_context *)context->dev_private;
+
+	if (request != RTTST_RTIOC_TQBENCH_RUN)
+		return -ENOTTY;
+
+	if (user_info) {
+		if (rtdm_safe_copy_from_user(user_info, &run, user_run,
+					     sizeof(run)) < 0)
+			return -EFAULT;
+	} else
+		memcpy(&run, (struct rttst_tqbench_run *)user_run,
+		       sizeof(run));
+
+	memset(&run.res, 0, sizeof(run.res));
+
+	if (down_interruptible(&ctx->nrt_mutex))
+		return -ERESTARTSYS;
+
+	err = rt_tqbench_run(ctx, &run.config, &run.res);
+
+	up(&ctx->nrt_mutex);
+
+	if (err)
+		return err;
+
+	if (user_info)
+		return rtdm_safe_copy_to_user(user_info, &user_run->res,
+					      &run.res, sizeof(run.res));
+
+	memcpy(&((struct rttst_tqbench_run *)user_run)->res, &run.res,
+	       sizeof(run.res));
+
+	return 0;
+}
+
+static int rt_tqbench_ioctl_rt(struct rtdm_dev_context *context,
+			       rtdm_user_info_t *user_info,
+			       unsigned int request, void __user *arg)
+{
+	/* Runs may only proceed from the Linux domain. */
+	return request == RTTST_RTIOC_TQBENCH_RUN ? -ENOSYS : -ENOTTY;
+}
+
+static struct rtdm_device device = {
+	.struct_version		= RTDM_DEVICE_STRUCT_VER,
+
+	.device_flags		= RTDM_NAMED_DEVICE,
+	.context_size		= sizeof(struct rt_tqbench_context),
+	.device_name		= "",
+
+	.open_nrt		= rt_tqbench_open,
+
+	.ops = {
+		.close_nrt	= rt_tqbench_close,
+
+		.ioctl_rt	= rt_tqbench_ioctl_rt,
+		.ioctl_nrt	= rt_tqbench_ioctl_nrt,
+	},
+
+	.device_class		= RTDM_CLASS_TESTING,
+	.device_sub_class	= RTDM_SUBCLASS_TIMERQBENCH,
+	.profile_version	= RTTST_PROFILE_VER,
+	.driver_name		= "xeno_timerqbench",
+	.driver_version		= RTDM_DRIVER_VER(0, 1, 0),
+	.peripheral_name	= "Timer Queue Scalability Benchmark",
+	.provider_name		= "Xenomai",
+	.proc_name		= device.device_name,
+};
+
+static int __init __timerqbench_init(void)
+{
+	int err;
+
+	do {
+		snprintf(device.device_name, RTDM_MAX_DEVNAME_LEN,
+			 "rttest-timerqbench%d",
+			 start_index);
+		err = rtdm_dev_register(&device);
+
+		start_index++;
+	} while (err == -EEXIST);
+
+	return err;
+}
+
+static void __timerqbench_exit(void)
+{
+	rtdm_dev_unregister(&device, 1000);
+}
+
+module_init(__timerqbench_init);
+module_exit(__timerqbench_exit);
@@ -0,0 +1,371 @@
+/*!\file nucleus/budget.c
+ * \brief Per-thread CPU budget enforcement.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * \ingroup nucleus
+ */
+
+/*
+ * The watchdog only catches threads which starve Linux for seconds.
+ * A thread given a budget may only consume a quota of CPU time per
+ * period in primary mode, so that a runaway thread cannot eat the
+ * slack lower priority work depends on, whatever its priority.
+ *
+ * The CPU time of the current thread is timed by a per-CPU one-shot
+ * timer armed at switch-in for the time left in the current period,
+ * and charged at switch-out. When the timer fires, the quota is
+ * exhausted: the overrun is counted, and depending on the action
+ * chosen, the thread is demoted to a lower priority or held until
+ * its per-thread replenishment timer starts the next period.
+ */
+
+#include <nucleus/pod.h>
+#include <nucleus/vfile.h>
+#include <nucleus/budget.h>
+
+/* nklock held, interrupts off. */
+static void budget_arm(struct xnsched *sched, struct xnthread *thread)
+{
+	sched->bgstamp = xnarch_get_cpu_time();
+	xntimer_start(&sched->bgtimer, thread->budget.left,
+		      XN_INFINITE, XN_RELATIVE);
+}
+
+/* Undo the overrun action, nklock held. */
+static void budget_restore(struct xnthread *thread)
+{
+	struct xnbudget *b = &thread->budget;
+	union xnsched_policy_param param;
+
+	if (b->saved_prio >= 0) {
+		/* Unless the priority was changed meanwhile. */
+		if (thread->base_class == &xnsched_class_rt &&
+		    thread->bprio == b->demote_prio) {
+			param.rt.prio = b->saved_prio;
+			__xnpod_set_thread_schedparam(thread,
+						      &xnsched_class_rt,
+						      &param, 0);
+		}
+		b->saved_prio = -1;
+	}
+
+	if (b->held) {
+		b->held = 0;
+		xnpod_resume_thread(thread, XNHELD);
+	}
+}
+
+static void budget_overrun(struct xnthread *thread)
+{
+	struct xnbudget *b = &thread->budget;
+	union xnsched_policy_param param;
+
+	b->overruns++;
+
+	trace_mark(xn_nucleus, budget_overrun, "thread %p thread_name %s",
+		   thread, xnthread_name(thread));
+
+	switch (b->action) {
+	case XNBUDGET_DEMOTE:
+		/*
+		 * Only threads of the RT class are demoted, within
+		 * their class. The change is not propagated to the
+		 * Linux side, since it is undone by the next
+		 * replenishment.
+		 */
+		if (b->saved_prio >= 0 ||
+		    thread->base_class != &xnsched_class_rt ||
+		    thread->bprio <= b->demote_prio)
+			break;
+		b->saved_prio = thread->bprio;
+		param.rt.prio = b->demote_prio;
+		__xnpod_set_thread_schedparam(thread, &xnsched_class_rt,
+					      &param, 0);
+		break;
+
+	case XNBUDGET_SUSPEND:
+		b->held = 1;
+		xnpod_suspend_thread(thread, XNHELD,
+				     XN_INFINITE, XN_RELATIVE, NULL);
+		break;
+	}
+}
+
+/* nklock held, interrupts off. */
+void __xnbudget_switch(struct xnsched *sched,
+		       struct xnthread *prev, struct xnthread *next)
+{
+	struct xnbudget *b = &prev->budget;
+	xnticks_t elapsed;
+
+	/* The budget timer only ever runs on behalf of sched->curr. */
+	if (xntimer_running_p(&sched->bgtimer)) {
+		xntimer_stop(&sched->bgtimer);
+		elapsed = xnarch_get_cpu_time() - sched->bgstamp;
+		b->left = b->left > elapsed ? b->left - elapsed : 0;
+	}
+
+	/*
+	 * A thread which overran its quota with XNBUDGET_NOTIFY runs
+	 * untimed until the next period.
+	 */
+	if (next->budget.quota && next->budget.left)
+		budget_arm(sched, next);
+}
+
+static void budget_timer_handler(struct xntimer *timer)
+{
+	struct xnsched *sched = container_of(timer, struct xnsched, bgtimer);
+	struct xnthread *curr = sched->curr;
+
+	if (curr->budget.quota == 0)
+		return;
+
+	curr->budget.left = 0;
+	budget_overrun(curr);
+}
+
+static void budget_replenish_handler(struct xntimer *timer)
+{
+	struct xnbudget *b = container_of(timer, struct xnbudget, rtimer);
+	struct xnthread *thread = container_of(b, struct xnthread, budget);
+	struct xnsched *sched = thread->sched;
+	int running = sched == xnpod_current_sched() && sched->curr == thread;
+
+	/* What is left of the past period is lost. */
+	if (running)
+		xntimer_stop(&sched->bgtimer);
+
+	b->left = b->quota;
+	budget_restore(thread);
+
+	if (running)
+		budget_arm(sched, thread);
+}
+
+void xnbudget_init_thread(struct xnthread *thread)
+{
+	struct xnbudget *b = &thread->budget;
+
+	b->quota = 0;
+	b->period = 0;
+	b->left = 0;
+	b->action = XNBUDGET_NOTIFY;
+	b->demote_prio = XNSCHED_RT_MIN_PRIO;
+	b->saved_prio = -1;
+	b->held = 0;
+	b->overruns = 0;
+	xntimer_init(&b->rtimer, &nktbase, budget_replenish_handler);
+	xntimer_set_name(&b->rtimer, "[budget]");
+	xntimer_set_sched(&b->rtimer, thread->sched);
+}
+
+void xnbudget_destroy_thread(struct xnthread *thread)
+{
+	xntimer_destroy(&thread->budget.rtimer);
+}
+
+void xnbudget_init_sched(struct xnsched *sched)
+{
+	xntimer_init(&sched->bgtimer, &nktbase, budget_timer_handler);
+	xntimer_set_name(&sched->bgtimer, "[budget]");
+	xntimer_set_sched(&sched->bgtimer, sched);
+	sched->bgstamp = 0;
+}
+
+void xnbudget_destroy_sched(struct xnsched *sched)
+{
+	xntimer_destroy(&sched->bgtimer);
+}
+
+/**
+ * @fn int xnbudget_set(struct xnthread *thread, xnticks_t quota, xnticks_t period, int action, int demote_prio)
+ * @brief Set the CPU budget of a thread.
+ *
+ * @param thread The thread to update.
+ *
+ * @param quota The CPU time @a thread may consume in primary mode
+ * per @a period, in nanoseconds. Zero removes the budget.
+ *
+ * @param period The replenishment period in nanoseconds. A new
+ * period starts upon this call.
+ *
+ * @param action What happens to @a thread when it overruns its
+ * quota: XNBUDGET_NOTIFY only counts the overrun, XNBUDGET_DEMOTE
+ * lowers its base priority to @a demote_prio if it belongs to the
+ * RT class, XNBUDGET_SUSPEND holds it. Either way, the next period
+ * restores it.
+ *
+ * @param demote_prio The RT class priority to demote to.
+ *
+ * @return 0 is returned on success. Otherwise, -EINVAL is returned
+ * if @a thread is a root thread, or the parameters are invalid.
+ *
+ * Overruns are counted per thread, and reported by
+ * /proc/xenomai/budget.
+ */
+int xnbudget_set(struct xnthread *thread, xnticks_t quota,
+		 xnticks_t period, int action, int demote_prio)
+{
+	struct xnbudget *b = &thread->budget;
+	struct xnsched *sched;
+	spl_t s;
+
+	if (xnthread_test_state(thread, XNROOT) ||
+	    (quota && (period == 0 || quota > period)) ||
+	    action < XNBUDGET_NOTIFY || action > XNBUDGET_SUSPEND ||
+	    (action == XNBUDGET_DEMOTE &&
+	     (demote_prio < XNSCHED_RT_MIN_PRIO ||
+	      demote_prio > XNSCHED_RT_MAX_PRIO)))
+		return -EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	sched = thread->sched;
+	xntimer_stop(&b->rtimer);
+	if (sched->curr == thread)
+		xntimer_stop(&sched->bgtimer);
+	budget_restore(thread);
+
+	b->quota = quota;
+	b->period = period;
+	b->left = quota;
+	b->action = action;
+	b->demote_prio = demote_prio;
+
+	if (quota) {
+		xntimer_set_sched(&b->rtimer, sched);
+		xntimer_start(&b->rtimer, period, period, XN_RELATIVE);
+		if (sched->curr == thread)
+			budget_arm(sched, thread);
+	}
+
+	xnpod_schedule();
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(xnbudget_set);
+
+#ifdef CONFIG_XENO_OPT_VFILE
+
+struct vfile_budget_priv {
+	struct xnholder *curr;
+};
+
+struct vfile_budget_data {
+	int cpu;
+	pid_t pid;
+	xnticks_t quota;
+	xnticks_t period;
+	xnticks_t left;
+	int action;
+	unsigned long overruns;
+	char name[XNOBJECT_NAME_LEN];
+};
+
+static struct xnvfile_snapshot_ops vfile_budget_ops;
+
+static struct xnvfile_snapshot budget_vfile = {
+	.privsz = sizeof(struct vfile_budget_priv),
+	.datasz = sizeof(struct vfile_budget_data),
+	.tag = &nkpod_struct.threadlist_tag,
+	.ops = &vfile_budget_ops,
+};
+
+static int vfile_budget_rewind(struct xnvfile_snapshot_iterator *it)
+{
+	struct vfile_budget_priv *priv = xnvfile_iterator_priv(it);
+
+	priv->curr = getheadq(&nkpod->threadq);
+
+	return countq(&nkpod->threadq);
+}
+
+static int vfile_budget_next(struct xnvfile_snapshot_iterator *it, void *data)
+{
+	struct vfile_budget_priv *priv = xnvfile_iterator_priv(it);
+	struct vfile_budget_data *p = data;
+	struct xnthread *thread;
+
+	if (priv->curr == NULL)
+		return 0;	/* All done. */
+
+	thread = link2thread(priv->curr, glink);
+	priv->curr = nextq(&nkpod->threadq, priv->curr);
+
+	/* Threads which had a budget keep showing their overruns. */
+	if (thread->budget.quota == 0 && thread->budget.overruns == 0)
+		return VFILE_SEQ_SKIP;
+
+	p->cpu = xnsched_cpu(thread->sched);
+	p->pid = xnthread_user_pid(thread);
+	p->quota = thread->budget.quota;
+	p->period = thread->budget.period;
+	p->left = thread->budget.left;
+	p->action = thread->budget.action;
+	p->overruns = thread->budget.overruns;
+	memcpy(p->name, thread->name, sizeof(p->name));
+
+	return 1;
+}
+
+static int vfile_budget_show(struct xnvfile_snapshot_iterator *it, void *data)
+{
+	static const char *actions[] = {
+		[XNBUDGET_NOTIFY] = "notify",
+		[XNBUDGET_DEMOTE] = "demote",
+		[XNBUDGET_SUSPEND] = "suspend",
+	};
+	struct vfile_budget_data *p = data;
+
+	if (p == NULL)
+		xnvfile_printf(it, "%-3s  %-6s %-12s %-12s %-12s %-8s %-10s %s\n",
+			       "CPU", "PID", "QUOTA(ns)", "PERIOD(ns)",
+			       "LEFT(ns)", "ACTION", "OVERRUNS", "NAME");
+	else
+		xnvfile_printf(it, "%3u  %-6d %-12Lu %-12Lu %-12Lu %-8s %-10lu %s\n",
+			       p->cpu, p->pid, p->quota, p->period, p->left,
+			       actions[p->action], p->overruns, p->name);
+
+	return 0;
+}
+
+static struct xnvfile_snapshot_ops vfile_budget_ops = {
+	.rewind = vfile_budget_rewind,
+	.next = vfile_budget_next,
+	.show = vfile_budget_show,
+};
+
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+int xnbudget_mount(void)
+{
+#ifdef CONFIG_XENO_OPT_VFILE
+	return xnvfile_init_snapshot("budget", &budget_vfile, &nkvfroot);
+#else /* !CONFIG_XENO_OPT_VFILE */
+	return 0;
+#endif /* !CONFIG_XENO_OPT_VFILE */
+}
+
+void xnbudget_umount(void)
+{
+#ifdef CONFIG_XENO_OPT_VFILE
+	xnvfile_destroy_snapshot(&budget_vfile);
+#endif /* CONFIG_XENO_OPT_VFILE */
+}
@@ -299,7 +299,9 @@ EXPORT_SYMBOL_GPL(xnbufd_map_umem);
  *   xnbufd_map_uread()), the copy is performed only if that area
  *   lives in the currently active address space, and only if the
  *   caller may sleep Linux-wise to process any potential page fault
- *   which may arise while reading from that memory.
+ *   which may arise while reading from that memory. Transfers of at
+ *   least CONFIG_XENO_OPT_BUFD_NOCACHE_THRESHOLD bytes use
+ *   non-temporal stores to the kernel memory, if available.
  *
  * - any attempt to read from @a bufd from a non-suitable context is
  *   considered as a bug, and will raise a panic assertion when the
@@ -372,7 +374,7 @@ ssize_t xnbufd_copy_to_kmem(void *to, struct xnbufd *bufd, size_t len)
 	if (xnpod_userspace_p() && !xnpod_asynch_p() &&
 	    current->mm == bufd->b_mm) {
 		XENO_BUGON(NUCLEUS, xnlock_is_owner(&nklock) || spltest());
-		if (__xn_safe_copy_from_user(to, (void __user *)from, len))
+		if (__xn_safe_copy_from_user_bulk(to, (void __user *)from, len))
 			return -EFAULT;
 		goto advance_offset;
 	}
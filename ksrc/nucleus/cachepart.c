@@ -0,0 +1,342 @@
+/*!\file nucleus/cachepart.c
+ * \brief Cache partitioning for real-time CPUs and threads.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * \ingroup nucleus
+ */
+
+/*
+ * Linux activity evicts the working set of real-time threads from
+ * the last level cache, which shows as latency spikes under load.
+ * When the CPU partitions its cache into classes, each allowed a
+ * subset of the ways, real-time threads may be given classes of
+ * their own, so that Linux cannot evict what they fill.
+ *
+ * Classes are assigned per-thread, or per-CPU as a default for all
+ * real-time threads running there. The rescheduling procedure only
+ * writes the class register when the outgoing and incoming classes
+ * differ, the class Linux set being saved upon switching away from
+ * it and restored upon switching back to the root thread.
+ *
+ * Way masks may only be written locally. Each CPU reloads them the
+ * next time it switches classes after they changed, so that no
+ * cross-CPU call is needed.
+ */
+
+#include <nucleus/pod.h>
+#include <nucleus/vfile.h>
+#include <nucleus/cachepart.h>
+
+#define CACHEPART_MAX_CLASSES	16
+
+static int cachepart_nr_classes;
+
+static unsigned int cachepart_cbm_len;
+
+static unsigned long cachepart_masks[CACHEPART_MAX_CLASSES];
+
+static unsigned long cachepart_saved_masks[CACHEPART_MAX_CLASSES];
+
+static unsigned long cachepart_gen;
+
+/* nklock held, interrupts off. */
+static void cachepart_load_masks(struct xnsched *sched)
+{
+	int clos;
+
+	for (clos = 0; clos < cachepart_nr_classes; clos++)
+		xnarch_write_cachemask(clos, cachepart_masks[clos]);
+
+	sched->cpgen = cachepart_gen;
+}
+
+void __xncachepart_switch(struct xnsched *sched, int clos)
+{
+	if (sched->cpgen != cachepart_gen)
+		cachepart_load_masks(sched);
+
+	if (sched->cpcurrent < 0)
+		xnarch_read_cacheclass(sched->cplinux[0], sched->cplinux[1]);
+
+	xnarch_write_cacheclass(sched->cplinux[0],
+				clos < 0 ? sched->cplinux[1] : clos);
+	sched->cpcurrent = clos;
+}
+
+static inline int cachepart_valid_class(int clos)
+{
+	return clos >= -1 && clos < cachepart_nr_classes;
+}
+
+/**
+ * @fn int xncachepart_set_mask(int clos, unsigned long mask)
+ * @brief Set the cache ways of a class.
+ *
+ * @param clos The class to update.
+ *
+ * @param mask The ways the class may fill, which must be a non-empty
+ * set of contiguous bits. Class 0 is the one Linux runs with by
+ * default.
+ *
+ * @return 0 is returned on success. Otherwise, -ENODEV is returned
+ * if the CPU cannot partition its cache, -EINVAL if @a clos or @a
+ * mask is invalid.
+ *
+ * This service does not conflict with, but is not aware of the
+ * resctrl interface of Linux, which should not be used meanwhile.
+ */
+int xncachepart_set_mask(int clos, unsigned long mask)
+{
+	spl_t s;
+
+	if (cachepart_nr_classes == 0)
+		return -ENODEV;
+
+	if (clos < 0 || clos >= cachepart_nr_classes || mask == 0 ||
+	    (mask >> cachepart_cbm_len) != 0 ||
+	    ((mask + (mask & -mask)) & mask) != 0)
+		return -EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+	cachepart_masks[clos] = mask;
+	cachepart_gen++;
+	cachepart_load_masks(xnpod_current_sched());
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(xncachepart_set_mask);
+
+/**
+ * @fn int xncachepart_set_cpu(int cpu, int clos)
+ * @brief Set the default class of a CPU.
+ *
+ * Real-time threads with no class of their own run with the default
+ * class of their CPU.
+ *
+ * @param cpu The CPU to update.
+ *
+ * @param clos The default class, -1 for the class Linux runs with.
+ *
+ * @return 0 is returned on success. Otherwise, -EINVAL is returned
+ * if @a cpu or @a clos is invalid, -ENODEV if the nucleus is not
+ * started.
+ */
+int xncachepart_set_cpu(int cpu, int clos)
+{
+	struct xnsched *sched;
+	spl_t s;
+
+	if (cpu < 0 || cpu >= xnarch_num_online_cpus() ||
+	    !xnarch_cpu_supported(cpu) || !cachepart_valid_class(clos))
+		return -EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	/* Scheduler slots are reset when the nucleus starts. */
+	if (!xnpod_active_p()) {
+		xnlock_put_irqrestore(&nklock, s);
+		return -ENODEV;
+	}
+
+	sched = xnpod_sched_slot(cpu);
+	sched->cpdefault = clos;
+	/* Remote CPUs pick the change at their next switch. */
+	if (sched == xnpod_current_sched())
+		xncachepart_switch(sched, sched->curr);
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(xncachepart_set_cpu);
+
+/**
+ * @fn int xncachepart_set_thread(struct xnthread *thread, int clos)
+ * @brief Set the class of a thread.
+ *
+ * @param thread The thread to update.
+ *
+ * @param clos The class of @a thread, -1 for the default class of
+ * its CPU.
+ *
+ * @return 0 is returned on success, -EINVAL if @a clos is invalid.
+ */
+int xncachepart_set_thread(struct xnthread *thread, int clos)
+{
+	struct xnsched *sched;
+	spl_t s;
+
+	if (!cachepart_valid_class(clos))
+		return -EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	thread->cacheclass = clos;
+	sched = thread->sched;
+	if (sched == xnpod_current_sched() && sched->curr == thread)
+		xncachepart_switch(sched, thread);
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(xncachepart_set_thread);
+
+#ifdef CONFIG_XENO_OPT_VFILE
+
+static int cachepart_vfile_show(struct xnvfile_regular_iterator *it,
+				void *data)
+{
+	struct xnsched *sched;
+	int cpu, clos;
+
+	xnvfile_printf(it, "classes: %d\n", cachepart_nr_classes);
+	if (cachepart_nr_classes == 0)
+		return 0;
+
+	xnvfile_printf(it, "ways: %u\n", cachepart_cbm_len);
+	xnvfile_printf(it, "%-4s %s\n", "CLOS", "MASK");
+	for (clos = 0; clos < cachepart_nr_classes; clos++)
+		xnvfile_printf(it, "%-4d 0x%lx\n", clos, cachepart_masks[clos]);
+
+	if (!xnpod_active_p())
+		return 0;
+
+	xnvfile_printf(it, "%-4s %s\n", "CPU", "CLOS");
+	for_each_online_cpu(cpu) {
+		if (!xnarch_cpu_supported(cpu))
+			continue;
+
+		sched = xnpod_sched_slot(cpu);
+		if (sched->cpdefault < 0)
+			xnvfile_printf(it, "%-4d -\n", cpu);
+		else
+			xnvfile_printf(it, "%-4d %d\n", cpu, sched->cpdefault);
+	}
+
+	return 0;
+}
+
+/*
+ * "mask <clos> <mask>" sets the ways of a class, "cpu <cpu> <clos>"
+ * the default class of a CPU, -1 reverting to the Linux class.
+ */
+static ssize_t cachepart_vfile_store(struct xnvfile_input *input)
+{
+	char buf[64], *p, *end;
+	long arg1, arg2;
+	ssize_t ret;
+	int err;
+
+	ret = xnvfile_get_string(input, buf, sizeof(buf));
+	if (ret < 0)
+		return ret;
+
+	p = strchr(buf, ' ');
+	if (p == NULL)
+		return -EINVAL;
+
+	*p++ = '\0';
+	arg1 = simple_strtol(p, &end, 0);
+	if (end == p || *end != ' ')
+		return -EINVAL;
+
+	p = end + 1;
+	if (strcmp(buf, "mask") == 0)
+		arg2 = simple_strtoul(p, &end, 16);
+	else
+		arg2 = simple_strtol(p, &end, 0);
+	if (end == p || *end)
+		return -EINVAL;
+
+	if (strcmp(buf, "mask") == 0)
+		err = xncachepart_set_mask(arg1, arg2);
+	else if (strcmp(buf, "cpu") == 0)
+		err = xncachepart_set_cpu(arg1, arg2);
+	else
+		return -EINVAL;
+
+	return err ?: ret;
+}
+
+static struct xnvfile_regular_ops cachepart_vfile_ops = {
+	.show = cachepart_vfile_show,
+	.store = cachepart_vfile_store,
+};
+
+static struct xnvfile_regular cachepart_vfile = {
+	.ops = &cachepart_vfile_ops,
+};
+
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+void xncachepart_mount(void)
+{
+	int nr, clos;
+
+	nr = xnarch_cacheclass_probe(&cachepart_cbm_len);
+	if (nr > CACHEPART_MAX_CLASSES)
+		nr = CACHEPART_MAX_CLASSES;
+
+	/* We assume all packages were set up alike. */
+	for (clos = 0; clos < nr; clos++) {
+		xnarch_read_cachemask(clos, cachepart_masks[clos]);
+		cachepart_saved_masks[clos] = cachepart_masks[clos];
+	}
+
+	cachepart_nr_classes = nr;
+	if (nr == 0)
+		xnloginfo("cache partitioning unavailable on this CPU\n");
+
+#ifdef CONFIG_XENO_OPT_VFILE
+	xnvfile_init_regular("cachepart", &cachepart_vfile, &nkvfroot);
+#endif /* CONFIG_XENO_OPT_VFILE */
+}
+
+void xncachepart_umount(void)
+{
+	struct xnsched *sched;
+	int cpu, clos;
+	spl_t s;
+
+#ifdef CONFIG_XENO_OPT_VFILE
+	xnvfile_destroy_regular(&cachepart_vfile);
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+	/*
+	 * No real-time thread is left, so all CPUs run with the
+	 * class Linux set already. The masks are only restored for
+	 * the package we run on, the others keep our settings.
+	 */
+	xnlock_get_irqsave(&nklock, s);
+
+	if (xnpod_active_p())
+		for_each_online_cpu(cpu) {
+			if (!xnarch_cpu_supported(cpu))
+				continue;
+			sched = xnpod_sched_slot(cpu);
+			sched->cpdefault = -1;
+		}
+
+	for (clos = 0; clos < cachepart_nr_classes; clos++)
+		xnarch_write_cachemask(clos, cachepart_saved_masks[clos]);
+
+	cachepart_nr_classes = 0;
+
+	xnlock_put_irqrestore(&nklock, s);
+}
@@ -0,0 +1,189 @@
+/*!\file nucleus/evtrace.c
+ * \brief Binary event tracer for the nucleus.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * \ingroup nucleus
+ */
+
+/*
+ * Unlike the I-pipe tracer, this tracer is cheap enough to be left
+ * enabled in production: each event stores a fixed-size record into
+ * a per-CPU ring, with no locking involved besides masking the
+ * interrupts on the local CPU. The rings live in a mapped heap, so
+ * that user-space may stream them to disk without issuing any
+ * syscall per event (see nucleus/evtrace.h for the layout).
+ */
+
+#include <nucleus/pod.h>
+#include <nucleus/heap.h>
+#include <nucleus/vfile.h>
+#include <nucleus/evtrace.h>
+#include <nucleus/jhash.h>
+#include <linux/random.h>
+
+#define EVTRACE_NR_RECS  (1U << CONFIG_XENO_OPT_EVTRACE_SHIFT)
+
+int xnevtrace_enabled;
+EXPORT_SYMBOL_GPL(xnevtrace_enabled);
+
+static struct xnheap evtrace_heap;
+
+static struct xnevtrace_area *evtrace_area;
+
+/* Per-boot key, so that object cookies tell nothing about addresses. */
+static u32 evtrace_cookie_key;
+
+void __xnevtrace_log(unsigned int event, struct xnthread *thread,
+		     unsigned long long arg)
+{
+	struct xnevtrace_ring *ring;
+	struct xnevtrace_rec *rec;
+	unsigned int head;
+	spl_t s;
+
+	splhigh(s);
+
+	ring = xnevtrace_ring(evtrace_area, xnarch_current_cpu());
+	head = ring->head;
+	rec = &ring->recs[head & (EVTRACE_NR_RECS - 1)];
+	rec->tsc = xnarch_get_cpu_tsc();
+	rec->event = event;
+	rec->thread = thread ? xnthread_handle(thread) : XN_NO_HANDLE;
+	rec->arg = arg;
+	/* Publish the record before the new head. */
+	xnarch_write_memory_barrier();
+	ring->head = head + 1;
+
+	splexit(s);
+}
+EXPORT_SYMBOL_GPL(__xnevtrace_log);
+
+void __xnevtrace_log_obj(unsigned int event, struct xnthread *thread,
+			 const void *obj)
+{
+	unsigned long addr = (unsigned long)obj;
+
+	/*
+	 * The trace area is readable by unprivileged user-space, so
+	 * never store a kernel address there. A keyed hash still lets
+	 * a reader match the events bearing on the same object.
+	 */
+	__xnevtrace_log(event, thread,
+			jhash(&addr, sizeof(addr), evtrace_cookie_key));
+}
+EXPORT_SYMBOL_GPL(__xnevtrace_log_obj);
+
+struct xnheap *xnevtrace_heap(void)
+{
+	return evtrace_area ? &evtrace_heap : NULL;
+}
+
+#ifdef CONFIG_XENO_OPT_VFILE
+
+static int evtrace_vfile_show(struct xnvfile_regular_iterator *it, void *data)
+{
+	xnvfile_printf(it, "enabled: %d\n", xnevtrace_enabled);
+	xnvfile_printf(it, "cpus: %u\n", evtrace_area->nr_cpus);
+	xnvfile_printf(it, "records: %u\n", evtrace_area->nr_recs);
+	xnvfile_printf(it, "offset: %lu\n",
+		       xnheap_mapped_offset(&evtrace_heap, evtrace_area));
+	xnvfile_printf(it, "heapsize: %lu\n",
+		       (unsigned long)xnheap_extentsize(&evtrace_heap));
+
+	return 0;
+}
+
+static ssize_t evtrace_vfile_store(struct xnvfile_input *input)
+{
+	ssize_t ret;
+	long val;
+
+	ret = xnvfile_get_integer(input, &val);
+	if (ret < 0)
+		return ret;
+
+	xnevtrace_enabled = (val != 0);
+
+	return ret;
+}
+
+static struct xnvfile_regular_ops evtrace_vfile_ops = {
+	.show = evtrace_vfile_show,
+	.store = evtrace_vfile_store,
+};
+
+static struct xnvfile_regular evtrace_vfile = {
+	.ops = &evtrace_vfile_ops,
+};
+
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+int xnevtrace_mount(void)
+{
+	unsigned int ring_size;
+	size_t size;
+	int ret;
+
+	ring_size = sizeof(struct xnevtrace_ring) +
+		EVTRACE_NR_RECS * sizeof(struct xnevtrace_rec);
+	size = sizeof(struct xnevtrace_area) + ring_size * XNARCH_NR_CPUS;
+
+	ret = xnheap_init_mapped(&evtrace_heap,
+				 xnheap_rounded_size(size, PAGE_SIZE),
+				 XNARCH_SHARED_HEAP_FLAGS);
+	if (ret)
+		return ret;
+
+	xnheap_set_label(&evtrace_heap, "event trace");
+
+	get_random_bytes(&evtrace_cookie_key, sizeof(evtrace_cookie_key));
+
+	evtrace_area = xnheap_alloc(&evtrace_heap, size);
+	if (evtrace_area == NULL) {
+		xnheap_destroy_mapped(&evtrace_heap, NULL, NULL);
+		return -ENOMEM;
+	}
+
+	memset(evtrace_area, 0, size);
+	evtrace_area->nr_cpus = XNARCH_NR_CPUS;
+	evtrace_area->nr_recs = EVTRACE_NR_RECS;
+	evtrace_area->ring_size = ring_size;
+	evtrace_area->tsc_freq = xnarch_get_cpu_freq();
+	xnarch_write_memory_barrier();
+	evtrace_area->magic = XNEVTRACE_MAGIC;
+
+#ifdef CONFIG_XENO_OPT_VFILE
+	xnvfile_init_regular("evtrace", &evtrace_vfile, &nkvfroot);
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+	xnevtrace_enabled = 1;
+
+	return 0;
+}
+
+void xnevtrace_umount(void)
+{
+	xnevtrace_enabled = 0;
+
+#ifdef CONFIG_XENO_OPT_VFILE
+	xnvfile_destroy_regular(&evtrace_vfile);
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+	xnheap_free(&evtrace_heap, evtrace_area);
+	evtrace_area = NULL;
+	xnheap_destroy_mapped(&evtrace_heap, NULL, NULL);
+}
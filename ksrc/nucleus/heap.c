@@ -38,6 +38,13 @@
  * when needed, with multiple memory extents providing autonomous page
  * address spaces.
  *
+ * When CONFIG_XENO_OPT_HEAP_TLSF is enabled, heaps created with the
+ * XNHEAP_TLSF flag are managed by a two-level segregated fit
+ * allocator instead, which serves any request in bounded time with
+ * low fragmentation, at the expense of a per-block header. Such
+ * heaps use the same extent layout, but carve their blocks directly
+ * from the page array, ignoring the page map.
+ *
  * The data structures hierarchy is as follows:
  *
  * <tt> @verbatim
@@ -80,6 +87,105 @@ struct xnheap kstacks;		/* Private stack pool */
 
 static DEFINE_XNQUEUE(heapq);	/* Heap list for v-file dump */
 
+static DEFINE_XNQUEUE(poolq);	/* Object pool list for v-file dump */
+
+#ifdef CONFIG_XENO_OPT_SEM_HEAP_AUTOGROW
+
+/*
+ * Growth watermark, i.e. percentage of the usable memory in use
+ * beyond which a new extent is requested for an auto-growing heap.
+ */
+#define XNHEAP_GROW_WMARK  75
+
+static void request_growth(xnheap_t *heap);
+
+static inline void check_growth(xnheap_t *heap)
+{
+	if (heap->grow.maxext == 0 || heap->grow.pending ||
+	    countq(&heap->extents) >= heap->grow.maxext)
+		return;
+
+	if (heap->ubytes * 100 >= xnheap_usable_mem(heap) * XNHEAP_GROW_WMARK)
+		request_growth(heap);
+}
+
+#else /* !CONFIG_XENO_OPT_SEM_HEAP_AUTOGROW */
+
+static inline void check_growth(xnheap_t *heap) { }
+
+#endif /* !CONFIG_XENO_OPT_SEM_HEAP_AUTOGROW */
+
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+
+static inline struct xnheap_magazine *
+get_magazine(xnheap_t *heap, int cpu, int log2size)
+{
+	return heap->magazines + cpu * heap->nmags + (log2size - XNHEAP_MINLOG2);
+}
+
+static inline void get_magazine_stats(xnheap_t *heap,
+				      unsigned long *hits, unsigned long *misses)
+{
+	struct xnheap_magazine *mag;
+	int n;
+
+	*hits = *misses = 0;
+
+	if (heap->magazines == NULL)
+		return;
+
+	for (n = 0, mag = heap->magazines;
+	     n < heap->nrcpus * heap->nmags; n++, mag++) {
+		*hits += mag->hits;
+		*misses += mag->misses;
+	}
+}
+
+static int init_magazines(xnheap_t *heap, int flags)
+{
+	size_t size;
+
+	heap->magazines = NULL;
+	heap->nmags = 0;
+	heap->nrcpus = 0;
+
+	if ((flags & XNHEAP_MAGAZINE) == 0)
+		return 0;
+
+	/* One magazine per CPU and sub-page bucket. */
+	heap->nmags = heap->pageshift - XNHEAP_MINLOG2 + 1;
+	heap->nrcpus = xnarch_num_online_cpus();
+	size = heap->nrcpus * heap->nmags * sizeof(struct xnheap_magazine);
+	heap->magazines = xnmalloc(size);
+	if (heap->magazines == NULL)
+		return -ENOMEM;
+
+	memset(heap->magazines, 0, size);
+
+	return 0;
+}
+
+static void cleanup_magazines(xnheap_t *heap)
+{
+	if (heap->magazines) {
+		xnfree(heap->magazines);
+		heap->magazines = NULL;
+	}
+}
+
+#else /* !CONFIG_XENO_OPT_HEAP_MAGAZINES */
+
+static inline int init_magazines(xnheap_t *heap, int flags)
+{
+	return 0;
+}
+
+static inline void cleanup_magazines(xnheap_t *heap)
+{
+}
+
+#endif /* !CONFIG_XENO_OPT_HEAP_MAGAZINES */
+
 #ifdef CONFIG_XENO_OPT_VFILE
 
 static struct xnvfile_rev_tag vfile_tag;
@@ -94,6 +200,11 @@ struct vfile_data {
 	size_t usable_mem;
 	size_t used_mem;
 	size_t page_size;
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+	unsigned long hits;
+	unsigned long misses;
+#endif
+	struct xnheap_xstats xs;
 	char label[XNOBJECT_NAME_LEN+16];
 };
 
@@ -128,25 +239,59 @@ static int vfile_next(struct xnvfile_snapshot_iterator *it, void *data)
 	p->usable_mem = xnheap_usable_mem(heap);
 	p->used_mem = xnheap_used_mem(heap);
 	p->page_size = xnheap_page_size(heap);
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+	get_magazine_stats(heap, &p->hits, &p->misses);
+#endif
+	xnheap_get_xstats(heap, &p->xs);
 	strncpy(p->label, heap->label, sizeof(p->label));
 
 	return 1;
 }
 
+/*
+ * Each heap gets a second line describing its free memory: page
+ * states (free/list/cont/bucket) for the default allocator, then the
+ * count of free chunks per size class, for non-empty classes only.
+ */
 static int vfile_show(struct xnvfile_snapshot_iterator *it, void *data)
 {
 	struct vfile_data *p = data;
+	int n;
+
+	if (p == NULL) {
+		xnvfile_printf(it, "%9s %9s  %6s  %9s %10s %10s %6s %8s  ",
+			       "TOTAL", "USED", "PAGESZ", "LARGEST",
+			       "ALLOCS", "FREES", "FAILS", "MAXALLOC");
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+		xnvfile_printf(it, "%10s %10s  ", "HITS", "MISSES");
+#endif
+		xnvfile_printf(it, "NAME\n");
+		return 0;
+	}
+
+	xnvfile_printf(it, "%9Zu %9Zu  %6Zu  %9lu %10lu %10lu %6lu %8Lu  ",
+		       p->usable_mem,
+		       p->used_mem,
+		       p->page_size,
+		       p->xs.largest,
+		       p->xs.allocs,
+		       p->xs.frees,
+		       p->xs.failures,
+		       p->xs.maxalloc);
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+	xnvfile_printf(it, "%10lu %10lu  ", p->hits, p->misses);
+#endif
+	xnvfile_printf(it, "%.*s\n", (int)sizeof(p->label), p->label);
+
+	xnvfile_printf(it, "  pages %lu/%lu/%lu/%lu  free",
+		       p->xs.pfree, p->xs.plist, p->xs.pcont, p->xs.pbucket);
+	for (n = 0; n < XNHEAP_XSTATS_CLASSES; n++)
+		if (p->xs.freechunks[n])
+			xnvfile_printf(it, " %lu:%lu",
+				       1UL << (n + XNHEAP_MINLOG2),
+				       p->xs.freechunks[n]);
+	xnvfile_printf(it, "\n");
 
-	if (p == NULL)
-		xnvfile_printf(it, "%9s %9s  %6s  %s\n",
-			       "TOTAL", "USED", "PAGESZ", "NAME");
-	else
-		xnvfile_printf(it, "%9Zu %9Zu  %6Zu  %.*s\n",
-			       p->usable_mem,
-			       p->used_mem,
-			       p->page_size,
-			       (int)sizeof(p->label),
-			       p->label);
 	return 0;
 }
 
@@ -156,13 +301,95 @@ static struct xnvfile_snapshot_ops vfile_ops = {
 	.show = vfile_show,
 };
 
+static struct xnvfile_rev_tag pool_vfile_tag;
+
+static struct xnvfile_snapshot_ops pool_vfile_ops;
+
+struct pool_vfile_data {
+	u_long objsize;
+	int nfree;
+	int capacity;
+	int nused;
+	unsigned long hits;
+	unsigned long misses;
+	char name[XNOBJECT_NAME_LEN];
+};
+
+static struct xnvfile_snapshot pool_vfile = {
+	.privsz = sizeof(struct vfile_priv),
+	.datasz = sizeof(struct pool_vfile_data),
+	.tag = &pool_vfile_tag,
+	.ops = &pool_vfile_ops,
+};
+
+static int pool_vfile_rewind(struct xnvfile_snapshot_iterator *it)
+{
+	struct vfile_priv *priv = xnvfile_iterator_priv(it);
+
+	priv->curr = getheadq(&poolq);
+
+	return countq(&poolq);
+}
+
+static int pool_vfile_next(struct xnvfile_snapshot_iterator *it, void *data)
+{
+	struct vfile_priv *priv = xnvfile_iterator_priv(it);
+	struct pool_vfile_data *p = data;
+	struct xnobjpool *pool;
+
+	if (priv->curr == NULL)
+		return 0;	/* We are done. */
+
+	pool = link2objpool(priv->curr);
+	priv->curr = nextq(&poolq, priv->curr);
+
+	p->objsize = pool->objsize;
+	p->nfree = pool->nfree;
+	p->capacity = pool->capacity;
+	p->nused = pool->nused;
+	p->hits = pool->hits;
+	p->misses = pool->misses;
+	strncpy(p->name, pool->name, sizeof(p->name));
+
+	return 1;
+}
+
+static int pool_vfile_show(struct xnvfile_snapshot_iterator *it, void *data)
+{
+	struct pool_vfile_data *p = data;
+
+	if (p == NULL)
+		xnvfile_printf(it, "%6s %6s %6s %6s  %10s %10s  %s\n",
+			       "OBJSZ", "USED", "FREE", "CAP", "HITS", "MISSES",
+			       "NAME");
+	else
+		xnvfile_printf(it, "%6lu %6d %6d %6d  %10lu %10lu  %.*s\n",
+			       p->objsize,
+			       p->nused,
+			       p->nfree,
+			       p->capacity,
+			       p->hits,
+			       p->misses,
+			       (int)sizeof(p->name),
+			       p->name);
+	return 0;
+}
+
+static struct xnvfile_snapshot_ops pool_vfile_ops = {
+	.rewind = pool_vfile_rewind,
+	.next = pool_vfile_next,
+	.show = pool_vfile_show,
+};
+
 void xnheap_init_proc(void)
 {
 	xnvfile_init_snapshot("heap", &vfile, &nkvfroot);
+	xnvfile_init_snapshot("objpools", &pool_vfile, &nkvfroot);
 }
 
 void xnheap_cleanup_proc(void)
 {
+	xnvfile_destroy_snapshot(&pool_vfile);
 	xnvfile_destroy_snapshot(&vfile);
 }
 
@@ -196,11 +423,391 @@ static void init_extent(xnheap_t *heap, xnextent_t *extent)
 	extent->freelist = extent->membase;
 }
 
+/* Account for a free chunk in the fragmentation statistics. */
+static void xstats_add_chunk(struct xnheap_xstats *xs, u_long size)
+{
+	int class = 31 - __builtin_clz((unsigned int)size) - XNHEAP_MINLOG2;
+
+	if (class < 0)
+		class = 0;
+	else if (class >= XNHEAP_XSTATS_CLASSES)
+		class = XNHEAP_XSTATS_CLASSES - 1;
+
+	xs->freechunks[class]++;
+	if (size > xs->largest)
+		xs->largest = size;
+}
+
+#ifdef CONFIG_XENO_OPT_HEAP_TLSF
+
+/*
+ * TLSF backend, after M. Masmano et al., "TLSF: a New Dynamic Memory
+ * Allocator for Real-Time Systems" (ECRTS 2004). Every block starts
+ * with a header giving its payload size and the address of the
+ * block preceding it in memory, so that a released block is merged
+ * with its free neighbours on the spot. Free blocks also hold the
+ * links of their free list in their payload. The free lists are
+ * indexed by two bitmaps, so that finding a fitting block takes a
+ * couple of find-first-set operations.
+ *
+ * Each extent ends with a zero-sized busy block, which keeps merging
+ * within the extent boundaries. The control block is laid at the
+ * start of the initial extent.
+ */
+
+struct xnheap_tlsf_block {
+	struct xnheap_tlsf_block *prev_phys; /* NULL for the first block */
+	u_long size;		/* Payload size | TLSF_* bits */
+	char pad[XNHEAP_MINALIGNSZ - sizeof(void *) - sizeof(u_long)];
+	/* Payload starts here; free blocks only: */
+	struct xnheap_tlsf_block *next_free;
+	struct xnheap_tlsf_block *prev_free;
+};
+
+#define TLSF_HDRSZ	offsetof(struct xnheap_tlsf_block, next_free)
+#define TLSF_CTLSZ	XNHEAP_TLSF_OVERHEAD
+#define TLSF_FREE	0x1
+#define TLSF_PREVFREE	0x2
+#define TLSF_SIZEMASK	(~(u_long)(XNHEAP_MINALIGNSZ - 1))
+
+#define tlsf_requested(flags)	((flags) & XNHEAP_TLSF)
+
+static inline u_long tlsf_size(struct xnheap_tlsf_block *b)
+{
+	return b->size & TLSF_SIZEMASK;
+}
+
+static inline struct xnheap_tlsf_block *
+tlsf_next_phys(struct xnheap_tlsf_block *b)
+{
+	return (struct xnheap_tlsf_block *)((caddr_t)b + TLSF_HDRSZ + tlsf_size(b));
+}
+
+static inline void tlsf_mapping(u_long size, int *fl, int *sl)
+{
+	int msb;
+
+	if (size < XNHEAP_TLSF_SMALL) {
+		*fl = 0;
+		*sl = size / (XNHEAP_TLSF_SMALL / XNHEAP_TLSF_SLCOUNT);
+	} else {
+		msb = 31 - __builtin_clz((unsigned int)size);
+		*sl = (size >> (msb - XNHEAP_TLSF_SLLOG2)) ^ XNHEAP_TLSF_SLCOUNT;
+		*fl = msb - XNHEAP_TLSF_FLSHIFT + 1;
+	}
+}
+
+static void tlsf_insert(struct xnheap_tlsf *t, struct xnheap_tlsf_block *b)
+{
+	int fl, sl;
+
+	tlsf_mapping(tlsf_size(b), &fl, &sl);
+	b->prev_free = NULL;
+	b->next_free = t->freelist[fl][sl];
+	if (b->next_free)
+		b->next_free->prev_free = b;
+	t->freelist[fl][sl] = b;
+	t->fl_bitmap |= 1U << fl;
+	t->sl_bitmap[fl] |= 1U << sl;
+}
+
+static void tlsf_remove(struct xnheap_tlsf *t, struct xnheap_tlsf_block *b)
+{
+	int fl, sl;
+
+	if (b->next_free)
+		b->next_free->prev_free = b->prev_free;
+
+	if (b->prev_free) {
+		b->prev_free->next_free = b->next_free;
+		return;
+	}
+
+	tlsf_mapping(tlsf_size(b), &fl, &sl);
+	t->freelist[fl][sl] = b->next_free;
+	if (b->next_free == NULL) {
+		t->sl_bitmap[fl] &= ~(1U << sl);
+		if (t->sl_bitmap[fl] == 0)
+			t->fl_bitmap &= ~(1U << fl);
+	}
+}
+
+/*
+ * Pick the head of the first non-empty list holding blocks which are
+ * all large enough, i.e. round the size up to the next list
+ * boundary before mapping it. Failing that, the head of the list
+ * the size maps to may still fit, which matters when asking for the
+ * largest block available.
+ */
+static struct xnheap_tlsf_block *tlsf_find(struct xnheap_tlsf *t, u_long size)
+{
+	struct xnheap_tlsf_block *b;
+	u_long rsize = size;
+	unsigned int map;
+	int fl, sl;
+
+	if (size >= XNHEAP_TLSF_SMALL)
+		rsize += (1UL << (31 - __builtin_clz((unsigned int)size) -
+				  XNHEAP_TLSF_SLLOG2)) - 1;
+
+	tlsf_mapping(rsize, &fl, &sl);
+	if (fl < XNHEAP_TLSF_FLCOUNT) {
+		map = t->sl_bitmap[fl] & (~0U << sl);
+		if (map == 0) {
+			map = t->fl_bitmap & (~0U << (fl + 1));
+			if (map) {
+				fl = __builtin_ffs(map) - 1;
+				map = t->sl_bitmap[fl];
+			}
+		}
+		if (map)
+			return t->freelist[fl][__builtin_ffs(map) - 1];
+	}
+
+	tlsf_mapping(size, &fl, &sl);
+	b = t->freelist[fl][sl];
+
+	return b && tlsf_size(b) >= size ? b : NULL;
+}
+
+static int init_tlsf(xnheap_t *heap, int flags)
+{
+	heap->tlsf = NULL;
+
+	if (!tlsf_requested(flags))
+		return 0;
+
+	/* The initial extent must hold the control block. */
+	if (heap->pagesize < XNHEAP_MINALIGNSZ ||
+	    (heap->npages << heap->pageshift) <
+	    TLSF_CTLSZ + 2 * TLSF_HDRSZ + XNHEAP_MINALIGNSZ)
+		return -EINVAL;
+
+	return 0;
+}
+
+/* Must be called with the heap lock held, unless initializing. */
+static void tlsf_init_extent(xnheap_t *heap, xnextent_t *extent)
+{
+	struct xnheap_tlsf_block *b, *tail;
+	caddr_t base;
+
+	inith(&extent->link);
+	extent->membase = (caddr_t) extent + heap->hdrsize;
+	extent->memlim = extent->membase + (heap->npages << heap->pageshift);
+	extent->freelist = NULL;
+
+	base = extent->membase;
+	if (heap->tlsf == NULL) {
+		heap->tlsf = (struct xnheap_tlsf *)base;
+		memset(heap->tlsf, 0, sizeof(*heap->tlsf));
+		base += TLSF_CTLSZ;
+		/* The initial extent has the smallest free block. */
+		heap->maxcont = extent->memlim - base - 2 * TLSF_HDRSZ;
+	}
+
+	b = (struct xnheap_tlsf_block *)base;
+	b->prev_phys = NULL;
+	b->size = (extent->memlim - base - 2 * TLSF_HDRSZ) | TLSF_FREE;
+	tail = tlsf_next_phys(b);
+	tail->prev_phys = b;
+	tail->size = TLSF_PREVFREE;
+	tlsf_insert(heap->tlsf, b);
+}
+
+static caddr_t tlsf_alloc(xnheap_t *heap, u_long size)
+{
+	struct xnheap_tlsf *t = heap->tlsf;
+	struct xnheap_tlsf_block *b, *n;
+	u_long bsize;
+	spl_t s;
+
+	if (size > heap->maxcont)
+		return NULL;
+
+	size = xnheap_align(size, XNHEAP_MINALIGNSZ);
+
+	xnlock_get_irqsave(&heap->lock, s);
+
+	b = tlsf_find(t, size);
+	if (b == NULL) {
+		xnlock_put_irqrestore(&heap->lock, s);
+		return NULL;
+	}
+
+	tlsf_remove(t, b);
+	bsize = tlsf_size(b);
+
+	if (bsize - size >= TLSF_HDRSZ + XNHEAP_MINALIGNSZ) {
+		/* Split, and give the remainder back to the free lists. */
+		b->size = size | (b->size & TLSF_PREVFREE);
+		n = tlsf_next_phys(b);
+		n->prev_phys = b;
+		n->size = (bsize - size - TLSF_HDRSZ) | TLSF_FREE;
+		tlsf_next_phys(n)->prev_phys = n;
+		tlsf_insert(t, n);
+	} else {
+		b->size &= ~TLSF_FREE;
+		tlsf_next_phys(b)->size &= ~TLSF_PREVFREE;
+	}
+
+	heap->ubytes += tlsf_size(b);
+
+	xnlock_put_irqrestore(&heap->lock, s);
+
+	return (caddr_t)b + TLSF_HDRSZ;
+}
+
+/*
+ * Return the header of a busy block, or NULL if @block cannot be
+ * one. There is no page map to tell us whether @block actually
+ * starts a block, but every block knows its physical predecessor,
+ * so a genuine block is the one its successor points back to, and
+ * which follows its own predecessor.
+ */
+static struct xnheap_tlsf_block *tlsf_get_block(xnheap_t *heap, void *block,
+						int *errp)
+{
+	struct xnheap_tlsf_block *b, *p;
+	xnextent_t *extent = NULL;
+	xnholder_t *holder;
+	caddr_t first;
+
+	for (holder = getheadq(&heap->extents);
+	     holder != NULL; holder = nextq(&heap->extents, holder)) {
+		extent = link2extent(holder);
+		if ((caddr_t) block >= extent->membase &&
+		    (caddr_t) block < extent->memlim)
+			break;
+	}
+
+	if (!holder) {
+		*errp = -EFAULT;
+		return NULL;
+	}
+
+	*errp = -EINVAL;
+	b = (struct xnheap_tlsf_block *)((caddr_t)block - TLSF_HDRSZ);
+
+	/* The initial extent starts with the control block. */
+	first = extent->membase;
+	if (first == (caddr_t)heap->tlsf)
+		first += TLSF_CTLSZ;
+
+	if ((((caddr_t)block - extent->membase) & (XNHEAP_MINALIGNSZ - 1)) ||
+	    (caddr_t)b < first || (b->size & TLSF_FREE) ||
+	    tlsf_size(b) > extent->memlim - TLSF_HDRSZ - (caddr_t)block)
+		return NULL;
+
+	if (tlsf_next_phys(b)->prev_phys != b)
+		return NULL;
+
+	p = b->prev_phys;
+	if (p == NULL ? (caddr_t)b != first :
+	    (caddr_t)p < first || p >= b || tlsf_next_phys(p) != b)
+		return NULL;
+
+	return b;
+}
+
+/* Must be called with the heap lock held. */
+static int tlsf_free(xnheap_t *heap, void *block, int (*ckfn)(void *block))
+{
+	struct xnheap_tlsf *t = heap->tlsf;
+	struct xnheap_tlsf_block *b, *n;
+	int err;
+
+	b = tlsf_get_block(heap, block, &err);
+	if (b == NULL)
+		return err;
+
+	if (ckfn && (err = ckfn(block)) != 0)
+		return err;
+
+	heap->ubytes -= tlsf_size(b);
+
+	/* Merge with the free neighbours, if any. */
+	if (b->size & TLSF_PREVFREE) {
+		n = b->prev_phys;
+		tlsf_remove(t, n);
+		n->size += TLSF_HDRSZ + tlsf_size(b);
+		b = n;
+	}
+
+	n = tlsf_next_phys(b);
+	if (n->size & TLSF_FREE) {
+		tlsf_remove(t, n);
+		b->size += TLSF_HDRSZ + tlsf_size(n);
+	}
+
+	b->size |= TLSF_FREE;
+	n = tlsf_next_phys(b);
+	n->prev_phys = b;
+	n->size |= TLSF_PREVFREE;
+	tlsf_insert(t, b);
+
+	return 0;
+}
+
+static int tlsf_check_block(xnheap_t *heap, void *block)
+{
+	int err;
+
+	return tlsf_get_block(heap, block, &err) ? 0 : -EINVAL;
+}
+
+static void tlsf_get_xstats(xnheap_t *heap, struct xnheap_xstats *xs)
+{
+	struct xnheap_tlsf *t = heap->tlsf;
+	struct xnheap_tlsf_block *b;
+	int fl, sl;
+
+	for (fl = 0; fl < XNHEAP_TLSF_FLCOUNT; fl++)
+		for (sl = 0; sl < XNHEAP_TLSF_SLCOUNT; sl++)
+			for (b = t->freelist[fl][sl]; b; b = b->next_free)
+				xstats_add_chunk(xs, tlsf_size(b));
+}
+
+#else /* !CONFIG_XENO_OPT_HEAP_TLSF */
+
+#define tlsf_requested(flags)	0
+
+static inline int init_tlsf(xnheap_t *heap, int flags)
+{
+	return 0;
+}
+
+static inline void tlsf_init_extent(xnheap_t *heap, xnextent_t *extent)
+{
+}
+
+static inline caddr_t tlsf_alloc(xnheap_t *heap, u_long size)
+{
+	return NULL;
+}
+
+static inline int tlsf_free(xnheap_t *heap, void *block,
+			    int (*ckfn)(void *block))
+{
+	return -EINVAL;
+}
+
+static inline int tlsf_check_block(xnheap_t *heap, void *block)
+{
+	return -EINVAL;
+}
+
+static inline void tlsf_get_xstats(xnheap_t *heap, struct xnheap_xstats *xs)
+{
+}
+
+#endif /* !CONFIG_XENO_OPT_HEAP_TLSF */
+
 /*
  */
 
 /*!
- * \fn xnheap_init(xnheap_t *heap,void *heapaddr,u_long heapsize,u_long pagesize)
+ * \fn xnheap_init(xnheap_t *heap,void *heapaddr,u_long heapsize,u_long pagesize,int flags)
  * \brief Initialize a memory heap.
  *
  * Initializes a memory heap suitable for time-bounded allocation
@@ -237,10 +844,31 @@ static void init_extent(xnheap_t *heap, xnextent_t *extent)
  * best one for your needs. In the current implementation, pagesize
  * must be a power of two in the range [ 8 .. 32768 ] inclusive.
  *
+ * @param flags A set of creation flags affecting the heap
+ * operations. 0 or XNHEAP_MAGAZINE may be passed. XNHEAP_MAGAZINE
+ * sets up per-CPU caches of recently freed blocks in front of the
+ * buckets, so that most sub-page allocations and releases do not
+ * grab the heap lock. The magazine storage is obtained from the
+ * system heap, and cached blocks are still accounted as free
+ * memory. This flag is ignored unless CONFIG_XENO_OPT_HEAP_MAGAZINES
+ * is enabled. XNHEAP_TLSF has the heap managed by the TLSF allocator,
+ * which serves requests of any size in bounded time without rounding
+ * them to a power of two, at the expense of a 16-byte header per
+ * block and a control block of about 3Kb laid at the start of the
+ * initial extent. @a pagesize then only matters for the extent
+ * layout, and must be at least 16. XNHEAP_MAGAZINE is ignored for
+ * such heaps, and so is XNHEAP_TLSF unless CONFIG_XENO_OPT_HEAP_TLSF
+ * is enabled.
+ *
  * @return 0 is returned upon success, or one of the following error
  * codes:
  *
- * - -EINVAL is returned whenever a parameter is invalid.
+ * - -EINVAL is returned whenever a parameter is invalid, or if
+ * XNHEAP_TLSF was given for a heap too small to hold the TLSF control
+ * block.
+ *
+ * - -ENOMEM is returned if XNHEAP_MAGAZINE was given, but the
+ * magazine storage could not be obtained from the system heap.
  *
  * Environments:
  *
@@ -254,11 +882,12 @@ static void init_extent(xnheap_t *heap, xnextent_t *extent)
  */
 
 int xnheap_init(xnheap_t *heap,
-		void *heapaddr, u_long heapsize, u_long pagesize)
+		void *heapaddr, u_long heapsize, u_long pagesize, int flags)
 {
 	unsigned cpu, nr_cpus = xnarch_num_online_cpus();
 	u_long hdrsize, shiftsize, pageshift;
 	xnextent_t *extent;
+	int err;
 	spl_t s;
 
 	/*
@@ -311,6 +940,15 @@ int xnheap_init(xnheap_t *heap,
 	if (heap->npages < 2)
 		return -EINVAL;
 
+	err = init_tlsf(heap, flags);
+	if (err)
+		return err;
+
+	err = init_magazines(heap, tlsf_requested(flags) ?
+			     flags & ~XNHEAP_MAGAZINE : flags);
+	if (err)
+		return err;
+
 	heap->ubytes = 0;
 	heap->maxcont = heap->npages * pagesize;
 	for (cpu = 0; cpu < nr_cpus; cpu++)
@@ -320,9 +958,19 @@ int xnheap_init(xnheap_t *heap,
 	initq(&heap->extents);
 	xnlock_init(&heap->lock);
 	xnarch_init_heapcb(&heap->archdep);
+#ifdef CONFIG_XENO_OPT_SEM_HEAP_AUTOGROW
+	heap->grow.maxext = 0;
+	heap->grow.pending = 0;
+	heap->grow.kmflags = 0;
+	inith(&heap->grow.link);
+#endif
 	memset(heap->buckets, 0, sizeof(heap->buckets));
+	memset(&heap->stats, 0, sizeof(heap->stats));
 	extent = (xnextent_t *)heapaddr;
-	init_extent(heap, extent);
+	if (tlsf_requested(flags))
+		tlsf_init_extent(heap, extent);
+	else
+		init_extent(heap, extent);
 
 	appendq(&heap->extents, &extent->link);
 
@@ -374,6 +1022,9 @@ void xnheap_set_label(xnheap_t *heap, const char *label, ...)
 	xnlock_put_irqrestore(&nklock, s);
 
 	va_end(args);
+
+	xnlock_stat_detach(&heap->lock);
+	xnlock_stat_attach(&heap->lock, "heap/%s", heap->label);
 }
 EXPORT_SYMBOL_GPL(xnheap_set_label);
 
@@ -412,11 +1063,15 @@ void xnheap_destroy(xnheap_t *heap,
 	xnholder_t *holder;
 	spl_t s;
 
+	xnlock_stat_detach(&heap->lock);
+
 	xnlock_get_irqsave(&nklock, s);
 	removeq(&heapq, &heap->stat_link);
 	xnvfile_touch_tag(&vfile_tag);
 	xnlock_put_irqrestore(&nklock, s);
 
+	cleanup_magazines(heap);
+
 	if (!flushfn)
 		return;
 
@@ -535,6 +1190,200 @@ static caddr_t get_free_range(xnheap_t *heap, u_long bsize, int log2size)
 	return headpage;
 }
 
+/*
+ * get_bucket_block() -- Pull a block of 2 ** log2size bytes from the
+ * bucketed memory space, refilling the bucket from the free page
+ * list if empty. The caller must have acquired the heap lock.
+ */
+
+static caddr_t get_bucket_block(xnheap_t *heap, u_long bsize, int log2size)
+{
+	int ilog = log2size - XNHEAP_MINLOG2;
+	xnholder_t *holder;
+	xnextent_t *extent;
+	u_long pagenum;
+	caddr_t block;
+
+	block = heap->buckets[ilog].freelist;
+
+	if (block == NULL) {
+		block = get_free_range(heap, bsize, log2size);
+		if (block == NULL)
+			return NULL;
+		if (bsize <= heap->pagesize)
+			heap->buckets[ilog].fcount += (heap->pagesize >> log2size) - 1;
+	} else {
+		if (bsize <= heap->pagesize)
+			--heap->buckets[ilog].fcount;
+
+		for (holder = getheadq(&heap->extents), extent = NULL;
+		     holder != NULL; holder = nextq(&heap->extents, holder)) {
+			extent = link2extent(holder);
+			if ((caddr_t) block >= extent->membase &&
+			    (caddr_t) block < extent->memlim)
+				break;
+		}
+		XENO_ASSERT(NUCLEUS, extent != NULL,
+			    xnpod_fatal("Cannot determine source extent for block %p (heap %p)?!",
+					block, heap);
+			);
+		pagenum = ((caddr_t) block - extent->membase) >> heap->pageshift;
+		++extent->pagemap[pagenum].bcount;
+	}
+
+	heap->buckets[ilog].freelist = *((caddr_t *) block);
+	heap->ubytes += bsize;
+
+	return block;
+}
+
+#ifdef CONFIG_XENO_OPT_HEAP_MAGAZINES
+
+/*
+ * Serve a sub-page allocation from the current CPU's magazine,
+ * refilling it with a batch of blocks from the bucket on a
+ * miss. Returns NULL if the heap has no magazine for this CPU or
+ * if the refill failed, in which case the caller should go through
+ * the regular bucket allocator.
+ */
+static caddr_t magazine_alloc(xnheap_t *heap, u_long bsize, int log2size)
+{
+	struct xnheap_magazine *mag;
+	caddr_t block = NULL;
+	int cpu, n;
+	spl_t s, ls;
+
+	splhigh(s);
+
+	cpu = xnarch_current_cpu();
+	if (unlikely(cpu >= heap->nrcpus))
+		goto out;
+
+	mag = get_magazine(heap, cpu, log2size);
+	if (likely(mag->count > 0)) {
+		block = mag->slots[--mag->count];
+		mag->hits++;
+		goto out;
+	}
+
+	mag->misses++;
+
+	/*
+	 * Refill half of the magazine in one go, so that we don't
+	 * come back to the heap lock on the next allocation. Keep
+	 * the last block for the caller.
+	 */
+	xnlock_get_irqsave(&heap->lock, ls);
+
+	for (n = 0; n < XNHEAP_MAGAZINE_BATCH; n++) {
+		block = get_bucket_block(heap, bsize, log2size);
+		if (block == NULL)
+			break;
+		if (n < XNHEAP_MAGAZINE_BATCH - 1)
+			mag->slots[mag->count++] = block;
+	}
+
+	xnlock_put_irqrestore(&heap->lock, ls);
+
+	if (block == NULL && mag->count > 0)
+		block = mag->slots[--mag->count];
+out:
+	splexit(s);
+
+	return block;
+}
+
+static int put_bucket_block(xnheap_t *heap, void *block,
+			    int (*ckfn)(void *block));
+
+/*
+ * Stash a released sub-page block into the current CPU's magazine,
+ * draining a batch of blocks back to the bucket when the magazine is
+ * full. Returns non-zero if the block was consumed. Only blocks from
+ * the initial extent are cached, since this one can be located
+ * without holding the heap lock.
+ */
+static int magazine_free(xnheap_t *heap, void *block)
+{
+	struct xnheap_magazine *mag;
+	int log2size, cpu, n, ret = 0;
+	xnextent_t *extent;
+	u_long pagenum;
+	spl_t s, ls;
+
+	extent = link2extent(getheadq(&heap->extents));
+	if ((caddr_t) block < extent->membase ||
+	    (caddr_t) block >= extent->memlim)
+		return 0;
+
+	/*
+	 * The page map entry of an allocated block cannot change
+	 * under our feet, since its page remains busy until the
+	 * block is returned to its bucket.
+	 */
+	pagenum = ((caddr_t) block - extent->membase) >> heap->pageshift;
+	log2size = extent->pagemap[pagenum].type;
+	if (log2size < XNHEAP_MINLOG2 ||
+	    (1UL << log2size) > heap->pagesize ||
+	    ((u_long)((caddr_t) block - extent->membase) & ((1UL << log2size) - 1)))
+		return 0;	/* Let the regular path sort this out. */
+
+	splhigh(s);
+
+	cpu = xnarch_current_cpu();
+	if (unlikely(cpu >= heap->nrcpus))
+		goto out;
+
+	mag = get_magazine(heap, cpu, log2size);
+	if (unlikely(mag->count >= CONFIG_XENO_OPT_HEAP_MAGAZINE_DEPTH)) {
+		xnlock_get_irqsave(&heap->lock, ls);
+		for (n = 0; n < XNHEAP_MAGAZINE_BATCH; n++)
+			put_bucket_block(heap, mag->slots[--mag->count], NULL);
+		xnlock_put_irqrestore(&heap->lock, ls);
+	}
+
+	mag->slots[mag->count++] = block;
+	ret = 1;
+out:
+	splexit(s);
+
+	return ret;
+}
+
+u_long xnheap_cached_mem(xnheap_t *heap)
+{
+	struct xnheap_magazine *mag;
+	u_long cached = 0;
+	int cpu, n;
+
+	if (heap->magazines == NULL)
+		return 0;
+
+	/* Racy by nature, but only used for reporting. */
+	for (cpu = 0; cpu < heap->nrcpus; cpu++)
+		for (n = 0; n < heap->nmags; n++) {
+			mag = get_magazine(heap, cpu, n + XNHEAP_MINLOG2);
+			cached += (u_long)mag->count << (n + XNHEAP_MINLOG2);
+		}
+
+	return cached;
+}
+EXPORT_SYMBOL_GPL(xnheap_cached_mem);
+
+#else /* !CONFIG_XENO_OPT_HEAP_MAGAZINES */
+
+static inline caddr_t magazine_alloc(xnheap_t *heap, u_long bsize,
+				     int log2size)
+{
+	return NULL;
+}
+
+static inline int magazine_free(xnheap_t *heap, void *block)
+{
+	return 0;
+}
+#endif /* !CONFIG_XENO_OPT_HEAP_MAGAZINES */
+
 /*!
  * \fn void *xnheap_alloc(xnheap_t *heap, u_long size)
  * \brief Allocate a memory block from a memory heap.
@@ -550,7 +1399,8 @@ static caddr_t get_free_range(xnheap_t *heap, u_long bsize, int log2size)
  * alignment size if greater or equal to this value. In the current
  * implementation, with MINALLOC = 8 and MINALIGN = 16, a 7 bytes
  * request will be rounded to 8 bytes, and a 17 bytes request will be
- * rounded to 32.
+ * rounded to 32. Heaps managed by the TLSF allocator round all sizes
+ * to the next multiple of 16 bytes.
  *
  * @return The address of the allocated region upon success, or NULL
  * if no memory is available from the specified heap.
@@ -567,19 +1417,22 @@ static caddr_t get_free_range(xnheap_t *heap, u_long bsize, int log2size)
  * Rescheduling: never.
  */
 
-void *xnheap_alloc(xnheap_t *heap, u_long size)
+static void *__xnheap_alloc(xnheap_t *heap, u_long size)
 {
-	xnholder_t *holder;
-	xnextent_t *extent;
-	int log2size, ilog;
-	u_long pagenum;
 	caddr_t block;
+	int log2size;
 	u_long bsize;
 	spl_t s;
 
 	if (size == 0)
 		return NULL;
 
+	if (xnheap_tlsf_p(heap)) {
+		block = tlsf_alloc(heap, size);
+		check_growth(heap);
+		return block;
+	}
+
 	if (size <= heap->pagesize)
 		/* Sizes lower or equal to the page size are rounded either to
 		   the minimum allocation size if lower than this value, or to
@@ -614,39 +1467,14 @@ void *xnheap_alloc(xnheap_t *heap, u_long size)
 		     bsize < size; bsize <<= 1, log2size++)
 			;	/* Loop */
 
-		ilog = log2size - XNHEAP_MINLOG2;
-
-		xnlock_get_irqsave(&heap->lock, s);
-
-		block = heap->buckets[ilog].freelist;
-
-		if (block == NULL) {
-			block = get_free_range(heap, bsize, log2size);
-			if (block == NULL)
-				goto release_and_exit;
-			if (bsize <= heap->pagesize)
-				heap->buckets[ilog].fcount += (heap->pagesize >> log2size) - 1;
-		} else {
-			if (bsize <= heap->pagesize)
-				--heap->buckets[ilog].fcount;
-
-			for (holder = getheadq(&heap->extents), extent = NULL;
-			     holder != NULL; holder = nextq(&heap->extents, holder)) {
-				extent = link2extent(holder);
-				if ((caddr_t) block >= extent->membase &&
-				    (caddr_t) block < extent->memlim)
-					break;
-			}
-			XENO_ASSERT(NUCLEUS, extent != NULL,
-				    xnpod_fatal("Cannot determine source extent for block %p (heap %p)?!",
-						block, heap);
-				);
-			pagenum = ((caddr_t) block - extent->membase) >> heap->pageshift;
-			++extent->pagemap[pagenum].bcount;
+		if (xnheap_magazines_p(heap) && bsize <= heap->pagesize) {
+			block = magazine_alloc(heap, bsize, log2size);
+			if (block)
+				return block;
 		}
 
-		heap->buckets[ilog].freelist = *((caddr_t *) block);
-		heap->ubytes += bsize;
+		xnlock_get_irqsave(&heap->lock, s);
+		block = get_bucket_block(heap, bsize, log2size);
 	} else {
 		if (size > heap->maxcont)
 			return NULL;
@@ -660,64 +1488,47 @@ void *xnheap_alloc(xnheap_t *heap, u_long size)
 			heap->ubytes += size;
 	}
 
-      release_and_exit:
-
 	xnlock_put_irqrestore(&heap->lock, s);
 
+	check_growth(heap);
+
+	return block;
+}
+
+void *xnheap_alloc(xnheap_t *heap, u_long size)
+{
+	xnticks_t start, duration;
+	void *block;
+
+	start = xnstat_exectime_now();
+	block = __xnheap_alloc(heap, size);
+	duration = xnstat_exectime_now() - start;
+
+	if (block)
+		heap->stats.allocs++;
+	else
+		heap->stats.failures++;
+
+	if (duration > heap->stats.maxalloc)
+		heap->stats.maxalloc = duration;
+
 	return block;
 }
 EXPORT_SYMBOL_GPL(xnheap_alloc);
 
-/*!
- * \fn int xnheap_test_and_free(xnheap_t *heap,void *block,int (*ckfn)(void *block))
- * \brief Test and release a memory block to a memory heap.
- *
- * Releases a memory region to the memory heap it was previously
- * allocated from. Before the actual release is performed, an optional
- * user-defined can be invoked to check for additional criteria with
- * respect to the request consistency.
- *
- * @param heap The descriptor address of the heap to release memory
- * to.
- *
- * @param block The address of the region to be returned to the heap.
- *
- * @param ckfn The address of a user-supplied verification routine
- * which is to be called after the memory address specified by @a
- * block has been checked for validity. The routine is expected to
- * proceed to further consistency checks, and either return zero upon
- * success, or non-zero upon error. In the latter case, the release
- * process is aborted, and @a ckfn's return value is passed back to
- * the caller of this service as its error return code. @a ckfn must
- * not trigger the rescheduling procedure either directly or
- * indirectly.
- *
- * @return 0 is returned upon success, or -EINVAL is returned whenever
- * the block is not a valid region of the specified heap. Additional
- * return codes can also be defined locally by the @a ckfn routine.
- *
- * Environments:
- *
- * This service can be called from:
- *
- * - Kernel module initialization/cleanup code
- * - Interrupt service routine
- * - Kernel-based task
- * - User-space task
- *
- * Rescheduling: never.
+/*
+ * put_bucket_block() -- Release a block to the heap. The caller must
+ * have acquired the heap lock.
  */
 
-int xnheap_test_and_free(xnheap_t *heap, void *block, int (*ckfn) (void *block))
+static int put_bucket_block(xnheap_t *heap, void *block,
+			    int (*ckfn)(void *block))
 {
 	caddr_t freepage, lastpage, nextpage, tailpage, freeptr, *tailptr;
 	int log2size, npages, err, nblocks, xpage, ilog;
 	u_long pagenum, pagecont, boffset, bsize;
 	xnextent_t *extent = NULL;
 	xnholder_t *holder;
-	spl_t s;
-
-	xnlock_get_irqsave(&heap->lock, s);
 
 	/* Find the extent from which the returned block is
 	   originating. */
@@ -730,10 +1541,8 @@ int xnheap_test_and_free(xnheap_t *heap, void *block, int (*ckfn) (void *block))
 			break;
 	}
 
-	if (!holder) {
-		err = -EFAULT;
-		goto unlock_and_fail;
-	}
+	if (!holder)
+		return -EFAULT;
 
 	/* Compute the heading page number in the page map. */
 	pagenum = ((caddr_t) block - extent->membase) >> heap->pageshift;
@@ -746,17 +1555,12 @@ int xnheap_test_and_free(xnheap_t *heap, void *block, int (*ckfn) (void *block))
 	case XNHEAP_PCONT:	/* Not a range heading page? */
 
 	      bad_block:
-		err = -EINVAL;
-
-	      unlock_and_fail:
-
-		xnlock_put_irqrestore(&heap->lock, s);
-		return err;
+		return -EINVAL;
 
 	case XNHEAP_PLIST:
 
 		if (ckfn && (err = ckfn(block)) != 0)
-			goto unlock_and_fail;
+			return err;
 
 		npages = 1;
 
@@ -807,7 +1611,7 @@ int xnheap_test_and_free(xnheap_t *heap, void *block, int (*ckfn) (void *block))
 			goto bad_block;
 
 		if (ckfn && (err = ckfn(block)) != 0)
-			goto unlock_and_fail;
+			return err;
 
 		/*
 		 * Return the page to the free list if we've just
@@ -889,9 +1693,70 @@ int xnheap_test_and_free(xnheap_t *heap, void *block, int (*ckfn) (void *block))
 
 	heap->ubytes -= bsize;
 
+	return 0;
+}
+
+/*!
+ * \fn int xnheap_test_and_free(xnheap_t *heap,void *block,int (*ckfn)(void *block))
+ * \brief Test and release a memory block to a memory heap.
+ *
+ * Releases a memory region to the memory heap it was previously
+ * allocated from. Before the actual release is performed, an optional
+ * user-defined can be invoked to check for additional criteria with
+ * respect to the request consistency.
+ *
+ * @param heap The descriptor address of the heap to release memory
+ * to.
+ *
+ * @param block The address of the region to be returned to the heap.
+ *
+ * @param ckfn The address of a user-supplied verification routine
+ * which is to be called after the memory address specified by @a
+ * block has been checked for validity. The routine is expected to
+ * proceed to further consistency checks, and either return zero upon
+ * success, or non-zero upon error. In the latter case, the release
+ * process is aborted, and @a ckfn's return value is passed back to
+ * the caller of this service as its error return code. @a ckfn must
+ * not trigger the rescheduling procedure either directly or
+ * indirectly.
+ *
+ * @return 0 is returned upon success, or -EINVAL is returned whenever
+ * the block is not a valid region of the specified heap. Additional
+ * return codes can also be defined locally by the @a ckfn routine.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+
+int xnheap_test_and_free(xnheap_t *heap, void *block, int (*ckfn) (void *block))
+{
+	int err;
+	spl_t s;
+
+	if (xnheap_magazines_p(heap) && ckfn == NULL &&
+	    magazine_free(heap, block)) {
+		heap->stats.frees++;
+		return 0;
+	}
+
+	xnlock_get_irqsave(&heap->lock, s);
+	if (xnheap_tlsf_p(heap))
+		err = tlsf_free(heap, block, ckfn);
+	else
+		err = put_bucket_block(heap, block, ckfn);
+	if (err == 0)
+		heap->stats.frees++;
 	xnlock_put_irqrestore(&heap->lock, s);
 
-	return 0;
+	return err;
 }
 EXPORT_SYMBOL_GPL(xnheap_test_and_free);
 
@@ -971,6 +1836,14 @@ int xnheap_extend(xnheap_t *heap, void *extaddr, u_long extsize)
 	if (extsize != heap->extentsize)
 		return -EINVAL;
 
+	if (xnheap_tlsf_p(heap)) {
+		xnlock_get_irqsave(&heap->lock, s);
+		tlsf_init_extent(heap, extent);
+		appendq(&heap->extents, &extent->link);
+		xnlock_put_irqrestore(&heap->lock, s);
+		return 0;
+	}
+
 	init_extent(heap, extent);
 	xnlock_get_irqsave(&heap->lock, s);
 	appendq(&heap->extents, &extent->link);
@@ -1052,6 +1925,11 @@ int xnheap_check_block(xnheap_t *heap, void *block)
 
 	xnlock_get_irqsave(&heap->lock, s);
 
+	if (xnheap_tlsf_p(heap)) {
+		err = tlsf_check_block(heap, block);
+		goto unlock_and_exit;
+	}
+
 	/* Find the extent from which the checked block is
 	   originating. */
 
@@ -1075,26 +1953,599 @@ int xnheap_check_block(xnheap_t *heap, void *block)
   bad_block:
 		err = -EINVAL;
 
+  unlock_and_exit:
 	xnlock_put_irqrestore(&heap->lock, s);
 
 	return err;
 }
 EXPORT_SYMBOL_GPL(xnheap_check_block);
 
+/*!
+ * \fn void xnheap_get_xstats(xnheap_t *heap, struct xnheap_xstats *xs)
+ * \brief Report usage and fragmentation statistics of a heap.
+ *
+ * Collects the cumulative allocation counts of a heap, the worst
+ * time spent in xnheap_alloc() so far, and a picture of its free
+ * memory: the largest free contiguous chunk, a histogram of free
+ * chunks by power-of-two size class, and for the default allocator,
+ * how pages are used. A run of adjacent free pages counts as a
+ * single chunk, free blocks sitting in the per-size buckets are
+ * counted individually. Blocks cached in per-CPU magazines are not
+ * accounted for as free memory.
+ *
+ * The counters are updated without locking, and may thus be
+ * slightly off when the heap is used concurrently from several
+ * CPUs. The worst allocation time is only tracked with
+ * CONFIG_XENO_OPT_STATS, and reads zero otherwise.
+ *
+ * @param heap The descriptor address of the heap to inspect.
+ *
+ * @param xs The address of a structure receiving the statistics.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ *
+ * @note This service walks the page maps or free lists of the heap
+ * with its lock held, which takes time proportional to the heap
+ * size. It is meant for monitoring, not for time-critical code.
+ */
+
+void xnheap_get_xstats(xnheap_t *heap, struct xnheap_xstats *xs)
+{
+	u_long pagenum, run;
+	xnholder_t *holder;
+	xnextent_t *extent;
+	int ilog;
+	spl_t s;
+
+	memset(xs, 0, sizeof(*xs));
+
+	xnlock_get_irqsave(&heap->lock, s);
+
+	xs->allocs = heap->stats.allocs;
+	xs->frees = heap->stats.frees;
+	xs->failures = heap->stats.failures;
+	xs->maxalloc = xnarch_tsc_to_ns(heap->stats.maxalloc);
+
+	if (xnheap_tlsf_p(heap)) {
+		tlsf_get_xstats(heap, xs);
+		goto unlock_and_exit;
+	}
+
+	for (holder = getheadq(&heap->extents);
+	     holder != NULL; holder = nextq(&heap->extents, holder)) {
+		extent = link2extent(holder);
+		for (pagenum = 0, run = 0; pagenum < heap->npages; pagenum++) {
+			switch (extent->pagemap[pagenum].type) {
+			case XNHEAP_PFREE:
+				xs->pfree++;
+				run++;
+				continue;
+			case XNHEAP_PCONT:
+				xs->pcont++;
+				break;
+			case XNHEAP_PLIST:
+				xs->plist++;
+				break;
+			default:
+				xs->pbucket++;
+			}
+			if (run) {
+				xstats_add_chunk(xs, run << heap->pageshift);
+				run = 0;
+			}
+		}
+		if (run)
+			xstats_add_chunk(xs, run << heap->pageshift);
+	}
+
+	/* Only sub-page buckets keep free blocks around. */
+	for (ilog = 0; ilog < XNHEAP_NBUCKETS; ilog++) {
+		if (heap->buckets[ilog].fcount <= 0)
+			continue;
+		xs->freechunks[ilog] += heap->buckets[ilog].fcount;
+		if ((1UL << (ilog + XNHEAP_MINLOG2)) > xs->largest)
+			xs->largest = 1UL << (ilog + XNHEAP_MINLOG2);
+	}
+
+  unlock_and_exit:
+
+	xnlock_put_irqrestore(&heap->lock, s);
+}
+EXPORT_SYMBOL_GPL(xnheap_get_xstats);
+
+/*!
+ * \fn void xnobjpool_init(xnobjpool_t *pool, const char *name, u_long objsize, int capacity)
+ * \brief Initialize an object pool.
+ *
+ * Blocks of @a objsize bytes are obtained from the system heap to
+ * fill the pool up to @a capacity blocks. Falling short of system
+ * heap memory is not an error; the pool then serves the missing
+ * blocks from the system heap on demand.
+ *
+ * @param pool The address of a pool descriptor the nucleus will use
+ * to store the pool-related data.
+ *
+ * @param name The symbolic name of the pool, as displayed in
+ * /proc/xenomai/objpools.
+ *
+ * @param objsize The size of the pooled objects in bytes.
+ *
+ * @param capacity The number of free blocks the pool holds at most,
+ * which is also the prefill count. With a null value, every request
+ * goes to the system heap.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ *
+ * Rescheduling: never.
+ */
+
+void xnobjpool_init(xnobjpool_t *pool, const char *name,
+		    u_long objsize, int capacity)
+{
+	caddr_t obj;
+	spl_t s;
+
+	if (objsize < sizeof(caddr_t))
+		objsize = sizeof(caddr_t);
+
+	inith(&pool->link);
+	pool->freelist = NULL;
+	pool->objsize = objsize;
+	pool->nfree = 0;
+	pool->capacity = capacity;
+	pool->nused = 0;
+	pool->hits = 0;
+	pool->misses = 0;
+	xnlock_init(&pool->lock);
+	snprintf(pool->name, sizeof(pool->name), "%s", name);
+
+	while (pool->nfree < capacity) {
+		obj = xnmalloc(objsize);
+		if (obj == NULL)
+			break;
+		*(caddr_t *)obj = pool->freelist;
+		pool->freelist = obj;
+		pool->nfree++;
+	}
+
+	xnlock_get_irqsave(&nklock, s);
+	appendq(&poolq, &pool->link);
+	xnvfile_touch_tag(&pool_vfile_tag);
+	xnlock_put_irqrestore(&nklock, s);
+}
+EXPORT_SYMBOL_GPL(xnobjpool_init);
+
+/*!
+ * \fn void xnobjpool_destroy(xnobjpool_t *pool)
+ * \brief Destroy an object pool.
+ *
+ * The free blocks are returned to the system heap. Blocks still in
+ * use should be released by xnfree() afterwards.
+ *
+ * @param pool The descriptor address of the destroyed pool.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ *
+ * Rescheduling: never.
+ */
+
+void xnobjpool_destroy(xnobjpool_t *pool)
+{
+	caddr_t obj;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	removeq(&poolq, &pool->link);
+	xnvfile_touch_tag(&pool_vfile_tag);
+	xnlock_put_irqrestore(&nklock, s);
+
+	while ((obj = pool->freelist) != NULL) {
+		pool->freelist = *(caddr_t *)obj;
+		xnfree(obj);
+	}
+
+	pool->nfree = 0;
+}
+EXPORT_SYMBOL_GPL(xnobjpool_destroy);
+
+/*!
+ * \fn void *xnobjpool_alloc(xnobjpool_t *pool)
+ * \brief Get an object block from a pool.
+ *
+ * The block is picked from the free list in constant time if
+ * available, or obtained from the system heap otherwise.
+ *
+ * @param pool The descriptor address of the pool to get the block
+ * from.
+ *
+ * @return The address of the block upon success, or NULL if the pool
+ * is empty and the system heap is exhausted.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+
+void *xnobjpool_alloc(xnobjpool_t *pool)
+{
+	caddr_t obj;
+	spl_t s;
+
+	xnlock_get_irqsave(&pool->lock, s);
+
+	pool->nused++;
+	obj = pool->freelist;
+	if (obj) {
+		pool->freelist = *(caddr_t *)obj;
+		pool->nfree--;
+		pool->hits++;
+		xnlock_put_irqrestore(&pool->lock, s);
+		return obj;
+	}
+
+	pool->misses++;
+
+	xnlock_put_irqrestore(&pool->lock, s);
+
+	obj = xnmalloc(pool->objsize);
+	if (obj == NULL) {
+		xnlock_get_irqsave(&pool->lock, s);
+		pool->nused--;
+		xnlock_put_irqrestore(&pool->lock, s);
+	}
+
+	return obj;
+}
+EXPORT_SYMBOL_GPL(xnobjpool_alloc);
+
+/*!
+ * \fn void xnobjpool_free(xnobjpool_t *pool, void *obj)
+ * \brief Release an object block to a pool.
+ *
+ * The block is kept in the free list unless the pool is full, in
+ * which case it is returned to the system heap.
+ *
+ * @param pool The descriptor address of the pool the block was
+ * obtained from. A NULL pool releases the block to the system heap.
+ *
+ * @param obj The address of the released block.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+
+void xnobjpool_free(xnobjpool_t *pool, void *obj)
+{
+	spl_t s;
+
+	if (pool == NULL) {
+		xnfree(obj);
+		return;
+	}
+
+	xnlock_get_irqsave(&pool->lock, s);
+
+	pool->nused--;
+	if (pool->nfree < pool->capacity) {
+		*(caddr_t *)obj = pool->freelist;
+		pool->freelist = obj;
+		pool->nfree++;
+		obj = NULL;
+	}
+
+	xnlock_put_irqrestore(&pool->lock, s);
+
+	if (obj)
+		xnfree(obj);
+}
+EXPORT_SYMBOL_GPL(xnobjpool_free);
+
+#if CONFIG_XENO_OPT_SYS_STACKPOOLSZ > 0
+
+/*
+ * Kernel thread stacks. Requests are rounded up to a power-of-two
+ * stack class between 4k and 64k, and released stacks are kept in a
+ * small per-CPU cache for their class, so that drivers creating and
+ * deleting worker threads on the fly mostly recycle a stack freed
+ * on the same CPU, instead of going through the pool allocator.
+ * Larger stacks are served by the pool directly.
+ *
+ * With nucleus debugging on, every stack is preceded by a guard area
+ * filled with a known pattern, which is checked upon release to
+ * catch overflows. The stack pool is not backed by vmalloc memory,
+ * so we may not rely on unmapped guard pages for that purpose.
+ */
+
+#define XNHEAP_STACK_MINLOG2   12
+#define XNHEAP_STACK_MAXLOG2   16
+#define XNHEAP_STACK_NCLASSES  (XNHEAP_STACK_MAXLOG2 - XNHEAP_STACK_MINLOG2 + 1)
+
+#ifdef CONFIG_XENO_OPT_DEBUG_NUCLEUS
+#define XNHEAP_STACK_GUARD     256
+#define XNHEAP_STACK_PATTERN   0xa5
+#else
+#define XNHEAP_STACK_GUARD     0
+#endif
+
+#ifdef CONFIG_XENO_OPT_SYS_STACKCACHE
+
+struct xnheap_stack_cache {
+	xnlock_t lock;
+	int count;
+	caddr_t slots[CONFIG_XENO_OPT_SYS_STACKCACHE_DEPTH];
+};
+
+static struct xnheap_stack_cache
+stack_caches[XNARCH_NR_CPUS][XNHEAP_STACK_NCLASSES];
+
+static inline int stack_class(u_long size)
+{
+	int log2size = XNHEAP_STACK_MINLOG2;
+
+	while ((1UL << log2size) < size)
+		if (++log2size > XNHEAP_STACK_MAXLOG2)
+			return -1;
+
+	return log2size - XNHEAP_STACK_MINLOG2;
+}
+
+/*
+ * The cache lock is only contended when the pool runs short of
+ * memory and xnheap_flush_stacks() walks the caches of all CPUs.
+ */
+static caddr_t stack_cache_get(int class)
+{
+	struct xnheap_stack_cache *cache;
+	caddr_t stack = NULL;
+	spl_t s;
+
+	splhigh(s);
+	cache = &stack_caches[xnarch_current_cpu()][class];
+	xnlock_get(&cache->lock);
+	if (cache->count > 0)
+		stack = cache->slots[--cache->count];
+	xnlock_put(&cache->lock);
+	splexit(s);
+
+	return stack;
+}
+
+static int stack_cache_put(int class, caddr_t stack)
+{
+	struct xnheap_stack_cache *cache;
+	int ret = 0;
+	spl_t s;
+
+	splhigh(s);
+	cache = &stack_caches[xnarch_current_cpu()][class];
+	xnlock_get(&cache->lock);
+	if (cache->count < CONFIG_XENO_OPT_SYS_STACKCACHE_DEPTH) {
+		cache->slots[cache->count++] = stack;
+		ret = 1;
+	}
+	xnlock_put(&cache->lock);
+	splexit(s);
+
+	return ret;
+}
+
+void xnheap_init_stacks(void)
+{
+	struct xnheap_stack_cache *cache;
+	int cpu, class;
+
+	for (cpu = 0; cpu < XNARCH_NR_CPUS; cpu++)
+		for (class = 0; class < XNHEAP_STACK_NCLASSES; class++) {
+			cache = &stack_caches[cpu][class];
+			xnlock_init(&cache->lock);
+			cache->count = 0;
+		}
+}
+
+void xnheap_flush_stacks(void)
+{
+	struct xnheap_stack_cache *cache;
+	int cpu, class;
+	spl_t s;
+
+	for (cpu = 0; cpu < XNARCH_NR_CPUS; cpu++)
+		for (class = 0; class < XNHEAP_STACK_NCLASSES; class++) {
+			cache = &stack_caches[cpu][class];
+			xnlock_get_irqsave(&cache->lock, s);
+			while (cache->count > 0)
+				xnheap_free(&kstacks,
+					    cache->slots[--cache->count]);
+			xnlock_put_irqrestore(&cache->lock, s);
+		}
+}
+
+#else /* !CONFIG_XENO_OPT_SYS_STACKCACHE */
+
+static inline int stack_class(u_long size)
+{
+	return -1;
+}
+
+static inline caddr_t stack_cache_get(int class)
+{
+	return NULL;
+}
+
+static inline int stack_cache_put(int class, caddr_t stack)
+{
+	return 0;
+}
+
+void xnheap_init_stacks(void)
+{
+}
+
+void xnheap_flush_stacks(void)
+{
+}
+
+#endif /* !CONFIG_XENO_OPT_SYS_STACKCACHE */
+
+/*
+ * Stacks are obtained and released from a Linux context when
+ * creating and deleting kernel threads, but may also be released
+ * from the primary domain when a thread self-deletes.
+ */
+void *xnheap_alloc_stack(u_long size)
+{
+	caddr_t stack = NULL;
+	int class;
+
+	size += XNHEAP_STACK_GUARD;
+	class = stack_class(size);
+	if (class >= 0) {
+		stack = stack_cache_get(class);
+		size = 1UL << (class + XNHEAP_STACK_MINLOG2);
+	}
+
+	if (stack == NULL) {
+		stack = xnheap_alloc(&kstacks, size);
+		if (stack == NULL) {
+			/* Free stacks may be sitting in the caches. */
+			xnheap_flush_stacks();
+			stack = xnheap_alloc(&kstacks, size);
+			if (stack == NULL)
+				return NULL;
+		}
+	}
+
+#ifdef CONFIG_XENO_OPT_DEBUG_NUCLEUS
+	memset(stack, XNHEAP_STACK_PATTERN, XNHEAP_STACK_GUARD);
+#endif
+
+	return stack + XNHEAP_STACK_GUARD;
+}
+EXPORT_SYMBOL_GPL(xnheap_alloc_stack);
+
+void xnheap_free_stack(void *stackbase, u_long size)
+{
+	caddr_t stack = (caddr_t)stackbase - XNHEAP_STACK_GUARD;
+	int class;
+#ifdef CONFIG_XENO_OPT_DEBUG_NUCLEUS
+	int n;
+
+	for (n = 0; n < XNHEAP_STACK_GUARD; n++)
+		if ((u_char)stack[n] != XNHEAP_STACK_PATTERN) {
+			xnlogerr("kernel thread stack overflow detected "
+				 "(stack %p, %lu bytes)\n", stackbase, size);
+			break;
+		}
+#endif
+
+	class = stack_class(size + XNHEAP_STACK_GUARD);
+	if (class >= 0 && stack_cache_put(class, stack))
+		return;
+
+	xnheap_free(&kstacks, stack);
+}
+EXPORT_SYMBOL_GPL(xnheap_free_stack);
+
+#endif /* CONFIG_XENO_OPT_SYS_STACKPOOLSZ > 0 */
+
 #ifdef CONFIG_XENO_OPT_PERVASIVE
 
-#include <asm/io.h>
-#include <linux/miscdevice.h>
-#include <linux/device.h>
-#include <linux/vmalloc.h>
-#include <linux/mm.h>
-#include <linux/fs.h>
-#include <linux/spinlock.h>
+#include <asm/io.h>
+#include <linux/miscdevice.h>
+#include <linux/device.h>
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
+#include <linux/fs.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+
+static DEFINE_XNQUEUE(kheapq);	/* Shared heap queue. */
+static DEFINE_SPINLOCK(kheapq_lock);
+
+#ifdef CONFIG_XENO_OPT_NUMA
+
+/*
+ * Mapped heaps are backed by memory from the node of the CPU which
+ * creates them, which is where their owner most likely runs.
+ */
+static inline int heap_node(void)
+{
+	return numa_node_id();
+}
+
+static inline void *heap_vmalloc(size_t size, int node)
+{
+	return node < 0 ? vmalloc(size) : vmalloc_node(size, node);
+}
+
+static inline void *heap_kmalloc(size_t size, int flags, int node)
+{
+	return kmalloc_node(size, flags, node);
+}
+
+static inline void *heap_get_pages(int flags, int order, int node)
+{
+	struct page *page = alloc_pages_node(node, flags, order);
+
+	return page ? page_address(page) : NULL;
+}
+
+#else /* !CONFIG_XENO_OPT_NUMA */
+
+static inline int heap_node(void)
+{
+	return -1;
+}
+
+static inline void *heap_vmalloc(size_t size, int node)
+{
+	return vmalloc(size);
+}
+
+static inline void *heap_kmalloc(size_t size, int flags, int node)
+{
+	return kmalloc(size, flags);
+}
+
+static inline void *heap_get_pages(int flags, int order, int node)
+{
+	return (void *)__get_free_pages(flags, order);
+}
 
-static DEFINE_XNQUEUE(kheapq);	/* Shared heap queue. */
-static DEFINE_SPINLOCK(kheapq_lock);
+#endif /* !CONFIG_XENO_OPT_NUMA */
 
-static inline void *__alloc_and_reserve_heap(size_t size, int kmflags)
+static inline void *__alloc_and_reserve_heap(size_t size, int kmflags,
+					     int node)
 {
 	unsigned long vaddr, vabase;
 	void *ptr;
@@ -1103,7 +2554,7 @@ static inline void *__alloc_and_reserve_heap(size_t size, int kmflags)
 
 	if ((kmflags & ~XNHEAP_GFP_NONCACHED) == 0) {
 		if (kmflags == 0)
-			ptr = vmalloc(size);
+			ptr = heap_vmalloc(size, node);
 		else
 			ptr = __vmalloc(size,
 					GFP_KERNEL | __GFP_HIGHMEM,
@@ -1118,12 +2569,23 @@ static inline void *__alloc_and_reserve_heap(size_t size, int kmflags)
 		/*
 		 * Otherwise, we have been asked for some kmalloc()
 		 * space. Assume that we can wait to get the required memory.
+		 * Huge page requests always go to the page allocator, which
+		 * returns blocks naturally aligned on their order; don't
+		 * insist too much, the caller falls back to vmalloc().
+		 * The non-cached attribute only affects the user
+		 * mappings of such memory.
 		 */
-		if (size <= KMALLOC_MAX_SIZE)
-			ptr = kmalloc(size, kmflags | GFP_KERNEL);
+		kmflags &= ~XNHEAP_GFP_NONCACHED;
+		if (kmflags & XNHEAP_GFP_HUGE)
+			ptr = heap_get_pages((kmflags & ~XNHEAP_GFP_HUGE)
+					     | GFP_KERNEL | __GFP_NOWARN
+					     | __GFP_NORETRY,
+					     get_order(size), node);
+		else if (size <= KMALLOC_MAX_SIZE)
+			ptr = heap_kmalloc(size, kmflags | GFP_KERNEL, node);
 		else
-			ptr = (void *)__get_free_pages(kmflags | GFP_KERNEL,
-						       get_order(size));
+			ptr = heap_get_pages(kmflags | GFP_KERNEL,
+					     get_order(size), node);
 		if (ptr == NULL)
 			return NULL;
 
@@ -1152,13 +2614,334 @@ static void __unreserve_and_free_heap(void *ptr, size_t size, int kmflags)
 		for (vaddr = vabase; vaddr < vabase + size; vaddr += PAGE_SIZE)
 			ClearPageReserved(virt_to_page(vaddr));
 
-		if (size <= KMALLOC_MAX_SIZE)
+		if (size <= KMALLOC_MAX_SIZE && (kmflags & XNHEAP_GFP_HUGE) == 0)
 			kfree(ptr);
 		else
 			free_pages((unsigned long)ptr, get_order(size));
 	}
 }
 
+#ifdef CONFIG_XENO_OPT_SEM_HEAP_AUTOGROW
+
+static DEFINE_XNQUEUE(growq);	/* Heaps pending growth. */
+
+static DEFINE_BINARY_SEMAPHORE(growsem);
+
+static int grow_apc = -1;
+
+static DECLARE_WORK_FUNC(grow_callback);
+
+static DECLARE_WORK_NODATA(grow_work, &grow_callback);
+
+static void request_growth(xnheap_t *heap)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (heap->grow.maxext && !heap->grow.pending && grow_apc >= 0) {
+		heap->grow.pending = 1;
+		appendq(&growq, &heap->grow.link);
+		__rthal_apc_schedule(grow_apc);
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+static DECLARE_WORK_FUNC(grow_callback)
+{
+	struct xnholder *h;
+	void *extaddr;
+	xnheap_t *heap;
+	spl_t s;
+
+	/*
+	 * Extending a heap is fine from any context, but getting the
+	 * memory for the new extent requires a sleeping allocation,
+	 * which is why the real-time side defers the request to us.
+	 */
+	down(&growsem);
+
+	for (;;) {
+		xnlock_get_irqsave(&nklock, s);
+		h = getq(&growq);
+		if (h == NULL) {
+			xnlock_put_irqrestore(&nklock, s);
+			break;
+		}
+		heap = container_of(h, xnheap_t, grow.link);
+		heap->grow.pending = 0;
+		xnlock_put_irqrestore(&nklock, s);
+
+		if (countq(&heap->extents) >= heap->grow.maxext)
+			continue;
+
+		extaddr = __alloc_and_reserve_heap(xnheap_extentsize(heap),
+						   heap->grow.kmflags,
+						   heap->archdep.node);
+		if (extaddr == NULL) {
+			printk(KERN_WARNING "xnheap: cannot grow heap '%s'\n",
+			       heap->label);
+			continue;
+		}
+
+		xnheap_extend(heap, extaddr, xnheap_extentsize(heap));
+	}
+
+	up(&growsem);
+}
+
+static void grow_schedule(void *cookie)
+{
+	schedule_work(&grow_work);
+}
+
+static int init_growth(void)
+{
+	int apc;
+
+	apc = rthal_apc_alloc("heap_grow", &grow_schedule, NULL);
+	if (apc < 0)
+		return apc;
+
+	grow_apc = apc;
+
+	return 0;
+}
+
+static void cleanup_growth(void)
+{
+	int apc;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	apc = grow_apc;
+	grow_apc = -1;
+	xnlock_put_irqrestore(&nklock, s);
+
+	rthal_apc_free(apc);
+	flush_scheduled_work();
+}
+
+static void stop_growth(xnheap_t *heap)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	heap->grow.maxext = 0;
+	if (heap->grow.pending) {
+		removeq(&growq, &heap->grow.link);
+		heap->grow.pending = 0;
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	/* Wait for any extension in progress to complete. */
+	down(&growsem);
+	up(&growsem);
+}
+
+/**
+ * Enable on-demand growth of a mapped heap.
+ *
+ * Once enabled, a new extent of the same size is added to the heap
+ * each time its memory usage crosses XNHEAP_GROW_WMARK percent of
+ * the usable space, until @a maxext extents are attached. Memory for
+ * the new extents is obtained from a Linux work queue, so requests
+ * issued from the real-time domain never block.
+ *
+ * @param heap The descriptor address of a heap obtained from
+ * xnheap_init_mapped().
+ *
+ * @param maxext The maximum number of extents. A value of one
+ * disables growth.
+ *
+ * @return 0 is returned upon success, or -EINVAL if @a heap is not a
+ * mapped heap or @a maxext is lower than one.
+ */
+int xnheap_set_autogrow(xnheap_t *heap, int maxext)
+{
+	spl_t s;
+
+	if (!xnheap_mapped_p(heap) || maxext < 1)
+		return -EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+	/* Added extents are never huge-page backed. */
+	heap->grow.kmflags = heap->archdep.kmflags & ~XNHEAP_GFP_HUGE;
+	heap->grow.maxext = maxext > 1 ? maxext : 0;
+	xnlock_put_irqrestore(&nklock, s);
+
+	check_growth(heap);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(xnheap_set_autogrow);
+
+unsigned long xnheap_mapped_offset(xnheap_t *heap, void *ptr)
+{
+	caddr_t p = ptr, base = (caddr_t)xnheap_base_memory(heap);
+	u_long extsize = xnheap_extentsize(heap), off, ret;
+	struct xnholder *h;
+	spl_t s;
+
+	ret = p - base;
+	if (p >= base && p < base + extsize)
+		return ret;
+
+	xnlock_get_irqsave(&heap->lock, s);
+
+	for (h = getheadq(&heap->extents), off = 0;
+	     h; h = nextq(&heap->extents, h), off += extsize) {
+		base = (caddr_t)link2extent(h);
+		if (p >= base && p < base + extsize) {
+			ret = off + (p - base);
+			break;
+		}
+	}
+
+	xnlock_put_irqrestore(&heap->lock, s);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(xnheap_mapped_offset);
+
+caddr_t xnheap_mapped_address(xnheap_t *heap, unsigned long off)
+{
+	u_long extsize = xnheap_extentsize(heap);
+	struct xnholder *h;
+	caddr_t ret = NULL;
+	spl_t s;
+
+	if (off < extsize)
+		return (caddr_t)xnheap_base_memory(heap) + off;
+
+	xnlock_get_irqsave(&heap->lock, s);
+
+	for (h = getheadq(&heap->extents);
+	     h; h = nextq(&heap->extents, h), off -= extsize) {
+		if (off < extsize) {
+			ret = (caddr_t)link2extent(h) + off;
+			break;
+		}
+	}
+
+	xnlock_put_irqrestore(&heap->lock, s);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(xnheap_mapped_address);
+
+/*
+ * Return the allocation flags of the extent which covers the memory
+ * range to be mapped, or -1 if there is no such extent.
+ */
+static int __validate_map_range(struct xnheap *heap,
+				unsigned long vaddr, unsigned long size)
+{
+	u_long extsize = xnheap_extentsize(heap), base;
+	struct xnholder *h;
+	int kmflags = -1;
+	spl_t s;
+
+	xnlock_get_irqsave(&heap->lock, s);
+
+	for (h = getheadq(&heap->extents); h; h = nextq(&heap->extents, h)) {
+		base = (unsigned long)link2extent(h);
+		if (vaddr >= base && vaddr + size <= base + extsize) {
+			kmflags = (void *)base == heap->archdep.heapbase ?
+				heap->archdep.kmflags : heap->grow.kmflags;
+			break;
+		}
+	}
+
+	xnlock_put_irqrestore(&heap->lock, s);
+
+	return kmflags;
+}
+
+static void __release_heap_memory(struct xnheap *heap)
+{
+	struct xnholder *h;
+	void *extaddr;
+
+	while ((h = getq(&heap->extents)) != NULL) {
+		extaddr = link2extent(h);
+		if (extaddr != heap->archdep.heapbase)
+			__unreserve_and_free_heap(extaddr,
+						  xnheap_extentsize(heap),
+						  heap->grow.kmflags);
+	}
+
+	__unreserve_and_free_heap(heap->archdep.heapbase,
+				  xnheap_extentsize(heap),
+				  heap->archdep.kmflags);
+}
+
+#else /* !CONFIG_XENO_OPT_SEM_HEAP_AUTOGROW */
+
+static inline int init_growth(void)
+{
+	return 0;
+}
+
+static inline void cleanup_growth(void) { }
+
+static inline void stop_growth(xnheap_t *heap) { }
+
+static int __validate_map_range(struct xnheap *heap,
+				unsigned long vaddr, unsigned long size)
+{
+	/*
+	 * Cannot map multi-extent heaps, we need the memory area we
+	 * map from to be contiguous.
+	 */
+	if (countq(&heap->extents) > 1)
+		return -1;
+
+	if (vaddr + size >
+	    xnheap_base_memory(heap) + xnheap_extentsize(heap))
+		return -1;
+
+	return heap->archdep.kmflags;
+}
+
+static inline void __release_heap_memory(struct xnheap *heap)
+{
+	__unreserve_and_free_heap(heap->archdep.heapbase,
+				  xnheap_extentsize(heap),
+				  heap->archdep.kmflags);
+}
+
+#endif /* !CONFIG_XENO_OPT_SEM_HEAP_AUTOGROW */
+
+/*
+ * Return the number of extents attached to a mapped heap, fetching
+ * the mapping offset of the extent at @index into *@areap, or zero if
+ * the heap has no such extent yet.
+ */
+int xnheap_mapped_extent(xnheap_t *heap, int index, unsigned long *areap)
+{
+	struct xnholder *h;
+	int nrext = 0;
+	spl_t s;
+
+	*areap = 0;
+
+	xnlock_get_irqsave(&heap->lock, s);
+
+	for (h = getheadq(&heap->extents); h; h = nextq(&heap->extents, h)) {
+		if (nrext++ == index)
+			*areap = (unsigned long)link2extent(h);
+	}
+
+	xnlock_put_irqrestore(&heap->lock, s);
+
+	return nrext;
+}
+EXPORT_SYMBOL_GPL(xnheap_mapped_extent);
+
 static void xnheap_vmopen(struct vm_area_struct *vma)
 {
 	xnheap_t *heap = vma->vm_private_data;
@@ -1177,9 +2960,7 @@ static void xnheap_vmclose(struct vm_area_struct *vma)
 	if (--heap->archdep.numaps == 0 && heap->archdep.release) {
 		removeq(&kheapq, &heap->link);
 		spin_unlock(&kheapq_lock);
-		__unreserve_and_free_heap(heap->archdep.heapbase,
-					  xnheap_extentsize(heap),
-					  heap->archdep.kmflags);
+		__release_heap_memory(heap);
 		heap->archdep.release(heap);
 		return;
 	}
@@ -1247,16 +3028,8 @@ static int xnheap_mmap(struct file *file, struct vm_area_struct *vma)
 	vma->vm_private_data = file->private_data;
 	vma->vm_ops = &xnheap_vmops;
 	size = vma->vm_end - vma->vm_start;
-	kmflags = heap->archdep.kmflags;
 	ret = -ENXIO;
 
-	/*
-	 * Cannot map multi-extent heaps, we need the memory area we
-	 * map from to be contiguous.
-	 */
-	if (countq(&heap->extents) > 1)
-		goto deref_out;
-
 	vaddr = vma->vm_pgoff << PAGE_SHIFT;
 
 	/*
@@ -1267,10 +3040,11 @@ static int xnheap_mmap(struct file *file, struct vm_area_struct *vma)
 	 * always requests mappings on non-overlapping areas for
 	 * different heaps, by passing offset values which are actual
 	 * RAM addresses. We do the same in the MMU case as well, to
-	 * keep a single implementation for both.
+	 * keep a single implementation for both. Extents added to a
+	 * growing heap are mapped separately the same way.
 	 */
-	if (vaddr + size >
-	    xnheap_base_memory(heap) + xnheap_extentsize(heap))
+	kmflags = __validate_map_range(heap, vaddr, size);
+	if (kmflags < 0)
 		goto deref_out;
 
 #ifdef CONFIG_MMU
@@ -1289,11 +3063,15 @@ static int xnheap_mmap(struct file *file, struct vm_area_struct *vma)
 			vaddr += PAGE_SIZE;
 			size -= PAGE_SIZE;
 		}
-	} else if (xnarch_remap_io_page_range(file,vma,
-					      vma->vm_start,
-					      __pa(vaddr),
-					      size, vma->vm_page_prot))
-		goto deref_out;
+	} else {
+		if (kmflags & XNHEAP_GFP_NONCACHED)
+			vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+		if (xnarch_remap_io_page_range(file,vma,
+					       vma->vm_start,
+					       __pa(vaddr),
+					       size, vma->vm_page_prot))
+			goto deref_out;
+	}
 
 	xnarch_fault_range(vma);
 #else /* !CONFIG_MMU */
@@ -1310,6 +3088,58 @@ deref_out:
 	return ret;
 }
 
+/*
+ * Charge a page fault a real-time thread took at @a addr to the
+ * mapped heap covering this address, if any. Called on behalf of
+ * the faulting thread, once relaxed.
+ */
+void xnheap_account_fault(unsigned long addr)
+{
+	struct mm_struct *mm = current->mm;
+	struct vm_area_struct *vma;
+	struct xnheap *heap;
+
+	if (mm == NULL || !down_read_trylock(&mm->mmap_sem))
+		return;
+
+	vma = find_vma(mm, addr);
+	if (vma && vma->vm_start <= addr && vma->vm_ops == &xnheap_vmops) {
+		heap = vma->vm_private_data;
+		spin_lock(&kheapq_lock);
+		heap->archdep.faults++;
+		spin_unlock(&kheapq_lock);
+	}
+
+	up_read(&mm->mmap_sem);
+}
+
+#ifdef CONFIG_XENO_OPT_VFILE
+
+void xnheap_show_faults(struct xnvfile_regular_iterator *it)
+{
+	struct xnholder *h;
+	struct xnheap *heap;
+	int header = 0;
+
+	spin_lock(&kheapq_lock);
+
+	for (h = getheadq(&kheapq); h; h = nextq(&kheapq, h)) {
+		heap = link2heap(h);
+		if (heap->archdep.faults == 0)
+			continue;
+		if (!header) {
+			xnvfile_printf(it, "\n%-12s %s\n", "FAULTS", "HEAP");
+			header = 1;
+		}
+		xnvfile_printf(it, "%-12lu %s\n",
+			       heap->archdep.faults, heap->label);
+	}
+
+	spin_unlock(&kheapq_lock);
+}
+
+#endif /* CONFIG_XENO_OPT_VFILE */
+
 #ifndef CONFIG_MMU
 static unsigned long xnheap_get_unmapped_area(struct file *file,
 					      unsigned long addr,
@@ -1348,29 +3178,65 @@ fail:
 
 int xnheap_init_mapped(xnheap_t *heap, u_long heapsize, int memflags)
 {
+	int err, heapflags, node;
 	void *heapbase;
-	int err;
 
 	/* Caller must have accounted for internal overhead. */
 	heapsize = xnheap_align(heapsize, PAGE_SIZE);
 
-	if ((memflags & XNHEAP_GFP_NONCACHED)
-	    && memflags != XNHEAP_GFP_NONCACHED)
-		return -EINVAL;
+	if (memflags & XNHEAP_GFP_MAGAZINE) {
+		memflags &= ~XNHEAP_GFP_MAGAZINE;
+		heapflags = XNHEAP_MAGAZINE;
+	} else
+		heapflags = 0;
 
-	heapbase = __alloc_and_reserve_heap(heapsize, memflags);
-	if (heapbase == NULL)
-		return -ENOMEM;
+	if (memflags & XNHEAP_GFP_TLSF) {
+		memflags &= ~XNHEAP_GFP_TLSF;
+		heapflags |= XNHEAP_TLSF;
+	}
+
+	heapbase = NULL;
+	node = heap_node();
+
+	if (memflags & XNHEAP_GFP_HUGE) {
+		/*
+		 * Try to get a physically contiguous block aligned on
+		 * the huge page size, so that the kernel accesses the
+		 * heap through the large pages of its linear mapping,
+		 * and the user mapping is remapped as a single
+		 * contiguous range. Fall back to the regular
+		 * allocation if no such block is available.
+		 */
+		u_long hugesize = ALIGN(heapsize, XNHEAP_HUGE_PAGE_SIZE);
+
+		if (get_order(hugesize) < MAX_ORDER) {
+			heapbase = __alloc_and_reserve_heap(hugesize, memflags,
+							    node);
+			if (heapbase)
+				heapsize = hugesize;
+		}
+
+		if (heapbase == NULL)
+			memflags &= ~XNHEAP_GFP_HUGE;
+	}
+
+	if (heapbase == NULL) {
+		heapbase = __alloc_and_reserve_heap(heapsize, memflags, node);
+		if (heapbase == NULL)
+			return -ENOMEM;
+	}
 
-	err = xnheap_init(heap, heapbase, heapsize, PAGE_SIZE);
+	err = xnheap_init(heap, heapbase, heapsize, PAGE_SIZE, heapflags);
 	if (err) {
 		__unreserve_and_free_heap(heapbase, heapsize, memflags);
 		return err;
 	}
 
 	heap->archdep.kmflags = memflags;
+	heap->archdep.node = node;
 	heap->archdep.heapbase = heapbase;
 	heap->archdep.release = NULL;
+	heap->archdep.faults = 0;
 
 	spin_lock(&kheapq_lock);
 	appendq(&kheapq, &heap->link);
@@ -1402,6 +3268,10 @@ void xnheap_destroy_mapped(xnheap_t *heap,
 	xnvfile_touch_tag(&vfile_tag);
 	xnlock_put_irqrestore(&nklock, s);
 
+	stop_growth(heap);
+
+	cleanup_magazines(heap);
+
 	len = xnheap_extentsize(heap);
 
 	/*
@@ -1445,8 +3315,7 @@ void xnheap_destroy_mapped(xnheap_t *heap,
 
 	spin_unlock(&kheapq_lock);
 
-	__unreserve_and_free_heap(heap->archdep.heapbase, len,
-				  heap->archdep.kmflags);
+	__release_heap_memory(heap);
 	if (release)
 		release(heap);
 }
@@ -1465,12 +3334,23 @@ static struct miscdevice xnheap_dev = {
 
 int xnheap_mount(void)
 {
-	return misc_register(&xnheap_dev);
+	int ret;
+
+	ret = init_growth();
+	if (ret)
+		return ret;
+
+	ret = misc_register(&xnheap_dev);
+	if (ret)
+		cleanup_growth();
+
+	return ret;
 }
 
 void xnheap_umount(void)
 {
 	misc_deregister(&xnheap_dev);
+	cleanup_growth();
 }
 
 #elif !defined(__XENO_SIM__) /* !CONFIG_XENO_OPT_PERVASIVE */
@@ -1482,16 +3362,26 @@ static void xnheap_free_extent(xnheap_t *heap,
 
 int xnheap_init_mapped(xnheap_t *heap, u_long heapsize, int memflags)
 {
+	int ret, heapflags;
 	void *heapaddr;
-	int ret;
 
-	if ((memflags & XNHEAP_GFP_NONCACHED)
-	    && memflags != XNHEAP_GFP_NONCACHED)
-		return -EINVAL;
+	if (memflags & XNHEAP_GFP_MAGAZINE) {
+		memflags &= ~XNHEAP_GFP_MAGAZINE;
+		heapflags = XNHEAP_MAGAZINE;
+	} else
+		heapflags = 0;
+
+	if (memflags & XNHEAP_GFP_TLSF) {
+		memflags &= ~XNHEAP_GFP_TLSF;
+		heapflags |= XNHEAP_TLSF;
+	}
+
+	memflags &= ~XNHEAP_GFP_HUGE;
 
 	heapaddr = xnarch_alloc_host_mem(heapsize);
 	if (heapaddr) {
-		ret = xnheap_init(heap, heapaddr, heapsize, XNHEAP_PAGE_SIZE);
+		ret = xnheap_init(heap, heapaddr, heapsize, XNHEAP_PAGE_SIZE,
+				  heapflags);
 		if (ret)
 			xnarch_free_host_mem(heapaddr, heapsize);
 
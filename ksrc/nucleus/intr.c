@@ -35,6 +35,8 @@
 #include <nucleus/pod.h>
 #include <nucleus/intr.h>
 #include <nucleus/stat.h>
+#include <nucleus/evtrace.h>
+#include <nucleus/statmap.h>
 #include <asm/xenomai/bits/intr.h>
 
 #define XNINTR_MAX_UNHANDLED	1000
@@ -83,6 +85,34 @@ static inline void xnintr_sync_stat_references(xnintr_t *intr) {}
 
 static void xnintr_irq_handler(unsigned irq, void *cookie);
 
+#ifdef CONFIG_SMP
+/*
+ * Track the receipts which woke up a thread running on another CPU,
+ * i.e. which will cost an IPI on exit from the interrupt. @remote
+ * tells whether a remote rescheduling was already pending.
+ */
+static inline void xnintr_count_xwakeup(struct xnsched *sched,
+					xnintr_t *intr, int *remote)
+{
+	if (!*remote && !xnarch_cpus_empty(sched->resched)) {
+		xnstat_counter_inc(&intr->stat[xnsched_cpu(sched)].xwakeups);
+		*remote = 1;
+	}
+}
+
+static inline int xnintr_remote_pending(struct xnsched *sched)
+{
+	return !xnarch_cpus_empty(sched->resched);
+}
+#else /* !CONFIG_SMP */
+static inline void xnintr_count_xwakeup(struct xnsched *sched,
+					xnintr_t *intr, int *remote) {}
+static inline int xnintr_remote_pending(struct xnsched *sched)
+{
+	return 0;
+}
+#endif /* !CONFIG_SMP */
+
 void xnintr_host_tick(struct xnsched *sched) /* Interrupts off. */
 {
 	__clrbits(sched->lflags, XNHTICK);
@@ -102,8 +132,13 @@ void xnintr_clock_handler(void)
 		return;
 	}
 
+	xnsched_stamp_phase(sched, XNSCHED_PHASE_IRQ);
 	prev = xnstat_exectime_switch(sched, &nkclock.stat[cpu].account);
 	xnstat_counter_inc(&nkclock.stat[cpu].hits);
+#ifdef CONFIG_XENO_OPT_STATS
+	/* The exectime sampler charges the preempted account. */
+	sched->sampled_account = prev;
+#endif /* CONFIG_XENO_OPT_STATS */
 
 	trace_mark(xn_nucleus, irq_enter, "irq %u", XNARCH_TIMER_IRQ);
 	trace_mark(xn_nucleus, tbase_tick, "base %s", nktbase.name);
@@ -113,9 +148,12 @@ void xnintr_clock_handler(void)
 
 	xnlock_get(&nklock);
 	xntimer_tick_aperiodic();
+	xnshadow_publish(sched->curr);
 	xnlock_put(&nklock);
 
 	xnstat_exectime_switch(sched, prev);
+	/* Keep the figures of CPU-bound threads fresh. */
+	xnstatmap_publish(sched->curr);
 
 	if (--sched->inesting == 0) {
 		__clrbits(sched->lflags, XNINIRQ);
@@ -140,11 +178,19 @@ void xnintr_clock_handler(void)
 
 #ifdef CONFIG_XENO_OPT_SHIRQ
 
+/*
+ * Number of claimed receipts after which the handler to try first on
+ * a shared line is elected again.
+ */
+#define XNINTR_SHIRQ_ELECT	256
+
 typedef struct xnintr_irq {
 
 	DECLARE_XNLOCK(lock);
 
 	xnintr_t *handlers;
+	xnintr_t *hot;		/* Handler which claimed most receipts. */
+	unsigned long receipts;	/* Claimed receipts since the last election. */
 	int unhandled;
 
 } ____cacheline_aligned_in_smp xnintr_irq_t;
@@ -161,6 +207,44 @@ static inline xnintr_t *xnintr_shirq_next(xnintr_t *prev)
 	return prev->next;
 }
 
+/*
+ * The dispatchers walk the chain circularly, starting from the
+ * hottest handler; the chain itself is left in attachment order, so
+ * that the /proc iterators are not disturbed. Called with shirq->lock
+ * held.
+ */
+static void xnintr_shirq_elect(xnintr_irq_t *shirq)
+{
+	unsigned long max = 0;
+	xnintr_t *intr;
+
+	for (intr = shirq->handlers; intr; intr = intr->next) {
+		if (intr->shirq_hits > max) {
+			max = intr->shirq_hits;
+			shirq->hot = intr;
+		}
+		intr->shirq_hits = 0;
+	}
+
+	shirq->receipts = 0;
+}
+
+static inline void xnintr_shirq_hit(xnintr_irq_t *shirq, xnintr_t *intr)
+{
+	intr->shirq_hits++;
+	if (++shirq->receipts >= XNINTR_SHIRQ_ELECT)
+		xnintr_shirq_elect(shirq);
+}
+
+static inline int xnintr_shirq_call(xnintr_t *intr)
+{
+	/* A negative claim check spares the whole ISR invocation. */
+	if (intr->claim && !intr->claim(intr))
+		return XN_ISR_NONE;
+
+	return intr->isr(intr);
+}
+
 /*
  * Low-level interrupt handler dispatching the user-defined ISRs for
  * shared interrupts -- Called with interrupts off.
@@ -171,25 +255,32 @@ static void xnintr_shirq_handler(unsigned irq, void *cookie)
 	xnintr_irq_t *shirq = &xnirqs[irq];
 	xnstat_exectime_t *prev;
 	xnticks_t start;
-	xnintr_t *intr;
-	int s = 0, ret;
+	xnintr_t *intr, *end;
+	int s = 0, ret, remote;
 
 	prev  = xnstat_exectime_get_current(sched);
-	start = xnstat_exectime_now();
+	start = xnstat_exectime_lazy_now();
 	trace_mark(xn_nucleus, irq_enter, "irq %u", irq);
 
 	++sched->inesting;
 	__setbits(sched->lflags, XNINIRQ);
 
 	xnlock_get(&shirq->lock);
-	intr = shirq->handlers;
+	remote = xnintr_remote_pending(sched);
+	intr = end = shirq->hot;
 
+	/*
+	 * Stop at the first handler claiming the interrupt: the line
+	 * being level-triggered, it remains asserted if another
+	 * device is still requesting service, and the next receipt
+	 * will take care of it.
+	 */
 	while (intr) {
 		/*
 		 * NOTE: We assume that no CPU migration will occur
 		 * while running the interrupt service routine.
 		 */
-		ret = intr->isr(intr);
+		ret = xnintr_shirq_call(intr);
 		s |= ret;
 
 		if (ret & XN_ISR_HANDLED) {
@@ -198,10 +289,15 @@ static void xnintr_shirq_handler(unsigned irq, void *cookie)
 			xnstat_exectime_lazy_switch(sched,
 				&intr->stat[xnsched_cpu(sched)].account,
 				start);
-			start = xnstat_exectime_now();
+			xnintr_count_xwakeup(sched, intr, &remote);
+			xnintr_shirq_hit(shirq, intr);
+			break;
 		}
 
-		intr = intr->next;
+		if (!(intr = intr->next))
+			intr = shirq->handlers;
+		if (intr == end)
+			break;
 	}
 
 	xnlock_put(&shirq->lock);
@@ -239,20 +335,21 @@ static void xnintr_edge_shirq_handler(unsigned irq, void *cookie)
 	const int MAX_EDGEIRQ_COUNTER = 128;
 	struct xnsched *sched = xnpod_current_sched();
 	xnintr_irq_t *shirq = &xnirqs[irq];
-	int s = 0, counter = 0, ret, code;
+	int s = 0, counter = 0, ret, code, remote;
 	struct xnintr *intr, *end = NULL;
 	xnstat_exectime_t *prev;
 	xnticks_t start;
 
 	prev  = xnstat_exectime_get_current(sched);
-	start = xnstat_exectime_now();
+	start = xnstat_exectime_lazy_now();
 	trace_mark(xn_nucleus, irq_enter, "irq %u", irq);
 
 	++sched->inesting;
 	__setbits(sched->lflags, XNINIRQ);
 
 	xnlock_get(&shirq->lock);
-	intr = shirq->handlers;
+	remote = xnintr_remote_pending(sched);
+	intr = shirq->hot;
 
 	while (intr != end) {
 		xnstat_exectime_switch(sched,
@@ -261,7 +358,7 @@ static void xnintr_edge_shirq_handler(unsigned irq, void *cookie)
 		 * NOTE: We assume that no CPU migration will occur
 		 * while running the interrupt service routine.
 		 */
-		ret = intr->isr(intr);
+		ret = xnintr_shirq_call(intr);
 		code = ret & ~XN_ISR_BITMASK;
 		s |= ret;
 
@@ -272,7 +369,9 @@ static void xnintr_edge_shirq_handler(unsigned irq, void *cookie)
 			xnstat_exectime_lazy_switch(sched,
 				&intr->stat[xnsched_cpu(sched)].account,
 				start);
-			start = xnstat_exectime_now();
+			start = xnstat_exectime_lazy_now();
+			xnintr_count_xwakeup(sched, intr, &remote);
+			xnintr_shirq_hit(shirq, intr);
 		} else if (end == NULL)
 			end = intr;
 
@@ -345,6 +444,7 @@ static inline int xnintr_irq_attach(xnintr_t *intr)
 
 		}
 		shirq->unhandled = 0;
+		shirq->receipts = 0;
 
 		err = xnarch_hook_irq(intr->irq, handler,
 				      (rthal_irq_ackfn_t)intr->iack, intr);
@@ -353,10 +453,15 @@ static inline int xnintr_irq_attach(xnintr_t *intr)
 	}
 
 	intr->next = NULL;
+	intr->shirq_hits = 0;
 
-	/* Add the given interrupt object. No need to synchronise with the IRQ
-	   handler, we are only extending the chain. */
+	/* Add the given interrupt object. The dispatchers may move the
+	   hottest handler, so synchronise with them. */
+	xnlock_get(&shirq->lock);
 	*p = intr;
+	if (shirq->hot == NULL)
+		shirq->hot = intr;
+	xnlock_put(&shirq->lock);
 
 	return 0;
 }
@@ -372,6 +477,8 @@ static inline int xnintr_irq_detach(xnintr_t *intr)
 			/* Remove the given interrupt object from the list. */
 			xnlock_get(&shirq->lock);
 			*p = e->next;
+			if (shirq->hot == e)
+				shirq->hot = shirq->handlers;
 			xnlock_put(&shirq->lock);
 
 			xnintr_sync_stat_references(intr);
@@ -433,6 +540,127 @@ static inline int xnintr_irq_detach(xnintr_t *intr)
 
 #endif /* !CONFIG_XENO_OPT_SHIRQ */
 
+/*
+ * Threaded interrupts: the low-level handler only wakes up a
+ * per-IRQ real-time thread, leaving the line masked. The thread runs
+ * the ISR, then re-enables the line, so that the bulk of the
+ * interrupt processing is scheduled like any other real-time
+ * activity.
+ */
+struct xnintr_thread {
+	struct xnthread thread;
+	xnholder_t link;	/* For xnfreesafe(). */
+};
+
+static void xnintr_thread_body(void *cookie)
+{
+	xnintr_t *intr = cookie;
+	struct xnthread *curr = &intr->irqthread->thread;
+	struct xnsched *sched;
+	spl_t s;
+	int ret;
+
+	for (;;) {
+		xnlock_get_irqsave(&nklock, s);
+
+		while (intr->pending == 0)
+			xnpod_suspend_thread(curr, XNSUSP,
+					     XN_INFINITE, XN_RELATIVE, NULL);
+		/*
+		 * Events which piled up while we were busy are
+		 * processed by a single run of the ISR, which has to
+		 * check the device status anyway.
+		 */
+		intr->pending = 0;
+
+		xnlock_put_irqrestore(&nklock, s);
+
+		ret = intr->isr(intr);
+
+		splhigh(s);
+
+		sched = xnpod_current_sched();
+
+		if (unlikely(ret == XN_ISR_NONE)) {
+			if (++intr->unhandled == XNINTR_MAX_UNHANDLED) {
+				xnlogerr("%s: IRQ%d not handled. Disabling IRQ "
+					 "line.\n", __FUNCTION__, intr->irq);
+				ret |= XN_ISR_NOENABLE;
+			}
+		} else {
+			xnstat_counter_inc(&intr->stat[xnsched_cpu(sched)].hits);
+			intr->unhandled = 0;
+		}
+
+		/* XN_ISR_PROPAGATE makes no sense past the pipeline. */
+		if (!(ret & XN_ISR_NOENABLE))
+			xnarch_end_irq(intr->irq);
+
+		splexit(s);
+	}
+}
+
+static int xnintr_thread_create(xnintr_t *intr)
+{
+	union xnsched_policy_param param;
+	struct xnthread_start_attr sattr;
+	struct xnthread_init_attr iattr;
+	char name[XNOBJECT_NAME_LEN];
+	struct xnintr_thread *it;
+	int ret;
+
+	it = xnmalloc(sizeof(*it));
+	if (it == NULL)
+		return -ENOMEM;
+
+	snprintf(name, sizeof(name), "irq%u", intr->irq);
+	iattr.tbase = &nktbase;
+	iattr.name = name;
+	iattr.flags = 0;
+	iattr.ops = NULL;
+	iattr.stacksize = 0;
+	param.rt.prio = (intr->flags & XN_ISR_PRIO_MASK) >> XN_ISR_PRIO_SHIFT;
+	if (param.rt.prio == 0)
+		param.rt.prio = XNSCHED_HIGH_PRIO;
+
+	ret = xnpod_init_thread(&it->thread, &iattr, &xnsched_class_rt, &param);
+	if (ret) {
+		xnfree(it);
+		return ret;
+	}
+
+	intr->irqthread = it;
+	intr->pending = 0;
+
+	sattr.mode = 0;
+	sattr.imask = 0;
+	sattr.affinity = XNPOD_ALL_CPUS;
+	sattr.entry = xnintr_thread_body;
+	sattr.cookie = intr;
+	ret = xnpod_start_thread(&it->thread, &sattr);
+	if (ret) {
+		xnpod_delete_thread(&it->thread);
+		xnfree(it);
+		intr->irqthread = NULL;
+	}
+
+	return ret;
+}
+
+static void xnintr_thread_delete(struct xnintr_thread *it)
+{
+	xnpod_delete_thread(&it->thread);
+	xnfreesafe(&it->thread, it, &it->link);
+}
+
+static inline void xnintr_thread_wakeup(xnintr_t *intr)
+{
+	xnlock_get(&nklock);
+	intr->pending++;
+	xnpod_resume_thread(&intr->irqthread->thread, XNSUSP);
+	xnlock_put(&nklock);
+}
+
 /*
  * Low-level interrupt handler dispatching non-shared ISRs -- Called with
  * interrupts off.
@@ -443,11 +671,12 @@ static void xnintr_irq_handler(unsigned irq, void *cookie)
 	xnstat_exectime_t *prev;
 	struct xnintr *intr;
 	xnticks_t start;
-	int s;
+	int s, remote;
 
 	prev  = xnstat_exectime_get_current(sched);
-	start = xnstat_exectime_now();
+	start = xnstat_exectime_lazy_now();
 	trace_mark(xn_nucleus, irq_enter, "irq %u", irq);
+	xnevtrace_log(XNEVT_IRQ, NULL, irq);
 
 	++sched->inesting;
 	__setbits(sched->lflags, XNINIRQ);
@@ -471,6 +700,17 @@ static void xnintr_irq_handler(unsigned irq, void *cookie)
 	/* cookie always valid, attach/detach happens with IRQs disabled */
 	intr = cookie;
 #endif
+	if (intr->flags & XN_ISR_THREADED) {
+		/* The IRQ thread will re-enable the line. */
+		xnintr_thread_wakeup(intr);
+		xnstat_exectime_lazy_switch(sched,
+			&intr->stat[xnsched_cpu(sched)].account,
+			start);
+		s = XN_ISR_HANDLED | XN_ISR_NOENABLE;
+		goto unlock_and_exit;
+	}
+
+	remote = xnintr_remote_pending(sched);
 	s = intr->isr(intr);
 	if (unlikely(s == XN_ISR_NONE)) {
 		if (++intr->unhandled == XNINTR_MAX_UNHANDLED) {
@@ -483,12 +723,11 @@ static void xnintr_irq_handler(unsigned irq, void *cookie)
 		xnstat_exectime_lazy_switch(sched,
 			&intr->stat[xnsched_cpu(sched)].account,
 			start);
+		xnintr_count_xwakeup(sched, intr, &remote);
 		intr->unhandled = 0;
 	}
 
-#ifdef CONFIG_SMP
  unlock_and_exit:
-#endif
 	xnlock_put(&xnirqs[irq].lock);
 
 	if (s & XN_ISR_PROPAGATE)
@@ -506,12 +745,25 @@ static void xnintr_irq_handler(unsigned irq, void *cookie)
 	trace_mark(xn_nucleus, irq_exit, "irq %u", irq);
 }
 
+#ifdef CONFIG_SMP
+static int xnintr_follow_mount(void);
+static void xnintr_follow_umount(void);
+#else /* !CONFIG_SMP */
+static inline int xnintr_follow_mount(void) { return 0; }
+static inline void xnintr_follow_umount(void) { }
+#endif /* !CONFIG_SMP */
+
 int __init xnintr_mount(void)
 {
 	int i;
 	for (i = 0; i < XNARCH_NR_IRQS; ++i)
 		xnlock_init(&xnirqs[i].lock);
-	return 0;
+	return xnintr_follow_mount();
+}
+
+void xnintr_umount(void)
+{
+	xnintr_follow_umount();
 }
 
 /*!
@@ -604,8 +856,20 @@ int __init xnintr_mount(void)
  * - XN_ISR_EDGE is an additional flag need to be set together with XN_ISR_SHARED
  * to enable IRQ-sharing of edge-triggered interrupts.
  *
+ * - XN_ISR_THREADED moves the ISR to a dedicated real-time thread,
+ * created when the object is attached. Upon receipt of an IRQ, the
+ * low-level handler only wakes up this thread, leaving the line
+ * masked until the ISR has run, then re-enables it unless the ISR
+ * returned XN_ISR_NOENABLE. This way, the interrupt processing can
+ * be preempted by more critical real-time threads. The ISR may not
+ * return XN_ISR_PROPAGATE in this mode. The priority of the IRQ
+ * thread is given by or'ing XN_ISR_PRIO(prio) to the flags, which
+ * defaults to XNSCHED_HIGH_PRIO. XN_ISR_THREADED cannot be combined
+ * with XN_ISR_SHARED.
+ *
  * @return 0 is returned on success. Otherwise, -EINVAL is returned if
- * @a irq is not a valid interrupt number.
+ * @a irq is not a valid interrupt number, or if the set of @a flags
+ * is invalid.
  *
  * Environments:
  *
@@ -624,6 +888,10 @@ int xnintr_init(xnintr_t *intr,
 	if (irq >= XNARCH_NR_IRQS)
 		return -EINVAL;
 
+	if ((flags & (XN_ISR_THREADED | XN_ISR_SHARED)) ==
+	    (XN_ISR_THREADED | XN_ISR_SHARED))
+		return -EINVAL;
+
 	intr->irq = irq;
 	intr->isr = isr;
 	intr->iack = iack;
@@ -631,10 +899,19 @@ int xnintr_init(xnintr_t *intr,
 	intr->name = name ? : "<unknown>";
 	intr->flags = flags;
 	intr->unhandled = 0;
+	intr->irqthread = NULL;
+	intr->pending = 0;
 	memset(&intr->stat, 0, sizeof(intr->stat));
 #ifdef CONFIG_XENO_OPT_SHIRQ
 	intr->next = NULL;
+	intr->claim = NULL;
+	intr->shirq_hits = 0;
 #endif
+#ifdef CONFIG_SMP
+	intr->consumer = NULL;
+	intr->ctimer = NULL;
+	intr->cnext = NULL;
+#endif /* CONFIG_SMP */
 
 	return 0;
 }
@@ -695,6 +972,9 @@ EXPORT_SYMBOL_GPL(xnintr_destroy);
  *
  * - -EBUSY is returned if the interrupt object was already attached.
  *
+ * - -ENOMEM is returned if the IRQ thread of a XN_ISR_THREADED object
+ * could not be created.
+ *
  * @note The caller <b>must not</b> hold nklock when invoking this service,
  * this would cause deadlocks.
  *
@@ -713,15 +993,27 @@ EXPORT_SYMBOL_GPL(xnintr_destroy);
 
 int xnintr_attach(xnintr_t *intr, void *cookie)
 {
+	struct xnintr_thread *it = NULL;
 	int ret;
 	spl_t s;
 
 	trace_mark(xn_nucleus, irq_attach, "irq %u name %s",
 		   intr->irq, intr->name);
 
+	if (__testbits(intr->flags, XN_ISR_ATTACHED))
+		return -EBUSY;
+
 	intr->cookie = cookie;
 	memset(&intr->stat, 0, sizeof(intr->stat));
 
+	/* The IRQ thread must exist before the first IRQ shows up. */
+	if (intr->flags & XN_ISR_THREADED) {
+		ret = xnintr_thread_create(intr);
+		if (ret)
+			return ret;
+		it = intr->irqthread;
+	}
+
 #ifdef CONFIG_SMP
 	xnarch_set_irq_affinity(intr->irq, nkaffinity);
 #endif /* CONFIG_SMP */
@@ -739,9 +1031,15 @@ int xnintr_attach(xnintr_t *intr, void *cookie)
 
 	__setbits(intr->flags, XN_ISR_ATTACHED);
 	xnintr_stat_counter_inc();
+	it = NULL;
 out:
 	xnlock_put_irqrestore(&intrlock, s);
 
+	if (it) {
+		intr->irqthread = NULL;
+		xnintr_thread_delete(it);
+	}
+
 	return ret;
 }
 EXPORT_SYMBOL_GPL(xnintr_attach);
@@ -779,6 +1077,7 @@ EXPORT_SYMBOL_GPL(xnintr_attach);
  */
 int xnintr_detach(xnintr_t *intr)
 {
+	struct xnintr_thread *it = NULL;
 	int ret;
 	spl_t s;
 
@@ -798,9 +1097,18 @@ int xnintr_detach(xnintr_t *intr)
 		goto out;
 
 	xnintr_stat_counter_dec();
+	it = intr->irqthread;
+	intr->irqthread = NULL;
  out:
 	xnlock_put_irqrestore(&intrlock, s);
 
+	/* No more IRQs may wake up the thread at this point. */
+	if (it)
+		xnintr_thread_delete(it);
+
+	if (ret == 0)
+		xnintr_bind(intr, NULL, NULL);
+
 	return ret;
 }
 EXPORT_SYMBOL_GPL(xnintr_detach);
@@ -898,6 +1206,208 @@ void xnintr_affinity(xnintr_t *intr, xnarch_cpumask_t cpumask)
 }
 EXPORT_SYMBOL_GPL(xnintr_affinity);
 
+/*!
+ * \fn void xnintr_set_claim (xnintr_t *intr, xnisr_t claim)
+ * \brief Set the claim check of a shared interrupt object.
+ *
+ * On a shared line, the ISR of every interrupt object may be called
+ * until one claims the receipt. A claim check is a cheap test, e.g.
+ * reading a status register, telling whether the device raised the
+ * interrupt; the ISR is skipped when it returns zero. The dispatcher
+ * also tries first the object which claimed most receipts lately.
+ *
+ * @param intr The descriptor address of the interrupt object.
+ *
+ * @param claim The claim check, which receives @a intr and returns
+ * non-zero if the device may have raised the interrupt, or NULL to
+ * always call the ISR. The check must have no side-effect on the
+ * device state.
+ *
+ * @note The claim check is ignored unless the object is attached
+ * with XN_ISR_SHARED and CONFIG_XENO_OPT_SHIRQ is enabled.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ *
+ * Rescheduling: never.
+ */
+
+void xnintr_set_claim(xnintr_t *intr, xnisr_t claim)
+{
+#ifdef CONFIG_XENO_OPT_SHIRQ
+	intr->claim = claim;
+#endif /* CONFIG_XENO_OPT_SHIRQ */
+}
+EXPORT_SYMBOL_GPL(xnintr_set_claim);
+
+#ifdef CONFIG_SMP
+
+/*
+ * Changing the IRQ affinity goes through the irqchip code, which may
+ * grab Linux locks or access the PCI configuration space, so it may
+ * not run from the head domain with nklock held. Migrating consumers
+ * only post the new affinity, which is applied from the root domain
+ * by an APC. If the APC is not available, the IRQ affinity does not
+ * follow the consumer, only the timer does.
+ */
+static int follow_apc = -1;
+
+static unsigned long follow_pending[BITS_TO_LONGS(XNARCH_NR_IRQS)];
+
+static int follow_cpu[XNARCH_NR_IRQS];
+
+static void xnintr_follow_proc(void *cookie)
+{
+	unsigned irq;
+	spl_t s;
+	int cpu;
+
+	for (irq = find_first_bit(follow_pending, XNARCH_NR_IRQS);
+	     irq < XNARCH_NR_IRQS;
+	     irq = find_next_bit(follow_pending, XNARCH_NR_IRQS, irq + 1)) {
+		if (!test_and_clear_bit(irq, follow_pending))
+			continue;
+		xnlock_get_irqsave(&nklock, s);
+		cpu = follow_cpu[irq];
+		xnlock_put_irqrestore(&nklock, s);
+		xnarch_set_irq_affinity(irq, xnarch_cpumask_of_cpu(cpu));
+	}
+}
+
+static int xnintr_follow_mount(void)
+{
+	follow_apc = rthal_apc_alloc("irq_follow", &xnintr_follow_proc, NULL);
+
+	return follow_apc < 0 ? follow_apc : 0;
+}
+
+static void xnintr_follow_umount(void)
+{
+	if (follow_apc >= 0) {
+		rthal_apc_free(follow_apc);
+		follow_apc = -1;
+	}
+}
+
+/* Must be called with nklock locked, interrupts off. */
+static void xnintr_follow(xnintr_t *intr, struct xnsched *sched)
+{
+	follow_cpu[intr->irq] = xnsched_cpu(sched);
+	if (follow_apc >= 0 && !test_and_set_bit(intr->irq, follow_pending))
+		__rthal_apc_schedule(follow_apc);
+	/*
+	 * A timer still queued on another CPU than the current one
+	 * cannot be moved, it stays there until it is re-armed.
+	 */
+	if (intr->ctimer)
+		xntimer_migrate(intr->ctimer, sched);
+}
+
+/* Must be called with nklock locked, interrupts off. */
+static void xnintr_unbind(xnintr_t *intr)
+{
+	xnintr_t **p;
+
+	if (intr->consumer == NULL)
+		return;
+
+	for (p = &intr->consumer->bound_intrs; *p; p = &(*p)->cnext)
+		if (*p == intr) {
+			*p = intr->cnext;
+			break;
+		}
+
+	/* Drop any affinity change not applied yet. */
+	clear_bit(intr->irq, follow_pending);
+	intr->consumer = NULL;
+	intr->ctimer = NULL;
+	intr->cnext = NULL;
+}
+
+/*
+ * Called by the scheduler each time a thread moves to another CPU,
+ * with nklock locked, interrupts off.
+ */
+void xnintr_follow_consumer(struct xnthread *thread, struct xnsched *sched)
+{
+	xnintr_t *intr;
+
+	for (intr = thread->bound_intrs; intr; intr = intr->cnext)
+		xnintr_follow(intr, sched);
+}
+
+/* Called upon deletion of a thread, with nklock locked. */
+void xnintr_release_consumer(struct xnthread *thread)
+{
+	while (thread->bound_intrs)
+		xnintr_unbind(thread->bound_intrs);
+}
+
+#endif /* CONFIG_SMP */
+
+/*!
+ * \fn void xnintr_bind (xnintr_t *intr, struct xnthread *thread, struct xntimer *timer)
+ * \brief Make an interrupt follow its consumer thread.
+ *
+ * Binds the interrupt object @a intr to the thread which consumes
+ * the events it receives. The IRQ affinity is set to the CPU of @a
+ * thread, then changed each time the thread migrates, so that the
+ * wakeups of @a thread by the ISR do not require an inter-processor
+ * interrupt. The affinity changes are applied shortly after, from
+ * the Linux domain. The number of receipts which still woke up a thread on
+ * another CPU is reported by /proc/xenomai/irq.
+ *
+ * @param intr The descriptor address of the interrupt object.
+ *
+ * @param thread The consumer thread, or NULL to remove the
+ * binding. The binding is also removed when the interrupt object is
+ * detached, or when the thread is deleted.
+ *
+ * @param timer The address of an optional timer armed by the ISR,
+ * which is migrated along with the IRQ affinity. NULL if none.
+ *
+ * @note On uniprocessor systems, this service does nothing. The IRQ
+ * affinity set by a previous call to xnintr_affinity() is overridden
+ * by the binding.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+
+void xnintr_bind(xnintr_t *intr, struct xnthread *thread,
+		 struct xntimer *timer)
+{
+#ifdef CONFIG_SMP
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	xnintr_unbind(intr);
+
+	if (thread) {
+		intr->consumer = thread;
+		intr->ctimer = timer;
+		intr->cnext = thread->bound_intrs;
+		thread->bound_intrs = intr;
+		xnintr_follow(intr, thread->sched);
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+#endif /* CONFIG_SMP */
+}
+EXPORT_SYMBOL_GPL(xnintr_bind);
+
 #ifdef CONFIG_XENO_OPT_VFILE
 
 #include <nucleus/vfile.h>
@@ -994,6 +1504,24 @@ int xnintr_query_next(int irq, xnintr_iterator_t *iterator, char *name_buf)
 }
 #endif /* CONFIG_XENO_OPT_STATS */
 
+/*
+ * Receipts which woke up a thread on another CPU, see xnintr_bind().
+ */
+static inline void format_irq_xwakeups(struct xnintr *intr,
+				       struct xnvfile_regular_iterator *it)
+{
+#ifdef CONFIG_SMP
+	unsigned long xwakeups = 0;
+	int cpu;
+
+	for_each_online_cpu(cpu)
+		xwakeups += xnstat_counter_get(&intr->stat[cpu].xwakeups);
+
+	if (xwakeups)
+		xnvfile_printf(it, "(xwake:%lu)", xwakeups);
+#endif /* CONFIG_SMP */
+}
+
 static inline int format_irq_proc(unsigned int irq,
 				  struct xnvfile_regular_iterator *it)
 {
@@ -1033,6 +1561,7 @@ static inline int format_irq_proc(unsigned int irq,
 		do {
 			xnvfile_putc(it, ' ');
 			xnvfile_puts(it, intr->name);
+			format_irq_xwakeups(intr, it);
 			intr = xnintr_shirq_next(intr);
 		} while (intr);
 	}
@@ -0,0 +1,422 @@
+/*!\file nucleus/latprof.c
+ * \brief Power management latency profile.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * \ingroup nucleus
+ */
+
+/*
+ * Deep C-states and frequency transitions add their exit latency
+ * to every real-time wakeup of an idle CPU. Instead of disabling
+ * them once and for all, the nucleus engages a latency profile on a
+ * CPU as soon as a real-time thread is switched in there, i.e. it
+ * holds a PM QoS constraint on the CPU wakeup latency and pins the
+ * frequency of that CPU to its maximum. The profile is released
+ * once the CPU has been running the root thread for
+ * CONFIG_XENO_OPT_LATPROF_HOLD milliseconds in a row, so that idle
+ * real-time CPUs do not burn power.
+ *
+ * The real-time side only flips a per-CPU flag and kicks an APC,
+ * the PM QoS and cpufreq interfaces being applied from a Linux work
+ * queue.
+ */
+
+#include <linux/version.h>
+#include <linux/workqueue.h>
+#include <linux/timer.h>
+#include <linux/delay.h>
+#include <linux/cpufreq.h>
+#include <nucleus/pod.h>
+#include <nucleus/vfile.h>
+#include <nucleus/latprof.h>
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,36)
+#include <linux/pm_qos.h>
+#endif
+
+#define LATPROF_HOLD		msecs_to_jiffies(CONFIG_XENO_OPT_LATPROF_HOLD)
+#define LATPROF_CAL_SAMPLES	32
+#define LATPROF_CAL_DELAY	1000000	/* ns */
+
+static int latprof_apc = -1;
+
+static int latprof_stopping;
+
+static DEFINE_BINARY_SEMAPHORE(latprof_sem);
+
+static xnarch_cpumask_t latprof_applied; /* Profiles applied to Linux. */
+
+static int latprof_qos_held;
+
+static long long latprof_penalty[XNARCH_NR_CPUS]; /* ns, -1 if unknown. */
+
+static DECLARE_WORK_FUNC(latprof_callback);
+
+static DECLARE_WORK_NODATA(latprof_work, &latprof_callback);
+
+static struct timer_list latprof_poll;
+
+/*
+ * PM QoS requests appeared with 2.6.36. On earlier kernels, only the
+ * frequency is pinned.
+ */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,2,0)
+static struct pm_qos_request latprof_qos;
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,36)
+static struct pm_qos_request_list latprof_qos;
+#endif
+
+static void latprof_set_qos(int held)
+{
+	if (held == latprof_qos_held)
+		return;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,36)
+	pm_qos_update_request(&latprof_qos,
+			      held ? CONFIG_XENO_OPT_LATPROF_QOS :
+			      PM_QOS_DEFAULT_VALUE);
+#endif
+
+	latprof_qos_held = held;
+}
+
+#ifdef CONFIG_CPU_FREQ
+
+static xnarch_cpumask_t latprof_pinned;
+
+static int latprof_cpufreq_notifier(struct notifier_block *nb,
+				    unsigned long event, void *data)
+{
+	struct cpufreq_policy *policy = data;
+
+	if (event == CPUFREQ_ADJUST &&
+	    xnarch_cpu_isset(policy->cpu, latprof_pinned))
+		cpufreq_verify_within_limits(policy,
+					     policy->cpuinfo.max_freq,
+					     policy->cpuinfo.max_freq);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block latprof_cpufreq_nb = {
+	.notifier_call = latprof_cpufreq_notifier,
+};
+
+static void latprof_set_pinned(int cpu, int pinned)
+{
+	if (pinned)
+		xnarch_cpu_set(cpu, latprof_pinned);
+	else
+		xnarch_cpu_clear(cpu, latprof_pinned);
+
+	cpufreq_update_policy(cpu);
+}
+
+#else /* !CONFIG_CPU_FREQ */
+
+#define latprof_set_pinned(cpu, pinned)	do { } while (0)
+
+#endif /* !CONFIG_CPU_FREQ */
+
+void __xnlatprof_engage(struct xnsched *sched)
+{
+	sched->lpstate = 1;
+
+	if (latprof_apc >= 0)
+		__rthal_apc_schedule(latprof_apc);
+}
+
+/*
+ * Apply the profiles requested by the real-time side, releasing
+ * those of the CPUs which have been idling for long enough. Must be
+ * called with latprof_sem held.
+ */
+static void latprof_update(void)
+{
+	struct xnsched *sched;
+	int cpu, want, engaged = 0;
+	spl_t s;
+
+	for_each_online_cpu(cpu) {
+		if (!xnarch_cpu_supported(cpu))
+			continue;
+
+		sched = xnpod_sched_slot(cpu);
+
+		xnlock_get_irqsave(&nklock, s);
+		if (sched->lpstate && latprof_stopping)
+			sched->lpstate = 0;
+		else if (sched->lpstate && sched->curr == &sched->rootcb &&
+			 time_after(jiffies, sched->lpidle + LATPROF_HOLD))
+			sched->lpstate = 0;
+		want = sched->lpstate;
+		xnlock_put_irqrestore(&nklock, s);
+
+		if (want != !!xnarch_cpu_isset(cpu, latprof_applied)) {
+			if (want)
+				xnarch_cpu_set(cpu, latprof_applied);
+			else
+				xnarch_cpu_clear(cpu, latprof_applied);
+			latprof_set_pinned(cpu, want);
+		}
+
+		engaged += want;
+	}
+
+	latprof_set_qos(engaged > 0);
+
+	/* Check again later for idle CPUs to release. */
+	if (engaged && !latprof_stopping)
+		mod_timer(&latprof_poll, jiffies + LATPROF_HOLD);
+}
+
+static DECLARE_WORK_FUNC(latprof_callback)
+{
+	down(&latprof_sem);
+	latprof_update();
+	up(&latprof_sem);
+}
+
+static void latprof_schedule(void *cookie)
+{
+	schedule_work(&latprof_work);
+}
+
+static void latprof_poll_handler(unsigned long data)
+{
+	schedule_work(&latprof_work);
+}
+
+static struct xntimer latprof_cal_timer;
+
+static unsigned long long latprof_cal_hit;
+
+static void latprof_cal_handler(struct xntimer *timer)
+{
+	latprof_cal_hit = xnarch_get_cpu_tsc();
+}
+
+/*
+ * Measure the average lateness of a timer shot on a CPU, which is
+ * assumed to be idle meanwhile since we sleep twice as long as the
+ * timer delay.
+ */
+static long long latprof_cal_run(struct xnsched *sched)
+{
+	unsigned long long start, hit;
+	long long sum = 0;
+	int n, samples = 0;
+	spl_t s;
+
+	for (n = 0; n < LATPROF_CAL_SAMPLES; n++) {
+		xnlock_get_irqsave(&nklock, s);
+		latprof_cal_hit = 0;
+		xntimer_set_sched(&latprof_cal_timer, sched);
+		start = xnarch_get_cpu_tsc();
+		xntimer_start(&latprof_cal_timer, LATPROF_CAL_DELAY,
+			      XN_INFINITE, XN_RELATIVE);
+		xnlock_put_irqrestore(&nklock, s);
+
+		msleep(2 * LATPROF_CAL_DELAY / 1000000);
+
+		xnlock_get_irqsave(&nklock, s);
+		xntimer_stop(&latprof_cal_timer);
+		hit = latprof_cal_hit;
+		xnlock_put_irqrestore(&nklock, s);
+
+		if (hit == 0)
+			continue;
+
+		sum += xnarch_tsc_to_ns(hit - start) - LATPROF_CAL_DELAY;
+		samples++;
+	}
+
+	return samples ? xnarch_llimd(sum, 1, samples) : 0;
+}
+
+/*
+ * The exit penalty of a CPU is the difference between the timer
+ * latencies measured without, then with the profile applied. The
+ * PM QoS constraint being global, this only gives meaningful figures
+ * on an otherwise quiet system.
+ */
+static int latprof_calibrate(void)
+{
+	long long relaxed, held;
+	struct xnsched *sched;
+	int cpu;
+
+	if (!xnpod_active_p())
+		return -ENOSYS;
+
+	down(&latprof_sem);
+
+	for_each_online_cpu(cpu) {
+		if (!xnarch_cpu_supported(cpu))
+			continue;
+
+		sched = xnpod_sched_slot(cpu);
+
+		latprof_set_qos(0);
+		latprof_set_pinned(cpu, 0);
+		relaxed = latprof_cal_run(sched);
+
+		latprof_set_qos(1);
+		latprof_set_pinned(cpu, 1);
+		held = latprof_cal_run(sched);
+
+		latprof_set_pinned(cpu,
+				   !!xnarch_cpu_isset(cpu, latprof_applied));
+		latprof_penalty[cpu] = relaxed - held;
+	}
+
+	latprof_update();
+
+	up(&latprof_sem);
+
+	return 0;
+}
+
+#ifdef CONFIG_XENO_OPT_VFILE
+
+static int latprof_vfile_show(struct xnvfile_regular_iterator *it, void *data)
+{
+	struct xnsched *sched;
+	int cpu;
+
+	xnvfile_printf(it, "qos: %s (%d us)\n",
+		       latprof_qos_held ? "held" : "released",
+		       CONFIG_XENO_OPT_LATPROF_QOS);
+	xnvfile_printf(it, "%-4s %-9s %s\n", "CPU", "PROFILE", "PENALTY(ns)");
+
+	for_each_online_cpu(cpu) {
+		if (!xnarch_cpu_supported(cpu))
+			continue;
+
+		sched = xnpod_sched_slot(cpu);
+		if (latprof_penalty[cpu] < 0)
+			xnvfile_printf(it, "%-4d %-9s -\n", cpu,
+				       sched->lpstate ? "engaged" : "released");
+		else
+			xnvfile_printf(it, "%-4d %-9s %lld\n", cpu,
+				       sched->lpstate ? "engaged" : "released",
+				       latprof_penalty[cpu]);
+	}
+
+	return 0;
+}
+
+/* Writing a non-zero value runs the calibration. */
+static ssize_t latprof_vfile_store(struct xnvfile_input *input)
+{
+	ssize_t ret;
+	long val;
+	int err;
+
+	ret = xnvfile_get_integer(input, &val);
+	if (ret < 0)
+		return ret;
+
+	if (val) {
+		err = latprof_calibrate();
+		if (err)
+			return err;
+	}
+
+	return ret;
+}
+
+static struct xnvfile_regular_ops latprof_vfile_ops = {
+	.show = latprof_vfile_show,
+	.store = latprof_vfile_store,
+};
+
+static struct xnvfile_regular latprof_vfile = {
+	.ops = &latprof_vfile_ops,
+};
+
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+void xnlatprof_mount(void)
+{
+	int cpu, apc;
+
+	for (cpu = 0; cpu < XNARCH_NR_CPUS; cpu++)
+		latprof_penalty[cpu] = -1;
+
+	xnarch_cpus_clear(latprof_applied);
+	setup_timer(&latprof_poll, latprof_poll_handler, 0);
+	xntimer_init(&latprof_cal_timer, &nktbase, latprof_cal_handler);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,36)
+	pm_qos_add_request(&latprof_qos, PM_QOS_CPU_DMA_LATENCY,
+			   PM_QOS_DEFAULT_VALUE);
+#endif
+#ifdef CONFIG_CPU_FREQ
+	xnarch_cpus_clear(latprof_pinned);
+	cpufreq_register_notifier(&latprof_cpufreq_nb,
+				  CPUFREQ_POLICY_NOTIFIER);
+#endif /* CONFIG_CPU_FREQ */
+
+	apc = rthal_apc_alloc("latprof", &latprof_schedule, NULL);
+	if (apc < 0) {
+		xnlogwarn("latency profile disabled, no APC available\n");
+		return;
+	}
+
+	latprof_apc = apc;
+
+#ifdef CONFIG_XENO_OPT_VFILE
+	xnvfile_init_regular("latprof", &latprof_vfile, &nkvfroot);
+#endif /* CONFIG_XENO_OPT_VFILE */
+}
+
+void xnlatprof_umount(void)
+{
+	int apc;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	apc = latprof_apc;
+	latprof_apc = -1;
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (apc >= 0) {
+#ifdef CONFIG_XENO_OPT_VFILE
+		xnvfile_destroy_regular(&latprof_vfile);
+#endif /* CONFIG_XENO_OPT_VFILE */
+		rthal_apc_free(apc);
+	}
+
+	/* Release all profiles, and prevent further polling. */
+	down(&latprof_sem);
+	latprof_stopping = 1;
+	latprof_update();
+	up(&latprof_sem);
+
+	del_timer_sync(&latprof_poll);
+	flush_scheduled_work();
+
+#ifdef CONFIG_CPU_FREQ
+	cpufreq_unregister_notifier(&latprof_cpufreq_nb,
+				    CPUFREQ_POLICY_NOTIFIER);
+#endif /* CONFIG_CPU_FREQ */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,36)
+	pm_qos_remove_request(&latprof_qos);
+#endif
+	xntimer_destroy(&latprof_cal_timer);
+}
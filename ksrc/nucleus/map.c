@@ -35,7 +35,9 @@
  * could be available for drawing free keys dynamically.
  *
  * A maximum of 1024 unique keys per map is supported on 32bit
- * machines.
+ * machines. Growable maps, which obtain their index memory on demand
+ * by chunks of one page, do not have this limitation (see
+ * xnmap_create_growable()).
  *
  * (This implementation should not be confused with C++ STL maps,
  * which are dynamically expandable and allow arbitrary key types;
@@ -105,6 +107,7 @@ xnmap_t *xnmap_create(int nkeys, int reserve, int offset)
 	map->ukeys = 0;
 	map->nkeys = nkeys;
 	map->offset = offset;
+	map->chunks = NULL;
 	map->himask = (1 << ((reserve + BITS_PER_LONG - 1) / BITS_PER_LONG)) - 1;
 	map->himap = ~0;
 	memset(map->lomap, ~0, sizeof(map->lomap));
@@ -114,6 +117,194 @@ xnmap_t *xnmap_create(int nkeys, int reserve, int offset)
 }
 EXPORT_SYMBOL_GPL(xnmap_create);
 
+static inline int map_nchunks(xnmap_t *map)
+{
+	return (map->nkeys + XNMAP_CHUNK_KEYS - 1) / XNMAP_CHUNK_KEYS;
+}
+
+/*!
+ * \fn void xnmap_create_growable(int nkeys, int reserve, int offset)
+ * \brief Create a growable map.
+ *
+ * Allocates a new map which obtains the memory indexing its objects
+ * on demand, by chunks of one page, as keys are entered. Only a
+ * directory of one pointer per chunk is allocated upfront, so that a
+ * large key space does not cost memory until it is actually
+ * used. Growable maps are otherwise used exactly like fixed-size
+ * ones, and xnmap_fetch() remains a constant-time operation on them.
+ * Chunks are released when the map is deleted.
+ *
+ * @param nkeys The maximum number of unique keys the map will be able
+ * to hold. Unlike with xnmap_create(), this value is not bounded by
+ * XNMAP_MAX_KEYS, and does not have to be a power of two.
+ *
+ * @param reserve The number of keys which should be kept for
+ * reservation within the index space, as described for
+ * xnmap_create(). This value is not rounded.
+ *
+ * @param offset The lowest key value xnmap_enter() will return to the
+ * caller, as described for xnmap_create().
+ *
+ * @return the address of the new map is returned on success;
+ * otherwise, NULL is returned if @a nkeys or @a reserve is invalid,
+ * or memory is short.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+
+xnmap_t *xnmap_create_growable(int nkeys, int reserve, int offset)
+{
+	int nchunks, nlongs, c;
+	xnmap_t *map;
+	size_t size;
+
+	if (nkeys <= 0 || reserve < 0 || reserve > nkeys)
+		return NULL;
+
+	nchunks = (nkeys + XNMAP_CHUNK_KEYS - 1) / XNMAP_CHUNK_KEYS;
+	nlongs = (nchunks + BITS_PER_LONG - 1) / BITS_PER_LONG;
+	size = offsetof(xnmap_t, lomap) +
+		nchunks * sizeof(map->chunks[0]) +
+		nlongs * sizeof(map->chunkmap[0]);
+	map = (xnmap_t *) xnmalloc(size);
+
+	if (!map)
+		return NULL;
+
+	memset(map, 0, size);
+	map->nkeys = nkeys;
+	map->offset = offset;
+	map->reserve = reserve;
+	map->chunks = (struct xnmap_chunk **)((char *)map +
+					      offsetof(xnmap_t, lomap));
+	map->chunkmap = (unsigned long *)(map->chunks + nchunks);
+
+	/* Flag the chunks holding unreserved keys. */
+	if (reserve < nkeys)
+		for (c = reserve / XNMAP_CHUNK_KEYS; c < nchunks; c++)
+			__setbits(map->chunkmap[c / BITS_PER_LONG],
+				  1UL << (c % BITS_PER_LONG));
+
+	return map;
+}
+EXPORT_SYMBOL_GPL(xnmap_create_growable);
+
+/* Must be called with nklock locked, interrupts off. */
+static struct xnmap_chunk *map_grow(xnmap_t *map, int c)
+{
+	int base = c * XNMAP_CHUNK_KEYS, n;
+	struct xnmap_chunk *chunk;
+
+	chunk = xnmalloc(sizeof(*chunk));
+	if (chunk == NULL)
+		return NULL;
+
+	memset(chunk, 0, sizeof(*chunk));
+
+	for (n = 0; n < XNMAP_CHUNK_KEYS; n++) {
+		if (base + n < map->reserve || base + n >= map->nkeys)
+			continue;
+		__setbits(chunk->freemap[n / BITS_PER_LONG],
+			  1UL << (n % BITS_PER_LONG));
+		chunk->nfree++;
+	}
+
+	/* xnmap_fetch() may run locklessly. */
+	xnarch_write_memory_barrier();
+	map->chunks[c] = chunk;
+
+	return chunk;
+}
+
+static void map_take_key(xnmap_t *map, struct xnmap_chunk *chunk,
+			 int c, int n)
+{
+	unsigned long bit = 1UL << (n % BITS_PER_LONG);
+
+	if ((chunk->freemap[n / BITS_PER_LONG] & bit) == 0)
+		return;		/* Reserved key. */
+
+	__clrbits(chunk->freemap[n / BITS_PER_LONG], bit);
+
+	if (--chunk->nfree == 0)
+		__clrbits(map->chunkmap[c / BITS_PER_LONG],
+			  1UL << (c % BITS_PER_LONG));
+}
+
+static int map_enter_growable(xnmap_t *map, int ofkey, void *objaddr)
+{
+	struct xnmap_chunk *chunk;
+	int c, n, hi;
+
+	if (ofkey < 0 || ofkey >= map->nkeys) {
+		/* Draw the lowest free key from the unreserved space. */
+		for (hi = 0; map->chunkmap[hi] == 0; hi++)
+			if ((hi + 1) * BITS_PER_LONG >= map_nchunks(map))
+				return -ENOSPC;
+
+		c = hi * BITS_PER_LONG + ffnz(map->chunkmap[hi]);
+		chunk = map->chunks[c];
+		if (chunk == NULL) {
+			chunk = map_grow(map, c);
+			if (chunk == NULL)
+				return -ENOMEM;
+		}
+
+		for (hi = 0; chunk->freemap[hi] == 0; hi++)
+			;
+		n = hi * BITS_PER_LONG + ffnz(chunk->freemap[hi]);
+		ofkey = c * XNMAP_CHUNK_KEYS + n;
+	} else {
+		c = ofkey / XNMAP_CHUNK_KEYS;
+		n = ofkey % XNMAP_CHUNK_KEYS;
+		chunk = map->chunks[c];
+		if (chunk == NULL) {
+			chunk = map_grow(map, c);
+			if (chunk == NULL)
+				return -ENOMEM;
+		} else if (chunk->objarray[n] != NULL)
+			return -EEXIST;
+	}
+
+	map_take_key(map, chunk, c, n);
+	chunk->objarray[n] = objaddr;
+	++map->ukeys;
+
+	return ofkey + map->offset;
+}
+
+static int map_remove_growable(xnmap_t *map, int ofkey)
+{
+	int c = ofkey / XNMAP_CHUNK_KEYS, n = ofkey % XNMAP_CHUNK_KEYS;
+	struct xnmap_chunk *chunk = map->chunks[c];
+
+	if (chunk == NULL || chunk->objarray[n] == NULL)
+		return -ESRCH;
+
+	chunk->objarray[n] = NULL;
+	--map->ukeys;
+
+	if (ofkey < map->reserve)
+		return 0;
+
+	__setbits(chunk->freemap[n / BITS_PER_LONG],
+		  1UL << (n % BITS_PER_LONG));
+
+	if (chunk->nfree++ == 0)
+		__setbits(map->chunkmap[c / BITS_PER_LONG],
+			  1UL << (c % BITS_PER_LONG));
+
+	return 0;
+}
+
 /*!
  * \fn void xnmap_delete(xnmap_t *map)
  * \brief Delete a map.
@@ -136,6 +327,14 @@ EXPORT_SYMBOL_GPL(xnmap_create);
 
 void xnmap_delete(xnmap_t *map)
 {
+	int c;
+
+	if (map->chunks) {
+		for (c = 0; c < map_nchunks(map); c++)
+			if (map->chunks[c])
+				xnfree(map->chunks[c]);
+	}
+
 	xnfree(map);
 }
 EXPORT_SYMBOL_GPL(xnmap_delete);
@@ -165,6 +364,9 @@ EXPORT_SYMBOL_GPL(xnmap_delete);
  *
  * - -ENOSPC when no more free key is available.
  *
+ * - -ENOMEM when a growable map could not obtain the memory for
+ * indexing the object.
+ *
  * Environments:
  *
  * This service can be called from:
@@ -184,6 +386,12 @@ int xnmap_enter(xnmap_t *map, int key, void *objaddr)
 
 	xnlock_get_irqsave(&nklock, s);
 
+	if (map->chunks) {
+		key = map_enter_growable(map, ofkey, objaddr);
+		xnlock_put_irqrestore(&nklock, s);
+		return key;
+	}
+
 	if (ofkey >= 0 && ofkey < map->nkeys) {
 		if (map->objarray[ofkey] != NULL) {
 			key = -EEXIST;
@@ -233,7 +441,8 @@ EXPORT_SYMBOL_GPL(xnmap_enter);
  *
  * @return 0 is returned on success. Otherwise:
  *
- * - -ESRCH is returned if @a key is invalid.
+ * - -ESRCH is returned if @a key is invalid, or not indexing any
+ * object in a growable map.
  *
  * Environments:
  *
@@ -249,12 +458,19 @@ EXPORT_SYMBOL_GPL(xnmap_enter);
 
 int xnmap_remove(xnmap_t *map, int key)
 {
-	int ofkey = key - map->offset, hi, lo;
+	int ofkey = key - map->offset, hi, lo, ret;
 	spl_t s;
 
 	if (ofkey < 0 || ofkey >= map->nkeys)
 		return -ESRCH;
 
+	if (map->chunks) {
+		xnlock_get_irqsave(&nklock, s);
+		ret = map_remove_growable(map, ofkey);
+		xnlock_put_irqrestore(&nklock, s);
+		return ret;
+	}
+
 	hi = ofkey / BITS_PER_LONG;
 	lo = ofkey % BITS_PER_LONG;
 	xnlock_get_irqsave(&nklock, s);
@@ -30,6 +30,13 @@
 #include <nucleus/intr.h>
 #include <nucleus/version.h>
 #include <nucleus/sys_ppd.h>
+#include <nucleus/evtrace.h>
+#include <nucleus/statmap.h>
+#include <nucleus/profile.h>
+#include <nucleus/latprof.h>
+#include <nucleus/cachepart.h>
+#include <nucleus/budget.h>
+#include <nucleus/tscsync.h>
 #ifdef CONFIG_XENO_OPT_PIPE
 #include <nucleus/pipe.h>
 #endif /* CONFIG_XENO_OPT_PIPE */
@@ -50,6 +57,7 @@ EXPORT_SYMBOL_GPL(nkvdso);
 void __init xnheap_init_vdso(void)
 {
 	static_nkvdso.features = XNVDSO_FEATURES;
+	xnseqcount_init(&static_nkvdso.clock_data.seqcount);
 	nkvdso = &static_nkvdso;
 }
 #endif /* !CONFIG_XENO_OPT_PERVASIVE */
@@ -115,6 +123,11 @@ u_long sysheap_size_arg = CONFIG_XENO_OPT_SYS_HEAPSZ;
 module_param_named(sysheap_size, sysheap_size_arg, ulong, 0444);
 MODULE_PARM_DESC(sysheap_size, "System heap size (Kb)");
 
+u_long xnmod_htick_nohz_mask = 0;
+module_param_named(htick_nohz_cpus, xnmod_htick_nohz_mask, ulong, 0444);
+MODULE_PARM_DESC(htick_nohz_cpus,
+		 "CPUs not to relay host ticks to while running real-time threads (mask)");
+
 xnqueue_t xnmod_glink_queue;
 EXPORT_SYMBOL_GPL(xnmod_glink_queue);
 
@@ -164,9 +177,16 @@ int __init __xeno_sys_init(void)
 		goto fail;
 
 #ifndef __XENO_SIM__
+	/*
+	 * The global semaphore heap is mapped by every Xenomai
+	 * process; back it with huge pages when it is large enough
+	 * for this to pay off.
+	 */
 	ret = xnheap_init_mapped(&__xnsys_global_ppd.sem_heap,
 				 CONFIG_XENO_OPT_GLOBAL_SEM_HEAPSZ * 1024,
-				 XNARCH_SHARED_HEAP_FLAGS);
+				 XNARCH_SHARED_HEAP_FLAGS
+				 | (CONFIG_XENO_OPT_GLOBAL_SEM_HEAPSZ * 1024 >=
+				    XNHEAP_HUGE_PAGE_SIZE ? XNHEAP_GFP_HUGE : 0));
 	if (ret)
 		goto cleanup_arch;
 
@@ -177,9 +197,30 @@ int __init __xeno_sys_init(void)
 #endif /* !__XENO_SIM__ */
 
 #ifdef __KERNEL__
-	xnpod_mount();
+	ret = xnpod_mount();
+	if (ret)
+		goto cleanup_host;
+
 	xnintr_mount();
 
+#ifdef CONFIG_XENO_OPT_TSC_SYNC
+	xntscsync_mount();
+#endif /* CONFIG_XENO_OPT_TSC_SYNC */
+#ifdef CONFIG_XENO_OPT_LATPROF
+	xnlatprof_mount();
+#endif /* CONFIG_XENO_OPT_LATPROF */
+#ifdef CONFIG_XENO_OPT_CACHE_PARTITION
+	xncachepart_mount();
+#endif /* CONFIG_XENO_OPT_CACHE_PARTITION */
+#ifdef CONFIG_XENO_OPT_SCHED_BUDGET
+	ret = xnbudget_mount();
+	if (ret)
+		goto cleanup_budget;
+#endif /* CONFIG_XENO_OPT_SCHED_BUDGET */
+#ifdef CONFIG_XENO_OPT_POLL_IDLE
+	xnsched_poll_idle_mount();
+#endif /* CONFIG_XENO_OPT_POLL_IDLE */
+
 #ifdef CONFIG_XENO_OPT_PIPE
 	ret = xnpipe_mount();
 	if (ret)
@@ -197,9 +238,33 @@ int __init __xeno_sys_init(void)
 	if (ret)
 		goto cleanup_select;
 
-	ret = xnheap_mount();
+	ret = xnsynch_mount();
 	if (ret)
 		goto cleanup_shadow;
+
+	ret = xnheap_mount();
+	if (ret)
+		goto cleanup_synch;
+
+#ifdef CONFIG_XENO_OPT_EVTRACE
+	ret = xnevtrace_mount();
+	if (ret)
+		goto cleanup_heap;
+#endif /* CONFIG_XENO_OPT_EVTRACE */
+#ifdef CONFIG_XENO_OPT_STATS_MAP
+	ret = xnstatmap_mount();
+	if (ret)
+		goto cleanup_evtrace;
+#endif /* CONFIG_XENO_OPT_STATS_MAP */
+#ifdef CONFIG_XENO_OPT_PROFILE
+	ret = xnprofile_mount();
+	if (ret)
+		goto cleanup_statmap;
+#endif /* CONFIG_XENO_OPT_PROFILE */
+#ifdef CONFIG_XENO_OPT_SEM_HEAP_AUTOGROW
+	xnheap_set_autogrow(&__xnsys_global_ppd.sem_heap,
+			    CONFIG_XENO_OPT_SEM_HEAP_MAXEXT);
+#endif
 #endif /* CONFIG_XENO_OPT_PERVASIVE */
 #endif /* __KERNEL__ */
 
@@ -224,6 +289,37 @@ int __init __xeno_sys_init(void)
 
 #ifdef CONFIG_XENO_OPT_PERVASIVE
 
+#ifdef CONFIG_XENO_OPT_PROFILE
+      cleanup_statmap:
+
+#ifdef CONFIG_XENO_OPT_STATS_MAP
+	xnstatmap_umount();
+#endif /* CONFIG_XENO_OPT_STATS_MAP */
+#endif /* CONFIG_XENO_OPT_PROFILE */
+
+#ifdef CONFIG_XENO_OPT_STATS_MAP
+      cleanup_evtrace:
+#endif /* CONFIG_XENO_OPT_STATS_MAP */
+#if defined(CONFIG_XENO_OPT_STATS_MAP) || defined(CONFIG_XENO_OPT_PROFILE)
+
+#ifdef CONFIG_XENO_OPT_EVTRACE
+	xnevtrace_umount();
+#endif /* CONFIG_XENO_OPT_EVTRACE */
+#endif /* CONFIG_XENO_OPT_STATS_MAP || CONFIG_XENO_OPT_PROFILE */
+
+#ifdef CONFIG_XENO_OPT_EVTRACE
+      cleanup_heap:
+#endif /* CONFIG_XENO_OPT_EVTRACE */
+#if defined(CONFIG_XENO_OPT_EVTRACE) || defined(CONFIG_XENO_OPT_STATS_MAP) || \
+	defined(CONFIG_XENO_OPT_PROFILE)
+
+	xnheap_umount();
+#endif /* CONFIG_XENO_OPT_EVTRACE || CONFIG_XENO_OPT_STATS_MAP || CONFIG_XENO_OPT_PROFILE */
+
+      cleanup_synch:
+
+	xnsynch_umount();
+
       cleanup_shadow:
 
 	xnshadow_cleanup();
@@ -244,8 +340,26 @@ int __init __xeno_sys_init(void)
 
 #endif /* CONFIG_XENO_OPT_PIPE */
 
+#ifdef CONFIG_XENO_OPT_POLL_IDLE
+	xnsched_poll_idle_umount();
+#endif /* CONFIG_XENO_OPT_POLL_IDLE */
+#ifdef CONFIG_XENO_OPT_SCHED_BUDGET
+	xnbudget_umount();
+
+      cleanup_budget:
+#endif /* CONFIG_XENO_OPT_SCHED_BUDGET */
+#ifdef CONFIG_XENO_OPT_CACHE_PARTITION
+	xncachepart_umount();
+#endif /* CONFIG_XENO_OPT_CACHE_PARTITION */
+#ifdef CONFIG_XENO_OPT_LATPROF
+	xnlatprof_umount();
+#endif /* CONFIG_XENO_OPT_LATPROF */
+#ifdef CONFIG_XENO_OPT_TSC_SYNC
+	xntscsync_umount();
+#endif /* CONFIG_XENO_OPT_TSC_SYNC */
 	xnpod_umount();
 
+  cleanup_host:
 	cleanup_hostrt();
 
   cleanup_arch:
@@ -267,11 +381,37 @@ void __exit __xeno_sys_exit(void)
 	xnpod_shutdown(XNPOD_NORMAL_EXIT);
 
 #ifdef CONFIG_XENO_OPT_PERVASIVE
+#ifdef CONFIG_XENO_OPT_PROFILE
+	xnprofile_umount();
+#endif /* CONFIG_XENO_OPT_PROFILE */
+#ifdef CONFIG_XENO_OPT_STATS_MAP
+	xnstatmap_umount();
+#endif /* CONFIG_XENO_OPT_STATS_MAP */
+#ifdef CONFIG_XENO_OPT_EVTRACE
+	xnevtrace_umount();
+#endif /* CONFIG_XENO_OPT_EVTRACE */
 	/* Must take place before xnpod_umount(). */
 	xnshadow_cleanup();
+	xnsynch_umount();
 #endif /* CONFIG_XENO_OPT_PERVASIVE */
 
+#ifdef CONFIG_XENO_OPT_POLL_IDLE
+	xnsched_poll_idle_umount();
+#endif /* CONFIG_XENO_OPT_POLL_IDLE */
+#ifdef CONFIG_XENO_OPT_SCHED_BUDGET
+	xnbudget_umount();
+#endif /* CONFIG_XENO_OPT_SCHED_BUDGET */
+#ifdef CONFIG_XENO_OPT_CACHE_PARTITION
+	xncachepart_umount();
+#endif /* CONFIG_XENO_OPT_CACHE_PARTITION */
+#ifdef CONFIG_XENO_OPT_LATPROF
+	xnlatprof_umount();
+#endif /* CONFIG_XENO_OPT_LATPROF */
+#ifdef CONFIG_XENO_OPT_TSC_SYNC
+	xntscsync_umount();
+#endif /* CONFIG_XENO_OPT_TSC_SYNC */
 	xntbase_umount();
+	xnintr_umount();
 	xnpod_umount();
 	cleanup_hostrt();
 	xnarch_exit();
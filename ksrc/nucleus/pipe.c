@@ -212,6 +212,73 @@ static inline void xnpipe_schedule_request(void) /* hw IRQs off */
 	__rthal_apc_schedule(xnpipe_wakeup_apc);
 }
 
+/*
+ * Wake up the Linux reader for the output sent so far, resetting the
+ * coalescing state. Must be entered with nklock held, interrupts off.
+ */
+static void xnpipe_wakeup_reader(struct xnpipe_state *state)
+{
+	int need_sched = 0;
+
+	state->wbytes = 0;
+	state->wmsgs = 0;
+	xntimer_stop(&state->wtimer);
+
+	if (testbits(state->status, XNPIPE_USER_WREAD)) {
+		/*
+		 * Wake up the regular Linux task waiting for input
+		 * from the Xenomai side.
+		 */
+		__setbits(state->status, XNPIPE_USER_WREAD_READY);
+		need_sched = 1;
+	}
+
+	if (state->asyncq) {	/* Schedule asynch sig. */
+		__setbits(state->status, XNPIPE_USER_SIGIO);
+		need_sched = 1;
+	}
+
+	if (need_sched) {
+		state->nwakeups++;
+		xnpipe_schedule_request();
+	}
+}
+
+/*
+ * Account for @a size bytes just sent to a waiting reader, telling
+ * whether a watermark was crossed. The latency timer is armed on
+ * the first message pending the wakeup otherwise. Must be entered
+ * with nklock held, interrupts off.
+ */
+static inline int xnpipe_wakeup_due(struct xnpipe_state *state, size_t size)
+{
+	struct xnpipe_wmark *wmark = &state->wmark;
+
+	if (wmark->bytes == 0 && wmark->msgs == 0)
+		return 1;
+
+	state->wbytes += size;
+	state->wmsgs++;
+
+	if ((wmark->bytes && state->wbytes >= wmark->bytes) ||
+	    (wmark->msgs && state->wmsgs >= wmark->msgs))
+		return 1;
+
+	if (!xntimer_running_p(&state->wtimer))
+		xntimer_start(&state->wtimer, wmark->latency,
+			      XN_INFINITE, XN_RELATIVE);
+
+	return 0;
+}
+
+static void xnpipe_wmark_handler(xntimer_t *timer) /* nklock held */
+{
+	struct xnpipe_state *state =
+		container_of(timer, struct xnpipe_state, wtimer);
+
+	xnpipe_wakeup_reader(state);
+}
+
 static inline ssize_t xnpipe_flush_bufq(void (*fn)(void *buf, void *xstate),
 					struct xnqueue *q,
 					void *xstate)
@@ -251,6 +318,130 @@ static inline ssize_t xnpipe_flush_bufq(void (*fn)(void *buf, void *xstate),
 	n;								\
 })
 
+/*
+ * Publish as many pending messages as the ring may hold. Must be
+ * entered with nklock held, interrupts off.
+ */
+static void xnpipe_publish_ring(struct xnpipe_state *state)
+{
+	struct xnpipe_ring *ring = state->ring;
+	struct xnpipe_ring_desc *desc;
+	struct xnpipe_mh *mh;
+	struct xnholder *h;
+	unsigned long slot;
+
+	while (state->rhead - state->rreap < state->rnslots) {
+		h = getq(&state->outq);
+		if (h == NULL)
+			break;
+		mh = link2mh(h);
+		slot = state->rhead % state->rnslots;
+		state->rmh[slot] = mh;
+		desc = &ring->desc[slot];
+		desc->offset = xnheap_mapped_offset(state->rpool,
+						    xnpipe_m_data(mh));
+		desc->size = xnpipe_m_size(mh);
+		state->rhead++;
+	}
+
+	/* Descriptors must be visible before the head moves. */
+	xnarch_write_memory_barrier();
+	ring->head = state->rhead;
+}
+
+/*
+ * Collect the messages the reader has consumed, or all published
+ * messages if @a all is set, to @a freeq. The tail index lives in
+ * shared memory, so it is checked before being trusted. Returns the
+ * number of messages collected, or -EINVAL for a bogus tail. Must be
+ * entered with nklock held, interrupts off.
+ */
+static int xnpipe_reap_ring(struct xnpipe_state *state,
+			    struct xnqueue *freeq, int all)
+{
+	unsigned long tail;
+	struct xnpipe_mh *mh;
+	int n = 0;
+
+	tail = all ? state->rhead : state->ring->tail;
+	if (tail - state->rreap > state->rhead - state->rreap)
+		return -EINVAL;
+
+	while (state->rreap != tail) {
+		mh = state->rmh[state->rreap % state->rnslots];
+		state->ionrd -= xnpipe_m_size(mh);
+		if (state->ops.output && !all)
+			state->ops.output(mh, state->xstate);
+		appendq(freeq, xnpipe_m_link(mh));
+		state->rreap++;
+		n++;
+	}
+
+	return n;
+}
+
+/*
+ * Release the consumed ring slots, then refill the ring from the
+ * output queue. Must be entered with nklock held, interrupts off.
+ */
+static int xnpipe_release_ring(struct xnpipe_state *state, spl_t *sp)
+{
+	struct xnqueue freeq;
+	int n;
+
+	initq(&freeq);
+	n = xnpipe_reap_ring(state, &freeq, 0);
+	if (n <= 0)
+		return n;
+
+	xnpipe_publish_ring(state);
+	xnlock_put_irqrestore(&nklock, *sp);
+	xnpipe_flush_bufq(state->ops.free_obuf, &freeq, state->xstate);
+	xnlock_get_irqsave(&nklock, *sp);
+
+	if (testbits(state->status, XNPIPE_USER_WSYNC)) {
+		__setbits(state->status, XNPIPE_USER_WSYNC_READY);
+		xnpipe_schedule_request();
+	}
+
+	return n;
+}
+
+/*
+ * Leave ring mode, dropping the published messages. Must be entered
+ * with nklock held, interrupts off.
+ */
+#define xnpipe_flush_ring(__state, __s)					\
+	do {								\
+		struct xnqueue __freeq;					\
+									\
+		if (testbits((__state)->status, XNPIPE_USER_RING)) {	\
+			initq(&__freeq);				\
+			xnpipe_reap_ring((__state), &__freeq, 1);	\
+			__clrbits((__state)->status, XNPIPE_USER_RING);	\
+			(__state)->ring->head = 0;			\
+			(__state)->ring->tail = 0;			\
+			(__state)->rhead = (__state)->rreap = 0;	\
+			xnlock_put_irqrestore(&nklock, (__s));		\
+			xnpipe_flush_bufq((__state)->ops.free_obuf,	\
+					  &__freeq, (__state)->xstate);	\
+			xnlock_get_irqsave(&nklock, (__s));		\
+		}							\
+	} while(0)
+
+/* The ring lives in the pool, drop it before the owner releases. */
+static void xnpipe_detach_ring(struct xnpipe_state *state) /* nklock free */
+{
+	if (state->ring == NULL)
+		return;
+
+	xnheap_free(state->rpool, state->ring);
+	xnfree(state->rmh);
+	state->ring = NULL;
+	state->rmh = NULL;
+	state->rpool = NULL;
+}
+
 static void *xnpipe_default_alloc_ibuf(size_t size, void *xstate)
 {
 	void *buf;
@@ -320,8 +511,18 @@ int xnpipe_connect(int minor, struct xnpipe_operations *ops, void *xstate)
 
 	__setbits(state->status, XNPIPE_KERN_CONN);
 	xnsynch_init(&state->synchbase, XNSYNCH_FIFO, NULL);
+	xnselect_init(&state->rselect);
 	state->xstate = xstate;
 	state->ionrd = 0;
+	state->ring = NULL;
+	state->rmh = NULL;
+	state->rpool = NULL;
+	memset(&state->wmark, 0, sizeof(state->wmark));
+	state->wbytes = 0;
+	state->wmsgs = 0;
+	state->nsent = 0;
+	state->nwakeups = 0;
+	xntimer_init(&state->wtimer, &nktbase, xnpipe_wmark_handler);
 
 	if (testbits(state->status, XNPIPE_USER_CONN)) {
 		if (testbits(state->status, XNPIPE_USER_WREAD)) {
@@ -367,6 +568,8 @@ int xnpipe_disconnect(int minor)
 	}
 
 	__clrbits(state->status, XNPIPE_KERN_CONN);
+	xntimer_destroy(&state->wtimer);
+	xnselect_destroy(&state->rselect);
 
 	state->ionrd -= xnpipe_flushq(state, outq, free_obuf, s);
 
@@ -403,6 +606,7 @@ cleanup:
 		__setbits(state->status, XNPIPE_KERN_LCLOSE);
 	else {
 		xnlock_put_irqrestore(&nklock, s);
+		xnpipe_detach_ring(state);
 		state->ops.release(state->xstate);
 		xnlock_get_irqsave(&nklock, s);
 		xnpipe_minor_free(minor);
@@ -420,7 +624,6 @@ EXPORT_SYMBOL_GPL(xnpipe_disconnect);
 ssize_t xnpipe_send(int minor, struct xnpipe_mh *mh, size_t size, int flags)
 {
 	struct xnpipe_state *state;
-	int need_sched = 0;
 	spl_t s;
 
 	if (minor < 0 || minor >= XNPIPE_NDEVS)
@@ -453,23 +656,15 @@ ssize_t xnpipe_send(int minor, struct xnpipe_mh *mh, size_t size, int flags)
 		return (ssize_t) size;
 	}
 
-	if (testbits(state->status, XNPIPE_USER_WREAD)) {
-		/*
-		 * Wake up the regular Linux task waiting for input
-		 * from the Xenomai side.
-		 */
-		__setbits(state->status, XNPIPE_USER_WREAD_READY);
-		need_sched = 1;
-	}
+	if (testbits(state->status, XNPIPE_USER_RING))
+		xnpipe_publish_ring(state);
 
-	if (state->asyncq) {	/* Schedule asynch sig. */
-		__setbits(state->status, XNPIPE_USER_SIGIO);
-		need_sched = 1;
+	if (testbits(state->status, XNPIPE_USER_WREAD) || state->asyncq) {
+		state->nsent++;
+		if (xnpipe_wakeup_due(state, xnpipe_m_size(mh)))
+			xnpipe_wakeup_reader(state);
 	}
 
-	if (need_sched)
-		xnpipe_schedule_request();
-
 	xnlock_put_irqrestore(&nklock, s);
 
 	return (ssize_t) size;
@@ -559,6 +754,9 @@ ssize_t xnpipe_recv(int minor, struct xnpipe_mh **pmh, xnticks_t timeout)
 
 	ret = (ssize_t) xnpipe_m_size(*pmh);
 
+	if (emptyq_p(&state->inq))
+		xnselect_signal(&state->rselect, 0);
+
 	if (testbits(state->status, XNPIPE_USER_WSYNC)) {
 		__setbits(state->status, XNPIPE_USER_WSYNC_READY);
 		xnpipe_schedule_request();
@@ -595,8 +793,10 @@ int xnpipe_flush(int minor, int mode)
 	if (mode & XNPIPE_OFLUSH)
 		state->ionrd -= xnpipe_flushq(state, outq, free_obuf, s);
 
-	if (mode & XNPIPE_IFLUSH)
+	if (mode & XNPIPE_IFLUSH) {
 		xnpipe_flushq(state, inq, free_ibuf, s);
+		xnselect_signal(&state->rselect, 0);
+	}
 
 	if (testbits(state->status, XNPIPE_USER_WSYNC) &&
 	    msgcount > countq(&state->outq) + countq(&state->inq)) {
@@ -610,15 +810,159 @@ int xnpipe_flush(int minor, int mode)
 }
 EXPORT_SYMBOL_GPL(xnpipe_flush);
 
+#ifdef CONFIG_XENO_OPT_SELECT
+
+/*
+ * Have a selector watch the input queue of a pipe, i.e. the
+ * messages xnpipe_recv() would return without blocking.
+ */
+int xnpipe_select_bind(int minor, struct xnselector *selector,
+		       unsigned type, unsigned index)
+{
+	struct xnselect_binding *binding;
+	struct xnpipe_state *state;
+	int ret;
+	spl_t s;
+
+	if (minor < 0 || minor >= XNPIPE_NDEVS)
+		return -ENODEV;
+
+	if (type != XNSELECT_READ)
+		return -EBADF;
+
+	binding = xnmalloc(sizeof(*binding));
+	if (binding == NULL)
+		return -ENOMEM;
+
+	state = &xnpipe_states[minor];
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!testbits(state->status, XNPIPE_KERN_CONN)) {
+		ret = -EBADF;
+		goto unlock_and_error;
+	}
+
+	ret = xnselect_bind(&state->rselect, binding, selector, type, index,
+			    !emptyq_p(&state->inq));
+	if (ret)
+		goto unlock_and_error;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+
+      unlock_and_error:
+
+	xnlock_put_irqrestore(&nklock, s);
+	xnfree(binding);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(xnpipe_select_bind);
+
+#endif /* CONFIG_XENO_OPT_SELECT */
+
+int xnpipe_attach_ring(int minor, struct xnheap *pool, unsigned nslots)
+{
+	struct xnpipe_state *state;
+	struct xnpipe_ring *ring;
+	struct xnpipe_mh **rmh;
+	int ret = 0;
+	spl_t s;
+
+	if (minor < 0 || minor >= XNPIPE_NDEVS)
+		return -ENODEV;
+
+	if (nslots == 0 || !xnheap_mapped_p(pool))
+		return -EINVAL;
+
+	state = &xnpipe_states[minor];
+
+	ring = xnheap_alloc(pool, sizeof(*ring) + nslots * sizeof(ring->desc[0]));
+	if (ring == NULL)
+		return -ENOMEM;
+
+	rmh = xnmalloc(nslots * sizeof(*rmh));
+	if (rmh == NULL) {
+		xnheap_free(pool, ring);
+		return -ENOMEM;
+	}
+
+	ring->nslots = nslots;
+	ring->head = 0;
+	ring->tail = 0;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!testbits(state->status, XNPIPE_KERN_CONN))
+		ret = -EBADF;
+	else if (state->ring)
+		ret = -EBUSY;
+	else {
+		state->rpool = pool;
+		state->ring = ring;
+		state->rmh = rmh;
+		state->rnslots = nslots;
+		state->rhead = 0;
+		state->rreap = 0;
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (ret) {
+		xnfree(rmh);
+		xnheap_free(pool, ring);
+	}
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(xnpipe_attach_ring);
+
+int xnpipe_set_wmark(int minor, const struct xnpipe_wmark *wmark)
+{
+	struct xnpipe_state *state;
+	spl_t s;
+
+	if (minor < 0 || minor >= XNPIPE_NDEVS)
+		return -ENODEV;
+
+	/* A watermark without latency bound could starve the reader. */
+	if ((wmark->bytes || wmark->msgs) && wmark->latency == 0)
+		return -EINVAL;
+
+	state = &xnpipe_states[minor];
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!testbits(state->status, XNPIPE_KERN_CONN)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return -EBADF;
+	}
+
+	state->wmark = *wmark;
+	/* Don't keep the reader waiting on stale thresholds. */
+	if (state->wmsgs > 0)
+		xnpipe_wakeup_reader(state);
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(xnpipe_set_wmark);
+
 /* Must be entered with nklock held, interrupts off. */
 #define xnpipe_cleanup_user_conn(__state, __s)				\
 	do {								\
+		xnpipe_flush_ring((__state), (__s));			\
 		xnpipe_flushq((__state), outq, free_obuf, (__s));	\
 		xnpipe_flushq((__state), inq, free_ibuf, (__s));	\
+		xnselect_signal(&(__state)->rselect, 0);		\
 		__clrbits((__state)->status, XNPIPE_USER_CONN);		\
 		if (testbits((__state)->status, XNPIPE_KERN_LCLOSE)) {	\
 			clrbits((__state)->status, XNPIPE_KERN_LCLOSE);	\
 			xnlock_put_irqrestore(&nklock, (__s));		\
+			xnpipe_detach_ring(__state);			\
 			(__state)->ops.release((__state)->xstate);	\
 			xnlock_get_irqsave(&nklock, (__s));		\
 			xnpipe_minor_free(xnminor_from_state(__state));	\
@@ -747,6 +1091,12 @@ static ssize_t xnpipe_read(struct file *file,
 		xnlock_put_irqrestore(&nklock, s);
 		return -EPIPE;
 	}
+
+	/* Messages are consumed in place in ring mode. */
+	if (testbits(state->status, XNPIPE_USER_RING)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return -EINVAL;
+	}
 	/*
 	 * Queue probe and proc enqueuing must be seen atomically,
 	 * including from the Xenomai side.
@@ -840,7 +1190,7 @@ static ssize_t xnpipe_write(struct file *file,
 {
 	struct xnpipe_state *state = file->private_data;
 	struct xnpipe_mh *mh;
-	int pollnum, ret;
+	int pollnum, ret, resched;
 	spl_t s;
 
 	if (count == 0)
@@ -892,8 +1242,9 @@ static ssize_t xnpipe_write(struct file *file,
 
 	appendq(&state->inq, &mh->link);
 
-	/* Wake up a Xenomai sleeper if any. */
-	if (xnsynch_wakeup_one_sleeper(&state->synchbase))
+	/* Wake up a Xenomai sleeper or selector if any. */
+	resched = xnselect_signal(&state->rselect, 1);
+	if (xnsynch_wakeup_one_sleeper(&state->synchbase) || resched)
 		xnpod_schedule();
 
 	if (state->ops.input) {
@@ -918,6 +1269,8 @@ static ssize_t xnpipe_write(struct file *file,
 static DECLARE_IOCTL_HANDLER(xnpipe_ioctl, file, cmd, arg)
 {
 	struct xnpipe_state *state = file->private_data;
+	struct xnpipe_ring_info info;
+	struct xnpipe_wmark wmark;
 	int ret = 0;
 	ssize_t n;
 	spl_t s;
@@ -953,6 +1306,7 @@ static DECLARE_IOCTL_HANDLER(xnpipe_ioctl, file, cmd, arg)
 		}
 
 		n = xnpipe_flushq(state, inq, free_ibuf, s);
+		xnselect_signal(&state->rselect, 0);
 
 	kick_wsync:
 
@@ -965,6 +1319,62 @@ static DECLARE_IOCTL_HANDLER(xnpipe_ioctl, file, cmd, arg)
 		ret = n;
 		break;
 
+	case XNPIPEIOC_MAP_RING:
+
+		xnlock_get_irqsave(&nklock, s);
+
+		if (!testbits(state->status, XNPIPE_KERN_CONN)) {
+			xnlock_put_irqrestore(&nklock, s);
+			return -EPIPE;
+		}
+
+		if (state->ring == NULL) {
+			xnlock_put_irqrestore(&nklock, s);
+			return -ENXIO;
+		}
+
+		info.handle = (unsigned long)state->rpool;
+		info.size = xnheap_extentsize(state->rpool);
+		info.area = xnheap_base_memory(state->rpool);
+		info.ringoff = xnheap_mapped_offset(state->rpool, state->ring);
+
+		if (!testbits(state->status, XNPIPE_USER_RING)) {
+			__setbits(state->status, XNPIPE_USER_RING);
+			xnpipe_publish_ring(state);
+		}
+
+		xnlock_put_irqrestore(&nklock, s);
+
+		if (copy_to_user((void __user *)arg, &info, sizeof(info)))
+			return -EFAULT;
+
+		break;
+
+	case XNPIPEIOC_RELEASE:
+
+		xnlock_get_irqsave(&nklock, s);
+
+		if (!testbits(state->status, XNPIPE_KERN_CONN))
+			ret = -EPIPE;
+		else if (!testbits(state->status, XNPIPE_USER_RING))
+			ret = -ENXIO;
+		else
+			ret = xnpipe_release_ring(state, &s);
+
+		xnlock_put_irqrestore(&nklock, s);
+		break;
+
+	case XNPIPEIOC_SET_WMARK:
+
+		if (copy_from_user(&wmark, (void __user *)arg, sizeof(wmark)))
+			return -EFAULT;
+
+		ret = xnpipe_set_wmark(xnminor_from_state(state), &wmark);
+		if (ret == -EBADF)
+			ret = -EPIPE;
+
+		break;
+
 	case XNPIPEIOC_SETSIG:
 
 		if (arg < 1 || arg >= _NSIG)
@@ -1034,7 +1444,18 @@ static unsigned xnpipe_poll(struct file *file, poll_table *pt)
 	else
 		r_mask |= POLLHUP;
 
-	if (!emptyq_p(&state->outq))
+	if (testbits(state->status, XNPIPE_USER_RING)) {
+		/*
+		 * Reclaim whatever the reader consumed since the last
+		 * call, so that polling for more data also releases
+		 * the previous batch.
+		 */
+		xnpipe_release_ring(state, &s);
+		if (state->rhead != state->ring->tail)
+			r_mask |= (POLLIN | POLLRDNORM);
+		else
+			xnpipe_enqueue_wait(state, XNPIPE_USER_WREAD);
+	} else if (!emptyq_p(&state->outq))
 		r_mask |= (POLLIN | POLLRDNORM);
 	else
 		/*
@@ -1056,6 +1477,56 @@ static unsigned xnpipe_poll(struct file *file, poll_table *pt)
 	return r_mask | w_mask;
 }
 
+#ifdef CONFIG_XENO_OPT_VFILE
+
+static int pipe_vfile_show(struct xnvfile_regular_iterator *it, void *data)
+{
+	unsigned long bytes, msgs, latency, nsent, nwakeups;
+	struct xnpipe_state *state;
+	int minor;
+	spl_t s;
+
+	xnvfile_printf(it, "%-5s  %-10s  %-8s  %-10s  %-10s  %-10s  %s\n",
+		       "MINOR", "WMARK-B", "WMARK-M", "LATENCY",
+		       "SENT", "WAKEUPS", "RATIO");
+
+	for (minor = 0; minor < XNPIPE_NDEVS; minor++) {
+		state = &xnpipe_states[minor];
+		xnlock_get_irqsave(&nklock, s);
+		if (!testbits(state->status, XNPIPE_KERN_CONN)) {
+			xnlock_put_irqrestore(&nklock, s);
+			continue;
+		}
+		bytes = state->wmark.bytes;
+		msgs = state->wmark.msgs;
+		latency = state->wmark.latency;
+		nsent = state->nsent;
+		nwakeups = state->nwakeups;
+		xnlock_put_irqrestore(&nklock, s);
+
+		xnvfile_printf(it, "%5d  %-10lu  %-8lu  %-10lu  %-10lu  %-10lu",
+			       minor, bytes, msgs, latency, nsent, nwakeups);
+		/* Messages conveyed per wakeup, i.e. coalescing ratio. */
+		if (nwakeups > 0)
+			xnvfile_printf(it, "  %lu.%lu\n", nsent / nwakeups,
+				       (nsent % nwakeups) * 10 / nwakeups);
+		else
+			xnvfile_printf(it, "  -\n");
+	}
+
+	return 0;
+}
+
+static struct xnvfile_regular_ops pipe_vfile_ops = {
+	.show = pipe_vfile_show,
+};
+
+static struct xnvfile_regular pipe_vfile = {
+	.ops = &pipe_vfile_ops,
+};
+
+#endif /* CONFIG_XENO_OPT_VFILE */
+
 static struct file_operations xnpipe_fops = {
 	.owner = THIS_MODULE,
 	.read = xnpipe_read,
@@ -1116,6 +1587,10 @@ int xnpipe_mount(void)
 	xnpipe_wakeup_apc =
 	    rthal_apc_alloc("pipe_wakeup", &xnpipe_wakeup_proc, NULL);
 
+#ifdef CONFIG_XENO_OPT_VFILE
+	xnvfile_init_regular("pipes", &pipe_vfile, &nkvfroot);
+#endif /* CONFIG_XENO_OPT_VFILE */
+
 	return 0;
 }
 
@@ -1123,6 +1598,9 @@ void xnpipe_umount(void)
 {
 	int i;
 
+#ifdef CONFIG_XENO_OPT_VFILE
+	xnvfile_destroy_regular(&pipe_vfile);
+#endif /* CONFIG_XENO_OPT_VFILE */
 	rthal_apc_free(xnpipe_wakeup_apc);
 	unregister_chrdev(XNPIPE_DEV_MAJOR, "rtpipe");
 
@@ -44,6 +44,12 @@
 #include <nucleus/stat.h>
 #include <nucleus/assert.h>
 #include <nucleus/select.h>
+#include <nucleus/vdso.h>
+#include <nucleus/evtrace.h>
+#include <nucleus/statmap.h>
+#include <nucleus/latprof.h>
+#include <nucleus/cachepart.h>
+#include <nucleus/budget.h>
 #include <asm/xenomai/bits/pod.h>
 
 /*
@@ -64,12 +70,49 @@ EXPORT_SYMBOL_GPL(nklatency);
 /* Already accounted for in nklatency, kept separately for user information. */
 u_long nktimerlat = 0;
 
+#ifndef CONFIG_XENO_OPT_TIMING_COALESCE
+#define CONFIG_XENO_OPT_TIMING_COALESCE 0
+#endif
+
+/* Timer coalescing window (raw ticks), caps the slack of timers. */
+u_long nkcoalesce = 0;
+EXPORT_SYMBOL_GPL(nkcoalesce);
+
 xnarch_cpumask_t nkaffinity = XNPOD_ALL_CPUS;
 
 xnticks_t nkvtick = CONFIG_XENO_OPT_TIMING_VIRTICK * 1000;
 
+/*
+ * Periodic threads running with XNPREREL set have their timer fire
+ * ahead of each nominal release point by this amount (in
+ * nanoseconds), then spin until the release point is reached. Zero
+ * means to use the scheduling latency (i.e. the timer gravity).
+ */
+static unsigned long prerelease_arg;
+module_param_named(prerelease_ns, prerelease_arg, ulong, 0644);
+MODULE_PARM_DESC(prerelease_ns,
+		 "Timer advance of pre-released periodic threads (ns)");
+
 #ifdef CONFIG_XENO_HW_FPU
 
+/*
+ * FPU contexts are switched lazily by default: the context of the
+ * outgoing thread is kept in the FPU until another FPU thread is
+ * switched in, and shadows get their FPU initialized upon their
+ * first FPU fault. Eager threads (XNFPUEAGER, or every thread when
+ * the fpu_eager parameter is set) save their context when switched
+ * out, and have it initialized before they resume if they never used
+ * the FPU so far.
+ */
+static int fpu_eager_arg;
+module_param_named(fpu_eager, fpu_eager_arg, int, 0644);
+MODULE_PARM_DESC(fpu_eager, "Switch FPU contexts eagerly for all threads");
+
+static inline int __xnpod_fpu_eager_p(struct xnthread *thread)
+{
+	return fpu_eager_arg || xnthread_test_state(thread, XNFPUEAGER);
+}
+
 static inline void __xnpod_init_fpu(struct xnsched *sched,
 				    struct xnthread *thread)
 {
@@ -82,10 +125,13 @@ static inline void __xnpod_init_fpu(struct xnsched *sched,
 	if (xnthread_test_state(thread, XNFPU)) {
 		if (sched->fpuholder != NULL &&
 		    xnarch_fpu_ptr(xnthread_archtcb(sched->fpuholder)) !=
-		    xnarch_fpu_ptr(xnthread_archtcb(thread)))
+		    xnarch_fpu_ptr(xnthread_archtcb(thread))) {
 			xnarch_save_fpu(xnthread_archtcb(sched->fpuholder));
+			sched->fpustat.saves++;
+		}
 
 		xnarch_init_fpu(xnthread_archtcb(thread));
+		sched->fpustat.inits++;
 
 		sched->fpuholder = thread;
 	}
@@ -109,9 +155,53 @@ static inline void __xnpod_release_fpu(struct xnthread *thread)
 		 */
 		xnarch_save_fpu(xnthread_archtcb(thread));
 		thread->sched->fpuholder = NULL;
+		thread->sched->fpustat.saves++;
 	}
 }
 
+static inline void __xnpod_eager_save_fpu(struct xnsched *sched,
+					  struct xnthread *prev)
+{
+	/* The root thread context is left to the host kernel. */
+	if (prev != sched->fpuholder ||
+	    xnthread_test_state(prev, XNROOT) ||
+	    !__xnpod_fpu_eager_p(prev))
+		return;
+
+	xnarch_save_fpu(xnthread_archtcb(prev));
+	sched->fpuholder = NULL;
+	sched->fpustat.saves++;
+}
+
+#ifdef CONFIG_XENO_OPT_TIMING_TICKLESS
+
+/*
+ * Idle periodic time bases must tick for round-robin threads, so
+ * keep their count in sync with the XNRRB bit, whichever path flips
+ * it. Must be called with nklock locked, interrupts off.
+ */
+static inline void __xnpod_track_rr(struct xnthread *thread, int on)
+{
+	xntbase_t *base = xnthread_time_base(thread);
+
+	if (!xntbase_periodic_p(base) || thread->rrtracked == on)
+		return;
+
+	thread->rrtracked = on;
+	xntslave_set_rr(base2slave(base), on);
+}
+
+#else /* !CONFIG_XENO_OPT_TIMING_TICKLESS */
+
+static inline void __xnpod_track_rr(struct xnthread *thread, int on)
+{
+}
+
+#endif /* !CONFIG_XENO_OPT_TIMING_TICKLESS */
+
+#define __xnpod_sync_rr(thread)	\
+	__xnpod_track_rr(thread, xnthread_test_state(thread, XNRRB) != 0)
+
 static inline void __xnpod_switch_fpu(struct xnsched *sched)
 {
 	xnthread_t *curr = sched->curr;
@@ -119,15 +209,28 @@ static inline void __xnpod_switch_fpu(struct xnsched *sched)
 	if (!xnthread_test_state(curr, XNFPU))
 		return;
 
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+	if (xnthread_test_state(curr, XNSHADOW) &&
+	    __xnpod_fpu_eager_p(curr) &&
+	    !xnarch_fpu_init_p(xnthread_archtcb(curr)->user_task)) {
+		/* Do not wait for the first-use fault. */
+		__xnpod_init_fpu(sched, curr);
+		return;
+	}
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+
 	if (sched->fpuholder != curr) {
 		if (sched->fpuholder == NULL ||
 		    xnarch_fpu_ptr(xnthread_archtcb(sched->fpuholder)) !=
 		    xnarch_fpu_ptr(xnthread_archtcb(curr))) {
-			if (sched->fpuholder)
+			if (sched->fpuholder) {
 				xnarch_save_fpu(xnthread_archtcb
 						(sched->fpuholder));
+				sched->fpustat.saves++;
+			}
 
 			xnarch_restore_fpu(xnthread_archtcb(curr));
+			sched->fpustat.restores++;
 		} else
 			xnarch_enable_fpu(xnthread_archtcb(curr));
 
@@ -157,6 +260,7 @@ static inline int __xnpod_fault_init_fpu(struct xnthread *thread)
 		 * use of the FPU is an error.
 		 */
 		xnarch_init_fpu(tcb);
+		thread->sched->fpustat.faults++;
 		return 1;
 	}
 #endif /* CONFIG_XENO_OPT_PERVASIVE */
@@ -180,6 +284,11 @@ static inline void __xnpod_release_fpu(struct xnthread *thread)
 {
 }
 
+static inline void __xnpod_eager_save_fpu(struct xnsched *sched,
+					  struct xnthread *prev)
+{
+}
+
 static inline void __xnpod_switch_fpu(struct xnsched *sched)
 {
 }
@@ -270,6 +379,10 @@ void xnpod_schedule_handler(void) /* Called with hw interrupts off. */
 	xnsched_t *sched;
 
 	trace_mark(xn_nucleus, sched_remote, MARK_NOARGS);
+#ifdef CONFIG_SMP
+	/* Senders may notify us again from now on. */
+	xnarch_cpu_clear(xnarch_current_cpu(), nkpod->ipipend);
+#endif /* CONFIG_SMP */
 	xnarch_memory_barrier();
 #if defined(CONFIG_SMP) && defined(CONFIG_XENO_OPT_PRIOCPL)
 	sched = xnpod_current_sched();
@@ -278,6 +391,9 @@ void xnpod_schedule_handler(void) /* Called with hw interrupts off. */
 #else
 	(void)sched;
 #endif /* CONFIG_SMP && CONFIG_XENO_OPT_PRIOCPL */
+#ifdef CONFIG_XENO_OPT_DIRECT_HARDEN
+	xnshadow_finish_harden(xnpod_current_sched());
+#endif /* CONFIG_XENO_OPT_DIRECT_HARDEN */
 	xnpod_schedule();
 }
 
@@ -287,11 +403,6 @@ void xnpod_schedule_deferred(void)
 		xnpod_schedule();
 }
 
-static void xnpod_timeslice_handler(struct xntimer *timer)
-{
-	xnsched_tick(timer->sched->curr, &nktbase);
-}
-
 static void xnpod_flush_heap(xnheap_t *heap,
 			     void *extaddr, u_long extsize, void *cookie)
 {
@@ -306,6 +417,47 @@ static void xnpod_flush_stackpool(xnheap_t *heap,
 }
 #endif
 
+#ifdef CONFIG_XENO_OPT_NUMA
+
+/*
+ * Every scheduler slot, including its timer queue, is allocated on
+ * the memory node of the CPU it belongs to, so that the scheduling
+ * and timing code running on that CPU does not go through remote
+ * accesses. Slots are set up once and for all when the nucleus is
+ * loaded, since some of them are used before the pod is initialized
+ * (e.g. by the gatekeepers).
+ */
+int xnpod_alloc_scheds(void)
+{
+	xnsched_t *sched;
+	int cpu, node;
+
+	for (cpu = 0; cpu < XNARCH_NR_CPUS; cpu++) {
+		node = cpu_possible(cpu) ? cpu_to_node(cpu) : -1;
+		sched = kmalloc_node(sizeof(*sched), GFP_KERNEL, node);
+		if (sched == NULL) {
+			xnpod_free_scheds();
+			return -ENOMEM;
+		}
+		memset(sched, 0, sizeof(*sched));
+		nkpod_struct.sched[cpu] = sched;
+	}
+
+	return 0;
+}
+
+void xnpod_free_scheds(void)
+{
+	int cpu;
+
+	for (cpu = 0; cpu < XNARCH_NR_CPUS; cpu++) {
+		kfree(nkpod_struct.sched[cpu]);
+		nkpod_struct.sched[cpu] = NULL;
+	}
+}
+
+#endif /* CONFIG_XENO_OPT_NUMA */
+
 /*!
  * \fn int xnpod_init(void)
  * \brief Initialize the core pod.
@@ -357,12 +509,16 @@ int xnpod_init(void)
 
 	pod->status = 0;
 	pod->refcnt = 1;
+#ifdef CONFIG_SMP
+	xnarch_cpus_clear(pod->ipipend);
+#endif /* CONFIG_SMP */
+	nkcoalesce = xnarch_ns_to_tsc(CONFIG_XENO_OPT_TIMING_COALESCE);
 	initq(&pod->threadq);
 	initq(&pod->tstartq);
 	initq(&pod->tswitchq);
 	initq(&pod->tdeleteq);
-	xntimer_init(&pod->tslicer, &nktbase, xnpod_timeslice_handler);
-	pod->tsliced = 0;
+	pod->hooks = 0;
+	pod->hookgen = 0;
 	xnarch_atomic_set(&pod->timerlck, 0);
 #ifdef __XENO_SIM__
 	pod->schedhook = NULL;
@@ -370,10 +526,12 @@ int xnpod_init(void)
 
 	xnlock_put_irqrestore(&nklock, s);
 
+	xnlock_stat_attach(&nklock, "nklock");
+
 	heapaddr = xnarch_alloc_host_mem(xnmod_sysheap_size);
 	if (heapaddr == NULL ||
 	    xnheap_init(&kheap, heapaddr, xnmod_sysheap_size,
-			XNHEAP_PAGE_SIZE) != 0) {
+			XNHEAP_PAGE_SIZE, 0) != 0) {
 		return -ENOMEM;
 	}
 	xnheap_set_label(&kheap, "main heap");
@@ -394,15 +552,16 @@ int xnpod_init(void)
 	heapaddr = xnarch_alloc_stack_mem(CONFIG_XENO_OPT_SYS_STACKPOOLSZ * 1024);
 	if (heapaddr == NULL ||
 	    xnheap_init(&kstacks, heapaddr, CONFIG_XENO_OPT_SYS_STACKPOOLSZ * 1024,
-			XNHEAP_PAGE_SIZE) != 0) {
+			XNHEAP_PAGE_SIZE, 0) != 0) {
 		xnheap_destroy(&kheap, &xnpod_flush_heap, NULL);
 		return -ENOMEM;
 	}
 	xnheap_set_label(&kstacks, "stack pool");
+	xnheap_init_stacks();
 #endif /* CONFIG_XENO_OPT_SYS_STACKPOOLSZ > 0 */
 
 	for (cpu = 0; cpu < nr_cpus; ++cpu) {
-		sched = &pod->sched[cpu];
+		sched = xnpod_sched_slot(cpu);
 		xnsched_init(sched, cpu);
 		if (xnarch_cpu_supported(cpu))
 			appendq(&pod->threadq, &sched->rootcb.glink);
@@ -422,6 +581,35 @@ int xnpod_init(void)
 		return ret;
 	}
 
+	/*
+	 * Thread wakeups are anticipated by the scheduling latency
+	 * until tuned; timer handlers running in IRQ context get a
+	 * calibrated gravity.
+	 */
+	nkkgravity = nklatency;
+	nkigravity = nklatency;
+#ifndef __XENO_SIM__
+	xntimer_calibrate_gravity();
+#endif /* !__XENO_SIM__ */
+
+	ret = xnsched_balance_init();
+	if (ret) {
+		xnpod_shutdown(XNPOD_FATAL_EXIT);
+		return ret;
+	}
+
+	ret = xnsched_reaper_init();
+	if (ret) {
+		xnpod_shutdown(XNPOD_FATAL_EXIT);
+		return ret;
+	}
+
+	ret = xntimerq_grow_init();
+	if (ret) {
+		xnpod_shutdown(XNPOD_FATAL_EXIT);
+		return ret;
+	}
+
 	return 0;
 }
 EXPORT_SYMBOL_GPL(xnpod_init);
@@ -465,8 +653,6 @@ void xnpod_shutdown(int xtype)
 		return;	/* No-op */
 	}
 
-	xntimer_destroy(&nkpod->tslicer);
-
 	/*
 	 * FIXME: We must release the lock before disabling the time
 	 * source, so we accept a potential race due to another skin
@@ -475,6 +661,8 @@ void xnpod_shutdown(int xtype)
 	 */
 	xnlock_put_irqrestore(&nklock, s);
 
+	xnsched_balance_cleanup();
+	xntimerq_grow_cleanup();
 	xnpod_disable_timesource();
 	xnarch_notify_shutdown();
 
@@ -501,21 +689,79 @@ void xnpod_shutdown(int xtype)
 
 	xnlock_put_irqrestore(&nklock, s);
 
+	xnsched_reaper_cleanup();
 	xnregistry_cleanup();
 	xnarch_notify_halt();
 	xnheap_destroy(&kheap, &xnpod_flush_heap, NULL);
 #if CONFIG_XENO_OPT_SYS_STACKPOOLSZ > 0
+	xnheap_flush_stacks();
 	xnheap_destroy(&kstacks, &xnpod_flush_stackpool, NULL);
 #endif
+	xnlock_stat_detach(&nklock);
 }
 EXPORT_SYMBOL_GPL(xnpod_shutdown);
 
-void xnpod_fire_callouts(xnqueue_t *hookq, xnthread_t *thread)
+static const char *const xnpod_hook_names[] = {
+	[XNHOOK_THREAD_START] = "START",
+	[XNHOOK_THREAD_SWITCH] = "SWITCH",
+	[XNHOOK_THREAD_DELETE] = "DELETE",
+};
+
+static inline xnqueue_t *xnpod_hook_queue(int type)
+{
+	switch (type) {
+	case XNHOOK_THREAD_START:
+		return &nkpod->tstartq;
+	case XNHOOK_THREAD_SWITCH:
+		return &nkpod->tswitchq;
+	case XNHOOK_THREAD_DELETE:
+		return &nkpod->tdeleteq;
+	}
+
+	return NULL;
+}
+
+#ifdef CONFIG_XENO_OPT_STATS
+
+static inline void xnpod_call_hook(xnhook_t *hook, xnthread_t *thread)
+{
+	unsigned long gen = nkpod->hookgen;
+	xnticks_t start, t;
+
+	start = xnarch_get_cpu_tsc();
+	hook->routine(thread);
+	t = xnarch_get_cpu_tsc() - start;
+
+	/* The hook may have removed itself, and been freed. */
+	if (nkpod->hookgen != gen)
+		return;
+
+	hook->calls++;
+	hook->exectime += t;
+	if (t > hook->maxtime)
+		hook->maxtime = t;
+}
+
+#else /* !CONFIG_XENO_OPT_STATS */
+
+static inline void xnpod_call_hook(xnhook_t *hook, xnthread_t *thread)
+{
+	hook->routine(thread);
+}
+
+#endif /* !CONFIG_XENO_OPT_STATS */
+
+void xnpod_fire_callouts(int type, xnthread_t *thread)
 {
 	/* Must be called with nklock locked, interrupts off. */
 	xnsched_t *sched = xnpod_current_sched();
+	xnqueue_t *hookq = xnpod_hook_queue(type);
 	xnholder_t *holder, *nholder;
 
+	trace_mark(xn_nucleus, thread_callout,
+		   "thread %p thread_name %s hook %s",
+		   thread, xnthread_name(thread), xnpod_hook_names[type]);
+
 	__setbits(sched->status, XNKCOUT);
 
 	/* The callee is allowed to alter the hook queue when running */
@@ -525,7 +771,7 @@ void xnpod_fire_callouts(xnqueue_t *hookq, xnthread_t *thread)
 	while ((holder = nholder) != NULL) {
 		xnhook_t *hook = link2hook(holder);
 		nholder = nextq(hookq, holder);
-		hook->routine(thread);
+		xnpod_call_hook(hook, thread);
 	}
 
 	__clrbits(sched->status, XNKCOUT);
@@ -756,6 +1002,11 @@ int xnpod_start_thread(struct xnthread *thread,
 		ret = -EINVAL;
 		goto unlock_and_exit;
 	}
+#ifdef CONFIG_XENO_OPT_SCHED_BALANCE
+	/* Shadows got their balancing set when mapped. */
+	if (!xnthread_test_state(thread, XNSHADOW))
+		thread->lb_affinity = thread->affinity;
+#endif /* CONFIG_XENO_OPT_SCHED_BALANCE */
 #ifdef CONFIG_SMP
 	if (!xnarch_cpu_isset(xnsched_cpu(thread->sched), thread->affinity)) {
 		xnsched_t *sched;
@@ -767,6 +1018,7 @@ int xnpod_start_thread(struct xnthread *thread,
 	xnthread_set_state(thread, (attr->mode & (XNTHREAD_MODE_BITS | XNSUSP)) | XNSTARTED);
 	thread->imask = attr->imask;
 	thread->imode = (attr->mode & XNTHREAD_MODE_BITS);
+	__xnpod_sync_rr(thread);
 	thread->entry = attr->entry;
 	thread->cookie = attr->cookie;
 
@@ -799,7 +1051,7 @@ int xnpod_start_thread(struct xnthread *thread,
 #ifdef CONFIG_XENO_OPT_PERVASIVE
 run_hooks:
 #endif
-	xnpod_run_hooks(&nkpod->tstartq, thread, "START");
+	xnpod_run_hooks(XNHOOK_THREAD_START, thread);
 
 schedule:
 	xnpod_schedule();
@@ -835,6 +1087,7 @@ static void xnpod_reset_thread(struct xnthread *thread)
 	/* Reset modebits. */
 	xnthread_clear_state(thread, XNTHREAD_MODE_BITS);
 	xnthread_set_state(thread, thread->imode);
+	__xnpod_sync_rr(thread);
 
 	/* Reset scheduling class and priority to the initial ones. */
 	xnsched_set_policy(thread, thread->init_class,
@@ -1015,6 +1268,7 @@ xnflags_t xnpod_set_thread_mode(xnthread_t *thread,
 	oldmode = xnthread_state_flags(thread) & XNTHREAD_MODE_BITS;
 	xnthread_clear_state(thread, clrmask & XNTHREAD_MODE_BITS);
 	xnthread_set_state(thread, setmask & XNTHREAD_MODE_BITS);
+	__xnpod_sync_rr(thread);
 
 	if (curr == thread) {
 		if (!(oldmode & XNLOCK)) {
@@ -1025,6 +1279,12 @@ xnflags_t xnpod_set_thread_mode(xnthread_t *thread,
 			xnthread_lock_count(thread) = 0;
 	}
 
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+	/* User-space checks the mode bits before locking on its own. */
+	if (thread->u_mode)
+		*(thread->u_mode) = thread->state;
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+
 	xnlock_put_irqrestore(&nklock, s);
 
 	return oldmode;
@@ -1155,14 +1415,26 @@ void xnpod_delete_thread(xnthread_t *thread)
 		xnthread_clear_state(thread, XNREADY);
 	}
 
+	__xnpod_track_rr(thread, 0);
 	xntimer_destroy(&thread->rtimer);
 	xntimer_destroy(&thread->ptimer);
+#ifdef CONFIG_XENO_OPT_SCHED_BUDGET
+	xnbudget_destroy_thread(thread);
+#endif /* CONFIG_XENO_OPT_SCHED_BUDGET */
+
+#ifdef CONFIG_SMP
+	xnintr_release_consumer(thread);
+#endif /* CONFIG_SMP */
 
 #ifdef CONFIG_XENO_OPT_SELECT
 	if (thread->selector) {
 		xnselector_destroy(thread->selector);
 		thread->selector = NULL;
 	}
+	if (thread->eselector) {
+		xnselector_destroy(thread->eselector);
+		thread->eselector = NULL;
+	}
 #endif /* CONFIG_XENO_OPT_SELECT */
 
 	if (xnthread_test_state(thread, XNPEND))
@@ -1196,7 +1468,7 @@ void xnpod_delete_thread(xnthread_t *thread)
 #else /* !CONFIG_XENO_HW_UNLOCKED_SWITCH */
 	} else {
 #endif /* !CONFIG_XENO_HW_UNLOCKED_SWITCH */
-		xnpod_run_hooks(&nkpod->tdeleteq, thread, "DELETE");
+		xnpod_run_hooks(XNHOOK_THREAD_DELETE, thread);
 
 		xnsched_forget(thread);
 		/*
@@ -1207,8 +1479,12 @@ void xnpod_delete_thread(xnthread_t *thread)
 
 		xnarch_finalize_no_switch(xnthread_archtcb(thread));
 
+#ifdef CONFIG_XENO_OPT_SCHED_REAPER
+		xnsched_kick_reaper(xnpod_current_sched());
+#else /* !CONFIG_XENO_OPT_SCHED_REAPER */
 		if (xnthread_test_state(sched->curr, XNROOT))
 			xnfreesync();
+#endif /* !CONFIG_XENO_OPT_SCHED_REAPER */
 	}
 
       unlock_and_exit:
@@ -1398,10 +1674,11 @@ void xnpod_suspend_thread(xnthread_t *thread, xnflags_t mask,
 	   a call to xnpod_suspend_thread(thread,XNDELAY,XN_INFINITE,XN_RELATIVE,NULL). */
 
 	if (timeout != XN_INFINITE || timeout_mode != XN_RELATIVE) {
-		xntimer_set_sched(&thread->rtimer, thread->sched);
-		if (xntimer_start(&thread->rtimer, timeout, XN_INFINITE,
-				  timeout_mode)) {
-			/* (absolute) timeout value in the past, bail out. */
+		if (xnthread_start_rtimer(thread, timeout, timeout_mode)) {
+			/*
+			 * (absolute) timeout value in the past, or
+			 * timer stuck on another CPU, bail out.
+			 */
 			if (wchan) {
 				thread->wchan = wchan;
 				xnsynch_forget_sleeper(thread);
@@ -1607,7 +1884,7 @@ void xnpod_resume_thread(struct xnthread *thread, xnflags_t mask)
 	 * latter case, stopping the timer is a no-op.
 	 */
 	if (mask & XNDELAY)
-		xntimer_stop(&thread->rtimer);
+		xnthread_stop_rtimer(thread);
 
 	if (!xnthread_test_state(thread, XNTHREAD_BLOCK_BITS))
 		goto clear_wchan;
@@ -1627,7 +1904,7 @@ void xnpod_resume_thread(struct xnthread *thread, xnflags_t mask)
 			 * A resource became available to the thread.
 			 * Cancel the watchdog timer.
 			 */
-			xntimer_stop(&thread->rtimer);
+			xnthread_stop_rtimer(thread);
 			xnthread_clear_state(thread, XNDELAY);
 		}
 		goto recheck_state;
@@ -1891,6 +2168,8 @@ int __xnpod_set_thread_schedparam(struct xnthread *thread,
 	}
 #endif /* CONFIG_XENO_OPT_PERVASIVE */
 
+	xnshadow_publish(thread);
+
 unlock_and_exit:
 
 	xnlock_put_irqrestore(&nklock, s);
@@ -1952,6 +2231,9 @@ int xnpod_migrate_thread(int cpu)
 
 	/* Migrate the thread periodic timer. */
 	xntimer_set_sched(&thread->ptimer, sched);
+#ifdef CONFIG_XENO_OPT_SCHED_BUDGET
+	xntimer_set_sched(&thread->budget.rtimer, sched);
+#endif /* CONFIG_XENO_OPT_SCHED_BUDGET */
 
 	xnpod_schedule();
 
@@ -2010,6 +2292,7 @@ void xnpod_dispatch_signals(void)
 	/* Reset ASR mode bits */
 	xnthread_clear_state(thread, XNTHREAD_MODE_BITS);
 	xnthread_set_state(thread, thread->asrmode);
+	__xnpod_sync_rr(thread);
 	thread->asrlevel++;
 
 	/* Setup ASR interrupt mask then fire it. */
@@ -2021,6 +2304,7 @@ void xnpod_dispatch_signals(void)
 	thread->asrlevel--;
 	xnthread_clear_state(thread, XNTHREAD_MODE_BITS);
 	xnthread_set_state(thread, oldmode);
+	__xnpod_sync_rr(thread);
 }
 
 /*!
@@ -2039,6 +2323,7 @@ void xnpod_welcome_thread(xnthread_t *thread, int imask)
 {
 	xnsched_t *sched = xnsched_finish_unlocked_switch(thread->sched);
 
+	xnsched_cswhist_end(sched);
 	xnsched_finalize_zombie(sched);
 
 	trace_mark(xn_nucleus, thread_boot, "thread %p thread_name %s",
@@ -2144,16 +2429,50 @@ static inline void xnpod_switch_to(xnsched_t *sched,
  * @note The switch hooks are called on behalf of the resuming thread.
  */
 
+#ifdef CONFIG_SMP
+
+/*
+ * Send one rescheduling IPI to each remote CPU marked in the resched
+ * mask, unless the CPU still has one in flight: the target clears
+ * its pending bit before rescheduling, so that the IPI already sent
+ * will pick the latest scheduling state up.
+ */
+static void __xnpod_send_resched_ipis(struct xnsched *sched)
+{
+	xnarch_cpumask_t ipimask;
+	int cpu, send = 0;
+
+	xnarch_cpus_clear(ipimask);
+
+	for (cpu = 0; cpu < XNARCH_NR_CPUS; cpu++) {
+		if (!xnarch_cpu_isset(cpu, sched->resched))
+			continue;
+		if (xnarch_cpu_test_and_set(cpu, nkpod->ipipend)) {
+			xnstat_counter_inc(&sched->ipiskip);
+			continue;
+		}
+		xnarch_cpu_set(cpu, ipimask);
+		xnstat_counter_inc(&sched->ipisent);
+		send = 1;
+	}
+
+	xnarch_cpus_clear(sched->resched);
+
+	if (send) {
+		xnarch_memory_barrier();
+		xnarch_send_ipi(ipimask);
+	}
+}
+
+#endif /* CONFIG_SMP */
+
 static inline int __xnpod_test_resched(struct xnsched *sched)
 {
 	int resched = testbits(sched->status, XNRESCHED);
 #ifdef CONFIG_SMP
 	/* Send resched IPI to remote CPU(s). */
-	if (unlikely(!xnarch_cpus_empty(sched->resched))) {
-		xnarch_memory_barrier();
-		xnarch_send_ipi(sched->resched);
-		xnarch_cpus_clear(sched->resched);
-	}
+	if (unlikely(!xnarch_cpus_empty(sched->resched)))
+		__xnpod_send_resched_ipis(sched);
 #else
 	resched = xnsched_resched_p(sched);
 #endif
@@ -2170,6 +2489,7 @@ void __xnpod_schedule(struct xnsched *sched)
 	if (xnarch_escalate())
 		return;
 
+	xnsched_stamp_phase(sched, XNSCHED_PHASE_SCHED);
 	trace_mark(xn_nucleus, sched, MARK_NOARGS);
 
 	xnlock_get_irqsave(&nklock, s);
@@ -2188,6 +2508,17 @@ reschedule:
 #endif /* !XENO_DEBUG(NUCLEUS) */
 	zombie = xnthread_test_state(curr, XNZOMBIE);
 
+#if defined(CONFIG_XENO_OPT_PERVASIVE) && defined(CONFIG_XENO_FASTSYNCH)
+	/*
+	 * Apply the priority ceiling the current thread deferred
+	 * when locking a PP object from user-space, before it may be
+	 * switched out.
+	 */
+	if (!zombie && curr->u_window &&
+	    curr->u_window->pp_pending != XN_NO_HANDLE)
+		xnsynch_commit_ceiling(curr);
+#endif /* CONFIG_XENO_OPT_PERVASIVE && CONFIG_XENO_FASTSYNCH */
+
 	next = xnsched_pick_next(sched);
 	if (next == curr && !xnthread_test_state(curr, XNRESTART)) {
 		/* Note: the root thread never restarts. */
@@ -2209,6 +2540,7 @@ reschedule:
 		   "next %p next_name %s",
 		   prev, xnthread_name(prev),
 		   next, xnthread_name(next));
+	xnevtrace_log(XNEVT_SWITCH, next, xnthread_handle(prev));
 
 #ifdef CONFIG_XENO_OPT_PERVASIVE
 	shadow = xnthread_test_state(prev, XNSHADOW);
@@ -2218,13 +2550,19 @@ reschedule:
 
 	if (xnthread_test_state(next, XNROOT)) {
 		xnsched_reset_watchdog(sched);
+#ifdef CONFIG_XENO_OPT_SCHED_REAPER
+		xnsched_kick_reaper(sched);
+#else /* !CONFIG_XENO_OPT_SCHED_REAPER */
 		xnfreesync();
+#endif /* !CONFIG_XENO_OPT_SCHED_REAPER */
 	}
 
 	if (zombie)
 		xnsched_zombie_hooks(prev);
 
 	sched->curr = next;
+	xnlatprof_switch(sched, next);
+	xncachepart_switch(sched, next);
 
 	if (xnthread_test_state(prev, XNROOT))
 		xnarch_leave_root(xnthread_archtcb(prev));
@@ -2233,11 +2571,32 @@ reschedule:
 			xnintr_host_tick(sched);
 		if (testbits(sched->lflags, XNHDEFER))
 			xntimer_next_local_shot(sched);
+#ifdef CONFIG_XENO_OPT_DIRECT_HARDEN
+		if (sched->gkdirect)
+			xnshadow_kick_harden(sched);
+#endif /* CONFIG_XENO_OPT_DIRECT_HARDEN */
 		xnarch_enter_root(xnthread_archtcb(next));
 	}
 
 	xnstat_exectime_switch(sched, &next->stat.account);
 	xnstat_counter_inc(&next->stat.csw);
+	xnstatmap_publish(prev);
+	/*
+	 * Threads only read their own window, so refreshing it when
+	 * switching in is enough, unless the outgoing thread relaxes:
+	 * its primary mode figures would then stay stale until it
+	 * hardens again.
+	 */
+	if (xnthread_test_state(prev, XNRELAX))
+		xnshadow_publish(prev);
+	xnshadow_publish(next);
+
+	__xnpod_eager_save_fpu(sched, prev);
+
+	xnsched_cswhist_start(sched, prev, next);
+
+	xnsched_rrb_switch(sched, prev, next);
+	xnbudget_switch(sched, prev, next);
 
 	xnpod_switch_to(sched, prev, next);
 
@@ -2259,6 +2618,8 @@ reschedule:
 
 	switched = 1;
 	sched = xnsched_finish_unlocked_switch(sched);
+	xnsched_cswhist_end(sched);
+	xnsched_stamp_phase(sched, XNSCHED_PHASE_SWITCH);
 	/*
 	 * Re-read the currently running thread, this is needed
 	 * because of relaxed/hardened transitions.
@@ -2282,7 +2643,7 @@ reschedule:
 		nkpod->schedhook(curr, XNRUNNING);
 #endif /* __XENO_SIM__ */
 
-	xnpod_run_hooks(&nkpod->tswitchq, curr, "SWITCH");
+	xnpod_run_hooks(XNHOOK_THREAD_SWITCH, curr);
 
       signal_unlock_and_exit:
 	if (xnthread_signaled_p(curr))
@@ -2301,6 +2662,8 @@ reschedule:
 
 #ifdef CONFIG_XENO_OPT_PERVASIVE
       shadow_epilogue:
+	xnsched_cswhist_end(xnpod_current_sched());
+
 	/* Shadow on entry and root without shadow extension on exit?
 	   Mmmm... This must be the user-space mate of a deleted real-time
 	   shadow we've just rescheduled in the Linux domain to have it
@@ -2408,17 +2771,8 @@ int xnpod_add_hook(int type, void (*routine) (xnthread_t *))
 	trace_mark(xn_nucleus, sched_addhook, "type %d routine %p",
 		   type, routine);
 
-	switch (type) {
-	case XNHOOK_THREAD_START:
-		hookq = &nkpod->tstartq;
-		break;
-	case XNHOOK_THREAD_SWITCH:
-		hookq = &nkpod->tswitchq;
-		break;
-	case XNHOOK_THREAD_DELETE:
-		hookq = &nkpod->tdeleteq;
-		break;
-	default:
+	hookq = xnpod_hook_queue(type);
+	if (hookq == NULL) {
 		err = -EINVAL;
 		goto unlock_and_exit;
 	}
@@ -2428,7 +2782,13 @@ int xnpod_add_hook(int type, void (*routine) (xnthread_t *))
 	if (hook) {
 		inith(&hook->link);
 		hook->routine = routine;
+#ifdef CONFIG_XENO_OPT_STATS
+		hook->calls = 0;
+		hook->exectime = 0;
+		hook->maxtime = 0;
+#endif /* CONFIG_XENO_OPT_STATS */
 		prependq(hookq, &hook->link);
+		__setbits(nkpod->hooks, XNHOOK_BIT(type));
 	} else
 		err = -ENOMEM;
 
@@ -2480,19 +2840,9 @@ int xnpod_remove_hook(int type, void (*routine) (xnthread_t *))
 	trace_mark(xn_nucleus, sched_removehook, "type %d routine %p",
 		   type, routine);
 
-	switch (type) {
-	case XNHOOK_THREAD_START:
-		hookq = &nkpod->tstartq;
-		break;
-	case XNHOOK_THREAD_SWITCH:
-		hookq = &nkpod->tswitchq;
-		break;
-	case XNHOOK_THREAD_DELETE:
-		hookq = &nkpod->tdeleteq;
-		break;
-	default:
+	hookq = xnpod_hook_queue(type);
+	if (hookq == NULL)
 		goto bad_hook;
-	}
 
 	for (holder = getheadq(hookq);
 	     holder != NULL; holder = nextq(hookq, holder)) {
@@ -2501,6 +2851,9 @@ int xnpod_remove_hook(int type, void (*routine) (xnthread_t *))
 		if (hook->routine == routine) {
 			removeq(hookq, holder);
 			xnfree(hook);
+			nkpod->hookgen++;
+			if (emptyq_p(hookq))
+				__clrbits(nkpod->hooks, XNHOOK_BIT(type));
 			goto unlock_and_exit;
 		}
 	}
@@ -2574,6 +2927,7 @@ int xnpod_trap_fault(xnarch_fltinfo_t *fltinfo)
 	   stepping properly. */
 
 	if (xnpod_shadow_p()) {
+		unsigned long addr = 0;
 #if XENO_DEBUG(NUCLEUS)
 		if (!xnarch_fault_um(fltinfo)) {
 			xnarch_trace_panic_freeze();
@@ -2598,8 +2952,19 @@ int xnpod_trap_fault(xnarch_fltinfo_t *fltinfo)
 			   locking anyway. */
 			xnstat_counter_inc(&thread->stat.pf);
 
+#ifdef xnarch_fault_addr
+		/* Grab the fault address before relaxing, the latter
+		   might clobber it. */
+		if (xnarch_fault_pf_p(fltinfo))
+			addr = xnarch_fault_addr(fltinfo);
+#endif /* xnarch_fault_addr */
+
 		xnshadow_relax(xnarch_fault_notify(fltinfo),
 			       SIGDEBUG_MIGRATE_FAULT);
+
+		/* Tell which mapped heap was hit, if any. */
+		if (addr)
+			xnheap_account_fault(addr);
 	}
 #endif /* CONFIG_XENO_OPT_PERVASIVE */
 #endif /* __KERNEL__ */
@@ -2691,6 +3056,7 @@ int xnpod_enable_timesource(void)
 
 	nktbase.wallclock_offset =
 		xnarch_get_host_time() - xnarch_get_cpu_time();
+	xnvdso_set_wallclock_offset(nktbase.wallclock_offset);
 
 	for (cpu = 0; cpu < xnarch_num_online_cpus(); cpu++) {
 
@@ -2833,7 +3199,8 @@ EXPORT_SYMBOL_GPL(xnpod_disable_timesource);
  *
  * - -EINVAL is returned if @a period is different from XN_INFINITE
  * but shorter than the scheduling latency value for the target
- * system, as available from /proc/xenomai/latency.
+ * system, as available from /proc/xenomai/latency, or than the
+ * pre-release advance of the thread.
  *
  * Environments:
  *
@@ -2849,11 +3216,22 @@ EXPORT_SYMBOL_GPL(xnpod_disable_timesource);
  * @note The @a idate and @a period values will be interpreted as
  * jiffies if @a thread is bound to a periodic time base (see
  * xnpod_init_thread), or nanoseconds otherwise.
+ *
+ * @note If @a thread has the XNPREREL mode bit set and is bound to an
+ * aperiodic time base, its periodic timer is programmed ahead of each
+ * release point by the value of the prerelease_ns module parameter,
+ * or by the scheduling latency if zero. xnpod_wait_thread_period()
+ * then busy-waits for the remaining time, so that the thread is
+ * released on the nominal date regardless of the timer and
+ * rescheduling latency. A release point is deemed missed when the
+ * thread was not waiting for it by its advanced date. Changing
+ * XNPREREL takes effect on the next call to this service.
  */
 
 int xnpod_set_thread_periodic(xnthread_t *thread,
 			      xnticks_t idate, xnticks_t period)
 {
+	xnticks_t advance = 0, release = 0;
 	int err = 0;
 	spl_t s;
 
@@ -2880,18 +3258,33 @@ int xnpod_set_thread_periodic(xnthread_t *thread,
 		goto unlock_and_exit;
 	}
 
+	thread->prerelease = 0;
+	if (xnthread_test_state(thread, XNPREREL) &&
+	    !xntbase_periodic_p(xnthread_time_base(thread))) {
+		advance = prerelease_arg ?:
+			xnarch_tsc_to_ns(nklatency - nktimerlat);
+		if (advance >= period) {
+			err = -EINVAL;
+			goto unlock_and_exit;
+		}
+		thread->prerelease = xnarch_ns_to_tsc(advance);
+	}
+
 	xntimer_set_sched(&thread->ptimer, thread->sched);
 
 	if (idate == XN_INFINITE) {
-		xntimer_start(&thread->ptimer, period, period, XN_RELATIVE);
+		xntimer_start(&thread->ptimer, period - advance, period,
+			      XN_RELATIVE);
 	} else {
 		idate -= xntbase_get_wallclock_offset(
 			xntimer_base(&thread->ptimer));
-		err = xntimer_start(&thread->ptimer, idate, period,
+		err = xntimer_start(&thread->ptimer, idate - advance, period,
 				    XN_ABSOLUTE);
 		if (err)
 			goto unlock_and_exit;
 
+		release = xntimer_pexpect(&thread->ptimer) + thread->prerelease;
+
 		/* We could call xntimer_get_overruns after
 		   xnpod_suspend_thread, but we would need to return the count
 		   of overruns to the caller, otherwise, these overruns
@@ -2902,10 +3295,17 @@ int xnpod_set_thread_periodic(xnthread_t *thread,
 				     XN_RELATIVE, NULL);
 	}
 
+	xnshadow_publish(thread);
+
       unlock_and_exit:
 
 	xnlock_put_irqrestore(&nklock, s);
 
+	if (advance && release && thread == xnpod_current_thread() &&
+	    !xnthread_test_info(thread, XNBREAK))
+		while ((xnsticks_t)(xnarch_get_cpu_tsc() - release) < 0)
+			cpu_relax();
+
 	return err;
 }
 EXPORT_SYMBOL_GPL(xnpod_set_thread_periodic);
@@ -2954,7 +3354,7 @@ EXPORT_SYMBOL_GPL(xnpod_set_thread_periodic);
 
 int xnpod_wait_thread_period(unsigned long *overruns_r)
 {
-	xnticks_t now;
+	xnticks_t now, release = 0;
 	unsigned long overruns = 0;
 	xnthread_t *thread;
 	xntbase_t *tbase;
@@ -2988,6 +3388,9 @@ int xnpod_wait_thread_period(unsigned long *overruns_r)
 		now = xntbase_get_rawclock(tbase);
 	}
 
+	if (thread->prerelease)
+		release = xntimer_pexpect(&thread->ptimer) + thread->prerelease;
+
 	overruns = xntimer_get_overruns(&thread->ptimer, now);
 	if (overruns) {
 		err = -ETIMEDOUT;
@@ -3000,10 +3403,22 @@ int xnpod_wait_thread_period(unsigned long *overruns_r)
 	if (likely(overruns_r != NULL))
 		*overruns_r = overruns;
 
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+	if (thread->u_window) {
+		thread->u_window->overruns += overruns;
+		__xnshadow_publish(thread);
+	}
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+
       unlock_and_exit:
 
 	xnlock_put_irqrestore(&nklock, s);
 
+	/* Pre-released thread: spin until the nominal release date. */
+	if (release && err == 0)
+		while ((xnsticks_t)(xnarch_get_cpu_tsc() - release) < 0)
+			cpu_relax();
+
 	return err;
 }
 EXPORT_SYMBOL_GPL(xnpod_wait_thread_period);
@@ -3046,12 +3461,15 @@ EXPORT_SYMBOL_GPL(xnpod_wait_thread_period);
  * represents the number of periodic ticks in that
  * timebase. Otherwise, if @a thread is bound to the master time base,
  * a full time-slice will last:
- * @a quantum * CONFIG_XENO_OPT_TIMING_VIRTICK.
+ * @a quantum * CONFIG_XENO_OPT_TIMING_VIRTICK. In the latter case,
+ * the time actually consumed by the thread is accounted for at each
+ * context switch, and a one-shot timer only runs while the thread
+ * is current, so that idle or blocked round-robin threads cause no
+ * timer interrupt.
  */
 
 int xnpod_set_thread_tslice(struct xnthread *thread, xnticks_t quantum)
 {
-	unsigned long oldmode;
 	int aperiodic;
 	spl_t s;
 
@@ -3065,25 +3483,138 @@ int xnpod_set_thread_tslice(struct xnthread *thread, xnticks_t quantum)
 	aperiodic = !xntbase_periodic_p(xnthread_time_base(thread));
 	thread->rrperiod = quantum;
 	thread->rrcredit = quantum;
-	oldmode = xnthread_test_state(thread, XNRRB);
+	thread->rrbudget = 0;
 
-	if (quantum != XN_INFINITE) {
+	if (quantum != XN_INFINITE)
 		xnthread_set_state(thread, XNRRB);
-		if (aperiodic && !oldmode && nkpod->tsliced++ == 0)
-			xntimer_start(&nkpod->tslicer,
-				      nkvtick, nkvtick, XN_RELATIVE);
-	} else {
+	else
 		xnthread_clear_state(thread, XNRRB);
-		if (aperiodic && oldmode && --nkpod->tsliced == 0)
-			xntimer_stop(&nkpod->tslicer);
+
+	/*
+	 * The budget timer only runs on behalf of the current
+	 * thread, restart it with the new slice.
+	 */
+	if (aperiodic && thread->sched->curr == thread) {
+		xntimer_stop(&thread->sched->rrbtimer);
+		if (quantum != XN_INFINITE)
+			xnsched_rrb_arm(thread->sched, thread);
 	}
 
+	__xnpod_sync_rr(thread);
+
 	xnlock_put_irqrestore(&nklock, s);
 
 	return 0;
 }
 EXPORT_SYMBOL_GPL(xnpod_set_thread_tslice);
 
+#ifdef XNLOCK_CONTENTION_STATS
+
+/*
+ * Contention accounting only: scheduler-local operations still
+ * serialize on nklock, these figures tell how much that costs.
+ */
+
+#define XNLOCK_STAT_MAX  64
+
+static struct xnlockstat xnlock_stat_pool[XNLOCK_STAT_MAX];
+
+/*
+ * Called from __xnlock_spin() with the lock held, which serializes
+ * the updates of its profile.
+ */
+void xnlock_stat_record(struct xnlockstat *stat,
+			unsigned long long spin, void *ip)
+{
+	unsigned long long ns = xnarch_tsc_to_ns(spin);
+	int n, victim = 0;
+
+	if (ns >= 1ULL << (XNLOCK_STAT_BUCKETS - 2))
+		n = XNLOCK_STAT_BUCKETS - 1;
+	else
+		n = fls((unsigned long)ns);
+	stat->hist[n]++;
+
+	for (n = 0; n < XNLOCK_STAT_SITES; n++) {
+		if (stat->sites[n].ip == ip) {
+			stat->sites[n].count++;
+			return;
+		}
+		if (stat->sites[n].count < stat->sites[victim].count)
+			victim = n;
+	}
+
+	/*
+	 * Evict the least contending site, the newcomer inherits its
+	 * count so that the top sites may only be overestimated.
+	 */
+	stat->sites[victim].ip = ip;
+	stat->sites[victim].count++;
+}
+EXPORT_SYMBOL_GPL(xnlock_stat_record);
+
+/**
+ * Attach a profile to a nucleus lock, so that /proc/xenomai/lockstat
+ * reports its spin time histogram and top contending sites, besides
+ * the counters all locks maintain. Nothing happens if the profile
+ * pool is exhausted. The profile must be detached before the lock
+ * goes away.
+ */
+void xnlock_stat_attach(xnlock_t *lock, const char *name, ...)
+{
+	struct xnlockstat *stat;
+	va_list args;
+	spl_t s;
+	int n;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	for (n = 0; n < XNLOCK_STAT_MAX; n++)
+		if (xnlock_stat_pool[n].lock == NULL)
+			break;
+
+	if (n == XNLOCK_STAT_MAX) {
+		xnlock_put_irqrestore(&nklock, s);
+		return;
+	}
+
+	stat = &xnlock_stat_pool[n];
+	memset(stat, 0, sizeof(*stat));
+	stat->lock = lock;
+	va_start(args, name);
+	vsnprintf(stat->name, sizeof(stat->name), name, args);
+	va_end(args);
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	/* Do not nest the lock into nklock, some paths do the converse. */
+	xnlock_get_irqsave(lock, s);
+	lock->stat = stat;
+	xnlock_put_irqrestore(lock, s);
+}
+EXPORT_SYMBOL_GPL(xnlock_stat_attach);
+
+void xnlock_stat_detach(xnlock_t *lock)
+{
+	struct xnlockstat *stat;
+	spl_t s;
+
+	xnlock_get_irqsave(lock, s);
+	stat = lock->stat;
+	lock->stat = NULL;
+	xnlock_put_irqrestore(lock, s);
+
+	if (stat == NULL)
+		return;
+
+	xnlock_get_irqsave(&nklock, s);
+	stat->lock = NULL;
+	xnlock_put_irqrestore(&nklock, s);
+}
+EXPORT_SYMBOL_GPL(xnlock_stat_detach);
+
+#endif /* XNLOCK_CONTENTION_STATS */
+
 #ifdef CONFIG_XENO_OPT_VFILE
 
 #if XENO_DEBUG(XNLOCK)
@@ -3155,6 +3686,117 @@ static struct xnvfile_regular lock_vfile = {
 
 #endif /* XENO_DEBUG(XNLOCK) */
 
+#ifdef XNLOCK_CONTENTION_STATS
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,26)
+#define LOCKSTAT_SITE_FMT  "%pS"
+#else
+#define LOCKSTAT_SITE_FMT  "%p"
+#endif
+
+static int lockstat_vfile_show(struct xnvfile_regular_iterator *it,
+			       void *data)
+{
+	unsigned long acquired, contended;
+	unsigned long long spin_tsc;
+	struct xnlockstat stat;
+	xnlock_t *lock;
+	int n, i;
+	spl_t s;
+
+	xnvfile_printf(it, "%-24s %12s %12s %14s\n",
+		       "LOCK", "ACQUIRED", "CONTENDED", "SPIN(us)");
+
+	for (n = 0; n < XNLOCK_STAT_MAX; n++) {
+		xnlock_get_irqsave(&nklock, s);
+		lock = xnlock_stat_pool[n].lock;
+		if (lock == NULL) {
+			xnlock_put_irqrestore(&nklock, s);
+			continue;
+		}
+		/* The lock remains valid until its profile is detached. */
+		stat = xnlock_stat_pool[n];
+		acquired = lock->acquired;
+		contended = lock->contended;
+		spin_tsc = lock->spin_tsc;
+		xnlock_put_irqrestore(&nklock, s);
+
+		xnvfile_printf(it, "%-24s %12lu %12lu %14llu\n",
+			       stat.name, acquired, contended,
+			       xnarch_tsc_to_ns(spin_tsc) / 1000);
+
+		if (contended == 0)
+			continue;
+
+		xnvfile_printf(it, "  spin(ns):");
+		for (i = 0; i < XNLOCK_STAT_BUCKETS; i++)
+			if (stat.hist[i])
+				xnvfile_printf(it, " %s%lu:%lu",
+					       i == XNLOCK_STAT_BUCKETS - 1 ?
+					       ">=" : "<",
+					       i == XNLOCK_STAT_BUCKETS - 1 ?
+					       1UL << (i - 1) : 1UL << i,
+					       stat.hist[i]);
+		xnvfile_printf(it, "\n");
+
+		for (i = 0; i < XNLOCK_STAT_SITES; i++)
+			if (stat.sites[i].ip)
+				xnvfile_printf(it, "  %12lu  " LOCKSTAT_SITE_FMT "\n",
+					       stat.sites[i].count,
+					       stat.sites[i].ip);
+	}
+
+	return 0;
+}
+
+static ssize_t lockstat_vfile_store(struct xnvfile_input *input)
+{
+	struct xnlockstat *stat;
+	xnlock_t *lock;
+	ssize_t ret;
+	long val;
+	spl_t s;
+	int n;
+
+	ret = xnvfile_get_integer(input, &val);
+	if (ret < 0)
+		return ret;
+
+	if (val != 0)
+		return -EINVAL;
+
+	/*
+	 * We may not grab the profiled locks under nklock, so a
+	 * concurrent update may survive the reset; this is harmless.
+	 */
+	for (n = 0; n < XNLOCK_STAT_MAX; n++) {
+		xnlock_get_irqsave(&nklock, s);
+		stat = &xnlock_stat_pool[n];
+		lock = stat->lock;
+		if (lock) {
+			lock->acquired = 0;
+			lock->contended = 0;
+			lock->spin_tsc = 0;
+			memset(stat->hist, 0, sizeof(stat->hist));
+			memset(stat->sites, 0, sizeof(stat->sites));
+		}
+		xnlock_put_irqrestore(&nklock, s);
+	}
+
+	return ret;
+}
+
+static struct xnvfile_regular_ops lockstat_vfile_ops = {
+	.show = lockstat_vfile_show,
+	.store = lockstat_vfile_store,
+};
+
+static struct xnvfile_regular lockstat_vfile = {
+	.ops = &lockstat_vfile_ops,
+};
+
+#endif /* XNLOCK_CONTENTION_STATS */
+
 static int latency_vfile_show(struct xnvfile_regular_iterator *it, void *data)
 {
 	xnvfile_printf(it, "%Lu\n", xnarch_tsc_to_ns(nklatency - nktimerlat));
@@ -3185,6 +3827,68 @@ static struct xnvfile_regular latency_vfile = {
 	.ops = &latency_vfile_ops,
 };
 
+static int gravity_vfile_show(struct xnvfile_regular_iterator *it, void *data)
+{
+	xnvfile_printf(it, "irq=%Lu\nkernel=%Lu\nuser=%Lu\n",
+		       xnarch_tsc_to_ns(nkigravity),
+		       xnarch_tsc_to_ns(nkkgravity),
+		       xnarch_tsc_to_ns(nklatency));
+
+	return 0;
+}
+
+/*
+ * Accepts "calibrate", which measures the IRQ class gravity again,
+ * or "<class>=<ns>" to set the gravity of a wakeup class. Setting
+ * the user class gravity is equivalent to writing the same value
+ * minus the timer latency to /proc/xenomai/latency.
+ */
+static ssize_t gravity_vfile_store(struct xnvfile_input *input)
+{
+	char buf[32], *val, *end;
+	unsigned long ns;
+	ssize_t ret;
+	int err;
+
+	ret = xnvfile_get_string(input, buf, sizeof(buf));
+	if (ret < 0)
+		return ret;
+
+	if (strcmp(buf, "calibrate") == 0) {
+		err = xntimer_calibrate_gravity();
+		return err ?: ret;
+	}
+
+	val = strchr(buf, '=');
+	if (val == NULL)
+		return -EINVAL;
+
+	*val++ = '\0';
+	ns = simple_strtoul(val, &end, 0);
+	if (end == val || *end)
+		return -EINVAL;
+
+	if (strcmp(buf, "irq") == 0)
+		nkigravity = xnarch_ns_to_tsc(ns);
+	else if (strcmp(buf, "kernel") == 0)
+		nkkgravity = xnarch_ns_to_tsc(ns);
+	else if (strcmp(buf, "user") == 0)
+		nklatency = xnarch_ns_to_tsc(ns);
+	else
+		return -EINVAL;
+
+	return ret;
+}
+
+static struct xnvfile_regular_ops gravity_vfile_ops = {
+	.show = gravity_vfile_show,
+	.store = gravity_vfile_store,
+};
+
+static struct xnvfile_regular gravity_vfile = {
+	.ops = &gravity_vfile_ops,
+};
+
 static int version_vfile_show(struct xnvfile_regular_iterator *it, void *data)
 {
 	xnvfile_printf(it, "%s\n", XENO_VERSION_STRING);
@@ -3225,6 +3929,10 @@ static int faults_vfile_show(struct xnvfile_regular_iterator *it, void *data)
 
 	xnvfile_putc(it, '\n');
 
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+	xnheap_show_faults(it);
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+
 	return 0;
 }
 
@@ -3262,6 +3970,24 @@ static int apc_vfile_show(struct xnvfile_regular_iterator *it, void *data)
 				       rthal_apc_table[apc].name);
 	}
 
+	/* Dispatcher runs, with average and longest drain time (ns). */
+	xnvfile_puts(it, "\nbat: ");
+	for_each_online_cpu(cpu)
+		xnvfile_printf(it, "%12lu", rthal_apc_stats[cpu].batches);
+
+	xnvfile_puts(it, "\navg: ");
+	for_each_online_cpu(cpu) {
+		struct rthal_apc_stats *st = &rthal_apc_stats[cpu];
+		xnvfile_printf(it, "%12llu", st->batches ?
+			       xnarch_ulldiv(xnarch_tsc_to_ns(st->drain_time),
+					     st->batches, NULL) : 0ULL);
+	}
+
+	xnvfile_puts(it, "\nmax: ");
+	for_each_online_cpu(cpu)
+		xnvfile_printf(it, "%12llu",
+			       xnarch_tsc_to_ns(rthal_apc_stats[cpu].drain_max));
+
 	xnvfile_putc(it, '\n');
 
 	return 0;
@@ -3275,6 +4001,222 @@ static struct xnvfile_regular apc_vfile = {
 	.ops = &apc_vfile_ops,
 };
 
+#ifdef CONFIG_XENO_OPT_STATS
+
+static int hooks_vfile_show(struct xnvfile_regular_iterator *it, void *data)
+{
+	xnholder_t *holder;
+	xnqueue_t *hookq;
+	xnhook_t *hook;
+	int type;
+	spl_t s;
+
+	xnvfile_printf(it, "%-6s  %-18s  %10s  %10s  %10s\n",
+		       "TYPE", "ROUTINE", "CALLS", "AVG(ns)", "MAX(ns)");
+
+	/* There are only a few hooks, if any. */
+	xnlock_get_irqsave(&nklock, s);
+
+	for (type = XNHOOK_THREAD_START; type <= XNHOOK_THREAD_DELETE; type++) {
+		hookq = xnpod_hook_queue(type);
+		for (holder = getheadq(hookq);
+		     holder != NULL; holder = nextq(hookq, holder)) {
+			hook = link2hook(holder);
+			xnvfile_printf(it, "%-6s  %-18p  %10lu  %10Lu  %10Lu\n",
+				       xnpod_hook_names[type], hook->routine,
+				       hook->calls, hook->calls ?
+				       xnarch_ulldiv(xnarch_tsc_to_ns(hook->exectime),
+						     hook->calls, NULL) : 0ULL,
+				       xnarch_tsc_to_ns(hook->maxtime));
+		}
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+
+static struct xnvfile_regular_ops hooks_vfile_ops = {
+	.show = hooks_vfile_show,
+};
+
+static struct xnvfile_regular hooks_vfile = {
+	.ops = &hooks_vfile_ops,
+};
+
+#ifdef XNARCH_HAVE_MM_SWITCH_STATS
+
+static int mmswitch_vfile_show(struct xnvfile_regular_iterator *it, void *data)
+{
+	int cpu;
+
+	xnvfile_printf(it, "%-3s  %12s  %12s\n", "CPU", "SAME-MM", "CROSS-MM");
+
+	for_each_online_cpu(cpu) {
+		if (!xnarch_cpu_supported(cpu))
+			continue;
+		xnvfile_printf(it, "%3d  %12lu  %12lu\n", cpu,
+			       xnarch_mm_switch_count(cpu, 0),
+			       xnarch_mm_switch_count(cpu, 1));
+	}
+
+	return 0;
+}
+
+static struct xnvfile_regular_ops mmswitch_vfile_ops = {
+	.show = mmswitch_vfile_show,
+};
+
+static struct xnvfile_regular mmswitch_vfile = {
+	.ops = &mmswitch_vfile_ops,
+};
+
+#endif /* XNARCH_HAVE_MM_SWITCH_STATS */
+
+#endif /* CONFIG_XENO_OPT_STATS */
+
+#ifdef CONFIG_XENO_OPT_STATS_SWITCH
+
+unsigned long xnsched_cswhist_gen;
+
+static inline unsigned long
+cswhist_hits(int cpu, int type, int bucket)
+{
+	struct xnsched_cswhist *h = &xnpod_sched_slot(cpu)->cswhist;
+
+	/* Counters pending a lazy reset read as zero. */
+	if (h->gen != xnsched_cswhist_gen)
+		return 0;
+
+	return h->hits[type][bucket];
+}
+
+static int cswhist_vfile_show(struct xnvfile_regular_iterator *it, void *data)
+{
+	static const char *labels[XNSCHED_CSW_TYPES] = {
+		[XNSCHED_CSW_PRIMARY] = "primary",
+		[XNSCHED_CSW_ROOT] = "root",
+	};
+	int cpu, type, bucket, used;
+
+	xnvfile_puts(it, "TYPE     RANGE(ns)          ");
+
+	for_each_online_cpu(cpu)
+		xnvfile_printf(it, "        CPU%d", cpu);
+
+	for (type = 0; type < XNSCHED_CSW_TYPES; type++) {
+		for (bucket = 0; bucket < XNSCHED_CSW_BUCKETS; bucket++) {
+			used = 0;
+			for_each_online_cpu(cpu)
+				used |= cswhist_hits(cpu, type, bucket) != 0;
+
+			if (!used)
+				continue;
+
+			if (bucket < XNSCHED_CSW_BUCKETS - 1)
+				xnvfile_printf(it, "\n%-8s < %-17Lu", labels[type],
+					       xnarch_tsc_to_ns(1ULL << bucket));
+			else
+				xnvfile_printf(it, "\n%-8s >= %-16Lu", labels[type],
+					       xnarch_tsc_to_ns(1ULL << (bucket - 1)));
+
+			for_each_online_cpu(cpu)
+				xnvfile_printf(it, "%12lu",
+					       cswhist_hits(cpu, type, bucket));
+		}
+	}
+
+	xnvfile_putc(it, '\n');
+
+	return 0;
+}
+
+static ssize_t cswhist_vfile_store(struct xnvfile_input *input)
+{
+	ssize_t ret;
+	long val;
+
+	ret = xnvfile_get_integer(input, &val);
+	if (ret < 0)
+		return ret;
+
+	if (val != 0)
+		return -EINVAL;
+
+	/* Each CPU clears its own histogram on its next sample. */
+	xnsched_cswhist_gen++;
+	xnarch_memory_barrier();
+
+	return ret;
+}
+
+static struct xnvfile_regular_ops cswhist_vfile_ops = {
+	.show = cswhist_vfile_show,
+	.store = cswhist_vfile_store,
+};
+
+static struct xnvfile_regular cswhist_vfile = {
+	.ops = &cswhist_vfile_ops,
+};
+
+#endif /* CONFIG_XENO_OPT_STATS_SWITCH */
+
+#ifdef CONFIG_XENO_HW_FPU
+
+static int fpustat_vfile_show(struct xnvfile_regular_iterator *it, void *data)
+{
+	struct xnsched_fpustat *stat;
+	int cpu;
+
+	xnvfile_printf(it, "policy: %s\n", fpu_eager_arg ? "eager" : "lazy");
+	xnvfile_printf(it, "%-6s %12s %12s %12s %12s\n",
+		       "CPU", "SAVES", "RESTORES", "FAULTS", "INITS");
+
+	for_each_online_cpu(cpu) {
+		stat = &xnpod_sched_slot(cpu)->fpustat;
+		xnvfile_printf(it, "%-6d %12lu %12lu %12lu %12lu\n", cpu,
+			       stat->saves, stat->restores,
+			       stat->faults, stat->inits);
+	}
+
+	return 0;
+}
+
+static ssize_t fpustat_vfile_store(struct xnvfile_input *input)
+{
+	ssize_t ret;
+	long val;
+	int cpu;
+
+	ret = xnvfile_get_integer(input, &val);
+	if (ret < 0)
+		return ret;
+
+	if (val != 0)
+		return -EINVAL;
+
+	/*
+	 * Racing with the owner CPUs may lose a few increments, which
+	 * is harmless for event counters.
+	 */
+	for_each_online_cpu(cpu)
+		memset(&xnpod_sched_slot(cpu)->fpustat, 0,
+		       sizeof(struct xnsched_fpustat));
+
+	return ret;
+}
+
+static struct xnvfile_regular_ops fpustat_vfile_ops = {
+	.show = fpustat_vfile_show,
+	.store = fpustat_vfile_store,
+};
+
+static struct xnvfile_regular fpustat_vfile = {
+	.ops = &fpustat_vfile_ops,
+};
+
+#endif /* CONFIG_XENO_HW_FPU */
+
 int __init xnpod_init_proc(void)
 {
 	int ret;
@@ -3294,24 +4236,56 @@ int __init xnpod_init_proc(void)
 	xnshadow_init_proc();
 
 	xnvfile_init_regular("latency", &latency_vfile, &nkvfroot);
+	xnvfile_init_regular("gravity", &gravity_vfile, &nkvfroot);
 	xnvfile_init_regular("version", &version_vfile, &nkvfroot);
 	xnvfile_init_regular("faults", &faults_vfile, &nkvfroot);
 	xnvfile_init_regular("apc", &apc_vfile, &nkvfroot);
+#ifdef CONFIG_XENO_OPT_STATS
+	xnvfile_init_regular("hooks", &hooks_vfile, &nkvfroot);
+#ifdef XNARCH_HAVE_MM_SWITCH_STATS
+	xnvfile_init_regular("mmswitch", &mmswitch_vfile, &nkvfroot);
+#endif /* XNARCH_HAVE_MM_SWITCH_STATS */
+#endif /* CONFIG_XENO_OPT_STATS */
 #if XENO_DEBUG(XNLOCK)
 	xnvfile_init_regular("lock", &lock_vfile, &nkvfroot);
 #endif /* XENO_DEBUG(XNLOCK) */
+#ifdef XNLOCK_CONTENTION_STATS
+	xnvfile_init_regular("lockstat", &lockstat_vfile, &nkvfroot);
+#endif /* XNLOCK_CONTENTION_STATS */
+#ifdef CONFIG_XENO_OPT_STATS_SWITCH
+	xnvfile_init_regular("cswhist", &cswhist_vfile, &nkvfroot);
+#endif /* CONFIG_XENO_OPT_STATS_SWITCH */
+#ifdef CONFIG_XENO_HW_FPU
+	xnvfile_init_regular("fpustat", &fpustat_vfile, &nkvfroot);
+#endif /* CONFIG_XENO_HW_FPU */
 
 	return 0;
 }
 
 void xnpod_cleanup_proc(void)
 {
+#ifdef CONFIG_XENO_HW_FPU
+	xnvfile_destroy_regular(&fpustat_vfile);
+#endif /* CONFIG_XENO_HW_FPU */
+#ifdef CONFIG_XENO_OPT_STATS_SWITCH
+	xnvfile_destroy_regular(&cswhist_vfile);
+#endif /* CONFIG_XENO_OPT_STATS_SWITCH */
+#ifdef XNLOCK_CONTENTION_STATS
+	xnvfile_destroy_regular(&lockstat_vfile);
+#endif /* XNLOCK_CONTENTION_STATS */
 #if XENO_DEBUG(XNLOCK)
 	xnvfile_destroy_regular(&lock_vfile);
 #endif /* XENO_DEBUG(XNLOCK) */
+#ifdef CONFIG_XENO_OPT_STATS
+#ifdef XNARCH_HAVE_MM_SWITCH_STATS
+	xnvfile_destroy_regular(&mmswitch_vfile);
+#endif /* XNARCH_HAVE_MM_SWITCH_STATS */
+	xnvfile_destroy_regular(&hooks_vfile);
+#endif /* CONFIG_XENO_OPT_STATS */
 	xnvfile_destroy_regular(&apc_vfile);
 	xnvfile_destroy_regular(&faults_vfile);
 	xnvfile_destroy_regular(&version_vfile);
+	xnvfile_destroy_regular(&gravity_vfile);
 	xnvfile_destroy_regular(&latency_vfile);
 
 	xnshadow_cleanup_proc();
@@ -0,0 +1,301 @@
+/*!\file nucleus/profile.c
+ * \brief Sampling profiler for the nucleus.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * \ingroup nucleus
+ */
+
+/*
+ * Linux profilers do not see threads running in primary mode, since
+ * the host timer interrupts are deferred while the real-time domain
+ * runs. Instead, a per-CPU nucleus timer samples the thread it
+ * preempts at a configurable rate, and logs its user-space PC and
+ * call chain into a per-CPU ring, which user-space may map the same
+ * way as the event tracer's (see nucleus/profile.h for the layout).
+ *
+ * Call chains are recovered by following the frame pointers of the
+ * sampled thread, within the bounds of the stack area it was mapped
+ * from. This is only attempted over locked memory, since taking a
+ * page fault from the timer interrupt is not an option.
+ */
+
+#include <linux/mm.h>
+#include <nucleus/pod.h>
+#include <nucleus/heap.h>
+#include <nucleus/vfile.h>
+#include <nucleus/profile.h>
+
+#define PROFILE_NR_RECS   (1U << CONFIG_XENO_OPT_PROFILE_SHIFT)
+#define PROFILE_MAX_DEPTH CONFIG_XENO_OPT_PROFILE_DEPTH
+#define PROFILE_MAX_FREQ  20000
+
+static struct xnheap profile_heap;
+
+static struct xnprofile_area *profile_area;
+
+/* Called on behalf of the mapped thread, from the Linux domain. */
+void xnprofile_attach(struct xnthread *thread)
+{
+#ifdef XNARCH_HAVE_USER_FRAMES
+	struct mm_struct *mm = current->mm;
+	struct vm_area_struct *vma;
+	unsigned long sp;
+
+	thread->u_stkend = 0;
+
+	if (!(mm->def_flags & VM_LOCKED))
+		return;
+
+	sp = xnarch_user_sp(task_pt_regs(current));
+
+	down_read(&mm->mmap_sem);
+	vma = find_vma(mm, sp);
+	if (vma && vma->vm_start <= sp)
+		thread->u_stkend = vma->vm_end;
+	up_read(&mm->mmap_sem);
+#endif /* XNARCH_HAVE_USER_FRAMES */
+}
+
+static unsigned int profile_user_chain(struct xnthread *thread,
+				       struct pt_regs *regs,
+				       unsigned long long *pcs)
+{
+	unsigned int depth = 0;
+#ifdef XNARCH_HAVE_USER_FRAMES
+	struct xnarch_user_frame frame;
+	unsigned long fp, addr, low;
+
+	if (thread->u_stkend == 0)
+		return 0;
+
+	low = xnarch_user_sp(regs);
+	fp = xnarch_user_fp(regs);
+
+	while (depth < PROFILE_MAX_DEPTH) {
+		addr = xnarch_user_frame_addr(fp);
+		/*
+		 * Frames must move up the stack, so that the walk
+		 * always terminates, and stay within the locked
+		 * stack area, so that it never faults.
+		 */
+		if (addr < low || addr + sizeof(frame) > thread->u_stkend ||
+		    (addr & (sizeof(long) - 1)) != 0)
+			break;
+		if (__xn_copy_from_user(&frame, (void __user *)addr,
+					sizeof(frame)))
+			break;
+		if (frame.ret == 0)
+			break;
+		pcs[depth++] = frame.ret;
+		low = addr + sizeof(frame);
+		fp = frame.next;
+	}
+#endif /* XNARCH_HAVE_USER_FRAMES */
+
+	return depth;
+}
+
+/* Timer handler, nklock held, interrupts off. */
+void xnprofile_tick(struct xntimer *timer)
+{
+	struct xnsched *sched = xnpod_current_sched();
+	struct xnthread *thread = sched->curr;
+	struct xnprofile_ring *ring;
+	struct xnprofile_rec *rec;
+	struct task_struct *p;
+	struct pt_regs *regs;
+	unsigned int head;
+
+	ring = xnprofile_ring(profile_area, xnsched_cpu(sched));
+	head = ring->head;
+	rec = xnprofile_rec(profile_area, ring, head);
+	rec->tsc = xnarch_get_cpu_tsc();
+	rec->thread = xnthread_handle(thread);
+	rec->pid = 0;
+	rec->depth = 0;
+	strncpy(rec->name, xnthread_name(thread), sizeof(rec->name));
+
+	if (xnthread_test_state(thread, XNROOT))
+		rec->flags = XNPROFILE_ROOT;
+	else if (!xnthread_test_state(thread, XNSHADOW) ||
+		 (p = xnthread_user_task(thread)) == NULL)
+		rec->flags = XNPROFILE_KERNEL;
+	else {
+		/*
+		 * A shadow in primary mode is either running
+		 * user code, or a syscall entered from it: in both
+		 * cases, its user-space context is the one saved
+		 * upon the last kernel entry.
+		 */
+		regs = task_pt_regs(p);
+		rec->flags = 0;
+		rec->pid = xnthread_user_pid(thread);
+		rec->pcs[0] = instruction_pointer(regs);
+		rec->depth = 1 + profile_user_chain(thread, regs, rec->pcs + 1);
+	}
+
+	/* Publish the record before the new head. */
+	xnarch_write_memory_barrier();
+	ring->head = head + 1;
+}
+
+static int profile_set_frequency(unsigned int freq)
+{
+	struct xnsched *sched;
+	xnticks_t period;
+	int cpu;
+	spl_t s;
+
+	if (freq > PROFILE_MAX_FREQ)
+		return -EINVAL;
+
+	period = freq ? xnarch_ulldiv(1000000000ULL, freq, NULL) : 0;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	/* Sampling timers vanish with the scheduler slots. */
+	if (!xnpod_active_p()) {
+		xnlock_put_irqrestore(&nklock, s);
+		if (freq)
+			return -ENODEV;
+		profile_area->frequency = 0;
+		return 0;
+	}
+
+	for (cpu = 0; cpu < xnarch_num_online_cpus(); cpu++) {
+		if (!xnarch_cpu_supported(cpu))
+			continue;
+		sched = xnpod_sched_slot(cpu);
+		if (period)
+			xntimer_start(&sched->proftimer, period, period,
+				      XN_RELATIVE);
+		else
+			xntimer_stop(&sched->proftimer);
+	}
+
+	profile_area->frequency = freq;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+
+struct xnheap *xnprofile_heap(void)
+{
+	return profile_area ? &profile_heap : NULL;
+}
+
+#ifdef CONFIG_XENO_OPT_VFILE
+
+static int profile_vfile_show(struct xnvfile_regular_iterator *it, void *data)
+{
+	xnvfile_printf(it, "frequency: %u\n", profile_area->frequency);
+	xnvfile_printf(it, "cpus: %u\n", profile_area->nr_cpus);
+	xnvfile_printf(it, "records: %u\n", profile_area->nr_recs);
+	xnvfile_printf(it, "depth: %u\n", profile_area->max_depth);
+	xnvfile_printf(it, "offset: %lu\n",
+		       xnheap_mapped_offset(&profile_heap, profile_area));
+	xnvfile_printf(it, "heapsize: %lu\n",
+		       (unsigned long)xnheap_extentsize(&profile_heap));
+
+	return 0;
+}
+
+static ssize_t profile_vfile_store(struct xnvfile_input *input)
+{
+	ssize_t ret;
+	long val;
+	int err;
+
+	ret = xnvfile_get_integer(input, &val);
+	if (ret < 0)
+		return ret;
+
+	if (val < 0)
+		return -EINVAL;
+
+	err = profile_set_frequency(val);
+	if (err)
+		return err;
+
+	return ret;
+}
+
+static struct xnvfile_regular_ops profile_vfile_ops = {
+	.show = profile_vfile_show,
+	.store = profile_vfile_store,
+};
+
+static struct xnvfile_regular profile_vfile = {
+	.ops = &profile_vfile_ops,
+};
+
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+int xnprofile_mount(void)
+{
+	unsigned int rec_size, ring_size;
+	size_t size;
+	int ret;
+
+	rec_size = sizeof(struct xnprofile_rec) +
+		(PROFILE_MAX_DEPTH + 1) * sizeof(unsigned long long);
+	ring_size = sizeof(struct xnprofile_ring) + PROFILE_NR_RECS * rec_size;
+	size = sizeof(struct xnprofile_area) + ring_size * XNARCH_NR_CPUS;
+
+	ret = xnheap_init_mapped(&profile_heap,
+				 xnheap_rounded_size(size, PAGE_SIZE),
+				 XNARCH_SHARED_HEAP_FLAGS);
+	if (ret)
+		return ret;
+
+	xnheap_set_label(&profile_heap, "profiler");
+
+	profile_area = xnheap_alloc(&profile_heap, size);
+	if (profile_area == NULL) {
+		xnheap_destroy_mapped(&profile_heap, NULL, NULL);
+		return -ENOMEM;
+	}
+
+	memset(profile_area, 0, size);
+	profile_area->nr_cpus = XNARCH_NR_CPUS;
+	profile_area->nr_recs = PROFILE_NR_RECS;
+	profile_area->rec_size = rec_size;
+	profile_area->ring_size = ring_size;
+	profile_area->max_depth = PROFILE_MAX_DEPTH;
+	profile_area->tsc_freq = xnarch_get_cpu_freq();
+	xnarch_write_memory_barrier();
+	profile_area->magic = XNPROFILE_MAGIC;
+
+#ifdef CONFIG_XENO_OPT_VFILE
+	xnvfile_init_regular("profile", &profile_vfile, &nkvfroot);
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+	return 0;
+}
+
+void xnprofile_umount(void)
+{
+#ifdef CONFIG_XENO_OPT_VFILE
+	xnvfile_destroy_regular(&profile_vfile);
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+	profile_set_frequency(0);
+	xnheap_free(&profile_heap, profile_area);
+	profile_area = NULL;
+	xnheap_destroy_mapped(&profile_heap, NULL, NULL);
+}
@@ -41,11 +41,16 @@
 #include <nucleus/registry.h>
 #include <nucleus/thread.h>
 #include <nucleus/assert.h>
+#include <nucleus/jhash.h>
 
 #ifndef CONFIG_XENO_OPT_DEBUG_REGISTRY
 #define CONFIG_XENO_OPT_DEBUG_REGISTRY  0
 #endif
 
+#if CONFIG_XENO_OPT_REGISTRY_NRSLOTS > (1 << XNOBJECT_SLOT_BITS)
+#error "CONFIG_XENO_OPT_REGISTRY_NRSLOTS too large for the handle layout"
+#endif
+
 struct xnobject *registry_obj_slots;
 EXPORT_SYMBOL_GPL(registry_obj_slots);
 
@@ -55,12 +60,26 @@ static struct xnqueue registry_obj_busyq;	/* Active and exported objects. */
 
 static u_long registry_obj_stamp;
 
+/*
+ * The number of registered objects is bounded by the slot count, so
+ * the hash table is sized from it once and for all: one bucket per
+ * slot rounded up to a power of two keeps chains short even when
+ * every slot is in use, without ever rehashing under nklock nor
+ * allocating memory from primary mode.
+ */
 static struct xnobject **registry_hash_table;
 
-static int registry_hash_entries;
+static unsigned int registry_hash_entries;
 
 static struct xnsynch registry_hash_synch;
 
+static inline xnhandle_t registry_next_handle(struct xnobject *object)
+{
+	xnhandle_t gen = (object->handle + (1UL << XNOBJECT_SLOT_BITS));
+
+	return (gen & XNOBJECT_GEN_MASK) | (object->handle & XNOBJECT_SLOT_MASK);
+}
+
 #ifdef CONFIG_XENO_OPT_VFILE
 
 #include <linux/workqueue.h>
@@ -73,6 +92,23 @@ static void registry_proc_schedule(void *cookie);
 
 static xnqueue_t registry_obj_procq;	/* Objects waiting for /proc handling. */
 
+static xnqueue_t registry_obj_lazyq;	/* Objects waiting for an export request. */
+
+/*
+ * Creating the /proc entries of thousands of objects keeps the Linux
+ * side busy for a long time. Exports may be deferred until
+ * explicitly requested by writing to /proc/xenomai/registry/export,
+ * or disabled entirely.
+ */
+#define REGISTRY_EXPORT_NEVER	0
+#define REGISTRY_EXPORT_EAGER	1
+#define REGISTRY_EXPORT_LAZY	2
+
+static int registry_export_arg = REGISTRY_EXPORT_EAGER;
+module_param_named(registry_export, registry_export_arg, int, 0444);
+MODULE_PARM_DESC(registry_export,
+		 "Export registry objects to /proc: 0=never, 1=on creation (default), 2=on request");
+
 static DECLARE_WORK_NODATA(registry_proc_work, &registry_proc_callback);
 
 static int registry_proc_apc;
@@ -81,14 +117,40 @@ static struct xnvfile_directory registry_vfroot;
 
 static int usage_vfile_show(struct xnvfile_regular_iterator *it, void *data)
 {
+	unsigned int n, len, nonempty = 0, maxchain = 0;
+	struct xnobject *ecurr;
+	spl_t s;
+
 	if (!xnpod_active_p())
 		return -ESRCH;
 
-	xnvfile_printf(it, "slots=%u:used=%u:exported=%u\n",
+	/*
+	 * Scan the hash table by small batches so as not to hold
+	 * nklock for too long; the figures are only indicative.
+	 */
+	xnlock_get_irqsave(&nklock, s);
+
+	for (n = 0; n < registry_hash_entries; n++) {
+		for (ecurr = registry_hash_table[n], len = 0;
+		     ecurr; ecurr = ecurr->hnext)
+			len++;
+		if (len > 0)
+			nonempty++;
+		if (len > maxchain)
+			maxchain = len;
+		if ((n & 63) == 63)
+			xnlock_sync_irq(&nklock, s);
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	xnvfile_printf(it, "slots=%u:used=%u:exported=%u"
+		       ":buckets=%u:nonempty=%u:maxchain=%u\n",
 		       CONFIG_XENO_OPT_REGISTRY_NRSLOTS,
 		       CONFIG_XENO_OPT_REGISTRY_NRSLOTS -
 		       countq(&registry_obj_freeq),
-		       registry_exported_objects);
+		       registry_exported_objects,
+		       registry_hash_entries, nonempty, maxchain);
 	return 0;
 }
 
@@ -100,19 +162,66 @@ static struct xnvfile_regular usage_vfile = {
 	.ops = &usage_vfile_ops,
 };
 
-#endif /* CONFIG_XENO_OPT_VFILE */
+static int export_vfile_show(struct xnvfile_regular_iterator *it, void *data)
+{
+	xnvfile_printf(it, "mode=%d:pending=%d\n",
+		       registry_export_arg, countq(&registry_obj_lazyq));
+	return 0;
+}
 
-int xnregistry_init(void)
+/*
+ * Hand all objects pending export over to the lower stage, and wait
+ * for their /proc entries to be created.
+ */
+static ssize_t export_vfile_store(struct xnvfile_input *input)
 {
-	static const int primes[] = {
-		101, 211, 307, 401, 503, 601,
-		701, 809, 907, 1009, 1103
-	};
+	struct xnholder *holder;
+	struct xnobject *object;
+	ssize_t ret;
+	long val;
+	int n = 0;
+	spl_t s;
+
+	ret = xnvfile_get_integer(input, &val);
+	if (ret < 0)
+		return ret;
+
+	if (val == 0)
+		return ret;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	while ((holder = getq(&registry_obj_lazyq)) != NULL) {
+		object = link2xnobj(holder);
+		object->vfilp = XNOBJECT_PNODE_RESERVED1;
+		appendq(&registry_obj_procq, holder);
+		if ((++n & 63) == 0)
+			xnlock_sync_irq(&nklock, s);
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (n > 0) {
+		schedule_work(&registry_proc_work);
+		flush_scheduled_work();
+	}
+
+	return ret;
+}
+
+static struct xnvfile_regular_ops export_vfile_ops = {
+	.show = export_vfile_show,
+	.store = export_vfile_store,
+};
+
+static struct xnvfile_regular export_vfile = {
+	.ops = &export_vfile_ops,
+};
 
-#define obj_hash_max(n)			 \
-((n) < sizeof(primes) / sizeof(int) ? \
- (n) : sizeof(primes) / sizeof(int) - 1)
+#endif /* CONFIG_XENO_OPT_VFILE */
 
+int xnregistry_init(void)
+{
 	int n, ret;
 
 	registry_obj_slots =
@@ -131,16 +240,25 @@ int xnregistry_init(void)
 		return ret;
 	}
 
+	ret = xnvfile_init_regular("export", &export_vfile, &registry_vfroot);
+	if (ret) {
+		xnvfile_destroy_regular(&usage_vfile);
+		xnvfile_destroy_dir(&registry_vfroot);
+		return ret;
+	}
+
 	registry_proc_apc =
 	    rthal_apc_alloc("registry_export", &registry_proc_schedule, NULL);
 
 	if (registry_proc_apc < 0) {
+		xnvfile_destroy_regular(&export_vfile);
 		xnvfile_destroy_regular(&usage_vfile);
 		xnvfile_destroy_dir(&registry_vfroot);
 		return registry_proc_apc;
 	}
 
 	initq(&registry_obj_procq);
+	initq(&registry_obj_lazyq);
 #endif /* CONFIG_XENO_OPT_VFILE */
 
 	initq(&registry_obj_freeq);
@@ -150,18 +268,21 @@ int xnregistry_init(void)
 	for (n = 0; n < CONFIG_XENO_OPT_REGISTRY_NRSLOTS; n++) {
 		inith(&registry_obj_slots[n].link);
 		registry_obj_slots[n].objaddr = NULL;
+		registry_obj_slots[n].handle = n;
 		appendq(&registry_obj_freeq, &registry_obj_slots[n].link);
 	}
 
 	getq(&registry_obj_freeq);	/* Slot #0 is reserved/invalid. */
 
-	registry_hash_entries =
-	    primes[obj_hash_max(CONFIG_XENO_OPT_REGISTRY_NRSLOTS / 100)];
+	registry_hash_entries = 1;
+	while (registry_hash_entries < CONFIG_XENO_OPT_REGISTRY_NRSLOTS)
+		registry_hash_entries <<= 1;
 	registry_hash_table = xnarch_alloc_host_mem(sizeof(struct xnobject *) *
 						    registry_hash_entries);
 
 	if (registry_hash_table == NULL) {
 #ifdef CONFIG_XENO_OPT_VFILE
+		xnvfile_destroy_regular(&export_vfile);
 		xnvfile_destroy_regular(&usage_vfile);
 		xnvfile_destroy_dir(&registry_vfroot);
 		rthal_apc_free(registry_proc_apc);
@@ -190,7 +311,8 @@ void xnregistry_cleanup(void)
 		for (ecurr = registry_hash_table[n]; ecurr; ecurr = enext) {
 			enext = ecurr->hnext;
 			pnode = ecurr->pnode;
-			if (pnode == NULL)
+			if (pnode == NULL ||
+			    ecurr->vfilp == XNOBJECT_PNODE_RESERVED3)
 				continue;
 
 			pnode->ops->unexport(ecurr, pnode);
@@ -213,6 +335,7 @@ void xnregistry_cleanup(void)
 #ifdef CONFIG_XENO_OPT_VFILE
 	rthal_apc_free(registry_proc_apc);
 	flush_scheduled_work();
+	xnvfile_destroy_regular(&export_vfile);
 	xnvfile_destroy_regular(&usage_vfile);
 	xnvfile_destroy_dir(&registry_vfroot);
 #endif /* CONFIG_XENO_OPT_VFILE */
@@ -475,6 +598,17 @@ EXPORT_SYMBOL_GPL(xnregistry_vlink_ops);
 static inline void registry_export_pnode(struct xnobject *object,
 					 struct xnpnode *pnode)
 {
+	switch (registry_export_arg) {
+	case REGISTRY_EXPORT_NEVER:
+		return;
+	case REGISTRY_EXPORT_LAZY:
+		object->vfilp = XNOBJECT_PNODE_RESERVED3;
+		object->pnode = pnode;
+		removeq(&registry_obj_busyq, &object->link);
+		appendq(&registry_obj_lazyq, &object->link);
+		return;
+	}
+
 	object->vfilp = XNOBJECT_PNODE_RESERVED1;
 	object->pnode = pnode;
 	removeq(&registry_obj_busyq, &object->link);
@@ -484,7 +618,13 @@ static inline void registry_export_pnode(struct xnobject *object,
 
 static inline void registry_unexport_pnode(struct xnobject *object)
 {
-	if (object->vfilp != XNOBJECT_PNODE_RESERVED1) {
+	if (object->vfilp == XNOBJECT_PNODE_RESERVED3) {
+		/* Never exported, drop the pending request. */
+		removeq(&registry_obj_lazyq, &object->link);
+		appendq(&registry_obj_busyq, &object->link);
+		object->pnode = NULL;
+		object->vfilp = NULL;
+	} else if (object->vfilp != XNOBJECT_PNODE_RESERVED1) {
 		/*
 		 * We might have preempted a v-file read op, so bump
 		 * the object's revtag to make sure the data
@@ -511,35 +651,29 @@ static inline void registry_unexport_pnode(struct xnobject *object)
 
 #endif /* CONFIG_XENO_OPT_VFILE */
 
-static unsigned registry_hash_crunch(const char *key)
+static inline unsigned int registry_hash_crunch(const char *key)
 {
-	unsigned int h = 0, g;
-
-#define HQON    24		/* Higher byte position */
-#define HBYTE   0xf0000000	/* Higher nibble on */
-
-	while (*key) {
-		h = (h << 4) + *key++;
-		if ((g = (h & HBYTE)) != 0)
-			h = (h ^ (g >> HQON)) ^ g;
-	}
-
-	return h % registry_hash_entries;
+	return jhash(key, strlen(key), 0);
 }
 
+#define registry_hash_bucket(h)	((h) & (registry_hash_entries - 1))
+
 static inline int registry_hash_enter(const char *key, struct xnobject *object)
 {
 	struct xnobject *ecurr;
-	unsigned s;
+	unsigned int h, s;
 
-	object->key = key;
-	s = registry_hash_crunch(key);
+	h = registry_hash_crunch(key);
+	s = registry_hash_bucket(h);
 
 	for (ecurr = registry_hash_table[s]; ecurr != NULL; ecurr = ecurr->hnext) {
-		if (ecurr == object || !strcmp(key, ecurr->key))
+		if (ecurr == object ||
+		    (ecurr->hash == h && !strcmp(key, ecurr->key)))
 			return -EEXIST;
 	}
 
+	object->key = key;
+	object->hash = h;
 	object->hnext = registry_hash_table[s];
 	registry_hash_table[s] = object;
 
@@ -548,7 +682,7 @@ static inline int registry_hash_enter(const char *key, struct xnobject *object)
 
 static inline int registry_hash_remove(struct xnobject *object)
 {
-	unsigned s = registry_hash_crunch(object->key);
+	unsigned int s = registry_hash_bucket(object->hash);
 	struct xnobject *ecurr, *eprev;
 
 	for (ecurr = registry_hash_table[s], eprev = NULL;
@@ -568,11 +702,12 @@ static inline int registry_hash_remove(struct xnobject *object)
 
 static struct xnobject *registry_hash_find(const char *key)
 {
+	unsigned int h = registry_hash_crunch(key);
 	struct xnobject *ecurr;
 
-	for (ecurr = registry_hash_table[registry_hash_crunch(key)];
+	for (ecurr = registry_hash_table[registry_hash_bucket(h)];
 	     ecurr != NULL; ecurr = ecurr->hnext) {
-		if (!strcmp(key, ecurr->key))
+		if (ecurr->hash == h && !strcmp(key, ecurr->key))
 			return ecurr;
 	}
 
@@ -681,9 +816,10 @@ int xnregistry_enter(const char *key, void *objaddr,
 #ifdef CONFIG_XENO_OPT_VFILE
 	object->pnode = NULL;
 #endif
+	xnarch_write_memory_barrier();
 	if (*key == '\0') {
 		object->key = NULL;
-		*phandle = object - registry_obj_slots;
+		*phandle = object->handle;
 		ret = 0;
 		goto unlock_and_exit;
 	}
@@ -700,7 +836,7 @@ int xnregistry_enter(const char *key, void *objaddr,
 	 * <!> Make sure the handle is written back before the
 	 * rescheduling takes place.
 	 */
-	*phandle = object - registry_obj_slots;
+	*phandle = object->handle;
 
 #ifdef CONFIG_XENO_OPT_VFILE
 	if (pnode)
@@ -821,7 +957,7 @@ int xnregistry_bind(const char *key, xnticks_t timeout, int timeout_mode,
 		object = registry_hash_find(key);
 
 		if (object) {
-			*phandle = object - registry_obj_slots;
+			*phandle = object->handle;
 			goto unlock_and_exit;
 		}
 
@@ -902,6 +1038,12 @@ int xnregistry_remove(xnhandle_t handle)
 			  object->pnode->dirname);
 #endif
 
+	/*
+	 * Retire the current handle before clearing objaddr, lockless
+	 * readers depend on this ordering.
+	 */
+	object->handle = registry_next_handle(object);
+	xnarch_write_memory_barrier();
 	object->objaddr = NULL;
 	object->cstamp = 0;
 
@@ -1193,7 +1335,9 @@ EXPORT_SYMBOL_GPL(xnregistry_put);
  * @brief Find a real-time object into the registry.
  *
  * This service retrieves an object from its handle into the registry
- * and returns the memory address of its descriptor.
+ * and returns the memory address of its descriptor. The lookup does
+ * not grab the nucleus lock; a handle to an object which has been
+ * removed meanwhile is detected, even if its slot has been reused.
  *
  * @param handle The generic handle of the object to fetch. If
  * XNOBJECT_SELF is passed, the object is the calling Xenomai thread.
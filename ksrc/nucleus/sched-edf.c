@@ -0,0 +1,637 @@
+/*!\file sched-edf.c
+ * \brief Earliest-deadline-first scheduling class.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * \ingroup sched
+ */
+
+#include <nucleus/pod.h>
+
+/*
+ * Each member of the EDF class is a hard constant bandwidth server
+ * (CBS): it may consume up to param.runtime nanoseconds of CPU time
+ * before its current deadline. When the budget is exhausted, the
+ * thread is throttled, i.e. kept out of the runqueue until that
+ * deadline, at which point the budget is refilled and the deadline
+ * postponed by one period. This bounds the CPU share of every
+ * thread to runtime/period, regardless of its actual behaviour.
+ *
+ * A throttled thread keeps its XNREADY bit if it was runnable; only
+ * its presence in the runqueue reflects the throttling. We track the
+ * latter explicitly with pedf->queued. A thread undergoing a PIP
+ * boost is queued regardless of its budget, so that it may release
+ * the resource the booster waits for.
+ */
+
+#define EDF_BW_LIMIT \
+	((CONFIG_XENO_OPT_SCHED_EDF_BWLIMIT * XNSCHED_EDF_BW_UNIT) / 100)
+
+static inline int edf_earlier_p(xnticks_t d1, xnticks_t d2)
+{
+	return (xnsticks_t)(d1 - d2) < 0;
+}
+
+/*
+ * A thread only consumes its budget while running as a member of
+ * its own class. Execution time spent under a PIP boost is not
+ * charged, so that the boosted thread may release the resource the
+ * booster waits for asap.
+ */
+static inline int edf_metered_p(struct xnthread *thread)
+{
+	return thread->sched_class == &xnsched_class_edf &&
+		!xnthread_test_state(thread, XNBOOST);
+}
+
+static void edf_insert(struct xnthread *thread, int lifo)
+{
+	struct xnqueue *q = &thread->sched->edf.runnable;
+	xnticks_t deadline = thread->edf_deadline;
+	struct xnthread *pos;
+	struct xnholder *h;
+	xnsticks_t delta;
+
+	/*
+	 * Threads with equal deadlines are queued in FIFO order,
+	 * except for preempted threads which go back to the head of
+	 * their group.
+	 */
+	for (h = getheadq(q); h; h = nextq(q, h)) {
+		pos = link2thread(h, rlink.plink);
+		delta = (xnsticks_t)(pos->edf_deadline - deadline);
+		if (delta > 0 || (lifo && delta == 0)) {
+			insertq(q, h, &thread->rlink.plink);
+			goto out;
+		}
+	}
+
+	appendq(q, &thread->rlink.plink);
+out:
+	if (thread->pedf)
+		thread->pedf->queued = 1;
+}
+
+static void edf_remove(struct xnthread *thread)
+{
+	removeq(&thread->sched->edf.runnable, &thread->rlink.plink);
+	if (thread->pedf)
+		thread->pedf->queued = 0;
+}
+
+static void edf_set_deadline(struct xnthread *thread, xnticks_t deadline)
+{
+	struct xnsched_edf_data *pedf = thread->pedf;
+
+	pedf->deadline = deadline;
+
+	/* Keep an inherited deadline until the boost ends. */
+	if (xnthread_test_state(thread, XNBOOST))
+		return;
+
+	if (pedf->queued) {
+		edf_remove(thread);
+		thread->edf_deadline = deadline;
+		edf_insert(thread, 0);
+	} else
+		thread->edf_deadline = deadline;
+}
+
+static void edf_replenish(struct xnthread *thread, xnticks_t now)
+{
+	struct xnsched_edf_data *pedf = thread->pedf;
+	xnticks_t deadline = pedf->deadline + pedf->param.period;
+
+	if (!edf_earlier_p(now, deadline))
+		deadline = now + pedf->param.period;
+
+	pedf->budget = pedf->param.runtime;
+	edf_set_deadline(thread, deadline);
+}
+
+static void edf_throttle(struct xnthread *thread)
+{
+	struct xnsched_edf_data *pedf = thread->pedf;
+	xnticks_t now = xnpod_get_cpu_time();
+
+	pedf->throttles++;
+
+	/*
+	 * Replenish right away if we are already past the current
+	 * deadline, there is no point in holding the thread.
+	 */
+	if (!edf_earlier_p(now, pedf->deadline) ||
+	    xntimer_start(&pedf->repl_timer, pedf->deadline,
+			  XN_INFINITE, XN_ABSOLUTE) == -ETIMEDOUT) {
+		edf_replenish(thread, now);
+		return;
+	}
+
+	pedf->throttled = 1;
+	if (pedf->queued && !xnthread_test_state(thread, XNBOOST))
+		edf_remove(thread);
+
+	xnsched_set_resched(thread->sched);
+}
+
+static void edf_replenish_handler(struct xntimer *timer)
+{
+	struct xnsched_edf_data *pedf;
+	struct xnthread *thread;
+
+	pedf = container_of(timer, struct xnsched_edf_data, repl_timer);
+	thread = pedf->thread;
+	pedf->throttled = 0;
+	edf_replenish(thread, xnpod_get_cpu_time());
+
+	/*
+	 * Put the thread back into the runqueue if it is runnable,
+	 * unless a PIP boost kept it there, or moved it to another
+	 * class.
+	 */
+	if (xnthread_test_state(thread, XNREADY) && !pedf->queued &&
+	    thread->sched_class == &xnsched_class_edf)
+		edf_insert(thread, 0);
+
+	xnsched_set_resched(thread->sched);
+}
+
+static void edf_drop_handler(struct xntimer *timer)
+{
+	struct xnsched_edf_data *pedf;
+
+	pedf = container_of(timer, struct xnsched_edf_data, drop_timer);
+	pedf->budget = 0;
+	pedf->running = 0;
+	edf_throttle(pedf->thread);
+}
+
+static void edf_start_metering(struct xnthread *thread)
+{
+	struct xnsched_edf_data *pedf = thread->pedf;
+	xnticks_t now = xnpod_get_cpu_time();
+
+	pedf->run_start = now;
+	pedf->running = 1;
+	/*
+	 * If the drop date is already behind us, the overrun will be
+	 * charged when the thread is switched out.
+	 */
+	xntimer_start(&pedf->drop_timer, now + pedf->budget,
+		      XN_INFINITE, XN_ABSOLUTE);
+}
+
+static void edf_stop_metering(struct xnthread *thread)
+{
+	struct xnsched_edf_data *pedf = thread->pedf;
+	xnticks_t elapsed;
+
+	xntimer_stop(&pedf->drop_timer);
+	pedf->running = 0;
+
+	elapsed = xnpod_get_cpu_time() - pedf->run_start;
+	if (elapsed < pedf->budget) {
+		pedf->budget -= elapsed;
+		return;
+	}
+
+	pedf->budget = 0;
+	edf_throttle(thread);
+}
+
+static void xnsched_edf_init(struct xnsched *sched)
+{
+	initq(&sched->edf.runnable);
+	sched->edf.bw = 0;
+}
+
+static void xnsched_edf_setparam(struct xnthread *thread,
+				 const union xnsched_policy_param *p)
+{
+	struct xnsched_edf_data *pedf = thread->pedf;
+	unsigned long bw;
+
+	if (pedf->running) {
+		xntimer_stop(&pedf->drop_timer);
+		pedf->running = 0;
+	}
+
+	xntimer_stop(&pedf->repl_timer);
+	pedf->throttled = 0;
+
+	bw = xnarch_div64(p->edf.runtime << XNSCHED_EDF_BW_SHIFT,
+			  p->edf.period);
+	thread->sched->edf.bw += bw - pedf->bw;
+	pedf->bw = bw;
+	pedf->param = p->edf;
+	pedf->budget = p->edf.runtime;
+	pedf->deadline = xnpod_get_cpu_time() + p->edf.period;
+	/* We are called with the thread unlinked from any runqueue. */
+	thread->edf_deadline = pedf->deadline;
+
+	if (xnthread_test_state(thread, XNSHADOW))
+		xnthread_clear_state(thread, XNOTHER);
+	thread->cprio = p->edf.prio;
+
+	if (thread == thread->sched->curr)
+		edf_start_metering(thread);
+}
+
+static void xnsched_edf_getparam(struct xnthread *thread,
+				 union xnsched_policy_param *p)
+{
+	/*
+	 * We may be asked for the parameters of a thread from
+	 * another class which currently inherits EDF scheduling,
+	 * e.g. to propagate a PIP boost further.
+	 */
+	if (thread->pedf)
+		p->edf = thread->pedf->param;
+	else {
+		p->edf.runtime = 0;
+		p->edf.period = 0;
+	}
+	p->edf.prio = thread->cprio;
+	p->edf.deadline = thread->edf_deadline;
+}
+
+static void xnsched_edf_trackprio(struct xnthread *thread,
+				  const union xnsched_policy_param *p)
+{
+	xnticks_t deadline;
+
+	if (p == NULL) {
+		thread->cprio = thread->bprio;
+		thread->edf_deadline = thread->pedf->deadline;
+		return;
+	}
+
+	/*
+	 * Inherit the deadline of the booster, unless our own one
+	 * comes earlier.
+	 */
+	deadline = p->edf.deadline;
+	if (thread->pedf && edf_earlier_p(thread->pedf->deadline, deadline))
+		deadline = thread->pedf->deadline;
+
+	thread->cprio = p->edf.prio;
+	thread->edf_deadline = deadline;
+}
+
+static int xnsched_edf_chkparam(struct xnthread *thread,
+				const union xnsched_policy_param *p)
+{
+	unsigned long bw, oldbw = 0;
+
+	/* Budgets are accounted in nanoseconds. */
+	if (xntbase_periodic_p(xnthread_time_base(thread)))
+		return -EINVAL;
+
+	if (p->edf.prio < XNSCHED_RT_MIN_PRIO ||
+	    p->edf.prio > XNSCHED_RT_MAX_PRIO)
+		return -EINVAL;
+
+	if (p->edf.runtime == 0 || p->edf.period < p->edf.runtime)
+		return -EINVAL;
+
+	bw = xnarch_div64(p->edf.runtime << XNSCHED_EDF_BW_SHIFT,
+			  p->edf.period);
+
+	if (thread->base_class == &xnsched_class_edf)
+		oldbw = thread->pedf->bw;
+
+	if (thread->sched->edf.bw - oldbw + bw > EDF_BW_LIMIT)
+		return -EBUSY;
+
+	return 0;
+}
+
+static int xnsched_edf_declare(struct xnthread *thread,
+			       const union xnsched_policy_param *p)
+{
+	struct xnsched_edf_data *pedf;
+	struct xntbase *tbase;
+
+	pedf = xnmalloc(sizeof(*pedf));
+	if (pedf == NULL)
+		return -ENOMEM;
+
+	tbase = xnthread_time_base(thread);
+	xntimer_init(&pedf->drop_timer, tbase, edf_drop_handler);
+	xntimer_set_name(&pedf->drop_timer, "edf-drop");
+	xntimer_set_sched(&pedf->drop_timer, thread->sched);
+	xntimer_init(&pedf->repl_timer, tbase, edf_replenish_handler);
+	xntimer_set_name(&pedf->repl_timer, "edf-replenish");
+	xntimer_set_sched(&pedf->repl_timer, thread->sched);
+
+	pedf->bw = 0;	/* Reserved by xnsched_edf_setparam(). */
+	pedf->running = 0;
+	pedf->throttled = 0;
+	pedf->queued = 0;
+	pedf->throttles = 0;
+	pedf->thread = thread;
+	thread->pedf = pedf;
+	/*
+	 * As with temporal partitioning, the root thread could not
+	 * carry a deadline on behalf of a relaxed EDF thread, so
+	 * priority coupling is pointless.
+	 */
+	xnthread_set_state(thread, XNRPIOFF);
+
+	return 0;
+}
+
+static void xnsched_edf_forget(struct xnthread *thread)
+{
+	struct xnsched_edf_data *pedf = thread->pedf;
+
+	thread->sched->edf.bw -= pedf->bw;
+	xntimer_destroy(&pedf->drop_timer);
+	xntimer_destroy(&pedf->repl_timer);
+	xnfree(pedf);
+	thread->pedf = NULL;
+}
+
+static void xnsched_edf_enqueue(struct xnthread *thread)
+{
+	struct xnsched_edf_data *pedf = thread->pedf;
+	xnticks_t now, slack;
+
+	if (pedf == NULL) {
+		edf_insert(thread, 0);
+		return;
+	}
+
+	if (pedf->throttled && !xnthread_test_state(thread, XNBOOST))
+		return;
+
+	/*
+	 * CBS wakeup rule: if the remaining budget could not be
+	 * consumed before the current deadline without exceeding the
+	 * reserved bandwidth, start a fresh period.
+	 */
+	if (!pedf->running && !pedf->throttled &&
+	    !xnthread_test_state(thread, XNBOOST)) {
+		now = xnpod_get_cpu_time();
+		if (!edf_earlier_p(now, pedf->deadline))
+			slack = 0;
+		else
+			slack = ((pedf->deadline - now) * pedf->bw) >>
+				XNSCHED_EDF_BW_SHIFT;
+		if (pedf->budget > slack) {
+			pedf->budget = pedf->param.runtime;
+			pedf->deadline = now + pedf->param.period;
+			thread->edf_deadline = pedf->deadline;
+		}
+	}
+
+	edf_insert(thread, 0);
+}
+
+static void xnsched_edf_dequeue(struct xnthread *thread)
+{
+	if (thread->pedf == NULL || thread->pedf->queued)
+		edf_remove(thread);
+}
+
+static void xnsched_edf_requeue(struct xnthread *thread)
+{
+	struct xnsched_edf_data *pedf = thread->pedf;
+
+	if (pedf == NULL || !pedf->throttled ||
+	    xnthread_test_state(thread, XNBOOST))
+		edf_insert(thread, 1);
+}
+
+struct xnthread *xnsched_edf_pick(struct xnsched *sched)
+{
+	struct xnqueue *q = &sched->edf.runnable;
+	struct xnthread *curr = sched->curr, *next;
+	struct xnholder *h;
+
+	h = getheadq(q);
+	next = h ? link2thread(h, rlink.plink) : NULL;
+
+	/*
+	 * Charge the outgoing thread for the time it consumed, unless
+	 * it keeps running on its own budget. This may throttle it,
+	 * in which case it leaves the runqueue.
+	 */
+	if (curr->pedf && curr->pedf->running &&
+	    (curr != next || !edf_metered_p(curr))) {
+		edf_stop_metering(curr);
+		h = getheadq(q);
+		next = h ? link2thread(h, rlink.plink) : NULL;
+	}
+
+	if (next == NULL)
+		return NULL;
+
+	edf_remove(next);
+
+	if (next->pedf && !next->pedf->running && edf_metered_p(next))
+		edf_start_metering(next);
+
+	return next;
+}
+
+static void xnsched_edf_migrate(struct xnthread *thread, struct xnsched *sched)
+{
+	struct xnsched_edf_data *pedf = thread->pedf;
+	union xnsched_policy_param param;
+
+	if (pedf == NULL)
+		return;
+	/*
+	 * The bandwidth reserved for the thread moves along with it.
+	 * If the remote CPU cannot accommodate it, downgrade the
+	 * thread to the RT class, as TP does. A subsequent call to
+	 * xnsched_set_policy() may move it back to EDF scheduling.
+	 */
+	if (sched->edf.bw + pedf->bw > EDF_BW_LIMIT) {
+		param.rt.prio = thread->cprio;
+		xnsched_set_policy(thread, &xnsched_class_rt, &param);
+		return;
+	}
+
+	thread->sched->edf.bw -= pedf->bw;
+	sched->edf.bw += pedf->bw;
+	xntimer_set_sched(&pedf->drop_timer, sched);
+	xntimer_set_sched(&pedf->repl_timer, sched);
+}
+
+#ifdef CONFIG_XENO_OPT_VFILE
+
+struct xnvfile_directory sched_edf_vfroot;
+
+struct vfile_sched_edf_priv {
+	struct xnholder *curr;
+	xnticks_t now;
+};
+
+struct vfile_sched_edf_data {
+	int cpu;
+	pid_t pid;
+	char name[XNOBJECT_NAME_LEN];
+	int prio;
+	int throttled;
+	xnticks_t runtime;
+	xnticks_t period;
+	xnticks_t budget;
+	xnticks_t deadline;
+	unsigned long throttles;
+};
+
+static struct xnvfile_snapshot_ops vfile_sched_edf_ops;
+
+static struct xnvfile_snapshot vfile_sched_edf = {
+	.privsz = sizeof(struct vfile_sched_edf_priv),
+	.datasz = sizeof(struct vfile_sched_edf_data),
+	.tag = &nkpod_struct.threadlist_tag,
+	.ops = &vfile_sched_edf_ops,
+};
+
+static int vfile_sched_edf_rewind(struct xnvfile_snapshot_iterator *it)
+{
+	struct vfile_sched_edf_priv *priv = xnvfile_iterator_priv(it);
+	int nrthreads = xnsched_class_edf.nthreads;
+
+	if (nrthreads == 0)
+		return -ESRCH;
+
+	priv->curr = getheadq(&nkpod->threadq);
+	priv->now = xnpod_get_cpu_time();
+
+	return nrthreads;
+}
+
+static int vfile_sched_edf_next(struct xnvfile_snapshot_iterator *it,
+				void *data)
+{
+	struct vfile_sched_edf_priv *priv = xnvfile_iterator_priv(it);
+	struct vfile_sched_edf_data *p = data;
+	struct xnsched_edf_data *pedf;
+	struct xnthread *thread;
+
+	if (priv->curr == NULL)
+		return 0;	/* All done. */
+
+	thread = link2thread(priv->curr, glink);
+	priv->curr = nextq(&nkpod->threadq, priv->curr);
+
+	if (thread->base_class != &xnsched_class_edf)
+		return VFILE_SEQ_SKIP;
+
+	pedf = thread->pedf;
+	p->cpu = xnsched_cpu(thread->sched);
+	p->pid = xnthread_user_pid(thread);
+	memcpy(p->name, thread->name, sizeof(p->name));
+	p->prio = thread->bprio;
+	p->throttled = pedf->throttled;
+	p->runtime = pedf->param.runtime;
+	p->period = pedf->param.period;
+	p->budget = pedf->budget;
+	p->deadline = edf_earlier_p(priv->now, pedf->deadline) ?
+		pedf->deadline - priv->now : 0;
+	p->throttles = pedf->throttles;
+
+	return 1;
+}
+
+static int vfile_sched_edf_show(struct xnvfile_snapshot_iterator *it,
+				void *data)
+{
+	char rtbuf[16], ptbuf[16], btbuf[16], dlbuf[16];
+	struct vfile_sched_edf_data *p = data;
+
+	if (p == NULL)
+		xnvfile_printf(it,
+			       "%-3s  %-6s %-4s %-10s %-10s %-10s %-10s %-9s %s\n",
+			       "CPU", "PID", "PRI", "RUNTIME", "PERIOD",
+			       "BUDGET", "DEADLINE", "THROTTLES", "NAME");
+	else {
+		xntimer_format_time(p->runtime, 0, rtbuf, sizeof(rtbuf));
+		xntimer_format_time(p->period, 0, ptbuf, sizeof(ptbuf));
+		xntimer_format_time(p->budget, 0, btbuf, sizeof(btbuf));
+		xntimer_format_time(p->deadline, 0, dlbuf, sizeof(dlbuf));
+
+		xnvfile_printf(it,
+			       "%3u  %-6d %3d%c %-10s %-10s %-10s %-10s %-9lu %s\n",
+			       p->cpu,
+			       p->pid,
+			       p->prio,
+			       p->throttled ? '*' : ' ',
+			       rtbuf,
+			       ptbuf,
+			       btbuf,
+			       dlbuf,
+			       p->throttles,
+			       p->name);
+	}
+
+	return 0;
+}
+
+static struct xnvfile_snapshot_ops vfile_sched_edf_ops = {
+	.rewind = vfile_sched_edf_rewind,
+	.next = vfile_sched_edf_next,
+	.show = vfile_sched_edf_show,
+};
+
+static int xnsched_edf_init_vfile(struct xnsched_class *schedclass,
+				  struct xnvfile_directory *vfroot)
+{
+	int ret;
+
+	ret = xnvfile_init_dir(schedclass->name, &sched_edf_vfroot, vfroot);
+	if (ret)
+		return ret;
+
+	return xnvfile_init_snapshot("threads", &vfile_sched_edf,
+				     &sched_edf_vfroot);
+}
+
+static void xnsched_edf_cleanup_vfile(struct xnsched_class *schedclass)
+{
+	xnvfile_destroy_snapshot(&vfile_sched_edf);
+	xnvfile_destroy_dir(&sched_edf_vfroot);
+}
+
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+struct xnsched_class xnsched_class_edf = {
+	.sched_init		=	xnsched_edf_init,
+	.sched_enqueue		=	xnsched_edf_enqueue,
+	.sched_dequeue		=	xnsched_edf_dequeue,
+	.sched_requeue		=	xnsched_edf_requeue,
+	.sched_pick		=	xnsched_edf_pick,
+	.sched_tick		=	NULL,
+	.sched_rotate		=	NULL,
+	.sched_migrate		=	xnsched_edf_migrate,
+	.sched_setparam		=	xnsched_edf_setparam,
+	.sched_getparam		=	xnsched_edf_getparam,
+	.sched_trackprio	=	xnsched_edf_trackprio,
+	.sched_declare		=	xnsched_edf_declare,
+	.sched_forget		=	xnsched_edf_forget,
+	.sched_chkparam		=	xnsched_edf_chkparam,
+#ifdef CONFIG_XENO_OPT_VFILE
+	.sched_init_vfile	=	xnsched_edf_init_vfile,
+	.sched_cleanup_vfile	=	xnsched_edf_cleanup_vfile,
+#endif
+	.weight			=	XNSCHED_CLASS_WEIGHT(4),
+	.name			=	"edf"
+};
+EXPORT_SYMBOL_GPL(xnsched_class_edf);
@@ -23,6 +23,114 @@
  */
 
 #include <nucleus/sched.h>
+#include <nucleus/pod.h>
+
+#ifdef CONFIG_XENO_OPT_POLL_IDLE
+
+#include <linux/version.h>
+#include <linux/sched.h>
+
+/*
+ * When the idle class is picked, the CPU runs the root thread, and
+ * Linux may then put it to deep sleep, so that the next real-time
+ * interrupt pays the wakeup and cache refill costs. CPUs from the
+ * poll_idle mask spin with pause in the Linux idle routine instead,
+ * so that real-time interrupts hit a warm core. The root thread of
+ * such CPU counts its transitions to idle polling in its mode switch
+ * count (MSW in /proc/xenomai/stat), which is meaningless otherwise.
+ */
+static unsigned long poll_idle_mask;
+module_param_named(poll_idle, poll_idle_mask, ulong, 0644);
+MODULE_PARM_DESC(poll_idle, "Mask of CPUs polling instead of idling");
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(3,9,0)
+
+static void (*poll_idle_saved)(void);
+
+static atomic_t poll_idle_users = ATOMIC_INIT(0);
+
+static inline int poll_idle_p(int cpu)
+{
+	return cpu < BITS_PER_LONG && ((poll_idle_mask >> cpu) & 1);
+}
+
+/* Called by the Linux idle loop, interrupts off. */
+static void xnsched_poll_idle(void)
+{
+	int cpu = smp_processor_id();
+
+	if (!poll_idle_p(cpu)) {
+		if (poll_idle_saved)
+			poll_idle_saved();
+		else
+			local_irq_enable();
+		return;
+	}
+
+	atomic_inc(&poll_idle_users);
+	xnstat_counter_inc(&xnpod_sched_slot(cpu)->rootcb.stat.ssw);
+	local_irq_enable();
+
+	while (!need_resched() && poll_idle_p(cpu))
+		cpu_relax();
+
+	atomic_dec(&poll_idle_users);
+}
+
+void xnsched_poll_idle_mount(void)
+{
+	poll_idle_saved = pm_idle;
+	pm_idle = xnsched_poll_idle;
+}
+
+void xnsched_poll_idle_umount(void)
+{
+	if (pm_idle == xnsched_poll_idle)
+		pm_idle = poll_idle_saved;
+
+	/* Wait for the pollers to leave the loop. */
+	poll_idle_mask = 0;
+	smp_mb();
+	while (atomic_read(&poll_idle_users))
+		cpu_relax();
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,5,0)
+	kick_all_cpus_sync();
+#else
+	cpu_idle_wait();
+#endif
+}
+
+#else /* Linux >= 3.9 */
+
+/*
+ * The idle routine cannot be overridden anymore, and idle polling
+ * can only be forced on all CPUs at once, without counting.
+ */
+static int poll_idle_forced;
+
+void xnsched_poll_idle_mount(void)
+{
+	if (poll_idle_mask == 0)
+		return;
+#ifdef MODULE
+	xnlogwarn("idle polling requires a built-in nucleus, ignored\n");
+#else
+	cpu_idle_poll_ctrl(true);
+	poll_idle_forced = 1;
+#endif
+}
+
+void xnsched_poll_idle_umount(void)
+{
+#ifndef MODULE
+	if (poll_idle_forced)
+		cpu_idle_poll_ctrl(false);
+#endif
+}
+
+#endif /* Linux >= 3.9 */
+
+#endif /* CONFIG_XENO_OPT_POLL_IDLE */
 
 static struct xnthread *xnsched_idle_pick(struct xnsched *sched)
 {
@@ -113,37 +113,104 @@ static void sporadic_schedule_drop(struct xnthread *thread)
 		sporadic_note_valid_drop(thread->sched);
 }
 
-static void sporadic_replenish_handler(struct xntimer *timer)
+static inline xnticks_t sporadic_repl_date(struct xnsched_sporadic_data *pss)
 {
-	struct xnsched_sporadic_data *pss;
+	return pss->repl_data[pss->repl_out].date;
+}
+
+#define link2pss(ln)	container_of(ln, struct xnsched_sporadic_data, rlink)
+
+static void sporadic_replenish_handler(struct xntimer *timer);
+
+/*
+ * Pending replenishments of all sporadic threads are served by a
+ * single timer per CPU. Each thread with replenishments pending is
+ * linked once to the replenishment queue of its CPU, ordered by the
+ * date of its earliest replenishment; the timer is armed for the
+ * head of the queue only, so that posting a replenishment which is
+ * not the next one to expire does not involve any timer operation.
+ */
+static void sporadic_queue_repl(struct xnsched_sporadic_data *pss)
+{
+	struct xnsched *sched = pss->thread->sched;
+	struct xnqueue *q = &sched->pss.replq;
+	xnticks_t date = sporadic_repl_date(pss);
+	struct xnholder *h;
+	int ret;
+
+	for (h = getheadq(q); h; h = nextq(q, h))
+		if ((xnsticks_t)(date - sporadic_repl_date(link2pss(h))) < 0)
+			break;
+
+	if (h)
+		insertq(q, h, &pss->rlink);
+	else
+		appendq(q, &pss->rlink);
+
+	pss->repl_sched = sched;
+
+	/*
+	 * The queue is being served by the replenishment handler,
+	 * which will program the timer on its way out.
+	 */
+	if (getheadq(q) != &pss->rlink || sched->pss.repl_busy)
+		return;
+
+	ret = xntimer_start(&sched->pss.repl_timer, date,
+			    XN_INFINITE, XN_ABSOLUTE);
+	/*
+	 * The following case should not happen unless the initial
+	 * budget value is inappropriate, but let's handle it anyway.
+	 */
+	if (ret == -ETIMEDOUT)
+		sporadic_replenish_handler(&sched->pss.repl_timer);
+}
+
+static void sporadic_unqueue_repl(struct xnsched_sporadic_data *pss)
+{
+	struct xnsched *sched = pss->repl_sched;
+
+	if (sched == NULL)
+		return;
+
+	removeq(&sched->pss.replq, &pss->rlink);
+	pss->repl_sched = NULL;
+	/*
+	 * An early shot of the timer is harmless, we only care for
+	 * not leaving it armed over an empty queue.
+	 */
+	if (emptyq_p(&sched->pss.replq) && !sched->pss.repl_busy)
+		xntimer_stop(&sched->pss.repl_timer);
+}
+
+static void sporadic_replenish(struct xnsched_sporadic *ps,
+			       struct xnsched_sporadic_data *pss,
+			       xnticks_t now)
+{
+	struct xnthread *thread = pss->thread;
 	union xnsched_policy_param p;
-	struct xnthread *thread;
-	xnticks_t now;
-	int r, ret;
+	xnticks_t late;
+	int r;
 
-	pss = container_of(timer, struct xnsched_sporadic_data, repl_timer);
-	thread = pss->thread;
 	XENO_BUGON(NUCLEUS, pss->repl_pending <= 0);
 
-retry:
-	now = xnpod_get_cpu_time();
-
 	do {
 		r = pss->repl_out;
-		if ((xnsticks_t)(now - pss->repl_data[r].date) <= 0)
+		if ((xnsticks_t)(now - pss->repl_data[r].date) < 0)
 			break;
+		late = now - pss->repl_data[r].date;
+		ps->repl_count++;
+		ps->repl_late_sum += late;
+		if (late > ps->repl_late_max)
+			ps->repl_late_max = late;
 		pss->budget += pss->repl_data[r].amount;
 		if (pss->budget > pss->param.init_budget)
 			pss->budget = pss->param.init_budget;
 		pss->repl_out = (r + 1) % MAX_REPLENISH;
 	} while(--pss->repl_pending > 0);
 
-	if (pss->repl_pending > 0) {
-		ret = xntimer_start(&pss->repl_timer, pss->repl_data[r].date,
-				    XN_INFINITE, XN_ABSOLUTE);
-		if (ret == -ETIMEDOUT)
-			goto retry; /* This plugs a tiny race. */
-	}
+	if (pss->repl_pending > 0)
+		sporadic_queue_repl(pss);
 
 	if (pss->budget == 0)
 		return;
@@ -171,10 +238,49 @@ retry:
 		sporadic_schedule_drop(thread);
 }
 
+static void sporadic_replenish_handler(struct xntimer *timer)
+{
+	struct xnsched *sched =
+		container_of(timer, struct xnsched, pss.repl_timer);
+	struct xnsched_sporadic *ps = &sched->pss;
+	struct xnsched_sporadic_data *pss;
+	struct xnholder *h;
+	xnticks_t now;
+	int ret;
+
+	ps->repl_shots++;
+	ps->repl_busy = 1;
+retry:
+	now = xnpod_get_cpu_time();
+
+	/*
+	 * Serve all replenishments which are due in a single pass,
+	 * regardless of the thread they belong to.
+	 */
+	while ((h = getheadq(&ps->replq)) != NULL) {
+		pss = link2pss(h);
+		if ((xnsticks_t)(now - sporadic_repl_date(pss)) < 0)
+			break;
+		removeq(&ps->replq, h);
+		pss->repl_sched = NULL;
+		sporadic_replenish(ps, pss, now);
+	}
+
+	h = getheadq(&ps->replq);
+	if (h) {
+		ret = xntimer_start(timer, sporadic_repl_date(link2pss(h)),
+				    XN_INFINITE, XN_ABSOLUTE);
+		if (ret == -ETIMEDOUT)
+			goto retry; /* This plugs a tiny race. */
+	}
+
+	ps->repl_busy = 0;
+}
+
 static void sporadic_post_recharge(struct xnthread *thread, xnticks_t budget)
 {
 	struct xnsched_sporadic_data *pss = thread->pss;
-	int r, ret;
+	int r;
 
 	if (pss->repl_pending >= pss->param.max_repl)
 		return;
@@ -190,17 +296,13 @@ static void sporadic_post_recharge(struct xnthread *thread, xnticks_t budget)
 	pss->repl_data[r].amount = budget;
 	pss->repl_in = (r + 1) % MAX_REPLENISH;
 
-	if (pss->repl_pending++ == 0) {
-		ret = xntimer_start(&pss->repl_timer, pss->repl_data[r].date,
-				    XN_INFINITE, XN_ABSOLUTE);
-		/*
-		 * The following case should not happen unless the
-		 * initial budget value is inappropriate, but let's
-		 * handle it anyway.
-		 */
-		if (ret == -ETIMEDOUT)
-			sporadic_replenish_handler(&pss->repl_timer);
-	}
+	/*
+	 * Replenishment dates increase monotonically, so the thread
+	 * keeps its position in the queue if it already has
+	 * replenishments pending.
+	 */
+	if (pss->repl_pending++ == 0)
+		sporadic_queue_repl(pss);
 }
 
 static void sporadic_suspend_activity(struct xnthread *thread)
@@ -230,8 +332,19 @@ static void xnsched_sporadic_init(struct xnsched *sched)
 	 * runqueue and thus share the same priority scale, with the
 	 * addition of budget management for the sporadic ones.
 	 */
+	struct xnsched_sporadic *ps = &sched->pss;
+
+	initq(&ps->replq);
+	xntimer_init(&ps->repl_timer, &nktbase, sporadic_replenish_handler);
+	xntimer_set_name(&ps->repl_timer, "pss-replenish");
+	xntimer_set_sched(&ps->repl_timer, sched);
+	ps->repl_busy = 0;
+	ps->repl_shots = 0;
+	ps->repl_count = 0;
+	ps->repl_late_sum = 0;
+	ps->repl_late_max = 0;
 #if XENO_DEBUG(NUCLEUS)
-	sched->pss.drop_retries = 0;
+	ps->drop_retries = 0;
 #endif
 }
 
@@ -247,6 +360,7 @@ static void xnsched_sporadic_setparam(struct xnthread *thread,
 	 * the dynamic priority of the thread.
 	 */
 	if (p->pss.init_budget > 0) {
+		sporadic_unqueue_repl(pss);
 		pss->param = p->pss;
 		pss->budget = p->pss.init_budget;
 		pss->repl_in = 0;
@@ -313,11 +427,11 @@ static int xnsched_sporadic_declare(struct xnthread *thread,
 		return -ENOMEM;
 
 	tbase = xnthread_time_base(thread);
-	xntimer_init(&pss->repl_timer, tbase, sporadic_replenish_handler);
-	xntimer_set_name(&pss->repl_timer, "pss-replenish");
 	xntimer_init(&pss->drop_timer, tbase, sporadic_drop_handler);
 	xntimer_set_name(&pss->drop_timer, "pss-drop");
 
+	inith(&pss->rlink);
+	pss->repl_sched = NULL;
 	thread->pss = pss;
 	pss->thread = thread;
 
@@ -328,7 +442,7 @@ static void xnsched_sporadic_forget(struct xnthread *thread)
 {
 	struct xnsched_sporadic_data *pss = thread->pss;
 
-	xntimer_destroy(&pss->repl_timer);
+	sporadic_unqueue_repl(pss);
 	xntimer_destroy(&pss->drop_timer);
 	xnfree(pss);
 	thread->pss = NULL;
@@ -349,7 +463,7 @@ static void xnsched_sporadic_requeue(struct xnthread *thread)
 	__xnsched_rt_requeue(thread);
 }
 
-static struct xnthread *xnsched_sporadic_pick(struct xnsched *sched)
+struct xnthread *xnsched_sporadic_pick(struct xnsched *sched)
 {
 	struct xnthread *curr = sched->curr, *next;
 	struct xnpholder *h;
@@ -541,6 +655,85 @@ static struct xnvfile_snapshot_ops vfile_sched_sporadic_ops = {
 	.show = vfile_sched_sporadic_show,
 };
 
+static struct xnvfile_rev_tag sporadic_stats_tag;
+
+struct vfile_sched_sporadic_stats_priv {
+	int cpu;
+};
+
+struct vfile_sched_sporadic_stats_data {
+	int cpu;
+	unsigned long shots;
+	unsigned long repls;
+	xnticks_t late_avg;
+	xnticks_t late_max;
+};
+
+static struct xnvfile_snapshot_ops vfile_sched_sporadic_stats_ops;
+
+static struct xnvfile_snapshot vfile_sched_sporadic_stats = {
+	.privsz = sizeof(struct vfile_sched_sporadic_stats_priv),
+	.datasz = sizeof(struct vfile_sched_sporadic_stats_data),
+	.tag = &sporadic_stats_tag,
+	.ops = &vfile_sched_sporadic_stats_ops,
+};
+
+static int vfile_sched_sporadic_stats_rewind(struct xnvfile_snapshot_iterator *it)
+{
+	struct vfile_sched_sporadic_stats_priv *priv = xnvfile_iterator_priv(it);
+
+	priv->cpu = 0;
+
+	return xnarch_num_online_cpus();
+}
+
+static int vfile_sched_sporadic_stats_next(struct xnvfile_snapshot_iterator *it,
+					   void *data)
+{
+	struct vfile_sched_sporadic_stats_priv *priv = xnvfile_iterator_priv(it);
+	struct vfile_sched_sporadic_stats_data *p = data;
+	struct xnsched_sporadic *ps;
+
+	if (priv->cpu >= xnarch_num_online_cpus())
+		return 0;	/* All done. */
+
+	ps = &xnpod_sched_slot(priv->cpu)->pss;
+	p->cpu = priv->cpu;
+	p->shots = ps->repl_shots;
+	p->repls = ps->repl_count;
+	p->late_avg = ps->repl_count ?
+		xnarch_ulldiv(ps->repl_late_sum, ps->repl_count, NULL) : 0;
+	p->late_max = ps->repl_late_max;
+	priv->cpu++;
+
+	return 1;
+}
+
+static int vfile_sched_sporadic_stats_show(struct xnvfile_snapshot_iterator *it,
+					   void *data)
+{
+	struct vfile_sched_sporadic_stats_data *p = data;
+
+	if (p == NULL)
+		xnvfile_printf(it, "%-3s  %-10s %-10s %-10s %s\n",
+			       "CPU", "SHOTS", "REPLS", "AVGLATE", "MAXLATE");
+	else
+		xnvfile_printf(it, "%3u  %-10lu %-10lu %-10Lu %Lu\n",
+			       p->cpu,
+			       p->shots,
+			       p->repls,
+			       p->late_avg,
+			       p->late_max);
+
+	return 0;
+}
+
+static struct xnvfile_snapshot_ops vfile_sched_sporadic_stats_ops = {
+	.rewind = vfile_sched_sporadic_stats_rewind,
+	.next = vfile_sched_sporadic_stats_next,
+	.show = vfile_sched_sporadic_stats_show,
+};
+
 static int xnsched_sporadic_init_vfile(struct xnsched_class *schedclass,
 				       struct xnvfile_directory *vfroot)
 {
@@ -551,12 +744,18 @@ static int xnsched_sporadic_init_vfile(struct xnsched_class *schedclass,
 	if (ret)
 		return ret;
 
-	return xnvfile_init_snapshot("threads", &vfile_sched_sporadic,
+	ret = xnvfile_init_snapshot("threads", &vfile_sched_sporadic,
+				    &sched_sporadic_vfroot);
+	if (ret)
+		return ret;
+
+	return xnvfile_init_snapshot("stats", &vfile_sched_sporadic_stats,
 				     &sched_sporadic_vfroot);
 }
 
 static void xnsched_sporadic_cleanup_vfile(struct xnsched_class *schedclass)
 {
+	xnvfile_destroy_snapshot(&vfile_sched_sporadic_stats);
 	xnvfile_destroy_snapshot(&vfile_sched_sporadic);
 	xnvfile_destroy_dir(&sched_sporadic_vfroot);
 }
@@ -24,6 +24,16 @@
 
 #include <nucleus/pod.h>
 
+#ifdef CONFIG_XENO_OPT_VFILE
+static struct xnvfile_rev_tag tp_windows_tag;
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+#ifdef CONFIG_XENO_OPT_SCHED_TP_GLOBAL
+/* Common origin of all time frames, set by the first schedule. */
+static xnticks_t tp_epoch;
+static int tp_epoch_set;
+#endif /* CONFIG_XENO_OPT_SCHED_TP_GLOBAL */
+
 static void tp_schedule_next(struct xnsched_tp *tp)
 {
 	struct xnsched_tp_window *w;
@@ -53,6 +63,8 @@ static void tp_schedule_next(struct xnsched_tp *tp)
 		ret = xntimer_start(&tp->tf_timer, t, XN_INFINITE, XN_ABSOLUTE);
 		if (ret != -ETIMEDOUT)
 			break;
+
+		w->w_overruns++;
 		/*
 		 * We are late, make sure to remain within the bounds
 		 * of a valid time frame before advancing to the next
@@ -76,6 +88,13 @@ static void tp_schedule_next(struct xnsched_tp *tp)
 static void tp_tick_handler(struct xntimer *timer)
 {
 	struct xnsched_tp *tp = container_of(timer, struct xnsched_tp, tf_timer);
+	struct xnsched_tp_window *w = &tp->gps->pwins[tp->wnext];
+	xnsticks_t drift;
+
+	drift = xnpod_get_cpu_time() - (tp->tf_start + w->w_offset);
+	if (drift > (xnsticks_t)w->w_maxdrift)
+		w->w_maxdrift = drift;
+	w->w_switches++;
 	/*
 	 * Advance beginning date of time frame by a full period if we
 	 * are processing the last window.
@@ -203,7 +222,7 @@ static void xnsched_tp_requeue(struct xnthread *thread)
 			&thread->rlink, thread->cprio);
 }
 
-static struct xnthread *xnsched_tp_pick(struct xnsched *sched)
+struct xnthread *xnsched_tp_pick(struct xnsched *sched)
 {
 	struct xnpholder *h;
 
@@ -235,9 +254,37 @@ static void xnsched_tp_migrate(struct xnthread *thread, struct xnsched *sched)
 void xnsched_tp_start_schedule(struct xnsched *sched)
 {
 	struct xnsched_tp *tp = &sched->tp;
+#ifdef CONFIG_XENO_OPT_SCHED_TP_GLOBAL
+	struct xnsched_tp_schedule *gps = tp->gps;
+	xnticks_t elapsed;
+	int n;
+#endif /* CONFIG_XENO_OPT_SCHED_TP_GLOBAL */
 
 	tp->wnext = 0;
 	tp->tf_start = xnpod_get_cpu_time();
+
+#ifdef CONFIG_XENO_OPT_SCHED_TP_GLOBAL
+	/*
+	 * Anchor the time frame to the common epoch, joining it at
+	 * the window currently in progress, so that frames of equal
+	 * duration switch windows at the same dates on all CPUs.
+	 */
+	if (!tp_epoch_set) {
+		tp_epoch = tp->tf_start;
+		tp_epoch_set = 1;
+	} else {
+		elapsed = xnarch_mod64(tp->tf_start - tp_epoch,
+				       gps->tf_duration);
+		tp->tf_start -= elapsed;
+		for (n = gps->pwin_nr - 1; gps->pwins[n].w_offset > elapsed; n--)
+			;
+		tp->wnext = n;
+		/* As tp_tick_handler() does when entering the last window. */
+		if (n + 1 == gps->pwin_nr)
+			tp->tf_start += gps->tf_duration;
+	}
+#endif /* CONFIG_XENO_OPT_SCHED_TP_GLOBAL */
+
 	tp_schedule_next(&sched->tp);
 }
 EXPORT_SYMBOL_GPL(xnsched_tp_start_schedule);
@@ -258,6 +305,7 @@ xnsched_tp_set_schedule(struct xnsched *sched,
 	union xnsched_policy_param param;
 	struct xnthread *thread;
 	struct xnholder *h;
+	int n;
 
 	XENO_BUGON(NUCLEUS, gps != NULL &&
 		    (gps->pwin_nr <= 0 || gps->pwins[0].w_offset != 0));
@@ -274,8 +322,16 @@ xnsched_tp_set_schedule(struct xnsched *sched,
 		xnsched_set_policy(thread, &xnsched_class_rt, &param);
 	}
 
+	if (gps)
+		for (n = 0; n < gps->pwin_nr; n++) {
+			gps->pwins[n].w_switches = 0;
+			gps->pwins[n].w_overruns = 0;
+			gps->pwins[n].w_maxdrift = 0;
+		}
+
 	old_gps = tp->gps;
 	tp->gps = gps;
+	xnvfile_touch_tag(&tp_windows_tag);
 
 	return old_gps;
 }
@@ -377,6 +433,113 @@ static struct xnvfile_snapshot_ops vfile_sched_tp_ops = {
 	.show = vfile_sched_tp_show,
 };
 
+struct vfile_sched_tp_windows_priv {
+	int cpu;
+	int wnum;
+};
+
+struct vfile_sched_tp_windows_data {
+	int cpu;
+	int wnum;
+	int ptid;
+	xnticks_t offset;
+	xnticks_t duration;
+	unsigned long switches;
+	unsigned long overruns;
+	xnticks_t maxdrift;
+};
+
+static struct xnvfile_snapshot_ops vfile_sched_tp_windows_ops;
+
+static struct xnvfile_snapshot vfile_sched_tp_windows = {
+	.privsz = sizeof(struct vfile_sched_tp_windows_priv),
+	.datasz = sizeof(struct vfile_sched_tp_windows_data),
+	.tag = &tp_windows_tag,
+	.ops = &vfile_sched_tp_windows_ops,
+};
+
+static int vfile_sched_tp_windows_rewind(struct xnvfile_snapshot_iterator *it)
+{
+	struct vfile_sched_tp_windows_priv *priv = xnvfile_iterator_priv(it);
+	struct xnsched *sched;
+	int cpu, nrwins = 0;
+
+	priv->cpu = 0;
+	priv->wnum = 0;
+
+	for (cpu = 0; cpu < xnarch_num_online_cpus(); cpu++) {
+		sched = xnpod_sched_slot(cpu);
+		if (sched->tp.gps)
+			nrwins += sched->tp.gps->pwin_nr;
+	}
+
+	return nrwins;
+}
+
+static int vfile_sched_tp_windows_next(struct xnvfile_snapshot_iterator *it,
+				       void *data)
+{
+	struct vfile_sched_tp_windows_priv *priv = xnvfile_iterator_priv(it);
+	struct vfile_sched_tp_windows_data *p = data;
+	struct xnsched_tp_schedule *gps;
+	struct xnsched_tp_window *w;
+
+	for (;;) {
+		if (priv->cpu >= xnarch_num_online_cpus())
+			return 0;	/* All done. */
+
+		gps = xnpod_sched_slot(priv->cpu)->tp.gps;
+		if (gps && priv->wnum < gps->pwin_nr)
+			break;
+
+		priv->cpu++;
+		priv->wnum = 0;
+	}
+
+	w = &gps->pwins[priv->wnum];
+	p->cpu = priv->cpu;
+	p->wnum = priv->wnum;
+	p->ptid = w->w_part;
+	p->offset = w->w_offset;
+	p->duration = (priv->wnum + 1 < gps->pwin_nr ?
+		       w[1].w_offset : gps->tf_duration) - w->w_offset;
+	p->switches = w->w_switches;
+	p->overruns = w->w_overruns;
+	p->maxdrift = w->w_maxdrift;
+	priv->wnum++;
+
+	return 1;
+}
+
+static int vfile_sched_tp_windows_show(struct xnvfile_snapshot_iterator *it,
+				       void *data)
+{
+	struct vfile_sched_tp_windows_data *p = data;
+
+	if (p == NULL)
+		xnvfile_printf(it, "%-3s  %-3s %-4s %-12s %-12s %-10s %-8s %s\n",
+			       "CPU", "WIN", "PTID", "OFFSET", "DURATION",
+			       "SWITCHES", "OVERRUNS", "MAXDRIFT");
+	else
+		xnvfile_printf(it, "%3u  %-3d %-4d %-12Lu %-12Lu %-10lu %-8lu %Lu\n",
+			       p->cpu,
+			       p->wnum,
+			       p->ptid,
+			       p->offset,
+			       p->duration,
+			       p->switches,
+			       p->overruns,
+			       p->maxdrift);
+
+	return 0;
+}
+
+static struct xnvfile_snapshot_ops vfile_sched_tp_windows_ops = {
+	.rewind = vfile_sched_tp_windows_rewind,
+	.next = vfile_sched_tp_windows_next,
+	.show = vfile_sched_tp_windows_show,
+};
+
 static int xnsched_tp_init_vfile(struct xnsched_class *schedclass,
 				 struct xnvfile_directory *vfroot)
 {
@@ -386,12 +549,18 @@ static int xnsched_tp_init_vfile(struct xnsched_class *schedclass,
 	if (ret)
 		return ret;
 
-	return xnvfile_init_snapshot("threads", &vfile_sched_tp,
+	ret = xnvfile_init_snapshot("threads", &vfile_sched_tp,
+				    &sched_tp_vfroot);
+	if (ret)
+		return ret;
+
+	return xnvfile_init_snapshot("windows", &vfile_sched_tp_windows,
 				     &sched_tp_vfroot);
 }
 
 static void xnsched_tp_cleanup_vfile(struct xnsched_class *schedclass)
 {
+	xnvfile_destroy_snapshot(&vfile_sched_tp_windows);
 	xnvfile_destroy_snapshot(&vfile_sched_tp);
 	xnvfile_destroy_dir(&sched_tp_vfroot);
 }
@@ -26,6 +26,10 @@
 #include <nucleus/timer.h>
 #include <nucleus/intr.h>
 #include <nucleus/heap.h>
+#include <nucleus/statmap.h>
+#include <nucleus/profile.h>
+#include <nucleus/module.h>
+#include <nucleus/budget.h>
 #include <asm/xenomai/bits/sched.h>
 
 static struct xnsched_class *xnsched_class_highest;
@@ -58,6 +62,9 @@ void xnsched_register_classes(void)
 	xnsched_register_class(&xnsched_class_sporadic);
 #endif
 	xnsched_register_class(&xnsched_class_rt);
+#ifdef CONFIG_XENO_OPT_SCHED_EDF
+	xnsched_register_class(&xnsched_class_edf);
+#endif
 }
 
 #ifdef CONFIG_XENO_OPT_WATCHDOG
@@ -115,6 +122,145 @@ static void xnsched_watchdog_handler(struct xntimer *timer)
 
 #endif /* CONFIG_XENO_OPT_WATCHDOG */
 
+#ifdef CONFIG_XENO_OPT_STATS
+
+int xnstat_sampling;
+EXPORT_SYMBOL_GPL(xnstat_sampling);
+
+static xnticks_t xnstat_sampling_period; /* ns, 0 for exact accounting. */
+
+/*
+ * In sampled mode, the execution time elapsed since the last sample
+ * is charged as a whole to the account the clock interrupt preempted,
+ * instead of being accumulated on each context switch.
+ */
+static void xnsched_sampling_handler(struct xntimer *timer)
+{
+	struct xnsched *sched = container_of(timer, struct xnsched, stimer);
+	xnstat_exectime_t *account = sched->sampled_account;
+	xnticks_t now = xnstat_exectime_now();
+
+	if (account == NULL)
+		return;
+
+	account->total += now - sched->last_account_switch;
+	account->last = now;
+	sched->last_account_switch = now;
+}
+
+/**
+ * @internal
+ * @fn int xnsched_set_sampling(xnticks_t period)
+ * @brief Select exact or sampled execution time accounting.
+ *
+ * @param period The sampling period in nanoseconds, or zero to
+ * account for execution times exactly upon each context switch.
+ *
+ * Sampling trades the accuracy of the exectime figures for the two
+ * time stamp reads each switch costs otherwise.
+ */
+int xnsched_set_sampling(xnticks_t period)
+{
+	struct xnsched *sched;
+	xnticks_t now;
+	int cpu;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	now = xnstat_exectime_now();
+
+	for (cpu = 0; cpu < xnarch_num_online_cpus(); cpu++) {
+		if (!xnarch_cpu_supported(cpu))
+			continue;
+		sched = xnpod_sched_slot(cpu);
+		if (period) {
+			xntimer_start(&sched->stimer, period, period,
+				      XN_RELATIVE);
+			continue;
+		}
+		xntimer_stop(&sched->stimer);
+		/* Do not charge the last sampling interval twice. */
+		if (cpu == xnarch_current_cpu())
+			sched->last_account_switch = now;
+	}
+
+	xnstat_sampling_period = period;
+	xnstat_sampling = period != 0;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+
+#endif /* CONFIG_XENO_OPT_STATS */
+
+/* Must be called with nklock locked, interrupts off. */
+void xnsched_rrb_arm(struct xnsched *sched, struct xnthread *thread)
+{
+	if (thread->rrperiod == XN_INFINITE)
+		return;
+
+	if (thread->rrbudget == 0)
+		thread->rrbudget = thread->rrperiod * nkvtick;
+
+	sched->rrbstamp = xnarch_get_cpu_time();
+	xntimer_start(&sched->rrbtimer, thread->rrbudget,
+		      XN_INFINITE, XN_RELATIVE);
+}
+
+/* Must be called with nklock locked, interrupts off. */
+void __xnsched_rrb_switch(struct xnsched *sched,
+			  struct xnthread *prev, struct xnthread *next)
+{
+	xnticks_t elapsed;
+
+	/* The budget timer only ever runs on behalf of sched->curr. */
+	if (xntimer_running_p(&sched->rrbtimer)) {
+		xntimer_stop(&sched->rrbtimer);
+		elapsed = xnarch_get_cpu_time() - sched->rrbstamp;
+		/*
+		 * Leave at least 1ns, so that a thread preempted at
+		 * the very end of its slice is rotated as soon as it
+		 * resumes, instead of being given a full slice.
+		 */
+		prev->rrbudget = prev->rrbudget > elapsed ?
+			prev->rrbudget - elapsed : 1;
+	}
+
+	if (xnsched_rrb_p(next))
+		xnsched_rrb_arm(sched, next);
+}
+
+static void xnsched_rrb_handler(struct xntimer *timer)
+{
+	struct xnsched *sched = container_of(timer, struct xnsched, rrbtimer);
+	struct xnthread *curr = sched->curr;
+
+	if (!xnsched_rrb_p(curr))
+		return;
+
+	if (xnsched_rr_p(curr, &nktbase)) {
+		/*
+		 * The slice is exhausted: let the scheduling class
+		 * move the thread to the end of its priority group,
+		 * which also refills its credit, then start over
+		 * with a full budget.
+		 */
+		curr->rrcredit = 1;
+		curr->sched_class->sched_tick(curr);
+		curr->rrbudget = 0;
+	} else
+		/*
+		 * The budget is not consumed while the thread holds
+		 * the scheduler lock or runs boosted, check again a
+		 * virtual tick later.
+		 */
+		curr->rrbudget = nkvtick;
+
+	xnsched_rrb_arm(sched, curr);
+}
+
 void xnsched_init(struct xnsched *sched, int cpu)
 {
 	char htimer_name[XNOBJECT_NAME_LEN];
@@ -123,6 +269,18 @@ void xnsched_init(struct xnsched *sched, int cpu)
 	struct xnthread_init_attr attr;
 	struct xnsched_class *p;
 
+	/*
+	 * The hot fields of struct xnthread must fit in two 64-byte
+	 * cache lines, which they do on 64bit platforms without room
+	 * to spare: look elsewhere for a spot before adding any.
+	 */
+	XENO_BUILD_BUG_ON(offsetof(struct xnthread, signals) +
+			  sizeof(xnsigmask_t) -
+			  offsetof(struct xnthread, state) > 128);
+#ifdef CONFIG_SMP
+	XENO_BUILD_BUG_ON(offsetof(struct xnthread, state) % L1_CACHE_BYTES);
+#endif
+
 	sched->cpu = cpu;
 
 	for_each_xnsched_class(p) {
@@ -139,11 +297,18 @@ void xnsched_init(struct xnsched *sched, int cpu)
 #endif
 	sched->status = 0;
 	sched->lflags = 0;
+	if (xnmod_htick_nohz_mask & (1UL << cpu))
+		__setbits(sched->lflags, XNHNOHZ);
 	sched->inesting = 0;
 	sched->curr = &sched->rootcb;
 #ifdef CONFIG_XENO_OPT_PRIOCPL
 	xnlock_init(&sched->rpilock);
+	xnlock_stat_attach(&sched->rpilock, "rpilock/%d", cpu);
 	sched->rpistatus = 0;
+	sched->rpicount = 0;
+#ifdef CONFIG_XENO_OPT_STATS
+	memset(&sched->rpistat, 0, sizeof(sched->rpistat));
+#endif /* CONFIG_XENO_OPT_STATS */
 #endif
 	/*
 	 * No direct handler here since the host timer processing is
@@ -154,9 +319,18 @@ void xnsched_init(struct xnsched *sched, int cpu)
 	xntimer_set_priority(&sched->htimer, XNTIMER_LOPRIO);
 	xntimer_set_name(&sched->htimer, htimer_name);
 	xntimer_set_sched(&sched->htimer, sched);
+	xntimer_init(&sched->rrbtimer, &nktbase, xnsched_rrb_handler);
+	xntimer_set_name(&sched->rrbtimer, "[rrb]");
+	xntimer_set_sched(&sched->rrbtimer, sched);
+	sched->rrbstamp = 0;
+#ifdef CONFIG_XENO_OPT_SCHED_BUDGET
+	xnbudget_init_sched(sched);
+#endif /* CONFIG_XENO_OPT_SCHED_BUDGET */
 	sched->zombie = NULL;
 #ifdef CONFIG_SMP
 	xnarch_cpus_clear(sched->resched);
+	xnstat_counter_set(&sched->ipisent, 0);
+	xnstat_counter_set(&sched->ipiskip, 0);
 #endif
 
 	attr.flags = XNROOT | XNSTARTED | XNFPU;
@@ -173,33 +347,109 @@ void xnsched_init(struct xnsched *sched, int cpu)
 	xnstat_exectime_set_current(sched, &sched->rootcb.stat.account);
 #ifdef CONFIG_XENO_HW_FPU
 	sched->fpuholder = &sched->rootcb;
+	memset(&sched->fpustat, 0, sizeof(sched->fpustat));
 #endif /* CONFIG_XENO_HW_FPU */
+#ifdef CONFIG_XENO_OPT_STATS_TIMERS
+	memset(&sched->tmstat, 0, sizeof(sched->tmstat));
+#endif /* CONFIG_XENO_OPT_STATS_TIMERS */
 
 	xnarch_init_root_tcb(xnthread_archtcb(&sched->rootcb),
 			     &sched->rootcb,
 			     xnthread_name(&sched->rootcb));
 
+#ifdef CONFIG_XENO_OPT_STATS
+	sched->sampled_account = NULL;
+	xntimer_init_noblock(&sched->stimer, &nktbase,
+			     xnsched_sampling_handler);
+	xntimer_set_name(&sched->stimer, "[stat-sampler]");
+	xntimer_set_priority(&sched->stimer, XNTIMER_LOPRIO);
+	xntimer_set_sched(&sched->stimer, sched);
+#endif /* CONFIG_XENO_OPT_STATS */
 #ifdef CONFIG_XENO_OPT_WATCHDOG
 	xntimer_init_noblock(&sched->wdtimer, &nktbase,
 			     xnsched_watchdog_handler);
 	xntimer_set_name(&sched->wdtimer, "[watchdog]");
 	xntimer_set_priority(&sched->wdtimer, XNTIMER_LOPRIO);
+	xntimer_set_slack(&sched->wdtimer, 1000000000UL);
 	xntimer_set_sched(&sched->wdtimer, sched);
 #endif /* CONFIG_XENO_OPT_WATCHDOG */
+#ifdef CONFIG_XENO_OPT_PROFILE
+	xntimer_init_noblock(&sched->proftimer, &nktbase, xnprofile_tick);
+	xntimer_set_name(&sched->proftimer, "[profiler]");
+	xntimer_set_sched(&sched->proftimer, sched);
+#endif /* CONFIG_XENO_OPT_PROFILE */
+#ifdef CONFIG_XENO_OPT_CACHE_PARTITION
+	sched->cpdefault = -1;
+	sched->cpcurrent = -1;
+	sched->cpgen = 0;
+#endif /* CONFIG_XENO_OPT_CACHE_PARTITION */
 	xntimerq_init(&sched->timerqueue);
+	xntimerq_init(&sched->rtimerqueue);
+	initq(&sched->rtpq);
 }
 
 void xnsched_destroy(struct xnsched *sched)
 {
+#ifdef CONFIG_XENO_OPT_PRIOCPL
+	xnlock_stat_detach(&sched->rpilock);
+#endif
 	xntimer_destroy(&sched->htimer);
+	xntimer_destroy(&sched->rrbtimer);
+#ifdef CONFIG_XENO_OPT_SCHED_BUDGET
+	xnbudget_destroy_sched(sched);
+	xnbudget_destroy_thread(&sched->rootcb);
+#endif /* CONFIG_XENO_OPT_SCHED_BUDGET */
 	xntimer_destroy(&sched->rootcb.ptimer);
 	xntimer_destroy(&sched->rootcb.rtimer);
+	xnstatmap_detach(&sched->rootcb);
+#ifdef CONFIG_XENO_OPT_STATS
+	xntimer_destroy(&sched->stimer);
+#endif /* CONFIG_XENO_OPT_STATS */
 #ifdef CONFIG_XENO_OPT_WATCHDOG
 	xntimer_destroy(&sched->wdtimer);
 #endif /* CONFIG_XENO_OPT_WATCHDOG */
+#ifdef CONFIG_XENO_OPT_PROFILE
+	xntimer_destroy(&sched->proftimer);
+#endif /* CONFIG_XENO_OPT_PROFILE */
 	xntimerq_destroy(&sched->timerqueue);
+	xntimerq_destroy(&sched->rtimerqueue);
 }
 
+#ifdef CONFIG_XENO_OPT_SCHED_STATIC
+
+/*
+ * The set of scheduling classes is fixed at build time, so we may
+ * poll them in decreasing weight order with direct calls, instead of
+ * walking the class list. This must follow the registration order
+ * of xnsched_register_classes().
+ */
+static inline struct xnthread *xnsched_static_pick(struct xnsched *sched)
+{
+	struct xnthread *thread;
+
+#ifdef CONFIG_XENO_OPT_SCHED_EDF
+	thread = xnsched_edf_pick(sched);
+	if (thread)
+		return thread;
+#endif
+	thread = __xnsched_rt_pick(sched);
+	if (thread)
+		return thread;
+#ifdef CONFIG_XENO_OPT_SCHED_SPORADIC
+	thread = xnsched_sporadic_pick(sched);
+	if (thread)
+		return thread;
+#endif
+#ifdef CONFIG_XENO_OPT_SCHED_TP
+	thread = xnsched_tp_pick(sched);
+	if (thread)
+		return thread;
+#endif
+	return &sched->rootcb;
+}
+
+#endif /* CONFIG_XENO_OPT_SCHED_STATIC */
+
 /* Must be called with nklock locked, interrupts off. */
 struct xnthread *xnsched_pick_next(struct xnsched *sched)
 {
@@ -216,6 +466,18 @@ struct xnthread *xnsched_pick_next(struct xnsched *sched)
 			xnsched_set_self_resched(sched);
 			return curr;
 		}
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+		/*
+		 * Same if it holds the lock from user-space through
+		 * its state window, in which case it will call us
+		 * back upon unlock.
+		 */
+		if (curr->u_window && curr->u_window->schedlck) {
+			curr->u_window->schedpend = 1;
+			xnsched_set_self_resched(sched);
+			return curr;
+		}
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
 		/*
 		 * Push the current thread back to the runnable queue
 		 * of the scheduling class it belongs to, if not yet
@@ -235,7 +497,12 @@ struct xnthread *xnsched_pick_next(struct xnsched *sched)
 	 * Find the runnable thread having the highest priority among
 	 * all scheduling classes, scanned by decreasing priority.
 	 */
-#ifdef CONFIG_XENO_OPT_SCHED_CLASSES
+#if defined(CONFIG_XENO_OPT_SCHED_STATIC)
+	thread = xnsched_static_pick(sched); (void)p;
+	xnthread_clear_state(thread, XNREADY);
+
+	return thread;
+#elif defined(CONFIG_XENO_OPT_SCHED_CLASSES)
 	for_each_xnsched_class(p) {
 		thread = p->sched_pick(sched);
 		if (thread) {
@@ -266,11 +533,59 @@ void xnsched_zombie_hooks(struct xnthread *thread)
 		   "thread_out %p thread_out_name %s",
 		   thread, xnthread_name(thread));
 
-	xnpod_run_hooks(&nkpod->tdeleteq, thread, "DELETE");
+	xnpod_run_hooks(XNHOOK_THREAD_DELETE, thread);
 
 	xnsched_forget(thread);
 }
 
+#ifdef CONFIG_XENO_OPT_SCHED_REAPER
+
+/*
+ * Zombies release their own resources on the switch path as usual,
+ * since their TCB may be freed by their owner as soon as they are
+ * gone (e.g. after rtdm_task_join_nrt()). Only the memory scheduled
+ * for freeing on the CPU (i.e. TCBs) is released by the reaper, in
+ * bulk from the Linux domain. Since the reaper works on the CPU it
+ * was kicked from, the idle memory it drains is that of the CPU the
+ * zombies died on.
+ */
+
+static int reaper_apc = -1;
+
+/* Must be called with nklock locked, interrupts off. */
+void xnsched_kick_reaper(struct xnsched *sched)
+{
+	if (kheap.idleq[xnsched_cpu(sched)])
+		__rthal_apc_schedule(reaper_apc);
+}
+
+static void xnsched_reap(void *cookie)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	xnfreesync();
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+int xnsched_reaper_init(void)
+{
+	reaper_apc = rthal_apc_alloc("zombie_reaper", &xnsched_reap, NULL);
+
+	return reaper_apc < 0 ? reaper_apc : 0;
+}
+
+void xnsched_reaper_cleanup(void)
+{
+	/* Leftover idle memory goes away with the heap. */
+	if (reaper_apc >= 0) {
+		rthal_apc_free(reaper_apc);
+		reaper_apc = -1;
+	}
+}
+
+#endif /* CONFIG_XENO_OPT_SCHED_REAPER */
+
 void __xnsched_finalize_zombie(struct xnsched *sched)
 {
 	struct xnthread *thread = sched->zombie;
@@ -279,8 +594,12 @@ void __xnsched_finalize_zombie(struct xnsched *sched)
 
 	xnarch_finalize_no_switch(xnthread_archtcb(thread));
 
+#ifdef CONFIG_XENO_OPT_SCHED_REAPER
+	xnsched_kick_reaper(sched);
+#else /* !CONFIG_XENO_OPT_SCHED_REAPER */
 	if (xnthread_test_state(sched->curr, XNROOT))
 		xnfreesync();
+#endif /* !CONFIG_XENO_OPT_SCHED_REAPER */
 
 	sched->zombie = NULL;
 }
@@ -404,6 +723,17 @@ int xnsched_set_policy(struct xnthread *thread,
 {
 	int ret;
 
+	/*
+	 * Let the target class validate the parameters first, which
+	 * also covers updates within the current class, for which
+	 * there is no declaration step.
+	 */
+	if (sched_class->sched_chkparam) {
+		ret = sched_class->sched_chkparam(thread, p);
+		if (ret)
+			return ret;
+	}
+
 	/*
 	 * Declaring a thread to a new scheduling class may fail, so
 	 * we do that early, while the thread is still a member of the
@@ -476,6 +806,29 @@ void xnsched_track_policy(struct xnthread *thread,
 	xnsched_set_resched(thread->sched);
 }
 
+/*
+ * Must be called with nklock locked, interrupts off. Move thread to
+ * the RT class at the given priority level, for enforcing a priority
+ * ceiling. The base scheduling data are left untouched, so that
+ * xnsched_track_policy(thread, thread) restores them.
+ */
+void xnsched_protect_priority(struct xnthread *thread, int prio)
+{
+	union xnsched_policy_param param;
+
+	if (xnthread_test_state(thread, XNREADY))
+		xnsched_dequeue(thread);
+
+	param.rt.prio = prio;
+	thread->sched_class = &xnsched_class_rt;
+	xnsched_trackprio(thread, &param);
+
+	if (xnthread_test_state(thread, XNREADY))
+		xnsched_enqueue(thread);
+
+	xnsched_set_resched(thread->sched);
+}
+
 /* Must be called with nklock locked, interrupts off. thread must be
  * runnable. */
 void xnsched_migrate(struct xnthread *thread, struct xnsched *sched)
@@ -495,6 +848,9 @@ void xnsched_migrate(struct xnthread *thread, struct xnsched *sched)
 	 */
 	xnsched_set_resched(thread->sched);
 	thread->sched = sched;
+#ifdef CONFIG_SMP
+	xnintr_follow_consumer(thread, sched);
+#endif /* CONFIG_SMP */
 
 #ifdef CONFIG_XENO_HW_UNLOCKED_SWITCH
 	/*
@@ -527,6 +883,18 @@ void xnsched_migrate_passive(struct xnthread *thread, struct xnsched *sched)
 	 */
 	xnsched_set_resched(thread->sched);
 	thread->sched = sched;
+#ifdef CONFIG_SMP
+	xnintr_follow_consumer(thread, sched);
+#endif /* CONFIG_SMP */
+#ifdef CONFIG_XENO_OPT_SCHED_BUDGET
+	/*
+	 * A queued timer only moves from its own CPU. Should it stay
+	 * behind, the replenishment handler still finds the thread
+	 * through thread->sched, and only rearms the budget when
+	 * firing on that CPU.
+	 */
+	xntimer_set_sched(&thread->budget.rtimer, sched);
+#endif /* CONFIG_XENO_OPT_SCHED_BUDGET */
 
 	if (!xnthread_test_state(thread, XNTHREAD_BLOCK_BITS)) {
 		xnsched_requeue(thread);
@@ -534,128 +902,284 @@ void xnsched_migrate_passive(struct xnthread *thread, struct xnsched *sched)
 	}
 }
 
-#ifdef CONFIG_XENO_OPT_SCALABLE_SCHED
+#ifdef CONFIG_XENO_OPT_SCHED_BALANCE
 
-void initmlq(struct xnsched_mlq *q, int loprio, int hiprio)
+/*
+ * Load balancer for threads which opted in by setting XNBALANCE.
+ *
+ * A periodic nucleus timer triggers an APC, so that the balancing
+ * pass runs from the Linux domain. Each pass samples the execution
+ * time every thread consumed since the previous pass, sums it up
+ * per CPU, and if the gap between the busiest and the least loaded
+ * CPUs exceeds the configured threshold, moves the heaviest eligible
+ * thread which would not reverse the imbalance. At most one thread
+ * is moved per pass, which keeps the system from oscillating.
+ */
+
+#define XNSCHED_BALANCE_LOGSZ  8
+
+static struct xnsched_balancer {
+	xntimer_t timer;
+	int apc;
+	xnticks_t lastdate;	/* Date of the last pass (tsc). */
+	xnticks_t period;	/* Duration of the last period (tsc). */
+	xnticks_t load[XNARCH_NR_CPUS]; /* Per-CPU load over the last period. */
+	unsigned long passes;
+	unsigned long migrations;
+	struct xnsched_balance_rec {
+		char name[XNOBJECT_NAME_LEN];
+		int from, to;
+		xnticks_t load;
+		xnticks_t period;
+	} log[XNSCHED_BALANCE_LOGSZ];
+	int logpos;
+} balancer = {
+	.apc = -1,
+};
+
+static inline int xnsched_balance_eligible(struct xnthread *thread,
+					   struct xnsched *dst)
 {
-	int prio;
+	if ((xnthread_state_flags(thread) & (XNBALANCE|XNROOT|XNDORMANT|
+					     XNZOMBIE|XNMIGRATE|XNLOCK))
+	    != XNBALANCE)
+		return 0;
 
-	q->elems = 0;
-	q->loprio = loprio;
-	q->hiprio = hiprio;
-	q->himap = 0;
-	memset(&q->lomap, 0, sizeof(q->lomap));
+	/* Hard-pinned threads never have any alternate CPU. */
+	if (!xnarch_cpu_isset(xnsched_cpu(dst), thread->lb_affinity))
+		return 0;
 
-	for (prio = 0; prio < XNSCHED_MLQ_LEVELS; prio++)
-		initq(&q->queue[prio]);
+	if (xnthread_test_state(thread, XNSHADOW))
+		/* Skip shadows which are already on their way. */
+		return !xnthread_test_info(thread, XNAFFSET);
 
-	XENO_ASSERT(QUEUES,
-		    hiprio - loprio + 1 < XNSCHED_MLQ_LEVELS,
-		    xnpod_fatal("priority range [%d..%d] is beyond multi-level "
-				"queue indexing capabilities",
-				loprio, hiprio));
+	if (thread == thread->sched->curr)
+		return 0;
+#ifdef CONFIG_XENO_HW_FPU
+	/* The FPU context may still live in the source CPU. */
+	if (thread == thread->sched->fpuholder)
+		return 0;
+#endif /* CONFIG_XENO_HW_FPU */
+	/* Queued timers may only be moved from their own CPU. */
+	if ((xntimer_running_p(&thread->rtimer) &&
+	     thread->rtimer.sched != xnpod_current_sched()) ||
+	    (xntimer_running_p(&thread->ptimer) &&
+	     thread->ptimer.sched != xnpod_current_sched()))
+		return 0;
+
+	return 1;
 }
 
-void addmlq(struct xnsched_mlq *q,
-	    struct xnpholder *h, int idx, int lifo)
+static int xnsched_balance_move(struct xnthread *thread, struct xnsched *dst)
 {
-	struct xnqueue *queue = &q->queue[idx];
-	int hi = idx / BITS_PER_LONG;
-	int lo = idx % BITS_PER_LONG;
+	struct xnsched_balance_rec *rec;
+	int ret;
 
-	if (lifo)
-		prependq(queue, &h->plink);
-	else
-		appendq(queue, &h->plink);
+	if (!xnthread_test_state(thread, XNSHADOW)) {
+		/*
+		 * xnsched_balance_eligible() made sure the timers are
+		 * movable, but do not leave the thread behind them if
+		 * this ever changes: a timer firing on another CPU
+		 * than its thread is harmless, a lost migration is not.
+		 */
+		ret = xntimer_migrate(&thread->rtimer, dst);
+		if (ret == 0)
+			ret = xntimer_migrate(&thread->ptimer, dst);
+		if (ret)
+			return ret;
+	}
 
-	h->prio = idx;
-	q->elems++;
-	__setbits(q->himap, 1UL << hi);
-	__setbits(q->lomap[hi], 1UL << lo);
+	rec = &balancer.log[balancer.logpos];
+	balancer.logpos = (balancer.logpos + 1) % XNSCHED_BALANCE_LOGSZ;
+	memcpy(rec->name, thread->name, sizeof(rec->name));
+	rec->from = xnsched_cpu(thread->sched);
+	rec->to = xnsched_cpu(dst);
+	rec->load = thread->lb_load;
+	rec->period = balancer.period;
+	balancer.migrations++;
+
+	trace_mark(xn_nucleus, thread_balance,
+		   "thread %p thread_name %s cpu %d",
+		   thread, xnthread_name(thread), rec->to);
+
+	if (xnthread_test_state(thread, XNSHADOW)) {
+		/*
+		 * A shadow may not change CPU behind the back of its
+		 * Linux mate. Narrow its affinity and let the relax
+		 * path apply it to the Linux task; the gatekeeper of
+		 * the new CPU will then take over when the shadow
+		 * switches back to primary mode.
+		 */
+		thread->affinity = xnarch_cpumask_of_cpu(xnsched_cpu(dst));
+		xnthread_set_info(thread, XNAFFSET);
+		return 0;
+	}
+
+	xnsched_migrate_passive(thread, dst);
+	xnstat_exectime_reset_stats(&thread->stat.lastperiod);
+
+	return 0;
 }
 
-void removemlq(struct xnsched_mlq *q, struct xnpholder *h)
+static void xnsched_balance_pass(void *cookie)
 {
-	int idx = h->prio;
-	struct xnqueue *queue = &q->queue[idx];
+	struct xnthread *thread, *victim;
+	xnticks_t now, exec, imbalance;
+	struct xnsched *sched, *src, *dst;
+	struct xnholder *h;
+	int cpu;
+	spl_t s;
 
-	q->elems--;
+	xnlock_get_irqsave(&nklock, s);
+
+	now = xnstat_exectime_now();
+	balancer.period = now - balancer.lastdate;
+	balancer.lastdate = now;
+	balancer.passes++;
+
+	for (cpu = 0; cpu < xnarch_num_online_cpus(); cpu++)
+		balancer.load[cpu] = 0;
+
+	for (h = getheadq(&nkpod->threadq); h; h = nextq(&nkpod->threadq, h)) {
+		thread = link2thread(h, glink);
+		if (xnthread_test_state(thread, XNROOT))
+			continue;
 
-	removeq(queue, &h->plink);
+		sched = thread->sched;
+		exec = xnstat_exectime_get_total(&thread->stat.account);
+		if (xnstat_exectime_get_current(sched) == &thread->stat.account)
+			exec += now - xnstat_exectime_get_last_switch(sched);
+
+		thread->lb_load = exec >= thread->lb_lastexec ?
+			exec - thread->lb_lastexec : 0;
+		thread->lb_lastexec = exec;
+
+		/* Charge in-flight shadows to their destination CPU. */
+		if (xnthread_test_info(thread, XNAFFSET))
+			cpu = xnarch_first_cpu(thread->affinity);
+		else
+			cpu = xnsched_cpu(sched);
 
-	if (emptyq_p(queue)) {
-		int hi = idx / BITS_PER_LONG;
-		int lo = idx % BITS_PER_LONG;
-		__clrbits(q->lomap[hi], 1UL << lo);
-		if (q->lomap[hi] == 0)
-			__clrbits(q->himap, 1UL << hi);
+		balancer.load[cpu] += thread->lb_load;
 	}
+
+	src = dst = NULL;
+
+	for (cpu = 0; cpu < xnarch_num_online_cpus(); cpu++) {
+		if (!xnarch_cpu_supported(cpu) ||
+		    !xnarch_cpu_isset(cpu, nkaffinity))
+			continue;
+		sched = xnpod_sched_slot(cpu);
+		if (src == NULL || balancer.load[cpu] > balancer.load[xnsched_cpu(src)])
+			src = sched;
+		if (dst == NULL || balancer.load[cpu] < balancer.load[xnsched_cpu(dst)])
+			dst = sched;
+	}
+
+	if (src == dst)
+		goto unlock_and_exit;
+
+	imbalance = balancer.load[xnsched_cpu(src)] - balancer.load[xnsched_cpu(dst)];
+	if (imbalance * 100 <
+	    balancer.period * CONFIG_XENO_OPT_SCHED_BALANCE_THRESHOLD)
+		goto unlock_and_exit;
+
+	victim = NULL;
+
+	for (h = getheadq(&nkpod->threadq); h; h = nextq(&nkpod->threadq, h)) {
+		thread = link2thread(h, glink);
+		if (thread->sched != src ||
+		    thread->lb_load == 0 ||
+		    thread->lb_load > (imbalance >> 1) ||
+		    !xnsched_balance_eligible(thread, dst))
+			continue;
+		if (victim == NULL || thread->lb_load > victim->lb_load)
+			victim = thread;
+	}
+
+	if (victim && xnsched_balance_move(victim, dst) == 0)
+		xnpod_schedule();
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
 }
 
-struct xnpholder *findmlqh(struct xnsched_mlq *q, int prio)
+static void xnsched_balance_handler(struct xntimer *timer)
 {
-	struct xnqueue *queue = &q->queue[indexmlq(q, prio)];
-	return (struct xnpholder *)getheadq(queue);
+	__rthal_apc_schedule(balancer.apc);
 }
 
-struct xnpholder *getheadmlq(struct xnsched_mlq *q)
+int xnsched_balance_init(void)
 {
-	struct xnqueue *queue;
-	struct xnpholder *h;
+	xnticks_t period;
+	spl_t s;
 
-	if (emptymlq_p(q))
-		return NULL;
+	balancer.apc = rthal_apc_alloc("sched_balance",
+				       &xnsched_balance_pass, NULL);
+	if (balancer.apc < 0)
+		return balancer.apc;
 
-	queue = &q->queue[ffsmlq(q)];
-	h = (struct xnpholder *)getheadq(queue);
+	period = CONFIG_XENO_OPT_SCHED_BALANCE_PERIOD * 1000000ULL;
 
-	XENO_ASSERT(QUEUES, h,
-		    xnpod_fatal
-		    ("corrupted multi-level queue, qslot=%p at %s:%d", q,
-		     __FILE__, __LINE__);
-		);
+	xnlock_get_irqsave(&nklock, s);
+	balancer.lastdate = xnstat_exectime_now();
+	xntimer_init_noblock(&balancer.timer, &nktbase,
+			     xnsched_balance_handler);
+	xntimer_set_name(&balancer.timer, "[balancer]");
+	xntimer_set_priority(&balancer.timer, XNTIMER_LOPRIO);
+	xntimer_set_slack(&balancer.timer, period >> 2);
+	xntimer_start(&balancer.timer, period, period, XN_RELATIVE);
+	xnlock_put_irqrestore(&nklock, s);
 
-	return h;
+	return 0;
 }
 
-struct xnpholder *getmlq(struct xnsched_mlq *q)
+void xnsched_balance_cleanup(void)
 {
-	struct xnqueue *queue;
-	struct xnholder *h;
-	int idx, hi, lo;
+	if (balancer.apc < 0)
+		return;
+
+	xntimer_destroy(&balancer.timer);
+	rthal_apc_free(balancer.apc);
+	balancer.apc = -1;
+}
 
-	if (emptymlq_p(q))
-		return NULL;
+#endif /* CONFIG_XENO_OPT_SCHED_BALANCE */
 
-	idx = ffsmlq(q);
-	queue = &q->queue[idx];
-	h = getq(queue);
+#ifdef CONFIG_XENO_OPT_SCALABLE_SCHED
 
-	XENO_ASSERT(QUEUES, h,
-		    xnpod_fatal
-		    ("corrupted multi-level queue, qslot=%p at %s:%d", q,
-		     __FILE__, __LINE__);
-	    );
+void initmlq(struct xnsched_mlq *q, int loprio, int hiprio)
+{
+	int prio;
 
-	q->elems--;
+	q->elems = 0;
+	q->loprio = loprio;
+	q->hiprio = hiprio;
+	q->himap = 0;
+	memset(&q->lomap, 0, sizeof(q->lomap));
 
-	if (emptyq_p(queue)) {
-		hi = idx / BITS_PER_LONG;
-		lo = idx % BITS_PER_LONG;
-		__clrbits(q->lomap[hi], 1UL << lo);
-		if (q->lomap[hi] == 0)
-			__clrbits(q->himap, 1UL << hi);
-	}
+	for (prio = 0; prio < XNSCHED_MLQ_LEVELS; prio++)
+		inith(&q->heads[prio]);
 
-	return (struct xnpholder *)h;
+	XENO_ASSERT(QUEUES,
+		    hiprio - loprio + 1 < XNSCHED_MLQ_LEVELS,
+		    xnpod_fatal("priority range [%d..%d] is beyond multi-level "
+				"queue indexing capabilities",
+				loprio, hiprio));
+}
+
+struct xnpholder *findmlqh(struct xnsched_mlq *q, int prio)
+{
+	struct xnholder *head = &q->heads[indexmlq(q, prio)];
+	return head->next == head ? NULL : (struct xnpholder *)head->next;
 }
 
 struct xnpholder *nextmlq(struct xnsched_mlq *q, struct xnpholder *h)
 {
 	unsigned long hibits, lobits;
 	int idx = h->prio, hi, lo;
-	struct xnqueue *queue;
-	struct xnholder *nh;
+	struct xnholder *head, *nh;
 
 	hi = idx / BITS_PER_LONG;
 	lo = idx % BITS_PER_LONG;
@@ -663,12 +1187,10 @@ struct xnpholder *nextmlq(struct xnsched_mlq *q, struct xnpholder *h)
 	hibits = q->himap >> hi;
 
 	for (;;) {
-		queue = &q->queue[idx];
-		if (!emptyq_p(queue)) {
-			nh = h ? nextq(queue, &h->plink) : getheadq(queue);
-			if (nh)
-				return (struct xnpholder *)nh;
-		}
+		head = &q->heads[idx];
+		nh = h ? h->plink.next : head->next;
+		if (nh != head)
+			return (struct xnpholder *)nh;
 		for (;;) {
 			lobits >>= 1;
 			if (lobits == 0) {
@@ -695,8 +1217,37 @@ struct xnpholder *nextmlq(struct xnsched_mlq *q, struct xnpholder *h)
 
 static struct xnvfile_directory schedclass_vfroot;
 
+/*
+ * Find the thread following the last one collected, after the thread
+ * list changed while a vfile was scanning it. Threads are queued in
+ * creation order, i.e. by increasing ID tag (root threads first, all
+ * tagged zero), so unless the last thread went away in the meantime,
+ * we may pick the first thread created after it.
+ */
+static struct xnholder *vfile_resume_threadq(struct xnholder *last,
+					     unsigned int idtag)
+{
+	struct xnthread *thread;
+	struct xnholder *h;
+
+	if (last == NULL)
+		return getheadq(&nkpod->threadq);
+
+	for (h = getheadq(&nkpod->threadq); h; h = nextq(&nkpod->threadq, h)) {
+		thread = link2thread(h, glink);
+		if (h == last && thread->idtag == idtag)
+			return nextq(&nkpod->threadq, h);
+		if (thread->idtag > idtag)
+			break;
+	}
+
+	return h;
+}
+
 struct vfile_sched_priv {
 	struct xnholder *curr;
+	struct xnholder *last;
+	unsigned int last_idtag;
 	xnticks_t start_time;
 };
 
@@ -727,6 +1278,7 @@ static int vfile_sched_rewind(struct xnvfile_snapshot_iterator *it)
 	struct vfile_sched_priv *priv = xnvfile_iterator_priv(it);
 
 	priv->curr = getheadq(&nkpod->threadq);
+	priv->last = NULL;
 	priv->start_time = xntbase_get_jiffies(&nktbase);
 
 	return countq(&nkpod->threadq);
@@ -743,6 +1295,8 @@ static int vfile_sched_next(struct xnvfile_snapshot_iterator *it, void *data)
 		return 0;	/* All done. */
 
 	thread = link2thread(priv->curr, glink);
+	priv->last = priv->curr;
+	priv->last_idtag = thread->idtag;
 	priv->curr = nextq(&nkpod->threadq, priv->curr);
 
 	p->cpu = xnsched_cpu(thread->sched);
@@ -768,7 +1322,7 @@ static int vfile_sched_next(struct xnvfile_snapshot_iterator *it, void *data)
 	 * go through the vfile interface anyway?
 	 */
 	if (period > 0 && period < timeout &&
-	    !xntimer_running_p(&thread->rtimer))
+	    !xnthread_rtimer_running_p(thread))
 		timeout = period;
 	p->timeout = timeout;
 	p->periodic = xntbase_periodic_p(xnthread_time_base(thread));
@@ -776,6 +1330,15 @@ static int vfile_sched_next(struct xnvfile_snapshot_iterator *it, void *data)
 	return 1;
 }
 
+static int vfile_sched_resume(struct xnvfile_snapshot_iterator *it)
+{
+	struct vfile_sched_priv *priv = xnvfile_iterator_priv(it);
+
+	priv->curr = vfile_resume_threadq(priv->last, priv->last_idtag);
+
+	return 0;
+}
+
 static int vfile_sched_show(struct xnvfile_snapshot_iterator *it, void *data)
 {
 	struct vfile_sched_data *p = data;
@@ -814,6 +1377,7 @@ static int vfile_sched_show(struct xnvfile_snapshot_iterator *it, void *data)
 static struct xnvfile_snapshot_ops vfile_sched_ops = {
 	.rewind = vfile_sched_rewind,
 	.next = vfile_sched_next,
+	.resume = vfile_sched_resume,
 	.show = vfile_sched_show,
 };
 
@@ -821,8 +1385,14 @@ static struct xnvfile_snapshot_ops vfile_sched_ops = {
 
 struct vfile_stat_priv {
 	int irq;
+	int ipi;
 	struct xnholder *curr;
+	struct xnholder *last;
+	unsigned int last_idtag;
 	struct xnintr_iterator intr_it;
+	int intr_stale;
+	xnticks_t date;
+	int listrev;
 };
 
 struct vfile_stat_data {
@@ -845,6 +1415,7 @@ static struct xnvfile_snapshot stat_vfile = {
 	.datasz = sizeof(struct vfile_stat_data),
 	.tag = &nkpod_struct.threadlist_tag,
 	.ops = &vfile_stat_ops,
+	.flags = XNVFILE_SNAPSHOT_DELTA,
 };
 
 static int vfile_stat_rewind(struct xnvfile_snapshot_iterator *it)
@@ -857,8 +1428,17 @@ static int vfile_stat_rewind(struct xnvfile_snapshot_iterator *it)
 	 * grouped under a pseudo-thread.
 	 */
 	priv->curr = getheadq(&nkpod->threadq);
+	priv->last = NULL;
 	priv->irq = 0;
+	priv->ipi = 0;
+	priv->intr_stale = 0;
+	priv->date = xnstat_exectime_now();
+	priv->listrev = it->vfile->tag->rev;
 	irqnr = xnintr_query_init(&priv->intr_it) * XNARCH_NR_CPUS;
+#ifdef CONFIG_SMP
+	/* Two pseudo-threads per CPU count the rescheduling IPIs. */
+	irqnr += 2 * XNARCH_NR_CPUS;
+#endif /* CONFIG_SMP */
 
 	return irqnr + countq(&nkpod->threadq);
 }
@@ -880,9 +1460,21 @@ static int vfile_stat_next(struct xnvfile_snapshot_iterator *it, void *data)
 		goto scan_irqs;
 
 	thread = link2thread(priv->curr, glink);
+	priv->last = priv->curr;
+	priv->last_idtag = thread->idtag;
 	priv->curr = nextq(&nkpod->threadq, priv->curr);
 
 	sched = thread->sched;
+	/*
+	 * Delta query: skip the threads which neither ran nor were
+	 * created since the given date. Their counters and execution
+	 * time only change while they run.
+	 */
+	if (it->delta && thread != sched->curr &&
+	    thread->stat.account.last < it->since &&
+	    thread->stat.account.start < it->since)
+		return VFILE_SEQ_SKIP;
+
 	p->cpu = xnsched_cpu(sched);
 	p->pid = xnthread_user_pid(thread);
 	memcpy(p->name, thread->name, sizeof(p->name));
@@ -908,12 +1500,14 @@ static int vfile_stat_next(struct xnvfile_snapshot_iterator *it, void *data)
 
 scan_irqs:
 	if (priv->irq >= XNARCH_NR_IRQS)
-		return 0;	/* All done. */
+		goto scan_ipis;
 
 	ret = xnintr_query_next(priv->irq, &priv->intr_it, p->name);
 	if (ret) {
-		if (ret == -EAGAIN)
+		if (ret == -EAGAIN) {
+			priv->intr_stale = 1;
 			xnvfile_touch(it->vfile); /* force rewind. */
+		}
 		priv->irq++;
 		return VFILE_SEQ_SKIP;
 	}
@@ -932,13 +1526,74 @@ scan_irqs:
 	p->pf = 0;
 
 	return 1;
+
+scan_ipis:
+#ifdef CONFIG_SMP
+	/*
+	 * Rescheduling IPIs sent from each CPU, then those saved
+	 * because the target had one in flight already.
+	 */
+	while (priv->ipi < 2 * XNARCH_NR_CPUS) {
+		int cpu = priv->ipi >> 1, skipped = priv->ipi & 1;
+
+		priv->ipi++;
+		if (cpu >= xnarch_num_online_cpus() ||
+		    !xnarch_cpu_supported(cpu))
+			continue;
+
+		sched = xnpod_sched_slot(cpu);
+		p->cpu = cpu;
+		p->csw = skipped ? xnstat_counter_get(&sched->ipiskip) :
+			xnstat_counter_get(&sched->ipisent);
+		strcpy(p->name, skipped ? "IPI-skipped" : "IPI-sent");
+		p->exectime_period = 0;
+		p->account_period = 0;
+		p->exectime_total = 0;
+		p->pid = 0;
+		p->state = 0;
+		p->ssw = 0;
+		p->pf = 0;
+
+		return 1;
+	}
+#endif /* CONFIG_SMP */
+
+	return 0;	/* All done. */
+}
+
+static int vfile_stat_resume(struct xnvfile_snapshot_iterator *it)
+{
+	struct vfile_stat_priv *priv = xnvfile_iterator_priv(it);
+
+	if (priv->curr == NULL) {
+		/* Done with threads, restart the IRQ scan if stale. */
+		if (priv->intr_stale) {
+			xnintr_query_init(&priv->intr_it);
+			priv->intr_stale = 0;
+		}
+		return 0;
+	}
+
+	priv->curr = vfile_resume_threadq(priv->last, priv->last_idtag);
+
+	return 0;
 }
 
 static int vfile_stat_show(struct xnvfile_snapshot_iterator *it, void *data)
 {
+	struct vfile_stat_priv *priv = xnvfile_iterator_priv(it);
 	struct vfile_stat_data *p = data;
 	int usage = 0;
 
+	/*
+	 * Delta readers get the date to pass with their next query,
+	 * and the thread list revision, which changes whenever a
+	 * thread is created or deleted.
+	 */
+	if (p == NULL && it->delta)
+		xnvfile_printf(it, "REVISION %Lu %d\n",
+			       (unsigned long long)priv->date, priv->listrev);
+
 	if (p == NULL)
 		xnvfile_printf(it,
 			       "%-3s  %-6s %-10s %-10s %-4s  %-8s  %5s"
@@ -985,6 +1640,7 @@ static int vfile_acct_show(struct xnvfile_snapshot_iterator *it, void *data)
 static struct xnvfile_snapshot_ops vfile_stat_ops = {
 	.rewind = vfile_stat_rewind,
 	.next = vfile_stat_next,
+	.resume = vfile_stat_resume,
 	.show = vfile_stat_show,
 };
 
@@ -1004,11 +1660,219 @@ static struct xnvfile_snapshot acct_vfile = {
 static struct xnvfile_snapshot_ops vfile_acct_ops = {
 	.rewind = vfile_stat_rewind,
 	.next = vfile_stat_next,
+	.resume = vfile_stat_resume,
 	.show = vfile_acct_show,
 };
 
+#ifdef CONFIG_XENO_OPT_STATS_SYNCH
+
+struct vfile_synchstat_priv {
+	struct xnholder *curr;
+	struct xnholder *last;
+	unsigned int last_idtag;
+};
+
+struct vfile_synchstat_data {
+	int cpu;
+	pid_t pid;
+	unsigned long acquires;
+	unsigned long sleeps;
+	unsigned long boosts;
+	unsigned long chain_max;
+	xnticks_t chain_time;
+	char name[XNOBJECT_NAME_LEN];
+};
+
+static struct xnvfile_snapshot_ops vfile_synchstat_ops;
+
+static struct xnvfile_snapshot synchstat_vfile = {
+	.privsz = sizeof(struct vfile_synchstat_priv),
+	.datasz = sizeof(struct vfile_synchstat_data),
+	.tag = &nkpod_struct.threadlist_tag,
+	.ops = &vfile_synchstat_ops,
+};
+
+static int vfile_synchstat_rewind(struct xnvfile_snapshot_iterator *it)
+{
+	struct vfile_synchstat_priv *priv = xnvfile_iterator_priv(it);
+
+	priv->curr = getheadq(&nkpod->threadq);
+	priv->last = NULL;
+
+	return countq(&nkpod->threadq);
+}
+
+static int vfile_synchstat_next(struct xnvfile_snapshot_iterator *it,
+				void *data)
+{
+	struct vfile_synchstat_priv *priv = xnvfile_iterator_priv(it);
+	struct vfile_synchstat_data *p = data;
+	struct xnthread *thread;
+
+	if (priv->curr == NULL)
+		return 0;	/* All done. */
+
+	thread = link2thread(priv->curr, glink);
+	priv->last = priv->curr;
+	priv->last_idtag = thread->idtag;
+	priv->curr = nextq(&nkpod->threadq, priv->curr);
+
+	p->cpu = xnsched_cpu(thread->sched);
+	p->pid = xnthread_user_pid(thread);
+	p->acquires = thread->stat.acquires;
+	p->sleeps = thread->stat.sleeps;
+	p->boosts = thread->stat.boosts;
+	p->chain_max = thread->stat.chain_max;
+	p->chain_time = thread->stat.chain_time;
+	memcpy(p->name, thread->name, sizeof(p->name));
+
+	return 1;
+}
+
+static int vfile_synchstat_resume(struct xnvfile_snapshot_iterator *it)
+{
+	struct vfile_synchstat_priv *priv = xnvfile_iterator_priv(it);
+
+	priv->curr = vfile_resume_threadq(priv->last, priv->last_idtag);
+
+	return 0;
+}
+
+static int vfile_synchstat_show(struct xnvfile_snapshot_iterator *it,
+				void *data)
+{
+	struct vfile_synchstat_data *p = data;
+
+	if (p == NULL)
+		xnvfile_printf(it, "%-3s  %-6s %-10s %-10s %-10s %-5s %-9s %s\n",
+			       "CPU", "PID", "ACQUIRE", "SLEEP", "BOOST",
+			       "CHAIN", "WALK(ns)", "NAME");
+	else
+		xnvfile_printf(it, "%3u  %-6d %-10lu %-10lu %-10lu %-5lu %-9llu %s\n",
+			       p->cpu, p->pid, p->acquires, p->sleeps,
+			       p->boosts, p->chain_max,
+			       (unsigned long long)xnarch_tsc_to_ns(p->chain_time),
+			       p->name);
+
+	return 0;
+}
+
+static struct xnvfile_snapshot_ops vfile_synchstat_ops = {
+	.rewind = vfile_synchstat_rewind,
+	.next = vfile_synchstat_next,
+	.resume = vfile_synchstat_resume,
+	.show = vfile_synchstat_show,
+};
+
+#endif /* CONFIG_XENO_OPT_STATS_SYNCH */
+
+static int sampling_vfile_show(struct xnvfile_regular_iterator *it,
+			       void *data)
+{
+	xnvfile_printf(it, "%Lu\n",
+		       xnarch_ulldiv(xnstat_sampling_period, 1000, NULL));
+	return 0;
+}
+
+static ssize_t sampling_vfile_store(struct xnvfile_input *input)
+{
+	ssize_t ret;
+	long val;
+	int err;
+
+	ret = xnvfile_get_integer(input, &val);
+	if (ret < 0)
+		return ret;
+
+	if (val < 0)
+		return -EINVAL;
+
+	err = xnsched_set_sampling((xnticks_t)val * 1000);
+	if (err)
+		return err;
+
+	return ret;
+}
+
+static struct xnvfile_regular_ops sampling_vfile_ops = {
+	.show = sampling_vfile_show,
+	.store = sampling_vfile_store,
+};
+
+static struct xnvfile_regular sampling_vfile = {
+	.ops = &sampling_vfile_ops,
+};
+
 #endif /* CONFIG_XENO_OPT_STATS */
 
+#ifdef CONFIG_XENO_OPT_SCHED_BALANCE
+
+static unsigned long balance_percent(xnticks_t load, xnticks_t period)
+{
+	unsigned long long load_us, period_us;
+
+	load_us = xnarch_ulldiv(xnarch_tsc_to_ns(load), 1000, NULL);
+	period_us = xnarch_ulldiv(xnarch_tsc_to_ns(period), 1000, NULL);
+	if (period_us == 0)
+		return 0;
+
+	return xnarch_ulldiv(load_us * 100, (unsigned long)period_us, NULL);
+}
+
+static int balance_vfile_show(struct xnvfile_regular_iterator *it, void *data)
+{
+	struct xnsched_balance_rec rec;
+	unsigned long passes, migrations;
+	xnticks_t load, period;
+	int cpu, n, pos;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	passes = balancer.passes;
+	migrations = balancer.migrations;
+	xnlock_put_irqrestore(&nklock, s);
+
+	xnvfile_printf(it, "PASSES=%lu MIGRATIONS=%lu\n", passes, migrations);
+	xnvfile_printf(it, "%-3s  %s\n", "CPU", "LOAD%");
+
+	for (cpu = 0; cpu < xnarch_num_online_cpus(); cpu++) {
+		if (!xnarch_cpu_supported(cpu))
+			continue;
+		xnlock_get_irqsave(&nklock, s);
+		load = balancer.load[cpu];
+		period = balancer.period;
+		xnlock_put_irqrestore(&nklock, s);
+		xnvfile_printf(it, "%3u  %5lu\n",
+			       cpu, balance_percent(load, period));
+	}
+
+	xnvfile_printf(it, "%-4s %-4s %-5s  %s\n", "FROM", "TO", "LOAD%", "NAME");
+
+	/* Most recent decision last. */
+	for (n = 0; n < XNSCHED_BALANCE_LOGSZ; n++) {
+		xnlock_get_irqsave(&nklock, s);
+		pos = (balancer.logpos + n) % XNSCHED_BALANCE_LOGSZ;
+		rec = balancer.log[pos];
+		xnlock_put_irqrestore(&nklock, s);
+		if (rec.period == 0)
+			continue;
+		xnvfile_printf(it, "%4d %4d %5lu  %s\n", rec.from, rec.to,
+			       balance_percent(rec.load, rec.period), rec.name);
+	}
+
+	return 0;
+}
+
+static struct xnvfile_regular_ops balance_vfile_ops = {
+	.show = balance_vfile_show,
+};
+
+static struct xnvfile_regular balance_vfile = {
+	.ops = &balance_vfile_ops,
+};
+
+#endif /* CONFIG_XENO_OPT_SCHED_BALANCE */
+
 int xnsched_init_proc(void)
 {
 	struct xnsched_class *p;
@@ -1037,8 +1901,22 @@ int xnsched_init_proc(void)
 	ret = xnvfile_init_snapshot("acct", &acct_vfile, &nkvfroot);
 	if (ret)
 		return ret;
+	ret = xnvfile_init_regular("sampling", &sampling_vfile, &nkvfroot);
+	if (ret)
+		return ret;
+#ifdef CONFIG_XENO_OPT_STATS_SYNCH
+	ret = xnvfile_init_snapshot("synchstat", &synchstat_vfile, &nkvfroot);
+	if (ret)
+		return ret;
+#endif /* CONFIG_XENO_OPT_STATS_SYNCH */
 #endif /* CONFIG_XENO_OPT_STATS */
 
+#ifdef CONFIG_XENO_OPT_SCHED_BALANCE
+	ret = xnvfile_init_regular("balance", &balance_vfile, &nkvfroot);
+	if (ret)
+		return ret;
+#endif /* CONFIG_XENO_OPT_SCHED_BALANCE */
+
 	return 0;
 }
 
@@ -1051,7 +1929,14 @@ void xnsched_cleanup_proc(void)
 			p->sched_cleanup_vfile(p);
 	}
 
+#ifdef CONFIG_XENO_OPT_SCHED_BALANCE
+	xnvfile_destroy_regular(&balance_vfile);
+#endif /* CONFIG_XENO_OPT_SCHED_BALANCE */
 #ifdef CONFIG_XENO_OPT_STATS
+#ifdef CONFIG_XENO_OPT_STATS_SYNCH
+	xnvfile_destroy_snapshot(&synchstat_vfile);
+#endif /* CONFIG_XENO_OPT_STATS_SYNCH */
+	xnvfile_destroy_regular(&sampling_vfile);
 	xnvfile_destroy_snapshot(&acct_vfile);
 	xnvfile_destroy_snapshot(&stat_vfile);
 #endif /* CONFIG_XENO_OPT_STATS */
@@ -44,6 +44,13 @@
  * - a @a struct @a xnselector structure, the selection structure,  passed by
  * the thread calling the xnselect service, where this service does all its
  * housekeeping.
+ *
+ * Bindings with pending events are also linked to a ready queue of their
+ * selector, so that xnselect_wait_ready() may return them at a cost
+ * proportional to the number of ready descriptors, instead of scanning
+ * descriptor sets. Bindings persist until unbound with xnselect_unbind(),
+ * the file descriptor is destroyed, or the selector is destroyed, which
+ * allows to implement epoll-like services with a persistent interest set.
  *@{*/
 
 #include <nucleus/heap.h>
@@ -78,6 +85,22 @@ static inline int xnselect_wakeup(struct xnselector *selector)
 	return xnsynch_flush(&selector->synchbase, 0) == XNSYNCH_RESCHED;
 }
 
+static inline void xnselect_set_ready(struct xnselect_binding *binding)
+{
+	if (!binding->ready) {
+		binding->ready = 1;
+		appendq(&binding->selector->readyq, &binding->rlink);
+	}
+}
+
+static inline void xnselect_clear_ready(struct xnselect_binding *binding)
+{
+	if (binding->ready) {
+		binding->ready = 0;
+		removeq(&binding->selector->readyq, &binding->rlink);
+	}
+}
+
 /**
  * Bind a file descriptor (represented by its @a xnselect structure) to a
  * selector block.
@@ -121,14 +144,18 @@ int xnselect_bind(struct xnselect *select_block,
 	binding->fd = select_block;
 	binding->type = type;
 	binding->bit_index = index;
+	binding->ready = 0;
+	binding->cookie = selector->cookie;
 	inith(&binding->link);
 	inith(&binding->slink);
+	inith(&binding->rlink);
 
 	appendq(&selector->bindings, &binding->slink);
 	appendq(&select_block->bindings, &binding->link);
 	__FD_SET__(index, &selector->fds[type].expected);
 	if (state) {
 		__FD_SET__(index, &selector->fds[type].pending);
+		xnselect_set_ready(binding);
 		if (xnselect_wakeup(selector))
 			xnpod_schedule();
 	} else
@@ -153,6 +180,7 @@ int __xnselect_signal(struct xnselect *select_block, unsigned state)
 
 		selector = binding->selector;
 		if (state) {
+			xnselect_set_ready(binding);
 			if (!__FD_ISSET__(binding->bit_index,
 					&selector->fds[binding->type].pending)) {
 				__FD_SET__(binding->bit_index,
@@ -160,9 +188,11 @@ int __xnselect_signal(struct xnselect *select_block, unsigned state)
 				if (xnselect_wakeup(selector))
 					resched = 1;
 			}
-		} else
+		} else {
+			xnselect_clear_ready(binding);
 			__FD_CLR__(binding->bit_index,
 				 &selector->fds[binding->type].pending);
+		}
 	}
 
 	return resched;
@@ -199,6 +229,7 @@ void xnselect_destroy(struct xnselect *select_block)
 			if (xnselect_wakeup(selector))
 				resched = 1;
 		}
+		xnselect_clear_ready(binding);
 		removeq(&selector->bindings, &binding->slink);
 		xnlock_put_irqrestore(&nklock, s);
 
@@ -292,6 +323,8 @@ int xnselector_init(struct xnselector *selector)
 		__FD_ZERO__(&selector->fds[i].pending);
 	}
 	initq(&selector->bindings);
+	initq(&selector->readyq);
+	selector->cookie = 0;
 	return 0;
 }
 EXPORT_SYMBOL_GPL(xnselector_init);
@@ -387,6 +420,157 @@ int xnselect(struct xnselector *selector,
 }
 EXPORT_SYMBOL_GPL(xnselect);
 
+/**
+ * Remove the binding of a file descriptor from a selector.
+ *
+ * @param selector the selector structure;
+ *
+ * @param type type of events (@a XNSELECT_READ, @a XNSELECT_WRITE, or @a
+ * XNSELECT_EXCEPT);
+ *
+ * @param index index of the file descriptor in the @a selector.
+ *
+ * This service must be called with nklock unlocked, by the only thread
+ * using the @a selector.
+ *
+ * @retval -ENOENT if no such binding exists;
+ * @retval 0 otherwise.
+ */
+int xnselect_unbind(struct xnselector *selector, unsigned type, unsigned index)
+{
+	struct xnselect_binding *binding;
+	xnholder_t *holder;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	for (holder = getheadq(&selector->bindings);
+	     holder; holder = nextq(&selector->bindings, holder)) {
+		binding = link2binding(holder, slink);
+		if (binding->type == type && binding->bit_index == index)
+			goto found;
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return -ENOENT;
+
+  found:
+	xnselect_clear_ready(binding);
+	removeq(&selector->bindings, &binding->slink);
+	removeq(&binding->fd->bindings, &binding->link);
+	__FD_CLR__(index, &selector->fds[type].expected);
+	__FD_CLR__(index, &selector->fds[type].pending);
+	xnlock_put_irqrestore(&nklock, s);
+
+	xnfree(binding);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(xnselect_unbind);
+
+static int collect_ready(struct xnselector *selector,
+			 struct xnselect_event *events, int maxevents)
+{
+	struct xnselect_binding *binding;
+	int count = 0, n, i;
+	xnholder_t *holder;
+
+	/*
+	 * Ready bindings are rotated to the tail of the queue once
+	 * reported, so that descriptors which remain ready do not
+	 * starve the others when more than maxevents are pending.
+	 */
+	for (n = countq(&selector->readyq); n > 0; n--) {
+		holder = getheadq(&selector->readyq);
+		binding = link2binding(holder, rlink);
+
+		for (i = 0; i < count; i++)
+			if (events[i].index == binding->bit_index)
+				break;
+
+		if (i == count) {
+			if (count == maxevents)
+				break;
+			events[i].index = binding->bit_index;
+			events[i].types = 0;
+			events[i].cookie = binding->cookie;
+			count++;
+		}
+		events[i].types |= 1 << binding->type;
+
+		removeq(&selector->readyq, holder);
+		appendq(&selector->readyq, holder);
+	}
+
+	return count;
+}
+
+/**
+ * Wait for events on the descriptors bound to a selector.
+ *
+ * Unlike xnselect(), this service does not get descriptor sets to
+ * check, but returns the events pending on any descriptor bound to
+ * the @a selector, at a cost proportional to the number of ready
+ * descriptors. It is meant for interest sets set up once, using
+ * xnselect_bind() and xnselect_unbind().
+ *
+ * @param selector the selector structure;
+ * @param events array receiving at most one event per ready descriptor;
+ * @param maxevents size of the @a events array;
+ * @param timeout the timeout, whose meaning depends on @a timeout_mode,
+ * XN_NONBLOCK with @a timeout_mode set to XN_RELATIVE means not to wait.
+ * As for xnselect(), a relative timeout restarts from scratch after
+ * spurious wakeups, an absolute one should be preferred;
+ * @param timeout_mode the mode of @a timeout.
+ *
+ * @retval -EINVAL if @a maxevents is not strictly positive;
+ * @retval -EINTR if @a xnselect_wait_ready was interrupted while waiting;
+ * @retval 0 in case of timeout.
+ * @retval the number of events stored in @a events.
+ */
+int xnselect_wait_ready(struct xnselector *selector,
+			struct xnselect_event *events,
+			int maxevents,
+			xnticks_t timeout, xntmode_t timeout_mode)
+{
+	xnthread_t *thread;
+	int ret = 0;
+	spl_t s;
+
+	if (maxevents <= 0)
+		return -EINVAL;
+
+	thread = xnpod_current_thread();
+
+	xnlock_get_irqsave(&nklock, s);
+
+	while (emptyq_p(&selector->readyq)) {
+		if (timeout == XN_NONBLOCK && timeout_mode == XN_RELATIVE)
+			goto out;
+
+		xnsynch_sleep_on(&selector->synchbase, timeout, timeout_mode);
+
+		if (!emptyq_p(&selector->readyq))
+			break;
+
+		if (xnthread_test_info(thread, XNBREAK)) {
+			ret = -EINTR;
+			goto out;
+		}
+
+		if (xnthread_test_info(thread, XNTIMEO))
+			goto out;
+	}
+
+	ret = collect_ready(selector, events, maxevents);
+  out:
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(xnselect_wait_ready);
+
 /**
  * Destroy a selector block.
  *
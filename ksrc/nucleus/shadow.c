@@ -53,6 +53,9 @@
 #include <nucleus/stat.h>
 #include <nucleus/sys_ppd.h>
 #include <nucleus/vdso.h>
+#include <nucleus/evtrace.h>
+#include <nucleus/statmap.h>
+#include <nucleus/profile.h>
 #include <asm/xenomai/features.h>
 #include <asm/xenomai/syscall.h>
 #include <asm/xenomai/bits/shadow.h>
@@ -71,14 +74,68 @@ EXPORT_SYMBOL_GPL(nkmmptd);
 #define xnshadow_mmptd(t) ((t)->ptd[nkmmptd])
 #define xnshadow_mm(t) ((struct mm_struct *)xnshadow_mmptd(t))
 
+#ifdef CONFIG_XENO_OPT_STATS_SYSCALL
+struct xnsyscall_stat {
+	unsigned long calls;
+	xnticks_t total;	/* TSC */
+};
+#endif /* CONFIG_XENO_OPT_STATS_SYSCALL */
+
 struct xnskin_slot {
 	struct xnskin_props *props;
 	atomic_counter_t refcnt;
 #ifdef CONFIG_XENO_OPT_VFILE
 	struct xnvfile_regular vfile;
 #endif
+#ifdef CONFIG_XENO_OPT_STATS_SYSCALL
+	struct xnsyscall_stat *sysstat; /* One per call number. */
+#endif
 } muxtable[XENOMAI_MUX_NR];
 
+#ifdef CONFIG_XENO_OPT_STATS_SYSCALL
+
+static inline xnticks_t syscall_stat_start(void)
+{
+	return xnarch_get_cpu_tsc();
+}
+
+/*
+ * Counters are updated locklessly from the syscall path, so figures
+ * may be slightly off on SMP when several CPUs issue the same call
+ * concurrently. This is acceptable for profiling purposes.
+ */
+static void syscall_stat_end(int muxid, int muxop, xnticks_t start)
+{
+	struct xnsyscall_stat *stat = muxtable[muxid].sysstat;
+	xnticks_t delta = xnarch_get_cpu_tsc() - start;
+	struct xnthread *thread;
+
+	if (stat) {
+		stat[muxop].calls++;
+		stat[muxop].total += delta;
+	}
+
+	/* The call may have just created the shadow, look it up anew. */
+	thread = xnshadow_thread(current);
+	if (thread) {
+		thread->stat.syscalls++;
+		thread->stat.systime += delta;
+	}
+}
+
+#else /* !CONFIG_XENO_OPT_STATS_SYSCALL */
+
+static inline xnticks_t syscall_stat_start(void)
+{
+	return 0;
+}
+
+static inline void syscall_stat_end(int muxid, int muxop, xnticks_t start)
+{
+}
+
+#endif /* !CONFIG_XENO_OPT_STATS_SYSCALL */
+
 static int lostage_apc;
 
 static struct __lostagerq {
@@ -181,10 +238,50 @@ static inline void set_switch_lock_owner(struct task_struct *p)
  * scheduling class and priority of the thread leading the RPI list
  * after the removal. If no other thread is currently relaxed, the
  * root thread is moved back to the idle scheduling class.
+ *
+ * Each RPI slot counts the threads linked to its queue. Since only
+ * the local CPU may link threads to its own slot, a null count read
+ * locklessly can be trusted, which spares the RPI lock on the most
+ * frequent Linux context switches, i.e. those not involving any
+ * relaxed Xenomai thread.
  */
 
 #define rpi_p(t)	((t)->rpi != NULL)
 
+#ifdef CONFIG_XENO_OPT_STATS
+#define rpi_stat_inc(field)	(xnpod_current_sched()->rpistat.field++)
+#else
+#define rpi_stat_inc(field)	do { } while (0)
+#endif
+
+/* Must be called with the slot RPI lock held. */
+static inline struct xnthread *rpi_link(struct xnsched *sched,
+					struct xnthread *thread)
+{
+	sched->rpicount++;
+	thread->rpi = sched;
+	return xnsched_push_rpi(sched, thread);
+}
+
+static inline void rpi_unlink(struct xnthread *thread)
+{
+	thread->rpi->rpicount--;
+	xnsched_pop_rpi(thread);
+	thread->rpi = NULL;
+}
+
+static inline void rpi_lock(struct xnsched *sched, spl_t *s)
+{
+	xnlock_get_irqsave(&sched->rpilock, *s);
+	rpi_stat_inc(locked);
+}
+
+static inline void rpi_renice(struct xnsched *sched, struct xnthread *top)
+{
+	xnsched_renice_root(sched, top);
+	rpi_stat_inc(renices);
+}
+
 static void rpi_push(struct xnsched *sched, struct xnthread *thread)
 {
 	struct xnsched_class *sched_class;
@@ -200,13 +297,12 @@ static void rpi_push(struct xnsched *sched, struct xnthread *thread)
 	 */
 	if (likely(xnthread_user_task(thread)->policy == SCHED_FIFO &&
 		   !xnthread_test_state(thread, XNRPIOFF))) {
-		xnlock_get_irqsave(&sched->rpilock, s);
+		rpi_lock(sched, &s);
 
 		if (XENO_DEBUG(NUCLEUS) && rpi_p(thread))
 			xnpod_fatal("re-enqueuing a relaxed thread in the RPI queue");
 
-		top = xnsched_push_rpi(sched, thread);
-		thread->rpi = sched;
+		top = rpi_link(sched, thread);
 		prio = top->cprio;
 		sched_class = top->sched_class;
 		xnlock_put_irqrestore(&sched->rpilock, s);
@@ -218,7 +314,7 @@ static void rpi_push(struct xnsched *sched, struct xnthread *thread)
 
 	if (xnsched_root_priority(sched) != prio ||
 	    xnsched_root_class(sched) != sched_class)
-		xnsched_renice_root(sched, top);
+		rpi_renice(sched, top);
 }
 
 static void rpi_pop(struct xnthread *thread)
@@ -231,7 +327,7 @@ static void rpi_pop(struct xnthread *thread)
 
 	sched = xnpod_current_sched();
 
-	xnlock_get_irqsave(&sched->rpilock, s);
+	rpi_lock(sched, &s);
 
 	/*
 	 * Make sure we don't try to unlink a shadow which is not
@@ -239,15 +335,15 @@ static void rpi_pop(struct xnthread *thread)
 	 * hardening thread is migrated by the kernel while in flight
 	 * to the primary mode.
 	 */
-	if (likely(thread->rpi == sched)) {
-		xnsched_pop_rpi(thread);
-		thread->rpi = NULL;
-	} else if (!rpi_p(thread)) {
+	if (likely(thread->rpi == sched))
+		rpi_unlink(thread);
+	else if (!rpi_p(thread)) {
 		xnlock_put_irqrestore(&sched->rpilock, s);
 		return;
 	}
 
-	top = xnsched_peek_rpi(sched);
+	/* Being the only relaxed thread is the common case. */
+	top = sched->rpicount ? xnsched_peek_rpi(sched) : NULL;
 	if (likely(top == NULL)) {
 		prio = XNSCHED_IDLE_PRIO;
 		sched_class = &xnsched_class_idle;
@@ -261,7 +357,7 @@ static void rpi_pop(struct xnthread *thread)
 
 	if (xnsched_root_priority(sched) != prio ||
 	    xnsched_root_class(sched) != sched_class)
-		xnsched_renice_root(sched, top);
+		rpi_renice(sched, top);
 }
 
 static void rpi_update(struct xnthread *thread)
@@ -269,11 +365,10 @@ static void rpi_update(struct xnthread *thread)
 	struct xnsched *sched = xnpod_current_sched();
 	spl_t s;
 
-	xnlock_get_irqsave(&sched->rpilock, s);
+	rpi_lock(sched, &s);
 
 	if (rpi_p(thread)) {
-		xnsched_pop_rpi(thread);
-		thread->rpi = NULL;
+		rpi_unlink(thread);
 		rpi_push(sched, thread);
 	}
 
@@ -310,7 +405,8 @@ static void rpi_clear_remote(struct xnthread *thread)
 	if (unlikely(rpi == NULL))
 		return;
 
-	xnlock_get_irqsave(&rpi->rpilock, s);
+	rpi_lock(rpi, &s);
+	rpi_stat_inc(remote);
 
 	/*
 	 * The RPI slot - if present - is always valid, and won't
@@ -318,10 +414,9 @@ static void rpi_clear_remote(struct xnthread *thread)
 	 * migrate under our feet. We may grab the remote slot lock
 	 * now.
 	 */
-	xnsched_pop_rpi(thread);
-	thread->rpi = NULL;
+	rpi_unlink(thread);
 
-	if (xnsched_peek_rpi(rpi) == NULL)
+	if (rpi->rpicount == 0)
 		rcpu = xnsched_cpu(rpi);
 
 	/*
@@ -388,8 +483,13 @@ static inline void rpi_switch(struct task_struct *next_task)
 	sched = xnpod_current_sched();
 	oldprio = xnsched_root_priority(sched);
 	oldclass = xnsched_root_class(sched);
+	rpi_stat_inc(switches);
 
-	if (prev &&
+	/*
+	 * prev->rpi may only be reset remotely, so peeking at it
+	 * locklessly first is safe.
+	 */
+	if (prev && prev->rpi == sched &&
 	    current->state != TASK_RUNNING &&
 	    !xnthread_test_info(prev, XNATOMIC)) {
 		/*
@@ -404,10 +504,9 @@ static inline void rpi_switch(struct task_struct *next_task)
 		 * since this may happen if such thread immediately
 		 * resumes on the remote CPU.
 		 */
-		xnlock_get_irqsave(&sched->rpilock, s);
+		rpi_lock(sched, &s);
 		if (prev->rpi == sched) {
-			xnsched_pop_rpi(prev);
-			prev->rpi = NULL;
+			rpi_unlink(prev);
 			xnlock_put_irqrestore(&sched->rpilock, s);
 			/*
 			 * Do NOT nest the rpilock and nklock locks.
@@ -423,7 +522,16 @@ static inline void rpi_switch(struct task_struct *next_task)
 	if (next == NULL ||
 	    next_task->policy != SCHED_FIFO ||
 	    xnthread_test_state(next, XNRPIOFF)) {
-		xnlock_get_irqsave(&sched->rpilock, s);
+		if (sched->rpicount == 0) {
+			/* No relaxed thread to inherit from. */
+			rpi_stat_inc(fastpath);
+			top = NULL;
+			newprio = XNSCHED_IDLE_PRIO;
+			newclass = &xnsched_class_idle;
+			goto boost_root;
+		}
+
+		rpi_lock(sched, &s);
 
 		top = xnsched_peek_rpi(sched);
 		if (top) {
@@ -465,22 +573,23 @@ static inline void rpi_switch(struct task_struct *next_task)
 
 	if (unlikely(next->rpi == NULL)) {
 		if (!xnthread_test_state(next, XNDORMANT)) {
-			xnlock_get_irqsave(&sched->rpilock, s);
-			xnsched_push_rpi(sched, next);
-			next->rpi = sched;
+			rpi_lock(sched, &s);
+			rpi_link(sched, next);
 			xnlock_put_irqrestore(&sched->rpilock, s);
 			xnsched_resume_rpi(next);
 		}
 	} else if (unlikely(next->rpi != sched))
 		/* We hold no lock here. */
 		rpi_migrate(sched, next);
+	else
+		rpi_stat_inc(fastpath);
 
 boost_root:
 
 	if (newprio == oldprio && newclass == oldclass)
 		return;
 
-	xnsched_renice_root(sched, top);
+	rpi_renice(sched, top);
 	/*
 	 * Subtle: by downgrading the root thread priority, some
 	 * higher priority thread might have become eligible for
@@ -496,7 +605,7 @@ static inline void rpi_clear_local(struct xnthread *thread)
 	struct xnsched *sched = xnpod_current_sched();
 	if (thread == NULL &&
 	    xnsched_root_class(sched) != &xnsched_class_idle)
-		xnsched_renice_root(sched, NULL);
+		rpi_renice(sched, NULL);
 }
 
 #ifdef CONFIG_SMP
@@ -511,13 +620,13 @@ void xnshadow_rpi_check(void)
 	struct xnthread *top;
 	spl_t s;
 
-	xnlock_get_irqsave(&sched->rpilock, s);
+	rpi_lock(sched, &s);
 	__clrbits(sched->rpistatus, XNRPICK);
- 	top = xnsched_peek_rpi(sched);
+	top = sched->rpicount ? xnsched_peek_rpi(sched) : NULL;
 	xnlock_put_irqrestore(&sched->rpilock, s);
 
 	if (top == NULL && xnsched_root_class(sched) != &xnsched_class_idle)
-		xnsched_renice_root(sched, NULL);
+		rpi_renice(sched, NULL);
 }
 
 #endif	/* CONFIG_SMP */
@@ -534,8 +643,17 @@ void xnshadow_rpi_check(void)
 
 #endif /* !CONFIG_XENO_OPT_RPIDISABLE */
 
+/*
+ * All ppds of a process hash to the same bucket, so the table should
+ * have at least as many buckets as there are Xenomai processes for
+ * chains to stay short. Shadow threads mostly bypass it anyway, see
+ * xnshadow_ppd_get().
+ */
 static xnqueue_t *ppd_hash;
-#define PPD_HASH_SIZE 13
+static unsigned long ppd_hash_size = 256;
+module_param_named(ppd_hash_size, ppd_hash_size, ulong, 0444);
+MODULE_PARM_DESC(ppd_hash_size, "Number of buckets of the per-process data hash table");
+#define PPD_HASH_SIZE ppd_hash_size
 
 union xnshadow_ppd_hkey {
 	struct mm_struct *mm;
@@ -695,6 +813,8 @@ void __init xnheap_init_vdso(void)
 		xnpod_fatal("Xenomai: cannot allocate memory for xnvdso!\n");
 
 	nkvdso->features = XNVDSO_FEATURES;
+	xnseqcount_init(&nkvdso->clock_data.seqcount);
+	nkvdso->clock_data.wallclock_offset = 0;
 }
 
 static inline void request_syscall_restart(xnthread_t *thread,
@@ -916,6 +1036,118 @@ static int gatekeeper_thread(void *data)
 	return 0;
 }
 
+#ifdef CONFIG_XENO_OPT_DIRECT_HARDEN
+
+/*
+ * Direct harden: instead of waking up the gatekeeper, the thread
+ * switching to primary mode is picked by do_schedule_event() as
+ * Linux switches it out, then resumed from the rescheduling IPI
+ * the CPU posts to itself. We may not resume it from the
+ * scheduler hook, since its Linux context is not saved yet; the
+ * IPI is processed once the hw interrupts are re-enabled in the
+ * tail code of the Linux context switch, over the incoming task.
+ */
+static void post_harden(struct xnthread *thread)
+{
+	struct xnsched *sched = xnpod_current_sched();
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	sched->gkdirect = thread;
+	xnlock_put_irqrestore(&nklock, s);
+
+	xnshadow_kick_harden(sched);
+}
+
+/*
+ * A signal woke up the requestor after its direct request was
+ * posted: withdraw the request, so that it is not served later on
+ * while the thread goes through the gatekeeper on its next attempt.
+ */
+static void drop_harden(struct xnthread *thread)
+{
+	struct xnsched *sched;
+	spl_t s;
+	int cpu;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	for_each_online_cpu(cpu) {
+		if (!xnarch_cpu_supported(cpu))
+			continue;
+		sched = xnpod_sched_slot(cpu);
+		if (sched->gkdirect == thread)
+			sched->gkdirect = NULL;
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+void xnshadow_kick_harden(struct xnsched *sched)
+{
+	xnarch_send_ipi(xnarch_cpumask_of_cpu(xnsched_cpu(sched)));
+}
+
+void xnshadow_finish_harden(struct xnsched *sched) /* hw IRQs off. */
+{
+	struct xnthread *thread;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	thread = sched->gkdirect;
+	if (thread == NULL)
+		goto out;
+
+	/*
+	 * If a real-time thread preempted the root one while Linux
+	 * was still switching out the requestor, we will be kicked
+	 * again when the root thread resumes.
+	 */
+	if (!xnthread_test_state(sched->curr, XNROOT))
+		goto out;
+
+	/*
+	 * The IPI was taken before Linux switched the requestor out,
+	 * i.e. before the hw interrupts were disabled for the actual
+	 * switch. Try again shortly.
+	 */
+	if (xnthread_user_task(thread) == current) {
+		xnshadow_kick_harden(sched);
+		goto out;
+	}
+
+	sched->gkdirect = NULL;
+
+	/*
+	 * Same as the gatekeeper: if a signal woke up the requestor
+	 * meanwhile, drop the request. The requestor notices it is
+	 * still relaxed, and its restarted syscall hardens anew.
+	 */
+	if ((xnthread_user_task(thread)->state & ~TASK_ATOMICSWITCH) !=
+	    TASK_INTERRUPTIBLE)
+		goto out;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	rpi_pop(thread);
+
+	xnlock_get_irqsave(&nklock, s);
+	if (thread->sched != sched)
+		xnsched_migrate_passive(thread, sched);
+	xnpod_resume_thread(thread, XNRELAX);
+out:
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+#else /* !CONFIG_XENO_OPT_DIRECT_HARDEN */
+
+static inline void drop_harden(struct xnthread *thread)
+{
+}
+
+#endif /* !CONFIG_XENO_OPT_DIRECT_HARDEN */
+
 /*!
  * @internal
  * \fn int xnshadow_harden(void);
@@ -936,9 +1168,103 @@ static int gatekeeper_thread(void *data)
  * Rescheduling: always.
  */
 
+#ifdef CONFIG_XENO_OPT_STATS_MODESW
+
+#define RELAX_TRACE_DEPTH  64
+
+struct relax_trace_rec {
+	xnticks_t date;		/* TSC */
+	xnticks_t duration;	/* TSC */
+	unsigned long pc;
+	pid_t pid;
+	int reason;
+	char name[XNOBJECT_NAME_LEN];
+};
+
+static struct relax_trace_rec relax_trace[RELAX_TRACE_DEPTH];
+
+static unsigned long relax_trace_count;
+
+static struct xnvfile_rev_tag relax_trace_tag;
+
+static inline xnticks_t modesw_stat_start(void)
+{
+	return xnarch_get_cpu_tsc();
+}
+
+/*
+ * Only the thread itself updates its histograms, so no locking is
+ * needed there.
+ */
+static void modesw_stat_harden(struct xnthread *thread, xnticks_t start)
+{
+	xnticks_t delta = xnarch_get_cpu_tsc() - start;
+
+	thread->stat.msw.harden[xnstat_modesw_bucket(delta)]++;
+}
+
+static void modesw_stat_relax(struct xnthread *thread, xnticks_t start,
+			      unsigned long pc, int reason)
+{
+	xnticks_t now = xnarch_get_cpu_tsc(), delta = now - start;
+	struct relax_trace_rec *rec;
+	spl_t s;
+
+	if (reason < 0 || reason >= XNSTAT_MSW_REASONS)
+		reason = SIGDEBUG_UNDEFINED;
+
+	thread->stat.msw.relax[reason][xnstat_modesw_bucket(delta)]++;
+
+	xnlock_get_irqsave(&nklock, s);
+	rec = relax_trace + relax_trace_count++ % RELAX_TRACE_DEPTH;
+	rec->date = now;
+	rec->duration = delta;
+	rec->pc = pc;
+	rec->pid = xnthread_user_pid(thread);
+	rec->reason = reason;
+	memcpy(rec->name, thread->name, sizeof(rec->name));
+	xnvfile_touch_tag(&relax_trace_tag);
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+static inline unsigned long modesw_user_pc(void)
+{
+#ifdef task_pt_regs
+	return instruction_pointer(task_pt_regs(current));
+#else /* !task_pt_regs */
+	return 0;
+#endif /* !task_pt_regs */
+}
+
+#else /* !CONFIG_XENO_OPT_STATS_MODESW */
+
+static inline xnticks_t modesw_stat_start(void)
+{
+	return 0;
+}
+
+static inline void modesw_stat_harden(struct xnthread *thread,
+				      xnticks_t start)
+{
+}
+
+static inline void modesw_stat_relax(struct xnthread *thread,
+				     xnticks_t start,
+				     unsigned long pc, int reason)
+{
+}
+
+static inline unsigned long modesw_user_pc(void)
+{
+	return 0;
+}
+
+#endif /* !CONFIG_XENO_OPT_STATS_MODESW */
+
 int xnshadow_harden(void)
 {
 	struct task_struct *this_task = current;
+	xnticks_t start = modesw_stat_start();
 	struct xnthread *thread;
 	struct xnsched *sched;
 	int cpu, err;
@@ -948,6 +1274,19 @@ redo:
 	if (!thread)
 		return -EPERM;
 
+#ifdef CONFIG_XENO_OPT_DIRECT_HARDEN
+	preempt_disable();
+	sched = xnpod_current_sched();
+	if (sched->gkdirect == NULL) {
+		xnthread_set_info(thread, XNDIRECT);
+		if (thread->u_mode)
+			*(thread->u_mode) = thread->state & ~XNRELAX;
+		goto request;
+	}
+	/* Pending direct request on this CPU, use the gatekeeper. */
+	preempt_enable();
+#endif /* CONFIG_XENO_OPT_DIRECT_HARDEN */
+
 	cpu = task_cpu(this_task);
 	sched = xnpod_sched_slot(cpu);
 
@@ -984,15 +1323,19 @@ redo:
 	 * out.
 	 */
 
+	sched->gktarget = thread;
+#ifdef CONFIG_XENO_OPT_DIRECT_HARDEN
+request:
+#endif /* CONFIG_XENO_OPT_DIRECT_HARDEN */
 	trace_mark(xn_nucleus, shadow_gohard,
 		   "thread %p thread_name %s comm %s",
 		   thread, xnthread_name(thread), this_task->comm);
 
-	sched->gktarget = thread;
 	xnthread_set_info(thread, XNATOMIC);
 	set_current_state(TASK_INTERRUPTIBLE | TASK_ATOMICSWITCH);
 
-	wake_up_process(sched->gatekeeper);
+	if (!xnthread_test_info(thread, XNDIRECT))
+		wake_up_process(sched->gatekeeper);
 
 	schedule();
 	xnthread_clear_info(thread, XNATOMIC);
@@ -1011,6 +1354,17 @@ redo:
 			    ("xnshadow_harden() failed for thread %s[%d]",
 			     thread->name, xnthread_user_pid(thread));
 
+		/*
+		 * A direct request involves no gatekeeper, only
+		 * withdraw it in case it was posted before the
+		 * signal woke us up.
+		 */
+		if (xnthread_test_info(thread, XNDIRECT)) {
+			xnthread_clear_info(thread, XNDIRECT);
+			drop_harden(thread);
+			return -ERESTARTSYS;
+		}
+
 		/*
 		 * Synchronize with the chosen gatekeeper so that it no longer
 		 * holds any reference to this thread and does not develop the
@@ -1023,9 +1377,12 @@ redo:
 		return -ERESTARTSYS;
 	}
 
+	xnthread_clear_info(thread, XNDIRECT);
+
 	/* "current" is now running into the Xenomai domain. */
 	sched = xnsched_finish_unlocked_switch(thread->sched);
 
+	xnsched_cswhist_end(sched);
 	xnsched_finalize_zombie(sched);
 
 #ifdef CONFIG_XENO_HW_FPU
@@ -1034,6 +1391,8 @@ redo:
 
 	xnarch_schedule_tail(this_task);
 
+	modesw_stat_harden(thread, start);
+
 	if (xnthread_signaled_p(thread))
 		xnpod_dispatch_signals();
 
@@ -1109,6 +1468,8 @@ EXPORT_SYMBOL_GPL(xnshadow_harden);
 void xnshadow_relax(int notify, int reason)
 {
 	xnthread_t *thread = xnpod_current_thread();
+	xnticks_t start = modesw_stat_start();
+	unsigned long pc = modesw_user_pc();
 	siginfo_t si;
 	int prio;
 
@@ -1121,6 +1482,7 @@ void xnshadow_relax(int notify, int reason)
 	 */
 	trace_mark(xn_nucleus, shadow_gorelax, "thread %p thread_name %s",
 		  thread, xnthread_name(thread));
+	xnevtrace_log(XNEVT_RELAX, thread, reason);
 
 	/*
 	 * If you intend to change the following interrupt-free
@@ -1157,6 +1519,7 @@ void xnshadow_relax(int notify, int reason)
 			   prio ? SCHED_FIFO : SCHED_NORMAL, prio);
 
 	xnstat_counter_inc(&thread->stat.ssw);	/* Account for secondary mode switch. */
+	modesw_stat_relax(thread, start, pc, reason);
 
 	if (notify) {
 		if (xnthread_test_state(thread, XNTRAPSW)) {
@@ -1241,7 +1604,9 @@ void xnshadow_exit(void)
  * process shared heap. This thread variable reflects the current
  * thread mode (primary or secondary). The nucleus will try to update
  * the variable before switching to secondary  or after switching from
- * primary mode.
+ * primary mode. This variable is the first word of the thread state
+ * window (struct xnthread_user_window), which the nucleus refreshes
+ * as the thread runs.
  *
  * @return 0 is returned on success. Otherwise:
  *
@@ -1277,8 +1642,8 @@ int xnshadow_map(xnthread_t *thread, xncompletion_t __user *u_completion,
 	struct xnthread_start_attr attr;
 	xnarch_cpumask_t affinity;
 	struct xnsys_ppd *sys_ppd;
+	struct xnthread_user_window *u_window;
 	unsigned int muxid, magic;
-	unsigned long *u_mode;
 	xnheap_t *sem_heap;
 	spl_t s;
 	int ret;
@@ -1324,12 +1689,20 @@ int xnshadow_map(xnthread_t *thread, xncompletion_t __user *u_completion,
 	xnlock_put_irqrestore(&nklock, s);
 
 	sem_heap = &sys_ppd->sem_heap;
-	u_mode = xnheap_alloc(sem_heap, sizeof(*u_mode));
-	if (!u_mode)
+	u_window = xnheap_alloc(sem_heap, sizeof(*u_window));
+	if (!u_window)
 		return -ENOMEM;
 
+	memset(u_window, 0, sizeof(*u_window));
+	u_window->handle = xnthread_handle(thread);
+	xnobject_copy_name(u_window->name, xnthread_name(thread));
+
 	/* Restrict affinity to a single CPU of nkaffinity & current set. */
 	xnarch_cpus_and(affinity, current->cpus_allowed, nkaffinity);
+#ifdef CONFIG_XENO_OPT_SCHED_BALANCE
+	/* The load balancer may still move us within the original set. */
+	thread->lb_affinity = affinity;
+#endif /* CONFIG_XENO_OPT_SCHED_BALANCE */
 	affinity = xnarch_cpumask_of_cpu(xnarch_first_cpu(affinity));
 	set_cpus_allowed(current, affinity);
 
@@ -1341,8 +1714,16 @@ int xnshadow_map(xnthread_t *thread, xncompletion_t __user *u_completion,
 	xnarch_init_shadow_tcb(xnthread_archtcb(thread), thread,
 			       xnthread_name(thread));
 
-	thread->u_mode = u_mode;
-	__xn_put_user(xnheap_mapped_offset(sem_heap, u_mode), u_mode_offset);
+	/*
+	 * The mode variable is the first word of the state window,
+	 * so that user-space may reach both from the same offset.
+	 */
+	thread->u_window = u_window;
+	thread->u_mode = &u_window->state;
+	__xn_put_user(xnheap_mapped_offset(sem_heap, u_window), u_mode_offset);
+	thread->ppd_mm = current->mm;
+	memset(thread->ppd_cache, 0, sizeof(thread->ppd_cache));
+	xnprofile_attach(thread);
 
 	xnthread_set_state(thread, XNMAPPED);
 	xnpod_suspend_thread(thread, XNRELAX, XN_INFINITE, XN_RELATIVE, NULL);
@@ -1430,8 +1811,9 @@ void xnshadow_unmap(xnthread_t *thread)
 	rpi_pop(thread);
 
 	sys_ppd = xnsys_ppd_get(0);
-	if (thread->u_mode) {
-		xnheap_free(&sys_ppd->sem_heap, thread->u_mode);
+	if (thread->u_window) {
+		xnheap_free(&sys_ppd->sem_heap, thread->u_window);
+		thread->u_window = NULL;
 		thread->u_mode = NULL;
 	}
 
@@ -1516,6 +1898,43 @@ void xnshadow_start(struct xnthread *thread)
 }
 EXPORT_SYMBOL_GPL(xnshadow_start);
 
+/*
+ * Refresh the state window of a shadow thread, which user-space
+ * reads within a sequence counter section. All writers hold nklock,
+ * which serializes them.
+ */
+void __xnshadow_publish(struct xnthread *thread)
+{
+	struct xnthread_user_window *u_window = thread->u_window;
+
+	xnwrite_seqcount_begin(&u_window->seq);
+	u_window->bprio = xnthread_base_priority(thread);
+	u_window->cprio = xnthread_current_priority(thread);
+	u_window->cpu = xnsched_cpu(thread->sched);
+	u_window->modeswitches = xnstat_counter_get(&thread->stat.ssw);
+	u_window->ctxswitches = xnstat_counter_get(&thread->stat.csw);
+	u_window->pagefaults = xnstat_counter_get(&thread->stat.pf);
+	u_window->relpoint = xntimer_get_date(&thread->ptimer);
+	u_window->exectime = xnthread_get_exectime(thread);
+	u_window->switchdate = xnthread_get_lastswitch(thread);
+	xnwrite_seqcount_end(&u_window->seq);
+}
+EXPORT_SYMBOL_GPL(__xnshadow_publish);
+
+/* Must be called with nklock locked, interrupts off. */
+void xnshadow_rename(struct xnthread *thread)
+{
+	struct xnthread_user_window *u_window = thread->u_window;
+
+	if (u_window == NULL)
+		return;
+
+	xnwrite_seqcount_begin(&u_window->seq);
+	xnobject_copy_name(u_window->name, xnthread_name(thread));
+	xnwrite_seqcount_end(&u_window->seq);
+}
+EXPORT_SYMBOL_GPL(xnshadow_rename);
+
 /* Called with nklock locked, Xenomai interrupts off. */
 void xnshadow_renice(struct xnthread *thread)
 {
@@ -2058,6 +2477,128 @@ static int xnshadow_sys_trace(struct pt_regs *regs)
 	return err;
 }
 
+#if CONFIG_XENO_OPT_MALLOC_HEAPSZ > 0
+
+/*
+ * The heap metadata sits in the user mapping, so the blocks handed
+ * out are also recorded in a private bitmap, one bit per minimum
+ * block size, which sys_heap_free checks offsets against.
+ */
+struct xnmalloc_heap {
+	struct xnheap heap;
+	unsigned long *busy;
+	u_long busysz;
+};
+
+static void post_malloc_heap_release(struct xnheap *h)
+{
+	struct xnmalloc_heap *mh = container_of(h, struct xnmalloc_heap, heap);
+
+	xnarch_free_host_mem(mh->busy, mh->busysz);
+	xnarch_free_host_mem(mh, sizeof(*mh));
+}
+
+/*
+ * The malloc heap is created upon the first request from a process,
+ * always from a Linux context since sys_heap_info runs there.
+ */
+static struct xnheap *get_malloc_heap(struct xnsys_ppd *p)
+{
+	struct xnheap *heap, *old;
+	struct xnmalloc_heap *mh;
+	u_long nbits;
+	int err;
+
+	if (p == &__xnsys_global_ppd)
+		return ERR_PTR(-ENODEV);
+
+	heap = p->malloc_heap;
+	if (heap)
+		return heap;
+
+	mh = xnarch_alloc_host_mem(sizeof(*mh));
+	if (mh == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	heap = &mh->heap;
+	err = xnheap_init_mapped(heap,
+				 CONFIG_XENO_OPT_MALLOC_HEAPSZ * 1024,
+				 XNARCH_SHARED_HEAP_FLAGS);
+	if (err) {
+		xnarch_free_host_mem(mh, sizeof(*mh));
+		return ERR_PTR(err);
+	}
+
+	nbits = xnheap_extentsize(heap) >> XNHEAP_MINLOG2;
+	mh->busysz = BITS_TO_LONGS(nbits) * sizeof(long);
+	mh->busy = xnarch_alloc_host_mem(mh->busysz);
+	if (mh->busy == NULL) {
+		mh->busysz = 0;
+		xnheap_destroy_mapped(heap, post_malloc_heap_release, NULL);
+		return ERR_PTR(-ENOMEM);
+	}
+	memset(mh->busy, 0, mh->busysz);
+
+	xnheap_set_label(heap, "malloc heap [%d]", current->pid);
+
+	/* Another thread of the same process may have raced us. */
+	old = cmpxchg(&p->malloc_heap, NULL, heap);
+	if (old) {
+		xnheap_destroy_mapped(heap, post_malloc_heap_release, NULL);
+		return old;
+	}
+
+	return heap;
+}
+
+static inline struct xnheap *lookup_malloc_heap(void)
+{
+	struct xnsys_ppd *p = xnsys_ppd_get(0);
+
+	return p == &__xnsys_global_ppd ? NULL : p->malloc_heap;
+}
+
+static inline void track_malloc_block(struct xnheap *heap, unsigned long off)
+{
+	struct xnmalloc_heap *mh = container_of(heap, struct xnmalloc_heap, heap);
+
+	set_bit(off >> XNHEAP_MINLOG2, mh->busy);
+}
+
+/* Only blocks we handed out may be released, and only once. */
+static inline int untrack_malloc_block(struct xnheap *heap, unsigned long off)
+{
+	struct xnmalloc_heap *mh = container_of(heap, struct xnmalloc_heap, heap);
+
+	if (off >= xnheap_extentsize(heap) || (off & (XNHEAP_MINALLOCSZ - 1)))
+		return 0;
+
+	return test_and_clear_bit(off >> XNHEAP_MINLOG2, mh->busy);
+}
+
+#else /* CONFIG_XENO_OPT_MALLOC_HEAPSZ == 0 */
+
+static inline struct xnheap *get_malloc_heap(struct xnsys_ppd *p)
+{
+	return ERR_PTR(-ENODEV);
+}
+
+static inline struct xnheap *lookup_malloc_heap(void)
+{
+	return NULL;
+}
+
+static inline void track_malloc_block(struct xnheap *heap, unsigned long off)
+{
+}
+
+static inline int untrack_malloc_block(struct xnheap *heap, unsigned long off)
+{
+	return 0;
+}
+
+#endif /* CONFIG_XENO_OPT_MALLOC_HEAPSZ == 0 */
+
 static int xnshadow_sys_heap_info(struct pt_regs *regs)
 {
 	struct xnheap_desc hd, __user *u_hd;
@@ -2073,6 +2614,12 @@ static int xnshadow_sys_heap_info(struct pt_regs *regs)
 		heap = &xnsys_ppd_get(heap_nr)->sem_heap;
 		break;
 
+	case XNHEAP_PROC_MALLOC_HEAP:
+		heap = get_malloc_heap(xnsys_ppd_get(0));
+		if (IS_ERR(heap))
+			return PTR_ERR(heap);
+		break;
+
 	case XNHEAP_SYS_HEAP:
 		heap = &kheap;
 		break;
@@ -2083,6 +2630,30 @@ static int xnshadow_sys_heap_info(struct pt_regs *regs)
 		break;
 #endif
 
+#ifdef CONFIG_XENO_OPT_EVTRACE
+	case XNHEAP_SYS_EVTRACE:
+		heap = xnevtrace_heap();
+		if (heap == NULL)
+			return -ENODEV;
+		break;
+#endif
+
+#ifdef CONFIG_XENO_OPT_STATS_MAP
+	case XNHEAP_SYS_STATMAP:
+		heap = xnstatmap_heap();
+		if (heap == NULL)
+			return -ENODEV;
+		break;
+#endif
+
+#ifdef CONFIG_XENO_OPT_PROFILE
+	case XNHEAP_SYS_PROFILE:
+		heap = xnprofile_heap();
+		if (heap == NULL)
+			return -ENODEV;
+		break;
+#endif
+
 	default:
 		return -EINVAL;
 	}
@@ -2095,6 +2666,82 @@ static int xnshadow_sys_heap_info(struct pt_regs *regs)
 	return __xn_safe_copy_to_user(u_hd, &hd, sizeof(*u_hd));
 }
 
+static int xnshadow_sys_heap_extent(struct pt_regs *regs)
+{
+	struct xnheap_ext_desc ed, __user *u_ed;
+	struct xnheap *heap;
+	unsigned heap_nr;
+
+	heap_nr = __xn_reg_arg2(regs);
+	u_ed = (struct xnheap_ext_desc __user *)__xn_reg_arg1(regs);
+
+	if (heap_nr != XNHEAP_PROC_PRIVATE_HEAP &&
+	    heap_nr != XNHEAP_PROC_SHARED_HEAP)
+		return -EINVAL;
+
+	heap = &xnsys_ppd_get(heap_nr)->sem_heap;
+	ed.size = xnheap_extentsize(heap);
+	ed.nrext = xnheap_mapped_extent(heap, __xn_reg_arg3(regs), &ed.area);
+#ifdef CONFIG_XENO_OPT_SEM_HEAP_AUTOGROW
+	ed.maxext = CONFIG_XENO_OPT_SEM_HEAP_MAXEXT;
+#else
+	ed.maxext = 1;
+#endif
+
+	return __xn_safe_copy_to_user(u_ed, &ed, sizeof(*u_ed));
+}
+
+static int xnshadow_sys_heap_alloc(struct pt_regs *regs)
+{
+	unsigned long __user *u_offp;
+	struct xnheap *heap;
+	unsigned long off;
+	size_t size;
+	void *ptr;
+	int err;
+
+	heap = lookup_malloc_heap();
+	if (heap == NULL)
+		return -ENODEV;
+
+	size = __xn_reg_arg1(regs);
+	u_offp = (unsigned long __user *)__xn_reg_arg2(regs);
+
+	if (size == 0)
+		return -EINVAL;
+
+	ptr = xnheap_alloc(heap, size);
+	if (ptr == NULL)
+		return -ENOMEM;
+
+	off = xnheap_mapped_offset(heap, ptr);
+	err = __xn_safe_copy_to_user(u_offp, &off, sizeof(off));
+	if (err) {
+		xnheap_free(heap, ptr);
+		return err;
+	}
+
+	track_malloc_block(heap, off);
+
+	return 0;
+}
+
+static int xnshadow_sys_heap_free(struct pt_regs *regs)
+{
+	struct xnheap *heap;
+	unsigned long off;
+
+	heap = lookup_malloc_heap();
+	if (heap == NULL)
+		return -ENODEV;
+
+	off = __xn_reg_arg1(regs);
+	if (!untrack_malloc_block(heap, off))
+		return -EINVAL;
+
+	return xnheap_free(heap, xnheap_mapped_address(heap, off));
+}
+
 static int xnshadow_sys_current(struct pt_regs *regs)
 {
 	xnthread_t *cur = xnshadow_thread(current);
@@ -2103,6 +2750,13 @@ static int xnshadow_sys_current(struct pt_regs *regs)
 	if (!cur)
 		return -EPERM;
 
+	/*
+	 * Skins may register the thread after mapping it; user-space
+	 * asks for the handle before looking up the state window.
+	 */
+	if (cur->u_window)
+		cur->u_window->handle = xnthread_handle(cur);
+
 	us_handle = (xnhandle_t __user *) __xn_reg_arg1(regs);
 
 	return __xn_safe_copy_to_user(us_handle, &xnthread_handle(cur),
@@ -2141,6 +2795,32 @@ static int xnshadow_sys_current_info(struct pt_regs *regs)
 	return __xn_safe_copy_to_user(us_info, &info, sizeof(*us_info));
 }
 
+static int xnshadow_sys_sched_unlock(struct pt_regs *regs)
+{
+	xnthread_t *cur = xnshadow_thread(current);
+	struct xnthread_user_window *u_window = cur->u_window;
+	spl_t s;
+
+	if (u_window == NULL)
+		return -EPERM;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	u_window->schedpend = 0;
+	/*
+	 * Nothing was deferred if we run in secondary mode, Linux
+	 * does not care about the window lock.
+	 */
+	if (u_window->schedlck == 0 && !xnpod_root_p()) {
+		xnsched_set_self_resched(xnpod_current_sched());
+		xnpod_schedule();
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+
 static xnsysent_t __systab[] = {
 	[__xn_sys_migrate] = {&xnshadow_sys_migrate, __xn_exec_current},
 	[__xn_sys_arch] = {&xnshadow_sys_arch, __xn_exec_any},
@@ -2154,6 +2834,11 @@ static xnsysent_t __systab[] = {
 	[__xn_sys_current_info] =
 		{&xnshadow_sys_current_info, __xn_exec_shadow},
 	[__xn_sys_mayday] = {&xnshadow_sys_mayday, __xn_exec_any|__xn_exec_norestart},
+	[__xn_sys_heap_extent] = {&xnshadow_sys_heap_extent, __xn_exec_lostage},
+	[__xn_sys_sched_unlock] =
+		{&xnshadow_sys_sched_unlock, __xn_exec_shadow|__xn_exec_current},
+	[__xn_sys_heap_alloc] = {&xnshadow_sys_heap_alloc, __xn_exec_any},
+	[__xn_sys_heap_free] = {&xnshadow_sys_heap_free, __xn_exec_any},
 };
 
 static void post_ppd_release(struct xnheap *h)
@@ -2162,6 +2847,17 @@ static void post_ppd_release(struct xnheap *h)
 	xnarch_free_host_mem(p, sizeof(*p));
 }
 
+/*
+ * Thread state windows live in the private heap, which rounds small
+ * blocks up to a power of two.
+ */
+#define XNSHADOW_WINDOW_BLKSZ \
+	(sizeof(struct xnthread_user_window) <= 128 ? 128 : 256)
+
+#define XNSHADOW_SEM_HEAPSZ \
+	(CONFIG_XENO_OPT_SEM_HEAPSZ * 1024 + \
+	 CONFIG_XENO_OPT_SEM_HEAP_WINDOWS * XNSHADOW_WINDOW_BLKSZ)
+
 static void *xnshadow_sys_event(int event, void *data)
 {
 	struct xnsys_ppd *p;
@@ -2173,16 +2869,23 @@ static void *xnshadow_sys_event(int event, void *data)
 		if (p == NULL)
 			return ERR_PTR(-ENOMEM);
 
-		err = xnheap_init_mapped(&p->sem_heap,
-					 CONFIG_XENO_OPT_SEM_HEAPSZ * 1024,
+		XENO_BUILD_BUG_ON(sizeof(struct xnthread_user_window) > 256);
+		err = xnheap_init_mapped(&p->sem_heap, XNSHADOW_SEM_HEAPSZ,
 					 XNARCH_SHARED_HEAP_FLAGS);
 		if (err) {
 			xnarch_free_host_mem(p, sizeof(*p));
 			return ERR_PTR(err);
 		}
+#if CONFIG_XENO_OPT_MALLOC_HEAPSZ > 0
+		p->malloc_heap = NULL;
+#endif
 
 		xnheap_set_label(&p->sem_heap,
 				 "private sem heap [%d]", current->pid);
+#ifdef CONFIG_XENO_OPT_SEM_HEAP_AUTOGROW
+		xnheap_set_autogrow(&p->sem_heap,
+				    CONFIG_XENO_OPT_SEM_HEAP_MAXEXT);
+#endif
 
 #ifdef XNARCH_HAVE_MAYDAY
 		p->mayday_addr = map_mayday_page(current);
@@ -2200,6 +2903,11 @@ static void *xnshadow_sys_event(int event, void *data)
 
 	case XNSHADOW_CLIENT_DETACH:
 		p = ppd2sys(data);
+#if CONFIG_XENO_OPT_MALLOC_HEAPSZ > 0
+		if (p->malloc_heap)
+			xnheap_destroy_mapped(p->malloc_heap,
+					      post_malloc_heap_release, NULL);
+#endif
 		xnheap_destroy_mapped(&p->sem_heap, post_ppd_release, NULL);
 		xnarch_atomic_dec(&muxtable[0].refcnt);
 
@@ -2243,6 +2951,7 @@ int do_hisyscall_event(unsigned event, rthal_pipeline_stage_t *stage,
 	struct task_struct *p;
 	xnthread_t *thread;
 	u_long sysflags;
+	xnticks_t start;
 
 	if (!xnpod_active_p())
 		goto no_skin;
@@ -2340,6 +3049,7 @@ int do_hisyscall_event(unsigned event, rthal_pipeline_stage_t *stage,
 		   immediately. */
 	}
 
+	start = syscall_stat_start();
 	err = muxtable[muxid].props->systab[muxop].svc(regs);
 
 	if (err == -ENOSYS && (sysflags & __xn_exec_adaptive) != 0) {
@@ -2356,6 +3066,8 @@ int do_hisyscall_event(unsigned event, rthal_pipeline_stage_t *stage,
 		goto restart;
 	}
 
+	syscall_stat_end(muxid, muxop, start);
+
       done:
 
 	__xn_status_return(regs, err);
@@ -2461,6 +3173,7 @@ int do_losyscall_event(unsigned event, rthal_pipeline_stage_t *stage,
 	int muxid, muxop, sysflags, switched, err, sigs;
 	struct pt_regs *regs = (struct pt_regs *)data;
 	xnthread_t *thread = xnshadow_thread(current);
+	xnticks_t start;
 
 	if (__xn_reg_mux_p(regs))
 		goto xenomai_syscall;
@@ -2513,6 +3226,7 @@ int do_losyscall_event(unsigned event, rthal_pipeline_stage_t *stage,
 	} else			/* We want to run the syscall in the Linux domain.  */
 		switched = 0;
 
+	start = syscall_stat_start();
 	err = muxtable[muxid].props->systab[muxop].svc(regs);
 
 	if (err == -ENOSYS && (sysflags & __xn_exec_adaptive) != 0) {
@@ -2527,6 +3241,8 @@ int do_losyscall_event(unsigned event, rthal_pipeline_stage_t *stage,
 		goto restart;
 	}
 
+	syscall_stat_end(muxid, muxop, start);
+
 	__xn_status_return(regs, err);
 
 	sigs = 0;
@@ -2610,6 +3326,20 @@ static inline void do_schedule_event(struct task_struct *next_task)
 	next = xnshadow_thread(next_task);
 	set_switch_lock_owner(prev_task);
 
+#ifdef CONFIG_XENO_OPT_DIRECT_HARDEN
+	{
+		struct xnthread *prev = xnshadow_thread(prev_task);
+		/*
+		 * Linux is switching out a thread on its way to
+		 * primary mode. Once in this state, the task has left
+		 * the runqueue and may not be woken up by Linux.
+		 */
+		if (prev && xnthread_test_info(prev, XNDIRECT) &&
+		    (prev_task->state & ~TASK_ATOMICSWITCH) == TASK_INTERRUPTIBLE)
+			post_harden(prev);
+	}
+#endif /* CONFIG_XENO_OPT_DIRECT_HARDEN */
+
 	if (next) {
 		/*
 		 * Check whether we need to unlock the timers, each
@@ -2848,6 +3578,47 @@ RTHAL_DECLARE_CLEANUP_EVENT(cleanup_event);
 
 #ifdef CONFIG_XENO_OPT_VFILE
 
+#if defined(CONFIG_XENO_OPT_PRIOCPL) && defined(CONFIG_XENO_OPT_STATS)
+
+static int rpi_vfile_show(struct xnvfile_regular_iterator *it, void *data)
+{
+	struct xnsched_rpistat stat;
+	struct xnsched *sched;
+	int cpu, count;
+	spl_t s;
+
+	xnvfile_printf(it, "%-3s  %6s  %10s  %10s  %10s  %10s  %10s\n",
+		       "CPU", "RELAX", "SWITCHES", "FASTPATH", "LOCKED",
+		       "RENICES", "REMOTE");
+
+	for_each_online_cpu(cpu) {
+		if (!xnarch_cpu_supported(cpu))
+			continue;
+
+		sched = xnpod_sched_slot(cpu);
+		xnlock_get_irqsave(&sched->rpilock, s);
+		stat = sched->rpistat;
+		count = sched->rpicount;
+		xnlock_put_irqrestore(&sched->rpilock, s);
+
+		xnvfile_printf(it, "%3u  %6d  %10lu  %10lu  %10lu  %10lu  %10lu\n",
+			       cpu, count, stat.switches, stat.fastpath,
+			       stat.locked, stat.renices, stat.remote);
+	}
+
+	return 0;
+}
+
+static struct xnvfile_regular_ops rpi_vfile_ops = {
+	.show = rpi_vfile_show,
+};
+
+static struct xnvfile_regular rpi_vfile = {
+	.ops = &rpi_vfile_ops,
+};
+
+#endif /* CONFIG_XENO_OPT_PRIOCPL && CONFIG_XENO_OPT_STATS */
+
 static struct xnvfile_directory iface_vfroot;
 
 static int iface_vfile_show(struct xnvfile_regular_iterator *it, void *data)
@@ -2866,15 +3637,348 @@ static struct xnvfile_regular_ops iface_vfile_ops = {
 	.show = iface_vfile_show,
 };
 
+#ifdef CONFIG_XENO_OPT_STATS_SYSCALL
+
+struct vfile_syscall_priv {
+	int muxid;
+	int muxop;
+	int budget;
+	struct xnholder *curr;
+};
+
+struct vfile_syscall_data {
+	int muxop;		/* -1 for thread records. */
+	pid_t pid;
+	unsigned long calls;
+	xnticks_t total;
+	char name[XNOBJECT_NAME_LEN];
+};
+
+static struct xnvfile_snapshot_ops vfile_syscall_ops;
+
+static struct xnvfile_snapshot syscall_vfile = {
+	.privsz = sizeof(struct vfile_syscall_priv),
+	.datasz = sizeof(struct vfile_syscall_data),
+	.tag = &nkpod_struct.threadlist_tag,
+	.ops = &vfile_syscall_ops,
+};
+
+static int vfile_syscall_rewind(struct xnvfile_snapshot_iterator *it)
+{
+	struct vfile_syscall_priv *priv = xnvfile_iterator_priv(it);
+	int muxid, count = 0;
+
+	/*
+	 * Global per-call records come first, then per-thread
+	 * totals. Interfaces may come and go while we collect, so
+	 * bound the output to what we sized the buffer for.
+	 */
+	for (muxid = 0; muxid < XENOMAI_MUX_NR; muxid++)
+		if (muxtable[muxid].props && muxtable[muxid].sysstat)
+			count += muxtable[muxid].props->nrcalls;
+
+	priv->muxid = 0;
+	priv->muxop = 0;
+	priv->curr = getheadq(&nkpod->threadq);
+	priv->budget = count + countq(&nkpod->threadq);
+
+	return priv->budget;
+}
+
+static int vfile_syscall_next(struct xnvfile_snapshot_iterator *it, void *data)
+{
+	struct vfile_syscall_priv *priv = xnvfile_iterator_priv(it);
+	struct vfile_syscall_data *p = data;
+	struct xnsyscall_stat *stat;
+	struct xnskin_slot *iface;
+	struct xnthread *thread;
+
+	if (priv->budget <= 0)
+		return 0;
+
+	while (priv->muxid < XENOMAI_MUX_NR) {
+		iface = muxtable + priv->muxid;
+		if (iface->props == NULL || iface->sysstat == NULL ||
+		    priv->muxop >= iface->props->nrcalls) {
+			priv->muxid++;
+			priv->muxop = 0;
+			continue;
+		}
+		stat = iface->sysstat + priv->muxop;
+		priv->budget--;
+		if (stat->calls == 0) {
+			priv->muxop++;
+			return VFILE_SEQ_SKIP;
+		}
+		p->muxop = priv->muxop++;
+		p->pid = 0;
+		p->calls = stat->calls;
+		p->total = stat->total;
+		strncpy(p->name, iface->props->name ?: "?", sizeof(p->name));
+		p->name[sizeof(p->name) - 1] = '\0';
+		return 1;
+	}
+
+	if (priv->curr == NULL)
+		return 0;	/* All done. */
+
+	thread = link2thread(priv->curr, glink);
+	priv->curr = nextq(&nkpod->threadq, priv->curr);
+	priv->budget--;
+
+	if (thread->stat.syscalls == 0)
+		return VFILE_SEQ_SKIP;
+
+	p->muxop = -1;
+	p->pid = xnthread_user_pid(thread);
+	p->calls = thread->stat.syscalls;
+	p->total = thread->stat.systime;
+	memcpy(p->name, thread->name, sizeof(p->name));
+
+	return 1;
+}
+
+static int vfile_syscall_show(struct xnvfile_snapshot_iterator *it, void *data)
+{
+	struct vfile_syscall_data *p = data;
+	unsigned long long total, avg;
+
+	if (p == NULL) {
+		xnvfile_printf(it, "%-6s %-4s %-10s %-14s %-10s %s\n",
+			       "PID", "NR", "CALLS", "TIME(ns)", "AVG(ns)",
+			       "NAME");
+		return 0;
+	}
+
+	total = xnarch_tsc_to_ns(p->total);
+	avg = xnarch_ulldiv(total, p->calls, NULL);
+
+	if (p->muxop < 0)
+		xnvfile_printf(it, "%-6d %-4s %-10lu %-14Lu %-10Lu %s\n",
+			       p->pid, "-", p->calls, total, avg, p->name);
+	else
+		xnvfile_printf(it, "%-6s %-4d %-10lu %-14Lu %-10Lu %s\n",
+			       "-", p->muxop, p->calls, total, avg, p->name);
+
+	return 0;
+}
+
+static struct xnvfile_snapshot_ops vfile_syscall_ops = {
+	.rewind = vfile_syscall_rewind,
+	.next = vfile_syscall_next,
+	.show = vfile_syscall_show,
+};
+
+#endif /* CONFIG_XENO_OPT_STATS_SYSCALL */
+
+#ifdef CONFIG_XENO_OPT_STATS_MODESW
+
+static const char *modesw_labels[XNSTAT_MSW_REASONS] = {
+	[SIGDEBUG_UNDEFINED] = "other",
+	[SIGDEBUG_MIGRATE_SIGNAL] = "signal",
+	[SIGDEBUG_MIGRATE_SYSCALL] = "syscall",
+	[SIGDEBUG_MIGRATE_FAULT] = "fault",
+	[SIGDEBUG_MIGRATE_PRIOINV] = "prioinv",
+	[SIGDEBUG_NOMLOCK] = "nomlock",
+	[SIGDEBUG_WATCHDOG] = "watchdog",
+	[SIGDEBUG_RESCNT_IMBALANCE] = "rescnt",
+};
+
+struct vfile_modesw_priv {
+	struct xnholder *curr;
+};
+
+struct vfile_modesw_data {
+	pid_t pid;
+	char name[XNOBJECT_NAME_LEN];
+	xnstat_modesw_t msw;
+};
+
+static struct xnvfile_snapshot_ops vfile_modesw_ops;
+
+static struct xnvfile_snapshot modesw_vfile = {
+	.privsz = sizeof(struct vfile_modesw_priv),
+	.datasz = sizeof(struct vfile_modesw_data),
+	.tag = &nkpod_struct.threadlist_tag,
+	.ops = &vfile_modesw_ops,
+};
+
+static int vfile_modesw_rewind(struct xnvfile_snapshot_iterator *it)
+{
+	struct vfile_modesw_priv *priv = xnvfile_iterator_priv(it);
+
+	priv->curr = getheadq(&nkpod->threadq);
+
+	return countq(&nkpod->threadq);
+}
+
+static int vfile_modesw_next(struct xnvfile_snapshot_iterator *it, void *data)
+{
+	struct vfile_modesw_priv *priv = xnvfile_iterator_priv(it);
+	struct vfile_modesw_data *p = data;
+	struct xnthread *thread;
+
+	if (priv->curr == NULL)
+		return 0;	/* All done. */
+
+	thread = link2thread(priv->curr, glink);
+	priv->curr = nextq(&nkpod->threadq, priv->curr);
+
+	if (!xnthread_test_state(thread, XNSHADOW))
+		return VFILE_SEQ_SKIP;
+
+	p->pid = xnthread_user_pid(thread);
+	memcpy(p->name, thread->name, sizeof(p->name));
+	p->msw = thread->stat.msw;
+
+	return 1;
+}
+
+static void vfile_modesw_show_hist(struct xnvfile_snapshot_iterator *it,
+				   struct vfile_modesw_data *p,
+				   const char *type, unsigned long *hits)
+{
+	int bucket;
+
+	for (bucket = 0; bucket < XNSTAT_MSW_BUCKETS; bucket++) {
+		if (hits[bucket] == 0)
+			continue;
+		if (bucket < XNSTAT_MSW_BUCKETS - 1)
+			xnvfile_printf(it, "%-6d %-8s < %-14Lu %-10lu %s\n",
+				       p->pid, type,
+				       xnarch_tsc_to_ns(1ULL << bucket),
+				       hits[bucket], p->name);
+		else
+			xnvfile_printf(it, "%-6d %-8s >= %-13Lu %-10lu %s\n",
+				       p->pid, type,
+				       xnarch_tsc_to_ns(1ULL << (bucket - 1)),
+				       hits[bucket], p->name);
+	}
+}
+
+static int vfile_modesw_show(struct xnvfile_snapshot_iterator *it, void *data)
+{
+	struct vfile_modesw_data *p = data;
+	int reason;
+
+	if (p == NULL) {
+		xnvfile_printf(it, "%-6s %-8s %-17s %-10s %s\n",
+			       "PID", "TYPE", "RANGE(ns)", "COUNT", "NAME");
+		return 0;
+	}
+
+	vfile_modesw_show_hist(it, p, "harden", p->msw.harden);
+	for (reason = 0; reason < XNSTAT_MSW_REASONS; reason++)
+		vfile_modesw_show_hist(it, p, modesw_labels[reason],
+				       p->msw.relax[reason]);
+
+	return 0;
+}
+
+static struct xnvfile_snapshot_ops vfile_modesw_ops = {
+	.rewind = vfile_modesw_rewind,
+	.next = vfile_modesw_next,
+	.show = vfile_modesw_show,
+};
+
+struct vfile_relaxtrace_priv {
+	unsigned long pos;
+	unsigned long end;
+};
+
+static struct xnvfile_snapshot_ops vfile_relaxtrace_ops;
+
+static struct xnvfile_snapshot relaxtrace_vfile = {
+	.privsz = sizeof(struct vfile_relaxtrace_priv),
+	.datasz = sizeof(struct relax_trace_rec),
+	.tag = &relax_trace_tag,
+	.ops = &vfile_relaxtrace_ops,
+};
+
+static int vfile_relaxtrace_rewind(struct xnvfile_snapshot_iterator *it)
+{
+	struct vfile_relaxtrace_priv *priv = xnvfile_iterator_priv(it);
+
+	/* Oldest record first. */
+	priv->end = relax_trace_count;
+	priv->pos = priv->end > RELAX_TRACE_DEPTH ?
+		priv->end - RELAX_TRACE_DEPTH : 0;
+
+	return priv->end - priv->pos;
+}
+
+static int vfile_relaxtrace_next(struct xnvfile_snapshot_iterator *it,
+				 void *data)
+{
+	struct vfile_relaxtrace_priv *priv = xnvfile_iterator_priv(it);
+
+	if (priv->pos >= priv->end)
+		return 0;	/* All done. */
+
+	memcpy(data, relax_trace + priv->pos++ % RELAX_TRACE_DEPTH,
+	       sizeof(struct relax_trace_rec));
+
+	return 1;
+}
+
+static int vfile_relaxtrace_show(struct xnvfile_snapshot_iterator *it,
+				 void *data)
+{
+	struct relax_trace_rec *p = data;
+
+	if (p == NULL) {
+		xnvfile_printf(it, "%-16s %-6s %-8s %-18s %-12s %s\n",
+			       "DATE(ns)", "PID", "REASON", "PC", "TIME(ns)",
+			       "NAME");
+		return 0;
+	}
+
+	xnvfile_printf(it, "%-16Lu %-6d %-8s 0x%-16lx %-12Lu %s\n",
+		       xnarch_tsc_to_ns(p->date), p->pid,
+		       modesw_labels[p->reason], p->pc,
+		       xnarch_tsc_to_ns(p->duration), p->name);
+
+	return 0;
+}
+
+static struct xnvfile_snapshot_ops vfile_relaxtrace_ops = {
+	.rewind = vfile_relaxtrace_rewind,
+	.next = vfile_relaxtrace_next,
+	.show = vfile_relaxtrace_show,
+};
+
+#endif /* CONFIG_XENO_OPT_STATS_MODESW */
+
 void xnshadow_init_proc(void)
 {
 	xnvfile_init_dir("interfaces", &iface_vfroot, &nkvfroot);
+#if defined(CONFIG_XENO_OPT_PRIOCPL) && defined(CONFIG_XENO_OPT_STATS)
+	xnvfile_init_regular("rpi", &rpi_vfile, &nkvfroot);
+#endif
+#ifdef CONFIG_XENO_OPT_STATS_SYSCALL
+	xnvfile_init_snapshot("syscalls", &syscall_vfile, &nkvfroot);
+#endif
+#ifdef CONFIG_XENO_OPT_STATS_MODESW
+	xnvfile_init_snapshot("modesw", &modesw_vfile, &nkvfroot);
+	xnvfile_init_snapshot("relaxtrace", &relaxtrace_vfile, &nkvfroot);
+#endif
 }
 
 void xnshadow_cleanup_proc(void)
 {
 	int muxid;
 
+#if defined(CONFIG_XENO_OPT_PRIOCPL) && defined(CONFIG_XENO_OPT_STATS)
+	xnvfile_destroy_regular(&rpi_vfile);
+#endif
+#ifdef CONFIG_XENO_OPT_STATS_SYSCALL
+	xnvfile_destroy_snapshot(&syscall_vfile);
+#endif
+#ifdef CONFIG_XENO_OPT_STATS_MODESW
+	xnvfile_destroy_snapshot(&relaxtrace_vfile);
+	xnvfile_destroy_snapshot(&modesw_vfile);
+#endif
+
 	for (muxid = 0; muxid < XENOMAI_MUX_NR; muxid++)
 		if (muxtable[muxid].props && muxtable[muxid].props->name)
 			xnvfile_destroy_regular(&muxtable[muxid].vfile);
@@ -2911,6 +4015,10 @@ int xnshadow_register_interface(struct xnskin_props *props)
 	struct xnskin_slot *iface;
 	int muxid;
 	spl_t s;
+#ifdef CONFIG_XENO_OPT_STATS_SYSCALL
+	struct xnsyscall_stat *sysstat;
+	size_t statsz;
+#endif
 
 	/*
 	 * We can only handle up to MAX_SYSENT syscalls per skin,
@@ -2919,6 +4027,14 @@ int xnshadow_register_interface(struct xnskin_props *props)
 	if (XENOMAI_MAX_SYSENT < props->nrcalls || 0 > props->nrcalls)
 		return -EINVAL;
 
+#ifdef CONFIG_XENO_OPT_STATS_SYSCALL
+	/* Profiling is best effort, go without it if short of memory. */
+	statsz = props->nrcalls * sizeof(*sysstat);
+	sysstat = statsz ? xnarch_alloc_host_mem(statsz) : NULL;
+	if (sysstat)
+		memset(sysstat, 0, statsz);
+#endif
+
 	down(&registration_mutex);
 
 	xnlock_get_irqsave(&nklock, s);
@@ -2928,6 +4044,9 @@ int xnshadow_register_interface(struct xnskin_props *props)
 		if (iface->props == NULL) {
 			iface->props = props;
 			xnarch_atomic_set(&iface->refcnt, 0);
+#ifdef CONFIG_XENO_OPT_STATS_SYSCALL
+			iface->sysstat = sysstat;
+#endif
 			break;
 		}
 	}
@@ -2936,6 +4055,10 @@ int xnshadow_register_interface(struct xnskin_props *props)
 
 	if (muxid >= XENOMAI_MUX_NR) {
 		up(&registration_mutex);
+#ifdef CONFIG_XENO_OPT_STATS_SYSCALL
+		if (sysstat)
+			xnarch_free_host_mem(sysstat, statsz);
+#endif
 		return -ENOBUFS;
 	}
 
@@ -2962,6 +4085,10 @@ int xnshadow_unregister_interface(int muxid)
 {
 	struct xnskin_slot *iface;
 	spl_t s;
+#ifdef CONFIG_XENO_OPT_STATS_SYSCALL
+	struct xnsyscall_stat *sysstat;
+	size_t statsz;
+#endif
 
 	if (muxid < 0 || muxid >= XENOMAI_MUX_NR)
 		return -EINVAL;
@@ -2975,9 +4102,19 @@ int xnshadow_unregister_interface(int muxid)
 		up(&registration_mutex);
 		return -EBUSY;
 	}
+#ifdef CONFIG_XENO_OPT_STATS_SYSCALL
+	statsz = iface->props->nrcalls * sizeof(*sysstat);
+	sysstat = iface->sysstat;
+	iface->sysstat = NULL;
+#endif
 	iface->props = NULL;
 	xnlock_put_irqrestore(&nklock, s);
 
+#ifdef CONFIG_XENO_OPT_STATS_SYSCALL
+	if (sysstat)
+		xnarch_free_host_mem(sysstat, statsz);
+#endif
+
 #ifdef CONFIG_XENO_OPT_VFILE
 	xnvfile_destroy_regular(&iface->vfile);
 #endif
@@ -3006,10 +4143,33 @@ EXPORT_SYMBOL_GPL(xnshadow_unregister_interface);
  */
 xnshadow_ppd_t *xnshadow_ppd_get(unsigned muxid)
 {
-	if (xnpod_userspace_p())
-		return ppd_lookup(muxid, xnshadow_mm(current) ?: current->mm);
+	struct xnthread *thread;
+	struct mm_struct *mm;
+	xnshadow_ppd_t *ppd;
 
-	return NULL;
+	if (!xnpod_userspace_p())
+		return NULL;
+
+	mm = xnshadow_mm(current) ?: current->mm;
+
+	/*
+	 * A shadow holds a reference on the per-process data of its
+	 * process until it is unmapped, so the ppds it looked up may
+	 * be cached for its lifetime. The cleanup of another process
+	 * may run over a shadow context though, hence the mm check.
+	 */
+	thread = xnshadow_thread(current);
+	if (thread == NULL || thread->ppd_mm != mm)
+		return ppd_lookup(muxid, mm);
+
+	ppd = thread->ppd_cache[muxid];
+	if (likely(ppd))
+		return ppd;
+
+	ppd = ppd_lookup(muxid, mm);
+	thread->ppd_cache[muxid] = ppd;
+
+	return ppd;
 }
 EXPORT_SYMBOL_GPL(xnshadow_ppd_get);
 
@@ -3056,8 +4216,11 @@ int xnshadow_mount(void)
 		if (!xnarch_cpu_supported(cpu))
 			continue;
 
-		sched = &nkpod_struct.sched[cpu];
+		sched = xnpod_sched_slot(cpu);
 		sema_init(&sched->gksync, 0);
+#ifdef CONFIG_XENO_OPT_DIRECT_HARDEN
+		sched->gkdirect = NULL;
+#endif
 		xnarch_memory_barrier();
 		sched->gatekeeper =
 		    kthread_create(&gatekeeper_thread, (void *)(long)cpu,
@@ -3080,6 +4243,8 @@ int xnshadow_mount(void)
 	rthal_catch_losyscall(&losyscall_event);
 	rthal_catch_hisyscall(&hisyscall_event);
 
+	if (ppd_hash_size == 0)
+		ppd_hash_size = 1;
 	size = sizeof(xnqueue_t) * PPD_HASH_SIZE;
 	ppd_hash = (xnqueue_t *)xnarch_alloc_host_mem(size);
 	if (!ppd_hash) {
@@ -3132,7 +4297,7 @@ void xnshadow_cleanup(void)
 		if (!xnarch_cpu_supported(cpu))
 			continue;
 
-		sched = &nkpod_struct.sched[cpu];
+		sched = xnpod_sched_slot(cpu);
 		down(&sched->gksync);
 		sched->gktarget = NULL;
 		kthread_stop(sched->gatekeeper);
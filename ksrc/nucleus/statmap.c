@@ -0,0 +1,198 @@
+/*!\file nucleus/statmap.c
+ * \brief Mappable thread statistics.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * \ingroup nucleus
+ */
+
+/*
+ * Reading /proc/xenomai/stat formats every thread under nklock,
+ * which is too costly to be done at a high rate on systems running
+ * hundreds of threads. Instead, the nucleus may mirror the main
+ * per-thread counters into an array of slots living in a mapped
+ * heap, so that a monitoring tool may sample them from user-space
+ * without issuing any syscall (see nucleus/statmap.h for the
+ * layout).
+ */
+
+#include <nucleus/pod.h>
+#include <nucleus/heap.h>
+#include <nucleus/vfile.h>
+#include <nucleus/statmap.h>
+
+#define STATMAP_NR_SLOTS  CONFIG_XENO_OPT_STATS_MAP_SLOTS
+
+static struct xnheap statmap_heap;
+
+static struct xnstatmap_area *statmap_area;
+
+static unsigned int statmap_serial, statmap_used, statmap_dropped;
+
+void xnstatmap_attach(struct xnthread *thread)
+{
+	struct xnstatmap_slot *slot;
+	unsigned int n;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (statmap_area == NULL)
+		goto unlock_and_exit;
+
+	for (n = 0; n < STATMAP_NR_SLOTS; n++) {
+		slot = &statmap_area->slots[n];
+		if (slot->serial == 0)
+			goto found;
+	}
+
+	statmap_dropped++;
+	goto unlock_and_exit;
+
+  found:
+	if (++statmap_serial == 0)
+		statmap_serial = 1;
+
+	xnwrite_seqcount_begin(&slot->seq);
+	slot->serial = statmap_serial;
+	slot->pid = 0;
+	slot->cpu = xnsched_cpu(thread->sched);
+	slot->exectime = 0;
+	slot->csw = 0;
+	slot->ssw = 0;
+	slot->pf = 0;
+	memcpy(slot->name, thread->name, sizeof(slot->name));
+	xnwrite_seqcount_end(&slot->seq);
+
+	thread->stat.map = slot;
+	statmap_used++;
+
+  unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+/* Must be called with nklock locked, interrupts off. */
+void xnstatmap_detach(struct xnthread *thread)
+{
+	struct xnstatmap_slot *slot = thread->stat.map;
+
+	if (slot == NULL)
+		return;
+
+	xnwrite_seqcount_begin(&slot->seq);
+	slot->serial = 0;
+	xnwrite_seqcount_end(&slot->seq);
+
+	thread->stat.map = NULL;
+	statmap_used--;
+}
+
+/*
+ * Called over the context switch code and the timer interrupt, with
+ * interrupts off. A thread is only ever refreshed by the CPU it runs
+ * on, so there is a single writer per slot at any time.
+ */
+void __xnstatmap_publish(struct xnthread *thread)
+{
+	struct xnstatmap_slot *slot = thread->stat.map;
+
+	xnwrite_seqcount_begin(&slot->seq);
+	slot->pid = xnthread_user_pid(thread);
+	slot->cpu = xnsched_cpu(thread->sched);
+	slot->exectime = xnstat_exectime_get_total(&thread->stat.account);
+	slot->csw = xnstat_counter_get(&thread->stat.csw);
+	slot->ssw = xnstat_counter_get(&thread->stat.ssw);
+	slot->pf = xnstat_counter_get(&thread->stat.pf);
+	xnwrite_seqcount_end(&slot->seq);
+}
+EXPORT_SYMBOL_GPL(__xnstatmap_publish);
+
+struct xnheap *xnstatmap_heap(void)
+{
+	return statmap_area ? &statmap_heap : NULL;
+}
+
+#ifdef CONFIG_XENO_OPT_VFILE
+
+static int statmap_vfile_show(struct xnvfile_regular_iterator *it, void *data)
+{
+	xnvfile_printf(it, "slots: %u\n", statmap_area->nr_slots);
+	xnvfile_printf(it, "used: %u\n", statmap_used);
+	xnvfile_printf(it, "dropped: %u\n", statmap_dropped);
+	xnvfile_printf(it, "offset: %lu\n",
+		       xnheap_mapped_offset(&statmap_heap, statmap_area));
+	xnvfile_printf(it, "heapsize: %lu\n",
+		       (unsigned long)xnheap_extentsize(&statmap_heap));
+
+	return 0;
+}
+
+static struct xnvfile_regular_ops statmap_vfile_ops = {
+	.show = statmap_vfile_show,
+};
+
+static struct xnvfile_regular statmap_vfile = {
+	.ops = &statmap_vfile_ops,
+};
+
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+int xnstatmap_mount(void)
+{
+	size_t size;
+	int ret;
+
+	size = sizeof(struct xnstatmap_area) +
+		STATMAP_NR_SLOTS * sizeof(struct xnstatmap_slot);
+
+	ret = xnheap_init_mapped(&statmap_heap,
+				 xnheap_rounded_size(size, PAGE_SIZE),
+				 XNARCH_SHARED_HEAP_FLAGS);
+	if (ret)
+		return ret;
+
+	xnheap_set_label(&statmap_heap, "thread statistics");
+
+	statmap_area = xnheap_alloc(&statmap_heap, size);
+	if (statmap_area == NULL) {
+		xnheap_destroy_mapped(&statmap_heap, NULL, NULL);
+		return -ENOMEM;
+	}
+
+	memset(statmap_area, 0, size);
+	statmap_area->nr_slots = STATMAP_NR_SLOTS;
+	statmap_area->tsc_freq = xnarch_get_cpu_freq();
+	xnarch_write_memory_barrier();
+	statmap_area->magic = XNSTATMAP_MAGIC;
+
+#ifdef CONFIG_XENO_OPT_VFILE
+	xnvfile_init_regular("statmap", &statmap_vfile, &nkvfroot);
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+	return 0;
+}
+
+void xnstatmap_umount(void)
+{
+#ifdef CONFIG_XENO_OPT_VFILE
+	xnvfile_destroy_regular(&statmap_vfile);
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+	xnheap_free(&statmap_heap, statmap_area);
+	statmap_area = NULL;
+	xnheap_destroy_mapped(&statmap_heap, NULL, NULL);
+}
@@ -35,10 +35,80 @@
 #include <nucleus/synch.h>
 #include <nucleus/thread.h>
 #include <nucleus/module.h>
+#include <nucleus/evtrace.h>
+#include <nucleus/map.h>
 
 #define w_bprio(t)	xnsched_weighted_bprio(t)
 #define w_cprio(t)	xnsched_weighted_cprio(t)
 
+#if defined(CONFIG_XENO_OPT_PERVASIVE) && defined(CONFIG_XENO_FASTSYNCH)
+
+/*
+ * Priority-protected objects user-space may lock without entering
+ * the nucleus, indexed by the handle their owner publishes for
+ * having the ceiling applied lazily.
+ */
+static xnmap_t *xnsynch_ppmap;
+
+#define XNSYNCH_PP_MAXKEYS	1024
+
+int xnsynch_mount(void)
+{
+	xnsynch_ppmap = xnmap_create(XNSYNCH_PP_MAXKEYS, 0, 1);
+
+	return xnsynch_ppmap ? 0 : -ENOMEM;
+}
+
+void xnsynch_umount(void)
+{
+	xnmap_delete(xnsynch_ppmap);
+}
+
+static inline void xnsynch_enter_pp(struct xnsynch *synch)
+{
+	int key;
+
+	/* Without a handle, user-space goes through the nucleus. */
+	key = xnmap_enter(xnsynch_ppmap, -1, synch);
+	if (key > 0)
+		synch->pph = key;
+}
+
+static inline void xnsynch_forget_pp(struct xnsynch *synch)
+{
+	if (synch->pph != XN_NO_HANDLE) {
+		xnmap_remove(xnsynch_ppmap, synch->pph);
+		synch->pph = XN_NO_HANDLE;
+	}
+}
+
+/*
+ * A lazy ceiling the owner failed to drop by itself, because the
+ * lock got claimed meanwhile, is dropped along with the lock.
+ */
+static inline void xnsynch_cancel_pp(struct xnsynch *synch,
+				     struct xnthread *owner)
+{
+	struct xnthread_user_window *u_window = owner->u_window;
+
+	if (synch->pph != XN_NO_HANDLE && u_window &&
+	    u_window->pp_pending == synch->pph)
+		u_window->pp_pending = XN_NO_HANDLE;
+}
+
+#else /* !(CONFIG_XENO_OPT_PERVASIVE && CONFIG_XENO_FASTSYNCH) */
+
+static inline void xnsynch_forget_pp(struct xnsynch *synch)
+{
+}
+
+static inline void xnsynch_cancel_pp(struct xnsynch *synch,
+				     struct xnthread *owner)
+{
+}
+
+#endif /* !(CONFIG_XENO_OPT_PERVASIVE && CONFIG_XENO_FASTSYNCH) */
+
 /*!
  * \fn void xnsynch_init(struct xnsynch *synch, xnflags_t flags,
  *                       xnarch_atomic_t *fastlock)
@@ -84,6 +154,24 @@
  * synchronization object makes the waiters wait by priority order on
  * the awaited resource (XNSYNCH_PRIO).
  *
+ * - XNSYNCH_SPIN enables adaptive spinning for objects tracking
+ * ownership (XNSYNCH_OWNER). On SMP, a thread contending for the
+ * resource busy-waits for a bounded amount of time as long as the
+ * current owner is running on another CPU, before it is eventually
+ * put to sleep. The spin budget defaults to
+ * CONFIG_XENO_OPT_SYNCH_SPIN_BUDGET, and may be changed by calling
+ * xnsynch_set_spin_budget(). This flag is ignored on uniprocessor
+ * systems.
+ *
+ * - XNSYNCH_PP enables the priority protection protocol, also known
+ * as priority ceiling. The owner of the resource runs at least at
+ * the ceiling priority of the RT class, as set by
+ * xnsynch_set_ceiling(), until it releases the resource. This flag
+ * implies XNSYNCH_PRIO and XNSYNCH_OWNER, and is mutually exclusive
+ * with XNSYNCH_PIP. With fast locks, the lock word must be followed
+ * by a second one (see XNSYNCH_FASTPP_SIZE), so that user-space
+ * owners may defer the ceiling until they get switched out.
+ *
  * @param fastlock Address of the fast lock word to be associated with
  * the synchronization object. If NULL is passed or XNSYNCH_OWNER is not
  * set, fast-lock support is disabled.
@@ -103,24 +191,136 @@ void xnsynch_init(struct xnsynch *synch, xnflags_t flags, xnarch_atomic_t *fastl
 {
 	initph(&synch->link);
 
-	if (flags & XNSYNCH_PIP)
+	if (flags & (XNSYNCH_PIP | XNSYNCH_PP))
 		flags |= XNSYNCH_PRIO | XNSYNCH_OWNER;	/* Obviously... */
 
-	synch->status = flags & ~XNSYNCH_CLAIMED;
+	synch->status = flags & ~(XNSYNCH_CLAIMED | XNSYNCH_CEILING);
 	synch->owner = NULL;
 	synch->cleanup = NULL;	/* Only works for PIP-enabled objects. */
+	synch->ceiling = XNSCHED_RT_MIN_PRIO;
+#ifdef CONFIG_SMP
+	if ((flags & (XNSYNCH_OWNER|XNSYNCH_SPIN)) ==
+	    (XNSYNCH_OWNER|XNSYNCH_SPIN))
+		synch->spin_budget =
+			xnarch_ns_to_tsc(CONFIG_XENO_OPT_SYNCH_SPIN_BUDGET);
+	else
+		synch->spin_budget = 0;
+#endif /* CONFIG_SMP */
 #ifdef CONFIG_XENO_FASTSYNCH
 	if ((flags & XNSYNCH_OWNER) && fastlock) {
 		synch->fastlock = fastlock;
 		xnarch_atomic_set(fastlock, XN_NO_HANDLE);
 	} else
 		synch->fastlock = NULL;
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+	synch->pph = XN_NO_HANDLE;
+	if ((flags & XNSYNCH_PP) && synch->fastlock) {
+		xnsynch_enter_pp(synch);
+		xnarch_atomic_set(fastlock + 1, synch->pph);
+	}
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
 #endif /* CONFIG_XENO_FASTSYNCH */
 	initpq(&synch->pendq);
 	xnarch_init_display_context(synch);
 }
 EXPORT_SYMBOL_GPL(xnsynch_init);
 
+#ifdef CONFIG_SMP
+
+/*!
+ * \fn void xnsynch_set_spin_budget(struct xnsynch *synch, xnticks_t ns);
+ * \brief Set the adaptive spin budget of a synchronization object.
+ *
+ * Changes the maximum amount of time a thread contending for an
+ * object created with XNSYNCH_SPIN busy-waits for the owner to
+ * release it, before going to sleep.
+ *
+ * @param synch The descriptor address of the synchronization object.
+ *
+ * @param ns The new spin budget, in nanoseconds. Zero disables
+ * spinning on this object.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+
+void xnsynch_set_spin_budget(struct xnsynch *synch, xnticks_t ns)
+{
+	synch->spin_budget = xnarch_ns_to_tsc(ns);
+}
+EXPORT_SYMBOL_GPL(xnsynch_set_spin_budget);
+
+/*
+ * Tell whether a contender should spin on the resource instead of
+ * going to sleep immediately, i.e. whether its owner is currently
+ * running on a remote CPU. Called with nklock held.
+ */
+static inline int xnsynch_spin_p(struct xnsynch *synch,
+				 struct xnthread *thread,
+				 struct xnthread *owner)
+{
+	return synch->spin_budget &&
+		owner->sched != thread->sched &&
+		owner->sched->curr == owner;
+}
+
+/*
+ * Busy-wait until the owner releases the resource, stops running on
+ * its CPU, or the spin budget is exhausted, whichever comes
+ * first. Called with nklock released and interrupts on. We never
+ * dereference the owner TCB here, since it might go away meanwhile;
+ * comparing pointers is enough for a heuristic.
+ */
+static void xnsynch_spin_on_owner(struct xnsynch *synch,
+				  struct xnthread *owner,
+				  struct xnsched *osched)
+{
+	xnarch_atomic_t *lockp = xnsynch_fastlock(synch);
+	xnticks_t start = xnarch_get_cpu_tsc();
+	xnhandle_t fastlock = XN_NO_HANDLE;
+
+	if (lockp)
+		fastlock = xnarch_atomic_get(lockp);
+
+	do {
+		cpu_relax();
+
+		if (lockp) {
+			if (xnarch_atomic_get(lockp) != fastlock)
+				break;
+		} else if (*(struct xnthread * volatile *)&synch->owner != owner)
+			break;
+
+		if (*(struct xnthread * volatile *)&osched->curr != owner)
+			break;
+
+	} while (xnarch_get_cpu_tsc() - start < synch->spin_budget);
+}
+
+#else /* !CONFIG_SMP */
+
+static inline int xnsynch_spin_p(struct xnsynch *synch,
+				 struct xnthread *thread,
+				 struct xnthread *owner)
+{
+	return 0;
+}
+
+static inline void xnsynch_spin_on_owner(struct xnsynch *synch,
+					 struct xnthread *owner,
+					 struct xnsched *osched)
+{
+}
+
+#endif /* !CONFIG_SMP */
+
 /*!
  * \fn xnflags_t xnsynch_sleep_on(struct xnsynch *synch, xnticks_t timeout,
  *                                xntmode_t timeout_mode);
@@ -181,6 +381,10 @@ xnflags_t xnsynch_sleep_on(struct xnsynch *synch, xnticks_t timeout,
 	trace_mark(xn_nucleus, synch_sleepon,
 		   "thread %p thread_name %s synch %p",
 		   thread, xnthread_name(thread), synch);
+	xnevtrace_log_obj(XNEVT_SLEEP, thread, synch);
+#ifdef CONFIG_XENO_OPT_STATS_SYNCH
+	thread->stat.sleeps++;
+#endif /* CONFIG_XENO_OPT_STATS_SYNCH */
 
 	if (!testbits(synch->status, XNSYNCH_PRIO)) /* i.e. FIFO */
 		appendpq(&synch->pendq, &thread->plink);
@@ -332,30 +536,272 @@ struct xnpholder *xnsynch_wakeup_this_sleeper(struct xnsynch *synch, struct xnph
 }
 EXPORT_SYMBOL_GPL(xnsynch_wakeup_this_sleeper);
 
+static void xnsynch_notify_priority(struct xnthread *thread)
+{
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+	if (xnthread_test_state(thread, XNRELAX))
+		xnshadow_renice(thread);
+	else if (xnthread_test_state(thread, XNSHADOW))
+		xnthread_set_info(thread, XNPRIOSET);
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+
+	xnshadow_publish(thread);
+}
+
 /*
  * xnsynch_renice_thread() -- This service is used by the PIP code to
  * raise/lower a thread's priority. The thread's base priority value
  * is _not_ changed and if ready, the thread is always moved at the
- * end of its priority group.
+ * end of its priority group. Propagating the change to the resource
+ * the thread may wait for is left to the caller.
  */
 
 static void xnsynch_renice_thread(struct xnthread *thread,
 				  struct xnthread *target)
 {
+#ifdef CONFIG_XENO_OPT_STATS_SYNCH
+	if (w_cprio(target) > w_cprio(thread))
+		thread->stat.boosts++;
+#endif /* CONFIG_XENO_OPT_STATS_SYNCH */
+
 	/* Apply the scheduling policy of "target" to "thread" */
 	xnsched_track_policy(thread, target);
+	xnsynch_notify_priority(thread);
+}
+
+/*
+ * xnsynch_renice_ceiling() -- Same as xnsynch_renice_thread(), for
+ * raising a thread to the ceiling of a PP object it owns.
+ */
 
+static void xnsynch_renice_ceiling(struct xnthread *thread, int prio)
+{
+#ifdef CONFIG_XENO_OPT_STATS_SYNCH
+	thread->stat.boosts++;
+#endif /* CONFIG_XENO_OPT_STATS_SYNCH */
+
+	xnsched_protect_priority(thread, prio);
+	xnsynch_notify_priority(thread);
+}
+
+/*!
+ * @internal
+ * \fn int xnsynch_adjust_boost(struct xnthread *owner);
+ * \brief Recompute the priority boost.
+ *
+ * This service is called internally whenever the claim queue of a
+ * thread has changed, to set its priority to the level required by
+ * the synchronization objects it still holds, i.e. the priority of
+ * their top waiter for PIP objects, or their ceiling for PP objects,
+ * or its initial level if none requires more.
+ *
+ * The claim queue being kept in priority order, only its head has
+ * to be considered.
+ *
+ * @param owner The descriptor address of the thread owning the
+ * synchronization objects.
+ *
+ * @return Non-zero if the (weighted) priority of @a owner changed,
+ * in which case the caller is responsible for propagating the change
+ * to the resource @a owner may wait for.
+ *
+ * @note This routine must be entered nklock locked, interrupts off.
+ */
+
+static int xnsynch_adjust_boost(struct xnthread *owner)
+{
+	struct xnthread *target;
+	struct xnsynch *hsynch;
+	struct xnpholder *h;
+	int wprio;
+
+	wprio = w_bprio(owner);
+
+	if (emptypq_p(&owner->claimq)) {
+		xnthread_clear_state(owner, XNBOOST);
+		target = owner;
+	} else {
+		/* Find the highest priority needed to enforce the PIP/PP. */
+		h = getheadpq(&owner->claimq);
+		hsynch = link2synch(h);
+		if (testbits(hsynch->status, XNSYNCH_CEILING)) {
+			if (h->prio > wprio) {
+				if (w_cprio(owner) == h->prio ||
+				    xnthread_test_state(owner, XNZOMBIE))
+					return 0;
+				xnsynch_renice_ceiling(owner, hsynch->ceiling);
+				return 1;
+			}
+			target = owner;
+		} else {
+			h = getheadpq(&hsynch->pendq);
+			XENO_BUGON(NUCLEUS, h == NULL);
+			target = link2thread(h, plink);
+			if (w_cprio(target) > wprio)
+				wprio = w_cprio(target);
+			else
+				target = owner;
+		}
+	}
+
+	if (w_cprio(owner) == wprio || xnthread_test_state(owner, XNZOMBIE))
+		return 0;
+
+	xnsynch_renice_thread(owner, target);
+
+	return 1;
+}
+
+/*
+ * xnsynch_walk_chain() -- Update the claim @synch exerts on its
+ * owner after its top waiter changed, then carry any resulting
+ * priority change of the owner over to the PIP object it may wait
+ * for in turn, and so on down the chain. The walk is iterative, so
+ * that deep nesting does not eat kernel stack, and stops as soon as
+ * the effective priority of an owner does not change, leaving the
+ * rest of the chain untouched. Must be called nklock locked,
+ * interrupts off.
+ */
+
+static void xnsynch_walk_chain(struct xnsynch *synch)
+{
+	struct xnthread *owner, *waiter;
+	unsigned long depth = 0;
+	int wprio;
+#ifdef CONFIG_XENO_OPT_STATS_SYNCH
+	xnticks_t start = xnstat_exectime_now();
+	struct xnthread *curr;
+#endif /* CONFIG_XENO_OPT_STATS_SYNCH */
+
+	for (;;) {
+		owner = synch->owner;
+		if (owner == NULL || !testbits(synch->status, XNSYNCH_PIP))
+			break;
+
+		waiter = link2thread(getheadpq(&synch->pendq), plink);
+		wprio = w_cprio(waiter);
+
+		if (testbits(synch->status, XNSYNCH_CLAIMED)) {
+			if (synch->link.prio == wprio)
+				break;
+			removepq(&owner->claimq, &synch->link);
+		} else {
+			if (wprio <= w_cprio(owner))
+				break;
+			__setbits(synch->status, XNSYNCH_CLAIMED);
+			if (!xnthread_test_state(owner, XNBOOST)) {
+				owner->bprio = owner->cprio;
+				xnthread_set_state(owner, XNBOOST);
+			}
+		}
+
+		insertpqf(&owner->claimq, &synch->link, wprio);
+
+		if (!xnsynch_adjust_boost(owner))
+			break;
+
+		depth++;
+		synch = owner->wchan;
+		if (synch == NULL || !testbits(synch->status, XNSYNCH_PRIO))
+			break;
+
+		removepq(&synch->pendq, &owner->plink);
+		insertpqf(&synch->pendq, &owner->plink, w_cprio(owner));
+	}
+
+#ifdef CONFIG_XENO_OPT_STATS_SYNCH
+	curr = xnpod_current_thread();
+	start = xnstat_exectime_now() - start;
+	if (depth > curr->stat.chain_max)
+		curr->stat.chain_max = depth;
+	if (start > curr->stat.chain_time)
+		curr->stat.chain_time = start;
+#endif /* CONFIG_XENO_OPT_STATS_SYNCH */
+}
+
+/*
+ * xnsynch_propagate_boost() -- Carry a priority change applied to
+ * @thread over to the resource it waits for, if any.
+ */
+
+static inline void xnsynch_propagate_boost(struct xnthread *thread)
+{
 	if (thread->wchan)
 		xnsynch_requeue_sleeper(thread);
+}
 
-#ifdef CONFIG_XENO_OPT_PERVASIVE
-	if (xnthread_test_state(thread, XNRELAX))
-		xnshadow_renice(thread);
-	else if (xnthread_test_state(thread, XNSHADOW))
-		xnthread_set_info(thread, XNPRIOSET);
-#endif /* CONFIG_XENO_OPT_PERVASIVE */
+static inline int xnsynch_ceiling_wprio(struct xnsynch *synch)
+{
+	return synch->ceiling + xnsched_class_rt.weight;
+}
+
+/*
+ * xnsynch_apply_ceiling() -- Link a PP object to the claim queue of
+ * its new owner, raising the latter to the ceiling if need be. Must
+ * be called nklock locked, interrupts off.
+ */
+
+static void xnsynch_apply_ceiling(struct xnsynch *synch,
+				  struct xnthread *owner)
+{
+	int wprio = xnsynch_ceiling_wprio(synch);
+
+	if (testbits(synch->status, XNSYNCH_CEILING))
+		return;
+
+	if (!xnthread_test_state(owner, XNBOOST)) {
+		owner->bprio = owner->cprio;
+		xnthread_set_state(owner, XNBOOST);
+	}
+
+	__setbits(synch->status, XNSYNCH_CEILING);
+	insertpqf(&owner->claimq, &synch->link, wprio);
+
+	if (wprio > w_cprio(owner)) {
+		xnsynch_renice_ceiling(owner, synch->ceiling);
+		xnsynch_propagate_boost(owner);
+	}
 }
 
+/*!
+ * \fn void xnsynch_protect_owner(struct xnsynch *synch);
+ * \brief Apply the priority ceiling to a new owner.
+ *
+ * This service should be called by upper interfaces which grabbed a
+ * synchronization object on behalf of the current thread without
+ * going through xnsynch_acquire(), e.g. by calling
+ * xnsynch_fast_acquire(), in order to raise the thread to the
+ * ceiling of priority-protected objects (XNSYNCH_PP). It has no
+ * effect on other objects.
+ *
+ * @param synch The descriptor address of the synchronization object
+ * the current thread just grabbed.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+
+void xnsynch_protect_owner(struct xnsynch *synch)
+{
+	struct xnthread *thread = xnpod_current_thread();
+	spl_t s;
+
+	if (!testbits(synch->status, XNSYNCH_PP))
+		return;
+
+	xnlock_get_irqsave(&nklock, s);
+	xnsynch_set_owner(synch, thread);
+	xnsynch_apply_ceiling(synch, thread);
+	xnlock_put_irqrestore(&nklock, s);
+}
+EXPORT_SYMBOL_GPL(xnsynch_protect_owner);
+
 /*!
  * \fn xnflags_t xnsynch_acquire(struct xnsynch *synch, xnticks_t timeout,
  *                               xntmode_t timeout_mode);
@@ -409,11 +855,24 @@ xnflags_t xnsynch_acquire(struct xnsynch *synch, xnticks_t timeout,
 	struct xnthread *thread = xnpod_current_thread(), *owner;
 	xnhandle_t threadh = xnthread_handle(thread), fastlock, old;
 	const int use_fastlock = xnsynch_fastlock_p(synch);
+	struct xnsched *osched;
+	int spin;
 	spl_t s;
 
 	XENO_BUGON(NUCLEUS, !testbits(synch->status, XNSYNCH_OWNER));
 
+	/*
+	 * Adaptive spinning is only attempted once per acquisition,
+	 * and never when the caller holds nklock, since the owner
+	 * might then be prevented from releasing the resource.
+	 */
+	spin = testbits(synch->status, XNSYNCH_SPIN) &&
+		!xnlock_is_owner(&nklock);
+
 	trace_mark(xn_nucleus, synch_acquire, "synch %p", synch);
+#ifdef CONFIG_XENO_OPT_STATS_SYNCH
+	thread->stat.acquires++;
+#endif /* CONFIG_XENO_OPT_STATS_SYNCH */
 
       redo:
 
@@ -428,11 +887,29 @@ xnflags_t xnsynch_acquire(struct xnsynch *synch, xnticks_t timeout,
 				xnthread_inc_rescnt(thread);
 			xnthread_clear_info(thread,
 					    XNRMID | XNTIMEO | XNBREAK);
+			xnsynch_protect_owner(synch);
 			return 0;
 		}
 
 		xnlock_get_irqsave(&nklock, s);
 
+		/*
+		 * Spin on an unclaimed lock held by a thread running
+		 * on a remote CPU, which will release it through the
+		 * lockless path. Once claimed, the resource is handed
+		 * over to the sleepers, so spinning would be useless.
+		 */
+		if (spin && !xnsynch_fast_is_claimed(fastlock)) {
+			owner = xnthread_lookup(fastlock);
+			if (owner && xnsynch_spin_p(synch, thread, owner)) {
+				osched = owner->sched;
+				xnlock_put_irqrestore(&nklock, s);
+				xnsynch_spin_on_owner(synch, owner, osched);
+				spin = 0;
+				goto redo;
+			}
+		}
+
 		/* Set claimed bit.
 		   In case it appears to be set already, re-read its state
 		   under nklock so that we don't miss any change between the
@@ -480,8 +957,19 @@ xnflags_t xnsynch_acquire(struct xnsynch *synch, xnticks_t timeout,
 				xnthread_inc_rescnt(thread);
 			xnthread_clear_info(thread,
 					    XNRMID | XNTIMEO | XNBREAK);
+			if (testbits(synch->status, XNSYNCH_PP))
+				xnsynch_apply_ceiling(synch, thread);
 			goto unlock_and_exit;
 		}
+
+		if (spin && !xnsynch_pended_p(synch) &&
+		    xnsynch_spin_p(synch, thread, owner)) {
+			osched = owner->sched;
+			xnlock_put_irqrestore(&nklock, s);
+			xnsynch_spin_on_owner(synch, owner, osched);
+			spin = 0;
+			goto redo;
+		}
 	}
 
 	xnsynch_detect_relaxed_owner(synch, thread);
@@ -498,21 +986,7 @@ xnflags_t xnsynch_acquire(struct xnsynch *synch, xnticks_t timeout,
 		}
 
 		insertpqf(&synch->pendq, &thread->plink, w_cprio(thread));
-
-		if (testbits(synch->status, XNSYNCH_PIP)) {
-			if (!xnthread_test_state(owner, XNBOOST)) {
-				owner->bprio = owner->cprio;
-				xnthread_set_state(owner, XNBOOST);
-			}
-
-			if (testbits(synch->status, XNSYNCH_CLAIMED))
-				removepq(&owner->claimq, &synch->link);
-			else
-				__setbits(synch->status, XNSYNCH_CLAIMED);
-
-			insertpqf(&owner->claimq, &synch->link, w_cprio(thread));
-			xnsynch_renice_thread(owner, thread);
-		}
+		xnsynch_walk_chain(synch);
 	} else
 		insertpqf(&synch->pendq, &thread->plink, w_cprio(thread));
 
@@ -532,7 +1006,7 @@ xnflags_t xnsynch_acquire(struct xnsynch *synch, xnticks_t timeout,
 			xnlock_put_irqrestore(&nklock, s);
 			goto redo;
 		}
-		timeout = xntimer_get_timeout_stopped(&thread->rtimer);
+		timeout = xnthread_rtimeout(thread);
 		if (timeout > 1) { /* Otherwise, it's too late. */
 			xnlock_put_irqrestore(&nklock, s);
 			goto redo;
@@ -545,6 +1019,13 @@ xnflags_t xnsynch_acquire(struct xnsynch *synch, xnticks_t timeout,
 		if (xnthread_test_state(thread, XNOTHER))
 			xnthread_inc_rescnt(thread);
 
+		/*
+		 * A handed over PP object only raises its owner once
+		 * the latter resumes, it might be robbed before.
+		 */
+		if (testbits(synch->status, XNSYNCH_PP))
+			xnsynch_apply_ceiling(synch, thread);
+
 		if (use_fastlock) {
 			xnarch_atomic_t *lockp = xnsynch_fastlock(synch);
 			/* We are the new owner, update the fastlock
@@ -570,8 +1051,9 @@ EXPORT_SYMBOL_GPL(xnsynch_acquire);
  * \brief Clear the priority boost.
  *
  * This service is called internally whenever a synchronization object
- * is not claimed anymore by sleepers to reset the object owner's
- * priority to its initial level.
+ * is not claimed anymore by sleepers, or its ceiling stops applying
+ * to its owner, to reset the object owner's priority to the level
+ * required by the other objects it holds.
  *
  * @param synch The descriptor address of the synchronization object.
  *
@@ -584,33 +1066,10 @@ EXPORT_SYMBOL_GPL(xnsynch_acquire);
 static void xnsynch_clear_boost(struct xnsynch *synch,
 				struct xnthread *owner)
 {
-	struct xnthread *target;
-	struct xnsynch *hsynch;
-	struct xnpholder *h;
-	int wprio;
-
 	removepq(&owner->claimq, &synch->link);
-	__clrbits(synch->status, XNSYNCH_CLAIMED);
-	wprio = w_bprio(owner);
-
-	if (emptypq_p(&owner->claimq)) {
-		xnthread_clear_state(owner, XNBOOST);
-		target = owner;
-	} else {
-		/* Find the highest priority needed to enforce the PIP. */
-		hsynch = link2synch(getheadpq(&owner->claimq));
-		h = getheadpq(&hsynch->pendq);
-		XENO_BUGON(NUCLEUS, h == NULL);
-		target = link2thread(h, plink);
-		if (w_cprio(target) > wprio)
-			wprio = w_cprio(target);
-		else
-			target = owner;
-	}
-
-	if (w_cprio(owner) != wprio &&
-	    !xnthread_test_state(owner, XNZOMBIE))
-		xnsynch_renice_thread(owner, target);
+	__clrbits(synch->status, XNSYNCH_CLAIMED | XNSYNCH_CEILING);
+	if (xnsynch_adjust_boost(owner))
+		xnsynch_propagate_boost(owner);
 }
 
 /*!
@@ -629,50 +1088,201 @@ static void xnsynch_clear_boost(struct xnsynch *synch,
 void xnsynch_requeue_sleeper(struct xnthread *thread)
 {
 	struct xnsynch *synch = thread->wchan;
-	struct xnthread *owner;
 
 	if (!testbits(synch->status, XNSYNCH_PRIO))
 		return;
 
 	removepq(&synch->pendq, &thread->plink);
 	insertpqf(&synch->pendq, &thread->plink, w_cprio(thread));
-	owner = synch->owner;
 
-	if (owner != NULL && w_cprio(thread) > w_cprio(owner)) {
+	/*
+	 * Update the PI state down the chain, waiters never boost the
+	 * owner of a PP object though.
+	 */
+	xnsynch_walk_chain(synch);
+}
+EXPORT_SYMBOL_GPL(xnsynch_requeue_sleeper);
+
+/*!
+ * \fn int xnsynch_requeue_sleepers(struct xnsynch *from, struct xnsynch *to, int nr);
+ * \brief Move sleepers to the wait queue of an owned resource.
+ *
+ * This service implements wait morphing for condition variables:
+ * instead of being woken up only to block again on the resource
+ * protecting the condition, up to @a nr threads sleeping on @a from
+ * are moved directly to the pending queue of @a to, as if they had
+ * called xnsynch_acquire() on it. They will be resumed one at a
+ * time, as the resource is handed over to them by xnsynch_release().
+ *
+ * Sleepers are only moved if @a to is currently owned, otherwise
+ * nothing would ever wake them up; the caller should then fall back
+ * to waking them up. Moved threads stop waiting for their timeout,
+ * since they are no more waiting for the condition. Once resumed,
+ * they should call xnsynch_accept_handoff() to find out whether they
+ * actually own @a to.
+ *
+ * @param from The descriptor address of the synchronization object
+ * the threads sleep on, which must not track ownership.
+ *
+ * @param to The descriptor address of the synchronization object the
+ * threads should wait for, which must track ownership (XNSYNCH_OWNER
+ * set).
+ *
+ * @param nr The maximum number of threads to move, or -1 to move all
+ * of them.
+ *
+ * @return The number of threads moved to @a to.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+
+int xnsynch_requeue_sleepers(struct xnsynch *from, struct xnsynch *to,
+			     int nr)
+{
+	struct xnthread *thread, *owner;
+	struct xnpholder *holder;
+	xnhandle_t fastlock, old;
+	int moved = 0;
+	spl_t s;
+
+	XENO_BUGON(NUCLEUS, testbits(from->status, XNSYNCH_OWNER));
+	XENO_BUGON(NUCLEUS, !testbits(to->status, XNSYNCH_OWNER));
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!xnsynch_pended_p(from))
+		goto unlock_and_exit;
+
+	if (xnsynch_fastlock_p(to)) {
+		xnarch_atomic_t *lockp = xnsynch_fastlock(to);
+
 		/*
-		 * The new (weighted) priority of the sleeping thread
-		 * is higher than the priority of the current owner of
-		 * the resource: we need to update the PI state.
+		 * Claim the resource, so that the owner releases it
+		 * through xnsynch_release() and hands it over to the
+		 * moved threads.
 		 */
-		if (testbits(synch->status, XNSYNCH_CLAIMED)) {
-			/*
-			 * The resource is already claimed, just
-			 * reorder the claim queue.
-			 */
-			removepq(&owner->claimq, &synch->link);
-			insertpqf(&owner->claimq, &synch->link,
-				  w_cprio(thread));
-		} else {
-			/*
-			 * The resource was NOT claimed, claim it now
-			 * and boost the owner.
-			 */
-			__setbits(synch->status, XNSYNCH_CLAIMED);
-			insertpqf(&owner->claimq, &synch->link,
-				  w_cprio(thread));
-			if (!xnthread_test_state(owner, XNBOOST)) {
-				owner->bprio = owner->cprio;
-				xnthread_set_state(owner, XNBOOST);
-			}
+		fastlock = xnarch_atomic_get(lockp);
+		while (!xnsynch_fast_is_claimed(fastlock)) {
+			if (fastlock == XN_NO_HANDLE)
+				goto unlock_and_exit;
+			old = xnarch_atomic_cmpxchg(lockp, fastlock,
+					xnsynch_fast_set_claimed(fastlock, 1));
+			if (likely(old == fastlock))
+				break;
+			fastlock = old;
 		}
-		/*
-		 * Renice the owner thread, progressing in the PI
-		 * chain as needed.
-		 */
-		xnsynch_renice_thread(owner, thread);
+
+		owner = xnthread_lookup(xnsynch_fast_mask_claimed(fastlock));
+		if (owner == NULL)
+			goto unlock_and_exit;
+
+		xnsynch_set_owner(to, owner);
+	} else {
+		owner = to->owner;
+		if (owner == NULL)
+			goto unlock_and_exit;
 	}
+
+	while (moved != nr && (holder = getpq(&from->pendq)) != NULL) {
+		thread = link2thread(holder, plink);
+
+		trace_mark(xn_nucleus, synch_requeue,
+			   "thread %p thread_name %s from %p to %p",
+			   thread, xnthread_name(thread), from, to);
+
+		if (xnthread_test_state(thread, XNDELAY)) {
+			xnthread_stop_rtimer(thread);
+			xnthread_clear_state(thread, XNDELAY);
+		}
+
+		thread->wchan = to;
+		moved++;
+
+		if (!testbits(to->status, XNSYNCH_PRIO)) { /* i.e. FIFO */
+			appendpq(&to->pendq, &thread->plink);
+			continue;
+		}
+
+		insertpqf(&to->pendq, &thread->plink, w_cprio(thread));
+
+		if (w_cprio(thread) > w_cprio(owner))
+			xnsynch_walk_chain(to);
+	}
+
+	xnarch_post_graph_if(from, 0, emptypq_p(&from->pendq));
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return moved;
 }
-EXPORT_SYMBOL_GPL(xnsynch_requeue_sleeper);
+EXPORT_SYMBOL_GPL(xnsynch_requeue_sleepers);
+
+/*!
+ * \fn int xnsynch_accept_handoff(struct xnsynch *synch);
+ * \brief Complete an acquisition started by wait morphing.
+ *
+ * This service should be called by a thread resumed from a wait on a
+ * synchronization object it might have been moved from by
+ * xnsynch_requeue_sleepers(), in order to find out whether the
+ * ownership of @a synch was handed over to it meanwhile. If so, the
+ * acquisition is completed as xnsynch_acquire() would have done.
+ *
+ * @param synch The descriptor address of the synchronization object
+ * the current thread may have been moved to.
+ *
+ * @return 1 if the current thread owns @a synch, 0 otherwise, in
+ * which case the caller should acquire it the usual way.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+
+int xnsynch_accept_handoff(struct xnsynch *synch)
+{
+	struct xnthread *thread = xnpod_current_thread();
+	int ret = 0;
+	spl_t s;
+
+	XENO_BUGON(NUCLEUS, !testbits(synch->status, XNSYNCH_OWNER));
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (thread->wwake == synch) {
+		thread->wwake = NULL;
+		xnthread_clear_info(thread, XNWAKEN);
+
+		if (!xnthread_test_info(thread, XNROBBED) &&
+		    xnsynch_owner_check(synch, thread) == 0) {
+			if (xnthread_test_state(thread, XNOTHER))
+				xnthread_inc_rescnt(thread);
+			if (testbits(synch->status, XNSYNCH_PP))
+				xnsynch_apply_ceiling(synch, thread);
+			ret = 1;
+		}
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(xnsynch_accept_handoff);
 
 static struct xnthread *
 xnsynch_release_thread(struct xnsynch *synch, struct xnthread *lastowner)
@@ -696,7 +1306,8 @@ xnsynch_release_thread(struct xnsynch *synch, struct xnthread *lastowner)
 #endif
 	lastownerh = xnthread_handle(lastowner);
 
-	if (use_fastlock &&
+	/* Dropping a ceiling requires nklock. */
+	if (use_fastlock && !testbits(synch->status, XNSYNCH_PP) &&
 	    likely(xnsynch_fast_release(xnsynch_fastlock(synch), lastownerh)))
 		return NULL;
 
@@ -704,6 +1315,11 @@ xnsynch_release_thread(struct xnsynch *synch, struct xnthread *lastowner)
 
 	trace_mark(xn_nucleus, synch_release, "synch %p", synch);
 
+	if (testbits(synch->status, XNSYNCH_CEILING))
+		xnsynch_clear_boost(synch, lastowner);
+	else if (testbits(synch->status, XNSYNCH_PP))
+		xnsynch_cancel_pp(synch, lastowner);
+
 	holder = getpq(&synch->pendq);
 	if (holder) {
 		newowner = link2thread(holder, plink);
@@ -886,11 +1502,14 @@ int xnsynch_flush(struct xnsynch *synch, xnflags_t reason)
 		xnpod_resume_thread(sleeper, XNPEND);
 	}
 
-	if (testbits(synch->status, XNSYNCH_CLAIMED)) {
+	if (testbits(synch->status, XNSYNCH_CLAIMED | XNSYNCH_CEILING)) {
 		xnsynch_clear_boost(synch, synch->owner);
 		status = XNSYNCH_RESCHED;
 	}
 
+	if (reason & XNRMID)
+		xnsynch_forget_pp(synch);
+
 	xnlock_put_irqrestore(&nklock, s);
 
 	xnarch_post_graph_if(synch, 0, emptypq_p(&synch->pendq));
@@ -921,8 +1540,6 @@ EXPORT_SYMBOL_GPL(xnsynch_flush);
 void xnsynch_forget_sleeper(struct xnthread *thread)
 {
 	struct xnsynch *synch = thread->wchan;
-	struct xnthread *owner, *target;
-	struct xnpholder *h;
 
 	trace_mark(xn_nucleus, synch_forget,
 		   "thread %p thread_name %s synch %p",
@@ -933,31 +1550,16 @@ void xnsynch_forget_sleeper(struct xnthread *thread)
 	removepq(&synch->pendq, &thread->plink);
 
 	if (testbits(synch->status, XNSYNCH_CLAIMED)) {
-		/* Find the highest priority needed to enforce the PIP. */
-		owner = synch->owner;
-
 		if (emptypq_p(&synch->pendq))
 			/* No more sleepers: clear the boost. */
-			xnsynch_clear_boost(synch, owner);
-		else {
-			target = link2thread(getheadpq(&synch->pendq), plink);
-			h = getheadpq(&owner->claimq);
-			if (w_cprio(target) != h->prio) {
-				/*
-				 * Reorder the claim queue, and lower
-				 * the priority to the required
-				 * minimum needed to prevent priority
-				 * inversion.
-				 */
-				removepq(&owner->claimq, &synch->link);
-				insertpqf(&owner->claimq, &synch->link,
-					  w_cprio(target));
-
-				h = getheadpq(&owner->claimq);
-				if (h->prio < w_cprio(owner))
-					xnsynch_renice_thread(owner, target);
-			}
-		}
+			xnsynch_clear_boost(synch, synch->owner);
+		else
+			/*
+			 * Lower the owner priority to the required
+			 * minimum needed to prevent priority
+			 * inversion.
+			 */
+			xnsynch_walk_chain(synch);
 	}
 
 	xnarch_post_graph_if(synch, 0, emptypq_p(&synch->pendq));
@@ -998,6 +1600,54 @@ void xnsynch_release_all_ownerships(struct xnthread *thread)
 }
 EXPORT_SYMBOL_GPL(xnsynch_release_all_ownerships);
 
+#if defined(CONFIG_XENO_OPT_PERVASIVE) && defined(CONFIG_XENO_FASTSYNCH)
+
+/*!
+ * @internal
+ * \fn void xnsynch_commit_ceiling(struct xnthread *curr);
+ * \brief Apply a lazy priority ceiling.
+ *
+ * This service is called by the rescheduling procedure when the
+ * current thread published the handle of a PP object in the
+ * pp_pending field of its state window, having grabbed the object's
+ * fast lock from user-space without raising its priority. The
+ * ceiling is applied for real if the thread actually owns the
+ * object, and the claim bit is raised in the fast lock, so that the
+ * thread releases it through the nucleus, which drops the ceiling.
+ *
+ * @param curr The descriptor address of the current thread.
+ *
+ * @note This routine must be entered nklock locked, interrupts off.
+ */
+
+void xnsynch_commit_ceiling(struct xnthread *curr)
+{
+	struct xnthread_user_window *u_window = curr->u_window;
+	xnhandle_t pph = u_window->pp_pending, h;
+	struct xnsynch *synch;
+
+	synch = xnmap_fetch(xnsynch_ppmap, pph);
+	if (synch == NULL) {
+		u_window->pp_pending = XN_NO_HANDLE;
+		return;
+	}
+
+	/*
+	 * The handle is published before the lock is grabbed, leave
+	 * it pending until we actually own the lock.
+	 */
+	h = xnarch_atomic_get(synch->fastlock);
+	if (xnsynch_fast_mask_claimed(h) != xnthread_handle(curr))
+		return;
+
+	u_window->pp_pending = XN_NO_HANDLE;
+	xnarch_atomic_set(synch->fastlock, xnsynch_fast_set_claimed(h, 1));
+	xnsynch_set_owner(synch, curr);
+	xnsynch_apply_ceiling(synch, curr);
+}
+
+#endif /* CONFIG_XENO_OPT_PERVASIVE && CONFIG_XENO_FASTSYNCH */
+
 #if XENO_DEBUG(SYNCH_RELAX)
 
 /*
@@ -22,6 +22,8 @@
 #include <nucleus/heap.h>
 #include <nucleus/thread.h>
 #include <nucleus/module.h>
+#include <nucleus/statmap.h>
+#include <nucleus/budget.h>
 #include <asm/xenomai/bits/thread.h>
 
 static unsigned idtags;
@@ -29,6 +31,22 @@ static unsigned idtags;
 static void xnthread_timeout_handler(xntimer_t *timer)
 {
 	xnthread_t *thread = container_of(timer, xnthread_t, rtimer);
+#ifdef CONFIG_XENO_OPT_TIMER_LAZY
+	xnticks_t date = thread->rtdate;
+
+	/* The wait this timer was armed for ended early. */
+	if (thread->rtstale) {
+		thread->rtstale = 0;
+		return;
+	}
+
+	/* Armed for an earlier wait, catch up with the deadline. */
+	if (date != XN_INFINITE) {
+		thread->rtdate = XN_INFINITE;
+		if (xntimer_start(timer, date, XN_INFINITE, XN_ABSOLUTE) == 0)
+			return;
+	}
+#endif /* CONFIG_XENO_OPT_TIMER_LAZY */
 	xnthread_set_info(thread, XNTIMEO);	/* Interrupts are off. */
 	xnpod_resume_thread(thread, XNDELAY);
 }
@@ -53,7 +71,7 @@ int xnthread_init(struct xnthread *thread,
 	unsigned int stacksize = attr->stacksize;
 	xnflags_t flags = attr->flags;
 	struct xnarchtcb *tcb;
-	int ret;
+	int ret, gravity;
 
 	/* Setup the TCB. */
 	tcb = xnthread_archtcb(thread);
@@ -110,6 +128,14 @@ int xnthread_init(struct xnthread *thread,
 	xntimer_init(&thread->ptimer, attr->tbase, xnthread_periodic_handler);
 	xntimer_set_name(&thread->ptimer, thread->name);
 	xntimer_set_priority(&thread->ptimer, XNTIMER_HIPRIO);
+	thread->prerelease = 0;
+	gravity = (flags & XNSHADOW) ? XNTIMER_UGRAVITY : XNTIMER_KGRAVITY;
+	xntimer_set_gravity(&thread->rtimer, gravity);
+	xntimer_set_gravity(&thread->ptimer, gravity);
+#ifdef CONFIG_XENO_OPT_TIMER_LAZY
+	thread->rtdate = XN_INFINITE;
+	thread->rtstale = 0;
+#endif /* CONFIG_XENO_OPT_TIMER_LAZY */
 
 	thread->state = flags;
 	thread->info = 0;
@@ -123,6 +149,13 @@ int xnthread_init(struct xnthread *thread,
 	thread->ops = attr->ops;
 	thread->rrperiod = XN_INFINITE;
 	thread->rrcredit = XN_INFINITE;
+	thread->rrbudget = 0;
+#ifdef CONFIG_XENO_OPT_TIMING_TICKLESS
+	thread->rrtracked = 0;
+#endif /* CONFIG_XENO_OPT_TIMING_TICKLESS */
+#ifdef CONFIG_XENO_OPT_CACHE_PARTITION
+	thread->cacheclass = -1;
+#endif /* CONFIG_XENO_OPT_CACHE_PARTITION */
 	thread->wchan = NULL;
 	thread->wwake = NULL;
 	thread->wcontext = NULL;
@@ -131,6 +164,11 @@ int xnthread_init(struct xnthread *thread,
 	thread->registry.handle = XN_NO_HANDLE;
 	thread->registry.waitkey = NULL;
 	memset(&thread->stat, 0, sizeof(thread->stat));
+#ifdef CONFIG_XENO_OPT_SCHED_BALANCE
+	xnarch_cpus_clear(thread->lb_affinity);
+	thread->lb_lastexec = 0;
+	thread->lb_load = 0;
+#endif /* CONFIG_XENO_OPT_SCHED_BALANCE */
 
 	/* These will be filled by xnpod_start_thread() */
 	thread->imask = 0;
@@ -147,8 +185,16 @@ int xnthread_init(struct xnthread *thread,
 #endif /* CONFIG_XENO_OPT_PRIOCPL */
 #ifdef CONFIG_XENO_OPT_SELECT
 	thread->selector = NULL;
+	thread->eselector = NULL;
 #endif /* CONFIG_XENO_OPT_SELECT */
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+	thread->u_mode = NULL;
+	thread->u_window = NULL; /* xnshadow_map() will set it. */
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
 	initpq(&thread->claimq);
+#ifdef CONFIG_SMP
+	thread->bound_intrs = NULL;
+#endif /* CONFIG_SMP */
 
 	thread->sched = sched;
 	thread->init_class = sched_class;
@@ -169,6 +215,12 @@ int xnthread_init(struct xnthread *thread,
 
 	xnarch_init_display_context(thread);
 
+#ifdef CONFIG_XENO_OPT_SCHED_BUDGET
+	xnbudget_init_thread(thread);
+#endif /* CONFIG_XENO_OPT_SCHED_BUDGET */
+
+	xnstatmap_attach(thread);
+
 	return 0;
 
 fail:
@@ -189,6 +241,8 @@ void xnthread_cleanup_tcb(xnthread_t *thread)
 		xnregistry_remove(thread->registry.handle);
 
 	thread->registry.handle = XN_NO_HANDLE;
+
+	xnstatmap_detach(thread);
 }
 
 char *xnthread_format_status(xnflags_t status, char *buf, int size)
@@ -276,7 +330,7 @@ xnticks_t xnthread_get_timeout(xnthread_t *thread, xnticks_t tsc_ns)
 	if (!xnthread_test_state(thread,XNDELAY))
 		return 0LL;
 
-	if (xntimer_running_p(&thread->rtimer))
+	if (xnthread_rtimer_running_p(thread))
 		timer = &thread->rtimer;
 	else if (xntimer_running_p(&thread->ptimer))
 		timer = &thread->ptimer;
@@ -297,6 +351,10 @@ xnticks_t xnthread_get_timeout(xnthread_t *thread, xnticks_t tsc_ns)
 		return xntimer_get_timeout(timer);
 
 	timeout = xntimer_get_date(timer);
+#ifdef CONFIG_XENO_OPT_TIMER_LAZY
+	if (timer == &thread->rtimer && thread->rtdate != XN_INFINITE)
+		timeout = thread->rtdate;
+#endif /* CONFIG_XENO_OPT_TIMER_LAZY */
 
 	if (timeout <= tsc_ns)
 		return 1;
@@ -305,6 +363,102 @@ xnticks_t xnthread_get_timeout(xnthread_t *thread, xnticks_t tsc_ns)
 }
 EXPORT_SYMBOL_GPL(xnthread_get_timeout);
 
+/*
+ * Arm the resource timer of @a thread for a timed wait. Returns
+ * -ETIMEDOUT if the timeout date has already elapsed, -EINVAL if the
+ * timer could not be moved to the CPU of @a thread. Must be called
+ * with nklock held, IRQs off.
+ */
+int xnthread_start_rtimer(struct xnthread *thread,
+			  xnticks_t timeout, xntmode_t timeout_mode)
+{
+	xntimer_t *timer = &thread->rtimer;
+	int ret;
+#ifdef CONFIG_XENO_OPT_TIMER_LAZY
+	xnticks_t date, armed, now;
+
+	/*
+	 * The timer of a wait which ended early is still queued. If
+	 * the new deadline is not earlier than the date it is armed
+	 * for, we only record the deadline, and the timeout handler
+	 * moves the timer forward if it ever elapses while the thread
+	 * still waits. Otherwise, requeuing the timer costs the same
+	 * as starting it anew.
+	 */
+	if (thread->rtstale && xntimer_running_p(timer) &&
+	    timeout_mode != XN_REALTIME &&
+	    xntimer_sched(timer) == thread->sched) {
+		now = xntbase_get_jiffies(xntimer_base(timer));
+		date = timeout_mode == XN_RELATIVE ? now + timeout : timeout;
+		if ((xnsticks_t)(date - now) <= 0)
+			return -ETIMEDOUT;
+		armed = xntimer_get_date(timer);
+		if ((xnsticks_t)(date - armed) >= 0) {
+			thread->rtdate = date == armed ? XN_INFINITE : date;
+			thread->rtstale = 0;
+			return 0;
+		}
+	}
+
+	thread->rtdate = XN_INFINITE;
+	thread->rtstale = 0;
+	/*
+	 * A stale timer may still be queued on the CPU the thread
+	 * left since, which xntimer_set_sched() refuses to migrate
+	 * from here. Dequeue it first.
+	 */
+	if (xntimer_running_p(timer) && xntimer_sched(timer) != thread->sched)
+		xntimer_stop(timer);
+#endif /* CONFIG_XENO_OPT_TIMER_LAZY */
+	ret = xntimer_set_sched(timer, thread->sched);
+	if (ret)
+		return ret;
+
+	return xntimer_start(timer, timeout, XN_INFINITE, timeout_mode);
+}
+
+#ifdef CONFIG_XENO_OPT_TIMER_LAZY
+
+/*
+ * Disarm the resource timer of @a thread when its timed wait ends
+ * early. One-shot timers of aperiodic time bases based on the
+ * monotonic clock are left queued for xnthread_start_rtimer() to
+ * reuse; they are ignored should they elapse. Must be called with
+ * nklock held, IRQs off.
+ */
+void xnthread_stop_rtimer(struct xnthread *thread)
+{
+	xntimer_t *timer = &thread->rtimer;
+
+	if (!xntimer_running_p(timer))
+		return;
+
+	if (xntbase_periodic_p(xntimer_base(timer)) ||
+	    testbits(timer->status, XNTIMER_REALTIME)) {
+		xntimer_stop(timer);
+		return;
+	}
+
+	thread->rtstale = 1;
+}
+
+/* Time left until the deadline of the current or last timed wait. */
+xnticks_t xnthread_rtimeout(struct xnthread *thread)
+{
+	xnticks_t now;
+
+	if (thread->rtdate == XN_INFINITE)
+		return xntimer_get_timeout_stopped(&thread->rtimer);
+
+	now = xntbase_get_jiffies(xnthread_time_base(thread));
+	if ((xnsticks_t)(thread->rtdate - now) <= 0)
+		return 1;	/* Will elapse shortly. */
+
+	return thread->rtdate - now;
+}
+
+#endif /* CONFIG_XENO_OPT_TIMER_LAZY */
+
 xnticks_t xnthread_get_period(xnthread_t *thread)
 {
 	xnticks_t period = 0;
@@ -54,6 +54,7 @@
 #include <nucleus/pod.h>
 #include <nucleus/timer.h>
 #include <nucleus/module.h>
+#include <nucleus/vdso.h>
 
 DEFINE_XNQUEUE(nktimebaseq);
 
@@ -146,6 +147,7 @@ int xntbase_alloc(const char *name, u_long period, u_long flags,
 	base = &slave->base;
 	base->tickvalue = period;
 	base->ticks2sec = 1000000000UL / period;
+	xnarch_init_conv(&base->tickconv, 1, period);
 	base->wallclock_offset = 0;
 	base->jiffies = 0;
 	base->hook = NULL;
@@ -261,6 +263,7 @@ int xntbase_update(xntbase_t *base, u_long period)
 	xnlock_get_irqsave(&nklock, s);
 	base->tickvalue = period;
 	base->ticks2sec = 1000000000UL / period;
+	xnarch_init_conv(&base->tickconv, 1, period);
 	xntslave_update(base2slave(base), period);
 	xnlock_put_irqrestore(&nklock, s);
 
@@ -496,10 +499,97 @@ void xntbase_tick(xntbase_t *base)
 }
 EXPORT_SYMBOL_GPL(xntbase_tick);
 
+#ifdef CONFIG_XENO_OPT_TIMING_TICKLESS
+
+/*!
+ * @internal
+ * \fn xnticks_t xntbase_catch_up(xntbase_t *base)
+ * \brief Account for the ticks skipped by an idle time base.
+ *
+ * A periodic time base with no outstanding timer stops ticking. This
+ * routine adds the count of ticks elapsed since the last one to the
+ * jiffies, based on the master clock, so that the idle base still
+ * reads as if it had been ticking all along.
+ *
+ * @param base The address of an idle periodic time base.
+ *
+ * @return The updated count of jiffies.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+
+xnticks_t xntbase_catch_up(xntbase_t *base)
+{
+	xntslave_t *slave = base2slave(base);
+	xnticks_t now, jiffies, elapsed;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (testbits(base->status, XNTBIDLE)) {
+		now = xnarch_get_cpu_time();
+		if ((xnsticks_t)(now - slave->idle_date) > 0) {
+			elapsed = xntbase_ns2ticks(base, now - slave->idle_date);
+			base->jiffies += elapsed;
+			slave->idle_date += elapsed * base->tickvalue;
+		}
+	}
+
+	jiffies = base->jiffies;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return jiffies;
+}
+EXPORT_SYMBOL_GPL(xntbase_catch_up);
+
+/*!
+ * @internal
+ * \fn void xntbase_wakeup(xntbase_t *base)
+ * \brief Resume ticking an idle time base.
+ *
+ * @param base The address of a periodic time base.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+
+void xntbase_wakeup(xntbase_t *base)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	xntslave_resume(base2slave(base));
+	xnlock_put_irqrestore(&nklock, s);
+}
+EXPORT_SYMBOL_GPL(xntbase_wakeup);
+
+#endif /* CONFIG_XENO_OPT_TIMING_TICKLESS */
+
 xnticks_t xntbase_ns2ticks_ceil(xntbase_t *base, xntime_t t)
 {
-	return xnarch_ulldiv(t + xntbase_get_tickval(base) - 1,
-			     xntbase_get_tickval(base), NULL);
+	if (xntbase_master_p(base))
+		return t;
+
+	return xnarch_conv_divrem(&base->tickconv,
+				  t + xntbase_get_tickval(base) - 1, NULL);
 }
 EXPORT_SYMBOL_GPL(xntbase_ns2ticks_ceil);
 
@@ -599,6 +689,7 @@ void xntbase_adjust_time(xntbase_t *base, xnsticks_t delta)
 #endif /* CONFIG_XENO_OPT_TIMING_PERIODIC */
 		/* Update all non-isolated bases in the system. */
 		nktbase.wallclock_offset += xntbase_ticks2ns(base, delta);
+		xnvdso_set_wallclock_offset(nktbase.wallclock_offset);
 		xntimer_adjust_all_aperiodic(xntbase_ticks2ns(base, delta));
 
 #ifdef CONFIG_XENO_OPT_TIMING_PERIODIC
@@ -672,7 +763,7 @@ static int tbase_vfile_next(struct xnvfile_snapshot_iterator *it, void *data)
 
 	xnobject_copy_name(p->name, base->name);
 	p->tickvalue = base->tickvalue;
-	p->jiffies = base->jiffies;
+	p->jiffies = xntbase_periodic_p(base) ? xntbase_get_jiffies(base) : 0;
 	p->enabled = xntbase_enabled_p(base);
 	p->set = xntbase_timeset_p(base);
 	p->isolated = xntbase_isolated_p(base);
@@ -732,6 +823,10 @@ struct tmstat_vfile_data {
 	xnticks_t timeout;
 	xnticks_t interval;
 	xnflags_t status;
+#ifdef CONFIG_XENO_OPT_STATS_TIMERS
+	xnticks_t handler_time;
+	xnticks_t max_late;
+#endif /* CONFIG_XENO_OPT_STATS_TIMERS */
 	char handler[12];
 	char name[XNOBJECT_NAME_LEN];
 };
@@ -768,6 +863,10 @@ static int tmstat_vfile_next(struct xnvfile_snapshot_iterator *it, void *data)
 	p->timeout = xntimer_get_timeout(timer);
 	p->interval = xntimer_get_interval(timer);
 	p->status = timer->status;
+#ifdef CONFIG_XENO_OPT_STATS_TIMERS
+	p->handler_time = timer->handler_time;
+	p->max_late = timer->max_late;
+#endif /* CONFIG_XENO_OPT_STATS_TIMERS */
 	memcpy(p->handler, timer->handler_name,
 	       sizeof(p->handler)-1);
 	p->handler[sizeof(p->handler)-1] = 0;
@@ -782,22 +881,31 @@ static int tmstat_vfile_show(struct xnvfile_snapshot_iterator *it, void *data)
 	char timeout_buf[]  = "-         ";
 	char interval_buf[] = "-         ";
 
-	if (p == NULL)
+	if (p == NULL) {
 		xnvfile_printf(it,
-			       "%-3s  %-10s  %-10s  %-10s  %-10s  %-11s  %-15s\n",
+			       "%-3s  %-10s  %-10s  %-10s  %-10s  ",
 			       "CPU", "SCHEDULED", "FIRED", "TIMEOUT",
-			       "INTERVAL", "HANDLER", "NAME");
-	else {
+			       "INTERVAL");
+#ifdef CONFIG_XENO_OPT_STATS_TIMERS
+		xnvfile_printf(it, "%-12s  %-11s  ", "COST(ns)", "MAXLATE(ns)");
+#endif /* CONFIG_XENO_OPT_STATS_TIMERS */
+		xnvfile_printf(it, "%-11s  %-15s\n", "HANDLER", "NAME");
+	} else {
 		if (!testbits(p->status, XNTIMER_DEQUEUED))
 			snprintf(timeout_buf, sizeof(timeout_buf), "%-10llu",
 				 p->timeout);
 		if (testbits(p->status, XNTIMER_PERIODIC))
 			snprintf(interval_buf, sizeof(interval_buf), "%-10llu",
 				 p->interval);
-		xnvfile_printf(it,
-			       "%-3u  %-10u  %-10u  %s  %s  %-11s  %-15s\n",
+		xnvfile_printf(it, "%-3u  %-10u  %-10u  %s  %s  ",
 			       p->cpu, p->scheduled, p->fired, timeout_buf,
-			       interval_buf, p->handler, p->name);
+			       interval_buf);
+#ifdef CONFIG_XENO_OPT_STATS_TIMERS
+		xnvfile_printf(it, "%-12Lu  %-11Lu  ",
+			       xnarch_tsc_to_ns(p->handler_time),
+			       xnarch_tsc_to_ns(p->max_late));
+#endif /* CONFIG_XENO_OPT_STATS_TIMERS */
+		xnvfile_printf(it, "%-11s  %-15s\n", p->handler, p->name);
 	}
 
 	return 0;
@@ -39,20 +39,525 @@
 #include <nucleus/pod.h>
 #include <nucleus/thread.h>
 #include <nucleus/timer.h>
+#include <nucleus/evtrace.h>
 #include <asm/xenomai/bits/timer.h>
 
+/* Gravities of the IRQ and kernel wakeup classes (raw ticks). */
+u_long nkigravity;
+EXPORT_SYMBOL_GPL(nkigravity);
+
+u_long nkkgravity;
+EXPORT_SYMBOL_GPL(nkkgravity);
+
+static inline xnticks_t xntimer_class_gravity(xntimer_t *timer)
+{
+	if (testbits(timer->status, XNTIMER_UGRAVITY))
+		return nklatency;
+
+	if (testbits(timer->status, XNTIMER_KGRAVITY))
+		return nkkgravity;
+
+	return nkigravity;
+}
+
+#ifdef CONFIG_XENO_OPT_TIMER_HWHEEL
+
+void xntimerq_init(xntimerq_t *q)
+{
+	unsigned long long step_tsc;
+	int level, slot;
+
+	step_tsc = xnarch_ns_to_tsc(CONFIG_XENO_OPT_TIMER_HWHEEL_STEP);
+	for (q->date_shift = 0; (1ULL << q->date_shift) < step_tsc; q->date_shift++)
+		;
+	q->clock = xnarch_get_cpu_tsc() >> q->date_shift;
+	q->head = NULL;
+
+	for (level = 0; level < XNTIMER_HWHEEL_LEVELS; level++) {
+		q->map[level] = 0;
+		q->count[level] = 0;
+		for (slot = 0; slot < XNTIMER_HWHEEL_SLOTS; slot++)
+			initq(&q->slots[level][slot]);
+	}
+
+	q->count[XNTIMER_HWHEEL_LEVELS] = 0;
+	xntlist_init(&q->overflow);
+}
+
+/*
+ * Return the rank of the first busy slot in @a map, scanning
+ * circularly from slot @a pos, or -1 if all slots are idle.
+ */
+static inline int xntimerq_first_busy(unsigned long map, int pos)
+{
+	unsigned long r;
+
+	if (map == 0)
+		return -1;
+
+	r = map >> pos;
+	if (r)
+		return ffnz(r);
+
+	return ffnz(map) + XNTIMER_HWHEEL_SLOTS - pos;
+}
+
+static inline xntimerh_t *xntimerq_overflow_head(xntimerq_t *q)
+{
+	xntlholder_t *h = xntlist_head(&q->overflow);
+
+	return h ? container_of(h, xntimerh_t, tlink) : NULL;
+}
+
+/*
+ * Move the wheel position forward to @a target, which must not be
+ * later than the index of any queued timer. Upper level slots
+ * covering @a target are cascaded, and overflow timers are pulled
+ * into the wheel as they enter its range.
+ */
+static void xntimerq_advance(xntimerq_t *q, xnticks_t target)
+{
+	xnholder_t *ln;
+	xntimerh_t *h;
+	xnqueue_t *slot;
+	xnqueue_t cq;
+	int level, shift;
+
+	initq(&cq);
+
+	/*
+	 * Level 0 slots we skip over are idle by construction. At
+	 * upper levels, only the slot which holds @a target may be
+	 * busy among those we step over.
+	 */
+	for (level = 1; level < XNTIMER_HWHEEL_LEVELS; level++) {
+		shift = level * XNTIMER_HWHEEL_BITS;
+		if ((target >> shift) == (q->clock >> shift))
+			break;	/* Upper levels do not move either. */
+		slot = &q->slots[level][(target >> shift) & XNTIMER_HWHEEL_MASK];
+		while ((ln = getq(slot)) != NULL) {
+			appendq(&cq, ln);
+			q->count[level]--;
+		}
+		q->map[level] &= ~(1UL << ((target >> shift) & XNTIMER_HWHEEL_MASK));
+	}
+
+	q->clock = target;
+
+	while ((ln = getq(&cq)) != NULL)
+		__xntimerq_place(q, link2hwholder(ln));
+
+	while ((h = xntimerq_overflow_head(q)) != NULL &&
+	       (xntimerh_date(h) >> q->date_shift) - q->clock < XNTIMER_HWHEEL_RANGE) {
+		xntlist_remove(&q->overflow, &h->tlink);
+		q->count[XNTIMER_HWHEEL_LEVELS]--;
+		__xntimerq_place(q, h);
+	}
+}
+
+xntimerh_t *xntimerq_head(xntimerq_t *q)
+{
+	xnticks_t unit, next, start;
+	int level, shift, n, pos;
+	xntimerh_t *h;
+
+	if (q->head)
+		return q->head;
+
+	for (;;) {
+		/*
+		 * Level 0 slots are scanned in increasing date order
+		 * from the current position.
+		 */
+		n = xntimerq_first_busy(q->map[0], q->clock & XNTIMER_HWHEEL_MASK);
+		unit = n < 0 ? ~0ULL : q->clock + n;
+
+		/*
+		 * Find the earliest busy slot at each upper level,
+		 * and the overflow queue, which might hold timers
+		 * due before or along with the level 0 candidate.
+		 */
+		next = ~0ULL;
+		for (level = 1; level < XNTIMER_HWHEEL_LEVELS; level++) {
+			if (q->map[level] == 0)
+				continue;
+			shift = level * XNTIMER_HWHEEL_BITS;
+			pos = ((q->clock >> shift) + 1) & XNTIMER_HWHEEL_MASK;
+			n = xntimerq_first_busy(q->map[level], pos);
+			start = ((q->clock >> shift) + 1 + n) << shift;
+			if (start < next)
+				next = start;
+		}
+
+		h = xntimerq_overflow_head(q);
+		if (h) {
+			start = xntimerh_date(h) >> q->date_shift;
+			if (start < next)
+				next = start;
+		}
+
+		if (unit < next)
+			break;
+
+		if (next == ~0ULL)
+			return NULL;
+
+		/* Cascade the upper level timers which are due first. */
+		xntimerq_advance(q, next);
+	}
+
+	h = link2hwholder(getheadq(&q->slots[0][unit & XNTIMER_HWHEEL_MASK]));
+	q->head = h;
+
+	return h;
+}
+
+/*
+ * Iterating over the wheel returns the earliest timer first, then
+ * walks the levels in increasing date order of their slots, skipping
+ * the head timer.
+ */
+static xntimerh_t *xntimerq_it_scan(xntimerq_t *q, xntimerq_it_t *it,
+				    xnholder_t *ln)
+{
+	xnqueue_t *slot;
+	int pos;
+
+	for (;;) {
+		if (it->level == XNTIMER_HWHEEL_LEVELS)
+			slot = &q->overflow;
+		else {
+			if (it->level == 0)
+				pos = q->clock & XNTIMER_HWHEEL_MASK;
+			else
+				pos = (q->clock >> (it->level * XNTIMER_HWHEEL_BITS)) + 1;
+			slot = &q->slots[it->level][(pos + it->n) & XNTIMER_HWHEEL_MASK];
+		}
+
+		ln = ln ? nextq(slot, ln) : getheadq(slot);
+		while (ln && link2hwholder(ln) == it->head)
+			ln = nextq(slot, ln);
+		if (ln)
+			return link2hwholder(ln);
+
+		if (it->level == XNTIMER_HWHEEL_LEVELS)
+			return NULL;
+
+		if (++it->n == XNTIMER_HWHEEL_SLOTS) {
+			it->n = 0;
+			do
+				it->level++;
+			while (it->level < XNTIMER_HWHEEL_LEVELS &&
+			       q->count[it->level] == 0);
+		}
+	}
+}
+
+xntimerh_t *xntimerq_it_begin(xntimerq_t *q, xntimerq_it_t *it)
+{
+	it->head = xntimerq_head(q);
+	it->level = -1;
+	it->n = 0;
+
+	return it->head;
+}
+
+xntimerh_t *xntimerq_it_next(xntimerq_t *q, xntimerq_it_t *it,
+			     xntimerh_t *holder)
+{
+	if (it->level < 0) {
+		it->level = 0;
+		return xntimerq_it_scan(q, it, NULL);
+	}
+
+	return xntimerq_it_scan(q, it, &holder->tlink.link);
+}
+
+#endif /* CONFIG_XENO_OPT_TIMER_HWHEEL */
+
+#ifdef CONFIG_XENO_OPT_TIMER_DHEAP
+
+static DEFINE_XNQUEUE(growq);	/* Timer queues pending growth. */
+
+static int grow_apc = -1;
+
+void xntimerq_init(xntimerq_t *q)
+{
+	q->last = 0;
+	q->chunks[0] = q->first;
+	q->nchunks = 1;
+	q->capacity = XNTIMER_DHEAP_CHUNK - XNTIMER_DHEAP_BIAS;
+	q->gpending = 0;
+	inith(&q->glink);
+}
+
+/* Must be called with nklock locked, interrupts off. */
+void xntimerq_destroy(xntimerq_t *q)
+{
+	if (q->gpending) {
+		removeq(&growq, &q->glink);
+		q->gpending = 0;
+	}
+
+	while (q->nchunks > 1)
+		xnfree(q->chunks[--q->nchunks]);
+
+	q->last = 0;
+	q->capacity = 0;
+}
+
+static void xntimerq_down(xntimerq_t *q, unsigned i, struct xntimerslot s)
+{
+	struct xntimerslot *c, *min;
+	unsigned child, n, k;
+
+	for (;;) {
+		child = 4 * i + 1;
+		if (child >= q->last)
+			break;
+
+		/* Siblings are contiguous, see XNTIMER_DHEAP_BIAS. */
+		c = __xntimerq_slot(q, child);
+		n = q->last - child;
+		if (n > 4)
+			n = 4;
+		for (min = c, k = 1; k < n; k++)
+			if (__xntimerq_lt(c + k, min))
+				min = c + k;
+
+		if (!__xntimerq_lt(min, &s))
+			break;
+
+		__xntimerq_set(q, i, min);
+		i = child + (min - c);
+	}
+
+	__xntimerq_set(q, i, &s);
+}
+
+void xntimerq_remove(xntimerq_t *q, xntimerh_t *h)
+{
+	unsigned i = h->pos;
+	struct xntimerslot s;
+
+	if (unlikely(i >= q->last || __xntimerq_slot(q, i)->h != h))
+		return;
+
+	h->pos = ~0U;
+	if (--q->last == i)
+		return;
+
+	s = *__xntimerq_slot(q, q->last);
+	if (i > 0 && __xntimerq_lt(&s, __xntimerq_slot(q, (i - 1) >> 2)))
+		__xntimerq_up(q, i, s);
+	else
+		xntimerq_down(q, i, s);
+}
+
+/* Must be called with nklock locked, interrupts off. */
+void __xntimerq_grow(xntimerq_t *q)
+{
+	if (q->gpending || q->nchunks == XNTIMER_DHEAP_CHUNKS || grow_apc < 0)
+		return;
+
+	q->gpending = 1;
+	appendq(&growq, &q->glink);
+	__rthal_apc_schedule(grow_apc);
+}
+
+static void xntimerq_grow_proc(void *cookie)
+{
+	struct xntimerslot *chunk;
+	struct xnholder *h;
+	xntimerq_t *q;
+	spl_t s;
+
+	/*
+	 * Allocating from the system heap would be fine from the
+	 * real-time side too, but we want to keep this out of the
+	 * timer programming path.
+	 */
+	for (;;) {
+		xnlock_get_irqsave(&nklock, s);
+		h = getq(&growq);
+		if (h == NULL) {
+			xnlock_put_irqrestore(&nklock, s);
+			break;
+		}
+		q = container_of(h, xntimerq_t, glink);
+		q->gpending = 0;
+		xnlock_put_irqrestore(&nklock, s);
+
+		chunk = xnmalloc(XNTIMER_DHEAP_CHUNK * sizeof(*chunk));
+		if (chunk == NULL) {
+			xnlogwarn("cannot grow timer queue, %u timers max\n",
+				  q->capacity);
+			continue;
+		}
+
+		xnlock_get_irqsave(&nklock, s);
+		/* The queue may have been destroyed meanwhile. */
+		if (q->capacity && q->nchunks < XNTIMER_DHEAP_CHUNKS) {
+			q->chunks[q->nchunks++] = chunk;
+			q->capacity += XNTIMER_DHEAP_CHUNK;
+			chunk = NULL;
+		}
+		xnlock_put_irqrestore(&nklock, s);
+
+		if (chunk)
+			xnfree(chunk);
+	}
+}
+
+int xntimerq_grow_init(void)
+{
+	int apc;
+
+	apc = rthal_apc_alloc("timerq_grow", &xntimerq_grow_proc, NULL);
+	if (apc < 0)
+		return apc;
+
+	grow_apc = apc;
+
+	return 0;
+}
+
+void xntimerq_grow_cleanup(void)
+{
+	int apc;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	apc = grow_apc;
+	grow_apc = -1;
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (apc >= 0)
+		rthal_apc_free(apc);
+}
+
+#endif /* CONFIG_XENO_OPT_TIMER_DHEAP */
+
+#ifdef CONFIG_XENO_OPT_STATS_TIMERS
+
+#define xntimer_stat_depth(sched, n)	((sched)->tmstat.depth += (n))
+
+static inline void xntimer_stat_tick(xnsched_t *sched)
+{
+	struct xnsched_tmstat *st = &sched->tmstat;
+	int bucket;
+
+	/* Bucket #n counts depths in [2^(n-1), 2^n). */
+	bucket = fls(st->depth);
+	if (bucket >= XNSCHED_TMQ_BUCKETS)
+		bucket = XNSCHED_TMQ_BUCKETS - 1;
+
+	st->depth_hist[bucket]++;
+	st->ticks++;
+}
+
+static inline void xntimer_stat_fire(xnsched_t *sched, xntimer_t *timer,
+				     xnticks_t date, xnticks_t start,
+				     xnticks_t end)
+{
+	struct xnsched_tmstat *st = &sched->tmstat;
+	xnsticks_t late = (xnsticks_t)(start - date);
+
+	if (late > 0) {
+		if (late > timer->max_late)
+			timer->max_late = late;
+		if (late > st->max_late)
+			st->max_late = late;
+	}
+
+	timer->handler_time += end - start;
+	st->handler_time += end - start;
+	st->fired++;
+}
+
+#else /* !CONFIG_XENO_OPT_STATS_TIMERS */
+
+#define xntimer_stat_depth(sched, n)			do { } while (0)
+#define xntimer_stat_tick(sched)			do { } while (0)
+#define xntimer_stat_fire(sched, timer, date, start, end) do { } while (0)
+
+#endif /* !CONFIG_XENO_OPT_STATS_TIMERS */
+
+/*
+ * Realtime-absolute one-shot timers are queued apart, keyed on their
+ * date plus the sum of all wallclock adjustments applied so far, so
+ * that changing the wallclock never reorders them: only the shot
+ * needs to be reprogrammed. Periodic ones need their release point
+ * adjusted, so they stay in the core queue and are linked to a
+ * per-CPU list walked upon adjustment.
+ */
+static xnsticks_t xntimer_rtoffset;
+
+static inline int xntimer_rtq_p(xntimer_t *timer)
+{
+	return (timer->status & (XNTIMER_REALTIME|XNTIMER_PERIODIC)) ==
+		XNTIMER_REALTIME;
+}
+
+/* Date of a timer in raw CPU ticks, whether queued or not. */
+static inline xnticks_t xntimer_qdate(xntimer_t *timer)
+{
+	xnticks_t date = xntimerh_date(&timer->aplink);
+
+	if (xntimer_rtq_p(timer) && !testbits(timer->status, XNTIMER_DEQUEUED))
+		date -= xntimer_rtoffset;
+
+	return date;
+}
+
 static inline void xntimer_enqueue_aperiodic(xntimer_t *timer)
 {
-	xntimerq_t *q = &timer->sched->timerqueue;
-	xntimerq_insert(q, &timer->aplink);
+	xnsched_t *sched = timer->sched;
+
+	if (xntimer_rtq_p(timer)) {
+		xntimerh_date(&timer->aplink) += xntimer_rtoffset;
+		xntimerq_insert(&sched->rtimerqueue, &timer->aplink);
+	} else {
+		xntimerq_insert(&sched->timerqueue, &timer->aplink);
+		if (testbits(timer->status, XNTIMER_REALTIME))
+			appendq(&sched->rtpq, &timer->adjlink);
+	}
 	__clrbits(timer->status, XNTIMER_DEQUEUED);
 	xnstat_counter_inc(&timer->scheduled);
+	xntimer_stat_depth(sched, 1);
 }
 
 static inline void xntimer_dequeue_aperiodic(xntimer_t *timer)
 {
-	xntimerq_remove(&timer->sched->timerqueue, &timer->aplink);
+	xnsched_t *sched = timer->sched;
+
+	if (xntimer_rtq_p(timer)) {
+		xntimerq_remove(&sched->rtimerqueue, &timer->aplink);
+		xntimerh_date(&timer->aplink) -= xntimer_rtoffset;
+	} else {
+		xntimerq_remove(&sched->timerqueue, &timer->aplink);
+		if (testbits(timer->status, XNTIMER_REALTIME))
+			removeq(&sched->rtpq, &timer->adjlink);
+	}
 	__setbits(timer->status, XNTIMER_DEQUEUED);
+	xntimer_stat_depth(sched, -1);
+}
+
+/* Earliest timer queued on @a sched, or NULL. */
+static inline xntimer_t *xntimer_earliest(xnsched_t *sched)
+{
+	xntimerh_t *h = xntimerq_head(&sched->timerqueue);
+	xntimerh_t *rh = xntimerq_head(&sched->rtimerqueue);
+
+	if (rh == NULL)
+		return h ? aplink2timer(h) : NULL;
+
+	if (h == NULL ||
+	    (xnsticks_t)(xntimerh_date(rh) - xntimer_rtoffset -
+			 xntimerh_date(h)) < 0)
+		return aplink2timer(rh);
+
+	return aplink2timer(h);
 }
 
 void xntimer_next_local_shot(xnsched_t *sched)
@@ -71,8 +576,6 @@ void xntimer_next_local_shot(xnsched_t *sched)
 		return;
 
 	h = xntimerq_it_begin(&sched->timerqueue, &it);
-	if (h == NULL)
-		return;
 
 	/*
 	 * Here we try to defer the host tick heading the timer queue,
@@ -93,9 +596,14 @@ void xntimer_next_local_shot(xnsched_t *sched)
 	 * to yield control to the host kernel (see
 	 * __xnpod_schedule()), or a timer with an earlier timeout
 	 * date is scheduled, whichever comes first.
+	 *
+	 * On CPUs dedicated to real-time duties (XNHNOHZ), we defer
+	 * the host tick even if no other timer is outstanding, so
+	 * that no shot is programmed for it until the host kernel
+	 * resumes, which then receives a single catch-up tick.
 	 */
 	__clrbits(sched->lflags, XNHDEFER);
-	timer = aplink2timer(h);
+	timer = h ? aplink2timer(h) : NULL;
 	if (unlikely(timer == &sched->htimer)) {
 		if (xnsched_resched_p(sched) ||
 		    !xnthread_test_state(sched->curr, XNROOT)) {
@@ -103,12 +611,24 @@ void xntimer_next_local_shot(xnsched_t *sched)
 			if (h) {
 				__setbits(sched->lflags, XNHDEFER);
 				timer = aplink2timer(h);
+			} else if (testbits(sched->lflags, XNHNOHZ)) {
+				__setbits(sched->lflags, XNHDEFER);
+				timer = NULL;
 			}
 		}
 	}
 
-	delay = xntimerh_date(&timer->aplink) -
-		(xnarch_get_cpu_tsc() + nklatency);
+	h = xntimerq_head(&sched->rtimerqueue);
+	if (h && (timer == NULL ||
+		  (xnsticks_t)(xntimer_qdate(aplink2timer(h)) -
+			       xntimer_qdate(timer)) < 0))
+		timer = aplink2timer(h);
+
+	if (timer == NULL)
+		return;
+
+	/* The timer gravity is already accounted for in its date. */
+	delay = xntimer_qdate(timer) - xnarch_get_cpu_tsc();
 
 	if (delay < 0)
 		delay = 0;
@@ -126,6 +646,9 @@ static inline int xntimer_heading_p(struct xntimer *timer)
 	xntimerq_it_t it;
 	xntimerh_t *h;
 
+	if (xntimer_rtq_p(timer))
+		return xntimerq_head(&sched->rtimerqueue) == &timer->aplink;
+
 	h = xntimerq_it_begin(&sched->timerqueue, &it);
 	if (h == &timer->aplink)
 		return 1;
@@ -179,37 +702,26 @@ xntimer_adjust_aperiodic(xntimer_t *timer, xnsticks_t delta)
 			timer->pexpect += diff + mod;
 		}
 	}
-
-	xntimer_enqueue_aperiodic(timer);
 }
 
 void xntimer_adjust_all_aperiodic(xnsticks_t delta)
 {
 	unsigned cpu, nr_cpus;
-	xnqueue_t adjq;
 
-	initq(&adjq);
 	delta = xnarch_ns_to_tsc(delta);
+	/* Moves all realtime one-shot timers at once. */
+	xntimer_rtoffset += delta;
+
 	for (cpu = 0, nr_cpus = xnarch_num_online_cpus(); cpu < nr_cpus; cpu++) {
 		xnsched_t *sched = xnpod_sched_slot(cpu);
 		xntimerq_t *q = &sched->timerqueue;
-		xnholder_t *adjholder;
-		xntimerh_t *holder;
-		xntimerq_it_t it;
-
-		for (holder = xntimerq_it_begin(q, &it); holder;
-		     holder = xntimerq_it_next(q, &it, holder)) {
-			xntimer_t *timer = aplink2timer(holder);
-			if (testbits(timer->status, XNTIMER_REALTIME)) {
-				inith(&timer->adjlink);
-				appendq(&adjq, &timer->adjlink);
-			}
-		}
+		xnholder_t *h;
 
-		while ((adjholder = getq(&adjq))) {
-			xntimer_t *timer = adjlink2timer(adjholder);
-			xntimer_dequeue_aperiodic(timer);
+		for (h = getheadq(&sched->rtpq); h; h = nextq(&sched->rtpq, h)) {
+			xntimer_t *timer = adjlink2timer(h);
+			xntimerq_remove(q, &timer->aplink);
 			xntimer_adjust_aperiodic(timer, delta);
+			xntimerq_insert(q, &timer->aplink);
 		}
 
 		if (sched != xnpod_current_sched())
@@ -253,7 +765,17 @@ int xntimer_start_aperiodic(xntimer_t *timer,
 		break;
 	}
 
-	xntimerh_date(&timer->aplink) = date;
+	/*
+	 * Timers are queued by the latest date they may elapse at,
+	 * i.e. their slack added. The tick handler fires any timer
+	 * whose nominal date has passed, so that timers with
+	 * overlapping slack windows are processed by a single shot.
+	 * The gravity of the wakeup class is subtracted, so that the
+	 * queue is ordered by the dates the shots should be taken
+	 * at.
+	 */
+	timer->gravity = xntimer_class_gravity(timer);
+	xntimerh_date(&timer->aplink) = date + timer->slack - timer->gravity;
 
 	timer->interval = XN_INFINITE;
 	if (interval != XN_INFINITE) {
@@ -290,9 +812,14 @@ void xntimer_stop_aperiodic(xntimer_t *timer)
 }
 EXPORT_SYMBOL_GPL(xntimer_stop_aperiodic);
 
+static inline xnticks_t xntimer_nominal_date(xntimer_t *timer)
+{
+	return xntimer_qdate(timer) - timer->slack + timer->gravity;
+}
+
 xnticks_t xntimer_get_date_aperiodic(xntimer_t *timer)
 {
-	return xnarch_tsc_to_ns(xntimerh_date(&timer->aplink));
+	return xnarch_tsc_to_ns(xntimer_nominal_date(timer));
 }
 EXPORT_SYMBOL_GPL(xntimer_get_date_aperiodic);
 
@@ -300,10 +827,10 @@ xnticks_t xntimer_get_timeout_aperiodic(xntimer_t *timer)
 {
 	xnticks_t tsc = xnarch_get_cpu_tsc();
 
-	if (xntimerh_date(&timer->aplink) < tsc)
+	if (xntimer_nominal_date(timer) < tsc)
 		return 1;	/* Will elapse shortly. */
 
-	return xnarch_tsc_to_ns(xntimerh_date(&timer->aplink) - tsc);
+	return xnarch_tsc_to_ns(xntimer_nominal_date(timer) - tsc);
 }
 EXPORT_SYMBOL_GPL(xntimer_get_timeout_aperiodic);
 
@@ -315,7 +842,7 @@ EXPORT_SYMBOL_GPL(xntimer_get_interval_aperiodic);
 
 xnticks_t xntimer_get_raw_expiry_aperiodic(xntimer_t *timer)
 {
-	return xntimerh_date(&timer->aplink);
+	return xntimer_nominal_date(timer);
 }
 EXPORT_SYMBOL_GPL(xntimer_get_raw_expiry_aperiodic);
 
@@ -341,34 +868,50 @@ EXPORT_SYMBOL_GPL(xntimer_get_raw_expiry_aperiodic);
 void xntimer_tick_aperiodic(void)
 {
 	xnsched_t *sched = xnpod_current_sched();
-	xntimerq_t *timerq = &sched->timerqueue;
 	xnticks_t now, interval;
-	xntimerh_t *holder;
 	xntimer_t *timer;
 	xnsticks_t delta;
+	int stale = 0;
 
 	/*
 	 * Optimisation: any local timer reprogramming triggered by
 	 * invoked timer handlers can wait until we leave the tick
 	 * handler. Use this status flag as hint to
-	 * xntimer_start_aperiodic.
+	 * xntimer_start_aperiodic. Likewise, rescheduling requests
+	 * issued by the handlers (e.g. periodic thread releases) are
+	 * only acted upon once, when the interrupt handler exits, so
+	 * that a release burst costs a single pass through
+	 * __xnpod_schedule().
+	 *
+	 * Expired timers are processed in a batch against the same
+	 * clock sample; we only read the clock again once we reach a
+	 * timer which does not seem due, in case the handlers which
+	 * ran meanwhile took long enough for it to elapse.
 	 */
 	__setbits(sched->status, XNINTCK);
+	xntimer_stat_tick(sched);
 
 	now = xnarch_get_cpu_tsc();
-	while ((holder = xntimerq_head(timerq)) != NULL) {
-		timer = aplink2timer(holder);
+	while ((timer = xntimer_earliest(sched)) != NULL) {
 		/*
 		 * If the delay to the next shot is greater than the
 		 * intrinsic latency value, we may stop scanning the
 		 * timer queue there, since timeout dates are ordered
-		 * by increasing values.
+		 * by increasing values. Timers with some slack are
+		 * queued by their latest date, but may be fired as
+		 * soon as their nominal date is reached.
 		 */
-		delta = (xnsticks_t)(xntimerh_date(&timer->aplink) - now);
-		if (delta > (xnsticks_t)(nklatency + nktimerlat))
-			break;
+		delta = (xnsticks_t)(xntimer_qdate(timer) - timer->slack - now);
+		if (delta > (xnsticks_t)nktimerlat) {
+			if (!stale)
+				break;
+			now = xnarch_get_cpu_tsc();
+			stale = 0;
+			continue;
+		}
 
 		trace_mark(xn_nucleus, timer_expire, "timer %p", timer);
+		xnevtrace_log_obj(XNEVT_TIMER, NULL, timer);
 
 		xntimer_dequeue_aperiodic(timer);
 		xnstat_counter_inc(&timer->fired);
@@ -376,8 +919,16 @@ void xntimer_tick_aperiodic(void)
 		if (likely(timer != &sched->htimer)) {
 			if (likely(!testbits(nktbase.status, XNTBLCK)
 				   || testbits(timer->status, XNTIMER_NOBLCK))) {
+#ifdef CONFIG_XENO_OPT_STATS_TIMERS
+				/* The handler may restart the timer. */
+				xnticks_t start = xnarch_get_cpu_tsc(),
+					date = xntimer_nominal_date(timer);
+#endif /* CONFIG_XENO_OPT_STATS_TIMERS */
+				xnsched_stamp_phase(sched, XNSCHED_PHASE_TIMER);
 				timer->handler(timer);
-				now = xnarch_get_cpu_tsc();
+				stale = 1;
+				xntimer_stat_fire(sched, timer, date, start,
+						  xnarch_get_cpu_tsc());
 				/*
 				 * If the elapsed timer has no reload
 				 * value, or was re-enqueued or killed
@@ -420,7 +971,7 @@ void xntimer_tick_aperiodic(void)
 	requeue:
 		do {
 			xntimerh_date(&timer->aplink) += interval;
-		} while (xntimerh_date(&timer->aplink) < now + nklatency);
+		} while (xntimerh_date(&timer->aplink) < now);
 		xntimer_enqueue_aperiodic(timer);
 	}
 
@@ -448,6 +999,9 @@ static inline void xntimer_enqueue_periodic(xntimer_t *timer)
 	xntlist_insert(&pc->wheel[slot], &timer->plink);
 	__clrbits(timer->status, XNTIMER_DEQUEUED);
 	xnstat_counter_inc(&timer->scheduled);
+#ifdef CONFIG_XENO_OPT_TIMING_TICKLESS
+	base2slave(timer->base)->nr_timers++;
+#endif /* CONFIG_XENO_OPT_TIMING_TICKLESS */
 }
 
 static inline void xntimer_dequeue_periodic(xntimer_t *timer)
@@ -457,6 +1011,9 @@ static inline void xntimer_dequeue_periodic(xntimer_t *timer)
 	struct percpu_cascade *pc = &base2slave(timer->base)->cascade[cpu];
 	xntlist_remove(&pc->wheel[slot], &timer->plink);
 	__setbits(timer->status, XNTIMER_DEQUEUED);
+#ifdef CONFIG_XENO_OPT_TIMING_TICKLESS
+	base2slave(timer->base)->nr_timers--;
+#endif /* CONFIG_XENO_OPT_TIMING_TICKLESS */
 }
 
 static int xntimer_start_periodic(xntimer_t *timer,
@@ -467,6 +1024,11 @@ static int xntimer_start_periodic(xntimer_t *timer,
 		   "timer %p base %s value %Lu interval %Lu mode %u", timer,
 		   xntimer_base(timer)->name, value, interval, mode);
 
+#ifdef CONFIG_XENO_OPT_TIMING_TICKLESS
+	/* Resume ticking, bringing the jiffies up to date. */
+	xntslave_resume(base2slave(timer->base));
+#endif /* CONFIG_XENO_OPT_TIMING_TICKLESS */
+
 	if (!testbits(timer->status, XNTIMER_DEQUEUED))
 		xntimer_dequeue_periodic(timer);
 
@@ -514,7 +1076,7 @@ static xnticks_t xntimer_get_date_periodic(xntimer_t *timer)
 
 static xnticks_t xntimer_get_timeout_periodic(xntimer_t *timer)
 {
-	return xntlholder_date(&timer->plink) - timer->base->jiffies;
+	return xntlholder_date(&timer->plink) - xntbase_get_jiffies(timer->base);
 }
 
 static xnticks_t xntimer_get_interval_periodic(xntimer_t *timer)
@@ -605,15 +1167,104 @@ void xntimer_tick_periodic_inner(xntslave_t *slave)
 	xnsched_tick(sched->curr, base); /* Do time-slicing if required. */
 }
 
+#ifdef CONFIG_XENO_OPT_TIMING_TICKLESS
+
+/*
+ * Stop the cascading timers of an idle slave, i.e. with no timer
+ * queued and no thread undergoing round-robin. This is done by the
+ * time keeper, from the handler of its own cascading timer, which
+ * elapsed for tick #jiffies: the date of that tick is recorded, so
+ * that the jiffies skipped while idle can be recomputed from the
+ * master clock upon the next read (see xntbase_catch_up()).
+ */
+static void xntslave_suspend(xntslave_t *slave, xntimer_t *mtimer)
+{
+	int nr_cpus, cpu;
+
+	slave->idle_date = xnarch_tsc_to_ns(xntimer_get_raw_expiry(mtimer));
+	__setbits(slave->base.status, XNTBIDLE);
+
+	for (cpu = 0, nr_cpus = xnarch_num_online_cpus(); cpu < nr_cpus; cpu++) {
+
+		struct percpu_cascade *pc = &slave->cascade[cpu];
+
+		if (&pc->timer == mtimer)
+			/* Running its handler: just prevent the reload. */
+			__clrbits(mtimer->status, XNTIMER_PERIODIC);
+		else
+			xntimer_stop(&pc->timer);
+	}
+
+	trace_mark(xn_nucleus, tbase_idle, "base %s", slave->base.name);
+}
+
+/* Must be called with nklock locked, interrupts off. */
+void xntslave_resume(xntslave_t *slave)
+{
+	xntbase_t *base = &slave->base;
+	int nr_cpus, cpu;
+	xnticks_t date;
+
+	if (likely(!testbits(base->status, XNTBIDLE)))
+		return;
+
+	xntbase_catch_up(base);
+	__clrbits(base->status, XNTBIDLE);
+
+	/*
+	 * Restart ticking on the same grid, from the first tick
+	 * past the last one accounted for in the jiffies.
+	 */
+	date = slave->idle_date + base->tickvalue;
+
+	for (cpu = 0, nr_cpus = xnarch_num_online_cpus(); cpu < nr_cpus; cpu++) {
+
+		struct percpu_cascade *pc = &slave->cascade[cpu];
+
+		while (xntimer_start(&pc->timer, date + cpu * nklatency,
+				     base->tickvalue, XN_ABSOLUTE) == -ETIMEDOUT) {
+			/* We raced with the next tick; it has elapsed. */
+			if (cpu == XNTIMER_KEEPER_ID)
+				++base->jiffies;
+			date += base->tickvalue;
+		}
+	}
+
+	trace_mark(xn_nucleus, tbase_resume, "base %s", base->name);
+}
+EXPORT_SYMBOL_GPL(xntslave_resume);
+
+/* Must be called with nklock locked, interrupts off. */
+void xntslave_set_rr(xntslave_t *slave, int on)
+{
+	if (on) {
+		slave->nr_rrthreads++;
+		/* Time-slicing needs every tick. */
+		xntslave_resume(slave);
+	} else
+		slave->nr_rrthreads--;
+}
+EXPORT_SYMBOL_GPL(xntslave_set_rr);
+
+#endif /* CONFIG_XENO_OPT_TIMING_TICKLESS */
+
 void xntimer_tick_periodic(xntimer_t *mtimer)
 {
 	xntslave_t *slave = timer2slave(mtimer);
 	xntbase_t *base = &slave->base;
 
-	if (unlikely(base->hook != NULL))
+	if (unlikely(base->hook != NULL)) {
 		base->hook();
-	else
-		xntimer_tick_periodic_inner(slave);
+		return;
+	}
+
+	xntimer_tick_periodic_inner(slave);
+
+#ifdef CONFIG_XENO_OPT_TIMING_TICKLESS
+	if (slave->nr_timers == 0 && slave->nr_rrthreads == 0 &&
+	    xnpod_current_sched() == xnpod_sched_slot(XNTIMER_KEEPER_ID))
+		xntslave_suspend(slave, mtimer);
+#endif /* CONFIG_XENO_OPT_TIMING_TICKLESS */
 }
 
 static void
@@ -683,6 +1334,12 @@ void xntslave_init(xntslave_t *slave)
 		xntimer_set_priority(&pc->timer, XNTIMER_HIPRIO);
 		xntimer_set_sched(&pc->timer, xnpod_sched_slot(cpu));
 	}
+
+#ifdef CONFIG_XENO_OPT_TIMING_TICKLESS
+	slave->nr_timers = 0;
+	slave->nr_rrthreads = 0;
+	slave->idle_date = 0;
+#endif /* CONFIG_XENO_OPT_TIMING_TICKLESS */
 }
 
 void xntslave_destroy(xntslave_t *slave)
@@ -715,6 +1372,15 @@ void xntslave_update(xntslave_t *slave, xnticks_t interval)
 {
 	int nr_cpus, cpu;
 
+#ifdef CONFIG_XENO_OPT_TIMING_TICKLESS
+	/*
+	 * Account for the ticks elapsed at the former rate; the
+	 * date of the last one remains the origin of the new grid.
+	 */
+	if (testbits(slave->base.status, XNTBIDLE))
+		xntbase_catch_up(&slave->base);
+#endif /* CONFIG_XENO_OPT_TIMING_TICKLESS */
+
 	for (cpu = 0, nr_cpus = xnarch_num_online_cpus(); cpu < nr_cpus; cpu++) {
 
 		struct percpu_cascade *pc = &slave->cascade[cpu];
@@ -748,6 +1414,15 @@ void xntslave_stop(xntslave_t *slave)
 
 	trace_mark(xn_nucleus, tbase_stop, "base %s", slave->base.name);
 
+#ifdef CONFIG_XENO_OPT_TIMING_TICKLESS
+	xnlock_get_irqsave(&nklock, s);
+	if (testbits(slave->base.status, XNTBIDLE)) {
+		xntbase_catch_up(&slave->base);
+		__clrbits(slave->base.status, XNTBIDLE);
+	}
+	xnlock_put_irqrestore(&nklock, s);
+#endif /* CONFIG_XENO_OPT_TIMING_TICKLESS */
+
 	for (cpu = 0, nr_cpus = xnarch_num_online_cpus(); cpu < nr_cpus; cpu++) {
 
 		struct percpu_cascade *pc = &slave->cascade[cpu];
@@ -856,6 +1531,8 @@ void __xntimer_init(xntimer_t *timer, xntbase_t *base,
 	timer->status = XNTIMER_DEQUEUED;
 	timer->handler = handler;
 	timer->interval = 0;
+	timer->slack = 0;
+	timer->gravity = 0;
 	timer->sched = xnpod_current_sched();
 
 #ifdef CONFIG_XENO_OPT_STATS
@@ -872,6 +1549,10 @@ void __xntimer_init(xntimer_t *timer, xntbase_t *base,
 		inith(&timer->tblink);
 		xnstat_counter_set(&timer->scheduled, 0);
 		xnstat_counter_set(&timer->fired, 0);
+#ifdef CONFIG_XENO_OPT_STATS_TIMERS
+		timer->handler_time = 0;
+		timer->max_late = 0;
+#endif /* CONFIG_XENO_OPT_STATS_TIMERS */
 
 		xnlock_get_irqsave(&nklock, s);
 		appendq(&base->timerq, &timer->tblink);
@@ -1013,7 +1694,17 @@ unsigned long xntimer_get_overruns(xntimer_t *timer, xnticks_t now)
 	unsigned long overruns = 0;
 
 	if (unlikely(delta >= (xnsticks_t) period)) {
-		overruns = xnarch_div64(delta, period);
+		/*
+		 * Late by a few periods at most in the common case,
+		 * which is cheaper to count than to divide.
+		 */
+		if (likely(delta < (xnsticks_t) period * 4)) {
+			do {
+				delta -= period;
+				overruns++;
+			} while (delta >= (xnsticks_t) period);
+		} else
+			overruns = xnarch_div64(delta, period);
 		timer->pexpect += period * overruns;
 	}
 
@@ -1022,6 +1713,129 @@ unsigned long xntimer_get_overruns(xntimer_t *timer, xnticks_t now)
 }
 EXPORT_SYMBOL_GPL(xntimer_get_overruns);
 
+/*!
+ * \fn void xntimer_set_slack(xntimer_t *timer, xnticks_t slack)
+ *
+ * \brief Allow a timer to elapse late.
+ *
+ * Give a timer some slack, so that the nucleus may fire it together
+ * with other timers due shortly after, instead of programming a
+ * separate hardware shot for it. The timer never elapses before its
+ * nominal date, but possibly up to @a slack nanoseconds later. The
+ * slack is capped by the nucleus-wide coalescing window
+ * (CONFIG_XENO_OPT_TIMING_COALESCE), and a zero window disables
+ * coalescing altogether. This is meant for timers which are not
+ * latency-critical, such as watchdogs or coarse timeouts.
+ *
+ * The new slack applies from the next call to xntimer_start(). It
+ * only affects timers of the aperiodic master time base.
+ *
+ * @param timer The address of a valid timer descriptor.
+ *
+ * @param slack The tolerated delay, in nanoseconds. Zero restores
+ * the default behaviour.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+
+void xntimer_set_slack(xntimer_t *timer, xnticks_t slack)
+{
+	slack = xnarch_ns_to_tsc(slack);
+	timer->slack = slack < nkcoalesce ? slack : nkcoalesce;
+}
+EXPORT_SYMBOL_GPL(xntimer_set_slack);
+
+#define GRAVITY_CALIB_SHOTS	100
+#define GRAVITY_CALIB_DELAY	100000	/* ns */
+
+static struct {
+	xntimer_t timer;
+	xnsticks_t minlat;
+	volatile int shots;
+} gravity_calib;
+
+static void gravity_calib_handler(xntimer_t *timer)
+{
+	xnsticks_t lat = xnarch_get_cpu_tsc() - xntimer_nominal_date(timer);
+
+	if (lat < gravity_calib.minlat)
+		gravity_calib.minlat = lat;
+
+	if (++gravity_calib.shots < GRAVITY_CALIB_SHOTS)
+		xntimer_start(timer, GRAVITY_CALIB_DELAY, XN_INFINITE,
+			      XN_RELATIVE);
+}
+
+/*!
+ * \fn int xntimer_calibrate_gravity(void)
+ * \brief Calibrate the gravity of the IRQ wakeup class.
+ *
+ * Measures the latency of a series of timer shots taken without any
+ * anticipation, then sets the gravity of timers whose handler runs
+ * in IRQ context (nkigravity) to the smallest latency observed. The
+ * gravities of the thread wakeup classes cannot be measured from the
+ * nucleus; they are given by the scheduling latency, and may be
+ * tuned via /proc/xenomai/gravity, e.g. from the figures the latency
+ * tool reports in its kernel and user task modes.
+ *
+ * @return 0 is returned on success, or -ETIMEDOUT if the timer
+ * shots could not be observed, in which case nkigravity is left
+ * unchanged.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization code
+ * - Linux domain (the caller busy-waits for a few milliseconds)
+ *
+ * Rescheduling: never.
+ */
+
+int xntimer_calibrate_gravity(void)
+{
+	u_long saved = nkigravity;
+	xnticks_t timeout;
+	spl_t s;
+
+	xntimer_init(&gravity_calib.timer, &nktbase, gravity_calib_handler);
+	xntimer_set_name(&gravity_calib.timer, "[gravity]");
+	gravity_calib.minlat = (xnsticks_t)(~0ULL >> 1);
+	gravity_calib.shots = 0;
+
+	xnlock_get_irqsave(&nklock, s);
+	nkigravity = 0;
+	xntimer_start(&gravity_calib.timer, GRAVITY_CALIB_DELAY, XN_INFINITE,
+		      XN_RELATIVE);
+	xnlock_put_irqrestore(&nklock, s);
+
+	timeout = xnarch_get_cpu_tsc() + xnarch_ns_to_tsc(1000000000ULL);
+	while (gravity_calib.shots < GRAVITY_CALIB_SHOTS &&
+	       (xnsticks_t)(xnarch_get_cpu_tsc() - timeout) < 0)
+		cpu_relax();
+
+	xntimer_destroy(&gravity_calib.timer);
+
+	if (gravity_calib.shots < GRAVITY_CALIB_SHOTS) {
+		nkigravity = saved;
+		return -ETIMEDOUT;
+	}
+
+	nkigravity = gravity_calib.minlat > 0 ? gravity_calib.minlat : 0;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(xntimer_calibrate_gravity);
+
 /*!
  * @internal
  * \fn void xntimer_freeze(void)
@@ -1054,13 +1868,14 @@ void xntimer_freeze(void)
 
 	for (cpu = 0; cpu < nr_cpus; cpu++) {
 
-		xntimerq_t *timerq = &xnpod_sched_slot(cpu)->timerqueue;
-		xntimerh_t *holder;
+		xnsched_t *sched = xnpod_sched_slot(cpu);
+		xntimer_t *timer;
 
-		while ((holder = xntimerq_head(timerq)) != NULL) {
-			__setbits(aplink2timer(holder)->status, XNTIMER_DEQUEUED);
-			xntimerq_remove(timerq, holder);
-		}
+		while ((timer = xntimer_earliest(sched)) != NULL)
+			xntimer_dequeue_aperiodic(timer);
+#ifdef CONFIG_XENO_OPT_STATS_TIMERS
+		xnpod_sched_slot(cpu)->tmstat.depth = 0;
+#endif /* CONFIG_XENO_OPT_STATS_TIMERS */
 
 		/* Dequeuing all timers from the master time base
 		 * freezes all slave time bases the same way, so there
@@ -1142,11 +1957,108 @@ static int timer_vfile_show(struct xnvfile_regular_iterator *it, void *data)
 		       tm_status, wd_status, xnarch_tsc_to_ns(nktimerlat),
 		       xntbase_get_rawclock(&nktbase),
 		       XNARCH_TIMER_DEVICE, XNARCH_CLOCK_DEVICE);
+
+#ifdef CONFIG_XENO_OPT_TIMER_HWHEEL
+	{
+		int cpu, level;
+		xntimerq_t *q;
+
+		xnvfile_printf(it, "%3s", "CPU");
+		for (level = 0; level < XNTIMER_HWHEEL_LEVELS; level++)
+			xnvfile_printf(it, "  %6s%d", "LEVEL", level);
+		xnvfile_printf(it, "  %7s\n", "OVERFLW");
+
+		for (cpu = 0; cpu < xnarch_num_online_cpus(); cpu++) {
+			q = &xnpod_sched_slot(cpu)->timerqueue;
+			xnvfile_printf(it, "%3d", cpu);
+			for (level = 0; level <= XNTIMER_HWHEEL_LEVELS; level++)
+				xnvfile_printf(it, "  %7u", q->count[level]);
+			xnvfile_printf(it, "\n");
+		}
+	}
+#endif /* CONFIG_XENO_OPT_TIMER_HWHEEL */
+
+#ifdef CONFIG_XENO_OPT_STATS_TIMERS
+	{
+		struct xnsched_tmstat *st;
+		int cpu, bucket;
+
+		xnvfile_printf(it, "%3s  %10s  %10s  %6s  %12s  %12s\n",
+			       "CPU", "TICKS", "FIRED", "DEPTH",
+			       "HANDLER(ns)", "MAXLATE(ns)");
+
+		for_each_online_cpu(cpu) {
+			st = &xnpod_sched_slot(cpu)->tmstat;
+			xnvfile_printf(it, "%3d  %10lu  %10lu  %6lu  %12Lu  %12Lu\n",
+				       cpu, st->ticks, st->fired, st->depth,
+				       xnarch_tsc_to_ns(st->handler_time),
+				       xnarch_tsc_to_ns(st->max_late));
+		}
+
+		xnvfile_printf(it, "%-11s", "DEPTH");
+		for_each_online_cpu(cpu)
+			xnvfile_printf(it, "  %8s%d", "CPU", cpu);
+
+		for (bucket = 0; bucket < XNSCHED_TMQ_BUCKETS; bucket++) {
+			if (bucket == 0)
+				xnvfile_printf(it, "\n%-11s", "0");
+			else if (bucket < XNSCHED_TMQ_BUCKETS - 1)
+				xnvfile_printf(it, "\n< %-9lu", 1UL << bucket);
+			else
+				xnvfile_printf(it, "\n>= %-8lu", 1UL << (bucket - 1));
+
+			for_each_online_cpu(cpu)
+				xnvfile_printf(it, "  %9lu",
+					       xnpod_sched_slot(cpu)->tmstat.depth_hist[bucket]);
+		}
+
+		xnvfile_putc(it, '\n');
+	}
+#endif /* CONFIG_XENO_OPT_STATS_TIMERS */
+
 	return 0;
 }
 
+#ifdef CONFIG_XENO_OPT_STATS_TIMERS
+
+static ssize_t timer_vfile_store(struct xnvfile_input *input)
+{
+	struct xnsched_tmstat *st;
+	ssize_t ret;
+	long val;
+	int cpu;
+
+	ret = xnvfile_get_integer(input, &val);
+	if (ret < 0)
+		return ret;
+
+	if (val != 0)
+		return -EINVAL;
+
+	/*
+	 * The queue depth is live state, not a statistic: leave it
+	 * alone. Racing with the owner CPUs may lose a few updates,
+	 * which is harmless.
+	 */
+	for_each_online_cpu(cpu) {
+		st = &xnpod_sched_slot(cpu)->tmstat;
+		st->ticks = 0;
+		st->fired = 0;
+		st->handler_time = 0;
+		st->max_late = 0;
+		memset(st->depth_hist, 0, sizeof(st->depth_hist));
+	}
+
+	return ret;
+}
+
+#endif /* CONFIG_XENO_OPT_STATS_TIMERS */
+
 static struct xnvfile_regular_ops timer_vfile_ops = {
 	.show = timer_vfile_show,
+#ifdef CONFIG_XENO_OPT_STATS_TIMERS
+	.store = timer_vfile_store,
+#endif /* CONFIG_XENO_OPT_STATS_TIMERS */
 };
 
 static struct xnvfile_regular timer_vfile = {
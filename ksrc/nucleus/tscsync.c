@@ -0,0 +1,399 @@
+/*!\file nucleus/tscsync.c
+ * \brief TSC skew compensation.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * \ingroup nucleus
+ */
+
+/*
+ * When the TSCs of the CPUs are not perfectly synchronized, time
+ * stamps taken on different CPUs are inconsistent. Every
+ * CONFIG_XENO_OPT_TSC_SYNC_PERIOD milliseconds, a Linux work
+ * measures the offset of the TSC of each CPU from the TSC of the
+ * first online CPU, and xnarch_get_cpu_tsc() adds the corresponding
+ * correction to the raw TSC of the CPU it runs on.
+ *
+ * The CPU running the work pulls every other CPU in with an IPI,
+ * then both exchange a few time stamps: each round trip brackets the
+ * TSC value read by the remote CPU, the round trip of shortest
+ * duration giving the best estimate of the offset between both
+ * CPUs, within half that duration. Both sides only stall the root
+ * domain while doing so, real-time activities may preempt them, in
+ * which case the affected round trips get discarded as too long.
+ *
+ * Corrections are filtered, so that a single poor estimate cannot
+ * make the time of a CPU jump.
+ */
+
+#include <linux/timer.h>
+#include <linux/smp.h>
+#include <nucleus/pod.h>
+#include <nucleus/vfile.h>
+#include <nucleus/tscsync.h>
+
+#define TSCSYNC_PERIOD		msecs_to_jiffies(CONFIG_XENO_OPT_TSC_SYNC_PERIOD)
+#define TSCSYNC_ROUNDS		16
+#define TSCSYNC_TIMEOUT		100000	/* ns, per step of the exchange. */
+#define TSCSYNC_FILTER		3	/* Log2 of the filter weight. */
+
+long xnarch_tsc_offset[XNARCH_NR_CPUS];
+EXPORT_SYMBOL_GPL(xnarch_tsc_offset);
+
+#define TSCSYNC_IDLE		0
+#define TSCSYNC_POSTED		1
+#define TSCSYNC_READY		2
+#define TSCSYNC_ABORTED		3
+
+struct tscsync_slot {
+	atomic_t state;
+	volatile int round;	/* Written by the measuring CPU. */
+	volatile int ack;	/* Written by the remote CPU. */
+	volatile unsigned long long stamp;
+} ____cacheline_aligned_in_smp;
+
+struct tscsync_stat {
+	long long skew;		/* Last estimate, TSC ticks. */
+	unsigned long long error; /* Uncertainty of the estimate. */
+	unsigned long samples;	/* Successful measurements. */
+	unsigned long misses;	/* Failed measurements. */
+};
+
+static struct tscsync_slot tscsync_slots[XNARCH_NR_CPUS];
+
+static struct tscsync_stat tscsync_stats[XNARCH_NR_CPUS];
+
+static int tscsync_enabled = 1;
+
+static int tscsync_stopping;
+
+static DEFINE_BINARY_SEMAPHORE(tscsync_sem);
+
+static DECLARE_WORK_FUNC(tscsync_callback);
+
+static DECLARE_WORK_NODATA(tscsync_work, &tscsync_callback);
+
+static struct timer_list tscsync_poll;
+
+static unsigned long long tscsync_timeout;
+
+/* Runs on the remote CPU, over the IPI sent by tscsync_measure(). */
+static void tscsync_remote(void *arg)
+{
+	struct tscsync_slot *slot = arg;
+	unsigned long long deadline;
+	unsigned long flags;
+	int round = 0;
+
+	if (atomic_cmpxchg(&slot->state, TSCSYNC_POSTED,
+			   TSCSYNC_READY) != TSCSYNC_POSTED) {
+		/* The measuring CPU gave up waiting for us. */
+		atomic_set(&slot->state, TSCSYNC_IDLE);
+		return;
+	}
+
+	local_irq_save(flags);
+
+	deadline = rthal_rdtsc() + tscsync_timeout;
+	while (round <= TSCSYNC_ROUNDS) {
+		if (slot->round == round) {
+			cpu_relax();
+			if ((long long)(rthal_rdtsc() - deadline) > 0)
+				break;
+			continue;
+		}
+		round = slot->round;
+		slot->stamp = rthal_rdtsc();
+		xnarch_memory_barrier();
+		slot->ack = round;
+		deadline = rthal_rdtsc() + tscsync_timeout;
+	}
+
+	local_irq_restore(flags);
+
+	xnarch_memory_barrier();
+	atomic_set(&slot->state, TSCSYNC_IDLE);
+}
+
+/*
+ * Measure the offset between the TSC of the current CPU and the one
+ * of "cpu", i.e. local TSC minus remote TSC. Returns 0 upon success,
+ * or -EAGAIN if the remote CPU could not be reached in time.
+ */
+static int tscsync_measure(int cpu, long long *offset,
+			   unsigned long long *error)
+{
+	struct tscsync_slot *slot = &tscsync_slots[cpu];
+	unsigned long long t0, t2, rtt, best = ~0ULL, deadline;
+	unsigned long flags;
+	int round;
+
+	/* Still busy with a previous, aborted measurement? */
+	if (atomic_read(&slot->state) != TSCSYNC_IDLE)
+		return -EAGAIN;
+
+	slot->round = 0;
+	slot->ack = 0;
+	atomic_set(&slot->state, TSCSYNC_POSTED);
+	xnarch_memory_barrier();
+
+	if (smp_call_function_single(cpu, tscsync_remote, slot, 0)) {
+		atomic_set(&slot->state, TSCSYNC_IDLE);
+		return -EAGAIN;
+	}
+
+	/*
+	 * Wait for the remote CPU to pick the request, interrupts
+	 * enabled, since this may take a while if real-time
+	 * activities keep it busy.
+	 */
+	deadline = rthal_rdtsc() + xnarch_ns_to_tsc(10 * TSCSYNC_TIMEOUT);
+	while (atomic_read(&slot->state) == TSCSYNC_POSTED) {
+		if ((long long)(rthal_rdtsc() - deadline) > 0 &&
+		    atomic_cmpxchg(&slot->state, TSCSYNC_POSTED,
+				   TSCSYNC_ABORTED) == TSCSYNC_POSTED)
+			return -EAGAIN;
+		cpu_relax();
+	}
+
+	local_irq_save(flags);
+
+	for (round = 1; round <= TSCSYNC_ROUNDS; round++) {
+		t0 = rthal_rdtsc();
+		slot->round = round;
+		deadline = t0 + tscsync_timeout;
+		while (slot->ack != round) {
+			cpu_relax();
+			if ((long long)(rthal_rdtsc() - deadline) > 0)
+				goto out;
+		}
+		xnarch_read_memory_barrier();
+		t2 = rthal_rdtsc();
+		rtt = t2 - t0;
+		if (rtt < best) {
+			best = rtt;
+			*offset = (long long)(t0 + rtt / 2 - slot->stamp);
+		}
+	}
+out:
+	/* Release the remote CPU. */
+	slot->round = TSCSYNC_ROUNDS + 1;
+
+	local_irq_restore(flags);
+
+	if (best == ~0ULL)
+		return -EAGAIN;
+
+	*error = best / 2;
+
+	return 0;
+}
+
+/* Scratch areas of tscsync_update(), tscsync_sem held. */
+static long long tscsync_offset[XNARCH_NR_CPUS];
+static unsigned long long tscsync_error[XNARCH_NR_CPUS];
+static int tscsync_valid[XNARCH_NR_CPUS];
+
+static void tscsync_update(void)
+{
+	long long *offset = tscsync_offset, skew, delta;
+	unsigned long long *error = tscsync_error;
+	int *valid = tscsync_valid, ref, cpu, self;
+
+	ref = cpumask_first(cpu_online_mask);
+
+	/*
+	 * We may run on any CPU, so measure all offsets from the
+	 * current one, then rebase them on the reference CPU.
+	 */
+	self = get_cpu();
+
+	for_each_online_cpu(cpu) {
+		valid[cpu] = 0;
+		if (!xnarch_cpu_supported(cpu) && cpu != ref)
+			continue;
+		if (cpu == self) {
+			offset[cpu] = 0;
+			error[cpu] = 0;
+			valid[cpu] = 1;
+			continue;
+		}
+		valid[cpu] = tscsync_measure(cpu, &offset[cpu],
+					     &error[cpu]) == 0;
+	}
+
+	put_cpu();
+
+	if (!valid[ref]) {
+		for_each_online_cpu(cpu)
+			if (xnarch_cpu_supported(cpu))
+				tscsync_stats[cpu].misses++;
+		return;
+	}
+
+	for_each_online_cpu(cpu) {
+		if (!xnarch_cpu_supported(cpu) || cpu == ref)
+			continue;
+
+		if (!valid[cpu]) {
+			tscsync_stats[cpu].misses++;
+			continue;
+		}
+
+		/* Reference TSC minus the TSC of "cpu". */
+		skew = offset[cpu] - offset[ref];
+		tscsync_stats[cpu].skew = skew;
+		tscsync_stats[cpu].error = error[cpu] + error[ref];
+
+		if (!tscsync_enabled)
+			continue;
+
+		if (tscsync_stats[cpu].samples++ == 0)
+			delta = skew - xnarch_tsc_offset[cpu];
+		else
+			delta = (skew - xnarch_tsc_offset[cpu]) >> TSCSYNC_FILTER;
+
+		xnarch_tsc_offset[cpu] += (long)delta;
+	}
+}
+
+static DECLARE_WORK_FUNC(tscsync_callback)
+{
+	down(&tscsync_sem);
+
+	if (!tscsync_stopping) {
+		tscsync_update();
+		mod_timer(&tscsync_poll, jiffies + TSCSYNC_PERIOD);
+	}
+
+	up(&tscsync_sem);
+}
+
+static void tscsync_poll_handler(unsigned long data)
+{
+	schedule_work(&tscsync_work);
+}
+
+#ifdef CONFIG_XENO_OPT_VFILE
+
+static int tscsync_vfile_show(struct xnvfile_regular_iterator *it, void *data)
+{
+	struct tscsync_stat *stat;
+	int cpu;
+
+	xnvfile_printf(it, "correction: %s, period: %d ms\n",
+		       tscsync_enabled ? "on" : "off",
+		       CONFIG_XENO_OPT_TSC_SYNC_PERIOD);
+	xnvfile_printf(it, "%-4s %12s %12s %10s %10s %8s\n",
+		       "CPU", "SKEW(ns)", "OFFSET(ns)", "ERROR(ns)",
+		       "SAMPLES", "MISSES");
+
+	for_each_online_cpu(cpu) {
+		if (!xnarch_cpu_supported(cpu))
+			continue;
+
+		stat = &tscsync_stats[cpu];
+		xnvfile_printf(it, "%-4d %12lld %12lld %10llu %10lu %8lu\n",
+			       cpu,
+			       xnarch_tsc_to_ns(stat->skew),
+			       xnarch_tsc_to_ns(xnarch_tsc_offset[cpu]),
+			       (unsigned long long)xnarch_tsc_to_ns(stat->error),
+			       stat->samples, stat->misses);
+	}
+
+	return 0;
+}
+
+/*
+ * Writing zero drops the corrections, measurements going on;
+ * writing a non-zero value applies them again.
+ */
+static ssize_t tscsync_vfile_store(struct xnvfile_input *input)
+{
+	ssize_t ret;
+	long val;
+	int cpu;
+
+	ret = xnvfile_get_integer(input, &val);
+	if (ret < 0)
+		return ret;
+
+	down(&tscsync_sem);
+
+	tscsync_enabled = val != 0;
+	for (cpu = 0; cpu < XNARCH_NR_CPUS; cpu++) {
+		xnarch_tsc_offset[cpu] = 0;
+		tscsync_stats[cpu].samples = 0;
+	}
+
+	up(&tscsync_sem);
+
+	return ret;
+}
+
+static struct xnvfile_regular_ops tscsync_vfile_ops = {
+	.show = tscsync_vfile_show,
+	.store = tscsync_vfile_store,
+};
+
+static struct xnvfile_regular tscsync_vfile = {
+	.ops = &tscsync_vfile_ops,
+};
+
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+void xntscsync_mount(void)
+{
+	int cpu;
+
+	for (cpu = 0; cpu < XNARCH_NR_CPUS; cpu++)
+		atomic_set(&tscsync_slots[cpu].state, TSCSYNC_IDLE);
+
+	tscsync_timeout = xnarch_ns_to_tsc(TSCSYNC_TIMEOUT);
+	setup_timer(&tscsync_poll, tscsync_poll_handler, 0);
+
+	/* Get the corrections right before the first time stamp. */
+	down(&tscsync_sem);
+	tscsync_update();
+	up(&tscsync_sem);
+
+	mod_timer(&tscsync_poll, jiffies + TSCSYNC_PERIOD);
+
+#ifdef CONFIG_XENO_OPT_VFILE
+	xnvfile_init_regular("clock", &tscsync_vfile, &nkvfroot);
+#endif /* CONFIG_XENO_OPT_VFILE */
+}
+
+void xntscsync_umount(void)
+{
+	int cpu;
+
+#ifdef CONFIG_XENO_OPT_VFILE
+	xnvfile_destroy_regular(&tscsync_vfile);
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+	down(&tscsync_sem);
+	tscsync_stopping = 1;
+	up(&tscsync_sem);
+
+	del_timer_sync(&tscsync_poll);
+	flush_scheduled_work();
+
+	/* Let aborted measurements drain before the slots vanish. */
+	for_each_online_cpu(cpu)
+		while (atomic_read(&tscsync_slots[cpu].state) != TSCSYNC_IDLE)
+			cpu_relax();
+}
@@ -90,10 +90,24 @@ EXPORT_SYMBOL_GPL(nkvfroot);
 
 static struct xnvfile_directory sysroot;
 
+static int vfile_snapshot_collect(struct xnvfile_snapshot_iterator *it);
+
 static void *vfile_snapshot_start(struct seq_file *seq, loff_t *offp)
 {
 	struct xnvfile_snapshot_iterator *it = seq->private;
 	loff_t pos = *offp;
+	int ret;
+
+	/*
+	 * Readers which may send us a "since" query collect the
+	 * snapshot upon the first read, instead of at open time.
+	 */
+	if (it->pending) {
+		ret = vfile_snapshot_collect(it);
+		if (ret)
+			return ERR_PTR(ret);
+		it->pending = 0;
+	}
 
 	if (pos > it->nrdata)
 		return NULL;
@@ -144,48 +158,16 @@ static void vfile_snapshot_free(struct xnvfile_snapshot_iterator *it, void *buf)
 	kfree(buf);
 }
 
-static int vfile_snapshot_open(struct inode *inode, struct file *file)
+static int vfile_snapshot_collect(struct xnvfile_snapshot_iterator *it)
 {
-	struct xnvfile_snapshot *vfile = PDE_DATA(inode);
+	struct xnvfile_snapshot *vfile = it->vfile;
 	struct xnvfile_snapshot_ops *ops = vfile->ops;
-	struct xnvfile_snapshot_iterator *it;
-	int revtag, ret, nrdata;
-	struct seq_file *seq;
+	int revtag, ret, nrdata, retries = 0, resumed = 0;
 	caddr_t data;
 
-	/*
-	 * There is no point in reading/writing to v-files that must
-	 * be connected to Xenomai resources if the system has not
-	 * been initialized yet (i.e. xnpod_init() called).
-	 */
-	if (!xnpod_active_p())
-		return -ESRCH;
-
-	if ((file->f_mode & FMODE_WRITE) != 0 && ops->store == NULL)
-		return -EACCES;
-
-	/*
-	 * Make sure to create the seq_file backend only when reading
-	 * from the v-file is possible.
-	 */
-	if ((file->f_mode & FMODE_READ) == 0) {
-		file->private_data = NULL;
-		return 0;
-	}
-
-	if ((file->f_flags & O_EXCL) != 0 && xnvfile_nref(vfile) > 0)
-		return -EBUSY;
-
-	it = kzalloc(sizeof(*it) + vfile->privsz, GFP_KERNEL);
-	if (it == NULL)
-		return -ENOMEM;
-
-	it->vfile = vfile;
-	xnvfile_file(vfile) = file;
-
 	ret = vfile->entry.lockops->get(&vfile->entry);
 	if (ret)
-		goto fail;
+		return ret;
 redo:
 	/*
 	 * The ->rewind() method is optional; there may be cases where
@@ -208,9 +190,8 @@ redo:
 	if (ops->rewind) {
 		nrdata = ops->rewind(it);
 		if (nrdata < 0) {
-			ret = nrdata;
 			vfile->entry.lockops->put(&vfile->entry);
-			goto fail;
+			return nrdata;
 		}
 	}
 	revtag = vfile->tag->rev;
@@ -233,10 +214,8 @@ redo:
 	if (ops->begin) {
 		XENO_BUGON(NUCLEUS, ops->end == NULL);
 		data = ops->begin(it);
-		if (data == NULL) {
-			kfree(it);
+		if (data == NULL)
 			return -ENOMEM;
-		}
 		if (data != VFILE_SEQ_EMPTY) {
 			it->databuf = data;
 			it->endfn = ops->end;
@@ -244,33 +223,47 @@ redo:
 	} else if (nrdata > 0 && vfile->datasz > 0) {
 		/* We have a hint for auto-allocation. */
 		data = kmalloc(vfile->datasz * nrdata, GFP_KERNEL);
-		if (data == NULL) {
-			kfree(it);
+		if (data == NULL)
 			return -ENOMEM;
-		}
 		it->databuf = data;
 		it->endfn = vfile_snapshot_free;
 	}
 
-	ret = seq_open(file, &vfile_snapshot_ops);
-	if (ret)
-		goto fail;
-
 	it->nrdata = 0;
 	data = it->databuf;
 	if (data == NULL)
-		goto finish;
+		return 0;
 
 	/*
 	 * Take a snapshot of the vfile contents, redo if the revision
-	 * tag of the scanned data set changed concurrently.
+	 * tag of the scanned data set changed concurrently. Under
+	 * constant churn, this could go on for a long time, so past
+	 * a few attempts, we keep the records collected so far and
+	 * let ->resume() find its way back into the updated set
+	 * instead, if the vfile allows it. Since the buffer was sized
+	 * after the rewind hint, we may have to stop short of the
+	 * records added in the meantime.
 	 */
 	for (;;) {
 		ret = vfile->entry.lockops->get(&vfile->entry);
 		if (ret)
 			break;
-		if (vfile->tag->rev != revtag)
-			goto redo;
+		if (vfile->tag->rev != revtag) {
+			if (ops->resume == NULL || ops->begin ||
+			    retries++ < XNVFILE_SNAPSHOT_RETRIES)
+				goto redo;
+			ret = ops->resume(it);
+			if (ret) {
+				vfile->entry.lockops->put(&vfile->entry);
+				break;
+			}
+			revtag = vfile->tag->rev;
+			resumed = 1;
+		}
+		if (resumed && it->nrdata >= nrdata) {
+			vfile->entry.lockops->put(&vfile->entry);
+			break;
+		}
 		ret = ops->next(it, data);
 		vfile->entry.lockops->put(&vfile->entry);
 		if (ret <= 0)
@@ -281,19 +274,78 @@ redo:
 		}
 	}
 
-	if (ret < 0) {
-		seq_release(inode, file);
-	fail:
-		if (it->databuf)
-			it->endfn(it, it->databuf);
+	return ret < 0 ? ret : 0;
+}
+
+static int vfile_snapshot_open(struct inode *inode, struct file *file)
+{
+	struct xnvfile_snapshot *vfile = PDE_DATA(inode);
+	struct xnvfile_snapshot_ops *ops = vfile->ops;
+	struct xnvfile_snapshot_iterator *it;
+	struct seq_file *seq;
+	int ret;
+
+	/*
+	 * There is no point in reading/writing to v-files that must
+	 * be connected to Xenomai resources if the system has not
+	 * been initialized yet (i.e. xnpod_init() called).
+	 */
+	if (!xnpod_active_p())
+		return -ESRCH;
+
+	if ((file->f_mode & FMODE_WRITE) != 0 && ops->store == NULL &&
+	    (vfile->flags & XNVFILE_SNAPSHOT_DELTA) == 0)
+		return -EACCES;
+
+	/*
+	 * Make sure to create the seq_file backend only when reading
+	 * from the v-file is possible.
+	 */
+	if ((file->f_mode & FMODE_READ) == 0) {
+		file->private_data = NULL;
+		return 0;
+	}
+
+	if ((file->f_flags & O_EXCL) != 0 && xnvfile_nref(vfile) > 0)
+		return -EBUSY;
+
+	it = kzalloc(sizeof(*it) + vfile->privsz, GFP_KERNEL);
+	if (it == NULL)
+		return -ENOMEM;
+
+	it->vfile = vfile;
+	xnvfile_file(vfile) = file;
+
+	ret = seq_open(file, &vfile_snapshot_ops);
+	if (ret) {
 		kfree(it);
 		return ret;
 	}
 
-finish:
 	seq = file->private_data;
 	it->seq = seq;
 	seq->private = it;
+
+	/*
+	 * A reader which may also write to a delta-capable vfile
+	 * gets a chance to send a "since" query before the data is
+	 * collected.
+	 */
+	if ((vfile->flags & XNVFILE_SNAPSHOT_DELTA) != 0 &&
+	    (file->f_mode & FMODE_WRITE) != 0)
+		it->pending = 1;
+	else {
+		ret = vfile_snapshot_collect(it);
+		if (ret) {
+			seq->private = NULL;
+			seq_release(inode, file);
+			if (it->databuf)
+				it->endfn(it, it->databuf);
+			kfree(it);
+			return ret;
+		}
+	}
+
 	xnvfile_nref(vfile)++;
 
 	return 0;
@@ -324,9 +376,36 @@ ssize_t vfile_snapshot_write(struct file *file, const char __user *buf,
 			     size_t size, loff_t *ppos)
 {
 	struct xnvfile_snapshot *vfile = PDE_DATA(wrap_f_inode(file));
+	struct xnvfile_snapshot_iterator *it;
 	struct xnvfile_input input;
+	struct seq_file *seq;
+	char query[32], *end;
 	ssize_t ret;
 
+	/*
+	 * A reader which has not collected the snapshot yet may ask
+	 * for the records changed since a given revision, by writing
+	 * "since <revision>" to the vfile. Anything else goes to the
+	 * ->store() handler.
+	 */
+	seq = file->private_data;
+	it = seq ? seq->private : NULL;
+	if (it && it->pending && size > 6 && size < sizeof(query)) {
+		if (copy_from_user(query, buf, size))
+			return -EFAULT;
+		query[size] = '\0';
+		if (strncmp(query, "since ", 6) == 0) {
+			it->since = simple_strtoull(query + 6, &end, 0);
+			if (end == query + 6 || (*end && !isspace(*end)))
+				return -EINVAL;
+			it->delta = 1;
+			return size;
+		}
+	}
+
+	if (vfile->ops->store == NULL)
+		return -EINVAL;
+
 	if (vfile->entry.lockops) {
 		ret = vfile->entry.lockops->get(&vfile->entry);
 		if (ret)
@@ -390,6 +469,15 @@ static struct file_operations vfile_snapshot_fops = {
  *
  * - .ops is a pointer to an @ref snapshot_ops "operation descriptor".
  *
+ * - .flags may contain XNVFILE_SNAPSHOT_DELTA, in which case a
+ * process opening the vfile for both reading and writing may write
+ * "since <revision>" to it before reading, and the data collection
+ * is deferred until then. The @ref snapshot_next "next() handler"
+ * finds the revision in it->since when it->delta is set, and should
+ * skip the records which did not change since then. What a revision
+ * stands for is up to the vfile, which should output the current
+ * one in its header so that the reader may pass it back next time.
+ *
  * @param parent A pointer to a virtual directory descriptor; the
  * vfile entry will be created into this directory. If NULL, the /proc
  * root directory will be used. /proc/xenomai is mapped on the
@@ -416,7 +504,8 @@ int xnvfile_init_snapshot(const char *name,
 	if (parent == NULL)
 		parent = &sysroot;
 
-	mode = vfile->ops->store ? 0644 : 0444;
+	mode = vfile->ops->store ||
+		(vfile->flags & XNVFILE_SNAPSHOT_DELTA) ? 0644 : 0444;
 	ppde = parent->entry.pde;
 	pde = proc_create_data(name, mode, ppde, &vfile_snapshot_fops, vfile);
 	if (pde == NULL)
@@ -32,6 +32,14 @@
  * automatically reprograms the alarm for the next shot according to a
  * user-defined interval value.
  *
+ * Alarms may also be attached to an alarm group, so that a single
+ * task collects the expiries of many alarms with rt_alarm_group_wait(),
+ * instead of dedicating one waiter to each alarm. Every expiry of an
+ * attached alarm is posted to its group; expiries of the same alarm
+ * which have not been collected yet are coalesced into a single
+ * record carrying an overrun count, so that no expiry is ever lost,
+ * and alarms firing at the same tick only cause one wakeup.
+ *
  *@{*/
 
 /** @example user_alarm.c */
@@ -142,6 +150,85 @@ static struct xnpnode_snapshot __alarm_pnode = {
 	},
 };
 
+struct vfile_group_priv {
+	struct xnholder *curr;
+	int npending;
+};
+
+struct vfile_group_data {
+	unsigned long pending;
+	char name[XNOBJECT_NAME_LEN];
+};
+
+static int vfile_group_rewind(struct xnvfile_snapshot_iterator *it)
+{
+	struct vfile_group_priv *priv = xnvfile_iterator_priv(it);
+	RT_ALARM_GROUP *group = xnvfile_priv(it->vfile);
+
+	group = xeno_h2obj_validate(group, XENO_ALARM_GROUP_MAGIC,
+				    RT_ALARM_GROUP);
+	if (group == NULL)
+		return -EIDRM;
+
+	priv->curr = getheadq(&group->alarmq);
+	priv->npending = countq(&group->pendq);
+
+	return countq(&group->alarmq);
+}
+
+static int vfile_group_next(struct xnvfile_snapshot_iterator *it, void *data)
+{
+	struct vfile_group_priv *priv = xnvfile_iterator_priv(it);
+	RT_ALARM_GROUP *group = xnvfile_priv(it->vfile);
+	struct vfile_group_data *p = data;
+	RT_ALARM *alarm;
+
+	if (priv->curr == NULL)
+		return 0;	/* We are done. */
+
+	alarm = glink2alarm(priv->curr);
+	priv->curr = nextq(&group->alarmq, priv->curr);
+	p->pending = alarm->gpending;
+	strncpy(p->name, alarm->name, sizeof(p->name));
+
+	return 1;
+}
+
+static int vfile_group_show(struct xnvfile_snapshot_iterator *it, void *data)
+{
+	struct vfile_group_priv *priv = xnvfile_iterator_priv(it);
+	struct vfile_group_data *p = data;
+
+	if (p == NULL) {	/* Dump header. */
+		xnvfile_printf(it, "pending alarms: %d\n", priv->npending);
+		if (it->nrdata > 0)
+			xnvfile_printf(it, "%8s  %s\n", "PENDING", "ALARM");
+	} else
+		xnvfile_printf(it, "%8lu  %.*s\n", p->pending,
+			       (int)sizeof(p->name), p->name);
+
+	return 0;
+}
+
+static struct xnvfile_snapshot_ops vfile_group_ops = {
+	.rewind = vfile_group_rewind,
+	.next = vfile_group_next,
+	.show = vfile_group_show,
+};
+
+static struct xnpnode_snapshot __alarm_group_pnode = {
+	.node = {
+		.dirname = "alarm_groups",
+		.root = &__native_ptree,
+		.ops = &xnregistry_vfsnap_ops,
+	},
+	.vfile = {
+		.privsz = sizeof(struct vfile_group_priv),
+		.datasz = sizeof(struct vfile_group_data),
+		.ops = &vfile_group_ops,
+	},
+};
+
 #else /* !CONFIG_XENO_OPT_VFILE */
 
 static struct xnpnode_snapshot __alarm_pnode = {
@@ -150,6 +237,12 @@ static struct xnpnode_snapshot __alarm_pnode = {
 	},
 };
 
+static struct xnpnode_snapshot __alarm_group_pnode = {
+	.node = {
+		.dirname = "alarm_groups",
+	},
+};
+
 #endif /* !CONFIG_XENO_OPT_VFILE */
 
 int __native_alarm_pkg_init(void)
@@ -160,12 +253,44 @@ int __native_alarm_pkg_init(void)
 void __native_alarm_pkg_cleanup(void)
 {
 	__native_alarm_flush_rq(&__native_global_rholder.alarmq);
+	__native_alarm_group_flush_rq(&__native_global_rholder.alarm_groupq);
+}
+
+/* Must be called with nklock locked, interrupts off. */
+static void __alarm_group_post(RT_ALARM *alarm)
+{
+	RT_ALARM_GROUP *group = alarm->group;
+
+	if (alarm->gpending++ > 0)
+		return;		/* Coalesced into the pending record. */
+
+	appendq(&group->pendq, &alarm->plink);
+	/*
+	 * A single waiter collects all pending records, the timer
+	 * code reschedules on its way out.
+	 */
+	xnsynch_wakeup_one_sleeper(&group->synch_base);
+}
+
+/* Must be called with nklock locked, interrupts off. */
+static void __alarm_group_detach(RT_ALARM *alarm)
+{
+	RT_ALARM_GROUP *group = alarm->group;
+
+	removeq(&group->alarmq, &alarm->glink);
+	if (alarm->gpending) {
+		removeq(&group->pendq, &alarm->plink);
+		alarm->gpending = 0;
+	}
+	alarm->group = NULL;
 }
 
 static void __alarm_trampoline(xntimer_t *timer)
 {
 	RT_ALARM *alarm = container_of(timer, RT_ALARM, timer_base);
 	++alarm->expiries;
+	if (alarm->group)
+		__alarm_group_post(alarm);
 	alarm->handler(alarm, alarm->cookie);
 }
 
@@ -241,6 +366,10 @@ int rt_alarm_create(RT_ALARM *alarm,
 	alarm->expiries = 0;
 	alarm->handler = handler;
 	alarm->cookie = cookie;
+	alarm->group = NULL;
+	inith(&alarm->glink);
+	inith(&alarm->plink);
+	alarm->gpending = 0;
 	xnobject_copy_name(alarm->name, name);
 	inith(&alarm->rlink);
 	alarm->rqueue = &xeno_get_rholder()->alarmq;
@@ -329,6 +458,9 @@ int rt_alarm_delete(RT_ALARM *alarm)
 
 	xntimer_destroy(&alarm->timer_base);
 
+	if (alarm->group)
+		__alarm_group_detach(alarm);
+
 #ifdef CONFIG_XENO_OPT_PERVASIVE
 	rc = xnsynch_destroy(&alarm->synch_base);
 #endif /* CONFIG_XENO_OPT_PERVASIVE */
@@ -532,6 +664,377 @@ int rt_alarm_inquire(RT_ALARM *alarm, RT_ALARM_INFO *info)
 	return err;
 }
 
+/**
+ * @fn int rt_alarm_group_create(RT_ALARM_GROUP *group,const char *name)
+ * @brief Create an alarm group.
+ *
+ * Create a group collecting the expiries of the alarms attached to
+ * it by rt_alarm_attach(), to be waited for with
+ * rt_alarm_group_wait().
+ *
+ * @param group The address of an alarm group descriptor Xenomai will
+ * use to store the group-related data.  This descriptor must always
+ * be valid while the group is active therefore it must be allocated
+ * in permanent memory.
+ *
+ * @param name An ASCII string standing for the symbolic name of the
+ * group. When non-NULL and non-empty, this string is copied to a safe
+ * place into the descriptor, and passed to the registry package if
+ * enabled for indexing the created group.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -ENOMEM is returned if the system fails to get enough dynamic
+ * memory from the global real-time heap in order to register the
+ * group.
+ *
+ * - -EEXIST is returned if the @a name is already in use by some
+ * registered object.
+ *
+ * - -EPERM is returned if this service was called from an
+ * asynchronous context.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: possible.
+ */
+
+int rt_alarm_group_create(RT_ALARM_GROUP *group, const char *name)
+{
+	int err = 0;
+	spl_t s;
+
+	if (xnpod_asynch_p())
+		return -EPERM;
+
+	group->handle = 0;	/* i.e. (still) unregistered group. */
+	group->magic = XENO_ALARM_GROUP_MAGIC;
+	initq(&group->alarmq);
+	initq(&group->pendq);
+	xnsynch_init(&group->synch_base, XNSYNCH_PRIO, NULL);
+	xnobject_copy_name(group->name, name);
+	inith(&group->rlink);
+	group->rqueue = &xeno_get_rholder()->alarm_groupq;
+	xnlock_get_irqsave(&nklock, s);
+	appendq(group->rqueue, &group->rlink);
+	xnlock_put_irqrestore(&nklock, s);
+
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+	group->cpid = 0;
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+
+	if (name) {
+		/*
+		 * <!> Since xnregister_enter() may reschedule, only register
+		 * complete objects, so that the registry cannot return
+		 * handles to half-baked objects...
+		 */
+		err = xnregistry_enter((*name) ? group->name : "", group,
+				       &group->handle,
+				       &__alarm_group_pnode.node);
+		if (err)
+			rt_alarm_group_delete(group);
+	}
+
+	return err;
+}
+
+/**
+ * @fn int rt_alarm_group_delete(RT_ALARM_GROUP *group)
+ * @brief Delete an alarm group.
+ *
+ * Destroy an alarm group. The attached alarms are detached from it,
+ * their pending expiries being discarded, and the tasks waiting on
+ * the group are unblocked with -EIDRM.
+ *
+ * @param group The descriptor address of the affected group.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a group is not an alarm group descriptor.
+ *
+ * - -EIDRM is returned if @a group is a deleted alarm group
+ * descriptor.
+ *
+ * - -EPERM is returned if this service was called from an
+ * asynchronous context.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: possible.
+ */
+
+int rt_alarm_group_delete(RT_ALARM_GROUP *group)
+{
+	xnholder_t *holder;
+	int err = 0, rc;
+	spl_t s;
+
+	if (xnpod_asynch_p())
+		return -EPERM;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	group = xeno_h2obj_validate(group, XENO_ALARM_GROUP_MAGIC,
+				    RT_ALARM_GROUP);
+
+	if (!group) {
+		err = xeno_handle_error(group, XENO_ALARM_GROUP_MAGIC,
+					RT_ALARM_GROUP);
+		goto unlock_and_exit;
+	}
+
+	removeq(group->rqueue, &group->rlink);
+
+	while ((holder = getheadq(&group->alarmq)) != NULL)
+		__alarm_group_detach(glink2alarm(holder));
+
+	rc = xnsynch_destroy(&group->synch_base);
+
+	if (group->handle)
+		xnregistry_remove(group->handle);
+
+	xeno_mark_deleted(group);
+
+	if (rc == XNSYNCH_RESCHED)
+		/* Some task has been woken up as a result of the deletion:
+		   reschedule now. */
+		xnpod_schedule();
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
+/**
+ * @fn int rt_alarm_attach(RT_ALARM *alarm, RT_ALARM_GROUP *group)
+ * @brief Attach an alarm to a group.
+ *
+ * Have the expiries of an alarm posted to an alarm group. An alarm
+ * belongs to one group at most; attaching it moves it from its
+ * current group, if any. Expiries which were pending in the former
+ * group are discarded. Posting to the group does not replace the
+ * alarm handler, nor the wakeup of the tasks sleeping in
+ * rt_alarm_wait().
+ *
+ * @param alarm The descriptor address of the affected alarm. Since
+ * expiries are identified by the registry handle of their alarm,
+ * alarms created from kernel space should be given a name.
+ *
+ * @param group The descriptor address of the group, or NULL to
+ * detach @a alarm from its current group.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a alarm is not an alarm descriptor, or @a
+ * group is not an alarm group descriptor.
+ *
+ * - -EIDRM is returned if @a alarm or @a group is a deleted
+ * descriptor.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+
+int rt_alarm_attach(RT_ALARM *alarm, RT_ALARM_GROUP *group)
+{
+	int err = 0;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	alarm = xeno_h2obj_validate(alarm, XENO_ALARM_MAGIC, RT_ALARM);
+
+	if (!alarm) {
+		err = xeno_handle_error(alarm, XENO_ALARM_MAGIC, RT_ALARM);
+		goto unlock_and_exit;
+	}
+
+	if (group) {
+		group = xeno_h2obj_validate(group, XENO_ALARM_GROUP_MAGIC,
+					    RT_ALARM_GROUP);
+		if (!group) {
+			err = xeno_handle_error(group, XENO_ALARM_GROUP_MAGIC,
+						RT_ALARM_GROUP);
+			goto unlock_and_exit;
+		}
+	}
+
+	if (alarm->group == group)
+		goto unlock_and_exit;
+
+	if (alarm->group)
+		__alarm_group_detach(alarm);
+
+	if (group) {
+		appendq(&group->alarmq, &alarm->glink);
+		alarm->group = group;
+	}
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
+/**
+ * @fn int rt_alarm_group_wait(RT_ALARM_GROUP *group, RT_ALARM_EXPIRY *buf, int nr, RTIME timeout)
+ * @brief Collect the pending expiries of an alarm group.
+ *
+ * Return the expiries posted to the group since the last call,
+ * waiting for some if none is pending. Each alarm which expired is
+ * reported by a single record, in the order the alarms first expired;
+ * further expiries of the same alarm since then are counted as
+ * overruns of that record.
+ *
+ * @param group The descriptor address of the group.
+ *
+ * @param buf The address of an array receiving the records.
+ *
+ * @param nr The number of records @a buf can hold. The records which
+ * do not fit remain pending for the next call.
+ *
+ * @param timeout The number of clock ticks to wait for some expiry
+ * (see note). Passing TM_INFINITE causes the caller to block
+ * indefinitely until some alarm expires. Passing TM_NONBLOCK causes
+ * the service to return immediately without waiting if no expiry is
+ * pending.
+ *
+ * @return The number of records stored into @a buf is returned upon
+ * success. Otherwise:
+ *
+ * - -EINVAL is returned if @a group is not an alarm group descriptor,
+ * or @a nr is not positive.
+ *
+ * - -EIDRM is returned if @a group is a deleted alarm group
+ * descriptor, including if the deletion occurred while the caller was
+ * waiting.
+ *
+ * - -EWOULDBLOCK is returned if @a timeout is equal to TM_NONBLOCK
+ * and no expiry is pending.
+ *
+ * - -ETIMEDOUT is returned if no alarm expired within the specified
+ * amount of time.
+ *
+ * - -EINTR is returned if rt_task_unblock() has been called for the
+ * waiting task.
+ *
+ * - -EPERM is returned if this service should block, but was called
+ * from a context which cannot sleep (e.g. interrupt, non-realtime
+ * context).
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ *   only if @a timeout is equal to TM_NONBLOCK.
+ *
+ * - Kernel-based task
+ * - User-space task (switches to primary mode)
+ *
+ * Rescheduling: always unless the request is immediately satisfied
+ * or @a timeout specifies a non-blocking operation.
+ *
+ * @note The @a timeout value will be interpreted as jiffies if the
+ * native skin is bound to a periodic time base (see
+ * CONFIG_XENO_OPT_NATIVE_PERIOD), or nanoseconds otherwise.
+ */
+
+int rt_alarm_group_wait(RT_ALARM_GROUP *group, RT_ALARM_EXPIRY *buf,
+			int nr, RTIME timeout)
+{
+	xnholder_t *holder;
+	RT_ALARM *alarm;
+	xnflags_t info;
+	int n = 0;
+	spl_t s;
+
+	if (nr <= 0)
+		return -EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	group = xeno_h2obj_validate(group, XENO_ALARM_GROUP_MAGIC,
+				    RT_ALARM_GROUP);
+
+	if (!group) {
+		n = xeno_handle_error(group, XENO_ALARM_GROUP_MAGIC,
+				      RT_ALARM_GROUP);
+		goto unlock_and_exit;
+	}
+
+	while (emptyq_p(&group->pendq)) {
+		if (timeout == TM_NONBLOCK) {
+			n = -EWOULDBLOCK;
+			goto unlock_and_exit;
+		}
+
+		if (xnpod_unblockable_p()) {
+			n = -EPERM;
+			goto unlock_and_exit;
+		}
+
+		info = xnsynch_sleep_on(&group->synch_base,
+					timeout, XN_RELATIVE);
+		if (info & XNRMID) {
+			n = -EIDRM;	/* Group deleted while pending. */
+			goto unlock_and_exit;
+		}
+		if (info & XNTIMEO) {
+			n = -ETIMEDOUT;	/* Timeout. */
+			goto unlock_and_exit;
+		}
+		if (info & XNBREAK) {
+			n = -EINTR;	/* Unblocked. */
+			goto unlock_and_exit;
+		}
+	}
+
+	while (n < nr && (holder = getq(&group->pendq)) != NULL) {
+		alarm = plink2alarm(holder);
+		buf[n].alarm = alarm->handle;
+		buf[n].overruns = alarm->gpending - 1;
+		alarm->gpending = 0;
+		n++;
+	}
+
+	/* Let another waiter pick what did not fit. */
+	if (!emptyq_p(&group->pendq) &&
+	    xnsynch_wakeup_one_sleeper(&group->synch_base))
+		xnpod_schedule();
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return n;
+}
+
 /**
  * @fn int rt_alarm_create(RT_ALARM *alarm,const char *name)
  * @brief Create an alarm object from user-space.
@@ -626,3 +1129,7 @@ EXPORT_SYMBOL_GPL(rt_alarm_delete);
 EXPORT_SYMBOL_GPL(rt_alarm_start);
 EXPORT_SYMBOL_GPL(rt_alarm_stop);
 EXPORT_SYMBOL_GPL(rt_alarm_inquire);
+EXPORT_SYMBOL_GPL(rt_alarm_group_create);
+EXPORT_SYMBOL_GPL(rt_alarm_group_delete);
+EXPORT_SYMBOL_GPL(rt_alarm_attach);
+EXPORT_SYMBOL_GPL(rt_alarm_group_wait);
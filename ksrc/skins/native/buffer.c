@@ -243,6 +243,8 @@ int rt_buffer_create(RT_BUFFER *bf, const char *name, size_t bufsz, int mode)
 
 	xnsynch_init(&bf->isynch_base, mode & B_PRIO, NULL);
 	xnsynch_init(&bf->osynch_base, mode & B_PRIO, NULL);
+	xnselect_init(&bf->read_select);
+	xnselect_init(&bf->write_select);
 
 	bf->handle = 0;	/* i.e. (still) unregistered buffer. */
 	xnobject_copy_name(bf->name, name);
@@ -257,6 +259,9 @@ int rt_buffer_create(RT_BUFFER *bf, const char *name, size_t bufsz, int mode)
 	bf->rdoff = 0;
 	bf->wroff = 0;
 	bf->fillsz = 0;
+	bf->rsvsz = 0;
+	bf->holesz = 0;
+	initq(&bf->rsvq);
 	bf->rdtoken = 0;
 	bf->wrtoken = 0;
 
@@ -351,22 +356,173 @@ int rt_buffer_delete(RT_BUFFER *bf)
 
 	xnlock_put_irqrestore(&nklock, s);
 
+	if (ret == 0) {
+		xnselect_destroy(&bf->read_select);
+		xnselect_destroy(&bf->write_select);
+	}
+
 	if (bufmem)
 		xnarch_free_host_mem(bufmem, bufsz);
 
 	return ret;
 }
 
-ssize_t rt_buffer_write_inner(RT_BUFFER *bf,
-			      struct xnbufd *bufd,
-			      xntmode_t timeout_mode, RTIME timeout)
+/*
+ * Update the state of the selectors watching the buffer: input is
+ * ready with any data, output with any free space. Called with
+ * nklock held, returns non-zero if a rescheduling is required.
+ */
+static int buffer_select_signal(RT_BUFFER *bf)
 {
-	xnthread_t *thread, *waiter;
-	size_t len, rbytes, n;
+	int resched;
+
+	resched = xnselect_signal(&bf->read_select, bf->fillsz > 0);
+	resched |= xnselect_signal(&bf->write_select,
+				   bf->fillsz + bf->rsvsz < bf->bufsz);
+
+	return resched;
+}
+
+/*
+ * Move data within the buffer space back to a lower offset in the
+ * stream, in a circular way. Copying forward is safe for such a move,
+ * even across the end of the buffer space.
+ */
+static void buffer_move(RT_BUFFER *bf, off_t dst, off_t src, size_t len)
+{
+	size_t n;
+
+	while (len > 0) {
+		n = len;
+		if (src + n > bf->bufsz)
+			n = bf->bufsz - src;
+		if (dst + n > bf->bufsz)
+			n = bf->bufsz - dst;
+		memmove(bf->bufmem + dst, bf->bufmem + src, n);
+		dst = (dst + n) % bf->bufsz;
+		src = (src + n) % bf->bufsz;
+		len -= n;
+	}
+}
+
+/*
+ * Publish the leading run of committed reservations to readers, and
+ * wake them up if the first one may now be fed. Readers only ever
+ * see data in reservation order, regardless of the order in which
+ * writers committed.
+ *
+ * Aborted reservations leave a hole right after the filled space,
+ * which the data committed next is moved back over, so that readers
+ * never see it. The hole is given back to writers, rolling back the
+ * write offset, once no reservation follows it anymore. Called with
+ * nklock held, returns non-zero if a rescheduling is required.
+ */
+static int buffer_publish(RT_BUFFER *bf)
+{
+	xnthread_t *waiter;
+	RT_BUFFER_RSV *rsv;
+	xnholder_t *holder;
+	size_t len = 0;
+	int resched = 0;
+	off_t end;
+
+	while ((holder = getheadq(&bf->rsvq)) != NULL) {
+		rsv = link2rsv(holder);
+		if (!rsv->done)
+			break;
+		removeq(&bf->rsvq, holder);
+		if (rsv->aborted) {
+			bf->holesz += rsv->size;
+			continue;
+		}
+		if (bf->holesz > 0) {
+			end = (bf->rdoff + bf->fillsz + len) % bf->bufsz;
+			buffer_move(bf, end, rsv->off, rsv->size);
+		}
+		len += rsv->size;
+	}
+
+	bf->rsvsz -= len;
+	bf->fillsz += len;
+
+	if (bf->holesz > 0 && emptyq_p(&bf->rsvq)) {
+		bf->rsvsz -= bf->holesz;
+		bf->holesz = 0;
+		bf->wroff = (bf->rdoff + bf->fillsz) % bf->bufsz;
+		waiter = xnsynch_peek_pendq(&bf->osynch_base);
+		if (waiter &&
+		    waiter->wait_u.size + bf->fillsz + bf->rsvsz <= bf->bufsz &&
+		    xnsynch_flush(&bf->osynch_base, 0) == XNSYNCH_RESCHED)
+			resched = 1;
+	} else if (len == 0)
+		return 0;
+
+	resched |= buffer_select_signal(bf);
+
+	/*
+	 * Wake up all threads pending on the input wait queue, if we
+	 * accumulated enough data to feed the leading one.
+	 */
+	waiter = xnsynch_peek_pendq(&bf->isynch_base);
+	if (len > 0 && waiter && waiter->wait_u.bufd->b_len <= bf->fillsz &&
+	    xnsynch_flush(&bf->isynch_base, 0) == XNSYNCH_RESCHED)
+		resched = 1;
+
+	return resched;
+}
+
+/*
+ * Drop a reservation which could not be filled. The space is given
+ * back right away if no other reservation follows it; otherwise it
+ * is skipped when publishing, so that no filler data ever reaches
+ * the readers.
+ */
+static void buffer_abort(RT_BUFFER *bf, RT_BUFFER_RSV *rsv)
+{
+	xnthread_t *waiter;
+	int resched;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (xeno_h2obj_validate(bf, XENO_BUFFER_MAGIC, RT_BUFFER) == NULL)
+		goto unlock_and_exit;
+
+	rsv->done = 1;
+	rsv->aborted = 1;
+
+	if (nextq(&bf->rsvq, &rsv->link) == NULL) {
+		removeq(&bf->rsvq, &rsv->link);
+		bf->rsvsz -= rsv->size;
+		bf->wroff = rsv->off;
+		resched = buffer_select_signal(bf);
+		waiter = xnsynch_peek_pendq(&bf->osynch_base);
+		if (waiter &&
+		    waiter->wait_u.size + bf->fillsz + bf->rsvsz <= bf->bufsz &&
+		    xnsynch_flush(&bf->osynch_base, 0) == XNSYNCH_RESCHED)
+			resched = 1;
+		/* We may have been the last one after a hole. */
+		resched |= buffer_publish(bf);
+		if (resched)
+			xnpod_schedule();
+		goto unlock_and_exit;
+	}
+
+	if (buffer_publish(bf))
+		xnpod_schedule();
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+int rt_buffer_reserve_inner(RT_BUFFER *bf, size_t len, RT_BUFFER_RSV *rsv,
+			    xntmode_t timeout_mode, RTIME timeout)
+{
+	xnthread_t *thread;
 	xnflags_t info;
-	u_long wrtoken;
-	off_t wroff;
-	ssize_t ret;
+	int ret = 0;
+	size_t n;
 	spl_t s;
 
 	xnlock_get_irqsave(&nklock, s);
@@ -382,108 +538,35 @@ ssize_t rt_buffer_write_inner(RT_BUFFER *bf,
 	 * accepting messages which are larger than what the buffer
 	 * can hold.
 	 */
-	len = bufd->b_len;
-	if (len > bf->bufsz) {
+	if (len == 0 || len > bf->bufsz) {
 		ret = -EINVAL;
 		goto unlock_and_exit;
 	}
 
-	if (len == 0) {
-		ret = 0;
-		goto unlock_and_exit;
-	}
-
 	if (timeout_mode == XN_RELATIVE &&
 	    timeout != TM_NONBLOCK && timeout != TM_INFINITE) {
 		/*
 		 * We may sleep several times before being able to
-		 * send the data, so let's always use an absolute time
-		 * spec.
+		 * reserve the space, so let's always use an absolute
+		 * time spec.
 		 */
 		timeout_mode = XN_REALTIME;
 		timeout += xntbase_get_time(__native_tbase);
 	}
 
-redo:
-	for (;;) {
-		/*
-		 * We should be able to write the entire message at
-		 * once, or block.
-		 */
-		if (bf->fillsz + len > bf->bufsz)
-			goto wait;
-
-		/*
-		 * Draw the next write token so that we can later
-		 * detect preemption.
-		 */
-		wrtoken = ++bf->wrtoken;
-
-		/* Write to the buffer in a circular way. */
-		wroff = bf->wroff;
-		rbytes = len;
-
-		do {
-			if (wroff + rbytes > bf->bufsz)
-				n = bf->bufsz - wroff;
-			else
-				n = rbytes;
-			/*
-			 * Release the nklock while copying the source
-			 * data to keep latency low.
-			 */
-			xnlock_put_irqrestore(&nklock, s);
-
-			ret = xnbufd_copy_to_kmem(bf->bufmem + wroff, bufd, n);
-			if (ret < 0)
-				return ret;
-
-			xnlock_get_irqsave(&nklock, s);
-			/*
-			 * In case we were preempted while writing
-			 * the message, we have to resend the whole
-			 * thing.
-			 */
-			if (bf->wrtoken != wrtoken) {
-				xnbufd_reset(bufd);
-				goto redo;
-			}
-
-			wroff = (wroff + n) % bf->bufsz;
-			rbytes -= n;
-		} while (rbytes > 0);
-
-		bf->fillsz += len;
-		bf->wroff = wroff;
-		ret = (ssize_t)len;
-
-		/*
-		 * Wake up all threads pending on the input wait
-		 * queue, if we accumulated enough data to feed the
-		 * leading one.
-		 */
-		waiter = xnsynch_peek_pendq(&bf->isynch_base);
-		if (waiter && waiter->wait_u.bufd->b_len <= bf->fillsz) {
-			if (xnsynch_flush(&bf->isynch_base, 0) == XNSYNCH_RESCHED)
-				xnpod_schedule();
-		}
-
-		/*
-		 * We cannot fail anymore once some data has been
-		 * copied via the buffer descriptor, so no need to
-		 * check for any reason to invalidate the latter.
-		 */
-		goto unlock_and_exit;
-
-	wait:
+	/*
+	 * Space which is reserved but not committed yet is as
+	 * unavailable to other writers as filled space is.
+	 */
+	while (bf->fillsz + bf->rsvsz + len > bf->bufsz) {
 		if (timeout_mode == XN_RELATIVE && timeout == TM_NONBLOCK) {
 			ret = -EWOULDBLOCK;
-			break;
+			goto unlock_and_exit;
 		}
 
 		if (xnpod_unblockable_p()) {
 			ret = -EPERM;
-			break;
+			goto unlock_and_exit;
 		}
 
 		thread = xnpod_current_thread();
@@ -492,30 +575,83 @@ redo:
 					timeout, timeout_mode);
 		if (info & XNRMID) {
 			ret = -EIDRM;	/* Buffer deleted while pending. */
-			break;
+			goto unlock_and_exit;
 		} if (info & XNTIMEO) {
 			ret = -ETIMEDOUT;	/* Timeout. */
-			break;
+			goto unlock_and_exit;
 		} if (info & XNBREAK) {
 			ret = -EINTR;	/* Unblocked. */
-			break;
+			goto unlock_and_exit;
 		}
 	}
 
-      unlock_and_exit:
-
 	/*
-	 * xnpod_schedule() is smarter than us; it will detect any
-	 * worthless call inline and won't branch to the rescheduling
-	 * code in such a case.
+	 * Hand out the range in a circular way; a range crossing the
+	 * end of the buffer space is split in two segments.
 	 */
-	xnpod_schedule();
+	rsv->off = bf->wroff;
+	rsv->size = len;
+	rsv->done = 0;
+	rsv->aborted = 0;
+	n = bf->bufsz - rsv->off;
+	rsv->ptr[0] = bf->bufmem + rsv->off;
+	if (len > n) {
+		rsv->len[0] = n;
+		rsv->ptr[1] = bf->bufmem;
+		rsv->len[1] = len - n;
+	} else {
+		rsv->len[0] = len;
+		rsv->ptr[1] = NULL;
+		rsv->len[1] = 0;
+	}
+
+	bf->wroff = (rsv->off + len) % bf->bufsz;
+	bf->rsvsz += len;
+	inith(&rsv->link);
+	appendq(&bf->rsvq, &rsv->link);
+	buffer_select_signal(bf);
+
+      unlock_and_exit:
 
 	xnlock_put_irqrestore(&nklock, s);
 
 	return ret;
 }
 
+ssize_t rt_buffer_write_inner(RT_BUFFER *bf,
+			      struct xnbufd *bufd,
+			      xntmode_t timeout_mode, RTIME timeout)
+{
+	RT_BUFFER_RSV rsv;
+	size_t len;
+	int ret;
+
+	len = bufd->b_len;
+	if (len == 0)
+		return 0;
+
+	ret = rt_buffer_reserve_inner(bf, len, &rsv, timeout_mode, timeout);
+	if (ret)
+		return ret;
+
+	/*
+	 * The reserved range belongs to us until committed, so we
+	 * may copy the source data with the nklock released, without
+	 * having to care for concurrent writers.
+	 */
+	ret = xnbufd_copy_to_kmem(rsv.ptr[0], bufd, rsv.len[0]);
+	if (ret >= 0 && rsv.len[1])
+		ret = xnbufd_copy_to_kmem(rsv.ptr[1], bufd, rsv.len[1]);
+	if (ret < 0) {
+		buffer_abort(bf, &rsv);
+		return ret;
+	}
+
+	ret = rt_buffer_commit(bf, &rsv);
+
+	return ret ?: (ssize_t)len;
+}
+
 ssize_t rt_buffer_read_inner(RT_BUFFER *bf,
 			     struct xnbufd *bufd,
 			     xntmode_t timeout_mode, RTIME timeout)
@@ -526,6 +662,7 @@ ssize_t rt_buffer_read_inner(RT_BUFFER *bf,
 	u_long rdtoken;
 	off_t rdoff;
 	ssize_t ret;
+	int resched;
 	spl_t s;
 
 	xnlock_get_irqsave(&nklock, s);
@@ -615,6 +752,7 @@ redo:
 		bf->fillsz -= len;
 		bf->rdoff = rdoff;
 		ret = (ssize_t)len;
+		resched = buffer_select_signal(bf);
 
 		/*
 		 * Wake up all threads pending on the output wait
@@ -622,10 +760,13 @@ redo:
 		 * to post its message.
 		 */
 		waiter = xnsynch_peek_pendq(&bf->osynch_base);
-		if (waiter && waiter->wait_u.size + bf->fillsz <= bf->bufsz) {
-			if (xnsynch_flush(&bf->osynch_base, 0) == XNSYNCH_RESCHED)
-				xnpod_schedule();
-		}
+		if (waiter &&
+		    waiter->wait_u.size + bf->fillsz + bf->rsvsz <= bf->bufsz &&
+		    xnsynch_flush(&bf->osynch_base, 0) == XNSYNCH_RESCHED)
+			resched = 1;
+
+		if (resched)
+			xnpod_schedule();
 
 		/*
 		 * We cannot fail anymore once some data has been
@@ -1057,6 +1198,178 @@ ssize_t rt_buffer_read_until(RT_BUFFER *bf, void *ptr, size_t len, RTIME timeout
 	return ret;
 }
 
+/**
+ * @fn int rt_buffer_reserve(RT_BUFFER *bf, size_t len, RT_BUFFER_RSV *rsv, RTIME timeout)
+ * @brief Reserve space in a buffer.
+ *
+ * Reserves @a len contiguous bytes (modulo wrap-around) at the write
+ * end of the specified buffer, which the caller may then fill in
+ * place before publishing them with rt_buffer_commit(). If not enough
+ * buffer space is available on entry, the caller is allowed to block
+ * until enough room is freed.
+ *
+ * Unlike rt_buffer_write(), this call does not serialize writers
+ * while the message is copied: several tasks may hold reservations on
+ * the same buffer concurrently, and fill them in parallel. Readers
+ * only get to see reserved data once committed, and always in
+ * reservation order; a reservation committed early is held back until
+ * all reservations preceding it have been committed too.
+ *
+ * @param bf The descriptor address of the buffer to reserve space
+ * from.
+ *
+ * @param len The length in bytes of the message to be written.
+ *
+ * @param rsv The address of a reservation descriptor, which is filled
+ * with the location of the reserved space upon success. When the
+ * reserved range crosses the end of the buffer space, it is returned
+ * as two segments (rsv->ptr[0], rsv->len[0]) and (rsv->ptr[1],
+ * rsv->len[1]); otherwise rsv->len[1] is zero. This descriptor must
+ * remain valid until passed to rt_buffer_commit().
+ *
+ * @param timeout The number of clock ticks to wait for enough buffer
+ * space to be available (see note). Passing TM_INFINITE causes the
+ * caller to block indefinitely until enough buffer space is
+ * available. Passing TM_NONBLOCK causes the service to return
+ * immediately without blocking in case of buffer space shortage.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -ETIMEDOUT is returned if @a timeout is different from
+ * TM_NONBLOCK and no buffer space is available within the specified
+ * amount of time.
+ *
+ * - -EWOULDBLOCK is returned if @a timeout is equal to TM_NONBLOCK
+ * and no buffer space is immediately available on entry.
+ *
+ * - -EINTR is returned if rt_task_unblock() has been called for the
+ * reserving task before enough buffer space became available.
+ *
+ * - -EINVAL is returned if @a bf is not a buffer descriptor, or @a
+ * len is zero or greater than the actual buffer length.
+ *
+ * - -EIDRM is returned if @a bf is a deleted buffer descriptor.
+ *
+ * - -EPERM is returned if this service should block, but was called
+ * from a context which cannot sleep (e.g. interrupt, non-realtime
+ * context).
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine (non-blocking call only)
+ * - Kernel-based task
+ *
+ * Rescheduling: always unless the request is immediately satisfied,
+ * or @a timeout specifies a non-blocking operation.
+ *
+ * @note A reservation which is never committed stalls all readers
+ * once they reach it, so the reserving task should not be deleted
+ * before rt_buffer_commit() is called.
+ *
+ * @note The @a timeout value will be interpreted as jiffies if the
+ * native skin is bound to a periodic time base (see
+ * CONFIG_XENO_OPT_NATIVE_PERIOD), or nanoseconds otherwise.
+ */
+
+int rt_buffer_reserve(RT_BUFFER *bf, size_t len, RT_BUFFER_RSV *rsv,
+		      RTIME timeout)
+{
+	return rt_buffer_reserve_inner(bf, len, rsv, XN_RELATIVE, timeout);
+}
+
+/**
+ * @fn int rt_buffer_reserve_until(RT_BUFFER *bf, size_t len, RT_BUFFER_RSV *rsv, RTIME timeout)
+ * @brief Reserve space in a buffer (with absolute timeout date).
+ *
+ * This call is equivalent to rt_buffer_reserve(), except that @a
+ * timeout is an absolute date specifying a time limit to wait for
+ * enough buffer space to be available. See rt_buffer_reserve() for a
+ * description of the other parameters and return values.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine (non-blocking call only)
+ * - Kernel-based task
+ *
+ * Rescheduling: always unless the request is immediately satisfied,
+ * or @a timeout specifies a non-blocking operation.
+ */
+
+int rt_buffer_reserve_until(RT_BUFFER *bf, size_t len, RT_BUFFER_RSV *rsv,
+			    RTIME timeout)
+{
+	return rt_buffer_reserve_inner(bf, len, rsv, XN_REALTIME, timeout);
+}
+
+/**
+ * @fn int rt_buffer_commit(RT_BUFFER *bf, RT_BUFFER_RSV *rsv)
+ * @brief Commit reserved buffer space.
+ *
+ * Marks the space obtained from rt_buffer_reserve() as filled, making
+ * it available to readers as soon as all reservations preceding it
+ * have been committed as well. Tasks waiting in rt_buffer_read() are
+ * woken up if enough data became available to feed the leading one.
+ *
+ * @param bf The descriptor address of the buffer the space was
+ * reserved from.
+ *
+ * @param rsv The address of the reservation descriptor filled by
+ * rt_buffer_reserve().
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a bf is not a buffer descriptor, or @a
+ * rsv was already committed.
+ *
+ * - -EIDRM is returned if @a bf is a deleted buffer descriptor.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ *
+ * Rescheduling: possible, as a consequence of resuming tasks that
+ * wait for data in rt_buffer_read().
+ */
+
+int rt_buffer_commit(RT_BUFFER *bf, RT_BUFFER_RSV *rsv)
+{
+	int ret = 0;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	bf = xeno_h2obj_validate(bf, XENO_BUFFER_MAGIC, RT_BUFFER);
+	if (bf == NULL) {
+		ret = xeno_handle_error(bf, XENO_BUFFER_MAGIC, RT_BUFFER);
+		goto unlock_and_exit;
+	}
+
+	if (rsv->done) {
+		ret = -EINVAL;
+		goto unlock_and_exit;
+	}
+
+	rsv->done = 1;
+	if (buffer_publish(bf))
+		xnpod_schedule();
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+
 /**
  * @fn int rt_buffer_clear(RT_BUFFER *bf)
  * @brief Clear a buffer.
@@ -1086,7 +1399,7 @@ ssize_t rt_buffer_read_until(RT_BUFFER *bf, void *ptr, size_t len, RTIME timeout
 
 int rt_buffer_clear(RT_BUFFER *bf)
 {
-	int ret = 0;
+	int ret = 0, resched;
 	spl_t s;
 
 	xnlock_get_irqsave(&nklock, s);
@@ -1097,11 +1410,22 @@ int rt_buffer_clear(RT_BUFFER *bf)
 		goto unlock_and_exit;
 	}
 
-	bf->wroff = 0;
-	bf->rdoff = 0;
+	if (emptyq_p(&bf->rsvq)) {
+		bf->wroff = 0;
+		bf->rdoff = 0;
+	} else
+		/*
+		 * Writers are still filling reserved space: only drop
+		 * what was committed so far.
+		 */
+		bf->rdoff = (bf->rdoff + bf->fillsz) % bf->bufsz;
 	bf->fillsz = 0;
+	resched = buffer_select_signal(bf);
 
 	if (xnsynch_flush(&bf->osynch_base, 0) == XNSYNCH_RESCHED)
+		resched = 1;
+
+	if (resched)
 		xnpod_schedule();
 
       unlock_and_exit:
@@ -1159,7 +1483,7 @@ int rt_buffer_inquire(RT_BUFFER *bf, RT_BUFFER_INFO *info)
 	info->iwaiters = xnsynch_nsleepers(&bf->isynch_base);
 	info->owaiters = xnsynch_nsleepers(&bf->osynch_base);
 	info->totalmem = bf->bufsz;
-	info->availmem = bf->bufsz - bf->fillsz;
+	info->availmem = bf->bufsz - bf->fillsz - bf->rsvsz;
 
       unlock_and_exit:
 
@@ -1168,6 +1492,96 @@ int rt_buffer_inquire(RT_BUFFER *bf, RT_BUFFER_INFO *info)
 	return ret;
 }
 
+#ifdef CONFIG_XENO_OPT_SELECT
+
+/**
+ * @fn int rt_buffer_select_bind(RT_BUFFER *bf,struct xnselector *selector,unsigned type,unsigned index)
+ *
+ * @brief Bind a buffer to a selector.
+ *
+ * Have the @a selector watch the buffer, so that xnselect() reports
+ * bit @a index of the XNSELECT_READ set while the buffer holds data,
+ * and of the XNSELECT_WRITE set while it has free space. A reader or
+ * writer may still block if the buffer cannot satisfy the whole
+ * request, so the selecting task should use non-blocking calls.
+ *
+ * @param bf The descriptor address of the buffer to watch.
+ *
+ * @param selector The selector to bind the buffer to.
+ *
+ * @param type The event type, either XNSELECT_READ or XNSELECT_WRITE.
+ *
+ * @param index The index of the buffer in the selector sets.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a bf is not a buffer descriptor, or @a
+ * index is out of range.
+ *
+ * - -EIDRM is returned if @a bf is a deleted buffer descriptor.
+ *
+ * - -EBADF is returned if @a type is not supported.
+ *
+ * - -ENOMEM is returned if the binding cannot be allocated.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: possible.
+ */
+
+int rt_buffer_select_bind(RT_BUFFER *bf, struct xnselector *selector,
+			  unsigned type, unsigned index)
+{
+	struct xnselect_binding *binding;
+	int ret;
+	spl_t s;
+
+	if (type != XNSELECT_READ && type != XNSELECT_WRITE)
+		return -EBADF;
+
+	binding = xnmalloc(sizeof(*binding));
+	if (binding == NULL)
+		return -ENOMEM;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	bf = xeno_h2obj_validate(bf, XENO_BUFFER_MAGIC, RT_BUFFER);
+	if (bf == NULL) {
+		ret = xeno_handle_error(bf, XENO_BUFFER_MAGIC, RT_BUFFER);
+		goto unlock_and_error;
+	}
+
+	if (type == XNSELECT_READ)
+		ret = xnselect_bind(&bf->read_select, binding,
+				    selector, type, index, bf->fillsz > 0);
+	else
+		ret = xnselect_bind(&bf->write_select, binding,
+				    selector, type, index,
+				    bf->fillsz + bf->rsvsz < bf->bufsz);
+	if (ret)
+		goto unlock_and_error;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+
+      unlock_and_error:
+
+	xnlock_put_irqrestore(&nklock, s);
+	xnfree(binding);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(rt_buffer_select_bind);
+
+#endif /* CONFIG_XENO_OPT_SELECT */
+
 /**
  * @fn int rt_buffer_bind(RT_BUFFER *bf, const char *name, RTIME timeout)
  * @brief Bind to a buffer.
@@ -1263,4 +1677,7 @@ EXPORT_SYMBOL_GPL(rt_buffer_write);
 EXPORT_SYMBOL_GPL(rt_buffer_write_until);
 EXPORT_SYMBOL_GPL(rt_buffer_read);
 EXPORT_SYMBOL_GPL(rt_buffer_read_until);
+EXPORT_SYMBOL_GPL(rt_buffer_reserve);
+EXPORT_SYMBOL_GPL(rt_buffer_reserve_until);
+EXPORT_SYMBOL_GPL(rt_buffer_commit);
 EXPORT_SYMBOL_GPL(rt_buffer_inquire);
@@ -188,6 +188,7 @@ int rt_cond_create(RT_COND *cond, const char *name)
 	xnobject_copy_name(cond->name, name);
 	inith(&cond->rlink);
 	cond->rqueue = &xeno_get_rholder()->condq;
+	cond->mutex = NULL;
 	xnlock_get_irqsave(&nklock, s);
 	appendq(cond->rqueue, &cond->rlink);
 	xnlock_put_irqrestore(&nklock, s);
@@ -284,6 +285,18 @@ int rt_cond_delete(RT_COND *cond)
 	return err;
 }
 
+static int rt_cond_morph_sleepers(RT_COND *cond, int nr)
+{
+	RT_MUTEX *mutex;
+
+	mutex = xeno_h2obj_validate(cond->mutex, XENO_MUTEX_MAGIC, RT_MUTEX);
+	if (!mutex)
+		return 0;
+
+	return xnsynch_requeue_sleepers(&cond->synch_base,
+					&mutex->synch_base, nr);
+}
+
 /**
  * @fn int rt_cond_signal(RT_COND *cond)
  * @brief Signal a condition variable.
@@ -328,6 +341,15 @@ int rt_cond_signal(RT_COND *cond)
 		goto unlock_and_exit;
 	}
 
+	/*
+	 * If all waiters use the same mutex, and it is currently
+	 * owned, move the first waiter to the mutex wait queue
+	 * instead of waking it up only to have it block on the mutex
+	 * again.
+	 */
+	if (rt_cond_morph_sleepers(cond, 1))
+		goto unlock_and_exit;
+
 	if (thread2rtask(xnsynch_wakeup_one_sleeper(&cond->synch_base)) != NULL) {
 		xnsynch_set_owner(&cond->synch_base, NULL);	/* No ownership to track. */
 		xnpod_schedule();
@@ -384,6 +406,10 @@ int rt_cond_broadcast(RT_COND *cond)
 		goto unlock_and_exit;
 	}
 
+	/* Same as rt_cond_signal(), to avoid a thundering herd. */
+	if (rt_cond_morph_sleepers(cond, -1))
+		goto unlock_and_exit;
+
 	if (xnsynch_flush(&cond->synch_base, 0) == XNSYNCH_RESCHED)
 		xnpod_schedule();
 
@@ -442,6 +468,12 @@ int rt_cond_wait_prologue(RT_COND *cond, RT_MUTEX *mutex, unsigned *plockcnt,
 	xnsynch_release(&mutex->synch_base);
 	/* Scheduling deferred */
 
+	/* Remember the mutex as long as all waiters agree on it. */
+	if (!xnsynch_nsleepers(&cond->synch_base))
+		cond->mutex = mutex;
+	else if (cond->mutex != mutex)
+		cond->mutex = NULL;
+
 	info = xnsynch_sleep_on(&cond->synch_base,
 				timeout, timeout_mode);
 	if (info & XNRMID)
@@ -473,6 +505,16 @@ int rt_cond_wait_epilogue(RT_MUTEX *mutex, unsigned lockcnt)
 		goto unlock_and_exit;
 	}
 
+	/*
+	 * The mutex may have been handed over to us already, if we
+	 * were moved to its wait queue by rt_cond_signal() or
+	 * rt_cond_broadcast().
+	 */
+	if (xnsynch_accept_handoff(&mutex->synch_base)) {
+		mutex->lockcnt = lockcnt;
+		goto unlock_and_exit;
+	}
+
 	err = rt_mutex_acquire(mutex, TM_INFINITE);
 
 	if(!err)
@@ -764,6 +806,25 @@ int rt_cond_inquire(RT_COND *cond, RT_COND_INFO *info)
  * Rescheduling: never.
  */
 
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+
+xnobjpool_t __native_cond_pool;
+
+int __native_cond_pkg_init(void)
+{
+	xnobjpool_init(&__native_cond_pool, "native.cond", sizeof(RT_COND),
+		       CONFIG_XENO_OPT_NATIVE_COND_POOLSZ);
+	return 0;
+}
+
+void __native_cond_pkg_cleanup(void)
+{
+	__native_cond_flush_rq(&__native_global_rholder.condq);
+	xnobjpool_destroy(&__native_cond_pool);
+}
+
+#else /* !CONFIG_XENO_OPT_PERVASIVE */
+
 int __native_cond_pkg_init(void)
 {
 	return 0;
@@ -774,6 +835,8 @@ void __native_cond_pkg_cleanup(void)
 	__native_cond_flush_rq(&__native_global_rholder.condq);
 }
 
+#endif /* !CONFIG_XENO_OPT_PERVASIVE */
+
 /*@}*/
 
 EXPORT_SYMBOL_GPL(rt_cond_create);
@@ -0,0 +1,903 @@
+/**
+ * @file
+ * This file is part of the Xenomai project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * \ingroup native_cyclic
+ */
+
+/*!
+ * \ingroup native
+ * \defgroup native_cyclic Cyclic executive services.
+ *
+ * Cyclic executive services.
+ *
+ * A cyclic executive divides time into a major frame made of a fixed
+ * number of minor frames (or slots) of equal duration, which are
+ * repeated forever. Each slot may be bound to a task, which is
+ * released at the beginning of the slot, and/or to a handler called
+ * from the timer interrupt at that time.
+ *
+ * A single timer paces the whole executive, programmed once per
+ * minor frame boundary. Tasks bound to slots wait for their next
+ * release point by calling rt_cyclic_wait(), which involves no timer
+ * management at all; the task of the incoming slot is woken up
+ * directly by the timer handler. Since only that task is released at
+ * each boundary, the execution order follows the slot table, instead
+ * of depending on the outcome of priority-based competition between
+ * several periodic tasks. For this reason, tasks attached to a
+ * cyclic executive should be given the same priority.
+ *
+ * A task which is still running when the slot it was released for
+ * ends, or which is not waiting for the slot it is bound to when it
+ * begins, causes an overrun to be charged to that slot. Overruns are
+ * reported to the task by its next call to rt_cyclic_wait(), and are
+ * globally visible through rt_cyclic_inquire().
+ *
+ *@{*/
+
+#include <nucleus/pod.h>
+#include <nucleus/registry.h>
+#include <nucleus/heap.h>
+#include <native/task.h>
+#include <native/cyclic.h>
+#include <native/timer.h>
+
+#ifdef CONFIG_XENO_OPT_VFILE
+
+struct vfile_priv {
+	int curr;
+	RTIME minor;
+	unsigned long frames;
+	unsigned long overruns;
+};
+
+struct vfile_data {
+	int slot;
+	int handler;
+	unsigned long overruns;
+	char name[XNOBJECT_NAME_LEN];
+};
+
+static int vfile_rewind(struct xnvfile_snapshot_iterator *it)
+{
+	struct vfile_priv *priv = xnvfile_iterator_priv(it);
+	RT_CYCLIC *cyclic = xnvfile_priv(it->vfile);
+
+	cyclic = xeno_h2obj_validate(cyclic, XENO_CYCLIC_MAGIC, RT_CYCLIC);
+	if (cyclic == NULL)
+		return -EIDRM;
+
+	priv->curr = 0;
+	priv->minor = cyclic->minor;
+	priv->frames = cyclic->frames;
+	priv->overruns = cyclic->overruns;
+
+	return cyclic->nslots;
+}
+
+static int vfile_next(struct xnvfile_snapshot_iterator *it, void *data)
+{
+	struct vfile_priv *priv = xnvfile_iterator_priv(it);
+	RT_CYCLIC *cyclic = xnvfile_priv(it->vfile);
+	struct vfile_data *p = data;
+	struct rt_cyclic_slot *slot;
+	struct xnthread *thread;
+
+	if (priv->curr >= cyclic->nslots)
+		return 0;	/* We are done. */
+
+	slot = cyclic->slots + priv->curr;
+	p->slot = priv->curr++;
+	p->handler = slot->handler != NULL;
+	p->overruns = slot->overruns;
+	thread = NULL;
+	if (slot->threadh != XN_NO_HANDLE)
+		thread = xnthread_lookup(slot->threadh);
+	if (thread)
+		strncpy(p->name, xnthread_name(thread), sizeof(p->name));
+	else
+		strcpy(p->name, "-");
+
+	return 1;
+}
+
+static int vfile_show(struct xnvfile_snapshot_iterator *it, void *data)
+{
+	struct vfile_priv *priv = xnvfile_iterator_priv(it);
+	struct vfile_data *p = data;
+
+	if (p == NULL) {	/* Dump header. */
+		xnvfile_printf(it, "%8s  %10s  %10s\n",
+			       "MINOR", "FRAMES", "OVERRUNS");
+		xnvfile_printf(it, "%8Lu  %10lu  %10lu\n",
+			       priv->minor, priv->frames, priv->overruns);
+		xnvfile_printf(it, "---------------------------------\n");
+		xnvfile_printf(it, "%4s  %7s  %10s  %s\n",
+			       "SLOT", "HANDLER", "OVERRUNS", "TASK");
+	} else
+		xnvfile_printf(it, "%4d  %7s  %10lu  %.*s\n",
+			       p->slot, p->handler ? "yes" : "no",
+			       p->overruns, (int)sizeof(p->name), p->name);
+
+	return 0;
+}
+
+static struct xnvfile_snapshot_ops vfile_ops = {
+	.rewind = vfile_rewind,
+	.next = vfile_next,
+	.show = vfile_show,
+};
+
+extern struct xnptree __native_ptree;
+
+static struct xnpnode_snapshot __cyclic_pnode = {
+	.node = {
+		.dirname = "cyclics",
+		.root = &__native_ptree,
+		.ops = &xnregistry_vfsnap_ops,
+	},
+	.vfile = {
+		.privsz = sizeof(struct vfile_priv),
+		.datasz = sizeof(struct vfile_data),
+		.ops = &vfile_ops,
+	},
+};
+
+#else /* !CONFIG_XENO_OPT_VFILE */
+
+static struct xnpnode_snapshot __cyclic_pnode = {
+	.node = {
+		.dirname = "cyclics",
+	},
+};
+
+#endif /* !CONFIG_XENO_OPT_VFILE */
+
+int __native_cyclic_pkg_init(void)
+{
+	return 0;
+}
+
+void __native_cyclic_pkg_cleanup(void)
+{
+	__native_cyclic_flush_rq(&__native_global_rholder.cyclicq);
+}
+
+static void __cyclic_overrun(RT_CYCLIC *cyclic, int slot)
+{
+	cyclic->slots[slot].overruns++;
+	cyclic->slots[slot].pending++;
+	cyclic->overruns++;
+	cyclic->last_overrun = slot;
+}
+
+/*
+ * Called at every minor frame boundary, nklock held, interrupts
+ * off. Rescheduling takes place when the timer interrupt handler
+ * returns.
+ */
+static void __cyclic_trampoline(xntimer_t *timer)
+{
+	RT_CYCLIC *cyclic = container_of(timer, RT_CYCLIC, timer_base);
+	struct rt_cyclic_slot *prev = NULL, *next;
+	xnhandle_t late = XN_NO_HANDLE;
+	struct xnthread *thread;
+	int slot;
+
+	if (cyclic->slot >= 0)
+		prev = cyclic->slots + cyclic->slot;
+
+	slot = cyclic->slot + 1;
+	if (slot == cyclic->nslots) {
+		slot = 0;
+		cyclic->frames++;
+	}
+	cyclic->slot = slot;
+	next = cyclic->slots + slot;
+
+	if (next->handler)
+		next->handler(cyclic, slot, next->cookie);
+
+	/*
+	 * The task released for the previous slot should be waiting
+	 * again by now, unless the new slot is its own as well.
+	 */
+	if (prev && prev->busy) {
+		prev->busy = 0;
+		if (prev != next && prev->threadh == next->threadh) {
+			next->busy = 1;
+			return;
+		}
+		__cyclic_overrun(cyclic, prev - cyclic->slots);
+		late = prev->threadh;
+	}
+
+	if (next->threadh == XN_NO_HANDLE)
+		return;
+
+	thread = xnthread_lookup(next->threadh);
+	if (thread == NULL) {
+		/* The task has been deleted, forget about it. */
+		next->threadh = XN_NO_HANDLE;
+		return;
+	}
+
+	if (thread->wchan == &cyclic->synch_base) {
+		xnsynch_wakeup_this_sleeper(&cyclic->synch_base,
+					    &thread->plink);
+		next->busy = 1;
+	} else if (next->threadh != late)
+		/* The task missed its release point. */
+		__cyclic_overrun(cyclic, slot);
+}
+
+/**
+ * @fn int rt_cyclic_create(RT_CYCLIC *cyclic,const char *name,RTIME minor,int nslots)
+ *
+ * @brief Create a cyclic executive.
+ *
+ * Create a cyclic executive made of @a nslots minor frames of equal
+ * duration. No slot is bound to any task or handler initially; the
+ * slot table should be filled using rt_cyclic_attach() before the
+ * executive is started by a call to rt_cyclic_start().
+ *
+ * @param cyclic The address of a cyclic executive descriptor Xenomai
+ * will use to store the related data.  This descriptor must always
+ * be valid while the executive is active therefore it must be
+ * allocated in permanent memory.
+ *
+ * @param name An ASCII string standing for the symbolic name of the
+ * executive. When non-NULL and non-empty, this string is copied to a
+ * safe place into the descriptor, and passed to the registry package
+ * if enabled for indexing the created executive.
+ *
+ * @param minor The duration of a minor frame, expressed in clock
+ * ticks (see note).
+ *
+ * @param nslots The number of minor frames in a major frame, in the
+ * [1 .. CY_MAX_SLOTS] range.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a minor is zero or TM_INFINITE, or if @a
+ * nslots is out of range.
+ *
+ * - -ENOMEM is returned if the system fails to get enough dynamic
+ * memory from the global real-time heap in order to allocate the
+ * slot table, or register the executive.
+ *
+ * - -EEXIST is returned if the @a name is already in use by some
+ * registered object.
+ *
+ * - -EPERM is returned if this service was called from an
+ * asynchronous context.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: possible.
+ *
+ * @note The @a minor value will be interpreted as jiffies if the
+ * native skin is bound to a periodic time base (see
+ * CONFIG_XENO_OPT_NATIVE_PERIOD), or nanoseconds otherwise.
+ */
+
+int rt_cyclic_create(RT_CYCLIC *cyclic, const char *name,
+		     RTIME minor, int nslots)
+{
+	int err = 0;
+	spl_t s;
+
+	if (xnpod_asynch_p())
+		return -EPERM;
+
+	if (minor == 0 || minor == TM_INFINITE ||
+	    nslots < 1 || nslots > CY_MAX_SLOTS)
+		return -EINVAL;
+
+	cyclic->slots = xnmalloc(nslots * sizeof(struct rt_cyclic_slot));
+	if (cyclic->slots == NULL)
+		return -ENOMEM;
+
+	memset(cyclic->slots, 0, nslots * sizeof(struct rt_cyclic_slot));
+	xntimer_init(&cyclic->timer_base, __native_tbase, __cyclic_trampoline);
+	xnsynch_init(&cyclic->synch_base, XNSYNCH_FIFO, NULL);
+	cyclic->handle = 0;	/* i.e. (still) unregistered executive. */
+	cyclic->magic = XENO_CYCLIC_MAGIC;
+	cyclic->minor = minor;
+	cyclic->nslots = nslots;
+	cyclic->slot = -1;
+	cyclic->frames = 0;
+	cyclic->overruns = 0;
+	cyclic->last_overrun = -1;
+	xnobject_copy_name(cyclic->name, name);
+	inith(&cyclic->rlink);
+	cyclic->rqueue = &xeno_get_rholder()->cyclicq;
+	xnlock_get_irqsave(&nklock, s);
+	appendq(cyclic->rqueue, &cyclic->rlink);
+	xnlock_put_irqrestore(&nklock, s);
+
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+	cyclic->cpid = 0;
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+
+	if (name) {
+		if (!*name)
+			/*
+			 * To improve readability in timer_base /proc
+			 * output.
+			 */
+			xnobject_create_name(cyclic->name, sizeof(cyclic->name),
+					     (void *)cyclic);
+
+		/*
+		 * <!> Since xnregister_enter() may reschedule, only register
+		 * complete objects, so that the registry cannot return
+		 * handles to half-baked objects...
+		 */
+		err = xnregistry_enter((*name) ? cyclic->name : "", cyclic,
+				       &cyclic->handle, &__cyclic_pnode.node);
+		if (err)
+			rt_cyclic_delete(cyclic);
+
+		xntimer_set_name(&cyclic->timer_base, cyclic->name);
+	}
+
+	return err;
+}
+
+/**
+ * @fn int rt_cyclic_delete(RT_CYCLIC *cyclic)
+ *
+ * @brief Delete a cyclic executive.
+ *
+ * Stop and destroy a cyclic executive. Tasks waiting for their slot
+ * are unblocked, their call to rt_cyclic_wait() returning -EIDRM.
+ *
+ * @param cyclic The descriptor address of the affected executive.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a cyclic is not a cyclic executive
+ * descriptor.
+ *
+ * - -EIDRM is returned if @a cyclic is a deleted cyclic executive
+ * descriptor.
+ *
+ * - -EPERM is returned if this service was called from an
+ * asynchronous context.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: possible.
+ */
+
+int rt_cyclic_delete(RT_CYCLIC *cyclic)
+{
+	struct rt_cyclic_slot *slots = NULL;
+	int err = 0, rc;
+	spl_t s;
+
+	if (xnpod_asynch_p())
+		return -EPERM;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	cyclic = xeno_h2obj_validate(cyclic, XENO_CYCLIC_MAGIC, RT_CYCLIC);
+
+	if (!cyclic) {
+		err = xeno_handle_error(cyclic, XENO_CYCLIC_MAGIC, RT_CYCLIC);
+		goto unlock_and_exit;
+	}
+
+	removeq(cyclic->rqueue, &cyclic->rlink);
+
+	xntimer_destroy(&cyclic->timer_base);
+
+	rc = xnsynch_destroy(&cyclic->synch_base);
+
+	if (cyclic->handle)
+		xnregistry_remove(cyclic->handle);
+
+	slots = cyclic->slots;
+
+	xeno_mark_deleted(cyclic);
+
+	if (rc == XNSYNCH_RESCHED)
+		/* Some task has been woken up as a result of the deletion:
+		   reschedule now. */
+		xnpod_schedule();
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (slots)
+		xnfree(slots);
+
+	return err;
+}
+
+/**
+ * @fn int rt_cyclic_attach(RT_CYCLIC *cyclic,int slot,RT_TASK *task)
+ *
+ * @brief Bind a task to a slot.
+ *
+ * Assign a minor frame of a cyclic executive to a task, which will be
+ * released at the beginning of that slot if it waits for it by a
+ * call to rt_cyclic_wait() at that time. A task may be bound to any
+ * number of slots, in which case the consecutive ones are run as a
+ * single longer slot. A slot may be reassigned at any time, the
+ * change taking effect at the next boundary.
+ *
+ * @param cyclic The descriptor address of the affected executive.
+ *
+ * @param slot The index of the minor frame to assign, in the [0
+ * .. nslots - 1] range.
+ *
+ * @param task The descriptor address of the task to bind to the
+ * slot. Passing NULL unbinds the slot.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a cyclic is not a cyclic executive
+ * descriptor, if @a task is not a task descriptor, or if @a slot is
+ * out of range.
+ *
+ * - -EIDRM is returned if @a cyclic is a deleted cyclic executive
+ * descriptor, or @a task is a deleted task descriptor.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+
+int rt_cyclic_attach(RT_CYCLIC *cyclic, int slot, RT_TASK *task)
+{
+	xnhandle_t threadh = XN_NO_HANDLE;
+	int err = 0;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	cyclic = xeno_h2obj_validate(cyclic, XENO_CYCLIC_MAGIC, RT_CYCLIC);
+
+	if (!cyclic) {
+		err = xeno_handle_error(cyclic, XENO_CYCLIC_MAGIC, RT_CYCLIC);
+		goto unlock_and_exit;
+	}
+
+	if (slot < 0 || slot >= cyclic->nslots) {
+		err = -EINVAL;
+		goto unlock_and_exit;
+	}
+
+	if (task) {
+		task = xeno_h2obj_validate(task, XENO_TASK_MAGIC, RT_TASK);
+
+		if (!task) {
+			err = xeno_handle_error(task, XENO_TASK_MAGIC, RT_TASK);
+			goto unlock_and_exit;
+		}
+
+		threadh = xnthread_handle(&task->thread_base);
+	}
+
+	if (cyclic->slots[slot].threadh != threadh) {
+		cyclic->slots[slot].threadh = threadh;
+		cyclic->slots[slot].busy = 0;
+	}
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
+/**
+ * @fn int rt_cyclic_attach_handler(RT_CYCLIC *cyclic,int slot,rt_cyclic_t handler,void *cookie)
+ *
+ * @brief Bind a handler to a slot.
+ *
+ * Assign a routine to be called from the timer interrupt at the
+ * beginning of a minor frame, before the task bound to the same slot
+ * (if any) is released. Since handlers run on behalf of Xenomai's
+ * internal timer tick handler, the Xenomai services which can be
+ * called from them are restricted to the set of services available
+ * on behalf of any ISR.
+ *
+ * @param cyclic The descriptor address of the affected executive.
+ *
+ * @param slot The index of the minor frame to assign, in the [0
+ * .. nslots - 1] range.
+ *
+ * @param handler The address of the routine to call. This routine
+ * will be passed the address of the executive descriptor, the slot
+ * index, and the opaque @a cookie. Passing NULL removes the handler
+ * from the slot.
+ *
+ * @param cookie A user-defined opaque cookie the real-time kernel
+ * will pass to the handler as its third argument.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a cyclic is not a cyclic executive
+ * descriptor, or if @a slot is out of range.
+ *
+ * - -EIDRM is returned if @a cyclic is a deleted cyclic executive
+ * descriptor.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ *
+ * Rescheduling: never.
+ */
+
+int rt_cyclic_attach_handler(RT_CYCLIC *cyclic, int slot,
+			     rt_cyclic_t handler, void *cookie)
+{
+	int err = 0;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	cyclic = xeno_h2obj_validate(cyclic, XENO_CYCLIC_MAGIC, RT_CYCLIC);
+
+	if (!cyclic) {
+		err = xeno_handle_error(cyclic, XENO_CYCLIC_MAGIC, RT_CYCLIC);
+		goto unlock_and_exit;
+	}
+
+	if (slot < 0 || slot >= cyclic->nslots) {
+		err = -EINVAL;
+		goto unlock_and_exit;
+	}
+
+	cyclic->slots[slot].handler = handler;
+	cyclic->slots[slot].cookie = cookie;
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
+/**
+ * @fn int rt_cyclic_start(RT_CYCLIC *cyclic,RTIME value)
+ *
+ * @brief Start a cyclic executive.
+ *
+ * Program the first minor frame boundary of a cyclic executive, from
+ * which slot #0 begins. The executive then runs its slot table
+ * endlessly, until rt_cyclic_stop() is called. Starting an executive
+ * which already runs restarts it from slot #0.
+ *
+ * @param cyclic The descriptor address of the affected executive.
+ *
+ * @param value The relative date of the first boundary, expressed in
+ * clock ticks (see note).
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a cyclic is not a cyclic executive
+ * descriptor.
+ *
+ * - -EIDRM is returned if @a cyclic is a deleted cyclic executive
+ * descriptor.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ *
+ * @note The initial @a value will be interpreted as jiffies if the
+ * native skin is bound to a periodic time base (see
+ * CONFIG_XENO_OPT_NATIVE_PERIOD), or nanoseconds otherwise.
+ */
+
+int rt_cyclic_start(RT_CYCLIC *cyclic, RTIME value)
+{
+	int err = 0, n;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	cyclic = xeno_h2obj_validate(cyclic, XENO_CYCLIC_MAGIC, RT_CYCLIC);
+
+	if (!cyclic) {
+		err = xeno_handle_error(cyclic, XENO_CYCLIC_MAGIC, RT_CYCLIC);
+		goto unlock_and_exit;
+	}
+
+	cyclic->slot = -1;
+	for (n = 0; n < cyclic->nslots; n++)
+		cyclic->slots[n].busy = 0;
+
+	xntimer_start(&cyclic->timer_base, value, cyclic->minor, XN_RELATIVE);
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
+/**
+ * @fn int rt_cyclic_stop(RT_CYCLIC *cyclic)
+ *
+ * @brief Stop a cyclic executive.
+ *
+ * Stop pacing the slot table. Tasks waiting for their slot remain
+ * blocked until the executive is started again, or deleted.
+ *
+ * @param cyclic The descriptor address of the affected executive.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a cyclic is not a cyclic executive
+ * descriptor.
+ *
+ * - -EIDRM is returned if @a cyclic is a deleted cyclic executive
+ * descriptor.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+
+int rt_cyclic_stop(RT_CYCLIC *cyclic)
+{
+	int err = 0;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	cyclic = xeno_h2obj_validate(cyclic, XENO_CYCLIC_MAGIC, RT_CYCLIC);
+
+	if (!cyclic) {
+		err = xeno_handle_error(cyclic, XENO_CYCLIC_MAGIC, RT_CYCLIC);
+		goto unlock_and_exit;
+	}
+
+	xntimer_stop(&cyclic->timer_base);
+	cyclic->slot = -1;
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
+/**
+ * @fn int rt_cyclic_wait(RT_CYCLIC *cyclic,unsigned long *overruns_r)
+ *
+ * @brief Wait for the next slot.
+ *
+ * Mark the job of the caller as complete for the current slot, and
+ * block it until the beginning of the next slot it is bound to. This
+ * service must be called by a task which has been attached to at
+ * least one slot of the executive, using rt_cyclic_attach().
+ *
+ * The caller is always released at the beginning of a slot, even if
+ * it overran some slot since the previous call; the overrun count is
+ * then returned along with -ETIMEDOUT, so that the task may take any
+ * corrective action before running its next job.
+ *
+ * @param cyclic The descriptor address of the executive.
+ *
+ * @param overruns_r If non-NULL, @a overruns_r must be a pointer to a
+ * memory location which will be written with the count of overruns
+ * charged to the slots of the caller since the previous call to this
+ * service.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -ETIMEDOUT is returned if the caller overran some slot, or
+ * missed its release point since the previous call.
+ *
+ * - -EINVAL is returned if @a cyclic is not a cyclic executive
+ * descriptor.
+ *
+ * - -EIDRM is returned if @a cyclic is a deleted cyclic executive
+ * descriptor, including if the deletion occurred while the caller
+ * was waiting for its slot.
+ *
+ * - -EINTR is returned if rt_task_unblock() has been called for the
+ * waiting task before its slot began.
+ *
+ * - -EPERM is returned if the caller is not attached to any slot of
+ * the executive, or if this service was called from a context which
+ * cannot sleep (e.g. interrupt, non-realtime context).
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: always.
+ */
+
+int rt_cyclic_wait(RT_CYCLIC *cyclic, unsigned long *overruns_r)
+{
+	unsigned long overruns = 0;
+	struct xnthread *thread;
+	int err = 0, attached = 0, n;
+	xnhandle_t threadh;
+	xnflags_t info;
+	spl_t s;
+
+	if (xnpod_unblockable_p())
+		return -EPERM;
+
+	thread = xnpod_current_thread();
+	threadh = xnthread_handle(thread);
+
+	xnlock_get_irqsave(&nklock, s);
+
+	cyclic = xeno_h2obj_validate(cyclic, XENO_CYCLIC_MAGIC, RT_CYCLIC);
+
+	if (!cyclic) {
+		err = xeno_handle_error(cyclic, XENO_CYCLIC_MAGIC, RT_CYCLIC);
+		goto unlock_and_exit;
+	}
+
+	for (n = 0; n < cyclic->nslots; n++) {
+		struct rt_cyclic_slot *slot = cyclic->slots + n;
+		if (slot->threadh != threadh)
+			continue;
+		attached = 1;
+		slot->busy = 0;
+		overruns += slot->pending;
+		slot->pending = 0;
+	}
+
+	if (!attached) {
+		err = -EPERM;
+		goto unlock_and_exit;
+	}
+
+	info = xnsynch_sleep_on(&cyclic->synch_base, XN_INFINITE, XN_RELATIVE);
+	if (info & XNRMID)
+		err = -EIDRM;	/* Executive deleted while pending. */
+	else if (info & XNBREAK)
+		err = -EINTR;	/* Unblocked. */
+	else if (overruns)
+		err = -ETIMEDOUT;
+
+	if (overruns_r)
+		*overruns_r = overruns;
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
+/**
+ * @fn int rt_cyclic_inquire(RT_CYCLIC *cyclic, RT_CYCLIC_INFO *info)
+ *
+ * @brief Inquire about a cyclic executive.
+ *
+ * Return various information about the status of a given executive.
+ *
+ * @param cyclic The descriptor address of the inquired executive.
+ *
+ * @param info The address of a structure the executive information
+ * will be written to.
+ *
+ * @return 0 is returned and status information is written to the
+ * structure pointed at by @a info upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a cyclic is not a cyclic executive
+ * descriptor.
+ *
+ * - -EIDRM is returned if @a cyclic is a deleted cyclic executive
+ * descriptor.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+
+int rt_cyclic_inquire(RT_CYCLIC *cyclic, RT_CYCLIC_INFO *info)
+{
+	int err = 0;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	cyclic = xeno_h2obj_validate(cyclic, XENO_CYCLIC_MAGIC, RT_CYCLIC);
+
+	if (!cyclic) {
+		err = xeno_handle_error(cyclic, XENO_CYCLIC_MAGIC, RT_CYCLIC);
+		goto unlock_and_exit;
+	}
+
+	strcpy(info->name, cyclic->name);
+	info->minor = cyclic->minor;
+	info->nslots = cyclic->nslots;
+	info->slot = cyclic->slot;
+	info->frames = cyclic->frames;
+	info->overruns = cyclic->overruns;
+	info->last_overrun = cyclic->last_overrun;
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
+/*@}*/
+
+EXPORT_SYMBOL_GPL(rt_cyclic_create);
+EXPORT_SYMBOL_GPL(rt_cyclic_delete);
+EXPORT_SYMBOL_GPL(rt_cyclic_attach);
+EXPORT_SYMBOL_GPL(rt_cyclic_attach_handler);
+EXPORT_SYMBOL_GPL(rt_cyclic_start);
+EXPORT_SYMBOL_GPL(rt_cyclic_stop);
+EXPORT_SYMBOL_GPL(rt_cyclic_wait);
+EXPORT_SYMBOL_GPL(rt_cyclic_inquire);
@@ -42,6 +42,7 @@
 #include <nucleus/pod.h>
 #include <nucleus/registry.h>
 #include <nucleus/heap.h>
+#include <nucleus/sys_ppd.h>
 #include <native/task.h>
 #include <native/event.h>
 
@@ -68,7 +69,7 @@ static int vfile_rewind(struct xnvfile_snapshot_iterator *it)
 		return -EIDRM;
 
 	priv->curr = getheadpq(xnsynch_wait_queue(&event->synch_base));
-	priv->value = event->value;
+	priv->value = xnarch_atomic_get(&event->state->value);
 
 	return xnsynch_nsleepers(&event->synch_base);
 }
@@ -81,7 +82,8 @@ static int vfile_next(struct xnvfile_snapshot_iterator *it, void *data)
 	struct xnthread *thread;
 	RT_TASK *task;
 
-	priv->value = event->value; /* Refresh as we collect. */
+	/* Refresh as we collect. */
+	priv->value = xnarch_atomic_get(&event->state->value);
 
 	if (priv->curr == NULL)
 		return 0;	/* We are done. */
@@ -151,6 +153,252 @@ static struct xnpnode_snapshot __event_pnode = {
 
 #endif /* !CONFIG_XENO_OPT_VFILE */
 
+/*
+ * Sleepers are indexed by the flags they are waiting for, so that a
+ * post only looks at the sleepers which may be satisfied by the
+ * flags it sets. A conjunctive sleeper, or a disjunctive one waiting
+ * for a single flag, is linked to the queue of one of the flags it
+ * still misses: it cannot be satisfied until that flag is posted,
+ * and is moved to the queue of the next missing flag if need
+ * be. Disjunctive sleepers waiting for several flags share the anyq
+ * queue, which a post only scans if it sets any of the flags they
+ * are waiting for. Index queues follow the pend order of the group;
+ * the masks of the non-empty queues are cleared lazily, by the posts
+ * scanning them. All callers hold nklock.
+ */
+static inline void __event_index(RT_EVENT *event, RT_TASK *task,
+				 unsigned long missing)
+{
+	unsigned long mask = task->wait_args.event.mask;
+	xnpqueue_t *q;
+	int bit, prio;
+
+	if ((task->wait_args.event.mode & EV_ANY) && (mask & (mask - 1))) {
+		q = &event->anyq;
+		event->anymask |= mask;
+	} else {
+		bit = ffnz(missing);
+		q = &event->bitq[bit];
+		event->bitmask |= (1UL << bit);
+	}
+
+	if (q == task->evq)
+		return;
+
+	if (task->evq)
+		removepq(task->evq, &task->evlink);
+
+	prio = xnsynch_test_flags(&event->synch_base, EV_PRIO) ?
+		xnthread_current_priority(&task->thread_base) : 0;
+	insertpqf(q, &task->evlink, prio);
+	task->evq = q;
+}
+
+void __native_event_forget(RT_TASK *task)
+{
+	removepq(task->evq, &task->evlink);
+	task->evq = NULL;
+}
+
+/*
+ * A selector bound to the group counts as a waiter, so that
+ * user-space posters enter the kernel and the selector gets
+ * notified. The count is refreshed lazily, a stale one only costs
+ * a useless syscall.
+ */
+static inline int __event_nwaiters(RT_EVENT *event)
+{
+	int nwaiters = xnsynch_nsleepers(&event->synch_base);
+
+#ifdef CONFIG_XENO_OPT_SELECT
+	if (!emptyq_p(&event->read_select.bindings))
+		nwaiters++;
+#endif /* CONFIG_XENO_OPT_SELECT */
+
+	return nwaiters;
+}
+
+static inline int __event_select_signal(RT_EVENT *event)
+{
+	return xnselect_signal(&event->read_select,
+			       xnarch_atomic_get(&event->state->value) != 0);
+}
+
+static void __event_flush_index(RT_EVENT *event)
+{
+	xnpholder_t *holder;
+	int bit;
+
+	for (bit = 0; bit < EV_NBITS; bit++)
+		while ((holder = getpq(&event->bitq[bit])) != NULL)
+			container_of(holder, RT_TASK, evlink)->evq = NULL;
+
+	while ((holder = getpq(&event->anyq)) != NULL)
+		container_of(holder, RT_TASK, evlink)->evq = NULL;
+
+	event->bitmask = 0;
+	event->anymask = 0;
+}
+
+/*
+ * Hand the flags a request is granted over to the requester. The
+ * flags of counting groups are consumed in the process, their post
+ * counts being reported through @a counts if non-NULL.
+ */
+static unsigned long __event_grant(RT_EVENT *event, unsigned long bits,
+				   unsigned long *counts)
+{
+	unsigned long rest;
+	int bit;
+
+	if (event->counts == NULL) {
+		if (counts)
+			for (rest = bits; rest; rest &= ~(1UL << bit)) {
+				bit = ffnz(rest);
+				counts[bit] = 1;
+			}
+		return bits;
+	}
+
+	__rt_event_clear(event->state, bits);
+	__event_select_signal(event);
+
+	for (rest = bits; rest; rest &= ~(1UL << bit)) {
+		bit = ffnz(rest);
+		if (counts)
+			counts[bit] = event->counts[bit];
+		event->counts[bit] = 0;
+	}
+
+	return bits;
+}
+
+/* Post flags, counting them in counting groups. */
+static unsigned long __event_post(RT_EVENT *event, unsigned long mask)
+{
+	unsigned long rest;
+	int bit;
+
+	if (event->counts)
+		for (rest = mask; rest; rest &= ~(1UL << bit)) {
+			bit = ffnz(rest);
+			if (event->counts[bit] != ~0UL)
+				event->counts[bit]++;
+		}
+
+	return __rt_event_post(event->state, mask);
+}
+
+/*
+ * Wake up an indexed sleeper if its request is fulfilled by the
+ * current flags, otherwise move it to the queue of a flag it still
+ * misses.
+ */
+static int __event_check(RT_EVENT *event, RT_TASK *sleeper)
+{
+	unsigned long value = xnarch_atomic_get(&event->state->value);
+	unsigned long bits = sleeper->wait_args.event.mask;
+	int mode = sleeper->wait_args.event.mode;
+
+	/* Timed out or unblocked, but not running yet. */
+	if (sleeper->thread_base.wchan != &event->synch_base) {
+		__native_event_forget(sleeper);
+		return 0;
+	}
+
+	if (!__rt_event_test(value, bits, mode)) {
+		__event_index(event, sleeper, bits & ~value);
+		return 0;
+	}
+
+	__native_event_forget(sleeper);
+	sleeper->wait_args.event.mask =
+		__event_grant(event, bits & value,
+			      sleeper->wait_args.event.counts);
+	xnsynch_wakeup_this_sleeper(&event->synch_base,
+				    &sleeper->thread_base.plink);
+	return 1;
+}
+
+int rt_event_create_inner(RT_EVENT *event, const char *name,
+			  unsigned long ivalue, int mode, int global)
+{
+	xnflags_t flags = mode & EV_PRIO;
+	struct rt_event_state *state;
+	unsigned long *counts = NULL;
+	int err = 0, n;
+	spl_t s;
+
+	if (xnpod_asynch_p())
+		return -EPERM;
+
+	if (mode & EV_COUNT) {
+		counts = xnmalloc(EV_NBITS * sizeof(*counts));
+		if (!counts)
+			return -ENOMEM;
+		for (n = 0; n < EV_NBITS; n++)
+			counts[n] = (ivalue >> n) & 1;
+	}
+
+#ifdef CONFIG_XENO_FASTSYNCH
+	/* Allocate the state user-space may update. */
+	state = xnheap_alloc(&xnsys_ppd_get(global)->sem_heap,
+			     xnheap_synch_size(sizeof(*state), 0));
+	if (!state) {
+		if (counts)
+			xnfree(counts);
+		return -ENOMEM;
+	}
+
+	if (global)
+		flags |= RT_EVENT_EXPORTED;
+#else /* !CONFIG_XENO_FASTSYNCH */
+	state = &event->statebuf;
+#endif /* !CONFIG_XENO_FASTSYNCH */
+
+	xnarch_atomic_set(&state->value, ivalue);
+	xnarch_atomic_set(&state->nwaiters, 0);
+	state->mode = mode & EV_COUNT;
+	event->state = state;
+	event->counts = counts;
+
+	for (n = 0; n < EV_NBITS; n++)
+		initpq(&event->bitq[n]);
+	initpq(&event->anyq);
+	event->bitmask = 0;
+	event->anymask = 0;
+
+	xnsynch_init(&event->synch_base, flags, NULL);
+	xnselect_init(&event->read_select);
+	event->handle = 0;	/* i.e. (still) unregistered event. */
+	event->magic = XENO_EVENT_MAGIC;
+	xnobject_copy_name(event->name, name);
+	inith(&event->rlink);
+	event->rqueue = &xeno_get_rholder()->eventq;
+	xnlock_get_irqsave(&nklock, s);
+	appendq(event->rqueue, &event->rlink);
+	xnlock_put_irqrestore(&nklock, s);
+
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+	event->cpid = 0;
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+
+	/*
+	 * <!> Since xnregister_enter() may reschedule, only register
+	 * complete objects, so that the registry cannot return
+	 * handles to half-baked objects...
+	 */
+	if (name) {
+		err = xnregistry_enter(event->name, event, &event->handle,
+				       &__event_pnode.node);
+
+		if (err)
+			rt_event_delete(event);
+	}
+
+	return err;
+}
+
 /**
  * @fn int rt_event_create(RT_EVENT *event,const char *name,unsigned long ivalue,int mode)
  * @brief Create an event group.
@@ -185,6 +433,13 @@ static struct xnpnode_snapshot __event_pnode = {
  *
  * - EV_PRIO makes tasks pend in priority order on the event group.
  *
+ * - EV_COUNT creates a counting group, which counts the posts of each
+ * flag until it is granted to a waiting task. Flags granted to a task
+ * are consumed, i.e. cleared from the event mask, and
+ * rt_event_wait_count() reports their post counts. Flags of counting
+ * groups are always posted and cleared by the kernel, including from
+ * user-space.
+ *
  * @return 0 is returned upon success. Otherwise:
  *
  * - -EEXIST is returned if the @a name is already in use by some
@@ -195,7 +450,8 @@ static struct xnpnode_snapshot __event_pnode = {
  *
  * - -ENOMEM is returned if the system fails to get enough dynamic
  * memory from the global real-time heap in order to register the
- * event group.
+ * event group, or from the semaphore heap in order to allocate its
+ * shared state.
  *
  * Environments:
  *
@@ -211,41 +467,7 @@ static struct xnpnode_snapshot __event_pnode = {
 int rt_event_create(RT_EVENT *event,
 		    const char *name, unsigned long ivalue, int mode)
 {
-	int err = 0;
-	spl_t s;
-
-	if (xnpod_asynch_p())
-		return -EPERM;
-
-	xnsynch_init(&event->synch_base, mode & EV_PRIO, NULL);
-	event->value = ivalue;
-	event->handle = 0;	/* i.e. (still) unregistered event. */
-	event->magic = XENO_EVENT_MAGIC;
-	xnobject_copy_name(event->name, name);
-	inith(&event->rlink);
-	event->rqueue = &xeno_get_rholder()->eventq;
-	xnlock_get_irqsave(&nklock, s);
-	appendq(event->rqueue, &event->rlink);
-	xnlock_put_irqrestore(&nklock, s);
-
-#ifdef CONFIG_XENO_OPT_PERVASIVE
-	event->cpid = 0;
-#endif /* CONFIG_XENO_OPT_PERVASIVE */
-
-	/*
-	 * <!> Since xnregister_enter() may reschedule, only register
-	 * complete objects, so that the registry cannot return
-	 * handles to half-baked objects...
-	 */
-	if (name) {
-		err = xnregistry_enter(event->name, event, &event->handle,
-				       &__event_pnode.node);
-
-		if (err)
-			rt_event_delete(event);
-	}
-
-	return err;
+	return rt_event_create_inner(event, name, ivalue, mode, 1);
 }
 
 /**
@@ -281,7 +503,7 @@ int rt_event_create(RT_EVENT *event,
 
 int rt_event_delete(RT_EVENT *event)
 {
-	int err = 0, rc;
+	int err = 0, global = 0, rc;
 	spl_t s;
 
 	if (xnpod_asynch_p())
@@ -296,8 +518,12 @@ int rt_event_delete(RT_EVENT *event)
 		goto unlock_and_exit;
 	}
 
+	global = xnsynch_test_flags(&event->synch_base, RT_EVENT_EXPORTED);
+
 	removeq(event->rqueue, &event->rlink);
 
+	__event_flush_index(event);
+
 	rc = xnsynch_destroy(&event->synch_base);
 
 	if (event->handle)
@@ -314,6 +540,17 @@ int rt_event_delete(RT_EVENT *event)
 
 	xnlock_put_irqrestore(&nklock, s);
 
+	if (!err) {
+		xnselect_destroy(&event->read_select);
+		if (event->counts)
+			xnfree(event->counts);
+	}
+
+#ifdef CONFIG_XENO_FASTSYNCH
+	if (!err)
+		xnheap_free(&xnsys_ppd_get(global)->sem_heap, event->state);
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 	return err;
 }
 
@@ -324,6 +561,13 @@ int rt_event_delete(RT_EVENT *event)
  * Post a set of bits to the event mask. All tasks having their wait
  * request fulfilled by the posted events are resumed.
  *
+ * When called from user-space, the flags are posted without entering
+ * the kernel if no task is pending on the group, by updating its
+ * state in the shared semaphore heap. Likewise, rt_event_wait()
+ * returns from user-space if the request is already fulfilled and the
+ * caller runs in primary mode, and rt_event_clear() never enters the
+ * kernel.
+ *
  * @param event The descriptor address of the affected event.
  *
  * @param mask The set of events to be posted.
@@ -349,7 +593,9 @@ int rt_event_delete(RT_EVENT *event)
 int rt_event_signal(RT_EVENT *event, unsigned long mask)
 {
 	xnpholder_t *holder, *nholder;
-	int err = 0, resched = 0;
+	unsigned long pending;
+	int err = 0, resched = 0, bit;
+	xnpqueue_t *q;
 	spl_t s;
 
 	xnlock_get_irqsave(&nklock, s);
@@ -363,32 +609,51 @@ int rt_event_signal(RT_EVENT *event, unsigned long mask)
 
 	/* Post the flags. */
 
-	event->value |= mask;
+	__event_post(event, mask);
+	resched = __event_select_signal(event);
 
-	/* And wakeup any sleeper having its request fulfilled. */
+	/*
+	 * And wakeup any sleeper having its request fulfilled,
+	 * looking only at the sleepers indexed by the posted flags.
+	 */
 
-	nholder = getheadpq(xnsynch_wait_queue(&event->synch_base));
+	for (pending = mask & event->bitmask; pending;
+	     pending &= ~(1UL << bit)) {
+		bit = ffnz(pending);
+		q = &event->bitq[bit];
+		nholder = getheadpq(q);
+
+		while ((holder = nholder) != NULL) {
+			nholder = nextpq(q, holder);
+			resched |= __event_check(event,
+						 container_of(holder, RT_TASK,
+							      evlink));
+		}
+
+		if (emptypq_p(q))
+			event->bitmask &= ~(1UL << bit);
+	}
 
-	while ((holder = nholder) != NULL) {
-		RT_TASK *sleeper = thread2rtask(link2thread(holder, plink));
-		int mode = sleeper->wait_args.event.mode;
-		unsigned long bits = sleeper->wait_args.event.mask;
+	if (mask & event->anymask) {
+		q = &event->anyq;
+		nholder = getheadpq(q);
 
-		if (((mode & EV_ANY) && (bits & event->value) != 0) ||
-		    (!(mode & EV_ANY) && ((bits & event->value) == bits))) {
-			sleeper->wait_args.event.mask = (bits & event->value);
-			nholder =
-			    xnsynch_wakeup_this_sleeper(&event->synch_base,
-							holder);
-			resched = 1;
-		} else
-			nholder =
-			    nextpq(xnsynch_wait_queue(&event->synch_base),
-				   holder);
+		while ((holder = nholder) != NULL) {
+			nholder = nextpq(q, holder);
+			resched |= __event_check(event,
+						 container_of(holder, RT_TASK,
+							      evlink));
+		}
+
+		if (emptypq_p(q))
+			event->anymask = 0;
 	}
 
-	if (resched)
+	if (resched) {
+		xnarch_atomic_set(&event->state->nwaiters,
+				  __event_nwaiters(event));
 		xnpod_schedule();
+	}
 
       unlock_and_exit:
 
@@ -400,8 +665,10 @@ int rt_event_signal(RT_EVENT *event, unsigned long mask)
 int rt_event_wait_inner(RT_EVENT *event,
 			unsigned long mask,
 			unsigned long *mask_r,
+			unsigned long *counts,
 			int mode, xntmode_t timeout_mode, RTIME timeout)
 {
+	unsigned long value;
 	RT_TASK *task;
 	xnflags_t info;
 	int err = 0;
@@ -416,27 +683,25 @@ int rt_event_wait_inner(RT_EVENT *event,
 		goto unlock_and_exit;
 	}
 
+	value = xnarch_atomic_get(&event->state->value);
+
 	if (!mask) {
-		*mask_r = event->value;
+		*mask_r = value;
 		goto unlock_and_exit;
 	}
 
 	if (timeout == TM_NONBLOCK) {
-		unsigned long bits = (event->value & mask);
-		*mask_r = bits;
-
-		if (mode & EV_ANY) {
-			if (!bits)
-				err = -EWOULDBLOCK;
-		} else if (bits != mask)
+		if (!__rt_event_test(value, mask, mode)) {
+			*mask_r = (value & mask);
 			err = -EWOULDBLOCK;
+		} else
+			*mask_r = __event_grant(event, value & mask, counts);
 
 		goto unlock_and_exit;
 	}
 
-	if (((mode & EV_ANY) && (mask & event->value) != 0) ||
-	    (!(mode & EV_ANY) && ((mask & event->value) == mask))) {
-		*mask_r = (event->value & mask);
+	if (__rt_event_test(value, mask, mode)) {
+		*mask_r = __event_grant(event, value & mask, counts);
 		goto unlock_and_exit;
 	}
 
@@ -445,17 +710,45 @@ int rt_event_wait_inner(RT_EVENT *event,
 		goto unlock_and_exit;
 	}
 
+	/*
+	 * Tell user-space posters we are about to sleep, then check
+	 * the flags again: either they see us, or we see what they
+	 * have posted meanwhile.
+	 */
+	xnarch_atomic_set(&event->state->nwaiters,
+			  __event_nwaiters(event) + 1);
+	xnarch_memory_barrier();
+	value = xnarch_atomic_get(&event->state->value);
+
+	if (__rt_event_test(value, mask, mode)) {
+		xnarch_atomic_set(&event->state->nwaiters,
+				  __event_nwaiters(event));
+		*mask_r = __event_grant(event, value & mask, counts);
+		goto unlock_and_exit;
+	}
+
 	task = xeno_current_task();
 	task->wait_args.event.mode = mode;
 	task->wait_args.event.mask = mask;
+	task->wait_args.event.counts = counts;
+	__event_index(event, task, mask & ~value);
 	info = xnsynch_sleep_on(&event->synch_base,
 				timeout, timeout_mode);
 	if (info & XNRMID)
 		err = -EIDRM;	/* Event group deleted while pending. */
-	else if (info & XNTIMEO)
-		err = -ETIMEDOUT;	/* Timeout. */
-	else if (info & XNBREAK)
-		err = -EINTR;	/* Unblocked. */
+	else {
+		if (info & XNTIMEO)
+			err = -ETIMEDOUT;	/* Timeout. */
+		else if (info & XNBREAK)
+			err = -EINTR;	/* Unblocked. */
+
+		/* Still indexed unless the request was fulfilled. */
+		if (task->evq)
+			__native_event_forget(task);
+
+		xnarch_atomic_set(&event->state->nwaiters,
+				  __event_nwaiters(event));
+	}
 	/*
 	 * The returned mask is only significant if the operation has
 	 * succeeded, but do always write it back anyway.
@@ -481,7 +774,7 @@ int rt_event_wait_inner(RT_EVENT *event,
  * The event bits are NOT cleared from the event group when a request
  * is satisfied; rt_event_wait() will return immediately with success
  * for the same event mask until rt_event_clear() is called to clear
- * those bits.
+ * those bits, unless the group was created with EV_COUNT.
  *
  * @param event The descriptor address of the affected event group.
  *
@@ -551,7 +844,8 @@ int rt_event_wait(RT_EVENT *event,
 		  unsigned long mask,
 		  unsigned long *mask_r, int mode, RTIME timeout)
 {
-	return rt_event_wait_inner(event, mask, mask_r, mode, XN_RELATIVE, timeout);
+	return rt_event_wait_inner(event, mask, mask_r, NULL,
+				   mode, XN_RELATIVE, timeout);
 }
 
 /**
@@ -566,7 +860,7 @@ int rt_event_wait(RT_EVENT *event,
  * The event bits are NOT cleared from the event group when a request
  * is satisfied; rt_event_wait() will return immediately with success
  * for the same event mask until rt_event_clear() is called to clear
- * those bits.
+ * those bits, unless the group was created with EV_COUNT.
  *
  * @param event The descriptor address of the affected event group.
  *
@@ -637,14 +931,70 @@ int rt_event_wait_until(RT_EVENT *event,
 		  unsigned long mask,
 		  unsigned long *mask_r, int mode, RTIME timeout)
 {
-	return rt_event_wait_inner(event, mask, mask_r, mode, XN_REALTIME, timeout);
+	return rt_event_wait_inner(event, mask, mask_r, NULL,
+				   mode, XN_REALTIME, timeout);
+}
+
+/**
+ * @fn int rt_event_wait_count(RT_EVENT *event,unsigned long mask,unsigned long *mask_r,unsigned long *counts,int mode,RTIME timeout)
+ * @brief Pend on an event group, collecting post counts.
+ *
+ * This service is identical to rt_event_wait(), except that it also
+ * reports how many times each of the returned flags has been posted
+ * to a group created in counting mode (EV_COUNT). The flags returned
+ * to the caller are consumed, i.e. cleared from the event mask and
+ * their post counts reset, so that a request does not have to be
+ * paired with a call to rt_event_clear().
+ *
+ * @param event The descriptor address of the affected event group.
+ *
+ * @param mask The set of bits to wait for.
+ *
+ * @param mask_r The set of flags granted to the caller.
+ *
+ * @param counts An array of EV_NBITS post counters, indexed by flag
+ * number. The entries of the flags returned in @a mask_r receive the
+ * number of times these flags were posted since they were last
+ * consumed or cleared; the other entries are left unchanged. For a
+ * group created without EV_COUNT, a count of one is reported for
+ * each flag returned. May be NULL.
+ *
+ * @param mode The pend mode, see rt_event_wait().
+ *
+ * @param timeout The number of clock ticks to wait for fulfilling the
+ * request, see rt_event_wait().
+ *
+ * @return 0 is returned upon success, or any of the error codes
+ * rt_event_wait() may return.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code or Interrupt service
+ * routine only if @a timeout is equal to TM_NONBLOCK.
+ * - Kernel-based task
+ * - User-space task (switches to primary mode)
+ *
+ * Rescheduling: always unless the request is immediately satisfied or
+ * @a timeout specifies a non-blocking operation.
+ */
+
+int rt_event_wait_count(RT_EVENT *event,
+			unsigned long mask,
+			unsigned long *mask_r,
+			unsigned long *counts, int mode, RTIME timeout)
+{
+	return rt_event_wait_inner(event, mask, mask_r, counts,
+				   mode, XN_RELATIVE, timeout);
 }
 
 /**
  * @fn int rt_event_clear(RT_EVENT *event,unsigned long mask,unsigned long *mask_r)
  * @brief Clear an event group.
  *
- * Clears a set of flags from an event mask.
+ * Clears a set of flags from an event mask. The post counts of those
+ * flags are reset as well if the group was created with EV_COUNT.
  *
  * @param event The descriptor address of the affected event.
  *
@@ -674,6 +1024,7 @@ int rt_event_wait_until(RT_EVENT *event,
 
 int rt_event_clear(RT_EVENT *event, unsigned long mask, unsigned long *mask_r)
 {
+	unsigned long value;
 	int err = 0;
 	spl_t s;
 
@@ -686,12 +1037,19 @@ int rt_event_clear(RT_EVENT *event, unsigned long mask, unsigned long *mask_r)
 		goto unlock_and_exit;
 	}
 
-	if (mask_r)
-		*mask_r = event->value;
-
 	/* Clear the flags. */
 
-	event->value &= ~mask;
+	if (event->counts) {
+		/* Reset the post counts along with the flags. */
+		value = xnarch_atomic_get(&event->state->value);
+		__event_grant(event, mask, NULL);
+	} else {
+		value = __rt_event_clear(event->state, mask);
+		__event_select_signal(event);
+	}
+
+	if (mask_r)
+		*mask_r = value;
 
       unlock_and_exit:
 
@@ -747,7 +1105,7 @@ int rt_event_inquire(RT_EVENT *event, RT_EVENT_INFO *info)
 	}
 
 	strcpy(info->name, event->name);
-	info->value = event->value;
+	info->value = xnarch_atomic_get(&event->state->value);
 	info->nwaiters = xnsynch_nsleepers(&event->synch_base);
 
       unlock_and_exit:
@@ -757,6 +1115,113 @@ int rt_event_inquire(RT_EVENT *event, RT_EVENT_INFO *info)
 	return err;
 }
 
+#ifdef CONFIG_XENO_OPT_SELECT
+
+/**
+ * @fn int rt_event_select_bind(RT_EVENT *event,struct xnselector *selector,unsigned type,unsigned index)
+ *
+ * @brief Bind an event group to a selector.
+ *
+ * Have the @a selector watch the event group, so that xnselect()
+ * reports bit @a index of the XNSELECT_READ set while any flag is
+ * set in the group's event mask. Since flags may be cleared from
+ * user-space without entering the kernel, readiness is only a hint:
+ * the selecting task should fetch the flags with a non-blocking
+ * rt_event_wait().
+ *
+ * @param event The descriptor address of the event group to watch.
+ *
+ * @param selector The selector to bind the event group to.
+ *
+ * @param type The event type, only XNSELECT_READ is supported.
+ *
+ * @param index The index of the event group in the selector sets.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a event is not an event group descriptor,
+ * or @a index is out of range.
+ *
+ * - -EIDRM is returned if @a event is a deleted event group
+ * descriptor.
+ *
+ * - -EBADF is returned if @a type is not XNSELECT_READ.
+ *
+ * - -ENOMEM is returned if the binding cannot be allocated.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: possible.
+ */
+
+int rt_event_select_bind(RT_EVENT *event, struct xnselector *selector,
+			 unsigned type, unsigned index)
+{
+	struct xnselect_binding *binding;
+	int err;
+	spl_t s;
+
+	if (type != XNSELECT_READ)
+		return -EBADF;
+
+	binding = xnmalloc(sizeof(*binding));
+	if (binding == NULL)
+		return -ENOMEM;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	event = xeno_h2obj_validate(event, XENO_EVENT_MAGIC, RT_EVENT);
+	if (event == NULL) {
+		err = xeno_handle_error(event, XENO_EVENT_MAGIC, RT_EVENT);
+		goto unlock_and_error;
+	}
+
+	err = xnselect_bind(&event->read_select, binding, selector, type, index,
+			    xnarch_atomic_get(&event->state->value) != 0);
+	if (err)
+		goto unlock_and_error;
+
+	/* Have user-space posters notify us from now on. */
+	xnarch_atomic_set(&event->state->nwaiters, __event_nwaiters(event));
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+
+      unlock_and_error:
+
+	xnlock_put_irqrestore(&nklock, s);
+	xnfree(binding);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(rt_event_select_bind);
+
+/*
+ * Flags may have been consumed from user-space, update the selector
+ * state before waiting on it.
+ */
+void __native_event_select_update(RT_EVENT *event)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	event = xeno_h2obj_validate(event, XENO_EVENT_MAGIC, RT_EVENT);
+	if (event)
+		__event_select_signal(event);
+
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+#endif /* CONFIG_XENO_OPT_SELECT */
+
 /**
  * @fn int rt_event_bind(RT_EVENT *event,const char *name,RTIME timeout)
  * @brief Bind to an event flag group.
@@ -833,6 +1298,25 @@ int rt_event_inquire(RT_EVENT *event, RT_EVENT_INFO *info)
  * Rescheduling: never.
  */
 
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+
+xnobjpool_t __native_event_pool;
+
+int __native_event_pkg_init(void)
+{
+	xnobjpool_init(&__native_event_pool, "native.event", sizeof(RT_EVENT),
+		       CONFIG_XENO_OPT_NATIVE_EVENT_POOLSZ);
+	return 0;
+}
+
+void __native_event_pkg_cleanup(void)
+{
+	__native_event_flush_rq(&__native_global_rholder.eventq);
+	xnobjpool_destroy(&__native_event_pool);
+}
+
+#else /* !CONFIG_XENO_OPT_PERVASIVE */
+
 int __native_event_pkg_init(void)
 {
 	return 0;
@@ -843,6 +1327,8 @@ void __native_event_pkg_cleanup(void)
 	__native_event_flush_rq(&__native_global_rholder.eventq);
 }
 
+#endif /* !CONFIG_XENO_OPT_PERVASIVE */
+
 /*@}*/
 
 EXPORT_SYMBOL_GPL(rt_event_create);
@@ -850,5 +1336,6 @@ EXPORT_SYMBOL_GPL(rt_event_delete);
 EXPORT_SYMBOL_GPL(rt_event_signal);
 EXPORT_SYMBOL_GPL(rt_event_wait);
 EXPORT_SYMBOL_GPL(rt_event_wait_until);
+EXPORT_SYMBOL_GPL(rt_event_wait_count);
 EXPORT_SYMBOL_GPL(rt_event_clear);
 EXPORT_SYMBOL_GPL(rt_event_inquire);
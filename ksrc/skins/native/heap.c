@@ -248,7 +248,46 @@ static void __heap_flush_private(xnheap_t *heap,
  *
  * - H_NONCACHED causes the heap not to be cached. This is necessary on
  * platforms such as ARM to share a heap between kernel and user-space.
- * Note that this flag is not compatible with the H_DMA flag.
+ * When combined with H_DMA, H_DMA32 or H_HUGE, only the user-space
+ * mappings of the physically contiguous block pool are made
+ * non-cached; kernel-space accesses still go through the cached
+ * linear mapping.
+ *
+ * - H_MAGAZINE causes per-CPU caches of recently freed blocks to be
+ * maintained in front of the heap, so that concurrent allocations
+ * from different CPUs seldom contend on the heap lock. This flag has
+ * no effect unless CONFIG_XENO_OPT_HEAP_MAGAZINES is enabled.
+ *
+ * - H_HUGE asks for a mappable heap to be backed by a physically
+ * contiguous memory block aligned on the huge page size (usually
+ * 2Mb), the heap size being rounded up accordingly. This lowers the
+ * TLB pressure of kernel-side accesses to large heaps, and lets the
+ * whole heap be remapped to user-space as a single contiguous
+ * range. The regular allocation is silently used instead if no such
+ * block is available. This flag is only meaningful along with
+ * H_MAPPABLE.
+ *
+ * - H_TLSF causes the heap to be managed by the TLSF allocator, which
+ * serves requests of any size in bounded time with low
+ * fragmentation, at the expense of a 16-byte header per block. This
+ * flag has no effect unless CONFIG_XENO_OPT_HEAP_TLSF is enabled.
+ *
+ * - H_PREFAULT causes the user-space mappings of the heap to be
+ * written to and locked as soon as they are established by
+ * rt_heap_create() or rt_heap_bind(), so that real-time threads do
+ * not take any page fault when touching the heap memory for the
+ * first time. This flag is only meaningful along with H_MAPPABLE.
+ *
+ * - H_UCACHE causes user-space callers of rt_heap_alloc() and
+ * rt_heap_free() to serve requests of up to 1024 bytes from
+ * per-thread caches of blocks, which are refilled from the heap and
+ * drained back to it in batches, a single system call moving up to
+ * 16 blocks at once. Blocks held in the caches are accounted for as
+ * used memory, and released blocks may not be available to other
+ * tasks until the next batch is exchanged; likewise, an invalid
+ * block address passed to rt_heap_free() is reported by the call
+ * exchanging the batch. This flag is only meaningful along with
+ * H_MAPPABLE, without H_SINGLE.
  *
  * @return 0 is returned upon success. Otherwise:
  *
@@ -295,6 +334,10 @@ int rt_heap_create(RT_HEAP *heap, const char *name, size_t heapsize, int mode)
 
 	heap->csize = heapsize;	/* Record this for SBA management and inquiry. */
 
+	/* Do not take the TLSF control block from the caller's share. */
+	if (mode & H_TLSF)
+		heapsize += XNHEAP_TLSF_OVERHEAD;
+
 #ifdef __KERNEL__
 	if (mode & H_MAPPABLE) {
 		if (!name || !*name)
@@ -308,7 +351,13 @@ int rt_heap_create(RT_HEAP *heap, const char *name, size_t heapsize, int mode)
 					 ((mode & H_DMA) ? GFP_DMA : 0)
 					 | ((mode & H_DMA32) ? GFP_DMA32 : 0)
 					 | ((mode & H_NONCACHED) ?
-					    XNHEAP_GFP_NONCACHED : 0));
+					    XNHEAP_GFP_NONCACHED : 0)
+					 | ((mode & H_MAGAZINE) ?
+					    XNHEAP_GFP_MAGAZINE : 0)
+					 | ((mode & H_HUGE) ?
+					    XNHEAP_GFP_HUGE : 0)
+					 | ((mode & H_TLSF) ?
+					    XNHEAP_GFP_TLSF : 0));
 		if (err)
 			return err;
 
@@ -328,7 +377,9 @@ int rt_heap_create(RT_HEAP *heap, const char *name, size_t heapsize, int mode)
 		if (!heapmem)
 			return -ENOMEM;
 
-		err = xnheap_init(&heap->heap_base, heapmem, heapsize, XNHEAP_PAGE_SIZE);
+		err = xnheap_init(&heap->heap_base, heapmem, heapsize, XNHEAP_PAGE_SIZE,
+				  ((mode & H_MAGAZINE) ? XNHEAP_MAGAZINE : 0) |
+				  ((mode & H_TLSF) ? XNHEAP_TLSF : 0));
 		if (err) {
 			xnarch_free_host_mem(heapmem, heapsize);
 			return err;
@@ -793,6 +844,60 @@ int rt_heap_inquire(RT_HEAP *heap, RT_HEAP_INFO *info)
 	return err;
 }
 
+/**
+ * @fn int rt_heap_inquire_ext(RT_HEAP *heap, RT_HEAP_XINFO *xinfo)
+ *
+ * @brief Inquire about a heap, with usage statistics.
+ *
+ * Return the same information as rt_heap_inquire(), plus usage and
+ * fragmentation statistics of the underlying memory pool: cumulative
+ * allocation and release counts, the worst time spent allocating a
+ * block, the largest free contiguous chunk, a histogram of free
+ * chunks by size class, and the page states of the default
+ * allocator. See xnheap_get_xstats() for details.
+ *
+ * @param heap The descriptor address of the inquired heap.
+ *
+ * @param xinfo The address of a structure the heap information will
+ * be written to.
+
+ * @return 0 is returned and status information is written to the
+ * structure pointed at by @a xinfo upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a heap is not a heap descriptor.
+ *
+ * - -EIDRM is returned if @a heap is a deleted heap descriptor.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ *
+ * @note The cost of this service grows with the heap size, since the
+ * free memory is scanned to build the statistics.
+ */
+
+int rt_heap_inquire_ext(RT_HEAP *heap, RT_HEAP_XINFO *xinfo)
+{
+	int err;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	err = rt_heap_inquire(heap, &xinfo->info);
+	if (err == 0)
+		xnheap_get_xstats(&heap->heap_base, &xinfo->stats);
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
 /**
  * @fn int rt_heap_bind(RT_HEAP *heap,const char *name,RTIME timeout)
  *
@@ -892,3 +997,4 @@ EXPORT_SYMBOL_GPL(rt_heap_delete);
 EXPORT_SYMBOL_GPL(rt_heap_alloc);
 EXPORT_SYMBOL_GPL(rt_heap_free);
 EXPORT_SYMBOL_GPL(rt_heap_inquire);
+EXPORT_SYMBOL_GPL(rt_heap_inquire_ext);
@@ -81,7 +81,8 @@ static int vfile_rewind(struct xnvfile_snapshot_iterator *it)
 	priv->curr = getheadpq(xnsynch_wait_queue(&intr->synch_base));
 	priv->mode = intr->mode;
 	priv->hits = __intr_get_hits(intr);
-	priv->pending = intr->pending;
+	priv->pending = intr->window ?
+		xnarch_atomic_get(&intr->window->pending) : 0;
 
 	return xnsynch_nsleepers(&intr->synch_base);
 }
@@ -296,7 +297,8 @@ int rt_intr_create(RT_INTR *intr,
 	xnintr_init(&intr->intr_base, intr->name, irq, isr, iack, mode);
 #ifdef CONFIG_XENO_OPT_PERVASIVE
 	xnsynch_init(&intr->synch_base, XNSYNCH_PRIO, NULL);
-	intr->pending = 0;
+	intr->window = NULL;
+	intr->wheap = NULL;
 	intr->cpid = 0;
 	intr->mode = 0;
 #endif /* CONFIG_XENO_OPT_PERVASIVE */
@@ -393,6 +395,12 @@ int rt_intr_delete(RT_INTR *intr)
 
 	err = xnintr_destroy(&intr->intr_base);
 
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+	/* The handler may not run anymore, drop the shared state. */
+	if (intr->window)
+		xnheap_free(intr->wheap, intr->window);
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+
 	if (rc == XNSYNCH_RESCHED)
 		/* Some task has been woken up as a result of the deletion:
 		   reschedule now. */
@@ -688,6 +696,47 @@ int rt_intr_inquire(RT_INTR *intr, RT_INTR_INFO *info)
  * CONFIG_XENO_OPT_NATIVE_PERIOD), or nanoseconds otherwise.
  */
 
+/**
+ * @fn int rt_intr_poll(RT_INTR *intr)
+ * @brief Collect pending interrupts without blocking.
+ *
+ * This user-space only call grabs the count of interrupts received
+ * since the last call to rt_intr_wait() or rt_intr_poll() for the
+ * same object. The count is read from a memory area shared with the
+ * kernel, and updated by the interrupt handler, so that no syscall is
+ * issued. A task which would rather spin than sleep may call this
+ * service in a loop. The same area also holds the total hit count, the
+ * date of the last hit and the CPU which took it (see RT_INTR_WINDOW),
+ * which may be read from the window field of @a intr.
+ *
+ * @param intr The descriptor address of the interrupt object.
+ *
+ * @return A positive value is returned upon success, representing the
+ * number of pending interrupts to process. Otherwise:
+ *
+ * - -EWOULDBLOCK is returned if no interrupt is pending.
+ *
+ * - -EPERM is returned if @a intr was created from kernel space.
+ *
+ * - -ENOSYS is returned if the architecture does not support atomic
+ * operations from user-space (i.e. CONFIG_XENO_FASTSYNCH is not
+ * available).
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - User-space task
+ *
+ * Rescheduling: never.
+ *
+ * @note rt_intr_wait() also collects the pending interrupts locally
+ * when some are pending on entry, without issuing any syscall. As a
+ * consequence, a task waiting for interrupts may be woken up with a
+ * zero count, when some other task has collected them in the
+ * meantime.
+ */
+
 /**
  * @fn int rt_intr_bind(RT_INTR *intr,const char *name,RTIME timeout)
  * @brief Bind to an interrupt object.
@@ -36,8 +36,10 @@
 #include <native/cond.h>
 #include <native/pipe.h>
 #include <native/queue.h>
+#include <native/ring.h>
 #include <native/heap.h>
 #include <native/alarm.h>
+#include <native/cyclic.h>
 #include <native/intr.h>
 #include <native/misc.h>
 #include <native/syscall.h>
@@ -61,6 +63,7 @@ int SKIN_INIT(native)
 	int err;
 
 	initq(&__native_global_rholder.alarmq);
+	initq(&__native_global_rholder.alarm_groupq);
 	initq(&__native_global_rholder.condq);
 	initq(&__native_global_rholder.eventq);
 	initq(&__native_global_rholder.heapq);
@@ -71,6 +74,8 @@ int SKIN_INIT(native)
 	initq(&__native_global_rholder.semq);
 	initq(&__native_global_rholder.ioregionq);
 	initq(&__native_global_rholder.bufferq);
+	initq(&__native_global_rholder.ringq);
+	initq(&__native_global_rholder.cyclicq);
 
 	err = xnpod_init();
 
@@ -124,21 +129,31 @@ int SKIN_INIT(native)
 	if (err)
 		goto cleanup_pipe;
 
-	err = __native_heap_pkg_init();
+	err = __native_ring_pkg_init();
 
 	if (err)
 		goto cleanup_queue;
 
+	err = __native_heap_pkg_init();
+
+	if (err)
+		goto cleanup_ring;
+
 	err = __native_alarm_pkg_init();
 
 	if (err)
 		goto cleanup_heap;
 
-	err = __native_intr_pkg_init();
+	err = __native_cyclic_pkg_init();
 
 	if (err)
 		goto cleanup_alarm;
 
+	err = __native_intr_pkg_init();
+
+	if (err)
+		goto cleanup_cyclic;
+
 	err = __native_syscall_init();
 
 	if (err)
@@ -152,6 +167,10 @@ int SKIN_INIT(native)
 
 	__native_intr_pkg_cleanup();
 
+      cleanup_cyclic:
+
+	__native_cyclic_pkg_cleanup();
+
       cleanup_alarm:
 
 	__native_alarm_pkg_cleanup();
@@ -160,6 +179,10 @@ int SKIN_INIT(native)
 
 	__native_heap_pkg_cleanup();
 
+      cleanup_ring:
+
+	__native_ring_pkg_cleanup();
+
       cleanup_queue:
 
 	__native_queue_pkg_cleanup();
@@ -210,8 +233,10 @@ void SKIN_EXIT(native)
 	xnprintf("stopping native API services.\n");
 
 	__native_intr_pkg_cleanup();
+	__native_cyclic_pkg_cleanup();
 	__native_alarm_pkg_cleanup();
 	__native_heap_pkg_cleanup();
+	__native_ring_pkg_cleanup();
 	__native_queue_pkg_cleanup();
 	__native_pipe_pkg_cleanup();
 	__native_cond_pkg_cleanup();
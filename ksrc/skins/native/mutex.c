@@ -171,9 +171,10 @@ static struct xnpnode_snapshot __mutex_pnode = {
 
 #endif /* !CONFIG_XENO_OPT_VFILE */
 
-int rt_mutex_create_inner(RT_MUTEX *mutex, const char *name, int global)
+int rt_mutex_create_inner(RT_MUTEX *mutex, const char *name, int global,
+			  int ceiling)
 {
-	xnflags_t flags = XNSYNCH_PRIO | XNSYNCH_PIP | XNSYNCH_OWNER;
+	xnflags_t flags = XNSYNCH_PRIO | XNSYNCH_OWNER;
 	xnarch_atomic_t *fastlock = NULL;
 	int err = 0;
 	spl_t s;
@@ -181,19 +182,34 @@ int rt_mutex_create_inner(RT_MUTEX *mutex, const char *name, int global)
 	if (xnpod_asynch_p())
 		return -EPERM;
 
+	/* A negative ceiling selects priority inheritance. */
+	flags |= ceiling < 0 ? XNSYNCH_PIP : XNSYNCH_PP;
+
 #ifdef CONFIG_XENO_FASTSYNCH
-	/* Allocate lock memory for in-kernel use */
+	/*
+	 * Allocate lock memory for in-kernel use. The second word
+	 * holds the ceiling handle user-space looks for, which
+	 * xnsynch_init() only fills in for ceiling mutexes.
+	 */
 	fastlock = xnheap_alloc(&xnsys_ppd_get(global)->sem_heap,
-				sizeof(*fastlock));
+				xnheap_synch_size(XNSYNCH_FASTPP_SIZE, 0));
 
 	if (!fastlock)
 		return -ENOMEM;
 
+	xnarch_atomic_set(fastlock + 1, XN_NO_HANDLE);
+
 	if (global)
 		flags |= RT_MUTEX_EXPORTED;
 #endif /* CONFIG_XENO_FASTSYNCH */
 
+#ifdef CONFIG_XENO_OPT_NATIVE_MUTEX_SPIN
+	flags |= XNSYNCH_SPIN;
+#endif /* CONFIG_XENO_OPT_NATIVE_MUTEX_SPIN */
+
 	xnsynch_init(&mutex->synch_base, flags, fastlock);
+	if (ceiling >= 0)
+		xnsynch_set_ceiling(&mutex->synch_base, ceiling);
 	mutex->handle = 0;	/* i.e. (still) unregistered mutex. */
 	mutex->magic = XENO_MUTEX_MAGIC;
 	mutex->lockcnt = 0;
@@ -268,7 +284,71 @@ int rt_mutex_create_inner(RT_MUTEX *mutex, const char *name, int global)
 
 int rt_mutex_create(RT_MUTEX *mutex, const char *name)
 {
-	return rt_mutex_create_inner(mutex, name, 1);
+	return rt_mutex_create_inner(mutex, name, 1, -1);
+}
+
+/**
+ * @fn int rt_mutex_create_ceiling(RT_MUTEX *mutex,const char *name,int ceiling)
+ *
+ * @brief Create a priority ceiling mutex.
+ *
+ * Create a mutex like rt_mutex_create() does, except that the
+ * priority protection protocol is used instead of priority
+ * inheritance: any task which owns the mutex runs at least at the
+ * given @a ceiling priority, until it releases it.
+ *
+ * With CONFIG_XENO_FASTSYNCH, the uncontended acquisition and release
+ * from user-space remain free of system calls, the nucleus applying
+ * the ceiling lazily the next time the owner is about to be
+ * preempted. Only the outermost ceiling mutex held by a task benefits
+ * from this; nested ones are grabbed and released through the
+ * nucleus.
+ *
+ * @param mutex The address of a mutex descriptor Xenomai will use to
+ * store the mutex-related data.  This descriptor must always be valid
+ * while the mutex is active therefore it must be allocated in
+ * permanent memory.
+ *
+ * @param name An ASCII string standing for the symbolic name of the
+ * mutex. When non-NULL and non-empty, this string is copied to a safe
+ * place into the descriptor, and passed to the registry package if
+ * enabled for indexing the created mutex.
+ *
+ * @param ceiling The priority ceiling of the mutex, which must be in
+ * the [T_LOPRIO .. T_HIPRIO] range. It should be the highest base
+ * priority of the tasks which may ever lock it.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a ceiling is out of range.
+ *
+ * - -ENOMEM is returned if the system fails to get enough dynamic
+ * memory from the global real-time heap in order to register the
+ * mutex.
+ *
+ * - -EEXIST is returned if the @a name is already in use by some
+ * registered object.
+ *
+ * - -EPERM is returned if this service was called from an
+ * asynchronous context.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: possible.
+ */
+
+int rt_mutex_create_ceiling(RT_MUTEX *mutex, const char *name, int ceiling)
+{
+	if (ceiling < T_LOPRIO || ceiling > T_HIPRIO)
+		return -EINVAL;
+
+	return rt_mutex_create_inner(mutex, name, 1, ceiling);
 }
 
 /**
@@ -370,12 +450,18 @@ int rt_mutex_acquire_inner(RT_MUTEX *mutex, RTIME timeout,
 		return 0;
 	}
 
+	/* The ceiling may not be lower than the caller's priority. */
+	if (xnsynch_test_flags(&mutex->synch_base, XNSYNCH_PP) &&
+	    mutex->synch_base.ceiling < xnthread_base_priority(thread))
+		return -EINVAL;
+
 	if (timeout == TM_NONBLOCK && timeout_mode == XN_RELATIVE) {
 #ifdef CONFIG_XENO_FASTSYNCH
 		if (xnsynch_fast_acquire(mutex->synch_base.fastlock,
 					 xnthread_handle(thread)) == 0) {
 			if (xnthread_test_state(thread, XNOTHER))
 				xnthread_inc_rescnt(thread);
+			xnsynch_protect_owner(&mutex->synch_base);
 			mutex->lockcnt = 1;
 			return 0;
 		} else
@@ -441,7 +527,9 @@ int rt_mutex_acquire_inner(RT_MUTEX *mutex, RTIME timeout,
  *
  * @return 0 is returned upon success. Otherwise:
  *
- * - -EINVAL is returned if @a mutex is not a mutex descriptor.
+ * - -EINVAL is returned if @a mutex is not a mutex descriptor, or
+ * if it is a priority ceiling mutex whose ceiling is lower than the
+ * base priority of the calling task.
  *
  * - -EIDRM is returned if @a mutex is a deleted mutex descriptor,
  * including if the deletion occurred while the caller was sleeping on
@@ -507,7 +595,9 @@ int rt_mutex_acquire(RT_MUTEX *mutex, RTIME timeout)
  *
  * @return 0 is returned upon success. Otherwise:
  *
- * - -EINVAL is returned if @a mutex is not a mutex descriptor.
+ * - -EINVAL is returned if @a mutex is not a mutex descriptor, or
+ * if it is a priority ceiling mutex whose ceiling is lower than the
+ * base priority of the calling task.
  *
  * - -EIDRM is returned if @a mutex is a deleted mutex descriptor,
  * including if the deletion occurred while the caller was sleeping on
@@ -600,8 +690,9 @@ int rt_mutex_release(RT_MUTEX *mutex)
 	if (--mutex->lockcnt > 0)
 		return 0;
 
-	if (xnsynch_release(&mutex->synch_base))
-		xnpod_schedule();
+	/* Dropping a priority ceiling may require rescheduling too. */
+	xnsynch_release(&mutex->synch_base);
+	xnpod_schedule();
 
 	return 0;
 }
@@ -755,19 +846,41 @@ int rt_mutex_inquire(RT_MUTEX *mutex, RT_MUTEX_INFO *info)
  * Rescheduling: never.
  */
 
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+
+xnobjpool_t __native_mutex_pool;
+
 int __native_mutex_pkg_init(void)
 {
+	xnobjpool_init(&__native_mutex_pool, "native.mutex", sizeof(RT_MUTEX),
+		       CONFIG_XENO_OPT_NATIVE_MUTEX_POOLSZ);
 	return 0;
 }
 
 void __native_mutex_pkg_cleanup(void)
 {
 	__native_mutex_flush_rq(&__native_global_rholder.mutexq);
+	xnobjpool_destroy(&__native_mutex_pool);
 }
 
+#else /* !CONFIG_XENO_OPT_PERVASIVE */
+
+int __native_mutex_pkg_init(void)
+{
+	return 0;
+}
+
+void __native_mutex_pkg_cleanup(void)
+{
+	__native_mutex_flush_rq(&__native_global_rholder.mutexq);
+}
+
+#endif /* !CONFIG_XENO_OPT_PERVASIVE */
+
 /*@}*/
 
 EXPORT_SYMBOL_GPL(rt_mutex_create);
+EXPORT_SYMBOL_GPL(rt_mutex_create_ceiling);
 EXPORT_SYMBOL_GPL(rt_mutex_delete);
 EXPORT_SYMBOL_GPL(rt_mutex_acquire);
 EXPORT_SYMBOL_GPL(rt_mutex_acquire_until);
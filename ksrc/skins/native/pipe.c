@@ -51,6 +51,7 @@
 #include <nucleus/heap.h>
 #include <nucleus/registry.h>
 #include <native/pipe.h>
+#include <native/timer.h>
 
 #ifdef CONFIG_XENO_OPT_VFILE
 
@@ -125,6 +126,7 @@ static void __pipe_free_handler(void *buf, void *xstate) /* nklock free */
 		xnpipe_m_size(pipe->buffer) = 0;
 		__clear_bit(P_SYNCWAIT, &pipe->status);
 		__clear_bit(P_ATOMIC, &pipe->status);
+		__clear_bit(P_PUSHREQ, &pipe->status);
 		xnlock_put_irqrestore(&nklock, s);
 	} else
 		xnheap_free(pipe->bufpool, buf);
@@ -169,6 +171,46 @@ static void __pipe_release_handler(void *xstate) /* nklock free */
 #endif
 }
 
+#if CONFIG_XENO_OPT_NATIVE_PIPE_BUFSZ > 0
+
+/*
+ * Queue the streaming buffer to the Linux side, unless it is there
+ * already, in which case rt_pipe_stream() extends it in place until
+ * it is consumed. Called with nklock held.
+ */
+static ssize_t __pipe_stream_push(RT_PIPE *pipe)
+{
+	ssize_t ret;
+
+	xntimer_stop(&pipe->flush_timer);
+	__clear_bit(P_PUSHREQ, &pipe->status);
+
+	if (pipe->fillsz == 0 || test_bit(P_SYNCWAIT, &pipe->status))
+		return 0;
+
+	ret = xnpipe_send(pipe->minor, pipe->buffer,
+			  pipe->fillsz + sizeof(RT_PIPE_MSG), XNPIPE_NORMAL);
+	if (ret < 0)
+		return ret;
+
+	__set_bit(P_SYNCWAIT, &pipe->status);
+
+	return 0;
+}
+
+static void __pipe_flush_timeout(xntimer_t *timer) /* nklock held */
+{
+	RT_PIPE *pipe = container_of(timer, RT_PIPE, flush_timer);
+
+	if (test_bit(P_ATOMIC, &pipe->status))
+		/* A writer is filling the buffer, let it push. */
+		__set_bit(P_PUSHREQ, &pipe->status);
+	else
+		__pipe_stream_push(pipe);
+}
+
+#endif /* CONFIG_XENO_OPT_NATIVE_PIPE_BUFSZ > 0 */
+
 int __native_pipe_pkg_init(void)
 {
 	return 0;
@@ -284,6 +326,8 @@ int rt_pipe_create(RT_PIPE *pipe, const char *name, int minor, size_t poolsize)
 	pipe->buffer = NULL;
 	pipe->bufpool = &kheap;
 	pipe->fillsz = 0;
+	pipe->fillthr = 0;
+	pipe->flushdly = TM_INFINITE;
 	pipe->monitor = NULL;
 	pipe->status = 0;
 	pipe->handle = 0;	/* i.e. (still) unregistered pipe. */
@@ -307,7 +351,7 @@ int rt_pipe_create(RT_PIPE *pipe, const char *name, int minor, size_t poolsize)
 			return -ENOMEM;
 
 		/* Use natural page size */
-		err = xnheap_init(&pipe->privpool, poolmem, poolsize, XNHEAP_PAGE_SIZE);
+		err = xnheap_init(&pipe->privpool, poolmem, poolsize, XNHEAP_PAGE_SIZE, 0);
 		if (err) {
 			xnarch_free_host_mem(poolmem, poolsize);
 			return err;
@@ -328,6 +372,7 @@ int rt_pipe_create(RT_PIPE *pipe, const char *name, int minor, size_t poolsize)
 	}
 	inith(xnpipe_m_link(pipe->buffer));
 	xnpipe_m_size(pipe->buffer) = streamsz - sizeof(RT_PIPE_MSG);
+	xntimer_init(&pipe->flush_timer, __native_tbase, __pipe_flush_timeout);
 #endif /* CONFIG_XENO_OPT_NATIVE_PIPE_BUFSZ > 0 */
 
 
@@ -423,6 +468,9 @@ int rt_pipe_delete(RT_PIPE *pipe)
 
 	removeq(pipe->rqueue, &pipe->rlink);
 	pipe->monitor = NULL;	/* Stop monitoring. */
+#if CONFIG_XENO_OPT_NATIVE_PIPE_BUFSZ > 0
+	xntimer_destroy(&pipe->flush_timer);
+#endif /* CONFIG_XENO_OPT_NATIVE_PIPE_BUFSZ > 0 */
 
 	if (pipe->handle)
 		xnregistry_remove(pipe->handle);
@@ -857,14 +905,22 @@ ssize_t rt_pipe_write(RT_PIPE *pipe, const void *buf, size_t size, int mode)
  * Data buffers sent by the rt_pipe_stream() service are always
  * transmitted in FIFO order (i.e. P_NORMAL mode).
  *
+ * By default, the internal buffer is handed over to the receiver
+ * upon the first write, and subsequent writes extend it in place
+ * until it is consumed. If batching has been enabled by
+ * rt_pipe_batch(), the data is held back until the batching
+ * threshold is reached, the batching delay elapses, or
+ * rt_pipe_stream() is called with a zero @a size, so that the
+ * receiver wakes up once for a whole batch of small writes.
+ *
  * @param pipe The descriptor address of the pipe to write to.
  *
  * @param buf The address of the first data byte to send. The
  * data will be copied to an internal buffer before transmission.
  *
  * @param size The size in bytes of the buffer. Zero is a valid value,
- * in which case the service returns immediately without buffering any
- * data.
+ * in which case any data held back by the batching mode is handed
+ * over to the receiver immediately, and zero is returned.
  *
  * @return The number of bytes sent upon success; this value may be
  * lower than @a size, depending on the available space in the
@@ -899,7 +955,7 @@ ssize_t rt_pipe_write(RT_PIPE *pipe, const void *buf, size_t size, int mode)
 
 ssize_t rt_pipe_stream(RT_PIPE *pipe, const void *buf, size_t size)
 {
-	ssize_t outbytes;
+	ssize_t outbytes = 0, err;
  	size_t fillptr;
 	spl_t s;
 
@@ -916,6 +972,15 @@ ssize_t rt_pipe_stream(RT_PIPE *pipe, const void *buf, size_t size)
 		goto unlock_and_exit;
 	}
 
+	if (size == 0) {
+		/* Explicit flush of the batched data. */
+		if (test_bit(P_ATOMIC, &pipe->status))
+			__set_bit(P_PUSHREQ, &pipe->status);
+		else
+			outbytes = __pipe_stream_push(pipe);
+		goto unlock_and_exit;
+	}
+
 	if (size > CONFIG_XENO_OPT_NATIVE_PIPE_BUFSZ
 	    - sizeof(RT_PIPE_MSG) - pipe->fillsz)
 		outbytes = CONFIG_XENO_OPT_NATIVE_PIPE_BUFSZ
@@ -942,13 +1007,19 @@ repeat:
 		if (!__test_and_clear_bit(P_ATOMIC, &pipe->status))
 			goto repeat;
 
-		if (__test_and_set_bit(P_SYNCWAIT, &pipe->status))
+		if (test_bit(P_SYNCWAIT, &pipe->status))
 			outbytes = xnpipe_mfixup(pipe->minor, pipe->buffer, outbytes);
-		else {
-			outbytes = xnpipe_send(pipe->minor, pipe->buffer,
-					       outbytes + sizeof(RT_PIPE_MSG), XNPIPE_NORMAL);
-			if (outbytes > 0)
-				outbytes -= sizeof(RT_PIPE_MSG);
+		else if (pipe->fillsz < pipe->fillthr &&
+			 !__test_and_clear_bit(P_PUSHREQ, &pipe->status)) {
+			/* Batching: hold the data back for now. */
+			if (pipe->flushdly != TM_INFINITE &&
+			    !xntimer_running_p(&pipe->flush_timer))
+				xntimer_start(&pipe->flush_timer, pipe->flushdly,
+					      XN_INFINITE, XN_RELATIVE);
+		} else {
+			err = __pipe_stream_push(pipe);
+			if (err)
+				outbytes = err;
 		}
 	}
 
@@ -960,6 +1031,100 @@ repeat:
 #endif /* CONFIG_XENO_OPT_NATIVE_PIPE_BUFSZ <= 0 */
 }
 
+/**
+ * @fn int rt_pipe_batch(RT_PIPE *pipe,size_t threshold,RTIME delay)
+ *
+ * @brief Set the batching mode of the byte stream.
+ *
+ * This service controls how data written by rt_pipe_stream() is
+ * handed over to the receiver. With batching enabled, small writes
+ * are accumulated into the internal streaming buffer, which is only
+ * queued to the special device once @a threshold bytes have been
+ * gathered, @a delay has elapsed since the first byte held back, or
+ * an explicit flush is requested by calling rt_pipe_stream() with a
+ * zero size. This way, the Linux reader is woken up once per batch
+ * instead of once per write, and gets the whole batch in a single
+ * read(2) operation.
+ *
+ * Once the buffer has been queued, further writes still extend it in
+ * place until the receiver consumes it, as in the default mode.
+ *
+ * @param pipe The descriptor address of the affected pipe.
+ *
+ * @param threshold The number of bytes to gather before handing the
+ * buffer over. Zero disables batching, which is the default
+ * setting. Values larger than the buffer space (see
+ * CONFIG_XENO_OPT_NATIVE_PIPE_BUFSZ) are trimmed down to it.
+ *
+ * @param delay The maximum number of clock ticks data may be held
+ * back, or TM_INFINITE to flush only upon threshold or explicit
+ * request.
+ *
+ * @return Zero is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a pipe is not a pipe descriptor.
+ *
+ * - -EIDRM is returned if @a pipe is a closed pipe descriptor.
+ *
+ * - -ENODEV or -EBADF are returned if @a pipe is scrambled.
+ *
+ * - -ENOSYS is returned if the byte streaming mode has been disabled
+ * at configuration time by nullifying the size of the pipe buffer
+ * (see CONFIG_XENO_OPT_NATIVE_PIPE_BUFSZ).
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ *
+ * @note The @a delay value will be interpreted as jiffies if the
+ * native skin is bound to a periodic time base (see
+ * CONFIG_XENO_OPT_NATIVE_PERIOD), or nanoseconds otherwise.
+ */
+
+int rt_pipe_batch(RT_PIPE *pipe, size_t threshold, RTIME delay)
+{
+#if CONFIG_XENO_OPT_NATIVE_PIPE_BUFSZ <= 0
+	return -ENOSYS;
+#else /* CONFIG_XENO_OPT_NATIVE_PIPE_BUFSZ > 0 */
+	int err = 0;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	pipe = xeno_h2obj_validate(pipe, XENO_PIPE_MAGIC, RT_PIPE);
+
+	if (!pipe) {
+		err = xeno_handle_error(pipe, XENO_PIPE_MAGIC, RT_PIPE);
+		goto unlock_and_exit;
+	}
+
+	if (threshold > CONFIG_XENO_OPT_NATIVE_PIPE_BUFSZ - sizeof(RT_PIPE_MSG))
+		threshold = CONFIG_XENO_OPT_NATIVE_PIPE_BUFSZ - sizeof(RT_PIPE_MSG);
+
+	pipe->fillthr = threshold;
+	pipe->flushdly = delay;
+
+	/* Hand over what was batched under the former settings. */
+	if (test_bit(P_ATOMIC, &pipe->status))
+		__set_bit(P_PUSHREQ, &pipe->status);
+	else
+		__pipe_stream_push(pipe);
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+#endif /* CONFIG_XENO_OPT_NATIVE_PIPE_BUFSZ <= 0 */
+}
+
 /**
  * @fn RT_PIPE_MSG *rt_pipe_alloc(RT_PIPE *pipe,size_t size)
  *
@@ -1102,6 +1267,74 @@ int rt_pipe_flush(RT_PIPE *pipe, int mode)
 	return xnpipe_flush(minor, mode);
 }
 
+#ifdef CONFIG_XENO_OPT_SELECT
+
+/**
+ * @fn int rt_pipe_select_bind(RT_PIPE *pipe,struct xnselector *selector,unsigned type,unsigned index)
+ *
+ * @brief Bind a message pipe to a selector.
+ *
+ * Have the @a selector watch the pipe, so that xnselect() reports
+ * bit @a index of the XNSELECT_READ set while messages written from
+ * user-space are pending, i.e. while rt_pipe_receive() would not
+ * block.
+ *
+ * @param pipe The descriptor address of the pipe to watch.
+ *
+ * @param selector The selector to bind the pipe to.
+ *
+ * @param type The event type, only XNSELECT_READ is supported.
+ *
+ * @param index The index of the pipe in the selector sets.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a pipe is not a pipe descriptor, or @a
+ * index is out of range.
+ *
+ * - -EIDRM is returned if @a pipe is a closed pipe descriptor.
+ *
+ * - -EBADF is returned if @a type is not XNSELECT_READ.
+ *
+ * - -ENOMEM is returned if the binding cannot be allocated.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: possible.
+ */
+
+int rt_pipe_select_bind(RT_PIPE *pipe, struct xnselector *selector,
+			unsigned type, unsigned index)
+{
+	int minor;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	pipe = xeno_h2obj_validate(pipe, XENO_PIPE_MAGIC, RT_PIPE);
+
+	if (!pipe) {
+		int err = xeno_handle_error(pipe, XENO_PIPE_MAGIC, RT_PIPE);
+		xnlock_put_irqrestore(&nklock, s);
+		return err;
+	}
+
+	minor = pipe->minor;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return xnpipe_select_bind(minor, selector, type, index);
+}
+EXPORT_SYMBOL_GPL(rt_pipe_select_bind);
+
+#endif /* CONFIG_XENO_OPT_SELECT */
+
 /**
  * @fn int rt_pipe_monitor(RT_PIPE *pipe, int (*fn)(RT_PIPE *pipe, int event, long arg))
  *
@@ -1194,6 +1427,7 @@ EXPORT_SYMBOL_GPL(rt_pipe_send);
 EXPORT_SYMBOL_GPL(rt_pipe_read);
 EXPORT_SYMBOL_GPL(rt_pipe_write);
 EXPORT_SYMBOL_GPL(rt_pipe_stream);
+EXPORT_SYMBOL_GPL(rt_pipe_batch);
 EXPORT_SYMBOL_GPL(rt_pipe_alloc);
 EXPORT_SYMBOL_GPL(rt_pipe_free);
 EXPORT_SYMBOL_GPL(rt_pipe_flush);
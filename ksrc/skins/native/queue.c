@@ -217,6 +217,24 @@ static void __queue_flush_private(xnheap_t *heap,
  * operations with I/O devices. A 128Kb limit exists for @a poolsize
  * when this flag is passed.
  *
+ * - Q_MAGAZINE causes per-CPU caches of recently freed message
+ * buffers to be maintained in front of the buffer pool, so that
+ * concurrent rt_queue_alloc() calls from different CPUs seldom
+ * contend on the pool lock. This flag has no effect unless
+ * CONFIG_XENO_OPT_HEAP_MAGAZINES is enabled.
+ *
+ * - Q_HUGE asks for the buffer pool of a shared queue to be backed by
+ * a physically contiguous memory block aligned on the huge page size
+ * (usually 2Mb), the pool size being rounded up accordingly. The
+ * regular allocation is silently used instead if no such block is
+ * available. This flag is only meaningful along with Q_SHARED.
+ *
+ * - Q_TLSF causes the buffer pool to be managed by the TLSF
+ * allocator, which serves message buffers of any size in bounded
+ * time with low fragmentation, at the expense of a 16-byte header
+ * per buffer. This flag has no effect unless CONFIG_XENO_OPT_HEAP_TLSF
+ * is enabled.
+ *
  * @return 0 is returned upon success. Otherwise:
  *
  * - -EEXIST is returned if the @a name is already in use by some
@@ -260,6 +278,10 @@ int rt_queue_create(RT_QUEUE *q,
 	if (poolsize == 0)
 		return -EINVAL;
 
+	/* Do not take the TLSF control block from the caller's share. */
+	if (mode & Q_TLSF)
+		poolsize += XNHEAP_TLSF_OVERHEAD;
+
 #ifdef __KERNEL__
 	if (mode & Q_SHARED) {
 		if (!name || !*name)
@@ -271,7 +293,13 @@ int rt_queue_create(RT_QUEUE *q,
 		err = xnheap_init_mapped(&q->bufpool,
 					 poolsize,
 					 ((mode & Q_DMA) ? GFP_DMA
-					  : XNARCH_SHARED_HEAP_FLAGS));
+					  : XNARCH_SHARED_HEAP_FLAGS)
+					 | ((mode & Q_MAGAZINE) ?
+					    XNHEAP_GFP_MAGAZINE : 0)
+					 | ((mode & Q_HUGE) ?
+					    XNHEAP_GFP_HUGE : 0)
+					 | ((mode & Q_TLSF) ?
+					    XNHEAP_GFP_TLSF : 0));
 		if (err)
 			return err;
 
@@ -291,7 +319,9 @@ int rt_queue_create(RT_QUEUE *q,
 		if (!poolmem)
 			return -ENOMEM;
 
-		err = xnheap_init(&q->bufpool, poolmem, poolsize, XNHEAP_PAGE_SIZE);
+		err = xnheap_init(&q->bufpool, poolmem, poolsize, XNHEAP_PAGE_SIZE,
+				  ((mode & Q_MAGAZINE) ? XNHEAP_MAGAZINE : 0) |
+				  ((mode & Q_TLSF) ? XNHEAP_TLSF : 0));
 		if (err) {
 			xnarch_free_host_mem(poolmem, poolsize);
 			return err;
@@ -301,6 +331,7 @@ int rt_queue_create(RT_QUEUE *q,
 
 	xnsynch_init(&q->synch_base, mode & (Q_PRIO | Q_FIFO), NULL);
 	initq(&q->pendq);
+	xnselect_init(&q->read_select);
 	q->handle = 0;		/* i.e. (still) unregistered queue. */
 	q->magic = XENO_QUEUE_MAGIC;
 	q->qlimit = qlimit;
@@ -409,6 +440,8 @@ int rt_queue_delete_inner(RT_QUEUE *q, void __user *mapaddr)
 
 	xnlock_put_irqrestore(&nklock, s);
 
+	xnselect_destroy(&q->read_select);
+
 	/*
 	 * The queue descriptor has been marked as deleted before we
 	 * released the superlock thus preventing any subsequent call
@@ -572,6 +605,72 @@ int rt_queue_free(RT_QUEUE *q, void *buf)
 	return err;
 }
 
+/**
+ * @fn int rt_queue_free_batch(RT_QUEUE *q,RT_QUEUE_MSGV *msgv,int nmsg)
+ *
+ * @brief Free a set of message queue buffers.
+ *
+ * This service releases a set of message buffers returned by
+ * rt_queue_receive_batch() to the queue's internal pool, grabbing
+ * the nucleus lock only once for the whole set. It behaves as
+ * rt_queue_free() called for each buffer in turn.
+ *
+ * @param q The descriptor address of the affected queue.
+ *
+ * @param msgv The address of an array of message vectors, whose @a
+ * buf members give the addresses of the message buffers to free. The
+ * @a size members are ignored.
+ *
+ * @param nmsg The number of elements in @a msgv.
+ *
+ * @return 0 is returned upon success, or -EINVAL if any buffer in
+ * the set is not a valid message buffer owned by the caller; valid
+ * buffers are released regardless.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+
+int rt_queue_free_batch(RT_QUEUE *q, RT_QUEUE_MSGV *msgv, int nmsg)
+{
+	int n, ret, err = 0;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	q = xeno_h2obj_validate(q, XENO_QUEUE_MAGIC, RT_QUEUE);
+
+	if (!q) {
+		err = xeno_handle_error(q, XENO_QUEUE_MAGIC, RT_QUEUE);
+		goto unlock_and_exit;
+	}
+
+	for (n = 0; n < nmsg; n++) {
+		if (msgv[n].buf == NULL)
+			ret = -EINVAL;
+		else
+			ret = xnheap_test_and_free(&q->bufpool,
+						   ((rt_queue_msg_t *)msgv[n].buf) - 1,
+						   &__queue_check_msg);
+		if (ret && ret != -EBUSY && err == 0)
+			err = ret;
+	}
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
 /**
  * @fn int rt_queue_send(RT_QUEUE *q,void *mbuf,size_t size,int mode)
  *
@@ -692,6 +791,9 @@ int rt_queue_send(RT_QUEUE *q, void *mbuf, size_t size, int mode)
 			prependq(&q->pendq, &msg->link);
 		else
 			appendq(&q->pendq, &msg->link);
+
+		if (xnselect_signal(&q->read_select, 1))
+			xnpod_schedule();
 	} else
 		/* Ownership did not change, so update reference count. */
 		msg->refcount++;
@@ -803,6 +905,8 @@ ssize_t rt_queue_receive_inner(RT_QUEUE *q, void **bufp,
 	if (holder) {
 		msg = link2rtmsg(holder);
 		msg->refcount++;
+		if (emptyq_p(&q->pendq))
+			xnselect_signal(&q->read_select, 0);
 	} else {
 		if (timeout == TM_NONBLOCK) {
 			err = -EWOULDBLOCK;;
@@ -978,6 +1082,161 @@ ssize_t rt_queue_receive_until(RT_QUEUE *q, void **bufp, RTIME timeout)
 	return rt_queue_receive_inner(q, bufp, XN_REALTIME, timeout);
 }
 
+int rt_queue_receive_batch_inner(RT_QUEUE *q, RT_QUEUE_MSGV *msgv, int nmsg,
+				 xntmode_t timeout_mode, RTIME timeout)
+{
+	rt_queue_msg_t *msg;
+	xnholder_t *holder;
+	ssize_t ret;
+	int n;
+	spl_t s;
+
+	if (nmsg <= 0)
+		return -EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	/* Wait for the first message, then grab whatever else is ready. */
+	ret = rt_queue_receive_inner(q, &msgv[0].buf, timeout_mode, timeout);
+	if (ret < 0) {
+		n = (int)ret;
+		goto unlock_and_exit;
+	}
+
+	msgv[0].size = ret;
+
+	for (n = 1; n < nmsg; n++) {
+		holder = getq(&q->pendq);
+		if (holder == NULL)
+			break;
+		msg = link2rtmsg(holder);
+		msg->refcount++;
+		msgv[n].buf = msg + 1;
+		msgv[n].size = msg->size;
+	}
+
+	if (emptyq_p(&q->pendq))
+		xnselect_signal(&q->read_select, 0);
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return n;
+}
+
+/**
+ * @fn int rt_queue_receive_batch(RT_QUEUE *q,RT_QUEUE_MSGV *msgv,int nmsg,RTIME timeout)
+ *
+ * @brief Receive a set of messages from a queue.
+ *
+ * This service retrieves up to @a nmsg messages available from the
+ * given queue in a single call, in the order rt_queue_receive() would
+ * return them. Unless otherwise specified, the caller is blocked for
+ * a given amount of time if no message is immediately available on
+ * entry; once the first message is received, the service only
+ * collects the messages already queued, and never waits for more.
+ *
+ * @param q The descriptor address of the message queue to receive
+ * from.
+ *
+ * @param msgv The address of an array of message vectors, which will
+ * be written upon success with the address and payload size of each
+ * received message. Once consumed, the message space should be freed
+ * using rt_queue_free_batch() or rt_queue_free().
+ *
+ * @param nmsg The number of elements in @a msgv, i.e. the maximum
+ * number of messages to receive.
+ *
+ * @param timeout The number of clock ticks to wait for a message to
+ * arrive (see note). Passing TM_INFINITE causes the caller to block
+ * indefinitely until some message is eventually available. Passing
+ * TM_NONBLOCK causes the service to return immediately without
+ * waiting if no message is available on entry.
+ *
+ * @return The number of messages received is returned upon
+ * success. Otherwise:
+ *
+ * - -EINVAL is returned if @a q is not a message queue descriptor,
+ * or @a nmsg is not positive.
+ *
+ * - -EIDRM is returned if @a q is a deleted queue descriptor.
+ *
+ * - -ETIMEDOUT is returned if @a timeout is different from
+ * TM_NONBLOCK and no message is available within the specified amount
+ * of time.
+ *
+ * - -EWOULDBLOCK is returned if @a timeout is equal to TM_NONBLOCK
+ * and no message is immediately available on entry.
+ *
+ * - -EINTR is returned if rt_task_unblock() has been called for the
+ * waiting task before any data was available.
+ *
+ * - -EPERM is returned if this service should block, but was called
+ * from a context which cannot sleep (e.g. interrupt, non-realtime
+ * context).
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ *   only if @a timeout is equal to TM_NONBLOCK.
+ *
+ * - Kernel-based task
+ * - User-space task (switches to primary mode)
+ *
+ * Rescheduling: always unless the request is immediately satisfied or
+ * @a timeout specifies a non-blocking operation.
+ *
+ * @note The @a timeout value will be interpreted as jiffies if the
+ * native skin is bound to a periodic time base (see
+ * CONFIG_XENO_OPT_NATIVE_PERIOD), or nanoseconds otherwise.
+ */
+
+int rt_queue_receive_batch(RT_QUEUE *q, RT_QUEUE_MSGV *msgv, int nmsg,
+			   RTIME timeout)
+{
+	return rt_queue_receive_batch_inner(q, msgv, nmsg, XN_RELATIVE, timeout);
+}
+
+/**
+ * @fn int rt_queue_receive_batch_until(RT_QUEUE *q,RT_QUEUE_MSGV *msgv,int nmsg,RTIME timeout)
+ *
+ * @brief Receive a set of messages from a queue (with absolute
+ * timeout date).
+ *
+ * This service is equivalent to rt_queue_receive_batch(), except
+ * that @a timeout is an absolute date specifying a time limit to wait
+ * for the first message to arrive (see note), and -ETIMEDOUT is
+ * returned if this date is reached before any message arrives.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ *   only if @a timeout is equal to TM_NONBLOCK.
+ *
+ * - Kernel-based task
+ * - User-space task (switches to primary mode)
+ *
+ * Rescheduling: always unless the request is immediately satisfied or
+ * @a timeout specifies a non-blocking operation.
+ *
+ * @note The @a timeout value will be interpreted as jiffies if the
+ * native skin is bound to a periodic time base (see
+ * CONFIG_XENO_OPT_NATIVE_PERIOD), or nanoseconds otherwise.
+ */
+
+int rt_queue_receive_batch_until(RT_QUEUE *q, RT_QUEUE_MSGV *msgv, int nmsg,
+				 RTIME timeout)
+{
+	return rt_queue_receive_batch_inner(q, msgv, nmsg, XN_REALTIME, timeout);
+}
+
 ssize_t rt_queue_read_inner(RT_QUEUE *q, void *buf,
 			    size_t size, xntmode_t timeout_mode, RTIME timeout)
 {
@@ -1205,6 +1464,7 @@ int rt_queue_flush(RT_QUEUE *q)
 	 */
 	initq(&tmpq);
 	moveq(&tmpq, &q->pendq);
+	xnselect_signal(&q->read_select, 0);
 
 	xnlock_put_irqrestore(&nklock, s);
 
@@ -1286,6 +1546,89 @@ int rt_queue_inquire(RT_QUEUE *q, RT_QUEUE_INFO *info)
 	return err;
 }
 
+#ifdef CONFIG_XENO_OPT_SELECT
+
+/**
+ * @fn int rt_queue_select_bind(RT_QUEUE *q,struct xnselector *selector,unsigned type,unsigned index)
+ *
+ * @brief Bind a message queue to a selector.
+ *
+ * Have the @a selector watch the queue for pending messages, so that
+ * xnselect() reports bit @a index of the XNSELECT_READ set while
+ * rt_queue_receive() would not block.
+ *
+ * @param q The descriptor address of the queue to watch.
+ *
+ * @param selector The selector to bind the queue to.
+ *
+ * @param type The event type, only XNSELECT_READ is supported.
+ *
+ * @param index The index of the queue in the selector sets.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a q is not a message queue descriptor,
+ * or @a index is out of range.
+ *
+ * - -EIDRM is returned if @a q is a deleted queue descriptor.
+ *
+ * - -EBADF is returned if @a type is not XNSELECT_READ.
+ *
+ * - -ENOMEM is returned if the binding cannot be allocated.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: possible.
+ */
+
+int rt_queue_select_bind(RT_QUEUE *q, struct xnselector *selector,
+			 unsigned type, unsigned index)
+{
+	struct xnselect_binding *binding;
+	int err;
+	spl_t s;
+
+	if (type != XNSELECT_READ)
+		return -EBADF;
+
+	binding = xnmalloc(sizeof(*binding));
+	if (binding == NULL)
+		return -ENOMEM;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	q = xeno_h2obj_validate(q, XENO_QUEUE_MAGIC, RT_QUEUE);
+	if (q == NULL) {
+		err = xeno_handle_error(q, XENO_QUEUE_MAGIC, RT_QUEUE);
+		goto unlock_and_error;
+	}
+
+	err = xnselect_bind(&q->read_select, binding, selector, type, index,
+			    !emptyq_p(&q->pendq));
+	if (err)
+		goto unlock_and_error;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+
+      unlock_and_error:
+
+	xnlock_put_irqrestore(&nklock, s);
+	xnfree(binding);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(rt_queue_select_bind);
+
+#endif /* CONFIG_XENO_OPT_SELECT */
+
 /**
  * @fn int rt_queue_bind(RT_QUEUE *q,const char *name,RTIME timeout)
  *
@@ -1393,10 +1736,13 @@ EXPORT_SYMBOL_GPL(rt_queue_create);
 EXPORT_SYMBOL_GPL(rt_queue_delete);
 EXPORT_SYMBOL_GPL(rt_queue_alloc);
 EXPORT_SYMBOL_GPL(rt_queue_free);
+EXPORT_SYMBOL_GPL(rt_queue_free_batch);
 EXPORT_SYMBOL_GPL(rt_queue_send);
 EXPORT_SYMBOL_GPL(rt_queue_write);
 EXPORT_SYMBOL_GPL(rt_queue_receive);
 EXPORT_SYMBOL_GPL(rt_queue_receive_until);
+EXPORT_SYMBOL_GPL(rt_queue_receive_batch);
+EXPORT_SYMBOL_GPL(rt_queue_receive_batch_until);
 EXPORT_SYMBOL_GPL(rt_queue_read);
 EXPORT_SYMBOL_GPL(rt_queue_read_until);
 EXPORT_SYMBOL_GPL(rt_queue_flush);
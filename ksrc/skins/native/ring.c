@@ -0,0 +1,1137 @@
+/**
+ * @file
+ * This file is part of the Xenomai project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * \ingroup native_ring
+ */
+
+/*!
+ * \ingroup native
+ * \defgroup native_ring Shared ring services.
+ *
+ * Shared ring services.
+ *
+ * A ring is a bounded circular list of fixed-size slots, which real-time
+ * tasks can fill and drain by copying messages in and out. The ring
+ * memory is built over a nucleus heap which can be mapped into the
+ * address space of user-space tasks, so that producers and consumers
+ * exchange slots entirely from user-space using atomic indices,
+ * without any system call. The nucleus is only entered for sleeping
+ * when the ring is full or empty, and for waking up such sleepers.
+ *
+ *@{*/
+
+#include <nucleus/pod.h>
+#include <nucleus/registry.h>
+#include <nucleus/heap.h>
+#include <nucleus/bufd.h>
+#include <native/task.h>
+#include <native/ring.h>
+#include <native/timer.h>
+
+#ifdef __KERNEL__
+#include <linux/delay.h>
+#endif /* __KERNEL__ */
+
+#ifdef CONFIG_XENO_OPT_VFILE
+
+struct vfile_priv {
+	struct xnpholder *curr;
+	int writers;
+	int mode;
+	size_t nslots;
+	size_t slotsz;
+	size_t count;
+};
+
+struct vfile_data {
+	int writer;
+	char name[XNOBJECT_NAME_LEN];
+};
+
+static inline size_t __ring_count(struct rt_ring_ctl *ctl)
+{
+	return (unsigned long)xnarch_atomic_get(&ctl->tail) -
+		(unsigned long)xnarch_atomic_get(&ctl->head);
+}
+
+static int vfile_rewind(struct xnvfile_snapshot_iterator *it)
+{
+	struct vfile_priv *priv = xnvfile_iterator_priv(it);
+	RT_RING *ring = xnvfile_priv(it->vfile);
+
+	ring = xeno_h2obj_validate(ring, XENO_RING_MAGIC, RT_RING);
+	if (ring == NULL)
+		return -EIDRM;
+
+	priv->curr = getheadpq(xnsynch_wait_queue(&ring->rsynch_base));
+	priv->writers = 0;
+	priv->mode = ring->mode;
+	priv->nslots = ring->geom.mask + 1;
+	priv->slotsz = ring->geom.slotsz;
+	priv->count = __ring_count(ring->ctl);
+
+	return xnsynch_nsleepers(&ring->rsynch_base) +
+		xnsynch_nsleepers(&ring->wsynch_base);
+}
+
+static int vfile_next(struct xnvfile_snapshot_iterator *it, void *data)
+{
+	struct vfile_priv *priv = xnvfile_iterator_priv(it);
+	RT_RING *ring = xnvfile_priv(it->vfile);
+	struct vfile_data *p = data;
+	struct xnthread *thread;
+	struct xnpqueue *waitq;
+
+	if (priv->curr == NULL) {
+		if (priv->writers)
+			return 0;	/* We are done. */
+		/* Readers collected, switch to the writers. */
+		priv->writers = 1;
+		priv->curr = getheadpq(xnsynch_wait_queue(&ring->wsynch_base));
+		if (priv->curr == NULL)
+			return 0;
+	}
+
+	waitq = priv->writers ? xnsynch_wait_queue(&ring->wsynch_base) :
+		xnsynch_wait_queue(&ring->rsynch_base);
+
+	/* Fetch current waiter, advance list cursor. */
+	thread = link2thread(priv->curr, plink);
+	priv->curr = nextpq(waitq, priv->curr);
+	/* Collect thread name to be output in ->show(). */
+	strncpy(p->name, xnthread_name(thread), sizeof(p->name));
+	p->writer = priv->writers;
+
+	return 1;
+}
+
+static int vfile_show(struct xnvfile_snapshot_iterator *it, void *data)
+{
+	struct vfile_priv *priv = xnvfile_iterator_priv(it);
+	struct vfile_data *p = data;
+
+	if (p == NULL) {	/* Dump header. */
+		xnvfile_printf(it, "%6s  %9s  %9s  %s\n",
+			       "TYPE", "NSLOTS", "SLOTSZ", "COUNT");
+		xnvfile_printf(it, "%6s  %9Zu  %9Zu  %Zu\n",
+			       priv->mode & R_SHARED ? "shared" : "local",
+			       priv->nslots,
+			       priv->slotsz,
+			       priv->count);
+		if (it->nrdata > 0)
+			/* Ring is pended -- dump waiters */
+			xnvfile_printf(it, "-------------------------------------------\n");
+	} else
+		xnvfile_printf(it, "%.*s (%s)\n",
+			       (int)sizeof(p->name), p->name,
+			       p->writer ? "write" : "read");
+
+	return 0;
+}
+
+static struct xnvfile_snapshot_ops vfile_ops = {
+	.rewind = vfile_rewind,
+	.next = vfile_next,
+	.show = vfile_show,
+};
+
+extern struct xnptree __native_ptree;
+
+static struct xnpnode_snapshot __ring_pnode = {
+	.node = {
+		.dirname = "rings",
+		.root = &__native_ptree,
+		.ops = &xnregistry_vfsnap_ops,
+	},
+	.vfile = {
+		.privsz = sizeof(struct vfile_priv),
+		.datasz = sizeof(struct vfile_data),
+		.ops = &vfile_ops,
+	},
+};
+
+#else /* !CONFIG_XENO_OPT_VFILE */
+
+static struct xnpnode_snapshot __ring_pnode = {
+	.node = {
+		.dirname = "rings",
+	},
+};
+
+#endif /* !CONFIG_XENO_OPT_VFILE */
+
+static void __ring_flush_private(xnheap_t *heap,
+				 void *poolmem, u_long poolsize, void *cookie)
+{
+	xnarch_free_host_mem(poolmem, poolsize);
+}
+
+/**
+ * @fn int rt_ring_create(RT_RING *ring,const char *name,size_t slotsz,size_t nslots,int mode)
+ *
+ * @brief Create a shared ring.
+ *
+ * Create a ring object made of @a nslots fixed-size slots, through
+ * which multiple tasks may exchange messages by copy. A ring is
+ * created empty. Rings can be local to the kernel space, or shared
+ * between kernel and user-space, in which case user-space tasks
+ * transfer messages without issuing any system call unless they have
+ * to wait for the ring to become non-full or non-empty.
+ *
+ * This service needs the special character device /dev/rtheap
+ * (10,254) when called from user-space tasks.
+ *
+ * @param ring The address of a ring descriptor Xenomai will use to
+ * store the ring-related data.  This descriptor must always be valid
+ * while the ring is active therefore it must be allocated in
+ * permanent memory.
+ *
+ * @param name An ASCII string standing for the symbolic name of the
+ * ring. When non-NULL and non-empty, this string is copied to a safe
+ * place into the descriptor, and passed to the registry package if
+ * enabled for indexing the created ring. Shared rings must be given
+ * a valid name.
+ *
+ * @param slotsz The maximum size (in bytes) of a message conveyed by
+ * a single slot.
+ *
+ * @param nslots The number of slots in the ring, i.e. the maximum
+ * number of messages it can hold at any point in time. This count
+ * must be a power of two.
+ *
+ * @param mode The ring creation mode. The following flags can be
+ * OR'ed into this bitmask, each of them affecting the new ring:
+ *
+ * - R_FIFO makes tasks pend in FIFO order on the ring, waiting for
+ * data or space.
+ *
+ * - R_PRIO makes tasks pend in priority order on the ring.
+ *
+ * - R_SHARED causes the ring to be sharable between kernel and
+ * user-space tasks. Otherwise, the new ring is only available for
+ * kernel-based usage. This flag is implicitely set when the caller is
+ * running in user-space. This feature requires the real-time support
+ * in user-space to be configured in (CONFIG_XENO_OPT_PERVASIVE).
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EEXIST is returned if the @a name is already in use by some
+ * registered object.
+ *
+ * - -EINVAL is returned if @a slotsz or @a nslots is null, @a nslots
+ * is not a power of two, or @a name
+ * is null or empty for a shared ring.
+ *
+ * - -ENOMEM is returned if not enough system memory is available to
+ * create or register the ring. Additionally, and if R_SHARED has
+ * been passed in @a mode, errors while mapping the ring memory in the
+ * caller's address space might beget this return code too.
+ *
+ * - -EPERM is returned if this service was called from an invalid
+ * context.
+ *
+ * - -ENOSYS is returned if @a mode specifies R_SHARED, but the
+ * real-time support in user-space is unavailable.
+ *
+ * - -ENOENT is returned if /dev/rtheap can't be opened.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - User-space task (switches to secondary mode)
+ *
+ * Rescheduling: possible.
+ */
+
+int rt_ring_create(RT_RING *ring,
+		   const char *name, size_t slotsz, size_t nslots, int mode)
+{
+	size_t memsz, poolsize;
+	int err = 0;
+	spl_t s;
+
+	if (!xnpod_root_p())
+		return -EPERM;
+
+	if (slotsz == 0 || nslots == 0 || (nslots & (nslots - 1)))
+		return -EINVAL;
+
+	memsz = __rt_ring_memsz(slotsz, nslots);
+
+#ifdef __KERNEL__
+	if (mode & R_SHARED) {
+		if (!name || !*name)
+			return -EINVAL;
+
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+		poolsize = xnheap_rounded_size(memsz, PAGE_SIZE);
+
+		err = xnheap_init_mapped(&ring->bufpool, poolsize,
+					 XNARCH_SHARED_HEAP_FLAGS);
+		if (err)
+			return err;
+
+		ring->cpid = 0;
+#else /* !CONFIG_XENO_OPT_PERVASIVE */
+		return -ENOSYS;
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+	} else
+#endif /* __KERNEL__ */
+	{
+		void *poolmem;
+
+		poolsize = xnheap_rounded_size(memsz, XNHEAP_PAGE_SIZE);
+
+		poolmem = xnarch_alloc_host_mem(poolsize);
+
+		if (!poolmem)
+			return -ENOMEM;
+
+		err = xnheap_init(&ring->bufpool, poolmem, poolsize,
+				  XNHEAP_PAGE_SIZE, 0);
+		if (err) {
+			xnarch_free_host_mem(poolmem, poolsize);
+			return err;
+		}
+	}
+	xnheap_set_label(&ring->bufpool, "rt_ring: %s", name);
+
+	/*
+	 * The control block and slots are laid out as a single block
+	 * spanning the whole heap, so that user-space can locate them
+	 * from the mapping base.
+	 */
+	ring->ctl = xnheap_alloc(&ring->bufpool,
+				 xnheap_max_contiguous(&ring->bufpool));
+	if (ring->ctl == NULL) {
+		/* Paranoid, the heap was sized for this. */
+		goto destroy_heap;
+	}
+
+	__rt_ring_set_geom(&ring->geom, slotsz, nslots);
+	__rt_ring_init(ring->ctl, &ring->geom);
+	ring->copiers = 0;
+
+	xnsynch_init(&ring->rsynch_base, mode & (R_PRIO | R_FIFO), NULL);
+	xnsynch_init(&ring->wsynch_base, mode & (R_PRIO | R_FIFO), NULL);
+	ring->handle = 0;	/* i.e. (still) unregistered ring. */
+	ring->magic = XENO_RING_MAGIC;
+	ring->mode = mode;
+	xnobject_copy_name(ring->name, name);
+	inith(&ring->rlink);
+	ring->rqueue = &xeno_get_rholder()->ringq;
+	xnlock_get_irqsave(&nklock, s);
+	appendq(ring->rqueue, &ring->rlink);
+	xnlock_put_irqrestore(&nklock, s);
+
+	/*
+	 * <!> Since xnregister_enter() may reschedule, only register
+	 * complete objects, so that the registry cannot return
+	 * handles to half-baked objects...
+	 */
+	if (name) {
+		err = xnregistry_enter(ring->name, ring,
+				       &ring->handle, &__ring_pnode.node);
+		if (err)
+			rt_ring_delete(ring);
+	}
+
+	return err;
+
+destroy_heap:
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+	if (mode & R_SHARED)
+		xnheap_destroy_mapped(&ring->bufpool, NULL, NULL);
+	else
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+		xnheap_destroy(&ring->bufpool, &__ring_flush_private, NULL);
+
+	return -ENOMEM;
+}
+
+static void __ring_post_release(struct xnheap *heap)
+{
+	RT_RING *ring = container_of(heap, RT_RING, bufpool);
+	int resched;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (ring->handle)
+		xnregistry_remove(ring->handle);
+
+	resched = xnsynch_destroy(&ring->rsynch_base) == XNSYNCH_RESCHED;
+	resched |= xnsynch_destroy(&ring->wsynch_base) == XNSYNCH_RESCHED;
+	if (resched)
+		/*
+		 * Some task has been woken up as a result of
+		 * the deletion: reschedule now.
+		 */
+		xnpod_schedule();
+
+	xnlock_put_irqrestore(&nklock, s);
+
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+	if (ring->cpid)
+		xnfree(ring);
+#endif
+}
+
+/**
+ * @fn int rt_ring_delete(RT_RING *ring)
+ *
+ * @brief Delete a shared ring.
+ *
+ * Destroy a ring and release all the tasks currently pending on it.
+ * A ring exists in the system since rt_ring_create() has been called
+ * to create it, so this service must be called in order to destroy
+ * it afterwards.
+ *
+ * @param ring The descriptor address of the affected ring.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a ring is not a ring descriptor.
+ *
+ * - -EIDRM is returned if @a ring is a deleted ring descriptor.
+ *
+ * - -EPERM is returned if this service was called from an
+ * asynchronous context.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - User-space task (switches to secondary mode).
+ *
+ * Rescheduling: possible.
+ */
+
+int rt_ring_delete_inner(RT_RING *ring, void __user *mapaddr)
+{
+	int err;
+	spl_t s;
+
+	if (xnpod_asynch_p())
+		return -EPERM;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	ring = xeno_h2obj_validate(ring, XENO_RING_MAGIC, RT_RING);
+
+	if (!ring) {
+		err = xeno_handle_error(ring, XENO_RING_MAGIC, RT_RING);
+		xnlock_put_irqrestore(&nklock, s);
+		return err;
+	}
+
+	xeno_mark_deleted(ring);
+	removeq(ring->rqueue, &ring->rlink);
+
+	/*
+	 * Tasks copying to or from a slot do so with the nklock
+	 * released. They will notice the deletion once done, but
+	 * the ring memory must outlive their copy.
+	 */
+	while (ring->copiers > 0) {
+		xnlock_put_irqrestore(&nklock, s);
+#ifdef __KERNEL__
+		msleep(1);
+#endif /* __KERNEL__ */
+		xnlock_get_irqsave(&nklock, s);
+	}
+
+	/* Get out of the nklocked section before releasing the heap
+	   memory, since we are about to invoke Linux kernel services. */
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	/*
+	 * The ring descriptor has been marked as deleted before we
+	 * released the superlock thus preventing any subsequent call
+	 * to rt_ring_delete() to succeed, so now we can actually
+	 * destroy the associated heap safely.
+	 */
+
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+	if (ring->mode & R_SHARED)
+		xnheap_destroy_mapped(&ring->bufpool,
+				      __ring_post_release, mapaddr);
+	else
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+	{
+		xnheap_destroy(&ring->bufpool, &__ring_flush_private, NULL);
+		__ring_post_release(&ring->bufpool);
+	}
+
+	return 0;
+}
+
+int rt_ring_delete(RT_RING *ring)
+{
+	return rt_ring_delete_inner(ring, NULL);
+}
+
+/*
+ * Sleep on the given wait queue of the ring until the other side
+ * wakes us up, after having announced ourselves in the shared
+ * waiter count, which tells user-space peers that a wakeup call is
+ * needed. Called with nklock held; returns zero if the caller should
+ * retry the transfer, or a negative error code. The waiter count is
+ * dropped on return in any case, unless the ring was deleted.
+ */
+static int __ring_wait(RT_RING *ring, xnsynch_t *synch,
+		       xnarch_atomic_t *waiters,
+		       xntmode_t timeout_mode, RTIME timeout)
+{
+	xnflags_t info;
+
+	if (timeout_mode == XN_RELATIVE && timeout == TM_NONBLOCK) {
+		xnarch_atomic_dec(waiters);
+		return -EWOULDBLOCK;
+	}
+
+	if (xnpod_unblockable_p()) {
+		xnarch_atomic_dec(waiters);
+		return -EPERM;
+	}
+
+	info = xnsynch_sleep_on(synch, timeout, timeout_mode);
+	if (info & XNRMID)
+		return -EIDRM;	/* Ring deleted while pending. */
+
+	xnarch_atomic_dec(waiters);
+
+	if (info & XNTIMEO)
+		return -ETIMEDOUT;	/* Timeout. */
+	if (info & XNBREAK)
+		return -EINTR;	/* Unblocked. */
+
+	return 0;
+}
+
+static inline void __ring_wakeup(xnsynch_t *synch, xnarch_atomic_t *waiters)
+{
+	if (xnarch_atomic_get(waiters))
+		xnsynch_wakeup_one_sleeper(synch);
+}
+
+ssize_t rt_ring_write_inner(RT_RING *ring, struct xnbufd *bufd,
+			    xntmode_t timeout_mode, RTIME timeout)
+{
+	struct rt_ring_slot *slot;
+	struct rt_ring_ctl *ctl;
+	unsigned long pos;
+	ssize_t ret;
+	size_t len;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	ring = xeno_h2obj_validate(ring, XENO_RING_MAGIC, RT_RING);
+	if (ring == NULL) {
+		ret = xeno_handle_error(ring, XENO_RING_MAGIC, RT_RING);
+		goto unlock_and_exit;
+	}
+
+	ctl = ring->ctl;
+	len = bufd->b_len;
+	if (len > ring->geom.slotsz) {
+		ret = -EINVAL;
+		goto unlock_and_exit;
+	}
+
+	if (timeout_mode == XN_RELATIVE &&
+	    timeout != TM_NONBLOCK && timeout != TM_INFINITE) {
+		/*
+		 * We may sleep several times before being able to
+		 * send the data, so let's always use an absolute time
+		 * spec.
+		 */
+		timeout_mode = XN_REALTIME;
+		timeout += xntbase_get_time(__native_tbase);
+	}
+
+	for (;;) {
+		ret = __rt_ring_reserve_put(ctl, &ring->geom, &slot, &pos);
+		if (ret != -EWOULDBLOCK)
+			break;
+		/*
+		 * Announce ourselves before checking for space anew,
+		 * so that a lockless reader which freed a slot
+		 * meanwhile either sees us waiting, or we see its
+		 * slot.
+		 */
+		xnarch_atomic_inc(&ctl->wwaiters);
+		xnarch_memory_barrier();
+		ret = __rt_ring_reserve_put(ctl, &ring->geom, &slot, &pos);
+		if (ret != -EWOULDBLOCK) {
+			xnarch_atomic_dec(&ctl->wwaiters);
+			break;
+		}
+		ret = __ring_wait(ring, &ring->wsynch_base, &ctl->wwaiters,
+				  timeout_mode, timeout);
+		if (ret)
+			goto unlock_and_exit;
+	}
+
+	if (ret)
+		goto unlock_and_exit;	/* Corrupted control block. */
+
+	/*
+	 * The slot is ours until committed: release the nklock while
+	 * copying the source data to keep latency low. The ring
+	 * memory stays pinned meanwhile, see rt_ring_delete_inner().
+	 */
+	ring->copiers++;
+	xnlock_put_irqrestore(&nklock, s);
+	ret = xnbufd_copy_to_kmem(__rt_ring_data(slot), bufd, len);
+	xnlock_get_irqsave(&nklock, s);
+	ring->copiers--;
+
+	if (xeno_h2obj_validate(ring, XENO_RING_MAGIC, RT_RING) == NULL) {
+		ret = -EIDRM;
+		goto unlock_and_exit;
+	}
+
+	/*
+	 * The slot has to be published in any case, otherwise the
+	 * ring would stall; a faulty copy yields an empty message.
+	 */
+	__rt_ring_commit_put(ctl, slot, pos, ret < 0 ? 0 : len);
+	__ring_wakeup(&ring->rsynch_base, &ctl->rwaiters);
+
+	if (ret >= 0)
+		ret = (ssize_t)len;
+
+      unlock_and_exit:
+
+	xnpod_schedule();
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+
+/**
+ * @fn ssize_t rt_ring_write(RT_RING *ring,const void *buf,size_t size,RTIME timeout)
+ *
+ * @brief Write a message to a ring.
+ *
+ * Copies a message into the next free slot of the ring. If the ring
+ * is full on entry, the caller is blocked until a slot is released,
+ * or a timeout elapses. Tasks waiting for data are woken up as
+ * needed.
+ *
+ * When called from a user-space task sharing the ring memory, the
+ * whole transfer is performed from user-space unless the ring is
+ * full, or tasks are sleeping on the ring, waiting for data.
+ *
+ * @param ring The descriptor address of the ring to write to.
+ *
+ * @param buf The address of the message data to be written to the
+ * ring.
+ *
+ * @param size The size in bytes of the message to write, which must
+ * not exceed the slot size of the ring. Zero is a valid value, in
+ * which case an empty message is queued.
+ *
+ * @param timeout The number of clock ticks to wait for a free slot
+ * (see note). Passing TM_INFINITE causes the caller to block
+ * indefinitely until a slot is available. Passing TM_NONBLOCK causes
+ * the service to return immediately without blocking in case the
+ * ring is full.
+ *
+ * @return The number of bytes written to the ring is returned upon
+ * success. Otherwise:
+ *
+ * - -ETIMEDOUT is returned if the absolute @a timeout date is reached
+ * before a slot is available.
+ *
+ * - -EWOULDBLOCK is returned if @a timeout is equal to TM_NONBLOCK
+ * and the ring is full on entry.
+ *
+ * - -EINTR is returned if rt_task_unblock() has been called for the
+ * writing task before a slot became available.
+ *
+ * - -EINVAL is returned if @a ring is not a ring descriptor, or @a
+ * size is greater than the slot size of the ring.
+ *
+ * - -EIDRM is returned if @a ring is a deleted ring descriptor, or
+ * the ring was deleted while the caller was sleeping on it.
+ *
+ * - -EIO is returned if the shared indices of the ring were
+ * corrupted.
+ *
+ * - -EPERM is returned if this service should block, but was called
+ * from a context which cannot sleep (e.g. interrupt, non-realtime
+ * context).
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ *   only if @a timeout is equal to TM_NONBLOCK.
+ *
+ * - Kernel-based task
+ * - User-space task (switches to primary mode when entering the
+ *   nucleus)
+ *
+ * Rescheduling: always unless the request is immediately satisfied or
+ * @a timeout specifies a non-blocking operation.
+ *
+ * @note The @a timeout value will be interpreted as jiffies if the
+ * native skin is bound to a periodic time base (see
+ * CONFIG_XENO_OPT_NATIVE_PERIOD), or nanoseconds otherwise.
+ */
+
+ssize_t rt_ring_write(RT_RING *ring, const void *buf, size_t size,
+		      RTIME timeout)
+{
+	struct xnbufd bufd;
+	ssize_t ret;
+
+	xnbufd_map_kread(&bufd, buf, size);
+	ret = rt_ring_write_inner(ring, &bufd, XN_RELATIVE, timeout);
+	xnbufd_unmap_kread(&bufd);
+
+	return ret;
+}
+
+/**
+ * @fn ssize_t rt_ring_write_until(RT_RING *ring,const void *buf,size_t size,RTIME timeout)
+ *
+ * @brief Write a message to a ring (with absolute timeout date).
+ *
+ * This service is a variant of rt_ring_write() accepting an absolute
+ * timeout specification expressed as a date, instead of a relative
+ * delay.
+ *
+ * @see rt_ring_write().
+ */
+
+ssize_t rt_ring_write_until(RT_RING *ring, const void *buf, size_t size,
+			    RTIME timeout)
+{
+	struct xnbufd bufd;
+	ssize_t ret;
+
+	xnbufd_map_kread(&bufd, buf, size);
+	ret = rt_ring_write_inner(ring, &bufd, XN_REALTIME, timeout);
+	xnbufd_unmap_kread(&bufd);
+
+	return ret;
+}
+
+ssize_t rt_ring_read_inner(RT_RING *ring, struct xnbufd *bufd,
+			   xntmode_t timeout_mode, RTIME timeout)
+{
+	struct rt_ring_slot *slot;
+	struct rt_ring_ctl *ctl;
+	unsigned long pos;
+	ssize_t ret;
+	size_t len;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	ring = xeno_h2obj_validate(ring, XENO_RING_MAGIC, RT_RING);
+	if (ring == NULL) {
+		ret = xeno_handle_error(ring, XENO_RING_MAGIC, RT_RING);
+		goto unlock_and_exit;
+	}
+
+	ctl = ring->ctl;
+
+	if (timeout_mode == XN_RELATIVE &&
+	    timeout != TM_NONBLOCK && timeout != TM_INFINITE) {
+		timeout_mode = XN_REALTIME;
+		timeout += xntbase_get_time(__native_tbase);
+	}
+
+	for (;;) {
+		ret = __rt_ring_reserve_get(ctl, &ring->geom, &slot, &pos);
+		if (ret != -EWOULDBLOCK)
+			break;
+		/* Same handshake as in rt_ring_write_inner(). */
+		xnarch_atomic_inc(&ctl->rwaiters);
+		xnarch_memory_barrier();
+		ret = __rt_ring_reserve_get(ctl, &ring->geom, &slot, &pos);
+		if (ret != -EWOULDBLOCK) {
+			xnarch_atomic_dec(&ctl->rwaiters);
+			break;
+		}
+		ret = __ring_wait(ring, &ring->rsynch_base, &ctl->rwaiters,
+				  timeout_mode, timeout);
+		if (ret)
+			goto unlock_and_exit;
+	}
+
+	if (ret)
+		goto unlock_and_exit;	/* Corrupted control block. */
+
+	/* The size comes from shared memory, read it once and clamp. */
+	len = *(volatile unsigned long *)&slot->size;
+	if (len > ring->geom.slotsz)
+		len = ring->geom.slotsz;
+	if (len > bufd->b_len)
+		len = bufd->b_len;
+
+	ring->copiers++;
+	xnlock_put_irqrestore(&nklock, s);
+	ret = xnbufd_copy_from_kmem(bufd, __rt_ring_data(slot), len);
+	xnlock_get_irqsave(&nklock, s);
+	ring->copiers--;
+
+	if (xeno_h2obj_validate(ring, XENO_RING_MAGIC, RT_RING) == NULL) {
+		ret = -EIDRM;
+		goto unlock_and_exit;
+	}
+
+	__rt_ring_commit_get(&ring->geom, slot, pos);
+	__ring_wakeup(&ring->wsynch_base, &ctl->wwaiters);
+
+	if (ret >= 0)
+		ret = (ssize_t)len;
+
+      unlock_and_exit:
+
+	xnpod_schedule();
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+
+/**
+ * @fn ssize_t rt_ring_read(RT_RING *ring,void *buf,size_t size,RTIME timeout)
+ *
+ * @brief Read a message from a ring.
+ *
+ * Copies the message held by the oldest filled slot of the ring to
+ * the caller's buffer, then releases the slot. If the ring is empty
+ * on entry, the caller is blocked until a message is written, or a
+ * timeout elapses. Tasks waiting for space are woken up as needed.
+ *
+ * When called from a user-space task sharing the ring memory, the
+ * whole transfer is performed from user-space unless the ring is
+ * empty, or tasks are sleeping on the ring, waiting for space.
+ *
+ * @param ring The descriptor address of the ring to read from.
+ *
+ * @param buf A pointer to a memory area which will be written upon
+ * success with the message contents.
+ *
+ * @param size The length in bytes of the memory area pointed to by @a
+ * buf. Messages larger than @a size are truncated appropriately.
+ *
+ * @param timeout The number of clock ticks to wait for a message to
+ * arrive (see note). Passing TM_INFINITE causes the caller to block
+ * indefinitely until some message is available. Passing TM_NONBLOCK
+ * causes the service to return immediately without waiting if the
+ * ring is empty.
+ *
+ * @return The number of bytes copied to @a buf is returned upon
+ * success. Otherwise:
+ *
+ * - -ETIMEDOUT is returned if @a timeout is different from
+ * TM_NONBLOCK and no message is available within the specified
+ * amount of time.
+ *
+ * - -EWOULDBLOCK is returned if @a timeout is equal to TM_NONBLOCK
+ * and the ring is empty on entry.
+ *
+ * - -EINTR is returned if rt_task_unblock() has been called for the
+ * reading task before a message was available.
+ *
+ * - -EINVAL is returned if @a ring is not a ring descriptor.
+ *
+ * - -EIDRM is returned if @a ring is a deleted ring descriptor, or
+ * the ring was deleted while the caller was sleeping on it.
+ *
+ * - -EIO is returned if the shared indices of the ring were
+ * corrupted.
+ *
+ * - -EPERM is returned if this service should block, but was called
+ * from a context which cannot sleep (e.g. interrupt, non-realtime
+ * context).
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ *   only if @a timeout is equal to TM_NONBLOCK.
+ *
+ * - Kernel-based task
+ * - User-space task (switches to primary mode when entering the
+ *   nucleus)
+ *
+ * Rescheduling: always unless the request is immediately satisfied or
+ * @a timeout specifies a non-blocking operation.
+ *
+ * @note The @a timeout value will be interpreted as jiffies if the
+ * native skin is bound to a periodic time base (see
+ * CONFIG_XENO_OPT_NATIVE_PERIOD), or nanoseconds otherwise.
+ */
+
+ssize_t rt_ring_read(RT_RING *ring, void *buf, size_t size, RTIME timeout)
+{
+	struct xnbufd bufd;
+	ssize_t ret;
+
+	xnbufd_map_kwrite(&bufd, buf, size);
+	ret = rt_ring_read_inner(ring, &bufd, XN_RELATIVE, timeout);
+	xnbufd_unmap_kwrite(&bufd);
+
+	return ret;
+}
+
+/**
+ * @fn ssize_t rt_ring_read_until(RT_RING *ring,void *buf,size_t size,RTIME timeout)
+ *
+ * @brief Read a message from a ring (with absolute timeout date).
+ *
+ * This service is a variant of rt_ring_read() accepting an absolute
+ * timeout specification expressed as a date, instead of a relative
+ * delay.
+ *
+ * @see rt_ring_read().
+ */
+
+ssize_t rt_ring_read_until(RT_RING *ring, void *buf, size_t size,
+			   RTIME timeout)
+{
+	struct xnbufd bufd;
+	ssize_t ret;
+
+	xnbufd_map_kwrite(&bufd, buf, size);
+	ret = rt_ring_read_inner(ring, &bufd, XN_REALTIME, timeout);
+	xnbufd_unmap_kwrite(&bufd);
+
+	return ret;
+}
+
+/*
+ * Wake up a task sleeping on the ring, on behalf of a user-space
+ * peer which transferred a slot locklessly, then noticed sleepers.
+ */
+int rt_ring_wakeup_inner(RT_RING *ring, int which)
+{
+	int err = 0;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	ring = xeno_h2obj_validate(ring, XENO_RING_MAGIC, RT_RING);
+	if (!ring) {
+		err = xeno_handle_error(ring, XENO_RING_MAGIC, RT_RING);
+		goto unlock_and_exit;
+	}
+
+	if (which == R_WAKE_WRITERS)
+		__ring_wakeup(&ring->wsynch_base, &ring->ctl->wwaiters);
+	else
+		__ring_wakeup(&ring->rsynch_base, &ring->ctl->rwaiters);
+
+	xnpod_schedule();
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
+/**
+ * @fn int rt_ring_inquire(RT_RING *ring, RT_RING_INFO *info)
+ *
+ * @brief Inquire about a shared ring.
+ *
+ * Return various information about the status of a given ring.
+ *
+ * @param ring The descriptor address of the inquired ring.
+ *
+ * @param info The address of a structure the ring information will
+ * be written to.
+
+ * @return 0 is returned and status information is written to the
+ * structure pointed at by @a info upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a ring is not a ring descriptor.
+ *
+ * - -EIDRM is returned if @a ring is a deleted ring descriptor.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+
+int rt_ring_inquire(RT_RING *ring, RT_RING_INFO *info)
+{
+	struct rt_ring_ctl *ctl;
+	int err = 0;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	ring = xeno_h2obj_validate(ring, XENO_RING_MAGIC, RT_RING);
+
+	if (!ring) {
+		err = xeno_handle_error(ring, XENO_RING_MAGIC, RT_RING);
+		goto unlock_and_exit;
+	}
+
+	ctl = ring->ctl;
+	strcpy(info->name, ring->name);
+	info->nreaders = xnsynch_nsleepers(&ring->rsynch_base);
+	info->nwriters = xnsynch_nsleepers(&ring->wsynch_base);
+	info->mode = ring->mode;
+	info->nslots = ring->geom.mask + 1;
+	info->slotsz = ring->geom.slotsz;
+	info->count = (unsigned long)xnarch_atomic_get(&ctl->tail) -
+		(unsigned long)xnarch_atomic_get(&ctl->head);
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
+/**
+ * @fn int rt_ring_bind(RT_RING *ring,const char *name,RTIME timeout)
+ *
+ * @brief Bind to a shared ring.
+ *
+ * This user-space only service retrieves the uniform descriptor of a
+ * given shared Xenomai ring identified by its symbolic name. If the
+ * ring does not exist on entry, this service blocks the caller until
+ * a ring of the given name is created.
+ *
+ * @param name A valid NULL-terminated name which identifies the
+ * ring to bind to.
+ *
+ * @param ring The address of a ring descriptor retrieved by the
+ * operation. Contents of this memory is undefined upon failure.
+ *
+ * @param timeout The number of clock ticks to wait for the
+ * registration to occur (see note). Passing TM_INFINITE causes the
+ * caller to block indefinitely until the object is
+ * registered. Passing TM_NONBLOCK causes the service to return
+ * immediately without waiting if the object is not registered on
+ * entry.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT is returned if @a ring or @a name is referencing invalid
+ * memory.
+ *
+ * - -EINTR is returned if rt_task_unblock() has been called for the
+ * waiting task before the retrieval has completed.
+ *
+ * - -EWOULDBLOCK is returned if @a timeout is equal to TM_NONBLOCK
+ * and the searched object is not registered on entry.
+ *
+ * - -ETIMEDOUT is returned if the object cannot be retrieved within
+ * the specified amount of time.
+ *
+ * - -EPERM is returned if this service should block, but was called
+ * from a context which cannot sleep (e.g. interrupt, non-realtime
+ * context).  This error may also be returned whenever the call
+ * attempts to bind from a user-space application to a local ring
+ * defined from kernel space (i.e. R_SHARED was not passed to
+ * rt_ring_create()).
+ *
+ * - -ENOENT is returned if the special file /dev/rtheap
+ * (character-mode, major 10, minor 254) is not available from the
+ * filesystem. This device is needed to map the memory used by the
+ * shared ring into the caller's address space. udev-based systems
+ * should not need manual creation of such device entry.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - User-space task (switches to primary mode)
+ *
+ * Rescheduling: always unless the request is immediately satisfied or
+ * @a timeout specifies a non-blocking operation.
+ *
+ * @note The @a timeout value will be interpreted as jiffies if the
+ * native skin is bound to a periodic time base (see
+ * CONFIG_XENO_OPT_NATIVE_PERIOD), or nanoseconds otherwise.
+ */
+
+/**
+ * @fn int rt_ring_unbind(RT_RING *ring)
+ *
+ * @brief Unbind from a shared ring.
+ *
+ * This user-space only service unbinds the calling task from the
+ * ring object previously retrieved by a call to rt_ring_bind().
+ *
+ * Unbinding from a ring when it is no more needed is especially
+ * important in order to properly release the mapping resources used
+ * to attach the shared ring memory to the caller's address space.
+ *
+ * @param ring The address of a ring descriptor to unbind from.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a ring is invalid or not bound.
+ *
+ * This service can be called from:
+ *
+ * - User-space task.
+ *
+ * Rescheduling: never.
+ */
+
+int __native_ring_pkg_init(void)
+{
+	return 0;
+}
+
+void __native_ring_pkg_cleanup(void)
+{
+	__native_ring_flush_rq(&__native_global_rholder.ringq);
+}
+
+/*@}*/
+
+EXPORT_SYMBOL_GPL(rt_ring_create);
+EXPORT_SYMBOL_GPL(rt_ring_delete);
+EXPORT_SYMBOL_GPL(rt_ring_write);
+EXPORT_SYMBOL_GPL(rt_ring_write_until);
+EXPORT_SYMBOL_GPL(rt_ring_read);
+EXPORT_SYMBOL_GPL(rt_ring_read_until);
+EXPORT_SYMBOL_GPL(rt_ring_inquire);
@@ -0,0 +1,441 @@
+/**
+ * @file
+ * This file is part of the Xenomai project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * \ingroup native_select
+ */
+
+/*!
+ * \ingroup native
+ * \defgroup native_select Synchronous I/O multiplexing services.
+ *
+ * Synchronous I/O multiplexing services.
+ *
+ * rt_select() allows a single task to wait for any of a set of
+ * message queues, event flag groups, semaphores, buffers, message
+ * pipes and RTDM file descriptors to become ready, instead of
+ * dedicating a task to each of them.
+ *
+ *@{*/
+
+#include <nucleus/pod.h>
+#include <nucleus/heap.h>
+#include <nucleus/registry.h>
+#include <nucleus/shadow.h>
+#include <native/task.h>
+#include <native/timer.h>
+#include <native/sem.h>
+#include <native/event.h>
+#include <native/queue.h>
+#include <native/pipe.h>
+#include <native/buffer.h>
+#include <native/select.h>
+#if defined(CONFIG_XENO_SKIN_RTDM) || defined(CONFIG_XENO_SKIN_RTDM_MODULE)
+#include <rtdm/rtdm_driver.h>
+#endif /* CONFIG_XENO_SKIN_RTDM */
+
+static int select_bind_one(struct xnselector *selector,
+			   RT_SELECT_ITEM *item, unsigned type, unsigned index)
+{
+	void *obj;
+
+	if (item->type == RT_SELECT_FD) {
+#if defined(CONFIG_XENO_SKIN_RTDM) || defined(CONFIG_XENO_SKIN_RTDM_MODULE)
+		return rtdm_select_bind(item->handle, selector, type, index);
+#else /* !CONFIG_XENO_SKIN_RTDM */
+		return -EBADF;
+#endif /* !CONFIG_XENO_SKIN_RTDM */
+	}
+
+	obj = xnregistry_fetch(item->handle);
+	if (obj == NULL)
+		return -ESRCH;
+
+	switch (item->type) {
+#ifdef CONFIG_XENO_OPT_NATIVE_QUEUE
+	case RT_SELECT_QUEUE:
+		return rt_queue_select_bind(obj, selector, type, index);
+#endif /* CONFIG_XENO_OPT_NATIVE_QUEUE */
+#ifdef CONFIG_XENO_OPT_NATIVE_EVENT
+	case RT_SELECT_EVENT:
+		return rt_event_select_bind(obj, selector, type, index);
+#endif /* CONFIG_XENO_OPT_NATIVE_EVENT */
+#ifdef CONFIG_XENO_OPT_NATIVE_SEM
+	case RT_SELECT_SEM:
+		return rt_sem_select_bind(obj, selector, type, index);
+#endif /* CONFIG_XENO_OPT_NATIVE_SEM */
+#ifdef CONFIG_XENO_OPT_NATIVE_BUFFER
+	case RT_SELECT_BUFFER:
+		return rt_buffer_select_bind(obj, selector, type, index);
+#endif /* CONFIG_XENO_OPT_NATIVE_BUFFER */
+#ifdef CONFIG_XENO_OPT_NATIVE_PIPE
+	case RT_SELECT_PIPE:
+		return rt_pipe_select_bind(obj, selector, type, index);
+#endif /* CONFIG_XENO_OPT_NATIVE_PIPE */
+	default:
+		return -EINVAL;
+	}
+}
+
+static void select_unbind_item(struct xnselector *selector,
+			       RT_SELECT_ITEM *item, unsigned index)
+{
+	/* Bindings of deleted objects are already gone. */
+	if (item->events & RT_SELECT_IN)
+		xnselect_unbind(selector, XNSELECT_READ, index);
+	if (item->events & RT_SELECT_OUT)
+		xnselect_unbind(selector, XNSELECT_WRITE, index);
+}
+
+static int select_bind_item(struct xnselector *selector,
+			    RT_SELECT_ITEM *item, unsigned index)
+{
+	int ret;
+
+	if (item->events & RT_SELECT_IN) {
+		ret = select_bind_one(selector, item, XNSELECT_READ, index);
+		if (ret)
+			return ret;
+	}
+
+	if (item->events & RT_SELECT_OUT) {
+		ret = select_bind_one(selector, item, XNSELECT_WRITE, index);
+		if (ret) {
+			if (item->events & RT_SELECT_IN)
+				xnselect_unbind(selector, XNSELECT_READ, index);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static inline int select_same_item(RT_SELECT_ITEM *a, RT_SELECT_ITEM *b)
+{
+	return a->type == b->type &&
+		a->handle == b->handle && a->events == b->events;
+}
+
+/*
+ * Bind item #n to bit #n of the selector sets. Items which did not
+ * change since the previous call keep their bindings, so that a
+ * task looping over the same set does not rebind anything. A slot
+ * whose events are zero is not bound.
+ */
+static int select_update(struct rt_select_cache *cache, int nitems)
+{
+	int i, n = max(nitems, cache->nbound), ret;
+	RT_SELECT_ITEM *old, *new;
+
+	for (i = 0; i < n; i++) {
+		old = &cache->bound[i];
+		new = &cache->items[i];
+
+		if (i >= cache->nbound)
+			old->events = 0;
+
+		if (i < nitems && old->events && select_same_item(old, new))
+			continue;
+
+		select_unbind_item(cache->selector, old, i);
+		old->events = 0;
+
+		if (i >= nitems)
+			continue;
+
+		ret = select_bind_item(cache->selector, new, i);
+		if (ret) {
+			cache->nbound = max(cache->nbound, i + 1);
+			return ret;
+		}
+
+		*old = *new;
+	}
+
+	cache->nbound = nitems;
+
+	return 0;
+}
+
+/* Rebind the items whose bindings went away with their object. */
+static int select_rebind(struct rt_select_cache *cache, int nitems)
+{
+	unsigned type;
+	int i, ret;
+
+	for (type = XNSELECT_READ; type <= XNSELECT_WRITE; type++)
+		for (i = 0; i < nitems; i++) {
+			if (!__FD_ISSET__(i, &cache->out_fds[type]))
+				continue;
+			ret = select_bind_one(cache->selector,
+					      &cache->items[i], type, i);
+			if (ret) {
+				select_unbind_item(cache->selector,
+						   &cache->bound[i], i);
+				cache->bound[i].events = 0;
+				return ret;
+			}
+		}
+
+	return 0;
+}
+
+/*
+ * Semaphore units and event flags may be consumed from user-space
+ * without the nucleus knowing, refresh their state before waiting.
+ */
+static void select_refresh(struct rt_select_cache *cache, int nitems)
+{
+	RT_SELECT_ITEM *item;
+	void *obj;
+	int i;
+
+	for (i = 0; i < nitems; i++) {
+		item = &cache->items[i];
+		if (item->type != RT_SELECT_SEM &&
+		    item->type != RT_SELECT_EVENT)
+			continue;
+
+		obj = xnregistry_fetch(item->handle);
+		if (obj == NULL)
+			continue;
+#ifdef CONFIG_XENO_OPT_NATIVE_SEM
+		if (item->type == RT_SELECT_SEM)
+			__native_sem_select_update(obj);
+#endif /* CONFIG_XENO_OPT_NATIVE_SEM */
+#ifdef CONFIG_XENO_OPT_NATIVE_EVENT
+		if (item->type == RT_SELECT_EVENT)
+			__native_event_select_update(obj);
+#endif /* CONFIG_XENO_OPT_NATIVE_EVENT */
+	}
+}
+
+static struct rt_select_cache *select_get_cache(RT_TASK *task)
+{
+	struct rt_select_cache *cache = task->selcache;
+
+	if (cache)
+		return cache;
+
+	cache = xnmalloc(sizeof(*cache));
+	if (cache == NULL)
+		return NULL;
+
+	cache->selector = xnmalloc(sizeof(*cache->selector));
+	if (cache->selector == NULL) {
+		xnfree(cache);
+		return NULL;
+	}
+
+	xnselector_init(cache->selector);
+	cache->nbound = 0;
+	task->selcache = cache;
+
+	return cache;
+}
+
+/**
+ * @fn int rt_select(RT_SELECT_ITEM *items,int nitems,RTIME timeout)
+ * @brief Wait for a set of objects to become ready.
+ *
+ * This user-space only service blocks the caller until at least one
+ * item of the set is ready for the events it lists, or the timeout
+ * elapses. Items are filled with rt_select_set() for Xenomai
+ * objects, or rt_select_set_fd() for RTDM file descriptors as
+ * returned by rt_dev_open() or rt_dev_socket(). The following
+ * objects may be watched:
+ *
+ * - message queues, for RT_SELECT_IN: a message is pending.
+ *
+ * - event flag groups, for RT_SELECT_IN: any flag is set.
+ *
+ * - semaphores, for RT_SELECT_IN: the count is positive. Pulse
+ * semaphores cannot be watched.
+ *
+ * - buffers, for RT_SELECT_IN: data is available, and RT_SELECT_OUT:
+ * space is available.
+ *
+ * - message pipes, for RT_SELECT_IN: a message written from the
+ * Linux side is pending.
+ *
+ * - RTDM file descriptors, for RT_SELECT_IN and RT_SELECT_OUT, as
+ * their driver defines them.
+ *
+ * Readiness is only a hint: another task may consume what made an
+ * item ready before the caller does, so ready items should be
+ * serviced with non-blocking calls.
+ *
+ * The caller keeps a selector across calls. Passing the same set
+ * repeatedly, which is the usual case of a server loop, binds the
+ * objects to it only once.
+ *
+ * @param items An array of @a nitems items. The revents field of
+ * each item is updated upon success with the events which occurred.
+ *
+ * @param nitems The number of items, at most RT_SELECT_MAX.
+ *
+ * @param timeout The number of clock ticks to wait for an item to
+ * become ready (see note). Passing TM_INFINITE causes the caller to
+ * block indefinitely. Passing TM_NONBLOCK causes the service to
+ * return immediately without waiting.
+ *
+ * @return The number of ready items is returned upon
+ * success. Otherwise:
+ *
+ * - -EINVAL is returned if @a nitems is out of range, or an item
+ * lists no or unsupported events, or has an invalid type.
+ *
+ * - -ESRCH is returned if an item refers to an object which does
+ * not exist anymore.
+ *
+ * - -EBADF is returned if an RTDM file descriptor is invalid, or
+ * does not support the events it lists.
+ *
+ * - -EWOULDBLOCK is returned if @a timeout is equal to TM_NONBLOCK
+ * and no item is ready.
+ *
+ * - -ETIMEDOUT is returned if no item became ready within the
+ * specified amount of time.
+ *
+ * - -EINTR is returned if rt_task_unblock() has been called for the
+ * waiting task.
+ *
+ * - -ENOMEM is returned if the selector cannot be allocated.
+ *
+ * - -EFAULT is returned if @a items is referencing invalid memory.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - User-space task (switches to primary mode)
+ *
+ * Rescheduling: always unless an item is ready on entry, or @a
+ * timeout specifies a non-blocking operation.
+ *
+ * @note The @a timeout value will be interpreted as jiffies if the
+ * native skin is bound to a periodic time base (see
+ * CONFIG_XENO_OPT_NATIVE_PERIOD), or nanoseconds otherwise.
+ */
+
+int rt_select_inner(RT_TASK *task, RT_SELECT_ITEM __user *u_items,
+		    int nitems, RTIME timeout)
+{
+	fd_set *out_fds[XNSELECT_MAX_TYPES] = { NULL, NULL, NULL };
+	fd_set *in_fds[XNSELECT_MAX_TYPES] = { NULL, NULL, NULL };
+	struct rt_select_cache *cache;
+	xntmode_t mode = XN_RELATIVE;
+	RT_SELECT_ITEM *item;
+	int i, ret, count;
+	xnticks_t date;
+
+	if (nitems <= 0 || nitems > RT_SELECT_MAX)
+		return -EINVAL;
+
+	cache = select_get_cache(task);
+	if (cache == NULL)
+		return -ENOMEM;
+
+	if (__xn_safe_copy_from_user(cache->items, u_items,
+				     nitems * sizeof(RT_SELECT_ITEM)))
+		return -EFAULT;
+
+	for (i = 0; i < 2; i++) {
+		__FD_ZERO__(&cache->in_fds[i]);
+		in_fds[i] = &cache->in_fds[i];
+		out_fds[i] = &cache->out_fds[i];
+	}
+
+	for (i = 0; i < nitems; i++) {
+		item = &cache->items[i];
+		if (item->events == 0 ||
+		    (item->events & ~(RT_SELECT_IN | RT_SELECT_OUT)))
+			return -EINVAL;
+		if (item->events & RT_SELECT_IN)
+			__FD_SET__(i, in_fds[XNSELECT_READ]);
+		if (item->events & RT_SELECT_OUT)
+			__FD_SET__(i, in_fds[XNSELECT_WRITE]);
+	}
+
+	ret = select_update(cache, nitems);
+	if (ret)
+		return ret;
+
+	select_refresh(cache, nitems);
+
+	/*
+	 * Bindings may be redone on the way, use an absolute date not
+	 * to extend the wait.
+	 */
+	if (timeout == TM_INFINITE)
+		date = XN_INFINITE;
+	else {
+		date = xntbase_get_jiffies(__native_tbase);
+		if (timeout != TM_NONBLOCK)
+			date += timeout;
+		mode = XN_ABSOLUTE;
+	}
+
+	for (;;) {
+		ret = xnselect(cache->selector, out_fds, in_fds,
+			       nitems, date, mode);
+		if (ret != -ECHRNG)
+			break;
+		ret = select_rebind(cache, nitems);
+		if (ret)
+			return ret;
+	}
+
+	if (ret == 0)
+		return timeout == TM_NONBLOCK ? -EWOULDBLOCK : -ETIMEDOUT;
+
+	if (ret < 0)
+		return ret;
+
+	for (i = 0, count = 0; i < nitems; i++) {
+		item = &cache->items[i];
+		item->revents = 0;
+		if (__FD_ISSET__(i, out_fds[XNSELECT_READ]))
+			item->revents |= RT_SELECT_IN;
+		if (__FD_ISSET__(i, out_fds[XNSELECT_WRITE]))
+			item->revents |= RT_SELECT_OUT;
+		if (item->revents)
+			count++;
+	}
+
+	if (__xn_safe_copy_to_user(u_items, cache->items,
+				   nitems * sizeof(RT_SELECT_ITEM)))
+		return -EFAULT;
+
+	return count;
+}
+
+/* Called from the task deletion hook, nklock held. */
+void __native_select_cleanup(RT_TASK *task)
+{
+	struct rt_select_cache *cache = task->selcache;
+
+	if (cache == NULL)
+		return;
+
+	/* The selector is released from an APC, with its bindings. */
+	xnselector_destroy(cache->selector);
+	xnfree(cache);
+	task->selcache = NULL;
+}
+
+/*@}*/
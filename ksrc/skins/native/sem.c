@@ -45,6 +45,7 @@
 #include <nucleus/pod.h>
 #include <nucleus/registry.h>
 #include <nucleus/heap.h>
+#include <nucleus/sys_ppd.h>
 #include <native/task.h>
 #include <native/sem.h>
 
@@ -69,7 +70,7 @@ static int vfile_rewind(struct xnvfile_snapshot_iterator *it)
 		return -EIDRM;
 
 	priv->curr = getheadpq(xnsynch_wait_queue(&sem->synch_base));
-	priv->count = sem->count;
+	priv->count = xnsynch_fast_count_get(sem->fastcnt);
 
 	return xnsynch_nsleepers(&sem->synch_base);
 }
@@ -87,7 +88,7 @@ static int vfile_next(struct xnvfile_snapshot_iterator *it, void *data)
 	 * collecting records, and we don't want to touch the revision
 	 * tag each time that value changes).
 	 */
-	priv->count = sem->count;
+	priv->count = xnsynch_fast_count_get(sem->fastcnt);
 
 	if (priv->curr == NULL)
 		return 0;	/* We are done. */
@@ -149,6 +150,112 @@ static struct xnpnode_snapshot __sem_pnode = {
 
 #endif /* !CONFIG_XENO_OPT_VFILE */
 
+#ifdef CONFIG_XENO_OPT_SELECT
+
+#define __sem_selected_p(sem)	(!emptyq_p(&(sem)->read_select.bindings))
+
+/*
+ * Keep the waiter flag raised while a selector watches the
+ * semaphore, so that user-space V operations enter the kernel and
+ * the selector gets notified; then update the selector state.
+ */
+static int __sem_select_signal(RT_SEM *sem)
+{
+	unsigned long cur, old;
+
+	if (!__sem_selected_p(sem))
+		return 0;
+
+	cur = xnarch_atomic_get(sem->fastcnt);
+	while (!(cur & XNSYNCH_FCNT_WAITERS)) {
+		old = xnarch_atomic_cmpxchg(sem->fastcnt, cur,
+					    cur | XNSYNCH_FCNT_WAITERS);
+		if (old == cur)
+			break;
+		cur = old;
+	}
+
+	return __xnselect_signal(&sem->read_select,
+				 (cur & XNSYNCH_FCNT_MASK) != 0);
+}
+
+#else /* !CONFIG_XENO_OPT_SELECT */
+
+#define __sem_selected_p(sem)		0
+#define __sem_select_signal(sem)	0
+
+#endif /* !CONFIG_XENO_OPT_SELECT */
+
+int rt_sem_create_inner(RT_SEM *sem, const char *name,
+			unsigned long icount, int mode, int global)
+{
+	xnflags_t flags = mode & S_PRIO;
+	xnarch_atomic_t *fastcnt;
+	int err = 0;
+	spl_t s;
+
+	if (xnpod_asynch_p())
+		return -EPERM;
+
+	if ((mode & S_PULSE) && icount > 0)
+		return -EINVAL;
+
+	if (icount > XNSYNCH_FCNT_MASK)
+		return -EINVAL;
+
+#ifdef CONFIG_XENO_FASTSYNCH
+	/* Allocate the counter word user-space may update. */
+	fastcnt = xnheap_alloc(&xnsys_ppd_get(global)->sem_heap,
+			       xnheap_synch_size(sizeof(*fastcnt), 0));
+	if (!fastcnt)
+		return -ENOMEM;
+
+	if (global)
+		flags |= RT_SEM_EXPORTED;
+#else /* !CONFIG_XENO_FASTSYNCH */
+	fastcnt = &sem->count;
+#endif /* !CONFIG_XENO_FASTSYNCH */
+
+	/*
+	 * A pulse semaphore never holds any unit, so keep the waiter
+	 * flag raised for good: this routes every V operation to the
+	 * nucleus.
+	 */
+	xnarch_atomic_set(fastcnt,
+			  (mode & S_PULSE) ? XNSYNCH_FCNT_WAITERS : icount);
+	sem->fastcnt = fastcnt;
+
+	xnsynch_init(&sem->synch_base, flags, NULL);
+	xnselect_init(&sem->read_select);
+	sem->mode = mode;
+	sem->handle = 0;	/* i.e. (still) unregistered semaphore. */
+	sem->magic = XENO_SEM_MAGIC;
+	xnobject_copy_name(sem->name, name);
+	inith(&sem->rlink);
+	sem->rqueue = &xeno_get_rholder()->semq;
+	xnlock_get_irqsave(&nklock, s);
+	appendq(sem->rqueue, &sem->rlink);
+	xnlock_put_irqrestore(&nklock, s);
+
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+	sem->cpid = 0;
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+
+	/*
+	 * <!> Since xnregister_enter() may reschedule, only register
+	 * complete objects, so that the registry cannot return
+	 * handles to half-baked objects...
+	 */
+	if (name) {
+		err = xnregistry_enter(sem->name, sem, &sem->handle,
+				       &__sem_pnode.node);
+		if (err)
+			rt_sem_delete(sem);
+	}
+
+	return err;
+}
+
 /**
  * @fn int rt_sem_create(RT_SEM *sem,const char *name,unsigned long icount,int mode)
  * @brief Create a counting semaphore.
@@ -182,13 +289,15 @@ static struct xnpnode_snapshot __sem_pnode = {
  *
  * - -ENOMEM is returned if the system fails to get enough dynamic
  * memory from the global real-time heap in order to register the
- * semaphore.
+ * semaphore, or from the semaphore heap in order to allocate its
+ * shared counter.
  *
  * - -EEXIST is returned if the @a name is already in use by some
  * registered object.
  *
  * - -EINVAL is returned if the @a icount is non-zero and @a mode
- * specifies a pulse semaphore.
+ * specifies a pulse semaphore, or if @a icount is greater than
+ * 0x7fffffff.
  *
  * - -EPERM is returned if this service was called from an
  * asynchronous context.
@@ -206,44 +315,7 @@ static struct xnpnode_snapshot __sem_pnode = {
 
 int rt_sem_create(RT_SEM *sem, const char *name, unsigned long icount, int mode)
 {
-	int err = 0;
-	spl_t s;
-
-	if (xnpod_asynch_p())
-		return -EPERM;
-
-	if ((mode & S_PULSE) && icount > 0)
-		return -EINVAL;
-
-	xnsynch_init(&sem->synch_base, mode & S_PRIO, NULL);
-	sem->count = icount;
-	sem->mode = mode;
-	sem->handle = 0;	/* i.e. (still) unregistered semaphore. */
-	sem->magic = XENO_SEM_MAGIC;
-	xnobject_copy_name(sem->name, name);
-	inith(&sem->rlink);
-	sem->rqueue = &xeno_get_rholder()->semq;
-	xnlock_get_irqsave(&nklock, s);
-	appendq(sem->rqueue, &sem->rlink);
-	xnlock_put_irqrestore(&nklock, s);
-
-#ifdef CONFIG_XENO_OPT_PERVASIVE
-	sem->cpid = 0;
-#endif /* CONFIG_XENO_OPT_PERVASIVE */
-
-	/*
-	 * <!> Since xnregister_enter() may reschedule, only register
-	 * complete objects, so that the registry cannot return
-	 * handles to half-baked objects...
-	 */
-	if (name) {
-		err = xnregistry_enter(sem->name, sem, &sem->handle,
-				       &__sem_pnode.node);
-		if (err)
-			rt_sem_delete(sem);
-	}
-
-	return err;
+	return rt_sem_create_inner(sem, name, icount, mode, 1);
 }
 
 /**
@@ -279,7 +351,7 @@ int rt_sem_create(RT_SEM *sem, const char *name, unsigned long icount, int mode)
 
 int rt_sem_delete(RT_SEM *sem)
 {
-	int err = 0, rc;
+	int err = 0, global = 0, rc;
 	spl_t s;
 
 	if (xnpod_asynch_p())
@@ -294,6 +366,8 @@ int rt_sem_delete(RT_SEM *sem)
 		goto unlock_and_exit;
 	}
 
+	global = xnsynch_test_flags(&sem->synch_base, RT_SEM_EXPORTED);
+
 	removeq(sem->rqueue, &sem->rlink);
 
 	rc = xnsynch_destroy(&sem->synch_base);
@@ -312,6 +386,14 @@ int rt_sem_delete(RT_SEM *sem)
 
 	xnlock_put_irqrestore(&nklock, s);
 
+	if (!err)
+		xnselect_destroy(&sem->read_select);
+
+#ifdef CONFIG_XENO_FASTSYNCH
+	if (!err)
+		xnheap_free(&xnsys_ppd_get(global)->sem_heap, sem->fastcnt);
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 	return err;
 }
 
@@ -331,10 +413,10 @@ int rt_sem_p_inner(RT_SEM *sem, xntmode_t timeout_mode, RTIME timeout)
 	}
 
 	if (timeout == TM_NONBLOCK) {
-		if (sem->count > 0)
-			sem->count--;
-		else
+		if (xnsynch_fast_count_down(sem->fastcnt))
 			err = -EWOULDBLOCK;
+		else
+			__sem_select_signal(sem);
 
 		goto unlock_and_exit;
 	}
@@ -344,17 +426,24 @@ int rt_sem_p_inner(RT_SEM *sem, xntmode_t timeout_mode, RTIME timeout)
 		goto unlock_and_exit;
 	}
 
-	if (sem->count > 0)
-		--sem->count;
+	if (xnsynch_fast_count_wait(sem->fastcnt) == 0) {
+		__sem_select_signal(sem);
+		goto unlock_and_exit;
+	}
+
+	info = xnsynch_sleep_on(&sem->synch_base, timeout, timeout_mode);
+	if (info & XNRMID)
+		err = -EIDRM;	/* Semaphore deleted while pending. */
 	else {
-		info = xnsynch_sleep_on(&sem->synch_base,
-					timeout, timeout_mode);
-		if (info & XNRMID)
-			err = -EIDRM;	/* Semaphore deleted while pending. */
-		else if (info & XNTIMEO)
+		if (info & XNTIMEO)
 			err = -ETIMEDOUT;	/* Timeout. */
 		else if (info & XNBREAK)
 			err = -EINTR;	/* Unblocked. */
+
+		if (!(sem->mode & S_PULSE) &&
+		    !xnsynch_pended_p(&sem->synch_base) &&
+		    !__sem_selected_p(sem))
+			xnsynch_fast_count_settle(sem->fastcnt);
 	}
 
       unlock_and_exit:
@@ -498,6 +587,11 @@ int rt_sem_p_until(RT_SEM *sem, RTIME timeout)
  * waiting task (by queuing order) is immediately unblocked;
  * otherwise, the semaphore value is incremented by one.
  *
+ * When called from user-space, a semaphore no task is pending on is
+ * signaled without entering the kernel, by updating its counter in
+ * the shared semaphore heap. Likewise, rt_sem_p() grabs an available
+ * unit from user-space, provided the caller runs in primary mode.
+ *
  * @param sem The descriptor address of the affected semaphore.
  *
  * @return 0 is returned upon success. Otherwise:
@@ -506,6 +600,9 @@ int rt_sem_p_until(RT_SEM *sem, RTIME timeout)
  *
  * - -EIDRM is returned if @a sem is a deleted semaphore descriptor.
  *
+ * - -EAGAIN is returned if the semaphore value would exceed
+ * 0x7fffffff.
+ *
  * Environments:
  *
  * This service can be called from:
@@ -532,10 +629,18 @@ int rt_sem_v(RT_SEM *sem)
 		goto unlock_and_exit;
 	}
 
-	if (xnsynch_wakeup_one_sleeper(&sem->synch_base) != NULL)
+	if (xnsynch_wakeup_one_sleeper(&sem->synch_base) != NULL) {
+		if (!(sem->mode & S_PULSE) &&
+		    !xnsynch_pended_p(&sem->synch_base) &&
+		    !__sem_selected_p(sem))
+			xnsynch_fast_count_settle(sem->fastcnt);
 		xnpod_schedule();
-	else if (!(sem->mode & S_PULSE))
-		sem->count++;
+	} else if (!(sem->mode & S_PULSE)) {
+		if (xnsynch_fast_count_post(sem->fastcnt, XNSYNCH_FCNT_MASK))
+			err = -EAGAIN;
+		else if (__sem_select_signal(sem))
+			xnpod_schedule();
+	}
 
       unlock_and_exit:
 
@@ -586,11 +691,13 @@ int rt_sem_broadcast(RT_SEM *sem)
 		goto unlock_and_exit;
 	}
 
+	xnarch_atomic_set(sem->fastcnt, (sem->mode & S_PULSE) ?
+			  XNSYNCH_FCNT_WAITERS : 0);
+	__sem_select_signal(sem);
+
 	if (xnsynch_flush(&sem->synch_base, 0) == XNSYNCH_RESCHED)
 		xnpod_schedule();
 
-	sem->count = 0;
-
       unlock_and_exit:
 
 	xnlock_put_irqrestore(&nklock, s);
@@ -643,7 +750,7 @@ int rt_sem_inquire(RT_SEM *sem, RT_SEM_INFO *info)
 	}
 
 	strcpy(info->name, sem->name);
-	info->count = sem->count;
+	info->count = xnsynch_fast_count_get(sem->fastcnt);
 	info->nwaiters = xnsynch_nsleepers(&sem->synch_base);
 
       unlock_and_exit:
@@ -653,6 +760,116 @@ int rt_sem_inquire(RT_SEM *sem, RT_SEM_INFO *info)
 	return err;
 }
 
+#ifdef CONFIG_XENO_OPT_SELECT
+
+/**
+ * @fn int rt_sem_select_bind(RT_SEM *sem,struct xnselector *selector,unsigned type,unsigned index)
+ *
+ * @brief Bind a semaphore to a selector.
+ *
+ * Have the @a selector watch the semaphore, so that xnselect()
+ * reports bit @a index of the XNSELECT_READ set while the semaphore
+ * count is positive. Since units may be taken from user-space
+ * without entering the kernel, readiness is only a hint: the
+ * selecting task should take the unit with a non-blocking rt_sem_p().
+ *
+ * @param sem The descriptor address of the semaphore to watch.
+ *
+ * @param selector The selector to bind the semaphore to.
+ *
+ * @param type The event type, only XNSELECT_READ is supported.
+ *
+ * @param index The index of the semaphore in the selector sets.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a sem is not a semaphore descriptor, or
+ * is a pulse semaphore, which never holds any unit, or @a index is
+ * out of range.
+ *
+ * - -EIDRM is returned if @a sem is a deleted semaphore descriptor.
+ *
+ * - -EBADF is returned if @a type is not XNSELECT_READ.
+ *
+ * - -ENOMEM is returned if the binding cannot be allocated.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: possible.
+ */
+
+int rt_sem_select_bind(RT_SEM *sem, struct xnselector *selector,
+		       unsigned type, unsigned index)
+{
+	struct xnselect_binding *binding;
+	int err;
+	spl_t s;
+
+	if (type != XNSELECT_READ)
+		return -EBADF;
+
+	binding = xnmalloc(sizeof(*binding));
+	if (binding == NULL)
+		return -ENOMEM;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	sem = xeno_h2obj_validate(sem, XENO_SEM_MAGIC, RT_SEM);
+	if (sem == NULL) {
+		err = xeno_handle_error(sem, XENO_SEM_MAGIC, RT_SEM);
+		goto unlock_and_error;
+	}
+
+	if (sem->mode & S_PULSE) {
+		err = -EINVAL;
+		goto unlock_and_error;
+	}
+
+	err = xnselect_bind(&sem->read_select, binding, selector, type, index,
+			    xnsynch_fast_count_get(sem->fastcnt) != 0);
+	if (err)
+		goto unlock_and_error;
+
+	__sem_select_signal(sem);
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+
+      unlock_and_error:
+
+	xnlock_put_irqrestore(&nklock, s);
+	xnfree(binding);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(rt_sem_select_bind);
+
+/*
+ * Units may have been taken from user-space, update the selector
+ * state before waiting on it.
+ */
+void __native_sem_select_update(RT_SEM *sem)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	sem = xeno_h2obj_validate(sem, XENO_SEM_MAGIC, RT_SEM);
+	if (sem)
+		__sem_select_signal(sem);
+
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+#endif /* CONFIG_XENO_OPT_SELECT */
+
 /**
  * @fn int rt_sem_bind(RT_SEM *sem,const char *name,RTIME timeout)
  * @brief Bind to a semaphore.
@@ -726,16 +943,37 @@ int rt_sem_inquire(RT_SEM *sem, RT_SEM_INFO *info)
  * Rescheduling: never.
  */
 
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+
+xnobjpool_t __native_sem_pool;
+
 int __native_sem_pkg_init(void)
 {
+	xnobjpool_init(&__native_sem_pool, "native.sem", sizeof(RT_SEM),
+		       CONFIG_XENO_OPT_NATIVE_SEM_POOLSZ);
 	return 0;
 }
 
 void __native_sem_pkg_cleanup(void)
 {
 	__native_sem_flush_rq(&__native_global_rholder.semq);
+	xnobjpool_destroy(&__native_sem_pool);
 }
 
+#else /* !CONFIG_XENO_OPT_PERVASIVE */
+
+int __native_sem_pkg_init(void)
+{
+	return 0;
+}
+
+void __native_sem_pkg_cleanup(void)
+{
+	__native_sem_flush_rq(&__native_global_rholder.semq);
+}
+
+#endif /* !CONFIG_XENO_OPT_PERVASIVE */
+
 /*@}*/
 
 EXPORT_SYMBOL_GPL(rt_sem_create);
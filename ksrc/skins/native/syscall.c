@@ -36,10 +36,13 @@
 #include <native/queue.h>
 #include <native/heap.h>
 #include <native/alarm.h>
+#include <native/cyclic.h>
 #include <native/intr.h>
 #include <native/pipe.h>
 #include <native/buffer.h>
+#include <native/ring.h>
 #include <native/misc.h>
+#include <native/select.h>
 
 #define rt_task_errno (*xnthread_get_errno_location(xnpod_current_thread()))
 
@@ -290,6 +293,58 @@ static int __rt_task_start(struct pt_regs *regs)
 			     (void *)__xn_reg_arg3(regs));
 }
 
+/*
+ * int __rt_task_start_batch(RT_TASK_SPEC *specv,
+ *                           int count,
+ *                           RTIME *datep)
+ */
+
+static int __rt_task_start_batch(struct pt_regs *regs)
+{
+	RT_TASK_SPEC *specv;
+	RT_TASK_PLACEHOLDER ph;
+	int count, n, ret;
+	RTIME date;
+
+	count = __xn_reg_arg2(regs);
+	if (count <= 0 || count > INT_MAX / sizeof(*specv))
+		return -EINVAL;
+
+	if (__xn_safe_copy_from_user(&date, (void __user *)__xn_reg_arg3(regs),
+				     sizeof(date)))
+		return -EFAULT;
+
+	specv = xnmalloc(count * sizeof(*specv));
+	if (specv == NULL)
+		return -ENOMEM;
+
+	if (__xn_safe_copy_from_user(specv, (void __user *)__xn_reg_arg1(regs),
+				     count * sizeof(*specv))) {
+		ret = -EFAULT;
+		goto out;
+	}
+
+	/* Resolve the placeholders into task descriptors. */
+	for (n = 0; n < count; n++) {
+		if (__xn_safe_copy_from_user(&ph, (void __user *)specv[n].task,
+					     sizeof(ph))) {
+			ret = -EFAULT;
+			goto out;
+		}
+		specv[n].task = __rt_task_lookup(ph.opaque);
+		if (specv[n].task == NULL) {
+			ret = -ESRCH;
+			goto out;
+		}
+	}
+
+	ret = rt_task_start_batch(specv, count, date);
+out:
+	xnfree(specv);
+
+	return ret;
+}
+
 /*
  * int __rt_task_suspend(RT_TASK_PLACEHOLDER *ph)
  */
@@ -542,6 +597,11 @@ static int __rt_task_inquire(struct pt_regs *regs)
 	if (err)
 		return err;
 
+	/* Account for a scheduler lock held from the state window. */
+	if (task->thread_base.u_window &&
+	    task->thread_base.u_window->schedlck)
+		info.status |= T_LOCK;
+
 	if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg2(regs),
 				   &info, sizeof(info)))
 		return -EFAULT;
@@ -587,7 +647,8 @@ static int __rt_task_notify(struct pt_regs *regs)
 
 static int __rt_task_set_mode(struct pt_regs *regs)
 {
-	int err, setmask, clrmask, mode_r;
+	struct xnthread_user_window *u_window;
+	int err, setmask, clrmask, mode_r, wlocked;
 
 	clrmask = __xn_reg_arg1(regs);
 	if (clrmask & T_CONFORMING)
@@ -601,10 +662,26 @@ static int __rt_task_set_mode(struct pt_regs *regs)
 	 * auto-relax feature, leading to a nop.
 	 */
 	setmask = __xn_reg_arg2(regs) & ~T_CONFORMING;
+
+	/*
+	 * The caller may also hold the scheduler lock from its state
+	 * window. Clearing T_LOCK drops both locks, and the old mode
+	 * reports either.
+	 */
+	u_window = xnshadow_thread(current)->u_window;
+	wlocked = u_window && u_window->schedlck;
+	if (wlocked && (clrmask & T_LOCK)) {
+		u_window->schedlck = 0;
+		u_window->schedpend = 0;
+	}
+
 	err = rt_task_set_mode(clrmask, setmask, &mode_r);
 	if (err)
 		return err;
 
+	if (wlocked)
+		mode_r |= T_LOCK;
+
 	mode_r |= T_CONFORMING;
 
 	if (__xn_reg_arg3(regs) &&
@@ -670,8 +747,63 @@ static int __rt_task_slice(struct pt_regs *regs)
 	return rt_task_slice(task, quantum);
 }
 
+/*
+ * int __rt_task_set_edf(RT_TASK_PLACEHOLDER *ph,
+ *                       RTIME runtime,
+ *                       RTIME period)
+ */
+
+static int __rt_task_set_edf(struct pt_regs *regs)
+{
+	RTIME runtime, period;
+	RT_TASK_PLACEHOLDER ph;
+	RT_TASK *task;
+
+	if (__xn_reg_arg1(regs)) {
+		if (__xn_safe_copy_from_user(&ph,
+					     (void __user *)__xn_reg_arg1(regs),
+					     sizeof(ph)))
+			return -EFAULT;
+
+		task = __rt_task_lookup(ph.opaque);
+	} else
+		task = __rt_task_current(current);
+
+	if (!task)
+		return -ESRCH;
+
+	if (__xn_safe_copy_from_user(&runtime, (void __user *)__xn_reg_arg2(regs),
+				     sizeof(runtime)))
+		return -EFAULT;
+
+	if (__xn_safe_copy_from_user(&period, (void __user *)__xn_reg_arg3(regs),
+				     sizeof(period)))
+		return -EFAULT;
+
+	return rt_task_set_edf(task, runtime, period);
+}
+
 #ifdef CONFIG_XENO_OPT_NATIVE_MPS
 
+/*
+ * Messages are staged in the caller's mailbox when they fit, so that
+ * short transactions involve neither the system heap nor a large
+ * stack frame; a task only takes part in one transaction at a time.
+ */
+static caddr_t __rt_task_get_mbox(RT_TASK *self, size_t size)
+{
+	if (self && size <= sizeof(self->mbox))
+		return self->mbox;
+
+	return xnmalloc(size);
+}
+
+static void __rt_task_put_mbox(RT_TASK *self, caddr_t area)
+{
+	if (area && (self == NULL || area != self->mbox))
+		xnfree(area);
+}
+
 /*
  * int __rt_task_send(RT_TASK_PLACEHOLDER *ph,
  *                    RT_TASK_MCB *mcb_s,
@@ -681,7 +813,7 @@ static int __rt_task_slice(struct pt_regs *regs)
 
 static int __rt_task_send(struct pt_regs *regs)
 {
-	char tmp_buf[RT_MCB_FSTORE_LIMIT];
+	RT_TASK *self = __rt_task_current(current);
 	RT_TASK_MCB mcb_s, mcb_r;
 	caddr_t tmp_area, data_r;
 	RT_TASK_PLACEHOLDER ph;
@@ -726,24 +858,19 @@ static int __rt_task_send(struct pt_regs *regs)
 
 	if (xsize > 0) {
 		/* Try optimizing a bit here: if the cumulated message sizes
-		   (initial+reply) can fit into our local buffer, use it;
+		   (initial+reply) can fit into our mailbox, use it;
 		   otherwise, take the slow path and fetch a larger buffer
 		   from the system heap. Most messages are expected to be
-		   short enough to fit on the stack anyway. */
-
-		if (xsize <= sizeof(tmp_buf))
-			tmp_area = tmp_buf;
-		else {
-			tmp_area = xnmalloc(xsize);
+		   short enough to fit in the mailbox anyway. */
 
-			if (!tmp_area)
-				return -ENOMEM;
-		}
+		tmp_area = __rt_task_get_mbox(self, xsize);
+		if (!tmp_area)
+			return -ENOMEM;
 
 		if (mcb_s.size > 0 &&
-		    __xn_safe_copy_from_user(tmp_area,
-					     (void __user *)mcb_s.data,
-					     mcb_s.size)) {
+		    __xn_safe_copy_from_user_bulk(tmp_area,
+						  (void __user *)mcb_s.data,
+						  mcb_s.size)) {
 			err = -EFAULT;
 			goto out;
 		}
@@ -769,8 +896,7 @@ static int __rt_task_send(struct pt_regs *regs)
 	}
 
 out:
-	if (tmp_area && tmp_area != tmp_buf)
-		xnfree(tmp_area);
+	__rt_task_put_mbox(self, tmp_area);
 
 	return err;
 }
@@ -782,7 +908,7 @@ out:
 
 static int __rt_task_receive(struct pt_regs *regs)
 {
-	char tmp_buf[RT_MCB_FSTORE_LIMIT];
+	RT_TASK *self = __rt_task_current(current);
 	caddr_t tmp_area, data_r;
 	RT_TASK_MCB mcb_r;
 	RTIME timeout;
@@ -800,18 +926,13 @@ static int __rt_task_receive(struct pt_regs *regs)
 
 	if (mcb_r.size > 0) {
 		/* Same optimization as in __rt_task_send(): if the size of
-		   the reply message can fit into our local buffer, use it;
+		   the reply message can fit into our mailbox, use it;
 		   otherwise, take the slow path and fetch a larger buffer
 		   from the system heap. */
 
-		if (mcb_r.size <= sizeof(tmp_buf))
-			tmp_area = tmp_buf;
-		else {
-			tmp_area = xnmalloc(mcb_r.size);
-
-			if (!tmp_area)
-				return -ENOMEM;
-		}
+		tmp_area = __rt_task_get_mbox(self, mcb_r.size);
+		if (!tmp_area)
+			return -ENOMEM;
 
 		mcb_r.data = tmp_area;
 	} else
@@ -834,8 +955,7 @@ static int __rt_task_receive(struct pt_regs *regs)
 		err = -EFAULT;
 
 out:
-	if (tmp_area && tmp_area != tmp_buf)
-		xnfree(tmp_area);
+	__rt_task_put_mbox(self, tmp_area);
 
 	return err;
 }
@@ -847,7 +967,7 @@ out:
 
 static int __rt_task_reply(struct pt_regs *regs)
 {
-	char tmp_buf[RT_MCB_FSTORE_LIMIT];
+	RT_TASK *self = __rt_task_current(current);
 	RT_TASK_MCB mcb_s;
 	caddr_t tmp_area;
 	int flowid, err;
@@ -866,21 +986,17 @@ static int __rt_task_reply(struct pt_regs *regs)
 
 	if (mcb_s.size > 0) {
 		/* Same optimization as in __rt_task_send(): if the size of
-		   the reply message can fit into our local buffer, use it;
+		   the reply message can fit into our mailbox, use it;
 		   otherwise, take the slow path and fetch a larger buffer
 		   from the system heap. */
 
-		if (mcb_s.size <= sizeof(tmp_buf))
-			tmp_area = tmp_buf;
-		else {
-			tmp_area = xnmalloc(mcb_s.size);
-
-			if (!tmp_area)
-				return -ENOMEM;
-		}
+		tmp_area = __rt_task_get_mbox(self, mcb_s.size);
+		if (!tmp_area)
+			return -ENOMEM;
 
-		if (__xn_safe_copy_from_user(tmp_area, (void __user *)mcb_s.data,
-					     mcb_s.size)) {
+		if (__xn_safe_copy_from_user_bulk(tmp_area,
+						  (void __user *)mcb_s.data,
+						  mcb_s.size)) {
 			err = -EFAULT;
 			goto out;
 		}
@@ -892,8 +1008,7 @@ static int __rt_task_reply(struct pt_regs *regs)
 	err = rt_task_reply(flowid, &mcb_s);
 
 out:
-	if (tmp_area && tmp_area != tmp_buf)
-		xnfree(tmp_area);
+	__rt_task_put_mbox(self, tmp_area);
 
 	return err;
 }
@@ -1069,22 +1184,28 @@ static int __rt_sem_create(struct pt_regs *regs)
 	/* Creation mode. */
 	mode = (int)__xn_reg_arg4(regs);
 
-	sem = (RT_SEM *)xnmalloc(sizeof(*sem));
+	sem = (RT_SEM *)xnobjpool_alloc(&__native_sem_pool);
 
 	if (!sem)
 		return -ENOMEM;
 
-	err = rt_sem_create(sem, name, icount, mode);
+	err = rt_sem_create_inner(sem, name, icount, mode, *name != '\0');
 
 	if (err == 0) {
 		sem->cpid = current->pid;
 		/* Copy back the registry handle to the ph struct. */
 		ph.opaque = sem->handle;
+#ifdef CONFIG_XENO_FASTSYNCH
+		/* The counter address will be finished in user space. */
+		ph.fastcnt = (void *)
+			xnheap_mapped_offset(&xnsys_ppd_get(*name != '\0')->sem_heap,
+					     sem->fastcnt);
+#endif /* CONFIG_XENO_FASTSYNCH */
 		if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg1(regs), &ph,
 					   sizeof(ph)))
 			err = -EFAULT;
 	} else
-		xnfree(sem);
+		xnobjpool_free(&__native_sem_pool, sem);
 
 	return err;
 }
@@ -1098,15 +1219,22 @@ static int __rt_sem_create(struct pt_regs *regs)
 static int __rt_sem_bind(struct pt_regs *regs)
 {
 	RT_SEM_PLACEHOLDER ph;
+	RT_SEM *sem;
 	int err;
 
 	err =
 	    __rt_bind_helper(current, regs, &ph.opaque, XENO_SEM_MAGIC,
-			     NULL, 0);
+			     (void **)&sem, 0);
 
 	if (err)
 		return err;
 
+#ifdef CONFIG_XENO_FASTSYNCH
+	ph.fastcnt =
+		(void *)xnheap_mapped_offset(&xnsys_ppd_get(1)->sem_heap,
+					     sem->fastcnt);
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 	if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg1(regs), &ph,
 				   sizeof(ph)))
 		return -EFAULT;
@@ -1136,7 +1264,7 @@ static int __rt_sem_delete(struct pt_regs *regs)
 	err = rt_sem_delete(sem);
 
 	if (!err && sem->cpid)
-		xnfree(sem);
+		xnobjpool_free(&__native_sem_pool, sem);
 
 	return err;
 }
@@ -1290,22 +1418,28 @@ static int __rt_event_create(struct pt_regs *regs)
 	/* Creation mode. */
 	mode = (int)__xn_reg_arg4(regs);
 
-	event = (RT_EVENT *)xnmalloc(sizeof(*event));
+	event = (RT_EVENT *)xnobjpool_alloc(&__native_event_pool);
 
 	if (!event)
 		return -ENOMEM;
 
-	err = rt_event_create(event, name, ivalue, mode);
+	err = rt_event_create_inner(event, name, ivalue, mode, *name != '\0');
 
 	if (err == 0) {
 		event->cpid = current->pid;
 		/* Copy back the registry handle to the ph struct. */
 		ph.opaque = event->handle;
+#ifdef CONFIG_XENO_FASTSYNCH
+		/* The state address will be finished in user space. */
+		ph.state = (void *)
+			xnheap_mapped_offset(&xnsys_ppd_get(*name != '\0')->sem_heap,
+					     event->state);
+#endif /* CONFIG_XENO_FASTSYNCH */
 		if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg1(regs), &ph,
 					   sizeof(ph)))
 			err = -EFAULT;
 	} else
-		xnfree(event);
+		xnobjpool_free(&__native_event_pool, event);
 
 	return err;
 }
@@ -1319,15 +1453,22 @@ static int __rt_event_create(struct pt_regs *regs)
 static int __rt_event_bind(struct pt_regs *regs)
 {
 	RT_EVENT_PLACEHOLDER ph;
+	RT_EVENT *event;
 	int err;
 
 	err =
 	    __rt_bind_helper(current, regs, &ph.opaque, XENO_EVENT_MAGIC,
-			     NULL, 0);
+			     (void **)&event, 0);
 
 	if (err)
 		return err;
 
+#ifdef CONFIG_XENO_FASTSYNCH
+	ph.state =
+		(void *)xnheap_mapped_offset(&xnsys_ppd_get(1)->sem_heap,
+					     event->state);
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 	if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg1(regs), &ph,
 				   sizeof(ph)))
 		return -EFAULT;
@@ -1357,7 +1498,7 @@ static int __rt_event_delete(struct pt_regs *regs)
 	err = rt_event_delete(event);
 
 	if (!err && event->cpid)
-		xnfree(event);
+		xnobjpool_free(&__native_event_pool, event);
 
 	return err;
 }
@@ -1398,7 +1539,8 @@ static int __rt_event_wait(struct pt_regs *regs)
 				     sizeof(timeout)))
 		return -EFAULT;
 
-	err = rt_event_wait_inner(event, mask, &mask_r, mode, timeout_mode, timeout);
+	err = rt_event_wait_inner(event, mask, &mask_r, NULL,
+				  mode, timeout_mode, timeout);
 
 	if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg2(regs), &mask_r,
 				   sizeof(mask_r)))
@@ -1407,6 +1549,65 @@ static int __rt_event_wait(struct pt_regs *regs)
 	return err;
 }
 
+/*
+ * int __rt_event_wait_count(RT_EVENT_PLACEHOLDER *ph,
+ *                           unsigned long *mask_io,
+ *                           int mode,
+ *                           RTIME *timeoutp,
+ *                           unsigned long *counts)
+ */
+
+static int __rt_event_wait_count(struct pt_regs *regs)
+{
+	unsigned long mask, mask_r, counts[EV_NBITS], rest;
+	unsigned long __user *u_counts;
+	RT_EVENT_PLACEHOLDER ph;
+	RT_EVENT *event;
+	RTIME timeout;
+	int mode, err, bit;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	if (__xn_safe_copy_from_user(&mask, (void __user *)__xn_reg_arg2(regs),
+				     sizeof(mask)))
+		return -EFAULT;
+
+	event = (RT_EVENT *)xnregistry_fetch(ph.opaque);
+	if (!event)
+		return -ESRCH;
+
+	mode = (int)__xn_reg_arg3(regs);
+
+	if (__xn_safe_copy_from_user(&timeout, (void __user *)__xn_reg_arg4(regs),
+				     sizeof(timeout)))
+		return -EFAULT;
+
+	u_counts = (unsigned long __user *)__xn_reg_arg5(regs);
+
+	err = rt_event_wait_inner(event, mask, &mask_r,
+				  u_counts ? counts : NULL,
+				  mode, XN_RELATIVE, timeout);
+
+	if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg2(regs), &mask_r,
+				   sizeof(mask_r)))
+		return -EFAULT;
+
+	/* Only the counts of the flags granted are significant. */
+	if (err || u_counts == NULL)
+		return err;
+
+	for (rest = mask_r; rest; rest &= ~(1UL << bit)) {
+		bit = ffnz(rest);
+		if (__xn_safe_copy_to_user(&u_counts[bit], &counts[bit],
+					   sizeof(counts[bit])))
+			return -EFAULT;
+	}
+
+	return 0;
+}
+
 /*
  * int __rt_event_signal(RT_EVENT_PLACEHOLDER *ph,
  *                       unsigned long mask)
@@ -1504,6 +1705,7 @@ static int __rt_event_inquire(struct pt_regs *regs)
 #define __rt_event_bind    __rt_call_not_available
 #define __rt_event_delete  __rt_call_not_available
 #define __rt_event_wait    __rt_call_not_available
+#define __rt_event_wait_count __rt_call_not_available
 #define __rt_event_signal  __rt_call_not_available
 #define __rt_event_clear   __rt_call_not_available
 #define __rt_event_inquire __rt_call_not_available
@@ -1512,12 +1714,7 @@ static int __rt_event_inquire(struct pt_regs *regs)
 
 #ifdef CONFIG_XENO_OPT_NATIVE_MUTEX
 
-/*
- * int __rt_mutex_create(RT_MUTEX_PLACEHOLDER *ph,
- *                       const char *name)
- */
-
-static int __rt_mutex_create(struct pt_regs *regs)
+static int __rt_mutex_create_inner(struct pt_regs *regs, int ceiling)
 {
 	char name[XNOBJECT_NAME_LEN];
 	xnheap_t *sem_heap;
@@ -1537,12 +1734,12 @@ static int __rt_mutex_create(struct pt_regs *regs)
 
 	sem_heap = &xnsys_ppd_get(*name != '\0')->sem_heap;
 
-	mutex = (RT_MUTEX *)xnmalloc(sizeof(*mutex));
+	mutex = (RT_MUTEX *)xnobjpool_alloc(&__native_mutex_pool);
 
 	if (!mutex)
 		return -ENOMEM;
 
-	err = rt_mutex_create_inner(mutex, name, *name != '\0');
+	err = rt_mutex_create_inner(mutex, name, *name != '\0', ceiling);
 	if (err < 0)
 		goto err_free_mutex;
 
@@ -1566,10 +1763,36 @@ static int __rt_mutex_create(struct pt_regs *regs)
   err_delete_mutex:
 	rt_mutex_delete(mutex);
   err_free_mutex:
-	xnfree(mutex);
+	xnobjpool_free(&__native_mutex_pool, mutex);
 	return err;
 }
 
+/*
+ * int __rt_mutex_create(RT_MUTEX_PLACEHOLDER *ph,
+ *                       const char *name)
+ */
+
+static int __rt_mutex_create(struct pt_regs *regs)
+{
+	return __rt_mutex_create_inner(regs, -1);
+}
+
+/*
+ * int __rt_mutex_create_ceiling(RT_MUTEX_PLACEHOLDER *ph,
+ *                               const char *name,
+ *                               int ceiling)
+ */
+
+static int __rt_mutex_create_ceiling(struct pt_regs *regs)
+{
+	int ceiling = __xn_reg_arg3(regs);
+
+	if (ceiling < T_LOPRIO || ceiling > T_HIPRIO)
+		return -EINVAL;
+
+	return __rt_mutex_create_inner(regs, ceiling);
+}
+
 /*
  * int __rt_mutex_bind(RT_MUTEX_PLACEHOLDER *ph,
  *                     const char *name,
@@ -1624,7 +1847,7 @@ static int __rt_mutex_delete(struct pt_regs *regs)
 	err = rt_mutex_delete(mutex);
 
 	if (!err && mutex->cpid)
-		xnfree(mutex);
+		xnobjpool_free(&__native_mutex_pool, mutex);
 
 	return err;
 }
@@ -1719,6 +1942,7 @@ static int __rt_mutex_inquire(struct pt_regs *regs)
 #else /* !CONFIG_XENO_OPT_NATIVE_MUTEX */
 
 #define __rt_mutex_create  __rt_call_not_available
+#define __rt_mutex_create_ceiling __rt_call_not_available
 #define __rt_mutex_bind    __rt_call_not_available
 #define __rt_mutex_delete  __rt_call_not_available
 #define __rt_mutex_acquire __rt_call_not_available
@@ -1751,7 +1975,7 @@ static int __rt_cond_create(struct pt_regs *regs)
 	} else
 		*name = '\0';
 
-	cond = (RT_COND *)xnmalloc(sizeof(*cond));
+	cond = (RT_COND *)xnobjpool_alloc(&__native_cond_pool);
 
 	if (!cond)
 		return -ENOMEM;
@@ -1766,7 +1990,7 @@ static int __rt_cond_create(struct pt_regs *regs)
 					   sizeof(ph)))
 			err = -EFAULT;
 	} else
-		xnfree(cond);
+		xnobjpool_free(&__native_cond_pool, cond);
 
 	return err;
 }
@@ -1818,7 +2042,7 @@ static int __rt_cond_delete(struct pt_regs *regs)
 	err = rt_cond_delete(cond);
 
 	if (!err && cond->cpid)
-		xnfree(cond);
+		xnobjpool_free(&__native_cond_pool, cond);
 
 	return err;
 }
@@ -2346,7 +2570,7 @@ static int __rt_queue_write(struct pt_regs *regs)
 
 	if (size > 0) {
 		/* Slurp the message directly into the conveying buffer. */
-		if (__xn_safe_copy_from_user(mbuf, buf, size)) {
+		if (__xn_safe_copy_from_user_bulk(mbuf, buf, size)) {
 			rt_queue_free(q, mbuf);
 			return -EFAULT;
 		}
@@ -2421,6 +2645,168 @@ out:
 	return err;
 }
 
+/*
+ * Number of message vectors converted per step by the batch
+ * services, bounding the stack footprint and the nklock section.
+ */
+#define RT_QUEUE_BATCH_CHUNK  16
+
+/*
+ * int __rt_queue_receive_batch(RT_QUEUE_PLACEHOLDER *ph,
+ *                              RT_QUEUE_MSGV *msgv,
+ *                              int nmsg,
+ *                              xntmode_t timeout_mode,
+ *                              RTIME *timeoutp)
+ */
+
+static int __rt_queue_receive_batch(struct pt_regs *regs)
+{
+	RT_QUEUE_MSGV msgv[RT_QUEUE_BATCH_CHUNK];
+	RT_QUEUE_MSGV __user *u_msgv;
+	int ret = 0, nmsg, done, n, i;
+	RT_QUEUE_PLACEHOLDER ph;
+	xntmode_t timeout_mode;
+	RTIME timeout;
+	RT_QUEUE *q;
+	spl_t s;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	u_msgv = (RT_QUEUE_MSGV __user *)__xn_reg_arg2(regs);
+	nmsg = (int)__xn_reg_arg3(regs);
+	timeout_mode = __xn_reg_arg4(regs);
+
+	if (nmsg <= 0)
+		return -EINVAL;
+
+	if (__xn_safe_copy_from_user(&timeout, (void __user *)__xn_reg_arg5(regs),
+				     sizeof(timeout)))
+		return -EFAULT;
+
+	for (done = 0; done < nmsg; done += ret) {
+		n = nmsg - done;
+		if (n > RT_QUEUE_BATCH_CHUNK)
+			n = RT_QUEUE_BATCH_CHUNK;
+
+		xnlock_get_irqsave(&nklock, s);
+
+		q = (RT_QUEUE *)xnregistry_fetch(ph.opaque);
+
+		if (!q) {
+			xnlock_put_irqrestore(&nklock, s);
+			ret = -ESRCH;
+			break;
+		}
+
+		/* Only the first step may wait for messages. */
+		ret = rt_queue_receive_batch_inner(q, msgv, n, timeout_mode,
+						   done ? TM_NONBLOCK : timeout);
+		if (ret < 0) {
+			xnlock_put_irqrestore(&nklock, s);
+			break;
+		}
+
+		/* Convert the kernel-based addresses of the buffers to the
+		   equivalent areas into the caller's address space. */
+
+		for (i = 0; i < ret; i++)
+			msgv[i].buf = ph.mapbase +
+				xnheap_mapped_offset(&q->bufpool, msgv[i].buf);
+
+		xnlock_put_irqrestore(&nklock, s);
+
+		if (__xn_safe_copy_to_user(u_msgv + done, msgv,
+					   ret * sizeof(msgv[0]))) {
+			/* Nobody will get these messages, release them. */
+			xnlock_get_irqsave(&nklock, s);
+			q = (RT_QUEUE *)xnregistry_fetch(ph.opaque);
+			if (q) {
+				for (i = 0; i < ret; i++)
+					msgv[i].buf =
+					    xnheap_mapped_address(&q->bufpool,
+								  (caddr_t)msgv[i].buf -
+								  ph.mapbase);
+				rt_queue_free_batch(q, msgv, ret);
+			}
+			xnlock_put_irqrestore(&nklock, s);
+			/* Report the messages the caller did receive. */
+			return done ? done : -EFAULT;
+		}
+
+		if (ret < n) {
+			done += ret;
+			break;
+		}
+	}
+
+	return done ? done : ret;
+}
+
+/*
+ * int __rt_queue_free_batch(RT_QUEUE_PLACEHOLDER *ph,
+ *                           RT_QUEUE_MSGV *msgv,
+ *                           int nmsg)
+ */
+
+static int __rt_queue_free_batch(struct pt_regs *regs)
+{
+	RT_QUEUE_MSGV msgv[RT_QUEUE_BATCH_CHUNK];
+	RT_QUEUE_MSGV __user *u_msgv;
+	int err = 0, nmsg, done, n, i, ret;
+	RT_QUEUE_PLACEHOLDER ph;
+	RT_QUEUE *q;
+	spl_t s;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	u_msgv = (RT_QUEUE_MSGV __user *)__xn_reg_arg2(regs);
+	nmsg = (int)__xn_reg_arg3(regs);
+
+	for (done = 0; done < nmsg; done += n) {
+		n = nmsg - done;
+		if (n > RT_QUEUE_BATCH_CHUNK)
+			n = RT_QUEUE_BATCH_CHUNK;
+
+		if (__xn_safe_copy_from_user(msgv, u_msgv + done,
+					     n * sizeof(msgv[0])))
+			return -EFAULT;
+
+		xnlock_get_irqsave(&nklock, s);
+
+		q = (RT_QUEUE *)xnregistry_fetch(ph.opaque);
+
+		if (!q) {
+			xnlock_put_irqrestore(&nklock, s);
+			return -ESRCH;
+		}
+
+		/* Convert the caller-based addresses of the buffers to the
+		   equivalent areas into the kernel address space. We don't
+		   know whether they are valid memory yet, do not
+		   dereference them. */
+
+		for (i = 0; i < n; i++)
+			if (msgv[i].buf)
+				msgv[i].buf =
+				    xnheap_mapped_address(&q->bufpool,
+							  (caddr_t)msgv[i].buf -
+							  ph.mapbase);
+
+		ret = rt_queue_free_batch(q, msgv, n);
+
+		xnlock_put_irqrestore(&nklock, s);
+
+		if (ret && err == 0)
+			err = ret;
+	}
+
+	return err;
+}
+
 /*
  * int __rt_queue_read(RT_QUEUE_PLACEHOLDER *ph,
  *                     void *buf,
@@ -2537,6 +2923,8 @@ static int __rt_queue_flush(struct pt_regs *regs)
 #define __rt_queue_free      __rt_call_not_available
 #define __rt_queue_send      __rt_call_not_available
 #define __rt_queue_receive   __rt_call_not_available
+#define __rt_queue_receive_batch __rt_call_not_available
+#define __rt_queue_free_batch __rt_call_not_available
 #define __rt_queue_inquire   __rt_call_not_available
 #define __rt_queue_read      __rt_call_not_available
 #define __rt_queue_write     __rt_call_not_available
@@ -2594,6 +2982,7 @@ static int __rt_heap_create(struct pt_regs *regs)
 	ph.opaque2 = &heap->heap_base;
 	ph.mapsize = xnheap_extentsize(&heap->heap_base);
 	ph.area = xnheap_base_memory(&heap->heap_base);
+	ph.mode = heap->mode;
 	if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg1(regs), &ph, sizeof(ph)))
 		return -EFAULT;
 
@@ -2636,6 +3025,7 @@ static int __rt_heap_bind(struct pt_regs *regs)
 	ph.opaque2 = &heap->heap_base;
 	ph.mapsize = xnheap_extentsize(&heap->heap_base);
 	ph.area = xnheap_base_memory(&heap->heap_base);
+	ph.mode = heap->mode;
 
 	xnlock_put_irqrestore(&nklock, s);
 
@@ -2776,33 +3166,154 @@ static int __rt_heap_free(struct pt_regs *regs)
 }
 
 /*
- * int __rt_heap_inquire(RT_HEAP_PLACEHOLDER *ph,
- *                       RT_HEAP_INFO *infop)
+ * int __rt_heap_xfer(RT_HEAP_PLACEHOLDER *ph,
+ *                    struct rt_arg_bulk *bulk)
+ *
+ * Release the bulk->a2 blocks listed at bulk->a1, then allocate up
+ * to bulk->a5 blocks of bulk->a3 bytes without blocking, storing
+ * their addresses at bulk->a4. Returns the number of blocks
+ * allocated.
  */
 
-static int __rt_heap_inquire(struct pt_regs *regs)
+#define RT_HEAP_XFER_MAX  32
+
+static int __rt_heap_xfer(struct pt_regs *regs)
 {
+	void __user *bufv[RT_HEAP_XFER_MAX];
+	struct rt_arg_bulk bulk;
 	RT_HEAP_PLACEHOLDER ph;
-	RT_HEAP_INFO info;
+	int nfree, nalloc, n;
 	RT_HEAP *heap;
+	size_t size;
+	void *buf;
 	int err;
+	spl_t s;
 
 	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
 				     sizeof(ph)))
 		return -EFAULT;
 
-	heap = (RT_HEAP *)xnregistry_fetch(ph.opaque);
-
-	if (!heap)
-		return -ESRCH;
+	if (__xn_safe_copy_from_user(&bulk, (void __user *)__xn_reg_arg2(regs),
+				     sizeof(bulk)))
+		return -EFAULT;
 
-	err = rt_heap_inquire(heap, &info);
+	nfree = (int)bulk.a2;
+	size = (size_t)bulk.a3;
+	nalloc = (int)bulk.a5;
 
-	if (err)
-		return err;
+	if (nfree < 0 || nfree > RT_HEAP_XFER_MAX ||
+	    nalloc < 0 || nalloc > RT_HEAP_XFER_MAX)
+		return -EINVAL;
 
-	if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg2(regs),
-				   &info, sizeof(info)))
+	if (nfree > 0 &&
+	    __xn_safe_copy_from_user(bufv, (void __user *)bulk.a1,
+				     nfree * sizeof(bufv[0])))
+		return -EFAULT;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	heap = (RT_HEAP *)xnregistry_fetch(ph.opaque);
+
+	if (!heap) {
+		err = -ESRCH;
+		goto unlock_and_exit;
+	}
+
+	if (heap->mode & H_SINGLE) {
+		err = -EINVAL;
+		goto unlock_and_exit;
+	}
+
+	for (n = 0; n < nfree; n++) {
+		buf = xnheap_mapped_address(&heap->heap_base,
+					    (caddr_t)bufv[n] - ph.mapbase);
+		err = rt_heap_free(heap, buf);
+		if (err)
+			goto unlock_and_exit;
+	}
+
+	for (n = 0; n < nalloc; n++) {
+		if (rt_heap_alloc(heap, size, TM_NONBLOCK, &buf))
+			break;
+		bufv[n] = ph.mapbase +
+			xnheap_mapped_offset(&heap->heap_base, buf);
+	}
+
+	err = n;
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (err > 0 &&
+	    __xn_safe_copy_to_user((void __user *)bulk.a4, bufv,
+				   err * sizeof(bufv[0])))
+		return -EFAULT;
+
+	return err;
+}
+
+/*
+ * int __rt_heap_inquire(RT_HEAP_PLACEHOLDER *ph,
+ *                       RT_HEAP_INFO *infop)
+ */
+
+static int __rt_heap_inquire(struct pt_regs *regs)
+{
+	RT_HEAP_PLACEHOLDER ph;
+	RT_HEAP_INFO info;
+	RT_HEAP *heap;
+	int err;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	heap = (RT_HEAP *)xnregistry_fetch(ph.opaque);
+
+	if (!heap)
+		return -ESRCH;
+
+	err = rt_heap_inquire(heap, &info);
+
+	if (err)
+		return err;
+
+	if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg2(regs),
+				   &info, sizeof(info)))
+		return -EFAULT;
+
+	return 0;
+}
+
+/*
+ * int __rt_heap_inquire_ext(RT_HEAP_PLACEHOLDER *ph,
+ *                           RT_HEAP_XINFO *xinfop)
+ */
+
+static int __rt_heap_inquire_ext(struct pt_regs *regs)
+{
+	RT_HEAP_PLACEHOLDER ph;
+	RT_HEAP_XINFO xinfo;
+	RT_HEAP *heap;
+	int err;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	heap = (RT_HEAP *)xnregistry_fetch(ph.opaque);
+
+	if (!heap)
+		return -ESRCH;
+
+	err = rt_heap_inquire_ext(heap, &xinfo);
+
+	if (err)
+		return err;
+
+	if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg2(regs),
+				   &xinfo, sizeof(xinfo)))
 		return -EFAULT;
 
 	return 0;
@@ -2815,7 +3326,9 @@ static int __rt_heap_inquire(struct pt_regs *regs)
 #define __rt_heap_delete    __rt_call_not_available
 #define __rt_heap_alloc     __rt_call_not_available
 #define __rt_heap_free      __rt_call_not_available
+#define __rt_heap_xfer      __rt_call_not_available
 #define __rt_heap_inquire   __rt_call_not_available
+#define __rt_heap_inquire_ext __rt_call_not_available
 
 #endif /* CONFIG_XENO_OPT_NATIVE_HEAP */
 
@@ -3033,6 +3546,167 @@ static int __rt_alarm_inquire(struct pt_regs *regs)
 	return 0;
 }
 
+/*
+ * int __rt_alarm_group_create(RT_ALARM_GROUP_PLACEHOLDER *ph,
+ *                             const char *name)
+ */
+
+static int __rt_alarm_group_create(struct pt_regs *regs)
+{
+	struct task_struct *p = current;
+	char name[XNOBJECT_NAME_LEN];
+	RT_ALARM_GROUP_PLACEHOLDER ph;
+	RT_ALARM_GROUP *group;
+	int err;
+
+	if (__xn_reg_arg2(regs)) {
+		if (__xn_safe_strncpy_from_user(name,
+						(const char __user *)__xn_reg_arg2(regs),
+						sizeof(name) - 1) < 0)
+			return -EFAULT;
+
+		name[sizeof(name) - 1] = '\0';
+	} else
+		*name = '\0';
+
+	group = (RT_ALARM_GROUP *)xnmalloc(sizeof(*group));
+
+	if (!group)
+		return -ENOMEM;
+
+	err = rt_alarm_group_create(group, name);
+
+	if (likely(err == 0)) {
+		group->cpid = p->pid;
+		/* Copy back the registry handle to the ph struct. */
+		ph.opaque = group->handle;
+		if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg1(regs), &ph,
+					   sizeof(ph)))
+			err = -EFAULT;
+	} else
+		xnfree(group);
+
+	return err;
+}
+
+/*
+ * int __rt_alarm_group_delete(RT_ALARM_GROUP_PLACEHOLDER *ph)
+ */
+
+static int __rt_alarm_group_delete(struct pt_regs *regs)
+{
+	RT_ALARM_GROUP_PLACEHOLDER ph;
+	RT_ALARM_GROUP *group;
+	int err;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	group = (RT_ALARM_GROUP *)xnregistry_fetch(ph.opaque);
+
+	if (!group)
+		return -ESRCH;
+
+	err = rt_alarm_group_delete(group);
+
+	if (!err && group->cpid)
+		xnfree(group);
+
+	return err;
+}
+
+/*
+ * int __rt_alarm_attach(RT_ALARM_PLACEHOLDER *ph,
+ *                       RT_ALARM_GROUP_PLACEHOLDER *gph)
+ */
+
+static int __rt_alarm_attach(struct pt_regs *regs)
+{
+	RT_ALARM_GROUP_PLACEHOLDER gph;
+	RT_ALARM_GROUP *group = NULL;
+	RT_ALARM_PLACEHOLDER ph;
+	RT_ALARM *alarm;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	alarm = (RT_ALARM *)xnregistry_fetch(ph.opaque);
+
+	if (!alarm)
+		return -ESRCH;
+
+	if (__xn_reg_arg2(regs)) {
+		if (__xn_safe_copy_from_user(&gph,
+					     (void __user *)__xn_reg_arg2(regs),
+					     sizeof(gph)))
+			return -EFAULT;
+
+		group = (RT_ALARM_GROUP *)xnregistry_fetch(gph.opaque);
+
+		if (!group)
+			return -ESRCH;
+	}
+
+	return rt_alarm_attach(alarm, group);
+}
+
+/*
+ * int __rt_alarm_group_wait(RT_ALARM_GROUP_PLACEHOLDER *ph,
+ *                           RT_ALARM_EXPIRY *buf,
+ *                           int nr,
+ *                           RTIME *timeoutp)
+ */
+
+#define ALARM_GROUP_WAIT_BATCH  16
+
+static int __rt_alarm_group_wait(struct pt_regs *regs)
+{
+	RT_ALARM_EXPIRY batch[ALARM_GROUP_WAIT_BATCH];
+	RT_ALARM_GROUP_PLACEHOLDER ph;
+	RT_ALARM_EXPIRY __user *buf;
+	RT_ALARM_GROUP *group;
+	int nr, n, ret = 0;
+	RTIME timeout;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	group = (RT_ALARM_GROUP *)xnregistry_fetch(ph.opaque);
+
+	if (!group)
+		return -ESRCH;
+
+	buf = (RT_ALARM_EXPIRY __user *)__xn_reg_arg2(regs);
+	nr = __xn_reg_arg3(regs);
+
+	if (__xn_safe_copy_from_user(&timeout, (void __user *)__xn_reg_arg4(regs),
+				     sizeof(timeout)))
+		return -EFAULT;
+
+	/*
+	 * Collect by batches on the stack, only the first one may
+	 * wait; the next ones return what is still pending.
+	 */
+	do {
+		n = rt_alarm_group_wait(group, batch,
+					min(nr - ret, ALARM_GROUP_WAIT_BATCH),
+					ret ? TM_NONBLOCK : timeout);
+		if (n < 0)
+			return ret ?: n;
+
+		if (__xn_safe_copy_to_user((void __user *)(buf + ret), batch,
+					   n * sizeof(batch[0])))
+			return -EFAULT;
+
+		ret += n;
+	} while (n == ALARM_GROUP_WAIT_BATCH && ret < nr);
+
+	return ret;
+}
+
 #else /* !CONFIG_XENO_OPT_NATIVE_ALARM */
 
 #define __rt_alarm_create     __rt_call_not_available
@@ -3041,16 +3715,271 @@ static int __rt_alarm_inquire(struct pt_regs *regs)
 #define __rt_alarm_stop       __rt_call_not_available
 #define __rt_alarm_wait       __rt_call_not_available
 #define __rt_alarm_inquire    __rt_call_not_available
+#define __rt_alarm_group_create __rt_call_not_available
+#define __rt_alarm_group_delete __rt_call_not_available
+#define __rt_alarm_attach     __rt_call_not_available
+#define __rt_alarm_group_wait __rt_call_not_available
 
 #endif /* CONFIG_XENO_OPT_NATIVE_ALARM */
 
+#ifdef CONFIG_XENO_OPT_NATIVE_CYCLIC
+
+/*
+ * int __rt_cyclic_create(RT_CYCLIC_PLACEHOLDER *ph,
+ *                        const char *name,
+ *                        RTIME *minorp,
+ *                        int nslots)
+ */
+
+static int __rt_cyclic_create(struct pt_regs *regs)
+{
+	struct task_struct *p = current;
+	char name[XNOBJECT_NAME_LEN];
+	RT_CYCLIC_PLACEHOLDER ph;
+	RT_CYCLIC *cyclic;
+	RTIME minor;
+	int err;
+
+	if (__xn_reg_arg2(regs)) {
+		if (__xn_safe_strncpy_from_user(name,
+						(const char __user *)__xn_reg_arg2(regs),
+						sizeof(name) - 1) < 0)
+			return -EFAULT;
+
+		name[sizeof(name) - 1] = '\0';
+	} else
+		*name = '\0';
+
+	if (__xn_safe_copy_from_user(&minor, (void __user *)__xn_reg_arg3(regs),
+				     sizeof(minor)))
+		return -EFAULT;
+
+	cyclic = (RT_CYCLIC *)xnmalloc(sizeof(*cyclic));
+
+	if (!cyclic)
+		return -ENOMEM;
+
+	err = rt_cyclic_create(cyclic, name, minor, __xn_reg_arg4(regs));
+
+	if (likely(err == 0)) {
+		cyclic->cpid = p->pid;
+		/* Copy back the registry handle to the ph struct. */
+		ph.opaque = cyclic->handle;
+		if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg1(regs), &ph,
+					   sizeof(ph)))
+			err = -EFAULT;
+	} else
+		xnfree(cyclic);
+
+	return err;
+}
+
+/*
+ * int __rt_cyclic_delete(RT_CYCLIC_PLACEHOLDER *ph)
+ */
+
+static int __rt_cyclic_delete(struct pt_regs *regs)
+{
+	RT_CYCLIC_PLACEHOLDER ph;
+	RT_CYCLIC *cyclic;
+	int err;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	cyclic = (RT_CYCLIC *)xnregistry_fetch(ph.opaque);
+
+	if (!cyclic)
+		return -ESRCH;
+
+	err = rt_cyclic_delete(cyclic);
+
+	if (!err && cyclic->cpid)
+		xnfree(cyclic);
+
+	return err;
+}
+
+/*
+ * int __rt_cyclic_attach(RT_CYCLIC_PLACEHOLDER *ph,
+ *                        int slot,
+ *                        RT_TASK_PLACEHOLDER *task)
+ */
+
+static int __rt_cyclic_attach(struct pt_regs *regs)
+{
+	RT_TASK_PLACEHOLDER tph;
+	RT_CYCLIC_PLACEHOLDER ph;
+	RT_TASK *task = NULL;
+	RT_CYCLIC *cyclic;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	cyclic = (RT_CYCLIC *)xnregistry_fetch(ph.opaque);
+
+	if (!cyclic)
+		return -ESRCH;
+
+	if (__xn_reg_arg3(regs)) {
+		if (__xn_safe_copy_from_user(&tph,
+					     (void __user *)__xn_reg_arg3(regs),
+					     sizeof(tph)))
+			return -EFAULT;
+
+		task = __rt_task_lookup(tph.opaque);
+
+		if (!task)
+			return -ESRCH;
+	}
+
+	return rt_cyclic_attach(cyclic, __xn_reg_arg2(regs), task);
+}
+
+/*
+ * int __rt_cyclic_start(RT_CYCLIC_PLACEHOLDER *ph,
+ *			 RTIME *valuep)
+ */
+
+static int __rt_cyclic_start(struct pt_regs *regs)
+{
+	RT_CYCLIC_PLACEHOLDER ph;
+	RT_CYCLIC *cyclic;
+	RTIME value;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	cyclic = (RT_CYCLIC *)xnregistry_fetch(ph.opaque);
+
+	if (!cyclic)
+		return -ESRCH;
+
+	if (__xn_safe_copy_from_user(&value, (void __user *)__xn_reg_arg2(regs),
+				     sizeof(value)))
+		return -EFAULT;
+
+	return rt_cyclic_start(cyclic, value);
+}
+
+/*
+ * int __rt_cyclic_stop(RT_CYCLIC_PLACEHOLDER *ph)
+ */
+
+static int __rt_cyclic_stop(struct pt_regs *regs)
+{
+	RT_CYCLIC_PLACEHOLDER ph;
+	RT_CYCLIC *cyclic;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	cyclic = (RT_CYCLIC *)xnregistry_fetch(ph.opaque);
+
+	if (!cyclic)
+		return -ESRCH;
+
+	return rt_cyclic_stop(cyclic);
+}
+
+/*
+ * int __rt_cyclic_wait(RT_CYCLIC_PLACEHOLDER *ph,
+ *                      unsigned long *overruns_r)
+ */
+
+static int __rt_cyclic_wait(struct pt_regs *regs)
+{
+	RT_CYCLIC_PLACEHOLDER ph;
+	unsigned long overruns;
+	RT_CYCLIC *cyclic;
+	int err;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	cyclic = (RT_CYCLIC *)xnregistry_fetch(ph.opaque);
+
+	if (!cyclic)
+		return -ESRCH;
+
+	err = rt_cyclic_wait(cyclic, &overruns);
+
+	if ((err == 0 || err == -ETIMEDOUT) && __xn_reg_arg2(regs) &&
+	    __xn_safe_copy_to_user((void __user *)__xn_reg_arg2(regs),
+				   &overruns, sizeof(overruns)))
+		return -EFAULT;
+
+	return err;
+}
+
+/*
+ * int __rt_cyclic_inquire(RT_CYCLIC_PLACEHOLDER *ph,
+ *                         RT_CYCLIC_INFO *infop)
+ */
+
+static int __rt_cyclic_inquire(struct pt_regs *regs)
+{
+	RT_CYCLIC_PLACEHOLDER ph;
+	RT_CYCLIC_INFO info;
+	RT_CYCLIC *cyclic;
+	int err;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	cyclic = (RT_CYCLIC *)xnregistry_fetch(ph.opaque);
+
+	if (!cyclic)
+		return -ESRCH;
+
+	err = rt_cyclic_inquire(cyclic, &info);
+
+	if (err)
+		return err;
+
+	if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg2(regs),
+				   &info, sizeof(info)))
+		return -EFAULT;
+
+	return 0;
+}
+
+#else /* !CONFIG_XENO_OPT_NATIVE_CYCLIC */
+
+#define __rt_cyclic_create    __rt_call_not_available
+#define __rt_cyclic_delete    __rt_call_not_available
+#define __rt_cyclic_attach    __rt_call_not_available
+#define __rt_cyclic_start     __rt_call_not_available
+#define __rt_cyclic_stop      __rt_call_not_available
+#define __rt_cyclic_wait      __rt_call_not_available
+#define __rt_cyclic_inquire   __rt_call_not_available
+
+#endif /* CONFIG_XENO_OPT_NATIVE_CYCLIC */
+
 #ifdef CONFIG_XENO_OPT_NATIVE_INTR
 
 int rt_intr_handler(xnintr_t *cookie)
 {
 	RT_INTR *intr = I_DESC(cookie);
+	RT_INTR_WINDOW *win = intr->window;
 
-	++intr->pending;
+	/*
+	 * The window is set before the line is first enabled, and
+	 * user-space objects may not share their IRQ line.
+	 */
+	if (likely(win)) {
+		win->hits++;
+		win->date = xnarch_get_cpu_tsc();
+		win->cpu = xnarch_current_cpu();
+		xnarch_write_memory_barrier();
+		xnarch_atomic_inc(&win->pending);
+	}
 
 	if (xnsynch_nsleepers(&intr->synch_base) > 0)
 		xnsynch_flush(&intr->synch_base, 0);
@@ -3075,6 +4004,8 @@ static int __rt_intr_create(struct pt_regs *regs)
 	struct task_struct *p = current;
 	char name[XNOBJECT_NAME_LEN];
 	RT_INTR_PLACEHOLDER ph;
+	RT_INTR_WINDOW *win;
+	xnheap_t *sem_heap;
 	int err, mode;
 	RT_INTR *intr;
 	unsigned irq;
@@ -3098,23 +4029,40 @@ static int __rt_intr_create(struct pt_regs *regs)
 	if (mode & ~(I_NOAUTOENA | I_PROPAGATE))
 		return -EINVAL;
 
+	/* Named objects may be bound to, share their state globally. */
+	sem_heap = &xnsys_ppd_get(*name != '\0')->sem_heap;
+
+	win = xnheap_alloc(sem_heap, sizeof(*win));
+	if (win == NULL)
+		return -ENOMEM;
+
+	memset(win, 0, sizeof(*win));
+
 	intr = (RT_INTR *)xnmalloc(sizeof(*intr));
 
-	if (!intr)
+	if (!intr) {
+		xnheap_free(sem_heap, win);
 		return -ENOMEM;
+	}
 
 	err = rt_intr_create(intr, name, irq, &rt_intr_handler, NULL, 0);
 
 	if (likely(err == 0)) {
 		intr->mode = mode;
 		intr->cpid = p->pid;
+		intr->wheap = sem_heap;
+		intr->window = win;
 		/* Copy back the registry handle to the ph struct. */
 		ph.opaque = intr->handle;
+		/* The window address will be finished in user space. */
+		ph.window = (void *)xnheap_mapped_offset(sem_heap, win);
 		if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg1(regs), &ph,
 					   sizeof(ph)))
 			err = -EFAULT;
-	} else
+	} else {
 		xnfree(intr);
+		xnheap_free(sem_heap, win);
+	}
 
 	return err;
 }
@@ -3129,13 +4077,23 @@ static int __rt_intr_bind(struct pt_regs *regs)
 {
 	struct task_struct *p = current;
 	RT_INTR_PLACEHOLDER ph;
+	RT_INTR *intr;
 	int err;
 
-	err = __rt_bind_helper(p, regs, &ph.opaque, XENO_INTR_MAGIC, NULL, 0);
+	err = __rt_bind_helper(p, regs, &ph.opaque, XENO_INTR_MAGIC,
+			       (void **)&intr, 0);
 
 	if (err)
 		return err;
 
+	/*
+	 * Objects created from kernel space have no window. Named
+	 * user-space objects have theirs in the global heap.
+	 */
+	ph.window = intr->window ?
+		(void *)xnheap_mapped_offset(&xnsys_ppd_get(1)->sem_heap,
+					     intr->window) : NULL;
+
 	if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg1(regs), &ph,
 				   sizeof(ph)))
 		return -EFAULT;
@@ -3170,6 +4128,12 @@ static int __rt_intr_delete(struct pt_regs *regs)
 	return err;
 }
 
+/* Objects created from kernel space have no pending count. */
+static inline int __intr_consume(RT_INTR *intr)
+{
+	return intr->window ? __rt_intr_consume(intr->window) : 0;
+}
+
 /*
  * int __rt_intr_wait(RT_INTR_PLACEHOLDER *ph,
  *                    RTIME *timeoutp)
@@ -3208,7 +4172,8 @@ static int __rt_intr_wait(struct pt_regs *regs)
 		goto unlock_and_exit;
 	}
 
-	if (!intr->pending) {
+	err = __intr_consume(intr);
+	if (err == 0) {
 		thread = xnpod_current_thread();
 
 		if (xnthread_base_priority(thread) != XNSCHED_IRQ_PRIO) {
@@ -3226,11 +4191,8 @@ static int __rt_intr_wait(struct pt_regs *regs)
 		else if (info & XNBREAK)
 			err = -EINTR;	/* Unblocked. */
 		else
-			err = intr->pending;
-	} else
-		err = intr->pending;
-
-	intr->pending = 0;
+			err = __intr_consume(intr);
+	}
 
       unlock_and_exit:
 
@@ -3515,8 +4477,9 @@ static int __rt_pipe_write(struct pt_regs *regs)
 	if (!msg)
 		return -ENOMEM;
 
-	if (__xn_safe_copy_from_user(P_MSGPTR(msg),
-				     (void __user *)__xn_reg_arg2(regs), size)) {
+	if (__xn_safe_copy_from_user_bulk(P_MSGPTR(msg),
+					  (void __user *)__xn_reg_arg2(regs),
+					  size)) {
 		rt_pipe_free(pipe, msg);
 		return -EFAULT;
 	}
@@ -3590,6 +4553,34 @@ out:
 	return err;
 }
 
+/*
+ * int __rt_pipe_batch(RT_PIPE_PLACEHOLDER *ph,
+ *                     size_t threshold,
+ *                     RTIME *delayp)
+ */
+
+static int __rt_pipe_batch(struct pt_regs *regs)
+{
+	RT_PIPE_PLACEHOLDER ph;
+	RT_PIPE *pipe;
+	RTIME delay;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	pipe = (RT_PIPE *)xnregistry_fetch(ph.opaque);
+
+	if (!pipe)
+		return -ESRCH;
+
+	if (__xn_safe_copy_from_user(&delay, (void __user *)__xn_reg_arg3(regs),
+				     sizeof(delay)))
+		return -EFAULT;
+
+	return rt_pipe_batch(pipe, (size_t)__xn_reg_arg2(regs), delay);
+}
+
 #else /* !CONFIG_XENO_OPT_NATIVE_PIPE */
 
 #define __rt_pipe_create   __rt_call_not_available
@@ -3598,6 +4589,7 @@ out:
 #define __rt_pipe_read     __rt_call_not_available
 #define __rt_pipe_write    __rt_call_not_available
 #define __rt_pipe_stream   __rt_call_not_available
+#define __rt_pipe_batch    __rt_call_not_available
 
 #endif /* CONFIG_XENO_OPT_NATIVE_PIPE */
 
@@ -3846,6 +4838,327 @@ static int __rt_buffer_inquire(struct pt_regs *regs)
 
 #endif /* !CONFIG_XENO_OPT_NATIVE_BUFFER */
 
+#ifdef CONFIG_XENO_OPT_NATIVE_RING
+
+/*
+ * int __rt_ring_create(RT_RING_PLACEHOLDER *ph,
+ *                      const char *name,
+ *                      size_t slotsz,
+ *                      size_t nslots,
+ *                      int mode)
+ */
+
+static int __rt_ring_create(struct pt_regs *regs)
+{
+	char name[XNOBJECT_NAME_LEN];
+	RT_RING_PLACEHOLDER ph;
+	size_t slotsz, nslots;
+	RT_RING *ring;
+	int err, mode;
+
+	if (__xn_reg_arg2(regs)) {
+		if (__xn_safe_strncpy_from_user(name,
+						(const char __user *)__xn_reg_arg2(regs),
+						sizeof(name) - 1) < 0)
+			return -EFAULT;
+
+		name[sizeof(name) - 1] = '\0';
+	} else
+		*name = '\0';
+
+	/* Payload size of a slot. */
+	slotsz = (size_t) __xn_reg_arg3(regs);
+	/* Number of slots. */
+	nslots = (size_t) __xn_reg_arg4(regs);
+	/* Creation mode. */
+	mode = (int)__xn_reg_arg5(regs);
+
+	ring = (RT_RING *)xnmalloc(sizeof(*ring));
+
+	if (!ring)
+		return -ENOMEM;
+
+	err = rt_ring_create(ring, name, slotsz, nslots, mode);
+
+	if (err)
+		goto free_and_fail;
+
+	ring->cpid = current->pid;
+
+	/* Copy back the registry handle to the ph struct. */
+	ph.opaque = ring->handle;
+	ph.opaque2 = &ring->bufpool;
+	ph.mapsize = xnheap_extentsize(&ring->bufpool);
+	ph.area = xnheap_base_memory(&ring->bufpool);
+	ph.ctloff = xnheap_mapped_offset(&ring->bufpool, ring->ctl);
+	ph.nslots = ring->geom.mask + 1;
+	ph.slotsz = ring->geom.slotsz;
+	if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg1(regs), &ph, sizeof(ph)))
+		return -EFAULT;
+
+	return 0;
+
+      free_and_fail:
+
+	xnfree(ring);
+
+	return err;
+}
+
+/*
+ * int __rt_ring_bind(RT_RING_PLACEHOLDER *ph,
+ *                    const char *name,
+ *                    RTIME *timeoutp)
+ */
+
+static int __rt_ring_bind(struct pt_regs *regs)
+{
+	struct task_struct *p = current;
+	RT_RING_PLACEHOLDER ph;
+	RT_RING *ring;
+	int err;
+	spl_t s;
+
+	err =
+	    __rt_bind_helper(p, regs, &ph.opaque, XENO_RING_MAGIC,
+			     (void **)&ring, 0);
+
+	if (err)
+		return err;
+
+	xnlock_get_irqsave(&nklock, s);
+	if (xeno_test_magic(ring, XENO_RING_MAGIC) == 0) {
+		xnlock_put_irqrestore(&nklock, s);
+
+		return -EACCES;
+	}
+	/* Local rings cannot be mapped to user-space. */
+	if ((ring->mode & R_SHARED) == 0) {
+		xnlock_put_irqrestore(&nklock, s);
+
+		return -EPERM;
+	}
+	ph.opaque2 = &ring->bufpool;
+	ph.mapsize = xnheap_extentsize(&ring->bufpool);
+	ph.area = xnheap_base_memory(&ring->bufpool);
+	ph.ctloff = xnheap_mapped_offset(&ring->bufpool, ring->ctl);
+	ph.nslots = ring->geom.mask + 1;
+	ph.slotsz = ring->geom.slotsz;
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg1(regs), &ph, sizeof(ph)))
+		return -EFAULT;
+
+	/* We might need to migrate to secondary mode now for mapping the
+	   ring memory to user-space; since this syscall is conforming, we
+	   might have entered it in primary mode. */
+
+	if (xnpod_primary_p())
+		xnshadow_relax(0, 0);
+
+	return 0;
+}
+
+/*
+ * int __rt_ring_delete(RT_RING_PLACEHOLDER *ph)
+ */
+
+static int __rt_ring_delete(struct pt_regs *regs)
+{
+	RT_RING_PLACEHOLDER ph;
+	RT_RING *ring;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	ring = (RT_RING *)xnregistry_fetch(ph.opaque);
+	if (!ring)
+		return -ESRCH;
+
+	/* Callee will check the ring descriptor for validity again. */
+	return rt_ring_delete_inner(ring, (void __user *)ph.mapbase);
+}
+
+/*
+ * int __rt_ring_write(RT_RING_PLACEHOLDER *ph,
+ *                     const void *buf,
+ *                     size_t size,
+ *                     xntmode_t timeout_mode,
+ *                     RTIME *timeoutp)
+ */
+
+static int __rt_ring_write(struct pt_regs *regs)
+{
+	RT_RING_PLACEHOLDER ph;
+	xntmode_t timeout_mode;
+	struct xnbufd bufd;
+	void __user *ptr;
+	RTIME timeout;
+	RT_RING *ring;
+	size_t size;
+	ssize_t ret;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	if (__xn_safe_copy_from_user(&timeout, (void __user *)__xn_reg_arg5(regs),
+				     sizeof(timeout)))
+		return -EFAULT;
+
+	ptr = (void __user *)__xn_reg_arg2(regs);
+	size = __xn_reg_arg3(regs);
+	timeout_mode = __xn_reg_arg4(regs);
+
+	ring = xnregistry_fetch(ph.opaque);
+	if (ring == NULL)
+		return -ESRCH;
+
+	xnbufd_map_uread(&bufd, ptr, size);
+	ret = rt_ring_write_inner(ring, &bufd, timeout_mode, timeout);
+	xnbufd_unmap_uread(&bufd);
+
+	return ret;
+}
+
+/*
+ * int __rt_ring_read(RT_RING_PLACEHOLDER *ph,
+ *                    void *buf,
+ *                    size_t size,
+ *                    xntmode_t timeout_mode,
+ *                    RTIME *timeoutp)
+ */
+
+static int __rt_ring_read(struct pt_regs *regs)
+{
+	RT_RING_PLACEHOLDER ph;
+	xntmode_t timeout_mode;
+	struct xnbufd bufd;
+	void __user *ptr;
+	RTIME timeout;
+	RT_RING *ring;
+	size_t size;
+	ssize_t ret;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	if (__xn_safe_copy_from_user(&timeout, (void __user *)__xn_reg_arg5(regs),
+				     sizeof(timeout)))
+		return -EFAULT;
+
+	ptr = (void __user *)__xn_reg_arg2(regs);
+	size = __xn_reg_arg3(regs);
+	timeout_mode = __xn_reg_arg4(regs);
+
+	ring = xnregistry_fetch(ph.opaque);
+	if (ring == NULL)
+		return -ESRCH;
+
+	xnbufd_map_uwrite(&bufd, ptr, size);
+	ret = rt_ring_read_inner(ring, &bufd, timeout_mode, timeout);
+	xnbufd_unmap_uwrite(&bufd);
+
+	return ret;
+}
+
+/*
+ * int __rt_ring_wakeup(RT_RING_PLACEHOLDER *ph,
+ *                      int which)
+ */
+
+static int __rt_ring_wakeup(struct pt_regs *regs)
+{
+	RT_RING_PLACEHOLDER ph;
+	RT_RING *ring;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	ring = xnregistry_fetch(ph.opaque);
+	if (ring == NULL)
+		return -ESRCH;
+
+	return rt_ring_wakeup_inner(ring, (int)__xn_reg_arg2(regs));
+}
+
+/*
+ * int __rt_ring_inquire(RT_RING_PLACEHOLDER *ph,
+ *                       RT_RING_INFO *infop)
+ */
+
+static int __rt_ring_inquire(struct pt_regs *regs)
+{
+	RT_RING_PLACEHOLDER ph;
+	RT_RING_INFO info;
+	RT_RING *ring;
+	int ret;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	ring = xnregistry_fetch(ph.opaque);
+	if (ring == NULL)
+		return -ESRCH;
+
+	ret = rt_ring_inquire(ring, &info);
+	if (ret)
+		return ret;
+
+	if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg2(regs),
+				   &info, sizeof(info)))
+		return -EFAULT;
+
+	return 0;
+}
+
+#else /* !CONFIG_XENO_OPT_NATIVE_RING */
+
+#define __rt_ring_create   __rt_call_not_available
+#define __rt_ring_bind     __rt_call_not_available
+#define __rt_ring_delete   __rt_call_not_available
+#define __rt_ring_write    __rt_call_not_available
+#define __rt_ring_read     __rt_call_not_available
+#define __rt_ring_wakeup   __rt_call_not_available
+#define __rt_ring_inquire  __rt_call_not_available
+
+#endif /* !CONFIG_XENO_OPT_NATIVE_RING */
+
+#ifdef CONFIG_XENO_OPT_NATIVE_SELECT
+
+/*
+ * int __rt_select(RT_SELECT_ITEM *items,
+ *                 int nitems,
+ *                 RTIME *timeoutp)
+ */
+
+static int __rt_select(struct pt_regs *regs)
+{
+	RT_TASK *task = __rt_task_current(current);
+	RTIME timeout;
+
+	if (!task)
+		return -EPERM;
+
+	if (__xn_safe_copy_from_user(&timeout, (void __user *)__xn_reg_arg3(regs),
+				     sizeof(timeout)))
+		return -EFAULT;
+
+	return rt_select_inner(task,
+			       (RT_SELECT_ITEM __user *)__xn_reg_arg1(regs),
+			       __xn_reg_arg2(regs), timeout);
+}
+
+#else /* !CONFIG_XENO_OPT_NATIVE_SELECT */
+
+#define __rt_select  __rt_call_not_available
+
+#endif /* !CONFIG_XENO_OPT_NATIVE_SELECT */
+
 /*
  * int __rt_io_get_region(RT_IOREGION_PLACEHOLDER *ph,
  *                        const char *name,
@@ -4021,6 +5334,7 @@ static void *__shadow_eventcb(int event, void *data)
 			return ERR_PTR(-ENOMEM);
 
 		initq(&rh->alarmq);
+		initq(&rh->alarm_groupq);
 		initq(&rh->condq);
 		initq(&rh->eventq);
 		initq(&rh->heapq);
@@ -4031,6 +5345,8 @@ static void *__shadow_eventcb(int event, void *data)
 		initq(&rh->semq);
 		initq(&rh->ioregionq);
 		initq(&rh->bufferq);
+		initq(&rh->ringq);
+		initq(&rh->cyclicq);
 
 		return &rh->ppd;
 
@@ -4038,6 +5354,7 @@ static void *__shadow_eventcb(int event, void *data)
 
 		rh = ppd2rholder((xnshadow_ppd_t *) data);
 		__native_alarm_flush_rq(&rh->alarmq);
+		__native_alarm_group_flush_rq(&rh->alarm_groupq);
 		__native_cond_flush_rq(&rh->condq);
 		__native_event_flush_rq(&rh->eventq);
 		__native_heap_flush_rq(&rh->heapq);
@@ -4048,6 +5365,8 @@ static void *__shadow_eventcb(int event, void *data)
 		__native_sem_flush_rq(&rh->semq);
 		__native_ioregion_flush_rq(&rh->ioregionq);
 		__native_buffer_flush_rq(&rh->bufferq);
+		__native_ring_flush_rq(&rh->ringq);
+		__native_cyclic_flush_rq(&rh->cyclicq);
 
 		xnarch_free_host_mem(rh, sizeof(*rh));
 
@@ -4130,6 +5449,21 @@ static xnsysent_t __systab[] = {
 	[__native_queue_send] = {&__rt_queue_send, __xn_exec_any},
 	[__native_queue_write] = {&__rt_queue_write, __xn_exec_any},
 	[__native_queue_receive] = {&__rt_queue_receive, __xn_exec_primary},
+	[__native_queue_receive_batch] = {&__rt_queue_receive_batch, __xn_exec_primary},
+	[__native_queue_free_batch] = {&__rt_queue_free_batch, __xn_exec_any},
+	[__native_task_set_edf] = {&__rt_task_set_edf, __xn_exec_any},
+	[__native_heap_inquire_ext] = {&__rt_heap_inquire_ext, __xn_exec_any},
+	[__native_task_start_batch] = {&__rt_task_start_batch, __xn_exec_any},
+	[__native_event_wait_count] = {&__rt_event_wait_count, __xn_exec_primary},
+	[__native_mutex_create_ceiling] =
+		{&__rt_mutex_create_ceiling, __xn_exec_any},
+	[__native_cyclic_create] = {&__rt_cyclic_create, __xn_exec_any},
+	[__native_cyclic_delete] = {&__rt_cyclic_delete, __xn_exec_any},
+	[__native_cyclic_attach] = {&__rt_cyclic_attach, __xn_exec_any},
+	[__native_cyclic_start] = {&__rt_cyclic_start, __xn_exec_any},
+	[__native_cyclic_stop] = {&__rt_cyclic_stop, __xn_exec_any},
+	[__native_cyclic_wait] = {&__rt_cyclic_wait, __xn_exec_primary},
+	[__native_cyclic_inquire] = {&__rt_cyclic_inquire, __xn_exec_any},
 	[__native_queue_read] = {&__rt_queue_read, __xn_exec_primary},
 	[__native_queue_inquire] = {&__rt_queue_inquire, __xn_exec_any},
 	[__native_queue_flush] = {&__rt_queue_flush, __xn_exec_any},
@@ -4139,12 +5473,17 @@ static xnsysent_t __systab[] = {
 	[__native_heap_alloc] = {&__rt_heap_alloc, __xn_exec_conforming},
 	[__native_heap_free] = {&__rt_heap_free, __xn_exec_any},
 	[__native_heap_inquire] = {&__rt_heap_inquire, __xn_exec_any},
+	[__native_heap_xfer] = {&__rt_heap_xfer, __xn_exec_any},
 	[__native_alarm_create] = {&__rt_alarm_create, __xn_exec_any},
 	[__native_alarm_delete] = {&__rt_alarm_delete, __xn_exec_any},
 	[__native_alarm_start] = {&__rt_alarm_start, __xn_exec_any},
 	[__native_alarm_stop] = {&__rt_alarm_stop, __xn_exec_any},
 	[__native_alarm_wait] = {&__rt_alarm_wait, __xn_exec_primary},
 	[__native_alarm_inquire] = {&__rt_alarm_inquire, __xn_exec_any},
+	[__native_alarm_group_create] = {&__rt_alarm_group_create, __xn_exec_any},
+	[__native_alarm_group_delete] = {&__rt_alarm_group_delete, __xn_exec_any},
+	[__native_alarm_attach] = {&__rt_alarm_attach, __xn_exec_any},
+	[__native_alarm_group_wait] = {&__rt_alarm_group_wait, __xn_exec_primary},
 	[__native_intr_create] = {&__rt_intr_create, __xn_exec_any},
 	[__native_intr_bind] = {&__rt_intr_bind, __xn_exec_conforming},
 	[__native_intr_delete] = {&__rt_intr_delete, __xn_exec_any},
@@ -4158,6 +5497,7 @@ static xnsysent_t __systab[] = {
 	[__native_pipe_read] = {&__rt_pipe_read, __xn_exec_primary},
 	[__native_pipe_write] = {&__rt_pipe_write, __xn_exec_any},
 	[__native_pipe_stream] = {&__rt_pipe_stream, __xn_exec_any},
+	[__native_pipe_batch] = {&__rt_pipe_batch, __xn_exec_any},
 	[__native_unimp_89] = {&__rt_call_not_available, __xn_exec_any},
 	[__native_io_get_region] = {&__rt_io_get_region, __xn_exec_lostage},
 	[__native_io_put_region] = {&__rt_io_put_region, __xn_exec_lostage},
@@ -4170,6 +5510,14 @@ static xnsysent_t __systab[] = {
 	[__native_buffer_write] = {&__rt_buffer_write, __xn_exec_conforming},
 	[__native_buffer_clear] = {&__rt_buffer_clear, __xn_exec_any},
 	[__native_buffer_inquire] = {&__rt_buffer_inquire, __xn_exec_any},
+	[__native_ring_create] = {&__rt_ring_create, __xn_exec_lostage},
+	[__native_ring_bind] = {&__rt_ring_bind, __xn_exec_conforming},
+	[__native_ring_delete] = {&__rt_ring_delete, __xn_exec_lostage},
+	[__native_ring_write] = {&__rt_ring_write, __xn_exec_conforming},
+	[__native_ring_read] = {&__rt_ring_read, __xn_exec_conforming},
+	[__native_ring_wakeup] = {&__rt_ring_wakeup, __xn_exec_any},
+	[__native_ring_inquire] = {&__rt_ring_inquire, __xn_exec_any},
+	[__native_select] = {&__rt_select, __xn_exec_primary},
 };
 
 static struct xnskin_props __props = {
@@ -50,6 +50,8 @@
 #include <nucleus/assert.h>
 #include <native/task.h>
 #include <native/timer.h>
+#include <native/event.h>
+#include <native/select.h>
 
 static DEFINE_XNQUEUE(__xeno_task_q);
 
@@ -86,6 +88,14 @@ static void __task_delete_hook(xnthread_t *thread)
 
 	xnsynch_destroy(&task->safesynch);
 
+#ifdef CONFIG_XENO_OPT_NATIVE_EVENT
+	/* Deleted while pending on an event group. */
+	if (task->evq)
+		__native_event_forget(task);
+#endif /* CONFIG_XENO_OPT_NATIVE_EVENT */
+
+	__native_select_cleanup(task);
+
 	removeq(&__xeno_task_q, &task->link);
 
 	xeno_mark_deleted(task);
@@ -295,6 +305,10 @@ int rt_task_create(RT_TASK *task,
 	task->overrun = -1;
 	task->cstamp = ++__xeno_task_stamp;
 	task->safelock = 0;
+	task->evq = NULL;
+#ifdef CONFIG_XENO_OPT_NATIVE_SELECT
+	task->selcache = NULL;
+#endif /* CONFIG_XENO_OPT_NATIVE_SELECT */
 	xnsynch_init(&task->safesynch, XNSYNCH_FIFO, NULL);
 
 	xnarch_cpus_clear(task->affinity);
@@ -432,6 +446,187 @@ int rt_task_start(RT_TASK *task, void (*entry) (void *cookie), void *cookie)
 	return ret;
 }
 
+/**
+ * @fn int rt_task_create_batch(RT_TASK_SPEC *specv, int count)
+ * @brief Create a set of real-time tasks.
+ *
+ * Create all tasks described by the @a specv vector, as
+ * rt_task_create() would do for each of them. From user-space, the
+ * new tasks are mapped concurrently instead of one after the other,
+ * which cuts the time needed to set up a large task set.
+ *
+ * @param specv The address of a vector of @a count task
+ * specifications. The @a task, @a name, @a stksize, @a prio and @a
+ * mode fields of each element are passed to rt_task_create(); the
+ * creation status of each task is returned into its @a err field.
+ *
+ * @param count The number of elements in @a specv.
+ *
+ * @return 0 is returned if all tasks were created. Otherwise, the
+ * first error met is returned, and the caller should look at the
+ * individual status of each task to delete those which were
+ * successfully created. Besides the error codes of
+ * rt_task_create():
+ *
+ * - -EINVAL is returned if @a count is not strictly positive.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task (switches to secondary mode)
+ *
+ * Rescheduling: possible.
+ */
+
+int rt_task_create_batch(RT_TASK_SPEC *specv, int count)
+{
+	int n, ret = 0;
+
+	if (count <= 0)
+		return -EINVAL;
+
+	for (n = 0; n < count; n++) {
+		specv[n].err = rt_task_create(specv[n].task, specv[n].name,
+					      specv[n].stksize, specv[n].prio,
+					      specv[n].mode);
+		if (specv[n].err && ret == 0)
+			ret = specv[n].err;
+	}
+
+	return ret;
+}
+
+/**
+ * @fn int rt_task_start_batch(RT_TASK_SPEC *specv, int count, RTIME date)
+ * @brief Start a set of real-time tasks at a common release date.
+ *
+ * Start all tasks described by the @a specv vector, as
+ * rt_task_start() would do for each of them. The whole set is
+ * checked before any task is started, so that none starts if any
+ * element is invalid. Should the nucleus still refuse to start a
+ * task (e.g. one which appears twice in @a specv), the tasks
+ * preceding it in @a specv remain started, and the error is
+ * returned. The scheduler is locked while the set is started, and
+ * all tasks are released at the same date.
+ *
+ * @param specv The address of a vector of @a count task
+ * specifications. The @a task, @a entry and @a cookie fields of each
+ * element are passed to rt_task_start().
+ *
+ * @param count The number of elements in @a specv.
+ *
+ * @param date The absolute date all tasks are released at, or TM_NOW
+ * to release them immediately. Since user-space tasks must switch
+ * to primary mode first when started, @a date should leave enough
+ * time for all of them to do so, for their release to be
+ * simultaneous.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a count is not strictly positive, or
+ * any element refers to an invalid task descriptor.
+ *
+ * - -EIDRM is returned if any element refers to a deleted task
+ * descriptor.
+ *
+ * - -EBUSY is returned if any task is already started, or appears
+ * more than once in @a specv.
+ *
+ * - -ETIMEDOUT is returned if @a date has already elapsed.
+ *
+ * - -EWOULDBLOCK is returned if @a date is not TM_NOW and the system
+ * timer is inactive.
+ *
+ * - -EPERM is returned if this service was called from an
+ * asynchronous context.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: possible.
+ *
+ * @note The @a date value will be interpreted as jiffies if the
+ * native skin is bound to a periodic time base (see
+ * CONFIG_XENO_OPT_NATIVE_PERIOD), or nanoseconds otherwise.
+ */
+
+int rt_task_start_batch(RT_TASK_SPEC *specv, int count, RTIME date)
+{
+	struct xnthread_start_attr attr;
+	int n, ret = 0;
+	RT_TASK *task;
+	spl_t s;
+
+	if (xnpod_asynch_p())
+		return -EPERM;
+
+	if (count <= 0)
+		return -EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (date != TM_NOW) {
+		if (!xntbase_enabled_p(__native_tbase)) {
+			ret = -EWOULDBLOCK;
+			goto unlock_and_exit;
+		}
+		if (date <= xntbase_get_time(__native_tbase)) {
+			ret = -ETIMEDOUT;
+			goto unlock_and_exit;
+		}
+	}
+
+	for (n = 0; n < count; n++) {
+		task = xeno_h2obj_validate(specv[n].task, XENO_TASK_MAGIC, RT_TASK);
+		if (!task) {
+			ret = xeno_handle_error(specv[n].task,
+						XENO_TASK_MAGIC, RT_TASK);
+			goto unlock_and_exit;
+		}
+		if (!xnthread_test_state(&task->thread_base, XNDORMANT)) {
+			ret = -EBUSY;
+			goto unlock_and_exit;
+		}
+	}
+
+	/*
+	 * Starting a task may reschedule; keep the emerging tasks
+	 * from preempting us until the whole set is started.
+	 */
+	__xnpod_lock_sched();
+
+	for (n = 0; n < count; n++) {
+		task = specv[n].task;
+		attr.mode = 0;
+		attr.imask = 0;
+		attr.affinity = task->affinity;
+		attr.entry = specv[n].entry;
+		attr.cookie = specv[n].cookie;
+		ret = xnpod_start_thread(&task->thread_base, &attr);
+		if (ret)
+			break;
+		if (date != TM_NOW)
+			xnpod_suspend_thread(&task->thread_base, XNDELAY,
+					     date, XN_REALTIME, NULL);
+	}
+
+	__xnpod_unlock_sched();
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+
 /**
  * @fn int rt_task_suspend(RT_TASK *task)
  * @brief Suspend a real-time task.
@@ -1159,6 +1354,12 @@ int rt_task_unblock(RT_TASK *task)
  * - User-space task
  *
  * Rescheduling: never.
+ *
+ * @note A user-space task inquiring about itself (i.e. @a task is
+ * NULL) gets the information from the state window the nucleus
+ * shares with it, without issuing any syscall. The execution time
+ * may then be slightly overestimated, by the time spent handling
+ * interrupts since the task was last switched in.
  */
 
 int rt_task_inquire(RT_TASK *task, RT_TASK_INFO *info)
@@ -1467,6 +1668,25 @@ int rt_task_notify(RT_TASK *task, rt_sigset_t signals)
  * inheriting the priority of the running shadow Xenomai thread. Use
  * CONFIG_XENO_OPT_RPIOFF to globally disable priority coupling.
  *
+ * - T_BALANCE allows the load balancer to move the current task to
+ * another CPU of its affinity set, when the CPU it runs on is
+ * overloaded compared to others (see CONFIG_XENO_OPT_SCHED_BALANCE).
+ * This bit is ignored if the load balancer is not enabled.
+ *
+ * - T_FPUEAGER causes the FPU context of the current task to be
+ * switched eagerly, i.e. saved whenever the task is switched out and
+ * initialized before the task resumes if it did not use the FPU
+ * yet, instead of waiting for a first-use fault. This bit has no
+ * effect for tasks which do not use the FPU.
+ *
+ * - T_PREREL causes the periodic timer of the current task to fire
+ * ahead of each release point, by the value of the prerelease_ns
+ * parameter of the nucleus module or by the scheduling latency if
+ * zero. rt_task_wait_period() then busy-waits until the nominal
+ * release date, which removes most of the release jitter at the
+ * expense of some CPU time. This bit takes effect on the next call to
+ * rt_task_set_periodic().
+ *
  * - T_CONFORMING can be passed in @a setmask to switch the current
  * user-space task to its preferred runtime mode. The only meaningful
  * use of this switch is to force a real-time shadow back to primary
@@ -1525,7 +1745,8 @@ int rt_task_set_mode(int clrmask, int setmask, int *mode_r)
 	}
 
 	if (((clrmask | setmask) &
-	     ~(T_LOCK | T_NOSIG | T_WARNSW | T_RPIOFF)) != 0)
+	     ~(T_LOCK | T_NOSIG | T_WARNSW | T_RPIOFF | T_BALANCE |
+	       T_FPUEAGER | T_PREREL)) != 0)
 		return -EINVAL;
 
 	if (!xnpod_primary_p())
@@ -1642,6 +1863,110 @@ int rt_task_slice(RT_TASK *task, RTIME quantum)
 	return ret;
 }
 
+/**
+ * @fn int rt_task_set_edf(RT_TASK *task, RTIME runtime, RTIME period)
+ * @brief Move a task to the earliest-deadline-first scheduling class.
+ *
+ * Attach a constant bandwidth server to a task, which is then
+ * scheduled by increasing absolute deadline, ahead of all
+ * fixed-priority tasks. The task may consume at most @a runtime
+ * ticks of CPU time every @a period ticks; when its budget is
+ * exhausted, the task is throttled until the next period
+ * begins. Calling rt_task_set_edf() on a task which already belongs
+ * to the EDF class updates its reservation. Use
+ * rt_task_set_priority() to move the task back to the fixed-priority
+ * class.
+ *
+ * The current base priority of the task is kept as its preemption
+ * level, which only matters for priority inheritance and wait queue
+ * ordering.
+ *
+ * @param task The descriptor address of the affected task. If @a task
+ * is NULL, the current task is considered.
+ *
+ * @param runtime The CPU budget granted to the task every period,
+ * expressed in ticks (see note).
+ *
+ * @param period The reservation period, expressed in ticks (see
+ * note). @a period shall not be lower than @a runtime.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a task is not a task descriptor, if @a
+ * runtime is zero or greater than @a period, or if the native skin
+ * is clocked by a periodic time base.
+ *
+ * - -EBUSY is returned if granting the reservation would exceed the
+ * bandwidth limit set for the EDF class on the CPU running @a task
+ * (see CONFIG_XENO_OPT_SCHED_EDF_BWLIMIT).
+ *
+ * - -ENOMEM is returned if the system fails to get enough dynamic
+ * memory from the global real-time heap in order to set up the
+ * server.
+ *
+ * - -EPERM is returned if @a task is NULL but not called from a task
+ * context.
+ *
+ * - -ENOSYS is returned if CONFIG_XENO_OPT_SCHED_EDF is disabled.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: possible.
+ *
+ * @note The @a runtime and @a period values are always interpreted as
+ * a count of ticks, which are nanoseconds since the EDF class
+ * requires aperiodic timing.
+ */
+
+int rt_task_set_edf(RT_TASK *task, RTIME runtime, RTIME period)
+{
+#ifdef CONFIG_XENO_OPT_SCHED_EDF
+	union xnsched_policy_param param;
+	int ret;
+	spl_t s;
+
+	if (!task) {
+		if (!xnpod_primary_p())
+			return -EPERM;
+
+		task = xeno_current_task();
+	}
+
+	xnlock_get_irqsave(&nklock, s);
+
+	task = xeno_h2obj_validate(task, XENO_TASK_MAGIC, RT_TASK);
+
+	if (!task) {
+		ret = xeno_handle_error(task, XENO_TASK_MAGIC, RT_TASK);
+		goto unlock_and_exit;
+	}
+
+	param.edf.prio = xnthread_base_priority(&task->thread_base);
+	param.edf.runtime = runtime;
+	param.edf.period = period;
+	ret = xnpod_set_thread_schedparam(&task->thread_base,
+					  &xnsched_class_edf, &param);
+	if (ret)
+		goto unlock_and_exit;
+
+	xnpod_schedule();
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+#else /* !CONFIG_XENO_OPT_SCHED_EDF */
+	return -ENOSYS;
+#endif /* !CONFIG_XENO_OPT_SCHED_EDF */
+}
+
 #ifdef CONFIG_XENO_OPT_NATIVE_MPS
 
 /**
@@ -1750,7 +2075,7 @@ int rt_task_slice(RT_TASK *task, RTIME quantum)
  * allocate some temporary buffer space from the system heap to hold
  * both the sent and the reply data if this cumulated size exceeds a
  * certain amount; the threshold before allocation is currently set to
- * 64 bytes.
+ * 256 bytes.
  */
 
 ssize_t rt_task_send(RT_TASK *task,
@@ -1960,7 +2285,7 @@ ssize_t rt_task_send(RT_TASK *task,
  * @note When called from a user-space task, this service may need to
  * allocate some temporary buffer space from the system heap to hold
  * the received data if the size of the latter exceeds a certain
- * amount; the threshold before allocation is currently set to 64
+ * amount; the threshold before allocation is currently set to 256
  * bytes.
  */
 
@@ -2116,7 +2441,7 @@ int rt_task_receive(RT_TASK_MCB *mcb_r, RTIME timeout)
  * @note When called from a user-space task, this service may need to
  * allocate some temporary buffer space from the system heap to hold
  * the reply data if the size of the latter exceeds a certain amount;
- * the threshold before allocation is currently set to 64 bytes.
+ * the threshold before allocation is currently set to 256 bytes.
  */
 
 int rt_task_reply(int flowid, RT_TASK_MCB *mcb_s)
@@ -2529,6 +2854,8 @@ int rt_task_reply(int flowid, RT_TASK_MCB *mcb_s)
 
 EXPORT_SYMBOL_GPL(rt_task_create);
 EXPORT_SYMBOL_GPL(rt_task_start);
+EXPORT_SYMBOL_GPL(rt_task_create_batch);
+EXPORT_SYMBOL_GPL(rt_task_start_batch);
 EXPORT_SYMBOL_GPL(rt_task_suspend);
 EXPORT_SYMBOL_GPL(rt_task_resume);
 EXPORT_SYMBOL_GPL(rt_task_delete);
@@ -2547,6 +2874,7 @@ EXPORT_SYMBOL_GPL(rt_task_notify);
 EXPORT_SYMBOL_GPL(rt_task_set_mode);
 EXPORT_SYMBOL_GPL(rt_task_self);
 EXPORT_SYMBOL_GPL(rt_task_slice);
+EXPORT_SYMBOL_GPL(rt_task_set_edf);
 #ifdef CONFIG_XENO_OPT_NATIVE_MPS
 EXPORT_SYMBOL_GPL(rt_task_send);
 EXPORT_SYMBOL_GPL(rt_task_receive);
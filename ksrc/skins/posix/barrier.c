@@ -0,0 +1,781 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @ingroup posix
+ * @defgroup posix_barrier Barriers services.
+ *
+ * Barriers services.
+ *
+ * A barrier makes a set of threads wait until all of them reached the
+ * same point. A barrier is created for a fixed number of threads by
+ * pthread_barrier_init(); each call to pthread_barrier_wait() blocks
+ * until this number of threads called it, after which all of them are
+ * released at once and the barrier starts a new cycle.
+ *
+ * In user-space, arrivals are counted in a word shared with the
+ * nucleus, so that only the threads which actually have to block issue
+ * a system call. The last thread to arrive enters the nucleus only if
+ * some of the others went to sleep, and wakes them all up with a single
+ * operation.
+ *
+ * Only pthread_barrier_init() may be used to initialize a barrier.
+ *
+ *@{*/
+
+#include <nucleus/sys_ppd.h>
+#include <posix/barrier.h>
+
+typedef struct pse51_barrier {
+	unsigned magic;
+	xnsynch_t synchbase;
+	xnholder_t link;	/* Link in pse51_barrierq */
+
+#define link2barrier(laddr)						\
+    ((pse51_barrier_t *)(((char *)laddr) - offsetof(pse51_barrier_t, link)))
+
+	xnarch_atomic_t *state;	/* Arrivals, cycle and waiter flag. */
+#ifndef CONFIG_XENO_FASTSYNCH
+	xnarch_atomic_t statebuf;
+#endif /* !CONFIG_XENO_FASTSYNCH */
+	unsigned count;
+	pthread_barrierattr_t attr;
+	pse51_kqueues_t *owningq;
+} pse51_barrier_t;
+
+static const pthread_barrierattr_t default_barrier_attr = {
+	.magic = PSE51_BARRIER_ATTR_MAGIC,
+	.pshared = PTHREAD_PROCESS_PRIVATE
+};
+
+static void barrier_destroy_internal(pse51_barrier_t *barrier,
+				     pse51_kqueues_t *q)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	removeq(&q->barrierq, &barrier->link);
+	/* The wait queue may only be non-empty when called from
+	   pse51_barrierq_cleanup(), hence no rescheduling. */
+	xnsynch_destroy(&barrier->synchbase);
+	xnlock_put_irqrestore(&nklock, s);
+#ifdef CONFIG_XENO_FASTSYNCH
+	xnheap_free(&xnsys_ppd_get(barrier->attr.pshared)->sem_heap,
+		    barrier->state);
+#endif /* CONFIG_XENO_FASTSYNCH */
+	xnfree(barrier);
+}
+
+/**
+ * Initialize a barrier attributes object.
+ *
+ * This service initializes the barrier attributes object @a attr with
+ * default values for all attributes, that is @a PTHREAD_PROCESS_PRIVATE
+ * for the @a pshared attribute.
+ *
+ * @param attr the barrier attributes object to be initialized.
+ *
+ * @return 0 on success;
+ * @return an error number if:
+ * - ENOMEM, the barrier attributes object pointer @a attr is @a NULL.
+ *
+ * @see
+ * <a href="http://www.opengroup.org/onlinepubs/000095399/functions/pthread_barrierattr_init.html">
+ * Specification.</a>
+ *
+ */
+int pthread_barrierattr_init(pthread_barrierattr_t *attr)
+{
+	if (!attr)
+		return ENOMEM;
+
+	*attr = default_barrier_attr;
+
+	return 0;
+}
+
+/**
+ * Destroy a barrier attributes object.
+ *
+ * @param attr the initialized barrier attributes object to be destroyed.
+ *
+ * @return 0 on success;
+ * @return an error number if:
+ * - EINVAL, the barrier attributes object @a attr is invalid.
+ *
+ * @see
+ * <a href="http://www.opengroup.org/onlinepubs/000095399/functions/pthread_barrierattr_destroy.html">
+ * Specification.</a>
+ *
+ */
+int pthread_barrierattr_destroy(pthread_barrierattr_t *attr)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!pse51_obj_active(attr, PSE51_BARRIER_ATTR_MAGIC,
+			      pthread_barrierattr_t)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return EINVAL;
+	}
+
+	pse51_mark_deleted(attr);
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+
+/**
+ * Get the process-shared attribute from a barrier attributes object.
+ *
+ * @param attr a barrier attributes object;
+ *
+ * @param pshared address where the value of the @a pshared attribute will be
+ * stored on success.
+ *
+ * @return 0 on success;
+ * @return an error number if:
+ * - EINVAL, the @a pshared address is invalid;
+ * - EINVAL, the barrier attributes object @a attr is invalid.
+ *
+ * @see
+ * <a href="http://www.opengroup.org/onlinepubs/000095399/functions/pthread_barrierattr_getpshared.html">
+ * Specification.</a>
+ *
+ */
+int pthread_barrierattr_getpshared(const pthread_barrierattr_t *attr,
+				   int *pshared)
+{
+	spl_t s;
+
+	if (!pshared)
+		return EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!pse51_obj_active(attr, PSE51_BARRIER_ATTR_MAGIC,
+			      pthread_barrierattr_t)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return EINVAL;
+	}
+
+	*pshared = attr->pshared;
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+
+/**
+ * Set the process-shared attribute of a barrier attributes object.
+ *
+ * @param attr a barrier attributes object;
+ *
+ * @param pshared value of the @a pshared attribute, either
+ * @a PTHREAD_PROCESS_PRIVATE or @a PTHREAD_PROCESS_SHARED.
+ *
+ * @return 0 on success;
+ * @return an error number if:
+ * - EINVAL, the barrier attributes object @a attr is invalid;
+ * - EINVAL, the value of @a pshared is invalid.
+ *
+ * @see
+ * <a href="http://www.opengroup.org/onlinepubs/000095399/functions/pthread_barrierattr_setpshared.html">
+ * Specification.</a>
+ *
+ */
+int pthread_barrierattr_setpshared(pthread_barrierattr_t *attr, int pshared)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!pse51_obj_active(attr, PSE51_BARRIER_ATTR_MAGIC,
+			      pthread_barrierattr_t)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return EINVAL;
+	}
+
+	switch (pshared) {
+	default:
+		xnlock_put_irqrestore(&nklock, s);
+		return EINVAL;
+
+	case PTHREAD_PROCESS_PRIVATE:
+	case PTHREAD_PROCESS_SHARED:
+		break;
+	}
+
+	attr->pshared = pshared;
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+
+/**
+ * Initialize a barrier.
+ *
+ * This service initializes the barrier @a bar for @a count threads,
+ * using the barrier attributes object @a attr. If @a attr is @a NULL,
+ * default attributes are used (see pthread_barrierattr_init()).
+ *
+ * @param bar the barrier to be initialized;
+ *
+ * @param attr the barrier attributes object;
+ *
+ * @param count the number of threads which must call
+ * pthread_barrier_wait() to complete a cycle.
+ *
+ * @return 0 on success;
+ * @return an error number if:
+ * - EINVAL, the barrier attributes object @a attr is invalid;
+ * - EINVAL, @a count is zero or greater than 32767;
+ * - EBUSY, the barrier @a bar was already initialized;
+ * - ENOMEM, insufficient memory exists in the system heap to initialize the
+ *   barrier, increase CONFIG_XENO_OPT_SYS_HEAPSZ;
+ * - EAGAIN, insufficient memory exists in the semaphore heap to initialize
+ *   the barrier, increase CONFIG_XENO_OPT_GLOBAL_SEM_HEAPSZ for a
+ *   process-shared barrier, or CONFIG_XENO_OPT_SEM_HEAPSZ for a process-private
+ *   barrier.
+ *
+ * @see
+ * <a href="http://www.opengroup.org/onlinepubs/000095399/functions/pthread_barrier_init.html">
+ * Specification.</a>
+ *
+ */
+int pthread_barrier_init(pthread_barrier_t *bar,
+			 const pthread_barrierattr_t *attr,
+			 unsigned count)
+{
+	struct __shadow_barrier *shadow =
+		&((union __xeno_barrier *)bar)->shadow_barrier;
+	pse51_barrier_t *barrier;
+	xnarch_atomic_t *state;
+	xnqueue_t *barrierq;
+	spl_t s;
+	int err;
+
+	if (!attr)
+		attr = &default_barrier_attr;
+
+	if (count == 0 || count > XNSYNCH_FBAR_MAX)
+		return EINVAL;
+
+	barrier = (pse51_barrier_t *)xnmalloc(sizeof(*barrier));
+	if (!barrier)
+		return ENOMEM;
+
+#ifdef CONFIG_XENO_FASTSYNCH
+	state = NULL;
+	if (attr->magic == PSE51_BARRIER_ATTR_MAGIC) {
+		state = (xnarch_atomic_t *)
+			xnheap_alloc(&xnsys_ppd_get(attr->pshared)->sem_heap,
+				     xnheap_synch_size(sizeof(*state), 0));
+		if (!state) {
+			xnfree(barrier);
+			return EAGAIN;
+		}
+	}
+#else /* !CONFIG_XENO_FASTSYNCH */
+	state = &barrier->statebuf;
+#endif /* !CONFIG_XENO_FASTSYNCH */
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (attr->magic != PSE51_BARRIER_ATTR_MAGIC) {
+		err = EINVAL;
+		goto error;
+	}
+
+	barrierq = &pse51_kqueues(attr->pshared)->barrierq;
+
+	if (shadow->magic == PSE51_BARRIER_MAGIC) {
+		xnholder_t *holder;
+		for (holder = getheadq(barrierq); holder;
+		     holder = nextq(barrierq, holder))
+			if (holder == &shadow->barrier->link) {
+				err = EBUSY;
+				goto error;
+			}
+	}
+
+	xnarch_atomic_set(state, 0);
+
+	shadow->magic = PSE51_BARRIER_MAGIC;
+	shadow->barrier = barrier;
+#ifdef CONFIG_XENO_FASTSYNCH
+	shadow->state_offset =
+		xnheap_mapped_offset(&xnsys_ppd_get(attr->pshared)->sem_heap,
+				     state);
+	shadow->pshared = attr->pshared;
+	shadow->count = count;
+#endif /* CONFIG_XENO_FASTSYNCH */
+
+	barrier->magic = PSE51_BARRIER_MAGIC;
+	xnsynch_init(&barrier->synchbase, XNSYNCH_PRIO | XNSYNCH_NOPIP, NULL);
+	inith(&barrier->link);
+	barrier->state = state;
+	barrier->count = count;
+	barrier->attr = *attr;
+	barrier->owningq = pse51_kqueues(attr->pshared);
+
+	appendq(barrierq, &barrier->link);
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+
+  error:
+	xnlock_put_irqrestore(&nklock, s);
+#ifdef CONFIG_XENO_FASTSYNCH
+	if (state)
+		xnheap_free(&xnsys_ppd_get(attr->pshared)->sem_heap, state);
+#endif /* CONFIG_XENO_FASTSYNCH */
+	xnfree(barrier);
+	return err;
+}
+
+/**
+ * Destroy a barrier.
+ *
+ * This service destroys the barrier @a bar, if no thread is currently
+ * waiting on it and no cycle is in progress. The barrier becomes invalid
+ * for all barrier services except pthread_barrier_init().
+ *
+ * @param bar the barrier to be destroyed.
+ *
+ * @return 0 on success;
+ * @return an error number if:
+ * - EINVAL, the barrier @a bar is invalid;
+ * - EPERM, the barrier is not process-shared and does not belong to the
+ *   current process;
+ * - EBUSY, some thread arrived at the barrier in the current cycle.
+ *
+ * @see
+ * <a href="http://www.opengroup.org/onlinepubs/000095399/functions/pthread_barrier_destroy.html">
+ * Specification.</a>
+ *
+ */
+int pthread_barrier_destroy(pthread_barrier_t *bar)
+{
+	struct __shadow_barrier *shadow =
+		&((union __xeno_barrier *)bar)->shadow_barrier;
+	pse51_barrier_t *barrier;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	barrier = shadow->barrier;
+	if (!pse51_obj_active(shadow, PSE51_BARRIER_MAGIC,
+			      struct __shadow_barrier)
+	    || !pse51_obj_active(barrier, PSE51_BARRIER_MAGIC,
+				 struct pse51_barrier)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return EINVAL;
+	}
+
+	if (barrier->owningq != pse51_kqueues(barrier->attr.pshared)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return EPERM;
+	}
+
+	if (xnsynch_nsleepers(&barrier->synchbase) ||
+	    (xnarch_atomic_get(barrier->state) & XNSYNCH_FBAR_MASK)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return EBUSY;
+	}
+
+	pse51_mark_deleted(shadow);
+	pse51_mark_deleted(barrier);
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	barrier_destroy_internal(barrier,
+				 pse51_kqueues(barrier->attr.pshared));
+
+	return 0;
+}
+
+/* must be called with nklock locked, interrupts off. */
+static inline pse51_barrier_t *barrier_get(struct __shadow_barrier *shadow,
+					   int *errp)
+{
+	pse51_barrier_t *barrier = shadow->barrier;
+
+	if (!pse51_obj_active(shadow, PSE51_BARRIER_MAGIC,
+			      struct __shadow_barrier)
+	    || !pse51_obj_active(barrier, PSE51_BARRIER_MAGIC,
+				 struct pse51_barrier)) {
+		*errp = EINVAL;
+		return NULL;
+	}
+
+	if (barrier->owningq != pse51_kqueues(barrier->attr.pshared)) {
+		*errp = EPERM;
+		return NULL;
+	}
+
+	return barrier;
+}
+
+/* must be called with nklock locked, interrupts off. */
+static void barrier_flush(pse51_barrier_t *barrier)
+{
+	if (xnsynch_flush(&barrier->synchbase, 0) == XNSYNCH_RESCHED)
+		xnpod_schedule();
+}
+
+/* must be called with nklock locked, interrupts off. */
+static int barrier_sleep(xnthread_t *cur, pse51_barrier_t *barrier,
+			 unsigned long cycle)
+{
+	/* A flush for an older cycle which raced with our arrival only
+	   sends us back to sleep. */
+	while (xnsynch_fast_barrier_wait(barrier->state, cycle)) {
+		xnsynch_sleep_on(&barrier->synchbase, XN_INFINITE, XN_RELATIVE);
+
+		if (xnthread_test_info(cur, XNRMID))
+			return EINVAL;
+
+		if (xnthread_test_info(cur, XNBREAK))
+			return EINTR;
+	}
+
+	return 0;
+}
+
+/*
+ * Arrive at the barrier from the nucleus. Returns
+ * PTHREAD_BARRIER_SERIAL_THREAD if the caller completed the cycle, 0 if
+ * it has to call pse51_barrier_sleep() for the cycle returned in
+ * @a cyclep, or an error number.
+ */
+int pse51_barrier_arrive(struct __shadow_barrier *shadow,
+			 unsigned long *cyclep)
+{
+	pse51_barrier_t *barrier;
+	int err;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	barrier = barrier_get(shadow, &err);
+	if (!barrier)
+		goto unlock_and_return;
+
+	err = xnsynch_fast_barrier_arrive(barrier->state, barrier->count,
+					  cyclep);
+	if (err == -EAGAIN) {
+		err = 0;
+		goto unlock_and_return;
+	}
+
+	if (err == -EBUSY)
+		barrier_flush(barrier);
+
+	err = PTHREAD_BARRIER_SERIAL_THREAD;
+
+  unlock_and_return:
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
+/*
+ * Wait for the cycle which the caller arrived in to complete. EINTR is
+ * returned if the sleep was broken, in which case the caller should
+ * retry with the same cycle.
+ */
+int pse51_barrier_sleep(xnthread_t *cur,
+			struct __shadow_barrier *shadow,
+			unsigned long cycle)
+{
+	pse51_barrier_t *barrier;
+	int err;
+	spl_t s;
+
+	if (xnpod_unblockable_p())
+		return EPERM;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	barrier = barrier_get(shadow, &err);
+	if (barrier)
+		err = barrier_sleep(cur, barrier, cycle);
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
+/*
+ * Release the sleepers of a cycle completed from user-space, which found
+ * the waiter flag raised.
+ */
+int pse51_barrier_release(struct __shadow_barrier *shadow)
+{
+	pse51_barrier_t *barrier;
+	int err;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	barrier = barrier_get(shadow, &err);
+	if (barrier) {
+		barrier_flush(barrier);
+		err = 0;
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
+/**
+ * Wait on a barrier.
+ *
+ * This service blocks the calling thread until @a count threads, as
+ * specified when initializing the barrier @a bar, called it. The thread
+ * completing the cycle does not block, and wakes up all the others.
+ *
+ * This service is not a cancellation point.
+ *
+ * @param bar the barrier to wait on.
+ *
+ * @return PTHREAD_BARRIER_SERIAL_THREAD for the thread which completed the
+ * cycle, 0 for the other threads;
+ * @return an error number if:
+ * - EINVAL, the barrier @a bar is invalid, or was destroyed while the caller
+ *   was waiting;
+ * - EPERM, the caller context is invalid;
+ * - EPERM, the barrier is not process-shared and does not belong to the
+ *   current process.
+ *
+ * @par Valid contexts:
+ * - Xenomai kernel-space thread,
+ * - Xenomai user-space thread (switches to primary mode).
+ *
+ * @see
+ * <a href="http://www.opengroup.org/onlinepubs/000095399/functions/pthread_barrier_wait.html">
+ * Specification.</a>
+ *
+ */
+int pthread_barrier_wait(pthread_barrier_t *bar)
+{
+	struct __shadow_barrier *shadow =
+		&((union __xeno_barrier *)bar)->shadow_barrier;
+	xnthread_t *cur = xnpod_current_thread();
+	unsigned long cycle;
+	int err;
+
+	if (xnpod_unblockable_p())
+		return EPERM;
+
+	err = pse51_barrier_arrive(shadow, &cycle);
+	if (err)
+		return err;
+
+	do
+		err = pse51_barrier_sleep(cur, shadow, cycle);
+	while (err == EINTR);
+
+	return err;
+}
+
+void pse51_barrierq_cleanup(pse51_kqueues_t *q)
+{
+	xnholder_t *holder;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	while ((holder = getheadq(&q->barrierq)) != NULL) {
+		xnlock_put_irqrestore(&nklock, s);
+		barrier_destroy_internal(link2barrier(holder), q);
+#if XENO_DEBUG(POSIX)
+		xnprintf("Posix: destroying barrier %p.\n",
+			 link2barrier(holder));
+#endif /* XENO_DEBUG(POSIX) */
+		xnlock_get_irqsave(&nklock, s);
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+void pse51_barrier_pkg_init(void)
+{
+	initq(&pse51_global_kqueues.barrierq);
+}
+
+void pse51_barrier_pkg_cleanup(void)
+{
+	pse51_barrierq_cleanup(&pse51_global_kqueues);
+}
+
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+
+/*
+ * Spinlocks are implemented in user-space only, on a state block
+ * allocated in the semaphore heap. The nucleus only hands out those
+ * blocks, and reclaims them when their owning process exits.
+ */
+typedef struct pse51_spin {
+	xnholder_t link;	/* Link in pse51_spinq */
+
+#define link2spin(laddr)						\
+    ((pse51_spin_t *)(((char *)laddr) - offsetof(pse51_spin_t, link)))
+
+	struct pse51_spin_state *state;
+	int pshared;
+} pse51_spin_t;
+
+static void spin_destroy_internal(pse51_spin_t *spin, pse51_kqueues_t *q)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	removeq(&q->spinq, &spin->link);
+	xnlock_put_irqrestore(&nklock, s);
+	xnheap_free(&xnsys_ppd_get(spin->pshared)->sem_heap, spin->state);
+	xnfree(spin);
+}
+
+int pse51_spin_init(int pshared, unsigned *cookiep)
+{
+	struct pse51_spin_state *state;
+	pse51_spin_t *spin;
+	xnheap_t *heap;
+	spl_t s;
+
+	switch (pshared) {
+	default:
+		return EINVAL;
+
+	case PTHREAD_PROCESS_PRIVATE:
+	case PTHREAD_PROCESS_SHARED:
+		break;
+	}
+
+	spin = (pse51_spin_t *)xnmalloc(sizeof(*spin));
+	if (!spin)
+		return ENOMEM;
+
+	heap = &xnsys_ppd_get(pshared)->sem_heap;
+	state = (struct pse51_spin_state *)
+		xnheap_alloc(heap, xnheap_synch_size(sizeof(*state), 0));
+	if (!state) {
+		xnfree(spin);
+		return EAGAIN;
+	}
+
+	xnarch_atomic_set(&state->owner, XN_NO_HANDLE);
+	state->acquired = 0;
+	state->contended = 0;
+
+	inith(&spin->link);
+	spin->state = state;
+	spin->pshared = pshared;
+
+	xnlock_get_irqsave(&nklock, s);
+	appendq(&pse51_kqueues(pshared)->spinq, &spin->link);
+	xnlock_put_irqrestore(&nklock, s);
+
+	*cookiep = xnheap_mapped_offset(heap, state) |
+		(pshared ? PSE51_SPIN_SHARED : 0);
+
+	return 0;
+}
+
+int pse51_spin_destroy(unsigned cookie)
+{
+	int pshared = !!(cookie & PSE51_SPIN_SHARED);
+	struct pse51_spin_state *state;
+	pse51_kqueues_t *q;
+	xnholder_t *holder;
+	pse51_spin_t *spin;
+	spl_t s;
+
+	if (cookie == PSE51_SPIN_INVALID)
+		return EINVAL;
+
+	state = (struct pse51_spin_state *)
+		xnheap_mapped_address(&xnsys_ppd_get(pshared)->sem_heap,
+				      cookie & ~PSE51_SPIN_SHARED);
+	q = pse51_kqueues(pshared);
+
+	xnlock_get_irqsave(&nklock, s);
+
+	for (holder = getheadq(&q->spinq); holder;
+	     holder = nextq(&q->spinq, holder)) {
+		spin = link2spin(holder);
+		if (spin->state == state)
+			goto found;
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return EINVAL;
+
+  found:
+	if (xnarch_atomic_get(&state->owner) != XN_NO_HANDLE) {
+		xnlock_put_irqrestore(&nklock, s);
+		return EBUSY;
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	spin_destroy_internal(spin, q);
+
+	return 0;
+}
+
+void pse51_spinq_cleanup(pse51_kqueues_t *q)
+{
+	xnholder_t *holder;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	while ((holder = getheadq(&q->spinq)) != NULL) {
+		xnlock_put_irqrestore(&nklock, s);
+		spin_destroy_internal(link2spin(holder), q);
+		xnlock_get_irqsave(&nklock, s);
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+void pse51_spin_pkg_init(void)
+{
+	initq(&pse51_global_kqueues.spinq);
+}
+
+void pse51_spin_pkg_cleanup(void)
+{
+	pse51_spinq_cleanup(&pse51_global_kqueues);
+}
+
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+
+/*@}*/
+
+EXPORT_SYMBOL_GPL(pthread_barrierattr_init);
+EXPORT_SYMBOL_GPL(pthread_barrierattr_destroy);
+EXPORT_SYMBOL_GPL(pthread_barrierattr_getpshared);
+EXPORT_SYMBOL_GPL(pthread_barrierattr_setpshared);
+EXPORT_SYMBOL_GPL(pthread_barrier_init);
+EXPORT_SYMBOL_GPL(pthread_barrier_destroy);
+EXPORT_SYMBOL_GPL(pthread_barrier_wait);
@@ -0,0 +1,51 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef _POSIX_BARRIER_H
+#define _POSIX_BARRIER_H
+
+#include <posix/posix.h>
+
+int pse51_barrier_arrive(struct __shadow_barrier *shadow,
+			 unsigned long *cyclep);
+
+int pse51_barrier_sleep(xnthread_t *cur,
+			struct __shadow_barrier *shadow,
+			unsigned long cycle);
+
+int pse51_barrier_release(struct __shadow_barrier *shadow);
+
+void pse51_barrierq_cleanup(pse51_kqueues_t *q);
+
+void pse51_barrier_pkg_init(void);
+
+void pse51_barrier_pkg_cleanup(void);
+
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+
+int pse51_spin_init(int pshared, unsigned *cookiep);
+
+int pse51_spin_destroy(unsigned cookie);
+
+void pse51_spinq_cleanup(pse51_kqueues_t *q);
+
+void pse51_spin_pkg_init(void);
+
+void pse51_spin_pkg_cleanup(void);
+
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+
+#endif /* !_POSIX_BARRIER_H */
@@ -338,7 +338,7 @@ int clock_nanosleep(clockid_t clock_id,
 		if (flags == 0 && rmtp) {
 			xnsticks_t rem;
 
-			rem = xntimer_get_timeout_stopped(&cur->rtimer);
+			rem = xnthread_rtimeout(cur);
 			xnlock_put_irqrestore(&nklock, s);
 
 			ticks2ts(rmtp, rem > 1 ? rem : 0);
@@ -47,6 +47,7 @@
  *
  *@{*/
 
+#include <nucleus/sys_ppd.h>
 #include <posix/mutex.h>
 #include <posix/cond.h>
 
@@ -61,10 +62,32 @@ typedef struct pse51_cond {
 	pthread_condattr_t attr;
 	struct pse51_mutex *mutex;
 	pse51_kqueues_t *owningq;
+#ifdef CONFIG_XENO_FASTSYNCH
+	xnarch_atomic_t *nwaiters; /* Mirrors the sleepers count in user-space. */
+#endif /* CONFIG_XENO_FASTSYNCH */
 } pse51_cond_t;
 
 static pthread_condattr_t default_cond_attr;
 
+static xnobjpool_t cond_pool;
+
+#ifdef CONFIG_XENO_FASTSYNCH
+/* must be called with nklock locked, interrupts off.
+
+   The user-space side of pthread_cond_signal() and
+   pthread_cond_broadcast() skips the syscall when this count is null, so
+   it must never be lower than the number of threads which released the
+   mutex to wait for the condition. It may be transiently higher, which
+   only costs a useless syscall. */
+static inline void cond_update_nwaiters(pse51_cond_t *cond, int extra)
+{
+	xnarch_atomic_set(cond->nwaiters,
+			  xnsynch_nsleepers(&cond->synchbase) + extra);
+}
+#else /* !CONFIG_XENO_FASTSYNCH */
+#define cond_update_nwaiters(cond, extra) do { } while (0)
+#endif /* !CONFIG_XENO_FASTSYNCH */
+
 static void cond_destroy_internal(pse51_cond_t * cond, pse51_kqueues_t *q)
 {
 	spl_t s;
@@ -76,7 +99,11 @@ static void cond_destroy_internal(pse51_cond_t * cond, pse51_kqueues_t *q)
 	   xnpod_schedule(). */
 	xnsynch_destroy(&cond->synchbase);
 	xnlock_put_irqrestore(&nklock, s);
-	xnfree(cond);
+#ifdef CONFIG_XENO_FASTSYNCH
+	xnheap_free(&xnsys_ppd_get(cond->attr.pshared)->sem_heap,
+		    cond->nwaiters);
+#endif /* CONFIG_XENO_FASTSYNCH */
+	xnobjpool_free(&cond_pool, cond);
 }
 
 /**
@@ -108,6 +135,7 @@ int pthread_cond_init(pthread_cond_t * cnd, const pthread_condattr_t * attr)
 {
 	struct __shadow_cond *shadow = &((union __xeno_cond *)cnd)->shadow_cond;
 	xnflags_t synch_flags = XNSYNCH_PRIO | XNSYNCH_NOPIP;
+	xnarch_atomic_t *nwaiters = NULL;
 	pse51_cond_t *cond;
 	xnqueue_t *condq;
 	spl_t s;
@@ -116,10 +144,23 @@ int pthread_cond_init(pthread_cond_t * cnd, const pthread_condattr_t * attr)
 	if (!attr)
 		attr = &default_cond_attr;
 
-	cond = (pse51_cond_t *) xnmalloc(sizeof(*cond));
+	cond = (pse51_cond_t *) xnobjpool_alloc(&cond_pool);
 	if (!cond)
 		return ENOMEM;
 
+#ifdef CONFIG_XENO_FASTSYNCH
+	if (attr->magic == PSE51_COND_ATTR_MAGIC) {
+		nwaiters = (xnarch_atomic_t *)
+			xnheap_alloc(&xnsys_ppd_get(attr->pshared)->sem_heap,
+				     xnheap_synch_size(sizeof(xnarch_atomic_t), 0));
+		if (!nwaiters) {
+			xnobjpool_free(&cond_pool, cond);
+			return EAGAIN;
+		}
+		xnarch_atomic_set(nwaiters, 0);
+	}
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 	xnlock_get_irqsave(&nklock, s);
 
 	if (attr->magic != PSE51_COND_ATTR_MAGIC) {
@@ -142,6 +183,13 @@ int pthread_cond_init(pthread_cond_t * cnd, const pthread_condattr_t * attr)
 
 	shadow->magic = PSE51_COND_MAGIC;
 	shadow->cond = cond;
+#ifdef CONFIG_XENO_FASTSYNCH
+	shadow->attr = *attr;
+	shadow->nwaiters_offset =
+		xnheap_mapped_offset(&xnsys_ppd_get(attr->pshared)->sem_heap,
+				     nwaiters);
+	cond->nwaiters = nwaiters;
+#endif /* CONFIG_XENO_FASTSYNCH */
 
 	cond->magic = PSE51_COND_MAGIC;
 	xnsynch_init(&cond->synchbase, synch_flags, NULL);
@@ -158,6 +206,11 @@ int pthread_cond_init(pthread_cond_t * cnd, const pthread_condattr_t * attr)
 
   error:
 	xnlock_put_irqrestore(&nklock, s);
+#ifdef CONFIG_XENO_FASTSYNCH
+	if (nwaiters)
+		xnheap_free(&xnsys_ppd_get(attr->pshared)->sem_heap, nwaiters);
+#endif /* CONFIG_XENO_FASTSYNCH */
+	xnobjpool_free(&cond_pool, cond);
 	return err;
 }
 
@@ -282,11 +335,18 @@ int pse51_cond_timedwait_prologue(xnthread_t *cur,
 		goto unlock_and_return;
 	}
 
+	/* Account for ourselves before releasing the mutex, since a
+	   signaler may then grab it and check the count from
+	   user-space at once. */
+	cond_update_nwaiters(cond, 1);
+
 	/* Unlock mutex, with its previous recursive lock count stored
 	   in "*count_ptr". */
 	err = mutex_save_count(cur, mutex, count_ptr);
-	if (err)
+	if (err) {
+		cond_update_nwaiters(cond, 0);
 		goto unlock_and_return;
+	}
 
 	/* Bind mutex to cond. */
 	if (cond->mutex == NULL)
@@ -299,6 +359,9 @@ int pse51_cond_timedwait_prologue(xnthread_t *cur,
 	else
 		xnsynch_sleep_on(&cond->synchbase, XN_INFINITE, XN_RELATIVE);
 
+	/* Drop any stale count left by a timeout or an unblock. */
+	cond_update_nwaiters(cond, 0);
+
 	/* There are four possible wakeup conditions :
 	   - cond_signal / cond_broadcast, no status bit is set, and the function
 	     should return 0 ;
@@ -340,7 +403,18 @@ int pse51_cond_timedwait_epilogue(xnthread_t *cur,
 
 	cond = shadow->cond;
 
-	err = pse51_mutex_timedlock_internal(cur, mutex, count, 0, XN_INFINITE);
+	/* We may have been moved to the mutex wait queue by
+	   pthread_cond_signal() or pthread_cond_broadcast(), in which case
+	   the mutex may already have been handed over to us. */
+	if (pse51_obj_active(mutex, PSE51_MUTEX_MAGIC, struct __shadow_mutex)
+	    && pse51_obj_active(mutex->mutex,
+				PSE51_MUTEX_MAGIC, struct pse51_mutex)
+	    && xnsynch_accept_handoff(&mutex->mutex->synchbase)) {
+		mutex->lockcnt = count;
+		err = 0;
+	} else
+		err = pse51_mutex_timedlock_internal(cur, mutex,
+						     count, 0, XN_INFINITE);
 
 	if (err == -EINTR)
 		goto unlock_and_return;
@@ -550,11 +624,18 @@ int pthread_cond_signal(pthread_cond_t * cnd)
 	}
 #endif /* XENO_DEBUG(POSIX) */
 
-	/* FIXME: If the mutex associated with cnd is owned by the current
-	   thread, we could postpone rescheduling until pthread_mutex_unlock is
-	   called, this would save two useless context switches. */
-	if (xnsynch_wakeup_one_sleeper(&cond->synchbase) != NULL)
+	/* If the mutex bound to cnd is currently owned, typically by the
+	   current thread, move the waiter directly to the mutex wait queue:
+	   it will be resumed when the mutex is released, instead of being
+	   resumed only to block again on the mutex. */
+	if (cond->mutex
+	    && xnsynch_requeue_sleepers(&cond->synchbase,
+					&cond->mutex->synchbase, 1))
+		cond_update_nwaiters(cond, 0);
+	else if (xnsynch_wakeup_one_sleeper(&cond->synchbase) != NULL) {
+		cond_update_nwaiters(cond, 0);
 		xnpod_schedule();
+	}
 
 	xnlock_put_irqrestore(&nklock, s);
 
@@ -599,8 +680,16 @@ int pthread_cond_broadcast(pthread_cond_t * cnd)
 		return EPERM;
 	}
 
-	if (xnsynch_flush(&cond->synchbase, 0) == XNSYNCH_RESCHED)
+	/* Same as pthread_cond_signal(), waiters are moved to the mutex wait
+	   queue if possible, in order to avoid a thundering herd. */
+	if (cond->mutex
+	    && xnsynch_requeue_sleepers(&cond->synchbase,
+					&cond->mutex->synchbase, -1))
+		cond_update_nwaiters(cond, 0);
+	else if (xnsynch_flush(&cond->synchbase, 0) == XNSYNCH_RESCHED) {
+		cond_update_nwaiters(cond, 0);
 		xnpod_schedule();
+	}
 
 	xnlock_put_irqrestore(&nklock, s);
 
@@ -631,11 +720,14 @@ void pse51_cond_pkg_init(void)
 {
 	initq(&pse51_global_kqueues.condq);
 	pthread_condattr_init(&default_cond_attr);
+	xnobjpool_init(&cond_pool, "posix.cond", sizeof(pse51_cond_t),
+		       CONFIG_XENO_OPT_POSIX_COND_POOLSZ);
 }
 
 void pse51_cond_pkg_cleanup(void)
 {
 	pse51_condq_cleanup(&pse51_global_kqueues);
+	xnobjpool_destroy(&cond_pool);
 }
 
 /*@}*/
@@ -37,7 +37,7 @@
 #define PSE51_THREAD_MAGIC      PSE51_MAGIC(01)
 #define PSE51_THREAD_ATTR_MAGIC PSE51_MAGIC(02)
 #define PSE51_MUTEX_MAGIC       PSE51_MAGIC(03)
-#define PSE51_MUTEX_ATTR_MAGIC  (PSE51_MAGIC(04) & ((1 << 24) - 1))
+#define PSE51_MUTEX_ATTR_MAGIC  (PSE51_MAGIC(04) & ((1 << 16) - 1))
 #define PSE51_COND_MAGIC        PSE51_MAGIC(05)
 #define PSE51_COND_ATTR_MAGIC   (PSE51_MAGIC(05) & ((1 << 24) - 1))
 #define PSE51_SEM_MAGIC         PSE51_MAGIC(06)
@@ -49,6 +49,9 @@
 #define PSE51_NAMED_SEM_MAGIC   PSE51_MAGIC(0C)
 #define PSE51_TIMER_MAGIC       PSE51_MAGIC(0D)
 #define PSE51_SHM_MAGIC         PSE51_MAGIC(0E)
+#define PSE51_TIMER_EVQ_MAGIC   PSE51_MAGIC(0F)
+#define PSE51_BARRIER_MAGIC     PSE51_MAGIC(10)
+#define PSE51_BARRIER_ATTR_MAGIC (PSE51_MAGIC(10) & ((1 << 24) - 1))
 
 #define PSE51_MIN_PRIORITY      XNSCHED_LOW_PRIO
 #define PSE51_MAX_PRIORITY      XNSCHED_HIGH_PRIO
@@ -64,10 +67,12 @@
 #define pse51_mark_deleted(t) ((t)->magic = ~(t)->magic)
 
 typedef struct {
+	xnqueue_t barrierq;
 	xnqueue_t condq;
 	xnqueue_t intrq;
 	xnqueue_t mutexq;
 	xnqueue_t semq;
+	xnqueue_t spinq;
 	xnqueue_t threadq;
 	xnqueue_t timerq;
 } pse51_kqueues_t;
@@ -79,6 +84,7 @@ typedef struct {
 	pse51_assocq_t usems;
 	pse51_assocq_t umaps;
 	pse51_assocq_t ufds;
+	pse51_assocq_t uevqs;
 
 	xnshadow_ppd_t ppd;
 
@@ -63,6 +63,7 @@
 #include <posix/timer.h>
 #include <posix/registry.h>
 #include <posix/shm.h>
+#include <posix/barrier.h>
 
 MODULE_DESCRIPTION("POSIX/PSE51 interface");
 MODULE_AUTHOR("gilles.chanteperdrix@xenomai.org");
@@ -86,6 +87,7 @@ static void pse51_shutdown(int xtype)
 #endif /* CONFIG_XENO_OPT_POSIX_SHM */
 	pse51_timer_pkg_cleanup();
 	pse51_mq_pkg_cleanup();
+	pse51_barrier_pkg_cleanup();
 	pse51_cond_pkg_cleanup();
 	pse51_tsd_pkg_cleanup();
 	pse51_sem_pkg_cleanup();
@@ -96,6 +98,7 @@ static void pse51_shutdown(int xtype)
 	pse51_intr_pkg_cleanup();
 #endif /* CONFIG_XENO_OPT_POSIX_INTR */
 #ifdef CONFIG_XENO_OPT_PERVASIVE
+	pse51_spin_pkg_cleanup();
 	pse51_syscall_cleanup();
 #endif /* CONFIG_XENO_OPT_PERVASIVE */
 #ifdef __KERNEL__
@@ -149,6 +152,7 @@ int SKIN_INIT(posix)
 	pse51_sem_pkg_init();
 	pse51_tsd_pkg_init();
 	pse51_cond_pkg_init();
+	pse51_barrier_pkg_init();
 	pse51_mq_pkg_init();
 #ifdef CONFIG_XENO_OPT_POSIX_INTR
 	pse51_intr_pkg_init();
@@ -157,6 +161,9 @@ int SKIN_INIT(posix)
 #ifdef CONFIG_XENO_OPT_POSIX_SHM
 	pse51_shm_pkg_init();
 #endif /* CONFIG_XENO_OPT_POSIX_SHM */
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+	pse51_spin_pkg_init();
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
 
 	pse51_thread_pkg_init(module_param_value(time_slice_arg));
 
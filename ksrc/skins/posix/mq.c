@@ -36,6 +36,7 @@
 #include <posix/internal.h>	/* Magics, time conversion */
 #include <posix/thread.h>	/* errno. */
 #include <posix/sig.h>		/* pse51_siginfo_t. */
+#include <nucleus/sys_ppd.h>	/* Global semaphore heap. */
 #ifdef __KERNEL__
 #include <linux/fs.h>		/* Make sure ERR_PTR is defined for all kernel versions */
 #include <posix/apc.h>
@@ -57,6 +58,10 @@ struct pse51_mq {
 	char *mem;
 	xnqueue_t avail;
 
+	/* MQ_ZEROCOPY_NP: payloads in the global semaphore heap. */
+	char *zcmem;
+	unsigned long zcstride;
+
 	/* mq_notify */
 	pse51_siginfo_t si;
 	mqd_t target_qd;
@@ -82,6 +87,12 @@ static struct mq_attr default_attr = {
       mq_msgsize:128,
 };
 
+static inline xnheap_t *pse51_mq_zcheap(void)
+{
+	/* Mapped by every Xenomai process, so payloads are shareable. */
+	return &xnsys_ppd_get(1)->sem_heap;
+}
+
 static pse51_msg_t *pse51_mq_msg_alloc(pse51_mq_t * mq)
 {
 	xnpholder_t *holder = (xnpholder_t *)getq(&mq->avail);
@@ -100,10 +111,68 @@ static void pse51_mq_msg_free(pse51_mq_t * mq, pse51_msg_t * msg)
 	prependq(&mq->avail, holder);	/* For earliest re-use of the block. */
 }
 
+/* Must be called with nklock locked, irq off. */
+static int pse51_mq_msg_post(pse51_mq_t *mq, pse51_msg_t *msg)
+{
+	int resched = 0;
+
+	insertpqf(&mq->queued, &msg->link, msg->link.prio);
+	if (countpq(&mq->queued) == 1)
+		resched = xnselect_signal(&mq->read_select, 1);
+
+	if (xnsynch_wakeup_one_sleeper(&mq->receivers))
+		resched = 1;
+	else if (mq->target && countpq(&mq->queued) == 1) {
+		/* First message ? no pending reader ? attempt
+		   to send a signal if mq_notify was called. */
+		if (pse51_sigqueue_inner(mq->target, &mq->si))
+			resched = 1;
+		mq->target = NULL;
+	}
+
+	return resched;
+}
+
+/* Must be called with nklock locked, irq off. */
+static int pse51_mq_msg_release(pse51_mq_t *mq, pse51_msg_t *msg)
+{
+	int resched = 0;
+
+	pse51_mq_msg_free(mq, msg);
+
+	if (countq(&mq->avail) == 1)
+		resched = xnselect_signal(&mq->write_select, 1);
+
+	if (xnsynch_wakeup_one_sleeper(&mq->senders))
+		resched = 1;
+
+	return resched;
+}
+
+/* Must be called with nklock locked, irq off. */
+static pse51_msg_t *pse51_mq_lent_msg(pse51_mq_t *mq, void *buf)
+{
+	unsigned long off;
+	pse51_msg_t *msg;
+
+	if (!mq->zcmem || (char *)buf < mq->zcmem)
+		return NULL;
+
+	off = (char *)buf - mq->zcmem;
+	if (off % mq->zcstride || off / mq->zcstride >= mq->attr.mq_maxmsg)
+		return NULL;
+
+	/* Headers are laid out in the same order as payloads. */
+	msg = (pse51_msg_t *)mq->mem + off / mq->zcstride;
+
+	return (msg->flags & PSE51_MSG_LENT) ? msg : NULL;
+}
+
 static int pse51_mq_init(pse51_mq_t * mq, const struct mq_attr *attr)
 {
 	unsigned i, msgsize, memsize;
-	char *mem;
+	unsigned long zcstride = 0;
+	char *mem, *zcmem = NULL;
 
 	if (xnpod_asynch_p() || !xnpod_root_p())
 		return EPERM;
@@ -113,7 +182,21 @@ static int pse51_mq_init(pse51_mq_t * mq, const struct mq_attr *attr)
 	else if (attr->mq_maxmsg <= 0 || attr->mq_msgsize <= 0)
 		return EINVAL;
 
-	msgsize = attr->mq_msgsize + sizeof(pse51_msg_t);
+	if (attr->mq_flags & MQ_ZEROCOPY_NP) {
+		/* Only the payloads are shared, the headers stay private. */
+		zcstride = attr->mq_msgsize;
+		if ((zcstride % sizeof(unsigned long)))
+			zcstride += sizeof(unsigned long)
+				- (zcstride % sizeof(unsigned long));
+
+		zcmem = xnheap_alloc(pse51_mq_zcheap(),
+				     zcstride * attr->mq_maxmsg);
+		if (!zcmem)
+			return ENOSPC;
+
+		msgsize = sizeof(pse51_msg_t);
+	} else
+		msgsize = attr->mq_msgsize + sizeof(pse51_msg_t);
 
 	/* Align msgsize on natural boundary. */
 	if ((msgsize % sizeof(unsigned long)))
@@ -125,19 +208,26 @@ static int pse51_mq_init(pse51_mq_t * mq, const struct mq_attr *attr)
 
 	mem = (char *)xnarch_alloc_host_mem(memsize);
 
-	if (!mem)
+	if (!mem) {
+		if (zcmem)
+			xnheap_free(pse51_mq_zcheap(), zcmem);
 		return ENOSPC;
+	}
 
 	mq->memsize = memsize;
 	initpq(&mq->queued);
 	xnsynch_init(&mq->receivers, XNSYNCH_PRIO | XNSYNCH_NOPIP, NULL);
 	xnsynch_init(&mq->senders, XNSYNCH_PRIO | XNSYNCH_NOPIP, NULL);
 	mq->mem = mem;
+	mq->zcmem = zcmem;
+	mq->zcstride = zcstride;
 
 	/* Fill the pool. */
 	initq(&mq->avail);
 	for (i = 0; i < attr->mq_maxmsg; i++) {
 		pse51_msg_t *msg = (pse51_msg_t *) (mem + i * msgsize);
+		msg->flags = 0;
+		msg->data = zcmem ? zcmem + i * zcstride : (char *)(msg + 1);
 		pse51_mq_msg_free(mq, msg);
 	}
 
@@ -161,6 +251,8 @@ static void pse51_mq_destroy(pse51_mq_t *mq)
 	xnlock_put_irqrestore(&nklock, s);
 	xnselect_destroy(&mq->read_select);
 	xnselect_destroy(&mq->write_select);
+	if (mq->zcmem)
+		xnheap_free(pse51_mq_zcheap(), mq->zcmem);
 #ifdef __KERNEL__
 	if (!xnpod_root_p())
 		pse51_schedule_lostage(PSE51_LO_FREE_REQ, mq->mem, mq->memsize);
@@ -205,6 +297,10 @@ static void pse51_mq_destroy(pse51_mq_t *mq)
  * - @a mq_maxmsg is the maximum number of messages in the queue (128 by
  *   default);
  * - @a mq_msgsize is the maximum size of each message (128 by default).
+ * - @a mq_flags may have the @a MQ_ZEROCOPY_NP bit set, in which case the
+ *   message buffers are allocated from the global semaphore heap so that
+ *   messages can be exchanged in place with mq_alloc_np(), mq_send_np(),
+ *   mq_receive_np() and mq_release_np().
  *
  * @a name may be any arbitrary string, in which slashes have no particular
  * meaning. However, for portability, using a name which starts with a slash and
@@ -223,7 +319,8 @@ static void pse51_mq_destroy(pse51_mq_t *mq)
  *   does not exist;
  * - ENOSPC, allocation of system memory failed, or insufficient memory exists
  *   in the system heap to create the queue, try increasing
- *   CONFIG_XENO_OPT_SYS_HEAPSZ;
+ *   CONFIG_XENO_OPT_SYS_HEAPSZ (or CONFIG_XENO_OPT_GLOBAL_SEM_HEAPSZ for
+ *   zero-copy queues);
  * - EPERM, attempting to create a message queue from an invalid context;
  * - EINVAL, the @a attr argument is invalid;
  * - EMFILE, too many descriptors are currently open.
@@ -480,7 +577,10 @@ static pse51_msg_t *pse51_mq_trysend(pse51_mq_t **mqp,
 	if (flags != O_WRONLY && flags != O_RDWR)
 		return ERR_PTR(-EBADF);
 
-	if (len > mq->attr.mq_msgsize)
+	if (len == PSE51_MQ_ZEROCOPY) {
+		if (!mq->zcmem)
+			return ERR_PTR(-EINVAL);
+	} else if (len > mq->attr.mq_msgsize)
 		return ERR_PTR(-EMSGSIZE);
 
 	msg = pse51_mq_msg_alloc(mq);
@@ -508,7 +608,10 @@ static pse51_msg_t *pse51_mq_tryrcv(pse51_mq_t **mqp,
 	if (flags != O_RDONLY && flags != O_RDWR)
 		return ERR_PTR(-EBADF);
 
-	if (len < mq->attr.mq_msgsize)
+	if (len == PSE51_MQ_ZEROCOPY) {
+		if (!mq->zcmem)
+			return ERR_PTR(-EINVAL);
+	} else if (len < mq->attr.mq_msgsize)
 		return ERR_PTR(-EMSGSIZE);
 
 	if (!(holder = getpq(&mq->queued)))
@@ -607,19 +710,7 @@ int pse51_mq_finish_send(mqd_t fd, pse51_mq_t *mq, pse51_msg_t *msg)
 		goto bad_fd;
 	}
 
-	insertpqf(&mq->queued, &msg->link, msg->link.prio);
-	if (countpq(&mq->queued) == 1)
-		resched = xnselect_signal(&mq->read_select, 1);
-
-	if (xnsynch_wakeup_one_sleeper(&mq->receivers))
-		resched = 1;
-	else if (mq->target && countpq(&mq->queued) == 1) {
-		/* First message ? no pending reader ? attempt
-		   to send a signal if mq_notify was called. */
-		if (pse51_sigqueue_inner(mq->target, &mq->si))
-			resched = 1;
-		mq->target = NULL;
-	}
+	resched = pse51_mq_msg_post(mq, msg);
 
   unref:
 	pse51_node_put(&mq->nodebase);
@@ -640,13 +731,7 @@ int pse51_mq_finish_send(mqd_t fd, pse51_mq_t *mq, pse51_msg_t *msg)
   bad_fd:
 	/* descriptor was destroyed, simply return the message to the
 	   pool and wakeup any waiting sender. */;
-	pse51_mq_msg_free(mq, msg);
-
-	if (countq(&mq->avail) == 1)
-		resched = xnselect_signal(&mq->write_select, 1);
-
-	if (xnsynch_wakeup_one_sleeper(&mq->senders))
-		resched = 1;
+	resched = pse51_mq_msg_release(mq, msg);
 	goto unref;
 }
 
@@ -731,13 +816,39 @@ int pse51_mq_finish_rcv(mqd_t fd, pse51_mq_t *mq, pse51_msg_t *msg)
 	if (!err && node2mq(pse51_desc_node(desc)) != mq)
 		err = -EBADF;
 
-	pse51_mq_msg_free(mq, msg);
+	resched = pse51_mq_msg_release(mq, msg);
 
-	if (countq(&mq->avail) == 1)
-		resched = xnselect_signal(&mq->write_select, 1);
+	pse51_node_put(&mq->nodebase);
+	removed = pse51_node_removed_p(&mq->nodebase);
 
-	if (xnsynch_wakeup_one_sleeper(&mq->senders))
-		resched = 1;
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (resched)
+		xnpod_schedule();
+
+	if (removed) {
+		pse51_mq_destroy(mq);
+		xnfree(mq);
+	}
+
+	return err;
+}
+
+int pse51_mq_finish_lend(mqd_t fd, pse51_mq_t *mq, pse51_msg_t *msg)
+{
+	int err = 0, resched = 0, removed;
+	pse51_desc_t *desc;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	err = -pse51_desc_get(&desc, fd, PSE51_MQ_MAGIC);
+	if (!err && node2mq(pse51_desc_node(desc)) != mq)
+		err = -EBADF;
+
+	if (err)
+		resched = pse51_mq_msg_release(mq, msg);
+	else
+		msg->flags |= PSE51_MSG_LENT;
 
 	pse51_node_put(&mq->nodebase);
 	removed = pse51_node_removed_p(&mq->nodebase);
@@ -755,6 +866,86 @@ int pse51_mq_finish_rcv(mqd_t fd, pse51_mq_t *mq, pse51_msg_t *msg)
 	return err;
 }
 
+int pse51_mq_post_lent(mqd_t fd, void *buf, size_t len, unsigned prio)
+{
+	int err, resched = 0;
+	pse51_desc_t *desc;
+	pse51_msg_t *msg;
+	pse51_mq_t *mq;
+	unsigned flags;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	err = -pse51_desc_get(&desc, fd, PSE51_MQ_MAGIC);
+	if (err)
+		goto unlock_and_exit;
+
+	flags = pse51_desc_getflags(desc) & PSE51_PERMS_MASK;
+	if (flags != O_WRONLY && flags != O_RDWR) {
+		err = -EBADF;
+		goto unlock_and_exit;
+	}
+
+	mq = node2mq(pse51_desc_node(desc));
+	msg = pse51_mq_lent_msg(mq, buf);
+	if (!msg) {
+		err = -EINVAL;
+		goto unlock_and_exit;
+	}
+
+	if (len > mq->attr.mq_msgsize) {
+		err = -EMSGSIZE;
+		goto unlock_and_exit;
+	}
+
+	msg->flags &= ~PSE51_MSG_LENT;
+	msg->len = len;
+	pse51_msg_set_prio(msg, prio);
+	resched = pse51_mq_msg_post(mq, msg);
+
+  unlock_and_exit:
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (resched)
+		xnpod_schedule();
+
+	return err;
+}
+
+int pse51_mq_put_lent(mqd_t fd, void *buf)
+{
+	int err, resched = 0;
+	pse51_desc_t *desc;
+	pse51_msg_t *msg;
+	pse51_mq_t *mq;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	err = -pse51_desc_get(&desc, fd, PSE51_MQ_MAGIC);
+	if (err)
+		goto unlock_and_exit;
+
+	mq = node2mq(pse51_desc_node(desc));
+	msg = pse51_mq_lent_msg(mq, buf);
+	if (!msg) {
+		err = -EINVAL;
+		goto unlock_and_exit;
+	}
+
+	msg->flags &= ~PSE51_MSG_LENT;
+	resched = pse51_mq_msg_release(mq, msg);
+
+  unlock_and_exit:
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (resched)
+		xnpod_schedule();
+
+	return err;
+}
+
 /**
  * Send a message to a message queue.
  *
@@ -1233,6 +1424,190 @@ int mq_notify(mqd_t fd, const struct sigevent *evp)
 }
 
 #ifdef CONFIG_XENO_OPT_POSIX_SELECT
+/**
+ * Get an empty message buffer from a zero-copy message queue.
+ *
+ * This service takes a message buffer out of the pool of the message
+ * queue @a fd, which must have been created with the @a MQ_ZEROCOPY_NP bit
+ * set in the @a mq_flags attribute. The caller fills the buffer in place,
+ * then either sends it with mq_send_np(), or gives it back with
+ * mq_release_np().
+ *
+ * Buffers of zero-copy queues are allocated from the global semaphore heap,
+ * which every Xenomai process maps, so that producers and consumers from
+ * different processes access messages without copying them. The size of
+ * this heap is set by CONFIG_XENO_OPT_GLOBAL_SEM_HEAPSZ.
+ *
+ * If the pool is empty and the flag @a O_NONBLOCK is not set, the calling
+ * thread is suspended until a buffer is released.
+ *
+ * @param fd message queue descriptor.
+ *
+ * @return the address of a buffer of @a mq_msgsize bytes on success;
+ * @return NULL with @a errno set if:
+ * - EBADF, @a fd is not a valid message queue descriptor open for writing;
+ * - EINVAL, the message queue was not created with @a MQ_ZEROCOPY_NP;
+ * - EAGAIN, the flag O_NONBLOCK is set for the descriptor @a fd and the
+ *   pool is empty;
+ * - EPERM, the caller context is invalid;
+ * - EINTR, the service was interrupted by a signal.
+ *
+ * @par Valid contexts:
+ * - Xenomai kernel-space thread,
+ * - Xenomai user-space thread (switches to primary mode).
+ *
+ */
+void *mq_alloc_np(mqd_t fd)
+{
+	pse51_msg_t *msg;
+	pse51_mq_t *mq;
+	int err;
+
+	msg = pse51_mq_timedsend_inner(&mq, fd, PSE51_MQ_ZEROCOPY, NULL);
+	if (IS_ERR(msg)) {
+		thread_set_errno(-PTR_ERR(msg));
+		return NULL;
+	}
+
+	err = pse51_mq_finish_lend(fd, mq, msg);
+	if (err) {
+		thread_set_errno(-err);
+		return NULL;
+	}
+
+	return msg->data;
+}
+
+/**
+ * Send a message filled in place to a zero-copy message queue.
+ *
+ * This service queues the buffer @a buf, obtained from mq_alloc_np() or
+ * mq_receive_np() on the same queue, as a message of length @a len and
+ * priority @a prio. Ownership of the buffer returns to the message queue.
+ *
+ * @param fd message queue descriptor;
+ *
+ * @param buf message buffer;
+ *
+ * @param len length of the message;
+ *
+ * @param prio priority of the message.
+ *
+ * @return 0 on success;
+ * @return -1 with @a errno set if:
+ * - EBADF, @a fd is not a valid message queue descriptor open for writing;
+ * - EINVAL, @a buf is not a buffer owned by the application;
+ * - EMSGSIZE, @a len exceeds the @a mq_msgsize attribute of the queue.
+ *
+ * @par Valid contexts:
+ * - Xenomai kernel-space thread,
+ * - Xenomai user-space thread.
+ *
+ */
+int mq_send_np(mqd_t fd, void *buf, size_t len, unsigned prio)
+{
+	int err;
+
+	err = pse51_mq_post_lent(fd, buf, len, prio);
+	if (!err)
+		return 0;
+
+	thread_set_errno(-err);
+	return -1;
+}
+
+/**
+ * Receive a message in place from a zero-copy message queue.
+ *
+ * This service dequeues the message with the highest priority from the
+ * message queue @a fd and hands its buffer over to the caller, instead of
+ * copying it out. The buffer must be given back with mq_release_np() once
+ * consumed, or sent again with mq_send_np().
+ *
+ * If the queue is empty and the flag @a O_NONBLOCK is not set, the calling
+ * thread is suspended until some message is sent to the queue.
+ *
+ * @param fd the queue descriptor;
+ *
+ * @param bufp address where the buffer address will be stored on success;
+ *
+ * @param priop address where the priority of the received message will be
+ * stored on success.
+ *
+ * @return the message length on success;
+ * @return -1 with no message unqueued and @a errno set if:
+ * - EBADF, @a fd is not a valid descriptor open for reading;
+ * - EINVAL, the message queue was not created with @a MQ_ZEROCOPY_NP;
+ * - EAGAIN, the queue is empty, and the flag @a O_NONBLOCK is set for the
+ *   descriptor @a fd;
+ * - EPERM, the caller context is invalid;
+ * - EINTR, the service was interrupted by a signal.
+ *
+ * @par Valid contexts:
+ * - Xenomai kernel-space thread,
+ * - Xenomai user-space thread (switches to primary mode).
+ *
+ */
+ssize_t mq_receive_np(mqd_t fd, void **bufp, unsigned *priop)
+{
+	pse51_msg_t *msg;
+	pse51_mq_t *mq;
+	unsigned prio;
+	ssize_t len;
+	int err;
+
+	msg = pse51_mq_timedrcv_inner(&mq, fd, PSE51_MQ_ZEROCOPY, NULL);
+	if (IS_ERR(msg)) {
+		thread_set_errno(-PTR_ERR(msg));
+		return -1;
+	}
+
+	len = msg->len;
+	prio = pse51_msg_get_prio(msg);
+	*bufp = msg->data;
+
+	err = pse51_mq_finish_lend(fd, mq, msg);
+	if (err) {
+		thread_set_errno(-err);
+		return -1;
+	}
+
+	if (priop)
+		*priop = prio;
+
+	return len;
+}
+
+/**
+ * Give a message buffer back to a zero-copy message queue.
+ *
+ * @param fd message queue descriptor;
+ *
+ * @param buf buffer obtained from mq_alloc_np() or mq_receive_np() on the
+ * same queue.
+ *
+ * @return 0 on success;
+ * @return -1 with @a errno set if:
+ * - EBADF, @a fd is not a valid message queue descriptor;
+ * - EINVAL, @a buf is not a buffer owned by the application.
+ *
+ * @par Valid contexts:
+ * - Xenomai kernel-space thread,
+ * - Xenomai user-space thread.
+ *
+ */
+int mq_release_np(mqd_t fd, void *buf)
+{
+	int err;
+
+	err = pse51_mq_put_lent(fd, buf);
+	if (!err)
+		return 0;
+
+	thread_set_errno(-err);
+	return -1;
+}
+
 int pse51_mq_select_bind(mqd_t fd, struct xnselector *selector,
 			 unsigned type, unsigned index)
 {
@@ -1347,3 +1722,7 @@ EXPORT_SYMBOL_GPL(mq_receive);
 EXPORT_SYMBOL_GPL(mq_timedreceive);
 EXPORT_SYMBOL_GPL(mq_close);
 EXPORT_SYMBOL_GPL(mq_unlink);
+EXPORT_SYMBOL_GPL(mq_alloc_np);
+EXPORT_SYMBOL_GPL(mq_send_np);
+EXPORT_SYMBOL_GPL(mq_receive_np);
+EXPORT_SYMBOL_GPL(mq_release_np);
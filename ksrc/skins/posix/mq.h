@@ -10,12 +10,17 @@ typedef struct pse51_mq pse51_mq_t;
 typedef struct pse51_msg {
 	xnpholder_t link;
 	size_t len;
-	char data[0];
+	unsigned flags;
+#define PSE51_MSG_LENT 0x1	/* Owned by the application (zero-copy). */
+	char *data;
 } pse51_msg_t;
 
 #define pse51_msg_get_prio(msg) (msg)->link.prio
 #define pse51_msg_set_prio(msg, prio) (msg)->link.prio = (prio)
 
+/* Length passed to the inner services to get a zero-copy message. */
+#define PSE51_MQ_ZEROCOPY ((size_t)-1)
+
 pse51_msg_t *pse51_mq_timedsend_inner(pse51_mq_t **mqp, mqd_t fd, size_t len,
 				      const struct timespec *abs_timeoutp);
 
@@ -26,6 +31,12 @@ pse51_msg_t *pse51_mq_timedrcv_inner(pse51_mq_t **mqp, mqd_t fd, size_t len,
 
 int pse51_mq_finish_rcv(mqd_t fd, pse51_mq_t *mq, pse51_msg_t *msg);
 
+int pse51_mq_finish_lend(mqd_t fd, pse51_mq_t *mq, pse51_msg_t *msg);
+
+int pse51_mq_post_lent(mqd_t fd, void *buf, size_t len, unsigned prio);
+
+int pse51_mq_put_lent(mqd_t fd, void *buf);
+
 #ifdef CONFIG_XENO_OPT_PERVASIVE
 
 void pse51_mq_uqds_cleanup(pse51_queues_t *q);
@@ -52,6 +52,8 @@
 
 pthread_mutexattr_t pse51_default_mutex_attr;
 
+xnobjpool_t pse51_mutex_pool;
+
 int pse51_mutex_check_init(struct __shadow_mutex *shadow,
 			   const pthread_mutexattr_t *attr)
 {
@@ -111,9 +113,15 @@ int pse51_mutex_init_internal(struct __shadow_mutex *shadow,
 
 	if (attr->protocol == PTHREAD_PRIO_INHERIT)
 		synch_flags |= XNSYNCH_PIP;
+	else if (attr->protocol == PTHREAD_PRIO_PROTECT)
+		synch_flags |= XNSYNCH_PP;
+
+	if (attr->spin)
+		synch_flags |= XNSYNCH_SPIN;
 
 	mutex->magic = PSE51_MUTEX_MAGIC;
 	xnsynch_init(&mutex->synchbase, synch_flags, ownerp);
+	xnsynch_set_ceiling(&mutex->synchbase, attr->prioceiling);
 	inith(&mutex->link);
 	mutex->attr = *attr;
 	mutex->owningq = kq;
@@ -179,16 +187,16 @@ int pthread_mutex_init(pthread_mutex_t *mx, const pthread_mutexattr_t *attr)
 #endif /* CONFIG_XENO_FASTSYNCH */
 
   checked:
-	mutex = (pse51_mutex_t *) xnmalloc(sizeof(*mutex));
+	mutex = (pse51_mutex_t *) xnobjpool_alloc(&pse51_mutex_pool);
 	if (!mutex)
 		return ENOMEM;
 
 #ifdef CONFIG_XENO_FASTSYNCH
 	ownerp = (xnarch_atomic_t *)
 		xnheap_alloc(&xnsys_ppd_get(attr->pshared)->sem_heap,
-			     sizeof(xnarch_atomic_t));
+			     pse51_mutex_lock_size(attr));
 	if (!ownerp) {
-		xnfree(mutex);
+		xnobjpool_free(&pse51_mutex_pool, mutex);
 		return EAGAIN;
 	}
 #endif /* CONFIG_XENO_FASTSYNCH */
@@ -198,7 +206,7 @@ int pthread_mutex_init(pthread_mutex_t *mx, const pthread_mutexattr_t *attr)
 	cb_write_unlock(&shadow->lock, s);
 
 	if (err) {
-		xnfree(mutex);
+		xnobjpool_free(&pse51_mutex_pool, mutex);
 #ifdef CONFIG_XENO_FASTSYNCH
 		xnheap_free(&xnsys_ppd_get(attr->pshared)->sem_heap, ownerp);
 #endif /* CONFIG_XENO_FASTSYNCH */
@@ -222,7 +230,7 @@ void pse51_mutex_destroy_internal(pse51_mutex_t *mutex,
 	xnheap_free(&xnsys_ppd_get(mutex->attr.pshared)->sem_heap,
 		    mutex->synchbase.fastlock);
 #endif /* CONFIG_XENO_FASTSYNCH */
-	xnfree(mutex);
+	xnobjpool_free(&pse51_mutex_pool, mutex);
 }
 
 /**
@@ -431,6 +439,7 @@ int pthread_mutex_trylock(pthread_mutex_t *mx)
 	if (likely(!err)) {
 		if (xnthread_test_state(cur, XNOTHER) && !err)
 			xnthread_inc_rescnt(cur);
+		xnsynch_protect_owner(&mutex->synchbase);
 		shadow->lockcnt = 1;
 	}
 	else if (err == EBUSY) {
@@ -627,8 +636,9 @@ int pthread_mutex_unlock(pthread_mutex_t * mx)
 		return 0;
 	}
 
-	if (xnsynch_release(&mutex->synchbase))
-		xnpod_schedule();
+	/* Dropping a priority ceiling may require rescheduling too. */
+	xnsynch_release(&mutex->synchbase);
+	xnpod_schedule();
 
   out:
 	cb_read_unlock(&shadow->lock, s);
@@ -659,11 +669,14 @@ void pse51_mutex_pkg_init(void)
 {
 	initq(&pse51_global_kqueues.mutexq);
 	pthread_mutexattr_init(&pse51_default_mutex_attr);
+	xnobjpool_init(&pse51_mutex_pool, "posix.mutex", sizeof(pse51_mutex_t),
+		       CONFIG_XENO_OPT_POSIX_MUTEX_POOLSZ);
 }
 
 void pse51_mutex_pkg_cleanup(void)
 {
 	pse51_mutexq_cleanup(&pse51_global_kqueues);
+	xnobjpool_destroy(&pse51_mutex_pool);
 }
 
 /*@}*/
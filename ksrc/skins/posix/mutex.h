@@ -61,6 +61,19 @@ typedef struct pse51_mutex {
 
 extern pthread_mutexattr_t pse51_default_mutex_attr;
 
+#ifdef CONFIG_XENO_FASTSYNCH
+/*
+ * Priority ceiling mutexes need room for their handle after the
+ * lock, padded mutexes a cache line of their own.
+ */
+#define pse51_mutex_lock_size(attr)					\
+	xnheap_synch_size((attr)->protocol == PTHREAD_PRIO_PROTECT ?	\
+			  XNSYNCH_FASTPP_SIZE : sizeof(xnarch_atomic_t),	\
+			  (attr)->padded)
+#endif /* CONFIG_XENO_FASTSYNCH */
+
+extern xnobjpool_t pse51_mutex_pool;
+
 void pse51_mutexq_cleanup(pse51_kqueues_t *q);
 
 void pse51_mutex_pkg_init(void);
@@ -107,6 +120,11 @@ static inline int pse51_mutex_timedlock_internal(xnthread_t *cur,
 	if (xnsynch_owner_check(&mutex->synchbase, cur) == 0)
 		return -EBUSY;
 
+	/* The ceiling may not be lower than the caller's priority. */
+	if (xnsynch_test_flags(&mutex->synchbase, XNSYNCH_PP) &&
+	    mutex->attr.prioceiling < xnthread_base_priority(cur))
+		return -EINVAL;
+
 	if (timed)
 		xnsynch_acquire(&mutex->synchbase, abs_to, XN_REALTIME);
 	else
@@ -27,7 +27,10 @@ static const pthread_mutexattr_t default_mutex_attr = {
 	magic: PSE51_MUTEX_ATTR_MAGIC,
 	type: PTHREAD_MUTEX_NORMAL,
 	protocol: PTHREAD_PRIO_NONE,
-	pshared: PTHREAD_PROCESS_PRIVATE
+	pshared: PTHREAD_PROCESS_PRIVATE,
+	spin: 0,
+	padded: 0,
+	prioceiling: PSE51_MIN_PRIORITY
 };
 
 /**
@@ -37,6 +40,8 @@ static const pthread_mutexattr_t default_mutex_attr = {
  * values for all attributes. Default value are :
  * - for the @a type attribute, @a PTHREAD_MUTEX_NORMAL;
  * - for the @a protocol attribute, @a PTHREAD_PRIO_NONE;
+ * - for the @a prioceiling attribute, the minimum priority of the
+ *   SCHED_FIFO policy;
  * - for the @a pshared attribute, @a PTHREAD_PROCESS_PRIVATE.
  *
  * If this service is called specifying a mutex attributes object that was
@@ -212,9 +217,9 @@ int pthread_mutexattr_settype(pthread_mutexattr_t * attr, int type)
  * This service stores, at the address @a proto, the value of the @a protocol
  * attribute in the mutex attributes object @a attr.
  *
- * The @a protcol attribute may only be one of @a PTHREAD_PRIO_NONE or @a
- * PTHREAD_PRIO_INHERIT. See pthread_mutexattr_setprotocol() for the meaning of
- * these two constants.
+ * The @a protcol attribute may only be one of @a PTHREAD_PRIO_NONE, @a
+ * PTHREAD_PRIO_INHERIT or @a PTHREAD_PRIO_PROTECT. See
+ * pthread_mutexattr_setprotocol() for the meaning of these constants.
  *
  * @param attr an initialized mutex attributes object;
  *
@@ -264,14 +269,21 @@ int pthread_mutexattr_getprotocol(const pthread_mutexattr_t * attr, int *proto)
  * - PTHREAD_PRIO_NONE, meaning that a mutex created with the attributes object
  *   @a attr will not follow any priority protocol;
  * - PTHREAD_PRIO_INHERIT, meaning that a mutex created with the attributes
- *   object @a attr, will follow the priority inheritance protocol.
- *
- * The value PTHREAD_PRIO_PROTECT (priority ceiling protocol) is unsupported.
+ *   object @a attr, will follow the priority inheritance protocol;
+ * - PTHREAD_PRIO_PROTECT, meaning that a mutex created with the attributes
+ *   object @a attr, will follow the priority ceiling protocol: its owner runs
+ *   at least at the SCHED_FIFO priority set by
+ *   pthread_mutexattr_setprioceiling(), until it unlocks the mutex.
+ *
+ * Locking and unlocking a free priority ceiling mutex from user-space does not
+ * issue any system call, the nucleus only raises the priority of the owner if
+ * it is about to be preempted or to block while holding the mutex. This
+ * applies to one such mutex at a time per thread, nested priority ceiling
+ * mutexes are locked through a system call.
  *
  * @return 0 on success,
  * @return an error number if:
  * - EINVAL, the mutex attributes object @a attr is invalid;
- * - ENOTSUP, the value of @a proto is unsupported;
  * - EINVAL, the value of @a proto is invalid.
  *
  * @see
@@ -299,13 +311,9 @@ int pthread_mutexattr_setprotocol(pthread_mutexattr_t * attr, int proto)
 		xnlock_put_irqrestore(&nklock, s);
 		return EINVAL;
 
-	case PTHREAD_PRIO_PROTECT:
-
-		xnlock_put_irqrestore(&nklock, s);
-		return ENOTSUP;
-
 	case PTHREAD_PRIO_NONE:
 	case PTHREAD_PRIO_INHERIT:
+	case PTHREAD_PRIO_PROTECT:
 		break;
 	}
 
@@ -316,6 +324,97 @@ int pthread_mutexattr_setprotocol(pthread_mutexattr_t * attr, int proto)
 	return 0;
 }
 
+/**
+ * Get the priority ceiling attribute from a mutex attributes object.
+ *
+ * This service stores, at the address @a prioceiling, the value of the @a
+ * prioceiling attribute in the mutex attributes object @a attr.
+ *
+ * @param attr an initialized mutex attributes object;
+ *
+ * @param prioceiling address where the value of the @a prioceiling attribute
+ * will be stored on success.
+ *
+ * @return 0 on success,
+ * @return an error number if:
+ * - EINVAL, the @a prioceiling address is invalid;
+ * - EINVAL, the mutex attributes object @a attr is invalid.
+ *
+ * @see
+ * <a href="http://www.opengroup.org/onlinepubs/000095399/functions/pthread_mutexattr_getprioceiling.html">
+ * Specification.</a>
+ *
+ */
+int pthread_mutexattr_getprioceiling(const pthread_mutexattr_t *attr,
+				     int *prioceiling)
+{
+	spl_t s;
+
+	if (!prioceiling || !attr)
+		return EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!pse51_obj_active(attr,PSE51_MUTEX_ATTR_MAGIC,pthread_mutexattr_t)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return EINVAL;
+	}
+
+	*prioceiling = attr->prioceiling;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+
+/**
+ * Set the priority ceiling attribute of a mutex attributes object.
+ *
+ * This service sets the @a prioceiling attribute of the mutex attributes
+ * object @a attr, which is only used by mutexes following the priority ceiling
+ * protocol (see pthread_mutexattr_setprotocol()).
+ *
+ * @param attr an initialized mutex attributes object.
+ *
+ * @param prioceiling value of the @a prioceiling attribute, a priority level of
+ * the SCHED_FIFO policy.
+ *
+ * @return 0 on success,
+ * @return an error number if:
+ * - EINVAL, the mutex attributes object @a attr is invalid;
+ * - EINVAL, the value of @a prioceiling is out of the SCHED_FIFO range.
+ *
+ * @see
+ * <a href="http://www.opengroup.org/onlinepubs/000095399/functions/pthread_mutexattr_setprioceiling.html">
+ * Specification.</a>
+ *
+ */
+int pthread_mutexattr_setprioceiling(pthread_mutexattr_t *attr,
+				     int prioceiling)
+{
+	spl_t s;
+
+	if (!attr)
+		return EINVAL;
+
+	if (prioceiling < PSE51_MIN_PRIORITY ||
+	    prioceiling > PSE51_MAX_PRIORITY)
+		return EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!pse51_obj_active(attr,PSE51_MUTEX_ATTR_MAGIC,pthread_mutexattr_t)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return EINVAL;
+	}
+
+	attr->prioceiling = prioceiling;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+
 /**
  * Get the process-shared attribute of a mutex attributes object.
  *
@@ -419,6 +518,179 @@ int pthread_mutexattr_setpshared(pthread_mutexattr_t *attr, int pshared)
 	return 0;
 }
 
+/**
+ * Get the adaptive spinning attribute of a mutex attributes object.
+ *
+ * This service stores, at the address @a spin, the value of the @a spin
+ * attribute in the mutex attributes object @a attr.
+ *
+ * See pthread_mutexattr_setspin_np() for the meaning of this attribute.
+ *
+ * This service is a non-portable extension of the POSIX interface.
+ *
+ * @param attr an initialized mutex attributes object;
+ *
+ * @param spin address where the value of the @a spin attribute will be
+ * stored on success.
+ *
+ * @return 0 on success;
+ * @return an error number if:
+ * - EINVAL, the @a spin address is invalid;
+ * - EINVAL, the mutex attributes object @a attr is invalid.
+ *
+ */
+int pthread_mutexattr_getspin_np(const pthread_mutexattr_t *attr, int *spin)
+{
+	spl_t s;
+
+	if (!spin || !attr)
+		return EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!pse51_obj_active(attr,PSE51_MUTEX_ATTR_MAGIC,pthread_mutexattr_t)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return EINVAL;
+	}
+
+	*spin = attr->spin;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+
+/**
+ * Set the adaptive spinning attribute of a mutex attributes object.
+ *
+ * This service sets the @a spin attribute of the mutex attributes object @a
+ * attr. When set, a thread contending for a mutex created with the
+ * attributes object @a attr busy-waits for a bounded amount of time
+ * (see CONFIG_XENO_OPT_SYNCH_SPIN_BUDGET) as long as the mutex owner runs
+ * on another CPU, before it is suspended. This attribute has no effect on
+ * uniprocessor systems.
+ *
+ * This service is a non-portable extension of the POSIX interface.
+ *
+ * @param attr an initialized mutex attributes object.
+ *
+ * @param spin non-zero to enable adaptive spinning, zero to disable it
+ * (default).
+ *
+ * @return 0 on success,
+ * @return an error status if:
+ * - EINVAL, the mutex attributes object @a attr is invalid.
+ *
+ */
+int pthread_mutexattr_setspin_np(pthread_mutexattr_t *attr, int spin)
+{
+	spl_t s;
+
+	if (!attr)
+		return EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!pse51_obj_active(attr,PSE51_MUTEX_ATTR_MAGIC,pthread_mutexattr_t)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return EINVAL;
+	}
+
+	attr->spin = !!spin;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+
+/**
+ * Get the padding attribute of a mutex attributes object.
+ *
+ * This service stores, at the address @a padded, the value of the @a
+ * padded attribute in the mutex attributes object @a attr.
+ *
+ * See pthread_mutexattr_setpadded_np() for the meaning of this
+ * attribute.
+ *
+ * This service is a non-portable extension of the POSIX interface.
+ *
+ * @param attr an initialized mutex attributes object;
+ *
+ * @param padded address where the value of the @a padded attribute
+ * will be stored on success.
+ *
+ * @return 0 on success;
+ * @return an error number if:
+ * - EINVAL, the @a padded address is invalid;
+ * - EINVAL, the mutex attributes object @a attr is invalid.
+ *
+ */
+int pthread_mutexattr_getpadded_np(const pthread_mutexattr_t *attr,
+				   int *padded)
+{
+	spl_t s;
+
+	if (!padded || !attr)
+		return EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!pse51_obj_active(attr,PSE51_MUTEX_ATTR_MAGIC,pthread_mutexattr_t)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return EINVAL;
+	}
+
+	*padded = attr->padded;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+
+/**
+ * Set the padding attribute of a mutex attributes object.
+ *
+ * This service sets the @a padded attribute of the mutex attributes
+ * object @a attr. When set, the lock word of a mutex created with
+ * the attributes object @a attr gets a cache line of its own in the
+ * semaphore heap, instead of possibly sharing it with the lock words
+ * of unrelated mutexes. This avoids bouncing that cache line between
+ * CPUs using these mutexes independently, at the expense of heap
+ * space. This attribute has no effect unless CONFIG_XENO_FASTSYNCH
+ * is enabled, and is implied by CONFIG_XENO_OPT_SEM_HEAP_PADDED.
+ *
+ * This service is a non-portable extension of the POSIX interface.
+ *
+ * @param attr an initialized mutex attributes object.
+ *
+ * @param padded non-zero to pad the lock word, zero not to (default).
+ *
+ * @return 0 on success,
+ * @return an error status if:
+ * - EINVAL, the mutex attributes object @a attr is invalid.
+ *
+ */
+int pthread_mutexattr_setpadded_np(pthread_mutexattr_t *attr, int padded)
+{
+	spl_t s;
+
+	if (!attr)
+		return EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!pse51_obj_active(attr,PSE51_MUTEX_ATTR_MAGIC,pthread_mutexattr_t)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return EINVAL;
+	}
+
+	attr->padded = !!padded;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+
 
 /*@}*/
 
@@ -428,5 +700,11 @@ EXPORT_SYMBOL_GPL(pthread_mutexattr_gettype);
 EXPORT_SYMBOL_GPL(pthread_mutexattr_settype);
 EXPORT_SYMBOL_GPL(pthread_mutexattr_getprotocol);
 EXPORT_SYMBOL_GPL(pthread_mutexattr_setprotocol);
+EXPORT_SYMBOL_GPL(pthread_mutexattr_getprioceiling);
+EXPORT_SYMBOL_GPL(pthread_mutexattr_setprioceiling);
+EXPORT_SYMBOL_GPL(pthread_mutexattr_getspin_np);
+EXPORT_SYMBOL_GPL(pthread_mutexattr_setspin_np);
+EXPORT_SYMBOL_GPL(pthread_mutexattr_getpadded_np);
+EXPORT_SYMBOL_GPL(pthread_mutexattr_setpadded_np);
 EXPORT_SYMBOL_GPL(pthread_mutexattr_getpshared);
 EXPORT_SYMBOL_GPL(pthread_mutexattr_setpshared);
@@ -24,6 +24,7 @@
 struct {
 	pse51_node_t **node_buckets;
 	unsigned buckets_count;
+	unsigned nodes_count;
 
 	pse51_desc_t **descs;
 	unsigned maxfds;
@@ -44,7 +45,47 @@ static unsigned pse51_reg_crunch(const char *key)
 			h = (h ^ (g >> HQON)) ^ g;
 	}
 
-	return h % pse51_reg.buckets_count;
+	return h;
+}
+
+#define PSE51_REG_MAXBUCKETS 4096
+
+/*
+ * Keep the name hash chains short by doubling the bucket count when
+ * there are twice as many nodes as buckets. Called with nklock
+ * locked; allocation failures just leave the table as it is.
+ */
+static void pse51_reg_grow(void)
+{
+	pse51_node_t **buckets, *node, *next;
+	unsigned count, i, h;
+
+	if (pse51_reg.nodes_count <= 2 * pse51_reg.buckets_count ||
+	    pse51_reg.buckets_count >= PSE51_REG_MAXBUCKETS)
+		return;
+
+	count = pse51_reg.buckets_count * 2;
+	buckets = xnmalloc(count * sizeof(*buckets));
+	if (buckets == NULL)
+		return;
+
+	for (i = 0; i < count; i++)
+		buckets[i] = NULL;
+
+	for (i = 0; i < pse51_reg.buckets_count; i++)
+		for (node = pse51_reg.node_buckets[i]; node; node = next) {
+			next = node->next;
+			h = pse51_reg_crunch(node->name) % count;
+			node->next = buckets[h];
+			if (node->next)
+				node->next->prev = &node->next;
+			node->prev = &buckets[h];
+			buckets[h] = node;
+		}
+
+	xnfree(pse51_reg.node_buckets);
+	pse51_reg.node_buckets = buckets;
+	pse51_reg.buckets_count = count;
 }
 
 static int pse51_node_lookup(pse51_node_t *** node_linkp,
@@ -56,7 +97,8 @@ static int pse51_node_lookup(pse51_node_t *** node_linkp,
 	    sizeof((*node_link)->name))
 		return ENAMETOOLONG;
 
-	node_link = &pse51_reg.node_buckets[pse51_reg_crunch(name)];
+	node_link = &pse51_reg.node_buckets[pse51_reg_crunch(name) %
+					    pse51_reg.buckets_count];
 
 	while (*node_link) {
 		pse51_node_t *node = *node_link;
@@ -82,6 +124,7 @@ static void pse51_node_unbind(pse51_node_t * node)
 		node->next->prev = node_link;
 	node->prev = NULL;
 	node->next = NULL;
+	pse51_reg.nodes_count--;
 }
 
 int pse51_node_add(pse51_node_t * node, const char *name, unsigned magic)
@@ -107,6 +150,8 @@ int pse51_node_add(pse51_node_t * node, const char *name, unsigned magic)
 	*node_link = node;
 	strcpy(node->name, name);	/* name length is checked in
 					   pse51_node_lookup. */
+	pse51_reg.nodes_count++;
+	pse51_reg_grow();
 
 	return 0;
 }
@@ -274,6 +319,48 @@ int pse51_desc_get(pse51_desc_t ** descp, int fd, unsigned magic)
 
 DEFINE_XNLOCK(pse51_assoc_lock);
 
+static inline unsigned pse51_assoc_hash(u_long key)
+{
+	/* Keys are small descriptors or aligned addresses. */
+	return (unsigned)(key ^ (key >> 3) ^ (key >> 11));
+}
+
+void pse51_assocq_init(pse51_assocq_t * q)
+{
+	initq(&q->queue);
+	q->seq = 0;
+	q->overflow = 0;
+	memset(q->index, 0, sizeof(q->index));
+}
+
+/* Called with pse51_assoc_lock locked, interrupts off. */
+static void pse51_assoc_index(pse51_assocq_t * q, pse51_assoc_t * assoc,
+			      int add)
+{
+	unsigned h = pse51_assoc_hash(assoc->key), n;
+
+	for (n = 0; n < PSE51_ASSOC_PROBES; n++) {
+		unsigned i = (h + n) & (PSE51_ASSOC_HASHSZ - 1);
+
+		if (add ? q->index[i].assoc != NULL :
+		    q->index[i].assoc != assoc)
+			continue;
+
+		++q->seq;
+		xnarch_write_memory_barrier();
+		q->index[i].key = assoc->key;
+		q->index[i].assoc = add ? assoc : NULL;
+		xnarch_write_memory_barrier();
+		++q->seq;
+		return;
+	}
+
+	if (add)
+		q->overflow++;
+	else
+		q->overflow--;
+}
+
 static int pse51_assoc_lookup_inner(pse51_assocq_t * q,
 				    pse51_assoc_t ** passoc,
 				    u_long key)
@@ -281,7 +368,7 @@ static int pse51_assoc_lookup_inner(pse51_assocq_t * q,
 	pse51_assoc_t *assoc;
 	xnholder_t *holder;
 
-	holder = getheadq(q);
+	holder = getheadq(&q->queue);
 
 	if (!holder) {
 		/* empty list. */
@@ -291,7 +378,7 @@ static int pse51_assoc_lookup_inner(pse51_assocq_t * q,
 
 	do {
 		assoc = link2assoc(holder);
-		holder = nextq(q, holder);
+		holder = nextq(&q->queue, holder);
 	}
 	while (holder && (assoc->key < key));
 
@@ -325,9 +412,10 @@ int pse51_assoc_insert(pse51_assocq_t * q, pse51_assoc_t * assoc, u_long key)
 	assoc->key = key;
 	inith(&assoc->link);
 	if (next)
-		insertq(q, &next->link, &assoc->link);
+		insertq(&q->queue, &next->link, &assoc->link);
 	else
-		appendq(q, &assoc->link);
+		appendq(&q->queue, &assoc->link);
+	pse51_assoc_index(q, assoc, 1);
 
 	xnlock_put_irqrestore(&pse51_assoc_lock, s);
 
@@ -336,10 +424,34 @@ int pse51_assoc_insert(pse51_assocq_t * q, pse51_assoc_t * assoc, u_long key)
 
 pse51_assoc_t *pse51_assoc_lookup(pse51_assocq_t * q, u_long key)
 {
+	unsigned h = pse51_assoc_hash(key), seq, n, found;
 	pse51_assoc_t *assoc;
-	unsigned found;
 	spl_t s;
 
+	/*
+	 * The index lives as long as the process, so probing it
+	 * locklessly never touches released memory; a concurrent
+	 * update only makes us retry.
+	 */
+	do {
+		while ((seq = q->seq) & 1)
+			cpu_relax();
+		xnarch_read_memory_barrier();
+		assoc = NULL;
+		for (n = 0; n < PSE51_ASSOC_PROBES; n++) {
+			unsigned i = (h + n) & (PSE51_ASSOC_HASHSZ - 1);
+
+			if (q->index[i].key == key && q->index[i].assoc) {
+				assoc = q->index[i].assoc;
+				break;
+			}
+		}
+		xnarch_read_memory_barrier();
+	} while (q->seq != seq);
+
+	if (assoc || q->overflow == 0)
+		return assoc;
+
 	xnlock_get_irqsave(&pse51_assoc_lock, s);
 	found = pse51_assoc_lookup_inner(q, &assoc, key);
 	xnlock_put_irqrestore(&pse51_assoc_lock, s);
@@ -358,7 +470,8 @@ pse51_assoc_t *pse51_assoc_remove(pse51_assocq_t * q, u_long key)
 		return NULL;
 	}
 
-	removeq(q, &assoc->link);
+	removeq(&q->queue, &assoc->link);
+	pse51_assoc_index(q, assoc, 0);
 	xnlock_put_irqrestore(&pse51_assoc_lock, s);
 
 	return assoc;
@@ -371,8 +484,9 @@ void pse51_assocq_destroy(pse51_assocq_t * q, void (*destroy) (pse51_assoc_t *))
 	spl_t s;
 
 	xnlock_get_irqsave(&pse51_assoc_lock, s);
-	while ((holder = getq(q))) {
+	while ((holder = getq(&q->queue))) {
 		assoc = link2assoc(holder);
+		pse51_assoc_index(q, assoc, 0);
 		xnlock_put_irqrestore(&pse51_assoc_lock, s);
 		if (destroy)
 			destroy(assoc);
@@ -395,19 +509,25 @@ int pse51_reg_pkg_init(unsigned buckets_count, unsigned maxfds)
 	if (maxfds % BITS_PER_INT)
 		++mapsize;
 
-	size = sizeof(pse51_node_t) * buckets_count +
-		sizeof(pse51_desc_t) * maxfds + sizeof(unsigned) * mapsize;
+	size = sizeof(pse51_desc_t) * maxfds + sizeof(unsigned) * mapsize;
+
+	/* The name hash grows by itself, see pse51_reg_grow(). */
+	pse51_reg.node_buckets =
+		xnmalloc(sizeof(pse51_node_t *) * buckets_count);
+	if (!pse51_reg.node_buckets)
+		return ENOMEM;
 
 	chunk = (char *)xnarch_alloc_host_mem(size);
-	if (!chunk)
+	if (!chunk) {
+		xnfree(pse51_reg.node_buckets);
 		return ENOMEM;
+	}
 
-	pse51_reg.node_buckets = (pse51_node_t **) chunk;
 	pse51_reg.buckets_count = buckets_count;
+	pse51_reg.nodes_count = 0;
 	for (i = 0; i < buckets_count; i++)
 		pse51_reg.node_buckets[i] = NULL;
 
-	chunk += sizeof(pse51_node_t) * buckets_count;
 	pse51_reg.descs = (pse51_desc_t **) chunk;
 	for (i = 0; i < maxfds; i++)
 		pse51_reg.descs[i] = NULL;
@@ -452,9 +572,9 @@ void pse51_reg_pkg_cleanup(void)
 	}
 #endif /* XENO_DEBUG(POSIX) */
 
-	size = sizeof(pse51_node_t) * pse51_reg.buckets_count
-		+ sizeof(pse51_desc_t) * pse51_reg.maxfds
+	size = sizeof(pse51_desc_t) * pse51_reg.maxfds
 		+ sizeof(unsigned) * pse51_reg.mapsz;
 
-	xnarch_free_host_mem(pse51_reg.node_buckets, size);
+	xnarch_free_host_mem(pse51_reg.descs, size);
+	xnfree(pse51_reg.node_buckets);
 }
@@ -82,8 +82,6 @@ struct mm_struct;
 
 DECLARE_EXTERN_XNLOCK(pse51_assoc_lock);
 
-typedef xnqueue_t pse51_assocq_t;
-
 typedef struct {
     u_long key;
     xnholder_t link;
@@ -93,6 +91,22 @@ typedef struct {
 
 } pse51_assoc_t;
 
+#define PSE51_ASSOC_HASHSZ  64	/* Power of 2. */
+#define PSE51_ASSOC_PROBES  4
+
+/* Per-process associations, sorted by key in the queue. Exact-key
+   lookups go through a small open-addressed index which readers probe
+   without locking, retrying if the sequence count moved. */
+typedef struct {
+    xnqueue_t queue;
+    unsigned seq;		/* Odd while the index is updated. */
+    unsigned overflow;		/* Associations missing from the index. */
+    struct {
+	u_long key;
+	pse51_assoc_t *assoc;	/* NULL if the slot is free. */
+    } index[PSE51_ASSOC_HASHSZ];
+} pse51_assocq_t;
+
 typedef struct {
     unsigned long kfd;
     pse51_assoc_t assoc;
@@ -101,7 +115,7 @@ typedef struct {
     ((pse51_ufd_t *)((unsigned long) (laddr) - offsetof(pse51_ufd_t, assoc)))
 } pse51_ufd_t;
 
-#define pse51_assocq_init(q) (initq(q))
+void pse51_assocq_init(pse51_assocq_t *q);
 
 #define pse51_assoc_key(assoc) ((assoc)->key)
 
@@ -23,7 +23,7 @@
  * Thread scheduling services.
  *
  * Xenomai POSIX skin supports the scheduling policies SCHED_FIFO,
- * SCHED_RR, SCHED_SPORADIC, SCHED_TP and SCHED_OTHER.
+ * SCHED_RR, SCHED_SPORADIC, SCHED_TP, SCHED_EDF and SCHED_OTHER.
  *
  * The SCHED_OTHER policy is mainly useful for user-space non-realtime
  * activities that need to synchronize with real-time activities.
@@ -47,6 +47,16 @@
  * global time frame recurs from the first partition defined, when the
  * last partition has ended.
  *
+ * The SCHED_EDF policy schedules threads by increasing absolute
+ * deadline, ahead of all other policies. Each thread may consume at
+ * most its runtime budget per period, the end of the current period
+ * being its deadline; once the budget is exhausted, the thread is
+ * throttled until the next period begins. The sum of the
+ * runtime/period ratios of the SCHED_EDF threads running on a CPU is
+ * bounded by CONFIG_XENO_OPT_SCHED_EDF_BWLIMIT. The priority of a
+ * SCHED_EDF thread only serves as its preemption level, for
+ * priority inheritance and for ordering wait queues.
+ *
  * The scheduling policy and priority of a thread is set when creating a thread,
  * by using thread creation attributes (see pthread_attr_setinheritsched(),
  * pthread_attr_setschedpolicy() and pthread_attr_setschedparam()), or when the
@@ -58,6 +68,8 @@
  *
  *@{*/
 
+#include <nucleus/cachepart.h>
+#include <nucleus/budget.h>
 #include <posix/thread.h>
 
 /**
@@ -67,7 +79,7 @@
  * policy.
  *
  * @param policy scheduling policy, one of SCHED_FIFO, SCHED_RR,
- * SCHED_SPORADIC, SCHED_TP or SCHED_OTHER.
+ * SCHED_SPORADIC, SCHED_TP, SCHED_EDF or SCHED_OTHER.
  *
  * @retval 0 on success;
  * @retval -1 with @a errno set if:
@@ -85,6 +97,7 @@ int sched_get_priority_min(int policy)
 	case SCHED_RR:
 	case SCHED_SPORADIC:
 	case SCHED_TP:
+	case SCHED_EDF:
 		return PSE51_MIN_PRIORITY;
 
 	case SCHED_OTHER:
@@ -103,7 +116,7 @@ int sched_get_priority_min(int policy)
  * policy.
  *
  * @param policy scheduling policy, one of SCHED_FIFO, SCHED_RR,
- * SCHED_SPORADIC, SCHED_TP or SCHED_OTHER.
+ * SCHED_SPORADIC, SCHED_TP, SCHED_EDF or SCHED_OTHER.
  *
  * @retval 0 on success;
  * @retval -1 with @a errno set if:
@@ -121,6 +134,7 @@ int sched_get_priority_max(int policy)
 	case SCHED_RR:
 	case SCHED_SPORADIC:
 	case SCHED_TP:
+	case SCHED_EDF:
 		return PSE51_MAX_PRIORITY;
 
 	case SCHED_OTHER:
@@ -289,6 +303,14 @@ int pthread_getschedparam_ex(pthread_t tid, int *pol, struct sched_param_ex *par
 		goto unlock_and_exit;
 	}
 #endif
+#ifdef CONFIG_XENO_OPT_SCHED_EDF
+	if (base_class == &xnsched_class_edf) {
+		*pol = SCHED_EDF;
+		ticks2ts(&par->sched_edf_runtime, thread->pedf->param.runtime);
+		ticks2ts(&par->sched_edf_period, thread->pedf->param.period);
+		goto unlock_and_exit;
+	}
+#endif
 
 unlock_and_exit:
 
@@ -314,7 +336,7 @@ unlock_and_exit:
  * @param tid target thread;
  *
  * @param pol scheduling policy, one of SCHED_FIFO, SCHED_RR,
- * SCHED_SPORADIC, SCHED_TP or SCHED_OTHER;
+ * SCHED_SPORADIC, SCHED_TP, SCHED_EDF or SCHED_OTHER;
  *
  * @param par scheduling parameters address.
  *
@@ -375,6 +397,7 @@ int pthread_setschedparam(pthread_t tid, int pol, const struct sched_param *par)
 	case SCHED_FIFO:
 	case SCHED_SPORADIC:
 	case SCHED_TP:
+	case SCHED_EDF:
 		xnpod_set_thread_tslice(&tid->threadbase, XN_INFINITE);
 		break;
 
@@ -409,8 +432,8 @@ int pthread_setschedparam(pthread_t tid, int pol, const struct sched_param *par)
  * that supports Xenomai-specific or additional POSIX scheduling
  * policies, which are not available with the host Linux environment.
  *
- * Typically, a Xenomai thread policy can be set to SCHED_SPORADIC or
- * SCHED_TP using this call.
+ * Typically, a Xenomai thread policy can be set to SCHED_SPORADIC,
+ * SCHED_TP or SCHED_EDF using this call.
  *
  * @param tid target thread;
  *
@@ -425,6 +448,8 @@ int pthread_setschedparam(pthread_t tid, int pol, const struct sched_param *par)
  * - ESRCH, @a tid is invalid.
  * - EINVAL, @a par contains invalid parameters.
  * - ENOMEM, lack of memory to perform the operation.
+ * - EBUSY, @a pol is SCHED_EDF and the CPU of @a tid cannot reserve
+ *   the requested bandwidth.
  *
  * @see
  * <a href="http://www.opengroup.org/onlinepubs/000095399/functions/pthread_getschedparam.html">
@@ -485,6 +510,16 @@ int pthread_setschedparam_ex(pthread_t tid, int pol, const struct sched_param_ex
 		ret = -xnpod_set_thread_schedparam(&tid->threadbase,
 						   &xnsched_class_tp, &param);
 		break;
+#endif
+#ifdef CONFIG_XENO_OPT_SCHED_EDF
+	case SCHED_EDF:
+		xnpod_set_thread_tslice(&tid->threadbase, XN_INFINITE);
+		param.edf.prio = par->sched_priority;
+		param.edf.runtime = ts2ticks_ceil(&par->sched_edf_runtime);
+		param.edf.period = ts2ticks_ceil(&par->sched_edf_period);
+		ret = -xnpod_set_thread_schedparam(&tid->threadbase,
+						   &xnsched_class_edf, &param);
+		break;
 #endif
 	}
 
@@ -586,17 +621,99 @@ int set_tp_config(int cpu, union sched_config *config, size_t len)
 
 #endif /* !CONFIG_XENO_OPT_SCHED_TP */
 
+#ifdef CONFIG_XENO_OPT_CACHE_PARTITION
+
+static inline
+int set_cache_config(int cpu, union sched_config *config, size_t len)
+{
+	struct xnthread *thread;
+
+	if (len < sizeof(config->cache))
+		return EINVAL;
+
+	switch (config->cache.op) {
+	case SCHED_CACHE_MASK:
+		return -xncachepart_set_mask(config->cache.clos,
+					     config->cache.mask);
+	case SCHED_CACHE_CPU:
+		return -xncachepart_set_cpu(cpu, config->cache.clos);
+	case SCHED_CACHE_SELF:
+		thread = xnpod_primary_p() ? xnpod_current_thread() :
+			xnshadow_thread(current);
+		if (thread == NULL)
+			return EPERM;
+		return -xncachepart_set_thread(thread, config->cache.clos);
+	}
+
+	return EINVAL;
+}
+
+#else /* !CONFIG_XENO_OPT_CACHE_PARTITION */
+
+static inline
+int set_cache_config(int cpu, union sched_config *config, size_t len)
+{
+	return EINVAL;
+}
+
+#endif /* !CONFIG_XENO_OPT_CACHE_PARTITION */
+
+#ifdef CONFIG_XENO_OPT_SCHED_BUDGET
+
+static inline xnticks_t ts2ns(const struct timespec *ts)
+{
+	return (xnticks_t)ts->tv_sec * ONE_BILLION + ts->tv_nsec;
+}
+
+static inline
+int set_budget_config(int cpu, union sched_config *config, size_t len)
+{
+	struct __sched_config_budget *b = &config->budget;
+	struct xnthread *thread;
+
+	if (len < sizeof(*b))
+		return EINVAL;
+
+	if (b->quota.tv_sec < 0 ||
+	    (unsigned long)b->quota.tv_nsec >= ONE_BILLION ||
+	    b->period.tv_sec < 0 ||
+	    (unsigned long)b->period.tv_nsec >= ONE_BILLION)
+		return EINVAL;
+
+	thread = xnpod_primary_p() ? xnpod_current_thread() :
+		xnshadow_thread(current);
+	if (thread == NULL)
+		return EPERM;
+
+	return -xnbudget_set(thread, ts2ns(&b->quota), ts2ns(&b->period),
+			     b->action, b->demote_prio);
+}
+
+#else /* !CONFIG_XENO_OPT_SCHED_BUDGET */
+
+static inline
+int set_budget_config(int cpu, union sched_config *config, size_t len)
+{
+	return EINVAL;
+}
+
+#endif /* !CONFIG_XENO_OPT_SCHED_BUDGET */
+
 /**
  * Load CPU-specific scheduler settings for a given policy.
  *
- * Currently, this call only supports the SCHED_TP policy, for loading
- * the temporal partitions. A configuration is strictly local to the
- * target @a cpu, and may differ from other processors.
+ * Currently, this call supports the SCHED_TP policy, for loading
+ * the temporal partitions, the SCHED_CACHE pseudo-policy, for
+ * partitioning the last level cache, and the SCHED_BUDGET
+ * pseudo-policy, for capping the CPU time of threads. A SCHED_TP configuration is
+ * strictly local to the target @a cpu, and may differ from other
+ * processors.
  *
  * @param cpu processor to load the configuration of.
  *
  * @param policy scheduling policy to which the configuration data
- * applies. Currently, only SCHED_TP is valid.
+ * applies. Currently, only SCHED_TP, SCHED_CACHE and SCHED_BUDGET
+ * are valid.
  *
  * @param p a pointer to the configuration data to load for @a
  * cpu, applicable to @a policy.
@@ -624,14 +741,54 @@ int set_tp_config(int cpu, union sched_config *config, size_t len)
  * - config.tp.nr_windows should define the number of elements present
  * in the config.tp.windows[] array.
  *
+ * Settings applicable to SCHED_CACHE:
+ *
+ * This call assigns classes of last level cache ways, on CPUs
+ * supporting it (see CONFIG_XENO_OPT_CACHE_PARTITION). Depending on
+ * config.cache.op:
+ *
+ * - SCHED_CACHE_MASK sets the ways class config.cache.clos may fill
+ * to config.cache.mask, a non-empty set of contiguous bits. Class 0
+ * is the one Linux runs with. @a cpu is ignored.
+ *
+ * - SCHED_CACHE_CPU sets the class real-time threads running on @a
+ * cpu use by default to config.cache.clos, -1 reverting to the class
+ * Linux runs with.
+ *
+ * - SCHED_CACHE_SELF sets the class of the calling thread to
+ * config.cache.clos, -1 reverting to the default class of its
+ * CPU. @a cpu is ignored.
+ *
+ * Settings applicable to SCHED_BUDGET:
+ *
+ * This call caps the CPU time the calling thread may consume in
+ * primary mode to config.budget.quota every config.budget.period, a
+ * new period starting upon the call. A null quota removes the
+ * budget. Upon overrun, depending on config.budget.action:
+ *
+ * - SCHED_BUDGET_NOTIFY only counts the overrun;
+ *
+ * - SCHED_BUDGET_DEMOTE lowers the priority of a SCHED_FIFO or
+ * SCHED_RR caller to config.budget.demote_prio;
+ *
+ * - SCHED_BUDGET_SUSPEND holds the caller.
+ *
+ * Either way, the next period restores the caller. Overruns are
+ * reported by /proc/xenomai/budget. @a cpu is ignored.
+ *
  * @param len size of the configuration data (in bytes).
  *
  * @return 0 on success;
  * @return an error number if:
  * - EINVAL, @a cpu is invalid, @a policy is different from SCHED_TP,
- * SCHED_TP support is not compiled in (see CONFIG_XENO_OPT_SCHED_TP),
- * @a len is zero, or @a p contains invalid parameters.
+ * SCHED_CACHE and SCHED_BUDGET, support for @a policy is not
+ * compiled in (see CONFIG_XENO_OPT_SCHED_TP,
+ * CONFIG_XENO_OPT_CACHE_PARTITION, CONFIG_XENO_OPT_SCHED_BUDGET), @a
+ * len is zero, or @a p contains invalid parameters.
  * - ENOMEM, lack of memory to perform the operation.
+ * - ENODEV, the CPU cannot partition its cache (SCHED_CACHE).
+ * - EPERM, the caller is not a Xenomai thread (SCHED_CACHE_SELF,
+ * SCHED_BUDGET).
  */
 int sched_setconfig_np(int cpu, int policy,
 		       union sched_config *config, size_t len)
@@ -642,6 +799,12 @@ int sched_setconfig_np(int cpu, int policy,
 	case SCHED_TP:
 		ret = set_tp_config(cpu, config, len);
 		break;
+	case SCHED_CACHE:
+		ret = set_cache_config(cpu, config, len);
+		break;
+	case SCHED_BUDGET:
+		ret = set_budget_config(cpu, config, len);
+		break;
 	default:
 		ret = EINVAL;
 	}
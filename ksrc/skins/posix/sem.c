@@ -34,6 +34,7 @@
 #include <stddef.h>
 #include <stdarg.h>
 
+#include <nucleus/sys_ppd.h>
 #include <posix/registry.h>	/* For named semaphores. */
 #include <posix/thread.h>
 #include <posix/sem.h>
@@ -46,7 +47,10 @@ typedef struct pse51_sem {
 #define link2sem(laddr)                                                 \
     ((pse51_sem_t *)(((char *)(laddr)) - offsetof(pse51_sem_t, link)))
 
-	int value;
+	xnarch_atomic_t *fastcnt; /* Value and waiter flag. */
+#ifndef CONFIG_XENO_FASTSYNCH
+	xnarch_atomic_t value;	/* Storage for the value. */
+#endif /* !CONFIG_XENO_FASTSYNCH */
 	unsigned pshared;
 	unsigned is_named;
 	pse51_kqueues_t *owningq;
@@ -63,6 +67,8 @@ typedef struct pse51_named_sem {
 	union __xeno_sem descriptor;
 } nsem_t;
 
+static xnobjpool_t sem_pool;	/* Unnamed semaphores. */
+
 #ifdef CONFIG_XENO_OPT_PERVASIVE
 typedef struct pse51_uptr {
 	struct mm_struct *mm;
@@ -86,23 +92,57 @@ static void sem_destroy_inner(pse51_sem_t * sem, pse51_kqueues_t *q)
 		xnpod_schedule();
 	xnlock_put_irqrestore(&nklock, s);
 
+#ifdef CONFIG_XENO_FASTSYNCH
+	xnheap_free(&xnsys_ppd_get(sem->pshared)->sem_heap, sem->fastcnt);
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 	if (sem->is_named)
 		xnfree(sem2named_sem(sem));
 	else
-		xnfree(sem);
+		xnobjpool_free(&sem_pool, sem);
+}
+
+#ifdef CONFIG_XENO_FASTSYNCH
+static xnarch_atomic_t *sem_alloc_fastcnt(int pshared)
+{
+	return xnheap_alloc(&xnsys_ppd_get(pshared)->sem_heap,
+			    xnheap_synch_size(sizeof(xnarch_atomic_t), 0));
+}
+
+static void sem_free_fastcnt(xnarch_atomic_t *fastcnt, int pshared)
+{
+	xnheap_free(&xnsys_ppd_get(pshared)->sem_heap, fastcnt);
 }
 
+static void sem_fill_shadow(struct __shadow_sem *shadow, pse51_sem_t *sem)
+{
+	shadow->value_offset =
+		xnheap_mapped_offset(&xnsys_ppd_get(sem->pshared)->sem_heap,
+				     sem->fastcnt);
+	shadow->pshared = sem->pshared;
+}
+#else /* !CONFIG_XENO_FASTSYNCH */
+#define sem_free_fastcnt(fastcnt, pshared)	do { } while(0)
+#define sem_fill_shadow(shadow, sem)		do { } while(0)
+#endif /* !CONFIG_XENO_FASTSYNCH */
+
 /* Called with nklock locked, irq off. */
-static int pse51_sem_init_inner(pse51_sem_t * sem, int pshared, unsigned value)
+static int pse51_sem_init_inner(pse51_sem_t * sem, int pshared, unsigned value,
+				xnarch_atomic_t *fastcnt)
 {
 	if (value > (unsigned)SEM_VALUE_MAX)
 		return EINVAL;
 
+#ifndef CONFIG_XENO_FASTSYNCH
+	fastcnt = &sem->value;
+#endif /* !CONFIG_XENO_FASTSYNCH */
+
 	sem->magic = PSE51_SEM_MAGIC;
 	inith(&sem->link);
 	appendq(&pse51_kqueues(pshared)->semq, &sem->link);
 	xnsynch_init(&sem->synchbase, XNSYNCH_PRIO, NULL);
-	sem->value = value;
+	xnarch_atomic_set(fastcnt, value);
+	sem->fastcnt = fastcnt;
 	sem->pshared = pshared;
 	sem->is_named = 0;
 	sem->owningq = pse51_kqueues(pshared);
@@ -130,7 +170,8 @@ static int pse51_sem_init_inner(pse51_sem_t * sem, int pshared, unsigned value)
  * @retval -1 with @a errno set if:
  * - EBUSY, the semaphore @a sm was already initialized;
  * - ENOSPC, insufficient memory exists in the system heap to initialize the
- *   semaphore, increase CONFIG_XENO_OPT_SYS_HEAPSZ;
+ *   semaphore, increase CONFIG_XENO_OPT_SYS_HEAPSZ, or in the semaphore heap
+ *   to allocate its shared counter;
  * - EINVAL, the @a value argument exceeds @a SEM_VALUE_MAX.
  *
  * @see
@@ -141,17 +182,29 @@ static int pse51_sem_init_inner(pse51_sem_t * sem, int pshared, unsigned value)
 int sem_init(sem_t * sm, int pshared, unsigned value)
 {
 	struct __shadow_sem *shadow = &((union __xeno_sem *)sm)->shadow_sem;
+	xnarch_atomic_t *fastcnt;
 	pse51_sem_t *sem;
 	xnqueue_t *semq;
 	int err;
 	spl_t s;
 
-	sem = (pse51_sem_t *) xnmalloc(sizeof(pse51_sem_t));
+	sem = (pse51_sem_t *) xnobjpool_alloc(&sem_pool);
 	if (!sem) {
 		err = ENOSPC;
 		goto error;
 	}
 
+#ifdef CONFIG_XENO_FASTSYNCH
+	fastcnt = sem_alloc_fastcnt(pshared);
+	if (!fastcnt) {
+		xnobjpool_free(&sem_pool, sem);
+		err = ENOSPC;
+		goto error;
+	}
+#else /* !CONFIG_XENO_FASTSYNCH */
+	fastcnt = NULL;
+#endif /* !CONFIG_XENO_FASTSYNCH */
+
 	xnlock_get_irqsave(&nklock, s);
 
 	semq = &pse51_kqueues(pshared)->semq;
@@ -169,19 +222,21 @@ int sem_init(sem_t * sm, int pshared, unsigned value)
 			}
 	}
 
-	err = pse51_sem_init_inner(sem, pshared, value);
+	err = pse51_sem_init_inner(sem, pshared, value, fastcnt);
 	if (err)
 		goto err_lock_put;
 
 	shadow->magic = PSE51_SEM_MAGIC;
 	shadow->sem = sem;
+	sem_fill_shadow(shadow, sem);
 	xnlock_put_irqrestore(&nklock, s);
 
 	return 0;
 
   err_lock_put:
 	xnlock_put_irqrestore(&nklock, s);
-	xnfree(sem);
+	sem_free_fastcnt(fastcnt, pshared);
+	xnobjpool_free(&sem_pool, sem);
   error:
 	thread_set_errno(err);
 
@@ -278,7 +333,8 @@ int sem_destroy(sem_t * sm)
  * - ENOENT, the bit @a O_CREAT is not set in @a oflags and the named semaphore
  *   does not exist;
  * - ENOSPC, insufficient memory exists in the system heap to create the
- *   semaphore, increase CONFIG_XENO_OPT_SYS_HEAPSZ;
+ *   semaphore, increase CONFIG_XENO_OPT_SYS_HEAPSZ, or in the global
+ *   semaphore heap to allocate its shared counter;
  * - EINVAL, the @a value argument exceeds @a SEM_VALUE_MAX.
  *
  * @see
@@ -288,6 +344,7 @@ int sem_destroy(sem_t * sm)
  */
 sem_t *sem_open(const char *name, int oflags, ...)
 {
+	xnarch_atomic_t *fastcnt;
 	pse51_node_t *node;
 	nsem_t *named_sem;
 	unsigned value;
@@ -313,6 +370,18 @@ sem_t *sem_open(const char *name, int oflags, ...)
 		err = ENOSPC;
 		goto error;
 	}
+
+#ifdef CONFIG_XENO_FASTSYNCH
+	fastcnt = sem_alloc_fastcnt(1);
+	if (!fastcnt) {
+		xnfree(named_sem);
+		err = ENOSPC;
+		goto error;
+	}
+#else /* !CONFIG_XENO_FASTSYNCH */
+	fastcnt = NULL;
+#endif /* !CONFIG_XENO_FASTSYNCH */
+
 	named_sem->sembase.is_named = 1;
 	named_sem->descriptor.shadow_sem.sem = &named_sem->sembase;
 
@@ -322,13 +391,16 @@ sem_t *sem_open(const char *name, int oflags, ...)
 	va_end(ap);
 
 	xnlock_get_irqsave(&nklock, s);
-	err = pse51_sem_init_inner(&named_sem->sembase, 1, value);
+	err = pse51_sem_init_inner(&named_sem->sembase, 1, value, fastcnt);
 	if (err) {
 		xnlock_put_irqrestore(&nklock, s);
+		sem_free_fastcnt(fastcnt, 1);
 		xnfree(named_sem);
 		goto error;
 	}
 
+	sem_fill_shadow(&named_sem->descriptor.shadow_sem, &named_sem->sembase);
+
 	err = pse51_node_add(&named_sem->nodebase, name, PSE51_NAMED_SEM_MAGIC);
 	if (err && err != EEXIST)
 		goto err_put_lock;
@@ -505,11 +577,9 @@ static inline int sem_trywait_internal(struct __shadow_sem *shadow)
 		return EPERM;
 #endif /* XENO_DEBUG(POSIX) */
 
-	if (sem->value == 0)
+	if (xnsynch_fast_count_down(sem->fastcnt))
 		return EAGAIN;
 
-	--sem->value;
-
 	return 0;
 }
 
@@ -571,11 +641,22 @@ static inline int sem_timedwait_internal(struct __shadow_sem *shadow,
 
 	thread_cancellation_point(cur);
 
+	/*
+	 * Raise the waiter flag, unless some unit was posted from
+	 * user-space in the meantime.
+	 */
+	if (xnsynch_fast_count_wait(sem->fastcnt) == 0)
+		return 0;
+
 	if (timed)
 		xnsynch_sleep_on(&sem->synchbase, to, XN_REALTIME);
 	else
 		xnsynch_sleep_on(&sem->synchbase, XN_INFINITE, XN_RELATIVE);
 
+	if (!xnthread_test_info(cur, XNRMID) &&
+	    !xnsynch_pended_p(&sem->synchbase))
+		xnsynch_fast_count_settle(sem->fastcnt);
+
 	/* Handle cancellation requests. */
 	thread_cancellation_point(cur);
 
@@ -706,6 +787,12 @@ int sem_timedwait(sem_t * sm, const struct timespec *abs_timeout)
  * If no thread is currently blocked on this semaphore, its count is
  * incremented, otherwise the highest priority thread is unblocked.
  *
+ * When called from user-space, a semaphore no thread is blocked on is
+ * unlocked without entering the kernel, by updating its counter in the
+ * semaphore heap. Likewise, sem_trywait() and sem_wait() lock an
+ * unlocked semaphore from user-space when called from a thread running
+ * in primary mode.
+ *
  * @param sm the semaphore to be unlocked.
  *
  * @retval 0 on success;
@@ -744,16 +831,15 @@ int sem_post(sem_t * sm)
 	}
 #endif /* XENO_DEBUG(POSIX) */
 
-	if (sem->value == SEM_VALUE_MAX) {
+	if (xnsynch_wakeup_one_sleeper(&sem->synchbase) != NULL) {
+		if (!xnsynch_pended_p(&sem->synchbase))
+			xnsynch_fast_count_settle(sem->fastcnt);
+		xnpod_schedule();
+	} else if (xnsynch_fast_count_post(sem->fastcnt, SEM_VALUE_MAX)) {
 		thread_set_errno(EAGAIN);
 		goto error;
 	}
 
-	if (xnsynch_wakeup_one_sleeper(&sem->synchbase) != NULL)
-		xnpod_schedule();
-	else
-		++sem->value;
-
 	xnlock_put_irqrestore(&nklock, s);
 
 	return 0;
@@ -812,7 +898,7 @@ int sem_getvalue(sem_t * sm, int *value)
 		return -1;
 	}
 
-	*value = sem->value;
+	*value = xnsynch_fast_count_get(sem->fastcnt);
 
 	xnlock_put_irqrestore(&nklock, s);
 
@@ -873,11 +959,14 @@ void pse51_semq_cleanup(pse51_kqueues_t *q)
 void pse51_sem_pkg_init(void)
 {
 	initq(&pse51_global_kqueues.semq);
+	xnobjpool_init(&sem_pool, "posix.sem", sizeof(pse51_sem_t),
+		       CONFIG_XENO_OPT_POSIX_SEM_POOLSZ);
 }
 
 void pse51_sem_pkg_cleanup(void)
 {
 	pse51_semq_cleanup(&pse51_global_kqueues);
+	xnobjpool_destroy(&sem_pool);
 }
 
 /*@}*/
@@ -39,6 +39,7 @@
 #include <posix/thread.h>
 #include <posix/shm.h>
 #include <linux/fs.h>		/* Make sure ERR_PTR is defined for all kernel versions */
+#include <linux/vmalloc.h>
 
 typedef struct pse51_shm {
 	pse51_node_t nodebase;
@@ -186,7 +187,15 @@ static void pse51_shm_put(pse51_shm_t * shm, unsigned dec)
  * currently mapped, its size is truncated to 0.
  *
  * If @a oflags has the bit @a O_DIRECT set, the shared memory will be suitable
- * for direct memory access (allocated in physically contiguous memory).
+ * for direct memory access (allocated in physically contiguous memory). The
+ * physical address of such memory may be obtained with shm_physaddr_np(), for
+ * handing it over to a DMA engine.
+ *
+ * If @a oflags has the bit @a O_SYNC set, the shared memory will be mapped
+ * non-cached into user-space processes, so that data written by a bus master
+ * is seen immediately by the processes. Along with @a O_DIRECT, only the
+ * user-space mappings are non-cached, kernel-space accesses still go through
+ * the cached linear mapping.
  *
  * @a name may be any arbitrary string, in which slashes have no particular
  * meaning. However, for portability, using a name which starts with a slash and
@@ -276,7 +285,7 @@ int shm_open(const char *name, int oflags, mode_t mode)
 
   got_shm:
 	err = pse51_desc_create(&desc, &shm->nodebase,
-				oflags & (PSE51_PERMS_MASK | O_DIRECT));
+				oflags & (PSE51_PERMS_MASK | O_DIRECT | O_SYNC));
 	if (err)
 		goto err_shm_put;
 
@@ -431,7 +440,8 @@ int shm_unlink(const char *name)
  * shared memory object, the added space is zero-filled.
  *
  * Shared memory are suitable for direct memory access (allocated in physically
- * contiguous memory) if O_DIRECT was passed to shm_open.
+ * contiguous memory) if O_DIRECT was passed to shm_open, and mapped non-cached
+ * into user-space processes if O_SYNC was passed to shm_open.
  *
  * Shared memory objects may only be resized if they are not currently mapped.
  *
@@ -537,7 +547,9 @@ int ftruncate(int fd, off_t len)
 
 		if (len) {
 			int flags = XNARCH_SHARED_HEAP_FLAGS |
-				((desc_flags & O_DIRECT) ? GFP_DMA : 0);
+				((desc_flags & O_DIRECT) ? GFP_DMA : 0) |
+				((desc_flags & O_SYNC) == O_SYNC ?
+				 XNHEAP_GFP_NONCACHED : 0);
 
 			err = -xnheap_init_mapped(&shm->heapbase, len, flags);
 			if (err)
@@ -861,6 +873,98 @@ int munmap(void *addr, size_t len)
 	return -1;
 }
 
+static unsigned long pse51_shm_pfn(unsigned long vaddr)
+{
+	if (vaddr >= VMALLOC_START && vaddr < VMALLOC_END)
+		return page_to_pfn(vmalloc_to_page((void *)vaddr));
+
+	return virt_to_phys((void *)vaddr) >> PAGE_SHIFT;
+}
+
+/**
+ * Get the physical address of a shared memory region.
+ *
+ * This service returns the physical address of the mapped shared memory region
+ * [addr;addr+len), so that it may be handed over to a device driver or a DMA
+ * engine, which may then read from or write to the region directly. The region
+ * must be physically contiguous, which is guaranteed for shared memory objects
+ * opened with the @a O_DIRECT flag (see shm_open()).
+ *
+ * This service is a non-portable extension of the POSIX interface.
+ *
+ * @param addr start address of the region, within a mapping returned by
+ * mmap();
+ *
+ * @param len length of the region;
+ *
+ * @param physp address where the physical address of @a addr is stored upon
+ * success.
+ *
+ * @retval 0 on success;
+ * @retval -1 with @a errno set if:
+ * - EINVAL, @a len is null or the region overflows the shared memory object;
+ * - ENXIO, @a addr is not the address of a shared memory area;
+ * - ENOTSUP, the region is not physically contiguous.
+ *
+ * @par Valid contexts:
+ * - kernel module initialization or cleanup routine;
+ * - kernel-space thread;
+ * - user-space thread.
+ *
+ */
+int shm_physaddr_np(void *addr, size_t len, unsigned long long *physp)
+{
+	unsigned long vaddr, end, pfn, base;
+	pse51_shm_t *shm;
+	int err;
+	spl_t s;
+
+	if (!len) {
+		err = EINVAL;
+		goto error;
+	}
+
+	xnlock_get_irqsave(&nklock, s);
+	shm = pse51_shm_lookup(addr);
+
+	if (!shm) {
+		xnlock_put_irqrestore(&nklock, s);
+		err = ENXIO;
+		goto error;
+	}
+
+	++shm->nodebase.refcount;
+	xnlock_put_irqrestore(&nklock, s);
+
+	base = PAGE_ALIGN((u_long)shm->addr);
+	vaddr = (unsigned long)addr;
+	end = vaddr + len;
+	if (vaddr < base || end > base + shm->size || end < vaddr) {
+		err = EINVAL;
+		goto err_shm_put;
+	}
+
+	/* Make sure the whole region is backed by contiguous frames. */
+	pfn = pse51_shm_pfn(vaddr & PAGE_MASK);
+	*physp = ((unsigned long long)pfn << PAGE_SHIFT) + (vaddr & ~PAGE_MASK);
+
+	for (vaddr = (vaddr & PAGE_MASK) + PAGE_SIZE;
+	     vaddr < end; vaddr += PAGE_SIZE)
+		if (pse51_shm_pfn(vaddr) != ++pfn) {
+			err = ENOTSUP;
+			goto err_shm_put;
+		}
+
+	pse51_shm_put(shm, 1);
+	return 0;
+
+      err_shm_put:
+	pse51_shm_put(shm, 1);
+      error:
+	thread_set_errno(err);
+	return -1;
+}
+
 #ifdef CONFIG_XENO_OPT_PERVASIVE
 int pse51_xnheap_get(xnheap_t **pheap, void *addr)
 {
@@ -948,3 +1052,4 @@ EXPORT_SYMBOL_GPL(pse51_shm_close);
 EXPORT_SYMBOL_GPL(ftruncate);
 EXPORT_SYMBOL_GPL(mmap);
 EXPORT_SYMBOL_GPL(munmap);
+EXPORT_SYMBOL_GPL(shm_physaddr_np);
@@ -24,9 +24,10 @@
 
 #define SIGACTION_FLAGS (SA_ONESHOT|SA_NOMASK|SA_SIGINFO)
 
-typedef struct {
+typedef struct pse51_siginfo {
     siginfo_t info;
     xnpholder_t link;
+    xnpqueue_t *pool;		/* Free list this block returns to. */
 
 #define link2siginfo(iaddr) \
     ((pse51_siginfo_t *)(((char *)iaddr) - offsetof(pse51_siginfo_t, link)))
@@ -39,6 +40,10 @@ int pse51_sigqueue_inner(pthread_t thread, pse51_siginfo_t *si);
 
 void pse51_sigunqueue(pthread_t thread, pse51_siginfo_t *si);
 
+/* Size of the signal pool trailing the TCB of a thread created with attr. */
+#define pse51_sigpool_size(attr) \
+    ((size_t)(attr)->sigqueue * sizeof(pse51_siginfo_t))
+
 void pse51_signal_init_thread(pthread_t new, const pthread_t parent);
 
 void pse51_signal_cleanup_thread(pthread_t zombie);
@@ -66,14 +66,19 @@ static struct sigaction actions[SIGRTMAX];
 static pse51_siginfo_t pse51_infos_pool[PSE51_SIGQUEUE_MAX];
 static xnpqueue_t pse51_infos_free_list;
 
-static pse51_siginfo_t *pse51_new_siginfo(int sig, int code, union sigval value)
+static pse51_siginfo_t *pse51_new_siginfo(pthread_t thread,
+					   int sig, int code, union sigval value)
 {
 	xnpholder_t *holder;
 	pse51_siginfo_t *si;
 
-	holder = getpq(&pse51_infos_free_list);
-	if (!holder)
-		return NULL;
+	/* Draw from the private pool of the target first. */
+	holder = getpq(&thread->sigpool);
+	if (!holder) {
+		holder = getpq(&pse51_infos_free_list);
+		if (!holder)
+			return NULL;
+	}
 
 	si = link2siginfo(holder);
 	si->info.si_signo = sig;
@@ -88,7 +93,16 @@ static void pse51_delete_siginfo(pse51_siginfo_t * si)
 	initph(&si->link);
 	si->info.si_signo = 0;	/* Used for debugging. */
 
-	insertpqlr(&pse51_infos_free_list, &si->link, 0);
+	insertpqlr(si->pool, &si->link, 0);
+}
+
+static void pse51_fill_sigpool(xnpqueue_t *pool, pse51_siginfo_t *si, int count)
+{
+	initpq(pool);
+	for (; count > 0; count--, si++) {
+		si->pool = pool;
+		pse51_delete_siginfo(si);
+	}
 }
 
 static inline void emptyset(pse51_sigset_t *set)
@@ -147,6 +161,26 @@ static inline void andnotset(pse51_sigset_t *set,
 	*set = (*left) & ~(*right);
 }
 
+/* Since signals below SIGRTMIN are not real-time, they should be treated after
+   real-time signals, hence their priority. */
+static inline unsigned sigprio(int sig)
+{
+	return sig < SIGRTMIN ? sig + SIGRTMAX : sig;
+}
+
+/* Return the signal of the non-empty set "set" which comes first in priority
+   order. */
+static inline int firstsig(const pse51_sigset_t *set)
+{
+	pse51_sigset_t rt = *set & ~(((pse51_sigset_t)1 << (SIGRTMIN - 1)) - 1);
+	pse51_sigset_t first = rt ?: *set;
+
+	if ((u32)first)
+		return ffs((u32)first);
+
+	return 32 + ffs((u32)(first >> 32));
+}
+
 /**
  * Initialize and empty a signal set.
  *
@@ -300,13 +334,21 @@ int pse51_sigqueue_inner(pthread_t thread, pse51_siginfo_t * si)
 		 return 0;
 
 	signum = si->info.si_signo;
-	/* Since signals below SIGRTMIN are not real-time, they should be treated
-	   after real-time signals, hence their priority. */
-	prio = signum < SIGRTMIN ? signum + SIGRTMAX : signum;
+	prio = sigprio(signum);
 
 	initph(&si->link);
 
 	if (ismember(&thread->sigmask, signum)) {
+		if (thread->sigwait_set && !thread->sigwait_si
+		    && ismember(thread->sigwait_set, signum)) {
+			/* The target waits for this very signal in
+			   sigtimedwait(), hand it over directly instead of
+			   queuing it and kicking the thread. */
+			thread->sigwait_si = si;
+			xnpod_resume_thread(&thread->threadbase, XNDELAY);
+			return 1;
+		}
+
 		addset(&thread->blocked_received.mask, signum);
 		insertpqfr(&thread->blocked_received.list, &si->link, prio);
 	} else {
@@ -343,6 +385,12 @@ void pse51_sigunqueue(pthread_t thread, pse51_siginfo_t * si)
 	pse51_sigqueue_t *queue;
 	xnpholder_t *next;
 
+	if (thread->sigwait_si == si) {
+		/* Handed over to sigtimedwait(), but not consumed yet. */
+		thread->sigwait_si = NULL;
+		return;
+	}
+
 	if (ismember(&thread->sigmask, si->info.si_signo))
 		queue = &thread->blocked_received;
 	else
@@ -353,7 +401,7 @@ void pse51_sigunqueue(pthread_t thread, pse51_siginfo_t * si)
 	   much less efficient. */
 	next = nextpq(&queue->list, &si->link);
 	if ((!next || next->prio != si->link.prio)
-	    && findpqh(&queue->list, si->link.prio) == &si->link)
+	    && findpqhr(&queue->list, si->link.prio) == &si->link)
 		delset(&queue->mask, si->info.si_signo);
 
 	removepq(&queue->list, &si->link);
@@ -366,9 +414,23 @@ static pse51_siginfo_t *pse51_getsigq(pse51_sigqueue_t * queue,
 				      pse51_siginfo_t ** start)
 {
 	xnpholder_t *holder, *next;
+	pse51_sigset_t wanted;
 	pse51_siginfo_t *si;
 
-	next = (start && *start) ? &(*start)->link : getheadpq(&queue->list);
+	if (start && *start)
+		next = &(*start)->link;
+	else {
+		/* The queue mask tells which signal the scan would stop at
+		   without walking the list, go straight to the head of its
+		   priority group. */
+		andset(&wanted, &queue->mask, set);
+		if (isemptyset(&wanted))
+			goto not_found;
+
+		next = findpqhr(&queue->list, sigprio(firstsig(&wanted)));
+		if (!next)
+			next = getheadpq(&queue->list);
+	}
 
 	while ((holder = next)) {
 		next = nextpq(&queue->list, holder);
@@ -378,6 +440,7 @@ static pse51_siginfo_t *pse51_getsigq(pse51_sigqueue_t * queue,
 			goto found;
 	}
 
+      not_found:
 	if (start)
 		*start = NULL;
 
@@ -568,7 +631,7 @@ int pthread_kill(pthread_t thread, int sig)
 		goto unlock_and_exit;
 	}
 
-	si = pse51_new_siginfo(sig, SI_USER, (union sigval)0);
+	si = pse51_new_siginfo(thread, sig, SI_USER, (union sigval)0);
 	if (si == NULL) {
 		ret = EAGAIN;
 		goto unlock_and_exit;
@@ -632,7 +695,7 @@ int pthread_sigqueue_np(pthread_t thread, int sig, union sigval value)
 	}
 
 	if (sig) {
-		si = pse51_new_siginfo(sig, SI_QUEUE, value);
+		si = pse51_new_siginfo(thread, sig, SI_QUEUE, value);
 		if (!si) {
 			err = EAGAIN;
 			goto unlock_and_exit;
@@ -794,11 +857,9 @@ int pthread_sigmask(int how, const sigset_t * set, sigset_t * oset)
 			pse51_getsigq(&cur->blocked_received, &unblocked,
 				      &next))) {
 			int sig = si->info.si_signo;
-			unsigned prio;
 
-			prio = sig < SIGRTMIN ? sig + SIGRTMAX : sig;
-			addset(&cur->pending.mask, si->info.si_signo);
-			insertpqfr(&cur->pending.list, &si->link, prio);
+			addset(&cur->pending.mask, sig);
+			insertpqfr(&cur->pending.list, &si->link, sigprio(sig));
 			cur->threadbase.signals = 1;
 
 			if (!next)
@@ -844,20 +905,29 @@ static int pse51_sigtimedwait_inner(const sigset_t * set,
 	if (!received) {
 		thread_cancellation_point(&thread->threadbase);
 
+		thread->sigwait_set = pse51_set;
+		thread->sigwait_si = NULL;
+
 		xnpod_suspend_thread(&thread->threadbase, XNDELAY,
 				     timed ? to : XN_INFINITE,
 				     XN_RELATIVE, NULL);
 
+		/* A signal handed over by pse51_sigqueue_inner() is released
+		   by pse51_signal_cleanup_thread() if we get cancelled. */
 		thread_cancellation_point(&thread->threadbase);
 
-		if (xnthread_test_info(&thread->threadbase, XNBREAK)) {
-			if (!
-			    (received =
-			     pse51_getsigq(&thread->blocked_received, pse51_set,
-					   NULL)))
+		received = thread->sigwait_si;
+		thread->sigwait_set = NULL;
+		thread->sigwait_si = NULL;
+
+		if (!received) {
+			if (xnthread_test_info(&thread->threadbase, XNTIMEO))
+				err = EAGAIN;
+			else if (!(received =
+				   pse51_getsigq(&thread->blocked_received,
+						 pse51_set, NULL)))
 				err = EINTR;
-		} else if (xnthread_test_info(&thread->threadbase, XNTIMEO))
-			err = EAGAIN;
+		}
 	}
 
 	if (!err) {
@@ -1128,6 +1198,14 @@ void pse51_signal_init_thread(pthread_t newthread, const pthread_t parent)
 	initpq(&newthread->blocked_received.list);
 	emptyset(&newthread->pending.mask);
 	initpq(&newthread->pending.list);
+	newthread->sigwait_set = NULL;
+	newthread->sigwait_si = NULL;
+
+	/* The private pool was allocated along with the TCB, see
+	   pthread_create(). */
+	pse51_fill_sigpool(&newthread->sigpool,
+			   (pse51_siginfo_t *)(newthread + 1),
+			   newthread->attr.sigqueue);
 
 	/* parent may be NULL if pthread_create is not called from a pse51 thread. */
 	if (parent)
@@ -1151,6 +1229,18 @@ void pse51_signal_cleanup_thread(pthread_t thread)
 	pse51_sigqueue_t *queue = &thread->pending;
 	pse51_siginfo_t *si;
 
+	/* Blocks from the private pool must not outlive the TCB. */
+	si = thread->sigwait_si;
+	if (si) {
+		thread->sigwait_si = NULL;
+		if (si->info.si_code == SI_TIMER)
+			pse51_timer_notified(si);
+
+		if (si->info.si_code == SI_QUEUE
+		    || si->info.si_code == SI_USER)
+			pse51_delete_siginfo(si);
+	}
+
 	while (queue) {
 		while ((si = pse51_getsigq(queue, &queue->mask, NULL))) {
 			if (si->info.si_code == SI_TIMER)
@@ -1174,9 +1264,8 @@ void pse51_signal_pkg_init(void)
 	int i;
 
 	/* Fill the pool. */
-	initpq(&pse51_infos_free_list);
-	for (i = 0; i < PSE51_SIGQUEUE_MAX; i++)
-		pse51_delete_siginfo(&pse51_infos_pool[i]);
+	pse51_fill_sigpool(&pse51_infos_free_list,
+			   pse51_infos_pool, PSE51_SIGQUEUE_MAX);
 
 	for (i = 1; i <= SIGRTMAX; i++) {
 		actions[i - 1].sa_handler = SIG_DFL;
@@ -36,10 +36,15 @@
 #include <posix/sem.h>
 #include <posix/shm.h>
 #include <posix/timer.h>
+#include <posix/barrier.h>
 #if defined(CONFIG_XENO_SKIN_RTDM) || defined (CONFIG_XENO_SKIN_RTDM_MODULE)
 #include <rtdm/rtdm_driver.h>
 #define RTDM_FD_MAX CONFIG_XENO_OPT_RTDM_FILDES
 #endif /* RTDM */
+#ifdef CONFIG_XENO_OPT_POSIX_SELECT
+#include <linux/poll.h>
+#include <linux/eventpoll.h>
+#endif /* CONFIG_XENO_OPT_POSIX_SELECT */
 
 int pse51_muxid;
 
@@ -939,6 +944,45 @@ static int __pthread_mutexattr_setprotocol(struct pt_regs *regs)
 	return __xn_safe_copy_to_user((void __user *)uattrp, &attr, sizeof(*uattrp));
 }
 
+static int __pthread_mutexattr_getprioceiling(struct pt_regs *regs)
+{
+	pthread_mutexattr_t attr, *uattrp;
+	int err, prioceiling, *uprioceilingp;
+
+	uattrp = (pthread_mutexattr_t *) __xn_reg_arg1(regs);
+
+	uprioceilingp = (int *)__xn_reg_arg2(regs);
+
+	if (__xn_safe_copy_from_user(&attr, (void __user *)uattrp, sizeof(attr)))
+		return -EFAULT;
+
+	err = pthread_mutexattr_getprioceiling(&attr, &prioceiling);
+	if (err)
+		return -err;
+
+	return __xn_safe_copy_to_user((void __user *)uprioceilingp,
+				      &prioceiling, sizeof(*uprioceilingp));
+}
+
+static int __pthread_mutexattr_setprioceiling(struct pt_regs *regs)
+{
+	pthread_mutexattr_t attr, *uattrp;
+	int err, prioceiling;
+
+	uattrp = (pthread_mutexattr_t *) __xn_reg_arg1(regs);
+
+	prioceiling = (int)__xn_reg_arg2(regs);
+
+	if (__xn_safe_copy_from_user(&attr, (void __user *)uattrp, sizeof(attr)))
+		return -EFAULT;
+
+	err = pthread_mutexattr_setprioceiling(&attr, prioceiling);
+	if (err)
+		return -err;
+
+	return __xn_safe_copy_to_user((void __user *)uattrp, &attr, sizeof(*uattrp));
+}
+
 static int __pthread_mutexattr_getpshared(struct pt_regs *regs)
 {
 	pthread_mutexattr_t attr, *uattrp;
@@ -978,6 +1022,84 @@ static int __pthread_mutexattr_setpshared(struct pt_regs *regs)
 	return __xn_safe_copy_to_user((void __user *)uattrp, &attr, sizeof(*uattrp));
 }
 
+static int __pthread_mutexattr_getspin_np(struct pt_regs *regs)
+{
+	pthread_mutexattr_t attr, *uattrp;
+	int err, spin, *uspinp;
+
+	uattrp = (pthread_mutexattr_t *) __xn_reg_arg1(regs);
+
+	uspinp = (int *)__xn_reg_arg2(regs);
+
+	if (__xn_safe_copy_from_user(&attr, (void __user *)uattrp, sizeof(attr)))
+		return -EFAULT;
+
+	err = pthread_mutexattr_getspin_np(&attr, &spin);
+	if (err)
+		return -err;
+
+	return __xn_safe_copy_to_user((void __user *)uspinp,
+				      &spin, sizeof(*uspinp));
+}
+
+static int __pthread_mutexattr_setspin_np(struct pt_regs *regs)
+{
+	pthread_mutexattr_t attr, *uattrp;
+	int err, spin;
+
+	uattrp = (pthread_mutexattr_t *) __xn_reg_arg1(regs);
+
+	spin = (int)__xn_reg_arg2(regs);
+
+	if (__xn_safe_copy_from_user(&attr, (void __user *)uattrp, sizeof(attr)))
+		return -EFAULT;
+
+	err = pthread_mutexattr_setspin_np(&attr, spin);
+	if (err)
+		return -err;
+
+	return __xn_safe_copy_to_user((void __user *)uattrp, &attr, sizeof(*uattrp));
+}
+
+static int __pthread_mutexattr_getpadded_np(struct pt_regs *regs)
+{
+	pthread_mutexattr_t attr, *uattrp;
+	int err, padded, *upaddedp;
+
+	uattrp = (pthread_mutexattr_t *) __xn_reg_arg1(regs);
+
+	upaddedp = (int *)__xn_reg_arg2(regs);
+
+	if (__xn_safe_copy_from_user(&attr, (void __user *)uattrp, sizeof(attr)))
+		return -EFAULT;
+
+	err = pthread_mutexattr_getpadded_np(&attr, &padded);
+	if (err)
+		return -err;
+
+	return __xn_safe_copy_to_user((void __user *)upaddedp,
+				      &padded, sizeof(*upaddedp));
+}
+
+static int __pthread_mutexattr_setpadded_np(struct pt_regs *regs)
+{
+	pthread_mutexattr_t attr, *uattrp;
+	int err, padded;
+
+	uattrp = (pthread_mutexattr_t *) __xn_reg_arg1(regs);
+
+	padded = (int)__xn_reg_arg2(regs);
+
+	if (__xn_safe_copy_from_user(&attr, (void __user *)uattrp, sizeof(attr)))
+		return -EFAULT;
+
+	err = pthread_mutexattr_setpadded_np(&attr, padded);
+	if (err)
+		return -err;
+
+	return __xn_safe_copy_to_user((void __user *)uattrp, &attr, sizeof(*uattrp));
+}
+
 #ifndef CONFIG_XENO_FASTSYNCH
 static int __pthread_mutex_init(struct pt_regs *regs)
 {
@@ -1170,8 +1292,9 @@ static int __pthread_mutex_unlock(struct pt_regs *regs)
 		return 0;
 	}
 
-	if (xnsynch_release(&mutex->synchbase))
-		xnpod_schedule();
+	/* Dropping a priority ceiling may require rescheduling too. */
+	xnsynch_release(&mutex->synchbase);
+	xnpod_schedule();
 
   out:
 	cb_read_unlock(&shadow->lock, s);
@@ -1231,21 +1354,21 @@ static int __pthread_mutex_init(struct pt_regs *regs)
 	} else
 		attr = &pse51_default_mutex_attr;
 
-	mutex = (pse51_mutex_t *) xnmalloc(sizeof(*mutex));
+	mutex = (pse51_mutex_t *) xnobjpool_alloc(&pse51_mutex_pool);
 	if (!mutex)
 		return -ENOMEM;
 
 	ownerp = (xnarch_atomic_t *)
 		xnheap_alloc(&xnsys_ppd_get(attr->pshared)->sem_heap,
-			     sizeof(xnarch_atomic_t));
+			     pse51_mutex_lock_size(attr));
 	if (!ownerp) {
-		xnfree(mutex);
+		xnobjpool_free(&pse51_mutex_pool, mutex);
 		return -EAGAIN;
 	}
 
 	err = pse51_mutex_init_internal(&mx.shadow_mutex, mutex, ownerp, attr);
 	if (err) {
-		xnfree(mutex);
+		xnobjpool_free(&pse51_mutex_pool, mutex);
 		xnheap_free(&xnsys_ppd_get(attr->pshared)->sem_heap, ownerp);
 		return err;
 	}
@@ -1362,8 +1485,9 @@ static int __pthread_mutex_unlock(struct pt_regs *regs)
 				     offsetof(struct __shadow_mutex, lock)))
 		return -EFAULT;
 
-	if (xnsynch_release(&mx.shadow_mutex.mutex->synchbase))
-		xnpod_schedule();
+	/* Dropping a priority ceiling may require rescheduling too. */
+	xnsynch_release(&mx.shadow_mutex.mutex->synchbase);
+	xnpod_schedule();
 
 	return 0;
 }
@@ -1687,6 +1811,146 @@ static int __pthread_cond_broadcast(struct pt_regs *regs)
 	return -pthread_cond_broadcast(&cnd.native_cond);
 }
 
+/* pthread_barrier_init(barrier, count, pshared) */
+static int __pthread_barrier_init(struct pt_regs *regs)
+{
+	union __xeno_barrier bar, *ubar;
+	pthread_barrierattr_t attr;
+	int err;
+
+	ubar = (union __xeno_barrier *)__xn_reg_arg1(regs);
+
+	if (__xn_safe_copy_from_user(&bar.shadow_barrier,
+				     (void __user *)&ubar->shadow_barrier,
+				     sizeof(bar.shadow_barrier)))
+		return -EFAULT;
+
+	pthread_barrierattr_init(&attr);
+	err = pthread_barrierattr_setpshared(&attr, __xn_reg_arg3(regs));
+	if (err)
+		return -err;
+
+	err = pthread_barrier_init(&bar.native_barrier, &attr,
+				   __xn_reg_arg2(regs));
+	if (err)
+		return -err;
+
+	return __xn_safe_copy_to_user((void __user *)&ubar->shadow_barrier,
+				      &bar.shadow_barrier,
+				      sizeof(ubar->shadow_barrier));
+}
+
+static int __pthread_barrier_destroy(struct pt_regs *regs)
+{
+	union __xeno_barrier bar, *ubar;
+	int err;
+
+	ubar = (union __xeno_barrier *)__xn_reg_arg1(regs);
+
+	if (__xn_safe_copy_from_user(&bar.shadow_barrier,
+				     (void __user *)&ubar->shadow_barrier,
+				     sizeof(bar.shadow_barrier)))
+		return -EFAULT;
+
+	err = pthread_barrier_destroy(&bar.native_barrier);
+	if (err)
+		return -err;
+
+	return __xn_safe_copy_to_user((void __user *)&ubar->shadow_barrier,
+				      &bar.shadow_barrier,
+				      sizeof(ubar->shadow_barrier));
+}
+
+/* pthread_barrier_arrive(barrier, &cycle), returns 1 for the thread
+   completing the cycle, 0 and the cycle to sleep on for the others. */
+static int __pthread_barrier_arrive(struct pt_regs *regs)
+{
+	union __xeno_barrier bar, *ubar;
+	unsigned long cycle;
+	int err;
+
+	ubar = (union __xeno_barrier *)__xn_reg_arg1(regs);
+
+	if (__xn_safe_copy_from_user(&bar.shadow_barrier,
+				     (void __user *)&ubar->shadow_barrier,
+				     sizeof(bar.shadow_barrier)))
+		return -EFAULT;
+
+	err = pse51_barrier_arrive(&bar.shadow_barrier, &cycle);
+	if (err == PTHREAD_BARRIER_SERIAL_THREAD)
+		return 1;
+	if (err)
+		return -err;
+
+	return __xn_safe_copy_to_user((void __user *)__xn_reg_arg2(regs),
+				      &cycle, sizeof(cycle));
+}
+
+/* pthread_barrier_sleep(barrier, cycle) */
+static int __pthread_barrier_sleep(struct pt_regs *regs)
+{
+	xnthread_t *cur = xnshadow_thread(current);
+	union __xeno_barrier bar, *ubar;
+
+	ubar = (union __xeno_barrier *)__xn_reg_arg1(regs);
+
+	if (__xn_safe_copy_from_user(&bar.shadow_barrier,
+				     (void __user *)&ubar->shadow_barrier,
+				     sizeof(bar.shadow_barrier)))
+		return -EFAULT;
+
+	return -pse51_barrier_sleep(cur, &bar.shadow_barrier,
+				    __xn_reg_arg2(regs));
+}
+
+static int __pthread_barrier_release(struct pt_regs *regs)
+{
+	union __xeno_barrier bar, *ubar;
+
+	ubar = (union __xeno_barrier *)__xn_reg_arg1(regs);
+
+	if (__xn_safe_copy_from_user(&bar.shadow_barrier,
+				     (void __user *)&ubar->shadow_barrier,
+				     sizeof(bar.shadow_barrier)))
+		return -EFAULT;
+
+	return -pse51_barrier_release(&bar.shadow_barrier);
+}
+
+/* pthread_spin_init(lock, pshared) */
+static int __pthread_spin_init(struct pt_regs *regs)
+{
+	unsigned cookie;
+	int err;
+
+	err = pse51_spin_init(__xn_reg_arg2(regs), &cookie);
+	if (err)
+		return -err;
+
+	return __xn_safe_copy_to_user((void __user *)__xn_reg_arg1(regs),
+				      &cookie, sizeof(cookie));
+}
+
+static int __pthread_spin_destroy(struct pt_regs *regs)
+{
+	unsigned cookie;
+	int err;
+
+	if (__xn_safe_copy_from_user(&cookie,
+				     (void __user *)__xn_reg_arg1(regs),
+				     sizeof(cookie)))
+		return -EFAULT;
+
+	err = pse51_spin_destroy(cookie);
+	if (err)
+		return -err;
+
+	cookie = PSE51_SPIN_INVALID;
+
+	return __xn_safe_copy_to_user((void __user *)__xn_reg_arg1(regs),
+				      &cookie, sizeof(cookie));
+}
+
 /* mq_open(name, oflags, mode, attr, ufd) */
 static int __mq_open(struct pt_regs *regs)
 {
@@ -2100,6 +2364,161 @@ static int __mq_notify(struct pt_regs *regs)
 	return 0;
 }
 
+/* mq_alloc_np(qd, &offset) */
+static int __mq_alloc_np(struct pt_regs *regs)
+{
+	pse51_assoc_t *assoc;
+	unsigned long offset;
+	pse51_queues_t *q;
+	pse51_msg_t *msg;
+	pse51_ufd_t *ufd;
+	pse51_mq_t *mq;
+	void *buf;
+	int err;
+
+	q = pse51_queues();
+	if (!q)
+		return -EPERM;
+
+	assoc = pse51_assoc_lookup(&q->uqds, (u_long)__xn_reg_arg1(regs));
+	if (!assoc)
+		return -EBADF;
+
+	ufd = assoc2ufd(assoc);
+
+	if (!access_wok(__xn_reg_arg2(regs), sizeof(offset)))
+		return -EFAULT;
+
+	msg = pse51_mq_timedsend_inner(&mq, ufd->kfd, PSE51_MQ_ZEROCOPY, NULL);
+	if (IS_ERR(msg))
+		return PTR_ERR(msg);
+
+	buf = msg->data;
+	offset = xnheap_mapped_offset(&xnsys_ppd_get(1)->sem_heap, buf);
+
+	err = pse51_mq_finish_lend(ufd->kfd, mq, msg);
+	if (err)
+		return err;
+
+	/* The caller would never learn about the buffer, take it back. */
+	if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg2(regs),
+				   &offset, sizeof(offset))) {
+		pse51_mq_put_lent(ufd->kfd, buf);
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+/* mq_send_np(qd, offset, len, prio) */
+static int __mq_send_np(struct pt_regs *regs)
+{
+	pse51_assoc_t *assoc;
+	pse51_queues_t *q;
+	pse51_ufd_t *ufd;
+	void *buf;
+
+	q = pse51_queues();
+	if (!q)
+		return -EPERM;
+
+	assoc = pse51_assoc_lookup(&q->uqds, (u_long)__xn_reg_arg1(regs));
+	if (!assoc)
+		return -EBADF;
+
+	ufd = assoc2ufd(assoc);
+
+	buf = xnheap_mapped_address(&xnsys_ppd_get(1)->sem_heap,
+				    __xn_reg_arg2(regs));
+	if (!buf)
+		return -EINVAL;
+
+	return pse51_mq_post_lent(ufd->kfd, buf, (size_t)__xn_reg_arg3(regs),
+				  __xn_reg_arg4(regs));
+}
+
+/* len = mq_receive_np(qd, &offset, &prio) */
+static int __mq_receive_np(struct pt_regs *regs)
+{
+	pse51_assoc_t *assoc;
+	unsigned long offset;
+	pse51_queues_t *q;
+	pse51_ufd_t *ufd;
+	pse51_msg_t *msg;
+	pse51_mq_t *mq;
+	unsigned prio;
+	int len, err;
+	void *buf;
+
+	q = pse51_queues();
+	if (!q)
+		return -EPERM;
+
+	assoc = pse51_assoc_lookup(&q->uqds, (u_long)__xn_reg_arg1(regs));
+	if (!assoc)
+		return -EBADF;
+
+	ufd = assoc2ufd(assoc);
+
+	if (!access_wok(__xn_reg_arg2(regs), sizeof(offset)))
+		return -EFAULT;
+
+	if (__xn_reg_arg3(regs)
+	    && !access_wok(__xn_reg_arg3(regs), sizeof(prio)))
+		return -EFAULT;
+
+	msg = pse51_mq_timedrcv_inner(&mq, ufd->kfd, PSE51_MQ_ZEROCOPY, NULL);
+	if (IS_ERR(msg))
+		return PTR_ERR(msg);
+
+	len = msg->len;
+	prio = pse51_msg_get_prio(msg);
+	buf = msg->data;
+	offset = xnheap_mapped_offset(&xnsys_ppd_get(1)->sem_heap, buf);
+
+	err = pse51_mq_finish_lend(ufd->kfd, mq, msg);
+	if (err)
+		return err;
+
+	/* The caller would never learn about the buffer, take it back. */
+	if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg2(regs),
+				   &offset, sizeof(offset)) ||
+	    (__xn_reg_arg3(regs) &&
+	     __xn_safe_copy_to_user((void __user *)__xn_reg_arg3(regs),
+				    &prio, sizeof(prio)))) {
+		pse51_mq_put_lent(ufd->kfd, buf);
+		return -EFAULT;
+	}
+
+	return len;
+}
+
+/* mq_release_np(qd, offset) */
+static int __mq_release_np(struct pt_regs *regs)
+{
+	pse51_assoc_t *assoc;
+	pse51_queues_t *q;
+	pse51_ufd_t *ufd;
+	void *buf;
+
+	q = pse51_queues();
+	if (!q)
+		return -EPERM;
+
+	assoc = pse51_assoc_lookup(&q->uqds, (u_long)__xn_reg_arg1(regs));
+	if (!assoc)
+		return -EBADF;
+
+	ufd = assoc2ufd(assoc);
+
+	buf = xnheap_mapped_address(&xnsys_ppd_get(1)->sem_heap,
+				    __xn_reg_arg2(regs));
+	if (!buf)
+		return -EINVAL;
+
+	return pse51_mq_put_lent(ufd->kfd, buf);
+}
+
 #ifdef CONFIG_XENO_OPT_POSIX_INTR
 
 static int __pse51_intr_handler(xnintr_t *cookie)
@@ -2317,6 +2736,119 @@ static int __timer_getoverrun(struct pt_regs *regs)
 	return rc >= 0 ? rc : -thread_get_errno();
 }
 
+/* timer_evq_create_np(ufd, nevents, &offset) */
+static int __timer_evq_create_np(struct pt_regs *regs)
+{
+	struct pse51_timer_evq *evq;
+	unsigned long offset;
+	pse51_ufd_t *assoc;
+	pse51_queues_t *q;
+	int err;
+
+	q = pse51_queues();
+	if (!q)
+		return -EPERM;
+
+	err = pse51_timer_evq_create(__xn_reg_arg2(regs), &evq, &offset);
+	if (err)
+		return -err;
+
+	assoc = (pse51_ufd_t *) xnmalloc(sizeof(*assoc));
+	if (!assoc) {
+		err = -ENOSPC;
+		goto fail;
+	}
+
+	assoc->kfd = (unsigned long)evq;
+
+	err = pse51_assoc_insert(&q->uevqs, &assoc->assoc,
+				 (u_long)__xn_reg_arg1(regs));
+	if (err) {
+		xnfree(assoc);
+		goto fail;
+	}
+
+	if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg3(regs),
+				   &offset, sizeof(offset))) {
+		pse51_assoc_remove(&q->uevqs, (u_long)__xn_reg_arg1(regs));
+		xnfree(assoc);
+		err = -EFAULT;
+		goto fail;
+	}
+
+	return 0;
+
+  fail:
+	pse51_timer_evq_destroy(evq);
+	return err;
+}
+
+static struct pse51_timer_evq *__timer_evq_get(pse51_queues_t *q, u_long ufd)
+{
+	pse51_assoc_t *assoc;
+
+	assoc = pse51_assoc_lookup(&q->uevqs, ufd);
+	if (!assoc)
+		return NULL;
+
+	return (struct pse51_timer_evq *)assoc2ufd(assoc)->kfd;
+}
+
+/* timer_evq_wait_np(ufd, &event, abstime) */
+static int __timer_evq_wait_np(struct pt_regs *regs)
+{
+	struct timespec abstime, *abstimep = NULL;
+	struct pse51_timer_evq *evq;
+	struct timer_event_np ev;
+	pse51_queues_t *q;
+	int err;
+
+	q = pse51_queues();
+	if (!q)
+		return -EPERM;
+
+	evq = __timer_evq_get(q, (u_long)__xn_reg_arg1(regs));
+	if (!evq)
+		return -EBADF;
+
+	if (__xn_reg_arg3(regs)) {
+		if (__xn_safe_copy_from_user(&abstime,
+					     (void __user *)__xn_reg_arg3(regs),
+					     sizeof(abstime)))
+			return -EFAULT;
+		abstimep = &abstime;
+	}
+
+	err = pse51_timer_evq_wait(evq, abstimep, &ev);
+	if (err)
+		return -err;
+
+	return __xn_safe_copy_to_user((void __user *)__xn_reg_arg2(regs),
+				      &ev, sizeof(ev));
+}
+
+/* timer_evq_destroy_np(ufd) */
+static int __timer_evq_destroy_np(struct pt_regs *regs)
+{
+	pse51_assoc_t *assoc;
+	pse51_queues_t *q;
+	int err;
+
+	q = pse51_queues();
+	if (!q)
+		return -EPERM;
+
+	assoc = pse51_assoc_remove(&q->uevqs, (u_long)__xn_reg_arg1(regs));
+	if (!assoc)
+		return -EBADF;
+
+	err = pse51_timer_evq_destroy((struct pse51_timer_evq *)
+				      assoc2ufd(assoc)->kfd);
+	xnfree(assoc2ufd(assoc));
+
+	return -err;
+}
+
 #ifdef CONFIG_XENO_OPT_POSIX_SELECT
 static int fd_valid_p(int fd)
 {
@@ -2339,7 +2871,8 @@ static int fd_valid_p(int fd)
 	if (!q)
 		return 0;
 
-	return pse51_assoc_lookup(&q->uqds, fd) != NULL;
+	return pse51_assoc_lookup(&q->uqds, fd) != NULL
+		|| pse51_assoc_lookup(&q->uevqs, fd) != NULL;
 }
 
 static int first_fd_valid_p(fd_set *fds[XNSELECT_MAX_TYPES], int nfds)
@@ -2373,8 +2906,15 @@ static int select_bind_one(struct xnselector *selector, unsigned type, int fd)
 		return -EPERM;
 
 	assoc = pse51_assoc_lookup(&q->uqds, fd);
-	if (!assoc)
-		return -EBADF;
+	if (!assoc) {
+		assoc = pse51_assoc_lookup(&q->uevqs, fd);
+		if (!assoc)
+			return -EBADF;
+
+		return pse51_timer_evq_select_bind((struct pse51_timer_evq *)
+						   assoc2ufd(assoc)->kfd,
+						   selector, type, fd);
+	}
 
 	return pse51_mq_select_bind(assoc2ufd(assoc)->kfd, selector, type, fd);
 }
@@ -2503,8 +3043,183 @@ static int __select(struct pt_regs *regs)
 				return -EFAULT;
 	return err;
 }
+
+/* Events returned per epoll_wait_np() call at most. */
+#define PSE51_EPOLL_BATCH 32
+
+static const unsigned epoll_type_events[XNSELECT_MAX_TYPES] = {
+	[XNSELECT_READ] = POLLIN,
+	[XNSELECT_WRITE] = POLLOUT,
+	[XNSELECT_EXCEPT] = POLLPRI,
+};
+
+static unsigned epoll_bound_types(struct xnselector *selector, int fd)
+{
+	unsigned type, types = 0;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	for (type = 0; type < XNSELECT_MAX_TYPES; type++)
+		if (__FD_ISSET__(fd, &selector->fds[type].expected))
+			types |= 1 << type;
+	xnlock_put_irqrestore(&nklock, s);
+
+	return types;
+}
+
+static void epoll_unbind_types(struct xnselector *selector,
+			       int fd, unsigned types)
+{
+	unsigned type;
+
+	for (type = 0; type < XNSELECT_MAX_TYPES; type++)
+		if (types & (1 << type))
+			xnselect_unbind(selector, type, fd);
+}
+
+/* int epoll_ctl_np(int op, int fd, struct epoll_event *event) */
+static int __epoll_ctl_np(struct pt_regs *regs)
+{
+	int op = __xn_reg_arg1(regs), fd = __xn_reg_arg2(regs);
+	struct xnselector *selector;
+	unsigned type, bound, wanted = 0;
+	struct epoll_event ev;
+	xnthread_t *thread;
+	int err;
+
+	thread = xnpod_current_thread();
+	if (!thread)
+		return -EPERM;
+
+	if ((unsigned)fd >= __FD_SETSIZE)
+		return -EBADF;
+
+	if (op != EPOLL_CTL_DEL) {
+		if (__xn_safe_copy_from_user(&ev,
+					     (void __user *)__xn_reg_arg3(regs),
+					     sizeof(ev)))
+			return -EFAULT;
+
+		for (type = 0; type < XNSELECT_MAX_TYPES; type++)
+			if (ev.events & epoll_type_events[type])
+				wanted |= 1 << type;
+		if (!wanted)
+			return -EINVAL;
+	}
+
+	selector = thread->eselector;
+	if (!selector) {
+		if (op != EPOLL_CTL_ADD)
+			return -ENOENT;
+		selector = xnmalloc(sizeof(*selector));
+		if (!selector)
+			return -ENOMEM;
+		xnselector_init(selector);
+		thread->eselector = selector;
+	}
+
+	bound = epoll_bound_types(selector, fd);
+
+	switch (op) {
+	case EPOLL_CTL_ADD:
+		if (bound)
+			return -EEXIST;
+		break;
+	case EPOLL_CTL_MOD:
+	case EPOLL_CTL_DEL:
+		if (!bound)
+			return -ENOENT;
+		/* Rebind from scratch, the cookie may change. */
+		epoll_unbind_types(selector, fd, bound);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (op == EPOLL_CTL_DEL)
+		return 0;
+
+	xnselector_set_cookie(selector, ev.data);
+	for (type = 0; type < XNSELECT_MAX_TYPES; type++)
+		if (wanted & (1 << type)) {
+			err = select_bind_one(selector, type, fd);
+			if (err) {
+				epoll_unbind_types(selector, fd,
+						   wanted & ((1 << type) - 1));
+				return err;
+			}
+		}
+
+	return 0;
+}
+
+/*
+ * int epoll_wait_np(struct epoll_event *events, int maxevents,
+ *		     const struct timespec *timeout)
+ */
+static int __epoll_wait_np(struct pt_regs *regs)
+{
+	struct epoll_event __user *u_events;
+	struct xnselect_event events[PSE51_EPOLL_BATCH];
+	xnticks_t timeout = XN_INFINITE;
+	xntmode_t mode = XN_RELATIVE;
+	struct xnselector *selector;
+	int maxevents, count, i;
+	struct epoll_event ev;
+	struct timespec ts;
+	unsigned type;
+
+	selector = xnpod_current_thread()->eselector;
+	if (!selector)
+		return -EINVAL;
+
+	u_events = (struct epoll_event __user *)__xn_reg_arg1(regs);
+	maxevents = __xn_reg_arg2(regs);
+	if (maxevents <= 0)
+		return -EINVAL;
+	if (maxevents > PSE51_EPOLL_BATCH)
+		maxevents = PSE51_EPOLL_BATCH;
+
+	if (!access_wok(u_events, maxevents * sizeof(ev)))
+		return -EFAULT;
+
+	if (__xn_reg_arg3(regs)) {
+		if (__xn_safe_copy_from_user(&ts,
+					     (void __user *)__xn_reg_arg3(regs),
+					     sizeof(ts)))
+			return -EFAULT;
+
+		if ((unsigned long)ts.tv_nsec >= ONE_BILLION)
+			return -EINVAL;
+
+		if (ts.tv_sec == 0 && ts.tv_nsec == 0)
+			timeout = XN_NONBLOCK;
+		else {
+			timeout = clock_get_ticks(CLOCK_MONOTONIC)
+				+ ts2ticks_ceil(&ts);
+			mode = XN_ABSOLUTE;
+		}
+	}
+
+	count = xnselect_wait_ready(selector, events, maxevents,
+				    timeout, mode);
+
+	for (i = 0; i < count; i++) {
+		ev.events = 0;
+		for (type = 0; type < XNSELECT_MAX_TYPES; type++)
+			if (events[i].types & (1 << type))
+				ev.events |= epoll_type_events[type];
+		ev.data = events[i].cookie;
+		if (__xn_copy_to_user(&u_events[i], &ev, sizeof(ev)))
+			return -EFAULT;
+	}
+
+	return count;
+}
 #else /* !CONFIG_XENO_OPT_POSIX_SELECT */
 #define __select __pse51_call_not_available
+#define __epoll_ctl_np __pse51_call_not_available
+#define __epoll_wait_np __pse51_call_not_available
 #endif /* !CONFIG_XENO_OPT_POSIX_SELECT */
 
 #ifdef CONFIG_XENO_OPT_POSIX_SHM
@@ -2810,6 +3525,57 @@ static int __munmap_epilogue(struct pt_regs *regs)
 
 	return !err ? 0 : -thread_get_errno();
 }
+/* shm_physaddr_np(uaddr, len, &phys) */
+static int __shm_physaddr_np(struct pt_regs *regs)
+{
+	unsigned long uaddr, start = 0;
+	unsigned long long phys;
+	pse51_umap_t *umap = NULL;
+	xnholder_t *holder;
+	pse51_queues_t *q;
+	void *kaddr;
+	size_t len;
+	spl_t s;
+
+	q = pse51_queues();
+	if (!q)
+		return -EPERM;
+
+	uaddr = (unsigned long)__xn_reg_arg1(regs);
+	len = (size_t) __xn_reg_arg2(regs);
+
+	/* Find the user mapping covering the address. */
+	xnlock_get_irqsave(&pse51_assoc_lock, s);
+	for (holder = getheadq(&q->umaps.queue);
+	     holder; holder = nextq(&q->umaps.queue, holder)) {
+		start = pse51_assoc_key(link2assoc(holder));
+		if (start > uaddr)
+			break;
+		if (uaddr - start < assoc2umap(link2assoc(holder))->len) {
+			umap = assoc2umap(link2assoc(holder));
+			break;
+		}
+	}
+
+	if (!umap) {
+		xnlock_put_irqrestore(&pse51_assoc_lock, s);
+		return -ENXIO;
+	}
+
+	if (len > umap->len - (uaddr - start)) {
+		xnlock_put_irqrestore(&pse51_assoc_lock, s);
+		return -EINVAL;
+	}
+
+	kaddr = (char *)umap->kaddr + (uaddr - start);
+	xnlock_put_irqrestore(&pse51_assoc_lock, s);
+
+	if (shm_physaddr_np(kaddr, len, &phys))
+		return -thread_get_errno();
+
+	return __xn_safe_copy_to_user((void __user *)__xn_reg_arg3(regs),
+				      &phys, sizeof(phys));
+}
 #else /* !CONFIG_XENO_OPT_POSIX_SHM */
 
 #define __shm_open        __pse51_call_not_available
@@ -2820,10 +3586,12 @@ static int __munmap_epilogue(struct pt_regs *regs)
 #define __mmap_epilogue   __pse51_call_not_available
 #define __munmap_prologue __pse51_call_not_available
 #define __munmap_epilogue __pse51_call_not_available
+#define __shm_physaddr_np __pse51_call_not_available
 
 #endif /* !CONFIG_XENO_OPT_POSIX_SHM */
 
-#ifdef CONFIG_XENO_OPT_SCHED_TP
+#if defined(CONFIG_XENO_OPT_SCHED_TP) || defined(CONFIG_XENO_OPT_CACHE_PARTITION) || \
+    defined(CONFIG_XENO_OPT_SCHED_BUDGET)
 /*
  * int __sched_setconfig_np(int cpu, int policy, union sched_config *p, size_t len)
  */
@@ -2858,11 +3626,13 @@ out:
 	return ret;
 }
 
-#else /* !CONFIG_XENO_OPT_SCHED_TP */
+#else /* !(CONFIG_XENO_OPT_SCHED_TP || CONFIG_XENO_OPT_CACHE_PARTITION || \
+	  CONFIG_XENO_OPT_SCHED_BUDGET) */
 
 #define __sched_setconfig_np        __pse51_call_not_available
 
-#endif /* !CONFIG_XENO_OPT_SCHED_TP */
+#endif /* !(CONFIG_XENO_OPT_SCHED_TP || CONFIG_XENO_OPT_CACHE_PARTITION || \
+	  CONFIG_XENO_OPT_SCHED_BUDGET) */
 
 int __pse51_call_not_available(struct pt_regs *regs)
 {
@@ -2921,6 +3691,16 @@ static xnsysent_t __systab[] = {
 	    {&__pthread_cond_wait_epilogue, __xn_exec_primary},
 	[__pse51_cond_signal] = {&__pthread_cond_signal, __xn_exec_any},
 	[__pse51_cond_broadcast] = {&__pthread_cond_broadcast, __xn_exec_any},
+	[__pse51_barrier_init] = {&__pthread_barrier_init, __xn_exec_any},
+	[__pse51_barrier_destroy] =
+	    {&__pthread_barrier_destroy, __xn_exec_any},
+	[__pse51_barrier_arrive] = {&__pthread_barrier_arrive, __xn_exec_any},
+	[__pse51_barrier_sleep] =
+	    {&__pthread_barrier_sleep, __xn_exec_primary},
+	[__pse51_barrier_release] =
+	    {&__pthread_barrier_release, __xn_exec_any},
+	[__pse51_spin_init] = {&__pthread_spin_init, __xn_exec_any},
+	[__pse51_spin_destroy] = {&__pthread_spin_destroy, __xn_exec_any},
 	[__pse51_mq_open] = {&__mq_open, __xn_exec_lostage},
 	[__pse51_mq_close] = {&__mq_close, __xn_exec_lostage},
 	[__pse51_mq_unlink] = {&__mq_unlink, __xn_exec_lostage},
@@ -2948,6 +3728,7 @@ static xnsysent_t __systab[] = {
 	[__pse51_mmap_epilogue] = {&__mmap_epilogue, __xn_exec_lostage},
 	[__pse51_munmap_prologue] = {&__munmap_prologue, __xn_exec_lostage},
 	[__pse51_munmap_epilogue] = {&__munmap_epilogue, __xn_exec_lostage},
+	[__pse51_shm_physaddr_np] = {&__shm_physaddr_np, __xn_exec_any},
 	[__pse51_mutexattr_init] = {&__pthread_mutexattr_init, __xn_exec_any},
 	[__pse51_mutexattr_destroy] =
 	    {&__pthread_mutexattr_destroy, __xn_exec_any},
@@ -2959,10 +3740,22 @@ static xnsysent_t __systab[] = {
 	    {&__pthread_mutexattr_getprotocol, __xn_exec_any},
 	[__pse51_mutexattr_setprotocol] =
 	    {&__pthread_mutexattr_setprotocol, __xn_exec_any},
+	[__pse51_mutexattr_getprioceiling] =
+	    {&__pthread_mutexattr_getprioceiling, __xn_exec_any},
+	[__pse51_mutexattr_setprioceiling] =
+	    {&__pthread_mutexattr_setprioceiling, __xn_exec_any},
 	[__pse51_mutexattr_getpshared] =
 	    {&__pthread_mutexattr_getpshared, __xn_exec_any},
 	[__pse51_mutexattr_setpshared] =
 	    {&__pthread_mutexattr_setpshared, __xn_exec_any},
+	[__pse51_mutexattr_getspin_np] =
+	    {&__pthread_mutexattr_getspin_np, __xn_exec_any},
+	[__pse51_mutexattr_setspin_np] =
+	    {&__pthread_mutexattr_setspin_np, __xn_exec_any},
+	[__pse51_mutexattr_getpadded_np] =
+	    {&__pthread_mutexattr_getpadded_np, __xn_exec_any},
+	[__pse51_mutexattr_setpadded_np] =
+	    {&__pthread_mutexattr_setpadded_np, __xn_exec_any},
 	[__pse51_condattr_init] = {&__pthread_condattr_init, __xn_exec_any},
 	[__pse51_condattr_destroy] =
 	    {&__pthread_condattr_destroy, __xn_exec_any},
@@ -2975,6 +3768,16 @@ static xnsysent_t __systab[] = {
 	[__pse51_condattr_setpshared] =
 	    {&__pthread_condattr_setpshared, __xn_exec_any},
 	[__pse51_select] = {&__select, __xn_exec_primary},
+	[__pse51_epoll_ctl_np] = {&__epoll_ctl_np, __xn_exec_any},
+	[__pse51_epoll_wait_np] = {&__epoll_wait_np, __xn_exec_primary},
+	[__pse51_mq_alloc_np] = {&__mq_alloc_np, __xn_exec_primary},
+	[__pse51_mq_send_np] = {&__mq_send_np, __xn_exec_any},
+	[__pse51_mq_receive_np] = {&__mq_receive_np, __xn_exec_primary},
+	[__pse51_mq_release_np] = {&__mq_release_np, __xn_exec_any},
+	[__pse51_timer_evq_create_np] = {&__timer_evq_create_np, __xn_exec_any},
+	[__pse51_timer_evq_wait_np] = {&__timer_evq_wait_np, __xn_exec_primary},
+	[__pse51_timer_evq_destroy_np] =
+		{&__timer_evq_destroy_np, __xn_exec_any},
 	[__pse51_sched_setconfig_np] = {&__sched_setconfig_np, __xn_exec_any},
 };
 
@@ -2999,16 +3802,19 @@ static void *pse51_eventcb(int event, void *data)
 		if (!q)
 			return ERR_PTR(-ENOSPC);
 
+		initq(&q->kqueues.barrierq);
 		initq(&q->kqueues.condq);
 #ifdef CONFIG_XENO_OPT_POSIX_INTR
 		initq(&q->kqueues.intrq);
 #endif /* CONFIG_XENO_OPT_POSIX_INTR */
 		initq(&q->kqueues.mutexq);
 		initq(&q->kqueues.semq);
+		initq(&q->kqueues.spinq);
 		initq(&q->kqueues.threadq);
 		initq(&q->kqueues.timerq);
 		pse51_assocq_init(&q->uqds);
 		pse51_assocq_init(&q->usems);
+		pse51_assocq_init(&q->uevqs);
 #ifdef CONFIG_XENO_OPT_POSIX_SHM
 		pse51_assocq_init(&q->umaps);
 		pse51_assocq_init(&q->ufds);
@@ -3026,12 +3832,15 @@ static void *pse51_eventcb(int event, void *data)
 		pse51_sem_usems_cleanup(q);
 		pse51_mq_uqds_cleanup(q);
 		pse51_timerq_cleanup(&q->kqueues);
+		pse51_timer_uevqs_cleanup(q);
 		pse51_semq_cleanup(&q->kqueues);
 		pse51_mutexq_cleanup(&q->kqueues);
 #ifdef CONFIG_XENO_OPT_POSIX_INTR
 		pse51_intrq_cleanup(&q->kqueues);
 #endif /* CONFIG_XENO_OPT_POSIX_INTR */
 		pse51_condq_cleanup(&q->kqueues);
+		pse51_barrierq_cleanup(&q->kqueues);
+		pse51_spinq_cleanup(&q->kqueues);
 
 		xnarch_free_host_mem(q, sizeof(*q));
 
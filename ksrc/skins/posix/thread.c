@@ -179,7 +179,9 @@ int pthread_create(pthread_t *tid,
 	if (attr && attr->magic != PSE51_THREAD_ATTR_MAGIC)
 		return EINVAL;
 
-	thread = (pthread_t)xnmalloc(sizeof(*thread));
+	/* The private signal pool trails the TCB. */
+	thread = (pthread_t)xnmalloc(sizeof(*thread) +
+				     pse51_sigpool_size(attr ?: &default_attr));
 
 	if (!thread)
 		return EAGAIN;
@@ -649,10 +651,14 @@ int pthread_wait_np(unsigned long *overruns_r)
  * - PTHREAD_WARNSW, when set, cause the signal SIGXCPU to be sent to the
  *   current thread, whenever it involontary switches to secondary mode;
  * - PTHREAD_PRIMARY, cause the migration of the current thread to primary
- *   mode.
+ *   mode;
+ * - PTHREAD_PREREL, when set, causes the periodic timer of the calling thread
+ *   to fire ahead of each release point, pthread_wait_np() then busy-waits
+ *   until the nominal release date. This bit takes effect on the next call to
+ *   pthread_make_periodic_np().
  *
- * PTHREAD_LOCK_SCHED is valid for any Xenomai thread, the other bits are only
- * valid for Xenomai user-space threads.
+ * PTHREAD_LOCK_SCHED and PTHREAD_PREREL are valid for any Xenomai thread, the
+ * other bits are only valid for Xenomai user-space threads.
  *
  * This service is a non-portable extension of the POSIX interface.
  *
@@ -668,7 +674,7 @@ int pthread_wait_np(unsigned long *overruns_r)
 int pthread_set_mode_np(int clrmask, int setmask)
 {
 	xnthread_t *cur = xnpod_current_thread();
-	xnflags_t valid_flags = XNLOCK;
+	xnflags_t valid_flags = XNLOCK | XNPREREL;
 
 #ifdef CONFIG_XENO_OPT_PERVASIVE
 	if (xnthread_test_state(cur, XNSHADOW))
@@ -736,6 +742,7 @@ int pthread_set_name_np(pthread_t thread, const char *name)
 		strncpy(p->comm, name, sizeof(p->comm));
 		p->comm[sizeof(p->comm) - 1] = '\0';
 	}
+	xnshadow_rename(&thread->threadbase);
 #endif /* CONFIG_XENO_OPT_PERVASIVE */
 
 	xnlock_put_irqrestore(&nklock, s);
@@ -83,12 +83,16 @@ struct pse51_thread {
     pse51_sigset_t sigmask;     /* signals mask. */
     pse51_sigqueue_t pending;   /* Pending signals */
     pse51_sigqueue_t blocked_received; /* Blocked signals received. */
+    xnpqueue_t sigpool;         /* Preallocated free siginfo blocks. */
+    pse51_sigset_t *sigwait_set; /* Signals waited for by sigtimedwait. */
+    struct pse51_siginfo *sigwait_si; /* Signal handed over to the waiter. */
 
     /* For thread specific data. */
     const void *tsd [PTHREAD_KEYS_MAX];
 
     /* For timers. */
     xnqueue_t timersq;
+    struct pse51_timer_evq *evq; /* Event queue of SIGEV_EVQ_NP timers. */
 
 #ifdef CONFIG_XENO_OPT_PERVASIVE
     struct pse51_hkey hkey;
@@ -57,6 +57,7 @@ static const pthread_attr_t default_thread_attr = {
       name:NULL,
       fp:1,
       affinity:XNPOD_ALL_CPUS,
+      sigqueue:CONFIG_XENO_OPT_POSIX_SIGQUEUE_POOLSZ,
 };
 
 /**
@@ -406,7 +407,7 @@ int pthread_attr_setinheritsched(pthread_attr_t * attr, int inheritsched)
  * Threads created with the attribute object @a attr use the value of this
  * attribute as scheduling policy if the @a inheritsched attribute is set to
  * PTHREAD_EXPLICIT_SCHED. The value of this attribute is one of SCHED_FIFO,
- * SCHED_RR, SCHED_SPORADIC, SCHED_TP or SCHED_OTHER.
+ * SCHED_RR, SCHED_SPORADIC, SCHED_TP, SCHED_EDF or SCHED_OTHER.
  *
  * @param attr attribute object;
  *
@@ -449,7 +450,7 @@ int pthread_attr_getschedpolicy(const pthread_attr_t * attr, int *policy)
  * Threads created with the attribute object @a attr use the value of this
  * attribute as scheduling policy if the @a inheritsched attribute is set to
  * PTHREAD_EXPLICIT_SCHED. The value of this attribute is one of SCHED_FIFO,
- * SCHED_RR, SCHED_SPORADIC, SCHED_TP or SCHED_OTHER.
+ * SCHED_RR, SCHED_SPORADIC, SCHED_TP, SCHED_EDF or SCHED_OTHER.
  *
  * @param attr attribute object;
  *
@@ -478,6 +479,7 @@ int pthread_attr_setschedpolicy(pthread_attr_t * attr, int policy)
 	case SCHED_RR:
 	case SCHED_SPORADIC:
 	case SCHED_TP:
+	case SCHED_EDF:
 
 		break;
 	}
@@ -1062,6 +1064,99 @@ int pthread_attr_setaffinity_np(pthread_attr_t * attr, xnarch_cpumask_t mask)
 	return 0;
 }
 
+/**
+ * Get the signal pool attribute.
+ *
+ * This service stores, at the address @a count, the value of the @a sigqueue
+ * attribute in the attribute object @a attr.
+ *
+ * The @a sigqueue attribute is the number of signal descriptors preallocated
+ * for a thread created with the attribute @a attr. Signals queued to such a
+ * thread with pthread_kill() or pthread_sigqueue_np() are first drawn from
+ * this private pool, then from the pool shared by all threads.
+ *
+ * This service is a non-portable extension of the POSIX interface.
+ *
+ * @param attr attribute object;
+ *
+ * @param count address where the value of the @a sigqueue attribute will be
+ * stored on success.
+ *
+ * @return 0 on success;
+ * @return an error number if:
+ * - EINVAL, @a attr is invalid.
+ *
+ * @par Valid contexts:
+ * - kernel module initialization or cleanup routine;
+ * - Xenomai kernel-space thread.
+ */
+int pthread_attr_getsigqueue_np(const pthread_attr_t * attr, int *count)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!pse51_obj_active(attr, PSE51_THREAD_ATTR_MAGIC, pthread_attr_t)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return EINVAL;
+	}
+
+	*count = attr->sigqueue;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+
+/**
+ * Set the signal pool attribute.
+ *
+ * This service sets to @a count, the value of the @a sigqueue attribute in the
+ * attribute object @a attr.
+ *
+ * The @a sigqueue attribute is the number of signal descriptors preallocated
+ * for a thread created with the attribute @a attr. Signals queued to such a
+ * thread with pthread_kill() or pthread_sigqueue_np() are first drawn from
+ * this private pool, then from the pool shared by all threads. The pool is
+ * allocated from the system heap along with the thread control block; a
+ * null value disables it.
+ *
+ * This service is a non-portable extension of the POSIX interface.
+ *
+ * @param attr attribute object;
+ *
+ * @param count value of the @a sigqueue attribute.
+ *
+ * @return 0 on success;
+ * @return an error number if:
+ * - EINVAL, @a attr is invalid;
+ * - EINVAL, @a count is negative.
+ *
+ * @par Valid contexts:
+ * - kernel module initialization or cleanup routine;
+ * - Xenomai kernel-space thread.
+ */
+int pthread_attr_setsigqueue_np(pthread_attr_t * attr, int count)
+{
+	spl_t s;
+
+	if (count < 0)
+		return EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!pse51_obj_active(attr, PSE51_THREAD_ATTR_MAGIC, pthread_attr_t)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return EINVAL;
+	}
+
+	attr->sigqueue = count;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+
 /*@}*/
 
 EXPORT_SYMBOL_GPL(pthread_attr_init);
@@ -1086,3 +1181,5 @@ EXPORT_SYMBOL_GPL(pthread_attr_getfp_np);
 EXPORT_SYMBOL_GPL(pthread_attr_setfp_np);
 EXPORT_SYMBOL_GPL(pthread_attr_getaffinity_np);
 EXPORT_SYMBOL_GPL(pthread_attr_setaffinity_np);
+EXPORT_SYMBOL_GPL(pthread_attr_getsigqueue_np);
+EXPORT_SYMBOL_GPL(pthread_attr_setsigqueue_np);
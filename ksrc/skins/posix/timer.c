@@ -22,8 +22,11 @@
  *@{*/
 
 #include <nucleus/timer.h>
+#include <nucleus/select.h>
+#include <nucleus/sys_ppd.h>	/* Global semaphore heap. */
 #include <posix/thread.h>
 #include <posix/timer.h>
+#include <posix/timer_evq.h>
 
 #define PSE51_TIMER_MAX  128
 
@@ -43,6 +46,10 @@ struct pse51_timer {
 
 	pse51_siginfo_t si;
 
+	int notify;	/* SIGEV_SIGNAL or SIGEV_EVQ_NP. */
+	struct pse51_timer_evq *evq;	/* Queue holding our last event. */
+	unsigned long evseq;	/* Ring index of that event. */
+
 	clockid_t clockid;
 	pthread_t owner;
 	pse51_kqueues_t *owningq;
@@ -52,12 +59,114 @@ static xnqueue_t timer_freeq;
 
 static struct pse51_timer timer_pool[PSE51_TIMER_MAX];
 
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+
+struct pse51_timer_evq {
+	unsigned magic;
+	struct pse51_timer_ring *ring;	/* In the global semaphore heap. */
+	unsigned long head;	/* Private copies of the ring indexing */
+	unsigned long size;	/* data, user-space may scribble over it. */
+	pthread_t owner;
+	xnsynch_t synchbase;
+	DECLARE_XNSELECT(read_select);
+};
+
+static inline xnheap_t *pse51_timer_evq_heap(void)
+{
+	return &xnsys_ppd_get(1)->sem_heap;
+}
+
+static inline struct pse51_timer_event *
+pse51_timer_evq_slot(struct pse51_timer_evq *evq, unsigned long seq)
+{
+	return &evq->ring->events[seq & (evq->size - 1)];
+}
+
+/* Whether the event last posted by a timer may still be pending, i.e. the
+   head did not go a full turn past its slot. */
+static inline int pse51_timer_evq_posted_p(struct pse51_timer *timer)
+{
+	struct pse51_timer_evq *evq = timer->evq;
+
+	return evq && evq->head - timer->evseq < evq->size;
+}
+
+/* Must be called with nklock locked, irq off. */
+static void pse51_timer_evq_post(struct pse51_timer *timer)
+{
+	struct pse51_timer_evq *evq = timer->owner->evq;
+	struct pse51_timer_event *ev;
+	struct pse51_timer_ring *ring;
+	unsigned long ov;
+
+	if (!evq)
+		return;
+
+	/* An event still pending for this timer absorbs the expiry. */
+	if (timer->evq == evq && pse51_timer_evq_posted_p(timer)) {
+		ev = pse51_timer_evq_slot(evq, timer->evseq);
+		do {
+			ov = xnarch_atomic_get(&ev->overruns);
+			if (ov == PSE51_TIMER_EVENT_CLAIMED)
+				goto post;
+		} while (xnarch_atomic_cmpxchg(&ev->overruns, ov, ov + 1) != ov);
+		return;
+	}
+
+  post:
+	ring = evq->ring;
+	if (evq->head - ring->tail >= evq->size) {
+		ring->dropped++;
+		return;
+	}
+
+	ev = pse51_timer_evq_slot(evq, evq->head);
+	ev->timerid = timer - timer_pool;
+	xnarch_atomic_set(&ev->overruns, 0);
+	timer->evq = evq;
+	timer->evseq = evq->head++;
+	xnarch_write_memory_barrier();
+	ring->head = evq->head;
+
+	xnsynch_wakeup_one_sleeper(&evq->synchbase);
+	xnselect_signal(&evq->read_select, 1);
+}
+
+/* Withdraw the pending event of a timer, the consumer will skip it. Must be
+   called with nklock locked, irq off. */
+static void pse51_timer_evq_cancel(struct pse51_timer *timer)
+{
+	struct pse51_timer_event *ev;
+	unsigned long ov;
+
+	if (pse51_timer_evq_posted_p(timer)) {
+		ev = pse51_timer_evq_slot(timer->evq, timer->evseq);
+		do {
+			ov = xnarch_atomic_get(&ev->overruns);
+			if (ov == PSE51_TIMER_EVENT_CLAIMED)
+				break;
+		} while (xnarch_atomic_cmpxchg(&ev->overruns, ov,
+					       PSE51_TIMER_EVENT_CLAIMED) != ov);
+	}
+
+	timer->evq = NULL;
+}
+
+#else /* !CONFIG_XENO_OPT_PERVASIVE */
+
+#define pse51_timer_evq_post(timer)	do { } while (0)
+#define pse51_timer_evq_cancel(timer)	do { } while (0)
+
+#endif /* !CONFIG_XENO_OPT_PERVASIVE */
+
 static void pse51_base_timer_handler(xntimer_t *xntimer)
 {
 	struct pse51_timer *timer =
 		container_of(xntimer, struct pse51_timer, timerbase);
 
-	if (!timer->queued) {
+	if (timer->notify == SIGEV_EVQ_NP)
+		pse51_timer_evq_post(timer);
+	else if (!timer->queued) {
 		timer->queued = 1;
 		pse51_sigqueue_inner(timer->owner, &timer->si);
 	}
@@ -95,7 +204,7 @@ void pse51_timer_notified(pse51_siginfo_t * si)
  * This service creates a time object using the clock @a clockid.
  *
  * If @a evp is not @a NULL, it describes the notification mechanism used on
- * timer expiration. Only notification via signal delivery is supported (member
+ * timer expiration. Notification via signal delivery is supported (member
  * @a sigev_notify of @a evp set to @a SIGEV_SIGNAL).  The signal will be sent to
  * the thread starting the timer with the timer_settime() service. If @a evp is
  * @a NULL, the SIGALRM signal will be used.
@@ -103,6 +212,12 @@ void pse51_timer_notified(pse51_siginfo_t * si)
  * Note that signals sent to user-space threads will cause them to switch to
  * secondary mode.
  *
+ * As a non-portable extension, user-space timers may instead post their
+ * expiries to the event queue of the thread starting them (member @a
+ * sigev_notify set to @a SIGEV_EVQ_NP), see timer_evq_create_np(). A timer has
+ * at most one event pending in the queue, which counts the expiries occurring
+ * until it is consumed.
+ *
  * If this service succeeds, an identifier for the created timer is returned at
  * the address @a timerid. The timer is unarmed until started with the
  * timer_settime() service.
@@ -119,7 +234,7 @@ void pse51_timer_notified(pse51_siginfo_t * si)
  * @retval -1 with @a errno set if:
  * - EINVAL, the clock @a clockid is invalid;
  * - EINVAL, the member @a sigev_notify of the @b sigevent structure at the
- *   address @a evp is not SIGEV_SIGNAL;
+ *   address @a evp is neither SIGEV_SIGNAL nor SIGEV_EVQ_NP;
  * - EINVAL, the  member @a sigev_signo of the @b sigevent structure is an
  *   invalid signal number;
  * - EAGAIN, the maximum number of timers was exceeded, recompile with a larger
@@ -144,9 +259,15 @@ int timer_create(clockid_t clockid,
 		goto error;
 	}
 
-	/* We only support notification via signals. */
-	if (evp && (evp->sigev_notify != SIGEV_SIGNAL ||
-		    (unsigned)(evp->sigev_signo - 1) > SIGRTMAX - 1)) {
+	/* We only support notification via signals, or via the event queue
+	   of user-space threads. */
+	if (evp && evp->sigev_notify == SIGEV_EVQ_NP) {
+#ifndef CONFIG_XENO_OPT_PERVASIVE
+		err = EINVAL;
+		goto error;
+#endif /* !CONFIG_XENO_OPT_PERVASIVE */
+	} else if (evp && (evp->sigev_notify != SIGEV_SIGNAL ||
+			   (unsigned)(evp->sigev_signo - 1) > SIGRTMAX - 1)) {
 		err = EINVAL;
 		goto error;
 	}
@@ -175,6 +296,8 @@ int timer_create(clockid_t clockid,
 	xntimer_init(&timer->timerbase, pse51_tbase,
 		     pse51_base_timer_handler);
 
+	timer->notify = evp ? evp->sigev_notify : SIGEV_SIGNAL;
+	timer->evq = NULL;
 	timer->overruns = 0;
 	timer->owner = NULL;
 	timer->clockid = clockid;
@@ -227,6 +350,8 @@ int pse51_timer_delete_inner(timer_t timerid, pse51_kqueues_t *q, int force)
 		timer->queued = 0;
 	}
 
+	pse51_timer_evq_cancel(timer);
+
 	xntimer_destroy(&timer->timerbase);
 	if (timer->owner)
 		removeq(&timer->owner->timersq, &timer->tlink);
@@ -294,7 +419,9 @@ static void pse51_timer_gettime_inner(struct pse51_timer *__restrict__ timer,
  * it_interval is not zero, the timer is periodic. The current thread must be a
  * POSIX skin thread (created with pthread_create()) and will be notified via
  * signal of timer expirations. Note that these notifications will cause
- * user-space threads to switch to secondary mode.
+ * user-space threads to switch to secondary mode. Timers created with @a
+ * SIGEV_EVQ_NP notify the event queue of the current thread instead, which
+ * must exist when the timer is started.
  *
  * When starting the timer, if @a flags is TIMER_ABSTIME, the expiration value
  * is interpreted as an absolute date of the clock passed to the timer_create()
@@ -319,6 +446,8 @@ static void pse51_timer_gettime_inner(struct pse51_timer *__restrict__ timer,
  * - EPERM, the caller context is invalid;
  * - EINVAL, the specified timer identifier, expiration date or reload value is
  *   invalid;
+ * - EINVAL, the timer @a timerid notifies via SIGEV_EVQ_NP and the current
+ *   thread has no event queue;
  * - EPERM, the timer @a timerid does not belong to the current process.
  *
  * @par Valid contexts:
@@ -378,12 +507,20 @@ int timer_settime(timer_t timerid,
 	if (ovalue)
 		pse51_timer_gettime_inner(timer, ovalue);
 
+	if (timer->notify == SIGEV_EVQ_NP && !cur->evq &&
+	    (value->it_value.tv_nsec || value->it_value.tv_sec)) {
+		err = EINVAL;
+		goto unlock_and_error;
+	}
+
 	if (timer->queued) {
 		/* timer signal is queued, unqueue it. */
 		pse51_sigunqueue(timer->owner, &timer->si);
 		timer->queued = 0;
 	}
 
+	pse51_timer_evq_cancel(timer);
+
 	if (timer->owner)
 		removeq(&timer->owner->timersq, &timer->tlink);
 
@@ -557,6 +694,7 @@ int timer_getoverrun(timer_t timerid)
 void pse51_timer_init_thread(pthread_t new_thread)
 {
 	initq(&new_thread->timersq);
+	new_thread->evq = NULL;
 }
 
 /* Called with nklock locked irq off. */
@@ -568,8 +706,250 @@ void pse51_timer_cleanup_thread(pthread_t zombie)
 		xntimer_stop(&timer->timerbase);
 		timer->owner = NULL;
 	}
+
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+	/* The queue outlives its owner, until its descriptor is closed. */
+	if (zombie->evq) {
+		zombie->evq->owner = NULL;
+		zombie->evq = NULL;
+	}
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+}
+
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+
+/*
+ * Timer event queues are only available to user-space, through a file
+ * descriptor which may be passed to select(). The services below back the
+ * timer_evq_*_np() calls, see src/skins/posix/timer.c.
+ */
+
+int pse51_timer_evq_create(unsigned nevents,
+			   struct pse51_timer_evq **evqp,
+			   unsigned long *offsetp)
+{
+	pthread_t cur = pse51_current_thread();
+	struct pse51_timer_ring *ring;
+	struct pse51_timer_evq *evq;
+	unsigned long size;
+	spl_t s;
+
+	if (!cur)
+		return EPERM;
+
+	if (nevents == 0)
+		return EINVAL;
+
+	/* A timer never has more than one event in the ring. */
+	if (nevents > PSE51_TIMER_MAX)
+		nevents = PSE51_TIMER_MAX;
+
+	for (size = 1; size < nevents; size <<= 1)
+		;
+
+	evq = xnmalloc(sizeof(*evq));
+	if (!evq)
+		return ENOSPC;
+
+	ring = xnheap_alloc(pse51_timer_evq_heap(),
+			    sizeof(*ring) + size * sizeof(ring->events[0]));
+	if (!ring) {
+		xnfree(evq);
+		return EAGAIN;
+	}
+
+	ring->head = ring->tail = 0;
+	ring->size = size;
+	ring->dropped = 0;
+
+	evq->ring = ring;
+	evq->head = 0;
+	evq->size = size;
+	xnsynch_init(&evq->synchbase, XNSYNCH_PRIO, NULL);
+	xnselect_init(&evq->read_select);
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (cur->evq) {
+		xnlock_put_irqrestore(&nklock, s);
+		xnsynch_destroy(&evq->synchbase);
+		xnselect_destroy(&evq->read_select);
+		xnheap_free(pse51_timer_evq_heap(), ring);
+		xnfree(evq);
+		return EBUSY;
+	}
+
+	evq->owner = cur;
+	evq->magic = PSE51_TIMER_EVQ_MAGIC;
+	cur->evq = evq;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	*evqp = evq;
+	*offsetp = xnheap_mapped_offset(pse51_timer_evq_heap(), ring);
+
+	return 0;
+}
+
+int pse51_timer_evq_wait(struct pse51_timer_evq *evq,
+			 const struct timespec *abstime,
+			 struct timer_event_np *ev)
+{
+	unsigned long timerid, overruns;
+	xnticks_t to = XN_INFINITE;
+	xnflags_t info;
+	int err;
+	spl_t s;
+
+	if (xnpod_unblockable_p())
+		return EPERM;
+
+	if (abstime) {
+		if ((unsigned long)abstime->tv_nsec >= ONE_BILLION)
+			return EINVAL;
+		to = ts2ticks_ceil(abstime) + 1;
+	}
+
+	xnlock_get_irqsave(&nklock, s);
+
+	for (;;) {
+		if (!pse51_obj_active(evq, PSE51_TIMER_EVQ_MAGIC,
+				      struct pse51_timer_evq)) {
+			err = EBADF;
+			break;
+		}
+
+		if (pse51_timer_ring_pop(evq->ring, evq->size - 1,
+					 &timerid, &overruns)) {
+			ev->timerid = (timer_t)timerid;
+			ev->overruns = overruns;
+			err = 0;
+			break;
+		}
+
+		/* Consumers pop events from user-space behind our back,
+		   bring the select state up to date. */
+		xnselect_signal(&evq->read_select, 0);
+
+		info = xnsynch_sleep_on(&evq->synchbase, to,
+					abstime ? XN_ABSOLUTE : XN_RELATIVE);
+		if (info & XNRMID) {
+			err = EBADF;
+			break;
+		}
+		if (info & XNTIMEO) {
+			err = ETIMEDOUT;
+			break;
+		}
+		if (info & XNBREAK) {
+			err = EINTR;
+			break;
+		}
+	}
+
+	if (err == 0)
+		xnselect_signal(&evq->read_select,
+				evq->ring->tail != evq->head);
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
 }
 
+int pse51_timer_evq_destroy(struct pse51_timer_evq *evq)
+{
+	int n, resched;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!pse51_obj_active(evq, PSE51_TIMER_EVQ_MAGIC,
+			      struct pse51_timer_evq)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return EBADF;
+	}
+
+	pse51_mark_deleted(evq);
+
+	if (evq->owner)
+		evq->owner->evq = NULL;
+
+	for (n = 0; n < PSE51_TIMER_MAX; n++)
+		if (timer_pool[n].evq == evq)
+			timer_pool[n].evq = NULL;
+
+	resched = (xnsynch_destroy(&evq->synchbase) == XNSYNCH_RESCHED);
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	xnselect_destroy(&evq->read_select);
+	xnheap_free(pse51_timer_evq_heap(), evq->ring);
+	xnfree(evq);
+
+	if (resched)
+		xnpod_schedule();
+
+	return 0;
+}
+
+#ifdef CONFIG_XENO_OPT_POSIX_SELECT
+int pse51_timer_evq_select_bind(struct pse51_timer_evq *evq,
+				struct xnselector *selector,
+				unsigned type, unsigned index)
+{
+	struct xnselect_binding *binding;
+	int err;
+	spl_t s;
+
+	if (type != XNSELECT_READ)
+		return -EBADF;
+
+	binding = xnmalloc(sizeof(*binding));
+	if (!binding)
+		return -ENOMEM;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!pse51_obj_active(evq, PSE51_TIMER_EVQ_MAGIC,
+			      struct pse51_timer_evq)) {
+		err = -EBADF;
+		goto unlock_and_error;
+	}
+
+	err = xnselect_bind(&evq->read_select, binding, selector, type,
+			    index, evq->ring->tail != evq->head);
+	if (err)
+		goto unlock_and_error;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+
+      unlock_and_error:
+	xnlock_put_irqrestore(&nklock, s);
+	xnfree(binding);
+	return err;
+}
+#endif /* CONFIG_XENO_OPT_POSIX_SELECT */
+
+static void uevq_cleanup(pse51_assoc_t *assoc)
+{
+	pse51_ufd_t *ufd = assoc2ufd(assoc);
+#if XENO_DEBUG(POSIX)
+	xnprintf("Posix: destroying timer event queue descriptor %lu.\n",
+		 pse51_assoc_key(assoc));
+#endif /* XENO_DEBUG(POSIX) */
+	pse51_timer_evq_destroy((struct pse51_timer_evq *)ufd->kfd);
+	xnfree(ufd);
+}
+
+void pse51_timer_uevqs_cleanup(pse51_queues_t *q)
+{
+	pse51_assocq_destroy(&q->uevqs, &uevq_cleanup);
+}
+
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+
 void pse51_timerq_cleanup(pse51_kqueues_t *q)
 {
 	xnholder_t *holder;
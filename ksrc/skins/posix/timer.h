@@ -29,6 +29,26 @@ void pse51_timer_cleanup_thread(pthread_t zombie);
 
 void pse51_timerq_cleanup(pse51_kqueues_t *q);
 
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+struct pse51_timer_evq;
+
+int pse51_timer_evq_create(unsigned nevents,
+			   struct pse51_timer_evq **evqp,
+			   unsigned long *offsetp);
+
+int pse51_timer_evq_wait(struct pse51_timer_evq *evq,
+			 const struct timespec *abstime,
+			 struct timer_event_np *ev);
+
+int pse51_timer_evq_destroy(struct pse51_timer_evq *evq);
+
+int pse51_timer_evq_select_bind(struct pse51_timer_evq *evq,
+				struct xnselector *selector,
+				unsigned type, unsigned index);
+
+void pse51_timer_uevqs_cleanup(pse51_queues_t *q);
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+
 int pse51_timer_pkg_init(void);
 
 void pse51_timer_pkg_cleanup(void);
@@ -0,0 +1,86 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef _POSIX_TIMER_EVQ_H
+#define _POSIX_TIMER_EVQ_H
+
+#include <asm/xenomai/atomic.h>
+
+/*
+ * Timer event ring, living in the global semaphore heap. The kernel
+ * posts the expiries of the timers created with SIGEV_EVQ_NP to the
+ * ring of the thread which armed them, the consumer pops them in
+ * user-space without issuing any syscall.
+ *
+ * The head is only written by the kernel, under nklock, the tail
+ * only by the consumer. A timer has at most one event in the ring:
+ * until that event is consumed, further expiries only bump its
+ * overrun count. The consumer claims an event by swapping its overrun
+ * count for PSE51_TIMER_EVENT_CLAIMED; the kernel does the same to
+ * cancel the event of a timer being deleted or re-armed, in which
+ * case the consumer skips it.
+ */
+#define PSE51_TIMER_EVENT_CLAIMED ((unsigned long)-1)
+
+struct pse51_timer_event {
+	xnarch_atomic_t overruns;
+	unsigned long timerid;
+};
+
+struct pse51_timer_ring {
+	unsigned long head;	/* Next event to post. */
+	unsigned long tail;	/* Next event to consume. */
+	unsigned long size;	/* Power of two. */
+	unsigned long dropped;	/* Expiries lost to a full ring. */
+	struct pse51_timer_event events[0];
+};
+
+#if defined(__KERNEL__) || defined(__XENO_SIM__) || defined(CONFIG_XENO_FASTSYNCH)
+/* Pop the next live event, returns 0 if the ring is empty. The kernel
+   passes its own copy of the index mask, user-space may not be trusted. */
+static inline int pse51_timer_ring_pop(struct pse51_timer_ring *ring,
+				       unsigned long mask,
+				       unsigned long *timerid,
+				       unsigned long *overruns)
+{
+	struct pse51_timer_event *ev;
+	unsigned long tail, ov;
+
+	for (tail = ring->tail; tail != ring->head; ring->tail = ++tail) {
+		xnarch_read_memory_barrier();
+		ev = &ring->events[tail & mask];
+		*timerid = ev->timerid;
+
+		do {
+			ov = xnarch_atomic_get(&ev->overruns);
+			if (ov == PSE51_TIMER_EVENT_CLAIMED)
+				break;
+		} while (xnarch_atomic_cmpxchg(&ev->overruns, ov,
+					       PSE51_TIMER_EVENT_CLAIMED) != ov);
+
+		if (ov != PSE51_TIMER_EVENT_CLAIMED) {
+			*overruns = ov;
+			xnarch_memory_barrier();
+			ring->tail = tail + 1;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+#endif /* __KERNEL__ || __XENO_SIM__ || CONFIG_XENO_FASTSYNCH */
+
+#endif /* !_POSIX_TIMER_EVQ_H */
@@ -74,16 +74,18 @@ u_long pt_create(const char *name, void *paddr, void *laddr,	/* unused */
 
 	pt->psize = pt->nblks * pt->bsize;
 	pt->data = (caddr_t)pt + overhead;
-	pt->freelist = mp = pt->data;
-	pt->ublks = 0;
+	atomic_long_set(&pt->ublks, 0);
 
-	for (n = pt->nblks; n > 1; n--) {
-		char *nmp = mp + pt->bsize;
-		*((void **)mp) = nmp;
-		mp = nmp;
-	}
+	/* Leave the upper bits of the stack head to the update tag. */
+	for (pt->idxmask = 1; pt->idxmask < pt->nblks;
+	     pt->idxmask = (pt->idxmask << 1) | 1)
+		;
+
+	for (n = 1, mp = pt->data; n < pt->nblks; n++, mp += pt->bsize)
+		*((u_long *)mp) = n + 1;
 
-	*((void **)mp) = NULL;
+	*((u_long *)mp) = 0;
+	xnarch_atomic_set(&pt->freehead, 1);
 
 	memset(pt->bitmap, 0, overhead - sizeof(*pt) + sizeof(pt->bitmap));
 	pt->magic = PSOS_PT_MAGIC;
@@ -116,7 +118,7 @@ u_long pt_delete(u_long ptid)
 		goto unlock_and_exit;
 	}
 
-	if (!(pt->flags & PT_DEL) && pt->ublks > 0) {
+	if (!(pt->flags & PT_DEL) && atomic_long_read(&pt->ublks) > 0) {
 		err = ERR_BUFINUSE;
 		goto unlock_and_exit;
 	}
@@ -132,78 +134,82 @@ u_long pt_delete(u_long ptid)
 	return err;
 }
 
+/*
+ * Buffers are obtained and released without grabbing nklock. Free
+ * blocks form a LIFO stack of block indices; its head carries a tag
+ * bumped by every update, so that a compare-and-swap started before
+ * the head block was popped and pushed back by a preempting context
+ * fails instead of corrupting the stack (ABA).
+ */
+
+static inline u_long pt_next_head(psospt_t *pt, u_long old, u_long idx)
+{
+	return ((old & ~pt->idxmask) + pt->idxmask + 1) | idx;
+}
+
 u_long pt_getbuf(u_long ptid, void **bufaddr)
 {
-	u_long numblk, err = SUCCESS;
+	u_long old, idx;
 	psospt_t *pt;
-	void *buf;
-	spl_t s;
-
-	xnlock_get_irqsave(&nklock, s);
+	char *buf;
 
 	pt = psos_h2obj_active(ptid, PSOS_PT_MAGIC, psospt_t);
 
-	if (!pt) {
-		err = psos_handle_error(ptid, PSOS_PT_MAGIC, psospt_t);
-		goto unlock_and_exit;
-	}
-
-	if ((buf = pt->freelist) != NULL) {
-		pt->freelist = *((void **)buf);
-		pt->ublks++;
-		numblk = ((char *)buf - pt->data) / pt->bsize;
-		pt_bitmap_setbit(pt, numblk);
-	} else
-		err = ERR_NOBUF;
+	if (!pt)
+		return psos_handle_error(ptid, PSOS_PT_MAGIC, psospt_t);
 
+	do {
+		old = xnarch_atomic_get(&pt->freehead);
+		idx = old & pt->idxmask;
+		if (idx == 0) {
+			*bufaddr = NULL;
+			return ERR_NOBUF;
+		}
+		buf = pt->data + (idx - 1) * pt->bsize;
+		/* May read a stale link, the tag then fails the swap. */
+	} while (xnarch_atomic_cmpxchg(&pt->freehead, old,
+				       pt_next_head(pt, old,
+						    *((volatile u_long *)buf)))
+		 != old);
+
+	pt_bitmap_setbit(pt, idx - 1);
+	atomic_long_inc(&pt->ublks);
 	*bufaddr = buf;
 
-      unlock_and_exit:
-
-	xnlock_put_irqrestore(&nklock, s);
-
-	return err;
+	return SUCCESS;
 }
 
 u_long pt_retbuf(u_long ptid, void *buf)
 {
-	u_long numblk, err = SUCCESS;
+	u_long numblk, old;
 	psospt_t *pt;
-	spl_t s;
-
-	xnlock_get_irqsave(&nklock, s);
 
 	pt = psos_h2obj_active(ptid, PSOS_PT_MAGIC, psospt_t);
 
-	if (!pt) {
-		err = psos_handle_error(ptid, PSOS_PT_MAGIC, psospt_t);
-		goto unlock_and_exit;
-	}
+	if (!pt)
+		return psos_handle_error(ptid, PSOS_PT_MAGIC, psospt_t);
 
 	if ((char *)buf < pt->data ||
 	    (char *)buf >= pt->data + pt->psize ||
-	    (((char *)buf - pt->data) % pt->bsize) != 0) {
-		err = ERR_BUFADDR;
-		goto unlock_and_exit;
-	}
+	    (((char *)buf - pt->data) % pt->bsize) != 0)
+		return ERR_BUFADDR;
 
 	numblk = ((char *)buf - pt->data) / pt->bsize;
 
-	if (!pt_bitmap_tstbit(pt, numblk)) {
-		err = ERR_BUFFREE;
-		goto unlock_and_exit;
-	}
+	if (!pt_bitmap_clrbit(pt, numblk))
+		return ERR_BUFFREE;
 
-	pt_bitmap_clrbit(pt, numblk);
-	*((void **)buf) = pt->freelist;
-	pt->freelist = buf;
-	pt->ublks--;
+	atomic_long_dec(&pt->ublks);
 
-      unlock_and_exit:
+	do {
+		old = xnarch_atomic_get(&pt->freehead);
+		*((u_long *)buf) = old & pt->idxmask;
+		xnarch_write_memory_barrier();
+	} while (xnarch_atomic_cmpxchg(&pt->freehead, old,
+				       pt_next_head(pt, old, numblk + 1))
+		 != old);
 
-	xnlock_put_irqrestore(&nklock, s);
-
-	return err;
+	return SUCCESS;
 }
 
 u_long pt_ident(const char *name, u_long node, u_long *ptid)
@@ -250,6 +256,7 @@ u_long pt_ident(const char *name, u_long node, u_long *ptid)
  *   [...block status bitmap (busy/free)...]
  *   [...user data area...]
  *
- * - Each free block starts with a link to the next free block
- * in the partition's free list. A NULL link ends this list.
+ * - Each free block starts with the index plus one of the next
+ * free block in the partition's free stack. A zero link ends this
+ * stack.
  */
@@ -148,19 +148,13 @@ void psosqueue_cleanup(void)
 		xnfree(holder);
 }
 
-static u_long feed_pool(xnqueue_t *chunkq,
-			xnqueue_t *freeq, u_long mbufcount, u_long datalen)
+static u_long carve_chunk(xnqueue_t *chunkq, xnqueue_t *freeq,
+			  u_long mbufcount, u_long datalen, int class)
 {
 	char *bstart, *bend;
 	psosmbuf_t *mbuf;
 	u_long bufsize;
 
-	if (countq(freeq) >= mbufcount)
-		return mbufcount;
-
-	if (mbufcount < PSOS_QUEUE_MIN_ALLOC)
-		mbufcount = PSOS_QUEUE_MIN_ALLOC;	/* Minimum allocation */
-
 	datalen = ((datalen + 3) & ~0x3);
 	bufsize = sizeof(*mbuf) + datalen - sizeof(mbuf->data);
 
@@ -181,24 +175,94 @@ static u_long feed_pool(xnqueue_t *chunkq,
 	     bstart += bufsize) {
 		mbuf = (psosmbuf_t *) bstart;
 		inith(&mbuf->link);
+		mbuf->class = class;
 		appendq(freeq, &mbuf->link);
 	}
 
 	return mbufcount;
 }
 
-static psosmbuf_t *get_mbuf(psosqueue_t *queue, u_long msglen)
+static u_long feed_pool(xnqueue_t *chunkq,
+			xnqueue_t *freeq, u_long mbufcount, u_long datalen)
 {
-	psosmbuf_t *mbuf = NULL;
+	if (countq(freeq) >= mbufcount)
+		return mbufcount;
 
-	if (testbits(queue->synchbase.status, Q_NOCACHE)) {
+	if (mbufcount < PSOS_QUEUE_MIN_ALLOC)
+		mbufcount = PSOS_QUEUE_MIN_ALLOC;	/* Minimum allocation */
+
+	return carve_chunk(chunkq, freeq, mbufcount, datalen, -1);
+}
+
+static int mbuf_class(u_long msglen)
+{
+	u_long size = 1UL << PSOS_QUEUE_MIN_CLASS;
+	int class;
+
+	for (class = 0; class < PSOS_QUEUE_NR_CLASSES; class++, size <<= 1)
+		if (msglen <= size)
+			return class;
+
+	return -1;
+}
+
+static psosmbuf_t *get_class_mbuf(psosqueue_t *queue, u_long msglen)
+{
+	xnqueue_t *classq;
+	xnholder_t *holder;
+	psosmbuf_t *mbuf;
+	int class;
+
+	class = mbuf_class(msglen);
+
+	if (class < 0) {
 		mbuf =
 		    (psosmbuf_t *) xnmalloc(sizeof(*mbuf) + msglen -
 					    sizeof(mbuf->data));
-
-		if (mbuf)
+		if (mbuf) {
 			inith(&mbuf->link);
-	} else {
+			mbuf->class = -1;
+		}
+
+		return mbuf;
+	}
+
+	classq = &queue->classq[class];
+	holder = getq(classq);
+
+	if (!holder) {
+		carve_chunk(&queue->chunkq, classq, PSOS_QUEUE_MAG_ALLOC,
+			    1UL << (PSOS_QUEUE_MIN_CLASS + class), class);
+		holder = getq(classq);
+	}
+
+	return holder ? link2psosmbuf(holder) : NULL;
+}
+
+static void put_mbuf(psosqueue_t *queue, psosmbuf_t *mbuf)
+{
+	if (--mbuf->refcnt > 0)
+		return;		/* Still referenced by other receivers. */
+
+	if (testbits(queue->synchbase.status, Q_NOCACHE)) {
+		if (mbuf->class < 0)
+			xnfree(mbuf);
+		else
+			appendq(&queue->classq[mbuf->class], &mbuf->link);
+	} else if (testbits(queue->synchbase.status, Q_SHAREDINIT))
+		/* Message buffer should go to the psosmbufq */
+		appendq(&psosmbufq, &mbuf->link);
+	else
+		appendq(&queue->freeq, &mbuf->link);
+}
+
+static psosmbuf_t *get_mbuf(psosqueue_t *queue, u_long msglen)
+{
+	psosmbuf_t *mbuf = NULL;
+
+	if (testbits(queue->synchbase.status, Q_NOCACHE))
+		mbuf = get_class_mbuf(queue, msglen);
+	else {
 		xnholder_t *holder = NULL;
 		if (testbits(queue->synchbase.status, Q_SHAREDINIT)) {
 			holder = getq(&psosmbufq);
@@ -217,6 +281,9 @@ static psosmbuf_t *get_mbuf(psosqueue_t *queue, u_long msglen)
 			mbuf = link2psosmbuf(holder);
 	}
 
+	if (mbuf)
+		mbuf->refcnt = 1;
+
 	return mbuf;
 }
 
@@ -226,7 +293,7 @@ static u_long q_create_internal(const char *name,
 {
 	static unsigned long msgq_ids;
 	psosqueue_t *queue;
-	int bflags, ret;
+	int bflags, ret, n;
 	spl_t s;
 
 	bflags = (flags & Q_VARIABLE);
@@ -273,6 +340,8 @@ static u_long q_create_internal(const char *name,
 	initq(&queue->inq);
 	initq(&queue->freeq);
 	initq(&queue->chunkq);
+	for (n = 0; n < PSOS_QUEUE_NR_CLASSES; n++)
+		initq(&queue->classq[n]);
 
 	if (bflags & Q_PRIVCACHE) {
 		if ((bflags & Q_SHAREDINIT) == 0) {
@@ -337,13 +406,18 @@ static u_long q_destroy_internal(psosqueue_t *queue)
 		xnregistry_remove(queue->handle);
 
 	if (testbits(flags, Q_NOCACHE)) {
-		/* No cache used -- return the buffers waiting to be received
-		   (i.e.linked to the input queue) to the region #0. Received
-		   buffers have already been freed on-the-fly in
-		   q_receive_internal(). */
+		/* No cache used -- return the unclassified buffers
+		   waiting to be received (i.e.linked to the input queue)
+		   to the region #0. Received buffers have already been
+		   freed on-the-fly in q_receive_internal(); class
+		   buffers go away with their chunks. */
 
 		while ((holder = getq(&queue->inq)) != NULL)
-			xnfree(link2psosmbuf(holder));
+			if (link2psosmbuf(holder)->class < 0)
+				xnfree(link2psosmbuf(holder));
+
+		while ((holder = getq(&queue->chunkq)) != NULL)
+			xnfree(holder);
 	} else {
 		if (testbits(flags, Q_SHAREDINIT)) {
 			/* Buffers come from the global shared queue. */
@@ -500,13 +574,7 @@ static u_long q_receive_internal(u_long qid,
 	if (msglen)
 		*msglen = mbuf->len;
 
-	if (testbits(queue->synchbase.status, Q_NOCACHE))
-		xnfree(mbuf);
-	else if (testbits(queue->synchbase.status, Q_SHAREDINIT)) {
-		/* Message buffer should go to the psosmbufq */
-		appendq(&psosmbufq, &mbuf->link);
-	} else
-		appendq(&queue->freeq, &mbuf->link);
+	put_mbuf(queue, mbuf);
 
       unlock_and_exit:
 
@@ -594,6 +662,7 @@ static u_long q_broadcast_internal(u_long qid,
 				   u_long flags,
 				   void *msgbuf, u_long msglen, u_long *count)
 {
+	psosmbuf_t *mbuf = NULL;
 	u_long err = SUCCESS;
 	xnthread_t *sleeper;
 	psosqueue_t *queue;
@@ -627,18 +696,25 @@ static u_long q_broadcast_internal(u_long qid,
 
 	*count = 0;
 
+	/* All receivers share a single copy of the message, the last
+	   one to consume it releases the buffer. */
 	while ((sleeper =
 		xnsynch_wakeup_one_sleeper(&queue->synchbase)) != NULL) {
-		psosmbuf_t *mbuf = get_mbuf(queue, msglen);
-
 		if (!mbuf) {
-			/* Will beget a spurious wakeup. */
-			thread2psostask(sleeper)->waitargs.qmsg = NULL;
-			break;
+			mbuf = get_mbuf(queue, msglen);
+
+			if (!mbuf) {
+				/* Will beget a spurious wakeup. */
+				thread2psostask(sleeper)->waitargs.qmsg = NULL;
+				break;
+			}
+
+			mbuf->len = msglen;
+			mbuf->refcnt = 0;
+			memcpy(mbuf->data, msgbuf, msglen);
 		}
 
-		mbuf->len = msglen;
-		memcpy(mbuf->data, msgbuf, msglen);
+		mbuf->refcnt++;
 		thread2psostask(sleeper)->waitargs.qmsg = mbuf;
 		(*count)++;
 	}
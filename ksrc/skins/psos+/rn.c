@@ -29,14 +29,36 @@ static void *rn0addr;
 
 static int rn_destroy_internal(psosrn_t *rn);
 
+/* Serve segments in constant time with TLSF when available. */
+#ifdef CONFIG_XENO_OPT_PSOS_RN_TLSF
+#define RN_HEAP_FLAGS	XNHEAP_TLSF
+#define RN_HEAP_GFP	XNHEAP_GFP_TLSF
+#else
+#define RN_HEAP_FLAGS	0
+#define RN_HEAP_GFP	0
+#endif
+
 #ifdef CONFIG_XENO_OPT_VFILE
 
 struct vfile_priv {
 	struct xnpholder *curr;
 	unsigned long rnsize;
 	unsigned long memused;
+	unsigned long allocs;
+	unsigned long frees;
+	unsigned long failures;
+	unsigned long long maxalloc;
 };
 
+static void vfile_collect(struct vfile_priv *priv, psosrn_t *rn)
+{
+	priv->memused = xnheap_used_mem(&rn->heapbase);
+	priv->allocs = rn->heapbase.stats.allocs;
+	priv->frees = rn->heapbase.stats.frees;
+	priv->failures = rn->heapbase.stats.failures;
+	priv->maxalloc = xnarch_tsc_to_ns(rn->heapbase.stats.maxalloc);
+}
+
 struct vfile_data {
 	char name[XNOBJECT_NAME_LEN];
 };
@@ -52,7 +74,7 @@ static int vfile_rewind(struct xnvfile_snapshot_iterator *it)
 
 	priv->curr = getheadpq(xnsynch_wait_queue(&rn->synchbase));
 	priv->rnsize = rn->rnsize;
-	priv->memused = xnheap_used_mem(&rn->heapbase);
+	vfile_collect(priv, rn);
 
 	return xnsynch_nsleepers(&rn->synchbase);
 }
@@ -64,7 +86,7 @@ static int vfile_next(struct xnvfile_snapshot_iterator *it, void *data)
 	struct vfile_data *p = data;
 	struct xnthread *thread;
 
-	priv->memused = xnheap_used_mem(&rn->heapbase); /* Refresh as we collect. */
+	vfile_collect(priv, rn); /* Refresh as we collect. */
 
 	if (priv->curr == NULL)
 		return 0;	/* We are done. */
@@ -86,8 +108,11 @@ static int vfile_show(struct xnvfile_snapshot_iterator *it, void *data)
 
 	if (p == NULL) {	/* Dump header. */
 		xnvfile_printf(it,
-			       "size=%lu:used=%lu\n",
-			       priv->rnsize, priv->memused);
+			       "size=%lu:used=%lu\n"
+			       "allocs=%lu:frees=%lu:failures=%lu:maxalloc=%Luns\n",
+			       priv->rnsize, priv->memused,
+			       priv->allocs, priv->frees, priv->failures,
+			       priv->maxalloc);
 		if (it->nrdata > 0)
 			/* Region is pended -- dump waiters */
 			xnvfile_printf(it, "-------------------------------------------\n");
@@ -225,7 +250,7 @@ u_long rn_create(const char *name,
 
 		rnsize = xnheap_rounded_size(rnsize, PAGE_SIZE),
 		err = xnheap_init_mapped(&rn->heapbase, rnsize,
-					 XNARCH_SHARED_HEAP_FLAGS);
+					 XNARCH_SHARED_HEAP_FLAGS | RN_HEAP_GFP);
 
 		if (err)
 			return err;
@@ -240,7 +265,8 @@ u_long rn_create(const char *name,
 		 * Caller must have accounted for overhead and
 		 * alignment since it supplies the memory space.
 		 */
-		if (xnheap_init(&rn->heapbase, rnaddr, rnsize, XNHEAP_PAGE_SIZE) != 0)
+		if (xnheap_init(&rn->heapbase, rnaddr, rnsize, XNHEAP_PAGE_SIZE,
+				RN_HEAP_FLAGS) != 0)
 			return ERR_TINYRN;
 
 	xnheap_set_label(&rn->heapbase, "psosrn: %s", name);
@@ -0,0 +1,402 @@
+/*
+ * Xenomai is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*!
+ * @ingroup driverapi
+ * @defgroup rtdmaio Asynchronous I/O Services
+ *
+ * A device context may be given a pair of rings shared with its
+ * user-space owner: the application posts requests to the submission
+ * ring, then rings the doorbell with rt_dev_aio_enter(), which passes
+ * them to the submit_rt handler of the driver. The driver posts the
+ * outcome of each request to the completion ring with
+ * rtdm_aio_complete(), usually from its interrupt handler, and the
+ * application reaps the completions from its side of the mapping, so
+ * that many requests may be in flight for a single syscall.
+ *
+ * RTDM never lets more requests in flight than the completion ring
+ * may hold, including the completions not reaped yet, so that
+ * rtdm_aio_complete() never has to wait nor fail.
+ *
+ * @{
+ */
+
+#include <linux/vmalloc.h>
+#include <linux/mman.h>
+
+#include "rtdm/internal.h"
+
+struct rtdm_aio {
+	struct rtdm_aio_area *area;
+	size_t size;
+	struct rtdm_aio_sqe *sqes;
+	struct rtdm_aio_cqe *cqes;
+	/* Kernel copies of the indexes and masks, user-space may not be
+	   trusted with them. */
+	unsigned int sq_head;
+	unsigned int sq_mask;
+	unsigned int cq_tail;
+	unsigned int cq_mask;
+	unsigned int cq_entries;
+	unsigned int inflight;
+	rtdm_event_t cq_event;
+	/* One for the context, one per mapping. */
+	atomic_t refcount;
+};
+
+static void rtdm_aio_put(struct rtdm_aio *aio)
+{
+	if (atomic_dec_and_test(&aio->refcount)) {
+		vfree(aio->area);
+		kfree(aio);
+	}
+}
+
+static void rtdm_aio_vmopen(struct vm_area_struct *vma)
+{
+	struct rtdm_aio *aio = vma->vm_private_data;
+
+	atomic_inc(&aio->refcount);
+}
+
+static void rtdm_aio_vmclose(struct vm_area_struct *vma)
+{
+	rtdm_aio_put(vma->vm_private_data);
+}
+
+static struct vm_operations_struct rtdm_aio_vmops = {
+	.open = rtdm_aio_vmopen,
+	.close = rtdm_aio_vmclose,
+};
+
+/* nklock held, irqs off. */
+static inline unsigned int rtdm_aio_cq_fill(struct rtdm_aio *aio)
+{
+	unsigned int fill = aio->cq_tail - aio->area->cq.head;
+
+	/* A bogus head set by user-space only hurts user-space. */
+	return fill > aio->cq_entries ? aio->cq_entries : fill;
+}
+
+/**
+ * @brief Post the completion of an asynchronous I/O request
+ *
+ * @param[in] context Context the request was submitted to
+ * @param[in] user_data Value of the user_data field of the request
+ * @param[in] res Result of the request, a negative error code on failure
+ *
+ * Each request the submit_rt handler of the driver started must be
+ * completed exactly once. The driver must have completed all its
+ * requests before its close handler returns successfully.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: possible.
+ */
+void rtdm_aio_complete(struct rtdm_dev_context *context,
+		       unsigned long long user_data, long res)
+{
+	struct rtdm_aio *aio = context->reserved.aio;
+	struct rtdm_aio_cqe *cqe;
+	spl_t s;
+
+	trace_mark(xn_rtdm, aio_complete, "context %p user_data %Lu res %ld",
+		   context, user_data, res);
+
+	xnlock_get_irqsave(&nklock, s);
+
+	XENO_ASSERT(RTDM, aio->inflight > 0,
+		    xnlock_put_irqrestore(&nklock, s); return;);
+
+	cqe = &aio->cqes[aio->cq_tail & aio->cq_mask];
+	cqe->user_data = user_data;
+	cqe->res = res;
+	cqe->flags = 0;
+	xnarch_write_memory_barrier();
+	aio->area->cq.tail = ++aio->cq_tail;
+	aio->inflight--;
+
+	rtdm_event_pulse(&aio->cq_event);
+
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+EXPORT_SYMBOL_GPL(rtdm_aio_complete);
+
+/**
+ * @brief Count the asynchronous I/O requests in flight
+ *
+ * @param[in] context Context to inspect
+ *
+ * @return The number of requests started by the submit_rt handler
+ * which have not been completed yet. A close handler may return
+ * -EAGAIN until this drops to zero, to have the closure retried
+ * later.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+unsigned int rtdm_aio_inflight(struct rtdm_dev_context *context)
+{
+	struct rtdm_aio *aio = context->reserved.aio;
+
+	return aio ? aio->inflight : 0;
+}
+
+EXPORT_SYMBOL_GPL(rtdm_aio_inflight);
+
+/** @} */
+
+int __rt_dev_aio_setup(rtdm_user_info_t *user_info, int fd,
+		       struct rtdm_aio_params *params)
+{
+	unsigned int sq_entries, cq_entries;
+	struct rtdm_dev_context *context;
+	struct rtdm_aio *aio;
+	void *uaddr = NULL;
+	int ret, race;
+	spl_t s;
+
+	trace_mark(xn_rtdm, aio_setup, "user_info %p fd %d sq %u cq %u",
+		   user_info, fd, params->sq_entries, params->cq_entries);
+
+	if (!xnpod_root_p() || user_info == NULL)
+		return -EPERM;
+
+	sq_entries = params->sq_entries;
+	cq_entries = params->cq_entries ?: 2 * sq_entries;
+	if (sq_entries == 0 || (sq_entries & (sq_entries - 1)) ||
+	    (cq_entries & (cq_entries - 1)) || cq_entries < sq_entries ||
+	    cq_entries > RTDM_AIO_MAX_ENTRIES)
+		return -EINVAL;
+
+	context = rtdm_context_get(fd);
+	if (unlikely(!context))
+		return -EBADF;
+
+	ret = -ENOSYS;
+	if (context->ops->submit_rt == NULL)
+		goto unlock_out;
+
+	ret = -EBUSY;
+	if (context->reserved.aio)
+		goto unlock_out;
+
+	ret = -ENOMEM;
+	aio = kmalloc(sizeof(*aio), GFP_KERNEL);
+	if (aio == NULL)
+		goto unlock_out;
+
+	params->cq_entries = cq_entries;
+	params->sq_off = sizeof(struct rtdm_aio_area);
+	params->cq_off = params->sq_off +
+		sq_entries * sizeof(struct rtdm_aio_sqe);
+	params->size = PAGE_ALIGN(params->cq_off +
+				  cq_entries * sizeof(struct rtdm_aio_cqe));
+
+	aio->size = params->size;
+	aio->area = vmalloc(aio->size);
+	if (aio->area == NULL) {
+		kfree(aio);
+		goto unlock_out;
+	}
+	memset(aio->area, 0, aio->size);
+
+	aio->area->sq.mask = sq_entries - 1;
+	aio->area->sq.entries = sq_entries;
+	aio->area->cq.mask = cq_entries - 1;
+	aio->area->cq.entries = cq_entries;
+	aio->sqes = (void *)aio->area + params->sq_off;
+	aio->cqes = (void *)aio->area + params->cq_off;
+	aio->sq_head = 0;
+	aio->sq_mask = sq_entries - 1;
+	aio->cq_tail = 0;
+	aio->cq_mask = cq_entries - 1;
+	aio->cq_entries = cq_entries;
+	aio->inflight = 0;
+	rtdm_event_init(&aio->cq_event, 0);
+	atomic_set(&aio->refcount, 2);
+
+	ret = rtdm_mmap_to_user(user_info, aio->area, aio->size,
+				PROT_READ | PROT_WRITE, &uaddr,
+				&rtdm_aio_vmops, aio);
+	if (ret) {
+		rtdm_event_destroy(&aio->cq_event);
+		vfree(aio->area);
+		kfree(aio);
+		goto unlock_out;
+	}
+
+	xnlock_get_irqsave(&nklock, s);
+	race = context->reserved.aio != NULL;
+	if (!race)
+		context->reserved.aio = aio;
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (race) {
+		rtdm_event_destroy(&aio->cq_event);
+		/* Drops the reference of the mapping. */
+		rtdm_munmap(user_info, uaddr, aio->size);
+		rtdm_aio_put(aio);
+		ret = -EBUSY;
+		goto unlock_out;
+	}
+
+	params->area = uaddr;
+
+unlock_out:
+	rtdm_context_unlock(context);
+
+	return ret;
+}
+
+EXPORT_SYMBOL_GPL(__rt_dev_aio_setup);
+
+int __rt_dev_aio_enter(rtdm_user_info_t *user_info, int fd,
+		       unsigned int to_submit, unsigned int min_complete,
+		       nanosecs_rel_t timeout)
+{
+	struct rtdm_dev_context *context;
+	unsigned int submitted = 0;
+	struct rtdm_aio_sqe sqe;
+	rtdm_toseq_t timeout_seq;
+	struct rtdm_aio *aio;
+	int ret = 0;
+	spl_t s;
+
+	trace_mark(xn_rtdm, aio_enter, "user_info %p fd %d to_submit %u "
+		   "min_complete %u timeout %Ld", user_info, fd, to_submit,
+		   min_complete, (long long)timeout);
+
+	context = rtdm_context_get(fd);
+	if (unlikely(!context))
+		return -EBADF;
+
+	aio = context->reserved.aio;
+	if (unlikely(aio == NULL)) {
+		ret = -EINVAL;
+		goto unlock_out;
+	}
+
+	if (!rtdm_in_rt_context()) {
+		/* The submission handler only runs in real-time context. */
+		ret = -ENOSYS;
+		goto unlock_out;
+	}
+
+	while (submitted < to_submit) {
+		xnlock_get_irqsave(&nklock, s);
+
+		if (aio->area->sq.tail == aio->sq_head ||
+		    aio->inflight + rtdm_aio_cq_fill(aio) >= aio->cq_entries) {
+			xnlock_put_irqrestore(&nklock, s);
+			break;
+		}
+
+		xnarch_read_memory_barrier();
+		sqe = aio->sqes[aio->sq_head & aio->sq_mask];
+		aio->area->sq.head = ++aio->sq_head;
+		aio->inflight++;
+
+		xnlock_put_irqrestore(&nklock, s);
+
+		ret = context->ops->submit_rt(context, user_info, &sqe);
+
+		XENO_ASSERT(RTDM, !rthal_local_irq_disabled(),
+			    rthal_local_irq_enable(););
+
+		if (ret < 0)
+			rtdm_aio_complete(context, sqe.user_data, ret);
+
+		submitted++;
+	}
+
+	ret = 0;
+
+	if (min_complete == 0)
+		goto unlock_out;
+
+	rtdm_toseq_init(&timeout_seq, timeout);
+
+	xnlock_get_irqsave(&nklock, s);
+
+	for (;;) {
+		/* Never wait for more than what may ever complete. */
+		if (rtdm_aio_cq_fill(aio) >=
+		    min(min_complete, rtdm_aio_cq_fill(aio) + aio->inflight))
+			break;
+
+		if (test_bit(RTDM_CLOSING, &context->context_flags)) {
+			ret = -EBADF;
+			break;
+		}
+
+		ret = rtdm_event_timedwait(&aio->cq_event, timeout,
+					   &timeout_seq);
+		if (ret)
+			break;
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+unlock_out:
+	rtdm_context_unlock(context);
+
+	return submitted > 0 ? submitted : ret;
+}
+
+EXPORT_SYMBOL_GPL(__rt_dev_aio_enter);
+
+/* Wake up the waiters of a context being closed. */
+void rtdm_aio_shutdown(struct rtdm_dev_context *context)
+{
+	struct rtdm_aio *aio = context->reserved.aio;
+
+	if (aio)
+		rtdm_event_pulse(&aio->cq_event);
+}
+
+/* Detach the rings from a context being destroyed, secondary mode. */
+void rtdm_aio_cleanup(struct rtdm_dev_context *context)
+{
+	struct rtdm_aio *aio = context->reserved.aio;
+
+	if (aio == NULL)
+		return;
+
+	XENO_ASSERT(RTDM, aio->inflight == 0,
+		    xnprintf("RTDM: closing fd %d with %u requests "
+			     "in flight.\n", context->fd, aio->inflight););
+
+	context->reserved.aio = NULL;
+	rtdm_event_destroy(&aio->cq_event);
+	rtdm_aio_put(aio);
+}
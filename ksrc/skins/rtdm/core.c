@@ -39,8 +39,7 @@
 
 #define FD_BITMAP_SIZE  ((RTDM_FD_MAX + BITS_PER_LONG-1) / BITS_PER_LONG)
 
-struct rtdm_fildes fildes_table[RTDM_FD_MAX] =
-	{ [0 ... RTDM_FD_MAX-1] = { NULL } };
+struct rtdm_fildes *fildes_chunks[RTDM_FD_CHUNKS];
 static unsigned long used_fildes[FD_BITMAP_SIZE];
 int open_fildes;	/* number of used descriptors */
 
@@ -53,6 +52,8 @@ EXPORT_SYMBOL_GPL(rtdm_tbase);
 
 DEFINE_XNLOCK(rt_fildes_lock);
 
+struct rtdm_close_stats rtdm_close_stats;
+
 /**
  * @brief Retrieve and lock a device context
  *
@@ -63,6 +64,10 @@ DEFINE_XNLOCK(rt_fildes_lock);
  * @note The device context has to be unlocked using rtdm_context_put() when
  * it is no longer referenced.
  *
+ * @note This service does not take any global lock. The closing code
+ * waits for lookups in flight on the descriptor to complete before
+ * checking whether the context is still referenced.
+ *
  * Environments:
  *
  * This service can be called from:
@@ -77,36 +82,92 @@ DEFINE_XNLOCK(rt_fildes_lock);
 struct rtdm_dev_context *rtdm_context_get(int fd)
 {
 	struct rtdm_dev_context *context;
+	struct rtdm_fildes *fildes;
 	spl_t s;
 
-	if ((unsigned int)fd >= RTDM_FD_MAX)
+	fildes = rtdm_fildes_get(fd);
+	if (unlikely(!fildes))
 		return NULL;
 
-	xnlock_get_irqsave(&rt_fildes_lock, s);
+	/*
+	 * Keep the window between reading the context pointer and
+	 * grabbing a reference short and preemption-free, the closer
+	 * spins until it is over.
+	 */
+	splhigh(s);
 
-	context = fildes_table[fd].context;
-	if (unlikely(!context)) {
-		xnlock_put_irqrestore(&rt_fildes_lock, s);
-		return NULL;
-	}
+	atomic_inc(&fildes->lookups);
+	xnarch_memory_barrier();
 
-	atomic_inc(&context->close_lock_count);
+	context = fildes->context;
+	if (likely(context))
+		atomic_inc(&context->close_lock_count);
 
-	xnlock_put_irqrestore(&rt_fildes_lock, s);
+	xnarch_memory_barrier();
+	atomic_dec(&fildes->lookups);
+
+	splexit(s);
 
 	return context;
 }
 
 EXPORT_SYMBOL_GPL(rtdm_context_get);
 
+/*
+ * Called with rt_fildes_lock held. xnmalloc() is fine from any
+ * context, so the table may grow on behalf of real-time callers too.
+ */
+static int grow_fildes(int fd)
+{
+	struct rtdm_fildes *chunk;
+	int n;
+
+	if (fildes_chunks[fd >> RTDM_FD_CHUNK_SHIFT])
+		return 0;
+
+	chunk = xnmalloc(RTDM_FD_CHUNK_SIZE * sizeof(*chunk));
+	if (chunk == NULL)
+		return -ENOMEM;
+
+	for (n = 0; n < RTDM_FD_CHUNK_SIZE; n++) {
+		chunk[n].context = NULL;
+		atomic_set(&chunk[n].lookups, 0);
+	}
+
+	xnarch_write_memory_barrier();
+	fildes_chunks[fd >> RTDM_FD_CHUNK_SHIFT] = chunk;
+
+	return 0;
+}
+
+/* Wait for the lockless lookups which might have seen the context. */
+static void sync_fildes(struct rtdm_fildes *fildes)
+{
+	xnarch_memory_barrier();
+
+	while (atomic_read(&fildes->lookups))
+		cpu_relax();
+}
+
+void rtdm_fildes_cleanup(void)
+{
+	int n;
+
+	for (n = 0; n < RTDM_FD_CHUNKS; n++)
+		if (fildes_chunks[n]) {
+			xnfree(fildes_chunks[n]);
+			fildes_chunks[n] = NULL;
+		}
+}
+
 static int create_instance(struct rtdm_device *device,
 			   struct rtdm_dev_context **context_ptr,
-			   struct rtdm_fildes **fildes_ptr,
+			   int *fd_ptr,
 			   rtdm_user_info_t *user_info, int nrt_mem)
 {
 	struct rtdm_dev_context *context;
 	xnshadow_ppd_t *ppd = NULL;
-	int fd;
+	int fd, err;
 	spl_t s;
 
 	/*
@@ -114,7 +175,7 @@ static int create_instance(struct rtdm_device *device,
 	 * revert also partially successful allocations.
 	 */
 	*context_ptr = NULL;
-	*fildes_ptr = NULL;
+	*fd_ptr = -1;
 
 	/* Reserve a file descriptor */
 	xnlock_get_irqsave(&rt_fildes_lock, s);
@@ -125,12 +186,19 @@ static int create_instance(struct rtdm_device *device,
 	}
 
 	fd = find_first_zero_bit(used_fildes, RTDM_FD_MAX);
+
+	err = grow_fildes(fd);
+	if (unlikely(err)) {
+		xnlock_put_irqrestore(&rt_fildes_lock, s);
+		return err;
+	}
+
 	__set_bit(fd, used_fildes);
 	open_fildes++;
 
 	xnlock_put_irqrestore(&rt_fildes_lock, s);
 
-	*fildes_ptr = &fildes_table[fd];
+	*fd_ptr = fd;
 
 	context = device->reserved.exclusive_context;
 	if (context) {
@@ -144,7 +212,9 @@ static int create_instance(struct rtdm_device *device,
 
 		xnlock_put_irqrestore(&rt_dev_lock, s);
 	} else {
-		if (nrt_mem)
+		if (device->device_flags & RTDM_CONTEXT_CACHE)
+			context = xnobjpool_alloc(&device->reserved.context_pool);
+		else if (nrt_mem)
 			context = kmalloc(sizeof(struct rtdm_dev_context) +
 					  device->context_size, GFP_KERNEL);
 		else
@@ -171,26 +241,48 @@ static int create_instance(struct rtdm_device *device,
 	context->reserved.owner =
 	    ppd ? container_of(ppd, struct rtdm_process, ppd) : NULL;
 	INIT_LIST_HEAD(&context->reserved.cleanup);
+	context->reserved.aio = NULL;
 
 	return 0;
 }
 
-static void __cleanup_fildes(struct rtdm_fildes *fildes)
+static void __cleanup_fildes(int fd, struct rtdm_fildes *fildes)
 {
-	__clear_bit((fildes - fildes_table), used_fildes);
+	__clear_bit(fd, used_fildes);
 	fildes->context = NULL;
 	open_fildes--;
 }
 
-static void cleanup_fildes(struct rtdm_fildes *fildes)
+/* Called with rt_fildes_lock held. */
+static void account_close(struct rtdm_dev_context *context, int deferred)
+{
+	struct rtdm_close_stats *stats = &rtdm_close_stats;
+	unsigned long long t;
+
+	t = xnarch_get_cpu_tsc() - context->reserved.close_date;
+	stats->closes++;
+	stats->deferred += deferred;
+	stats->total += t;
+	if (t > stats->max)
+		stats->max = t;
+}
+
+static inline int rtdm_rt_close_p(struct rtdm_device *device)
+{
+	return (device->device_flags & RTDM_CONTEXT_CACHE) &&
+		device->ops.close_rt != (void *)rtdm_no_support;
+}
+
+static void cleanup_fildes(int fd)
 {
 	spl_t s;
 
-	if (!fildes)
+	if (fd < 0)
 		return;
 
+	/* The context was not published yet, no lookup can see it. */
 	xnlock_get_irqsave(&rt_fildes_lock, s);
-	__cleanup_fildes(fildes);
+	__cleanup_fildes(fd, rtdm_fildes_get(fd));
 	xnlock_put_irqrestore(&rt_fildes_lock, s);
 }
 
@@ -199,8 +291,13 @@ static void cleanup_instance(struct rtdm_device *device,
 			     int nrt_mem)
 {
 	if (context) {
+		rtdm_aio_cleanup(context);
+
 		if (device->reserved.exclusive_context)
 			context->device = NULL;
+		else if (device->device_flags & RTDM_CONTEXT_CACHE)
+			xnobjpool_free(&device->reserved.context_pool,
+				       context);
 		else {
 			if (nrt_mem)
 				kfree(context);
@@ -212,49 +309,63 @@ static void cleanup_instance(struct rtdm_device *device,
 	rtdm_dereference_device(device);
 }
 
+/*
+ * Pending closures are processed in batches: the queue is grabbed
+ * as a whole, so that closers keep queuing without contending with
+ * the work, and the lock is only taken again once per pass to
+ * requeue what could not be closed yet and account for the rest.
+ */
 static DECLARE_WORK_FUNC(close_callback)
 {
-	struct rtdm_dev_context *context;
+	struct rtdm_dev_context *context, *tmp;
 	LIST_HEAD(deferred_list);
+	LIST_HEAD(batch);
+	unsigned long nr = 0;
 	int reschedule = 0;
 	int err;
 	spl_t s;
 
 	xnlock_get_irqsave(&rt_fildes_lock, s);
+	list_splice_init(&cleanup_queue, &batch);
+	xnlock_put_irqrestore(&rt_fildes_lock, s);
 
-	while (!list_empty(&cleanup_queue)) {
-		context = list_first_entry(&cleanup_queue,
-					   struct rtdm_dev_context,
-					   reserved.cleanup);
-		list_del(&context->reserved.cleanup);
+	list_for_each_entry_safe(context, tmp, &batch, reserved.cleanup) {
 		atomic_inc(&context->close_lock_count);
 
-		xnlock_put_irqrestore(&rt_fildes_lock, s);
-
 		err = context->ops->close_nrt(context, NULL);
 
 		if (err == -EAGAIN ||
 		    atomic_read(&context->close_lock_count) > 1) {
 			atomic_dec(&context->close_lock_count);
-			list_add_tail(&context->reserved.cleanup,
-				      &deferred_list);
+			list_move_tail(&context->reserved.cleanup,
+				       &deferred_list);
 			if (err == -EAGAIN)
 				reschedule = 1;
-		} else {
-			trace_mark(xn_rtdm, fd_closed, "fd %d", context->fd);
-
-			cleanup_instance(context->device, context,
-					 test_bit(RTDM_CREATED_IN_NRT,
-						  &context->context_flags));
-		}
-
-		xnlock_get_irqsave(&rt_fildes_lock, s);
+		} else
+			nr++;
 	}
 
+	xnlock_get_irqsave(&rt_fildes_lock, s);
+
 	list_splice(&deferred_list, &cleanup_queue);
 
+	list_for_each_entry(context, &batch, reserved.cleanup)
+		account_close(context, 1);
+
+	rtdm_close_stats.batches++;
+	if (nr > rtdm_close_stats.max_batch)
+		rtdm_close_stats.max_batch = nr;
+
 	xnlock_put_irqrestore(&rt_fildes_lock, s);
 
+	list_for_each_entry_safe(context, tmp, &batch, reserved.cleanup) {
+		trace_mark(xn_rtdm, fd_closed, "fd %d", context->fd);
+
+		cleanup_instance(context->device, context,
+				 test_bit(RTDM_CREATED_IN_NRT,
+					  &context->context_flags));
+	}
+
 	if (reschedule)
 		schedule_delayed_work(&close_work,
 				      (HZ * CLOSURE_RETRY_PERIOD_MS) / 1000);
@@ -269,9 +380,8 @@ void rtdm_apc_handler(void *cookie)
 int __rt_dev_open(rtdm_user_info_t *user_info, const char *path, int oflag)
 {
 	struct rtdm_device *device;
-	struct rtdm_fildes *fildes;
 	struct rtdm_dev_context *context;
-	int ret;
+	int ret, fd;
 	int nrt_mode = !rtdm_in_rt_context();
 
 	device = get_named_device(path);
@@ -281,7 +391,7 @@ int __rt_dev_open(rtdm_user_info_t *user_info, const char *path, int oflag)
 	if (!device)
 		goto err_out;
 
-	ret = create_instance(device, &context, &fildes, user_info, nrt_mode);
+	ret = create_instance(device, &context, &fd, user_info, nrt_mode);
 	if (ret != 0)
 		goto cleanup_out;
 
@@ -299,7 +409,9 @@ int __rt_dev_open(rtdm_user_info_t *user_info, const char *path, int oflag)
 	if (unlikely(ret < 0))
 		goto cleanup_out;
 
-	fildes->context = context;
+	/* Publish the context once fully set up. */
+	xnarch_write_memory_barrier();
+	rtdm_fildes_get(fd)->context = context;
 
 	trace_mark(xn_rtdm, fd_created,
 		   "device %p fd %d", device, context->fd);
@@ -307,7 +419,7 @@ int __rt_dev_open(rtdm_user_info_t *user_info, const char *path, int oflag)
 	return context->fd;
 
 cleanup_out:
-	cleanup_fildes(fildes);
+	cleanup_fildes(fd);
 	cleanup_instance(device, context, nrt_mode);
 
 err_out:
@@ -320,9 +432,8 @@ int __rt_dev_socket(rtdm_user_info_t *user_info, int protocol_family,
 		    int socket_type, int protocol)
 {
 	struct rtdm_device *device;
-	struct rtdm_fildes *fildes;
 	struct rtdm_dev_context *context;
-	int ret;
+	int ret, fd;
 	int nrt_mode = !rtdm_in_rt_context();
 
 	device = get_protocol_device(protocol_family, socket_type);
@@ -333,7 +444,7 @@ int __rt_dev_socket(rtdm_user_info_t *user_info, int protocol_family,
 	if (!device)
 		goto err_out;
 
-	ret = create_instance(device, &context, &fildes, user_info, nrt_mode);
+	ret = create_instance(device, &context, &fd, user_info, nrt_mode);
 	if (ret != 0)
 		goto cleanup_out;
 
@@ -351,7 +462,9 @@ int __rt_dev_socket(rtdm_user_info_t *user_info, int protocol_family,
 	if (unlikely(ret < 0))
 		goto cleanup_out;
 
-	fildes->context = context;
+	/* Publish the context once fully set up. */
+	xnarch_write_memory_barrier();
+	rtdm_fildes_get(fd)->context = context;
 
 	trace_mark(xn_rtdm, fd_created,
 		   "device %p fd %d", device, context->fd);
@@ -359,7 +472,7 @@ int __rt_dev_socket(rtdm_user_info_t *user_info, int protocol_family,
 	return context->fd;
 
 cleanup_out:
-	cleanup_fildes(fildes);
+	cleanup_fildes(fd);
 	cleanup_instance(device, context, nrt_mode);
 
 err_out:
@@ -371,6 +484,7 @@ EXPORT_SYMBOL_GPL(__rt_dev_socket);
 int __rt_dev_close(rtdm_user_info_t *user_info, int fd)
 {
 	struct rtdm_dev_context *context;
+	struct rtdm_fildes *fildes;
 	spl_t s;
 	int ret;
 	int nrt_mode = !rtdm_in_rt_context();
@@ -378,34 +492,45 @@ int __rt_dev_close(rtdm_user_info_t *user_info, int fd)
 	trace_mark(xn_rtdm, close, "user_info %p fd %d", user_info, fd);
 
 	ret = -EBADF;
-	if (unlikely((unsigned int)fd >= RTDM_FD_MAX))
+	fildes = rtdm_fildes_get(fd);
+	if (unlikely(!fildes))
 		goto err_out;
 
 	xnlock_get_irqsave(&rt_fildes_lock, s);
 
-	context = fildes_table[fd].context;
+	context = fildes->context;
 
 	if (unlikely(!context)) {
 		xnlock_put_irqrestore(&rt_fildes_lock, s);
 		goto err_out;	/* -EBADF */
 	}
 
-	/* Avoid asymmetric close context by switching to nrt. */
-	if (unlikely(test_bit(RTDM_CREATED_IN_NRT, &context->context_flags)) &&
-	    !nrt_mode) {
+	/*
+	 * Avoid asymmetric close context by switching to nrt, unless the
+	 * context was taken from the device cache and the driver can
+	 * close it from RT. Asynchronous I/O rings are released from nrt
+	 * as well.
+	 */
+	if (unlikely((test_bit(RTDM_CREATED_IN_NRT, &context->context_flags) &&
+		      !rtdm_rt_close_p(context->device)) ||
+		     context->reserved.aio) && !nrt_mode) {
 		xnlock_put_irqrestore(&rt_fildes_lock, s);
 
 		ret = -ENOSYS;
 		goto err_out;
 	}
 
+	context->reserved.close_date = xnarch_get_cpu_tsc();
 	set_bit(RTDM_CLOSING, &context->context_flags);
 	atomic_inc(&context->close_lock_count);
 
-	__cleanup_fildes(&fildes_table[fd]);
+	__cleanup_fildes(fd, fildes);
 
 	xnlock_put_irqrestore(&rt_fildes_lock, s);
 
+	sync_fildes(fildes);
+	rtdm_aio_shutdown(context);
+
 	if (nrt_mode)
 		ret = context->ops->close_nrt(context, user_info);
 	else
@@ -429,6 +554,8 @@ int __rt_dev_close(rtdm_user_info_t *user_info, int fd)
 		goto unlock_out;
 	}
 
+	account_close(context, 0);
+
 	xnlock_put_irqrestore(&rt_fildes_lock, s);
 
 	trace_mark(xn_rtdm, fd_closed, "fd %d", context->fd);
@@ -451,14 +578,22 @@ EXPORT_SYMBOL_GPL(__rt_dev_close);
 void cleanup_owned_contexts(void *owner)
 {
 	struct rtdm_dev_context *context;
+	struct rtdm_fildes *fildes;
 	unsigned int fd;
 	int ret;
 	spl_t s;
 
 	for (fd = 0; fd < RTDM_FD_MAX; fd++) {
+		fildes = rtdm_fildes_get(fd);
+		if (fildes == NULL) {
+			/* Skip the whole unallocated chunk. */
+			fd |= RTDM_FD_CHUNK_SIZE - 1;
+			continue;
+		}
+
 		xnlock_get_irqsave(&rt_fildes_lock, s);
 
-		context = fildes_table[fd].context;
+		context = fildes->context;
 		if (context && context->reserved.owner != owner)
 			context = NULL;
 
@@ -543,6 +678,47 @@ int __rt_dev_ioctl(rtdm_user_info_t *user_info, int fd, int request, ...)
 
 EXPORT_SYMBOL_GPL(__rt_dev_ioctl);
 
+/*
+ * Default vectored IOCTL handler, for drivers which only provide the
+ * single request ones.
+ */
+int rtdm_loop_ioctlv(struct rtdm_dev_context *context,
+		     rtdm_user_info_t *user_info,
+		     struct rtdm_ioctl_vec *vec, unsigned int vlen)
+{
+	rtdm_ioctl_handler_t ioctl;
+	unsigned int n;
+	int ret;
+
+	ioctl = rtdm_in_rt_context() ?
+		context->ops->ioctl_rt : context->ops->ioctl_nrt;
+
+	for (n = 0; n < vlen; n++) {
+		ret = ioctl(context, user_info, vec[n].request,
+			    (void __user *)vec[n].arg);
+		vec[n].result = ret;
+		if (ret < 0)
+			/*
+			 * A failing first request fails the whole call,
+			 * so that -ENOSYS gets it retried from the
+			 * opposite context.
+			 */
+			return n > 0 ? n : ret;
+	}
+
+	return n;
+}
+
+int __rt_dev_ioctlv(rtdm_user_info_t *user_info, int fd,
+		    struct rtdm_ioctl_vec *vec, unsigned int vlen)
+{
+	trace_mark(xn_rtdm, ioctlv, "user_info %p fd %d vec %p vlen %u",
+		   user_info, fd, vec, vlen);
+	MAJOR_FUNCTION_WRAPPER(ioctlv, vec, vlen);
+}
+
+EXPORT_SYMBOL_GPL(__rt_dev_ioctlv);
+
 ssize_t __rt_dev_read(rtdm_user_info_t *user_info, int fd, void *buf,
 		      size_t nbyte)
 {
@@ -591,6 +767,79 @@ ssize_t __rt_dev_sendmsg(rtdm_user_info_t *user_info, int fd,
 
 EXPORT_SYMBOL_GPL(__rt_dev_sendmsg);
 
+/*
+ * Default multiple message handlers, for drivers which only provide
+ * the single message ones.
+ */
+int rtdm_loop_recvmmsg(struct rtdm_dev_context *context,
+		       rtdm_user_info_t *user_info,
+		       struct rtdm_mmsghdr *msgvec, unsigned int vlen,
+		       int flags)
+{
+	rtdm_recvmsg_handler_t recvmsg;
+	unsigned int n;
+	ssize_t ret;
+
+	recvmsg = rtdm_in_rt_context() ?
+		context->ops->recvmsg_rt : context->ops->recvmsg_nrt;
+
+	for (n = 0; n < vlen; n++) {
+		ret = recvmsg(context, user_info, &msgvec[n].msg_hdr, flags);
+		if (ret < 0)
+			/* Report the error with the next call. */
+			return n > 0 ? n : ret;
+		msgvec[n].msg_len = ret;
+		/* Only wait for the first message. */
+		flags |= MSG_DONTWAIT;
+	}
+
+	return n;
+}
+
+int rtdm_loop_sendmmsg(struct rtdm_dev_context *context,
+		       rtdm_user_info_t *user_info,
+		       struct rtdm_mmsghdr *msgvec, unsigned int vlen,
+		       int flags)
+{
+	rtdm_sendmsg_handler_t sendmsg;
+	unsigned int n;
+	ssize_t ret;
+
+	sendmsg = rtdm_in_rt_context() ?
+		context->ops->sendmsg_rt : context->ops->sendmsg_nrt;
+
+	for (n = 0; n < vlen; n++) {
+		ret = sendmsg(context, user_info, &msgvec[n].msg_hdr, flags);
+		if (ret < 0)
+			return n > 0 ? n : ret;
+		msgvec[n].msg_len = ret;
+	}
+
+	return n;
+}
+
+int __rt_dev_recvmmsg(rtdm_user_info_t *user_info, int fd,
+		      struct rtdm_mmsghdr *msgvec, unsigned int vlen,
+		      int flags)
+{
+	trace_mark(xn_rtdm, recvmmsg, "user_info %p fd %d msgvec %p "
+		   "vlen %u flags %d", user_info, fd, msgvec, vlen, flags);
+	MAJOR_FUNCTION_WRAPPER(recvmmsg, msgvec, vlen, flags);
+}
+
+EXPORT_SYMBOL_GPL(__rt_dev_recvmmsg);
+
+int __rt_dev_sendmmsg(rtdm_user_info_t *user_info, int fd,
+		      struct rtdm_mmsghdr *msgvec, unsigned int vlen,
+		      int flags)
+{
+	trace_mark(xn_rtdm, sendmmsg, "user_info %p fd %d msgvec %p "
+		   "vlen %u flags %d", user_info, fd, msgvec, vlen, flags);
+	MAJOR_FUNCTION_WRAPPER(sendmmsg, msgvec, vlen, flags);
+}
+
+EXPORT_SYMBOL_GPL(__rt_dev_sendmmsg);
+
 /**
  * @brief Bind a selector to specified event types of a given file descriptor
  * @internal
@@ -1086,6 +1335,29 @@ int rt_dev_close(int fd);
  */
 int rt_dev_ioctl(int fd, int request, ...);
 
+/**
+ * @brief Issue a vector of IOCTLs
+ *
+ * @param[in] fd File descriptor as returned by rt_dev_open() or rt_dev_socket()
+ * @param[in,out] vec Vector of requests
+ * @param[in] vlen Number of entries in @a vec
+ *
+ * The requests are issued in order with a single lookup of @a fd, the
+ * value returned by each one being stored in the result field of its
+ * entry. Processing stops at the first failing request, its error code
+ * being stored likewise.
+ *
+ * @return Number of requests which succeeded, i.e. @a vlen if all did,
+ * otherwise negative error code if none could be issued
+ *
+ * Environments:
+ *
+ * Depends on driver implementation, see @ref profiles "Device Profiles".
+ *
+ * Rescheduling: possible.
+ */
+int rt_dev_ioctlv(int fd, struct rtdm_ioctl_vec *vec, unsigned int vlen);
+
 /**
  * @brief Read from device
  *
@@ -1211,6 +1483,138 @@ ssize_t rt_dev_recv(int fd, void *buf, size_t len, int flags);
  */
 ssize_t rt_dev_sendmsg(int fd, const struct msghdr *msg, int flags);
 
+/**
+ * @brief Receive multiple messages from socket
+ *
+ * @param[in] fd File descriptor as returned by rt_dev_socket()
+ * @param[in,out] msgvec Vector of message descriptors
+ * @param[in] vlen Number of entries in @a msgvec
+ * @param[in] flags Message flags
+ *
+ * Only the first message is waited for according to @a flags, the
+ * following ones are received only if already pending. The number of
+ * bytes received for each message is returned in the msg_len field of
+ * its descriptor.
+ *
+ * @return Number of messages received, otherwise negative error code
+ *
+ * Environments:
+ *
+ * Depends on driver implementation, see @ref profiles "Device Profiles".
+ *
+ * Rescheduling: possible.
+ *
+ * @see @c recvmmsg() in the Linux manual pages
+ */
+int rt_dev_recvmmsg(int fd, struct rtdm_mmsghdr *msgvec, unsigned int vlen,
+		    int flags);
+
+/**
+ * @brief Transmit multiple messages to socket
+ *
+ * @param[in] fd File descriptor as returned by rt_dev_socket()
+ * @param[in,out] msgvec Vector of message descriptors
+ * @param[in] vlen Number of entries in @a msgvec
+ * @param[in] flags Message flags
+ *
+ * The number of bytes transmitted for each message is returned in the
+ * msg_len field of its descriptor.
+ *
+ * @return Number of messages transmitted, otherwise negative error code
+ *
+ * Environments:
+ *
+ * Depends on driver implementation, see @ref profiles "Device Profiles".
+ *
+ * Rescheduling: possible.
+ *
+ * @see @c sendmmsg() in the Linux manual pages
+ */
+int rt_dev_sendmmsg(int fd, struct rtdm_mmsghdr *msgvec, unsigned int vlen,
+		    int flags);
+
+/**
+ * @brief Set up asynchronous I/O rings
+ *
+ * @param[in] fd File descriptor as returned by rt_dev_open() or
+ * rt_dev_socket()
+ * @param[in,out] params Ring sizes on entry, address and layout of the
+ * shared area on return, see struct rtdm_aio_params
+ *
+ * Allocates a submission and a completion ring for the device
+ * context, and maps them into the address space of the caller. The
+ * mapping remains valid until the caller unmaps it, even after the
+ * device is closed.
+ *
+ * @return 0 on success, otherwise:
+ *
+ * - -EBADF is returned if @a fd cannot be resolved.
+ *
+ * - -EINVAL is returned if a ring size is not a power of two, or the
+ * completion ring would be smaller than the submission ring or
+ * larger than RTDM_AIO_MAX_ENTRIES.
+ *
+ * - -ENOSYS is returned if the device does not support asynchronous
+ * I/O.
+ *
+ * - -EBUSY is returned if the rings were set up already.
+ *
+ * - -ENOMEM is returned if the rings could not be allocated or mapped.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - User-space task (non-RT)
+ *
+ * Rescheduling: possible.
+ */
+int rt_dev_aio_setup(int fd, struct rtdm_aio_params *params);
+
+/**
+ * @brief Submit asynchronous I/O requests and wait for completions
+ *
+ * @param[in] fd File descriptor the rings were set up for
+ * @param[in] to_submit Maximum number of requests to pass to the
+ * driver from the submission ring
+ * @param[in] min_complete Number of completions to wait for in the
+ * completion ring, counting the ones not reaped yet. Fewer are waited
+ * for if fewer requests are in flight.
+ * @param[in] timeout Relative timeout of the wait, see
+ * @ref RTDM_TIMEOUT_xxx for special values
+ *
+ * Requests are submitted in ring order, as long as the completion
+ * ring has room for the outcome of all requests in flight. A request
+ * the driver rejects is completed at once with the error code as
+ * result.
+ *
+ * @return Number of requests submitted if any, otherwise 0 on success
+ * or a negative error code:
+ *
+ * - -EBADF is returned if @a fd cannot be resolved or was closed
+ * while waiting.
+ *
+ * - -EINVAL is returned if no rings were set up for @a fd.
+ *
+ * - -ETIMEDOUT is returned if the timeout elapsed before enough
+ * requests completed.
+ *
+ * - -EWOULDBLOCK is returned if the caller would have to wait while a
+ * negative timeout was passed.
+ *
+ * - -EINTR is returned if the wait was interrupted.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - User-space task (RT)
+ *
+ * Rescheduling: possible.
+ */
+int rt_dev_aio_enter(int fd, unsigned int to_submit,
+		     unsigned int min_complete, nanosecs_rel_t timeout);
+
 /**
  * @brief Transmit message to socket
  *
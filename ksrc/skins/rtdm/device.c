@@ -254,17 +254,31 @@ int rtdm_dev_register(struct rtdm_device *device)
 		return -EINVAL;
 	}
 	if (device->ops.close_rt &&
-	    device->ops.close_rt != (void *)rtdm_no_support)
-		xnlogerr("RTDM: RT close handler is deprecated, driver "
-			 "requires update.\n");
-	else
+	    device->ops.close_rt != (void *)rtdm_no_support) {
+		/* Cached contexts may be closed from RT context. */
+		if (!(device->device_flags & RTDM_CONTEXT_CACHE))
+			xnlogerr("RTDM: RT close handler is deprecated, "
+				 "driver requires update.\n");
+	} else
 		device->ops.close_rt = (void *)rtdm_no_support;
 
 	SET_DEFAULT_OP_IF_NULL(device->ops, ioctl);
+	if (!device->ops.ioctlv_rt)
+		device->ops.ioctlv_rt = rtdm_loop_ioctlv;
+	if (!device->ops.ioctlv_nrt)
+		device->ops.ioctlv_nrt = rtdm_loop_ioctlv;
 	SET_DEFAULT_OP_IF_NULL(device->ops, read);
 	SET_DEFAULT_OP_IF_NULL(device->ops, write);
 	SET_DEFAULT_OP_IF_NULL(device->ops, recvmsg);
 	SET_DEFAULT_OP_IF_NULL(device->ops, sendmsg);
+	if (!device->ops.recvmmsg_rt)
+		device->ops.recvmmsg_rt = rtdm_loop_recvmmsg;
+	if (!device->ops.recvmmsg_nrt)
+		device->ops.recvmmsg_nrt = rtdm_loop_recvmmsg;
+	if (!device->ops.sendmmsg_rt)
+		device->ops.sendmmsg_rt = rtdm_loop_sendmmsg;
+	if (!device->ops.sendmmsg_nrt)
+		device->ops.sendmmsg_nrt = rtdm_loop_sendmmsg;
 	if (!device->ops.select_bind)
 		device->ops.select_bind = rtdm_select_bind_no_support;
 
@@ -283,7 +297,12 @@ int rtdm_dev_register(struct rtdm_device *device)
 		}
 		/* mark exclusive context as unused */
 		device->reserved.exclusive_context->device = NULL;
-	}
+	} else if (device->device_flags & RTDM_CONTEXT_CACHE)
+		xnobjpool_init(&device->reserved.context_pool,
+			       device->proc_name,
+			       sizeof(struct rtdm_dev_context) +
+			       device->context_size,
+			       CONFIG_XENO_OPT_RTDM_CONTEXT_CACHE);
 
 	down(&nrt_dev_lock);
 
@@ -366,6 +385,8 @@ err:
 	up(&nrt_dev_lock);
 	if (device->reserved.exclusive_context)
 		kfree(device->reserved.exclusive_context);
+	else if (device->device_flags & RTDM_CONTEXT_CACHE)
+		xnobjpool_destroy(&device->reserved.context_pool);
 	return ret;
 }
 
@@ -447,6 +468,8 @@ int rtdm_dev_unregister(struct rtdm_device *device, unsigned int poll_delay)
 
 	if (reg_dev->reserved.exclusive_context)
 		kfree(device->reserved.exclusive_context);
+	else if (reg_dev->device_flags & RTDM_CONTEXT_CACHE)
+		xnobjpool_destroy(&reg_dev->reserved.context_pool);
 
 	return 0;
 }
@@ -495,6 +518,9 @@ int __init rtdm_dev_init(void)
 	for (i = 0; i < protocol_hashtab_size; i++)
 		INIT_LIST_HEAD(&rtdm_protocol_devices[i]);
 
+	xnlock_stat_attach(&rt_dev_lock, "rt_dev_lock");
+	xnlock_stat_attach(&rt_fildes_lock, "rt_fildes_lock");
+
 	return 0;
 
 err_out2:
@@ -512,6 +538,8 @@ void rtdm_dev_cleanup(void)
 	 * Note: no need to flush the cleanup_queue as no device is allowed
 	 * to deregister as long as there are references.
 	 */
+	xnlock_stat_detach(&rt_fildes_lock);
+	xnlock_stat_detach(&rt_dev_lock);
 	rthal_apc_free(rtdm_apc);
 	kfree(rtdm_named_devices);
 	kfree(rtdm_protocol_devices);
@@ -41,6 +41,8 @@
 
 #include <rtdm/rtdm_driver.h>
 
+#include "rtdm/internal.h"
+
 /*!
  * @ingroup driverapi
  * @defgroup clock Clock Services
@@ -108,37 +110,10 @@ nanosecs_abs_t rtdm_clock_read_monotonic(void);
  * @{
  */
 
-/**
- * @brief Intialise and start a real-time task
- *
- * After initialising a task, the task handle remains valid and can be passed
- * to RTDM services until either rtdm_task_destroy() or rtdm_task_join_nrt()
- * was invoked.
- *
- * @param[in,out] task Task handle
- * @param[in] name Optional task name
- * @param[in] task_proc Procedure to be executed by the task
- * @param[in] arg Custom argument passed to @c task_proc() on entry
- * @param[in] priority Priority of the task, see also
- * @ref taskprio "Task Priority Range"
- * @param[in] period Period in nanoseconds of a cyclic task, 0 for non-cyclic
- * mode
- *
- * @return 0 on success, otherwise negative error code
- *
- * Environments:
- *
- * This service can be called from:
- *
- * - Kernel module initialization/cleanup code
- * - Kernel-based task
- * - User-space task (RT, non-RT)
- *
- * Rescheduling: possible.
- */
-int rtdm_task_init(rtdm_task_t *task, const char *name,
-		   rtdm_task_proc_t task_proc, void *arg,
-		   int priority, nanosecs_rel_t period)
+static int __rtdm_task_init(rtdm_task_t *task, const char *name,
+			    rtdm_task_proc_t task_proc, void *arg,
+			    int priority, nanosecs_rel_t period,
+			    xnarch_cpumask_t affinity)
 {
 	union xnsched_policy_param param;
 	struct xnthread_start_attr sattr;
@@ -172,7 +147,7 @@ int rtdm_task_init(rtdm_task_t *task, const char *name,
 
 	sattr.mode = 0;
 	sattr.imask = 0;
-	sattr.affinity = XNPOD_ALL_CPUS;
+	sattr.affinity = affinity;
 	sattr.entry = task_proc;
 	sattr.cookie = arg;
 	err = xnpod_start_thread(task, &sattr);
@@ -186,8 +161,86 @@ int rtdm_task_init(rtdm_task_t *task, const char *name,
 	return err;
 }
 
+/**
+ * @brief Intialise and start a real-time task
+ *
+ * After initialising a task, the task handle remains valid and can be passed
+ * to RTDM services until either rtdm_task_destroy() or rtdm_task_join_nrt()
+ * was invoked.
+ *
+ * @param[in,out] task Task handle
+ * @param[in] name Optional task name
+ * @param[in] task_proc Procedure to be executed by the task
+ * @param[in] arg Custom argument passed to @c task_proc() on entry
+ * @param[in] priority Priority of the task, see also
+ * @ref taskprio "Task Priority Range"
+ * @param[in] period Period in nanoseconds of a cyclic task, 0 for non-cyclic
+ * mode
+ *
+ * @return 0 on success, otherwise negative error code
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: possible.
+ */
+int rtdm_task_init(rtdm_task_t *task, const char *name,
+		   rtdm_task_proc_t task_proc, void *arg,
+		   int priority, nanosecs_rel_t period)
+{
+	return __rtdm_task_init(task, name, task_proc, arg, priority, period,
+				XNPOD_ALL_CPUS);
+}
+
 EXPORT_SYMBOL_GPL(rtdm_task_init);
 
+/**
+ * @brief Intialise and start a real-time task on a given CPU
+ *
+ * Same as rtdm_task_init(), except that the task is bound to @a cpu
+ * for its whole lifetime.
+ *
+ * @param[in,out] task Task handle
+ * @param[in] name Optional task name
+ * @param[in] task_proc Procedure to be executed by the task
+ * @param[in] arg Custom argument passed to @c task_proc() on entry
+ * @param[in] priority Priority of the task, see also
+ * @ref taskprio "Task Priority Range"
+ * @param[in] period Period in nanoseconds of a cyclic task, 0 for non-cyclic
+ * mode
+ * @param[in] cpu CPU the task runs on
+ *
+ * @return 0 on success, otherwise negative error code, -EINVAL if @a cpu
+ * is not available to real-time tasks
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: possible.
+ */
+int rtdm_task_init_cpu(rtdm_task_t *task, const char *name,
+		       rtdm_task_proc_t task_proc, void *arg,
+		       int priority, nanosecs_rel_t period, int cpu)
+{
+	if (cpu < 0 || cpu >= XNARCH_NR_CPUS || !xnarch_cpu_supported(cpu))
+		return -EINVAL;
+
+	return __rtdm_task_init(task, name, task_proc, arg, priority, period,
+				xnarch_cpumask_of_cpu(cpu));
+}
+
+EXPORT_SYMBOL_GPL(rtdm_task_init_cpu);
+
 #ifdef DOXYGEN_CPP /* Only used for doxygen doc generation */
 /**
  * @brief Destroy a real-time task
@@ -649,112 +702,192 @@ int rtdm_timer_start_in_handler(rtdm_timer_t *timer, nanosecs_abs_t expiry,
  * Rescheduling: never.
  */
 void rtdm_timer_stop_in_handler(rtdm_timer_t *timer);
-#endif /* DOXYGEN_CPP */
-/** @} */
 
-/* --- IPC cleanup helper --- */
+/**
+ * @brief Allow a timer to elapse late
+ *
+ * Lets the nucleus fire the timer up to @a slack nanoseconds after
+ * its expiry date, so that it can share a timer interrupt with other
+ * timers due shortly after. The slack is capped by the nucleus
+ * coalescing window and applies from the next call to
+ * rtdm_timer_start(). Use this for timers which are not
+ * latency-critical only.
+ *
+ * @param[in,out] timer Timer handle as returned by rtdm_timer_init()
+ * @param[in] slack Tolerated delay in nanoseconds, 0 for none
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+void rtdm_timer_set_slack(rtdm_timer_t *timer, nanosecs_rel_t slack);
+#endif /* DOXYGEN_CPP */
 
-#define RTDM_SYNCH_DELETED          XNSYNCH_SPARE0
+/*
+ * Timer groups. A single nucleus timer drives all the members of a
+ * group, which share the group period and are kept sorted by phase.
+ * The group timer is programmed for the next member due; when it
+ * fires, every member whose date has passed is dispatched, so that
+ * members with identical or close phases cost a single shot and a
+ * single timer queue operation per cycle.
+ */
 
-void __rtdm_synch_flush(xnsynch_t *synch, unsigned long reason)
+/* Find the first member due in the rest of the current cycle. */
+static void __rtdm_group_seek(rtdm_timer_group_t *group) /* nklock held */
 {
-	spl_t s;
-
-	xnlock_get_irqsave(&nklock, s);
+	xnholder_t *h;
 
-	if (reason == XNRMID)
-		xnsynch_set_flags(synch, RTDM_SYNCH_DELETED);
-
-	if (likely(xnsynch_flush(synch, reason) == XNSYNCH_RESCHED))
-		xnpod_schedule();
+	for (h = getheadq(&group->members); h; h = nextq(&group->members, h))
+		if (link2gtimer(h)->phase > group->pos)
+			break;
 
-	xnlock_put_irqrestore(&nklock, s);
+	group->cursor = h;
 }
 
-EXPORT_SYMBOL_GPL(__rtdm_synch_flush);
+/* Program the group timer for the next member due. */
+static void __rtdm_group_arm(rtdm_timer_group_t *group) /* nklock held */
+{
+	nanosecs_abs_t date;
+	xnholder_t *h;
 
-/*!
- * @ingroup driverapi
- * @defgroup rtdmsync Synchronisation Services
- * @{
- */
+	if (!(group->status & RTDM_TGROUP_RUNNING) ||
+	    emptyq_p(&group->members)) {
+		xntimer_stop(&group->master);
+		return;
+	}
 
-/*!
- * @name Timeout Sequence Management
- * @{
- */
+	h = group->cursor;
+	if (h == NULL) {
+		/* Every member ran in this cycle, move to the next one. */
+		group->cycle += group->period;
+		group->pos = -1;
+		h = group->cursor = getheadq(&group->members);
+	}
 
-/**
- * @brief Initialise a timeout sequence
- *
- * This service initialises a timeout sequence handle according to the given
- * timeout value. Timeout sequences allow to maintain a continuous @a timeout
- * across multiple calls of blocking synchronisation services. A typical
- * application scenario is given below.
- *
- * @param[in,out] timeout_seq Timeout sequence handle
- * @param[in] timeout Relative timeout in nanoseconds, see
- * @ref RTDM_TIMEOUT_xxx for special values
- *
- * Application Scenario:
- * @code
-int device_service_routine(...)
+	date = group->cycle + link2gtimer(h)->phase;
+	if (xntimer_start(&group->master,
+			  xntbase_ns2ticks_ceil(rtdm_tbase, date),
+			  XN_INFINITE, XN_ABSOLUTE))
+		/* Already due, fire as soon as possible. */
+		xntimer_start(&group->master, 0, XN_INFINITE, XN_RELATIVE);
+}
+
+static void __rtdm_group_handler(xntimer_t *timer) /* nklock held */
 {
-	rtdm_toseq_t timeout_seq;
-	...
+	rtdm_timer_group_t *group =
+		container_of(timer, rtdm_timer_group_t, master);
+	rtdm_group_timer_t *member;
+	nanosecs_abs_t now, date;
+	unsigned long long n;
+
+	group->stats.ticks++;
+	group->status |= RTDM_TGROUP_DISPATCH;
+	now = rtdm_clock_read_monotonic();
+
+	for (;;) {
+		if (group->cursor == NULL) {
+			if (emptyq_p(&group->members))
+				break;
+			/*
+			 * Cycle over; skip the cycles which have
+			 * entirely elapsed meanwhile, if any.
+			 */
+			n = xnarch_div64(now - group->cycle, group->period);
+			if (n > 1) {
+				group->stats.overruns += n - 1;
+				group->cycle += (n - 1) * group->period;
+			}
+			group->cycle += group->period;
+			group->pos = -1;
+			group->cursor = getheadq(&group->members);
+		}
 
-	rtdm_toseq_init(&timeout_seq, timeout);
-	...
-	while (received < requested) {
-		ret = rtdm_event_timedwait(&data_available, timeout, &timeout_seq);
-		if (ret < 0) // including -ETIMEDOUT
+		member = link2gtimer(group->cursor);
+		date = group->cycle + member->phase;
+		if (date > now)
 			break;
 
-		// receive some data
-		...
+		/*
+		 * The handler may stop or start members, which
+		 * repositions the cursor past the current phase.
+		 */
+		group->pos = member->phase;
+		group->cursor = nextq(&group->members, &member->link);
+		if (now - date > group->stats.maxlate)
+			group->stats.maxlate = now - date;
+		group->stats.fired++;
+		member->handler(member);
 	}
-	...
+
+	group->status &= ~RTDM_TGROUP_DISPATCH;
+	__rtdm_group_arm(group);
 }
- * @endcode
- * Using a timeout sequence in such a scenario avoids that the user-provided
- * relative @c timeout is restarted on every call to rtdm_event_timedwait(),
- * potentially causing an overall delay that is larger than specified by
- * @c timeout. Moreover, all functions supporting timeout sequences also
- * interpret special timeout values (infinite and non-blocking),
- * disburdening the driver developer from handling them separately.
+
+/**
+ * @brief Initialise a timer group
+ *
+ * A timer group runs the handlers of its member timers periodically,
+ * each at a fixed phase within the common period, out of a single
+ * nucleus timer. Members started with the same or close phases are
+ * dispatched by the same timer shot.
+ *
+ * @param[in,out] group Timer group handle
+ * @param[in] period Period shared by the members, in nanoseconds
+ * @param[in] slack Tolerated dispatch delay, allowing members with
+ * close phases to be dispatched together; 0 for none (see
+ * rtdm_timer_set_slack())
+ * @param[in] name Optional group name
+ *
+ * @return 0 on success, otherwise:
+ *
+ * - -EINVAL is returned if @a period is not positive.
  *
  * Environments:
  *
  * This service can be called from:
  *
+ * - Kernel module initialization/cleanup code
  * - Kernel-based task
- * - User-space task (RT)
+ * - User-space task (RT, non-RT)
  *
  * Rescheduling: never.
  */
-void rtdm_toseq_init(rtdm_toseq_t *timeout_seq, nanosecs_rel_t timeout)
+int rtdm_timer_group_init(rtdm_timer_group_t *group, nanosecs_rel_t period,
+			  nanosecs_rel_t slack, const char *name)
 {
-	xntbase_t *base = xnthread_time_base(xnpod_current_thread());
+	if (period <= 0)
+		return -EINVAL;
+
+	xntimer_init(&group->master, rtdm_tbase, __rtdm_group_handler);
+	xntimer_set_name(&group->master, name);
+	xntimer_set_slack(&group->master, slack);
+	initq(&group->members);
+	group->cursor = NULL;
+	group->period = period;
+	group->cycle = 0;
+	group->pos = -1;
+	group->status = 0;
+	memset(&group->stats, 0, sizeof(group->stats));
 
-	XENO_ASSERT(RTDM, !xnpod_unblockable_p(), /* only warn here */;);
-
-	*timeout_seq =
-	    xntbase_get_jiffies(base) + xntbase_ns2ticks_ceil(base, timeout);
+	return 0;
 }
 
-EXPORT_SYMBOL_GPL(rtdm_toseq_init);
-/** @} */
-
-/*!
- * @name Event Services
- * @{
- */
+EXPORT_SYMBOL_GPL(rtdm_timer_group_init);
 
 /**
- * @brief Initialise an event
+ * @brief Destroy a timer group
  *
- * @param[in,out] event Event handle
- * @param[in] pending Non-zero if event shall be initialised as set, 0 otherwise
+ * The members still started are stopped.
+ *
+ * @param[in,out] group Timer group handle as passed to
+ * rtdm_timer_group_init()
  *
  * Environments:
  *
@@ -766,52 +899,77 @@ EXPORT_SYMBOL_GPL(rtdm_toseq_init);
  *
  * Rescheduling: never.
  */
-void rtdm_event_init(rtdm_event_t *event, unsigned long pending)
+void rtdm_timer_group_destroy(rtdm_timer_group_t *group)
 {
+	xnholder_t *h;
 	spl_t s;
 
-	trace_mark(xn_rtdm, event_init,
-		   "event %p pending %lu", event, pending);
-
-	/* Make atomic for re-initialisation support */
 	xnlock_get_irqsave(&nklock, s);
-
-	xnsynch_init(&event->synch_base, XNSYNCH_PRIO, NULL);
-	if (pending)
-		xnsynch_set_flags(&event->synch_base, RTDM_EVENT_PENDING);
-	xnselect_init(&event->select_block);
-
+	xntimer_destroy(&group->master);
+	while ((h = getq(&group->members)) != NULL)
+		link2gtimer(h)->group = NULL;
+	group->cursor = NULL;
+	group->status = 0;
 	xnlock_put_irqrestore(&nklock, s);
 }
 
-EXPORT_SYMBOL_GPL(rtdm_event_init);
+EXPORT_SYMBOL_GPL(rtdm_timer_group_destroy);
 
-#ifdef DOXYGEN_CPP /* Only used for doxygen doc generation */
 /**
- * @brief Destroy an event
+ * @brief Start a timer group
  *
- * @param[in,out] event Event handle as returned by rtdm_event_init()
+ * @param[in,out] group Timer group handle as passed to
+ * rtdm_timer_group_init()
+ * @param[in] start Absolute monotonic date of the first cycle, each
+ * member being first dispatched at @a start plus its phase
+ *
+ * @return 0 on success, otherwise:
+ *
+ * - -EBUSY is returned if the group is already running.
  *
  * Environments:
  *
  * This service can be called from:
  *
  * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
  * - Kernel-based task
  * - User-space task (RT, non-RT)
  *
- * Rescheduling: possible.
+ * Rescheduling: never.
  */
-void rtdm_event_destroy(rtdm_event_t *event);
+int rtdm_timer_group_start(rtdm_timer_group_t *group, nanosecs_abs_t start)
+{
+	int ret = 0;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (group->status & RTDM_TGROUP_RUNNING)
+		ret = -EBUSY;
+	else {
+		group->status |= RTDM_TGROUP_RUNNING;
+		group->cycle = start;
+		group->pos = -1;
+		group->cursor = getheadq(&group->members);
+		__rtdm_group_arm(group);
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+
+EXPORT_SYMBOL_GPL(rtdm_timer_group_start);
 
 /**
- * @brief Signal an event occurrence to currently listening waiters
+ * @brief Stop a timer group
  *
- * This function wakes up all current waiters of the given event, but it does
- * not change the event state. Subsequently callers of rtdm_event_wait() or
- * rtdm_event_timedwait() will therefore be blocked first.
+ * The members remain attached to the group, and are dispatched again
+ * after the group is restarted.
  *
- * @param[in,out] event Event handle as returned by rtdm_event_init()
+ * @param[in,out] group Timer group handle as passed to
+ * rtdm_timer_group_init()
  *
  * Environments:
  *
@@ -822,19 +980,26 @@ void rtdm_event_destroy(rtdm_event_t *event);
  * - Kernel-based task
  * - User-space task (RT, non-RT)
  *
- * Rescheduling: possible.
+ * Rescheduling: never.
  */
-void rtdm_event_pulse(rtdm_event_t *event);
-#endif /* DOXYGEN_CPP */
+void rtdm_timer_group_stop(rtdm_timer_group_t *group)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	group->status &= ~RTDM_TGROUP_RUNNING;
+	xntimer_stop(&group->master);
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+EXPORT_SYMBOL_GPL(rtdm_timer_group_stop);
 
 /**
- * @brief Signal an event occurrence
+ * @brief Read the statistics of a timer group
  *
- * This function sets the given event and wakes up all current waiters. If no
- * waiter is presently registered, the next call to rtdm_event_wait() or
- * rtdm_event_timedwait() will return immediately.
- *
- * @param[in,out] event Event handle as returned by rtdm_event_init()
+ * @param[in] group Timer group handle as passed to
+ * rtdm_timer_group_init()
+ * @param[out] stats Statistics snapshot
  *
  * Environments:
  *
@@ -845,170 +1010,127 @@ void rtdm_event_pulse(rtdm_event_t *event);
  * - Kernel-based task
  * - User-space task (RT, non-RT)
  *
- * Rescheduling: possible.
+ * Rescheduling: never.
  */
-void rtdm_event_signal(rtdm_event_t *event)
+void rtdm_timer_group_get_stats(rtdm_timer_group_t *group,
+				struct rtdm_timer_group_stats *stats)
 {
-	int resched = 0;
 	spl_t s;
 
-	trace_mark(xn_rtdm, event_signal, "event %p", event);
-
 	xnlock_get_irqsave(&nklock, s);
-
-	xnsynch_set_flags(&event->synch_base, RTDM_EVENT_PENDING);
-	if (xnsynch_flush(&event->synch_base, 0))
-		resched = 1;
-	if (xnselect_signal(&event->select_block, 1))
-		resched = 1;
-	if (resched)
-		xnpod_schedule();
-
+	*stats = group->stats;
 	xnlock_put_irqrestore(&nklock, s);
 }
 
-EXPORT_SYMBOL_GPL(rtdm_event_signal);
+EXPORT_SYMBOL_GPL(rtdm_timer_group_get_stats);
 
 /**
- * @brief Wait on event occurrence
- *
- * This is the light-weight version of rtdm_event_timedwait(), implying an
- * infinite timeout.
- *
- * @param[in,out] event Event handle as returned by rtdm_event_init()
- *
- * @return 0 on success, otherwise:
- *
- * - -EINTR is returned if calling task has been unblock by a signal or
- * explicitly via rtdm_task_unblock().
+ * @brief Initialise a group timer
  *
- * - -EIDRM is returned if @a event has been destroyed.
- *
- * - -EPERM @e may be returned if an illegal invocation environment is
- * detected.
+ * @param[in,out] timer Group timer handle
+ * @param[in] handler Handler to be called on each dispatch
  *
  * Environments:
  *
  * This service can be called from:
  *
+ * - Kernel module initialization/cleanup code
  * - Kernel-based task
- * - User-space task (RT)
+ * - User-space task (RT, non-RT)
  *
- * Rescheduling: possible.
+ * Rescheduling: never.
  */
-int rtdm_event_wait(rtdm_event_t *event)
+void rtdm_group_timer_init(rtdm_group_timer_t *timer,
+			   rtdm_group_timer_handler_t handler)
 {
-	return rtdm_event_timedwait(event, 0, NULL);
+	inith(&timer->link);
+	timer->group = NULL;
+	timer->phase = 0;
+	timer->handler = handler;
 }
 
-EXPORT_SYMBOL_GPL(rtdm_event_wait);
+EXPORT_SYMBOL_GPL(rtdm_group_timer_init);
 
 /**
- * @brief Wait on event occurrence with timeout
+ * @brief Start a group timer
  *
- * This function waits or tests for the occurence of the given event, taking
- * the provided timeout into account. On successful return, the event is
- * reset.
+ * Attaches the timer to @a group, which dispatches it once per
+ * period, @a phase nanoseconds after the beginning of each cycle. A
+ * timer started while its group runs is first dispatched in the
+ * current cycle if its phase is still ahead, in the next cycle
+ * otherwise.
  *
- * @param[in,out] event Event handle as returned by rtdm_event_init()
- * @param[in] timeout Relative timeout in nanoseconds, see
- * @ref RTDM_TIMEOUT_xxx for special values
- * @param[in,out] timeout_seq Handle of a timeout sequence as returned by
- * rtdm_toseq_init() or NULL
+ * @param[in,out] timer Group timer handle as passed to
+ * rtdm_group_timer_init()
+ * @param[in,out] group Timer group handle as passed to
+ * rtdm_timer_group_init()
+ * @param[in] phase Dispatch offset within the period
  *
  * @return 0 on success, otherwise:
  *
- * - -ETIMEDOUT is returned if the if the request has not been satisfied
- * within the specified amount of time.
- *
- * - -EINTR is returned if calling task has been unblock by a signal or
- * explicitly via rtdm_task_unblock().
- *
- * - -EIDRM is returned if @a event has been destroyed.
- *
- * - -EPERM @e may be returned if an illegal invocation environment is
- * detected.
+ * - -EINVAL is returned if @a phase is not within the group period.
  *
- * - -EWOULDBLOCK is returned if a negative @a timeout (i.e., non-blocking
- * operation) has been specified.
+ * - -EBUSY is returned if @a timer is already started.
  *
  * Environments:
  *
  * This service can be called from:
  *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Timer handler
  * - Kernel-based task
- * - User-space task (RT)
+ * - User-space task (RT, non-RT)
  *
- * Rescheduling: possible.
+ * Rescheduling: never.
  */
-int rtdm_event_timedwait(rtdm_event_t *event, nanosecs_rel_t timeout,
-			 rtdm_toseq_t *timeout_seq)
+int rtdm_group_timer_start(rtdm_group_timer_t *timer,
+			   rtdm_timer_group_t *group, nanosecs_rel_t phase)
 {
-	xnthread_t *thread;
+	xnholder_t *h;
+	int ret = 0;
 	spl_t s;
-	int err = 0;
-
-	XENO_ASSERT(RTDM, !xnpod_unblockable_p(), return -EPERM;);
 
-	trace_mark(xn_rtdm, event_timedwait,
-		   "event %p timeout %Lu timeout_seq %p timeout_seq_value %Lu",
-		   event, (long long)timeout, timeout_seq, (long long)(timeout_seq ? *timeout_seq : 0));
+	if (phase < 0 || phase >= group->period)
+		return -EINVAL;
 
 	xnlock_get_irqsave(&nklock, s);
 
-	if (unlikely(xnsynch_test_flags(&event->synch_base,
-					RTDM_SYNCH_DELETED)))
-		err = -EIDRM;
-	else if (likely(xnsynch_test_flags(&event->synch_base,
-					   RTDM_EVENT_PENDING))) {
-		xnsynch_clear_flags(&event->synch_base, RTDM_EVENT_PENDING);
-		xnselect_signal(&event->select_block, 0);
-	} else {
-		/* non-blocking mode */
-		if (timeout < 0) {
-			err = -EWOULDBLOCK;
-			goto unlock_out;
-		}
+	if (timer->group) {
+		ret = -EBUSY;
+		goto unlock_and_exit;
+	}
 
-		thread = xnpod_current_thread();
+	timer->group = group;
+	timer->phase = phase;
 
-		if (timeout_seq && (timeout > 0)) {
-			/* timeout sequence */
-			xnsynch_sleep_on(&event->synch_base, *timeout_seq,
-					 XN_ABSOLUTE);
-		} else {
-			/* infinite or relative timeout */
-			xnsynch_sleep_on(&event->synch_base,
-					 xntbase_ns2ticks_ceil
-					 (xnthread_time_base(thread), timeout),
-					 XN_RELATIVE);
-		}
+	/* Keep the members sorted by phase, FIFO among equals. */
+	for (h = getheadq(&group->members); h; h = nextq(&group->members, h))
+		if (link2gtimer(h)->phase > phase)
+			break;
+	if (h)
+		insertq(&group->members, h, &timer->link);
+	else
+		appendq(&group->members, &timer->link);
 
-		if (likely
-		    (!xnthread_test_info(thread, XNTIMEO | XNRMID | XNBREAK))) {
-			xnsynch_clear_flags(&event->synch_base,
-					    RTDM_EVENT_PENDING);
-			xnselect_signal(&event->select_block, 0);
-		} else if (xnthread_test_info(thread, XNTIMEO))
-			err = -ETIMEDOUT;
-		else if (xnthread_test_info(thread, XNRMID))
-			err = -EIDRM;
-		else /* XNBREAK */
-			err = -EINTR;
-	}
+	__rtdm_group_seek(group);
+	if (!(group->status & RTDM_TGROUP_DISPATCH))
+		__rtdm_group_arm(group);
+
+      unlock_and_exit:
 
-unlock_out:
 	xnlock_put_irqrestore(&nklock, s);
 
-	return err;
+	return ret;
 }
 
-EXPORT_SYMBOL_GPL(rtdm_event_timedwait);
+EXPORT_SYMBOL_GPL(rtdm_group_timer_start);
 
 /**
- * @brief Clear event state
+ * @brief Stop a group timer
  *
- * @param[in,out] event Event handle as returned by rtdm_event_init()
+ * @param[in,out] timer Group timer handle as passed to
+ * rtdm_group_timer_init()
  *
  * Environments:
  *
@@ -1016,96 +1138,141 @@ EXPORT_SYMBOL_GPL(rtdm_event_timedwait);
  *
  * - Kernel module initialization/cleanup code
  * - Interrupt service routine
+ * - Timer handler
  * - Kernel-based task
  * - User-space task (RT, non-RT)
  *
  * Rescheduling: never.
  */
-void rtdm_event_clear(rtdm_event_t *event)
+void rtdm_group_timer_stop(rtdm_group_timer_t *timer)
 {
+	rtdm_timer_group_t *group;
 	spl_t s;
 
-	trace_mark(xn_rtdm, event_clear, "event %p", event);
+	xnlock_get_irqsave(&nklock, s);
+
+	group = timer->group;
+	if (group == NULL)
+		goto unlock_and_exit;
+
+	removeq(&group->members, &timer->link);
+	timer->group = NULL;
+
+	__rtdm_group_seek(group);
+	if (!(group->status & RTDM_TGROUP_DISPATCH))
+		__rtdm_group_arm(group);
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+EXPORT_SYMBOL_GPL(rtdm_group_timer_stop);
+/** @} */
+
+/* --- IPC cleanup helper --- */
+
+#define RTDM_SYNCH_DELETED          XNSYNCH_SPARE0
+
+void __rtdm_synch_flush(xnsynch_t *synch, unsigned long reason)
+{
+	spl_t s;
 
 	xnlock_get_irqsave(&nklock, s);
 
-	xnsynch_clear_flags(&event->synch_base, RTDM_EVENT_PENDING);
-	xnselect_signal(&event->select_block, 0);
+	if (reason == XNRMID)
+		xnsynch_set_flags(synch, RTDM_SYNCH_DELETED);
+
+	if (likely(xnsynch_flush(synch, reason) == XNSYNCH_RESCHED))
+		xnpod_schedule();
 
 	xnlock_put_irqrestore(&nklock, s);
 }
 
-EXPORT_SYMBOL_GPL(rtdm_event_clear);
+EXPORT_SYMBOL_GPL(__rtdm_synch_flush);
+
+/*!
+ * @ingroup driverapi
+ * @defgroup rtdmsync Synchronisation Services
+ * @{
+ */
+
+/*!
+ * @name Timeout Sequence Management
+ * @{
+ */
 
-#ifdef CONFIG_XENO_OPT_RTDM_SELECT
 /**
- * @brief Bind a selector to an event
- *
- * This functions binds the given selector to an event so that the former is
- * notified when the event state changes. Typically the select binding handler
- * will invoke this service.
- *
- * @param[in,out] event Event handle as returned by rtdm_event_init()
- * @param[in,out] selector Selector as passed to the select binding handler
- * @param[in] type Type of the bound event as passed to the select binding handler
- * @param[in] fd_index File descriptor index as passed to the select binding
- * handler
+ * @brief Initialise a timeout sequence
  *
- * @return 0 on success, otherwise:
+ * This service initialises a timeout sequence handle according to the given
+ * timeout value. Timeout sequences allow to maintain a continuous @a timeout
+ * across multiple calls of blocking synchronisation services. A typical
+ * application scenario is given below.
  *
- * - -ENOMEM is returned if there is insufficient memory to establish the
- * dynamic binding.
+ * @param[in,out] timeout_seq Timeout sequence handle
+ * @param[in] timeout Relative timeout in nanoseconds, see
+ * @ref RTDM_TIMEOUT_xxx for special values
  *
- * - -EINVAL is returned if @a type or @a fd_index are invalid.
+ * Application Scenario:
+ * @code
+int device_service_routine(...)
+{
+	rtdm_toseq_t timeout_seq;
+	...
+
+	rtdm_toseq_init(&timeout_seq, timeout);
+	...
+	while (received < requested) {
+		ret = rtdm_event_timedwait(&data_available, timeout, &timeout_seq);
+		if (ret < 0) // including -ETIMEDOUT
+			break;
+
+		// receive some data
+		...
+	}
+	...
+}
+ * @endcode
+ * Using a timeout sequence in such a scenario avoids that the user-provided
+ * relative @c timeout is restarted on every call to rtdm_event_timedwait(),
+ * potentially causing an overall delay that is larger than specified by
+ * @c timeout. Moreover, all functions supporting timeout sequences also
+ * interpret special timeout values (infinite and non-blocking),
+ * disburdening the driver developer from handling them separately.
  *
  * Environments:
  *
  * This service can be called from:
  *
- * - Kernel module initialization/cleanup code
  * - Kernel-based task
- * - User-space task (RT, non-RT)
+ * - User-space task (RT)
  *
  * Rescheduling: never.
  */
-int rtdm_event_select_bind(rtdm_event_t *event, rtdm_selector_t *selector,
-			   enum rtdm_selecttype type, unsigned fd_index)
+void rtdm_toseq_init(rtdm_toseq_t *timeout_seq, nanosecs_rel_t timeout)
 {
-	struct xnselect_binding *binding;
-	int err;
-	spl_t s;
-
-	binding = xnmalloc(sizeof(*binding));
-	if (!binding)
-		return -ENOMEM;
-
-	xnlock_get_irqsave(&nklock, s);
-	err = xnselect_bind(&event->select_block,
-			    binding, selector, type, fd_index,
-			    xnsynch_test_flags(&event->synch_base,
-					       RTDM_SYNCH_DELETED |
-					       RTDM_EVENT_PENDING));
-	xnlock_put_irqrestore(&nklock, s);
+	xntbase_t *base = xnthread_time_base(xnpod_current_thread());
 
-	if (err)
-		xnfree(binding);
+	XENO_ASSERT(RTDM, !xnpod_unblockable_p(), /* only warn here */;);
 
-	return err;
+	*timeout_seq =
+	    xntbase_get_jiffies(base) + xntbase_ns2ticks_ceil(base, timeout);
 }
-EXPORT_SYMBOL_GPL(rtdm_event_select_bind);
-#endif /* CONFIG_XENO_OPT_RTDM_SELECT */
+
+EXPORT_SYMBOL_GPL(rtdm_toseq_init);
 /** @} */
 
 /*!
- * @name Semaphore Services
+ * @name Event Services
  * @{
  */
 
 /**
- * @brief Initialise a semaphore
+ * @brief Initialise an event
  *
- * @param[in,out] sem Semaphore handle
- * @param[in] value Initial value of the semaphore
+ * @param[in,out] event Event handle
+ * @param[in] pending Non-zero if event shall be initialised as set, 0 otherwise
  *
  * Environments:
  *
@@ -1117,29 +1284,31 @@ EXPORT_SYMBOL_GPL(rtdm_event_select_bind);
  *
  * Rescheduling: never.
  */
-void rtdm_sem_init(rtdm_sem_t *sem, unsigned long value)
+void rtdm_event_init(rtdm_event_t *event, unsigned long pending)
 {
 	spl_t s;
 
-	trace_mark(xn_rtdm, sem_init, "sem %p value %lu", sem, value);
+	trace_mark(xn_rtdm, event_init,
+		   "event %p pending %lu", event, pending);
 
 	/* Make atomic for re-initialisation support */
 	xnlock_get_irqsave(&nklock, s);
 
-	sem->value = value;
-	xnsynch_init(&sem->synch_base, XNSYNCH_PRIO, NULL);
-	xnselect_init(&sem->select_block);
+	xnsynch_init(&event->synch_base, XNSYNCH_PRIO, NULL);
+	if (pending)
+		xnsynch_set_flags(&event->synch_base, RTDM_EVENT_PENDING);
+	xnselect_init(&event->select_block);
 
 	xnlock_put_irqrestore(&nklock, s);
 }
 
-EXPORT_SYMBOL_GPL(rtdm_sem_init);
+EXPORT_SYMBOL_GPL(rtdm_event_init);
 
 #ifdef DOXYGEN_CPP /* Only used for doxygen doc generation */
 /**
- * @brief Destroy a semaphore
+ * @brief Destroy an event
  *
- * @param[in,out] sem Semaphore handle as returned by rtdm_sem_init()
+ * @param[in,out] event Event handle as returned by rtdm_event_init()
  *
  * Environments:
  *
@@ -1151,23 +1320,87 @@ EXPORT_SYMBOL_GPL(rtdm_sem_init);
  *
  * Rescheduling: possible.
  */
-void rtdm_sem_destroy(rtdm_sem_t *sem);
+void rtdm_event_destroy(rtdm_event_t *event);
+
+/**
+ * @brief Signal an event occurrence to currently listening waiters
+ *
+ * This function wakes up all current waiters of the given event, but it does
+ * not change the event state. Subsequently callers of rtdm_event_wait() or
+ * rtdm_event_timedwait() will therefore be blocked first.
+ *
+ * @param[in,out] event Event handle as returned by rtdm_event_init()
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: possible.
+ */
+void rtdm_event_pulse(rtdm_event_t *event);
 #endif /* DOXYGEN_CPP */
 
 /**
- * @brief Decrement a semaphore
+ * @brief Signal an event occurrence
  *
- * This is the light-weight version of rtdm_sem_timeddown(), implying an
+ * This function sets the given event and wakes up all current waiters. If no
+ * waiter is presently registered, the next call to rtdm_event_wait() or
+ * rtdm_event_timedwait() will return immediately.
+ *
+ * @param[in,out] event Event handle as returned by rtdm_event_init()
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: possible.
+ */
+void rtdm_event_signal(rtdm_event_t *event)
+{
+	int resched = 0;
+	spl_t s;
+
+	trace_mark(xn_rtdm, event_signal, "event %p", event);
+
+	xnlock_get_irqsave(&nklock, s);
+
+	xnsynch_set_flags(&event->synch_base, RTDM_EVENT_PENDING);
+	if (xnsynch_flush(&event->synch_base, 0))
+		resched = 1;
+	if (xnselect_signal(&event->select_block, 1))
+		resched = 1;
+	if (resched)
+		xnpod_schedule();
+
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+EXPORT_SYMBOL_GPL(rtdm_event_signal);
+
+/**
+ * @brief Wait on event occurrence
+ *
+ * This is the light-weight version of rtdm_event_timedwait(), implying an
  * infinite timeout.
  *
- * @param[in,out] sem Semaphore handle as returned by rtdm_sem_init()
+ * @param[in,out] event Event handle as returned by rtdm_event_init()
  *
  * @return 0 on success, otherwise:
  *
  * - -EINTR is returned if calling task has been unblock by a signal or
  * explicitly via rtdm_task_unblock().
  *
- * - -EIDRM is returned if @a sem has been destroyed.
+ * - -EIDRM is returned if @a event has been destroyed.
  *
  * - -EPERM @e may be returned if an illegal invocation environment is
  * detected.
@@ -1181,21 +1414,21 @@ void rtdm_sem_destroy(rtdm_sem_t *sem);
  *
  * Rescheduling: possible.
  */
-int rtdm_sem_down(rtdm_sem_t *sem)
+int rtdm_event_wait(rtdm_event_t *event)
 {
-	return rtdm_sem_timeddown(sem, 0, NULL);
+	return rtdm_event_timedwait(event, 0, NULL);
 }
 
-EXPORT_SYMBOL_GPL(rtdm_sem_down);
+EXPORT_SYMBOL_GPL(rtdm_event_wait);
 
 /**
- * @brief Decrement a semaphore with timeout
+ * @brief Wait on event occurrence with timeout
  *
- * This function tries to decrement the given semphore's value if it is
- * positive on entry. If not, the caller is blocked unless non-blocking
- * operation was selected.
+ * This function waits or tests for the occurence of the given event, taking
+ * the provided timeout into account. On successful return, the event is
+ * reset.
  *
- * @param[in,out] sem Semaphore handle as returned by rtdm_sem_init()
+ * @param[in,out] event Event handle as returned by rtdm_event_init()
  * @param[in] timeout Relative timeout in nanoseconds, see
  * @ref RTDM_TIMEOUT_xxx for special values
  * @param[in,out] timeout_seq Handle of a timeout sequence as returned by
@@ -1206,17 +1439,17 @@ EXPORT_SYMBOL_GPL(rtdm_sem_down);
  * - -ETIMEDOUT is returned if the if the request has not been satisfied
  * within the specified amount of time.
  *
- * - -EWOULDBLOCK is returned if @a timeout is negative and the semaphore
- * value is currently not positive.
- *
  * - -EINTR is returned if calling task has been unblock by a signal or
  * explicitly via rtdm_task_unblock().
  *
- * - -EIDRM is returned if @a sem has been destroyed.
+ * - -EIDRM is returned if @a event has been destroyed.
  *
  * - -EPERM @e may be returned if an illegal invocation environment is
  * detected.
  *
+ * - -EWOULDBLOCK is returned if a negative @a timeout (i.e., non-blocking
+ * operation) has been specified.
+ *
  * Environments:
  *
  * This service can be called from:
@@ -1226,8 +1459,8 @@ EXPORT_SYMBOL_GPL(rtdm_sem_down);
  *
  * Rescheduling: possible.
  */
-int rtdm_sem_timeddown(rtdm_sem_t *sem, nanosecs_rel_t timeout,
-		       rtdm_toseq_t *timeout_seq)
+int rtdm_event_timedwait(rtdm_event_t *event, nanosecs_rel_t timeout,
+			 rtdm_toseq_t *timeout_seq)
 {
 	xnthread_t *thread;
 	spl_t s;
@@ -1235,58 +1468,65 @@ int rtdm_sem_timeddown(rtdm_sem_t *sem, nanosecs_rel_t timeout,
 
 	XENO_ASSERT(RTDM, !xnpod_unblockable_p(), return -EPERM;);
 
-	trace_mark(xn_rtdm, sem_timedwait,
-		   "sem %p timeout %Lu timeout_seq %p timeout_seq_value %Lu",
-		   sem, (long long)timeout, timeout_seq, (long long)(timeout_seq ? *timeout_seq : 0));
+	trace_mark(xn_rtdm, event_timedwait,
+		   "event %p timeout %Lu timeout_seq %p timeout_seq_value %Lu",
+		   event, (long long)timeout, timeout_seq, (long long)(timeout_seq ? *timeout_seq : 0));
 
 	xnlock_get_irqsave(&nklock, s);
 
-	if (unlikely(xnsynch_test_flags(&sem->synch_base, RTDM_SYNCH_DELETED)))
+	if (unlikely(xnsynch_test_flags(&event->synch_base,
+					RTDM_SYNCH_DELETED)))
 		err = -EIDRM;
-	else if (sem->value > 0) {
-		if(!--sem->value)
-			xnselect_signal(&sem->select_block, 0);
-	} else if (timeout < 0) /* non-blocking mode */
-		err = -EWOULDBLOCK;
-	else {
+	else if (likely(xnsynch_test_flags(&event->synch_base,
+					   RTDM_EVENT_PENDING))) {
+		xnsynch_clear_flags(&event->synch_base, RTDM_EVENT_PENDING);
+		xnselect_signal(&event->select_block, 0);
+	} else {
+		/* non-blocking mode */
+		if (timeout < 0) {
+			err = -EWOULDBLOCK;
+			goto unlock_out;
+		}
+
 		thread = xnpod_current_thread();
 
 		if (timeout_seq && (timeout > 0)) {
 			/* timeout sequence */
-			xnsynch_sleep_on(&sem->synch_base, *timeout_seq,
+			xnsynch_sleep_on(&event->synch_base, *timeout_seq,
 					 XN_ABSOLUTE);
 		} else {
 			/* infinite or relative timeout */
-			xnsynch_sleep_on(&sem->synch_base,
+			xnsynch_sleep_on(&event->synch_base,
 					 xntbase_ns2ticks_ceil
 					 (xnthread_time_base(thread), timeout),
 					 XN_RELATIVE);
 		}
 
-		if (xnthread_test_info(thread, XNTIMEO | XNRMID | XNBREAK)) {
-			if (xnthread_test_info(thread, XNTIMEO))
-				err = -ETIMEDOUT;
-			else if (xnthread_test_info(thread, XNRMID))
-				err = -EIDRM;
-			else /* XNBREAK */
-				err = -EINTR;
-		}
+		if (likely
+		    (!xnthread_test_info(thread, XNTIMEO | XNRMID | XNBREAK))) {
+			xnsynch_clear_flags(&event->synch_base,
+					    RTDM_EVENT_PENDING);
+			xnselect_signal(&event->select_block, 0);
+		} else if (xnthread_test_info(thread, XNTIMEO))
+			err = -ETIMEDOUT;
+		else if (xnthread_test_info(thread, XNRMID))
+			err = -EIDRM;
+		else /* XNBREAK */
+			err = -EINTR;
 	}
 
+unlock_out:
 	xnlock_put_irqrestore(&nklock, s);
 
 	return err;
 }
 
-EXPORT_SYMBOL_GPL(rtdm_sem_timeddown);
+EXPORT_SYMBOL_GPL(rtdm_event_timedwait);
 
 /**
- * @brief Increment a semaphore
- *
- * This function increments the given semphore's value, waking up a potential
- * waiter which was blocked upon rtdm_sem_down().
+ * @brief Clear event state
  *
- * @param[in,out] sem Semaphore handle as returned by rtdm_sem_init()
+ * @param[in,out] event Event handle as returned by rtdm_event_init()
  *
  * Environments:
  *
@@ -1297,37 +1537,33 @@ EXPORT_SYMBOL_GPL(rtdm_sem_timeddown);
  * - Kernel-based task
  * - User-space task (RT, non-RT)
  *
- * Rescheduling: possible.
+ * Rescheduling: never.
  */
-void rtdm_sem_up(rtdm_sem_t *sem)
+void rtdm_event_clear(rtdm_event_t *event)
 {
 	spl_t s;
 
-	trace_mark(xn_rtdm, sem_up, "sem %p", sem);
+	trace_mark(xn_rtdm, event_clear, "event %p", event);
 
 	xnlock_get_irqsave(&nklock, s);
 
-	if (xnsynch_wakeup_one_sleeper(&sem->synch_base))
-		xnpod_schedule();
-	else
-		if (sem->value++ == 0
-		    && xnselect_signal(&sem->select_block, 1))
-			xnpod_schedule();
+	xnsynch_clear_flags(&event->synch_base, RTDM_EVENT_PENDING);
+	xnselect_signal(&event->select_block, 0);
 
 	xnlock_put_irqrestore(&nklock, s);
 }
 
-EXPORT_SYMBOL_GPL(rtdm_sem_up);
+EXPORT_SYMBOL_GPL(rtdm_event_clear);
 
 #ifdef CONFIG_XENO_OPT_RTDM_SELECT
 /**
- * @brief Bind a selector to a semaphore
+ * @brief Bind a selector to an event
  *
- * This functions binds the given selector to the semaphore so that the former
- * is notified when the semaphore state changes. Typically the select binding
- * handler will invoke this service.
+ * This functions binds the given selector to an event so that the former is
+ * notified when the event state changes. Typically the select binding handler
+ * will invoke this service.
  *
- * @param[in,out] sem Semaphore handle as returned by rtdm_sem_init()
+ * @param[in,out] event Event handle as returned by rtdm_event_init()
  * @param[in,out] selector Selector as passed to the select binding handler
  * @param[in] type Type of the bound event as passed to the select binding handler
  * @param[in] fd_index File descriptor index as passed to the select binding
@@ -1350,8 +1586,8 @@ EXPORT_SYMBOL_GPL(rtdm_sem_up);
  *
  * Rescheduling: never.
  */
-int rtdm_sem_select_bind(rtdm_sem_t *sem, rtdm_selector_t *selector,
-			 enum rtdm_selecttype type, unsigned fd_index)
+int rtdm_event_select_bind(rtdm_event_t *event, rtdm_selector_t *selector,
+			   enum rtdm_selecttype type, unsigned fd_index)
 {
 	struct xnselect_binding *binding;
 	int err;
@@ -1362,11 +1598,11 @@ int rtdm_sem_select_bind(rtdm_sem_t *sem, rtdm_selector_t *selector,
 		return -ENOMEM;
 
 	xnlock_get_irqsave(&nklock, s);
-	err = xnselect_bind(&sem->select_block, binding, selector,
-			    type, fd_index,
-			    (sem->value > 0) ||
-			    xnsynch_test_flags(&sem->synch_base,
-					       RTDM_SYNCH_DELETED));
+	err = xnselect_bind(&event->select_block,
+			    binding, selector, type, fd_index,
+			    xnsynch_test_flags(&event->synch_base,
+					       RTDM_SYNCH_DELETED |
+					       RTDM_EVENT_PENDING));
 	xnlock_put_irqrestore(&nklock, s);
 
 	if (err)
@@ -1374,23 +1610,20 @@ int rtdm_sem_select_bind(rtdm_sem_t *sem, rtdm_selector_t *selector,
 
 	return err;
 }
-EXPORT_SYMBOL_GPL(rtdm_sem_select_bind);
+EXPORT_SYMBOL_GPL(rtdm_event_select_bind);
 #endif /* CONFIG_XENO_OPT_RTDM_SELECT */
 /** @} */
 
 /*!
- * @name Mutex Services
+ * @name Semaphore Services
  * @{
  */
 
 /**
- * @brief Initialise a mutex
- *
- * This function initalises a basic mutex with priority inversion protection.
- * "Basic", as it does not allow a mutex owner to recursively lock the same
- * mutex again.
+ * @brief Initialise a semaphore
  *
- * @param[in,out] mutex Mutex handle
+ * @param[in,out] sem Semaphore handle
+ * @param[in] value Initial value of the semaphore
  *
  * Environments:
  *
@@ -1402,26 +1635,29 @@ EXPORT_SYMBOL_GPL(rtdm_sem_select_bind);
  *
  * Rescheduling: never.
  */
-void rtdm_mutex_init(rtdm_mutex_t *mutex)
+void rtdm_sem_init(rtdm_sem_t *sem, unsigned long value)
 {
 	spl_t s;
 
+	trace_mark(xn_rtdm, sem_init, "sem %p value %lu", sem, value);
+
 	/* Make atomic for re-initialisation support */
 	xnlock_get_irqsave(&nklock, s);
 
-	xnsynch_init(&mutex->synch_base,
-		     XNSYNCH_PRIO | XNSYNCH_PIP | XNSYNCH_OWNER, NULL);
+	sem->value = value;
+	xnsynch_init(&sem->synch_base, XNSYNCH_PRIO, NULL);
+	xnselect_init(&sem->select_block);
 
 	xnlock_put_irqrestore(&nklock, s);
 }
 
-EXPORT_SYMBOL_GPL(rtdm_mutex_init);
+EXPORT_SYMBOL_GPL(rtdm_sem_init);
 
 #ifdef DOXYGEN_CPP /* Only used for doxygen doc generation */
 /**
- * @brief Destroy a mutex
+ * @brief Destroy a semaphore
  *
- * @param[in,out] mutex Mutex handle as returned by rtdm_mutex_init()
+ * @param[in,out] sem Semaphore handle as returned by rtdm_sem_init()
  *
  * Environments:
  *
@@ -1433,15 +1669,513 @@ EXPORT_SYMBOL_GPL(rtdm_mutex_init);
  *
  * Rescheduling: possible.
  */
-void rtdm_mutex_destroy(rtdm_mutex_t *mutex);
+void rtdm_sem_destroy(rtdm_sem_t *sem);
+#endif /* DOXYGEN_CPP */
 
 /**
- * @brief Release a mutex
+ * @brief Decrement a semaphore
+ *
+ * This is the light-weight version of rtdm_sem_timeddown(), implying an
+ * infinite timeout.
+ *
+ * @param[in,out] sem Semaphore handle as returned by rtdm_sem_init()
+ *
+ * @return 0 on success, otherwise:
+ *
+ * - -EINTR is returned if calling task has been unblock by a signal or
+ * explicitly via rtdm_task_unblock().
+ *
+ * - -EIDRM is returned if @a sem has been destroyed.
+ *
+ * - -EPERM @e may be returned if an illegal invocation environment is
+ * detected.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel-based task
+ * - User-space task (RT)
+ *
+ * Rescheduling: possible.
+ */
+int rtdm_sem_down(rtdm_sem_t *sem)
+{
+	return rtdm_sem_timeddown(sem, 0, NULL);
+}
+
+EXPORT_SYMBOL_GPL(rtdm_sem_down);
+
+/**
+ * @brief Decrement a semaphore with timeout
+ *
+ * This function tries to decrement the given semphore's value if it is
+ * positive on entry. If not, the caller is blocked unless non-blocking
+ * operation was selected.
+ *
+ * @param[in,out] sem Semaphore handle as returned by rtdm_sem_init()
+ * @param[in] timeout Relative timeout in nanoseconds, see
+ * @ref RTDM_TIMEOUT_xxx for special values
+ * @param[in,out] timeout_seq Handle of a timeout sequence as returned by
+ * rtdm_toseq_init() or NULL
+ *
+ * @return 0 on success, otherwise:
+ *
+ * - -ETIMEDOUT is returned if the if the request has not been satisfied
+ * within the specified amount of time.
+ *
+ * - -EWOULDBLOCK is returned if @a timeout is negative and the semaphore
+ * value is currently not positive.
+ *
+ * - -EINTR is returned if calling task has been unblock by a signal or
+ * explicitly via rtdm_task_unblock().
+ *
+ * - -EIDRM is returned if @a sem has been destroyed.
+ *
+ * - -EPERM @e may be returned if an illegal invocation environment is
+ * detected.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel-based task
+ * - User-space task (RT)
+ *
+ * Rescheduling: possible.
+ */
+int rtdm_sem_timeddown(rtdm_sem_t *sem, nanosecs_rel_t timeout,
+		       rtdm_toseq_t *timeout_seq)
+{
+	xnthread_t *thread;
+	spl_t s;
+	int err = 0;
+
+	XENO_ASSERT(RTDM, !xnpod_unblockable_p(), return -EPERM;);
+
+	trace_mark(xn_rtdm, sem_timedwait,
+		   "sem %p timeout %Lu timeout_seq %p timeout_seq_value %Lu",
+		   sem, (long long)timeout, timeout_seq, (long long)(timeout_seq ? *timeout_seq : 0));
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (unlikely(xnsynch_test_flags(&sem->synch_base, RTDM_SYNCH_DELETED)))
+		err = -EIDRM;
+	else if (sem->value > 0) {
+		if(!--sem->value)
+			xnselect_signal(&sem->select_block, 0);
+	} else if (timeout < 0) /* non-blocking mode */
+		err = -EWOULDBLOCK;
+	else {
+		thread = xnpod_current_thread();
+
+		if (timeout_seq && (timeout > 0)) {
+			/* timeout sequence */
+			xnsynch_sleep_on(&sem->synch_base, *timeout_seq,
+					 XN_ABSOLUTE);
+		} else {
+			/* infinite or relative timeout */
+			xnsynch_sleep_on(&sem->synch_base,
+					 xntbase_ns2ticks_ceil
+					 (xnthread_time_base(thread), timeout),
+					 XN_RELATIVE);
+		}
+
+		if (xnthread_test_info(thread, XNTIMEO | XNRMID | XNBREAK)) {
+			if (xnthread_test_info(thread, XNTIMEO))
+				err = -ETIMEDOUT;
+			else if (xnthread_test_info(thread, XNRMID))
+				err = -EIDRM;
+			else /* XNBREAK */
+				err = -EINTR;
+		}
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
+EXPORT_SYMBOL_GPL(rtdm_sem_timeddown);
+
+/**
+ * @brief Increment a semaphore
+ *
+ * This function increments the given semphore's value, waking up a potential
+ * waiter which was blocked upon rtdm_sem_down().
+ *
+ * @param[in,out] sem Semaphore handle as returned by rtdm_sem_init()
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: possible.
+ */
+void rtdm_sem_up(rtdm_sem_t *sem)
+{
+	spl_t s;
+
+	trace_mark(xn_rtdm, sem_up, "sem %p", sem);
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (xnsynch_wakeup_one_sleeper(&sem->synch_base))
+		xnpod_schedule();
+	else
+		if (sem->value++ == 0
+		    && xnselect_signal(&sem->select_block, 1))
+			xnpod_schedule();
+
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+EXPORT_SYMBOL_GPL(rtdm_sem_up);
+
+#ifdef CONFIG_XENO_OPT_RTDM_SELECT
+/**
+ * @brief Bind a selector to a semaphore
+ *
+ * This functions binds the given selector to the semaphore so that the former
+ * is notified when the semaphore state changes. Typically the select binding
+ * handler will invoke this service.
+ *
+ * @param[in,out] sem Semaphore handle as returned by rtdm_sem_init()
+ * @param[in,out] selector Selector as passed to the select binding handler
+ * @param[in] type Type of the bound event as passed to the select binding handler
+ * @param[in] fd_index File descriptor index as passed to the select binding
+ * handler
+ *
+ * @return 0 on success, otherwise:
+ *
+ * - -ENOMEM is returned if there is insufficient memory to establish the
+ * dynamic binding.
+ *
+ * - -EINVAL is returned if @a type or @a fd_index are invalid.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+int rtdm_sem_select_bind(rtdm_sem_t *sem, rtdm_selector_t *selector,
+			 enum rtdm_selecttype type, unsigned fd_index)
+{
+	struct xnselect_binding *binding;
+	int err;
+	spl_t s;
+
+	binding = xnmalloc(sizeof(*binding));
+	if (!binding)
+		return -ENOMEM;
+
+	xnlock_get_irqsave(&nklock, s);
+	err = xnselect_bind(&sem->select_block, binding, selector,
+			    type, fd_index,
+			    (sem->value > 0) ||
+			    xnsynch_test_flags(&sem->synch_base,
+					       RTDM_SYNCH_DELETED));
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (err)
+		xnfree(binding);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(rtdm_sem_select_bind);
+#endif /* CONFIG_XENO_OPT_RTDM_SELECT */
+/** @} */
+
+/*!
+ * @name Mutex Services
+ * @{
+ */
+
+/**
+ * @brief Initialise a mutex
+ *
+ * This function initalises a basic mutex with priority inversion protection.
+ * "Basic", as it does not allow a mutex owner to recursively lock the same
+ * mutex again.
+ *
+ * @param[in,out] mutex Mutex handle
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+void rtdm_mutex_init(rtdm_mutex_t *mutex)
+{
+	spl_t s;
+
+	/* Make atomic for re-initialisation support */
+	xnlock_get_irqsave(&nklock, s);
+
+	xnsynch_init(&mutex->synch_base,
+		     XNSYNCH_PRIO | XNSYNCH_PIP | XNSYNCH_OWNER, NULL);
+
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+EXPORT_SYMBOL_GPL(rtdm_mutex_init);
+
+#ifdef DOXYGEN_CPP /* Only used for doxygen doc generation */
+/**
+ * @brief Destroy a mutex
+ *
+ * @param[in,out] mutex Mutex handle as returned by rtdm_mutex_init()
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: possible.
+ */
+void rtdm_mutex_destroy(rtdm_mutex_t *mutex);
+
+/**
+ * @brief Release a mutex
  *
  * This function releases the given mutex, waking up a potential waiter which
  * was blocked upon rtdm_mutex_lock() or rtdm_mutex_timedlock().
  *
- * @param[in,out] mutex Mutex handle as returned by rtdm_mutex_init()
+ * @param[in,out] mutex Mutex handle as returned by rtdm_mutex_init()
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel-based task
+ * - User-space task (RT)
+ *
+ * Rescheduling: possible.
+ */
+void rtdm_mutex_unlock(rtdm_mutex_t *mutex);
+#endif /* DOXYGEN_CPP */
+
+/**
+ * @brief Request a mutex
+ *
+ * This is the light-weight version of rtdm_mutex_timedlock(), implying an
+ * infinite timeout.
+ *
+ * @param[in,out] mutex Mutex handle as returned by rtdm_mutex_init()
+ *
+ * @return 0 on success, otherwise:
+ *
+ * - -EIDRM is returned if @a mutex has been destroyed.
+ *
+ * - -EPERM @e may be returned if an illegal invocation environment is
+ * detected.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel-based task
+ * - User-space task (RT)
+ *
+ * Rescheduling: possible.
+ */
+int rtdm_mutex_lock(rtdm_mutex_t *mutex)
+{
+	return rtdm_mutex_timedlock(mutex, 0, NULL);
+}
+
+EXPORT_SYMBOL_GPL(rtdm_mutex_lock);
+
+/**
+ * @brief Request a mutex with timeout
+ *
+ * This function tries to acquire the given mutex. If it is not available, the
+ * caller is blocked unless non-blocking operation was selected.
+ *
+ * @param[in,out] mutex Mutex handle as returned by rtdm_mutex_init()
+ * @param[in] timeout Relative timeout in nanoseconds, see
+ * @ref RTDM_TIMEOUT_xxx for special values
+ * @param[in,out] timeout_seq Handle of a timeout sequence as returned by
+ * rtdm_toseq_init() or NULL
+ *
+ * @return 0 on success, otherwise:
+ *
+ * - -ETIMEDOUT is returned if the if the request has not been satisfied
+ * within the specified amount of time.
+ *
+ * - -EWOULDBLOCK is returned if @a timeout is negative and the semaphore
+ * value is currently not positive.
+ *
+ * - -EIDRM is returned if @a mutex has been destroyed.
+ *
+ * - -EPERM @e may be returned if an illegal invocation environment is
+ * detected.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel-based task
+ * - User-space task (RT)
+ *
+ * Rescheduling: possible.
+ */
+int rtdm_mutex_timedlock(rtdm_mutex_t *mutex, nanosecs_rel_t timeout,
+			 rtdm_toseq_t *timeout_seq)
+{
+	xnthread_t *curr_thread = xnpod_current_thread();
+	spl_t s;
+	int err = 0;
+
+	trace_mark(xn_rtdm, mutex_timedlock,
+		   "mutex %p timeout %Lu timeout_seq %p timeout_seq_value %Lu",
+		   mutex, (long long)timeout, timeout_seq, (long long)(timeout_seq ? *timeout_seq : 0));
+
+	XENO_ASSERT(RTDM, !xnpod_unblockable_p(), return -EPERM;);
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (unlikely(xnsynch_test_flags(&mutex->synch_base,
+					RTDM_SYNCH_DELETED)))
+		err = -EIDRM;
+	else if (likely(xnsynch_owner(&mutex->synch_base) == NULL))
+		xnsynch_set_owner(&mutex->synch_base, curr_thread);
+	else {
+		/* Redefinition to clarify XENO_ASSERT output */
+		#define mutex_owner xnsynch_owner(&mutex->synch_base)
+		XENO_ASSERT(RTDM, mutex_owner != curr_thread,
+			    err = -EDEADLK; goto unlock_out;);
+
+		/* non-blocking mode */
+		if (timeout < 0) {
+			err = -EWOULDBLOCK;
+			goto unlock_out;
+		}
+
+restart:
+		if (timeout_seq && (timeout > 0)) {
+			/* timeout sequence */
+			xnsynch_acquire(&mutex->synch_base, *timeout_seq,
+					XN_ABSOLUTE);
+		} else {
+			/* infinite or relative timeout */
+			xnsynch_acquire(&mutex->synch_base,
+					xntbase_ns2ticks_ceil
+					(xnthread_time_base(curr_thread),
+					 timeout), XN_RELATIVE);
+		}
+
+		if (unlikely(xnthread_test_info(curr_thread,
+						XNTIMEO | XNRMID | XNBREAK))) {
+			if (xnthread_test_info(curr_thread, XNTIMEO))
+				err = -ETIMEDOUT;
+			else if (xnthread_test_info(curr_thread, XNRMID))
+				err = -EIDRM;
+			else /*  XNBREAK */
+				goto restart;
+		}
+	}
+
+unlock_out:
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
+EXPORT_SYMBOL_GPL(rtdm_mutex_timedlock);
+/** @} */
+
+/*!
+ * @name Reader-Writer Mutex Services
+ *
+ * Reader-writer mutexes let any number of readers, or a single
+ * writer, hold the lock. Writers are protected against priority
+ * inversion: the writer owning the lock inherits the priority of
+ * the threads waiting for it, readers included. Readers do not
+ * inherit anything, since no owner is tracked for them. A waiting
+ * writer holds off new readers.
+ * @{
+ */
+
+/**
+ * @brief Initialise a reader-writer mutex
+ *
+ * @param[in,out] rwmutex Reader-writer mutex handle
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+void rtdm_rwmutex_init(rtdm_rwmutex_t *rwmutex)
+{
+	spl_t s;
+
+	/* Make atomic for re-initialisation support */
+	xnlock_get_irqsave(&nklock, s);
+
+	xnsynch_init(&rwmutex->synch_base,
+		     XNSYNCH_PRIO | XNSYNCH_PIP | XNSYNCH_OWNER, NULL);
+	xnsynch_init(&rwmutex->drain, XNSYNCH_PRIO, NULL);
+	rwmutex->readers = 0;
+
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+EXPORT_SYMBOL_GPL(rtdm_rwmutex_init);
+
+#ifdef DOXYGEN_CPP /* Only used for doxygen doc generation */
+/**
+ * @brief Destroy a reader-writer mutex
+ *
+ * @param[in,out] rwmutex Reader-writer mutex handle as returned by
+ * rtdm_rwmutex_init()
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: possible.
+ */
+void rtdm_rwmutex_destroy(rtdm_rwmutex_t *rwmutex);
+
+/**
+ * @brief Request a reader-writer mutex for reading
+ *
+ * This is the light-weight version of rtdm_rwmutex_timedrdlock(),
+ * implying an infinite timeout.
+ *
+ * @param[in,out] rwmutex Reader-writer mutex handle as returned by
+ * rtdm_rwmutex_init()
+ *
+ * @return 0 on success, otherwise see rtdm_rwmutex_timedrdlock().
  *
  * Environments:
  *
@@ -1452,24 +2186,94 @@ void rtdm_mutex_destroy(rtdm_mutex_t *mutex);
  *
  * Rescheduling: possible.
  */
-void rtdm_mutex_unlock(rtdm_mutex_t *mutex);
+int rtdm_rwmutex_rdlock(rtdm_rwmutex_t *rwmutex);
+
+/**
+ * @brief Request a reader-writer mutex for writing
+ *
+ * This is the light-weight version of rtdm_rwmutex_timedwrlock(),
+ * implying an infinite timeout.
+ *
+ * @param[in,out] rwmutex Reader-writer mutex handle as returned by
+ * rtdm_rwmutex_init()
+ *
+ * @return 0 on success, otherwise see rtdm_rwmutex_timedwrlock().
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel-based task
+ * - User-space task (RT)
+ *
+ * Rescheduling: possible.
+ */
+int rtdm_rwmutex_wrlock(rtdm_rwmutex_t *rwmutex);
 #endif /* DOXYGEN_CPP */
 
+static int rtdm_rwmutex_wait(xnsynch_t *synch, int acquire,
+			     nanosecs_rel_t timeout, rtdm_toseq_t *timeout_seq)
+{
+	xnthread_t *curr_thread = xnpod_current_thread();
+	xntmode_t mode = XN_RELATIVE;
+	xnticks_t ticks;
+
+	if (timeout_seq && (timeout > 0)) {
+		/* timeout sequence */
+		ticks = *timeout_seq;
+		mode = XN_ABSOLUTE;
+	} else
+		/* infinite or relative timeout */
+		ticks = xntbase_ns2ticks_ceil(xnthread_time_base(curr_thread),
+					      timeout);
+	if (acquire)
+		xnsynch_acquire(synch, ticks, mode);
+	else
+		xnsynch_sleep_on(synch, ticks, mode);
+
+	if (likely(!xnthread_test_info(curr_thread,
+				       XNTIMEO | XNRMID | XNBREAK)))
+		return 0;
+
+	if (xnthread_test_info(curr_thread, XNTIMEO))
+		return -ETIMEDOUT;
+
+	if (xnthread_test_info(curr_thread, XNRMID))
+		return -EIDRM;
+
+	return -EINTR;	/* XNBREAK */
+}
+
 /**
- * @brief Request a mutex
+ * @brief Request a reader-writer mutex for reading, with timeout
  *
- * This is the light-weight version of rtdm_mutex_timedlock(), implying an
- * infinite timeout.
+ * This function tries to acquire the given reader-writer mutex for
+ * reading. The caller is blocked while a writer holds the lock or
+ * waits for it, unless non-blocking operation was selected.
  *
- * @param[in,out] mutex Mutex handle as returned by rtdm_mutex_init()
+ * @param[in,out] rwmutex Reader-writer mutex handle as returned by
+ * rtdm_rwmutex_init()
+ * @param[in] timeout Relative timeout in nanoseconds, see
+ * @ref RTDM_TIMEOUT_xxx for special values
+ * @param[in,out] timeout_seq Handle of a timeout sequence as returned by
+ * rtdm_toseq_init() or NULL
  *
  * @return 0 on success, otherwise:
  *
- * - -EIDRM is returned if @a mutex has been destroyed.
+ * - -ETIMEDOUT is returned if the if the request has not been satisfied
+ * within the specified amount of time.
+ *
+ * - -EWOULDBLOCK is returned if @a timeout is negative and the lock
+ * is currently not available for reading.
+ *
+ * - -EIDRM is returned if @a rwmutex has been destroyed.
  *
  * - -EPERM @e may be returned if an illegal invocation environment is
  * detected.
  *
+ * - -EDEADLK @e may be returned if the caller holds the lock for
+ * writing.
+ *
  * Environments:
  *
  * This service can be called from:
@@ -1479,20 +2283,76 @@ void rtdm_mutex_unlock(rtdm_mutex_t *mutex);
  *
  * Rescheduling: possible.
  */
-int rtdm_mutex_lock(rtdm_mutex_t *mutex)
+int rtdm_rwmutex_timedrdlock(rtdm_rwmutex_t *rwmutex, nanosecs_rel_t timeout,
+			     rtdm_toseq_t *timeout_seq)
 {
-	return rtdm_mutex_timedlock(mutex, 0, NULL);
+	xnthread_t *curr_thread = xnpod_current_thread();
+	spl_t s;
+	int err = 0;
+
+	trace_mark(xn_rtdm, rwmutex_timedrdlock,
+		   "rwmutex %p timeout %Lu", rwmutex, (long long)timeout);
+
+	XENO_ASSERT(RTDM, !xnpod_unblockable_p(), return -EPERM;);
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (unlikely(xnsynch_test_flags(&rwmutex->synch_base,
+					RTDM_SYNCH_DELETED))) {
+		err = -EIDRM;
+		goto unlock_out;
+	}
+
+	if (likely(xnsynch_owner(&rwmutex->synch_base) == NULL)) {
+		rwmutex->readers++;
+		goto unlock_out;
+	}
+
+	/* Redefinition to clarify XENO_ASSERT output */
+	#define rwmutex_owner xnsynch_owner(&rwmutex->synch_base)
+	XENO_ASSERT(RTDM, rwmutex_owner != curr_thread,
+		    err = -EDEADLK; goto unlock_out;);
+
+	/* non-blocking mode */
+	if (timeout < 0) {
+		err = -EWOULDBLOCK;
+		goto unlock_out;
+	}
+
+	/*
+	 * Queue up behind the writer, which inherits our priority,
+	 * then pass the ownership on to the next waiter once we are
+	 * accounted for as a reader.
+	 */
+	do
+		err = rtdm_rwmutex_wait(&rwmutex->synch_base, 1,
+					timeout, timeout_seq);
+	while (err == -EINTR);
+
+	if (err == 0) {
+		rwmutex->readers++;
+		if (xnsynch_release(&rwmutex->synch_base))
+			xnpod_schedule();
+	}
+
+unlock_out:
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
 }
 
-EXPORT_SYMBOL_GPL(rtdm_mutex_lock);
+EXPORT_SYMBOL_GPL(rtdm_rwmutex_timedrdlock);
 
 /**
- * @brief Request a mutex with timeout
+ * @brief Request a reader-writer mutex for writing, with timeout
  *
- * This function tries to acquire the given mutex. If it is not available, the
- * caller is blocked unless non-blocking operation was selected.
+ * This function tries to acquire the given reader-writer mutex for
+ * writing. The caller is blocked while another writer holds the
+ * lock, then until all readers have released it, unless non-blocking
+ * operation was selected.
  *
- * @param[in,out] mutex Mutex handle as returned by rtdm_mutex_init()
+ * @param[in,out] rwmutex Reader-writer mutex handle as returned by
+ * rtdm_rwmutex_init()
  * @param[in] timeout Relative timeout in nanoseconds, see
  * @ref RTDM_TIMEOUT_xxx for special values
  * @param[in,out] timeout_seq Handle of a timeout sequence as returned by
@@ -1503,14 +2363,17 @@ EXPORT_SYMBOL_GPL(rtdm_mutex_lock);
  * - -ETIMEDOUT is returned if the if the request has not been satisfied
  * within the specified amount of time.
  *
- * - -EWOULDBLOCK is returned if @a timeout is negative and the semaphore
- * value is currently not positive.
+ * - -EWOULDBLOCK is returned if @a timeout is negative and the lock
+ * is currently not available.
  *
- * - -EIDRM is returned if @a mutex has been destroyed.
+ * - -EIDRM is returned if @a rwmutex has been destroyed.
  *
  * - -EPERM @e may be returned if an illegal invocation environment is
  * detected.
  *
+ * - -EDEADLK @e may be returned if the caller holds the lock for
+ * writing already.
+ *
  * Environments:
  *
  * This service can be called from:
@@ -1520,59 +2383,76 @@ EXPORT_SYMBOL_GPL(rtdm_mutex_lock);
  *
  * Rescheduling: possible.
  */
-int rtdm_mutex_timedlock(rtdm_mutex_t *mutex, nanosecs_rel_t timeout,
-			 rtdm_toseq_t *timeout_seq)
+int rtdm_rwmutex_timedwrlock(rtdm_rwmutex_t *rwmutex, nanosecs_rel_t timeout,
+			     rtdm_toseq_t *timeout_seq)
 {
 	xnthread_t *curr_thread = xnpod_current_thread();
+	rtdm_toseq_t toseq;
 	spl_t s;
 	int err = 0;
 
-	trace_mark(xn_rtdm, mutex_timedlock,
-		   "mutex %p timeout %Lu timeout_seq %p timeout_seq_value %Lu",
-		   mutex, (long long)timeout, timeout_seq, (long long)(timeout_seq ? *timeout_seq : 0));
+	trace_mark(xn_rtdm, rwmutex_timedwrlock,
+		   "rwmutex %p timeout %Lu", rwmutex, (long long)timeout);
 
 	XENO_ASSERT(RTDM, !xnpod_unblockable_p(), return -EPERM;);
 
 	xnlock_get_irqsave(&nklock, s);
 
-	if (unlikely(xnsynch_test_flags(&mutex->synch_base,
-					RTDM_SYNCH_DELETED)))
+	if (unlikely(xnsynch_test_flags(&rwmutex->synch_base,
+					RTDM_SYNCH_DELETED))) {
 		err = -EIDRM;
-	else if (likely(xnsynch_owner(&mutex->synch_base) == NULL))
-		xnsynch_set_owner(&mutex->synch_base, curr_thread);
-	else {
-		/* Redefinition to clarify XENO_ASSERT output */
-		#define mutex_owner xnsynch_owner(&mutex->synch_base)
-		XENO_ASSERT(RTDM, mutex_owner != curr_thread,
-			    err = -EDEADLK; goto unlock_out;);
+		goto unlock_out;
+	}
 
-		/* non-blocking mode */
-		if (timeout < 0) {
-			err = -EWOULDBLOCK;
+	if (likely(xnsynch_owner(&rwmutex->synch_base) == NULL)) {
+		if (rwmutex->readers == 0) {
+			xnsynch_set_owner(&rwmutex->synch_base, curr_thread);
 			goto unlock_out;
 		}
+	} else
+		XENO_ASSERT(RTDM, rwmutex_owner != curr_thread,
+			    err = -EDEADLK; goto unlock_out;);
 
-restart:
-		if (timeout_seq && (timeout > 0)) {
-			/* timeout sequence */
-			xnsynch_acquire(&mutex->synch_base, *timeout_seq,
-					XN_ABSOLUTE);
-		} else {
-			/* infinite or relative timeout */
-			xnsynch_acquire(&mutex->synch_base,
-					xntbase_ns2ticks_ceil
-					(xnthread_time_base(curr_thread),
-					 timeout), XN_RELATIVE);
-		}
+	/* non-blocking mode */
+	if (timeout < 0) {
+		err = -EWOULDBLOCK;
+		goto unlock_out;
+	}
 
-		if (unlikely(xnthread_test_info(curr_thread,
-						XNTIMEO | XNRMID | XNBREAK))) {
-			if (xnthread_test_info(curr_thread, XNTIMEO))
-				err = -ETIMEDOUT;
-			else if (xnthread_test_info(curr_thread, XNRMID))
-				err = -EIDRM;
-			else /*  XNBREAK */
-				goto restart;
+	/*
+	 * The wait may span two stages, have them share a single
+	 * deadline.
+	 */
+	if (timeout > 0 && timeout_seq == NULL) {
+		rtdm_toseq_init(&toseq, timeout);
+		timeout_seq = &toseq;
+	}
+
+	if (xnsynch_owner(&rwmutex->synch_base) == NULL)
+		xnsynch_set_owner(&rwmutex->synch_base, curr_thread);
+	else {
+		do
+			err = rtdm_rwmutex_wait(&rwmutex->synch_base, 1,
+						timeout, timeout_seq);
+		while (err == -EINTR);
+		if (err)
+			goto unlock_out;
+	}
+
+	/*
+	 * We own the mutex, so no reader may enter anymore; wait for
+	 * the current ones to leave.
+	 */
+	while (rwmutex->readers > 0) {
+		err = rtdm_rwmutex_wait(&rwmutex->drain, 0,
+					timeout, timeout_seq);
+		if (err == -EINTR)
+			err = 0;
+		else if (err) {
+			if (err != -EIDRM &&
+			    xnsynch_release(&rwmutex->synch_base))
+				xnpod_schedule();
+			break;
 		}
 	}
 
@@ -1582,67 +2462,353 @@ unlock_out:
 	return err;
 }
 
-EXPORT_SYMBOL_GPL(rtdm_mutex_timedlock);
+EXPORT_SYMBOL_GPL(rtdm_rwmutex_timedwrlock);
+
+/**
+ * @brief Release a reader-writer mutex
+ *
+ * This function releases the given reader-writer mutex, held either
+ * for reading or writing by the caller.
+ *
+ * @param[in,out] rwmutex Reader-writer mutex handle as returned by
+ * rtdm_rwmutex_init()
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel-based task
+ * - User-space task (RT)
+ *
+ * Rescheduling: possible.
+ */
+void rtdm_rwmutex_unlock(rtdm_rwmutex_t *rwmutex)
+{
+	spl_t s;
+
+	XENO_ASSERT(RTDM, !xnpod_asynch_p(), return;);
+
+	trace_mark(xn_rtdm, rwmutex_unlock, "rwmutex %p", rwmutex);
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (xnsynch_owner(&rwmutex->synch_base) == xnpod_current_thread()) {
+		if (xnsynch_release(&rwmutex->synch_base))
+			xnpod_schedule();
+	} else if (--rwmutex->readers == 0 &&
+		   xnsynch_wakeup_one_sleeper(&rwmutex->drain))
+		xnpod_schedule();
+
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+EXPORT_SYMBOL_GPL(rtdm_rwmutex_unlock);
 /** @} */
 
 /** @} Synchronisation services */
 
-/*!
- * @ingroup driverapi
- * @defgroup rtdmirq Interrupt Management Services
- * @{
- */
+/*!
+ * @ingroup driverapi
+ * @defgroup rtdmirq Interrupt Management Services
+ * @{
+ */
+
+/**
+ * @brief Register an interrupt handler
+ *
+ * This function registers the provided handler with an IRQ line and enables
+ * the line.
+ *
+ * @param[in,out] irq_handle IRQ handle
+ * @param[in] irq_no Line number of the addressed IRQ
+ * @param[in] handler Interrupt handler
+ * @param[in] flags Registration flags, see @ref RTDM_IRQTYPE_xxx for details
+ * @param[in] device_name Device name to show up in real-time IRQ lists
+ * @param[in] arg Pointer to be passed to the interrupt handler on invocation
+ *
+ * @return 0 on success, otherwise:
+ *
+ * - -EINVAL is returned if an invalid parameter was passed.
+ *
+ * - -EBUSY is returned if the specified IRQ line is already in use.
+ *
+ * - -ENOMEM is returned if the IRQ thread could not be created
+ * (RTDM_IRQTYPE_THREADED).
+ *
+ * @note With RTDM_IRQTYPE_THREADED, @a handler runs over a real-time
+ * thread instead of the interrupt context, while the IRQ line remains
+ * masked. Since this thread competes with other real-time tasks for
+ * the CPU, handlers of devices which cannot tolerate the additional
+ * latency should not be threaded.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - User-space task (non-RT)
+ *
+ * Rescheduling: never.
+ */
+int rtdm_irq_request(rtdm_irq_t *irq_handle, unsigned int irq_no,
+		     rtdm_irq_handler_t handler, unsigned long flags,
+		     const char *device_name, void *arg)
+{
+	int err;
+
+	XENO_ASSERT(RTDM, xnpod_root_p(), return -EPERM;);
+
+	err = xnintr_init(irq_handle, device_name, irq_no, handler, NULL, flags);
+	if (err)
+		return err;
+
+	err = xnintr_attach(irq_handle, arg);
+	if (err)
+		return err;
+
+	err = xnintr_enable(irq_handle);
+	if (err)
+		xnintr_detach(irq_handle);
+
+	return err;
+}
+
+EXPORT_SYMBOL_GPL(rtdm_irq_request);
+
+static void rtdm_irqpoll_task(void *arg)
+{
+	rtdm_irqpoll_t *poll = arg;
+	rtdm_lockctx_t lock_ctx;
+	int idle;
+
+	while (rtdm_event_wait(&poll->wakeup) == 0) {
+		/*
+		 * The line was disabled by rtdm_irqpoll_check(), run
+		 * the handler periodically until the device has been
+		 * idle for a few periods in a row.
+		 */
+		for (idle = 0; idle < RTDM_IRQPOLL_IDLE; ) {
+			if (rtdm_task_sleep(poll->period))
+				return;
+			poll->stats.polls++;
+			if (poll->handler(poll) > 0)
+				idle = 0;
+			else
+				idle++;
+		}
+
+		rtdm_lock_get_irqsave(&poll->lock, lock_ctx);
+		poll->polling = 0;
+		poll->count = 0;
+		poll->window = rtdm_clock_read_monotonic();
+		poll->stats.to_irq++;
+		rtdm_lock_put_irqrestore(&poll->lock, lock_ctx);
+
+		rtdm_irq_enable(poll->irq_handle);
+		/*
+		 * Edge-triggered sources would not notify events which
+		 * showed up since the last poll, catch them now.
+		 */
+		poll->handler(poll);
+	}
+}
+
+/**
+ * @brief Initialise an interrupt polling context
+ *
+ * Attach a polling fallback to an interrupt line. The interrupt
+ * handler reports each interrupt by calling rtdm_irqpoll_check(). When
+ * the interrupt rate exceeds @a max_rate, rtdm_irqpoll_check()
+ * disables the line and hands over to a polling task, which runs @a
+ * handler every @a period nanoseconds. Once @a handler reported no
+ * event for RTDM_IRQPOLL_IDLE polls in a row, the line is re-enabled
+ * and the driver returns to interrupt mode.
+ *
+ * This way, an interrupt storm costs a bounded share of the CPU, as a
+ * regular real-time task at @a priority does, instead of preempting
+ * all real-time activities.
+ *
+ * @param[in,out] poll Polling context
+ * @param[in] irq_handle IRQ handle the context applies to
+ * @param[in] handler Polling handler, which must serialize with the
+ * interrupt handler of the device
+ * @param[in] max_rate Interrupt rate (per second) above which polling
+ * mode is entered
+ * @param[in] period Polling period in nanoseconds
+ * @param[in] priority Priority of the polling task, between
+ * RTDM_TASK_LOWEST_PRIORITY and RTDM_TASK_HIGHEST_PRIORITY
+ * @param[in] name Name of the polling task, also shown in
+ * /proc/xenomai/rtdm/irq_polling
+ *
+ * @return 0 on success, otherwise:
+ *
+ * - -EINVAL is returned if @a max_rate or @a period is zero.
+ *
+ * - -ENOMEM is returned if the polling task could not be created.
+ *
+ * @note The polling context must be initialised before the interrupt
+ * handler is registered by rtdm_irq_request(). Since polling mode
+ * disables the interrupt line, it should not be used with
+ * RTDM_IRQTYPE_SHARED lines shared with other devices.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - User-space task (non-RT)
+ *
+ * Rescheduling: possible.
+ */
+int rtdm_irqpoll_init(rtdm_irqpoll_t *poll, rtdm_irq_t *irq_handle,
+		      rtdm_irqpoll_handler_t handler, unsigned int max_rate,
+		      nanosecs_rel_t period, int priority, const char *name)
+{
+	int err;
+
+	XENO_ASSERT(RTDM, xnpod_root_p(), return -EPERM;);
+
+	if (max_rate == 0 || period <= 0)
+		return -EINVAL;
+
+	poll->irq_handle = irq_handle;
+	poll->handler = handler;
+	poll->name = name;
+	rtdm_lock_init(&poll->lock);
+	poll->limit = max_rate / (1000000000 / RTDM_IRQPOLL_WINDOW) ? : 1;
+	poll->count = 0;
+	poll->window = rtdm_clock_read_monotonic();
+	poll->period = period;
+	poll->polling = 0;
+	memset(&poll->stats, 0, sizeof(poll->stats));
+	rtdm_event_init(&poll->wakeup, 0);
+
+	err = rtdm_task_init(&poll->task, name, rtdm_irqpoll_task, poll,
+			     priority, 0);
+	if (err) {
+		rtdm_event_destroy(&poll->wakeup);
+		return err;
+	}
+
+	rtdm_proc_register_irqpoll(poll);
+
+	return 0;
+}
+
+EXPORT_SYMBOL_GPL(rtdm_irqpoll_init);
 
 /**
- * @brief Register an interrupt handler
+ * @brief Destroy an interrupt polling context
  *
- * This function registers the provided handler with an IRQ line and enables
- * the line.
+ * @param[in,out] poll Polling context as passed to rtdm_irqpoll_init()
  *
- * @param[in,out] irq_handle IRQ handle
- * @param[in] irq_no Line number of the addressed IRQ
- * @param[in] handler Interrupt handler
- * @param[in] flags Registration flags, see @ref RTDM_IRQTYPE_xxx for details
- * @param[in] device_name Device name to show up in real-time IRQ lists
- * @param[in] arg Pointer to be passed to the interrupt handler on invocation
+ * @note The interrupt handler must have been released by
+ * rtdm_irq_free() before.
  *
- * @return 0 on success, otherwise:
+ * Environments:
  *
- * - -EINVAL is returned if an invalid parameter was passed.
+ * This service can be called from:
  *
- * - -EBUSY is returned if the specified IRQ line is already in use.
+ * - Kernel module initialization/cleanup code
+ * - User-space task (non-RT)
+ *
+ * Rescheduling: possible.
+ */
+void rtdm_irqpoll_destroy(rtdm_irqpoll_t *poll)
+{
+	XENO_ASSERT(RTDM, xnpod_root_p(), return;);
+
+	rtdm_proc_unregister_irqpoll(poll);
+	rtdm_task_destroy(&poll->task);
+	rtdm_event_destroy(&poll->wakeup);
+}
+
+EXPORT_SYMBOL_GPL(rtdm_irqpoll_destroy);
+
+/**
+ * @brief Account an interrupt, switching to polling mode on overload
+ *
+ * To be called by the interrupt handler of the device for each
+ * interrupt it handled.
+ *
+ * @param[in,out] poll Polling context as passed to rtdm_irqpoll_init()
+ *
+ * @return 0 in interrupt mode. Otherwise, the interrupt line has just
+ * been disabled and polling mode entered, and RTDM_IRQ_NOENABLE is
+ * returned, which the interrupt handler shall add to its return
+ * value.
  *
  * Environments:
  *
  * This service can be called from:
  *
- * - Kernel module initialization/cleanup code
- * - User-space task (non-RT)
+ * - Interrupt service routine
  *
  * Rescheduling: never.
  */
-int rtdm_irq_request(rtdm_irq_t *irq_handle, unsigned int irq_no,
-		     rtdm_irq_handler_t handler, unsigned long flags,
-		     const char *device_name, void *arg)
+int rtdm_irqpoll_check(rtdm_irqpoll_t *poll)
 {
-	int err;
+	nanosecs_abs_t now = rtdm_clock_read_monotonic();
+	int ret = 0;
 
-	XENO_ASSERT(RTDM, xnpod_root_p(), return -EPERM;);
+	rtdm_lock_get(&poll->lock);
 
-	xnintr_init(irq_handle, device_name, irq_no, handler, NULL, flags);
+	poll->stats.irqs++;
 
-	err = xnintr_attach(irq_handle, arg);
-	if (err)
-		return err;
+	if (poll->polling) {
+		ret = RTDM_IRQ_NOENABLE;
+		goto unlock_out;
+	}
 
-	err = xnintr_enable(irq_handle);
-	if (err)
-		xnintr_detach(irq_handle);
+	if (now - poll->window >= RTDM_IRQPOLL_WINDOW) {
+		poll->window = now;
+		poll->count = 0;
+	}
 
-	return err;
+	if (++poll->count > poll->limit) {
+		poll->polling = 1;
+		poll->stats.to_poll++;
+		rtdm_irq_disable(poll->irq_handle);
+		rtdm_event_signal(&poll->wakeup);
+		ret = RTDM_IRQ_NOENABLE;
+	}
+
+ unlock_out:
+	rtdm_lock_put(&poll->lock);
+
+	return ret;
 }
 
-EXPORT_SYMBOL_GPL(rtdm_irq_request);
+EXPORT_SYMBOL_GPL(rtdm_irqpoll_check);
+
+/**
+ * @brief Retrieve interrupt polling statistics
+ *
+ * @param[in] poll Polling context as passed to rtdm_irqpoll_init()
+ * @param[out] stats Copy of the current statistics
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+void rtdm_irqpoll_get_stats(rtdm_irqpoll_t *poll,
+			    struct rtdm_irqpoll_stats *stats)
+{
+	rtdm_lockctx_t lock_ctx;
+
+	rtdm_lock_get_irqsave(&poll->lock, lock_ctx);
+	*stats = poll->stats;
+	rtdm_lock_put_irqrestore(&poll->lock, lock_ctx);
+}
+
+EXPORT_SYMBOL_GPL(rtdm_irqpoll_get_stats);
 
 #ifdef DOXYGEN_CPP /* Only used for doxygen doc generation */
 /**
@@ -1723,6 +2889,58 @@ int rtdm_irq_enable(rtdm_irq_t *irq_handle);
  * Rescheduling: never.
  */
 int rtdm_irq_disable(rtdm_irq_t *irq_handle);
+
+/**
+ * @brief Set a claim check on a shared interrupt line
+ *
+ * @param[in,out] irq_handle IRQ handle as returned by rtdm_irq_request()
+ * @param[in] claim Cheap test returning non-zero if the device may have
+ * raised the interrupt, or NULL to remove it
+ *
+ * When the line is shared (RTDM_IRQTYPE_SHARED), the handler is only
+ * invoked if @a claim returns non-zero, which avoids running the whole
+ * handler of every device sharing the line on each interrupt. The check
+ * must not change the device state, e.g. by reading a register which
+ * acknowledges the interrupt. It is ignored on non-shared lines.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ *
+ * Rescheduling: never.
+ */
+void rtdm_irq_set_claim(rtdm_irq_t *irq_handle, rtdm_irq_handler_t claim);
+
+/**
+ * @brief Make an interrupt line follow the task consuming its events
+ *
+ * @param[in,out] irq_handle IRQ handle as returned by rtdm_irq_request()
+ * @param[in] task Task woken up by the interrupt handler, or NULL to
+ * remove the binding
+ * @param[in] timer Optional timer armed by the interrupt handler, or NULL
+ *
+ * On SMP systems, the affinity of the interrupt line is set to the CPU
+ * of @a task, and updated whenever the task migrates; @a timer, if
+ * any, is migrated along. This avoids a cross-CPU wakeup for each
+ * interrupt, such wakeups are counted in /proc/xenomai/irq. The
+ * binding is removed when the IRQ handler is released or the task is
+ * destroyed.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+void rtdm_irq_bind(rtdm_irq_t *irq_handle, rtdm_task_t *task,
+		   rtdm_timer_t *timer);
 #endif /* DOXYGEN_CPP */
 
 /** @} Interrupt Management Services */
@@ -2500,4 +3718,340 @@ int rtdm_rt_capable(rtdm_user_info_t *user_info);
 
 #endif /* DOXYGEN_CPP */
 
+/*
+ * Object caches serve fixed-size blocks from per-CPU free lists,
+ * with interrupts off but without any lock. Lists are refilled from
+ * and drained to a depot shared by all CPUs by batches, and the
+ * depot falls back to the system heap, so that the global locks are
+ * only taken once in a while in steady state. Cached objects are
+ * regular system heap blocks.
+ */
+struct rtdm_cache_cpu {
+	void *head;
+	unsigned int count;
+	unsigned long allocs;
+	unsigned long frees;
+	unsigned long refills;
+	unsigned long drains;
+	unsigned long failures;
+} ____cacheline_aligned_in_smp;
+
+#define cache_next(obj)	(*(void **)(obj))
+
+/* Called with interrupts off. */
+static void rtdm_cache_refill(rtdm_cache_t *cache, struct rtdm_cache_cpu *pc)
+{
+	unsigned int n = 0;
+	void *obj;
+
+	rtdm_lock_get(&cache->lock);
+
+	while (cache->depot && n < RTDM_CACHE_BATCH) {
+		obj = cache->depot;
+		cache->depot = cache_next(obj);
+		cache_next(obj) = pc->head;
+		pc->head = obj;
+		n++;
+	}
+	cache->ndepot -= n;
+
+	rtdm_lock_put(&cache->lock);
+
+	/* Depot is dry, go for the system heap. */
+	for (; n < RTDM_CACHE_BATCH; n++) {
+		obj = xnmalloc(cache->objsize);
+		if (obj == NULL)
+			break;
+		cache_next(obj) = pc->head;
+		pc->head = obj;
+	}
+
+	pc->count += n;
+	pc->refills++;
+}
+
+/* Called with interrupts off. */
+static void rtdm_cache_drain(rtdm_cache_t *cache, struct rtdm_cache_cpu *pc)
+{
+	void *head, *tail, *obj;
+	unsigned int n;
+
+	head = tail = pc->head;
+	for (n = 1; n < RTDM_CACHE_BATCH; n++)
+		tail = cache_next(tail);
+	pc->head = cache_next(tail);
+	cache_next(tail) = NULL;
+	pc->count -= RTDM_CACHE_BATCH;
+	pc->drains++;
+
+	rtdm_lock_get(&cache->lock);
+
+	if (cache->ndepot + RTDM_CACHE_BATCH <= cache->capacity) {
+		cache_next(tail) = cache->depot;
+		cache->depot = head;
+		cache->ndepot += RTDM_CACHE_BATCH;
+		head = NULL;
+	}
+
+	rtdm_lock_put(&cache->lock);
+
+	/* Depot is full, give the batch back to the system heap. */
+	while ((obj = head) != NULL) {
+		head = cache_next(obj);
+		xnfree(obj);
+	}
+}
+
+/**
+ * Create an object cache
+ *
+ * The cache is prefilled with @a capacity objects from the system
+ * heap, which are kept in a depot shared by all CPUs. Each CPU also
+ * keeps up to 2 * @ref RTDM_CACHE_BATCH free objects for itself.
+ * Falling short of system heap memory is not an error at creation
+ * time.
+ *
+ * @param[in,out] cache Cache handle
+ * @param[in] name Symbolic name of the cache, as displayed in
+ * /proc/xenomai/rtdm/caches
+ * @param[in] objsize Size of the cached objects in bytes
+ * @param[in] capacity Number of free objects the shared depot holds
+ * at most
+ *
+ * @return 0 on success, otherwise:
+ *
+ * - -EINVAL is returned if @a objsize is zero.
+ *
+ * - -ENOMEM is returned if the per-CPU lists could not be allocated.
+ *
+ * - -EPERM @e may be returned if an illegal invocation environment is
+ * detected.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - User-space task (non-RT)
+ *
+ * Rescheduling: never.
+ */
+int rtdm_cache_create(rtdm_cache_t *cache, const char *name,
+		      size_t objsize, unsigned int capacity)
+{
+	size_t size;
+	void *obj;
+
+	XENO_ASSERT(RTDM, xnpod_root_p(), return -EPERM;);
+
+	if (objsize == 0)
+		return -EINVAL;
+
+	size = XNARCH_NR_CPUS * sizeof(struct rtdm_cache_cpu);
+	cache->cpus = xnmalloc(size);
+	if (cache->cpus == NULL)
+		return -ENOMEM;
+
+	memset(cache->cpus, 0, size);
+	cache->objsize = ALIGN(objsize, sizeof(void *));
+	cache->capacity = capacity;
+	cache->depot = NULL;
+	cache->ndepot = 0;
+	rtdm_lock_init(&cache->lock);
+	cache->name = name;
+
+	while (cache->ndepot < capacity) {
+		obj = xnmalloc(cache->objsize);
+		if (obj == NULL)
+			break;
+		cache_next(obj) = cache->depot;
+		cache->depot = obj;
+		cache->ndepot++;
+	}
+
+	rtdm_proc_register_cache(cache);
+
+	return 0;
+}
+
+EXPORT_SYMBOL_GPL(rtdm_cache_create);
+
+/**
+ * Destroy an object cache
+ *
+ * The free objects are returned to the system heap. Objects still in
+ * use may be released with rtdm_free() afterwards.
+ *
+ * @param[in,out] cache Cache handle as passed to rtdm_cache_create()
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - User-space task (non-RT)
+ *
+ * Rescheduling: never.
+ */
+void rtdm_cache_destroy(rtdm_cache_t *cache)
+{
+	struct rtdm_cache_cpu *pc;
+	void *obj;
+	int cpu;
+
+	XENO_ASSERT(RTDM, xnpod_root_p(), return;);
+
+	rtdm_proc_unregister_cache(cache);
+
+	for (cpu = 0; cpu < XNARCH_NR_CPUS; cpu++) {
+		pc = &cache->cpus[cpu];
+		while ((obj = pc->head) != NULL) {
+			pc->head = cache_next(obj);
+			xnfree(obj);
+		}
+	}
+
+	while ((obj = cache->depot) != NULL) {
+		cache->depot = cache_next(obj);
+		xnfree(obj);
+	}
+
+	xnfree(cache->cpus);
+}
+
+EXPORT_SYMBOL_GPL(rtdm_cache_destroy);
+
+/**
+ * Allocate an object from a cache
+ *
+ * The object is picked from the free list of the current CPU if
+ * available, which is then refilled by a batch of objects from the
+ * shared depot or the system heap.
+ *
+ * @param[in,out] cache Cache handle as passed to rtdm_cache_create()
+ *
+ * @return The address of the object on success, NULL if the cache is
+ * empty and the system heap is exhausted.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+void *rtdm_cache_alloc(rtdm_cache_t *cache)
+{
+	struct rtdm_cache_cpu *pc;
+	rtdm_lockctx_t context;
+	void *obj;
+
+	rtdm_lock_irqsave(context);
+
+	pc = &cache->cpus[xnarch_current_cpu()];
+	if (unlikely(pc->head == NULL))
+		rtdm_cache_refill(cache, pc);
+
+	obj = pc->head;
+	if (likely(obj != NULL)) {
+		pc->head = cache_next(obj);
+		pc->count--;
+		pc->allocs++;
+	} else
+		pc->failures++;
+
+	rtdm_lock_irqrestore(context);
+
+	return obj;
+}
+
+EXPORT_SYMBOL_GPL(rtdm_cache_alloc);
+
+/**
+ * Release an object to a cache
+ *
+ * The object is kept in the free list of the current CPU. When that
+ * list grows too long, a batch of objects moves to the shared depot,
+ * or to the system heap if the depot is full.
+ *
+ * @param[in,out] cache Cache handle as passed to rtdm_cache_create()
+ * @param[in] obj Object address as returned by rtdm_cache_alloc()
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+void rtdm_cache_free(rtdm_cache_t *cache, void *obj)
+{
+	struct rtdm_cache_cpu *pc;
+	rtdm_lockctx_t context;
+
+	rtdm_lock_irqsave(context);
+
+	pc = &cache->cpus[xnarch_current_cpu()];
+	cache_next(obj) = pc->head;
+	pc->head = obj;
+	pc->count++;
+	pc->frees++;
+
+	if (unlikely(pc->count >= 2 * RTDM_CACHE_BATCH))
+		rtdm_cache_drain(cache, pc);
+
+	rtdm_lock_irqrestore(context);
+}
+
+EXPORT_SYMBOL_GPL(rtdm_cache_free);
+
+/**
+ * Get object cache statistics
+ *
+ * @param[in] cache Cache handle as passed to rtdm_cache_create()
+ * @param[out] stats Statistics, summed over all CPUs
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+void rtdm_cache_get_stats(rtdm_cache_t *cache,
+			  struct rtdm_cache_stats *stats)
+{
+	struct rtdm_cache_cpu *pc;
+	int cpu;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->objsize = cache->objsize;
+	stats->cached = cache->ndepot;
+
+	/* Per-CPU counters are sampled locklessly. */
+	for (cpu = 0; cpu < XNARCH_NR_CPUS; cpu++) {
+		pc = &cache->cpus[cpu];
+		stats->cached += pc->count;
+		stats->allocs += pc->allocs;
+		stats->frees += pc->frees;
+		stats->refills += pc->refills;
+		stats->drains += pc->drains;
+		stats->failures += pc->failures;
+	}
+}
+
+EXPORT_SYMBOL_GPL(rtdm_cache_get_stats);
+
 /** @} Utility Services */
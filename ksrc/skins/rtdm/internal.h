@@ -36,8 +36,20 @@
 #define DEF_DEVNAME_HASHTAB_SIZE	256	/* entries in name hash table */
 #define DEF_PROTO_HASHTAB_SIZE		256	/* entries in protocol hash table */
 
+/*
+ * The descriptor table is allocated by chunks as descriptors get
+ * used, so that a large RTDM_FD_MAX only costs a pointer per chunk
+ * until needed. Chunks are never released before the skin is
+ * unloaded, so that lockless lookups may always dereference them.
+ */
+#define RTDM_FD_CHUNK_SHIFT		6
+#define RTDM_FD_CHUNK_SIZE		(1 << RTDM_FD_CHUNK_SHIFT)
+#define RTDM_FD_CHUNKS			\
+	((RTDM_FD_MAX + RTDM_FD_CHUNK_SIZE - 1) >> RTDM_FD_CHUNK_SHIFT)
+
 struct rtdm_fildes {
 	struct rtdm_dev_context *context;
+	atomic_t lookups;	/* Lockless lookups in progress */
 };
 
 struct rtdm_process {
@@ -53,7 +65,7 @@ DECLARE_EXTERN_XNLOCK(rt_fildes_lock);
 DECLARE_EXTERN_XNLOCK(rt_dev_lock);
 
 extern int __rtdm_muxid;
-extern struct rtdm_fildes fildes_table[];
+extern struct rtdm_fildes *fildes_chunks[];
 extern int open_fildes;
 extern struct semaphore nrt_dev_lock;
 extern unsigned int devname_hashtab_size;
@@ -69,6 +81,19 @@ extern int rtdm_initialised;
 
 void cleanup_owned_contexts(void *user_info);
 int rtdm_no_support(void);
+int rtdm_loop_recvmmsg(struct rtdm_dev_context *context,
+		       rtdm_user_info_t *user_info,
+		       struct rtdm_mmsghdr *msgvec, unsigned int vlen,
+		       int flags);
+int rtdm_loop_sendmmsg(struct rtdm_dev_context *context,
+		       rtdm_user_info_t *user_info,
+		       struct rtdm_mmsghdr *msgvec, unsigned int vlen,
+		       int flags);
+int rtdm_loop_ioctlv(struct rtdm_dev_context *context,
+		     rtdm_user_info_t *user_info,
+		     struct rtdm_ioctl_vec *vec, unsigned int vlen);
+void rtdm_aio_shutdown(struct rtdm_dev_context *context);
+void rtdm_aio_cleanup(struct rtdm_dev_context *context);
 struct rtdm_device *get_named_device(const char *name);
 struct rtdm_device *get_protocol_device(int protocol_family, int socket_type);
 
@@ -77,6 +102,24 @@ static inline void rtdm_dereference_device(struct rtdm_device *device)
 	atomic_dec(&device->reserved.refcount);
 }
 
+/* Returns NULL if @fd is out of range or was never allocated. */
+static inline struct rtdm_fildes *rtdm_fildes_get(int fd)
+{
+	struct rtdm_fildes *chunk;
+
+	if (unlikely((unsigned int)fd >= RTDM_FD_MAX))
+		return NULL;
+
+	chunk = *(struct rtdm_fildes * volatile *)
+		&fildes_chunks[fd >> RTDM_FD_CHUNK_SHIFT];
+	if (unlikely(chunk == NULL))
+		return NULL;
+
+	return &chunk[fd & (RTDM_FD_CHUNK_SIZE - 1)];
+}
+
+void rtdm_fildes_cleanup(void);
+
 int __init rtdm_dev_init(void);
 void rtdm_dev_cleanup(void);
 
@@ -85,23 +128,51 @@ int rtdm_proc_init(void);
 void rtdm_proc_cleanup(void);
 int rtdm_proc_register_device(struct rtdm_device *device);
 void rtdm_proc_unregister_device(struct rtdm_device *device);
+void rtdm_proc_register_irqpoll(rtdm_irqpoll_t *poll);
+void rtdm_proc_unregister_irqpoll(rtdm_irqpoll_t *poll);
+void rtdm_proc_register_cache(rtdm_cache_t *cache);
+void rtdm_proc_unregister_cache(rtdm_cache_t *cache);
 #else
 static inline int rtdm_proc_init(void)
 {
 	return 0;
 }
-void rtdm_proc_cleanup(void)
+static inline void rtdm_proc_cleanup(void)
 {
 }
-static int rtdm_proc_register_device(struct rtdm_device *device)
+static inline int rtdm_proc_register_device(struct rtdm_device *device)
 {
 	return 0;
 }
-static void rtdm_proc_unregister_device(struct rtdm_device *device)
+static inline void rtdm_proc_unregister_device(struct rtdm_device *device)
+{
+}
+static inline void rtdm_proc_register_irqpoll(rtdm_irqpoll_t *poll)
+{
+}
+static inline void rtdm_proc_unregister_irqpoll(rtdm_irqpoll_t *poll)
+{
+}
+static inline void rtdm_proc_register_cache(rtdm_cache_t *cache)
+{
+}
+static inline void rtdm_proc_unregister_cache(rtdm_cache_t *cache)
 {
 }
 #endif
 
 void rtdm_apc_handler(void *cookie);
 
+/* Closure statistics, protected by rt_fildes_lock. */
+struct rtdm_close_stats {
+	unsigned long closes;		/* Completed closures */
+	unsigned long deferred;		/* ... completed by the cleanup work */
+	unsigned long batches;		/* Cleanup work passes */
+	unsigned long max_batch;	/* Largest pass */
+	unsigned long long total;	/* Cumulated closure time (TSC) */
+	unsigned long long max;		/* Longest closure time (TSC) */
+};
+
+extern struct rtdm_close_stats rtdm_close_stats;
+
 #endif /* _RTDM_INTERNAL_H */
@@ -52,6 +52,7 @@ static void __exit rtdm_skin_shutdown(int xtype)
 #ifdef CONFIG_XENO_OPT_PERVASIVE
 	rtdm_syscall_cleanup();
 #endif /* CONFIG_XENO_OPT_PERVASIVE */
+	rtdm_fildes_cleanup();
 	xntbase_free(rtdm_tbase);
 	xnpod_shutdown(xtype);
 }
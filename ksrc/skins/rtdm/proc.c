@@ -223,6 +223,7 @@ static void *openfd_next(struct xnvfile_regular_iterator *it)
 static int openfd_show(struct xnvfile_regular_iterator *it, void *data)
 {
 	struct rtdm_dev_context *context;
+	struct rtdm_fildes *fildes;
 	struct rtdm_device *device;
 	struct rtdm_process owner;
 	int close_lock_count, fd;
@@ -235,9 +236,13 @@ static int openfd_show(struct xnvfile_regular_iterator *it, void *data)
 
 	fd = (int)it->pos - 1;
 
+	fildes = rtdm_fildes_get(fd);
+	if (fildes == NULL)
+		return VFILE_SEQ_SKIP;
+
 	xnlock_get_irqsave(&rt_fildes_lock, s);
 
-	context = fildes_table[fd].context;
+	context = fildes->context;
 	if (context == NULL) {
 		xnlock_put_irqrestore(&rt_fildes_lock, s);
 		return VFILE_SEQ_SKIP;
@@ -305,6 +310,37 @@ static struct xnvfile_regular allfd_vfile = {
 	.ops = &allfd_vfile_ops,
 };
 
+static int close_vfile_show(struct xnvfile_regular_iterator *it, void *data)
+{
+	struct rtdm_close_stats stats;
+	unsigned long long avg = 0;
+	spl_t s;
+
+	xnlock_get_irqsave(&rt_fildes_lock, s);
+	stats = rtdm_close_stats;
+	xnlock_put_irqrestore(&rt_fildes_lock, s);
+
+	if (stats.closes)
+		avg = xnarch_ulldiv(xnarch_tsc_to_ns(stats.total),
+				    stats.closes, NULL);
+
+	xnvfile_printf(it, "closes=%lu:deferred=%lu:batches=%lu:max_batch=%lu\n",
+		       stats.closes, stats.deferred, stats.batches,
+		       stats.max_batch);
+	xnvfile_printf(it, "latency (ns): avg=%Lu:max=%Lu\n",
+		       avg, xnarch_tsc_to_ns(stats.max));
+
+	return 0;
+}
+
+static struct xnvfile_regular_ops close_vfile_ops = {
+	.show = close_vfile_show,
+};
+
+static struct xnvfile_regular close_vfile = {
+	.ops = &close_vfile_ops,
+};
+
 static int devinfo_vfile_show(struct xnvfile_regular_iterator *it, void *data)
 {
 	struct rtdm_device *device;
@@ -345,9 +381,11 @@ found:
 	xnvfile_printf(it, "class:\t\t%d\nsub-class:\t%d\n",
 		       device->device_class, device->device_sub_class);
 
-	xnvfile_printf(it, "flags:\t\t%s%s%s\n",
+	xnvfile_printf(it, "flags:\t\t%s%s%s%s\n",
 		       (device->device_flags & RTDM_EXCLUSIVE) ?
 		       "EXCLUSIVE  " : "",
+		       (device->device_flags & RTDM_CONTEXT_CACHE) ?
+		       "CONTEXT_CACHE  " : "",
 		       (device->device_flags & RTDM_NAMED_DEVICE) ?
 		       "NAMED_DEVICE  " : "",
 		       (device->device_flags & RTDM_PROTOCOL_DEVICE) ?
@@ -356,6 +394,12 @@ found:
 	xnvfile_printf(it, "lock count:\t%d\n",
 		       atomic_read(&device->reserved.refcount));
 
+	if (!device->reserved.exclusive_context &&
+	    (device->device_flags & RTDM_CONTEXT_CACHE))
+		xnvfile_printf(it, "context cache:\tused=%d:free=%d\n",
+			       device->reserved.context_pool.nused,
+			       device->reserved.context_pool.nfree);
+
 	up(&nrt_dev_lock);
 	return 0;
 }
@@ -364,6 +408,163 @@ static struct xnvfile_regular_ops devinfo_vfile_ops = {
 	.show = devinfo_vfile_show,
 };
 
+static LIST_HEAD(irqpoll_list);	/* protected by nrt_dev_lock */
+
+static void *irqpoll_at(loff_t pos)
+{
+	struct list_head *curr;
+
+	list_for_each(curr, &irqpoll_list)
+		if (--pos == 0)
+			return curr;
+
+	return NULL;
+}
+
+static void *irqpoll_begin(struct xnvfile_regular_iterator *it)
+{
+	if (list_empty(&irqpoll_list))
+		return NULL;
+
+	if (it->pos == 0)
+		return VFILE_SEQ_START;
+
+	return irqpoll_at(it->pos);
+}
+
+static void *irqpoll_next(struct xnvfile_regular_iterator *it)
+{
+	return irqpoll_at(it->pos);
+}
+
+static int irqpoll_show(struct xnvfile_regular_iterator *it, void *data)
+{
+	struct rtdm_irqpoll_stats stats;
+	rtdm_irqpoll_t *poll;
+
+	if (data == VFILE_SEQ_START) {
+		xnvfile_printf(it, "%-4s %-5s %-10s %-10s %-8s %-8s %s\n",
+			       "IRQ", "MODE", "IRQS", "POLLS",
+			       "TO-POLL", "TO-IRQ", "NAME");
+		return 0;
+	}
+
+	poll = list_entry((struct list_head *)data, rtdm_irqpoll_t, link);
+	rtdm_irqpoll_get_stats(poll, &stats);
+
+	xnvfile_printf(it, "%-4u %-5s %-10lu %-10lu %-8lu %-8lu %s\n",
+		       poll->irq_handle->irq,
+		       poll->polling ? "poll" : "irq",
+		       stats.irqs, stats.polls,
+		       stats.to_poll, stats.to_irq,
+		       poll->name);
+
+	return 0;
+}
+
+static struct xnvfile_regular_ops irqpoll_vfile_ops = {
+	.begin = irqpoll_begin,
+	.next = irqpoll_next,
+	.show = irqpoll_show,
+};
+
+static struct xnvfile_regular irqpoll_vfile = {
+	.ops = &irqpoll_vfile_ops,
+	.entry = { .lockops = &lockops }
+};
+
+void rtdm_proc_register_irqpoll(rtdm_irqpoll_t *poll)
+{
+	down(&nrt_dev_lock);
+	list_add_tail(&poll->link, &irqpoll_list);
+	up(&nrt_dev_lock);
+}
+
+void rtdm_proc_unregister_irqpoll(rtdm_irqpoll_t *poll)
+{
+	down(&nrt_dev_lock);
+	list_del(&poll->link);
+	up(&nrt_dev_lock);
+}
+
+static LIST_HEAD(cache_list);	/* protected by nrt_dev_lock */
+
+static void *cache_at(loff_t pos)
+{
+	struct list_head *curr;
+
+	list_for_each(curr, &cache_list)
+		if (--pos == 0)
+			return curr;
+
+	return NULL;
+}
+
+static void *cache_begin(struct xnvfile_regular_iterator *it)
+{
+	if (list_empty(&cache_list))
+		return NULL;
+
+	if (it->pos == 0)
+		return VFILE_SEQ_START;
+
+	return cache_at(it->pos);
+}
+
+static void *cache_next(struct xnvfile_regular_iterator *it)
+{
+	return cache_at(it->pos);
+}
+
+static int cache_show(struct xnvfile_regular_iterator *it, void *data)
+{
+	struct rtdm_cache_stats stats;
+	rtdm_cache_t *cache;
+
+	if (data == VFILE_SEQ_START) {
+		xnvfile_printf(it, "%-6s %-6s %-10s %-10s %-8s %-8s %-6s %s\n",
+			       "OBJSZ", "CACHED", "ALLOCS", "FREES",
+			       "REFILLS", "DRAINS", "FAILS", "NAME");
+		return 0;
+	}
+
+	cache = list_entry((struct list_head *)data, rtdm_cache_t, link);
+	rtdm_cache_get_stats(cache, &stats);
+
+	xnvfile_printf(it, "%-6lu %-6lu %-10lu %-10lu %-8lu %-8lu %-6lu %s\n",
+		       (unsigned long)stats.objsize, stats.cached,
+		       stats.allocs, stats.frees,
+		       stats.refills, stats.drains,
+		       stats.failures, cache->name);
+
+	return 0;
+}
+
+static struct xnvfile_regular_ops cache_vfile_ops = {
+	.begin = cache_begin,
+	.next = cache_next,
+	.show = cache_show,
+};
+
+static struct xnvfile_regular cache_vfile = {
+	.ops = &cache_vfile_ops,
+	.entry = { .lockops = &lockops }
+};
+
+void rtdm_proc_register_cache(rtdm_cache_t *cache)
+{
+	down(&nrt_dev_lock);
+	list_add_tail(&cache->link, &cache_list);
+	up(&nrt_dev_lock);
+}
+
+void rtdm_proc_unregister_cache(rtdm_cache_t *cache)
+{
+	down(&nrt_dev_lock);
+	list_del(&cache->link);
+	up(&nrt_dev_lock);
+}
+
 int rtdm_proc_register_device(struct rtdm_device *device)
 {
 	int ret;
@@ -423,6 +624,18 @@ int __init rtdm_proc_init(void)
 	if (ret)
 		goto error;
 
+	ret = xnvfile_init_regular("close", &close_vfile, &rtdm_vfroot);
+	if (ret)
+		goto error;
+
+	ret = xnvfile_init_regular("irq_polling", &irqpoll_vfile, &rtdm_vfroot);
+	if (ret)
+		goto error;
+
+	ret = xnvfile_init_regular("caches", &cache_vfile, &rtdm_vfroot);
+	if (ret)
+		goto error;
+
 	return 0;
 
 error:
@@ -432,6 +645,9 @@ error:
 
 void rtdm_proc_cleanup(void)
 {
+	xnvfile_destroy_regular(&cache_vfile);
+	xnvfile_destroy_regular(&irqpoll_vfile);
+	xnvfile_destroy_regular(&close_vfile);
 	xnvfile_destroy_regular(&allfd_vfile);
 	xnvfile_destroy_regular(&openfd_vfile);
 	xnvfile_destroy_regular(&proto_vfile);
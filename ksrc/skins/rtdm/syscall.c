@@ -25,6 +25,12 @@
 
 int __rtdm_muxid;
 
+/* Number of message descriptors mirrored at once by the mmsg calls. */
+#define RTDM_MMSG_BATCH		8
+
+/* Number of request descriptors mirrored at once by the ioctlv call. */
+#define RTDM_IOCTLV_BATCH	16
+
 static int sys_rtdm_fdcount(struct pt_regs *regs)
 {
 	return RTDM_FD_MAX;
@@ -116,6 +122,154 @@ static int sys_rtdm_sendmsg(struct pt_regs *regs)
 				__xn_reg_arg3(regs));
 }
 
+static int __sys_rtdm_mmsg(struct pt_regs *regs, int send)
+{
+	struct rtdm_mmsghdr krnl_vec[RTDM_MMSG_BATCH];
+	struct rtdm_mmsghdr __user *u_vec;
+	struct task_struct *p = current;
+	unsigned int vlen, n, done = 0;
+	int fd, flags, ret = 0;
+
+	fd = __xn_reg_arg1(regs);
+	u_vec = (struct rtdm_mmsghdr __user *)__xn_reg_arg2(regs);
+	vlen = __xn_reg_arg3(regs);
+	flags = __xn_reg_arg4(regs);
+
+	while (done < vlen) {
+		n = vlen - done;
+		if (n > RTDM_MMSG_BATCH)
+			n = RTDM_MMSG_BATCH;
+
+		if (unlikely(!access_wok(u_vec + done,
+					 n * sizeof(krnl_vec[0])) ||
+			     __xn_copy_from_user(krnl_vec, u_vec + done,
+						 n * sizeof(krnl_vec[0])))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		if (send)
+			ret = __rt_dev_sendmmsg(p, fd, krnl_vec, n, flags);
+		else
+			ret = __rt_dev_recvmmsg(p, fd, krnl_vec, n, flags);
+		if (ret <= 0)
+			break;
+
+		if (unlikely(__xn_copy_to_user(u_vec + done, krnl_vec,
+					       ret * sizeof(krnl_vec[0])))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		done += ret;
+		if (ret < n)
+			break;
+
+		/* Only the first message may be waited for. */
+		if (!send)
+			flags |= MSG_DONTWAIT;
+	}
+
+	return done > 0 ? done : ret;
+}
+
+static int sys_rtdm_recvmmsg(struct pt_regs *regs)
+{
+	return __sys_rtdm_mmsg(regs, 0);
+}
+
+static int sys_rtdm_sendmmsg(struct pt_regs *regs)
+{
+	return __sys_rtdm_mmsg(regs, 1);
+}
+
+static int sys_rtdm_ioctlv(struct pt_regs *regs)
+{
+	struct rtdm_ioctl_vec krnl_vec[RTDM_IOCTLV_BATCH];
+	struct rtdm_ioctl_vec __user *u_vec;
+	struct task_struct *p = current;
+	unsigned int vlen, n, done = 0;
+	int fd, ret = 0;
+
+	fd = __xn_reg_arg1(regs);
+	u_vec = (struct rtdm_ioctl_vec __user *)__xn_reg_arg2(regs);
+	vlen = __xn_reg_arg3(regs);
+
+	while (done < vlen) {
+		n = vlen - done;
+		if (n > RTDM_IOCTLV_BATCH)
+			n = RTDM_IOCTLV_BATCH;
+
+		if (unlikely(!access_wok(u_vec + done,
+					 n * sizeof(krnl_vec[0])) ||
+			     __xn_copy_from_user(krnl_vec, u_vec + done,
+						 n * sizeof(krnl_vec[0])))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		ret = __rt_dev_ioctlv(p, fd, krnl_vec, n);
+		if (ret < 0) {
+			/* Past the first batch, report in the entry. */
+			if (done > 0)
+				__xn_put_user(ret, &u_vec[done].result);
+			break;
+		}
+
+		/* Include the result of the failing request, if any. */
+		if (unlikely(__xn_copy_to_user(u_vec + done, krnl_vec,
+					       (ret < n ? ret + 1 : n) *
+					       sizeof(krnl_vec[0])))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		done += ret;
+		if (ret < n)
+			break;
+	}
+
+	return done > 0 ? done : ret;
+}
+
+static int sys_rtdm_aio_setup(struct pt_regs *regs)
+{
+	struct task_struct *p = current;
+	struct rtdm_aio_params params;
+	int ret;
+
+	if (unlikely(!access_wok(__xn_reg_arg2(regs), sizeof(params)) ||
+		     __xn_copy_from_user(&params,
+					 (void __user *)__xn_reg_arg2(regs),
+					 sizeof(params))))
+		return -EFAULT;
+
+	ret = __rt_dev_aio_setup(p, __xn_reg_arg1(regs), &params);
+	if (ret)
+		return ret;
+
+	if (unlikely(__xn_copy_to_user((void __user *)__xn_reg_arg2(regs),
+				       &params, sizeof(params))))
+		return -EFAULT;
+
+	return 0;
+}
+
+static int sys_rtdm_aio_enter(struct pt_regs *regs)
+{
+	nanosecs_rel_t timeout = RTDM_TIMEOUT_INFINITE;
+
+	if (__xn_reg_arg4(regs) &&
+	    __xn_safe_copy_from_user(&timeout,
+				     (void __user *)__xn_reg_arg4(regs),
+				     sizeof(timeout)))
+		return -EFAULT;
+
+	return __rt_dev_aio_enter(current, __xn_reg_arg1(regs),
+				  __xn_reg_arg2(regs), __xn_reg_arg3(regs),
+				  timeout);
+}
+
 static void *rtdm_skin_callback(int event, void *data)
 {
 	struct rtdm_process *process;
@@ -162,6 +316,15 @@ static xnsysent_t __systab[] = {
 	    {sys_rtdm_recvmsg, __xn_exec_current | __xn_exec_adaptive},
 	[__rtdm_sendmsg] =
 	    {sys_rtdm_sendmsg, __xn_exec_current | __xn_exec_adaptive},
+	[__rtdm_recvmmsg] =
+	    {sys_rtdm_recvmmsg, __xn_exec_current | __xn_exec_adaptive},
+	[__rtdm_sendmmsg] =
+	    {sys_rtdm_sendmmsg, __xn_exec_current | __xn_exec_adaptive},
+	[__rtdm_aio_setup] = {sys_rtdm_aio_setup, __xn_exec_lostage},
+	[__rtdm_aio_enter] =
+	    {sys_rtdm_aio_enter, __xn_exec_current | __xn_exec_adaptive},
+	[__rtdm_ioctlv] =
+	    {sys_rtdm_ioctlv, __xn_exec_current | __xn_exec_adaptive},
 };
 
 static struct xnskin_props __props = {
@@ -26,6 +26,7 @@
 #define uITRON_MAX_FLAGID 32	/* [1..32] */
 #define uITRON_MAX_MBXID  32	/* [1..32] */
 #define uITRON_MAX_MBFID  32	/* [1..32] */
+#define uITRON_MAX_MPRI   32	/* [1..32], message priorities */
 #define uITRON_MAX_IDS    64
 
 #if XNMAP_MAX_KEYS < uITRON_MAX_IDS
@@ -77,9 +77,10 @@ static int vfile_show(struct xnvfile_snapshot_iterator *it, void *data)
 
 	if (p == NULL) {	/* Dump header. */
 		/* Always dump mailbox value. */
-		xnvfile_printf(it, "%d/%d message(s), attr=%s\n",
+		xnvfile_printf(it, "%d/%d message(s), attr=%s|%s\n",
 			       priv->mcount, priv->bufcnt,
-			       priv->mbxatr & TA_TPRI ? "TA_TPRI" : "TA_TFIFO");
+			       priv->mbxatr & TA_TPRI ? "TA_TPRI" : "TA_TFIFO",
+			       priv->mbxatr & TA_MPRI ? "TA_MPRI" : "TA_MFIFO");
 		if (it->nrdata > 0)
 			xnvfile_printf(it, "--------------------\n");
 	} else
@@ -132,10 +133,99 @@ void uimbx_cleanup(void)
 	xnmap_delete(ui_mbx_idmap);
 }
 
+static struct uimbx_pq *ui_mbx_alloc_pq(INT bufcnt)
+{
+	struct uimbx_pq *pq;
+	int n;
+
+	pq = xnmalloc(sizeof(*pq) + sizeof(struct uimbx_slot) * bufcnt);
+	if (pq == NULL)
+		return NULL;
+
+	pq->primap = 0;
+	pq->freelist = 0;
+	for (n = 0; n < bufcnt; n++)
+		pq->slots[n].next = n + 1;
+	pq->slots[bufcnt - 1].next = -1;
+
+	return pq;
+}
+
+/* Must be called nklocked, with room left in the mailbox. */
+static void ui_mbx_put(uimbx_t *mbx, T_MSG *pk_msg, PRI msgpri)
+{
+	struct uimbx_pq *pq = mbx->pq;
+	int level, slot;
+
+	if (pq == NULL) {
+		mbx->ring[mbx->wrptr] = pk_msg;
+		mbx->wrptr = (mbx->wrptr + 1) % mbx->bufcnt;
+		mbx->mcount++;
+		return;
+	}
+
+	level = msgpri - 1;
+	slot = pq->freelist;
+	pq->freelist = pq->slots[slot].next;
+	pq->slots[slot].msg = pk_msg;
+	pq->slots[slot].next = -1;
+
+	if (pq->primap & (1UL << level))
+		pq->slots[pq->tail[level]].next = slot;
+	else {
+		pq->head[level] = slot;
+		pq->primap |= (1UL << level);
+	}
+
+	pq->tail[level] = slot;
+	mbx->mcount++;
+}
+
+/* Must be called nklocked, with messages pending in the mailbox. */
+static T_MSG *ui_mbx_peek(uimbx_t *mbx)
+{
+	struct uimbx_pq *pq = mbx->pq;
+
+	if (pq == NULL)
+		return mbx->ring[mbx->rdptr];
+
+	/* The lowest level holds the most urgent messages. */
+	return pq->slots[pq->head[ffnz(pq->primap)]].msg;
+}
+
+/* Must be called nklocked, with messages pending in the mailbox. */
+static T_MSG *ui_mbx_get(uimbx_t *mbx)
+{
+	struct uimbx_pq *pq = mbx->pq;
+	int level, slot;
+	T_MSG *pk_msg;
+
+	mbx->mcount--;
+
+	if (pq == NULL) {
+		pk_msg = mbx->ring[mbx->rdptr];
+		mbx->rdptr = (mbx->rdptr + 1) % mbx->bufcnt;
+		return pk_msg;
+	}
+
+	level = ffnz(pq->primap);
+	slot = pq->head[level];
+	pk_msg = pq->slots[slot].msg;
+	pq->head[level] = pq->slots[slot].next;
+	if (pq->head[level] < 0)
+		pq->primap &= ~(1UL << level);
+
+	pq->slots[slot].next = pq->freelist;
+	pq->freelist = slot;
+
+	return pk_msg;
+}
+
 ER cre_mbx(ID mbxid, T_CMBX *pk_cmbx)
 {
+	struct uimbx_pq *pq = NULL;
+	T_MSG **ring = NULL;
 	uimbx_t *mbx;
-	T_MSG **ring;
 
 	if (xnpod_asynch_p())
 		return EN_CTXID;
@@ -146,17 +236,17 @@ ER cre_mbx(ID mbxid, T_CMBX *pk_cmbx)
 	if (pk_cmbx->bufcnt <= 0)
 		return E_PAR;
 
-	if (pk_cmbx->mbxatr & TA_MPRI)
-		return E_RSATR;
-
 	mbx = xnmalloc(sizeof(*mbx));
 
 	if (!mbx)
 		return E_NOMEM;
 
-	ring = xnmalloc(sizeof(T_MSG *) * pk_cmbx->bufcnt);
+	if (pk_cmbx->mbxatr & TA_MPRI)
+		pq = ui_mbx_alloc_pq(pk_cmbx->bufcnt);
+	else
+		ring = xnmalloc(sizeof(T_MSG *) * pk_cmbx->bufcnt);
 
-	if (!ring) {
+	if (!ring && !pq) {
 		xnfree(mbx);
 		return E_NOMEM;
 	}
@@ -164,6 +254,10 @@ ER cre_mbx(ID mbxid, T_CMBX *pk_cmbx)
 	mbxid = xnmap_enter(ui_mbx_idmap, mbxid, mbx);
 
 	if (mbxid <= 0) {
+		if (pq)
+			xnfree(pq);
+		else
+			xnfree(ring);
 		xnfree(mbx);
 		return E_OBJ;
 	}
@@ -180,6 +274,7 @@ ER cre_mbx(ID mbxid, T_CMBX *pk_cmbx)
 	mbx->wrptr = 0;
 	mbx->mcount = 0;
 	mbx->ring = ring;
+	mbx->pq = pq;
 	sprintf(mbx->name, "mbx%d", mbxid);
 	xnregistry_enter(mbx->name, mbx, &mbx->handle, &__mbx_pnode.node);
 	xnarch_memory_barrier();
@@ -211,7 +306,10 @@ ER del_mbx(ID mbxid)
 	xnmap_remove(ui_mbx_idmap, mbx->id);
 	ui_mark_deleted(mbx);
 	xnregistry_remove(mbx->handle);
-	xnfree(mbx->ring);
+	if (mbx->pq)
+		xnfree(mbx->pq);
+	else
+		xnfree(mbx->ring);
 	xnfree(mbx);
 
 	if (xnsynch_destroy(&mbx->synchbase) == XNSYNCH_RESCHED)
@@ -222,12 +320,16 @@ ER del_mbx(ID mbxid)
 	return E_OK;
 }
 
-ER snd_msg(ID mbxid, T_MSG *pk_msg)
+/*
+ * The priority is only read for TA_MPRI mailboxes, from @msgpri if
+ * non-NULL, or else from the T_MSG_PRI container of @pk_msg.
+ */
+ER ui_snd_msg(ID mbxid, T_MSG *pk_msg, const PRI *msgpri)
 {
 	uitask_t *sleeper;
 	ER err = E_OK;
 	uimbx_t *mbx;
-	int wrptr;
+	PRI pri = 0;
 	spl_t s;
 
 	if (mbxid <= 0 || mbxid > uITRON_MAX_MBXID)
@@ -242,6 +344,19 @@ ER snd_msg(ID mbxid, T_MSG *pk_msg)
 		goto unlock_and_exit;
 	}
 
+	if (mbx->pq) {
+		pri = msgpri ? *msgpri :
+			container_of(pk_msg, T_MSG_PRI, msgque)->msgpri;
+		if (pri <= 0 || pri > uITRON_MAX_MPRI) {
+			err = E_PAR;
+			goto unlock_and_exit;
+		}
+	}
+
+	/*
+	 * Receivers only wait on empty mailboxes, so the message goes
+	 * straight to the first one whatever its priority.
+	 */
 	sleeper = thread2uitask(xnsynch_wakeup_one_sleeper(&mbx->synchbase));
 
 	if (sleeper) {
@@ -250,15 +365,10 @@ ER snd_msg(ID mbxid, T_MSG *pk_msg)
 		goto unlock_and_exit;
 	}
 
-	wrptr = mbx->wrptr;
-
-	if (mbx->mcount > 0 && wrptr == mbx->rdptr)
+	if (mbx->mcount >= mbx->bufcnt)
 		err = E_QOVR;
-	else {
-		mbx->ring[wrptr] = pk_msg;
-		mbx->wrptr = (wrptr + 1) % mbx->bufcnt;
-		mbx->mcount++;
-	}
+	else
+		ui_mbx_put(mbx, pk_msg, pri);
 
 unlock_and_exit:
 
@@ -267,6 +377,11 @@ unlock_and_exit:
 	return err;
 }
 
+ER snd_msg(ID mbxid, T_MSG *pk_msg)
+{
+	return ui_snd_msg(mbxid, pk_msg, NULL);
+}
+
 static ER rcv_msg_helper(T_MSG ** ppk_msg, ID mbxid, TMO tmout)
 {
 	xnticks_t timeout;
@@ -300,9 +415,7 @@ static ER rcv_msg_helper(T_MSG ** ppk_msg, ID mbxid, TMO tmout)
 	}
 
 	if (mbx->mcount > 0) {
-		*ppk_msg = mbx->ring[mbx->rdptr];
-		mbx->rdptr = (mbx->rdptr + 1) % mbx->bufcnt;
-		mbx->mcount--;
+		*ppk_msg = ui_mbx_get(mbx);
 		goto unlock_and_exit;
 	}
 
@@ -381,7 +494,7 @@ ER ref_mbx(T_RMBX *pk_rmbx, ID mbxid)
 
 	pk_rmbx->exinf = mbx->exinf;
 	pk_rmbx->pk_msg =
-	    mbx->mcount > 0 ? mbx->ring[mbx->rdptr] : (T_MSG *) NADR;
+	    mbx->mcount > 0 ? ui_mbx_peek(mbx) : (T_MSG *) NADR;
 
 unlock_and_exit:
 
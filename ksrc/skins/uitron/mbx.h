@@ -26,6 +26,24 @@
 
 #define uITRON_MBX_MAGIC 0x85850404
 
+struct uimbx_slot {
+    T_MSG *msg;
+    int next;			/* !< Next slot in level or free list, -1 if none. */
+};
+
+/*
+ * Message queue of TA_MPRI mailboxes: one FIFO of slots per priority
+ * level, with a bitmap of the non-empty levels so that both insertion
+ * and removal are O(1).
+ */
+struct uimbx_pq {
+    unsigned long primap;	/* !< Bit #n set if level n+1 is non-empty. */
+    int freelist;
+    int head[uITRON_MAX_MPRI];
+    int tail[uITRON_MAX_MPRI];
+    struct uimbx_slot slots[0];
+};
+
 typedef struct uimbx {
 
     unsigned magic;		/* !< Magic code - must be first. */
@@ -44,7 +62,9 @@ typedef struct uimbx {
 
     UINT mcount;
 
-    T_MSG **ring;
+    T_MSG **ring;		/* !< Message ring of TA_MFIFO mailboxes. */
+
+    struct uimbx_pq *pq;	/* !< Message queue of TA_MPRI mailboxes. */
 
     xnsynch_t synchbase;
 
@@ -66,6 +86,8 @@ extern "C" {
 
 int uimbx_init(void);
 
+ER ui_snd_msg(ID mbxid, T_MSG *pk_msg, const PRI *msgpri);
+
 void uimbx_cleanup(void);
 
 static inline void ui_mbx_flush_rq(xnqueue_t *rq)
@@ -637,8 +637,21 @@ static int __ui_snd_msg(struct pt_regs *regs)
 {
 	ID mbxid = __xn_reg_arg1(regs);
 	T_MSG __user *pk_msg = (T_MSG __user *) __xn_reg_arg2(regs);
-
-	return snd_msg(mbxid, pk_msg);
+	PRI msgpri;
+
+	/*
+	 * Messages stay in user-space, only fetch their priority from
+	 * the enclosing T_MSG_PRI. Plain T_MSGs sent to TA_MFIFO
+	 * mailboxes have no such header, so a fault is not an error
+	 * here; it leaves a priority TA_MPRI mailboxes reject.
+	 */
+	if (__xn_safe_copy_from_user(&msgpri,
+				     (char __user *)pk_msg -
+				     offsetof(T_MSG_PRI, msgque),
+				     sizeof(msgpri)))
+		msgpri = 0;
+
+	return ui_snd_msg(mbxid, pk_msg, &msgpri);
 }
 
 /*
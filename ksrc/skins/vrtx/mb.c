@@ -28,6 +28,18 @@ static xnqueue_t vrtx_mbox_q;
  * the VRTX services are never dereferenced, but only used as hash
  * keys. */
 
+/*
+ * Mailbox descriptors are never released until the skin is unloaded,
+ * so the hash chains may be walked without locking, provided new
+ * descriptors are fully built before being linked. sc_post(),
+ * sc_accept() and sc_pend() then only swap the message word with
+ * cmpxchg. The nklock is grabbed by sc_pend() when the mailbox is
+ * empty, and by sc_post() when some task waits for a message: the
+ * waiter counts itself in ->npend before checking the mailbox a last
+ * time, while the poster reads ->npend after storing the message, so
+ * that a wakeup cannot be missed.
+ */
+
 #ifdef CONFIG_XENO_OPT_VFILE
 
 struct vfile_priv {
@@ -45,7 +57,7 @@ static int vfile_rewind(struct xnvfile_snapshot_iterator *it)
 	struct vrtxmb *mb = xnvfile_priv(it->vfile);
 
 	priv->curr = getheadpq(xnsynch_wait_queue(&mb->synchbase));
-	priv->msg = mb->msg;
+	priv->msg = (char *)xnarch_atomic_get(&mb->msg);
 
 	return xnsynch_nsleepers(&mb->synchbase);
 }
@@ -139,6 +151,8 @@ static void mb_hash(char **pkey, vrtxmb_t * mb)
 
 	xnlock_get_irqsave(&nklock, s);
 	mb->hnext = *bucketp;
+	/* Lockless readers must see a complete descriptor. */
+	xnarch_write_memory_barrier();
 	*bucketp = mb;
 	xnlock_put_irqrestore(&nklock, s);
 }
@@ -168,23 +182,22 @@ static void mb_unhash(char **pkey)
 	xnlock_put_irqrestore(&nklock, s);
 }
 
+/* May be called locklessly, descriptors are never unhashed at runtime. */
 static vrtxmb_t *mb_find(char **pkey)
 {
 	union jhash_union hkey = {.key = pkey };
 	uint32_t hash;
 	vrtxmb_t *mb;
-	spl_t s;
 
 	hash = jhash2(&hkey.val, sizeof(pkey) / sizeof(uint32_t), 0);
 
-	xnlock_get_irqsave(&nklock, s);
-
 	mb = jhash_buckets[hash & ((1 << MB_HASHBITS) - 1)];
+	xnarch_read_memory_barrier();
 
-	while (mb != NULL && mb->mboxp != pkey)
+	while (mb != NULL && mb->mboxp != pkey) {
 		mb = mb->hnext;
-
-	xnlock_put_irqrestore(&nklock, s);
+		xnarch_read_memory_barrier();
+	}
 
 	return mb;
 }
@@ -231,7 +244,8 @@ vrtxmb_t *mb_map(char **mboxp)
 
 	inith(&mb->link);
 	mb->mboxp = mboxp;
-	mb->msg = NULL;
+	xnarch_atomic_set(&mb->msg, 0);
+	mb->npend = 0;
 	mb->hnext = NULL;
 	xnsynch_init(&mb->synchbase, XNSYNCH_PRIO | XNSYNCH_DREORD, NULL);
 	appendq(&vrtx_mbox_q, &mb->link);
@@ -243,86 +257,126 @@ vrtxmb_t *mb_map(char **mboxp)
 	return mb;
 }
 
-char *sc_accept(char **mboxp, int *errp)
+static vrtxmb_t *mb_lookup(char **mboxp)
 {
-	char *msg = NULL;
 	vrtxmb_t *mb;
 	spl_t s;
 
-	xnlock_get_irqsave(&nklock, s);
+	mb = mb_find(mboxp);
+	if (likely(mb != NULL))
+		return mb;
 
+	xnlock_get_irqsave(&nklock, s);
 	mb = mb_map(mboxp);
+	xnlock_put_irqrestore(&nklock, s);
 
-	if (!mb) {
-		*errp = ER_NOCB;
-		goto unlock_and_exit;
-	}
+	return mb;
+}
 
-	msg = mb->msg;
+/* Fetch the pending message, NULL if the mailbox is empty. */
+static inline char *mb_take(vrtxmb_t *mb)
+{
+	long msg;
 
-	if (msg == NULL)
-		*errp = ER_NMP;
-	else {
-		mb->msg = NULL;
-		*errp = RET_OK;
-	}
+	do {
+		msg = xnarch_atomic_get(&mb->msg);
+		if (msg == 0)
+			return NULL;
+	} while (xnarch_atomic_cmpxchg(&mb->msg, msg, 0) != msg);
 
-      unlock_and_exit:
+	return (char *)msg;
+}
 
-	xnlock_put_irqrestore(&nklock, s);
+char *sc_accept(char **mboxp, int *errp)
+{
+	vrtxmb_t *mb;
+	char *msg;
+
+	mb = mb_lookup(mboxp);
+
+	if (!mb) {
+		*errp = ER_NOCB;
+		return NULL;
+	}
+
+	msg = mb_take(mb);
+	*errp = msg ? RET_OK : ER_NMP;
 
 	return msg;
 }
 
 char *sc_pend(char **mboxp, long timeout, int *errp)
 {
-	char *msg = NULL;
+	xntmode_t timeout_mode = XN_RELATIVE;
+	xnticks_t date = timeout;
 	vrtxtask_t *task;
 	vrtxmb_t *mb;
+	char *msg;
 	spl_t s;
 
-	xnlock_get_irqsave(&nklock, s);
-
-	mb = mb_map(mboxp);
+	mb = mb_lookup(mboxp);
 
 	if (!mb) {
 		*errp = ER_NOCB;
-		goto unlock_and_exit;
+		return NULL;
 	}
 
-	if (mb->msg != NULL)
-		goto done;
+	msg = mb_take(mb);
+	if (msg) {
+		*errp = RET_OK;
+		return msg;
+	}
 
 	if (xnpod_unblockable_p()) {
 		*errp = -EPERM;
-		goto unlock_and_exit;
+		return NULL;
 	}
 
 	task = vrtx_current_task();
-	task->vrtxtcb.TCBSTAT = TBSMBOX;
 
-	if (timeout)
-		task->vrtxtcb.TCBSTAT |= TBSDELAY;
+	/* We may have to sleep several times, use an absolute date. */
+	if (timeout) {
+		timeout_mode = XN_REALTIME;
+		date += xntbase_get_time(vrtx_tbase);
+	}
 
-	xnsynch_sleep_on(&mb->synchbase, timeout, XN_RELATIVE);
+	xnlock_get_irqsave(&nklock, s);
 
-	if (xnthread_test_info(&task->threadbase, XNBREAK)) {
-		*errp = -EINTR;
-		goto unlock_and_exit;
-	}
+	mb->npend++;
+	xnarch_memory_barrier();
 
-	if (xnthread_test_info(&task->threadbase, XNTIMEO)) {
-		*errp = ER_TMO;
-		goto unlock_and_exit;
-	}
+	for (;;) {
+		msg = mb_take(mb);
+		if (msg) {
+			*errp = RET_OK;
+			break;
+		}
 
-      done:
+		task->vrtxtcb.TCBSTAT = TBSMBOX;
 
-	msg = mb->msg;
-	mb->msg = NULL;
-	*errp = RET_OK;
+		if (timeout)
+			task->vrtxtcb.TCBSTAT |= TBSDELAY;
 
-      unlock_and_exit:
+		xnsynch_sleep_on(&mb->synchbase, date, timeout_mode);
+
+		if (xnthread_test_info(&task->threadbase, XNBREAK)) {
+			*errp = -EINTR;
+			break;
+		}
+
+		if (xnthread_test_info(&task->threadbase, XNTIMEO)) {
+			*errp = ER_TMO;
+			break;
+		}
+
+		/*
+		 * The message we were woken up for may have been
+		 * fetched by sc_accept() meanwhile, in which case we
+		 * go back waiting until the initial deadline.
+		 */
+	}
+
+	mb->npend--;
 
 	xnlock_put_irqrestore(&nklock, s);
 
@@ -339,28 +393,31 @@ void sc_post(char **mboxp, char *msg, int *errp)
 		return;
 	}
 
-	xnlock_get_irqsave(&nklock, s);
-
-	mb = mb_map(mboxp);
+	mb = mb_lookup(mboxp);
 
 	if (!mb) {
 		*errp = ER_NOCB;
-		goto unlock_and_exit;
+		return;
 	}
 
-	if (mb->msg != NULL) {
+	if (xnarch_atomic_cmpxchg(&mb->msg, 0, (long)msg) != 0) {
 		*errp = ER_MIU;
-		goto unlock_and_exit;
+		return;
 	}
 
-	mb->msg = msg;
 	*errp = RET_OK;
 
+	/* Pairs with the barrier in sc_pend(). */
+	xnarch_memory_barrier();
+
+	if (likely(mb->npend == 0))
+		return;
+
+	xnlock_get_irqsave(&nklock, s);
+
 	/* xnsynch_wakeup_one_sleeper() readies the front thread */
 	if (xnsynch_wakeup_one_sleeper(&mb->synchbase))
 		xnpod_schedule();
 
-      unlock_and_exit:
-
 	xnlock_put_irqrestore(&nklock, s);
 }
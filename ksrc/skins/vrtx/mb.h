@@ -42,9 +42,13 @@ typedef struct vrtxmb {
        anyway, except perhaps for post-mortem analysis. In the latter
        case, the debugging code should fetch the last posted value
        from ->msg instead of dereferencing the mailbox pointer
-       directly. */
+       directly. Posting and fetching are done by exchanging this
+       word atomically, so that the nklock is only needed when a
+       task has to sleep or to be woken up. */
 
-    char *msg;
+    xnarch_atomic_t msg;
+
+    int npend;	/* Tasks waiting in sc_pend(), under nklock. */
 
     struct vrtxmb *hnext;
 
@@ -25,6 +25,153 @@ static xnmap_t *vrtx_queue_idmap;
 
 static xnqueue_t vrtx_queue_q;
 
+/*
+ * Messages are kept in a bounded ring of cells (D. Vyukov's MPMC
+ * algorithm), each cell carrying the ring position it may be written
+ * or read at next, so that sc_qpost(), sc_qpend() and sc_qaccept()
+ * may proceed without the nklock when no task is waiting on the
+ * queue. Jamming, broadcasting, inquiring, deleting and pending
+ * tasks go through the locked path, which raises ->slow then waits
+ * for the lockless operations in flight to complete, so that it owns
+ * the ring until it drops ->slow. A task waiting for a message keeps
+ * ->slow raised while it sleeps, forcing posters to hand messages
+ * over to it under the nklock.
+ */
+
+#define queue_cell(q, pos)	(&(q)->cells[(pos) & (q)->ring_mask])
+
+static inline long queue_atomic_add(xnarch_atomic_t *v, long delta)
+{
+	long old;
+
+	do
+		old = xnarch_atomic_get(v);
+	while (xnarch_atomic_cmpxchg(v, old, old + delta) != old);
+
+	return old + delta;
+}
+
+static inline int queue_count(vrtxqueue_t *queue)
+{
+	return queue->qsize + 1 - (int)xnarch_atomic_get(&queue->room);
+}
+
+/* Reserve a slot, leaving the jamming one unless asked for. */
+static inline int queue_get_room(vrtxqueue_t *queue, int jammed)
+{
+	long room;
+
+	do {
+		room = xnarch_atomic_get(&queue->room);
+		if (room <= !jammed)
+			return 0;
+	} while (xnarch_atomic_cmpxchg(&queue->room, room, room - 1) != room);
+
+	return 1;
+}
+
+/* Append a message, a slot must have been reserved. */
+static void queue_put(vrtxqueue_t *queue, char *msg)
+{
+	unsigned long pos;
+	vrtxqcell_t *cell;
+
+	for (;;) {
+		pos = xnarch_atomic_get(&queue->tail);
+		cell = queue_cell(queue, pos);
+		if ((long)(xnarch_atomic_get(&cell->seq) - pos) == 0 &&
+		    xnarch_atomic_cmpxchg(&queue->tail, pos, pos + 1) == pos)
+			break;
+		cpu_relax();
+	}
+
+	cell->msg = msg;
+	xnarch_memory_barrier();
+	xnarch_atomic_set(&cell->seq, pos + 1);
+}
+
+/* Insert a message at the head, exclusive access only. */
+static void queue_push_front(vrtxqueue_t *queue, char *msg)
+{
+	unsigned long pos = xnarch_atomic_get(&queue->head) - 1;
+	vrtxqcell_t *cell = queue_cell(queue, pos);
+
+	cell->msg = msg;
+	xnarch_atomic_set(&cell->seq, pos + 1);
+	xnarch_atomic_set(&queue->head, pos);
+}
+
+/* Remove the head message, returns zero if the queue is empty. */
+static int queue_get(vrtxqueue_t *queue, char **msgp)
+{
+	unsigned long pos;
+	vrtxqcell_t *cell;
+	long dif;
+
+	for (;;) {
+		pos = xnarch_atomic_get(&queue->head);
+		cell = queue_cell(queue, pos);
+		dif = (long)(xnarch_atomic_get(&cell->seq) - (pos + 1));
+		if (dif < 0)
+			return 0;
+		if (dif == 0 &&
+		    xnarch_atomic_cmpxchg(&queue->head, pos, pos + 1) == pos)
+			break;
+		cpu_relax();
+	}
+
+	xnarch_read_memory_barrier();
+	*msgp = cell->msg;
+	xnarch_memory_barrier();
+	xnarch_atomic_set(&cell->seq, pos + queue->ring_mask + 1);
+	queue_atomic_add(&queue->room, 1);
+
+	return 1;
+}
+
+/*
+ * Must be called interrupts off. The lookup and the inflight count
+ * update are serialized with queue_destroy_internal() by nklock, so
+ * that the queue is either gone from the map, or not freed until we
+ * leave. Only the ring transfer proper is lock-free.
+ */
+static inline vrtxqueue_t *queue_fast_enter(int qid)
+{
+	vrtxqueue_t *queue;
+
+	xnlock_get(&nklock);
+
+	queue = xnmap_fetch(vrtx_queue_idmap, qid);
+	if (queue && xnarch_atomic_get(&queue->slow) == 0)
+		queue_atomic_add(&queue->inflight, 1);
+	else
+		queue = NULL;
+
+	xnlock_put(&nklock);
+
+	return queue;
+}
+
+static inline void queue_fast_exit(vrtxqueue_t *queue)
+{
+	xnarch_memory_barrier();
+	queue_atomic_add(&queue->inflight, -1);
+}
+
+/* Must be called interrupts off, nklock locked. */
+static void queue_enter_slow(vrtxqueue_t *queue)
+{
+	queue_atomic_add(&queue->slow, 1);
+	xnarch_memory_barrier();
+	while (xnarch_atomic_get(&queue->inflight))
+		cpu_relax();
+}
+
+static inline void queue_leave_slow(vrtxqueue_t *queue)
+{
+	queue_atomic_add(&queue->slow, -1);
+}
+
 #ifdef CONFIG_XENO_OPT_VFILE
 
 struct vfile_priv {
@@ -43,7 +190,7 @@ static int vfile_rewind(struct xnvfile_snapshot_iterator *it)
 	struct vrtxqueue *queue = xnvfile_priv(it->vfile);
 
 	priv->curr = getheadpq(xnsynch_wait_queue(&queue->synchbase));
-	priv->qused = queue->qused;
+	priv->qused = queue_count(queue);
 	priv->qsize = queue->qsize;
 
 	return xnsynch_nsleepers(&queue->synchbase);
@@ -123,10 +270,12 @@ int queue_destroy_internal(vrtxqueue_t * queue)
 {
 	int s;
 
+	/* Pended tasks won't touch the queue once woken up. */
+	queue_enter_slow(queue);
 	removeq(&vrtx_queue_q, &queue->link);
 	s = xnsynch_destroy(&queue->synchbase);
 	xnmap_remove(vrtx_queue_idmap, queue->qid);
-	xnfree(queue->messages);
+	xnfree(queue->cells);
 	xnregistry_remove(queue->handle);
 	vrtx_mark_deleted(queue);
 	xnfree(queue);
@@ -153,6 +302,7 @@ void vrtxqueue_cleanup(void)
 
 int sc_qecreate(int qid, int qsize, int opt, int *errp)
 {
+	unsigned long i, nr_cells;
 	vrtxqueue_t *queue;
 	int bflags;
 	spl_t s;
@@ -167,10 +317,14 @@ int sc_qecreate(int qid, int qsize, int opt, int *errp)
 	if (queue == NULL)
 		goto nomem;
 
-	/* Allocate enough message entries, +1 for the jamming slot. */
-	queue->messages = (char **)xnmalloc(sizeof(char *) * (qsize + 1));
+	/* Allocate enough message entries, +1 for the jamming slot,
+	   rounded up to a power of 2 for the ring. */
+	for (nr_cells = 1; nr_cells < (unsigned long)qsize + 1; nr_cells <<= 1)
+		;
+
+	queue->cells = xnmalloc(sizeof(vrtxqcell_t) * nr_cells);
 
-	if (queue->messages == NULL) {
+	if (queue->cells == NULL) {
 		xnfree(queue);
 	      nomem:
 		*errp = ER_MEM;
@@ -180,7 +334,7 @@ int sc_qecreate(int qid, int qsize, int opt, int *errp)
 	qid = xnmap_enter(vrtx_queue_idmap, qid, queue);
 
 	if (qid < 0) {
-		xnfree(queue->messages);
+		xnfree(queue->cells);
 		xnfree(queue);
 		*errp = ER_QID;
 		return -1;
@@ -196,9 +350,15 @@ int sc_qecreate(int qid, int qsize, int opt, int *errp)
 	queue->magic = VRTX_QUEUE_MAGIC;
 	queue->qid = qid;
 	queue->qsize = qsize;
-	queue->rdptr = 0;
-	queue->wrptr = 0;
-	queue->qused = 0;
+	queue->ring_mask = nr_cells - 1;
+	xnarch_atomic_set(&queue->head, 0);
+	xnarch_atomic_set(&queue->tail, 0);
+	xnarch_atomic_set(&queue->room, qsize + 1);
+	xnarch_atomic_set(&queue->inflight, 0);
+	xnarch_atomic_set(&queue->slow, 0);
+
+	for (i = 0; i < nr_cells; i++)
+		xnarch_atomic_set(&queue->cells[i].seq, i);
 
 	*errp = RET_OK;
 
@@ -259,6 +419,23 @@ static void sc_qpost_inner(int qid, char *msg, int *errp, int jammed)
 	xnthread_t *waiter;
 	spl_t s;
 
+	/* Jamming needs exclusive access to the ring head. */
+	if (!jammed) {
+		splhigh(s);
+		queue = queue_fast_enter(qid);
+		if (queue) {
+			if (queue_get_room(queue, 0)) {
+				queue_put(queue, msg);
+				queue_fast_exit(queue);
+				splexit(s);
+				*errp = RET_OK;
+				return;
+			}
+			queue_fast_exit(queue);
+		}
+		splexit(s);
+	}
+
 	xnlock_get_irqsave(&nklock, s);
 
 	queue = xnmap_fetch(vrtx_queue_idmap, qid);
@@ -268,6 +445,8 @@ static void sc_qpost_inner(int qid, char *msg, int *errp, int jammed)
 		goto unlock_and_exit;
 	}
 
+	queue_enter_slow(queue);
+
 	*errp = RET_OK;
 
 	waiter = xnsynch_wakeup_one_sleeper(&queue->synchbase);
@@ -275,24 +454,22 @@ static void sc_qpost_inner(int qid, char *msg, int *errp, int jammed)
 	if (waiter) {
 		thread2vrtxtask(waiter)->waitargs.msg = msg;
 		xnpod_schedule();
-		goto unlock_and_exit;
+		goto leave_slow;
 	}
 
-	if (queue->qused >= queue->qsize + jammed) {
+	if (!queue_get_room(queue, jammed)) {
 		*errp = ER_QFL;
-		goto unlock_and_exit;
+		goto leave_slow;
 	}
 
-	if (jammed) {
-		queue->rdptr =
-		    queue->rdptr == 0 ? queue->qsize : queue->rdptr - 1;
-		queue->messages[queue->rdptr] = msg;
-	} else {
-		queue->messages[queue->wrptr] = msg;
-		queue->wrptr = (queue->wrptr + 1) % (queue->qsize + 1);
-	}
+	if (jammed)
+		queue_push_front(queue, msg);
+	else
+		queue_put(queue, msg);
+
+      leave_slow:
 
-	++queue->qused;
+	queue_leave_slow(queue);
 
       unlock_and_exit:
 
@@ -309,6 +486,26 @@ void sc_qjam(int qid, char *msg, int *errp)
 	sc_qpost_inner(qid, msg, errp, 1);
 }
 
+/* Lockless attempt to fetch a message, returns zero on failure. */
+static int sc_qget_fast(int qid, char **msgp)
+{
+	vrtxqueue_t *queue;
+	int ret = 0;
+	spl_t s;
+
+	splhigh(s);
+
+	queue = queue_fast_enter(qid);
+	if (queue) {
+		ret = queue_get(queue, msgp);
+		queue_fast_exit(queue);
+	}
+
+	splexit(s);
+
+	return ret;
+}
+
 char *sc_qpend(int qid, long timeout, int *errp)
 {
 	vrtxqueue_t *queue;
@@ -316,6 +513,11 @@ char *sc_qpend(int qid, long timeout, int *errp)
 	char *msg = NULL;
 	spl_t s;
 
+	if (sc_qget_fast(qid, &msg)) {
+		*errp = RET_OK;
+		return msg;
+	}
+
 	xnlock_get_irqsave(&nklock, s);
 
 	queue = xnmap_fetch(vrtx_queue_idmap, qid);
@@ -325,16 +527,16 @@ char *sc_qpend(int qid, long timeout, int *errp)
 		goto unlock_and_exit;
 	}
 
-	if (likely(queue->qused > 0)) {
-		msg = queue->messages[queue->rdptr];
-		queue->rdptr = (queue->rdptr + 1) % (queue->qsize + 1);
-		--queue->qused;
-		goto unlock_and_exit;
+	queue_enter_slow(queue);
+
+	if (likely(queue_get(queue, &msg))) {
+		*errp = RET_OK;
+		goto leave_slow;
 	}
 
 	if (xnpod_unblockable_p()) {
 		*errp = -EPERM;
-		goto unlock_and_exit;
+		goto leave_slow;
 	}
 
 	task = vrtx_current_task();
@@ -343,27 +545,34 @@ char *sc_qpend(int qid, long timeout, int *errp)
 	if (timeout)
 		task->vrtxtcb.TCBSTAT |= TBSDELAY;
 
+	/* The lockless path stays disabled while we sleep, so that
+	   posters hand their message over to us. */
 	xnsynch_sleep_on(&queue->synchbase, timeout, XN_RELATIVE);
 
-	if (xnthread_test_info(&task->threadbase, XNBREAK)) {
-		*errp = -EINTR;
-		goto unlock_and_exit;
-	}
-
+	/* The queue is gone, don't touch it anymore. */
 	if (xnthread_test_info(&task->threadbase, XNRMID)) {
 		*errp = ER_DEL;
 		goto unlock_and_exit;
 	}
 
+	if (xnthread_test_info(&task->threadbase, XNBREAK)) {
+		*errp = -EINTR;
+		goto leave_slow;
+	}
+
 	if (xnthread_test_info(&task->threadbase, XNTIMEO)) {
 		*errp = ER_TMO;
-		goto unlock_and_exit;
+		goto leave_slow;
 	}
 
 	msg = task->waitargs.msg;
 
 	*errp = RET_OK;
 
+      leave_slow:
+
+	queue_leave_slow(queue);
+
       unlock_and_exit:
 
 	xnlock_put_irqrestore(&nklock, s);
@@ -377,6 +586,11 @@ char *sc_qaccept(int qid, int *errp)
 	char *msg = NULL;
 	spl_t s;
 
+	if (sc_qget_fast(qid, &msg)) {
+		*errp = RET_OK;
+		return msg;
+	}
+
 	xnlock_get_irqsave(&nklock, s);
 
 	queue = xnmap_fetch(vrtx_queue_idmap, qid);
@@ -386,16 +600,14 @@ char *sc_qaccept(int qid, int *errp)
 		goto unlock_and_exit;
 	}
 
-	if (queue->qused == 0) {
-		*errp = ER_NMP;
-		goto unlock_and_exit;
-	}
+	queue_enter_slow(queue);
 
-	msg = queue->messages[queue->rdptr];
-	queue->rdptr = (queue->rdptr + 1) % (queue->qsize + 1);
-	--queue->qused;
+	if (queue_get(queue, &msg))
+		*errp = RET_OK;
+	else
+		*errp = ER_NMP;
 
-	*errp = RET_OK;
+	queue_leave_slow(queue);
 
       unlock_and_exit:
 
@@ -447,8 +659,10 @@ char *sc_qinquiry(int qid, int *countp, int *errp)
 		goto unlock_and_exit;
 	}
 
-	*countp = queue->qused;
-	msg = queue->messages[queue->rdptr];
+	queue_enter_slow(queue);
+	*countp = queue_count(queue);
+	msg = queue_cell(queue, xnarch_atomic_get(&queue->head))->msg;
+	queue_leave_slow(queue);
 	*errp = RET_OK;
 
       unlock_and_exit:
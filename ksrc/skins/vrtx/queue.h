@@ -25,6 +25,14 @@
 
 #define VRTX_QUEUE_MAGIC 0x82820303
 
+typedef struct vrtxqcell {
+
+    xnarch_atomic_t seq;	/* Ring position this cell is ready for. */
+
+    char *msg;
+
+} vrtxqcell_t;
+
 typedef struct vrtxqueue {
 
     unsigned magic;   /* Magic code - must be first */
@@ -37,13 +45,19 @@ typedef struct vrtxqueue {
 
     xnsynch_t synchbase;
 
-    char **messages;
+    vrtxqcell_t *cells;
+
+    unsigned long ring_mask;
+
+    xnarch_atomic_t head;	/* Next position to read. */
+
+    xnarch_atomic_t tail;	/* Next position to write. */
 
-    int rdptr;
+    xnarch_atomic_t room;	/* Free slots, including the jamming one. */
 
-    int wrptr;
+    xnarch_atomic_t inflight;	/* Lockless operations in progress. */
 
-    int qused;
+    xnarch_atomic_t slow;	/* Locked operations or waiters present. */
 
     int qsize;	/* Does not account for the jamming slot. */
 
@@ -91,9 +91,7 @@ static inline void wind_sem_flush_rq(xnqueue_t *rq)
 
 typedef struct wind_msg {
 
-    xnholder_t link;
-
-#define link2wind_msg(ln) container_of(ln, wind_msg_t, link)
+    xnarch_atomic_t seq;        /* ring position the cell is ready for */
 
     unsigned int length;
 
@@ -107,9 +105,23 @@ typedef struct wind_msgq {
 
     UINT msg_length;
 
-    xnholder_t * free_list;     /* simply linked list of free messages */
+    int nb_msgs;
+
+    char *ring;                 /* ring of message cells (power of 2) */
+
+    unsigned long ring_mask;
+
+    unsigned long msg_size;     /* size of a ring cell */
+
+    xnarch_atomic_t head;       /* next ring position to read */
 
-    xnqueue_t msgq;             /* queue of messages available for reading */
+    xnarch_atomic_t tail;       /* next ring position to write */
+
+    xnarch_atomic_t room;       /* free message slots */
+
+    xnarch_atomic_t inflight;   /* lock-free operations in progress */
+
+    xnarch_atomic_t slow;       /* pended tasks + locked operations */
 
     xnsynch_t synchbase;        /* pended readers or writers */
 
@@ -135,6 +147,11 @@ typedef struct wind_wd {
 
     xntimer_t timerbase;
 
+    xnholder_t wlink;		/* !< Link in wheel slot or expiry queue. */
+#define wlink2wd(ln)		container_of(ln, wind_wd_t, wlink)
+    xnqueue_t *wqueue;		/* !< Queue wlink is in, NULL if none. */
+    xnticks_t wdate;		/* !< Expiry date on the wheel (ticks). */
+
     wind_timer_t handler;
     long arg;
 
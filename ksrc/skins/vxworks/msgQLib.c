@@ -22,6 +22,157 @@
 
 static int msgq_destroy_internal(wind_msgq_t *queue);
 
+/*
+ * Messages are stored in a bounded MPMC ring (D. Vyukov's algorithm):
+ * each cell carries the ring position it is ready to be written or
+ * read at. As long as no task is pended on the queue, msgQSend() and
+ * msgQReceive() go through the ring without grabbing the nklock. The
+ * locked path handles pended tasks, urgent messages and deletion as
+ * before; it raises queue->slow then waits for the lock-free
+ * operations in flight to drain, so that it has exclusive access to
+ * the ring, while newcomers fall back to the locked path as well.
+ */
+
+#define msgq_cell(q, pos) \
+	((wind_msg_t *)((q)->ring + ((pos) & (q)->ring_mask) * (q)->msg_size))
+
+static inline long msgq_atomic_add(xnarch_atomic_t *v, long delta)
+{
+	long old;
+
+	do
+		old = xnarch_atomic_get(v);
+	while (xnarch_atomic_cmpxchg(v, old, old + delta) != old);
+
+	return old + delta;
+}
+
+static inline int msgq_count(wind_msgq_t *queue)
+{
+	return queue->nb_msgs - (int)xnarch_atomic_get(&queue->room);
+}
+
+/* reserve a free message slot */
+static inline int msgq_get_room(wind_msgq_t *queue)
+{
+	long room;
+
+	do {
+		room = xnarch_atomic_get(&queue->room);
+		if (room <= 0)
+			return 0;
+	} while (xnarch_atomic_cmpxchg(&queue->room, room, room - 1) != room);
+
+	return 1;
+}
+
+/* append a message to the ring, a slot must have been reserved */
+static void msgq_put(wind_msgq_t *queue, const char *buf, unsigned bytes)
+{
+	unsigned long pos;
+	wind_msg_t *msg;
+
+	for (;;) {
+		pos = xnarch_atomic_get(&queue->tail);
+		msg = msgq_cell(queue, pos);
+		if ((long)(xnarch_atomic_get(&msg->seq) - pos) == 0 &&
+		    xnarch_atomic_cmpxchg(&queue->tail, pos, pos + 1) == pos)
+			break;
+		/* Lost the race, or the cell is still being read. */
+		cpu_relax();
+	}
+
+	msg->length = bytes;
+	memcpy(msg->buffer, buf, bytes);
+	xnarch_memory_barrier();
+	xnarch_atomic_set(&msg->seq, pos + 1);
+}
+
+/* insert a message at the head of the ring, exclusive access only */
+static void msgq_push_front(wind_msgq_t *queue, const char *buf, unsigned bytes)
+{
+	unsigned long pos = xnarch_atomic_get(&queue->head) - 1;
+	wind_msg_t *msg = msgq_cell(queue, pos);
+
+	msg->length = bytes;
+	memcpy(msg->buffer, buf, bytes);
+	xnarch_atomic_set(&msg->seq, pos + 1);
+	xnarch_atomic_set(&queue->head, pos);
+}
+
+/* try to unqueue message for reading, -1 if none */
+static int msgq_get(wind_msgq_t *queue, char *buf, unsigned bytes)
+{
+	unsigned long pos;
+	wind_msg_t *msg;
+	long dif;
+
+	for (;;) {
+		pos = xnarch_atomic_get(&queue->head);
+		msg = msgq_cell(queue, pos);
+		dif = (long)(xnarch_atomic_get(&msg->seq) - (pos + 1));
+		if (dif < 0)
+			return -1;
+		if (dif == 0 &&
+		    xnarch_atomic_cmpxchg(&queue->head, pos, pos + 1) == pos)
+			break;
+		cpu_relax();
+	}
+
+	xnarch_read_memory_barrier();
+	if (msg->length < bytes)
+		bytes = msg->length;
+	memcpy(buf, msg->buffer, bytes);
+	xnarch_memory_barrier();
+	xnarch_atomic_set(&msg->seq, pos + queue->ring_mask + 1);
+	msgq_atomic_add(&queue->room, 1);
+
+	return bytes;
+}
+
+/* must be called with interrupts off.
+
+   The lookup and the inflight count update are done under nklock, so
+   that msgq_destroy_internal() either fails our lookup, or waits for
+   us to leave before freeing the queue. Only the ring transfer
+   proper is lock-free. */
+static inline wind_msgq_t *msgq_fast_enter(MSG_Q_ID qid)
+{
+	wind_msgq_t *queue;
+
+	xnlock_get(&nklock);
+
+	queue = wind_h2obj_active(qid, WIND_MSGQ_MAGIC, wind_msgq_t);
+	if (queue && xnarch_atomic_get(&queue->slow) == 0)
+		msgq_atomic_add(&queue->inflight, 1);
+	else
+		queue = NULL;
+
+	xnlock_put(&nklock);
+
+	return queue;
+}
+
+static inline void msgq_fast_exit(wind_msgq_t *queue)
+{
+	xnarch_memory_barrier();
+	msgq_atomic_add(&queue->inflight, -1);
+}
+
+/* must be called with nklock locked, interrupts off */
+static void msgq_enter_slow(wind_msgq_t *queue)
+{
+	msgq_atomic_add(&queue->slow, 1);
+	xnarch_memory_barrier();
+	while (xnarch_atomic_get(&queue->inflight))
+		cpu_relax();
+}
+
+static inline void msgq_leave_slow(wind_msgq_t *queue)
+{
+	msgq_atomic_add(&queue->slow, -1);
+}
+
 #ifdef CONFIG_XENO_OPT_VFILE
 
 struct vfile_priv {
@@ -47,7 +198,7 @@ static int vfile_rewind(struct xnvfile_snapshot_iterator *it)
 	priv->curr = getheadpq(xnsynch_wait_queue(&q->synchbase));
 	priv->flags = xnsynch_test_flags(&q->synchbase, XNSYNCH_PRIO);
 	priv->mlength = q->msg_length;
-	priv->mcount = countq(&q->msgq);
+	priv->mcount = msgq_count(q);
 
 	return xnsynch_nsleepers(&q->synchbase);
 }
@@ -133,50 +284,12 @@ void wind_msgq_cleanup(void)
 	wind_msgq_flush_rq(&__wind_global_rholder.msgQq);
 }
 
-/* free_msg: return a message to the free list */
-static inline void free_msg(wind_msgq_t *queue, wind_msg_t *msg)
-{
-	msg->link.next = queue->free_list;
-	queue->free_list = &msg->link;
-}
-
-/* get a message from the free list */
-static inline wind_msg_t *get_free_msg(wind_msgq_t *queue)
-{
-	wind_msg_t *msg;
-
-	if (queue->free_list == NULL)
-		return NULL;
-
-	msg = link2wind_msg(queue->free_list);
-	queue->free_list = queue->free_list->next;
-	inith(&msg->link);
-
-	return msg;
-}
-
-/* try to unqueue message for reading */
-static inline wind_msg_t *unqueue_msg(wind_msgq_t *queue)
-{
-	xnholder_t *holder;
-	wind_msg_t *msg;
-
-	holder = getheadq(&queue->msgq);
-	if (holder == NULL)
-		return NULL;
-
-	msg = link2wind_msg(holder);
-	removeq(&queue->msgq, holder);
-
-	return msg;
-}
-
 MSG_Q_ID msgQCreate(int nb_msgs, int length, int flags)
 {
 	static unsigned long msgq_ids;
 	wind_msgq_t *queue;
 	xnflags_t bflags = 0;
-	int i, msg_size;
+	unsigned long i, msg_size, nr_cells;
 	char *msgs_mem;
 	spl_t s;
 
@@ -189,8 +302,16 @@ MSG_Q_ID msgQCreate(int nb_msgs, int length, int flags)
 
 	error_check(length < 0, S_msgQLib_INVALID_MSG_LENGTH, return 0);
 
-	msgs_mem = xnmalloc(sizeof(wind_msgq_t) +
-			    nb_msgs * (sizeof(wind_msg_t) + length));
+	/* The ring needs a power of 2 cells, the room counter enforces
+	   the actual queue capacity. */
+	for (nr_cells = 1; nr_cells < (unsigned long)nb_msgs; nr_cells <<= 1)
+		;
+
+	msg_size = sizeof(wind_msg_t) + length;
+	if (msg_size % sizeof(long))
+		msg_size += sizeof(long) - (msg_size % sizeof(long));
+
+	msgs_mem = xnmalloc(sizeof(wind_msgq_t) + nr_cells * msg_size);
 
 	error_check(msgs_mem == NULL, S_memLib_NOT_ENOUGH_MEMORY, return 0);
 
@@ -199,8 +320,15 @@ MSG_Q_ID msgQCreate(int nb_msgs, int length, int flags)
 
 	queue->magic = WIND_MSGQ_MAGIC;
 	queue->msg_length = length;
-	queue->free_list = NULL;
-	initq(&queue->msgq);
+	queue->nb_msgs = nb_msgs;
+	queue->ring = msgs_mem;
+	queue->ring_mask = nr_cells - 1;
+	queue->msg_size = msg_size;
+	xnarch_atomic_set(&queue->head, 0);
+	xnarch_atomic_set(&queue->tail, 0);
+	xnarch_atomic_set(&queue->room, nb_msgs);
+	xnarch_atomic_set(&queue->inflight, 0);
+	xnarch_atomic_set(&queue->slow, 0);
 	inith(&queue->rlink);
 	queue->rqueue = &wind_get_rholder()->msgQq;
 
@@ -210,10 +338,8 @@ MSG_Q_ID msgQCreate(int nb_msgs, int length, int flags)
 
 	xnsynch_init(&queue->synchbase, bflags, NULL);
 
-	msg_size = sizeof(wind_msg_t) + length;
-
-	for (i = 0; i < nb_msgs; ++i, msgs_mem += msg_size)
-		free_msg(queue, (wind_msg_t *)msgs_mem);
+	for (i = 0; i < nr_cells; ++i, msgs_mem += msg_size)
+		xnarch_atomic_set(&((wind_msg_t *)msgs_mem)->seq, i);
 
 	xnlock_get_irqsave(&nklock, s);
 	appendq(queue->rqueue, &queue->rlink);
@@ -265,7 +391,7 @@ int msgQNumMsgs(MSG_Q_ID qid)
 	check_OBJ_ID_ERROR(qid, wind_msgq_t, queue, WIND_MSGQ_MAGIC,
 			   goto error);
 
-	result = queue->msgq.elems;
+	result = msgq_count(queue);
 
 	xnlock_put_irqrestore(&nklock, s);
 	return result;
@@ -279,26 +405,41 @@ int msgQReceive(MSG_Q_ID qid, char *buf, UINT bytes, int to)
 {
 	xnticks_t timeout;
 	wind_msgq_t *queue;
-	wind_msg_t *msg;
 	xnthread_t *thread;
 	wind_task_t *task;
+	int ret;
 	spl_t s;
 
 	error_check(buf == NULL, 0, return ERROR);
 
 	check_NOT_ISR_CALLABLE(return ERROR);
 
+	splhigh(s);
+	queue = msgq_fast_enter(qid);
+	if (queue) {
+		ret = msgq_get(queue, buf, bytes);
+		msgq_fast_exit(queue);
+		if (ret >= 0) {
+			splexit(s);
+			return ret;
+		}
+	}
+	splexit(s);
+
 	xnlock_get_irqsave(&nklock, s);
 
 	check_OBJ_ID_ERROR(qid, wind_msgq_t, queue, WIND_MSGQ_MAGIC,
 			   goto error);
 
-	if ((msg = unqueue_msg(queue)) == NULL) {
+	msgq_enter_slow(queue);
+
+	ret = msgq_get(queue, buf, bytes);
+	if (ret < 0) {
 		/* message queue is empty */
 
 		error_check(to == NO_WAIT ||
 			    xnpod_unblockable_p(), S_objLib_OBJ_UNAVAILABLE,
-			    goto error);
+			    goto leave_error);
 
 		if (to == WAIT_FOREVER)
 			timeout = XN_INFINITE;
@@ -310,30 +451,31 @@ int msgQReceive(MSG_Q_ID qid, char *buf, UINT bytes, int to)
 		task->rcv_buf = buf;
 		task->rcv_bytes = bytes;
 
+		/* The lock-free path stays disabled while we are pended,
+		   so that senders hand messages over to us. */
 		xnsynch_sleep_on(&queue->synchbase, timeout, XN_RELATIVE);
 
-		error_check(xnthread_test_info(thread, XNBREAK), -EINTR,
-			    goto error);
+		/* The queue memory is gone, don't touch it. */
 		error_check(xnthread_test_info(thread, XNRMID),
 			    S_objLib_OBJ_DELETED, goto error);
+		error_check(xnthread_test_info(thread, XNBREAK), -EINTR,
+			    goto leave_error);
 		error_check(xnthread_test_info(thread, XNTIMEO),
-			    S_objLib_OBJ_TIMEOUT, goto error);
+			    S_objLib_OBJ_TIMEOUT, goto leave_error);
 
-		bytes = task->rcv_bytes;
+		ret = task->rcv_bytes;
 	} else {
-		if (msg->length < bytes)
-			bytes = msg->length;
-		memcpy(buf, msg->buffer, bytes);
-		free_msg(queue, msg);
-
 		/* check if some sender is pending */
 		if (xnsynch_wakeup_one_sleeper(&queue->synchbase))
 			xnpod_schedule();
 	}
 
+	msgq_leave_slow(queue);
 	xnlock_put_irqrestore(&nklock, s);
-	return bytes;
+	return ret;
 
+      leave_error:
+	msgq_leave_slow(queue);
       error:
 	xnlock_put_irqrestore(&nklock, s);
 	return ERROR;
@@ -343,7 +485,6 @@ STATUS msgQSend(MSG_Q_ID qid, const char *buf, UINT bytes, int to, int prio)
 {
 	wind_msgq_t *queue;
 	xnticks_t timeout;
-	wind_msg_t *msg;
 	xnthread_t *thread;
 	wind_task_t *task;
 	spl_t s;
@@ -353,6 +494,23 @@ STATUS msgQSend(MSG_Q_ID qid, const char *buf, UINT bytes, int to, int prio)
 		return ERROR;
 	}
 
+	/* Urgent messages always go through the locked path, which has
+	   exclusive access to the ring head. */
+	if (prio == MSG_PRI_NORMAL && buf) {
+		splhigh(s);
+		queue = msgq_fast_enter(qid);
+		if (queue) {
+			if (bytes <= queue->msg_length && msgq_get_room(queue)) {
+				msgq_put(queue, buf, bytes);
+				msgq_fast_exit(queue);
+				splexit(s);
+				return OK;
+			}
+			msgq_fast_exit(queue);
+		}
+		splexit(s);
+	}
+
 	xnlock_get_irqsave(&nklock, s);
 
 	check_OBJ_ID_ERROR(qid, wind_msgq_t, queue, WIND_MSGQ_MAGIC,
@@ -361,7 +519,9 @@ STATUS msgQSend(MSG_Q_ID qid, const char *buf, UINT bytes, int to, int prio)
 	error_check(buf == NULL || bytes > queue->msg_length,
 		    S_msgQLib_INVALID_MSG_LENGTH, goto error);
 
-	if (queue->msgq.elems == 0 &&
+	msgq_enter_slow(queue);
+
+	if (msgq_count(queue) == 0 &&
 	    (thread = xnsynch_wakeup_one_sleeper(&queue->synchbase)) != NULL) {
 		/* the message queue is empty and we have found a pending receiver */
 		task = thread2wind_task(thread);
@@ -370,46 +530,46 @@ STATUS msgQSend(MSG_Q_ID qid, const char *buf, UINT bytes, int to, int prio)
 
 		memcpy(task->rcv_buf, buf, bytes);
 		xnpod_schedule();
+		goto done;
+	}
 
-	} else {
-		msg = get_free_msg(queue);
-		if (msg == NULL) {
-			/* the message queue is full, we need to wait */
-			error_check(to == NO_WAIT, S_objLib_OBJ_UNAVAILABLE,
-				    goto error);
-
-			thread = &wind_current_task()->threadbase;
-
-			if (to == WAIT_FOREVER)
-				timeout = XN_INFINITE;
-			else
-				timeout = to;
-
-			xnsynch_sleep_on(&queue->synchbase, timeout, XN_RELATIVE);
-
-			error_check(xnthread_test_info(thread, XNBREAK),
-				    -EINTR, goto error);
-			error_check(xnthread_test_info(thread, XNRMID),
-				    S_objLib_OBJ_DELETED, goto error);
-			error_check(xnthread_test_info(thread, XNTIMEO),
-				    S_objLib_OBJ_TIMEOUT, goto error);
-
-			/* a receiver unblocked us, so we are sure to obtain a message
-			   buffer */
-			msg = get_free_msg(queue);
-		}
+	while (!msgq_get_room(queue)) {
+		/* the message queue is full, we need to wait */
+		error_check(to == NO_WAIT, S_objLib_OBJ_UNAVAILABLE,
+			    goto leave_error);
+
+		thread = &wind_current_task()->threadbase;
 
-		msg->length = bytes;
-		memcpy(msg->buffer, buf, bytes);
-		if (prio == MSG_PRI_NORMAL)
-			appendq(&queue->msgq, &msg->link);
-		else		/* Anything else will be interpreted as MSG_PRI_URGENT. */
-			prependq(&queue->msgq, &msg->link);
+		if (to == WAIT_FOREVER)
+			timeout = XN_INFINITE;
+		else
+			timeout = to;
+
+		xnsynch_sleep_on(&queue->synchbase, timeout, XN_RELATIVE);
+
+		error_check(xnthread_test_info(thread, XNRMID),
+			    S_objLib_OBJ_DELETED, goto error);
+		error_check(xnthread_test_info(thread, XNBREAK),
+			    -EINTR, goto leave_error);
+		error_check(xnthread_test_info(thread, XNTIMEO),
+			    S_objLib_OBJ_TIMEOUT, goto leave_error);
+
+		/* A receiver released a slot, but another sender may
+		   have grabbed it meanwhile: try again. */
 	}
 
+	if (prio == MSG_PRI_NORMAL)
+		msgq_put(queue, buf, bytes);
+	else		/* Anything else will be interpreted as MSG_PRI_URGENT. */
+		msgq_push_front(queue, buf, bytes);
+
+      done:
+	msgq_leave_slow(queue);
 	xnlock_put_irqrestore(&nklock, s);
 	return OK;
 
+      leave_error:
+	msgq_leave_slow(queue);
       error:
 	xnlock_put_irqrestore(&nklock, s);
 	return ERROR;
@@ -418,7 +578,12 @@ STATUS msgQSend(MSG_Q_ID qid, const char *buf, UINT bytes, int to, int prio)
 
 static int msgq_destroy_internal(wind_msgq_t *queue)
 {
-	int s = xnsynch_destroy(&queue->synchbase);
+	int s;
+
+	/* Wait for the lock-free operations in flight to drain; the
+	   pended tasks will not touch the queue anymore. */
+	msgq_enter_slow(queue);
+	s = xnsynch_destroy(&queue->synchbase);
 	xnregistry_remove(queue->handle);
 	wind_mark_deleted(queue);
 	removeq(queue->rqueue, &queue->rlink);
@@ -24,8 +24,126 @@
 
 static void wd_destroy_internal(wind_wd_t *wd);
 
+/*
+ * With a periodic time base, watchdogs are not backed by individual
+ * nucleus timers, but hashed by expiry date on a timing wheel, so
+ * that starting and cancelling one are constant-time queue
+ * operations. A single timer advances the wheel on each tick while
+ * watchdogs are armed, moving the expired ones to a queue which a
+ * server thread running at IRQ server priority drains, calling their
+ * routines with nklock held. This keeps user routines out of the
+ * timer interrupt.
+ */
+
+#define WIND_WD_WHEELSIZE 256
+#define WIND_WD_WHEELMASK (WIND_WD_WHEELSIZE - 1)
+
+static struct {
+	xnqueue_t slot[WIND_WD_WHEELSIZE];
+	xnqueue_t expired;
+	xnticks_t last;		/* Last tick processed. */
+	int count;		/* Watchdogs armed on the wheel. */
+	int enabled;
+	xntimer_t timer;
+	xnthread_t server;
+} wd_wheel;
+
+/* Called with nklock locked, interrupts off. */
+static void wd_wheel_cancel(wind_wd_t *wd)
+{
+	if (wd->wqueue == NULL)
+		return;
+
+	if (wd->wqueue != &wd_wheel.expired &&
+	    --wd_wheel.count == 0)
+		xntimer_stop(&wd_wheel.timer);
+
+	removeq(wd->wqueue, &wd->wlink);
+	wd->wqueue = NULL;
+}
+
+/* Called with nklock locked, interrupts off. */
+static void wd_wheel_start(wind_wd_t *wd, int timeout)
+{
+	xnticks_t now = xntbase_get_jiffies(wind_tbase);
+
+	if (wd_wheel.count++ == 0) {
+		wd_wheel.last = now;
+		xntimer_start(&wd_wheel.timer, 1, 1, XN_RELATIVE);
+	}
+
+	wd->wdate = now + (timeout > 0 ? timeout : 1);
+	wd->wqueue = &wd_wheel.slot[wd->wdate & WIND_WD_WHEELMASK];
+	appendq(wd->wqueue, &wd->wlink);
+}
+
+static void wd_wheel_handler(xntimer_t *timer)
+{
+	xnticks_t now = xntbase_get_jiffies(wind_tbase);
+	xnholder_t *holder, *nholder;
+	int n = WIND_WD_WHEELSIZE;
+	wind_wd_t *wd;
+	xnqueue_t *q;
+
+	/* Catch up with missed ticks, one wheel round at most. */
+	while ((xnsticks_t)(now - wd_wheel.last) > 0 && n-- > 0) {
+		q = &wd_wheel.slot[++wd_wheel.last & WIND_WD_WHEELMASK];
+		for (holder = getheadq(q); holder; holder = nholder) {
+			nholder = nextq(q, holder);
+			wd = wlink2wd(holder);
+			if ((xnsticks_t)(wd->wdate - now) > 0)
+				continue; /* Due in a later round. */
+			removeq(q, holder);
+			appendq(&wd_wheel.expired, holder);
+			wd->wqueue = &wd_wheel.expired;
+			wd_wheel.count--;
+		}
+	}
+
+	wd_wheel.last = now;
+
+	if (wd_wheel.count == 0)
+		xntimer_stop(&wd_wheel.timer);
+
+	if (!emptyq_p(&wd_wheel.expired))
+		xnpod_resume_thread(&wd_wheel.server, XNSUSP);
+}
+
+static void wd_wheel_server(void *cookie)
+{
+	xnholder_t *holder;
+	wind_wd_t *wd;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	for (;;) {
+		while ((holder = getq(&wd_wheel.expired)) != NULL) {
+			wd = wlink2wd(holder);
+			wd->wqueue = NULL;
+			wd->handler(wd->arg);
+		}
+		xnpod_suspend_thread(&wd_wheel.server, XNSUSP,
+				     XN_INFINITE, XN_RELATIVE, NULL);
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+}
+
 #ifdef CONFIG_XENO_OPT_VFILE
 
+static xnticks_t wd_get_timeout(wind_wd_t *wd)
+{
+	xnticks_t now;
+
+	if (wd->wqueue == NULL)
+		return xntimer_get_timeout(&wd->timerbase);
+
+	now = xntbase_get_jiffies(wind_tbase);
+
+	return (xnsticks_t)(wd->wdate - now) > 0 ? wd->wdate - now : 1;
+}
+
 struct vfile_priv {
 	struct xnpholder *curr;
 	xnticks_t timeout;
@@ -52,7 +170,7 @@ static int vfile_rewind(struct xnvfile_snapshot_iterator *it)
 	priv->curr = NULL;
 	nr = 0;
 #endif
-	priv->timeout = xntimer_get_timeout(&wd->timerbase);
+	priv->timeout = wd_get_timeout(wd);
 
 	return nr;
 }
@@ -66,7 +184,7 @@ static int vfile_next(struct xnvfile_snapshot_iterator *it, void *data)
 	struct xnthread *thread;
 
 	/* Refresh as we collect. */
-	priv->timeout = xntimer_get_timeout(&wd->timerbase);
+	priv->timeout = wd_get_timeout(wd);
 
 	if (priv->curr == NULL)
 		return 0;	/* We are done. */
@@ -141,11 +259,63 @@ static void wind_wd_trampoline(xntimer_t *timer)
 
 void wind_wd_init(void)
 {
+	union xnsched_policy_param param;
+	struct xnthread_start_attr sattr;
+	struct xnthread_init_attr iattr;
+	int n;
+
+	if (!xntbase_periodic_p(wind_tbase))
+		return;
+
+	for (n = 0; n < WIND_WD_WHEELSIZE; n++)
+		initq(&wd_wheel.slot[n]);
+	initq(&wd_wheel.expired);
+	wd_wheel.count = 0;
+	xntimer_init(&wd_wheel.timer, wind_tbase, wd_wheel_handler);
+	xntimer_set_name(&wd_wheel.timer, "[vxworks-wd]");
+
+	iattr.tbase = wind_tbase;
+	iattr.name = "wdServer";
+	iattr.flags = 0;
+	iattr.ops = NULL;
+	iattr.stacksize = 0;
+	param.rt.prio = XNSCHED_IRQ_PRIO;
+
+	if (xnpod_init_thread(&wd_wheel.server, &iattr,
+			      &xnsched_class_rt, &param))
+		goto fail;
+
+	sattr.mode = 0;
+	sattr.imask = 0;
+	sattr.affinity = XNPOD_ALL_CPUS;
+	sattr.entry = wd_wheel_server;
+	sattr.cookie = NULL;
+
+	if (xnpod_start_thread(&wd_wheel.server, &sattr)) {
+		xnpod_delete_thread(&wd_wheel.server);
+		goto fail;
+	}
+
+	wd_wheel.enabled = 1;
+
+	return;
+
+fail:
+	/* Fall back to one nucleus timer per watchdog. */
+	xntimer_destroy(&wd_wheel.timer);
+	xnlogerr("VxWorks: no watchdog server, using plain timers.\n");
 }
 
 void wind_wd_cleanup(void)
 {
 	wind_wd_flush_rq(&__wind_global_rholder.wdq);
+
+	if (!wd_wheel.enabled)
+		return;
+
+	wd_wheel.enabled = 0;
+	xntimer_destroy(&wd_wheel.timer);
+	xnpod_delete_thread(&wd_wheel.server);
 }
 
 WDOG_ID wdCreate(void)
@@ -163,6 +333,8 @@ WDOG_ID wdCreate(void)
 #endif /* CONFIG_XENO_OPT_PERVASIVE */
 
 	xntimer_init(&wd->timerbase, wind_tbase, wind_wd_trampoline);
+	inith(&wd->wlink);
+	wd->wqueue = NULL;
 
 	inith(&wd->rlink);
 	wd->rqueue = &wind_get_rholder()->wdq;
@@ -214,13 +386,18 @@ STATUS wdStart(WDOG_ID wdog_id, int timeout, wind_timer_t handler, long arg)
 
 	if (testbits(wd->timerbase.status, WIND_WD_INITIALIZED))
 		__clrbits(wd->timerbase.status, WIND_WD_INITIALIZED);
-	else
+	else {
+		wd_wheel_cancel(wd);
 		xntimer_stop(&wd->timerbase);
+	}
 
 	wd->handler = handler;
 	wd->arg = arg;
 
-	xntimer_start(&wd->timerbase, timeout, XN_INFINITE, XN_RELATIVE);
+	if (wd_wheel.enabled)
+		wd_wheel_start(wd, timeout);
+	else
+		xntimer_start(&wd->timerbase, timeout, XN_INFINITE, XN_RELATIVE);
 
 	xnlock_put_irqrestore(&nklock, s);
 	return OK;
@@ -237,6 +414,7 @@ STATUS wdCancel(WDOG_ID wdog_id)
 
 	xnlock_get_irqsave(&nklock, s);
 	check_OBJ_ID_ERROR(wdog_id, wind_wd_t, wd, WIND_WD_MAGIC, goto error);
+	wd_wheel_cancel(wd);
 	xntimer_stop(&wd->timerbase);
 	xnlock_put_irqrestore(&nklock, s);
 
@@ -251,6 +429,7 @@ STATUS wdCancel(WDOG_ID wdog_id)
 static void wd_destroy_internal(wind_wd_t *wd)
 {
 	removeq(wd->rqueue, &wd->rlink);
+	wd_wheel_cancel(wd);
 	xntimer_destroy(&wd->timerbase);
 	xnregistry_remove(wd->handle);
 #ifdef CONFIG_XENO_OPT_PERVASIVE
@@ -90,6 +90,94 @@ int a4l_snd_cancel(a4l_desc_t * dsc, unsigned int idx_subd)
 	return __sys_ioctl(dsc->fd, A4L_CANCEL, (void *)(long)idx_subd);
 }
 
+/**
+ * @brief Read the stream of a command sent by another descriptor
+ *
+ * The function a4l_attach_reader() turns the descriptor into a
+ * secondary reader of the input command in progress on the
+ * subdevice, sent through another descriptor (possibly by another
+ * process). The reader gets its own position in the stream, starting
+ * with the oldest data the command's owner did not consume yet, and
+ * may then use a4l_async_read() and a4l_poll() as usual; its wake-up
+ * threshold is set by a4l_set_wakesize() on its own descriptor.
+ *
+ * The acquisition is never slowed down by the secondary readers: a
+ * reader which falls behind the owner of the command misses data;
+ * the next read or poll then fails with -EPIPE, and the following
+ * ones go on with the oldest data still available. Once the command
+ * is over, the reads return 0, or -EPIPE first if the reader did not
+ * get the whole acquisition. a4l_snd_cancel() on the reader's
+ * descriptor detaches it, without affecting the command.
+ *
+ * @param[in] dsc Device descriptor filled by a4l_open() (and
+ * optionally a4l_fill_desc())
+ * @param[in] idx_subd Index of the input subdevice
+ *
+ * @return 0 on success. Otherwise:
+ *
+ * - -EINVAL is returned if some argument is missing or wrong, or the
+ *    subdevice is not an input one (Please, type "dmesg" for more
+ *    info)
+ * - -EBUSY is returned if the descriptor already runs a command or
+ *    reads another stream
+ * - -ENOENT is returned if no command is in progress on the
+ *    subdevice
+ *
+ */
+int a4l_attach_reader(a4l_desc_t * dsc, unsigned int idx_subd)
+{
+	/* Basic checking */
+	if (dsc == NULL || dsc->fd < 0)
+		return -EINVAL;
+
+	return __sys_ioctl(dsc->fd, A4L_BUFSHARE, (void *)(long)idx_subd);
+}
+
+/**
+ * @brief Start several asynchronous acquisitions at once
+ *
+ * The function a4l_snd_grptrig() fires the start triggers of several
+ * commands in a row, with interrupts disabled, so that they begin as
+ * close in time as possible. The commands may run on different
+ * devices; each of them must have been sent beforehand with
+ * start_src set to TRIG_INT. This is the way to start a
+ * multi-board acquisition when the boards share a conversion clock
+ * (e.g. through RTSI): all the streams then begin on the same clock
+ * edge. On success, the date field of each member is updated with
+ * its trigger date.
+ *
+ * @param[in] dsc Device descriptor filled by a4l_open(), used to
+ * issue the request
+ * @param[in,out] members Commands to trigger; the fd field holds the
+ * descriptor of the device running the command (the fd field of the
+ * related a4l_desc_t)
+ * @param[in] nb_members Count of members, up to A4L_GRP_MAX_MEMBERS
+ *
+ * @return 0 on success. Otherwise:
+ *
+ * - -EINVAL is returned if some argument is missing or wrong, or if
+ *    a command cannot be triggered (Please, type "dmesg" for more
+ *    info)
+ * - -EBADF is returned if a member fd is not valid
+ * - -ENOENT is returned if no command runs on a member subdevice
+ * - -EFAULT is returned if a user <-> kernel transfer went wrong
+ *
+ */
+int a4l_snd_grptrig(a4l_desc_t * dsc,
+		    a4l_grpmbr_t * members, unsigned int nb_members)
+{
+	a4l_grptrig_t grp;
+
+	/* Basic checking */
+	if (dsc == NULL || dsc->fd < 0 || members == NULL)
+		return -EINVAL;
+
+	grp.nb_members = nb_members;
+	grp.members = members;
+
+	return __sys_ioctl(dsc->fd, A4L_GRPTRIG, &grp);
+}
+
 /**
  * @brief Change the size of the asynchronous buffer
  *
@@ -134,14 +222,79 @@ int a4l_set_bufsize(a4l_desc_t * dsc,
 int a4l_set_wakesize(a4l_desc_t * dsc, unsigned long size)
 {
 	int err;
-	a4l_bufcfg2_t cfg = { .wake_count = size };
+	a4l_bufcfg2_t cfg;
 
 	/* Basic checking */
 	if (dsc == NULL || dsc->fd < 0)
 		return -EINVAL;
 
+	/* Do not alter the allocation flags */
+	err = __sys_ioctl(dsc->fd, A4L_BUFINFO2, &cfg);
+	if (err)
+		return err;
+
+	cfg.wake_count = size;
+
 	return  __sys_ioctl(dsc->fd, A4L_BUFCFG2, &cfg);
-	
+}
+
+/**
+ * @brief Change the allocation mode of the asynchronous buffer
+ *
+ * By default, the asynchronous buffer is only virtually
+ * contiguous. Passing A4L_BUF_CONTIG in @a flags requests a
+ * physically contiguous buffer instead, which DMA-capable drivers can
+ * fill through a single descriptor and which costs fewer TLB entries
+ * on access. The buffer is reallocated at once if the mode changes;
+ * if no large enough physical block is available, the buffer
+ * silently falls back to the default mode. a4l_get_bufflags()
+ * returns the mode actually in use.
+ *
+ * @param[in] dsc Device descriptor filled by a4l_open() (and
+ * optionally a4l_fill_desc())
+ * @param[in] flags Allocation flags (0 or A4L_BUF_CONTIG)
+ *
+ * @return 0 on success. Otherwise:
+ *
+ * - -EINVAL is returned if the analogy descriptor is not correct
+ * - -EPERM is returned if the buffer is mapped in user-space
+ * - -ENOSYS is returned if the function is called in an RT context
+ * - -EBUSY is returned if an asynchronous operation is in progress
+ * - -ENOMEM is returned if the system is out of memory
+ *
+ */
+int a4l_set_bufflags(a4l_desc_t * dsc, unsigned long flags)
+{
+	int err;
+	a4l_bufcfg2_t cfg;
+
+	/* Basic checking */
+	if (dsc == NULL || dsc->fd < 0)
+		return -EINVAL;
+
+	err = __sys_ioctl(dsc->fd, A4L_BUFINFO2, &cfg);
+	if (err)
+		return err;
+
+	cfg.flags = flags;
+
+	return  __sys_ioctl(dsc->fd, A4L_BUFCFG2, &cfg);
+}
+
+int a4l_get_bufflags(a4l_desc_t * dsc, unsigned long *flags)
+{
+	int err;
+	a4l_bufcfg2_t cfg;
+
+	/* Basic checking */
+	if (flags == NULL || dsc == NULL || dsc->fd < 0)
+		return -EINVAL;
+
+	err = __sys_ioctl(dsc->fd, A4L_BUFINFO2, &cfg);
+
+	if (err == 0)
+		*flags = cfg.flags;
+
 	return err;
 }
 
@@ -162,6 +315,104 @@ int a4l_get_wakesize(a4l_desc_t * dsc, unsigned long *size)
 	return err;
 }
 
+/**
+ * @brief Set a period-based wake-up for the asynchronous buffer
+ *
+ * The wake-up size set by a4l_set_wakesize() delays the wake-ups
+ * until enough data is available. A wake-up period additionally
+ * bounds that delay: once @a period nanoseconds have elapsed since
+ * the previous period-based wake-up, any pending data wakes up the
+ * reader, whatever its amount. With a zero wake-up size, the reader
+ * is only awakened on period boundaries and at the end of the
+ * acquisition, e.g. once per control cycle. The period is checked
+ * whenever the driver reports new data, so its resolution is the
+ * driver's event rate.
+ *
+ * @param[in] dsc Device descriptor filled by a4l_open() (and
+ * optionally a4l_fill_desc())
+ * @param[in] period Wake-up period in nanoseconds, 0 to disable it
+ *
+ * @return 0 on success. Otherwise:
+ *
+ * - -EINVAL is returned if the analogy descriptor is not correct
+ *
+ */
+int a4l_set_wakeperiod(a4l_desc_t * dsc, unsigned long period)
+{
+	int err;
+	a4l_bufcfg2_t cfg;
+
+	/* Basic checking */
+	if (dsc == NULL || dsc->fd < 0)
+		return -EINVAL;
+
+	err = __sys_ioctl(dsc->fd, A4L_BUFINFO2, &cfg);
+	if (err)
+		return err;
+
+	cfg.wake_period = period;
+
+	return  __sys_ioctl(dsc->fd, A4L_BUFCFG2, &cfg);
+}
+
+int a4l_get_wakeperiod(a4l_desc_t * dsc, unsigned long *period)
+{
+	int err;
+	a4l_bufcfg2_t cfg;
+
+	/* Basic checking */
+	if (period == NULL || dsc == NULL || dsc->fd < 0)
+		return -EINVAL;
+
+	err = __sys_ioctl(dsc->fd, A4L_BUFINFO2, &cfg);
+
+	if (err == 0)
+		*period = cfg.wake_period;
+
+	return err;
+}
+
+/**
+ * @brief Get the position where the last command broke
+ *
+ * When an acquisition fails because of a buffer overrun (input) or
+ * underrun (output), the driver records the position in the stream
+ * of the first sample which got lost or which was sent without
+ * having been written. The position remains available after the
+ * cancellation, until the next command is sent.
+ *
+ * @param[in] dsc Device descriptor filled by a4l_open() (and
+ * optionally a4l_fill_desc())
+ * @param[out] pos Position in bytes from the start of the
+ * acquisition; dividing it by the scan size gives the scan index
+ *
+ * @return 0 on success. Otherwise:
+ *
+ * - -EINVAL is returned if the analogy descriptor is not correct
+ * - -ENOENT is returned if the last command did not fail
+ *
+ */
+int a4l_get_errpos(a4l_desc_t * dsc, unsigned long *pos)
+{
+	int err;
+	a4l_bufcfg2_t cfg;
+
+	/* Basic checking */
+	if (pos == NULL || dsc == NULL || dsc->fd < 0)
+		return -EINVAL;
+
+	err = __sys_ioctl(dsc->fd, A4L_BUFINFO2, &cfg);
+	if (err)
+		return err;
+
+	if (cfg.err_count == A4L_BUF_NOERR)
+		return -ENOENT;
+
+	*pos = cfg.err_count;
+
+	return 0;
+}
+
 /**
  * @brief Get the size of the asynchronous buffer
  *
@@ -278,6 +529,10 @@ int a4l_mark_bufrw(a4l_desc_t * dsc,
  * A4L_NONBLOCK causes the function to return immediately without
  * waiting for any available data
  *
+ * On an input subdevice, if a wake-up size was set with
+ * a4l_set_wakesize(), the function waits until that much data is
+ * available, the wake-up period elapses or the acquisition ends.
+ *
  * @return the available data count. Otherwise:
  *
  * - -EINVAL is returned if some argument is missing or wrong (Please,
@@ -349,6 +604,52 @@ int a4l_mmap(a4l_desc_t * dsc,
 	return ret;
 }
 
+/**
+ * @brief Map the event stamps ring into a user-space
+ *
+ * Once the stamps ring is mapped, each data event reported by the
+ * driver (usually from its interrupt handler) is recorded with its
+ * date on the Xenomai clock and the count of bytes the device
+ * transferred so far. Given two records around a sample, its date can
+ * be interpolated from its byte position, without any syscall or
+ * clock read on the consumer side. See a4l_bufstps_t for the layout
+ * and the lockless read protocol.
+ *
+ * @param[in] dsc Device descriptor filled by a4l_open() (and
+ * optionally a4l_fill_desc())
+ * @param[in] idx_subd Index of the concerned subdevice
+ * @param[out] ptr Address of the pointer containing the assigned
+ * address on return
+ *
+ * @return 0 on success. Otherwise:
+ *
+ * - -EINVAL is returned if some argument is missing or wrong
+ * - -ENOSYS is returned if the function is called in an RT context
+ * - -ENOMEM is returned if the system is out of memory
+ * - -EFAULT is returned if a user <-> kernel transfer went wrong
+ *
+ */
+int a4l_mmap_stamps(a4l_desc_t * dsc,
+		    unsigned int idx_subd, a4l_bufstps_t **ptr)
+{
+	int ret;
+	a4l_mmap_t map = { idx_subd, 0, NULL };
+
+	/* Basic checkings */
+	if (dsc == NULL || dsc->fd < 0)
+		return -EINVAL;
+
+	if (ptr == NULL)
+		return -EINVAL;
+
+	ret = __sys_ioctl(dsc->fd, A4L_MMAPSTAMP, &map);
+
+	if (ret == 0)
+		*ptr = map.ptr;
+
+	return ret;
+}
+
 /** @} Command syscall API */
 
 /*!
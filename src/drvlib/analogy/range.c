@@ -57,6 +57,85 @@ void data8_set(void *dst, lsampl_t val)
 	*((unsigned char *)(dst)) = (unsigned char)(0xff & val);
 }
 
+/*
+ * Width-specialized conversion loops. Going through the data*_get()
+ * and data*_set() accessors for each sample prevents the compiler
+ * from vectorizing anything; expanding the loops once per sample
+ * type with constant strides does not. Strides are expressed in
+ * bytes on the raw side, in elements on the physical side, so that
+ * the same loops also serve the multiplexed scan conversions.
+ */
+
+#define __rawto_loop(type, dst, dstep, src, sstep, cnt, a, b)		\
+	do {								\
+		int __j;						\
+		for (__j = 0; __j < (cnt); __j++)			\
+			(dst)[__j * (dstep)] = (a) *			\
+				*(type *)((char *)(src) + __j * (sstep)) + (b); \
+	} while (0)
+
+#define __rawto_switch(size, dst, dstep, src, sstep, cnt, a, b)		\
+	do {								\
+		switch (size) {						\
+		case 4:							\
+			__rawto_loop(lsampl_t, dst, dstep, src, sstep, cnt, a, b); \
+			break;						\
+		case 2:							\
+			__rawto_loop(sampl_t, dst, dstep, src, sstep, cnt, a, b); \
+			break;						\
+		default:						\
+			__rawto_loop(unsigned char, dst, dstep, src, sstep, cnt, a, b); \
+		}							\
+	} while (0)
+
+#define __toraw_loop(type, dst, src, cnt, a, b)				\
+	do {								\
+		type *__p = (type *)(dst);				\
+		int __j;						\
+		for (__j = 0; __j < (cnt); __j++)			\
+			__p[__j] = (type)(lsampl_t)((a) * (src)[__j] - (b)); \
+	} while (0)
+
+#define __toraw_switch(size, dst, src, cnt, a, b)			\
+	do {								\
+		switch (size) {						\
+		case 4:							\
+			__toraw_loop(lsampl_t, dst, src, cnt, a, b);	\
+			break;						\
+		case 2:							\
+			__toraw_loop(sampl_t, dst, src, cnt, a, b);	\
+			break;						\
+		default:						\
+			__toraw_loop(unsigned char, dst, src, cnt, a, b); \
+		}							\
+	} while (0)
+
+/* Factors of the raw to physical conversion (phys = a * raw + b) */
+static inline void rawto_factors(a4l_chinfo_t *chan,
+				 a4l_rnginfo_t *rng, double *a, double *b)
+{
+	*a = ((double)(rng->max - rng->min)) /
+		(((1ULL << chan->nb_bits) - 1) * A4L_RNG_FACTOR);
+	*b = ((double)rng->min) / A4L_RNG_FACTOR;
+}
+
+/* Sum up the sample sizes of a scan, checking the descriptors */
+static int scan_size(a4l_chinfo_t **chans, a4l_rnginfo_t **rngs, int nchans)
+{
+	int i, size, ret = 0;
+
+	for (i = 0; i < nchans; i++) {
+		if (chans[i] == NULL || rngs[i] == NULL)
+			return -EINVAL;
+		size = a4l_sizeof_chan(chans[i]);
+		if (size != 1 && size != 2 && size != 4)
+			return -EINVAL;
+		ret += size;
+	}
+
+	return ret;
+}
+
 #endif /* !DOXYGEN_CPP */
 
 /*!
@@ -309,14 +388,12 @@ int a4l_rawtoul(a4l_chinfo_t * chan, unsigned long *dst, void *src, int cnt)
 int a4l_rawtof(a4l_chinfo_t * chan,
 	       a4l_rnginfo_t * rng, float *dst, void *src, int cnt)
 {
-	int size, i = 0, j = 0;
-	lsampl_t tmp;
+	int size;
 
 	/* Temporary values used for conversion
 	   (phys = a * src + b) */
 	float a, b;
-	/* Temporary data accessor */
-	lsampl_t(*datax_get) (void *);
+	double da, db;
 
 	/* Basic checking */
 	if (rng == NULL || chan == NULL)
@@ -324,41 +401,27 @@ int a4l_rawtof(a4l_chinfo_t * chan,
 
 	/* Find out the size in memory */
 	size = a4l_sizeof_chan(chan);
+	if (size != 1 && size != 2 && size != 4)
+		return -EINVAL;
 
-	/* Get the suitable accessor */
-	switch (a4l_sizeof_chan(chan)) {
+	/* Compute the translation factor and the constant only once */
+	rawto_factors(chan, rng, &da, &db);
+	a = da;
+	b = db;
+
+	/* Perform the conversion with the loop matching the width */
+	switch (size) {
 	case 4:
-		datax_get = data32_get;
+		__rawto_loop(lsampl_t, dst, 1, src, 4, cnt, a, b);
 		break;
 	case 2:
-		datax_get = data16_get;
-		break;
-	case 1:
-		datax_get = data8_get;
+		__rawto_loop(sampl_t, dst, 1, src, 2, cnt, a, b);
 		break;
 	default:
-		return -EINVAL;
-	};
-
-	/* Compute the translation factor and the constant only once */
-	a = ((float)(rng->max - rng->min)) /
-		(((1ULL << chan->nb_bits) - 1) * A4L_RNG_FACTOR);
-	b = ((float)rng->min) / A4L_RNG_FACTOR;
-
-	while (j < cnt) {
-
-		/* Properly retrieve the data */
-		tmp = datax_get(src + i);
-
-		/* Perform the conversion */
-		dst[j] = a * tmp + b;
-
-		/* Update the counters */
-		i += size;
-		j++;
+		__rawto_loop(unsigned char, dst, 1, src, 1, cnt, a, b);
 	}
 
-	return j;
+	return cnt < 0 ? 0 : cnt;
 }
 
 /**
@@ -382,14 +445,12 @@ int a4l_rawtof(a4l_chinfo_t * chan,
 int a4l_rawtod(a4l_chinfo_t * chan,
 	       a4l_rnginfo_t * rng, double *dst, void *src, int cnt)
 {
-	int size, i = 0, j = 0;
-	lsampl_t tmp;
+	int size;
 
 	/* Temporary values used for conversion
 	   (phys = a * src + b) */
 	double a, b;
-	/* Temporary data accessor */
-	lsampl_t(*datax_get) (void *);
+	double da, db;
 
 	/* Basic checking */
 	if (rng == NULL || chan == NULL)
@@ -397,41 +458,27 @@ int a4l_rawtod(a4l_chinfo_t * chan,
 
 	/* Find out the size in memory */
 	size = a4l_sizeof_chan(chan);
+	if (size != 1 && size != 2 && size != 4)
+		return -EINVAL;
 
-	/* Get the suitable accessor */
-	switch (a4l_sizeof_chan(chan)) {
+	/* Compute the translation factor and the constant only once */
+	rawto_factors(chan, rng, &da, &db);
+	a = da;
+	b = db;
+
+	/* Perform the conversion with the loop matching the width */
+	switch (size) {
 	case 4:
-		datax_get = data32_get;
+		__rawto_loop(lsampl_t, dst, 1, src, 4, cnt, a, b);
 		break;
 	case 2:
-		datax_get = data16_get;
-		break;
-	case 1:
-		datax_get = data8_get;
+		__rawto_loop(sampl_t, dst, 1, src, 2, cnt, a, b);
 		break;
 	default:
-		return -EINVAL;
-	};
-
-	/* Computes the translation factor and the constant only once */
-	a = ((double)(rng->max - rng->min)) /
-		(((1ULL << chan->nb_bits) - 1) * A4L_RNG_FACTOR);
-	b = ((double)rng->min) / A4L_RNG_FACTOR;
-
-	while (j < cnt) {
-
-		/* Properly retrieve the data */
-		tmp = datax_get(src + i);
-
-		/* Perform the conversion */
-		dst[j] = a * tmp + b;
-
-		/* Update the counters */
-		i += size;
-		j++;
+		__rawto_loop(unsigned char, dst, 1, src, 1, cnt, a, b);
 	}
 
-	return j;
+	return cnt < 0 ? 0 : cnt;
 }
 
 /**
@@ -519,13 +566,11 @@ int a4l_ultoraw(a4l_chinfo_t * chan, void *dst, unsigned long *src, int cnt)
 int a4l_ftoraw(a4l_chinfo_t * chan,
 	       a4l_rnginfo_t * rng, void *dst, float *src, int cnt)
 {
-	int size, i = 0, j = 0;
+	int size;
 
 	/* Temporary values used for conversion
 	   (dst = a * phys - b) */
 	float a, b;
-	/* Temporary data accessor */
-	void (*datax_set) (void *, lsampl_t);
 
 	/* Basic checking */
 	if (rng == NULL || chan == NULL)
@@ -533,21 +578,8 @@ int a4l_ftoraw(a4l_chinfo_t * chan,
 
 	/* Find out the size in memory */
 	size = a4l_sizeof_chan(chan);
-
-	/* Select the suitable accessor */
-	switch (size) {
-	case 4:
-		datax_set = data32_set;
-		break;
-	case 2:
-		datax_set = data16_set;
-		break;
-	case 1:
-		datax_set = data8_set;
-		break;
-	default:
+	if (size != 1 && size != 2 && size != 4)
 		return -EINVAL;
-	};
 
 	/* Computes the translation factor and the constant only once */
 	a = (((float)A4L_RNG_FACTOR) / (rng->max - rng->min)) *
@@ -555,17 +587,10 @@ int a4l_ftoraw(a4l_chinfo_t * chan,
 	b = ((float)(rng->min) / (rng->max - rng->min)) *
 		((1ULL << chan->nb_bits) - 1);
 
-	while (j < cnt) {
+	/* Performs the conversion with the loop matching the width */
+	__toraw_switch(size, dst, src, cnt, a, b);
 
-		/* Performs the conversion */
-		datax_set(dst + i, (lsampl_t) (a * src[j] - b));
-
-		/* Updates the counters */
-		i += size;
-		j++;
-	}
-
-	return j;
+	return cnt < 0 ? 0 : cnt;
 }
 
 /**
@@ -589,13 +614,11 @@ int a4l_ftoraw(a4l_chinfo_t * chan,
 int a4l_dtoraw(a4l_chinfo_t * chan,
 	       a4l_rnginfo_t * rng, void *dst, double *src, int cnt)
 {
-	int size, i = 0, j = 0;
+	int size;
 
 	/* Temporary values used for conversion
 	   (dst = a * phys - b) */
 	double a, b;
-	/* Temporary data accessor */
-	void (*datax_set) (void *, lsampl_t);
 
 	/* Basic checking */
 	if (rng == NULL || chan == NULL)
@@ -603,21 +626,8 @@ int a4l_dtoraw(a4l_chinfo_t * chan,
 
 	/* Find out the size in memory */
 	size = a4l_sizeof_chan(chan);
-
-	/* Select the suitable accessor */
-	switch (size) {
-	case 4:
-		datax_set = data32_set;
-		break;
-	case 2:
-		datax_set = data16_set;
-		break;
-	case 1:
-		datax_set = data8_set;
-		break;
-	default:
+	if (size != 1 && size != 2 && size != 4)
 		return -EINVAL;
-	};
 
 	/* Computes the translation factor and the constant only once */
 	a = (((double)A4L_RNG_FACTOR) / (rng->max - rng->min)) *
@@ -625,16 +635,140 @@ int a4l_dtoraw(a4l_chinfo_t * chan,
 	b = ((double)(rng->min) / (rng->max - rng->min)) *
 		((1ULL << chan->nb_bits) - 1);
 
-	while (j < cnt) {
+	/* Performs the conversion with the loop matching the width */
+	__toraw_switch(size, dst, src, cnt, a, b);
 
-		/* Performs the conversion */
-		datax_set(dst + i, (lsampl_t) (a * src[j] - b));
+	return cnt < 0 ? 0 : cnt;
+}
 
-		/* Updates the counters */
-		i += size;
-		j++;
+/**
+ * @brief Convert a multiplexed acquisition to float-typed samples
+ *
+ * This function converts in one call a buffer holding @a nscans
+ * scans, each of them made of one sample per channel listed in @a
+ * chans, every channel being converted with its own range. The raw
+ * samples of a scan are packed according to the width of their
+ * channel, as they are delivered by the acquisition subdevice.
+ *
+ * By default, the output keeps the interleaved layout of the
+ * acquisition (dst[scan * nchans + chan]). With the A4L_SCAN_PLANAR
+ * flag, the samples of each channel are gathered into a contiguous
+ * block instead (dst[chan * nscans + scan]), which is usually what
+ * the downstream signal processing wants.
+ *
+ * @param[in] chans Table of @a nchans channel descriptors
+ * @param[in] rngs Table of @a nchans range descriptors
+ * @param[in] nchans Count of channels in a scan
+ * @param[out] dst Ouput buffer (nchans * nscans elements)
+ * @param[in] src Input buffer
+ * @param[in] nscans Count of scans to convert
+ * @param[in] flags A4L_SCAN_PLANAR or 0
+ *
+ * @return the count of conversion performed, otherwise a negative
+ * error code:
+ *
+ * - -EINVAL is returned if some argument is missing or wrong;
+ *    chans, rngs and the pointers should be checked; check also the
+ *    kernel log ("dmesg"); WARNING: a4l_fill_desc() should be called
+ *    before using a4l_rawtof_scan()
+ *
+ */
+int a4l_rawtof_scan(a4l_chinfo_t **chans, a4l_rnginfo_t **rngs,
+		    int nchans, float *dst, void *src, int nscans, int flags)
+{
+	int i, size, offset = 0, ssize, dstep;
+	float a, b, *p;
+	double da, db;
+
+	/* Basic checking */
+	if (chans == NULL || rngs == NULL || nchans <= 0 || nscans < 0)
+		return -EINVAL;
+
+	ssize = scan_size(chans, rngs, nchans);
+	if (ssize < 0)
+		return ssize;
+
+	dstep = (flags & A4L_SCAN_PLANAR) ? 1 : nchans;
+
+	/* Convert channel by channel, so that the factors are
+	   computed once for the whole buffer */
+	for (i = 0; i < nchans; i++) {
+		size = a4l_sizeof_chan(chans[i]);
+		rawto_factors(chans[i], rngs[i], &da, &db);
+		a = da;
+		b = db;
+		p = (flags & A4L_SCAN_PLANAR) ? dst + i * nscans : dst + i;
+		__rawto_switch(size, p, dstep,
+			       (char *)src + offset, ssize, nscans, a, b);
+		offset += size;
 	}
 
-	return j;
+	return nchans * nscans;
+}
+
+/**
+ * @brief Convert a multiplexed acquisition to double-typed samples
+ *
+ * This function converts in one call a buffer holding @a nscans
+ * scans, each of them made of one sample per channel listed in @a
+ * chans, every channel being converted with its own range. The raw
+ * samples of a scan are packed according to the width of their
+ * channel, as they are delivered by the acquisition subdevice.
+ *
+ * By default, the output keeps the interleaved layout of the
+ * acquisition (dst[scan * nchans + chan]). With the A4L_SCAN_PLANAR
+ * flag, the samples of each channel are gathered into a contiguous
+ * block instead (dst[chan * nscans + scan]), which is usually what
+ * the downstream signal processing wants.
+ *
+ * @param[in] chans Table of @a nchans channel descriptors
+ * @param[in] rngs Table of @a nchans range descriptors
+ * @param[in] nchans Count of channels in a scan
+ * @param[out] dst Ouput buffer (nchans * nscans elements)
+ * @param[in] src Input buffer
+ * @param[in] nscans Count of scans to convert
+ * @param[in] flags A4L_SCAN_PLANAR or 0
+ *
+ * @return the count of conversion performed, otherwise a negative
+ * error code:
+ *
+ * - -EINVAL is returned if some argument is missing or wrong;
+ *    chans, rngs and the pointers should be checked; check also the
+ *    kernel log ("dmesg"); WARNING: a4l_fill_desc() should be called
+ *    before using a4l_rawtod_scan()
+ *
+ */
+int a4l_rawtod_scan(a4l_chinfo_t **chans, a4l_rnginfo_t **rngs,
+		    int nchans, double *dst, void *src, int nscans, int flags)
+{
+	int i, size, offset = 0, ssize, dstep;
+	double a, b, *p;
+	double da, db;
+
+	/* Basic checking */
+	if (chans == NULL || rngs == NULL || nchans <= 0 || nscans < 0)
+		return -EINVAL;
+
+	ssize = scan_size(chans, rngs, nchans);
+	if (ssize < 0)
+		return ssize;
+
+	dstep = (flags & A4L_SCAN_PLANAR) ? 1 : nchans;
+
+	/* Convert channel by channel, so that the factors are
+	   computed once for the whole buffer */
+	for (i = 0; i < nchans; i++) {
+		size = a4l_sizeof_chan(chans[i]);
+		rawto_factors(chans[i], rngs[i], &da, &db);
+		a = da;
+		b = db;
+		p = (flags & A4L_SCAN_PLANAR) ? dst + i * nscans : dst + i;
+		__rawto_switch(size, p, dstep,
+			       (char *)src + offset, ssize, nscans, a, b);
+		offset += size;
+	}
+
+	return nchans * nscans;
 }
+
 /** @} Range / conversion  API */
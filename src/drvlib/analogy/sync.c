@@ -93,6 +93,70 @@ int a4l_snd_insn(a4l_desc_t * dsc, a4l_insn_t * arg)
 	return __sys_ioctl(dsc->fd, A4L_INSN, arg);
 }
 
+/**
+ * @brief Register a precompiled list of synchronous instructions
+ *
+ * The function a4l_snd_insnprg() hands a list of instructions over to
+ * the kernel once and for all, so that a4l_run_insnprg() may perform
+ * it many times (e.g. once per control cycle) at the cost of a
+ * single syscall, without any copy. The data buffers of the
+ * instructions are gathered into an area shared with the kernel: on
+ * return, the data pointer of each instruction in @a arg->insns
+ * points to its buffer in that area, loaded with the initial values
+ * of the write instructions. The application then updates the output
+ * values and reads the input values in place. Registering an empty
+ * list drops the current program.
+ *
+ * @param[in] dsc Device descriptor filled by a4l_open() (and
+ * optionally a4l_fill_desc())
+ * @param[in,out] arg Instructions program structure
+ *
+ * @return 0 on success. Otherwise:
+ *
+ * - -EINVAL is returned if some argument is missing or wrong (Please,
+ *    type "dmesg" for more info)
+ * - -EFAULT is returned if a user <-> kernel transfer went wrong
+ * - -ENOMEM is returned if the system is out of memory
+ * - -ENOSYS is returned if the function is called in an RT context
+ * - -EBUSY is returned if the current program is running
+ *
+ */
+int a4l_snd_insnprg(a4l_desc_t * dsc, a4l_insnprg_t * arg)
+{
+	/* Basic checking */
+	if (dsc == NULL || dsc->fd < 0)
+		return -EINVAL;
+
+	return __sys_ioctl(dsc->fd, A4L_INSNPRG, arg);
+}
+
+/**
+ * @brief Perform the precompiled list of synchronous instructions
+ *
+ * The function a4l_run_insnprg() performs the instructions registered
+ * with a4l_snd_insnprg(), in order, on their buffers in the shared
+ * data area.
+ *
+ * @param[in] dsc Device descriptor filled by a4l_open() (and
+ * optionally a4l_fill_desc())
+ *
+ * @return 0 on success. Otherwise:
+ *
+ * - -EINVAL is returned if some argument is missing or wrong (Please,
+ *    type "dmesg" for more info)
+ * - -ENOENT is returned if no program was registered
+ * - -EBUSY is returned if the program is already running
+ *
+ */
+int a4l_run_insnprg(a4l_desc_t * dsc)
+{
+	/* Basic checking */
+	if (dsc == NULL || dsc->fd < 0)
+		return -EINVAL;
+
+	return __sys_ioctl(dsc->fd, A4L_INSNPRGRUN, NULL);
+}
+
 /** @} Synchronous acquisition API */
 
 /** @} Level 1 API */
@@ -18,7 +18,9 @@
 
 #include <signal.h>
 #include <stdlib.h>
+#include <unistd.h>
 
+#include <rtdk.h>
 #include "internal.h"
 
 #include <nucleus/thread.h>
@@ -64,12 +66,99 @@ void assert_nrt_fast(void)
 /* Memory allocation services */
 void *__wrap_malloc(size_t size)
 {
+	void *ptr;
+
+	if (xeno_malloc_wrapped()) {
+		ptr = xeno_malloc(size);
+		if (ptr)
+			return ptr;
+	}
+
 	assert_nrt();
 	return __real_malloc(size);
 }
 
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+	void *ptr;
+
+	if (xeno_malloc_wrapped()) {
+		ptr = xeno_calloc(nmemb, size);
+		if (ptr)
+			return ptr;
+	}
+
+	assert_nrt();
+	return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	/* Blocks stay with the allocator they came from. */
+	if (xeno_malloc_owns(ptr))
+		return xeno_realloc(ptr, size);
+
+	if (ptr == NULL && xeno_malloc_wrapped()) {
+		ptr = xeno_malloc(size);
+		if (ptr)
+			return ptr;
+	}
+
+	assert_nrt();
+	return __real_realloc(ptr, size);
+}
+
+int __wrap_posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+	void *ptr;
+
+	if (xeno_malloc_wrapped() && alignment % sizeof(void *) == 0) {
+		ptr = xeno_memalign(alignment, size);
+		if (ptr) {
+			*memptr = ptr;
+			return 0;
+		}
+	}
+
+	assert_nrt();
+	return __real_posix_memalign(memptr, alignment, size);
+}
+
+void *__wrap_memalign(size_t alignment, size_t size)
+{
+	void *ptr;
+
+	if (xeno_malloc_wrapped()) {
+		ptr = xeno_memalign(alignment, size);
+		if (ptr)
+			return ptr;
+	}
+
+	assert_nrt();
+	return __real_memalign(alignment, size);
+}
+
+void *__wrap_valloc(size_t size)
+{
+	void *ptr;
+
+	if (xeno_malloc_wrapped()) {
+		ptr = xeno_memalign(sysconf(_SC_PAGESIZE), size);
+		if (ptr)
+			return ptr;
+	}
+
+	assert_nrt();
+	return __real_valloc(size);
+}
+
 void __wrap_free(void *ptr)
 {
+	if (xeno_malloc_owns(ptr)) {
+		xeno_free(ptr);
+		return;
+	}
+
 	assert_nrt();
 	__real_free(ptr);
 }
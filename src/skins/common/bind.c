@@ -5,6 +5,7 @@
 #include <string.h>
 #include <errno.h>
 #include <sys/mman.h>
+#include <sys/time.h>
 
 #include <nucleus/heap.h>
 #include <asm/xenomai/syscall.h>
@@ -16,6 +17,48 @@
 
 static pthread_t xeno_main_tid;
 
+/*
+ * Startup tuning, from the environment:
+ *
+ * XENO_STARTUP_PROFILE: report the time spent in each phase of the
+ * binding, and in faulting in the main thread stack, on stderr.
+ *
+ * XENO_LAZY_HEAPS: only reserve the address space of the growing
+ * semaphore heaps when binding, each extent being mapped upon first
+ * access. That first access switches the caller to secondary mode.
+ *
+ * XENO_MLOCK=future: only lock the memory mapped from now on,
+ * instead of faulting in the whole process. Real-time code and data
+ * mapped before binding, shared libraries included, must then be
+ * locked by the application, e.g. with mlock().
+ */
+static int xeno_profile_startup;
+
+static int xeno_mlock_future;
+
+static unsigned long long xeno_startup_clock(void)
+{
+	struct timeval tv;
+
+	if (!xeno_profile_startup)
+		return 0;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+static void xeno_init_startup_opts(void)
+{
+	const char *mlock_mode;
+
+	xeno_profile_startup = getenv("XENO_STARTUP_PROFILE") != NULL;
+	xeno_sem_heap_lazy = getenv("XENO_LAZY_HEAPS") != NULL;
+
+	mlock_mode = getenv("XENO_MLOCK");
+	xeno_mlock_future = mlock_mode && strcmp(mlock_mode, "future") == 0;
+}
+
 static void xeno_sigill_handler(int sig)
 {
 	fprintf(stderr, "Xenomai or CONFIG_XENO_OPT_PERVASIVE disabled.\n"
@@ -42,10 +85,14 @@ static void xeno_init_arch_features(void)
 int 
 xeno_bind_skin_opt(unsigned skin_magic, const char *skin, const char *module)
 {
+	unsigned long long t_bind, t_mlock, t_heaps, t_misc, t_end;
 	sighandler_t old_sigill_handler;
 	xnfeatinfo_t finfo;
 	int muxid;
 
+	xeno_init_startup_opts();
+	t_bind = xeno_startup_clock();
+
 	/* Some sanity checks first. */
 	if (access(XNHEAP_DEV_NAME, 0)) {
 		fprintf(stderr, "Xenomai: %s is missing\n(chardev, major=10 minor=%d)\n",
@@ -92,22 +139,36 @@ xeno_bind_skin_opt(unsigned skin_magic, const char *skin, const char *module)
 		exit(EXIT_FAILURE);
 	}
 
-	if (mlockall(MCL_CURRENT | MCL_FUTURE)) {
+	t_mlock = xeno_startup_clock();
+
+	if (mlockall(xeno_mlock_future ? MCL_FUTURE : MCL_CURRENT | MCL_FUTURE)) {
 		perror("Xenomai: mlockall");
 		exit(EXIT_FAILURE);
 	}
 
+	t_heaps = xeno_startup_clock();
+
 	xeno_featinfo = finfo;
 	xeno_init_arch_features();
 
 	xeno_init_sem_heaps();
 
+	t_misc = xeno_startup_clock();
+
 	xeno_init_current_keys();
 
 	xeno_main_tid = pthread_self();
 
 	xeno_init_timeconv(muxid);
 
+	if (xeno_profile_startup) {
+		t_end = xeno_startup_clock();
+		fprintf(stderr, "Xenomai: %s startup: bind %llu us, "
+			"mlock %llu us, heaps %llu us, misc %llu us\n",
+			skin, t_mlock - t_bind, t_heaps - t_mlock,
+			t_misc - t_heaps, t_end - t_misc);
+	}
+
 	return muxid;
 }
 
@@ -115,7 +176,16 @@ void xeno_fault_stack(void)
 {
 	if (pthread_self() == xeno_main_tid) {
 		char stk[xeno_stacksize(1)];
+		unsigned long long t_fault = xeno_startup_clock();
 
 		stk[0] = stk[sizeof(stk) - 1] = 0xA5;
+
+		/* The stack was mapped before binding */
+		if (xeno_mlock_future)
+			mlock(stk, sizeof(stk));
+
+		if (xeno_profile_startup)
+			fprintf(stderr, "Xenomai: main stack faulted in "
+				"%llu us\n", xeno_startup_clock() - t_fault);
 	}
 }
@@ -27,7 +27,7 @@ void xeno_init_current_keys(void)
 
 void xeno_set_current_mode(unsigned long offset)
 {
-	xeno_current_mode = (unsigned long *)(xeno_sem_heap[0] + offset);
+	xeno_current_mode = (unsigned long *)xeno_sem_heap_addr(0, offset);
 }
 #else /* !HAVE___THREAD */
 
@@ -42,8 +42,11 @@ static inline void __xeno_set_current(xnhandle_t current)
 
 static void xeno_current_fork_handler(void)
 {
-	if (xeno_get_current() != XN_NO_HANDLE)
+	if (xeno_get_current() != XN_NO_HANDLE) {
 		__xeno_set_current(XN_NO_HANDLE);
+		/* The window would hand out the parent's handle. */
+		pthread_setspecific(xeno_current_mode_key, NULL);
+	}
 }
 
 static void init_current_keys(void)
@@ -72,7 +75,7 @@ void xeno_init_current_keys(void)
 void xeno_set_current_mode(unsigned long offset)
 {
 	pthread_setspecific(xeno_current_mode_key,
-			    (void *)(xeno_sem_heap[0] + offset));
+			    (void *)xeno_sem_heap_addr(0, offset));
 }
 #endif /* !HAVE___THREAD */
 
@@ -82,8 +85,20 @@ xnhandle_t xeno_slow_get_current(void)
 	int err;
 
 	err = XENOMAI_SYSCALL1(__xn_sys_current, &current);
+	if (err) {
+#ifndef HAVE___THREAD
+		/* Remember it until the thread gets shadowed. */
+		pthread_setspecific(xeno_current_key, XENO_CURRENT_NONE);
+#endif /* !HAVE___THREAD */
+		return XN_NO_HANDLE;
+	}
 
-	return err ? XN_NO_HANDLE : current;
+	return current;
+}
+
+int xeno_slow_sched_unlock(void)
+{
+	return XENOMAI_SYSCALL0(__xn_sys_sched_unlock);
 }
 
 void xeno_set_current(void)
@@ -27,6 +27,14 @@ void __rt_print_exit(void);
 
 void __real_free(void *ptr);
 void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+int __real_posix_memalign(void **memptr, size_t alignment, size_t size);
+void *__real_memalign(size_t alignment, size_t size);
+void *__real_valloc(size_t size);
+
+int xeno_malloc_owns(void *ptr);
+int xeno_malloc_wrapped(void);
 
 int __real_gettimeofday(struct timeval *tv, struct timezone *tz);
 int __real_clock_gettime(clockid_t clk_id, struct timespec *tp);
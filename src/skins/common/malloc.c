@@ -0,0 +1,596 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include <nucleus/heap.h>
+#include <asm/xenomai/syscall.h>
+#include <asm/xenomai/atomic.h>
+#include <asm-generic/current.h>
+#include <rtdk.h>
+#include "sem_heap.h"
+#include "internal.h"
+
+#ifdef CONFIG_XENO_FASTSYNCH
+
+/*
+ * Real-time memory allocator. Memory comes from a heap the nucleus
+ * creates for this process and which is mapped here, so that blocks
+ * are obtained from and given back to the kernel with syscalls which
+ * never switch the caller to secondary mode.
+ *
+ * Each thread allocates from its own arena, which keeps a free list
+ * per size class: allocating and releasing a small block in the
+ * owner thread involves no syscall and no atomic operation. Empty
+ * lists are refilled by carving a chunk obtained from the kernel
+ * into several blocks at once. Blocks released by other threads are
+ * pushed to the owner's remote-free stack, which the owner drains
+ * before asking the kernel for more memory. Blocks larger than the
+ * biggest class are allocated from the kernel heap directly.
+ *
+ * Arenas outlive their thread, since their blocks may still be in
+ * use: they are put on an orphan list when the thread exits, and
+ * adopted by the next thread which needs an arena.
+ */
+
+#define MALLOC_MIN_SHIFT	5	/* 32 bytes */
+#define MALLOC_MAX_SHIFT	12	/* 4 Kb */
+#define MALLOC_NR_CLASSES	(MALLOC_MAX_SHIFT - MALLOC_MIN_SHIFT + 1)
+#define MALLOC_LARGE		(~0UL)
+#define MALLOC_ALIGNED		(~1UL)
+#define MALLOC_CHUNK_SIZE	16384
+#define MALLOC_BATCH		16
+
+struct malloc_arena;
+
+/*
+ * Header of each block. It keeps the natural malloc alignment of
+ * two words, which the kernel heap guarantees for chunks, and class
+ * sizes preserve for the blocks carved out of them.
+ */
+struct malloc_block {
+	union {
+		/* Owner of a class block. */
+		struct malloc_arena *arena;
+		/* Bytes obtained from the kernel for a MALLOC_LARGE block. */
+		size_t size;
+		/* Block a MALLOC_ALIGNED one was carved from. */
+		void *base;
+	} u;
+	unsigned long class;
+};
+
+/* Free blocks are linked through their payload. */
+struct malloc_link {
+	struct malloc_link *next;
+};
+
+struct malloc_arena {
+	/* Orphan list linkage, must come first. */
+	struct malloc_link orphan;
+	struct malloc_link *free[MALLOC_NR_CLASSES];
+	/* Blocks released by other threads, pushed atomically. */
+	xnarch_atomic_t remote;
+};
+
+static unsigned long malloc_base, malloc_size;
+static int malloc_wrap;
+static xnarch_atomic_t malloc_orphans;
+static pthread_once_t malloc_once = PTHREAD_ONCE_INIT;
+static pthread_key_t malloc_key;
+
+#ifdef HAVE___THREAD
+static __thread __attribute__ ((tls_model ("initial-exec")))
+struct malloc_arena *malloc_arena;
+#endif /* HAVE___THREAD */
+
+static inline struct malloc_arena *get_arena(void)
+{
+#ifdef HAVE___THREAD
+	return malloc_arena;
+#else /* !HAVE___THREAD */
+	return pthread_getspecific(malloc_key);
+#endif /* !HAVE___THREAD */
+}
+
+static inline void set_arena(struct malloc_arena *arena)
+{
+#ifdef HAVE___THREAD
+	malloc_arena = arena;
+#endif /* HAVE___THREAD */
+	/* Also arms the destructor at thread exit. */
+	pthread_setspecific(malloc_key, arena);
+}
+
+static void *kernel_alloc(size_t size)
+{
+	unsigned long off;
+	int err;
+
+	err = XENOMAI_SYSCALL2(__xn_sys_heap_alloc, size, &off);
+	if (err)
+		return NULL;
+
+	return (void *)(malloc_base + off);
+}
+
+static void kernel_free(void *ptr)
+{
+	XENOMAI_SYSCALL1(__xn_sys_heap_free,
+			 (unsigned long)ptr - malloc_base);
+}
+
+/* Push a list of blocks to a stack, other threads may push too. */
+static void push_blocks(xnarch_atomic_t *stack,
+			struct malloc_link *first, struct malloc_link *last)
+{
+	unsigned long old;
+
+	do {
+		old = xnarch_atomic_get(stack);
+		last->next = (struct malloc_link *)old;
+	} while (xnarch_atomic_cmpxchg(stack, old,
+				       (unsigned long)first) != old);
+}
+
+/* Take the whole stack at once, which is immune to ABA. */
+static struct malloc_link *pop_all(xnarch_atomic_t *stack)
+{
+	unsigned long old;
+
+	do {
+		old = xnarch_atomic_get(stack);
+		if (old == 0)
+			return NULL;
+	} while (xnarch_atomic_cmpxchg(stack, old, 0) != old);
+
+	return (struct malloc_link *)old;
+}
+
+static void drain_remote(struct malloc_arena *arena)
+{
+	struct malloc_link *link, *next;
+	struct malloc_block *b;
+
+	for (link = pop_all(&arena->remote); link; link = next) {
+		next = link->next;
+		b = (struct malloc_block *)link - 1;
+		link->next = arena->free[b->class];
+		arena->free[b->class] = link;
+	}
+}
+
+static void orphan_arena(void *cookie)
+{
+	struct malloc_arena *arena = cookie;
+
+	drain_remote(arena);
+	push_blocks(&malloc_orphans, &arena->orphan, &arena->orphan);
+}
+
+static struct malloc_arena *adopt_arena(void)
+{
+	struct malloc_link *list, *link, *next;
+	struct malloc_arena *arena;
+
+	/*
+	 * Only popping everything is safe without a lock: keep the
+	 * first orphan, and give the others back.
+	 */
+	list = pop_all(&malloc_orphans);
+	if (list == NULL)
+		return NULL;
+
+	for (link = list->next; link; link = next) {
+		next = link->next;
+		push_blocks(&malloc_orphans, link, link);
+	}
+
+	arena = (struct malloc_arena *)list;
+	arena->orphan.next = NULL;
+	drain_remote(arena);
+
+	return arena;
+}
+
+static struct malloc_arena *create_arena(void)
+{
+	struct malloc_arena *arena;
+
+	arena = adopt_arena();
+	if (arena == NULL) {
+		arena = kernel_alloc(sizeof(*arena));
+		if (arena == NULL)
+			return NULL;
+		memset(arena, 0, sizeof(*arena));
+	}
+
+	set_arena(arena);
+
+	return arena;
+}
+
+static int refill_class(struct malloc_arena *arena, unsigned int class)
+{
+	size_t bsize = 1UL << (class + MALLOC_MIN_SHIFT);
+	struct malloc_link *first = NULL, *link;
+	unsigned int n, count;
+	caddr_t chunk;
+
+	count = MALLOC_CHUNK_SIZE / bsize;
+	if (count > MALLOC_BATCH)
+		count = MALLOC_BATCH;
+
+	chunk = kernel_alloc(bsize * count);
+	if (chunk == NULL) {
+		/* Low on memory, try with a single block. */
+		count = 1;
+		chunk = kernel_alloc(bsize);
+		if (chunk == NULL)
+			return -ENOMEM;
+	}
+
+	for (n = count; n > 0; n--) {
+		link = (struct malloc_link *)
+			((struct malloc_block *)(chunk + (n - 1) * bsize) + 1);
+		link->next = first;
+		first = link;
+	}
+
+	arena->free[class] = first;
+
+	return 0;
+}
+
+static void unmap_on_fork(void)
+{
+	struct malloc_arena *arena = get_arena();
+
+	/*
+	 * The child gets a malloc heap of its own upon request, the
+	 * mapping inherited from the parent must not be written to.
+	 */
+	if (malloc_base) {
+		mmap((void *)malloc_base, malloc_size, PROT_NONE,
+		     MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+		malloc_base = 0;
+	}
+	if (arena)
+		set_arena(NULL);
+	xnarch_atomic_set(&malloc_orphans, 0);
+	malloc_once = PTHREAD_ONCE_INIT;
+}
+
+static void malloc_init(void)
+{
+	static int keyed;
+	struct xnheap_desc hd;
+	void *addr;
+	int err;
+
+	if (!keyed) {
+		if (pthread_key_create(&malloc_key, orphan_arena))
+			return;
+		pthread_atfork(NULL, NULL, unmap_on_fork);
+		keyed = 1;
+	}
+
+	err = XENOMAI_SYSCALL2(__xn_sys_heap_info,
+			       &hd, XNHEAP_PROC_MALLOC_HEAP);
+	if (err)
+		return;
+
+	addr = xeno_map_heap(&hd);
+	if (addr == MAP_FAILED)
+		return;
+
+	xeno_prefault_heap(addr, hd.size);
+	malloc_size = hd.size;
+	malloc_base = (unsigned long)addr;
+}
+
+/**
+ * Map the real-time malloc heap.
+ *
+ * This is done upon the first allocation otherwise, which then
+ * switches the caller to secondary mode. Call this service from a
+ * non real-time context before allocating from primary mode.
+ *
+ * @return 0 on success, -ENOSYS if the nucleus provides no malloc
+ * heap to this process.
+ */
+int xeno_malloc_init(void)
+{
+	pthread_once(&malloc_once, malloc_init);
+
+	return malloc_base ? 0 : -ENOSYS;
+}
+
+void *xeno_malloc(size_t size)
+{
+	struct malloc_arena *arena;
+	struct malloc_block *b;
+	struct malloc_link *link;
+	unsigned int class;
+	size_t bsize;
+
+	if (unlikely(malloc_base == 0) && xeno_malloc_init()) {
+		errno = ENOSYS;
+		return NULL;
+	}
+
+	bsize = size + sizeof(*b);
+	if (bsize < size) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	if (bsize > (1UL << MALLOC_MAX_SHIFT)) {
+		b = kernel_alloc(bsize);
+		if (b == NULL) {
+			errno = ENOMEM;
+			return NULL;
+		}
+		b->u.size = bsize;
+		b->class = MALLOC_LARGE;
+		return b + 1;
+	}
+
+	for (class = 0; (1UL << (class + MALLOC_MIN_SHIFT)) < bsize; class++)
+		;
+
+	arena = get_arena();
+	if (unlikely(arena == NULL)) {
+		arena = create_arena();
+		if (arena == NULL) {
+			errno = ENOMEM;
+			return NULL;
+		}
+	}
+
+	link = arena->free[class];
+	if (link == NULL) {
+		drain_remote(arena);
+		link = arena->free[class];
+		if (link == NULL) {
+			if (refill_class(arena, class)) {
+				errno = ENOMEM;
+				return NULL;
+			}
+			link = arena->free[class];
+		}
+	}
+
+	arena->free[class] = link->next;
+	b = (struct malloc_block *)link - 1;
+	b->u.arena = arena;
+	b->class = class;
+
+	return link;
+}
+
+void *xeno_calloc(size_t nmemb, size_t size)
+{
+	size_t len = nmemb * size;
+	void *ptr;
+
+	if (size && len / size != nmemb) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	ptr = xeno_malloc(len);
+	if (ptr)
+		memset(ptr, 0, len);
+
+	return ptr;
+}
+
+void xeno_free(void *ptr)
+{
+	struct malloc_link *link = ptr;
+	struct malloc_block *b;
+
+	if (ptr == NULL)
+		return;
+
+	b = (struct malloc_block *)ptr - 1;
+	if (b->class == MALLOC_LARGE) {
+		kernel_free(b);
+		return;
+	}
+
+	if (b->class == MALLOC_ALIGNED) {
+		xeno_free(b->u.base);
+		return;
+	}
+
+	if (b->u.arena == get_arena()) {
+		link->next = b->u.arena->free[b->class];
+		b->u.arena->free[b->class] = link;
+		return;
+	}
+
+	push_blocks(&b->u.arena->remote, link, link);
+}
+
+static size_t usable_size(void *ptr)
+{
+	struct malloc_block *b = (struct malloc_block *)ptr - 1;
+
+	if (b->class == MALLOC_LARGE)
+		return b->u.size - sizeof(*b);
+
+	if (b->class == MALLOC_ALIGNED)
+		return usable_size(b->u.base) -
+			((caddr_t)ptr - (caddr_t)b->u.base);
+
+	return (1UL << (b->class + MALLOC_MIN_SHIFT)) - sizeof(*b);
+}
+
+void *xeno_realloc(void *ptr, size_t size)
+{
+	size_t len;
+	void *new;
+
+	if (ptr == NULL)
+		return xeno_malloc(size);
+
+	if (size == 0) {
+		xeno_free(ptr);
+		return NULL;
+	}
+
+	len = usable_size(ptr);
+	if (size <= len)
+		return ptr;
+
+	new = xeno_malloc(size);
+	if (new == NULL)
+		return NULL;
+
+	memcpy(new, ptr, len);
+	xeno_free(ptr);
+
+	return new;
+}
+
+/*
+ * Blocks are aligned on two words already. Stricter alignments are
+ * obtained by over-allocating, then placing a MALLOC_ALIGNED header
+ * right before the aligned address, which points back to the block
+ * to release.
+ */
+void *xeno_memalign(size_t align, size_t size)
+{
+	struct malloc_block *b;
+	caddr_t base, ptr;
+	size_t len;
+
+	if (align == 0 || (align & (align - 1))) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (align <= sizeof(*b))
+		return xeno_malloc(size);
+
+	len = size + align + sizeof(*b);
+	if (len < size) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	base = xeno_malloc(len);
+	if (base == NULL)
+		return NULL;
+
+	ptr = (caddr_t)(((unsigned long)base + sizeof(*b) + align - 1) &
+			~(align - 1));
+	b = (struct malloc_block *)ptr - 1;
+	b->u.base = base;
+	b->class = MALLOC_ALIGNED;
+
+	return ptr;
+}
+
+int xeno_malloc_owns(void *ptr)
+{
+	return malloc_base &&
+		(unsigned long)ptr - malloc_base < malloc_size;
+}
+
+/**
+ * Route the malloc() family to the real-time allocator.
+ *
+ * Once enabled, malloc(), calloc(), realloc(), posix_memalign(),
+ * memalign() and valloc() calls from Xenomai threads are served by
+ * the real-time allocator, while free() and realloc() handle blocks
+ * from either allocator. This only applies to applications linked with the
+ * wrappers of the POSIX skin.
+ *
+ * @param enable non-zero to route, zero to stop routing new
+ * allocations; blocks already obtained are released properly in
+ * both cases.
+ */
+void xeno_malloc_wrap(int enable)
+{
+	if (enable)
+		xeno_malloc_init();
+
+	malloc_wrap = enable;
+}
+
+int xeno_malloc_wrapped(void)
+{
+	return malloc_wrap && malloc_base &&
+		xeno_get_current() != XN_NO_HANDLE;
+}
+
+#else /* !CONFIG_XENO_FASTSYNCH */
+
+int xeno_malloc_init(void)
+{
+	return -ENOSYS;
+}
+
+void *xeno_malloc(size_t size)
+{
+	errno = ENOSYS;
+	return NULL;
+}
+
+void *xeno_calloc(size_t nmemb, size_t size)
+{
+	errno = ENOSYS;
+	return NULL;
+}
+
+void xeno_free(void *ptr)
+{
+}
+
+void *xeno_realloc(void *ptr, size_t size)
+{
+	errno = ENOSYS;
+	return NULL;
+}
+
+void *xeno_memalign(size_t align, size_t size)
+{
+	errno = ENOSYS;
+	return NULL;
+}
+
+int xeno_malloc_owns(void *ptr)
+{
+	return 0;
+}
+
+void xeno_malloc_wrap(int enable)
+{
+}
+
+int xeno_malloc_wrapped(void)
+{
+	return 0;
+}
+
+#endif /* !CONFIG_XENO_FASTSYNCH */
@@ -21,12 +21,20 @@
 #include <limits.h>
 #include <pthread.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <syslog.h>
 #include <signal.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 
 #include <rtdk.h>
 #include <nucleus/types.h>	/* For BITS_PER_LONG */
@@ -43,6 +51,19 @@
 #define RT_PRINT_BUFFERS_COUNT_ENV      "RT_PRINT_BUFFERS_COUNT"
 #define RT_PRINT_DEFAULT_BUFFERS_COUNT  4
 
+#define RT_PRINT_DEFERRED_ENV		"RT_PRINT_DEFERRED"
+
+/* The printer polls at most 2^RT_PRINT_MAX_SPEEDUP times faster */
+#define RT_PRINT_MAX_SPEEDUP		4
+#define RT_PRINT_HIGH_FILL		50 /* % */
+#define RT_PRINT_LOW_FILL		10 /* % */
+
+#define RT_PRINT_SYNC_PERIOD		1000 /* ms */
+#define RT_PRINT_DEFAULT_WINDOW		(1024*1024)
+
+#define RT_PRINT_CACHE_LINE		64
+#define RT_PRINT_MAX_SPEC		32
+
 #define RT_PRINT_LINE_BREAK		256
 
 #define RT_PRINT_SYSLOG_STREAM		NULL
@@ -52,14 +73,21 @@
 
 struct entry_head {
 	FILE *dest;
+	/* Non-NULL for deferred entries, data then holds the arguments */
+	const char *format;
 	uint32_t seq_no;
 	int priority;
 	size_t len;
 	char data[0];
 } __attribute__((packed));
 
+/*
+ * Each buffer is a single-producer/single-consumer ring: write_pos
+ * is only updated by the owner thread, read_pos only by the printer
+ * thread, so no lock is needed on the output path.
+ */
 struct print_buffer {
-	off_t write_pos;
+	off_t write_pos __attribute__((aligned(RT_PRINT_CACHE_LINE)));
 
 	struct print_buffer *next, *prev;
 
@@ -68,11 +96,36 @@ struct print_buffer {
 
 	char name[32];
 
+	/* Output sink, resolved by the printer from the routes */
+	struct rt_print_sink *sink;
+	unsigned sink_gen;
+
+	/* Lost entries, counted by the owner, reported by the printer */
+	unsigned long dropped;
+	unsigned long reported;
+
 	/*
-	 * Keep read_pos separated from write_pos to optimise write
-	 * caching on SMP.
+	 * Keep read_pos on a different cache line than write_pos, so
+	 * that the producer and the consumer do not keep stealing
+	 * each other's line on SMP.
 	 */
-	off_t read_pos;
+	off_t read_pos __attribute__((aligned(RT_PRINT_CACHE_LINE)));
+} __attribute__((aligned(RT_PRINT_CACHE_LINE)));
+
+/* Argument classes for deferred formatting, as fetched by va_arg() */
+enum {
+	ARG_NONE,
+	ARG_INT,
+	ARG_LONG,
+	ARG_LLONG,
+	ARG_INTMAX,
+	ARG_SIZE,
+	ARG_PTRDIFF,
+	ARG_DOUBLE,
+	ARG_LDOUBLE,
+	ARG_PTR,
+	ARG_STRING,
+	ARG_UNSUPP,
 };
 
 static struct print_buffer *first_buffer;
@@ -81,6 +134,7 @@ static uint32_t seq_no;
 static size_t default_buffer_size;
 static struct timespec print_period;
 static int auto_init;
+static int deferred_format;
 static pthread_mutex_t buffer_lock;
 static pthread_cond_t printer_wakeup;
 static pthread_key_t buffer_key;
@@ -94,10 +148,356 @@ static unsigned long pool_start, pool_len;
 
 static pthread_once_t init_once = PTHREAD_ONCE_INIT;
 
+/*
+ * Raised by producers when their buffer fills up, so that the
+ * printer cuts its sleep short. Producers may run in primary mode,
+ * so this is a plain flag polled by the printer, not a condvar.
+ */
+static volatile int print_pressure;
+
+struct rt_print_sink {
+	const struct rt_print_sink_ops *ops;
+	void *cookie;
+	struct rt_print_sink *next;
+};
+
+struct print_route {
+	struct print_route *next;
+	struct rt_print_sink *sink;
+	char pattern[0];
+};
+
+static struct rt_print_sink *first_sink;
+static struct print_route *first_route;
+static unsigned routes_gen = 1;
+
 static void cleanup_buffer(struct print_buffer *buffer);
 static void print_buffers(void);
 static void spawn_printer_thread(void);
 
+/* *** Deferred formatting *** */
+
+/* Precision passed as an argument ('.*'). */
+#define PREC_ARG	-2
+
+/*
+ * Parse the conversion specification following a '%' sign. Return
+ * the class of the argument it converts, the number of '*' fields it
+ * contains, its precision (-1 if none, PREC_ARG if given by the last
+ * '*' field), and a pointer past its end.
+ */
+static int parse_spec(const char *fmt, int *stars, int *prec,
+		      const char **endp)
+{
+	const char *p = fmt;
+	int lmod = 0;
+
+	*stars = 0;
+	*prec = -1;
+
+	while (*p && strchr("#0- +'", *p))
+		p++;
+
+	if (*p == '*') {
+		(*stars)++;
+		p++;
+	} else
+		while (*p >= '0' && *p <= '9')
+			p++;
+
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			(*stars)++;
+			*prec = PREC_ARG;
+			p++;
+		} else {
+			*prec = 0;
+			while (*p >= '0' && *p <= '9') {
+				if (*prec < INT_MAX / 10)
+					*prec = *prec * 10 + *p - '0';
+				p++;
+			}
+		}
+	}
+
+	switch (*p) {
+	case 'h':
+		if (*++p == 'h')
+			p++;
+		break;
+	case 'l':
+		if (*++p == 'l') {
+			p++;
+			lmod = 'q';
+		} else
+			lmod = 'l';
+		break;
+	case 'q':
+	case 'L':
+		p++;
+		lmod = 'q';
+		break;
+	case 'j':
+	case 'z':
+	case 't':
+		lmod = *p++;
+		break;
+	}
+
+	/*
+	 * The whole spec, i.e. the '%' sign, the conversion character
+	 * and a trailing NUL, must fit in RT_PRINT_MAX_SPEC bytes.
+	 */
+	if (*p == '\0' || p - fmt > RT_PRINT_MAX_SPEC - 3)
+		return ARG_UNSUPP;
+
+	*endp = p + 1;
+
+	switch (*p) {
+	case 'd':
+	case 'i':
+	case 'o':
+	case 'u':
+	case 'x':
+	case 'X':
+		switch (lmod) {
+		case 'l':
+			return ARG_LONG;
+		case 'q':
+			return ARG_LLONG;
+		case 'j':
+			return ARG_INTMAX;
+		case 'z':
+			return ARG_SIZE;
+		case 't':
+			return ARG_PTRDIFF;
+		}
+		return ARG_INT;
+	case 'c':
+		return lmod == 'l' ? ARG_UNSUPP : ARG_INT;
+	case 'e':
+	case 'E':
+	case 'f':
+	case 'F':
+	case 'g':
+	case 'G':
+	case 'a':
+	case 'A':
+		return lmod == 'q' ? ARG_LDOUBLE : ARG_DOUBLE;
+	case 'p':
+		return ARG_PTR;
+	case 's':
+		return lmod == 'l' ? ARG_UNSUPP : ARG_STRING;
+	case '%':
+		return p == fmt ? ARG_NONE : ARG_UNSUPP;
+	default:
+		/* %n, %m, wide chars, positional arguments... */
+		return ARG_UNSUPP;
+	}
+}
+
+#define store_arg(type)							\
+	do {								\
+		type __v = va_arg(args, type);				\
+		if (pos + sizeof(__v) > len)				\
+			goto out;					\
+		memcpy(data + pos, &__v, sizeof(__v));			\
+		pos += sizeof(__v);					\
+	} while (0)
+
+/*
+ * Copy the raw arguments of a format string to a ring entry. Return
+ * the amount of data stored, which is less than needed if the entry
+ * is too small, or -1 if the format cannot be deferred, in which case
+ * args is left in an undefined state.
+ */
+static int store_args(char *data, int len, const char *format, va_list args)
+{
+	const char *p = format, *s;
+	int pos = 0, stars, prec, type, n, w = -1;
+
+	while ((p = strchr(p, '%')) != NULL) {
+		type = parse_spec(p + 1, &stars, &prec, &p);
+		if (type == ARG_UNSUPP)
+			return -1;
+
+		while (stars-- > 0) {
+			w = va_arg(args, int);
+			if (pos + sizeof(w) > len)
+				goto out;
+			memcpy(data + pos, &w, sizeof(w));
+			pos += sizeof(w);
+		}
+		if (prec == PREC_ARG)
+			prec = w;	/* Negative means none. */
+
+		switch (type) {
+		case ARG_INT:
+			store_arg(int);
+			break;
+		case ARG_LONG:
+			store_arg(long);
+			break;
+		case ARG_LLONG:
+			store_arg(long long);
+			break;
+		case ARG_INTMAX:
+			store_arg(intmax_t);
+			break;
+		case ARG_SIZE:
+			store_arg(size_t);
+			break;
+		case ARG_PTRDIFF:
+			store_arg(ptrdiff_t);
+			break;
+		case ARG_DOUBLE:
+			store_arg(double);
+			break;
+		case ARG_LDOUBLE:
+			store_arg(long double);
+			break;
+		case ARG_PTR:
+			store_arg(void *);
+			break;
+		case ARG_STRING:
+			/* The string may not outlive the call, copy it. */
+			s = va_arg(args, const char *);
+			if (s == NULL)
+				s = "(null)";
+			if (pos >= len)
+				goto out;
+			/* Never read past the precision. */
+			n = len - pos - 1;
+			if (prec >= 0 && prec < n)
+				n = prec;
+			n = strnlen(s, n);
+			memcpy(data + pos, s, n);
+			data[pos + n] = '\0';
+			pos += n + 1;
+			break;
+		}
+	}
+  out:
+	return pos;
+}
+
+#define print_arg(type)							\
+	do {								\
+		type __v;						\
+		if (pos + sizeof(__v) > len)				\
+			return;						\
+		memcpy(&__v, data + pos, sizeof(__v));			\
+		pos += sizeof(__v);					\
+		if (stars == 0)						\
+			fprintf(out, spec, __v);			\
+		else if (stars == 1)					\
+			fprintf(out, spec, w[0], __v);			\
+		else							\
+			fprintf(out, spec, w[0], w[1], __v);		\
+	} while (0)
+
+/*
+ * Format a deferred entry to out, on behalf of the printer thread.
+ * Output stops at the first conversion which has no argument
+ * stored, as the entry was truncated in that case.
+ */
+static void format_deferred(FILE *out, const struct entry_head *head)
+{
+	const char *p = head->format, *q, *data = head->data;
+	char spec[RT_PRINT_MAX_SPEC];
+	int pos = 0, len = head->len;
+	int stars, prec, type, w[2], n;
+
+	while ((q = strchr(p, '%')) != NULL) {
+		fwrite(p, q - p, 1, out);
+
+		type = parse_spec(q + 1, &stars, &prec, &p);
+		if (type == ARG_NONE) {
+			fputc('%', out);
+			continue;
+		}
+
+		/* Longer specs are never deferred, see parse_spec(). */
+		if (p - q > RT_PRINT_MAX_SPEC - 1)
+			return;
+		memcpy(spec, q, p - q);
+		spec[p - q] = '\0';
+
+		for (n = 0; n < stars; n++) {
+			if (pos + sizeof(w[n]) > len)
+				return;
+			memcpy(&w[n], data + pos, sizeof(w[n]));
+			pos += sizeof(w[n]);
+		}
+
+		switch (type) {
+		case ARG_INT:
+			print_arg(int);
+			break;
+		case ARG_LONG:
+			print_arg(long);
+			break;
+		case ARG_LLONG:
+			print_arg(long long);
+			break;
+		case ARG_INTMAX:
+			print_arg(intmax_t);
+			break;
+		case ARG_SIZE:
+			print_arg(size_t);
+			break;
+		case ARG_PTRDIFF:
+			print_arg(ptrdiff_t);
+			break;
+		case ARG_DOUBLE:
+			print_arg(double);
+			break;
+		case ARG_LDOUBLE:
+			print_arg(long double);
+			break;
+		case ARG_PTR:
+			print_arg(void *);
+			break;
+		case ARG_STRING:
+			if (pos >= len)
+				return;
+			n = strnlen(data + pos, len - pos);
+			if (stars == 0)
+				fprintf(out, spec, data + pos);
+			else if (stars == 1)
+				fprintf(out, spec, w[0], data + pos);
+			else
+				fprintf(out, spec, w[0], w[1], data + pos);
+			pos += n + 1;
+			break;
+		}
+	}
+
+	fputs(p, out);
+}
+
+static void print_deferred(const struct entry_head *head)
+{
+	size_t size;
+	char *line;
+	FILE *out;
+
+	if (head->dest != RT_PRINT_SYSLOG_STREAM) {
+		format_deferred(head->dest, head);
+		return;
+	}
+
+	out = open_memstream(&line, &size);
+	if (out == NULL)
+		return;
+
+	format_deferred(out, head);
+	fclose(out);
+	syslog(head->priority, "%s", line);
+	free(line);
+}
+
 /* *** rt_print API *** */
 
 static int 
@@ -105,9 +505,13 @@ vprint_to_buffer(FILE *stream, int fortify_level, int priority,
 		 unsigned int mode, size_t sz, const char *format, va_list args)
 {
 	struct print_buffer *buffer = pthread_getspecific(buffer_key);
+	const char *deferred = NULL;
 	off_t write_pos, read_pos;
 	struct entry_head *head;
+	va_list saved_args;
 	int len, str_len;
+	size_t used;
+	int lost = 0;
 	int res = 0;
 
 	if (!buffer) {
@@ -161,7 +565,18 @@ vprint_to_buffer(FILE *stream, int fortify_level, int priority,
 
 	head = buffer->ring + write_pos;
 
-	if (mode == RT_PRINT_MODE_FORMAT) {
+	if (mode == RT_PRINT_MODE_FORMAT && deferred_format) {
+		va_copy(saved_args, args);
+		res = store_args(head->data, len, format, saved_args);
+		va_end(saved_args);
+		if (res > 0)
+			deferred = format;
+	}
+
+	if (deferred) {
+		/* Leave the formatting work to the printer thread */
+		len = res;
+	} else if (mode == RT_PRINT_MODE_FORMAT) {
 		if (stream != RT_PRINT_SYSLOG_STREAM) {
 			/* We do not need the terminating \0 */
 #ifdef CONFIG_XENO_FORTIFY
@@ -182,6 +597,7 @@ vprint_to_buffer(FILE *stream, int fortify_level, int priority,
 				len = res;
 			} else {
 				/* Text was truncated */
+				lost = res > 0;
 				res = len;
 			}
 		} else {
@@ -202,21 +618,31 @@ vprint_to_buffer(FILE *stream, int fortify_level, int priority,
 				len = res + 1;
 			} else {
 				/* Text was truncated */
+				lost = res > 0;
 				res = len;
 			}
 		}
 	} else if (len >= 1) {
 		str_len = sz;
-		len = (str_len < len) ? str_len : len;
+		if (str_len > len)
+			lost = 1;
+		else
+			len = str_len;
 		memcpy(head->data, format, len);
-	} else
+	} else {
 		len = 0;
+		lost = sz > 0;
+	}
+
+	if (lost)
+		buffer->dropped++;
 
 	/* If we were able to write some text, finalise the entry */
 	if (len > 0) {
 		head->seq_no = ++seq_no;
 		head->priority = priority;
 		head->dest = stream;
+		head->format = deferred;
 		head->len = len;
 
 		/* Move forward by text and head length */
@@ -240,6 +666,12 @@ vprint_to_buffer(FILE *stream, int fortify_level, int priority,
 
 	buffer->write_pos = write_pos;
 
+	/* Ask the printer to hurry up if we are running out of space */
+	used = write_pos >= read_pos ? write_pos - read_pos :
+		buffer->size - read_pos + write_pos;
+	if (used * 100 >= buffer->size * RT_PRINT_HIGH_FILL || lost)
+		print_pressure = 1;
+
 	return res;
 }
 
@@ -373,6 +805,10 @@ static void set_buffer_name(struct print_buffer *buffer, const char *name)
 		strncpy(buffer->name+n, name, sizeof(buffer->name)-n-1);
 		buffer->name[sizeof(buffer->name)-1] = 0;
 	}
+
+	/* Have the printer look up the routes again */
+	xnarch_write_memory_barrier();
+	buffer->sink_gen = 0;
 }
 
 static void rt_print_init_inner(struct print_buffer *buffer, size_t size)
@@ -384,6 +820,11 @@ static void rt_print_init_inner(struct print_buffer *buffer, size_t size)
 	buffer->read_pos  = 0;
 	buffer->write_pos = 0;
 
+	buffer->sink = NULL;
+	buffer->sink_gen = 0;
+	buffer->dropped = 0;
+	buffer->reported = 0;
+
 	buffer->prev = NULL;
 
 	pthread_mutex_lock(&buffer_lock);
@@ -456,8 +897,8 @@ int rt_print_init(size_t buffer_size, const char *buffer_name)
 	if (!buffer) {
 		assert_nrt();
 
-		buffer = malloc(sizeof(*buffer));
-		if (!buffer)
+		if (posix_memalign((void **)&buffer, RT_PRINT_CACHE_LINE,
+				   sizeof(*buffer)))
 			return ENOMEM;
 
 		buffer->ring = malloc(size);
@@ -483,6 +924,19 @@ void rt_print_auto_init(int enable)
 		pthread_once(&init_once, spawn_printer_thread);
 }
 
+/*
+ * In deferred mode, rt_printf() and friends only store the raw
+ * arguments, formatting is left to the printer thread. The format
+ * string is referred to by address, so it must remain valid until
+ * the output is flushed, which is always the case for literals.
+ * Formats which cannot be deferred (e.g. %n or %m) are still
+ * processed immediately.
+ */
+void rt_print_deferred_format(int enable)
+{
+	deferred_format = enable;
+}
+
 void rt_print_cleanup(void)
 {
 	struct print_buffer *buffer = pthread_getspecific(buffer_key);
@@ -520,6 +974,365 @@ const char *rt_print_buffer_name(void)
 	return buffer->name;
 }
 
+/* *** Output sinks *** */
+
+rt_print_sink_t *rt_print_sink_create(const struct rt_print_sink_ops *ops,
+				      void *cookie)
+{
+	struct rt_print_sink *sink;
+
+	if (ops == NULL || ops->output == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	sink = malloc(sizeof(*sink));
+	if (sink == NULL) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	sink->ops = ops;
+	sink->cookie = cookie;
+
+	pthread_mutex_lock(&buffer_lock);
+	sink->next = first_sink;
+	first_sink = sink;
+	pthread_mutex_unlock(&buffer_lock);
+
+	return sink;
+}
+
+void rt_print_sink_destroy(rt_print_sink_t *sink)
+{
+	struct print_route **proute, *route;
+	struct rt_print_sink **psink;
+
+	assert_nrt();
+
+	pthread_mutex_lock(&buffer_lock);
+
+	/* Whatever is pending may still go to that sink */
+	print_buffers();
+
+	for (proute = &first_route; (route = *proute) != NULL; )
+		if (route->sink == sink) {
+			*proute = route->next;
+			free(route);
+		} else
+			proute = &route->next;
+
+	for (psink = &first_sink; *psink; psink = &(*psink)->next)
+		if (*psink == sink) {
+			*psink = sink->next;
+			break;
+		}
+
+	routes_gen++;
+
+	pthread_mutex_unlock(&buffer_lock);
+
+	if (sink->ops->close)
+		sink->ops->close(sink->cookie);
+
+	free(sink);
+}
+
+int rt_print_route(const char *pattern, rt_print_sink_t *sink)
+{
+	struct print_route **proute, *route;
+
+	assert_nrt();
+
+	if (pattern == NULL)
+		return EINVAL;
+
+	pthread_mutex_lock(&buffer_lock);
+
+	/* Drop any former route for this pattern */
+	for (proute = &first_route; (route = *proute) != NULL;
+	     proute = &route->next)
+		if (strcmp(route->pattern, pattern) == 0) {
+			*proute = route->next;
+			free(route);
+			break;
+		}
+
+	if (sink) {
+		route = malloc(sizeof(*route) + strlen(pattern) + 1);
+		if (route == NULL) {
+			pthread_mutex_unlock(&buffer_lock);
+			return ENOMEM;
+		}
+		route->sink = sink;
+		strcpy(route->pattern, pattern);
+
+		/* First match wins, keep routes in creation order */
+		for (proute = &first_route; *proute; proute = &(*proute)->next)
+			;
+		route->next = NULL;
+		*proute = route;
+	}
+
+	routes_gen++;
+
+	pthread_mutex_unlock(&buffer_lock);
+
+	return 0;
+}
+
+/* Must be called with buffer_lock held */
+static struct rt_print_sink *buffer_sink(struct print_buffer *buffer)
+{
+	struct print_route *route;
+	const char *name;
+
+	if (buffer->sink_gen == routes_gen)
+		return buffer->sink;
+
+	/* Routes match the user part of the name, past the thread id */
+	name = strchr(buffer->name, ' ');
+	name = name ? name + 1 : "";
+
+	for (route = first_route; route; route = route->next)
+		if (fnmatch(route->pattern, name, 0) == 0)
+			break;
+
+	buffer->sink = route ? route->sink : NULL;
+	buffer->sink_gen = routes_gen;
+
+	return buffer->sink;
+}
+
+static void sync_sinks(void)
+{
+	struct rt_print_sink *sink;
+
+	for (sink = first_sink; sink; sink = sink->next)
+		if (sink->ops->sync)
+			sink->ops->sync(sink->cookie);
+}
+
+static int stream_code(FILE *stream)
+{
+	if (stream == RT_PRINT_SYSLOG_STREAM)
+		return RT_PRINT_STREAM_SYSLOG;
+	if (stream == stdout)
+		return RT_PRINT_STREAM_STDOUT;
+	if (stream == stderr)
+		return RT_PRINT_STREAM_STDERR;
+
+	return RT_PRINT_STREAM_OTHER;
+}
+
+/*
+ * Binary log file sink. Records are appended to a shared mapping of
+ * the file, which is extended by windows of a fixed size; the
+ * mapping is synced periodically by the printer. The unused end of
+ * the last window reads as zero, which tells readers where the log
+ * stops.
+ */
+struct file_sink {
+	int fd;
+	char *map;
+	off_t map_off;
+	size_t map_len;
+	off_t end;
+	size_t window;
+};
+
+static int file_sink_map(struct file_sink *fs, size_t need)
+{
+	off_t pagemask = ~((off_t)sysconf(_SC_PAGESIZE) - 1);
+
+	if (fs->map && fs->end + need <= fs->map_off + fs->map_len)
+		return 0;
+
+	if (fs->map) {
+		msync(fs->map, fs->map_len, MS_ASYNC);
+		munmap(fs->map, fs->map_len);
+		fs->map = NULL;
+	}
+
+	fs->map_off = fs->end & pagemask;
+	fs->map_len = fs->window;
+	while (fs->end + need > fs->map_off + fs->map_len)
+		fs->map_len += fs->window;
+
+	if (ftruncate(fs->fd, fs->map_off + fs->map_len))
+		return -1;
+
+	fs->map = mmap(NULL, fs->map_len, PROT_READ | PROT_WRITE,
+		       MAP_SHARED, fs->fd, fs->map_off);
+	if (fs->map == MAP_FAILED) {
+		fs->map = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+static void file_sink_output(void *cookie, const char *buffer_name,
+			     FILE *stream, int priority, uint32_t seq_no,
+			     const char *data, size_t len)
+{
+	struct file_sink *fs = cookie;
+	struct rt_print_record *rec;
+	size_t size;
+
+	size = (sizeof(*rec) + len + 7) & ~7;
+	if (file_sink_map(fs, size))
+		return;
+
+	rec = (struct rt_print_record *)(fs->map + (fs->end - fs->map_off));
+	rec->seq_no = seq_no;
+	rec->len = len;
+	rec->stream = stream_code(stream);
+	rec->priority = priority;
+	memcpy(rec + 1, data, len);
+	/* Readers may be watching the file, publish the magic last */
+	xnarch_write_memory_barrier();
+	rec->magic = RT_PRINT_RECORD_MAGIC;
+
+	fs->end += size;
+}
+
+static void file_sink_sync(void *cookie)
+{
+	struct file_sink *fs = cookie;
+
+	if (fs->map)
+		msync(fs->map, fs->map_len, MS_ASYNC);
+}
+
+static void file_sink_close(void *cookie)
+{
+	struct file_sink *fs = cookie;
+
+	if (fs->map) {
+		msync(fs->map, fs->map_len, MS_SYNC);
+		munmap(fs->map, fs->map_len);
+	}
+
+	/* Trim the unused part of the last window */
+	if (ftruncate(fs->fd, fs->end) == 0)
+		fsync(fs->fd);
+	close(fs->fd);
+	free(fs);
+}
+
+static const struct rt_print_sink_ops file_sink_ops = {
+	.output = file_sink_output,
+	.sync = file_sink_sync,
+	.close = file_sink_close,
+};
+
+rt_print_sink_t *rt_print_sink_file(const char *path, size_t window)
+{
+	rt_print_sink_t *sink;
+	struct file_sink *fs;
+	long pagesize;
+	struct stat st;
+	int err;
+
+	pagesize = sysconf(_SC_PAGESIZE);
+	if (!window)
+		window = RT_PRINT_DEFAULT_WINDOW;
+	window = (window + pagesize - 1) & ~(pagesize - 1);
+
+	fs = malloc(sizeof(*fs));
+	if (fs == NULL) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	fs->fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (fs->fd < 0)
+		goto fail;
+
+	if (fstat(fs->fd, &st))
+		goto fail_close;
+
+	/* Append to what is there already */
+	fs->end = (st.st_size + 7) & ~7;
+	fs->map = NULL;
+	fs->map_off = 0;
+	fs->map_len = 0;
+	fs->window = window;
+
+	sink = rt_print_sink_create(&file_sink_ops, fs);
+	if (sink)
+		return sink;
+
+  fail_close:
+	err = errno;
+	close(fs->fd);
+	errno = err;
+  fail:
+	err = errno;
+	free(fs);
+	errno = err;
+	return NULL;
+}
+
+/*
+ * Unix socket sink: each entry is forwarded as a single datagram.
+ * The printer must not block on a slow reader, so datagrams which
+ * cannot be sent right away are discarded.
+ */
+static void socket_sink_output(void *cookie, const char *buffer_name,
+			       FILE *stream, int priority, uint32_t seq_no,
+			       const char *data, size_t len)
+{
+	int ret;
+
+	ret = send((long)cookie, data, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+	(void)ret;
+}
+
+static void socket_sink_close(void *cookie)
+{
+	close((long)cookie);
+}
+
+static const struct rt_print_sink_ops socket_sink_ops = {
+	.output = socket_sink_output,
+	.close = socket_sink_close,
+};
+
+rt_print_sink_t *rt_print_sink_socket(const char *path)
+{
+	struct sockaddr_un addr;
+	rt_print_sink_t *sink;
+	int fd, err;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		errno = ENAMETOOLONG;
+		return NULL;
+	}
+
+	fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (fd < 0)
+		return NULL;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)))
+		goto fail;
+
+	sink = rt_print_sink_create(&socket_sink_ops, (void *)(long)fd);
+	if (sink)
+		return sink;
+
+  fail:
+	err = errno;
+	close(fd);
+	errno = err;
+	return NULL;
+}
+
 /* *** Deferred Output Management *** */
 void rt_print_flush_buffers(void)
 {
@@ -620,12 +1433,77 @@ static struct print_buffer *get_next_buffer(void)
 	return buffer;
 }
 
+static void print_entry(struct print_buffer *buffer,
+			const struct entry_head *head)
+{
+	struct rt_print_sink *sink = buffer_sink(buffer);
+	size_t size;
+	char *line;
+	FILE *out;
+	int ret;
+
+	if (sink == NULL) {
+		/* Deferred entries still need formatting, check if
+		   output goes to syslog otherwise */
+		if (head->format)
+			print_deferred(head);
+		else if (head->dest == RT_PRINT_SYSLOG_STREAM) {
+			syslog(head->priority,
+			       "%s", head->data);
+		} else {
+			ret = fwrite(head->data,
+				     head->len, 1, head->dest);
+			(void)ret;
+		}
+		return;
+	}
+
+	if (head->format) {
+		out = open_memstream(&line, &size);
+		if (out == NULL)
+			return;
+		format_deferred(out, head);
+		fclose(out);
+		sink->ops->output(sink->cookie, buffer->name, head->dest,
+				  head->priority, head->seq_no, line, size);
+		free(line);
+	} else
+		/* Syslog entries carry their terminating \0 */
+		sink->ops->output(sink->cookie, buffer->name, head->dest,
+				  head->priority, head->seq_no, head->data,
+				  head->dest == RT_PRINT_SYSLOG_STREAM ?
+				  strlen(head->data) : head->len);
+}
+
+static void report_drops(struct print_buffer *buffer)
+{
+	unsigned long dropped = buffer->dropped;
+	struct rt_print_sink *sink;
+	char msg[96];
+	int len;
+
+	if (dropped == buffer->reported)
+		return;
+
+	len = snprintf(msg, sizeof(msg),
+		       "rt_print: %lu message(s) lost in buffer %s\n",
+		       dropped - buffer->reported, buffer->name);
+	buffer->reported = dropped;
+
+	sink = buffer_sink(buffer);
+	if (sink)
+		sink->ops->output(sink->cookie, buffer->name, stderr,
+				  LOG_WARNING, seq_no, msg, len);
+	else
+		fputs(msg, stderr);
+}
+
 static void print_buffers(void)
 {
 	struct print_buffer *buffer;
 	struct entry_head *head;
 	off_t read_pos;
-	int len, ret;
+	int len;
 
 	while (1) {
 		buffer = get_next_buffer();
@@ -638,15 +1516,7 @@ static void print_buffers(void)
 
 		if (len) {
 			/* Print out non-empty entry and proceed */
-			/* Check if output goes to syslog */
-			if (head->dest == RT_PRINT_SYSLOG_STREAM) {
-				syslog(head->priority,
-				       "%s", head->data);
-			} else {
-				ret = fwrite(head->data,
-					     head->len, 1, head->dest);
-				(void)ret;
-			}
+			print_entry(buffer, head);
 
 			read_pos += sizeof(*head) + len;
 		} else {
@@ -662,6 +1532,30 @@ static void print_buffers(void)
 		/* Enforce the read_pos update before proceeding */
 		xnarch_write_memory_barrier();
 	}
+
+	for (buffer = first_buffer; buffer; buffer = buffer->next)
+		report_drops(buffer);
+}
+
+/* Highest fill level of all buffers, in percent */
+static unsigned buffers_fill(void)
+{
+	struct print_buffer *buffer;
+	off_t write_pos, read_pos;
+	unsigned fill, max = 0;
+	size_t used;
+
+	for (buffer = first_buffer; buffer; buffer = buffer->next) {
+		write_pos = buffer->write_pos;
+		read_pos = buffer->read_pos;
+		used = write_pos >= read_pos ? write_pos - read_pos :
+			buffer->size - read_pos + write_pos;
+		fill = used * 100 / buffer->size;
+		if (fill > max)
+			max = fill;
+	}
+
+	return max;
 }
 
 static void unlock(void *cookie)
@@ -672,11 +1566,27 @@ static void unlock(void *cookie)
 
 static void *printer_loop(void *arg)
 {
+	struct timespec slice, now, last_sync;
+	unsigned fill, speedup = 0, n;
+	unsigned long long ns;
 	sigset_t mask;
 
 	sigfillset(&mask);
 	pthread_sigmask(SIG_BLOCK, &mask, NULL);
 
+	/*
+	 * The printer sleeps for print_period while the buffers stay
+	 * mostly empty, and speeds up as they fill. It sleeps in
+	 * slices, so that producers running short of space may cut
+	 * the sleep short by raising print_pressure.
+	 */
+	ns = (print_period.tv_sec * 1000000000ULL + print_period.tv_nsec)
+		>> RT_PRINT_MAX_SPEEDUP;
+	slice.tv_sec = ns / 1000000000;
+	slice.tv_nsec = ns % 1000000000;
+
+	clock_gettime(CLOCK_MONOTONIC, &last_sync);
+
 	while (1) {
 		pthread_cleanup_push(unlock, &buffer_lock);
 		pthread_mutex_lock(&buffer_lock);
@@ -684,11 +1594,29 @@ static void *printer_loop(void *arg)
 		while (buffers == 0)
 			pthread_cond_wait(&printer_wakeup, &buffer_lock);
 
+		print_pressure = 0;
+		fill = buffers_fill();
 		print_buffers();
 
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if ((now.tv_sec - last_sync.tv_sec) * 1000 +
+		    (now.tv_nsec - last_sync.tv_nsec) / 1000000 >=
+		    RT_PRINT_SYNC_PERIOD) {
+			sync_sinks();
+			last_sync = now;
+		}
+
 		pthread_cleanup_pop(1);
 
-		nanosleep(&print_period, NULL);
+		if (fill >= RT_PRINT_HIGH_FILL) {
+			if (speedup < RT_PRINT_MAX_SPEEDUP)
+				speedup++;
+		} else if (fill < RT_PRINT_LOW_FILL && speedup > 0)
+			speedup--;
+
+		for (n = 1 << (RT_PRINT_MAX_SPEEDUP - speedup);
+		     n > 0 && !print_pressure; n--)
+			nanosleep(&slice, NULL);
 	}
 
 	return NULL;
@@ -716,6 +1644,8 @@ static void forked_child_init(void)
 
 		my_buffer->read_pos  = 0;
 		my_buffer->write_pos = 0;
+		my_buffer->dropped = 0;
+		my_buffer->reported = 0;
 	}
 
 	/* re-init to avoid finding it locked by some parent thread */
@@ -771,10 +1701,15 @@ static __constructor__ void __rt_print_init(void)
 	print_period.tv_sec  = period / 1000;
 	print_period.tv_nsec = (period % 1000) * 1000000;
 
+	value_str = getenv(RT_PRINT_DEFERRED_ENV);
+	if (value_str)
+		deferred_format = strtol(value_str, NULL, 10) != 0;
+
 #ifdef CONFIG_XENO_FASTSYNCH
 	/* Fill the buffer pool */
 	{
 		unsigned buffers_count, i;
+		void *pool;
 
 		buffers_count = RT_PRINT_DEFAULT_BUFFERS_COUNT;
 
@@ -802,13 +1737,15 @@ static __constructor__ void __rt_print_init(void)
 		}
 
 		pool_buf_size = sizeof(struct print_buffer) + default_buffer_size;
+		pool_buf_size = (pool_buf_size + RT_PRINT_CACHE_LINE - 1)
+			& ~(RT_PRINT_CACHE_LINE - 1);
 		pool_len = buffers_count * pool_buf_size;
-		pool_start = (unsigned long)malloc(pool_len);
-		if (!pool_start) {
+		if (posix_memalign(&pool, RT_PRINT_CACHE_LINE, pool_len)) {
 			fprintf(stderr, "Error allocating rt_printf "
 				"buffers\n");
 			exit(1);
 		}
+		pool_start = (unsigned long)pool;
 
 		for (i = 0; i < buffers_count / BITS_PER_LONG; i++)
 			xnarch_atomic_set(&pool_bitmap[i], ~0UL);
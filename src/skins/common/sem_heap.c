@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 
 #include <unistd.h>
 #include <pthread.h>
@@ -13,6 +14,7 @@
 #include <nucleus/vdso.h>
 #include <nucleus/heap.h>
 #include <asm/xenomai/syscall.h>
+#include <asm/xenomai/atomic.h>
 #include <asm-generic/current.h>
 #include <asm-generic/sem_heap.h>
 #include "sem_heap.h"
@@ -24,13 +26,29 @@ struct xnvdso *nkvdso;
 
 unsigned long xeno_sem_heap[2] = { 0, 0 };
 
+/* Extent of each semaphore heap currently mapped from its base. */
+unsigned long xeno_sem_heap_mapsz[2] = { 0, 0 };
+
+/* Map the extents of growing heaps upon first access only. */
+int xeno_sem_heap_lazy;
+
 static pthread_once_t init_private_heap = PTHREAD_ONCE_INIT;
 static struct xnheap_desc private_hdesc;
 
-void *xeno_map_heap(struct xnheap_desc *hd)
+/*
+ * Growing heaps: handle for mapping new extents, extent size and
+ * address space reserved for all extents, a null size for fixed
+ * heaps.
+ */
+static unsigned long sem_heap_handle[2];
+static unsigned long sem_heap_extsz[2];
+static unsigned long sem_heap_rsvsz[2];
+static pthread_mutex_t sem_heap_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *map_heap_area(unsigned long handle, void *addr,
+			   size_t size, unsigned long area, int flags)
 {
 	int fd, ret;
-	void *addr;
 
 	fd = open(XNHEAP_DEV_NAME, O_RDWR, 0);
 	if (fd < 0) {
@@ -38,23 +56,105 @@ void *xeno_map_heap(struct xnheap_desc *hd)
 		return MAP_FAILED;
 	}
 
-	ret = ioctl(fd, 0, hd->handle);
+	ret = ioctl(fd, 0, handle);
 	if (ret) {
 		perror("Xenomai: ioctl");
+		close(fd);
 		return MAP_FAILED;
 	}
 
-	addr = mmap(NULL, hd->size, PROT_READ|PROT_WRITE,
-		    MAP_SHARED, fd, hd->area);
+	addr = mmap(addr, size, PROT_READ|PROT_WRITE,
+		    MAP_SHARED | flags, fd, area);
 
 	close(fd);
 
 	return addr;
 }
 
+void *xeno_map_heap(struct xnheap_desc *hd)
+{
+	return map_heap_area(hd->handle, NULL, hd->size, hd->area, 0);
+}
+
+/*
+ * The kernel maps every page of a heap upfront, but shared mappings
+ * may still be write-protected until first written to. Write each
+ * page back with its own contents, so that real-time threads never
+ * take such faults, then lock the range. Other processes may be
+ * updating the heap concurrently, hence the atomic rewrite.
+ */
+void xeno_prefault_heap(void *addr, size_t size)
+{
+	unsigned long pagesz = sysconf(_SC_PAGESIZE), off;
+	volatile unsigned long *p;
+
+	for (off = 0; off < size; off += pagesz) {
+		p = (volatile unsigned long *)((caddr_t)addr + off);
+#ifdef CONFIG_XENO_FASTSYNCH
+		xnarch_atomic_cmpxchg((xnarch_atomic_t *)p, *p, *p);
+#else /* !CONFIG_XENO_FASTSYNCH */
+		(void)*p;
+#endif /* !CONFIG_XENO_FASTSYNCH */
+	}
+
+	mlock(addr, size);
+}
+
+/* Map the extents of a growing heap up to the given index. */
+static int map_sem_extents(unsigned int shared, unsigned int last)
+{
+	unsigned long extsz = sem_heap_extsz[shared];
+	struct xnheap_ext_desc ed;
+	unsigned int n;
+	void *addr;
+	int ret;
+
+	for (n = xeno_sem_heap_mapsz[shared] / extsz; n <= last; n++) {
+		ret = XENOMAI_SYSCALL3(__xn_sys_heap_extent, &ed, shared, n);
+		if (ret < 0)
+			return ret;
+
+		if (ed.area == 0)
+			return -ENOMEM;
+
+		addr = map_heap_area(sem_heap_handle[shared],
+				     (void *)(xeno_sem_heap[shared] + n * extsz),
+				     extsz, ed.area, MAP_FIXED);
+		if (addr == MAP_FAILED)
+			return -errno;
+
+		xeno_prefault_heap(addr, extsz);
+		xeno_sem_heap_mapsz[shared] = (n + 1) * extsz;
+	}
+
+	return 0;
+}
+
+void xeno_sem_heap_map(unsigned int shared, unsigned long off)
+{
+	int ret = -EINVAL;
+
+	pthread_mutex_lock(&sem_heap_lock);
+
+	if (off < xeno_sem_heap_mapsz[shared])
+		ret = 0;
+	else if (sem_heap_extsz[shared] && off < sem_heap_rsvsz[shared])
+		ret = map_sem_extents(shared, off / sem_heap_extsz[shared]);
+
+	pthread_mutex_unlock(&sem_heap_lock);
+
+	if (ret) {
+		errno = -ret;
+		perror("Xenomai: mmap sem heap extent");
+		exit(EXIT_FAILURE);
+	}
+}
+
 static void *map_sem_heap(unsigned int shared)
 {
 	struct xnheap_desc global_hdesc, *hdesc;
+	struct xnheap_ext_desc ed;
+	void *addr;
 	int ret;
 
 	hdesc = shared ? &global_hdesc : &private_hdesc;
@@ -65,7 +165,48 @@ static void *map_sem_heap(unsigned int shared)
 		return MAP_FAILED;
 	}
 
-	return xeno_map_heap(hdesc);
+	/*
+	 * Older kernels do not know about heap extents, and fixed
+	 * heaps report a single one: map the heap as a whole.
+	 */
+	ret = XENOMAI_SYSCALL3(__xn_sys_heap_extent, &ed, shared, 0);
+	if (ret < 0 || ed.maxext <= 1) {
+		addr = xeno_map_heap(hdesc);
+		if (addr != MAP_FAILED) {
+			xeno_prefault_heap(addr, hdesc->size);
+			sem_heap_extsz[shared] = 0;
+			xeno_sem_heap_mapsz[shared] = hdesc->size;
+		}
+		return addr;
+	}
+
+	/*
+	 * Reserve the address space for the heap to grow to its
+	 * maximum size, so that extents follow each other in memory
+	 * and kernel offsets apply unchanged.
+	 */
+	addr = mmap(NULL, ed.size * ed.maxext, PROT_NONE,
+		    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (addr == MAP_FAILED)
+		return addr;
+
+	xeno_sem_heap[shared] = (unsigned long)addr;
+	xeno_sem_heap_mapsz[shared] = 0;
+	sem_heap_handle[shared] = hdesc->handle;
+	sem_heap_extsz[shared] = ed.size;
+	sem_heap_rsvsz[shared] = ed.size * ed.maxext;
+
+	if (xeno_sem_heap_lazy)
+		return addr;
+
+	ret = map_sem_extents(shared, ed.nrext - 1);
+	if (ret) {
+		munmap(addr, sem_heap_rsvsz[shared]);
+		errno = -ret;
+		return MAP_FAILED;
+	}
+
+	return addr;
 }
 
 static void unmap_on_fork(void)
@@ -83,14 +224,18 @@ static void unmap_on_fork(void)
 	   that access to these addresses will cause a segmentation
 	   fault.
 	*/
+	size_t size = sem_heap_extsz[PRIVATE] ?
+		sem_heap_rsvsz[PRIVATE] : private_hdesc.size;
 #if defined(CONFIG_XENO_FASTSYNCH)
 	void *addr = mmap((void *)xeno_sem_heap[PRIVATE],
-			  private_hdesc.size, PROT_NONE,
+			  size, PROT_NONE,
 			  MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
 	if (addr != (void *)xeno_sem_heap[PRIVATE])
 #endif /* CONFIG_XENO_FASTSYNCH */
-		munmap((void *)xeno_sem_heap[PRIVATE], private_hdesc.size);
+		munmap((void *)xeno_sem_heap[PRIVATE], size);
 	xeno_sem_heap[PRIVATE] = 0UL;
+	xeno_sem_heap_mapsz[PRIVATE] = 0UL;
+	pthread_mutex_init(&sem_heap_lock, NULL);
 	init_private_heap = PTHREAD_ONCE_INIT;
 }
 
@@ -106,7 +251,7 @@ static void xeno_init_vdso(void)
 		exit(EXIT_FAILURE);
 	}
 
-	nkvdso = (struct xnvdso *)(xeno_sem_heap[SHARED] + sysinfo.vdso);
+	nkvdso = (struct xnvdso *)xeno_sem_heap_addr(SHARED, sysinfo.vdso);
 }
 
 /* Will be called once at library loading time, and when re-binding
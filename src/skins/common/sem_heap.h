@@ -1,8 +1,17 @@
 #ifndef XENO_SEM_HEAP_H
 #define XENO_SEM_HEAP_H
 
+#include <stddef.h>
 #include <xeno_config.h>
 
+struct xnheap_desc;
+
+extern int xeno_sem_heap_lazy;
+
 void xeno_init_sem_heaps(void);
 
+void *xeno_map_heap(struct xnheap_desc *hd);
+
+void xeno_prefault_heap(void *addr, size_t size);
+
 #endif /* XENO_SEM_HEAP_H */
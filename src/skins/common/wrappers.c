@@ -17,6 +17,7 @@
  */
 
 #include <stdlib.h>
+#include <malloc.h>
 
 #include "internal.h"
 
@@ -26,6 +27,36 @@ void *__real_malloc(size_t size)
 	return malloc(size);
 }
 
+__attribute__ ((weak))
+void *__real_calloc(size_t nmemb, size_t size)
+{
+	return calloc(nmemb, size);
+}
+
+__attribute__ ((weak))
+void *__real_realloc(void *ptr, size_t size)
+{
+	return realloc(ptr, size);
+}
+
+__attribute__ ((weak))
+int __real_posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+	return posix_memalign(memptr, alignment, size);
+}
+
+__attribute__ ((weak))
+void *__real_memalign(size_t alignment, size_t size)
+{
+	return memalign(alignment, size);
+}
+
+__attribute__ ((weak))
+void *__real_valloc(size_t size)
+{
+	return valloc(size);
+}
+
 __attribute__ ((weak))
 void __real_free(void *ptr)
 {
@@ -54,3 +54,29 @@ int rt_alarm_inquire(RT_ALARM *alarm, RT_ALARM_INFO *info)
 	return XENOMAI_SKINCALL2(__native_muxid,
 				 __native_alarm_inquire, alarm, info);
 }
+
+int rt_alarm_group_create(RT_ALARM_GROUP *group, const char *name)
+{
+	return XENOMAI_SKINCALL2(__native_muxid,
+				 __native_alarm_group_create, group, name);
+}
+
+int rt_alarm_group_delete(RT_ALARM_GROUP *group)
+{
+	return XENOMAI_SKINCALL1(__native_muxid,
+				 __native_alarm_group_delete, group);
+}
+
+int rt_alarm_attach(RT_ALARM *alarm, RT_ALARM_GROUP *group)
+{
+	return XENOMAI_SKINCALL2(__native_muxid,
+				 __native_alarm_attach, alarm, group);
+}
+
+int rt_alarm_group_wait(RT_ALARM_GROUP *group, RT_ALARM_EXPIRY *buf,
+			int nr, RTIME timeout)
+{
+	return XENOMAI_SKINCALL4(__native_muxid,
+				 __native_alarm_group_wait, group, buf, nr,
+				 &timeout);
+}
@@ -0,0 +1,62 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <native/syscall.h>
+#include <native/cyclic.h>
+
+extern int __native_muxid;
+
+int rt_cyclic_create(RT_CYCLIC *cyclic, const char *name,
+		     RTIME minor, int nslots)
+{
+	return XENOMAI_SKINCALL4(__native_muxid,
+				 __native_cyclic_create, cyclic, name,
+				 &minor, nslots);
+}
+
+int rt_cyclic_delete(RT_CYCLIC *cyclic)
+{
+	return XENOMAI_SKINCALL1(__native_muxid, __native_cyclic_delete, cyclic);
+}
+
+int rt_cyclic_attach(RT_CYCLIC *cyclic, int slot, RT_TASK *task)
+{
+	return XENOMAI_SKINCALL3(__native_muxid,
+				 __native_cyclic_attach, cyclic, slot, task);
+}
+
+int rt_cyclic_start(RT_CYCLIC *cyclic, RTIME value)
+{
+	return XENOMAI_SKINCALL2(__native_muxid,
+				 __native_cyclic_start, cyclic, &value);
+}
+
+int rt_cyclic_stop(RT_CYCLIC *cyclic)
+{
+	return XENOMAI_SKINCALL1(__native_muxid, __native_cyclic_stop, cyclic);
+}
+
+int rt_cyclic_wait(RT_CYCLIC *cyclic, unsigned long *overruns_r)
+{
+	return XENOMAI_SKINCALL2(__native_muxid,
+				 __native_cyclic_wait, cyclic, overruns_r);
+}
+
+int rt_cyclic_inquire(RT_CYCLIC *cyclic, RT_CYCLIC_INFO *info)
+{
+	return XENOMAI_SKINCALL2(__native_muxid,
+				 __native_cyclic_inquire, cyclic, info);
+}
@@ -16,29 +16,96 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
  */
 
+#include <nucleus/thread.h>
 #include <native/syscall.h>
 #include <native/event.h>
+#include <asm-generic/current.h>
+#include <asm-generic/sem_heap.h>
 
 extern int __native_muxid;
 
 int rt_event_create(RT_EVENT *event,
 		    const char *name, unsigned long ivalue, int mode)
 {
-	return XENOMAI_SKINCALL4(__native_muxid,
-				 __native_event_create, event, name, ivalue,
-				 mode);
+	int err;
+
+	err = XENOMAI_SKINCALL4(__native_muxid,
+				__native_event_create, event, name, ivalue,
+				mode);
+
+#ifdef CONFIG_XENO_FASTSYNCH
+	if (!err)
+		event->state = (struct rt_event_state *)
+			xeno_sem_heap_addr((name && *name) ? 1 : 0,
+					   (unsigned long)event->state);
+#endif /* CONFIG_XENO_FASTSYNCH */
+
+	return err;
 }
 
 int rt_event_bind(RT_EVENT *event, const char *name, RTIME timeout)
 {
-	return XENOMAI_SKINCALL3(__native_muxid,
-				 __native_event_bind, event, name, &timeout);
+	int err;
+
+	err = XENOMAI_SKINCALL3(__native_muxid,
+				__native_event_bind, event, name, &timeout);
+
+#ifdef CONFIG_XENO_FASTSYNCH
+	if (!err)
+		event->state = (struct rt_event_state *)
+			xeno_sem_heap_addr(1, (unsigned long)event->state);
+#endif /* CONFIG_XENO_FASTSYNCH */
+
+	return err;
 }
 
 int rt_event_delete(RT_EVENT *event)
 {
-	return XENOMAI_SKINCALL1(__native_muxid, __native_event_delete, event);
+	int err;
+
+	err = XENOMAI_SKINCALL1(__native_muxid, __native_event_delete, event);
+#ifdef CONFIG_XENO_FASTSYNCH
+	if (err == 0)
+		event->state = NULL;
+#endif /* CONFIG_XENO_FASTSYNCH */
+
+	return err;
+}
+
+#ifdef CONFIG_XENO_FASTSYNCH
+/*
+ * Satisfy a wait request from user-space if the flags allow it,
+ * returning -EAGAIN if the syscall is required. As with semaphores,
+ * only primary mode shadows may do so.
+ */
+static inline int rt_event_fast_wait(RT_EVENT *event, unsigned long mask,
+				     unsigned long *mask_r, int mode,
+				     RTIME timeout)
+{
+	unsigned long value;
+
+	if (event->state == NULL || (event->state->mode & EV_COUNT) ||
+	    xeno_get_current() == XN_NO_HANDLE ||
+	    (xeno_get_current_mode() & XNRELAX))
+		return -EAGAIN;
+
+	value = xnarch_atomic_get(&event->state->value);
+
+	if (mask == 0) {
+		*mask_r = value;
+		return 0;
+	}
+
+	if (__rt_event_test(value, mask, mode)) {
+		*mask_r = value & mask;
+		return 0;
+	}
+
+	return timeout == TM_NONBLOCK ? -EWOULDBLOCK : -EAGAIN;
 }
+#else /* !CONFIG_XENO_FASTSYNCH */
+#define rt_event_fast_wait(event, mask, mask_r, mode, timeout)	(-EAGAIN)
+#endif /* !CONFIG_XENO_FASTSYNCH */
 
 int rt_event_wait(RT_EVENT *event,
 		  unsigned long mask,
@@ -46,6 +113,10 @@ int rt_event_wait(RT_EVENT *event,
 {
 	int ret;
 
+	ret = rt_event_fast_wait(event, mask, mask_r, mode, timeout);
+	if (ret != -EAGAIN)
+		return ret;
+
 	ret = XENOMAI_SKINCALL5(__native_muxid,
 				__native_event_wait,
 				event, &mask, mode, XN_RELATIVE, &timeout);
@@ -63,6 +134,10 @@ int rt_event_wait_until(RT_EVENT *event,
 {
 	int ret;
 
+	ret = rt_event_fast_wait(event, mask, mask_r, mode, timeout);
+	if (ret != -EAGAIN)
+		return ret;
+
 	ret = XENOMAI_SKINCALL5(__native_muxid,
 				__native_event_wait,
 				event, &mask, mode, XN_REALTIME, &timeout);
@@ -74,14 +149,52 @@ int rt_event_wait_until(RT_EVENT *event,
 	return 0;
 }
 
+int rt_event_wait_count(RT_EVENT *event,
+			unsigned long mask,
+			unsigned long *mask_r,
+			unsigned long *counts, int mode, RTIME timeout)
+{
+	int ret;
+
+	ret = XENOMAI_SKINCALL5(__native_muxid,
+				__native_event_wait_count,
+				event, &mask, mode, &timeout, counts);
+	if (ret)
+		return ret;
+
+	*mask_r = mask;
+
+	return 0;
+}
+
 int rt_event_signal(RT_EVENT *event, unsigned long mask)
 {
+#ifdef CONFIG_XENO_FASTSYNCH
+	/* Nobody to wake up: the flags are posted already. */
+	if (event->state && !(event->state->mode & EV_COUNT)) {
+		__rt_event_post(event->state, mask);
+		if (xnarch_atomic_get(&event->state->nwaiters) == 0)
+			return 0;
+	}
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 	return XENOMAI_SKINCALL2(__native_muxid,
 				 __native_event_signal, event, mask);
 }
 
 int rt_event_clear(RT_EVENT *event, unsigned long mask, unsigned long *mask_r)
 {
+#ifdef CONFIG_XENO_FASTSYNCH
+	unsigned long value;
+
+	if (event->state && !(event->state->mode & EV_COUNT)) {
+		value = __rt_event_clear(event->state, mask);
+		if (mask_r)
+			*mask_r = value;
+		return 0;
+	}
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 	return XENOMAI_SKINCALL3(__native_muxid,
 				 __native_event_clear, event, mask, mask_r);
 }
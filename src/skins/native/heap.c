@@ -21,6 +21,9 @@
 #include <sys/ioctl.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 #include <native/syscall.h>
 #include <native/task.h>
 #include <native/heap.h>
@@ -30,6 +33,134 @@ extern int __native_muxid;
 
 void *xeno_map_heap(struct xnheap_desc *hd);
 
+void xeno_prefault_heap(void *addr, size_t size);
+
+/*
+ * Per-thread block caches of H_UCACHE heaps. Allocations are served
+ * from per-size class stacks of blocks refilled from the heap, and
+ * releases are queued, both directions being exchanged with the
+ * heap in batches through a single __native_heap_xfer call. Since
+ * the size of a released block is unknown here, released blocks are
+ * not reused locally but returned to the heap with the next batch.
+ */
+
+#define UCACHE_MINSHIFT  5	/* Smallest class: 32 bytes. */
+#define UCACHE_CLASSES   6	/* Largest class: 1024 bytes. */
+#define UCACHE_DEPTH     16	/* Blocks moved per batch. */
+#define UCACHE_HEAPS     4	/* Heaps cached per thread. */
+
+struct heap_ucache {
+	RT_HEAP_PLACEHOLDER ph;	/* ph.opaque == XN_NO_HANDLE if unused. */
+	void *freev[UCACHE_DEPTH];
+	int nfree;
+	struct {
+		void *blockv[UCACHE_DEPTH];
+		int count;
+	} class[UCACHE_CLASSES];
+};
+
+static pthread_key_t __heap_ucache_key;
+
+static pthread_once_t __heap_ucache_once = PTHREAD_ONCE_INIT;
+
+static int __heap_xfer(RT_HEAP_PLACEHOLDER *ph, void **freev, int nfree,
+		       size_t size, void **allocv, int nalloc)
+{
+	struct rt_arg_bulk bulk;
+
+	bulk.a1 = (u_long)freev;
+	bulk.a2 = (u_long)nfree;
+	bulk.a3 = (u_long)size;
+	bulk.a4 = (u_long)allocv;
+	bulk.a5 = (u_long)nalloc;
+
+	return XENOMAI_SKINCALL2(__native_muxid, __native_heap_xfer, ph, &bulk);
+}
+
+/* Return all blocks held by a cache to its heap, then release it. */
+static void __heap_ucache_drain(struct heap_ucache *uc)
+{
+	int n, i;
+
+	if (uc->nfree)
+		__heap_xfer(&uc->ph, uc->freev, uc->nfree, 0, NULL, 0);
+
+	for (n = 0; n < UCACHE_CLASSES; n++) {
+		i = uc->class[n].count;
+		if (i)
+			__heap_xfer(&uc->ph, uc->class[n].blockv, i, 0, NULL, 0);
+	}
+
+	memset(uc, 0, sizeof(*uc));
+	uc->ph.opaque = XN_NO_HANDLE;
+}
+
+static void __heap_ucache_flush(void *tsd)
+{
+	struct heap_ucache *ucv = tsd;
+	int n;
+
+	for (n = 0; n < UCACHE_HEAPS; n++)
+		if (ucv[n].ph.opaque != XN_NO_HANDLE)
+			__heap_ucache_drain(&ucv[n]);
+
+	free(ucv);
+}
+
+static void __heap_ucache_init(void)
+{
+	pthread_key_create(&__heap_ucache_key, &__heap_ucache_flush);
+}
+
+static struct heap_ucache *__heap_ucache_get(RT_HEAP *heap, int create)
+{
+	struct heap_ucache *ucv, *uc = NULL;
+	int n;
+
+	pthread_once(&__heap_ucache_once, &__heap_ucache_init);
+
+	ucv = pthread_getspecific(__heap_ucache_key);
+	if (ucv == NULL) {
+		if (!create)
+			return NULL;
+		ucv = calloc(UCACHE_HEAPS, sizeof(*ucv));
+		if (ucv == NULL)
+			return NULL;
+		for (n = 0; n < UCACHE_HEAPS; n++)
+			ucv[n].ph.opaque = XN_NO_HANDLE;
+		if (pthread_setspecific(__heap_ucache_key, ucv)) {
+			free(ucv);
+			return NULL;
+		}
+	}
+
+	for (n = 0; n < UCACHE_HEAPS; n++) {
+		if (ucv[n].ph.opaque == heap->opaque)
+			return &ucv[n];
+		if (uc == NULL && ucv[n].ph.opaque == XN_NO_HANDLE)
+			uc = &ucv[n];
+	}
+
+	/* All slots busy: fall back to plain system calls. */
+	if (uc && create)
+		uc->ph = *heap;
+	else
+		uc = NULL;
+
+	return uc;
+}
+
+static int __heap_ucache_class(size_t size)
+{
+	int n;
+
+	for (n = 0; n < UCACHE_CLASSES; n++)
+		if (size <= (1UL << (n + UCACHE_MINSHIFT)))
+			return n;
+
+	return -1;
+}
+
 static int __map_heap_memory(RT_HEAP *heap, RT_HEAP_PLACEHOLDER *php)
 {
 	struct xnheap_desc hd;
@@ -41,6 +172,9 @@ static int __map_heap_memory(RT_HEAP *heap, RT_HEAP_PLACEHOLDER *php)
 	if (php->mapbase == MAP_FAILED)
 		return -errno;
 
+	if (php->mode & H_PREFAULT)
+		xeno_prefault_heap(php->mapbase, php->mapsize);
+
 	*heap = *php;
 
 	return 0;
@@ -80,7 +214,13 @@ int rt_heap_bind(RT_HEAP *heap, const char *name, RTIME timeout)
 
 int rt_heap_unbind(RT_HEAP *heap)
 {
-	int err = __real_munmap(heap->mapbase, heap->mapsize);
+	struct heap_ucache *uc;
+	int err;
+
+	if ((heap->mode & H_UCACHE) && (uc = __heap_ucache_get(heap, 0)))
+		__heap_ucache_drain(uc);
+
+	err = __real_munmap(heap->mapbase, heap->mapsize);
 
 	if (err == -1)
 		err = -errno;
@@ -94,8 +234,15 @@ int rt_heap_unbind(RT_HEAP *heap)
 
 int rt_heap_delete(RT_HEAP *heap)
 {
+	struct heap_ucache *uc;
 	int err;
 
+	if ((heap->mode & H_UCACHE) && (uc = __heap_ucache_get(heap, 0))) {
+		/* The blocks go away with the heap. */
+		memset(uc, 0, sizeof(*uc));
+		uc->ph.opaque = XN_NO_HANDLE;
+	}
+
 	err = XENOMAI_SKINCALL1(__native_muxid, __native_heap_delete, heap);
 	if (err)
 		return err;
@@ -109,6 +256,34 @@ int rt_heap_delete(RT_HEAP *heap)
 
 int rt_heap_alloc(RT_HEAP *heap, size_t size, RTIME timeout, void **bufp)
 {
+	struct heap_ucache *uc;
+	int class, n;
+
+	if ((heap->mode & (H_UCACHE|H_SINGLE)) != H_UCACHE || size == 0 ||
+	    (class = __heap_ucache_class(size)) < 0 ||
+	    (uc = __heap_ucache_get(heap, 1)) == NULL)
+		goto syscall;
+
+	n = uc->class[class].count;
+	if (n == 0) {
+		/* Refill, returning the released blocks on the way. */
+		n = __heap_xfer(&uc->ph, uc->freev, uc->nfree,
+				1UL << (class + UCACHE_MINSHIFT),
+				uc->class[class].blockv, UCACHE_DEPTH);
+		if (n < 0)
+			return n;
+		uc->nfree = 0;
+		if (n == 0)
+			/* Heap exhausted, wait for memory the usual way. */
+			goto syscall;
+	}
+
+	uc->class[class].count = --n;
+	*bufp = uc->class[class].blockv[n];
+
+	return 0;
+
+syscall:
 	return XENOMAI_SKINCALL4(__native_muxid,
 				 __native_heap_alloc, heap, size, &timeout,
 				 bufp);
@@ -116,7 +291,24 @@ int rt_heap_alloc(RT_HEAP *heap, size_t size, RTIME timeout, void **bufp)
 
 int rt_heap_free(RT_HEAP *heap, void *buf)
 {
-	return XENOMAI_SKINCALL2(__native_muxid, __native_heap_free, heap, buf);
+	struct heap_ucache *uc;
+	int err;
+
+	if ((heap->mode & (H_UCACHE|H_SINGLE)) != H_UCACHE || buf == NULL ||
+	    (uc = __heap_ucache_get(heap, 1)) == NULL)
+		return XENOMAI_SKINCALL2(__native_muxid,
+					 __native_heap_free, heap, buf);
+
+	if (uc->nfree == UCACHE_DEPTH) {
+		err = __heap_xfer(&uc->ph, uc->freev, uc->nfree, 0, NULL, 0);
+		if (err < 0)
+			return err;
+		uc->nfree = 0;
+	}
+
+	uc->freev[uc->nfree++] = buf;
+
+	return 0;
 }
 
 int rt_heap_inquire(RT_HEAP *heap, RT_HEAP_INFO *info)
@@ -124,3 +316,9 @@ int rt_heap_inquire(RT_HEAP *heap, RT_HEAP_INFO *info)
 	return XENOMAI_SKINCALL2(__native_muxid, __native_heap_inquire, heap,
 				 info);
 }
+
+int rt_heap_inquire_ext(RT_HEAP *heap, RT_HEAP_XINFO *xinfo)
+{
+	return XENOMAI_SKINCALL2(__native_muxid, __native_heap_inquire_ext,
+				 heap, xinfo);
+}
@@ -18,33 +18,81 @@
 
 #include <sys/types.h>
 #include <stdio.h>
+#include <errno.h>
 #include <pthread.h>
 #include <native/syscall.h>
 #include <native/intr.h>
+#include <asm-generic/sem_heap.h>
 
 extern int __native_muxid;
 
 int rt_intr_create(RT_INTR *intr, const char *name, unsigned irq, int mode)
 {
-	return XENOMAI_SKINCALL4(__native_muxid,
-				 __native_intr_create, intr, name, irq, mode);
+	int err;
+
+	err = XENOMAI_SKINCALL4(__native_muxid,
+				__native_intr_create, intr, name, irq, mode);
+	if (!err)
+		intr->window = (RT_INTR_WINDOW *)
+			xeno_sem_heap_addr((name && *name) ? 1 : 0,
+					   (unsigned long)intr->window);
+
+	return err;
 }
 
 int rt_intr_bind(RT_INTR *intr, const char *name, RTIME timeout)
 {
-	return XENOMAI_SKINCALL3(__native_muxid,
-				 __native_intr_bind, intr, name, &timeout);
+	int err;
+
+	err = XENOMAI_SKINCALL3(__native_muxid,
+				__native_intr_bind, intr, name, &timeout);
+	if (!err && intr->window)
+		intr->window = (RT_INTR_WINDOW *)
+			xeno_sem_heap_addr(1, (unsigned long)intr->window);
+
+	return err;
 }
 
 int rt_intr_delete(RT_INTR *intr)
 {
-	return XENOMAI_SKINCALL1(__native_muxid, __native_intr_delete, intr);
+	int err;
+
+	err = XENOMAI_SKINCALL1(__native_muxid, __native_intr_delete, intr);
+	if (!err)
+		intr->window = NULL;
+
+	return err;
+}
+
+int rt_intr_poll(RT_INTR *intr)
+{
+#ifdef CONFIG_XENO_FASTSYNCH
+	int pending;
+
+	if (intr->window == NULL)
+		return -EPERM;
+
+	pending = __rt_intr_consume(intr->window);
+
+	return pending ?: -EWOULDBLOCK;
+#else /* !CONFIG_XENO_FASTSYNCH */
+	return -ENOSYS;
+#endif /* !CONFIG_XENO_FASTSYNCH */
 }
 
 int rt_intr_wait(RT_INTR *intr, RTIME timeout)
 {
 	int err, oldtype;
 
+#ifdef CONFIG_XENO_FASTSYNCH
+	/* Hits received since the last wait are collected locally. */
+	if (intr->window) {
+		err = __rt_intr_consume(intr->window);
+		if (err)
+			return err;
+	}
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
 
 	err = XENOMAI_SKINCALL2(__native_muxid,
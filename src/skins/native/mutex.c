@@ -26,6 +26,43 @@
 
 extern int __native_muxid;
 
+#ifdef CONFIG_XENO_FASTSYNCH
+/*
+ * Ceiling mutexes carry a non-null ceiling handle after the lock
+ * word, which we publish in our state window for the nucleus to
+ * apply lazily.
+ */
+static inline int fast_acquire(RT_MUTEX *mutex, xnhandle_t cur)
+{
+	struct xnthread_user_window *window;
+
+	if (likely(xnsynch_fast_pp_handle(mutex->fastlock) == XN_NO_HANDLE))
+		return xnsynch_fast_acquire(mutex->fastlock, cur);
+
+	window = xeno_get_current_window();
+	if (window == NULL)
+		return -ENOSYS;
+
+	return xnsynch_fast_pp_acquire(mutex->fastlock, cur,
+				       &window->pp_pending);
+}
+
+static inline int fast_release(RT_MUTEX *mutex, xnhandle_t cur)
+{
+	struct xnthread_user_window *window;
+
+	if (likely(xnsynch_fast_pp_handle(mutex->fastlock) == XN_NO_HANDLE))
+		return xnsynch_fast_release(mutex->fastlock, cur);
+
+	window = xeno_get_current_window();
+	if (window == NULL)
+		return 0;
+
+	return xnsynch_fast_pp_release(mutex->fastlock, cur,
+				       &window->pp_pending);
+}
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 int rt_mutex_create(RT_MUTEX *mutex, const char *name)
 {
 	int err;
@@ -36,8 +73,27 @@ int rt_mutex_create(RT_MUTEX *mutex, const char *name)
 #ifdef CONFIG_XENO_FASTSYNCH
 	if (!err) {
 		mutex->fastlock = (xnarch_atomic_t *)
-			(xeno_sem_heap[(name && *name) ? 1 : 0] +
-			 (unsigned long)mutex->fastlock);
+			xeno_sem_heap_addr((name && *name) ? 1 : 0,
+					   (unsigned long)mutex->fastlock);
+		mutex->lockcnt = 0;
+	}
+#endif /* CONFIG_XENO_FASTSYNCH */
+
+	return err;
+}
+
+int rt_mutex_create_ceiling(RT_MUTEX *mutex, const char *name, int ceiling)
+{
+	int err;
+
+	err = XENOMAI_SKINCALL3(__native_muxid, __native_mutex_create_ceiling,
+				mutex, name, ceiling);
+
+#ifdef CONFIG_XENO_FASTSYNCH
+	if (!err) {
+		mutex->fastlock = (xnarch_atomic_t *)
+			xeno_sem_heap_addr((name && *name) ? 1 : 0,
+					   (unsigned long)mutex->fastlock);
 		mutex->lockcnt = 0;
 	}
 #endif /* CONFIG_XENO_FASTSYNCH */
@@ -55,8 +111,8 @@ int rt_mutex_bind(RT_MUTEX *mutex, const char *name, RTIME timeout)
 #ifdef CONFIG_XENO_FASTSYNCH
 	if (!err) {
 		mutex->fastlock = (xnarch_atomic_t *)
-			(xeno_sem_heap[(name && *name) ? 1 : 0] +
-			 (unsigned long)mutex->fastlock);
+			xeno_sem_heap_addr((name && *name) ? 1 : 0,
+					   (unsigned long)mutex->fastlock);
 		mutex->lockcnt = 0;
 	}
 #endif /* CONFIG_XENO_FASTSYNCH */
@@ -84,7 +140,7 @@ static int rt_mutex_acquire_inner(RT_MUTEX *mutex, RTIME timeout, xntmode_t mode
 	unsigned long status;
 	xnhandle_t cur;
 
-	cur = xeno_get_current();
+	cur = xeno_get_current_and_mode(&status);
 	if (cur == XN_NO_HANDLE)
 		return -EPERM;
 
@@ -93,17 +149,19 @@ static int rt_mutex_acquire_inner(RT_MUTEX *mutex, RTIME timeout, xntmode_t mode
 	 * order to handle the auto-relax feature, so we must always
 	 * obtain them via a syscall.
 	 */
-	status = xeno_get_current_mode();
 	if (unlikely(status & XNOTHER))
 		goto do_syscall;
 
 	if (likely(!(status & XNRELAX))) {
-		err = xnsynch_fast_acquire(mutex->fastlock, cur);
+		err = fast_acquire(mutex, cur);
 		if (likely(!err)) {
 			mutex->lockcnt = 1;
 			return 0;
 		}
 
+		if (err == -ENOSYS)
+			goto do_syscall;
+
 		if (err == -EBUSY) {
 			if (mutex->lockcnt == UINT_MAX)
 				return -EAGAIN;
@@ -159,11 +217,10 @@ int rt_mutex_release(RT_MUTEX *mutex)
 	unsigned long status;
 	xnhandle_t cur;
 
-	cur = xeno_get_current();
+	cur = xeno_get_current_and_mode(&status);
 	if (cur == XN_NO_HANDLE)
 		return -EPERM;
 
-	status = xeno_get_current_mode();
 	if (unlikely(status & XNOTHER))
 		/* See rt_mutex_acquire_inner() */
 		goto do_syscall;
@@ -176,7 +233,7 @@ int rt_mutex_release(RT_MUTEX *mutex)
 		return 0;
 	}
 
-	if (likely(xnsynch_fast_release(mutex->fastlock, cur)))
+	if (likely(fast_release(mutex, cur)))
 		return 0;
 
 do_syscall:
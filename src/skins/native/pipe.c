@@ -56,3 +56,9 @@ ssize_t rt_pipe_stream(RT_PIPE *pipe, const void *buf, size_t size)
 	return XENOMAI_SKINCALL3(__native_muxid,
 				 __native_pipe_stream, pipe, buf, size);
 }
+
+int rt_pipe_batch(RT_PIPE *pipe, size_t threshold, RTIME delay)
+{
+	return XENOMAI_SKINCALL3(__native_muxid,
+				 __native_pipe_batch, pipe, threshold, &delay);
+}
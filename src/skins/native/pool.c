@@ -0,0 +1,573 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <asm/xenomai/atomic.h>
+#include <native/task.h>
+#include <native/sem.h>
+#include <native/pool.h>
+
+#ifdef CONFIG_XENO_FASTSYNCH
+
+#define POOL_CACHELINE  64
+
+/*
+ * Work-stealing deque (Chase & Lev). The owner pushes and pops at the
+ * bottom end without any atomic operation, except when racing with
+ * thieves for the last item; thieves take from the top end with a
+ * compare-and-swap. The array does not grow: a full deque makes the
+ * submitter fall back to the shared injection queue.
+ */
+struct pool_deque {
+	xnarch_atomic_t top;
+	char pad1[POOL_CACHELINE - sizeof(xnarch_atomic_t)];
+	xnarch_atomic_t bottom;
+	char pad2[POOL_CACHELINE - sizeof(xnarch_atomic_t)];
+	RT_POOL_WORK *volatile *slots;
+	unsigned long mask;
+};
+
+/*
+ * Bounded multi-producer, multi-consumer queue (Vyukov), for items
+ * submitted from outside the workers. Each cell carries a sequence
+ * number telling whether it is free for the enqueuer at the same
+ * position, or filled for the dequeuer.
+ */
+struct pool_cell {
+	xnarch_atomic_t seq;
+	RT_POOL_WORK *work;
+};
+
+struct pool_inject {
+	xnarch_atomic_t head;
+	char pad1[POOL_CACHELINE - sizeof(xnarch_atomic_t)];
+	xnarch_atomic_t tail;
+	char pad2[POOL_CACHELINE - sizeof(xnarch_atomic_t)];
+	struct pool_cell *cells;
+	unsigned long mask;
+};
+
+struct pool_worker {
+	struct pool_deque deque;
+	struct rt_pool_control *ctl;
+	RT_TASK task;
+	int cpu;
+	int socket;
+	/* Steal order: workers on the same socket come first. */
+	int victims[RT_POOL_MAX_WORKERS - 1];
+	int nvictims;
+} __attribute__((aligned(POOL_CACHELINE)));
+
+struct rt_pool_control {
+	struct pool_worker workers[RT_POOL_MAX_WORKERS];
+	struct pool_inject inject;
+	/* Workers about to sleep, not yet claimed by a submitter. */
+	xnarch_atomic_t idle;
+	char pad[POOL_CACHELINE - sizeof(xnarch_atomic_t)];
+	RT_SEM sem;
+	int nworkers;
+	volatile int stopping;
+};
+
+#ifdef HAVE___THREAD
+static __thread struct pool_worker *__pool_self
+	__attribute__ ((tls_model ("initial-exec")));
+#define __pool_get_self()	(__pool_self)
+#define __pool_set_self(w)	(__pool_self = (w))
+#else /* !HAVE___THREAD */
+static pthread_key_t __pool_self_key;
+static pthread_once_t __pool_self_once = PTHREAD_ONCE_INIT;
+
+static void __pool_self_init(void)
+{
+	pthread_key_create(&__pool_self_key, NULL);
+}
+
+#define __pool_get_self()						\
+	({								\
+		pthread_once(&__pool_self_once, &__pool_self_init);	\
+		(struct pool_worker *)pthread_getspecific(__pool_self_key); \
+	})
+#define __pool_set_self(w)	pthread_setspecific(__pool_self_key, (w))
+#endif /* !HAVE___THREAD */
+
+static void __pool_add(xnarch_atomic_t *v, long d)
+{
+	unsigned long old;
+
+	do
+		old = xnarch_atomic_get(v);
+	while (xnarch_atomic_cmpxchg(v, old, old + d) != old);
+}
+
+static int __pool_dec_if_positive(xnarch_atomic_t *v)
+{
+	unsigned long old;
+
+	do {
+		old = xnarch_atomic_get(v);
+		if (old == 0)
+			return 0;
+	} while (xnarch_atomic_cmpxchg(v, old, old - 1) != old);
+
+	return 1;
+}
+
+static int deque_push(struct pool_deque *dq, RT_POOL_WORK *work)
+{
+	unsigned long b, t;
+
+	b = xnarch_atomic_get(&dq->bottom);
+	t = xnarch_atomic_get(&dq->top);
+	if (b - t > dq->mask)
+		return -EAGAIN;
+
+	dq->slots[b & dq->mask] = work;
+	xnarch_write_memory_barrier();
+	xnarch_atomic_set(&dq->bottom, b + 1);
+
+	return 0;
+}
+
+static RT_POOL_WORK *deque_pop(struct pool_deque *dq)
+{
+	unsigned long b, t;
+	RT_POOL_WORK *work;
+
+	b = xnarch_atomic_get(&dq->bottom) - 1;
+	xnarch_atomic_set(&dq->bottom, b);
+	xnarch_memory_barrier();
+	t = xnarch_atomic_get(&dq->top);
+
+	if ((long)(b - t) < 0) {
+		xnarch_atomic_set(&dq->bottom, t);
+		return NULL;
+	}
+
+	work = dq->slots[b & dq->mask];
+	if (b != t)
+		return work;
+
+	/* Last item, thieves may be after it too. */
+	if (xnarch_atomic_cmpxchg(&dq->top, t, t + 1) != t)
+		work = NULL;
+
+	xnarch_atomic_set(&dq->bottom, t + 1);
+
+	return work;
+}
+
+static RT_POOL_WORK *deque_steal(struct pool_deque *dq)
+{
+	unsigned long b, t;
+	RT_POOL_WORK *work;
+
+	t = xnarch_atomic_get(&dq->top);
+	xnarch_memory_barrier();
+	b = xnarch_atomic_get(&dq->bottom);
+
+	if ((long)(b - t) <= 0)
+		return NULL;
+
+	work = dq->slots[t & dq->mask];
+	if (xnarch_atomic_cmpxchg(&dq->top, t, t + 1) != t)
+		return NULL;	/* Lost the race, try another victim. */
+
+	return work;
+}
+
+static inline int deque_empty_p(struct pool_deque *dq)
+{
+	return (long)(xnarch_atomic_get(&dq->bottom) -
+		      xnarch_atomic_get(&dq->top)) <= 0;
+}
+
+static int inject_push(struct pool_inject *iq, RT_POOL_WORK *work)
+{
+	unsigned long pos, seq, old;
+	struct pool_cell *cell;
+
+	pos = xnarch_atomic_get(&iq->tail);
+	for (;;) {
+		cell = &iq->cells[pos & iq->mask];
+		seq = xnarch_atomic_get(&cell->seq);
+		xnarch_read_memory_barrier();
+		if (seq == pos) {
+			old = xnarch_atomic_cmpxchg(&iq->tail, pos, pos + 1);
+			if (old == pos)
+				break;
+			pos = old;
+		} else if ((long)(seq - pos) < 0)
+			return -EAGAIN;
+		else
+			pos = xnarch_atomic_get(&iq->tail);
+	}
+
+	cell->work = work;
+	xnarch_write_memory_barrier();
+	xnarch_atomic_set(&cell->seq, pos + 1);
+
+	return 0;
+}
+
+static RT_POOL_WORK *inject_pop(struct pool_inject *iq)
+{
+	unsigned long pos, seq, old;
+	struct pool_cell *cell;
+	RT_POOL_WORK *work;
+
+	pos = xnarch_atomic_get(&iq->head);
+	for (;;) {
+		cell = &iq->cells[pos & iq->mask];
+		seq = xnarch_atomic_get(&cell->seq);
+		xnarch_read_memory_barrier();
+		if (seq == pos + 1) {
+			old = xnarch_atomic_cmpxchg(&iq->head, pos, pos + 1);
+			if (old == pos)
+				break;
+			pos = old;
+		} else if ((long)(seq - (pos + 1)) < 0)
+			return NULL;
+		else
+			pos = xnarch_atomic_get(&iq->head);
+	}
+
+	work = cell->work;
+	xnarch_memory_barrier();
+	xnarch_atomic_set(&cell->seq, pos + iq->mask + 1);
+
+	return work;
+}
+
+static inline int inject_empty_p(struct pool_inject *iq)
+{
+	return xnarch_atomic_get(&iq->head) == xnarch_atomic_get(&iq->tail);
+}
+
+static RT_POOL_WORK *pool_next_work(struct pool_worker *self)
+{
+	struct rt_pool_control *ctl = self->ctl;
+	RT_POOL_WORK *work;
+	int n;
+
+	work = deque_pop(&self->deque);
+	if (work)
+		return work;
+
+	work = inject_pop(&ctl->inject);
+	if (work)
+		return work;
+
+	for (n = 0; n < self->nvictims; n++) {
+		work = deque_steal(&ctl->workers[self->victims[n]].deque);
+		if (work)
+			return work;
+	}
+
+	return NULL;
+}
+
+static int pool_has_work(struct rt_pool_control *ctl)
+{
+	int n;
+
+	if (!inject_empty_p(&ctl->inject))
+		return 1;
+
+	for (n = 0; n < ctl->nworkers; n++)
+		if (!deque_empty_p(&ctl->workers[n].deque))
+			return 1;
+
+	return 0;
+}
+
+/*
+ * Sleep until some work is submitted. The worker registers as idle
+ * before looking at the queues one last time, and submitters look at
+ * the idle count after queuing, so that either side sees the other.
+ * A submitter claims one idle registration per semaphore post; a
+ * worker which finds work after all gives its registration back, or
+ * consumes the post made on its behalf if it was already claimed.
+ * Returns non-zero when the pool is being deleted.
+ */
+static int pool_idle(struct rt_pool_control *ctl)
+{
+	__pool_add(&ctl->idle, 1);
+
+	if (pool_has_work(ctl) || ctl->stopping) {
+		if (!__pool_dec_if_positive(&ctl->idle))
+			rt_sem_p(&ctl->sem, TM_INFINITE);
+		return ctl->stopping && !pool_has_work(ctl);
+	}
+
+	rt_sem_p(&ctl->sem, TM_INFINITE);
+
+	return 0;
+}
+
+static void pool_wakeup(struct rt_pool_control *ctl)
+{
+	xnarch_memory_barrier();
+
+	if (__pool_dec_if_positive(&ctl->idle))
+		rt_sem_v(&ctl->sem);
+}
+
+static void pool_worker_loop(void *cookie)
+{
+	struct pool_worker *self = cookie;
+	RT_POOL_WORK *work;
+
+	__pool_set_self(self);
+
+	for (;;) {
+		work = pool_next_work(self);
+		if (work) {
+			work->handler(work->cookie);
+			continue;
+		}
+		if (pool_idle(self->ctl))
+			break;
+	}
+
+	__pool_set_self(NULL);
+}
+
+static int pool_cpu_socket(int cpu)
+{
+	char path[64];
+	int socket = 0;
+	FILE *fp;
+
+	snprintf(path, sizeof(path),
+		 "/sys/devices/system/cpu/cpu%d/topology/physical_package_id",
+		 cpu);
+
+	fp = fopen(path, "r");
+	if (fp == NULL)
+		return 0;
+
+	if (fscanf(fp, "%d", &socket) != 1)
+		socket = 0;
+
+	fclose(fp);
+
+	return socket;
+}
+
+static void pool_set_victims(struct rt_pool_control *ctl)
+{
+	struct pool_worker *w;
+	int i, n, pass;
+
+	for (i = 0; i < ctl->nworkers; i++) {
+		w = &ctl->workers[i];
+		w->nvictims = 0;
+		/* Same socket first, then the others, starting after us. */
+		for (pass = 0; pass < 2; pass++)
+			for (n = 1; n < ctl->nworkers; n++) {
+				struct pool_worker *v =
+					&ctl->workers[(i + n) % ctl->nworkers];
+				if ((v->socket == w->socket) == (pass == 0))
+					w->victims[w->nvictims++] =
+						(i + n) % ctl->nworkers;
+			}
+	}
+}
+
+static void pool_free(struct rt_pool_control *ctl)
+{
+	int n;
+
+	for (n = 0; n < RT_POOL_MAX_WORKERS; n++)
+		free((void *)ctl->workers[n].deque.slots);
+
+	free(ctl->inject.cells);
+	free(ctl);
+}
+
+static void pool_stop(struct rt_pool_control *ctl, int nstarted)
+{
+	int n;
+
+	ctl->stopping = 1;
+	xnarch_memory_barrier();
+
+	/* Posts are kept until consumed, no worker can miss one. */
+	for (n = 0; n < nstarted; n++)
+		rt_sem_v(&ctl->sem);
+
+	for (n = 0; n < nstarted; n++)
+		rt_task_join(&ctl->workers[n].task);
+
+	rt_sem_delete(&ctl->sem);
+}
+
+int rt_pool_create(RT_POOL *pool, const char *name, int prio,
+		   unsigned long cpumask, int depth)
+{
+	struct rt_pool_control *ctl;
+	struct pool_worker *w;
+	char tname[XNOBJECT_NAME_LEN];
+	long ncpus;
+	int cpu, n, err;
+
+	if (depth <= 0 || (depth & (depth - 1)) != 0)
+		return -EINVAL;
+
+	ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (ncpus < 1)
+		ncpus = 1;
+	else if (ncpus > RT_POOL_MAX_WORKERS)
+		ncpus = RT_POOL_MAX_WORKERS;
+
+	if (cpumask == 0)
+		cpumask = (1UL << ncpus) - 1;
+	else if (cpumask & ~((1UL << RT_POOL_MAX_WORKERS) - 1))
+		return -EINVAL;
+
+	if (posix_memalign((void **)&ctl, POOL_CACHELINE, sizeof(*ctl)))
+		return -ENOMEM;
+
+	memset(ctl, 0, sizeof(*ctl));
+
+	for (cpu = 0; cpu < RT_POOL_MAX_WORKERS; cpu++) {
+		if ((cpumask & (1UL << cpu)) == 0)
+			continue;
+		w = &ctl->workers[ctl->nworkers++];
+		w->ctl = ctl;
+		w->cpu = cpu;
+		w->socket = pool_cpu_socket(cpu);
+		w->deque.mask = depth - 1;
+		w->deque.slots = calloc(depth, sizeof(RT_POOL_WORK *));
+		if (w->deque.slots == NULL) {
+			err = -ENOMEM;
+			goto fail_free;
+		}
+	}
+
+	/* The injection queue takes work from any thread. */
+	ctl->inject.mask = depth * RT_POOL_MAX_WORKERS - 1;
+	ctl->inject.cells = calloc(ctl->inject.mask + 1,
+				   sizeof(struct pool_cell));
+	if (ctl->inject.cells == NULL) {
+		err = -ENOMEM;
+		goto fail_free;
+	}
+
+	for (n = 0; n <= ctl->inject.mask; n++)
+		xnarch_atomic_set(&ctl->inject.cells[n].seq, n);
+
+	pool_set_victims(ctl);
+
+	err = rt_sem_create(&ctl->sem, NULL, 0, S_FIFO);
+	if (err)
+		goto fail_free;
+
+	for (n = 0; n < ctl->nworkers; n++) {
+		w = &ctl->workers[n];
+		if (name)
+			snprintf(tname, sizeof(tname), "%s-%d", name, w->cpu);
+		err = rt_task_create(&w->task, name ? tname : NULL, 0, prio,
+				     T_CPU(w->cpu) | T_JOINABLE);
+		if (err)
+			goto fail_stop;
+		err = rt_task_start(&w->task, &pool_worker_loop, w);
+		if (err) {
+			rt_task_delete(&w->task);
+			goto fail_stop;
+		}
+	}
+
+	pool->ctl = ctl;
+
+	return 0;
+
+fail_stop:
+	pool_stop(ctl, n);
+fail_free:
+	pool_free(ctl);
+
+	return err;
+}
+
+int rt_pool_delete(RT_POOL *pool)
+{
+	struct rt_pool_control *ctl = pool->ctl;
+	struct pool_worker *self;
+
+	if (ctl == NULL)
+		return -EINVAL;
+
+	self = __pool_get_self();
+	if (self && self->ctl == ctl)
+		return -EDEADLK;
+
+	/* Queued work is run before the workers exit. */
+	pool_stop(ctl, ctl->nworkers);
+	pool_free(ctl);
+	pool->ctl = NULL;
+
+	return 0;
+}
+
+int rt_pool_submit(RT_POOL *pool, RT_POOL_WORK *work)
+{
+	struct rt_pool_control *ctl = pool->ctl;
+	struct pool_worker *self;
+	int err = -EAGAIN;
+
+	if (ctl == NULL || ctl->stopping)
+		return -EINVAL;
+
+	/* Workers queue locally, the others go through the injection queue. */
+	self = __pool_get_self();
+	if (self && self->ctl == ctl)
+		err = deque_push(&self->deque, work);
+
+	if (err)
+		err = inject_push(&ctl->inject, work);
+
+	if (err == 0)
+		pool_wakeup(ctl);
+
+	return err;
+}
+
+#else /* !CONFIG_XENO_FASTSYNCH */
+
+int rt_pool_create(RT_POOL *pool, const char *name, int prio,
+		   unsigned long cpumask, int depth)
+{
+	return -ENOSYS;
+}
+
+int rt_pool_delete(RT_POOL *pool)
+{
+	return -ENOSYS;
+}
+
+int rt_pool_submit(RT_POOL *pool, RT_POOL_WORK *work)
+{
+	return -ENOSYS;
+}
+
+#endif /* !CONFIG_XENO_FASTSYNCH */
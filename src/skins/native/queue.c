@@ -122,6 +122,12 @@ int rt_queue_free(RT_QUEUE *q, void *buf)
 	return XENOMAI_SKINCALL2(__native_muxid, __native_queue_free, q, buf);
 }
 
+int rt_queue_free_batch(RT_QUEUE *q, RT_QUEUE_MSGV *msgv, int nmsg)
+{
+	return XENOMAI_SKINCALL3(__native_muxid, __native_queue_free_batch,
+				 q, msgv, nmsg);
+}
+
 int rt_queue_send(RT_QUEUE *q, void *buf, size_t size, int mode)
 {
 	int err, oldtype;
@@ -180,6 +186,38 @@ ssize_t rt_queue_receive_until(RT_QUEUE *q, void **bufp, RTIME timeout)
 	return err;
 }
 
+int rt_queue_receive_batch(RT_QUEUE *q, RT_QUEUE_MSGV *msgv, int nmsg,
+			   RTIME timeout)
+{
+	int err, oldtype;
+
+	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
+
+	err = XENOMAI_SKINCALL5(__native_muxid,
+				 __native_queue_receive_batch, q, msgv, nmsg,
+				 XN_RELATIVE, &timeout);
+
+	pthread_setcanceltype(oldtype, NULL);
+
+	return err;
+}
+
+int rt_queue_receive_batch_until(RT_QUEUE *q, RT_QUEUE_MSGV *msgv, int nmsg,
+				 RTIME timeout)
+{
+	int err, oldtype;
+
+	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
+
+	err = XENOMAI_SKINCALL5(__native_muxid,
+				 __native_queue_receive_batch, q, msgv, nmsg,
+				 XN_REALTIME, &timeout);
+
+	pthread_setcanceltype(oldtype, NULL);
+
+	return err;
+}
+
 ssize_t rt_queue_read(RT_QUEUE *q, void *buf, size_t size, RTIME timeout)
 {
 	int err, oldtype;
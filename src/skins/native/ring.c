@@ -0,0 +1,250 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <native/syscall.h>
+#include <native/ring.h>
+#include "wrappers.h"
+
+extern int __native_muxid;
+
+void *xeno_map_heap(struct xnheap_desc *hd);
+
+static int __map_ring_memory(RT_RING *ring, RT_RING_PLACEHOLDER *php)
+{
+	struct xnheap_desc hd;
+
+	hd.handle = (unsigned long)php->opaque2;
+	hd.size = php->mapsize;
+	hd.area = php->area;
+	php->mapbase = xeno_map_heap(&hd);
+	if (php->mapbase == MAP_FAILED)
+		return -errno;
+
+	*ring = *php;
+
+	return 0;
+}
+
+int rt_ring_create(RT_RING *ring,
+		   const char *name, size_t slotsz, size_t nslots, int mode)
+{
+	RT_RING_PLACEHOLDER ph;
+	int err;
+
+	err = XENOMAI_SKINCALL5(__native_muxid,
+				__native_ring_create,
+				&ph, name, slotsz, nslots, mode | R_SHARED);
+	if (err)
+		return err;
+
+	err = __map_ring_memory(ring, &ph);
+
+	if (err)
+		/* If the mapping fails, make sure we don't leave a dandling
+		   ring in kernel space -- remove it. */
+		XENOMAI_SKINCALL1(__native_muxid, __native_ring_delete, &ph);
+
+	return err;
+}
+
+int rt_ring_bind(RT_RING *ring, const char *name, RTIME timeout)
+{
+	RT_RING_PLACEHOLDER ph;
+	int err;
+
+	err = XENOMAI_SKINCALL3(__native_muxid,
+				__native_ring_bind, &ph, name, &timeout);
+
+	return err ? : __map_ring_memory(ring, &ph);
+}
+
+int rt_ring_unbind(RT_RING *ring)
+{
+	int err = __real_munmap(ring->mapbase, ring->mapsize);
+
+	if (err)	/* Most likely already deleted or unbound. */
+		return -EINVAL;
+
+	ring->opaque = XN_NO_HANDLE;
+	ring->mapbase = NULL;
+	ring->mapsize = 0;
+
+	return 0;
+}
+
+int rt_ring_delete(RT_RING *ring)
+{
+	int err;
+
+	err = XENOMAI_SKINCALL1(__native_muxid, __native_ring_delete, ring);
+	if (err)
+		return err;
+
+	ring->opaque = XN_NO_HANDLE;
+	ring->mapbase = NULL;
+	ring->mapsize = 0;
+
+	return 0;
+}
+
+#ifdef CONFIG_XENO_FASTSYNCH
+
+static inline struct rt_ring_ctl *__ring_ctl(RT_RING *ring,
+					     struct rt_ring_geom *geom)
+{
+	__rt_ring_set_geom(geom, ring->slotsz, ring->nslots);
+
+	return (struct rt_ring_ctl *)(ring->mapbase + ring->ctloff);
+}
+
+/*
+ * Lockless transfers: a slot is moved without entering the kernel
+ * as long as the ring is neither full (writers) nor empty
+ * (readers). The kernel is only called for waking up a peer which
+ * went to sleep on the opposite condition.
+ */
+static ssize_t __ring_put(RT_RING *ring, const void *buf, size_t size)
+{
+	struct rt_ring_slot *slot;
+	struct rt_ring_geom geom;
+	struct rt_ring_ctl *ctl;
+	unsigned long pos;
+
+	ctl = __ring_ctl(ring, &geom);
+	if (size > geom.slotsz)
+		return -EINVAL;
+
+	/* Let the kernel sort out any failure. */
+	if (__rt_ring_reserve_put(ctl, &geom, &slot, &pos))
+		return -EWOULDBLOCK;
+
+	memcpy(__rt_ring_data(slot), buf, size);
+	__rt_ring_commit_put(ctl, slot, pos, size);
+
+	if (xnarch_atomic_get(&ctl->rwaiters))
+		XENOMAI_SKINCALL2(__native_muxid,
+				  __native_ring_wakeup, ring, R_WAKE_READERS);
+
+	return size;
+}
+
+static ssize_t __ring_get(RT_RING *ring, void *buf, size_t size)
+{
+	struct rt_ring_slot *slot;
+	struct rt_ring_geom geom;
+	struct rt_ring_ctl *ctl;
+	unsigned long pos;
+
+	ctl = __ring_ctl(ring, &geom);
+	/* Let the kernel sort out any failure. */
+	if (__rt_ring_reserve_get(ctl, &geom, &slot, &pos))
+		return -EWOULDBLOCK;
+
+	if (size > slot->size)
+		size = slot->size;
+
+	memcpy(buf, __rt_ring_data(slot), size);
+	__rt_ring_commit_get(&geom, slot, pos);
+
+	if (xnarch_atomic_get(&ctl->wwaiters))
+		XENOMAI_SKINCALL2(__native_muxid,
+				  __native_ring_wakeup, ring, R_WAKE_WRITERS);
+
+	return size;
+}
+
+#else /* !CONFIG_XENO_FASTSYNCH */
+
+#define __ring_put(ring, buf, size)	(-EWOULDBLOCK)
+#define __ring_get(ring, buf, size)	(-EWOULDBLOCK)
+
+#endif /* !CONFIG_XENO_FASTSYNCH */
+
+static ssize_t __ring_write(RT_RING *ring, const void *buf, size_t size,
+			    xntmode_t timeout_mode, RTIME timeout)
+{
+	ssize_t ret;
+	int oldtype;
+
+	ret = __ring_put(ring, buf, size);
+	if (ret != -EWOULDBLOCK)
+		return ret;
+
+	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
+
+	ret = XENOMAI_SKINCALL5(__native_muxid,
+				__native_ring_write, ring, buf, size,
+				timeout_mode, &timeout);
+
+	pthread_setcanceltype(oldtype, NULL);
+
+	return ret;
+}
+
+static ssize_t __ring_read(RT_RING *ring, void *buf, size_t size,
+			   xntmode_t timeout_mode, RTIME timeout)
+{
+	ssize_t ret;
+	int oldtype;
+
+	ret = __ring_get(ring, buf, size);
+	if (ret != -EWOULDBLOCK)
+		return ret;
+
+	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
+
+	ret = XENOMAI_SKINCALL5(__native_muxid,
+				__native_ring_read, ring, buf, size,
+				timeout_mode, &timeout);
+
+	pthread_setcanceltype(oldtype, NULL);
+
+	return ret;
+}
+
+ssize_t rt_ring_write(RT_RING *ring, const void *buf, size_t size,
+		      RTIME timeout)
+{
+	return __ring_write(ring, buf, size, XN_RELATIVE, timeout);
+}
+
+ssize_t rt_ring_write_until(RT_RING *ring, const void *buf, size_t size,
+			    RTIME timeout)
+{
+	return __ring_write(ring, buf, size, XN_REALTIME, timeout);
+}
+
+ssize_t rt_ring_read(RT_RING *ring, void *buf, size_t size, RTIME timeout)
+{
+	return __ring_read(ring, buf, size, XN_RELATIVE, timeout);
+}
+
+ssize_t rt_ring_read_until(RT_RING *ring, void *buf, size_t size,
+			   RTIME timeout)
+{
+	return __ring_read(ring, buf, size, XN_REALTIME, timeout);
+}
+
+int rt_ring_inquire(RT_RING *ring, RT_RING_INFO *info)
+{
+	return XENOMAI_SKINCALL2(__native_muxid, __native_ring_inquire, ring,
+				 info);
+}
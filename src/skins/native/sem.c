@@ -18,32 +18,92 @@
 
 #include <pthread.h>
 
+#include <nucleus/synch.h>
+#include <nucleus/thread.h>
 #include <native/syscall.h>
 #include <native/sem.h>
+#include <asm-generic/current.h>
+#include <asm-generic/sem_heap.h>
 
 extern int __native_muxid;
 
 int rt_sem_create(RT_SEM *sem, const char *name, unsigned long icount, int mode)
 {
-	return XENOMAI_SKINCALL4(__native_muxid,
-				 __native_sem_create, sem, name, icount, mode);
+	int err;
+
+	err = XENOMAI_SKINCALL4(__native_muxid,
+				__native_sem_create, sem, name, icount, mode);
+
+#ifdef CONFIG_XENO_FASTSYNCH
+	if (!err)
+		sem->fastcnt = (xnarch_atomic_t *)
+			xeno_sem_heap_addr((name && *name) ? 1 : 0,
+					   (unsigned long)sem->fastcnt);
+#endif /* CONFIG_XENO_FASTSYNCH */
+
+	return err;
 }
 
 int rt_sem_bind(RT_SEM *sem, const char *name, RTIME timeout)
 {
-	return XENOMAI_SKINCALL3(__native_muxid,
-				 __native_sem_bind, sem, name, &timeout);
+	int err;
+
+	err = XENOMAI_SKINCALL3(__native_muxid,
+				__native_sem_bind, sem, name, &timeout);
+
+#ifdef CONFIG_XENO_FASTSYNCH
+	if (!err)
+		sem->fastcnt = (xnarch_atomic_t *)
+			xeno_sem_heap_addr(1, (unsigned long)sem->fastcnt);
+#endif /* CONFIG_XENO_FASTSYNCH */
+
+	return err;
 }
 
 int rt_sem_delete(RT_SEM *sem)
 {
-	return XENOMAI_SKINCALL1(__native_muxid, __native_sem_delete, sem);
+	int err;
+
+	err = XENOMAI_SKINCALL1(__native_muxid, __native_sem_delete, sem);
+#ifdef CONFIG_XENO_FASTSYNCH
+	if (err == 0)
+		sem->fastcnt = NULL;
+#endif /* CONFIG_XENO_FASTSYNCH */
+
+	return err;
+}
+
+#ifdef CONFIG_XENO_FASTSYNCH
+/*
+ * Grab an available unit without entering the kernel, returning
+ * -EAGAIN if the syscall is required. Only primary mode shadows may
+ * do so, the others must go through the syscall, which either
+ * rejects or switches them.
+ */
+static inline int rt_sem_fast_p(RT_SEM *sem, RTIME timeout)
+{
+	if (sem->fastcnt == NULL ||
+	    xeno_get_current() == XN_NO_HANDLE ||
+	    (xeno_get_current_mode() & XNRELAX))
+		return -EAGAIN;
+
+	if (xnsynch_fast_count_down(sem->fastcnt) == 0)
+		return 0;
+
+	return timeout == TM_NONBLOCK ? -EWOULDBLOCK : -EAGAIN;
 }
+#else /* !CONFIG_XENO_FASTSYNCH */
+#define rt_sem_fast_p(sem, timeout)	(-EAGAIN)
+#endif /* !CONFIG_XENO_FASTSYNCH */
 
 int rt_sem_p(RT_SEM *sem, RTIME timeout)
 {
 	int err, oldtype;
 
+	err = rt_sem_fast_p(sem, timeout);
+	if (err != -EAGAIN)
+		return err;
+
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
 
 	err = XENOMAI_SKINCALL3(__native_muxid,
@@ -58,6 +118,10 @@ int rt_sem_p_until(RT_SEM *sem, RTIME timeout)
 {
 	int err, oldtype;
 
+	err = rt_sem_fast_p(sem, timeout);
+	if (err != -EAGAIN)
+		return err;
+
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
 
 	err = XENOMAI_SKINCALL3(__native_muxid,
@@ -70,6 +134,13 @@ int rt_sem_p_until(RT_SEM *sem, RTIME timeout)
 
 int rt_sem_v(RT_SEM *sem)
 {
+#ifdef CONFIG_XENO_FASTSYNCH
+	/* No sleeper to wake up: just bump the shared counter. */
+	if (sem->fastcnt &&
+	    xnsynch_fast_count_up(sem->fastcnt, XNSYNCH_FCNT_MASK) == 0)
+		return 0;
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 	return XENOMAI_SKINCALL1(__native_muxid, __native_sem_v, sem);
 }
 
@@ -27,6 +27,7 @@
 #include <pthread.h>
 #include <native/syscall.h>
 #include <native/task.h>
+#include <native/timer.h>
 #include <asm-generic/sigshadow.h>
 #include <asm-generic/current.h>
 #include <asm-generic/stack.h>
@@ -120,31 +121,15 @@ static void *rt_task_trampoline(void *cookie)
 	return (void *)err;
 }
 
-int rt_task_create(RT_TASK *task,
-		   const char *name, int stksize, int prio, int mode)
+static int rt_task_fork(struct rt_task_iargs *iargs, int stksize,
+			pthread_t *thid)
 {
-	struct rt_task_iargs iargs;
-	xncompletion_t completion;
 	struct sched_param param;
 	pthread_attr_t thattr;
-	pthread_t thid;
-	int err;
+	int prio = iargs->prio;
 
-	/* Migrate this thread to the Linux domain since we are about to
-	   issue a series of regular kernel syscalls in order to create
-	   the new Linux thread, which in turn will be mapped to a
-	   real-time shadow. */
-
-	XENOMAI_SYSCALL1(__xn_sys_migrate, XENOMAI_LINUX_DOMAIN);
-
-	completion.syncflag = 0;
-	completion.pid = -1;
-
-	iargs.task = task;
-	iargs.name = name;
-	iargs.prio = prio;
-	iargs.mode = mode;
-	iargs.completionp = &completion;
+	iargs->completionp->syncflag = 0;
+	iargs->completionp->pid = -1;
 
 	pthread_attr_init(&thattr);
 
@@ -159,13 +144,36 @@ int rt_task_create(RT_TASK *task,
 		pthread_attr_setschedpolicy(&thattr, SCHED_OTHER);
 	pthread_attr_setschedparam(&thattr, &param);
 	pthread_attr_setstacksize(&thattr, stksize);
-	if (!(mode & T_JOINABLE))
+	if (!(iargs->mode & T_JOINABLE))
 		pthread_attr_setdetachstate(&thattr, PTHREAD_CREATE_DETACHED);
 
-	err = __real_pthread_create(&thid, &thattr, &rt_task_trampoline, &iargs);
+	return -__real_pthread_create(thid, &thattr, &rt_task_trampoline, iargs);
+}
+
+int rt_task_create(RT_TASK *task,
+		   const char *name, int stksize, int prio, int mode)
+{
+	struct rt_task_iargs iargs;
+	xncompletion_t completion;
+	pthread_t thid;
+	int err;
+
+	/* Migrate this thread to the Linux domain since we are about to
+	   issue a series of regular kernel syscalls in order to create
+	   the new Linux thread, which in turn will be mapped to a
+	   real-time shadow. */
+
+	XENOMAI_SYSCALL1(__xn_sys_migrate, XENOMAI_LINUX_DOMAIN);
 
+	iargs.task = task;
+	iargs.name = name;
+	iargs.prio = prio;
+	iargs.mode = mode;
+	iargs.completionp = &completion;
+
+	err = rt_task_fork(&iargs, stksize, &thid);
 	if (err)
-		return -err;
+		return err;
 
 	/* Wait for sync with rt_task_trampoline() */
 	err = XENOMAI_SYSCALL1(__xn_sys_completion, &completion);
@@ -181,6 +189,63 @@ int rt_task_start(RT_TASK *task, void (*entry) (void *cookie), void *cookie)
 				 __native_task_start, task, entry, cookie);
 }
 
+int rt_task_create_batch(RT_TASK_SPEC *specv, int count)
+{
+	struct rt_task_batch_slot {
+		struct rt_task_iargs iargs;
+		xncompletion_t completion;
+		pthread_t thid;
+	} *slotv, *slot;
+	int n, err = 0;
+
+	if (count <= 0)
+		return -EINVAL;
+
+	slotv = malloc(count * sizeof(*slotv));
+	if (slotv == NULL)
+		return -ENOMEM;
+
+	XENOMAI_SYSCALL1(__xn_sys_migrate, XENOMAI_LINUX_DOMAIN);
+
+	/*
+	 * Spawn all threads first, then collect the completions, so
+	 * that the shadows are mapped concurrently instead of one
+	 * after the other.
+	 */
+	for (n = 0; n < count; n++) {
+		slot = &slotv[n];
+		slot->iargs.task = specv[n].task;
+		slot->iargs.name = specv[n].name;
+		slot->iargs.prio = specv[n].prio;
+		slot->iargs.mode = specv[n].mode;
+		slot->iargs.completionp = &slot->completion;
+		specv[n].err = rt_task_fork(&slot->iargs, specv[n].stksize,
+					    &slot->thid);
+	}
+
+	for (n = 0; n < count; n++) {
+		slot = &slotv[n];
+		if (specv[n].err == 0) {
+			specv[n].err = XENOMAI_SYSCALL1(__xn_sys_completion,
+							&slot->completion);
+			if (specv[n].err && (specv[n].mode & T_JOINABLE))
+				pthread_join(slot->thid, NULL);
+		}
+		if (specv[n].err && err == 0)
+			err = specv[n].err;
+	}
+
+	free(slotv);
+
+	return err;
+}
+
+int rt_task_start_batch(RT_TASK_SPEC *specv, int count, RTIME date)
+{
+	return XENOMAI_SKINCALL3(__native_muxid,
+				 __native_task_start_batch, specv, count, &date);
+}
+
 int rt_task_shadow(RT_TASK *task, const char *name, int prio, int mode)
 {
 	unsigned long mode_offset;
@@ -346,8 +411,40 @@ int rt_task_unblock(RT_TASK *task)
 
 int rt_task_inquire(RT_TASK *task, RT_TASK_INFO *info)
 {
-	return XENOMAI_SKINCALL2(__native_muxid, __native_task_inquire, task,
-				 info);
+	struct xnthread_user_window window;
+	RTIME exectime;
+
+	/*
+	 * Inquiring about the current task is served from its state
+	 * window, which saves a syscall.
+	 */
+	if (task || rt_task_self() == NULL ||
+	    xeno_read_current_window(&window))
+		return XENOMAI_SKINCALL2(__native_muxid,
+					 __native_task_inquire, task, info);
+	if (info == NULL)
+		return 0;
+
+	exectime = window.exectime;
+#ifdef XNARCH_HAVE_NONPRIV_TSC
+	/* Account for the time spent since the task was switched in. */
+	if (!(window.state & XNRELAX))
+		exectime += __xn_rdtsc() - window.switchdate;
+#endif /* XNARCH_HAVE_NONPRIV_TSC */
+
+	memcpy(info->name, window.name, sizeof(info->name));
+	info->bprio = window.bprio;
+	info->cprio = window.cprio;
+	info->status = window.state;
+	if (window.schedlck)
+		info->status |= T_LOCK;
+	info->relpoint = window.relpoint;
+	info->exectime = rt_timer_tsc2ns(exectime);
+	info->modeswitches = window.modeswitches;
+	info->ctxswitches = window.ctxswitches;
+	info->pagefaults = window.pagefaults;
+
+	return 0;
 }
 
 int rt_task_notify(RT_TASK *task, rt_sigset_t signals)
@@ -358,8 +455,30 @@ int rt_task_notify(RT_TASK *task, rt_sigset_t signals)
 
 int rt_task_set_mode(int clrmask, int setmask, int *oldmode)
 {
+	struct xnthread_user_window *window;
 	int err;
 
+	/*
+	 * Toggling T_LOCK alone is handled in the state window of the
+	 * current task when possible, saving the syscall. Unlocking
+	 * only stays in user-space if the window holds the sole lock;
+	 * otherwise the syscall drops both the kernel and window locks.
+	 */
+	if (oldmode == NULL && (clrmask ^ setmask) == T_LOCK) {
+		window = xeno_get_current_window();
+		if (setmask == T_LOCK) {
+			if (window &&
+			    (window->schedlck || (window->state & T_LOCK)))
+				return 0;
+			if (xeno_sched_lock() == 0)
+				return 0;
+		} else if (window && window->schedlck &&
+			   !(window->state & T_LOCK)) {
+			window->schedlck = 1;
+			return xeno_sched_unlock();
+		}
+	}
+
 	err = XENOMAI_SKINCALL3(__native_muxid,
 				__native_task_set_mode, clrmask, setmask,
 				oldmode);
@@ -389,6 +508,12 @@ int rt_task_slice(RT_TASK *task, RTIME quantum)
 				 __native_task_slice, task, &quantum);
 }
 
+int rt_task_set_edf(RT_TASK *task, RTIME runtime, RTIME period)
+{
+	return XENOMAI_SKINCALL3(__native_muxid,
+				 __native_task_set_edf, task, &runtime, &period);
+}
+
 int rt_task_join(RT_TASK *task)
 {
 	if (!task->opaque2)
@@ -0,0 +1,102 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <nucleus/synch.h>
+#include <posix/syscall.h>
+#include <asm-generic/current.h>
+#include <asm-generic/sem_heap.h>
+
+extern int __pse51_muxid;
+
+#ifdef CONFIG_XENO_FASTSYNCH
+#define PSE51_BARRIER_MAGIC (0x86861010)
+
+static inline xnarch_atomic_t *get_statep(struct __shadow_barrier *shadow)
+{
+	return (xnarch_atomic_t *)
+		xeno_sem_heap_addr(shadow->pshared, shadow->state_offset);
+}
+#endif /* CONFIG_XENO_FASTSYNCH */
+
+int __wrap_pthread_barrier_init(pthread_barrier_t *barrier,
+				const pthread_barrierattr_t *attr,
+				unsigned count)
+{
+	union __xeno_barrier *_barrier = (union __xeno_barrier *)barrier;
+	int pshared = PTHREAD_PROCESS_PRIVATE, err;
+
+	if (attr) {
+		err = pthread_barrierattr_getpshared(attr, &pshared);
+		if (err)
+			return err;
+	}
+
+	return -XENOMAI_SKINCALL3(__pse51_muxid, __pse51_barrier_init,
+				  &_barrier->shadow_barrier, count, pshared);
+}
+
+int __wrap_pthread_barrier_destroy(pthread_barrier_t *barrier)
+{
+	union __xeno_barrier *_barrier = (union __xeno_barrier *)barrier;
+
+	return -XENOMAI_SKINCALL1(__pse51_muxid, __pse51_barrier_destroy,
+				  &_barrier->shadow_barrier);
+}
+
+int __wrap_pthread_barrier_wait(pthread_barrier_t *barrier)
+{
+	union __xeno_barrier *_barrier = (union __xeno_barrier *)barrier;
+	struct __shadow_barrier *shadow = &_barrier->shadow_barrier;
+	unsigned long cycle;
+	int err;
+
+	/* Once counted in, we must be able to sleep in the nucleus. */
+	if (xeno_get_current() == XN_NO_HANDLE)
+		return EPERM;
+
+#ifdef CONFIG_XENO_FASTSYNCH
+	if (unlikely(shadow->magic != PSE51_BARRIER_MAGIC))
+		return EINVAL;
+
+	err = xnsynch_fast_barrier_arrive(get_statep(shadow),
+					  shadow->count, &cycle);
+	if (err == 0)
+		return PTHREAD_BARRIER_SERIAL_THREAD;
+
+	if (err == -EBUSY) {
+		/* Some waiters went to sleep, wake them all up at once. */
+		err = -XENOMAI_SKINCALL1(__pse51_muxid,
+					 __pse51_barrier_release, shadow);
+		return err ?: PTHREAD_BARRIER_SERIAL_THREAD;
+	}
+#else /* !CONFIG_XENO_FASTSYNCH */
+	err = XENOMAI_SKINCALL2(__pse51_muxid,
+				__pse51_barrier_arrive, shadow, &cycle);
+	if (err == 1)
+		return PTHREAD_BARRIER_SERIAL_THREAD;
+	if (err)
+		return -err;
+#endif /* !CONFIG_XENO_FASTSYNCH */
+
+	do
+		err = -XENOMAI_SKINCALL2(__pse51_muxid,
+					 __pse51_barrier_sleep, shadow, cycle);
+	while (err == EINTR);
+
+	return err;
+}
@@ -123,6 +123,19 @@ int __wrap_clock_gettime(clockid_t clock_id, struct timespec *tp)
 			tp->tv_nsec = rem;
 			return 0;
 		}
+		/* Falldown wanted, not taking the next case either. */
+	case CLOCK_REALTIME:
+		if (__pse51_sysinfo.tickval == 1 &&
+		    xnvdso_test_feature(XNVDSO_FEAT_WALLCLOCK)) {
+			unsigned long long ns;
+			unsigned long rem;
+
+			ns = xnarch_tsc_to_ns(__xn_rdtsc())
+				+ xnvdso_get_wallclock_offset();
+			tp->tv_sec = xnarch_divrem_billion(ns, &rem);
+			tp->tv_nsec = rem;
+			return 0;
+		}
 		/* Falldown wanted */
 #endif /* XNARCH_HAVE_NONPRIV_TSC */
 	default:
@@ -21,9 +21,35 @@
 #include <pthread.h>
 #include <posix/mutex.h>
 #include <posix/cb_lock.h>
+#include <asm-generic/sem_heap.h>
 
 extern int __pse51_muxid;
 
+#ifdef CONFIG_XENO_FASTSYNCH
+#define PSE51_COND_MAGIC (0x86860505)
+
+static xnarch_atomic_t *get_nwaitersp(struct __shadow_cond *shadow)
+{
+	if (likely(!shadow->attr.pshared))
+		return shadow->nwaiters;
+
+	return (xnarch_atomic_t *)
+		xeno_sem_heap_addr(1, shadow->nwaiters_offset);
+}
+
+/* Nobody can be waiting for the condition if the kernel says so, since
+   waiters are accounted for before they release the mutex. */
+static inline int cond_has_waiters(struct __shadow_cond *shadow)
+{
+	if (unlikely(shadow->magic != PSE51_COND_MAGIC))
+		return 1; /* Let the kernel sort it out. */
+
+	xnarch_memory_barrier();
+
+	return xnarch_atomic_get(get_nwaitersp(shadow)) != 0;
+}
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 int __wrap_pthread_condattr_init(pthread_condattr_t *attr)
 {
 	return -XENOMAI_SKINCALL1(__pse51_muxid, __pse51_condattr_init, attr);
@@ -69,6 +95,13 @@ int __wrap_pthread_cond_init(pthread_cond_t * cond,
 
 	err = -XENOMAI_SKINCALL2(__pse51_muxid,
 				 __pse51_cond_init, &_cond->shadow_cond, attr);
+
+#ifdef CONFIG_XENO_FASTSYNCH
+	if (!err && !_cond->shadow_cond.attr.pshared)
+		_cond->shadow_cond.nwaiters = (xnarch_atomic_t *)
+			xeno_sem_heap_addr(0, _cond->shadow_cond.nwaiters_offset);
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 	return err;
 }
 
@@ -182,6 +215,11 @@ int __wrap_pthread_cond_signal(pthread_cond_t * cond)
 {
 	union __xeno_cond *_cond = (union __xeno_cond *)cond;
 
+#ifdef CONFIG_XENO_FASTSYNCH
+	if (!cond_has_waiters(&_cond->shadow_cond))
+		return 0;
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 	return -XENOMAI_SKINCALL1(__pse51_muxid,
 				  __pse51_cond_signal, &_cond->shadow_cond);
 }
@@ -190,6 +228,11 @@ int __wrap_pthread_cond_broadcast(pthread_cond_t * cond)
 {
 	union __xeno_cond *_cond = (union __xeno_cond *)cond;
 
+#ifdef CONFIG_XENO_FASTSYNCH
+	if (!cond_has_waiters(&_cond->shadow_cond))
+		return 0;
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 	return -XENOMAI_SKINCALL1(__pse51_muxid,
 				  __pse51_cond_broadcast, &_cond->shadow_cond);
 }
@@ -23,6 +23,7 @@
 #include <posix/syscall.h>
 #include <pthread.h>
 #include <mqueue.h>
+#include <asm-generic/sem_heap.h>
 
 extern int __pse51_muxid;
 
@@ -202,3 +203,71 @@ int __wrap_mq_notify(mqd_t mqdes, const struct sigevent *notification)
 
 	return 0;
 }
+
+void *mq_alloc_np(mqd_t q)
+{
+	unsigned long offset;
+	int err, oldtype;
+
+	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
+
+	err = XENOMAI_SKINCALL2(__pse51_muxid,
+				__pse51_mq_alloc_np, q, &offset);
+
+	pthread_setcanceltype(oldtype, NULL);
+
+	if (!err)
+		return xeno_sem_heap_addr(1, offset);
+
+	errno = -err;
+	return NULL;
+}
+
+int mq_send_np(mqd_t q, void *buf, size_t len, unsigned prio)
+{
+	unsigned long offset = (unsigned long)buf - xeno_sem_heap[1];
+	int err;
+
+	err = XENOMAI_SKINCALL4(__pse51_muxid,
+				__pse51_mq_send_np, q, offset, len, prio);
+	if (!err)
+		return 0;
+
+	errno = -err;
+	return -1;
+}
+
+ssize_t mq_receive_np(mqd_t q, void **bufp, unsigned *prio)
+{
+	unsigned long offset;
+	int ret, oldtype;
+
+	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
+
+	ret = XENOMAI_SKINCALL3(__pse51_muxid,
+				__pse51_mq_receive_np, q, &offset, prio);
+
+	pthread_setcanceltype(oldtype, NULL);
+
+	if (ret >= 0) {
+		*bufp = xeno_sem_heap_addr(1, offset);
+		return ret;
+	}
+
+	errno = -ret;
+	return -1;
+}
+
+int mq_release_np(mqd_t q, void *buf)
+{
+	unsigned long offset = (unsigned long)buf - xeno_sem_heap[1];
+	int err;
+
+	err = XENOMAI_SKINCALL2(__pse51_muxid,
+				__pse51_mq_release_np, q, offset);
+	if (!err)
+		return 0;
+
+	errno = -err;
+	return -1;
+}
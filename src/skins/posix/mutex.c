@@ -36,7 +36,42 @@ static xnarch_atomic_t *get_ownerp(struct __shadow_mutex *shadow)
 	if (likely(!shadow->attr.pshared))
 		return shadow->owner;
 
-	return (xnarch_atomic_t *) (xeno_sem_heap[1] + shadow->owner_offset);
+	return (xnarch_atomic_t *) xeno_sem_heap_addr(1, shadow->owner_offset);
+}
+
+/*
+ * Priority ceiling mutexes are grabbed with the ceiling pending, the
+ * nucleus only applies it if we get switched out while holding the
+ * mutex (see xnsynch_fast_pp_acquire()).
+ */
+static inline int fast_acquire(struct __shadow_mutex *shadow,
+			       xnarch_atomic_t *ownerp, xnhandle_t cur)
+{
+	struct xnthread_user_window *window;
+
+	if (likely(shadow->attr.protocol != PTHREAD_PRIO_PROTECT))
+		return xnsynch_fast_acquire(ownerp, cur);
+
+	window = xeno_get_current_window();
+	if (window == NULL)
+		return -ENOSYS;
+
+	return xnsynch_fast_pp_acquire(ownerp, cur, &window->pp_pending);
+}
+
+static inline int fast_release(struct __shadow_mutex *shadow,
+			       xnarch_atomic_t *ownerp, xnhandle_t cur)
+{
+	struct xnthread_user_window *window;
+
+	if (likely(shadow->attr.protocol != PTHREAD_PRIO_PROTECT))
+		return xnsynch_fast_release(ownerp, cur);
+
+	window = xeno_get_current_window();
+	if (window == NULL)
+		return 0;
+
+	return xnsynch_fast_pp_release(ownerp, cur, &window->pp_pending);
 }
 #endif /* CONFIG_XENO_FASTSYNCH */
 
@@ -78,6 +113,22 @@ int __wrap_pthread_mutexattr_setprotocol(pthread_mutexattr_t *attr,
 				  __pse51_mutexattr_setprotocol, attr, proto);
 }
 
+int __wrap_pthread_mutexattr_getprioceiling(const pthread_mutexattr_t *attr,
+					    int *prioceiling)
+{
+	return -XENOMAI_SKINCALL2(__pse51_muxid,
+				  __pse51_mutexattr_getprioceiling,
+				  attr, prioceiling);
+}
+
+int __wrap_pthread_mutexattr_setprioceiling(pthread_mutexattr_t *attr,
+					    int prioceiling)
+{
+	return -XENOMAI_SKINCALL2(__pse51_muxid,
+				  __pse51_mutexattr_setprioceiling,
+				  attr, prioceiling);
+}
+
 int __wrap_pthread_mutexattr_getpshared(const pthread_mutexattr_t *attr,
 					int *pshared)
 {
@@ -91,6 +142,31 @@ int __wrap_pthread_mutexattr_setpshared(pthread_mutexattr_t *attr, int pshared)
 				  __pse51_mutexattr_setpshared, attr, pshared);
 }
 
+int pthread_mutexattr_getspin_np(const pthread_mutexattr_t *attr, int *spin)
+{
+	return -XENOMAI_SKINCALL2(__pse51_muxid,
+				  __pse51_mutexattr_getspin_np, attr, spin);
+}
+
+int pthread_mutexattr_setspin_np(pthread_mutexattr_t *attr, int spin)
+{
+	return -XENOMAI_SKINCALL2(__pse51_muxid,
+				  __pse51_mutexattr_setspin_np, attr, spin);
+}
+
+int pthread_mutexattr_getpadded_np(const pthread_mutexattr_t *attr,
+				   int *padded)
+{
+	return -XENOMAI_SKINCALL2(__pse51_muxid,
+				  __pse51_mutexattr_getpadded_np, attr, padded);
+}
+
+int pthread_mutexattr_setpadded_np(pthread_mutexattr_t *attr, int padded)
+{
+	return -XENOMAI_SKINCALL2(__pse51_muxid,
+				  __pse51_mutexattr_setpadded_np, attr, padded);
+}
+
 int __wrap_pthread_mutex_init(pthread_mutex_t *mutex,
 			      const pthread_mutexattr_t *attr)
 {
@@ -118,7 +194,7 @@ int __wrap_pthread_mutex_init(pthread_mutex_t *mutex,
 #ifdef CONFIG_XENO_FASTSYNCH
 	if (!shadow->attr.pshared)
 		shadow->owner = (xnarch_atomic_t *)
-			(xeno_sem_heap[0] + shadow->owner_offset);
+			xeno_sem_heap_addr(0, shadow->owner_offset);
 
 	cb_write_unlock(&shadow->lock, s);
 #endif /* CONFIG_XENO_FASTSYNCH */
@@ -152,7 +228,7 @@ int __wrap_pthread_mutex_lock(pthread_mutex_t *mutex)
 	unsigned long status;
 	xnhandle_t cur;
 
-	cur = xeno_get_current();
+	cur = xeno_get_current_and_mode(&status);
 	if (unlikely(cur == XN_NO_HANDLE))
 		return EPERM;
 
@@ -169,11 +245,10 @@ int __wrap_pthread_mutex_lock(pthread_mutex_t *mutex)
 	 * order to handle the auto-relax feature, so we must always
 	 * obtain them via a syscall.
 	 */
-	status = xeno_get_current_mode();
 	if (unlikely(status & (XNRELAX|XNOTHER)))
 		goto do_syscall;
 
-	err = xnsynch_fast_acquire(get_ownerp(shadow), cur);
+	err = fast_acquire(shadow, get_ownerp(shadow), cur);
 	if (likely(!err)) {
 		shadow->lockcnt = 1;
 		cb_read_unlock(&shadow->lock, s);
@@ -225,7 +300,7 @@ int __wrap_pthread_mutex_timedlock(pthread_mutex_t *mutex,
 	unsigned long status;
 	xnhandle_t cur;
 
-	cur = xeno_get_current();
+	cur = xeno_get_current_and_mode(&status);
 	if (unlikely(cur == XN_NO_HANDLE))
 		return EPERM;
 
@@ -238,11 +313,10 @@ int __wrap_pthread_mutex_timedlock(pthread_mutex_t *mutex,
 	}
 
 	/* See __wrap_pthread_mutex_lock() */
-	status = xeno_get_current_mode();
 	if (unlikely(status & (XNRELAX|XNOTHER)))
 		goto do_syscall;
 
-	err = xnsynch_fast_acquire(get_ownerp(shadow), cur);
+	err = fast_acquire(shadow, get_ownerp(shadow), cur);
 	if (likely(!err)) {
 		shadow->lockcnt = 1;
 		cb_read_unlock(&shadow->lock, s);
@@ -296,7 +370,7 @@ int __wrap_pthread_mutex_trylock(pthread_mutex_t *mutex)
 	unsigned long status;
 	xnhandle_t cur;
 
-	cur = xeno_get_current();
+	cur = xeno_get_current_and_mode(&status);
 	if (unlikely(cur == XN_NO_HANDLE))
 		return EPERM;
 
@@ -308,7 +382,6 @@ int __wrap_pthread_mutex_trylock(pthread_mutex_t *mutex)
 		goto out;
 	}
 
-	status = xeno_get_current_mode();
 	if (unlikely(status & XNOTHER))
 		goto do_syscall;
 
@@ -322,7 +395,7 @@ int __wrap_pthread_mutex_trylock(pthread_mutex_t *mutex)
 			goto out;
 	}
 
-	err = xnsynch_fast_acquire(get_ownerp(shadow), cur);
+	err = fast_acquire(shadow, get_ownerp(shadow), cur);
 
 	if (likely(!err)) {
 		shadow->lockcnt = 1;
@@ -330,6 +403,9 @@ int __wrap_pthread_mutex_trylock(pthread_mutex_t *mutex)
 		return 0;
 	}
 
+	if (err == -ENOSYS)
+		goto do_syscall;
+
 	if (err == -EBUSY && shadow->attr.type == PTHREAD_MUTEX_RECURSIVE) {
 		if (shadow->lockcnt == UINT_MAX)
 			err = -EAGAIN;
@@ -378,7 +454,7 @@ int __wrap_pthread_mutex_unlock(pthread_mutex_t *mutex)
 	unsigned long status;
 	xnhandle_t cur;
 
-	cur = xeno_get_current();
+	cur = xeno_get_current_and_mode(&status);
 	if (cur == XN_NO_HANDLE)
 		return EPERM;
 
@@ -390,7 +466,6 @@ int __wrap_pthread_mutex_unlock(pthread_mutex_t *mutex)
 		goto out_err;
 	}
 
-	status = xeno_get_current_mode();
 	if (unlikely(status & XNOTHER))
 		goto do_syscall;
 
@@ -405,7 +480,7 @@ int __wrap_pthread_mutex_unlock(pthread_mutex_t *mutex)
 		goto out;
 	}
 
-	if (likely(xnsynch_fast_release(ownerp, cur))) {
+	if (likely(fast_release(shadow, ownerp, cur))) {
 	  out:
 		cb_read_unlock(&shadow->lock, s);
 		return 0;
@@ -2,6 +2,7 @@
 #include <pthread.h>
 #include <posix/syscall.h>
 #include <sys/select.h>
+#include <sys/epoll.h>
 
 extern int __pse51_muxid;
 
@@ -29,3 +30,35 @@ int __wrap_select (int __nfds, fd_set *__restrict __readfds,
 	errno = -err;
 	return -1;
 }
+
+int epoll_ctl_np(int op, int fd, struct epoll_event *event)
+{
+	int err;
+
+	err = -XENOMAI_SKINCALL3(__pse51_muxid, __pse51_epoll_ctl_np,
+				 op, fd, event);
+	if (!err)
+		return 0;
+
+	errno = err;
+	return -1;
+}
+
+int epoll_wait_np(struct epoll_event *events, int maxevents,
+		  const struct timespec *timeout)
+{
+	int err, oldtype;
+
+	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
+
+	err = XENOMAI_SKINCALL3(__pse51_muxid, __pse51_epoll_wait_np,
+				events, maxevents, timeout);
+
+	pthread_setcanceltype(oldtype, NULL);
+
+	if (err >= 0)
+		return err;
+
+	errno = -err;
+	return -1;
+}
@@ -21,11 +21,50 @@
 #include <errno.h>
 #include <fcntl.h>		/* For O_CREAT. */
 #include <pthread.h>		/* For pthread_setcanceltype. */
+#include <nucleus/synch.h>
+#include <nucleus/thread.h>
 #include <posix/syscall.h>
 #include <semaphore.h>
+#include <asm-generic/current.h>
+#include <asm-generic/sem_heap.h>
 
 extern int __pse51_muxid;
 
+#ifdef CONFIG_XENO_FASTSYNCH
+#define PSE51_SEM_MAGIC (0x86860606)
+#define PSE51_NAMED_SEM_MAGIC (0x86860C0C)
+
+static xnarch_atomic_t *get_fastcnt(struct __shadow_sem *shadow)
+{
+	if (unlikely(shadow->magic != PSE51_SEM_MAGIC
+		     && shadow->magic != PSE51_NAMED_SEM_MAGIC))
+		return NULL;
+
+	return (xnarch_atomic_t *)
+		xeno_sem_heap_addr(shadow->pshared ? 1 : 0, shadow->value_offset);
+}
+
+/*
+ * Only real-time shadows running in primary mode may grab a unit
+ * without a syscall; other callers must go through the kernel, which
+ * handles the mode switch.
+ */
+static int sem_fast_wait_p(struct __shadow_sem *shadow)
+{
+	xnarch_atomic_t *fastcnt;
+
+	if (xeno_get_current() == XN_NO_HANDLE
+	    || (xeno_get_current_mode() & XNRELAX))
+		return -EAGAIN;
+
+	fastcnt = get_fastcnt(shadow);
+	if (unlikely(fastcnt == NULL))
+		return -EAGAIN;
+
+	return xnsynch_fast_count_down(fastcnt);
+}
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 int __wrap_sem_init(sem_t * sem, int pshared, unsigned value)
 {
 	union __xeno_sem *_sem = (union __xeno_sem *)sem;
@@ -62,6 +101,22 @@ int __wrap_sem_post(sem_t * sem)
 	union __xeno_sem *_sem = (union __xeno_sem *)sem;
 	int err;
 
+#ifdef CONFIG_XENO_FASTSYNCH
+	xnarch_atomic_t *fastcnt = get_fastcnt(&_sem->shadow_sem);
+
+	if (likely(fastcnt != NULL)) {
+		err = xnsynch_fast_count_up(fastcnt, SEM_VALUE_MAX);
+		if (likely(!err))
+			return 0;
+
+		if (err == -EOVERFLOW) {
+			errno = EAGAIN;
+			return -1;
+		}
+		/* -EBUSY: some thread is waiting, wake it up. */
+	}
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 	err = -XENOMAI_SKINCALL1(__pse51_muxid,
 				 __pse51_sem_post, &_sem->shadow_sem);
 	if (!err)
@@ -77,6 +132,14 @@ int __wrap_sem_wait(sem_t * sem)
 	union __xeno_sem *_sem = (union __xeno_sem *)sem;
 	int err, oldtype;
 
+#ifdef CONFIG_XENO_FASTSYNCH
+	/* sem_wait() is a cancellation point, even when not blocking. */
+	pthread_testcancel();
+
+	if (sem_fast_wait_p(&_sem->shadow_sem) == 0)
+		return 0;
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
 
 	err = -XENOMAI_SKINCALL1(__pse51_muxid,
@@ -97,6 +160,14 @@ int __wrap_sem_timedwait(sem_t * sem, const struct timespec *ts)
 	union __xeno_sem *_sem = (union __xeno_sem *)sem;
 	int err, oldtype;
 
+#ifdef CONFIG_XENO_FASTSYNCH
+	pthread_testcancel();
+
+	/* No need to validate the timeout if we do not block. */
+	if (sem_fast_wait_p(&_sem->shadow_sem) == 0)
+		return 0;
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
 
 	err = -XENOMAI_SKINCALL2(__pse51_muxid,
@@ -117,6 +188,11 @@ int __wrap_sem_trywait(sem_t * sem)
 	union __xeno_sem *_sem = (union __xeno_sem *)sem;
 	int err;
 
+#ifdef CONFIG_XENO_FASTSYNCH
+	if (sem_fast_wait_p(&_sem->shadow_sem) == 0)
+		return 0;
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 	err = -XENOMAI_SKINCALL1(__pse51_muxid,
 				 __pse51_sem_trywait, &_sem->shadow_sem);
 	if (!err)
@@ -257,3 +257,16 @@ int __wrap_munmap(void *addr, size_t len)
 	errno = err;
 	return -1;
 }
+
+int shm_physaddr_np(void *addr, size_t len, unsigned long long *physp)
+{
+	int err;
+
+	err = -XENOMAI_SKINCALL3(__pse51_muxid,
+				 __pse51_shm_physaddr_np, addr, len, physp);
+	if (!err)
+		return 0;
+
+	errno = err;
+	return -1;
+}
@@ -0,0 +1,180 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <nucleus/synch.h>
+#include <posix/syscall.h>
+#include <asm-generic/current.h>
+#include <asm-generic/sem_heap.h>
+
+extern int __pse51_muxid;
+
+#ifdef CONFIG_XENO_FASTSYNCH
+
+/*
+ * The lock state lives in the semaphore heap, so that locking and
+ * unlocking never leave user-space, and never cause a switch to
+ * secondary mode. Waiters busy-wait: these locks only make sense for
+ * short sections shared between threads running on distinct CPUs.
+ */
+static inline struct pse51_spin_state *get_state(pthread_spinlock_t *lock)
+{
+	unsigned cookie = *(volatile unsigned *)lock;
+
+	if (unlikely(cookie == PSE51_SPIN_INVALID))
+		return NULL;
+
+	return (struct pse51_spin_state *)
+		xeno_sem_heap_addr(cookie & PSE51_SPIN_SHARED,
+				   cookie & ~PSE51_SPIN_SHARED);
+}
+
+int __wrap_pthread_spin_init(pthread_spinlock_t *lock, int pshared)
+{
+	return -XENOMAI_SKINCALL2(__pse51_muxid,
+				  __pse51_spin_init, lock, pshared);
+}
+
+int __wrap_pthread_spin_destroy(pthread_spinlock_t *lock)
+{
+	return -XENOMAI_SKINCALL1(__pse51_muxid, __pse51_spin_destroy, lock);
+}
+
+int __wrap_pthread_spin_lock(pthread_spinlock_t *lock)
+{
+	xnhandle_t cur = xeno_get_current(), owner;
+	struct pse51_spin_state *state;
+	int contended = 0;
+
+	if (cur == XN_NO_HANDLE)
+		return EPERM;
+
+	state = get_state(lock);
+	if (state == NULL)
+		return EINVAL;
+
+	for (;;) {
+		owner = xnarch_atomic_cmpxchg(&state->owner, XN_NO_HANDLE, cur);
+		if (likely(owner == XN_NO_HANDLE))
+			break;
+
+		if (owner == cur)
+			return EDEADLK;
+
+		contended = 1;
+		do
+			cpu_relax();
+		while (xnarch_atomic_get(&state->owner) != XN_NO_HANDLE);
+	}
+
+	/* Statistics are updated under the lock. */
+	state->acquired++;
+	state->contended += contended;
+
+	return 0;
+}
+
+int __wrap_pthread_spin_trylock(pthread_spinlock_t *lock)
+{
+	xnhandle_t cur = xeno_get_current();
+	struct pse51_spin_state *state;
+
+	if (cur == XN_NO_HANDLE)
+		return EPERM;
+
+	state = get_state(lock);
+	if (state == NULL)
+		return EINVAL;
+
+	if (xnarch_atomic_cmpxchg(&state->owner, XN_NO_HANDLE, cur)
+	    != XN_NO_HANDLE)
+		return EBUSY;
+
+	state->acquired++;
+
+	return 0;
+}
+
+int __wrap_pthread_spin_unlock(pthread_spinlock_t *lock)
+{
+	xnhandle_t cur = xeno_get_current();
+	struct pse51_spin_state *state;
+
+	state = get_state(lock);
+	if (state == NULL)
+		return EINVAL;
+
+	if (cur == XN_NO_HANDLE || xnarch_atomic_get(&state->owner) != cur)
+		return EPERM;
+
+	xnarch_memory_barrier();
+	xnarch_atomic_set(&state->owner, XN_NO_HANDLE);
+
+	return 0;
+}
+
+int pthread_spin_getstats_np(pthread_spinlock_t *lock,
+			     unsigned long *acquired,
+			     unsigned long *contended)
+{
+	struct pse51_spin_state *state;
+
+	state = get_state(lock);
+	if (state == NULL)
+		return EINVAL;
+
+	*acquired = state->acquired;
+	*contended = state->contended;
+
+	return 0;
+}
+
+#else /* !CONFIG_XENO_FASTSYNCH */
+
+int __wrap_pthread_spin_init(pthread_spinlock_t *lock, int pshared)
+{
+	return __real_pthread_spin_init(lock, pshared);
+}
+
+int __wrap_pthread_spin_destroy(pthread_spinlock_t *lock)
+{
+	return __real_pthread_spin_destroy(lock);
+}
+
+int __wrap_pthread_spin_lock(pthread_spinlock_t *lock)
+{
+	return __real_pthread_spin_lock(lock);
+}
+
+int __wrap_pthread_spin_trylock(pthread_spinlock_t *lock)
+{
+	return __real_pthread_spin_trylock(lock);
+}
+
+int __wrap_pthread_spin_unlock(pthread_spinlock_t *lock)
+{
+	return __real_pthread_spin_unlock(lock);
+}
+
+int pthread_spin_getstats_np(pthread_spinlock_t *lock,
+			     unsigned long *acquired,
+			     unsigned long *contended)
+{
+	return ENOSYS;
+}
+
+#endif /* !CONFIG_XENO_FASTSYNCH */
@@ -26,6 +26,8 @@
 #include <sys/types.h>
 #include <semaphore.h>
 #include <posix/syscall.h>
+#include <asm/xenomai/arith.h>
+#include <asm-generic/xenomai/timeconv.h>
 #include <asm-generic/current.h>
 #include <asm-generic/sigshadow.h>
 #include <asm-generic/stack.h>
@@ -317,6 +319,42 @@ int pthread_set_name_np(pthread_t thread, const char *name)
 				  __pse51_thread_set_name, thread, name);
 }
 
+/*
+ * Report the state of the calling thread from its state window,
+ * without issuing any syscall.
+ */
+int pthread_inquire_np(struct xnthread_info *info)
+{
+	struct xnthread_user_window window;
+	unsigned long long exectime;
+	int err;
+
+	err = xeno_read_current_window(&window);
+	if (err)
+		return -err;
+
+	exectime = window.exectime;
+#ifdef XNARCH_HAVE_NONPRIV_TSC
+	/* Account for the time spent since the thread was switched in. */
+	if (!(window.state & XNRELAX))
+		exectime += __xn_rdtsc() - window.switchdate;
+#endif /* XNARCH_HAVE_NONPRIV_TSC */
+
+	info->state = window.state;
+	info->bprio = window.bprio;
+	info->cprio = window.cprio;
+	info->cpu = window.cpu;
+	info->affinity = 1UL << window.cpu;
+	info->relpoint = window.relpoint;
+	info->exectime = xnarch_tsc_to_ns(exectime);
+	info->modeswitches = window.modeswitches;
+	info->ctxswitches = window.ctxswitches;
+	info->pagefaults = window.pagefaults;
+	memcpy(info->name, window.name, sizeof(info->name));
+
+	return 0;
+}
+
 int sched_setconfig_np(int cpu, int policy,
 		       union sched_config *config, size_t len)
 {
@@ -17,7 +17,13 @@
  */
 
 #include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/select.h>
 #include <posix/syscall.h>
+#include <posix/timer_evq.h>
+#include <asm-generic/sem_heap.h>
 #include <time.h>
 
 extern int __pse51_muxid;
@@ -26,11 +32,14 @@ int __wrap_timer_create(clockid_t clockid,
 			const struct sigevent *__restrict__ evp,
 			timer_t * __restrict__ timerid)
 {
-	int err = -XENOMAI_SKINCALL3(__pse51_muxid,
-				     __pse51_timer_create,
-				     clockid,
-				     evp,
-				     timerid);
+	int err;
+
+	/* The kernel only fills the bytes of its own timer_t, clear the rest so
+	   that identifiers compare equal to the ones of timer events. */
+	*timerid = (timer_t)0;
+
+	err = -XENOMAI_SKINCALL3(__pse51_muxid,
+				 __pse51_timer_create, clockid, evp, timerid);
 
 	if (!err)
 		return 0;
@@ -102,3 +111,84 @@ int __wrap_timer_getoverrun(timer_t timerid)
 
 	return -1;
 }
+
+/* Rings of the timer event queues, indexed by descriptor. */
+static struct pse51_timer_ring *evq_rings[FD_SETSIZE];
+
+int timer_evq_create_np(unsigned nevents)
+{
+	unsigned long offset;
+	int fd, err;
+
+	fd = __real_open("/dev/null", O_RDWR, 0);
+	if (fd == -1)
+		return -1;
+
+	/* The descriptor is meant to be passed to select(). */
+	if (fd >= FD_SETSIZE) {
+		err = -EMFILE;
+		goto fail;
+	}
+
+	err = XENOMAI_SKINCALL3(__pse51_muxid,
+				__pse51_timer_evq_create_np,
+				fd, nevents, &offset);
+	if (err)
+		goto fail;
+
+	evq_rings[fd] = xeno_sem_heap_addr(1, offset);
+
+	return fd;
+
+  fail:
+	__real_close(fd);
+	errno = -err;
+	return -1;
+}
+
+int timer_evq_wait_np(int evq,
+		      struct timer_event_np *ev,
+		      const struct timespec *abstime)
+{
+	int err, oldtype;
+#ifdef CONFIG_XENO_FASTSYNCH
+	unsigned long timerid, overruns;
+	struct pse51_timer_ring *ring;
+
+	if ((unsigned)evq < FD_SETSIZE && (ring = evq_rings[evq]) &&
+	    pse51_timer_ring_pop(ring, ring->size - 1, &timerid, &overruns)) {
+		ev->timerid = (timer_t)timerid;
+		ev->overruns = overruns;
+		return 0;
+	}
+#endif /* CONFIG_XENO_FASTSYNCH */
+
+	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
+
+	err = XENOMAI_SKINCALL3(__pse51_muxid,
+				__pse51_timer_evq_wait_np, evq, ev, abstime);
+
+	pthread_setcanceltype(oldtype, NULL);
+
+	if (!err)
+		return 0;
+
+	errno = -err;
+	return -1;
+}
+
+int timer_evq_destroy_np(int evq)
+{
+	int err;
+
+	err = XENOMAI_SKINCALL1(__pse51_muxid,
+				__pse51_timer_evq_destroy_np, evq);
+	if (err) {
+		errno = -err;
+		return -1;
+	}
+
+	evq_rings[evq] = NULL;
+
+	return __real_close(evq);
+}
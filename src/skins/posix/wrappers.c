@@ -77,6 +77,37 @@ int __real_pthread_kill(pthread_t tid, int sig)
 	return pthread_kill(tid, sig);
 }
 
+/* spinlocks */
+__attribute__ ((weak))
+int __real_pthread_spin_init(pthread_spinlock_t *lock, int pshared)
+{
+	return pthread_spin_init(lock, pshared);
+}
+
+__attribute__ ((weak))
+int __real_pthread_spin_destroy(pthread_spinlock_t *lock)
+{
+	return pthread_spin_destroy(lock);
+}
+
+__attribute__ ((weak))
+int __real_pthread_spin_lock(pthread_spinlock_t *lock)
+{
+	return pthread_spin_lock(lock);
+}
+
+__attribute__ ((weak))
+int __real_pthread_spin_trylock(pthread_spinlock_t *lock)
+{
+	return pthread_spin_trylock(lock);
+}
+
+__attribute__ ((weak))
+int __real_pthread_spin_unlock(pthread_spinlock_t *lock)
+{
+	return pthread_spin_unlock(lock);
+}
+
 /* semaphores */
 __attribute__ ((weak))
 int __real_sem_init(sem_t * sem, int pshared, unsigned value)
@@ -61,6 +61,34 @@ int rt_dev_ioctl(int fd, int request, ...)
 				 __rtdm_ioctl, fd, request, arg);
 }
 
+int rt_dev_ioctlv(int fd, struct rtdm_ioctl_vec *vec, unsigned int vlen)
+{
+	unsigned int done = 0;
+	int ret;
+
+	for (;;) {
+		ret = XENOMAI_SKINCALL3(__rtdm_muxid, __rtdm_ioctlv,
+					fd, vec + done, vlen - done);
+		if (ret < 0) {
+			if (done == 0)
+				return ret;
+			vec[done].result = ret;
+			break;
+		}
+
+		done += ret;
+		/*
+		 * A request asking for the opposite mode stops the
+		 * vector. Resubmitting from there lets the nucleus
+		 * switch modes before retrying it.
+		 */
+		if (done >= vlen || vec[done].result != -ENOSYS)
+			break;
+	}
+
+	return done;
+}
+
 ssize_t rt_dev_read(int fd, void *buf, size_t nbyte)
 {
 	return XENOMAI_SKINCALL3(__rtdm_muxid,
@@ -85,6 +113,34 @@ ssize_t rt_dev_sendmsg(int fd, const struct msghdr *msg, int flags)
 				 __rtdm_sendmsg, fd, msg, flags);
 }
 
+int rt_dev_recvmmsg(int fd, struct rtdm_mmsghdr *msgvec, unsigned int vlen,
+		    int flags)
+{
+	return XENOMAI_SKINCALL4(__rtdm_muxid,
+				 __rtdm_recvmmsg, fd, msgvec, vlen, flags);
+}
+
+int rt_dev_sendmmsg(int fd, struct rtdm_mmsghdr *msgvec, unsigned int vlen,
+		    int flags)
+{
+	return XENOMAI_SKINCALL4(__rtdm_muxid,
+				 __rtdm_sendmmsg, fd, msgvec, vlen, flags);
+}
+
+int rt_dev_aio_setup(int fd, struct rtdm_aio_params *params)
+{
+	return XENOMAI_SKINCALL2(__rtdm_muxid,
+				 __rtdm_aio_setup, fd, params);
+}
+
+int rt_dev_aio_enter(int fd, unsigned int to_submit,
+		     unsigned int min_complete, nanosecs_rel_t timeout)
+{
+	return XENOMAI_SKINCALL4(__rtdm_muxid,
+				 __rtdm_aio_enter, fd, to_submit,
+				 min_complete, &timeout);
+}
+
 ssize_t rt_dev_recvfrom(int fd, void *buf, size_t len, int flags,
 			struct sockaddr *from,
 			socklen_t *fromlen)
@@ -428,13 +428,16 @@ STATUS taskPriorityGet(TASK_ID task_id, int *pprio)
 
 STATUS taskLock(void)
 {
-	XENOMAI_SKINCALL0(__vxworks_muxid, __vxworks_task_lock);
+	if (xeno_sched_lock())
+		XENOMAI_SKINCALL0(__vxworks_muxid, __vxworks_task_lock);
 	return OK;
 }
 
 STATUS taskUnlock(void)
 {
-	XENOMAI_SKINCALL0(__vxworks_muxid, __vxworks_task_unlock);
+	/* Drop the window lock first, nesting on the kernel one. */
+	if (xeno_sched_unlock() == -EPERM)
+		XENOMAI_SKINCALL0(__vxworks_muxid, __vxworks_task_unlock);
 	return OK;
 }
 
@@ -0,0 +1,327 @@
+/*
+ * Heap benchmark: allocation and release costs, and memory
+ * efficiency of the nucleus heap allocators under a mixed workload,
+ * i.e. a working set of blocks which sizes are spread over a range,
+ * randomly allocated and released. The same sequence of requests is
+ * replayed on a heap managed by each allocator.
+ *
+ * Released under the terms of GPLv2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <getopt.h>
+#include <sys/mman.h>
+
+#include <native/task.h>
+#include <native/timer.h>
+#include <native/heap.h>
+
+struct allocator {
+	const char *name;
+	int mode;
+};
+
+static const struct allocator allocators[] = {
+	{ .name = "default", .mode = 0 },
+	{ .name = "tlsf", .mode = H_TLSF },
+	{ .name = NULL }
+};
+
+struct op {
+	int slot;		/* Working set slot. */
+	size_t size;		/* Zero for a release. */
+};
+
+struct result {
+	unsigned long allocs, frees, failures;
+	unsigned long long alloc_sum, free_sum;	/* ns */
+	unsigned long alloc_max, free_max;	/* ns */
+	unsigned long *alloc_lat, *free_lat;	/* ns, per op. */
+	double efficiency;	/* Requested / used memory, %. */
+};
+
+static size_t heapsize = 4096 * 1024;
+static unsigned long nr_ops = 200000;
+static int wset = 256;
+static size_t min_size = 1, max_size = 65536;
+static unsigned int seed = 1;
+static int prio = 50;
+static const char *alloc_list;	/* Comma-separated, all if NULL. */
+
+static struct op *ops;
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: heapbench [options]\n"
+		"  -s <kbytes>   heap size (default 4096)\n"
+		"  -n <ops>      number of requests (default 200000)\n"
+		"  -w <blocks>   working set size (default 256)\n"
+		"  -m <bytes>    smallest block (default 1)\n"
+		"  -M <bytes>    largest block (default 65536)\n"
+		"  -a <list>     allocators to run, among default,tlsf\n"
+		"  -S <seed>     random seed (default 1)\n"
+		"  -p <prio>     priority (default 50)\n");
+}
+
+/*
+ * Block sizes are log-uniformly distributed, so that every power of
+ * two in the range is requested as often, with the odd sizes in
+ * between which the default allocator rounds up.
+ */
+static size_t random_size(void)
+{
+	double lo = log(min_size), hi = log(max_size + 1);
+
+	return (size_t)exp(lo + (hi - lo) * (rand() / (RAND_MAX + 1.0)));
+}
+
+/*
+ * Build the request sequence once, so that both allocators see the
+ * same one. The working set hovers around its half-size target, so
+ * that allocations and releases interleave at all occupancy levels.
+ */
+static void build_ops(char *live)
+{
+	unsigned long n;
+	int nlive = 0, slot;
+
+	for (n = 0; n < nr_ops; n++) {
+		if (nlive == 0 ||
+		    (nlive < wset && rand() % wset >= nlive / 2)) {
+			do
+				slot = rand() % wset;
+			while (live[slot]);
+			live[slot] = 1;
+			nlive++;
+			ops[n].slot = slot;
+			ops[n].size = random_size();
+		} else {
+			do
+				slot = rand() % wset;
+			while (!live[slot]);
+			live[slot] = 0;
+			nlive--;
+			ops[n].slot = slot;
+			ops[n].size = 0;
+		}
+	}
+}
+
+static int cmp_ulong(const void *a, const void *b)
+{
+	unsigned long x = *(const unsigned long *)a;
+	unsigned long y = *(const unsigned long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static unsigned long percentile(unsigned long *v, unsigned long n, double p)
+{
+	if (n == 0)
+		return 0;
+
+	qsort(v, n, sizeof(*v), cmp_ulong);
+
+	return v[(unsigned long)((n - 1) * p / 100.0)];
+}
+
+static int run(const struct allocator *a, struct result *r)
+{
+	unsigned long n, ns, samples = 0;
+	size_t *sizes, requested = 0;
+	double eff_sum = 0;
+	RT_HEAP_INFO info;
+	RTIME start;
+	RT_HEAP heap;
+	void **blocks;
+	int err;
+
+	blocks = calloc(wset, sizeof(*blocks));
+	sizes = calloc(wset, sizeof(*sizes));
+	if (blocks == NULL || sizes == NULL)
+		return -ENOMEM;
+
+	err = rt_heap_create(&heap, NULL, heapsize, H_PRIO | a->mode);
+	if (err) {
+		fprintf(stderr, "heapbench: rt_heap_create(%s): %s\n",
+			a->name, strerror(-err));
+		goto out;
+	}
+
+	r->allocs = r->frees = r->failures = 0;
+	r->alloc_sum = r->free_sum = 0;
+	r->alloc_max = r->free_max = 0;
+
+	for (n = 0; n < nr_ops; n++) {
+		struct op *op = &ops[n];
+
+		if (op->size) {
+			start = rt_timer_tsc();
+			err = rt_heap_alloc(&heap, op->size, TM_NONBLOCK,
+					    &blocks[op->slot]);
+			ns = rt_timer_tsc2ns(rt_timer_tsc() - start);
+			if (err) {
+				blocks[op->slot] = NULL;
+				r->failures++;
+				continue;
+			}
+			sizes[op->slot] = op->size;
+			requested += op->size;
+			r->alloc_lat[r->allocs++] = ns;
+			r->alloc_sum += ns;
+			if (ns > r->alloc_max)
+				r->alloc_max = ns;
+		} else {
+			if (blocks[op->slot] == NULL)
+				continue; /* Allocation failed. */
+			start = rt_timer_tsc();
+			err = rt_heap_free(&heap, blocks[op->slot]);
+			ns = rt_timer_tsc2ns(rt_timer_tsc() - start);
+			if (err) {
+				fprintf(stderr, "heapbench: rt_heap_free(%s): %s\n",
+					a->name, strerror(-err));
+				goto delete;
+			}
+			blocks[op->slot] = NULL;
+			requested -= sizes[op->slot];
+			r->free_lat[r->frees++] = ns;
+			r->free_sum += ns;
+			if (ns > r->free_max)
+				r->free_max = ns;
+		}
+
+		if ((n & 1023) == 0 &&
+		    rt_heap_inquire(&heap, &info) == 0 && info.usedmem) {
+			eff_sum += 100.0 * requested / info.usedmem;
+			samples++;
+		}
+	}
+
+	r->efficiency = samples ? eff_sum / samples : 0;
+	err = 0;
+delete:
+	rt_heap_delete(&heap);
+out:
+	free(sizes);
+	free(blocks);
+
+	return err;
+}
+
+static void report(const struct allocator *a, struct result *r)
+{
+	printf("%-8s %8lu %6lu %7llu %7lu %7lu %7llu %7lu %7lu %5.1f%%\n",
+	       a->name, r->allocs, r->failures,
+	       r->allocs ? r->alloc_sum / r->allocs : 0,
+	       percentile(r->alloc_lat, r->allocs, 99.9), r->alloc_max,
+	       r->frees ? r->free_sum / r->frees : 0,
+	       percentile(r->free_lat, r->frees, 99.9), r->free_max,
+	       r->efficiency);
+}
+
+static int selected(const char *name)
+{
+	size_t len = strlen(name);
+	const char *p;
+
+	if (alloc_list == NULL)
+		return 1;
+
+	for (p = alloc_list; (p = strstr(p, name)) != NULL; p += len)
+		if ((p == alloc_list || p[-1] == ',') &&
+		    (p[len] == '\0' || p[len] == ','))
+			return 1;
+
+	return 0;
+}
+
+int main(int argc, char *const argv[])
+{
+	const struct allocator *a;
+	struct result r;
+	RT_TASK task;
+	char *live;
+	int c, err;
+
+	while ((c = getopt(argc, argv, "s:n:w:m:M:a:S:p:h")) != EOF)
+		switch (c) {
+		case 's':
+			heapsize = strtoul(optarg, NULL, 0) * 1024;
+			break;
+		case 'n':
+			nr_ops = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			wset = atoi(optarg);
+			break;
+		case 'm':
+			min_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'M':
+			max_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'a':
+			alloc_list = optarg;
+			break;
+		case 'S':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			prio = atoi(optarg);
+			break;
+		default:
+			usage();
+			return c == 'h' ? 0 : 2;
+		}
+
+	if (heapsize == 0 || nr_ops == 0 || wset <= 0 ||
+	    min_size == 0 || min_size > max_size) {
+		usage();
+		return 2;
+	}
+
+	ops = malloc(nr_ops * sizeof(*ops));
+	live = calloc(wset, 1);
+	r.alloc_lat = malloc(nr_ops * sizeof(*r.alloc_lat));
+	r.free_lat = malloc(nr_ops * sizeof(*r.free_lat));
+	if (ops == NULL || live == NULL ||
+	    r.alloc_lat == NULL || r.free_lat == NULL) {
+		fprintf(stderr, "heapbench: out of memory\n");
+		return 1;
+	}
+
+	srand(seed);
+	build_ops(live);
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	err = rt_task_shadow(&task, "heapbench", prio, 0);
+	if (err) {
+		fprintf(stderr, "heapbench: rt_task_shadow: %s\n",
+			strerror(-err));
+		return 1;
+	}
+
+	printf("== heap %zu Kb, %lu requests, working set %d, "
+	       "sizes %zu-%zu bytes\n",
+	       heapsize / 1024, nr_ops, wset, min_size, max_size);
+	printf("%-8s %8s %6s %7s %7s %7s %7s %7s %7s %6s\n",
+	       "ALLOC", "ALLOCS", "FAIL", "AL-AVG", "AL-99.9", "AL-MAX",
+	       "FR-AVG", "FR-99.9", "FR-MAX", "EFF");
+
+	for (a = allocators; a->name; a++) {
+		if (!selected(a->name))
+			continue;
+		err = run(a, &r);
+		if (err)
+			return 1;
+		report(a, &r);
+	}
+
+	return 0;
+}
@@ -0,0 +1,688 @@
+/*
+ * IPC benchmark: message throughput and transfer latency of the
+ * real-time messaging services, swept over message sizes and CPU
+ * placements.
+ *
+ * Released under the terms of GPLv2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include <sched.h>
+#include <getopt.h>
+#include <sys/mman.h>
+
+#include <xeno_config.h>
+#include <native/timer.h>
+#include "ipcbench.h"
+
+#ifdef HAVE_RECENT_SETAFFINITY
+#define do_sched_setaffinity(pid,len,mask) sched_setaffinity(pid,len,mask)
+#else /* !HAVE_RECENT_SETAFFINITY */
+#ifdef HAVE_OLD_SETAFFINITY
+#define do_sched_setaffinity(pid,len,mask) sched_setaffinity(pid,mask)
+#else /* !HAVE_OLD_SETAFFINITY */
+#ifndef __cpu_set_t_defined
+typedef unsigned long cpu_set_t;
+#endif
+#define do_sched_setaffinity(pid,len,mask) 0
+#ifndef CPU_ZERO
+#define	 CPU_ZERO(set)		do { *(set) = 0; } while(0)
+#define	 CPU_SET(n,set)	do { *(set) |= (1 << n); } while(0)
+#endif
+#endif /* HAVE_OLD_SETAFFINITY */
+#endif /* HAVE_RECENT_SETAFFINITY */
+
+#define MAX_CPUS	64
+
+enum placement {
+	PLACE_SAME,	/* Producer and consumer share a CPU. */
+	PLACE_SIBLING,	/* Distinct CPUs of the same package. */
+	PLACE_CROSS,	/* CPUs of distinct packages. */
+	PLACE_MAX
+};
+
+static const char *place_names[PLACE_MAX] = {
+	[PLACE_SAME] = "same",
+	[PLACE_SIBLING] = "sibling",
+	[PLACE_CROSS] = "cross",
+};
+
+static struct {
+	int online;
+	int package;
+} topo[MAX_CPUS];
+
+static int nr_cpus;
+
+static unsigned long sizes[32] = { 16, 64, 256, 1024, 4096, 16384 };
+static int nr_sizes = 6;
+
+static const char *xprt_list;	/* Comma-separated, all if NULL. */
+static int places = (1 << PLACE_MAX) - 1;
+static int nr_pairs = 1;
+static unsigned long count = 100000;
+static unsigned long warmup = 1000;
+static int depth = 64;
+static int prio = 50;
+static const char *format;	/* json, csv or text if NULL. */
+static int nr_results;
+
+static const double pct[] = { 50, 90, 99, 99.9, 99.99 };
+#define NPCT (sizeof(pct) / sizeof(pct[0]))
+
+static int read_sysfs_int(const char *fmt, int cpu, int *val)
+{
+	char path[128];
+	FILE *fp;
+	int ret;
+
+	snprintf(path, sizeof(path), fmt, cpu);
+	fp = fopen(path, "r");
+	if (fp == NULL)
+		return -errno;
+	ret = fscanf(fp, "%d", val) == 1 ? 0 : -EINVAL;
+	fclose(fp);
+
+	return ret;
+}
+
+static void read_topology(void)
+{
+	char path[64];
+	int cpu, val;
+
+	for (cpu = 0; cpu < MAX_CPUS && cpu < ipcb_max_cpus; cpu++) {
+		snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+		if (access(path, F_OK))
+			continue;
+
+		/* The boot CPU usually has no online switch. */
+		if (read_sysfs_int("/sys/devices/system/cpu/cpu%d/online",
+				   cpu, &val))
+			val = 1;
+		topo[cpu].online = val;
+
+		if (read_sysfs_int("/sys/devices/system/cpu/cpu%d/topology/"
+				   "physical_package_id", cpu, &val))
+			val = 0;
+		topo[cpu].package = val;
+
+		if (topo[cpu].online)
+			nr_cpus = cpu + 1;
+	}
+
+	/* No sysfs, assume a single CPU. */
+	if (nr_cpus == 0) {
+		topo[0].online = 1;
+		nr_cpus = 1;
+	}
+}
+
+/*
+ * Pick the CPUs of a pair for a placement, pairs are spread over the
+ * candidates in a round-robin manner. Returns -1 if the placement is
+ * not available on this machine.
+ */
+static int pick_cpus(enum placement place, int index, int *pcpu, int *ccpu)
+{
+	int cand[MAX_CPUS][2], n = 0, a, b, k;
+
+	for (a = 0; a < nr_cpus; a++) {
+		if (!topo[a].online)
+			continue;
+
+		if (place == PLACE_SAME) {
+			cand[n][0] = cand[n][1] = a;
+			n++;
+			continue;
+		}
+
+		for (k = 1; k < nr_cpus; k++) {
+			b = (a + k) % nr_cpus;
+			if (!topo[b].online)
+				continue;
+			if ((topo[a].package == topo[b].package) ==
+			    (place == PLACE_SIBLING)) {
+				cand[n][0] = a;
+				cand[n][1] = b;
+				n++;
+				break;
+			}
+		}
+	}
+
+	if (n == 0)
+		return -1;
+
+	*pcpu = cand[index % n][0];
+	*ccpu = cand[index % n][1];
+
+	return 0;
+}
+
+static int set_affinity(int cpu)
+{
+	cpu_set_t cpus;
+
+	CPU_ZERO(&cpus);
+
+	if (cpu < 0) {
+		for (cpu = 0; cpu < nr_cpus; cpu++)
+			if (topo[cpu].online)
+				CPU_SET(cpu, &cpus);
+	} else
+		CPU_SET(cpu, &cpus);
+
+	return do_sched_setaffinity(0, sizeof(cpus), &cpus);
+}
+
+static inline void record(struct ipcb_pair *pair, unsigned long long tsc,
+			  unsigned long long stamp)
+{
+	long long ns = rt_timer_tsc2ns(tsc - stamp);
+
+	pair->hdr.counts[rttst_hdr_index(ns)]++;
+	pair->hdr.total++;
+}
+
+static void producer(struct ipcb_thread *thread)
+{
+	struct ipcb_pair *pair = thread->pair;
+	const struct ipcb_transport *xprt = pair->xprt;
+	unsigned long long stamp;
+	unsigned long n;
+	int ret;
+
+	for (n = 0; n < pair->count; n++) {
+		/* Stamp once, the time spent stalled is part of the
+		   latency the message sees. */
+		stamp = rt_timer_tsc();
+		memcpy(pair->sbuf, &stamp, sizeof(stamp));
+
+		while ((ret = xprt->send(pair, pair->sbuf,
+					 pair->msgsz)) == -EAGAIN) {
+			pair->stalls++;
+			ipcb_yield();
+		}
+
+		if (ret < 0) {
+			pair->err = ret;
+			break;
+		}
+	}
+}
+
+static void consumer(struct ipcb_thread *thread)
+{
+	struct ipcb_pair *pair = thread->pair;
+	const struct ipcb_transport *xprt = pair->xprt;
+	unsigned long long stamp, now;
+	unsigned long n;
+	ssize_t ret;
+
+	for (n = 0; n < pair->count; n++) {
+		ret = xprt->recv(pair, pair->rbuf, pair->msgsz);
+		if (ret < 0) {
+			pair->err = ret;
+			break;
+		}
+
+		now = rt_timer_tsc();
+
+		if (n < warmup)
+			continue;
+
+		memcpy(&stamp, pair->rbuf, sizeof(stamp));
+		record(pair, now, stamp);
+
+		if (pair->received++ == 0)
+			pair->first = now;
+		pair->last = now;
+	}
+}
+
+void ipcb_run(struct ipcb_thread *thread)
+{
+	thread->body(thread);
+	thread->done = 1;
+}
+
+static void percentiles(struct rttst_hdr_histogram *hdr, double *val)
+{
+	unsigned long long hits = 0, rank;
+	unsigned n, i = 0;
+
+	for (n = 0; n < NPCT; n++)
+		val[n] = 0;
+
+	for (n = 0; n < RTTST_HDR_BUCKETS && i < NPCT; n++) {
+		hits += hdr->counts[n];
+		while (i < NPCT) {
+			rank = (unsigned long long)
+				ceil(pct[i] * hdr->total / 100.0);
+			if (rank == 0)
+				rank = 1;
+			if (hits < rank)
+				break;
+			val[i++] = rttst_hdr_value(n) / 1000.0;
+		}
+	}
+}
+
+static void print_header(void)
+{
+	unsigned n;
+
+	if (format == NULL) {
+		printf("%-8s %-8s %6s %5s %12s %8s",
+		       "XPRT", "PLACE", "SIZE", "PAIRS", "MSG/S", "STALLS");
+		for (n = 0; n < NPCT; n++) {
+			char label[16];
+			snprintf(label, sizeof(label), "p%g", pct[n]);
+			printf(" %9s", label);
+		}
+		printf(" %9s   (latencies in us)\n", "max");
+	} else if (strcmp(format, "json") == 0)
+		printf("{\n  \"skin\": \"%s\",\n  \"messages\": %lu,\n"
+		       "  \"depth\": %d,\n  \"results\": [\n",
+		       ipcb_skin, count, depth);
+	else {
+		printf("transport,placement,size,pairs,msgs_per_sec,stalls");
+		for (n = 0; n < NPCT; n++)
+			printf(",p%g", pct[n]);
+		printf(",max\n");
+	}
+}
+
+static void print_footer(void)
+{
+	if (format && strcmp(format, "json") == 0)
+		printf("\n  ]\n}\n");
+}
+
+static void print_result(const struct ipcb_transport *xprt,
+			 enum placement place, size_t msgsz,
+			 struct rttst_hdr_histogram *hdr, double rate,
+			 unsigned long stalls)
+{
+	double val[NPCT], max = 0;
+	unsigned n;
+
+	percentiles(hdr, val);
+
+	for (n = RTTST_HDR_BUCKETS; n > 0; n--)
+		if (hdr->counts[n - 1]) {
+			max = rttst_hdr_value(n - 1) / 1000.0;
+			break;
+		}
+
+	if (format == NULL) {
+		printf("%-8s %-8s %6zu %5d %12.0f %8lu",
+		       xprt->name, place_names[place], msgsz, nr_pairs,
+		       rate, stalls);
+		for (n = 0; n < NPCT; n++)
+			printf(" %9.3f", val[n]);
+		printf(" %9.3f\n", max);
+	} else if (strcmp(format, "json") == 0) {
+		printf("%s    { \"transport\": \"%s\", \"placement\": \"%s\", "
+		       "\"size\": %zu, \"pairs\": %d, \"msgs_per_sec\": %.0f, "
+		       "\"stalls\": %lu",
+		       nr_results ? ",\n" : "", xprt->name,
+		       place_names[place], msgsz, nr_pairs, rate, stalls);
+		for (n = 0; n < NPCT; n++)
+			printf(", \"p%g\": %.3f", pct[n], val[n]);
+		printf(", \"max\": %.3f }", max);
+	} else {
+		printf("%s,%s,%zu,%d,%.0f,%lu", xprt->name,
+		       place_names[place], msgsz, nr_pairs, rate, stalls);
+		for (n = 0; n < NPCT; n++)
+			printf(",%.3f", val[n]);
+		printf(",%.3f\n", max);
+	}
+
+	fflush(stdout);
+	nr_results++;
+}
+
+static int spawn_on(struct ipcb_thread *thread, const char *role,
+		    int index, int cpu)
+{
+	char name[32];
+	int ret;
+
+	snprintf(name, sizeof(name), "ipcb-%s%d", role, index);
+
+	/* Most skins inherit the affinity of the creating thread. */
+	if (set_affinity(cpu)) {
+		fprintf(stderr, "ipcbench: cannot run on CPU%d\n", cpu);
+		return -EINVAL;
+	}
+
+	ret = ipcb_spawn(thread, name, prio);
+	set_affinity(-1);
+
+	return ret;
+}
+
+static void run(const struct ipcb_transport *xprt, size_t msgsz,
+		enum placement place)
+{
+	unsigned long long first = ~0ULL, last = 0;
+	struct rttst_hdr_histogram *hdr;
+	unsigned long received = 0, stalls = 0;
+	struct ipcb_pair *pairs, *pair;
+	int pcpu, ccpu, i, ret = 0, nr_cons = 0, nr_prod = 0;
+	unsigned n;
+
+	pairs = calloc(nr_pairs, sizeof(*pairs));
+	hdr = calloc(1, sizeof(*hdr));
+	if (pairs == NULL || hdr == NULL) {
+		fprintf(stderr, "ipcbench: out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; i < nr_pairs; i++) {
+		pair = &pairs[i];
+		pick_cpus(place, i, &pcpu, &ccpu);
+		pair->index = i;
+		pair->xprt = xprt;
+		pair->msgsz = msgsz;
+		pair->depth = depth;
+		pair->count = count + warmup;
+		pair->producer.pair = pair;
+		pair->producer.body = producer;
+		pair->producer.cpu = pcpu;
+		pair->consumer.pair = pair;
+		pair->consumer.body = consumer;
+		pair->consumer.cpu = ccpu;
+		pair->consumer.nrt = !!(xprt->flags & IPCB_NRT_CONSUMER);
+		pair->sbuf = malloc(msgsz);
+		pair->rbuf = malloc(msgsz);
+		if (pair->sbuf == NULL || pair->rbuf == NULL) {
+			fprintf(stderr, "ipcbench: out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+		/* Fault in the buffers before going real-time. */
+		memset(pair->sbuf, 0, msgsz);
+		memset(pair->rbuf, 0, msgsz);
+
+		ret = xprt->open(pair);
+		if (ret) {
+			fprintf(stderr, "ipcbench: %s: cannot open channel: %s\n",
+				xprt->name, strerror(-ret));
+			goto cleanup;
+		}
+		pair->opened = 1;
+	}
+
+	/* Consumers first, they must be waiting for the first message. */
+	for (i = 0; i < nr_pairs; i++, nr_cons++) {
+		pair = &pairs[i];
+		ret = spawn_on(&pair->consumer, "cons", i, pair->consumer.cpu);
+		if (ret)
+			goto abort;
+	}
+
+	for (i = 0; i < nr_pairs; i++, nr_prod++) {
+		pair = &pairs[i];
+		ret = spawn_on(&pair->producer, "prod", i, pair->producer.cpu);
+		if (ret)
+			goto abort;
+	}
+
+  abort:
+	if (ret)
+		fprintf(stderr, "ipcbench: %s: cannot spawn threads: %s\n",
+			xprt->name, strerror(-ret));
+
+	for (i = 0; i < nr_cons; i++) {
+		pair = &pairs[i];
+
+		if (i < nr_prod)
+			ipcb_join(&pair->producer);
+
+		/* The consumer would wait forever for missing messages. */
+		if (i >= nr_prod || pair->err) {
+			xprt->close(pair);
+			pair->opened = 0;
+		}
+
+		ipcb_join(&pair->consumer);
+	}
+
+	if (ret)
+		goto cleanup;
+
+	for (i = 0; i < nr_pairs; i++) {
+		pair = &pairs[i];
+
+		if (pair->err) {
+			fprintf(stderr, "ipcbench: %s: pair #%d failed: %s\n",
+				xprt->name, i, strerror(-pair->err));
+			ret = pair->err;
+			continue;
+		}
+
+		for (n = 0; n < RTTST_HDR_BUCKETS; n++)
+			hdr->counts[n] += pair->hdr.counts[n];
+		hdr->total += pair->hdr.total;
+		received += pair->received;
+		stalls += pair->stalls;
+		if (pair->first < first)
+			first = pair->first;
+		if (pair->last > last)
+			last = pair->last;
+	}
+
+	if (ret == 0 && received > 1 && last > first)
+		print_result(xprt, place, msgsz, hdr,
+			     (received - 1) * 1e9 / rt_timer_tsc2ns(last - first),
+			     stalls);
+
+  cleanup:
+	for (i = 0; i < nr_pairs; i++) {
+		pair = &pairs[i];
+		if (pair->opened)
+			xprt->close(pair);
+		free(pair->chan);
+		free(pair->sbuf);
+		free(pair->rbuf);
+	}
+
+	free(pairs);
+	free(hdr);
+}
+
+static int xprt_selected(const struct ipcb_transport *xprt)
+{
+	size_t len = strlen(xprt->name);
+	const char *p = xprt_list;
+
+	if (p == NULL)
+		return 1;
+
+	while (p) {
+		if (strncmp(p, xprt->name, len) == 0 &&
+		    (p[len] == ',' || p[len] == '\0'))
+			return 1;
+		p = strchr(p, ',');
+		if (p)
+			p++;
+	}
+
+	return 0;
+}
+
+static int parse_places(const char *arg)
+{
+	const char *p = arg;
+	int mask = 0, n;
+
+	while (p && *p) {
+		for (n = 0; n < PLACE_MAX; n++) {
+			size_t len = strlen(place_names[n]);
+			if (strncmp(p, place_names[n], len) == 0 &&
+			    (p[len] == ',' || p[len] == '\0'))
+				break;
+		}
+		if (n == PLACE_MAX)
+			return -1;
+		mask |= 1 << n;
+		p = strchr(p, ',');
+		if (p)
+			p++;
+	}
+
+	return mask;
+}
+
+static void usage(void)
+{
+	const struct ipcb_transport **xprt;
+
+	fprintf(stderr,
+		"usage: ipcbench [options]\n"
+		"  -t <xprt>[,<xprt>...]   transports to measure (default: all)\n"
+		"  -s <size>[,<size>...]   message sizes in bytes "
+		"(default: 16,64,256,1024,4096,16384)\n"
+		"  -c <place>[,<place>...] CPU placements, among same, sibling "
+		"and cross (default: all)\n"
+		"  -p <pairs>              producer/consumer pairs (default: 1)\n"
+		"  -n <count>              messages per pair (default: 100000)\n"
+		"  -w <count>              warmup messages, not measured "
+		"(default: 1000)\n"
+		"  -d <depth>              channel depth in messages "
+		"(default: 64)\n"
+		"  -P <prio>               thread priority (default: 50)\n"
+		"  -O <json|csv>           machine-readable output\n"
+		"  -l                      list the transports and exit\n"
+		"transports (%s skin):", ipcb_skin);
+
+	for (xprt = ipcb_transports; *xprt; xprt++)
+		fprintf(stderr, " %s", (*xprt)->name);
+
+	fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv)
+{
+	const struct ipcb_transport **xprt;
+	char *p, *end;
+	int c, n, place;
+
+	while ((c = getopt(argc, argv, "t:s:c:p:n:w:d:P:O:lh")) != EOF)
+		switch (c) {
+		case 't':
+			xprt_list = optarg;
+			break;
+
+		case 's':
+			for (nr_sizes = 0, p = optarg;
+			     *p && nr_sizes < sizeof(sizes) / sizeof(sizes[0]);
+			     p = *end ? end + 1 : end) {
+				sizes[nr_sizes] = strtoul(p, &end, 0);
+				if (end == p || sizes[nr_sizes] < IPCB_MIN_MSGSZ) {
+					fprintf(stderr, "ipcbench: invalid size "
+						"(min. %zu bytes)\n",
+						IPCB_MIN_MSGSZ);
+					return EXIT_FAILURE;
+				}
+				nr_sizes++;
+			}
+			break;
+
+		case 'c':
+			places = parse_places(optarg);
+			if (places <= 0) {
+				usage();
+				return EXIT_FAILURE;
+			}
+			break;
+
+		case 'p':
+			nr_pairs = atoi(optarg);
+			break;
+
+		case 'n':
+			count = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'w':
+			warmup = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'd':
+			depth = atoi(optarg);
+			break;
+
+		case 'P':
+			prio = atoi(optarg);
+			break;
+
+		case 'O':
+			format = optarg;
+			if (strcmp(format, "json") && strcmp(format, "csv")) {
+				usage();
+				return EXIT_FAILURE;
+			}
+			break;
+
+		case 'l':
+			for (xprt = ipcb_transports; *xprt; xprt++)
+				printf("%s\n", (*xprt)->name);
+			return EXIT_SUCCESS;
+
+		default:
+			usage();
+			return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+	if (nr_pairs < 1 || count < 2 || depth < 1 || nr_sizes == 0) {
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	read_topology();
+
+	for (place = 0; place < PLACE_MAX; place++) {
+		int pcpu, ccpu;
+
+		if ((places & (1 << place)) &&
+		    pick_cpus(place, 0, &pcpu, &ccpu)) {
+			fprintf(stderr, "ipcbench: no CPU pair for placement %s, "
+				"skipped\n", place_names[place]);
+			places &= ~(1 << place);
+		}
+	}
+
+	print_header();
+
+	for (xprt = ipcb_transports; *xprt; xprt++) {
+		if (!xprt_selected(*xprt))
+			continue;
+
+		for (n = 0; n < nr_sizes; n++) {
+			if (sizes[n] > (*xprt)->max_msgsz) {
+				fprintf(stderr, "ipcbench: %s: skipping %lu byte "
+					"messages (max. %zu)\n", (*xprt)->name,
+					sizes[n], (*xprt)->max_msgsz);
+				continue;
+			}
+
+			for (place = 0; place < PLACE_MAX; place++)
+				if (places & (1 << place))
+					run(*xprt, sizes[n], place);
+		}
+	}
+
+	print_footer();
+
+	return EXIT_SUCCESS;
+}
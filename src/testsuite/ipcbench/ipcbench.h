@@ -0,0 +1,88 @@
+/*
+ * IPC benchmark, definitions shared by the harness and the skin glues.
+ *
+ * Released under the terms of GPLv2.
+ */
+
+#ifndef _IPCBENCH_H
+#define _IPCBENCH_H
+
+#include <sys/types.h>
+#include <rtdm/rttesting.h>
+
+/*
+ * Each pair runs a producer feeding a consumer through its own
+ * channel. The producer stamps every message with the TSC, the
+ * consumer records the transfer latency and the time it took to
+ * receive the whole batch.
+ */
+
+/* The consumer is a plain Linux thread (e.g. the /dev/rtp side). */
+#define IPCB_NRT_CONSUMER	0x1
+
+/* Smallest message, enough room for the time stamp. */
+#define IPCB_MIN_MSGSZ		sizeof(unsigned long long)
+
+struct ipcb_pair;
+
+struct ipcb_thread {
+	struct ipcb_pair *pair;
+	void (*body)(struct ipcb_thread *thread);
+	int cpu;		/* -1 for any CPU. */
+	int nrt;		/* Plain Linux thread. */
+	volatile int done;
+	void *priv;		/* Skin-specific task descriptor. */
+};
+
+struct ipcb_transport {
+	const char *name;
+	int flags;
+	size_t max_msgsz;
+	int (*open)(struct ipcb_pair *pair);
+	/* Also called to unblock the consumer if the producer failed. */
+	void (*close)(struct ipcb_pair *pair);
+	/* Returns 0, -EAGAIN if the channel is full, or -errno. */
+	int (*send)(struct ipcb_pair *pair, const void *buf, size_t len);
+	/* Returns the message size, or -errno. */
+	ssize_t (*recv)(struct ipcb_pair *pair, void *buf, size_t len);
+};
+
+struct ipcb_pair {
+	int index;
+	const struct ipcb_transport *xprt;
+	size_t msgsz;
+	int depth;		/* Messages the channel may hold. */
+	unsigned long count;	/* Messages to transfer. */
+	struct ipcb_thread producer;
+	struct ipcb_thread consumer;
+	void *chan;		/* Channel state, freed by the harness. */
+	void *sbuf, *rbuf;	/* Message buffers, msgsz bytes. */
+	int opened;
+
+	/* Results. */
+	int err;
+	unsigned long stalls;	/* Producer found the channel full. */
+	unsigned long received;
+	unsigned long long first, last;	/* TSC of the first/last receipt. */
+	struct rttst_hdr_histogram hdr;	/* Latencies, ns. */
+};
+
+/* Provided by the skin-specific glue. */
+
+extern const char *ipcb_skin;
+
+extern const int ipcb_max_cpus;	/* Highest CPU number + 1 the glue may pin to. */
+
+extern const struct ipcb_transport *ipcb_transports[];
+
+int ipcb_spawn(struct ipcb_thread *thread, const char *name, int prio);
+
+int ipcb_join(struct ipcb_thread *thread);
+
+void ipcb_yield(void);
+
+/* Provided by the harness, entry point of all threads. */
+
+void ipcb_run(struct ipcb_thread *thread);
+
+#endif /* !_IPCBENCH_H */
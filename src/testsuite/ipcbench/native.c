@@ -0,0 +1,336 @@
+/*
+ * IPC benchmark, native skin glue and transports.
+ *
+ * Released under the terms of GPLv2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <native/task.h>
+#include <native/queue.h>
+#include <native/buffer.h>
+#include <native/pipe.h>
+#include "ipcbench.h"
+
+/* Message pools hold power-of-2 blocks with a header. */
+#define POOL_SIZE(pair) \
+	((pair)->depth * 2 * ((pair)->msgsz + 64) + 4096)
+
+struct native_thread {
+	RT_TASK task;
+	pthread_t tid;
+};
+
+const char *ipcb_skin = "native";
+
+/* T_CPU() only covers CPU0-7. */
+const int ipcb_max_cpus = 8;
+
+static void rt_trampoline(void *arg)
+{
+	ipcb_run(arg);
+}
+
+static void *nrt_trampoline(void *arg)
+{
+	ipcb_run(arg);
+	return NULL;
+}
+
+int ipcb_spawn(struct ipcb_thread *thread, const char *name, int prio)
+{
+	struct native_thread *nt;
+	int mode = T_JOINABLE, ret;
+
+	nt = calloc(1, sizeof(*nt));
+	if (nt == NULL)
+		return -ENOMEM;
+
+	if (thread->nrt) {
+		/* Keep this one a plain Linux thread. */
+		ret = -__real_pthread_create(&nt->tid, NULL,
+					     nrt_trampoline, thread);
+		goto out;
+	}
+
+	if (thread->cpu >= 0)
+		mode |= T_CPU(thread->cpu);
+
+	ret = rt_task_create(&nt->task, name, 0, prio, mode);
+	if (ret)
+		goto out;
+
+	ret = rt_task_start(&nt->task, rt_trampoline, thread);
+	if (ret)
+		rt_task_delete(&nt->task);
+  out:
+	if (ret)
+		free(nt);
+	else
+		thread->priv = nt;
+
+	return ret;
+}
+
+int ipcb_join(struct ipcb_thread *thread)
+{
+	struct native_thread *nt = thread->priv;
+	int ret;
+
+	if (thread->nrt)
+		ret = -pthread_join(nt->tid, NULL);
+	else
+		ret = rt_task_join(&nt->task);
+
+	thread->priv = NULL;
+	free(nt);
+
+	return ret;
+}
+
+void ipcb_yield(void)
+{
+	rt_task_yield();
+}
+
+/* rt_queue: the queue limit bounds the backlog. */
+
+static int queue_open(struct ipcb_pair *pair)
+{
+	RT_QUEUE *q;
+
+	q = malloc(sizeof(*q));
+	if (q == NULL)
+		return -ENOMEM;
+
+	pair->chan = q;
+
+	return rt_queue_create(q, NULL, POOL_SIZE(pair), pair->depth, Q_FIFO);
+}
+
+static void queue_close(struct ipcb_pair *pair)
+{
+	rt_queue_delete(pair->chan);
+}
+
+static int queue_send(struct ipcb_pair *pair, const void *buf, size_t len)
+{
+	int ret = rt_queue_write(pair->chan, buf, len, Q_NORMAL);
+
+	if (ret == -ENOMEM)
+		return -EAGAIN;
+
+	return ret < 0 ? ret : 0;
+}
+
+static ssize_t queue_recv(struct ipcb_pair *pair, void *buf, size_t len)
+{
+	return rt_queue_read(pair->chan, buf, len, TM_INFINITE);
+}
+
+static const struct ipcb_transport queue_xprt = {
+	.name = "queue",
+	.max_msgsz = 65536,
+	.open = queue_open,
+	.close = queue_close,
+	.send = queue_send,
+	.recv = queue_recv,
+};
+
+/* rt_buffer: byte stream, writers block when it is full. */
+
+static int buffer_open(struct ipcb_pair *pair)
+{
+	RT_BUFFER *bf;
+
+	bf = malloc(sizeof(*bf));
+	if (bf == NULL)
+		return -ENOMEM;
+
+	pair->chan = bf;
+
+	return rt_buffer_create(bf, NULL, pair->depth * pair->msgsz, B_FIFO);
+}
+
+static void buffer_close(struct ipcb_pair *pair)
+{
+	rt_buffer_delete(pair->chan);
+}
+
+static int buffer_send(struct ipcb_pair *pair, const void *buf, size_t len)
+{
+	ssize_t ret = rt_buffer_write(pair->chan, buf, len, TM_INFINITE);
+
+	return ret < 0 ? ret : 0;
+}
+
+static ssize_t buffer_recv(struct ipcb_pair *pair, void *buf, size_t len)
+{
+	return rt_buffer_read(pair->chan, buf, len, TM_INFINITE);
+}
+
+static const struct ipcb_transport buffer_xprt = {
+	.name = "buffer",
+	.max_msgsz = 65536,
+	.open = buffer_open,
+	.close = buffer_close,
+	.send = buffer_send,
+	.recv = buffer_recv,
+};
+
+/* rt_pipe: real-time producer, Linux consumer reading /dev/rtp*. */
+
+struct pipe_chan {
+	RT_PIPE pipe;
+	int fd;
+};
+
+static int pipe_open(struct ipcb_pair *pair)
+{
+	struct pipe_chan *c;
+	char devname[32];
+	int minor;
+
+	c = malloc(sizeof(*c));
+	if (c == NULL)
+		return -ENOMEM;
+
+	pair->chan = c;
+
+	minor = rt_pipe_create(&c->pipe, NULL, P_MINOR_AUTO, POOL_SIZE(pair));
+	if (minor < 0)
+		return minor;
+
+	snprintf(devname, sizeof(devname), "/dev/rtp%d", minor);
+	c->fd = open(devname, O_RDONLY);
+	if (c->fd < 0) {
+		minor = -errno;
+		rt_pipe_delete(&c->pipe);
+		return minor;
+	}
+
+	return 0;
+}
+
+static void pipe_close(struct ipcb_pair *pair)
+{
+	struct pipe_chan *c = pair->chan;
+
+	/* Disconnecting the pipe wakes up the Linux reader. */
+	rt_pipe_delete(&c->pipe);
+	close(c->fd);
+}
+
+static int pipe_send(struct ipcb_pair *pair, const void *buf, size_t len)
+{
+	struct pipe_chan *c = pair->chan;
+	ssize_t ret;
+
+	ret = rt_pipe_write(&c->pipe, buf, len, P_NORMAL);
+	if (ret == -ENOMEM)
+		return -EAGAIN;
+
+	return ret < 0 ? ret : 0;
+}
+
+static ssize_t pipe_recv(struct ipcb_pair *pair, void *buf, size_t len)
+{
+	struct pipe_chan *c = pair->chan;
+	ssize_t ret;
+
+	ret = read(c->fd, buf, len);
+	if (ret == 0)
+		return -EPIPE;
+
+	return ret < 0 ? -errno : ret;
+}
+
+static const struct ipcb_transport pipe_xprt = {
+	.name = "pipe",
+	.flags = IPCB_NRT_CONSUMER,
+	.max_msgsz = 65536,
+	.open = pipe_open,
+	.close = pipe_close,
+	.send = pipe_send,
+	.recv = pipe_recv,
+};
+
+/*
+ * rt_task_send/receive/reply: synchronous, the producer waits for
+ * the empty reply of the consumer, so there is no backlog.
+ */
+
+static int task_open(struct ipcb_pair *pair)
+{
+	return 0;
+}
+
+static void task_close(struct ipcb_pair *pair)
+{
+	struct native_thread *nt = pair->consumer.priv;
+
+	/* Kick the consumer out of rt_task_receive(). */
+	if (nt)
+		rt_task_unblock(&nt->task);
+}
+
+static int task_send(struct ipcb_pair *pair, const void *buf, size_t len)
+{
+	struct native_thread *nt = pair->consumer.priv;
+	RT_TASK_MCB mcb;
+	ssize_t ret;
+
+	mcb.opcode = 0;
+	mcb.data = (caddr_t)buf;
+	mcb.size = len;
+
+	ret = rt_task_send(&nt->task, &mcb, NULL, TM_INFINITE);
+
+	return ret < 0 ? ret : 0;
+}
+
+static ssize_t task_recv(struct ipcb_pair *pair, void *buf, size_t len)
+{
+	RT_TASK_MCB mcb;
+	int flowid;
+
+	mcb.data = buf;
+	mcb.size = len;
+
+	flowid = rt_task_receive(&mcb, TM_INFINITE);
+	if (flowid < 0)
+		return flowid;
+
+	rt_task_reply(flowid, NULL);
+
+	return mcb.size;
+}
+
+static const struct ipcb_transport task_xprt = {
+	.name = "task",
+	.max_msgsz = 65536,
+	.open = task_open,
+	.close = task_close,
+	.send = task_send,
+	.recv = task_recv,
+};
+
+extern const struct ipcb_transport mq_xprt;
+extern const struct ipcb_transport iddp_xprt, xddp_xprt, bufp_xprt;
+
+const struct ipcb_transport *ipcb_transports[] = {
+	&queue_xprt,
+	&buffer_xprt,
+	&pipe_xprt,
+	&task_xprt,
+	&mq_xprt,
+	&iddp_xprt,
+	&xddp_xprt,
+	&bufp_xprt,
+	NULL
+};
@@ -0,0 +1,73 @@
+/*
+ * IPC benchmark, POSIX message queue transport.
+ *
+ * Released under the terms of GPLv2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <mqueue.h>
+
+#include "ipcbench.h"
+
+static int mq_xprt_open(struct ipcb_pair *pair)
+{
+	struct mq_attr attr;
+	char name[32];
+	mqd_t *mq;
+
+	mq = malloc(sizeof(*mq));
+	if (mq == NULL)
+		return -ENOMEM;
+
+	pair->chan = mq;
+
+	attr.mq_flags = 0;
+	attr.mq_maxmsg = pair->depth;
+	attr.mq_msgsize = pair->msgsz;
+	attr.mq_curmsgs = 0;
+
+	snprintf(name, sizeof(name), "/ipcbench-%d-%d", getpid(), pair->index);
+	*mq = mq_open(name, O_RDWR | O_CREAT | O_EXCL, 0600, &attr);
+	if (*mq == (mqd_t)-1)
+		return -errno;
+
+	/* The queue goes away with its last descriptor. */
+	mq_unlink(name);
+
+	return 0;
+}
+
+static void mq_xprt_close(struct ipcb_pair *pair)
+{
+	mq_close(*(mqd_t *)pair->chan);
+}
+
+static int mq_xprt_send(struct ipcb_pair *pair, const void *buf, size_t len)
+{
+	if (mq_send(*(mqd_t *)pair->chan, buf, len, 0))
+		return -errno;
+
+	return 0;
+}
+
+static ssize_t mq_xprt_recv(struct ipcb_pair *pair, void *buf, size_t len)
+{
+	ssize_t ret;
+
+	ret = mq_receive(*(mqd_t *)pair->chan, buf, len, NULL);
+
+	return ret < 0 ? -errno : ret;
+}
+
+const struct ipcb_transport mq_xprt = {
+	.name = "mq",
+	.max_msgsz = 65536,
+	.open = mq_xprt_open,
+	.close = mq_xprt_close,
+	.send = mq_xprt_send,
+	.recv = mq_xprt_recv,
+};
@@ -0,0 +1,113 @@
+/*
+ * IPC benchmark, pSOS+ skin glue and variable-length queue transport.
+ *
+ * Released under the terms of GPLv2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <psos+/psos.h>
+#include "ipcbench.h"
+
+const char *ipcb_skin = "psos+";
+
+/* Tasks inherit the affinity of their creator. */
+const int ipcb_max_cpus = 64;
+
+static void trampoline(u_long a0, u_long a1, u_long a2, u_long a3)
+{
+	ipcb_run((struct ipcb_thread *)a0);
+	t_delete(0);
+}
+
+int ipcb_spawn(struct ipcb_thread *thread, const char *name, int prio)
+{
+	u_long args[4] = { (u_long)thread, 0, 0, 0 }, tid, err;
+
+	if (thread->nrt)
+		return -ENOSYS;
+
+	err = t_create(name, prio, 0, 0, 0, &tid);
+	if (err)
+		return -EINVAL;
+
+	err = t_start(tid, 0, trampoline, args);
+	if (err) {
+		t_delete(tid);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int ipcb_join(struct ipcb_thread *thread)
+{
+	/* Tasks cannot be joined, the harness flags them done. */
+	while (!thread->done)
+		usleep(10000);
+
+	return 0;
+}
+
+void ipcb_yield(void)
+{
+	tm_wkafter(0);
+}
+
+static int vq_open(struct ipcb_pair *pair)
+{
+	u_long *qid;
+
+	qid = malloc(sizeof(*qid));
+	if (qid == NULL)
+		return -ENOMEM;
+
+	pair->chan = qid;
+
+	if (q_vcreate("ipcb", Q_FIFO, pair->depth, pair->msgsz, qid))
+		return -ENOMEM;
+
+	return 0;
+}
+
+static void vq_close(struct ipcb_pair *pair)
+{
+	q_vdelete(*(u_long *)pair->chan);
+}
+
+static int vq_send(struct ipcb_pair *pair, const void *buf, size_t len)
+{
+	u_long err;
+
+	err = q_vsend(*(u_long *)pair->chan, (void *)buf, len);
+	if (err == ERR_QFULL)
+		return -EAGAIN;
+
+	return err ? -EIO : 0;
+}
+
+static ssize_t vq_recv(struct ipcb_pair *pair, void *buf, size_t len)
+{
+	u_long msglen, err;
+
+	err = q_vreceive(*(u_long *)pair->chan, Q_WAIT, 0, buf, len, &msglen);
+
+	return err ? -EIO : (ssize_t)msglen;
+}
+
+static const struct ipcb_transport vq_xprt = {
+	.name = "vqueue",
+	.max_msgsz = 65536,
+	.open = vq_open,
+	.close = vq_close,
+	.send = vq_send,
+	.recv = vq_recv,
+};
+
+const struct ipcb_transport *ipcb_transports[] = {
+	&vq_xprt,
+	NULL
+};
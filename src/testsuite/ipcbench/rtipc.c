@@ -0,0 +1,208 @@
+/*
+ * IPC benchmark, RTIPC socket transports (IDDP, XDDP, BUFP).
+ *
+ * Released under the terms of GPLv2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <rtdm/rtipc.h>
+#include "ipcbench.h"
+
+struct rtipc_chan {
+	int rfd;		/* Receiving socket, or /dev/rtp* for XDDP. */
+	int sfd;		/* Sending socket. */
+};
+
+static int rtipc_socket(int proto, int level, int optname, size_t size,
+			struct sockaddr_ipc *addr)
+{
+	socklen_t addrlen = sizeof(*addr);
+	int fd, ret;
+
+	fd = socket(AF_RTIPC, SOCK_DGRAM, proto);
+	if (fd < 0)
+		return -errno;
+
+	if (setsockopt(fd, level, optname, &size, sizeof(size)))
+		goto fail;
+
+	memset(addr, 0, sizeof(*addr));
+	addr->sipc_family = AF_RTIPC;
+	addr->sipc_port = -1;
+	if (bind(fd, (struct sockaddr *)addr, sizeof(*addr)))
+		goto fail;
+
+	if (getsockname(fd, (struct sockaddr *)addr, &addrlen))
+		goto fail;
+
+	return fd;
+
+  fail:
+	ret = -errno;
+	close(fd);
+	return ret;
+}
+
+static struct rtipc_chan *rtipc_alloc(struct ipcb_pair *pair)
+{
+	struct rtipc_chan *c;
+
+	c = malloc(sizeof(*c));
+	if (c) {
+		c->rfd = c->sfd = -1;
+		pair->chan = c;
+	}
+
+	return c;
+}
+
+static void rtipc_close(struct ipcb_pair *pair)
+{
+	struct rtipc_chan *c = pair->chan;
+
+	/* Closing the real-time endpoints unblocks the consumer. */
+	if (c->sfd >= 0)
+		close(c->sfd);
+	if (c->rfd >= 0)
+		close(c->rfd);
+}
+
+/* Datagram/stream protocols: the consumer binds, the producer connects. */
+static int rtipc_open(struct ipcb_pair *pair, int proto, int level,
+		      int optname, size_t size)
+{
+	struct sockaddr_ipc addr;
+	struct rtipc_chan *c;
+	int ret;
+
+	c = rtipc_alloc(pair);
+	if (c == NULL)
+		return -ENOMEM;
+
+	c->rfd = rtipc_socket(proto, level, optname, size, &addr);
+	if (c->rfd < 0)
+		return c->rfd;
+
+	c->sfd = socket(AF_RTIPC, SOCK_DGRAM, proto);
+	if (c->sfd < 0 ||
+	    connect(c->sfd, (struct sockaddr *)&addr, sizeof(addr))) {
+		ret = -errno;
+		rtipc_close(pair);
+		return ret;
+	}
+
+	return 0;
+}
+
+static int rtipc_send(struct ipcb_pair *pair, const void *buf, size_t len)
+{
+	struct rtipc_chan *c = pair->chan;
+
+	if (send(c->sfd, buf, len, 0) < 0)
+		return errno == ENOMEM || errno == ENOBUFS ? -EAGAIN : -errno;
+
+	return 0;
+}
+
+static ssize_t rtipc_recv(struct ipcb_pair *pair, void *buf, size_t len)
+{
+	struct rtipc_chan *c = pair->chan;
+	ssize_t ret;
+
+	ret = recv(c->rfd, buf, len, 0);
+
+	return ret < 0 ? -errno : ret;
+}
+
+/* Message pools hold power-of-2 blocks with a header. */
+#define POOL_SIZE(pair) \
+	((pair)->depth * 2 * ((pair)->msgsz + 64) + 4096)
+
+static int iddp_open(struct ipcb_pair *pair)
+{
+	return rtipc_open(pair, IPCPROTO_IDDP, SOL_IDDP, IDDP_POOLSZ,
+			  POOL_SIZE(pair));
+}
+
+const struct ipcb_transport iddp_xprt = {
+	.name = "iddp",
+	.max_msgsz = 65536,
+	.open = iddp_open,
+	.close = rtipc_close,
+	.send = rtipc_send,
+	.recv = rtipc_recv,
+};
+
+static int bufp_open(struct ipcb_pair *pair)
+{
+	return rtipc_open(pair, IPCPROTO_BUFP, SOL_BUFP, BUFP_BUFSZ,
+			  pair->depth * pair->msgsz);
+}
+
+const struct ipcb_transport bufp_xprt = {
+	.name = "bufp",
+	.max_msgsz = 65536,
+	.open = bufp_open,
+	.close = rtipc_close,
+	.send = rtipc_send,
+	.recv = rtipc_recv,
+};
+
+/* XDDP: real-time producer, Linux consumer reading /dev/rtp*. */
+
+static int xddp_open(struct ipcb_pair *pair)
+{
+	struct sockaddr_ipc addr;
+	struct rtipc_chan *c;
+	char devname[32];
+	int ret;
+
+	c = rtipc_alloc(pair);
+	if (c == NULL)
+		return -ENOMEM;
+
+	/* The bound socket sends to its own port by default. */
+	c->sfd = rtipc_socket(IPCPROTO_XDDP, SOL_XDDP, XDDP_POOLSZ,
+			      POOL_SIZE(pair), &addr);
+	if (c->sfd < 0)
+		return c->sfd;
+
+	snprintf(devname, sizeof(devname), "/dev/rtp%d", addr.sipc_port);
+	c->rfd = open(devname, O_RDONLY);
+	if (c->rfd < 0) {
+		ret = -errno;
+		rtipc_close(pair);
+		return ret;
+	}
+
+	return 0;
+}
+
+static ssize_t xddp_recv(struct ipcb_pair *pair, void *buf, size_t len)
+{
+	struct rtipc_chan *c = pair->chan;
+	ssize_t ret;
+
+	ret = read(c->rfd, buf, len);
+	if (ret == 0)
+		return -EPIPE;
+
+	return ret < 0 ? -errno : ret;
+}
+
+const struct ipcb_transport xddp_xprt = {
+	.name = "xddp",
+	.flags = IPCB_NRT_CONSUMER,
+	.max_msgsz = 65536,
+	.open = xddp_open,
+	.close = rtipc_close,
+	.send = rtipc_send,
+	.recv = xddp_recv,
+};
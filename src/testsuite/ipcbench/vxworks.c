@@ -0,0 +1,106 @@
+/*
+ * IPC benchmark, VxWorks skin glue and message queue transport.
+ *
+ * Released under the terms of GPLv2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <vxworks/vxworks.h>
+#include "ipcbench.h"
+
+const char *ipcb_skin = "vxworks";
+
+/* Tasks inherit the affinity of their creator. */
+const int ipcb_max_cpus = 64;
+
+static void trampoline(long arg0, long arg1, long arg2, long arg3, long arg4,
+		       long arg5, long arg6, long arg7, long arg8, long arg9)
+{
+	ipcb_run((struct ipcb_thread *)arg0);
+}
+
+int ipcb_spawn(struct ipcb_thread *thread, const char *name, int prio)
+{
+	TASK_ID tid;
+
+	if (thread->nrt)
+		return -ENOSYS;
+
+	/* VxWorks priorities are inverted, 0 is the highest. */
+	tid = taskSpawn(name, 256 - prio, 0, 0, trampoline,
+			(long)thread, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+	if (tid == ERROR)
+		return -EINVAL;
+
+	return 0;
+}
+
+int ipcb_join(struct ipcb_thread *thread)
+{
+	/* Tasks cannot be joined, the harness flags them done. */
+	while (!thread->done)
+		usleep(10000);
+
+	return 0;
+}
+
+void ipcb_yield(void)
+{
+	taskDelay(0);
+}
+
+static int msgq_open(struct ipcb_pair *pair)
+{
+	MSG_Q_ID *qid;
+
+	qid = malloc(sizeof(*qid));
+	if (qid == NULL)
+		return -ENOMEM;
+
+	pair->chan = qid;
+
+	*qid = msgQCreate(pair->depth, pair->msgsz, MSG_Q_FIFO);
+
+	return *qid ? 0 : -ENOMEM;
+}
+
+static void msgq_close(struct ipcb_pair *pair)
+{
+	msgQDelete(*(MSG_Q_ID *)pair->chan);
+}
+
+static int msgq_send(struct ipcb_pair *pair, const void *buf, size_t len)
+{
+	if (msgQSend(*(MSG_Q_ID *)pair->chan, buf, len,
+		     WAIT_FOREVER, MSG_PRI_NORMAL) == ERROR)
+		return -EIO;
+
+	return 0;
+}
+
+static ssize_t msgq_recv(struct ipcb_pair *pair, void *buf, size_t len)
+{
+	int ret;
+
+	ret = msgQReceive(*(MSG_Q_ID *)pair->chan, buf, len, WAIT_FOREVER);
+
+	return ret == ERROR ? -EIO : ret;
+}
+
+static const struct ipcb_transport msgq_xprt = {
+	.name = "msgq",
+	.max_msgsz = 65536,
+	.open = msgq_open,
+	.close = msgq_close,
+	.send = msgq_send,
+	.recv = msgq_recv,
+};
+
+const struct ipcb_transport *ipcb_transports[] = {
+	&msgq_xprt,
+	NULL
+};
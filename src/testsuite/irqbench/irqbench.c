@@ -24,6 +24,7 @@
 #include <unistd.h>
 #include <sys/io.h>
 #include <sys/mman.h>
+#include <rtdm/rttesting.h>
 
 
 #define SERPORT                 0
@@ -47,22 +48,38 @@
 #define CTRL_INIT               0x04
 #define CTRL_STROBE             0x10
 
+/* sys/ttydefaults.h has its own CTRL(). */
+#undef CTRL
+
 #define DATA(base) (base + 0) /* Data register */
 #define STAT(base) (base + 1) /* Status register */
 #define CTRL(base) (base + 2) /* Control register */
 
+#define MAX_PORTS               8
+
+struct port_stats {
+	long long min_lat;
+	long long max_lat;
+	long long loop_avg;
+	long loop_hits;
+	long long avg_lat;
+	long outer_loops;
+	unsigned long long lost;
+	struct rttst_hdr_histogram hdr;	/* Over the current sweep step. */
+};
+
 static double tsc2ns_scale;
-static long long min_lat = LONG_MAX;
-static long long max_lat = LONG_MIN;
-static long long avg_lat;
-static long outer_loops;
 static int warmup = 1;
 static int terminate;
-static unsigned long port_ioaddr = 0x3F8;
+static unsigned long port_ioaddr[MAX_PORTS] = { 0x3F8 };
+static int nr_ports = 1;
 static int port_type = SERPORT;
-static unsigned int toggle;
-static long loop_avg;
+static unsigned int toggle[MAX_PORTS];
+static struct port_stats stats[MAX_PORTS];
 static long long period = 100000;
+static long long min_period;
+static int sweep_steps = 10;
+static int step_duration = 5;
 static int trigger_trace;
 
 static inline long long rdtsc(void)
@@ -124,70 +141,234 @@ static void sighand(int signal)
 		terminate = 1;
 }
 
+static inline int port_replied(int n, int status)
+{
+	if (port_type == SERPORT)
+		return (inb(MSR(port_ioaddr[n])) & MSR_DELTA) != 0;
+
+	return inb(STAT(port_ioaddr[n])) != status;
+}
+
+static void trigger_port_trace(int n)
+{
+	if (port_type == SERPORT) {
+		toggle[n] ^= MCR_DTR;
+		outb(toggle[n], MCR(port_ioaddr[n]));
+	} else {
+		outb(0x18, DATA(port_ioaddr[n]));
+		outb(0x10, DATA(port_ioaddr[n]));
+	}
+}
+
+/*
+ * Stimulate all ports at once, then poll them in turn until each one
+ * has replied, so that the target has to handle concurrent IRQs.
+ * Ports are polled sequentially, so the resolution degrades by the
+ * cost of an I/O read per additional port.
+ */
 static void do_inner_loop(void)
 {
-	long long start, delay, timeout;
+	long long start, now, timeout, delay[MAX_PORTS];
+	int status[MAX_PORTS], pending, n;
+	struct port_stats *ps;
 	long lat;
 
 	__asm__ __volatile__("cli");
 
-	if (port_type ==  SERPORT) {
+	if (port_type == SERPORT) {
 		start = rdtsc();
 
-		toggle ^= MCR_RTS;
-		outb(toggle, MCR(port_ioaddr));
-
-		timeout = start + period * 100;
-		while ((inb(MSR(port_ioaddr)) & MSR_DELTA) == 0 &&
-		       rdtsc() < timeout);
-
-		delay = rdtsc() - start;
+		for (n = 0; n < nr_ports; n++) {
+			status[n] = 0;
+			toggle[n] ^= MCR_RTS;
+			outb(toggle[n], MCR(port_ioaddr[n]));
+		}
 	} else {
-		int status = inb(STAT(port_ioaddr));
-
-		outb(0x08, DATA(port_ioaddr));
+		for (n = 0; n < nr_ports; n++) {
+			status[n] = inb(STAT(port_ioaddr[n]));
+			outb(0x08, DATA(port_ioaddr[n]));
+		}
 
 		start = rdtsc();
 
-		outb(0x00, DATA(port_ioaddr));
+		for (n = 0; n < nr_ports; n++)
+			outb(0x00, DATA(port_ioaddr[n]));
+	}
 
-		timeout = start + period * 100;
-		while (inb(STAT(port_ioaddr)) == status &&
-		       rdtsc() < timeout);
+	for (n = 0; n < nr_ports; n++)
+		delay[n] = -1;
+
+	pending = nr_ports;
+	timeout = start + period * 100;
+	do {
+		now = rdtsc();
+		for (n = 0; n < nr_ports; n++)
+			if (delay[n] < 0 && port_replied(n, status[n])) {
+				delay[n] = rdtsc() - start;
+				pending--;
+			}
+	} while (pending > 0 && now < timeout);
 
-		delay = rdtsc() - start;
-	}
+	if (!warmup)
+		for (n = 0; n < nr_ports; n++) {
+			ps = &stats[n];
+
+			if (delay[n] < 0) {
+				ps->lost++;
+				continue;
+			}
 
-	if (!warmup) {
-		lat = tsc2ns(delay);
-
-		loop_avg += lat;
-		if (lat < min_lat)
-			min_lat = lat;
-		if (lat > max_lat) {
-			max_lat = lat;
-			if (trigger_trace) {
-				if (port_type == SERPORT) {
-					toggle ^= MCR_DTR;
-					outb(toggle, MCR(port_ioaddr));
-				} else {
-					outb(0x18, DATA(port_ioaddr));
-					outb(0x10, DATA(port_ioaddr));
-				}
+			lat = tsc2ns(delay[n]);
+
+			ps->loop_avg += lat;
+			ps->loop_hits++;
+			ps->hdr.counts[rttst_hdr_index(lat)]++;
+			ps->hdr.total++;
+			if (lat < ps->min_lat)
+				ps->min_lat = lat;
+			if (lat > ps->max_lat) {
+				ps->max_lat = lat;
+				if (trigger_trace)
+					trigger_port_trace(n);
 			}
 		}
-	}
 
 	__asm__ __volatile__("sti");
 
 	while (rdtsc() < start + period);
 }
 
+static const int pct_x10[] = { 500, 990, 999 };	/* 50, 99, 99.9 */
+#define NPCT (sizeof(pct_x10) / sizeof(pct_x10[0]))
+
+static void hdr_percentiles(struct rttst_hdr_histogram *hdr, double *val)
+{
+	unsigned long long hits = 0, rank;
+	unsigned n, i = 0;
+
+	for (n = 0; n < NPCT; n++)
+		val[n] = 0;
+
+	for (n = 0; n < RTTST_HDR_BUCKETS && i < NPCT; n++) {
+		hits += hdr->counts[n];
+		while (i < NPCT) {
+			rank = (hdr->total * pct_x10[i] + 999) / 1000;
+			if (rank == 0)
+				rank = 1;
+			if (hits < rank)
+				break;
+			val[i++] = rttst_hdr_value(n) / 1000.0;
+		}
+	}
+}
+
+static void parse_ports(char *arg)
+{
+	char *p;
+
+	for (nr_ports = 0, p = strtok(arg, ",");
+	     p && nr_ports < MAX_PORTS; p = strtok(NULL, ","))
+		port_ioaddr[nr_ports++] = strtol(p, NULL, 0);
+}
+
+/*
+ * Sweep mode: shorten the signal period step by step, from the
+ * initial period down to the minimum one, and report the IRQ
+ * throughput the target sustained at each load level, along with
+ * per-port latency percentiles.
+ */
+static void run_sweep(void)
+{
+	long long first_period = period, step_period, end;
+	unsigned long long replies, lost;
+	double val[NPCT];
+	int step, n, loops;
+
+	printf("%10s %12s %12s %8s", "period_us", "offered/s", "handled/s",
+	       "lost");
+	for (n = 0; n < nr_ports; n++)
+		printf(" | p%d: p50/p99/p99.9 us", n);
+	printf("\n");
+
+	for (step = 0; step < sweep_steps && !terminate; step++) {
+		step_period = first_period;
+		if (sweep_steps > 1)
+			step_period -= (first_period - min_period) * step /
+				(sweep_steps - 1);
+		period = step_period;
+
+		for (n = 0; n < nr_ports; n++) {
+			memset(&stats[n].hdr, 0, sizeof(stats[n].hdr));
+			stats[n].lost = 0;
+		}
+
+		end = rdtsc() + ns2tsc(step_duration * 1000000000LL);
+		for (loops = 0; rdtsc() < end && !terminate; loops++)
+			do_inner_loop();
+
+		if (terminate)
+			break;
+
+		replies = lost = 0;
+		for (n = 0; n < nr_ports; n++) {
+			replies += stats[n].hdr.total;
+			lost += stats[n].lost;
+		}
+
+		printf("%10.1f %12.0f %12.0f %8llu",
+		       tsc2ns(step_period) / 1000.0,
+		       (double)loops * nr_ports / step_duration,
+		       (double)replies / step_duration, lost);
+		for (n = 0; n < nr_ports; n++) {
+			hdr_percentiles(&stats[n].hdr, val);
+			printf(" | %6.2f/%6.2f/%6.2f", val[0], val[1], val[2]);
+		}
+		printf("\n");
+		fflush(stdout);
+	}
+}
+
+static void print_port_stats(unsigned long long count, int n, long long avg)
+{
+	struct port_stats *ps = &stats[n];
+
+	if (nr_ports > 1)
+		printf("%llu: port %d: %.3f / %.3f / %.3f us, lost %llu\n",
+		       count, n,
+		       ((double)ps->min_lat) / 1000.0,
+		       ((double)avg) / 1000.0,
+		       ((double)ps->max_lat) / 1000.0, ps->lost);
+	else
+		printf("%llu: %.3f / %.3f / %.3f us\n", count,
+		       ((double)ps->min_lat) / 1000.0,
+		       ((double)avg) / 1000.0,
+		       ((double)ps->max_lat) / 1000.0);
+}
+
+static int wait_on_port(int n)
+{
+	int status;
+
+	if (port_type == SERPORT) {
+		toggle[n] ^= MCR_RTS;
+		outb(toggle[n], MCR(port_ioaddr[n]));
+		usleep(100000);
+		return (inb(MSR(port_ioaddr[n])) & MSR_DELTA) != 0;
+	}
+
+	status = inb(STAT(port_ioaddr[n]));
+	outb(0x08, DATA(port_ioaddr[n]));
+	outb(0x00, DATA(port_ioaddr[n]));
+	usleep(100000);
+
+	return inb(STAT(port_ioaddr[n])) != status;
+}
+
 int main(int argc, char *argv[])
 {
 	int ioaddr_set = 0;
 	unsigned long long count = 1;
-	int c;
+	int c, n;
 
 	signal(SIGINT, sighand);
 	signal(SIGTERM, sighand);
@@ -196,7 +377,7 @@ int main(int argc, char *argv[])
 
 	calibrate_tsc();
 
-	while ((c = getopt(argc, argv, "p:T:o:a:f")) != EOF)
+	while ((c = getopt(argc, argv, "p:T:o:a:fs:n:l:")) != EOF)
 		switch (c) {
 		case 'p':
 			period = atoi(optarg) * 1000;
@@ -211,7 +392,7 @@ int main(int argc, char *argv[])
 			break;
 
 		case 'a':
-			port_ioaddr = strtol(optarg, NULL, 0);
+			parse_ports(optarg);
 			ioaddr_set = 1;
 			break;
 
@@ -219,19 +400,41 @@ int main(int argc, char *argv[])
 			trigger_trace = 1;
 			break;
 
+		case 's':
+			min_period = atoi(optarg) * 1000;
+			break;
+
+		case 'n':
+			sweep_steps = atoi(optarg);
+			break;
+
+		case 'l':
+			step_duration = atoi(optarg);
+			break;
+
 		default:
 			fprintf(stderr, "usage: irqbench [options]\n"
 				"  [-p <period_us>]             # signal period, default=100 us\n"
 				"  [-T <test_duration_seconds>] # default=0, so ^C to end\n"
 				"  [-o <port_type>]             # 0=serial (default), 1=parallel\n"
-				"  [-a <port_io_address>]       # default=0x3f8/0x378\n"
-				"  [-f]                         # freeze trace for each new max latency\n");
+				"  [-a <port_io_address>[,...]] # default=0x3f8/0x378, up to %d ports\n"
+				"  [-f]                         # freeze trace for each new max latency\n"
+				"  [-s <min_period_us>]         # sweep the period down to min_period_us\n"
+				"  [-n <steps>]                 # number of sweep steps, default=10\n"
+				"  [-l <step_duration_seconds>] # duration of each sweep step, default=5\n",
+				MAX_PORTS);
 			exit(2);
 		}
 
 	/* set defaults for parallel port */
 	if (port_type == 1 && !ioaddr_set)
-		port_ioaddr = 0x378;
+		port_ioaddr[0] = 0x378;
+
+	if (nr_ports == 0 || sweep_steps <= 0 || step_duration <= 0 ||
+	    (min_period && min_period > period)) {
+		fprintf(stderr, "irqbench: invalid arguments\n");
+		exit(2);
+	}
 
 	if (iopl(3) < 0) {
 		fprintf(stderr, "irqbench: superuser permissions required\n");
@@ -239,53 +442,64 @@ int main(int argc, char *argv[])
 	}
 	mlockall(MCL_CURRENT | MCL_FUTURE);
 
-	switch (port_type) {
-	case SERPORT:
-		toggle = MCR_OUT2;
-		inb(MSR(port_ioaddr));
-		break;
+	for (n = 0; n < nr_ports; n++) {
+		stats[n].min_lat = LONG_MAX;
+		stats[n].max_lat = LONG_MIN;
+
+		switch (port_type) {
+		case SERPORT:
+			toggle[n] = MCR_OUT2;
+			inb(MSR(port_ioaddr[n]));
+			break;
 
-	case PARPORT:
-		outb(CTRL_INIT, CTRL(port_ioaddr));
-		break;
+		case PARPORT:
+			outb(CTRL_INIT, CTRL(port_ioaddr[n]));
+			break;
 
-	default:
-		fprintf(stderr, "irqbench: invalid port type\n");
-		exit(1);
+		default:
+			fprintf(stderr, "irqbench: invalid port type\n");
+			exit(1);
+		}
 	}
 
 	period = ns2tsc(period);
+	min_period = ns2tsc(min_period);
 
-	printf("Port type:     %s\n"
-	       "Port address:  0x%lx\n\n",
-	       (port_type == SERPORT) ? "serial" : "parallel", port_ioaddr);
+	printf("Port type:     %s\n",
+	       (port_type == SERPORT) ? "serial" : "parallel");
+	for (n = 0; n < nr_ports; n++)
+		printf("Port address:  0x%lx\n", port_ioaddr[n]);
+	printf("\n");
 
 	printf("Waiting on target...\n");
 
-	while (1)
-		if (port_type ==  SERPORT) {
-			toggle ^= MCR_RTS;
-			outb(toggle, MCR(port_ioaddr));
-			usleep(100000);
-			if ((inb(MSR(port_ioaddr)) & MSR_DELTA) != 0)
-				break;
-		} else {
-			int status = inb(STAT(port_ioaddr));
-
-			outb(0x08, DATA(port_ioaddr));
-			outb(0x00, DATA(port_ioaddr));
-			usleep(100000);
-			if (inb(STAT(port_ioaddr)) != status)
-				break;
-		}
+	for (n = 0; n < nr_ports; n++)
+		while (!wait_on_port(n))
+			;
 
 	printf("Warming up...\n");
 
+	if (min_period) {
+		/* One second of warmup, then sweep. */
+		long long loop_timeout = rdtsc() + ns2tsc(1000000000LL);
+
+		while (rdtsc() < loop_timeout)
+			do_inner_loop();
+
+		warmup = 0;
+		run_sweep();
+		return 0;
+	}
+
 	while (!terminate) {
 		long long loop_timeout = rdtsc() + ns2tsc(1000000000LL);
 		int inner_loops = 0;
 
-		loop_avg = 0;
+		for (n = 0; n < nr_ports; n++) {
+			stats[n].loop_avg = 0;
+			stats[n].loop_hits = 0;
+		}
+
 		while (rdtsc() < loop_timeout) {
 			do_inner_loop();
 			inner_loops++;
@@ -294,23 +508,27 @@ int main(int argc, char *argv[])
 		count += inner_loops;
 
 		if (!warmup && !terminate) {
-			loop_avg /= inner_loops;
+			for (n = 0; n < nr_ports; n++) {
+				struct port_stats *ps = &stats[n];
+
+				if (ps->loop_hits)
+					ps->loop_avg /= ps->loop_hits;
 
-			printf("%llu: %.3f / %.3f / %.3f us\n", count,
-			       ((double)min_lat) / 1000.0,
-			       ((double)loop_avg) / 1000.0,
-			       ((double)max_lat) / 1000.0);
+				print_port_stats(count, n, ps->loop_avg);
 
-			avg_lat += loop_avg;
-			outer_loops++;
+				ps->avg_lat += ps->loop_avg;
+				ps->outer_loops++;
+			}
 		} else
 			warmup = 0;
 	}
 
-	avg_lat /= outer_loops;
-	printf("---\n%llu: %.3f / %.3f / %.3f us\n", count,
-	       ((double)min_lat) / 1000.0, ((double)avg_lat) / 1000.0,
-	       ((double)max_lat) / 1000.0);
+	printf("---\n");
+	for (n = 0; n < nr_ports; n++) {
+		if (stats[n].outer_loops)
+			stats[n].avg_lat /= stats[n].outer_loops;
+		print_port_stats(count, n, stats[n].avg_lat);
+	}
 
 	return 0;
 }
@@ -21,23 +21,62 @@
 #include <signal.h>
 #include <string.h>
 #include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
 #include <limits.h>
 #include <sys/mman.h>
 #include <rtdm/rttesting.h>
 
-static int benchdev;
+#include <xeno_config.h>
+
+#ifndef HAVE_RECENT_SETAFFINITY
+#ifdef HAVE_OLD_SETAFFINITY
+#define sched_setaffinity(pid, len, mask)	sched_setaffinity(pid, mask)
+#else /* !HAVE_OLD_SETAFFINITY */
+#ifndef __cpu_set_t_defined
+typedef unsigned long cpu_set_t;
+#endif
+#define sched_setaffinity(pid, len, mask)	do { } while (0)
+#ifndef CPU_ZERO
+#define CPU_ZERO(set)				memset(set, 0, sizeof(*set))
+#define CPU_SET(n, set)				do { } while (0)
+#endif
+#endif /* !HAVE_OLD_SETAFFINITY */
+#endif /* !HAVE_RECENT_SETAFFINITY */
+
+#define MAX_SOURCES	8
+
+struct irq_source {
+	int fd;
+	int priority;
+	pthread_t thr;
+	struct rttst_irqbench_config config;
+	unsigned long long last_received;
+	struct rttst_hdr_histogram last_hdr;
+	struct rttst_hdr_histogram hdr;
+};
+
+static struct irq_source sources[MAX_SOURCES];
+static int nr_sources;
 static int terminate;
 
 static void *irq_thread(void *arg)
 {
-	struct sched_param param = { .sched_priority = (long)arg };
+	struct irq_source *src = arg;
+	struct sched_param param = { .sched_priority = src->priority };
+	cpu_set_t cpus;
+
+	if (src->config.cpu >= 0) {
+		CPU_ZERO(&cpus);
+		CPU_SET(src->config.cpu, &cpus);
+		sched_setaffinity(0, sizeof(cpus), &cpus);
+	}
 
 	pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
 
 	while (1) {
-		if (ioctl(benchdev, RTTST_RTIOC_IRQBENCH_WAIT_IRQ) ||
-		    ioctl(benchdev, RTTST_RTIOC_IRQBENCH_REPLY_IRQ))
+		if (ioctl(src->fd, RTTST_RTIOC_IRQBENCH_WAIT_IRQ) ||
+		    ioctl(src->fd, RTTST_RTIOC_IRQBENCH_REPLY_IRQ))
 			break;
 	}
 
@@ -52,6 +91,47 @@ static void sighand(int sig)
 	terminate = 1;
 }
 
+static int parse_list(char *arg, long *values)
+{
+	int n = 0;
+	char *p;
+
+	for (p = strtok(arg, ","); p && n < MAX_SOURCES; p = strtok(NULL, ","))
+		values[n++] = strtol(p, NULL, 0);
+
+	return n;
+}
+
+/*
+ * Percentiles of the IRQ-to-reply delays recorded since the previous
+ * call, from the difference between two snapshots of the cumulative
+ * histogram maintained by the driver.
+ */
+static void delta_percentiles(struct irq_source *src, double *p50,
+			      double *p99, double *max)
+{
+	unsigned long long total, hits = 0, count;
+	int n;
+
+	total = src->hdr.total - src->last_hdr.total;
+	*p50 = *p99 = *max = 0;
+
+	for (n = 0; n < RTTST_HDR_BUCKETS && total > 0; n++) {
+		count = src->hdr.counts[n] - src->last_hdr.counts[n];
+		if (count == 0)
+			continue;
+		if (hits < (total + 1) / 2 && hits + count >= (total + 1) / 2)
+			*p50 = rttst_hdr_value(n) / 1000.0;
+		if (hits < (total * 99 + 99) / 100 &&
+		    hits + count >= (total * 99 + 99) / 100)
+			*p99 = rttst_hdr_value(n) / 1000.0;
+		hits += count;
+		*max = rttst_hdr_value(n) / 1000.0;
+	}
+
+	src->last_hdr = src->hdr;
+}
+
 int main(int argc, char *argv[])
 {
 	const char *mode_name[] = {
@@ -72,17 +152,20 @@ int main(int argc, char *argv[])
 		.calibration_loops	= 0,
 		.port_type		= RTTST_IRQBENCH_SERPORT,
 		.port_ioaddr		= 0x3f8,
-		.port_irq		= 4
+		.port_irq		= 4,
+		.cpu			= -1,
 	};
+	long ioaddrs[MAX_SOURCES], irqs[MAX_SOURCES], cpus[MAX_SOURCES];
+	int nr_ioaddrs = 0, nr_irqs = 0, nr_cpus = 0;
 	struct rttst_irqbench_stats stats;
-	unsigned long long last_received = 0;
-	pthread_t thr;
-	int ioaddr_set = 0;
-	int irq_set = 0;
-	int c;
+	unsigned long long received = 0, total;
+	double p50, p99, max;
+	struct irq_source *src;
 	int timeout = 10;
+	int ticks = 0;
+	int c, n;
 
-	while ((c = getopt(argc, argv, "D:t:P:o:a:i:")) != EOF)
+	while ((c = getopt(argc, argv, "D:t:P:o:a:i:c:")) != EOF)
 		switch (c) {
 		case 'D':
 			benchdev_no = atoi(optarg);
@@ -101,13 +184,15 @@ int main(int argc, char *argv[])
 			break;
 
 		case 'a':
-			config.port_ioaddr = strtol(optarg, NULL, 0);
-			ioaddr_set = 1;
+			nr_ioaddrs = parse_list(optarg, ioaddrs);
 			break;
 
 		case 'i':
-			config.port_irq = strtol(optarg, NULL, 0);
-			irq_set = 1;
+			nr_irqs = parse_list(optarg, irqs);
+			break;
+
+		case 'c':
+			nr_cpus = parse_list(optarg, cpus);
 			break;
 
 		default:
@@ -117,17 +202,45 @@ int main(int argc, char *argv[])
 				"                           # 2=IRQ handler, 3=hard-IRQ handler\n"
 				"  [-P <priority>]          # task priority (test mode 0 and 1 only)\n"
 				"  [-o <port_type>]         # 0=serial (default), 1=parallel\n"
-				"  [-a <port_io_address>]   # default=0x3f8/0x378\n"
-				"  [-i <port_irq>]          # default=4/7\n");
+				"  [-a <port_io_address>[,...]] # default=0x3f8/0x378\n"
+				"  [-i <port_irq>[,...]]    # default=4/7\n"
+				"  [-c <cpu>[,...]]         # CPU to route each IRQ to, default=any\n"
+				"\n"
+				"Several IRQ sources may be driven concurrently by passing\n"
+				"as many comma-separated I/O addresses and IRQs, up to %d.\n",
+				MAX_SOURCES);
 			exit(2);
 		}
 
 	/* set defaults for parallel port */
 	if (config.port_type == 1) {
-		if (!ioaddr_set)
-			config.port_ioaddr = 0x378;
-		if (!irq_set)
-			config.port_irq = 0x7;
+		config.port_ioaddr = 0x378;
+		config.port_irq = 0x7;
+	}
+
+	nr_sources = nr_ioaddrs > nr_irqs ? nr_ioaddrs : nr_irqs;
+	if (nr_sources == 0)
+		nr_sources = 1;
+
+	if ((nr_sources > 1 && (nr_ioaddrs != nr_sources ||
+				nr_irqs != nr_sources)) ||
+	    (nr_cpus > 0 && nr_cpus != nr_sources)) {
+		fprintf(stderr, "irqloop: need as many I/O addresses, "
+			"IRQs and CPUs as sources\n");
+		exit(2);
+	}
+
+	for (n = 0; n < nr_sources; n++) {
+		src = &sources[n];
+		src->fd = -1;
+		src->config = config;
+		src->priority = config.priority;
+		if (nr_ioaddrs)
+			src->config.port_ioaddr = ioaddrs[n];
+		if (nr_irqs)
+			src->config.port_irq = irqs[n];
+		if (nr_cpus)
+			src->config.cpu = cpus[n];
 	}
 
 	signal(SIGINT, sighand);
@@ -137,62 +250,112 @@ int main(int argc, char *argv[])
 	mlockall(MCL_CURRENT|MCL_FUTURE);
 
 	snprintf(devname, RTDM_MAX_DEVNAME_LEN, "/dev/rttest-irqbench%d", benchdev_no);
-	benchdev = open(devname, O_RDWR);
-	if (benchdev < 0) {
-		perror("irqloop: failed to open benchmark device");
-		fprintf(stderr, "(modprobe xeno_irqbench?)\n");
-		return 1;
-	}
 
-	if (config.mode == RTTST_IRQBENCH_USER_TASK) {
-		pthread_attr_t attr;
+	printf("Test mode:    %s\n"
+	       "Port type:    %s\n",
+	       mode_name[config.mode], port_type_name[config.port_type]);
 
-		pthread_attr_init(&attr);
-		pthread_attr_setstacksize(&attr, PTHREAD_STACK_MIN);
+	for (n = 0; n < nr_sources; n++) {
+		src = &sources[n];
 
-		pthread_create(&thr, &attr, irq_thread, (void *)(long)config.priority);
-	}
+		/* Each open file gets its own IRQ context. */
+		src->fd = open(devname, O_RDWR);
+		if (src->fd < 0) {
+			perror("irqloop: failed to open benchmark device");
+			fprintf(stderr, "(modprobe xeno_irqbench?)\n");
+			goto cleanup;
+		}
+
+		if (config.mode == RTTST_IRQBENCH_USER_TASK) {
+			pthread_attr_t attr;
+
+			pthread_attr_init(&attr);
+			pthread_attr_setstacksize(&attr, PTHREAD_STACK_MIN);
 
-	if (ioctl(benchdev, RTTST_RTIOC_IRQBENCH_START, &config)) {
-		perror("irqloop: error starting test");
-		goto cleanup;
+			pthread_create(&src->thr, &attr, irq_thread, src);
+		}
+
+		if (ioctl(src->fd, RTTST_RTIOC_IRQBENCH_START, &src->config)) {
+			perror("irqloop: error starting test");
+			goto cleanup;
+		}
+
+		printf("Source #%d:    port 0x%lx, IRQ %d, CPU ", n,
+		       src->config.port_ioaddr, src->config.port_irq);
+		if (src->config.cpu >= 0)
+			printf("%d\n", src->config.cpu);
+		else
+			printf("any\n");
 	}
 
-	printf("Test mode:    %s\n"
-	       "Port type:    %s\n"
-	       "Port address: 0x%lx\n"
-	       "Port IRQ:     %d\n\n\n\n",
-	       mode_name[config.mode], port_type_name[config.port_type],
-	       config.port_ioaddr, config.port_irq);
+	printf("\n");
 
 	while (!terminate) {
-		if (ioctl(benchdev, RTTST_RTIOC_IRQBENCH_GET_STATS,
-			  &stats) < 0) {
-			perror("irqloop: error reading stats");
-			break;
+		usleep(250000);
+
+		total = 0;
+		for (n = 0; n < nr_sources; n++) {
+			if (ioctl(sources[n].fd, RTTST_RTIOC_IRQBENCH_GET_STATS,
+				  &stats) < 0) {
+				perror("irqloop: error reading stats");
+				goto stop;
+			}
+			total += stats.irqs_received;
 		}
 
-		if ((last_received > 0) &&
-		    (stats.irqs_received == last_received)) {
+		/* Stop once all sources went idle for a while. */
+		if (total > 0 && total == received) {
 			if (--timeout == 0)
-				break; /* timed out */
+				break;
 		} else
 			timeout = 10;
-		last_received = stats.irqs_received;
+		received = total;
 
-		printf("\033[2AReceived IRQs:     %lld\n"
-		       "Acknowledged IRQs: %lld\n",
-		       stats.irqs_received, stats.irqs_acknowledged);
-		usleep(250000);
+		/* Report once per second. */
+		if (++ticks % 4)
+			continue;
+
+		total = 0;
+		for (n = 0; n < nr_sources; n++) {
+			src = &sources[n];
+
+			if (ioctl(src->fd, RTTST_RTIOC_IRQBENCH_GET_STATS,
+				  &stats) < 0 ||
+			    ioctl(src->fd, RTTST_RTIOC_IRQBENCH_GET_HDR,
+				  &src->hdr) < 0) {
+				perror("irqloop: error reading stats");
+				goto stop;
+			}
+
+			delta_percentiles(src, &p50, &p99, &max);
+			printf("#%d: %llu IRQs/s, received %llu, "
+			       "acknowledged %llu, "
+			       "reply %.3f / %.3f / %.3f us (p50/p99/max)\n",
+			       n, stats.irqs_received - src->last_received,
+			       stats.irqs_received, stats.irqs_acknowledged,
+			       p50, p99, max);
+			total += stats.irqs_received - src->last_received;
+			src->last_received = stats.irqs_received;
+		}
+
+		if (nr_sources > 1)
+			printf("all: %llu IRQs/s\n", total);
 	}
 
-	ioctl(benchdev, RTTST_RTIOC_IRQBENCH_STOP);
+stop:
+	for (n = 0; n < nr_sources; n++)
+		ioctl(sources[n].fd, RTTST_RTIOC_IRQBENCH_STOP);
 
 cleanup:
-	close(benchdev);
-	if (config.mode == RTTST_IRQBENCH_USER_TASK) {
-		pthread_cancel(thr);
-		pthread_join(thr, NULL);
+	for (n = 0; n < nr_sources; n++) {
+		src = &sources[n];
+		if (src->fd < 0)
+			continue;
+		close(src->fd);
+		if (config.mode == RTTST_IRQBENCH_USER_TASK) {
+			pthread_cancel(src->thr);
+			pthread_join(src->thr, NULL);
+		}
 	}
 	return 0;
 }
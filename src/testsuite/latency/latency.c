@@ -18,7 +18,7 @@
 #include <native/sem.h>
 #include <rtdm/rttesting.h>
 
-RT_TASK latency_task, display_task;
+RT_TASK display_task;
 
 RT_SEM display_sem;
 
@@ -70,6 +70,47 @@ int bucketsize = 1000;		/* default = 1000ns, -B <size> to override */
 
 #define need_histo() (do_histogram || do_stats || do_gnuplot)
 
+/* Machine-readable percentile report, via -O <json|csv>. */
+const char *hdr_format = NULL;
+#define need_hdr() (hdr_format != NULL)
+
+/*
+ * One sampling task per measured CPU (-A), the first one also
+ * feeding the periodic display. T_CPU() limits us to 8 CPUs.
+ */
+#define MAX_SAMPLERS 8
+
+struct sampler {
+	RT_TASK task;
+	int cpu;
+	long minj, maxj;	/* TSC units, user task mode only */
+	long overrun;
+	struct rttst_hdr_histogram hdr;
+} samplers[MAX_SAMPLERS];
+
+int nr_samplers = 1;
+int all_cpus = 0;
+int prerelease = 0;		/* -r: T_PREREL periodic wakeups */
+int tune_gravity = 0;		/* -G: tune the gravity of the test mode class */
+
+#define GRAVITY_PROC "/proc/xenomai/gravity"
+
+/* Timer wakeup class exercised by each test mode. */
+const char *gravity_classes[] = { "user", "kernel", "irq" };
+
+int cache_class = -1;		/* -L: cache class of the measuring CPUs */
+int cache_saved[MAX_SAMPLERS];	/* Default classes to restore on exit */
+
+#define CACHEPART_PROC "/proc/xenomai/cachepart"
+
+int do_phases = 0;		/* -d: break latencies down into phases */
+int have_phases = 0;
+struct rttst_phase_stats phases;
+
+const char *phase_names[RTTST_NR_PHASES] = {
+	"irq", "clock", "handler", "switch", "wakeup"
+};
+
 static inline void add_histogram(long *histogram, long addval)
 {
 	/* bucketsize steps */
@@ -78,10 +119,18 @@ static inline void add_histogram(long *histogram, long addval)
 	histogram[inabs < histogram_size ? inabs : histogram_size - 1]++;
 }
 
+static inline void add_hdr(struct sampler *s, long long ns)
+{
+	s->hdr.counts[rttst_hdr_index(ns)]++;
+	s->hdr.total++;
+}
+
 void latency(void *cookie)
 {
-	int err, count, nsamples, warmup = 1;
-	RTIME expected_tsc, period_tsc, start_ticks, fault_threshold;
+	struct sampler *s = cookie;
+	int primary = (s == &samplers[0]);
+	int err, count, nsamples, warmup = 1, loops = 0;
+	RTIME expected_tsc, period_tsc, start_ticks, fault_threshold, now_tsc;
 	RT_TIMER_INFO timer_info;
 	unsigned old_relaxed = 0;
 
@@ -99,6 +148,16 @@ void latency(void *cookie)
 	start_ticks = timer_info.date + rt_timer_ns2ticks(1000000);
 	expected_tsc = timer_info.tsc + rt_timer_ns2tsc(1000000);
 
+	if (prerelease) {
+		err = rt_task_set_mode(0, T_PREREL, NULL);
+		if (err) {
+			fprintf(stderr,
+				"latency: failed to set T_PREREL, code %d\n",
+				err);
+			return;
+		}
+	}
+
 	err =
 	    rt_task_set_periodic(NULL, start_ticks,
 				 rt_timer_ns2ticks(period_ns));
@@ -113,7 +172,10 @@ void latency(void *cookie)
 		long minj = TEN_MILLION, maxj = -TEN_MILLION, dt;
 		long overrun = 0;
 		long long sumj;
-		test_loops++;
+
+		if (primary)
+			test_loops++;
+		loops++;
 
 		for (count = sumj = 0; count < nsamples; count++) {
 			unsigned new_relaxed;
@@ -122,7 +184,8 @@ void latency(void *cookie)
 			expected_tsc += period_tsc;
 			err = rt_task_wait_period(&ov);
 
-			dt = (long)(rt_timer_tsc() - expected_tsc);
+			now_tsc = rt_timer_tsc();
+			dt = (long)(now_tsc - expected_tsc);
 			new_relaxed = sampling_relaxed;
 			if (dt > maxj) {
 				if (new_relaxed != old_relaxed
@@ -136,6 +199,17 @@ void latency(void *cookie)
 				minj = dt;
 			sumj += dt;
 
+			if (do_phases && !(finished || warmup)) {
+				struct rttst_phase_sample ps;
+
+				/* Before anything goes through the nucleus
+				   again, not to lose the stamps. */
+				ps.date = expected_tsc;
+				ps.now = now_tsc;
+				rt_dev_ioctl(benchdev,
+					     RTTST_RTIOC_TMBENCH_PHASE_SAMPLE, &ps);
+			}
+
 			if (err) {
 				if (err != -ETIMEDOUT) {
 					fprintf(stderr,
@@ -148,6 +222,21 @@ void latency(void *cookie)
 				expected_tsc += period_tsc * ov;
 			}
 
+			if (!(finished || warmup) && need_hdr()) {
+				long long ns = rt_timer_tsc2ns(dt);
+				unsigned long k;
+
+				add_hdr(s, ns);
+				/* The releases we overran would have been
+				   served late too: account for them, not
+				   to hide the tail (coordinated omission). */
+				for (k = 1; err == -ETIMEDOUT && k <= ov; k++)
+					add_hdr(s, ns - k * period_ns);
+			}
+
+			if (!primary)
+				continue;
+
 			if (freeze_max && (dt > gmaxjitter)
 			    && !(finished || warmup)) {
 				xntrace_user_freeze(rt_timer_tsc2ns(dt), 0);
@@ -159,6 +248,14 @@ void latency(void *cookie)
 		}
 
 		if (!warmup) {
+			if (minj < s->minj)
+				s->minj = minj;
+			if (maxj > s->maxj)
+				s->maxj = maxj;
+			s->overrun += overrun;
+		}
+
+		if (!warmup && primary) {
 			if (!finished && need_histo()) {
 				add_histogram(histogram_max, maxj);
 				add_histogram(histogram_min, minj);
@@ -178,8 +275,9 @@ void latency(void *cookie)
 			rt_sem_v(&display_sem);
 		}
 
-		if (warmup && test_loops == WARMUP_TIME) {
-			test_loops = 0;
+		if (warmup && loops == WARMUP_TIME) {
+			if (primary)
+				test_loops = 0;
 			warmup = 0;
 		}
 	}
@@ -216,6 +314,9 @@ void display(void *cookie)
 		config.histogram_size = need_histo() ? histogram_size : 0;
 		config.histogram_bucketsize = bucketsize;
 		config.freeze_max = freeze_max;
+		config.flags = need_hdr() ? RTTST_TMBENCH_HDR : 0;
+		if (do_phases)
+			config.flags |= RTTST_TMBENCH_PHASES;
 
 		err =
 		    rt_dev_ioctl(benchdev, RTTST_RTIOC_TMBENCH_START, &config);
@@ -406,6 +507,289 @@ void dump_hist_stats(void)
 		dump_histo_gnuplot(histogram_avg);
 }
 
+static const double hdr_pct[] = { 50, 90, 99, 99.9, 99.99 };
+#define HDR_NPCT (sizeof(hdr_pct) / sizeof(hdr_pct[0]))
+
+static void hdr_percentiles(struct rttst_hdr_histogram *hdr, double *val)
+{
+	unsigned long long hits = 0, rank;
+	unsigned n, i = 0;
+
+	for (n = 0; n < HDR_NPCT; n++)
+		val[n] = 0;
+
+	for (n = 0; n < RTTST_HDR_BUCKETS && i < HDR_NPCT; n++) {
+		hits += hdr->counts[n];
+		/* Rank of the sample standing for the i-th percentile. */
+		while (i < HDR_NPCT) {
+			rank = (unsigned long long)
+				ceil(hdr_pct[i] * hdr->total / 100.0);
+			if (rank == 0)
+				rank = 1;
+			if (hits < rank)
+				break;
+			val[i++] = rttst_hdr_value(n) / 1000.0;
+		}
+	}
+}
+
+static void dump_hdr_entry(int first, const char *cpu,
+			   struct rttst_hdr_histogram *hdr,
+			   double min, double max, long overrun)
+{
+	double val[HDR_NPCT];
+	unsigned n;
+
+	hdr_percentiles(hdr, val);
+
+	if (strcmp(hdr_format, "json") == 0) {
+		printf("%s    { \"cpu\": \"%s\", \"samples\": %llu, "
+		       "\"overruns\": %ld, \"min\": %.3f",
+		       first ? "" : ",\n", cpu, hdr->total, overrun, min);
+		for (n = 0; n < HDR_NPCT; n++)
+			printf(", \"p%g\": %.3f", hdr_pct[n], val[n]);
+		printf(", \"max\": %.3f }", max);
+	} else {
+		printf("%s,%llu,%ld,%.3f", cpu, hdr->total, overrun, min);
+		for (n = 0; n < HDR_NPCT; n++)
+			printf(",%.3f", val[n]);
+		printf(",%.3f\n", max);
+	}
+}
+
+/*
+ * Percentiles are computed over all samples, including the ones
+ * accounted for missed periods. All latencies are in microseconds.
+ */
+void dump_hdr(long gminj, long gmaxj)
+{
+	struct rttst_hdr_histogram all;
+	double min = 0, max = 0, gmin = 0, gmax = 0;
+	long overrun, goverrun_all = 0;
+	char cpu[16];
+	unsigned n;
+	int i;
+
+	memset(&all, 0, sizeof(all));
+
+	if (strcmp(hdr_format, "json") == 0)
+		printf("{\n  \"mode\": \"%s\",\n  \"period_us\": %Ld,\n"
+		       "  \"results\": [\n",
+		       test_mode_names[test_mode], period_ns / 1000);
+	else {
+		printf("cpu,samples,overruns,min");
+		for (n = 0; n < HDR_NPCT; n++)
+			printf(",p%g", hdr_pct[n]);
+		printf(",max\n");
+	}
+
+	for (i = 0; i < nr_samplers; i++) {
+		struct sampler *s = &samplers[i];
+
+		if (test_mode == USER_TASK) {
+			min = rt_timer_tsc2ns(s->minj) / 1000.0;
+			max = rt_timer_tsc2ns(s->maxj) / 1000.0;
+			overrun = s->overrun;
+		} else {
+			min = gminj / 1000.0;
+			max = gmaxj / 1000.0;
+			overrun = goverrun;
+		}
+
+		if (i == 0 || min < gmin)
+			gmin = min;
+		if (i == 0 || max > gmax)
+			gmax = max;
+		goverrun_all += overrun;
+
+		for (n = 0; n < RTTST_HDR_BUCKETS; n++)
+			all.counts[n] += s->hdr.counts[n];
+		all.total += s->hdr.total;
+
+		if (s->cpu < 0)
+			snprintf(cpu, sizeof(cpu), "any");
+		else
+			snprintf(cpu, sizeof(cpu), "%d", s->cpu);
+		dump_hdr_entry(i == 0, cpu, &s->hdr, min, max, overrun);
+	}
+
+	if (nr_samplers > 1)
+		dump_hdr_entry(0, "all", &all, gmin, gmax, goverrun_all);
+
+	if (strcmp(hdr_format, "json") == 0)
+		printf("\n  ]\n}\n");
+}
+
+/* Upper bound (ns) of the log2 bucket the percentile falls in. */
+static unsigned long phase_percentile(const unsigned long long *counts,
+				      unsigned long long total, double pct)
+{
+	unsigned long long hits = 0, rank;
+	int n;
+
+	rank = (unsigned long long)ceil(pct * total / 100.0);
+	if (rank == 0)
+		rank = 1;
+
+	for (n = 0; n < RTTST_PHASE_BUCKETS - 1; n++) {
+		hits += counts[n];
+		if (hits >= rank)
+			break;
+	}
+
+	return n ? (1UL << n) - 1 : 0;
+}
+
+/*
+ * Per-phase figures, from the due date to the sampling code. The
+ * worst column breaks down the worst latency observed, telling which
+ * phase made it. Percentiles are upper bounds, phases being
+ * recorded in log2-scaled histograms.
+ */
+void dump_phases(void)
+{
+	struct rttst_phase_stats *st = &phases;
+	int i, n, nr_phases;
+
+	nr_phases = test_mode == TIMER_HANDLER ?
+		RTTST_PHASE_SWITCH : RTTST_NR_PHASES;
+
+	if (st->samples == 0) {
+		printf("PHW| no sample broken down, %llu skipped\n",
+		       st->skipped);
+		return;
+	}
+
+	printf("PHH|--phase|--samples-|----avg----|----p99----|----max----|---worst---\n");
+	for (i = 0; i < nr_phases; i++)
+		printf("PHS|%7s|%10llu|%11.3f|%11.3f|%11.3f|%11.3f\n",
+		       phase_names[i], st->samples,
+		       (double)st->sum[i] / st->samples / 1000,
+		       phase_percentile(st->counts[i], st->samples, 99) / 1000.0,
+		       st->max[i] / 1000.0,
+		       st->worst_phases[i] / 1000.0);
+
+	printf("PHW| worst latency %.3f, %llu samples skipped\n",
+	       st->worst / 1000.0, st->skipped);
+
+	if (!do_histogram)
+		return;
+
+	printf("---|--phase|-----range-----|--samples\n");
+	for (i = 0; i < nr_phases; i++)
+		for (n = 0; n < RTTST_PHASE_BUCKETS; n++)
+			if (st->counts[i][n])
+				printf("PHD|%7s| <%12.3f | %8llu\n",
+				       phase_names[i], (1ULL << n) / 1000.0,
+				       st->counts[i][n]);
+}
+
+/*
+ * The smallest latency observed is what the timer shots may still be
+ * anticipated by for the wakeup class of the test mode, without ever
+ * releasing the measuring code early under the test conditions.
+ */
+static void update_gravity(long gminj)
+{
+	const char *class = gravity_classes[test_mode];
+	unsigned long cur = 0, val;
+	char line[64], name[16];
+	long new;
+	FILE *fp;
+
+	fp = fopen(GRAVITY_PROC, "r");
+	if (fp == NULL) {
+		perror("latency: " GRAVITY_PROC);
+		return;
+	}
+
+	while (fgets(line, sizeof(line), fp))
+		if (sscanf(line, "%15[^=]=%lu", name, &val) == 2 &&
+		    strcmp(name, class) == 0)
+			cur = val;
+
+	fclose(fp);
+
+	new = (long)cur + gminj;
+	if (new < 0)
+		new = 0;
+
+	fp = fopen(GRAVITY_PROC, "w");
+	if (fp == NULL || fprintf(fp, "%s=%ld\n", class, new) < 0 ||
+	    fclose(fp)) {
+		perror("latency: " GRAVITY_PROC);
+		return;
+	}
+
+	printf("== %s gravity: %lu -> %ld ns\n", class, cur, new);
+}
+
+static int cache_cpu_p(int cpu)
+{
+	if (all_cpus)
+		return cpu < nr_samplers;
+
+	if (samplers[0].cpu >= 0)
+		return cpu == samplers[0].cpu;
+
+	return cpu < sysconf(_SC_NPROCESSORS_ONLN);
+}
+
+static int set_cache_class(int cpu, int clos)
+{
+	FILE *fp;
+
+	fp = fopen(CACHEPART_PROC, "w");
+	if (fp == NULL || fprintf(fp, "cpu %d %d\n", cpu, clos) < 0 ||
+	    fclose(fp)) {
+		perror("latency: " CACHEPART_PROC);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void setup_cache_class(void)
+{
+	int cpu, in_cpus = 0;
+	char line[64], val[16];
+	FILE *fp;
+
+	for (cpu = 0; cpu < MAX_SAMPLERS; cpu++)
+		cache_saved[cpu] = -1;
+
+	fp = fopen(CACHEPART_PROC, "r");
+	if (fp == NULL) {
+		perror("latency: " CACHEPART_PROC);
+		exit(2);
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		if (strncmp(line, "CPU", 3) == 0)
+			in_cpus = 1;
+		else if (in_cpus && sscanf(line, "%d %15s", &cpu, val) == 2 &&
+			 cpu >= 0 && cpu < MAX_SAMPLERS)
+			cache_saved[cpu] = strcmp(val, "-") ? atoi(val) : -1;
+	}
+
+	fclose(fp);
+
+	for (cpu = 0; cpu < MAX_SAMPLERS; cpu++)
+		if (cache_cpu_p(cpu) && set_cache_class(cpu, cache_class))
+			exit(2);
+
+	printf("== Cache class: %d\n", cache_class);
+}
+
+static void restore_cache_class(void)
+{
+	int cpu;
+
+	for (cpu = 0; cpu < MAX_SAMPLERS; cpu++)
+		if (cache_cpu_p(cpu))
+			set_cache_class(cpu, cache_saved[cpu]);
+}
+
 void cleanup(void)
 {
 	time_t actual_duration;
@@ -428,12 +812,21 @@ void cleanup(void)
 
 		rt_dev_ioctl(benchdev, RTTST_RTIOC_TMBENCH_STOP, &overall);
 
+		if (need_hdr() &&
+		    rt_dev_ioctl(benchdev, RTTST_RTIOC_TMBENCH_GET_HDR,
+				 &samplers[0].hdr) < 0)
+			memset(&samplers[0].hdr, 0, sizeof(samplers[0].hdr));
+
 		gminj = overall.result.min;
 		gmaxj = overall.result.max;
 		gavgj = overall.result.avg;
 		goverrun = overall.result.overruns;
 	}
 
+	if (do_phases &&
+	    rt_dev_ioctl(benchdev, RTTST_RTIOC_TMBENCH_GET_PHASES, &phases) == 0)
+		have_phases = 1;
+
 	if (benchdev >= 0)
 		rt_dev_close(benchdev);
 
@@ -457,6 +850,18 @@ void cleanup(void)
 "Warning! some latency maxima may have been due to involuntary mode switches.\n"
 "Please contact xenomai@xenomai.org\n");
 
+	if (have_phases)
+		dump_phases();
+
+	if (need_hdr())
+		dump_hdr(gminj, gmaxj);
+
+	if (tune_gravity)
+		update_gravity(gminj);
+
+	if (cache_class >= 0)
+		restore_cache_class();
+
 	if (histogram_avg)
 		free(histogram_avg);
 	if (histogram_max)
@@ -531,12 +936,12 @@ void sigdebug(int sig, siginfo_t *si, void *context)
 
 int main(int argc, char **argv)
 {
-	int cpu = 0, c, err, sig;
+	int cpu = 0, cpu_no = -1, c, err, sig, i;
 	struct sigaction sa;
-	char task_name[16];
+	char task_name[XNOBJECT_NAME_LEN];
 	sigset_t mask;
 
-	while ((c = getopt(argc, argv, "g:hp:l:T:qH:B:sD:t:fc:P:b")) != EOF)
+	while ((c = getopt(argc, argv, "g:hp:l:T:qH:B:sD:t:fc:P:bO:ArGL:d")) != EOF)
 		switch (c) {
 		case 'g':
 			do_gnuplot = strdup(optarg);
@@ -599,7 +1004,8 @@ int main(int argc, char **argv)
 			break;
 
 		case 'c':
-			cpu = T_CPU(atoi(optarg));
+			cpu_no = atoi(optarg);
+			cpu = T_CPU(cpu_no);
 			break;
 
 		case 'P':
@@ -610,6 +1016,30 @@ int main(int argc, char **argv)
 			stop_upon_switch = 1;
 			break;
 
+		case 'O':
+			hdr_format = optarg;
+			break;
+
+		case 'A':
+			all_cpus = 1;
+			break;
+
+		case 'r':
+			prerelease = 1;
+			break;
+
+		case 'G':
+			tune_gravity = 1;
+			break;
+
+		case 'L':
+			cache_class = atoi(optarg);
+			break;
+
+		case 'd':
+			do_phases = 1;
+			break;
+
 		default:
 
 			fprintf(stderr,
@@ -629,6 +1059,12 @@ int main(int argc, char **argv)
 "  [-c <cpu>]                   # pin measuring task down to given CPU\n"
 "  [-P <priority>]              # task priority (test mode 0 and 1 only)\n"
 "  [-b]                         # break upon mode switch\n"
+"  [-O <json|csv>]              # report latency percentiles in given format\n"
+"  [-A]                         # one measuring task per CPU (test mode 0 only)\n"
+"  [-r]                         # pre-release periodic wakeups (test mode 0 only)\n"
+"  [-G]                         # tune the timer gravity of the test mode on exit\n"
+"  [-L <class>]                 # run the measuring CPUs in the given cache class\n"
+"  [-d]                         # break latencies down into phases on exit\n"
 );
 			exit(2);
 		}
@@ -644,6 +1080,41 @@ int main(int argc, char **argv)
 		exit(2);
 	}
 
+	if (hdr_format && strcmp(hdr_format, "json") &&
+	    strcmp(hdr_format, "csv")) {
+		fprintf(stderr, "latency: invalid output format.\n");
+		exit(2);
+	}
+
+	if (all_cpus) {
+		if (test_mode != USER_TASK) {
+			fprintf(stderr,
+				"latency: -A only works in test mode 0.\n");
+			exit(2);
+		}
+		nr_samplers = sysconf(_SC_NPROCESSORS_ONLN);
+		if (nr_samplers > MAX_SAMPLERS)
+			nr_samplers = MAX_SAMPLERS;
+		if (nr_samplers < 1)
+			nr_samplers = 1;
+	}
+
+	if (prerelease && test_mode != USER_TASK) {
+		fprintf(stderr, "latency: -r only works in test mode 0.\n");
+		exit(2);
+	}
+
+	if (prerelease && tune_gravity) {
+		fprintf(stderr, "latency: -G cannot be used with -r.\n");
+		exit(2);
+	}
+
+	for (i = 0; i < nr_samplers; i++) {
+		samplers[i].cpu = all_cpus ? i : cpu_no;
+		samplers[i].minj = TEN_MILLION;
+		samplers[i].maxj = -TEN_MILLION;
+	}
+
 	time(&test_start);
 
 	histogram_avg = calloc(histogram_size, sizeof(long));
@@ -683,13 +1154,17 @@ int main(int argc, char **argv)
 	setlinebuf(stdout);
 
 	printf("== Sampling period: %Ld us\n"
-	       "== Test mode: %s\n"
+	       "== Test mode: %s%s\n"
 	       "== All results in microseconds\n",
-	       period_ns / 1000, test_mode_names[test_mode]);
+	       period_ns / 1000, test_mode_names[test_mode],
+	       prerelease ? ", pre-released" : "");
 
 	mlockall(MCL_CURRENT | MCL_FUTURE);
 
-	if (test_mode != USER_TASK) {
+	if (cache_class >= 0)
+		setup_cache_class();
+
+	if (test_mode != USER_TASK || do_phases) {
 		char devname[RTDM_MAX_DEVNAME_LEN];
 
 		snprintf(devname, RTDM_MAX_DEVNAME_LEN, "rttest-timerbench%d",
@@ -702,6 +1177,14 @@ int main(int argc, char **argv)
 				"(modprobe xeno_timerbench?)\n", benchdev);
 			return 0;
 		}
+
+		if (do_phases &&
+		    rt_dev_ioctl(benchdev, RTTST_RTIOC_TMBENCH_GET_PHASES,
+				 &phases) < 0) {
+			fprintf(stderr,
+				"latency: -d requires CONFIG_XENO_OPT_STATS_PHASES\n");
+			exit(2);
+		}
 	}
 
 	rt_timer_set_mode(TM_ONESHOT);	/* Force aperiodic timing. */
@@ -725,10 +1208,18 @@ int main(int argc, char **argv)
 		return 0;
 	}
 
-	if (test_mode == USER_TASK) {
-		snprintf(task_name, sizeof(task_name), "sampling-%d", getpid());
+	for (i = 0; test_mode == USER_TASK && i < nr_samplers; i++) {
+		struct sampler *s = &samplers[i];
+
+		if (all_cpus) {
+			snprintf(task_name, sizeof(task_name), "sampling-%d.%d",
+				 getpid(), s->cpu);
+			cpu = T_CPU(s->cpu);
+		} else
+			snprintf(task_name, sizeof(task_name), "sampling-%d",
+				 getpid());
 		err =
-		    rt_task_create(&latency_task, task_name, 0, priority,
+		    rt_task_create(&s->task, task_name, 0, priority,
 				   T_FPU | cpu | T_WARNSW);
 
 		if (err) {
@@ -738,7 +1229,7 @@ int main(int argc, char **argv)
 			return 0;
 		}
 
-		err = rt_task_start(&latency_task, &latency, NULL);
+		err = rt_task_start(&s->task, &latency, s);
 
 		if (err) {
 			fprintf(stderr,
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <stddef.h>
 
 #include <sched.h>
 #include <signal.h>
@@ -91,6 +92,18 @@ static pthread_mutex_t headers_lock;
 static unsigned long data_lines = 21;
 static unsigned freeze_on_error;
 
+#define FPU_STAT_PROC	"/proc/xenomai/fpustat"
+#define FPU_POLICY_PARM	"/sys/module/xeno_nucleus/parameters/fpu_eager"
+
+struct fpu_stats {
+	unsigned long saves;
+	unsigned long restores;
+	unsigned long faults;
+	unsigned long inits;
+};
+
+static int fpu_policy = -1, saved_fpu_policy = -1;
+
 static inline void clean_exit(int retval)
 {
 	status = retval;
@@ -113,6 +126,82 @@ static void timespec_substract(struct timespec *result,
 	}
 }
 
+/* Sum up the FPU switch counters of all CPUs. */
+static int read_fpu_stats(struct fpu_stats *stats)
+{
+	struct fpu_stats row;
+	char line[128];
+	FILE *fp;
+	int cpu;
+
+	fp = fopen(FPU_STAT_PROC, "r");
+	if (fp == NULL)
+		return -1;
+
+	memset(stats, 0, sizeof(*stats));
+
+	while (fgets(line, sizeof(line), fp))
+		if (sscanf(line, "%d %lu %lu %lu %lu", &cpu, &row.saves,
+			   &row.restores, &row.faults, &row.inits) == 5) {
+			stats->saves += row.saves;
+			stats->restores += row.restores;
+			stats->faults += row.faults;
+			stats->inits += row.inits;
+		}
+
+	fclose(fp);
+
+	return 0;
+}
+
+static int access_fpu_policy(int *policy, int set)
+{
+	FILE *fp;
+	int ret;
+
+	fp = fopen(FPU_POLICY_PARM, set ? "w" : "r");
+	if (fp == NULL)
+		return -1;
+
+	if (set)
+		ret = fprintf(fp, "%d\n", *policy) > 0 ? 0 : -1;
+	else
+		ret = fscanf(fp, "%d", policy) == 1 ? 0 : -1;
+
+	if (fclose(fp))
+		ret = -1;
+
+	return ret;
+}
+
+static void display_fpu_stats(const struct fpu_stats *before,
+			      unsigned long switches,
+			      const struct timespec *elapsed)
+{
+	struct fpu_stats after;
+	double dt, rate;
+	int policy;
+
+	if (read_fpu_stats(&after))
+		return;
+
+	if (access_fpu_policy(&policy, 0))
+		policy = fpu_policy;
+
+	dt = elapsed->tv_sec + elapsed->tv_nsec / 1e9;
+	rate = dt > 0 ? switches / dt : 0;
+
+	printf("FPH|%12s|%12s|%12s|%12s|%12s|%12s\n", "-------policy",
+	       "-------saves", "----restores", "------faults", "-------inits",
+	       "ctx switch/s");
+	printf("FPD|%12s|%12lu|%12lu|%12lu|%12lu|%12.0f\n",
+	       policy > 0 ? "eager" : "lazy",
+	       after.saves - before->saves,
+	       after.restores - before->restores,
+	       after.faults - before->faults,
+	       after.inits - before->inits, rate);
+}
+
 static char *task_name(char *buf, size_t sz,
 		       struct cpu_tasks *cpu, unsigned task)
 {
@@ -933,6 +1022,141 @@ static int open_rttest(char *buf, size_t size, unsigned count)
 	return fd;
 }
 
+struct xcpu_result {
+	unsigned long long p50, p99, max;	/* One-way wakeup, ns. */
+	unsigned long long half_rtt;		/* Average round trip / 2, ns. */
+	int valid;
+};
+
+static unsigned long long hdr_percentile(const struct rttst_hdr_histogram *hdr,
+					 unsigned permille)
+{
+	unsigned long long hits = 0, rank;
+	unsigned n;
+
+	rank = (hdr->total * permille + 999) / 1000;
+	if (rank == 0)
+		rank = 1;
+
+	for (n = 0; n < RTTST_HDR_BUCKETS; n++) {
+		hits += hdr->counts[n];
+		if (hits >= rank)
+			return rttst_hdr_value(n);
+	}
+
+	return 0;
+}
+
+static void xcpu_print_matrix(const char *title, struct xcpu_result *res,
+			      unsigned nr_cpus, size_t offset)
+{
+	unsigned from, to;
+
+	printf("%-10s", title);
+	for (to = 0; to < nr_cpus; to++)
+		printf(" %8s%-3u", "to cpu", to);
+	printf("\n");
+
+	for (from = 0; from < nr_cpus; from++) {
+		printf("from cpu%-2u", from);
+		for (to = 0; to < nr_cpus; to++) {
+			struct xcpu_result *r = &res[from * nr_cpus + to];
+			unsigned long long ns;
+
+			if (!r->valid) {
+				printf(" %11s", "-");
+				continue;
+			}
+			ns = *(unsigned long long *)((char *)r + offset);
+			printf(" %11.3f", ns / 1000.0);
+		}
+		printf("\n");
+	}
+	printf("\n");
+}
+
+/*
+ * Ping-pong between kernel tasks pinned on every pair of CPUs, and
+ * print the wakeup latency matrices. Waking up a task on another CPU
+ * goes through the reschedule IPI, the diagonal gives the local
+ * wakeup cost for reference.
+ */
+static int xcpu_bench(unsigned nr_cpus, unsigned long count,
+		      unsigned long period_us)
+{
+	struct rttst_hdr_histogram *hdr;
+	struct rttst_swtest_xcpu xcpu;
+	char devname[RTDM_MAX_DEVNAME_LEN+1];
+	struct xcpu_result *res, *r;
+	unsigned from, to;
+	int fd, ret = EXIT_SUCCESS;
+
+	res = calloc(nr_cpus * nr_cpus, sizeof(*res));
+	hdr = malloc(sizeof(*hdr));
+	if (res == NULL || hdr == NULL) {
+		perror("malloc");
+		return EXIT_FAILURE;
+	}
+
+	fd = open_rttest(devname, sizeof(devname), 1);
+	if (fd == -1) {
+		ret = EXIT_FAILURE;
+		goto out;
+	}
+
+	printf("== Cross-CPU wakeups, %lu round trips per CPU pair", count);
+	if (period_us)
+		printf(", every %lu us", period_us);
+	printf("\n");
+
+	for (from = 0; from < nr_cpus; from++)
+		for (to = 0; to < nr_cpus; to++) {
+			r = &res[from * nr_cpus + to];
+
+			memset(&xcpu, 0, sizeof(xcpu));
+			xcpu.from_cpu = from;
+			xcpu.to_cpu = to;
+			xcpu.count = count;
+			xcpu.period_us = period_us;
+
+			if (ioctl(fd, RTTST_RTIOC_SWTEST_XCPU_RUN, &xcpu)) {
+				fprintf(stderr, "switchtest: cpu%u -> cpu%u: "
+					"%s\n", from, to, strerror(errno));
+				ret = EXIT_FAILURE;
+				continue;
+			}
+
+			if (xcpu.count == 0 ||
+			    ioctl(fd, RTTST_RTIOC_SWTEST_XCPU_GET_HDR, hdr))
+				continue;
+
+			r->p50 = hdr_percentile(hdr, 500);
+			r->p99 = hdr_percentile(hdr, 990);
+			r->max = hdr_percentile(hdr, 1000);
+			r->half_rtt = xcpu.rtt_sum / xcpu.count / 2;
+			r->valid = 1;
+		}
+
+	close(fd);
+
+	printf("== One-way wakeup latency (us), assuming synchronized TSCs\n");
+	xcpu_print_matrix("median", res, nr_cpus,
+			  offsetof(struct xcpu_result, p50));
+	xcpu_print_matrix("99th", res, nr_cpus,
+			  offsetof(struct xcpu_result, p99));
+	xcpu_print_matrix("max", res, nr_cpus,
+			  offsetof(struct xcpu_result, max));
+	printf("== Average round trip / 2 (us)\n");
+	xcpu_print_matrix("average", res, nr_cpus,
+			  offsetof(struct xcpu_result, half_rtt));
+
+  out:
+	free(hdr);
+	free(res);
+
+	return ret;
+}
+
 const char *all_nofp [] = {
 	"rtk",
 	"rtk",
@@ -1018,7 +1242,18 @@ void usage(FILE *fd, const char *progname)
 		"--stress <period> or -s <period> enable a stress mode where:\n"
 		"  context switches occur every <period> us;\n"
 		"  a background task uses fpu (and check) fpu all the time.\n"
-		"--freeze trace upon error.\n\n"
+		"--freeze trace upon error.\n"
+		"--fpu-policy <eager|lazy> or -p <eager|lazy>, select the "
+		"nucleus FPU switching\npolicy for the test duration; the "
+		"FPU switch events and the context\nswitch rate are reported "
+		"upon exit.\n"
+		"--xcpu <count> or -x <count>, instead of switching contexts, "
+		"measure the time\nit takes to wake up a kernel-space task "
+		"from every CPU to every other\nCPU, over <count> round trips "
+		"per CPU pair, and print the latency\nmatrices;\n"
+		"--xcpu-period <period> or -i <period>, pause <period> us "
+		"between the round trips\nof --xcpu, so that the woken CPU "
+		"goes idle.\n\n"
 		"Each 'threadspec' specifies the characteristics of a "
 		"thread to be created:\n"
 		"threadspec = (rtk|rtup|rtus|rtuo)(_fp|_ufpp|_ufps)*[0-9]*\n"
@@ -1117,11 +1352,16 @@ int check_fpu(void)
 int main(int argc, const char *argv[])
 {
 	unsigned i, j, nr_cpus, use_fp = 1, stress = 0;
+	unsigned long xcpu_count = 0, xcpu_period = 0;
 	pthread_attr_t rt_attr;
 	const char *progname = argv[0];
 	struct cpu_tasks *cpus;
 	struct sched_param sp;
 	char devname[RTDM_MAX_DEVNAME_LEN+1];
+	struct fpu_stats fpu_start;
+	unsigned long switches = 0;
+	struct timespec elapsed = { 0, 0 };
+	int fpu_stats_p = 0;
 	sigset_t mask;
 	int sig;
 
@@ -1162,13 +1402,16 @@ int main(int argc, const char *argv[])
 			{ "help",    0, NULL, 'h' },
 			{ "lines",   1, NULL, 'l' },
 			{ "nofpu",   0, NULL, 'n' },
+			{ "fpu-policy", 1, NULL, 'p' },
 			{ "quiet",   0, NULL, 'q' },
 			{ "stress",  1, NULL, 's' },
 			{ "timeout", 1, NULL, 'T' },
+			{ "xcpu",    1, NULL, 'x' },
+			{ "xcpu-period", 1, NULL, 'i' },
 			{ NULL,      0, NULL, 0   }
 		};
 		int i = 0;
-		int c = getopt_long(argc, (char *const *) argv, "fhl:nqs:T:",
+		int c = getopt_long(argc, (char *const *) argv, "fhi:l:np:qs:T:x:",
 				    long_options, &i);
 
 		if (c == -1)
@@ -1191,6 +1434,19 @@ int main(int argc, const char *argv[])
 			use_fp = 0;
 			break;
 
+		case 'p':
+			if (!strcmp(optarg, "eager"))
+				fpu_policy = 1;
+			else if (!strcmp(optarg, "lazy"))
+				fpu_policy = 0;
+			else {
+				usage(stderr, progname);
+				fprintf(stderr, "Invalid FPU policy %s.\n",
+					optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
+
 		case 'q':
 			quiet = 1;
 			break;
@@ -1203,6 +1459,14 @@ int main(int argc, const char *argv[])
 			alarm(xatoul(optarg));
 			break;
 
+		case 'x':
+			xcpu_count = xatoul(optarg);
+			break;
+
+		case 'i':
+			xcpu_period = xatoul(optarg);
+			break;
+
 		case '?':
 			usage(stderr, progname);
 			fprintf(stderr, "%s: Invalid option.\n", argv[optind-1]);
@@ -1221,6 +1485,9 @@ int main(int argc, const char *argv[])
 		exit(EXIT_FAILURE);
 	}
 
+	if (xcpu_count)
+		exit(xcpu_bench(nr_cpus, xcpu_count, xcpu_period));
+
 	/* If no argument was passed (or only -n), replace argc and argv with
 	   default values, given by all_fp or all_nofp depending on the presence
 	   of the -n flag. */
@@ -1411,6 +1678,17 @@ int main(int argc, const char *argv[])
 	}
 	printf("\n");
 
+	if (fpu_policy >= 0) {
+		if (access_fpu_policy(&saved_fpu_policy, 0) ||
+		    access_fpu_policy(&fpu_policy, 1)) {
+			perror("switchtest: cannot set the FPU policy");
+			saved_fpu_policy = -1;
+			goto failure;
+		}
+	}
+
+	fpu_stats_p = read_fpu_stats(&fpu_start) == 0;
+
 	clock_gettime(CLOCK_REALTIME, &start);
 
 	/* Start the sleeper tasks. */
@@ -1455,6 +1733,8 @@ int main(int argc, const char *argv[])
 
 			quiet = 0;
 			display_switches_count(&cpus[i], &now);
+			switches += cpus[i].last_switches_count;
+			timespec_substract(&elapsed, &now, &start);
 
 			/* Kill the kernel-space tasks. */
 			close(cpus[i].fd);
@@ -1462,6 +1742,13 @@ int main(int argc, const char *argv[])
 		free(cpu->tasks);
 	}
 	free(cpus);
+
+	if (fpu_stats_p && switches)
+		display_fpu_stats(&fpu_start, switches, &elapsed);
+
+	if (saved_fpu_policy >= 0)
+		access_fpu_policy(&saved_fpu_policy, 1);
+
 	__real_sem_destroy(&sleeper_start);
 	__real_pthread_mutex_destroy(&headers_lock);
 
@@ -0,0 +1,1046 @@
+/*
+ * Synchronization benchmark: throughput and handoff latency of the
+ * real-time locking services under contention, swept over thread
+ * counts, critical section lengths and CPU spreads, optionally with
+ * threads preempting the lock holders.
+ *
+ * Released under the terms of GPLv2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <xeno_config.h>
+#include <native/timer.h>
+#include <native/mutex.h>
+#include <native/sem.h>
+#include <native/event.h>
+
+#ifdef HAVE_RECENT_SETAFFINITY
+#define do_sched_setaffinity(pid,len,mask) sched_setaffinity(pid,len,mask)
+#else /* !HAVE_RECENT_SETAFFINITY */
+#ifdef HAVE_OLD_SETAFFINITY
+#define do_sched_setaffinity(pid,len,mask) sched_setaffinity(pid,mask)
+#else /* !HAVE_OLD_SETAFFINITY */
+#ifndef __cpu_set_t_defined
+typedef unsigned long cpu_set_t;
+#endif
+#define do_sched_setaffinity(pid,len,mask) 0
+#ifndef CPU_ZERO
+#define	 CPU_ZERO(set)		do { *(set) = 0; } while(0)
+#define	 CPU_SET(n,set)	do { *(set) |= (1 << n); } while(0)
+#endif
+#endif /* HAVE_OLD_SETAFFINITY */
+#endif /* HAVE_RECENT_SETAFFINITY */
+
+#define MAX_CPUS	64
+#define MAX_THREADS	32	/* One event bit per thread. */
+
+#define SYNCHSTAT	"/proc/xenomai/synchstat"
+
+enum placement {
+	PLACE_SAME,	/* All threads on a single CPU. */
+	PLACE_SPREAD,	/* Threads spread over the online CPUs. */
+	PLACE_MAX
+};
+
+static const char *place_names[PLACE_MAX] = {
+	[PLACE_SAME] = "same",
+	[PLACE_SPREAD] = "spread",
+};
+
+enum scenario {
+	SCEN_NONE,	/* Contention only. */
+	SCEN_PREEMPT,	/* Higher priority threads preempt the holders. */
+	SCEN_INVERSION,	/* Mixed priorities, medium priority hogs. */
+	SCEN_MAX
+};
+
+static const char *scen_names[SCEN_MAX] = {
+	[SCEN_NONE] = "none",
+	[SCEN_PREEMPT] = "preempt",
+	[SCEN_INVERSION] = "inversion",
+};
+
+struct worker;
+
+struct primitive {
+	const char *name;
+	int (*init)(int nr_threads);
+	void (*destroy)(void);
+	int (*lock)(struct worker *w);
+	int (*unlock)(struct worker *w);
+};
+
+struct worker {
+	int index;
+	int cpu;
+	int prio;
+	pthread_t tid;
+	pid_t pid;
+	const struct primitive *prim;
+	int err;
+	unsigned long ops;
+	unsigned long handoffs;
+	unsigned long long handoff_tsc;
+};
+
+struct interferer {
+	int cpu;
+	int prio;
+	pthread_t tid;
+};
+
+struct synchstat {
+	unsigned long slow;	/* Acquisitions and waits in the nucleus. */
+	unsigned long boosts;
+};
+
+struct result {
+	const char *prim;
+	enum scenario scen;
+	enum placement place;
+	int nr_threads;
+	unsigned long cs;
+	double rate;
+	double fast_pct;	/* < 0 if unknown. */
+	double handoff_ns;
+	long boosts;		/* < 0 if unknown. */
+};
+
+static int online[MAX_CPUS];
+static int nr_cpus;
+
+static int threads[16] = { 2, 4, 8 };
+static int nr_threads_list = 3;
+static unsigned long cs_lengths[16] = { 0, 1000, 10000 };
+static int nr_cs = 3;
+
+static const char *prim_list;	/* Comma-separated, all if NULL. */
+static int places = (1 << PLACE_MAX) - 1;
+static int scens = 1 << SCEN_NONE;
+static unsigned long gap = 1000;	/* ns, outside the critical section. */
+static unsigned long duration = 1;	/* s */
+static unsigned long period = 1000;	/* us, interferer period. */
+static unsigned long burst = 100;	/* us, interferer busy time. */
+static int prio = 50;
+static const char *format;	/* json, csv or text if NULL. */
+static const char *baseline;	/* Results of a previous run (csv). */
+static double threshold = 10;	/* % of throughput loss. */
+static int nr_results, nr_regressions;
+
+/* Shared state, only updated by the lock holder. */
+static unsigned long long release_tsc;
+static int holder;
+
+static volatile int stop;
+static unsigned long long cs_tsc, gap_tsc, burst_tsc;
+
+static RT_SEM start_gate, exit_gate;
+
+static struct {
+	char key[128];
+	double rate;
+} base[256];
+
+static int nr_base;
+
+/* rt_mutex, always priority inheriting. */
+
+static RT_MUTEX mutex;
+
+static int mutex_init(int nr_threads)
+{
+	return rt_mutex_create(&mutex, NULL);
+}
+
+static void mutex_destroy(void)
+{
+	rt_mutex_delete(&mutex);
+}
+
+static int mutex_lock(struct worker *w)
+{
+	return rt_mutex_acquire(&mutex, TM_INFINITE);
+}
+
+static int mutex_unlock(struct worker *w)
+{
+	return rt_mutex_release(&mutex);
+}
+
+/* POSIX mutexes, without and with priority inheritance. */
+
+static pthread_mutex_t pmutex;
+
+static int pmutex_create(int protocol)
+{
+	pthread_mutexattr_t attr;
+	int ret;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_setprotocol(&attr, protocol);
+	ret = -pthread_mutex_init(&pmutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+
+	return ret;
+}
+
+static int pmutex_init(int nr_threads)
+{
+	return pmutex_create(PTHREAD_PRIO_NONE);
+}
+
+static int pimutex_init(int nr_threads)
+{
+	return pmutex_create(PTHREAD_PRIO_INHERIT);
+}
+
+static void pmutex_destroy(void)
+{
+	pthread_mutex_destroy(&pmutex);
+}
+
+static int pmutex_lock(struct worker *w)
+{
+	return -pthread_mutex_lock(&pmutex);
+}
+
+static int pmutex_unlock(struct worker *w)
+{
+	return -pthread_mutex_unlock(&pmutex);
+}
+
+/* rt_sem used as a binary lock. */
+
+static RT_SEM sem;
+
+static int sem_init(int nr_threads)
+{
+	return rt_sem_create(&sem, NULL, 1, S_PRIO);
+}
+
+static void sem_destroy(void)
+{
+	rt_sem_delete(&sem);
+}
+
+static int sem_lock(struct worker *w)
+{
+	return rt_sem_p(&sem, TM_INFINITE);
+}
+
+static int sem_unlock(struct worker *w)
+{
+	return rt_sem_v(&sem);
+}
+
+/*
+ * rt_event: a token passed around a ring, each thread waits for its
+ * own bit and signals the bit of the next one.
+ */
+
+static RT_EVENT event;
+static int event_threads;
+
+static int event_init(int nr_threads)
+{
+	event_threads = nr_threads;
+
+	return rt_event_create(&event, NULL, 1, EV_PRIO);
+}
+
+static void event_destroy(void)
+{
+	rt_event_delete(&event);
+}
+
+static int event_lock(struct worker *w)
+{
+	unsigned long bit = 1UL << w->index, mask;
+	int ret;
+
+	ret = rt_event_wait(&event, bit, &mask, EV_ALL, TM_INFINITE);
+	if (ret)
+		return ret;
+
+	return rt_event_clear(&event, bit, NULL);
+}
+
+static int event_unlock(struct worker *w)
+{
+	return rt_event_signal(&event, 1UL << ((w->index + 1) % event_threads));
+}
+
+static const struct primitive primitives[] = {
+	{ "mutex", mutex_init, mutex_destroy, mutex_lock, mutex_unlock },
+	{ "pmutex", pmutex_init, pmutex_destroy, pmutex_lock, pmutex_unlock },
+	{ "pimutex", pimutex_init, pmutex_destroy, pmutex_lock, pmutex_unlock },
+	{ "sem", sem_init, sem_destroy, sem_lock, sem_unlock },
+	{ "event", event_init, event_destroy, event_lock, event_unlock },
+	{ NULL }
+};
+
+static void read_topology(void)
+{
+	char path[64];
+	FILE *fp;
+	int cpu, val;
+
+	for (cpu = 0; cpu < MAX_CPUS; cpu++) {
+		snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+		if (access(path, F_OK))
+			continue;
+
+		/* The boot CPU usually has no online switch. */
+		val = 1;
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/cpu/cpu%d/online", cpu);
+		fp = fopen(path, "r");
+		if (fp) {
+			if (fscanf(fp, "%d", &val) != 1)
+				val = 1;
+			fclose(fp);
+		}
+
+		online[cpu] = val;
+		if (val)
+			nr_cpus = cpu + 1;
+	}
+
+	/* No sysfs, assume a single CPU. */
+	if (nr_cpus == 0) {
+		online[0] = 1;
+		nr_cpus = 1;
+	}
+}
+
+/* Returns the n-th online CPU, counting modulo the online CPUs. */
+static int nth_cpu(int n)
+{
+	int cpu, count = 0;
+
+	for (cpu = 0; cpu < nr_cpus; cpu++)
+		count += online[cpu];
+
+	n %= count;
+
+	for (cpu = 0; cpu < nr_cpus; cpu++)
+		if (online[cpu] && n-- == 0)
+			break;
+
+	return cpu;
+}
+
+static int set_affinity(int cpu)
+{
+	cpu_set_t cpus;
+
+	CPU_ZERO(&cpus);
+
+	if (cpu < 0) {
+		for (cpu = 0; cpu < nr_cpus; cpu++)
+			if (online[cpu])
+				CPU_SET(cpu, &cpus);
+	} else
+		CPU_SET(cpu, &cpus);
+
+	return do_sched_setaffinity(0, sizeof(cpus), &cpus);
+}
+
+static inline void busy(unsigned long long tsc)
+{
+	unsigned long long end = rt_timer_tsc() + tsc;
+
+	while (rt_timer_tsc() < end)
+		;
+}
+
+/*
+ * Sleep from primary mode, Linux may not get a chance to run until
+ * the workers are done.
+ */
+static void rt_sleep(unsigned long sec, unsigned long nsec)
+{
+	struct timespec ts;
+
+	ts.tv_sec = sec;
+	ts.tv_nsec = nsec;
+	clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, NULL);
+}
+
+static void *worker(void *arg)
+{
+	struct worker *w = arg;
+	const struct primitive *prim = w->prim;
+	unsigned long long req, acq;
+	char name[32];
+	int ret;
+
+	snprintf(name, sizeof(name), "synchb-w%d", w->index);
+	pthread_set_name_np(pthread_self(), name);
+	w->pid = syscall(SYS_gettid);
+
+	rt_sem_p(&start_gate, TM_INFINITE);
+
+	while (!stop) {
+		req = rt_timer_tsc();
+		ret = prim->lock(w);
+		if (ret) {
+			w->err = ret;
+			break;
+		}
+		acq = rt_timer_tsc();
+
+		/* Let the token go round for the others to notice. */
+		if (stop) {
+			prim->unlock(w);
+			break;
+		}
+
+		/* Only count the threads which were actually waiting. */
+		if (holder >= 0 && holder != w->index && req < release_tsc) {
+			w->handoffs++;
+			w->handoff_tsc += acq - release_tsc;
+		}
+		w->ops++;
+
+		busy(cs_tsc);
+
+		holder = w->index;
+		release_tsc = rt_timer_tsc();
+		ret = prim->unlock(w);
+		if (ret) {
+			w->err = ret;
+			break;
+		}
+
+		busy(gap_tsc);
+	}
+
+	rt_sem_p(&exit_gate, TM_INFINITE);
+
+	return NULL;
+}
+
+static void *interferer(void *arg)
+{
+	pthread_set_name_np(pthread_self(), "synchb-hog");
+
+	while (!stop) {
+		rt_sleep(period / 1000000, (period % 1000000) * 1000);
+		busy(burst_tsc);
+	}
+
+	return NULL;
+}
+
+static int spawn_on(pthread_t *tid, void *(*body)(void *), void *arg,
+		    int cpu, int tprio)
+{
+	struct sched_param param;
+	pthread_attr_t attr;
+	int ret;
+
+	/* Threads inherit the affinity of their creator. */
+	if (set_affinity(cpu)) {
+		fprintf(stderr, "synchbench: cannot run on CPU%d\n", cpu);
+		return -EINVAL;
+	}
+
+	pthread_attr_init(&attr);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+	param.sched_priority = tprio;
+	pthread_attr_setschedparam(&attr, &param);
+	ret = -pthread_create(tid, &attr, body, arg);
+	pthread_attr_destroy(&attr);
+
+	set_affinity(-1);
+
+	return ret;
+}
+
+static void wait_gate(RT_SEM *gate, int nr)
+{
+	RT_SEM_INFO info;
+
+	for (;;) {
+		if (rt_sem_inquire(gate, &info) || info.nwaiters >= nr)
+			break;
+		rt_sleep(0, 1000000);
+	}
+}
+
+/*
+ * Sum up the nucleus counters of the workers, returns -ENOENT if the
+ * kernel does not provide them (CONFIG_XENO_OPT_STATS_SYNCH).
+ */
+static int read_synchstat(struct worker *workers, int nr,
+			  struct synchstat *st)
+{
+	unsigned long acquires, sleeps, boosts;
+	char line[256], name[64];
+	int cpu, pid, n;
+	FILE *fp;
+
+	fp = fopen(SYNCHSTAT, "r");
+	if (fp == NULL)
+		return -ENOENT;
+
+	memset(st, 0, sizeof(*st));
+
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "%d %d %lu %lu %lu %63s", &cpu, &pid,
+			   &acquires, &sleeps, &boosts, name) != 6)
+			continue;
+		for (n = 0; n < nr; n++)
+			if (workers[n].pid == pid) {
+				st->slow += acquires + sleeps;
+				st->boosts += boosts;
+				break;
+			}
+	}
+
+	fclose(fp);
+
+	return 0;
+}
+
+static const char *result_key(const char *prim, const char *scen,
+			      const char *place, int nr_threads,
+			      unsigned long cs)
+{
+	static char key[128];
+
+	snprintf(key, sizeof(key), "%s,%s,%s,%d,%lu",
+		 prim, scen, place, nr_threads, cs);
+
+	return key;
+}
+
+static void load_baseline(const char *path)
+{
+	char line[256], prim[32], scen[32], place[32];
+	unsigned long cs;
+	int nr_threads;
+	double rate;
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		fprintf(stderr, "synchbench: cannot open %s: %s\n",
+			path, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	while (fgets(line, sizeof(line), fp) &&
+	       nr_base < sizeof(base) / sizeof(base[0])) {
+		if (sscanf(line, "%31[^,],%31[^,],%31[^,],%d,%lu,%lf",
+			   prim, scen, place, &nr_threads, &cs, &rate) != 6)
+			continue;	/* Header. */
+		strcpy(base[nr_base].key,
+		       result_key(prim, scen, place, nr_threads, cs));
+		base[nr_base].rate = rate;
+		nr_base++;
+	}
+
+	fclose(fp);
+}
+
+/* Returns the change in %, or 0 with *found cleared. */
+static double compare(struct result *r, int *found)
+{
+	const char *key;
+	int n;
+
+	key = result_key(r->prim, scen_names[r->scen], place_names[r->place],
+			 r->nr_threads, r->cs);
+
+	for (n = 0; n < nr_base; n++)
+		if (strcmp(base[n].key, key) == 0 && base[n].rate > 0) {
+			*found = 1;
+			return (r->rate - base[n].rate) * 100.0 / base[n].rate;
+		}
+
+	*found = 0;
+
+	return 0;
+}
+
+static void print_header(void)
+{
+	if (format == NULL)
+		printf("%-8s %-9s %-6s %3s %8s %12s %6s %11s %7s%s\n",
+		       "PRIM", "SCENARIO", "PLACE", "THR", "CS(ns)",
+		       "ACQ/S", "FAST%", "HANDOFF(ns)", "BOOSTS",
+		       baseline ? "   DELTA%" : "");
+	else if (strcmp(format, "json") == 0)
+		printf("{\n  \"duration\": %lu,\n  \"gap_ns\": %lu,\n"
+		       "  \"results\": [\n", duration, gap);
+	else
+		printf("primitive,scenario,placement,threads,cs_ns,"
+		       "acq_per_sec,fast_pct,handoff_ns,boosts\n");
+}
+
+static void print_footer(void)
+{
+	if (format && strcmp(format, "json") == 0)
+		printf("\n  ]\n}\n");
+}
+
+static void print_result(struct result *r)
+{
+	double delta = 0;
+	int found = 0;
+
+	if (baseline) {
+		delta = compare(r, &found);
+		if (found && delta < -threshold) {
+			fprintf(stderr, "synchbench: %s: throughput down "
+				"by %.1f%%\n", result_key(r->prim,
+				scen_names[r->scen], place_names[r->place],
+				r->nr_threads, r->cs), -delta);
+			nr_regressions++;
+		}
+	}
+
+	if (format == NULL) {
+		printf("%-8s %-9s %-6s %3d %8lu %12.0f ",
+		       r->prim, scen_names[r->scen], place_names[r->place],
+		       r->nr_threads, r->cs, r->rate);
+		if (r->fast_pct < 0)
+			printf("%6s", "-");
+		else
+			printf("%6.1f", r->fast_pct);
+		printf(" %11.0f ", r->handoff_ns);
+		if (r->boosts < 0)
+			printf("%7s", "-");
+		else
+			printf("%7ld", r->boosts);
+		if (found)
+			printf("   %+6.1f", delta);
+		else if (baseline)
+			printf("   %6s", "-");
+		printf("\n");
+	} else if (strcmp(format, "json") == 0)
+		printf("%s    { \"primitive\": \"%s\", \"scenario\": \"%s\", "
+		       "\"placement\": \"%s\", \"threads\": %d, "
+		       "\"cs_ns\": %lu, \"acq_per_sec\": %.0f, "
+		       "\"fast_pct\": %.1f, \"handoff_ns\": %.0f, "
+		       "\"boosts\": %ld }",
+		       nr_results ? ",\n" : "", r->prim, scen_names[r->scen],
+		       place_names[r->place], r->nr_threads, r->cs, r->rate,
+		       r->fast_pct, r->handoff_ns, r->boosts);
+	else
+		printf("%s,%s,%s,%d,%lu,%.0f,%.1f,%.0f,%ld\n",
+		       r->prim, scen_names[r->scen], place_names[r->place],
+		       r->nr_threads, r->cs, r->rate, r->fast_pct,
+		       r->handoff_ns, r->boosts);
+
+	fflush(stdout);
+	nr_results++;
+}
+
+static void run(const struct primitive *prim, enum scenario scen,
+		enum placement place, int nr_threads, unsigned long cs)
+{
+	struct interferer hogs[MAX_CPUS];
+	struct synchstat st0, st1;
+	int i, ret, nr_spawned = 0, nr_hogs = 0, cpus_used, stats = 0;
+	unsigned long long tsc0 = 0, tsc1 = 0, handoff_tsc = 0;
+	unsigned long ops = 0, handoffs = 0;
+	struct worker *workers;
+	struct result r;
+
+	workers = calloc(nr_threads, sizeof(*workers));
+	if (workers == NULL) {
+		fprintf(stderr, "synchbench: out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	ret = prim->init(nr_threads);
+	if (ret) {
+		fprintf(stderr, "synchbench: %s: cannot create: %s\n",
+			prim->name, strerror(-ret));
+		free(workers);
+		return;
+	}
+
+	rt_sem_create(&start_gate, NULL, 0, S_FIFO);
+	rt_sem_create(&exit_gate, NULL, 0, S_FIFO);
+
+	stop = 0;
+	holder = -1;
+	release_tsc = 0;
+	cs_tsc = rt_timer_ns2tsc(cs);
+	gap_tsc = rt_timer_ns2tsc(gap);
+	burst_tsc = rt_timer_ns2tsc(burst * 1000);
+
+	cpus_used = place == PLACE_SAME ? 1 : nr_threads;
+
+	for (i = 0; i < nr_threads; i++, nr_spawned++) {
+		struct worker *w = &workers[i];
+
+		w->index = i;
+		w->prim = prim;
+		w->cpu = nth_cpu(place == PLACE_SAME ? 0 : i);
+		/* Alternate low and high priority workers. */
+		w->prio = prio;
+		if (scen == SCEN_INVERSION && (i & 1))
+			w->prio = prio + 2;
+
+		ret = spawn_on(&w->tid, worker, w, w->cpu, w->prio);
+		if (ret)
+			break;
+	}
+
+	if (ret == 0 && scen != SCEN_NONE) {
+		/*
+		 * One hog per CPU in use, either above all workers, or
+		 * between the low and high priority ones.
+		 */
+		for (i = 0; i < cpus_used && i < nr_cpus; i++) {
+			struct interferer *h = &hogs[nr_hogs];
+
+			h->cpu = nth_cpu(i);
+			h->prio = scen == SCEN_PREEMPT ? prio + 10 : prio + 1;
+			if (i > 0 && h->cpu == hogs[0].cpu)
+				break;	/* Wrapped around the CPUs. */
+			ret = spawn_on(&h->tid, interferer, NULL,
+				       h->cpu, h->prio);
+			if (ret)
+				break;
+			nr_hogs++;
+		}
+	}
+
+	if (ret) {
+		fprintf(stderr, "synchbench: %s: cannot spawn threads: %s\n",
+			prim->name, strerror(-ret));
+		stop = 1;
+		/* Let the workers through, they will notice the stop. */
+		for (i = 0; i < nr_spawned; i++) {
+			rt_sem_v(&start_gate);
+			rt_sem_v(&exit_gate);
+		}
+		goto join;
+	}
+
+	/* Snapshot the counters once all workers wait for the start. */
+	wait_gate(&start_gate, nr_threads);
+	stats = read_synchstat(workers, nr_threads, &st0) == 0;
+
+	tsc0 = rt_timer_tsc();
+	rt_sem_broadcast(&start_gate);
+
+	rt_sleep(duration, 0);
+
+	stop = 1;
+	tsc1 = rt_timer_tsc();
+
+	wait_gate(&exit_gate, nr_threads);
+	if (stats)
+		stats = read_synchstat(workers, nr_threads, &st1) == 0;
+	rt_sem_broadcast(&exit_gate);
+
+  join:
+	for (i = 0; i < nr_spawned; i++)
+		pthread_join(workers[i].tid, NULL);
+
+	for (i = 0; i < nr_hogs; i++)
+		pthread_join(hogs[i].tid, NULL);
+
+	if (ret)
+		goto cleanup;
+
+	for (i = 0; i < nr_threads; i++) {
+		struct worker *w = &workers[i];
+
+		if (w->err) {
+			fprintf(stderr, "synchbench: %s: worker #%d failed: %s\n",
+				prim->name, i, strerror(-w->err));
+			goto cleanup;
+		}
+
+		ops += w->ops;
+		handoffs += w->handoffs;
+		handoff_tsc += w->handoff_tsc;
+	}
+
+	memset(&r, 0, sizeof(r));
+	r.prim = prim->name;
+	r.scen = scen;
+	r.place = place;
+	r.nr_threads = nr_threads;
+	r.cs = cs;
+	r.rate = ops * 1e9 / rt_timer_tsc2ns(tsc1 - tsc0);
+	r.handoff_ns = handoffs ?
+		(double)rt_timer_tsc2ns(handoff_tsc) / handoffs : 0;
+	r.fast_pct = -1;
+	r.boosts = -1;
+
+	if (stats && ops) {
+		/* Each worker slept once on the exit gate. */
+		unsigned long slow = st1.slow - st0.slow - nr_threads;
+
+		r.fast_pct = slow >= ops ? 0 : 100.0 - slow * 100.0 / ops;
+		r.boosts = st1.boosts - st0.boosts;
+	}
+
+	print_result(&r);
+
+  cleanup:
+	rt_sem_delete(&exit_gate);
+	rt_sem_delete(&start_gate);
+	prim->destroy();
+	free(workers);
+}
+
+static int prim_selected(const struct primitive *prim)
+{
+	size_t len = strlen(prim->name);
+	const char *p = prim_list;
+
+	if (p == NULL)
+		return 1;
+
+	while (p) {
+		if (strncmp(p, prim->name, len) == 0 &&
+		    (p[len] == ',' || p[len] == '\0'))
+			return 1;
+		p = strchr(p, ',');
+		if (p)
+			p++;
+	}
+
+	return 0;
+}
+
+static int parse_names(const char *arg, const char **names, int nr)
+{
+	const char *p = arg;
+	int mask = 0, n;
+
+	while (p && *p) {
+		for (n = 0; n < nr; n++) {
+			size_t len = strlen(names[n]);
+			if (strncmp(p, names[n], len) == 0 &&
+			    (p[len] == ',' || p[len] == '\0'))
+				break;
+		}
+		if (n == nr)
+			return -1;
+		mask |= 1 << n;
+		p = strchr(p, ',');
+		if (p)
+			p++;
+	}
+
+	return mask;
+}
+
+static int parse_list(const char *arg, unsigned long *val, int max)
+{
+	const char *p;
+	char *end;
+	int nr;
+
+	for (nr = 0, p = arg; *p && nr < max; p = *end ? end + 1 : end) {
+		val[nr] = strtoul(p, &end, 0);
+		if (end == p)
+			return -1;
+		nr++;
+	}
+
+	return nr;
+}
+
+static void usage(void)
+{
+	const struct primitive *prim;
+
+	fprintf(stderr,
+		"usage: synchbench [options]\n"
+		"  -p <prim>[,<prim>...]   primitives to measure (default: all)\n"
+		"  -t <nr>[,<nr>...]       contending threads (default: 2,4,8)\n"
+		"  -s <ns>[,<ns>...]       critical section lengths "
+		"(default: 0,1000,10000)\n"
+		"  -g <ns>                 time spent out of the critical "
+		"section (default: 1000)\n"
+		"  -c <place>[,<place>...] CPU spreads, among same and spread "
+		"(default: all)\n"
+		"  -x <scen>[,<scen>...]   scenarios, among none, preempt and "
+		"inversion (default: none)\n"
+		"  -i <us>                 period of the preempting threads "
+		"(default: 1000)\n"
+		"  -b <us>                 busy time of the preempting threads "
+		"(default: 100)\n"
+		"  -d <s>                  duration of each run (default: 1)\n"
+		"  -P <prio>               worker priority (default: 50)\n"
+		"  -O <json|csv>           machine-readable output\n"
+		"  -C <file>               compare with the csv output of a "
+		"previous run\n"
+		"  -R <pct>                throughput loss reported as a "
+		"regression (default: 10)\n"
+		"primitives:");
+
+	for (prim = primitives; prim->name; prim++)
+		fprintf(stderr, " %s", prim->name);
+
+	fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long val[16];
+	const struct primitive *prim;
+	struct sched_param param;
+	int c, n, t, place, scen;
+
+	while ((c = getopt(argc, argv, "p:t:s:g:c:x:i:b:d:P:O:C:R:h")) != EOF)
+		switch (c) {
+		case 'p':
+			prim_list = optarg;
+			break;
+
+		case 't':
+			nr_threads_list = parse_list(optarg, val, 16);
+			for (n = 0; n < nr_threads_list; n++) {
+				threads[n] = val[n];
+				if (threads[n] < 1 || threads[n] > MAX_THREADS) {
+					fprintf(stderr, "synchbench: invalid "
+						"thread count (max. %d)\n",
+						MAX_THREADS);
+					return EXIT_FAILURE;
+				}
+			}
+			break;
+
+		case 's':
+			nr_cs = parse_list(optarg, cs_lengths, 16);
+			break;
+
+		case 'g':
+			gap = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'c':
+			places = parse_names(optarg, place_names, PLACE_MAX);
+			if (places <= 0) {
+				usage();
+				return EXIT_FAILURE;
+			}
+			break;
+
+		case 'x':
+			scens = parse_names(optarg, scen_names, SCEN_MAX);
+			if (scens <= 0) {
+				usage();
+				return EXIT_FAILURE;
+			}
+			break;
+
+		case 'i':
+			period = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'b':
+			burst = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'd':
+			duration = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'P':
+			prio = atoi(optarg);
+			break;
+
+		case 'O':
+			format = optarg;
+			if (strcmp(format, "json") && strcmp(format, "csv")) {
+				usage();
+				return EXIT_FAILURE;
+			}
+			break;
+
+		case 'C':
+			baseline = optarg;
+			break;
+
+		case 'R':
+			threshold = atof(optarg);
+			break;
+
+		default:
+			usage();
+			return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+	if (nr_threads_list <= 0 || nr_cs <= 0 || duration == 0 ||
+	    period == 0 || burst >= period || prio < 1 || prio + 10 > 99) {
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	if (baseline)
+		load_baseline(baseline);
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	read_topology();
+
+	if ((places & (1 << PLACE_SPREAD)) && nth_cpu(1) == nth_cpu(0)) {
+		fprintf(stderr, "synchbench: single CPU, spread placement "
+			"skipped\n");
+		places &= ~(1 << PLACE_SPREAD);
+		if (places == 0)
+			return EXIT_FAILURE;
+	}
+
+	/* Above all the other threads, so that we may stop them. */
+	param.sched_priority = 99;
+	pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+	print_header();
+
+	for (prim = primitives; prim->name; prim++) {
+		if (!prim_selected(prim))
+			continue;
+
+		for (scen = 0; scen < SCEN_MAX; scen++) {
+			if (!(scens & (1 << scen)))
+				continue;
+
+			for (place = 0; place < PLACE_MAX; place++) {
+				if (!(places & (1 << place)))
+					continue;
+
+				for (t = 0; t < nr_threads_list; t++)
+					for (n = 0; n < nr_cs; n++)
+						run(prim, scen, place,
+						    threads[t], cs_lengths[n]);
+			}
+		}
+	}
+
+	print_footer();
+
+	if (nr_regressions) {
+		fprintf(stderr, "synchbench: %d regression(s) beyond %g%%\n",
+			nr_regressions, threshold);
+		return 2;
+	}
+
+	return EXIT_SUCCESS;
+}
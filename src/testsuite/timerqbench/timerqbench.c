@@ -0,0 +1,195 @@
+/*
+ * Timer queue benchmark: costs of starting, stopping and firing
+ * timers, and lateness of the head timer, as the timer queue of each
+ * CPU is loaded with more and more outstanding timers. The runs are
+ * performed by the xeno_timerqbench driver, with the timer indexing
+ * method the nucleus was built with.
+ *
+ * Released under the terms of GPLv2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/mman.h>
+
+#include <rtdm/rtdm.h>
+#include <rtdm/rttesting.h>
+
+static const char *backends[] = {
+	[RTTST_TQBENCH_LIST] = "list",
+	[RTTST_TQBENCH_HEAP] = "heap",
+	[RTTST_TQBENCH_WHEEL] = "wheel",
+	[RTTST_TQBENCH_HWHEEL] = "hwheel",
+};
+
+static unsigned long min_timers = 10, max_timers = 100000;
+static int mode = RTTST_TQBENCH_RANDOM;
+static long long delay_ms = 1000, span_ms = 10000;
+static int probes = 16, loops = 100;
+static unsigned int seed = 1;
+static int only_cpu = -1;	/* All CPUs if negative. */
+static int devno;
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: timerqbench [options]\n"
+		"  -m <count>    fewest background timers, may be 0"
+		" (default 10)\n"
+		"  -n <count>    most background timers (default 100000,"
+		" max %d)\n"
+		"  -P            periodic timers (default: one-shot,"
+		" random dates)\n"
+		"  -d <ms>       delay of the earliest date (default 1000)\n"
+		"  -s <ms>       span of the dates, or period (default 10000)\n"
+		"  -p <count>    probe timers per round (default 16)\n"
+		"  -l <loops>    probe rounds per run (default 100)\n"
+		"  -c <cpu>      CPU to run on (default: all)\n"
+		"  -S <seed>     random seed (default 1)\n"
+		"  -D <n>        benchmark device number (default 0)\n",
+		RTTST_TQBENCH_MAX_TIMERS);
+}
+
+static int run(int fd, int cpu, unsigned long nr)
+{
+	struct rttst_tqbench_run r;
+	int err;
+
+	memset(&r, 0, sizeof(r));
+	r.config.nr_timers = nr;
+	r.config.cpu = cpu;
+	r.config.mode = mode;
+	r.config.delay = delay_ms * 1000000LL;
+	r.config.span = span_ms * 1000000LL;
+	r.config.probes = probes;
+	r.config.loops = loops;
+	r.config.seed = seed;
+
+	err = rt_dev_ioctl(fd, RTTST_RTIOC_TQBENCH_RUN, &r);
+	if (err) {
+		if (err == -ENOSPC)
+			printf("%3d %8lu  (exceeds the timer heap capacity)\n",
+			       cpu, nr);
+		else if (err == -EINVAL)
+			/* Settings were checked, the CPU is not supported. */
+			printf("%3d  (not available to Xenomai)\n", cpu);
+		else
+			fprintf(stderr, "timerqbench: run failed: %s\n",
+				strerror(-err));
+		return err;
+	}
+
+	printf("%3d %8lu %7Ld %7Ld %7Ld %7Ld %7Ld %7Ld %7Ld %7Ld %8lu  %s\n",
+	       cpu, nr,
+	       r.res.start.avg, r.res.start.max,
+	       r.res.stop.avg, r.res.stop.max,
+	       r.res.expiry.avg, r.res.expiry.max,
+	       r.res.head.avg, r.res.head.max,
+	       r.res.fired,
+	       r.res.backend >= 0 && r.res.backend <= RTTST_TQBENCH_HWHEEL ?
+	       backends[r.res.backend] : "?");
+
+	return 0;
+}
+
+static void run_cpu(int fd, int cpu)
+{
+	unsigned long nr, next;
+
+	for (nr = min_timers; nr <= max_timers; nr = next) {
+		if (run(fd, cpu, nr))
+			return;
+		if (nr == max_timers)
+			break;
+		/* Go on with 1 timer after an empty queue. */
+		next = nr ? nr * 10 : 1;
+		if (next > max_timers || next < nr)
+			next = max_timers;
+	}
+}
+
+int main(int argc, char *const argv[])
+{
+	char devname[RTDM_MAX_DEVNAME_LEN];
+	int c, fd, n, nr_cpus;
+
+	while ((c = getopt(argc, argv, "m:n:Pd:s:p:l:c:S:D:h")) != EOF)
+		switch (c) {
+		case 'm':
+			min_timers = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			max_timers = strtoul(optarg, NULL, 0);
+			break;
+		case 'P':
+			mode = RTTST_TQBENCH_PERIODIC;
+			break;
+		case 'd':
+			delay_ms = strtoll(optarg, NULL, 0);
+			break;
+		case 's':
+			span_ms = strtoll(optarg, NULL, 0);
+			break;
+		case 'p':
+			probes = atoi(optarg);
+			break;
+		case 'l':
+			loops = atoi(optarg);
+			break;
+		case 'c':
+			only_cpu = atoi(optarg);
+			break;
+		case 'S':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'D':
+			devno = atoi(optarg);
+			break;
+		default:
+			usage();
+			return c == 'h' ? 0 : 2;
+		}
+
+	if (min_timers > max_timers ||
+	    max_timers > RTTST_TQBENCH_MAX_TIMERS ||
+	    probes < 1 || probes > RTTST_TQBENCH_MAX_PROBES || loops < 1 ||
+	    delay_ms < 0 || span_ms <= 0) {
+		usage();
+		return 2;
+	}
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	snprintf(devname, RTDM_MAX_DEVNAME_LEN, "rttest-timerqbench%d", devno);
+	fd = rt_dev_open(devname, O_RDWR);
+	if (fd < 0) {
+		fprintf(stderr,
+			"timerqbench: failed to open benchmark device, code %d\n"
+			"(modprobe xeno_timerqbench?)\n", fd);
+		return 1;
+	}
+
+	printf("== %s timers, dates over %Ld ms from +%Ld ms, "
+	       "%d probes x %d rounds, all values in ns\n",
+	       mode == RTTST_TQBENCH_PERIODIC ? "periodic" : "one-shot",
+	       span_ms, delay_ms, probes, loops);
+	printf("CPU   TIMERS  ST-AVG  ST-MAX  SP-AVG  SP-MAX  EX-AVG  EX-MAX"
+	       "  HD-AVG  HD-MAX    FIRED  QUEUE\n");
+
+	if (only_cpu >= 0)
+		run_cpu(fd, only_cpu);
+	else {
+		nr_cpus = sysconf(_SC_NPROCESSORS_CONF);
+		for (n = 0; n < nr_cpus; n++)
+			run_cpu(fd, n);
+	}
+
+	rt_dev_close(fd);
+
+	return 0;
+}
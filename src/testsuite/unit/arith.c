@@ -11,6 +11,11 @@ static volatile unsigned nsec_per_sec = 1000000000;
 static volatile unsigned sample_freq = 33000000;
 static volatile long long arg = 0x3ffffffffffffffULL;
 
+#define speedup(display, ref)						\
+	fprintf(stderr, "%s: %lld.%02lldx faster\n", display,		\
+		avg > 0 ? (ref) / avg : 0,				\
+		avg > 0 ? ((ref) * 100 / avg) % 100 : 0)
+
 #define bench(display, f)						\
 	do {								\
 		unsigned long long result;				\
@@ -44,7 +49,8 @@ static volatile long long arg = 0x3ffffffffffffffULL;
 int main(void)
 {
 	unsigned mul, shft, rejected;
-	long long avg, calib = 0;
+	long long avg, ref, calib = 0;
+	xnarch_conv_t conv;
 #ifdef XNARCH_HAVE_NODIV_LLIMD
 	rthal_u32frac_t frac;
 #endif
@@ -119,5 +125,27 @@ int main(void)
 	bench("out of line nodiv_ullimd",
 	      do_nodiv_ullimd(arg, frac.frac, frac.integ));
 #endif /* XNARCH_HAVE_NODIV_LLIMD */
+
+	/* Precomputed conversion objects, as used by the nucleus timers. */
+	fprintf(stderr, "\nconversion objects: 0x%016llx * %u / %d\n",
+		arg, nsec_per_sec, sample_freq);
+	xnarch_init_conv(&conv, nsec_per_sec, sample_freq);
+	calib = 0;
+	bench("inline calibration", 0);
+	calib = avg;
+	bench("inlined llimd", rthal_llimd(arg, nsec_per_sec, sample_freq));
+	ref = avg;
+	bench("inlined conv_scale", xnarch_conv_scale(&conv, arg));
+	speedup("conv_scale vs llimd", ref);
+	bench("inlined conv_scale_exact", xnarch_conv_scale_exact(&conv, arg));
+	speedup("conv_scale_exact vs llimd", ref);
+
+	fprintf(stderr, "\nconversion objects: 0x%016llx / %d\n",
+		arg, sample_freq);
+	xnarch_init_conv(&conv, 1, sample_freq);
+	bench("inlined ulldiv", rthal_ulldiv(arg, sample_freq, NULL));
+	ref = avg;
+	bench("inlined conv_divrem", xnarch_conv_divrem(&conv, arg, NULL));
+	speedup("conv_divrem vs ulldiv", ref);
 	return 0;
 }
@@ -5,9 +5,62 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include <asm/xenomai/syscall.h>
 #include <asm-generic/sem_heap.h>
+#include <asm-generic/xenomai/timeconv.h>
 #include <nucleus/vdso.h>
+#include <native/timer.h>
+
+#define BENCH_LOOPS 1000000
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void report(const char *what, unsigned long long start)
+{
+	unsigned long long elapsed = now_ns() - start;
+
+	printf("%-24s %7.1f ns/call, %6.2f Mcalls/s\n", what,
+	       (double)elapsed / BENCH_LOOPS,
+	       BENCH_LOOPS * 1000.0 / elapsed);
+}
+
+/* Compare the syscall and data page paths to the wallclock. */
+static void bench_clocks(void)
+{
+	volatile unsigned long long sink;
+	unsigned long long start;
+	int n;
+
+	start = now_ns();
+	for (n = 0; n < BENCH_LOOPS; n++)
+		sink = rt_timer_read();
+	report("rt_timer_read syscall", start);
+
+#ifdef XNARCH_HAVE_NONPRIV_TSC
+	if (!xnvdso_test_feature(XNVDSO_FEAT_WALLCLOCK))
+		return;
+
+	start = now_ns();
+	for (n = 0; n < BENCH_LOOPS; n++)
+		sink = xnarch_tsc_to_ns(__xn_rdtsc())
+			+ xnvdso_get_wallclock_offset();
+	report("vdso wallclock", start);
+
+	start = now_ns();
+	for (n = 0; n < BENCH_LOOPS; n++)
+		sink = xnarch_tsc_to_ns(__xn_rdtsc());
+	report("tsc only", start);
+#endif /* XNARCH_HAVE_NONPRIV_TSC */
+	(void)sink;
+}
 
 int main(int argc, char **argv)
 {
@@ -28,8 +81,10 @@ int main(int argc, char **argv)
 
 	printf("Contents of the features flag: %llu\n", nkvdso->features);
 
-	if (nkvdso->features == test_features)
+	if (nkvdso->features == test_features) {
+		bench_clocks();
 		return 0;
+	}
 
 	fprintf(stderr, "error: nkvdso->features != %llu\n", test_features);
 	return 1;
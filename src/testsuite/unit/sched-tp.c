@@ -9,6 +9,7 @@
 #include <sys/mman.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <malloc.h>
 #include <unistd.h>
 #include <signal.h>
@@ -50,6 +51,22 @@ static void *thread_body(void *arg)
 	return NULL;
 }
 
+static void dump_windows(void)
+{
+	char buf[256];
+	FILE *fp;
+
+	fp = fopen("/proc/xenomai/sched/tp/windows", "r");
+	if (fp == NULL)
+		return;
+
+	putchar('\n');
+	while (fgets(buf, sizeof(buf), fp))
+		fputs(buf, stdout);
+
+	fclose(fp);
+}
+
 static void cleanup(int sig)
 {
 	pthread_cancel(threadC);
@@ -59,6 +76,7 @@ static void cleanup(int sig)
 	pthread_join(threadC, NULL);
 	pthread_join(threadB, NULL);
 	pthread_join(threadA, NULL);
+	dump_windows();
 }
 
 static void __create_thread(pthread_t *tid, const char *name, int seq)
@@ -88,8 +106,17 @@ int main(int argc, char **argv)
 {
 	sigset_t mask, oldmask;
 	union sched_config *p;
+	int ret, cpu, nrcpus = 1;
 	size_t len;
-	int ret;
+
+	/*
+	 * With -g, install the same schedule on all CPUs, which
+	 * should then switch windows in lockstep when the kernel is
+	 * built with CONFIG_XENO_OPT_SCHED_TP_GLOBAL. The per-window
+	 * statistics are dumped on exit.
+	 */
+	if (argc > 1 && strcmp(argv[1], "-g") == 0)
+		nrcpus = sysconf(_SC_NPROCESSORS_ONLN);
 
 	mlockall(MCL_CURRENT | MCL_FUTURE);
 
@@ -140,10 +167,12 @@ int main(int argc, char **argv)
 	p->tp.windows[3].duration.tv_nsec = 230000000;
 	p->tp.windows[3].ptid = -1;
 
-	/* Assign the TP schedule to CPU #0 */
-	ret = sched_setconfig_np(0, SCHED_TP, p, len);
-	if (ret)
-		error(1, ret, "sched_setconfig_np");
+	/* Assign the TP schedule to CPU #0, or all CPUs. */
+	for (cpu = 0; cpu < nrcpus; cpu++) {
+		ret = sched_setconfig_np(cpu, SCHED_TP, p, len);
+		if (ret)
+			error(1, ret, "sched_setconfig_np");
+	}
 
 	sigemptyset(&mask);
 	sigaddset(&mask, SIGINT);
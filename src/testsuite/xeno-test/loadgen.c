@@ -0,0 +1,871 @@
+/*
+ * Load generator: reproduces the cache, memory bus, TLB and
+ * interrupt interference which drives the worst-case latencies of
+ * real-time tasks, using selectable profiles run by threads pinned
+ * to the non real-time CPUs.
+ *
+ * Released under the terms of GPLv2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <time.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <netinet/in.h>
+
+#define CACHELINE	64
+#define MAX_CPUS	256
+
+struct profile {
+	const char *name;
+	const char *unit;	/* What workers count. */
+	unsigned long long scale; /* Units per count. */
+	int (*spawn)(const struct profile *prof);
+	int enabled;
+};
+
+struct worker {
+	pthread_t tid;
+	const struct profile *prof;
+	int cpu;
+	void *arg;
+	unsigned long long count;
+};
+
+struct line {
+	struct line *next;
+	unsigned long dirty;
+	char pad[CACHELINE - sizeof(struct line *) - sizeof(unsigned long)];
+};
+
+struct pingpong {
+	int *flag;		/* Shared with the peer. */
+	int mine;		/* Flag value when it is our turn. */
+};
+
+static int cpus[MAX_CPUS], nr_cpus;
+static int bw_cpus[MAX_CPUS], nr_bw_cpus;
+static size_t llc_wset;		/* Per thread, defaults to twice the LLC. */
+static size_t bw_size = 16 << 20; /* Per thread. */
+static int tlb_pages = 64;
+static long timer_period = 20000; /* ns */
+static const char *udp_target, *disk_path;
+static struct sockaddr_storage udp_addr;
+static socklen_t udp_addrlen;
+static int duration, verbose;
+
+static struct worker *workers;
+static int nr_workers;
+
+static volatile int stop;
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: loadgen [options]\n"
+		"  -p <prof>[,<prof>...]   profiles to run (default: all)\n"
+		"  -c <cpulist>            CPUs to load (default: online CPUs "
+		"but isolated ones)\n"
+		"  -n <nodelist>           NUMA nodes which memory bus the "
+		"membw profile saturates\n"
+		"                          (default: all)\n"
+		"  -w <size>[K|M]          LLC thrash working set per thread "
+		"(default: twice the LLC)\n"
+		"  -m <size>[K|M]          membw buffer per thread "
+		"(default: 16M)\n"
+		"  -P <pages>              pages of the area which protection "
+		"the tlb profile flips\n"
+		"                          (default: 64)\n"
+		"  -i <us>                 timer period of the irq profile "
+		"(default: 20)\n"
+		"  -s <host>[:<port>]      irq profile: flood host with UDP "
+		"datagrams (default port: 9)\n"
+		"  -d <file>               irq profile: read file or block "
+		"device at random offsets\n"
+		"  -T <seconds>            duration (default: until killed)\n"
+		"  -v                      print throughput of each profile "
+		"upon exit\n"
+		"profiles:\n"
+		"  llc    thrash the last level cache with random accesses to "
+		"the working set\n"
+		"  membw  saturate memory bandwidth, copying node-local "
+		"buffers\n"
+		"  tlb    storm of TLB shootdowns, flipping the protection of "
+		"an area read on all\n"
+		"         CPUs\n"
+		"  ipi    flood of rescheduling IPIs, with threads pairs "
+		"ping-ponging across CPUs\n"
+		"  irq    timer interrupts at high rate, plus network and disk "
+		"interrupts with -s\n"
+		"         and -d\n");
+}
+
+static int parse_list(const char *s, int *list, int max)
+{
+	int n = 0, first, last;
+	char *end;
+
+	while (*s) {
+		first = strtol(s, &end, 10);
+		if (end == s || first < 0)
+			return -EINVAL;
+		last = first;
+		if (*end == '-') {
+			s = end + 1;
+			last = strtol(s, &end, 10);
+			if (end == s || last < first)
+				return -EINVAL;
+		}
+		for (; first <= last; first++) {
+			if (n == max)
+				return -E2BIG;
+			list[n++] = first;
+		}
+		s = end;
+		if (*s == ',')
+			s++;
+		else if (*s && !isspace(*s))
+			return -EINVAL;
+		else
+			break;
+	}
+
+	return n;
+}
+
+static int read_list(const char *path, int *list, int max)
+{
+	char buf[1024];
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f)
+		return -errno;
+	if (!fgets(buf, sizeof(buf), f))
+		buf[0] = '\0';
+	fclose(f);
+
+	return parse_list(buf, list, max);
+}
+
+static int in_list(int v, const int *list, int n)
+{
+	while (n-- > 0)
+		if (list[n] == v)
+			return 1;
+	return 0;
+}
+
+static size_t parse_size(const char *s)
+{
+	unsigned long long v;
+	char *end;
+
+	v = strtoull(s, &end, 0);
+	switch (toupper(*end)) {
+	case 'G':
+		v <<= 10;
+		/* fall through */
+	case 'M':
+		v <<= 10;
+		/* fall through */
+	case 'K':
+		v <<= 10;
+		end++;
+	}
+
+	return *end ? 0 : v;
+}
+
+/* Largest cache of the first CPU we load, 0 if unknown. */
+static size_t llc_size(void)
+{
+	size_t size, max = 0;
+	char path[128], buf[32];
+	FILE *f;
+	int n;
+
+	for (n = 0; n < 8; n++) {
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/cpu/cpu%d/cache/index%d/size",
+			 cpus[0], n);
+		f = fopen(path, "r");
+		if (!f)
+			break;
+		if (fgets(buf, sizeof(buf), f)) {
+			buf[strcspn(buf, "\n")] = '\0';
+			size = parse_size(buf);
+			if (size > max)
+				max = size;
+		}
+		fclose(f);
+	}
+
+	return max;
+}
+
+static void *alloc_local(size_t size)
+{
+	void *p;
+
+	/*
+	 * Pages are only allocated when first touched, i.e. on the
+	 * node of the CPU the calling worker is pinned to.
+	 */
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		return NULL;
+	memset(p, 0, size);
+
+	return p;
+}
+
+static int spawn_worker(const struct profile *prof, int cpu,
+			void *(*fn)(void *), void *arg)
+{
+	struct worker *w;
+	pthread_attr_t attr;
+	cpu_set_t set;
+	int err;
+
+	w = realloc(workers, sizeof(*w) * (nr_workers + 1));
+	if (!w)
+		return -ENOMEM;
+	workers = w;
+
+	/*
+	 * Workers only get at their own slot once all are spawned, so
+	 * it is fine to move the array until then.
+	 */
+	w = &workers[nr_workers];
+	w->prof = prof;
+	w->cpu = cpu;
+	w->arg = arg;
+	w->count = 0;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	pthread_attr_init(&attr);
+	pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+	err = pthread_create(&w->tid, &attr, fn, (void *)(long)nr_workers);
+	pthread_attr_destroy(&attr);
+	if (err)
+		return -err;
+
+	nr_workers++;
+
+	return 0;
+}
+
+static pthread_mutex_t start_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct worker *self(void *cookie)
+{
+	struct worker *w;
+
+	/* Wait for main() to release us once all workers exist. */
+	pthread_mutex_lock(&start_lock);
+	w = &workers[(long)cookie];
+	pthread_mutex_unlock(&start_lock);
+
+	return w;
+}
+
+static void *llc_thrash(void *cookie)
+{
+	struct worker *w = self(cookie);
+	size_t nlines = llc_wset / sizeof(struct line), i, j, t;
+	struct line *lines, *l;
+	unsigned int seed = w->cpu + 1;
+	size_t *order;
+
+	lines = alloc_local(nlines * sizeof(*lines));
+	order = malloc(nlines * sizeof(*order));
+	if (!lines || !order) {
+		fprintf(stderr, "loadgen: llc: out of memory\n");
+		return NULL;
+	}
+
+	/*
+	 * Chain the lines in random order, so that the prefetchers
+	 * cannot hide the misses.
+	 */
+	for (i = 0; i < nlines; i++)
+		order[i] = i;
+	for (i = nlines - 1; i > 0; i--) {
+		j = rand_r(&seed) % (i + 1);
+		t = order[i];
+		order[i] = order[j];
+		order[j] = t;
+	}
+	for (i = 0; i < nlines; i++)
+		lines[order[i]].next = &lines[order[(i + 1) % nlines]];
+	free(order);
+
+	l = &lines[0];
+	while (!stop) {
+		for (i = 0; i < nlines; i++) {
+			/* Dirty the line, to cause write-backs too. */
+			l->dirty++;
+			l = l->next;
+		}
+		w->count += nlines;
+	}
+
+	munmap(lines, nlines * sizeof(*lines));
+
+	return NULL;
+}
+
+static void *membw_stream(void *cookie)
+{
+	struct worker *w = self(cookie);
+	size_t half = bw_size / 2;
+	char *buf;
+
+	buf = alloc_local(half * 2);
+	if (!buf) {
+		fprintf(stderr, "loadgen: membw: out of memory\n");
+		return NULL;
+	}
+
+	while (!stop) {
+		memcpy(buf + half, buf, half);
+		memcpy(buf, buf + half, half);
+		w->count += half * 2;
+	}
+
+	munmap(buf, half * 2);
+
+	return NULL;
+}
+
+static char *tlb_area;
+
+static void *tlb_read(void *cookie)
+{
+	size_t pagesz = getpagesize();
+	volatile char *p;
+	int n;
+
+	self(cookie);
+
+	/*
+	 * Keep the mm live on this CPU, so that every protection
+	 * change in the area needs a TLB shootdown IPI here.
+	 */
+	while (!stop) {
+		for (n = 0; n < tlb_pages; n++) {
+			p = tlb_area + n * pagesz;
+			(void)*p;
+		}
+	}
+
+	return NULL;
+}
+
+static void *tlb_shoot(void *cookie)
+{
+	struct worker *w = self(cookie);
+	size_t pagesz = getpagesize(), len = tlb_pages * pagesz;
+	int n;
+
+	while (!stop) {
+		for (n = 0; n < tlb_pages; n++)
+			tlb_area[n * pagesz]++;
+		mprotect(tlb_area, len, PROT_READ);
+		mprotect(tlb_area, len, PROT_READ | PROT_WRITE);
+		w->count++;
+	}
+
+	return NULL;
+}
+
+static void *ipi_pingpong(void *cookie)
+{
+	struct worker *w = self(cookie);
+	struct pingpong *pp = w->arg;
+	struct timespec ts = { .tv_sec = 0, .tv_nsec = 100000000 };
+
+	/*
+	 * Each side hands the flag over, then sleeps until the peer
+	 * hands it back: every wake up of the sleeping peer sends a
+	 * rescheduling IPI to its CPU. The timeout lets us notice
+	 * when we are asked to stop.
+	 */
+	while (!stop) {
+		if (__sync_bool_compare_and_swap(pp->flag,
+						 pp->mine, !pp->mine)) {
+			syscall(SYS_futex, pp->flag, FUTEX_WAKE, 1,
+				NULL, NULL, 0);
+			w->count++;
+		}
+		syscall(SYS_futex, pp->flag, FUTEX_WAIT, !pp->mine,
+			&ts, NULL, 0);
+	}
+
+	return NULL;
+}
+
+static void *irq_timer(void *cookie)
+{
+	struct worker *w = self(cookie);
+	struct timespec ts = { .tv_sec = 0, .tv_nsec = timer_period };
+
+	while (!stop) {
+		clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, NULL);
+		w->count++;
+	}
+
+	return NULL;
+}
+
+static void *irq_udp(void *cookie)
+{
+	struct worker *w = self(cookie);
+	char buf[1472];
+	int s;
+
+	s = socket(udp_addr.ss_family, SOCK_DGRAM, 0);
+	if (s < 0) {
+		perror("loadgen: irq: socket");
+		return NULL;
+	}
+
+	memset(buf, 0x55, sizeof(buf));
+	while (!stop)
+		if (sendto(s, buf, sizeof(buf), 0,
+			   (struct sockaddr *)&udp_addr, udp_addrlen) > 0)
+			w->count++;
+
+	close(s);
+
+	return NULL;
+}
+
+static void *irq_disk(void *cookie)
+{
+	struct worker *w = self(cookie);
+	unsigned int seed = w->cpu + 1;
+	int fd, direct = 1;
+	off_t size, off;
+	void *buf;
+
+	fd = open(disk_path, O_RDONLY | O_DIRECT);
+	if (fd < 0) {
+		direct = 0;
+		fd = open(disk_path, O_RDONLY);
+	}
+	if (fd < 0) {
+		fprintf(stderr, "loadgen: irq: %s: %s\n",
+			disk_path, strerror(errno));
+		return NULL;
+	}
+
+	size = lseek(fd, 0, SEEK_END) & ~4095LL;
+	if (size <= 0 || posix_memalign(&buf, 4096, 4096)) {
+		fprintf(stderr, "loadgen: irq: %s: cannot read\n", disk_path);
+		close(fd);
+		return NULL;
+	}
+
+	while (!stop) {
+		off = ((off_t)rand_r(&seed) * 4096) % size;
+		/* Without O_DIRECT, make sure we hit the device. */
+		if (!direct)
+			posix_fadvise(fd, off, 4096, POSIX_FADV_DONTNEED);
+		if (pread(fd, buf, 4096, off) > 0)
+			w->count++;
+	}
+
+	free(buf);
+	close(fd);
+
+	return NULL;
+}
+
+static int spawn_llc(const struct profile *prof)
+{
+	int n, err;
+
+	for (n = 0; n < nr_cpus; n++) {
+		err = spawn_worker(prof, cpus[n], llc_thrash, NULL);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+static int spawn_membw(const struct profile *prof)
+{
+	int n, err;
+
+	for (n = 0; n < nr_bw_cpus; n++) {
+		err = spawn_worker(prof, bw_cpus[n], membw_stream, NULL);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+static int spawn_tlb(const struct profile *prof)
+{
+	int n, err;
+
+	tlb_area = mmap(NULL, tlb_pages * getpagesize(),
+			PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (tlb_area == MAP_FAILED)
+		return -errno;
+
+	/* One shooter, readers on all other CPUs. */
+	err = spawn_worker(prof, cpus[0], tlb_shoot, NULL);
+	for (n = 1; !err && n < nr_cpus; n++)
+		err = spawn_worker(prof, cpus[n], tlb_read, NULL);
+
+	return err;
+}
+
+static int spawn_ipi(const struct profile *prof)
+{
+	struct pingpong *pp;
+	int n, err, *flag;
+
+	if (nr_cpus < 2)
+		fprintf(stderr, "loadgen: ipi: single CPU, no IPI will "
+			"be sent\n");
+
+	/* Pair each CPU with the next one. */
+	for (n = 0; n < nr_cpus; n++) {
+		flag = calloc(1, sizeof(*flag));
+		pp = calloc(2, sizeof(*pp));
+		if (!flag || !pp)
+			return -ENOMEM;
+		pp[0].flag = pp[1].flag = flag;
+		pp[1].mine = 1;
+		err = spawn_worker(prof, cpus[n], ipi_pingpong, &pp[0]);
+		if (!err)
+			err = spawn_worker(prof, cpus[(n + 1) % nr_cpus],
+					   ipi_pingpong, &pp[1]);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+static int spawn_irq(const struct profile *prof)
+{
+	int n, err;
+
+	for (n = 0; n < nr_cpus; n++) {
+		err = spawn_worker(prof, cpus[n], irq_timer, NULL);
+		if (err)
+			return err;
+	}
+
+	if (udp_target) {
+		err = spawn_worker(prof, cpus[0], irq_udp, NULL);
+		if (err)
+			return err;
+	}
+
+	if (disk_path) {
+		err = spawn_worker(prof, cpus[nr_cpus - 1], irq_disk, NULL);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+static struct profile profiles[] = {
+	{ .name = "llc", .unit = "Mlines/s", .scale = 1000000,
+	  .spawn = spawn_llc },
+	{ .name = "membw", .unit = "MB/s", .scale = 1000000,
+	  .spawn = spawn_membw },
+	{ .name = "tlb", .unit = "flips/s", .scale = 1,
+	  .spawn = spawn_tlb },
+	{ .name = "ipi", .unit = "wakeups/s", .scale = 1,
+	  .spawn = spawn_ipi },
+	{ .name = "irq", .unit = "events/s", .scale = 1,
+	  .spawn = spawn_irq },
+	{ .name = NULL }
+};
+
+static int resolve_udp_target(void)
+{
+	struct addrinfo hints, *res;
+	char host[256], *port;
+	int err;
+
+	snprintf(host, sizeof(host), "%s", udp_target);
+	port = strrchr(host, ':');
+	if (port)
+		*port++ = '\0';
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_socktype = SOCK_DGRAM;
+	err = getaddrinfo(host, port ?: "9", &hints, &res);
+	if (err) {
+		fprintf(stderr, "loadgen: %s: %s\n", udp_target,
+			gai_strerror(err));
+		return -EINVAL;
+	}
+
+	memcpy(&udp_addr, res->ai_addr, res->ai_addrlen);
+	udp_addrlen = res->ai_addrlen;
+	freeaddrinfo(res);
+
+	return 0;
+}
+
+static void sighand(int sig)
+{
+	stop = 1;
+}
+
+int main(int argc, char **argv)
+{
+	int online[MAX_CPUS], nr_online, isolated[MAX_CPUS], nr_isolated;
+	int nodes[MAX_CPUS], nr_nodes = -1, node_cpus[MAX_CPUS], nr_node_cpus;
+	const char *prof_list = NULL, *cpu_list = NULL;
+	unsigned long long total;
+	struct profile *prof;
+	struct timespec start, end;
+	sigset_t mask, oldmask;
+	double elapsed;
+	int c, n, m, err = 0;
+	char path[128];
+	char *p, *tok;
+
+	while ((c = getopt(argc, argv, "p:c:n:w:m:P:i:s:d:T:vh")) != EOF)
+		switch (c) {
+		case 'p':
+			prof_list = optarg;
+			break;
+
+		case 'c':
+			cpu_list = optarg;
+			break;
+
+		case 'n':
+			nr_nodes = parse_list(optarg, nodes, MAX_CPUS);
+			if (nr_nodes <= 0)
+				goto bad_usage;
+			break;
+
+		case 'w':
+			llc_wset = parse_size(optarg);
+			if (llc_wset < sizeof(struct line))
+				goto bad_usage;
+			break;
+
+		case 'm':
+			bw_size = parse_size(optarg);
+			if (bw_size < 2 * CACHELINE)
+				goto bad_usage;
+			break;
+
+		case 'P':
+			tlb_pages = atoi(optarg);
+			if (tlb_pages <= 0)
+				goto bad_usage;
+			break;
+
+		case 'i':
+			timer_period = atol(optarg) * 1000;
+			if (timer_period <= 0)
+				goto bad_usage;
+			break;
+
+		case 's':
+			udp_target = optarg;
+			break;
+
+		case 'd':
+			disk_path = optarg;
+			break;
+
+		case 'T':
+			duration = atoi(optarg);
+			break;
+
+		case 'v':
+			verbose = 1;
+			break;
+
+		case 'h':
+			usage();
+			exit(EXIT_SUCCESS);
+
+		default:
+		  bad_usage:
+			usage();
+			exit(EXIT_FAILURE);
+		}
+
+	if (optind != argc)
+		goto bad_usage;
+
+	if (prof_list) {
+		p = strdup(prof_list);
+		for (tok = strtok(p, ","); tok; tok = strtok(NULL, ",")) {
+			for (prof = profiles; prof->name; prof++)
+				if (!strcmp(prof->name, tok))
+					break;
+			if (!prof->name) {
+				fprintf(stderr, "loadgen: unknown profile %s\n",
+					tok);
+				exit(EXIT_FAILURE);
+			}
+			prof->enabled = 1;
+		}
+		free(p);
+	} else
+		for (prof = profiles; prof->name; prof++)
+			prof->enabled = 1;
+
+	/*
+	 * By default, load all online CPUs but the isolated ones,
+	 * which are usually those reserved for real-time activities.
+	 */
+	nr_online = read_list("/sys/devices/system/cpu/online",
+			      online, MAX_CPUS);
+	if (nr_online <= 0) {
+		nr_online = sysconf(_SC_NPROCESSORS_ONLN);
+		for (n = 0; n < nr_online && n < MAX_CPUS; n++)
+			online[n] = n;
+	}
+
+	if (cpu_list) {
+		nr_cpus = parse_list(cpu_list, cpus, MAX_CPUS);
+		if (nr_cpus <= 0)
+			goto bad_usage;
+		for (n = 0; n < nr_cpus; n++)
+			if (!in_list(cpus[n], online, nr_online)) {
+				fprintf(stderr, "loadgen: CPU%d is offline\n",
+					cpus[n]);
+				exit(EXIT_FAILURE);
+			}
+	} else {
+		nr_isolated = read_list("/sys/devices/system/cpu/isolated",
+					isolated, MAX_CPUS);
+		for (n = 0; n < nr_online; n++)
+			if (nr_isolated <= 0
+			    || !in_list(online[n], isolated, nr_isolated))
+				cpus[nr_cpus++] = online[n];
+		if (nr_cpus == 0) {
+			fprintf(stderr, "loadgen: all CPUs are isolated, "
+				"use -c\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	/* membw runs on the CPUs we load which belong to the nodes. */
+	if (nr_nodes < 0) {
+		memcpy(bw_cpus, cpus, sizeof(cpus));
+		nr_bw_cpus = nr_cpus;
+	} else
+		for (m = 0; m < nr_nodes; m++) {
+			snprintf(path, sizeof(path),
+				 "/sys/devices/system/node/node%d/cpulist",
+				 nodes[m]);
+			nr_node_cpus = read_list(path, node_cpus, MAX_CPUS);
+			if (nr_node_cpus < 0) {
+				fprintf(stderr, "loadgen: no node %d\n",
+					nodes[m]);
+				exit(EXIT_FAILURE);
+			}
+			for (n = 0; n < nr_cpus; n++)
+				if (in_list(cpus[n], node_cpus, nr_node_cpus))
+					bw_cpus[nr_bw_cpus++] = cpus[n];
+		}
+	if (profiles[1].enabled && nr_bw_cpus == 0) {
+		fprintf(stderr, "loadgen: membw: no CPU to load on the "
+			"nodes\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (llc_wset == 0) {
+		llc_wset = 2 * llc_size();
+		if (llc_wset == 0)
+			llc_wset = 8 << 20;
+	}
+
+	if (udp_target && resolve_udp_target())
+		exit(EXIT_FAILURE);
+
+	signal(SIGINT, sighand);
+	signal(SIGTERM, sighand);
+	signal(SIGHUP, sighand);
+	signal(SIGALRM, sighand);
+
+	/* Workers must leave the signals to us. */
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGINT);
+	sigaddset(&mask, SIGTERM);
+	sigaddset(&mask, SIGHUP);
+	sigaddset(&mask, SIGALRM);
+	pthread_sigmask(SIG_BLOCK, &mask, &oldmask);
+
+	pthread_mutex_lock(&start_lock);
+
+	for (prof = profiles; prof->name; prof++) {
+		if (!prof->enabled)
+			continue;
+		err = prof->spawn(prof);
+		if (err) {
+			fprintf(stderr, "loadgen: %s: %s\n",
+				prof->name, strerror(-err));
+			stop = 1;
+			break;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pthread_mutex_unlock(&start_lock);
+
+	if (duration)
+		alarm(duration);
+
+	while (!stop)
+		sigsuspend(&oldmask);
+
+	for (n = 0; n < nr_workers; n++)
+		pthread_join(workers[n].tid, NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	elapsed = (end.tv_sec - start.tv_sec) +
+		(end.tv_nsec - start.tv_nsec) / 1e9;
+
+	if (verbose && elapsed > 0)
+		for (prof = profiles; prof->name; prof++) {
+			if (!prof->enabled)
+				continue;
+			total = 0;
+			for (n = 0; n < nr_workers; n++)
+				if (workers[n].prof == prof)
+					total += workers[n].count;
+			printf("%-6s %12.1f %s\n", prof->name,
+			       total / elapsed / prof->scale, prof->unit);
+		}
+
+	return err ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,384 @@
+/**
+ * @file
+ * Analogy for Linux, input command throughput benchmark
+ *
+ * Xenomai is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <getopt.h>
+#include <string.h>
+
+#include <native/task.h>
+#include <native/timer.h>
+
+#include <analogy/analogy.h>
+
+/* The benchmark is meant to run against the high-rate AI subdevice
+   of the fake driver, which tags each 32-bit sample with its index in
+   the acquisition */
+#define ID_SUBD 4
+#define MAX_NB_CHAN 32
+
+#define FILENAME "analogy0"
+
+static char *filename = FILENAME;
+static char *str_chans = "0,1,2,3,4,5,6,7";
+static unsigned int chans[MAX_NB_CHAN];
+static int verbose = 0;
+static unsigned long duration = 10;
+static unsigned long wake_count = 0;
+static unsigned long wake_period = 0;
+
+static RT_TASK rt_task_desc;
+
+a4l_cmd_t cmd = {
+	.idx_subd = ID_SUBD,
+	.flags = 0,
+	.start_src = TRIG_NOW,
+	.start_arg = 0,
+	.scan_begin_src = TRIG_TIMER,
+	.scan_begin_arg = 1000,	/* in ns */
+	.convert_src = TRIG_NOW,
+	.convert_arg = 0,
+	.scan_end_src = TRIG_COUNT,
+	.scan_end_arg = 0,
+	.stop_src = TRIG_NONE,
+	.stop_arg = 0,
+	.nb_chan = 0,
+	.chan_descs = chans,
+};
+
+struct option cmd_bench_opts[] = {
+	{"verbose", no_argument, NULL, 'v'},
+	{"device", required_argument, NULL, 'd'},
+	{"subdevice", required_argument, NULL, 's'},
+	{"channels", required_argument, NULL, 'c'},
+	{"scan-period", required_argument, NULL, 'p'},
+	{"duration", required_argument, NULL, 'T'},
+	{"wake-count", required_argument, NULL, 'k'},
+	{"wake-period", required_argument, NULL, 'P'},
+	{"help", no_argument, NULL, 'h'},
+	{0},
+};
+
+void do_print_usage(void)
+{
+	fprintf(stdout, "usage:\tcmd_bench [OPTS]\n");
+	fprintf(stdout, "\tOPTS:\t -v, --verbose: verbose output\n");
+	fprintf(stdout,
+		"\t\t -d, --device: device filename (analogy0, analogy1, ...)\n");
+	fprintf(stdout, "\t\t -s, --subdevice: subdevice index (default: 4)\n");
+	fprintf(stdout, "\t\t -c, --channels: channels to use (ex.: -c 0,1)\n");
+	fprintf(stdout,
+		"\t\t -p, --scan-period: scan period in ns (default: 1000)\n");
+	fprintf(stdout,
+		"\t\t -T, --duration: duration of the test in s (default: 10)\n");
+	fprintf(stdout,
+		"\t\t -k, --wake-count: "
+		"data amount available before waking up the process\n");
+	fprintf(stdout,
+		"\t\t -P, --wake-period: "
+		"wake-up period in ns, whatever the data amount\n");
+	fprintf(stdout, "\t\t -h, --help: print this help\n");
+}
+
+static inline unsigned long long now_ns(void)
+{
+	return rt_timer_ticks2ns(rt_timer_read());
+}
+
+int main(int argc, char *argv[])
+{
+	int ret = 0, len, ofs;
+	unsigned int i, scan_size = 0;
+	unsigned long buf_size, front = 0, cnt = 0;
+	unsigned long long start, stop, t, lat, lat_min = ~0ULL,
+		lat_max = 0, lat_sum = 0, wakeups = 0, samples = 0, lost = 0,
+		gaps = 0;
+	uint32_t expected = 0;
+	void *map = NULL;
+	a4l_bufstps_t *stps = NULL;
+	a4l_desc_t dsc = { .sbdata = NULL };
+
+	/* Compute arguments */
+	while ((ret = getopt_long(argc,
+				  argv,
+				  "vd:s:c:p:T:k:P:h",
+				  cmd_bench_opts, NULL)) >= 0) {
+		switch (ret) {
+		case 'v':
+			verbose = 1;
+			break;
+		case 'd':
+			filename = optarg;
+			break;
+		case 's':
+			cmd.idx_subd = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			str_chans = optarg;
+			break;
+		case 'p':
+			cmd.scan_begin_arg = strtoul(optarg, NULL, 0);
+			break;
+		case 'T':
+			duration = strtoul(optarg, NULL, 0);
+			break;
+		case 'k':
+			wake_count = strtoul(optarg, NULL, 0);
+			break;
+		case 'P':
+			wake_period = strtoul(optarg, NULL, 0);
+			break;
+		case 'h':
+		default:
+			do_print_usage();
+			return 0;
+		}
+	}
+
+	/* Recover the channels to compute */
+	do {
+		if (cmd.nb_chan == MAX_NB_CHAN) {
+			fprintf(stderr, "cmd_bench: too many channels\n");
+			return -EINVAL;
+		}
+		cmd.nb_chan++;
+		len = strlen(str_chans);
+		ofs = strcspn(str_chans, ",");
+		if (sscanf(str_chans, "%u", &chans[cmd.nb_chan - 1]) == 0) {
+			fprintf(stderr, "cmd_bench: bad channel argument\n");
+			return -EINVAL;
+		}
+		str_chans += ofs + 1;
+	} while (len != ofs);
+
+	cmd.scan_end_arg = cmd.nb_chan;
+
+	/* Prevent any memory-swapping for this program */
+	ret = mlockall(MCL_CURRENT | MCL_FUTURE);
+	if (ret < 0) {
+		ret = errno;
+		fprintf(stderr, "cmd_bench: mlockall failed (ret=%d)\n", ret);
+		return ret;
+	}
+
+	/* Turn the current process into an RT task, the wake-up
+	   latency would not mean much otherwise */
+	ret = rt_task_shadow(&rt_task_desc, NULL, 99, 0);
+	if (ret < 0) {
+		fprintf(stderr,
+			"cmd_bench: rt_task_shadow failed (ret=%d)\n", ret);
+		return ret;
+	}
+
+	/* Open the device */
+	ret = a4l_open(&dsc, filename);
+	if (ret < 0) {
+		fprintf(stderr, "cmd_bench: a4l_open %s failed (ret=%d)\n",
+			filename, ret);
+		return ret;
+	}
+
+	/* Allocate a buffer so as to get more info (subd, chan, rng) */
+	dsc.sbdata = malloc(dsc.sbsize);
+	if (dsc.sbdata == NULL) {
+		fprintf(stderr, "cmd_bench: malloc failed \n");
+		ret = -ENOMEM;
+		goto out_main;
+	}
+
+	ret = a4l_fill_desc(&dsc);
+	if (ret < 0) {
+		fprintf(stderr,
+			"cmd_bench: a4l_fill_desc failed (ret=%d)\n", ret);
+		goto out_main;
+	}
+
+	/* The sequence check only makes sense with 32-bit samples */
+	for (i = 0; i < cmd.nb_chan; i++) {
+		a4l_chinfo_t *info;
+
+		ret = a4l_get_chinfo(&dsc,
+				     cmd.idx_subd, cmd.chan_descs[i], &info);
+		if (ret < 0) {
+			fprintf(stderr,
+				"cmd_bench: a4l_get_chinfo failed (ret=%d)\n",
+				ret);
+			goto out_main;
+		}
+
+		if (a4l_sizeof_chan(info) != sizeof(uint32_t)) {
+			fprintf(stderr,
+				"cmd_bench: channel %u is not 32-bit wide\n",
+				cmd.chan_descs[i]);
+			ret = -EINVAL;
+			goto out_main;
+		}
+
+		scan_size += sizeof(uint32_t);
+	}
+
+	/* Cancel any former command which might be in progress */
+	a4l_snd_cancel(&dsc, cmd.idx_subd);
+
+	ret = a4l_get_bufsize(&dsc, cmd.idx_subd, &buf_size);
+	if (ret < 0) {
+		fprintf(stderr,
+			"cmd_bench: a4l_get_bufsize() failed (ret=%d)\n", ret);
+		goto out_main;
+	}
+
+	ret = a4l_mmap(&dsc, cmd.idx_subd, buf_size, &map);
+	if (ret < 0) {
+		fprintf(stderr, "cmd_bench: a4l_mmap() failed (ret=%d)\n", ret);
+		goto out_main;
+	}
+
+	/* The event stamps give the date of the data the driver
+	   reported last, hence the wake-up latency */
+	ret = a4l_mmap_stamps(&dsc, cmd.idx_subd, &stps);
+	if (ret < 0) {
+		fprintf(stderr,
+			"cmd_bench: a4l_mmap_stamps() failed (ret=%d)\n", ret);
+		goto out_main;
+	}
+
+	ret = a4l_set_wakesize(&dsc, wake_count);
+	if (ret < 0) {
+		fprintf(stderr,
+			"cmd_bench: a4l_set_wakesize failed (ret=%d)\n", ret);
+		goto out_main;
+	}
+
+	ret = a4l_set_wakeperiod(&dsc, wake_period);
+	if (ret < 0) {
+		fprintf(stderr,
+			"cmd_bench: a4l_set_wakeperiod failed (ret=%d)\n", ret);
+		goto out_main;
+	}
+
+	if (verbose != 0)
+		printf("cmd_bench: %u channels, scan period %uns, "
+		       "buffer %lu bytes, %lus\n",
+		       cmd.nb_chan, cmd.scan_begin_arg, buf_size, duration);
+
+	ret = a4l_snd_command(&dsc, &cmd);
+	if (ret < 0) {
+		fprintf(stderr,
+			"cmd_bench: a4l_snd_command failed (ret=%d)\n", ret);
+		goto out_main;
+	}
+
+	start = now_ns();
+	stop = start + duration * 1000000000ULL;
+
+	do {
+		unsigned long n;
+
+		ret = a4l_mark_bufrw(&dsc, cmd.idx_subd, front, &front);
+		if (ret < 0) {
+			fprintf(stderr,
+				"cmd_bench: a4l_mark_bufrw() failed (ret=%d)\n",
+				ret);
+			goto out_cancel;
+		}
+
+		if (front == 0) {
+			unsigned int head;
+
+			ret = a4l_poll(&dsc, cmd.idx_subd, 1000);
+			if (ret < 0) {
+				fprintf(stderr,
+					"cmd_bench: a4l_poll() failed (ret=%d)\n",
+					ret);
+				goto out_cancel;
+			}
+			if (ret == 0)
+				continue;
+
+			/* Age of the freshest data when we get to run */
+			t = now_ns();
+			head = stps->head;
+			if (head == 0)
+				continue;
+			lat = t - stps->stamps[(head - 1) %
+					       A4L_BUF_NR_STAMPS].date;
+			if ((long long)lat < 0)
+				lat = 0;
+			if (lat < lat_min)
+				lat_min = lat;
+			if (lat > lat_max)
+				lat_max = lat;
+			lat_sum += lat;
+			wakeups++;
+			continue;
+		}
+
+		/* Check the samples are contiguous; the buffer size is a
+		   multiple of the sample size */
+		for (n = 0; n < front; n += sizeof(uint32_t)) {
+			uint32_t v = *(uint32_t *)
+				((char *)map + (cnt + n) % buf_size);
+
+			if (v != expected) {
+				lost += (uint32_t)(v - expected);
+				gaps++;
+			}
+			expected = v + 1;
+		}
+
+		samples += front / sizeof(uint32_t);
+		cnt += front;
+
+	} while (now_ns() < stop);
+
+	t = now_ns() - start;
+
+	printf("cmd_bench: %llu samples in %llu.%03llus\n",
+	       samples, t / 1000000000ULL, (t / 1000000ULL) % 1000);
+	printf("cmd_bench: throughput %.3f MS/s, %.3f MB/s (%.3f Mscans/s)\n",
+	       samples * 1000.0 / t, samples * sizeof(uint32_t) * 1000.0 / t,
+	       samples * 1000.0 / t / cmd.nb_chan);
+	if (wakeups != 0)
+		printf("cmd_bench: %llu wake-ups, latency min %.3fus "
+		       "avg %.3fus max %.3fus\n", wakeups,
+		       lat_min / 1000.0, lat_sum / 1000.0 / wakeups,
+		       lat_max / 1000.0);
+	printf("cmd_bench: %llu samples lost in %llu gaps\n", lost, gaps);
+
+	ret = lost != 0;
+
+out_cancel:
+	a4l_snd_cancel(&dsc, cmd.idx_subd);
+
+out_main:
+
+	if (map != NULL)
+		munmap(map, buf_size);
+
+	if (dsc.sbdata != NULL)
+		free(dsc.sbdata);
+
+	a4l_close(&dsc);
+
+	return ret;
+}
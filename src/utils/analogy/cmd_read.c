@@ -23,7 +23,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
 #include <sys/mman.h>
+#include <sys/time.h>
 #include <errno.h>
 #include <getopt.h>
 #include <string.h>
@@ -47,6 +51,9 @@
 
 #define BUF_SIZE 10000
 
+/* Default size of the writes performed by the recorder */
+#define CHUNK_SIZE (1024 * 1024)
+
 static unsigned char buf[BUF_SIZE];
 static char *filename = FILENAME;
 static char *str_chans = "0,1,2,3";
@@ -54,10 +61,21 @@ static unsigned int chans[MAX_NB_CHAN];
 static int verbose = 0;
 static int real_time = 0;
 static int use_mmap = 0;
+static int attach = 0;
 static unsigned long wake_count = 0;
+static char *output = NULL;
+static unsigned long ring_size = 0;
+static unsigned long chunk_size = CHUNK_SIZE;
 
 static RT_TASK rt_task_desc;
 
+/* Recorder state, shared with the writer thread */
+static volatile int rec_stop;
+static volatile int rec_done;
+static volatile unsigned long long rec_bytes;
+static volatile unsigned long rec_peak;
+static int rec_err;
+
 /* The command to send by default */
 a4l_cmd_t cmd = {
 	.idx_subd = ID_SUBD,
@@ -86,6 +104,10 @@ struct option cmd_read_opts[] = {
 	{"mmap", no_argument, NULL, 'm'},
 	{"raw", no_argument, NULL, 'w'},
 	{"wake-count", required_argument, NULL, 'k'},
+	{"output", required_argument, NULL, 'o'},
+	{"buffer-size", required_argument, NULL, 'b'},
+	{"chunk-size", required_argument, NULL, 'C'},
+	{"attach", no_argument, NULL, 'A'},
 	{"help", no_argument, NULL, 'h'},
 	{0},
 };
@@ -106,6 +128,17 @@ void do_print_usage(void)
 	fprintf(stdout, 
 		"\t\t -k, --wake-count: "
 		"space available before waking up the process\n");
+	fprintf(stdout,
+		"\t\t -o, --output: record the acquisition into a file, "
+		"straight from the mapped buffer\n");
+	fprintf(stdout,
+		"\t\t -b, --buffer-size: size of the acquisition buffer\n");
+	fprintf(stdout,
+		"\t\t -C, --chunk-size: size of the writes to the file "
+		"(default: %d)\n", CHUNK_SIZE);
+	fprintf(stdout,
+		"\t\t -A, --attach: read the acquisition in progress "
+		"on the subdevice instead of sending a command\n");
 	fprintf(stdout, "\t\t -h, --help: print this help\n");
 }
 
@@ -184,6 +217,202 @@ out:
 	return err;
 }
 
+/* --- Recorder --- */
+
+/* The recorder writes the data straight from the mapped buffer, and
+   only releases them to the driver once they hit the file. The writes
+   are chunk-sized, hence page-aligned both in the buffer and in the
+   file, which allows O_DIRECT; only the tail of the acquisition goes
+   through the page cache. The writer is a plain Linux thread, so that
+   the file system never runs under the real-time scheduler. */
+
+struct recorder {
+	a4l_desc_t *dsc;
+	int fd;
+	void *map;
+	unsigned long buf_size;
+	/* Bytes to record, ~0 if unlimited */
+	unsigned long long total;
+};
+
+static void rec_signal(int sig)
+{
+	rec_stop = 1;
+}
+
+static int rec_write(int fd, const char *data, unsigned long count)
+{
+	ssize_t ret;
+
+	while (count > 0) {
+		ret = write(fd, data, count);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		data += ret;
+		count -= ret;
+	}
+
+	return 0;
+}
+
+static void *rec_writer(void *arg)
+{
+	struct recorder *rec = (struct recorder *)arg;
+	unsigned long avail = 0, done = 0, n, ofs;
+	long page_size = sysconf(_SC_PAGESIZE);
+	int ret = 0, tail;
+
+	for (;;) {
+		/* Release what was written, fetch what is available */
+		ret = a4l_mark_bufrw(rec->dsc, cmd.idx_subd, done, &avail);
+		done = 0;
+		if (ret == -ENOENT) {
+			ret = 0;
+			break;
+		}
+		if (ret < 0) {
+			fprintf(stderr,
+				"cmd_read: a4l_mark_bufrw() failed (ret=%d)%s\n",
+				ret, ret == -EPIPE ? ", buffer overrun" : "");
+			break;
+		}
+
+		if (avail > rec_peak)
+			rec_peak = avail;
+
+		/* Once interrupted, flush what the driver produced so
+		   far, then stop */
+		if (rec_stop && rec_bytes + avail < rec->total)
+			rec->total = rec_bytes + avail;
+
+		if (rec_bytes >= rec->total)
+			break;
+
+		tail = rec_bytes + avail >= rec->total;
+		if (tail)
+			avail = rec->total - rec_bytes;
+
+		if (avail < chunk_size && !tail) {
+			ret = a4l_poll(rec->dsc, cmd.idx_subd, 100);
+			if (ret < 0) {
+				fprintf(stderr,
+					"cmd_read: a4l_poll() failed (ret=%d)\n",
+					ret);
+				break;
+			}
+			continue;
+		}
+
+		n = avail < chunk_size ? avail : chunk_size;
+		ofs = rec_bytes % rec->buf_size;
+		if (n > rec->buf_size - ofs)
+			n = rec->buf_size - ofs;
+
+		/* Only the tail may be unaligned; O_DIRECT cannot cope
+		   with it, so fall back to buffered writes */
+		if (n % page_size != 0) {
+			if (n > page_size)
+				n -= n % page_size;
+			else
+				fcntl(rec->fd, F_SETFL,
+				      fcntl(rec->fd, F_GETFL) & ~O_DIRECT);
+		}
+
+		ret = rec_write(rec->fd, (char *)rec->map + ofs, n);
+		if (ret < 0) {
+			fprintf(stderr,
+				"cmd_read: write to %s failed (ret=%d)\n",
+				output, ret);
+			break;
+		}
+
+		rec_bytes += n;
+		done = n;
+	}
+
+	rec_err = ret;
+	rec_done = 1;
+
+	return NULL;
+}
+
+static int record(a4l_desc_t *dsc, void *map, unsigned long buf_size,
+		  unsigned int scan_size)
+{
+	struct recorder rec = {
+		.dsc = dsc,
+		.map = map,
+		.buf_size = buf_size,
+		.total = cmd.stop_arg != 0 ?
+			(unsigned long long)scan_size * cmd.stop_arg : ~0ULL,
+	};
+	unsigned long long last = 0, bytes;
+	struct timeval start, now;
+	struct sigaction sa;
+	pthread_t writer;
+	double elapsed;
+	int ret;
+
+	rec.fd = open(output, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+	if (rec.fd < 0 && errno == EINVAL) {
+		fprintf(stderr,
+			"cmd_read: O_DIRECT not supported by %s, "
+			"writes will be buffered\n", output);
+		rec.fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	}
+	if (rec.fd < 0) {
+		ret = -errno;
+		fprintf(stderr, "cmd_read: cannot open %s (ret=%d)\n",
+			output, ret);
+		return ret;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = rec_signal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	gettimeofday(&start, NULL);
+
+	ret = pthread_create(&writer, NULL, rec_writer, &rec);
+	if (ret) {
+		fprintf(stderr,
+			"cmd_read: pthread_create failed (ret=%d)\n", ret);
+		close(rec.fd);
+		return -ret;
+	}
+
+	/* Report the recording rate every second */
+	while (!rec_done) {
+		sleep(1);
+		if (verbose == 0)
+			continue;
+		bytes = rec_bytes;
+		printf("cmd_read: %llu bytes recorded, %.3f MB/s, "
+		       "buffer peak %lu%%\n", bytes,
+		       (bytes - last) / 1000000.0, rec_peak * 100 / buf_size);
+		last = bytes;
+	}
+
+	pthread_join(writer, NULL);
+	gettimeofday(&now, NULL);
+	close(rec.fd);
+
+	elapsed = (now.tv_sec - start.tv_sec) +
+		(now.tv_usec - start.tv_usec) / 1000000.0;
+	printf("cmd_read: %llu bytes recorded into %s in %.3fs, %.3f MB/s, "
+	       "buffer peak %lu%%\n", rec_bytes, output, elapsed,
+	       elapsed > 0 ? rec_bytes / elapsed / 1000000.0 : 0.0,
+	       rec_peak * 100 / buf_size);
+	if (rec_err == -EPIPE)
+		printf("cmd_read: data lost, the buffer overran\n");
+
+	return rec_err;
+}
+
 int main(int argc, char *argv[])
 {
 	int ret = 0, len, ofs;
@@ -198,7 +427,7 @@ int main(int argc, char *argv[])
 	/* Compute arguments */
 	while ((ret = getopt_long(argc,
 				  argv,
-				  "vrd:s:S:c:mwk:h", 
+				  "vrd:s:S:c:mwk:o:b:C:Ah", 
 				  cmd_read_opts, NULL)) >= 0) {
 		switch (ret) {
 		case 'v':
@@ -228,6 +457,19 @@ int main(int argc, char *argv[])
 		case 'k':
 			wake_count = strtoul(optarg, NULL, 0);
 			break;
+		case 'o':
+			output = optarg;
+			use_mmap = 1;
+			break;
+		case 'b':
+			ring_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'C':
+			chunk_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'A':
+			attach = 1;
+			break;
 		case 'h':
 		default:
 			do_print_usage();
@@ -235,6 +477,12 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	if (attach != 0 && use_mmap != 0) {
+		fprintf(stderr,
+			"cmd_read: a shared acquisition cannot be mapped\n\n");
+		return -EINVAL;
+	}
+
 	if (isatty(STDOUT_FILENO) && dump_function == dump_raw) {
 		fprintf(stderr,
 			"cmd_read: cannot dump raw data on a terminal\n\n");
@@ -348,6 +596,16 @@ int main(int argc, char *argv[])
 	/* Cancel any former command which might be in progress */
 	a4l_snd_cancel(&dsc, cmd.idx_subd);
 
+	if (ring_size != 0) {
+		ret = a4l_set_bufsize(&dsc, cmd.idx_subd, ring_size);
+		if (ret < 0) {
+			fprintf(stderr,
+				"cmd_read: a4l_set_bufsize() failed (ret=%d)\n",
+				ret);
+			goto out_main;
+		}
+	}
+
 	if (use_mmap != 0) {
 
 		/* Get the buffer size to map */
@@ -377,6 +635,26 @@ int main(int argc, char *argv[])
 				 map);
 	}
 
+	if (output != NULL) {
+		long page_size = sysconf(_SC_PAGESIZE);
+
+		/* Writes must be page-aligned and leave the driver
+		   some room in the buffer */
+		chunk_size -= chunk_size % page_size;
+		if (chunk_size > buf_size / 2)
+			chunk_size = (buf_size / 2) - (buf_size / 2) % page_size;
+		if (chunk_size == 0)
+			chunk_size = page_size;
+
+		/* Wake up once a chunk can be written */
+		if (wake_count == 0)
+			wake_count = chunk_size;
+
+		if (verbose != 0)
+			printf("cmd_read: recording into %s by chunks of "
+			       "%lu bytes\n", output, chunk_size);
+	}
+
 	ret = a4l_set_wakesize(&dsc, wake_count);
 	if (ret < 0) {
 		fprintf(stderr,
@@ -388,23 +666,56 @@ int main(int argc, char *argv[])
 		printf("cmd_read: wake size successfully set (%lu)\n", 
 		       wake_count);
 
-	/* Send the command to the input device */
-	ret = a4l_snd_command(&dsc, &cmd);
-	if (ret < 0) {
-		fprintf(stderr,
-			"cmd_read: a4l_snd_command failed (ret=%d)\n", ret);
-		goto out_main;
+	if (attach != 0) {
+		/* Read the stream of the command sent by someone else */
+		ret = a4l_attach_reader(&dsc, cmd.idx_subd);
+		if (ret < 0) {
+			fprintf(stderr,
+				"cmd_read: a4l_attach_reader failed (ret=%d)\n",
+				ret);
+			goto out_main;
+		}
+
+		if (verbose != 0)
+			printf("cmd_read: attached to the acquisition\n");
+	} else {
+		/* Send the command to the input device */
+		ret = a4l_snd_command(&dsc, &cmd);
+		if (ret < 0) {
+			fprintf(stderr,
+				"cmd_read: a4l_snd_command failed (ret=%d)\n",
+				ret);
+			goto out_main;
+		}
+
+		if (verbose != 0)
+			printf("cmd_read: command successfully sent\n");
 	}
 
-	if (verbose != 0)
-		printf("cmd_read: command successfully sent\n");
+	if (output != NULL) {
+
+		/* Record the data without any memcpy */
+		ret = record(&dsc, map, buf_size, scan_size);
+		if (ret < 0)
+			goto out_main;
+
+		cnt = rec_bytes;
 
-	if (use_mmap == 0) {
+	} else if (use_mmap == 0) {
 
 		/* Fetch data */
 		do {
 			/* Perform the read operation */
 			ret = a4l_async_read(&dsc, buf, BUF_SIZE, A4L_INFINITE);
+
+			/* A secondary reader which lags behind only misses
+			   data, the acquisition goes on */
+			if (ret == -EPIPE && attach != 0) {
+				fprintf(stderr, "cmd_read: data lost, "
+					"the acquisition overtook us\n");
+				continue;
+			}
+
 			if (ret < 0) {
 				fprintf(stderr,
 					"cmd_read: a4l_read failed (ret=%d)\n",
@@ -421,7 +732,7 @@ int main(int argc, char *argv[])
 			/* Update the counter */
 			cnt += ret;
 
-		} while (ret > 0);
+		} while (ret > 0 || ret == -EPIPE);
 
 	} else {
 		unsigned long front = 0;
@@ -30,6 +30,8 @@
 
 #include <analogy/analogy.h>
 
+#include "wf_facilities.h"
+
 #define BUFFER_DEPTH 1024
 
 struct config {
@@ -46,10 +48,16 @@ struct config {
 	char *str_ranges;
 	unsigned long scans_count;
 	unsigned long wake_count;
+	unsigned long scan_period;
+	int use_mmap;
 
 	char *filename;
 	FILE *input;
 
+	/* Waveform generated on the fly, instead of read from stdin */
+	char *str_wf;
+	struct waveform_dds *dds;
+
 	/* Analogy stuff */
 
 	a4l_desc_t dsc;
@@ -59,6 +67,14 @@ struct config {
 	/* Buffer stuff
 	   TODO: add buffer depth / size (useful for mmap) */
 	void *buffer;
+	/* Samples before and after the conversion */
+	double *values;
+	void *raw;
+
+	/* Mapped asynchronous buffer */
+	void *map;
+	unsigned long buf_size;
+	unsigned long long written;
 
 };
 
@@ -72,6 +88,9 @@ struct option options[] = {
 	{"channels", required_argument, NULL, 'c'},
 	{"range", required_argument, NULL, 'c'},
 	{"wake-count", required_argument, NULL, 'k'},
+	{"scan-period", required_argument, NULL, 'p'},
+	{"waveform", required_argument, NULL, 'W'},
+	{"mmap", no_argument, NULL, 'm'},
 	{"help", no_argument, NULL, 'h'},
 	{0},
 };
@@ -94,6 +113,17 @@ void print_usage(void)
 	fprintf(stdout, 
 		"\t\t -k, --wake-count: "
 		"space available before waking up the process\n");
+	fprintf(stdout,
+		"\t\t -p, --scan-period: scan period in ns "
+		"(default: 2000000)\n");
+	fprintf(stdout,
+		"\t\t -W, --waveform: generate the signal instead of "
+		"reading it from stdin\n"
+		"\t\t\t<type[,frequency[,amplitude[,offset]]]> "
+		"(ex.: -W sine,50,2,1)\n"
+		"\t\t\ttype: sine, sawtooth, triangular or steps\n");
+	fprintf(stdout,
+		"\t\t -m, --mmap: fill the mapped buffer in place\n");
 
 	fprintf(stdout, "\t\t -h, --help: print this help\n");
 }
@@ -241,6 +271,46 @@ out:
 	return err;
 }
 
+int init_wf_config(struct config *cfg)
+{
+	static char *types[] = {"sine", "sawtooth", "triangular", "steps"};
+	struct waveform_config wf = {
+		.wf_kind = -1,
+		.wf_frequency = 50.0,
+		.wf_amplitude = 1.0,
+		.wf_offset = 0.0,
+	};
+	char *str_wf = cfg->str_wf;
+	int i, len;
+
+	len = strcspn(str_wf, ",");
+	for (i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+		if (strlen(types[i]) == len && !strncmp(str_wf, types[i], len))
+			wf.wf_kind = i;
+
+	if (wf.wf_kind < 0 ||
+	    (str_wf[len] == ',' &&
+	     sscanf(str_wf + len + 1, "%lf,%lf,%lf", &wf.wf_frequency,
+		    &wf.wf_amplitude, &wf.wf_offset) < 1)) {
+		fprintf(stderr, "cmd_write: bad waveform argument\n");
+		return -EINVAL;
+	}
+
+	wf.spl_frequency = 1000000000.0 / cfg->scan_period;
+	if (a4l_wf_check_config(&wf) < 0)
+		return -EINVAL;
+
+	cfg->dds = malloc(sizeof(struct waveform_dds));
+	if (!cfg->dds) {
+		fprintf(stderr, "cmd_write: malloc failed\n");
+		return -ENOMEM;
+	}
+
+	a4l_wf_dds_init(cfg->dds, &wf);
+
+	return 0;
+}
+
 void print_config(struct config *cfg)
 {
 	printf("cmd_write configuration:\n");
@@ -250,13 +320,29 @@ void print_config(struct config *cfg)
 	printf("\tSelected range: %s\n", cfg->str_ranges);
 	printf("\tScans count: %lu\n", cfg->scans_count);
 	printf("\tWake count: %lu\n", cfg->wake_count);
+	printf("\tScan period: %lu ns\n", cfg->scan_period);
+	printf("\tSignal: %s\n", cfg->str_wf ? cfg->str_wf :
+	       cfg->input ? "stdin" : "none");
+	printf("\tMapped buffer: %s\n", cfg->use_mmap ? "yes" : "no");
 }
 
 void cleanup_config(struct config *cfg)
 {
+	if (cfg->map)
+		munmap(cfg->map, cfg->buf_size);
+
 	if (cfg->buffer)
 		free(cfg->buffer);
 
+	if (cfg->values)
+		free(cfg->values);
+
+	if (cfg->raw)
+		free(cfg->raw);
+
+	if (cfg->dds)
+		free(cfg->dds);
+
 	if (cfg->dsc.sbdata)
 		free(cfg->dsc.sbdata);
 
@@ -273,11 +359,12 @@ int init_config(struct config *cfg, int argc, char *argv[])
 	cfg->str_ranges = "0,5,V";
 	cfg->filename = "analogy0";	
 	cfg->input = stdin;
+	cfg->scan_period = 2000000;
 	cfg->dsc.fd = -1;
 
 	while ((err = getopt_long(argc, 
 				  argv, 
-				  "vd:s:S:c:R:k:h", options, NULL)) >= 0) {
+				  "vd:s:S:c:R:k:p:W:mh", options, NULL)) >= 0) {
 		switch (err) {
 		case 'v':
 			cfg->verbose = 1;
@@ -300,6 +387,15 @@ int init_config(struct config *cfg, int argc, char *argv[])
 		case 'k':
 			cfg->wake_count = strtoul(optarg, NULL, 0);
 			break;
+		case 'p':
+			cfg->scan_period = strtoul(optarg, NULL, 0);
+			break;
+		case 'W':
+			cfg->str_wf = optarg;
+			break;
+		case 'm':
+			cfg->use_mmap = 1;
+			break;
 		case 'h':
 		default:
 			print_usage();
@@ -341,13 +437,46 @@ int init_config(struct config *cfg, int argc, char *argv[])
 		goto out;
 	}
 
-	/* If stdin is a terminal, we will not be able to read binary
-	   data from it */
-	if (isatty(fileno(cfg->input))) {
+	/* The samples are converted by blocks */
+	cfg->values = malloc(BUFFER_DEPTH * sizeof(double));
+	cfg->raw = malloc(BUFFER_DEPTH * a4l_sizeof_chan(cfg->cinfo));
+	if (!cfg->values || !cfg->raw) {
+		err = -ENOMEM;
+		fprintf(stderr, "cmd_write: malloc failed\n");
+		goto out;
+	}
+
+	/* Either the signal is generated here, or it is read from
+	   stdin; if stdin is a terminal, we will not be able to read
+	   binary data from it */
+	if (cfg->str_wf) {
+		err = init_wf_config(cfg);
+		if (err < 0)
+			goto out;
+		cfg->input = NULL;
+	} else if (isatty(fileno(cfg->input))) {
 		memset(cfg->buffer, 0, BUFFER_DEPTH * scan_size);
 		cfg->input = NULL;
 	} else
 		cfg->input = stdin;
+
+	if (cfg->use_mmap) {
+		err = a4l_get_bufsize(&cfg->dsc, cfg->subd, &cfg->buf_size);
+		if (err < 0) {
+			fprintf(stderr,
+				"cmd_write: a4l_get_bufsize failed (err=%d)\n",
+				err);
+			goto out;
+		}
+
+		err = a4l_mmap(&cfg->dsc, cfg->subd, cfg->buf_size, &cfg->map);
+		if (err < 0) {
+			fprintf(stderr,
+				"cmd_write: a4l_mmap failed (err=%d)\n", err);
+			cfg->map = NULL;
+			goto out;
+		}
+	}
 	
 out:
 
@@ -359,54 +488,126 @@ out:
 
 /* --- Input management part --- */
 
-int process_input(struct config *cfg)
+/* Produce up to nscans scans into dst, either from the generator or
+   from stdin; the samples are converted by blocks, then duplicated
+   for each channel. Returns the count of scans produced, 0 once the
+   input is exhausted */
+int process_input(struct config *cfg, void *dst, int nscans)
 {
-	int err = 0, filled = 0;
+	int err = 0, count, i, j;
 
 	/* The return value of a4l_sizeof_chan() was already
 	controlled in init_config so no need to do it twice */
 	int chan_size = a4l_sizeof_chan(cfg->cinfo);
 	int scan_size = cfg->chans_count * chan_size;
 
-	while (filled < BUFFER_DEPTH) {
-		int i;
-		double value;
-		char tmp[128];
+	if (nscans > BUFFER_DEPTH)
+		nscans = BUFFER_DEPTH;
 
+	if (cfg->dds) {
+		a4l_wf_dds_fill(cfg->dds, cfg->values, nscans);
+		count = nscans;
+	} else {
 		/* Data from stdin are supposed to be double values
 		   coming from wf_generate... */
-
-		err = fread(&value, sizeof(double), 1, cfg->input);
-		if (err != 1 && !feof(cfg->input)) {
-			err = -errno;
-			fprintf(stderr, 
+		count = fread(cfg->values, sizeof(double), nscans, cfg->input);
+		if (count < nscans && ferror(cfg->input)) {
+			err = -EIO;
+			fprintf(stderr,
 				"cmd_write: stdin IO error (err=%d)\n", err);
 			goto out;
-		} else if (err == 0 && feof(cfg->input))
-			goto out;
-		
-		/* ...and these data are just for one channel... */
-		err = a4l_dtoraw(cfg->cinfo, cfg->rinfo, tmp, &value, 1);
-		if (err < 0) {
-			fprintf(stderr, 
-				"cmd_write: conversion "
-				"from stdin failed (err=%d)\n", err);
-			goto out;			
 		}
+		if (count == 0)
+			goto out;
+	}
 
-		/* ...so we have to duplicate the conversion if many
-		   channels are selected for the acquisition */
-		for (i = 0; i < cfg->chans_count; i++)
-			memcpy(cfg->buffer + 
-			       filled * scan_size + i * chan_size, 
-			       tmp, chan_size);
-
-		filled ++;
+	/* ...and these data are just for one channel... */
+	err = a4l_dtoraw(cfg->cinfo, cfg->rinfo,
+			 cfg->chans_count == 1 ? dst : cfg->raw,
+			 cfg->values, count);
+	if (err < 0) {
+		fprintf(stderr,
+			"cmd_write: conversion "
+			"from stdin failed (err=%d)\n", err);
+		goto out;
 	}
 
+	/* ...so we have to duplicate the conversion if many
+	   channels are selected for the acquisition */
+	if (cfg->chans_count > 1)
+		for (i = 0; i < count; i++)
+			for (j = 0; j < cfg->chans_count; j++)
+				memcpy(dst + i * scan_size + j * chan_size,
+				       cfg->raw + i * chan_size, chan_size);
+
+	err = count;
+
 out:
 
-	return err < 0 ? err : filled;
+	return err;
+}
+
+/* Fill the mapped buffer in place, as far ahead of the device as the
+   free space allows */
+int process_mmap(struct config *cfg)
+{
+	int chan_size = a4l_sizeof_chan(cfg->cinfo);
+	int scan_size = cfg->chans_count * chan_size;
+	unsigned long long total = cfg->scans_count * scan_size;
+	unsigned long avail, done = 0, ofs, n;
+	int err;
+
+	err = a4l_mark_bufrw(&cfg->dsc, cfg->subd, 0, &avail);
+	if (err < 0)
+		return err;
+
+	if (avail < scan_size) {
+		err = a4l_poll(&cfg->dsc, cfg->subd, A4L_INFINITE);
+		return err < 0 ? err : 0;
+	}
+
+	while (avail - done >= scan_size) {
+
+		if (total != 0 && cfg->written >= total)
+			break;
+
+		ofs = cfg->written % cfg->buf_size;
+
+		if (cfg->buf_size - ofs < scan_size) {
+			/* The scan straddles the end of the buffer */
+			err = process_input(cfg, cfg->buffer, 1);
+			if (err <= 0)
+				break;
+			n = cfg->buf_size - ofs;
+			memcpy(cfg->map + ofs, cfg->buffer, n);
+			memcpy(cfg->map, cfg->buffer + n, scan_size - n);
+			n = scan_size;
+		} else {
+			n = avail - done;
+			if (n > cfg->buf_size - ofs)
+				n = cfg->buf_size - ofs;
+			if (total != 0 && n > total - cfg->written)
+				n = total - cfg->written;
+			err = process_input(cfg, cfg->map + ofs, n / scan_size);
+			if (err <= 0)
+				break;
+			n = err * scan_size;
+		}
+
+		done += n;
+		cfg->written += n;
+	}
+
+	if (err < 0)
+		return err;
+
+	if (done != 0) {
+		err = a4l_mark_bufrw(&cfg->dsc, cfg->subd, done, &avail);
+		if (err < 0)
+			return err;
+	}
+
+	return done != 0 ? 0 : -ENOENT;
 }
 
 /* --- Acquisition related stuff --- */
@@ -420,7 +621,11 @@ int run_acquisition(struct config *cfg)
 	int chan_size = a4l_sizeof_chan(cfg->cinfo);
 	int scan_size = cfg->chans_count * chan_size;
 
-	err = cfg->input ? process_input(cfg) : BUFFER_DEPTH;
+	if (cfg->use_mmap)
+		return process_mmap(cfg);
+
+	err = (cfg->input || cfg->dds) ?
+		process_input(cfg, cfg->buffer, BUFFER_DEPTH) : BUFFER_DEPTH;
 	if (err > 0)
 		err = a4l_async_write(&cfg->dsc, 
 				      cfg->buffer, 
@@ -441,7 +646,7 @@ int init_acquisition(struct config *cfg)
 		.start_src = TRIG_INT,
 		.start_arg = 0,
 		.scan_begin_src = TRIG_TIMER,
-		.scan_begin_arg = 2000000, /* in ns */
+		.scan_begin_arg = cfg->scan_period, /* in ns */
 		.convert_src = TRIG_NOW,
 		.convert_arg = 0,
 		.scan_end_src = TRIG_COUNT,
@@ -507,6 +712,16 @@ int main(int argc, char *argv[])
 
 	while ((err = run_acquisition(&cfg)) == 0);
 
+	if (err == -EPIPE) {
+		unsigned long pos;
+		int scan_size = cfg.chans_count * a4l_sizeof_chan(cfg.cinfo);
+
+		if (a4l_get_errpos(&cfg.dsc, &pos) == 0 && scan_size > 0)
+			fprintf(stderr,
+				"cmd_write: buffer underrun at byte %lu "
+				"(scan %lu)\n", pos, pos / scan_size);
+	}
+
 	err = (err == -ENOENT) ? 0 : err;
 
 	sleep(1);
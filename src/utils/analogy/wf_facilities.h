@@ -2,6 +2,7 @@
 #define  __SIGNAL_GENERATION_H__
 
 #include <stdio.h>
+#include <stdint.h>
 
 #define MAX_SAMPLE_COUNT 8096
 #define MIN_SAMPLE_COUNT 2
@@ -24,6 +25,21 @@ struct waveform_config {
 	int spl_count;
 };
 
+/* Streaming generator: a 32-bit phase accumulator advanced by a
+   fixed step per sample (direct digital synthesis); the sine is
+   interpolated from a table holding one period */
+
+#define WF_DDS_TABLE_BITS 12
+
+struct waveform_dds {
+	int wf_kind;
+	uint32_t phase;
+	uint32_t step;
+	double base;
+	double scale;
+	double table[(1 << WF_DDS_TABLE_BITS) + 1];
+};
+
 void a4l_wf_init_sine(struct waveform_config *config, double *values);
 void a4l_wf_init_sawtooth(struct waveform_config *config, double *values);
 void a4l_wf_init_triangular(struct waveform_config *config, double *values);
@@ -32,5 +48,7 @@ void a4l_wf_set_sample_count(struct waveform_config *config);
 int a4l_wf_check_config(struct waveform_config *config);
 void a4l_wf_init_values(struct waveform_config *config, double *values);
 void a4l_wf_dump_values(struct waveform_config *config, double *values);
+void a4l_wf_dds_init(struct waveform_dds *dds, struct waveform_config *config);
+void a4l_wf_dds_fill(struct waveform_dds *dds, double *values, int count);
 
 #endif /*  __SIGNAL_GENERATION_H__ */
@@ -11,6 +11,7 @@
 #include <native/pipe.h>
 
 #include <rtdm/rtcan.h>
+#include <asm/xenomai/atomic.h>
 
 static void print_usage(char *prg)
 {
@@ -24,6 +25,8 @@ static void print_usage(char *prg)
 	    " -R, --timestamp-rel   with relative timestamp\n"
 	    " -v, --verbose         be verbose\n"
 	    " -p, --print=MODULO    print every MODULO message\n"
+	    " -m, --mmap=SLOTS      receive via a mapped ring of SLOTS frames\n"
+	    " -w, --watermark=N     wake up every N frames in ring mode\n"
 	    " -h, --help            this help\n",
 	    prg);
 }
@@ -33,6 +36,8 @@ extern int optind, opterr, optopt;
 
 static int s = -1, verbose = 0, print = 1;
 static nanosecs_rel_t timeout = 0, with_timestamp = 0, timestamp_rel = 0;
+static unsigned int ring_slots = 0, ring_wm = 0;
+static struct can_rx_ring *ring;
 
 RT_TASK rt_task_desc;
 
@@ -79,15 +84,100 @@ void cleanup_and_exit(int sig)
     exit(0);
 }
 
+void print_frame(int count, int ifindex, struct can_frame *frame,
+		 int has_timestamp, nanosecs_abs_t timestamp)
+{
+    static nanosecs_abs_t timestamp_prev = 0;
+    int i;
+
+    printf("#%d: (%d) ", count, ifindex);
+    if (has_timestamp) {
+	if (timestamp_rel) {
+	    printf("%lldns ", (long long)(timestamp - timestamp_prev));
+	    timestamp_prev = timestamp;
+	} else
+	    printf("%lldns ", (long long)timestamp);
+    }
+    if (frame->can_id & CAN_ERR_FLAG)
+	printf("!0x%08x!", frame->can_id & CAN_ERR_MASK);
+    else if (frame->can_id & CAN_EFF_FLAG)
+	printf("<0x%08x>", frame->can_id & CAN_EFF_MASK);
+    else
+	printf("<0x%03x>", frame->can_id & CAN_SFF_MASK);
+
+    printf(" [%d]", frame->can_dlc);
+    if (!(frame->can_id & CAN_RTR_FLAG))
+	for (i = 0; i < frame->can_dlc; i++) {
+	    printf(" %02x", frame->data[i]);
+	}
+    if (frame->can_id & CAN_ERR_FLAG) {
+	printf(" ERROR ");
+	if (frame->can_id & CAN_ERR_BUSOFF)
+	    printf("bus-off");
+	if (frame->can_id & CAN_ERR_CRTL)
+	    printf("controller problem");
+    } else if (frame->can_id & CAN_RTR_FLAG)
+	printf(" remote request");
+    printf("\n");
+}
+
+void rt_task_ring(void)
+{
+    struct can_rx_slot *slot;
+    unsigned int head = 0;
+    int ret, count = 0;
+
+    while (1) {
+	ret = rt_dev_ioctl(s, RTCAN_RTIOC_RX_RING_WAIT);
+	if (ret < 0) {
+	    switch (ret) {
+	    case -ETIMEDOUT:
+		/* Frames below the watermark may be waiting. */
+		if (verbose)
+		    printf("rt_dev_ioctl RX_RING_WAIT: timed out\n");
+		break;
+	    case -EBADF:
+		if (verbose)
+		    printf("rt_dev_ioctl RX_RING_WAIT: aborted because socket was closed");
+		return;
+	    default:
+		fprintf(stderr, "rt_dev_ioctl RX_RING_WAIT: %s\n",
+			strerror(-ret));
+		return;
+	    }
+	}
+
+	while (1) {
+	    slot = &ring->slots[head & (ring->nr_slots - 1)];
+	    if (slot->status != CAN_RX_SLOT_USER)
+		break;
+	    xnarch_read_memory_barrier();
+
+	    if (print && (count % print) == 0)
+		print_frame(count, slot->ifindex, &slot->frame,
+			    with_timestamp, slot->timestamp);
+
+	    /* Hand the slot back once we are done with it. */
+	    xnarch_memory_barrier();
+	    slot->status = CAN_RX_SLOT_KERNEL;
+	    head++;
+	    count++;
+	}
+
+	if (verbose && ring->dropped)
+	    printf("%u frames dropped\n", ring->dropped);
+    }
+}
+
 void rt_task(void)
 {
-    int i, ret, count = 0;
+    int ret, count = 0;
     struct can_frame frame;
     struct sockaddr_can addr;
     socklen_t addrlen = sizeof(addr);
     struct msghdr msg;
     struct iovec iov;
-    nanosecs_abs_t timestamp, timestamp_prev = 0;
+    nanosecs_abs_t timestamp;
 
     if (with_timestamp) {
 	msg.msg_iov = &iov;
@@ -122,37 +212,9 @@ void rt_task(void)
 	    break;
 	}
 
-	if (print && (count % print) == 0) {
-	    printf("#%d: (%d) ", count, addr.can_ifindex);
-	    if (with_timestamp && msg.msg_controllen) {
-		if (timestamp_rel) {
-		printf("%lldns ", (long long)(timestamp - timestamp_prev));
-		    timestamp_prev = timestamp;
-		} else
-		    printf("%lldns ", (long long)timestamp);
-	    }
-	    if (frame.can_id & CAN_ERR_FLAG)
-		printf("!0x%08x!", frame.can_id & CAN_ERR_MASK);
-	    else if (frame.can_id & CAN_EFF_FLAG)
-		printf("<0x%08x>", frame.can_id & CAN_EFF_MASK);
-	    else
-		printf("<0x%03x>", frame.can_id & CAN_SFF_MASK);
-
-	    printf(" [%d]", frame.can_dlc);
-	    if (!(frame.can_id & CAN_RTR_FLAG))
-		for (i = 0; i < frame.can_dlc; i++) {
-		    printf(" %02x", frame.data[i]);
-		}
-	    if (frame.can_id & CAN_ERR_FLAG) {
-		printf(" ERROR ");
-		if (frame.can_id & CAN_ERR_BUSOFF)
-		    printf("bus-off");
-		if (frame.can_id & CAN_ERR_CRTL)
-		    printf("controller problem");
-	    } else if (frame.can_id & CAN_RTR_FLAG)
-		printf(" remote request");
-	    printf("\n");
-	}
+	if (print && (count % print) == 0)
+	    print_frame(count, addr.can_ifindex, &frame,
+			with_timestamp && msg.msg_controllen, timestamp);
 	count++;
     }
 }
@@ -174,6 +236,8 @@ int main(int argc, char **argv)
 	{ "timeout", required_argument, 0, 't'},
 	{ "timestamp", no_argument, 0, 'T'},
 	{ "timestamp-rel", no_argument, 0, 'R'},
+	{ "mmap", required_argument, 0, 'm'},
+	{ "watermark", required_argument, 0, 'w'},
 	{ 0, 0, 0, 0},
     };
 
@@ -182,7 +246,7 @@ int main(int argc, char **argv)
     signal(SIGTERM, cleanup_and_exit);
     signal(SIGINT, cleanup_and_exit);
 
-    while ((opt = getopt_long(argc, argv, "hve:f:t:p:RT",
+    while ((opt = getopt_long(argc, argv, "hve:f:t:p:m:w:RT",
 			      long_options, NULL)) != -1) {
 	switch (opt) {
 	case 'h':
@@ -224,6 +288,14 @@ int main(int argc, char **argv)
 	    timeout = (nanosecs_rel_t)strtoul(optarg, NULL, 0) * 1000000;
 	    break;
 
+	case 'm':
+	    ring_slots = strtoul(optarg, NULL, 0);
+	    break;
+
+	case 'w':
+	    ring_wm = strtoul(optarg, NULL, 0);
+	    break;
+
 	case 'R':
 	    timestamp_rel = 1;
 	case 'T':
@@ -303,7 +375,21 @@ int main(int argc, char **argv)
 	}
     }
 
-    if (with_timestamp) {
+    if (ring_slots) {
+	struct can_rx_ring_req req;
+
+	req.nr_slots = ring_slots;
+	req.watermark = ring_wm;
+	ret = rt_dev_ioctl(s, RTCAN_RTIOC_RX_RING, &req);
+	if (ret) {
+	    fprintf(stderr, "rt_dev_ioctl RX_RING: %s\n", strerror(-ret));
+	    goto failure;
+	}
+	ring = req.ring;
+	if (verbose)
+	    printf("Ring: %u slots, watermark %u\n",
+		   ring->nr_slots, ring->watermark);
+    } else if (with_timestamp) {
 	ret = rt_dev_ioctl(s, RTCAN_RTIOC_TAKE_TIMESTAMP, RTCAN_TAKE_TIMESTAMPS);
 	if (ret) {
 	    fprintf(stderr, "rt_dev_ioctl TAKE_TIMESTAMP: %s\n", strerror(-ret));
@@ -318,7 +404,10 @@ int main(int argc, char **argv)
 	goto failure;
     }
 
-    rt_task();
+    if (ring)
+	rt_task_ring();
+    else
+	rt_task();
     /* never returns */
 
  failure:
@@ -0,0 +1,467 @@
+/*
+ * rtlatmon - always-on timer latency monitor.
+ *
+ * Runs one low-rate in-kernel timerbench task pinned to each monitored
+ * CPU, collects its HDR histogram every window, and keeps the last
+ * windows around so that percentiles can be computed over a rolling
+ * period. Reports are served over a Unix stream socket: each client
+ * connecting gets a text snapshot, then the connection is closed. An
+ * alert is logged when the rolling p99.99 of a CPU crosses the
+ * configured threshold, and a notice when it drops back below.
+ *
+ * The sampling overhead is one timer shot per period and CPU, in the
+ * kernel, plus one ioctl per window and CPU from this process, which
+ * is not a real-time task itself.
+ *
+ * Released under the terms of GPLv2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <syslog.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <rtdm/rttesting.h>
+
+#define DEFAULT_SOCKET	"/var/run/rtlatmon.sock"
+
+/* Do not let the sampling rate go above 10 kHz per CPU. */
+#define MIN_PERIOD_US	100
+
+#define MAX_CPUS	64
+
+struct cpu_mon {
+	int cpu;
+	int fd;
+	unsigned nr_windows;	/* Windows filled so far. */
+	unsigned next;		/* Slot of the next window. */
+	struct rttst_hdr_histogram *windows;	/* Ring of nr_slots. */
+	struct rttst_hdr_histogram rolling;	/* Sum of the ring. */
+	int alert;
+};
+
+static struct cpu_mon *mons;
+static unsigned nr_mons, nr_slots = 6;
+static unsigned period_us = 10000, window_sec = 10;
+static unsigned long long threshold_ns;
+static int priority = 1, benchdev_no;
+static const char *sock_path = DEFAULT_SOCKET;
+static time_t start_time;
+
+static volatile sig_atomic_t finished;
+
+static void sighand(int sig)
+{
+	finished = 1;
+}
+
+static unsigned long long hdr_percentile(const struct rttst_hdr_histogram *hdr,
+					 unsigned long long ppm)
+{
+	unsigned long long hits = 0, rank;
+	unsigned n;
+
+	if (hdr->total == 0)
+		return 0;
+
+	rank = (hdr->total * ppm + 999999) / 1000000;
+	if (rank == 0)
+		rank = 1;
+
+	for (n = 0; n < RTTST_HDR_BUCKETS; n++) {
+		hits += hdr->counts[n];
+		if (hits >= rank)
+			return rttst_hdr_value(n);
+	}
+
+	return rttst_hdr_value(RTTST_HDR_BUCKETS - 1);
+}
+
+static int parse_cpus(const char *s, int *cpus)
+{
+	int nr = 0, first, last, cpu;
+	char *end;
+
+	while (*s) {
+		first = last = strtol(s, &end, 10);
+		if (end == s || first < 0)
+			return -EINVAL;
+		if (*end == '-') {
+			s = end + 1;
+			last = strtol(s, &end, 10);
+			if (end == s || last < first)
+				return -EINVAL;
+		}
+		for (cpu = first; cpu <= last; cpu++) {
+			if (nr == MAX_CPUS)
+				return -E2BIG;
+			cpus[nr++] = cpu;
+		}
+		if (*end == ',')
+			end++;
+		else if (*end)
+			return -EINVAL;
+		s = end;
+	}
+
+	return nr;
+}
+
+static int mon_start(struct cpu_mon *mon)
+{
+	struct rttst_tmbench_config config;
+	char devname[RTDM_MAX_DEVNAME_LEN];
+	int err;
+
+	snprintf(devname, sizeof(devname), "rttest-timerbench%d", benchdev_no);
+	mon->fd = rt_dev_open(devname, O_RDWR);
+	if (mon->fd < 0)
+		return mon->fd;
+
+	memset(&config, 0, sizeof(config));
+	config.mode = RTTST_TMBENCH_TASK;
+	config.priority = priority;
+	config.period = period_us * 1000ULL;
+	config.warmup_loops = 1;
+	config.flags = RTTST_TMBENCH_HDR | RTTST_TMBENCH_CPU;
+	config.cpu = mon->cpu;
+
+	err = rt_dev_ioctl(mon->fd, RTTST_RTIOC_TMBENCH_START, &config);
+	if (err) {
+		rt_dev_close(mon->fd);
+		mon->fd = -1;
+	}
+
+	return err;
+}
+
+static void mon_stop(struct cpu_mon *mon)
+{
+	struct rttst_overall_bench_res overall;
+
+	if (mon->fd < 0)
+		return;
+
+	memset(&overall, 0, sizeof(overall));
+	rt_dev_ioctl(mon->fd, RTTST_RTIOC_TMBENCH_STOP, &overall);
+	rt_dev_close(mon->fd);
+	mon->fd = -1;
+}
+
+static void mon_check(struct cpu_mon *mon)
+{
+	unsigned long long p9999 = hdr_percentile(&mon->rolling, 999900);
+
+	if (threshold_ns == 0 || mon->rolling.total == 0)
+		return;
+
+	if (!mon->alert && p9999 > threshold_ns) {
+		mon->alert = 1;
+		syslog(LOG_WARNING, "CPU%d: p99.99 latency %Lu ns above "
+		       "threshold %Lu ns (%Lu samples)", mon->cpu,
+		       p9999, threshold_ns, mon->rolling.total);
+	} else if (mon->alert && p9999 <= threshold_ns) {
+		mon->alert = 0;
+		syslog(LOG_NOTICE, "CPU%d: p99.99 latency %Lu ns back below "
+		       "threshold %Lu ns", mon->cpu, p9999, threshold_ns);
+	}
+}
+
+/* Close the current window of a CPU and fold it into the rolling sum. */
+static int mon_rotate(struct cpu_mon *mon)
+{
+	struct rttst_hdr_histogram *slot = &mon->windows[mon->next];
+	unsigned n;
+	int err;
+
+	/* Evict the oldest window, which the new one overwrites. */
+	if (mon->nr_windows == nr_slots) {
+		for (n = 0; n < RTTST_HDR_BUCKETS; n++)
+			mon->rolling.counts[n] -= slot->counts[n];
+		mon->rolling.total -= slot->total;
+	} else
+		mon->nr_windows++;
+
+	err = rt_dev_ioctl(mon->fd, RTTST_RTIOC_TMBENCH_ROTATE_HDR, slot);
+	if (err) {
+		memset(slot, 0, sizeof(*slot));
+		syslog(LOG_ERR, "CPU%d: cannot retrieve histogram: %s",
+		       mon->cpu, strerror(-err));
+	}
+
+	for (n = 0; n < RTTST_HDR_BUCKETS; n++)
+		mon->rolling.counts[n] += slot->counts[n];
+	mon->rolling.total += slot->total;
+
+	mon->next = (mon->next + 1) % nr_slots;
+
+	mon_check(mon);
+
+	return err;
+}
+
+static void print_stats(FILE *f, struct cpu_mon *mon, const char *what,
+			const struct rttst_hdr_histogram *hdr)
+{
+	fprintf(f, "cpu %d %s samples=%Lu p50=%Lu p99=%Lu p99.9=%Lu "
+		"p99.99=%Lu max=%Lu\n", mon->cpu, what, hdr->total,
+		hdr_percentile(hdr, 500000), hdr_percentile(hdr, 990000),
+		hdr_percentile(hdr, 999000), hdr_percentile(hdr, 999900),
+		hdr_percentile(hdr, 1000000));
+}
+
+/*
+ * One snapshot per connection: a header, the statistics of the last
+ * window and of the rolling period for each CPU, then the non-empty
+ * buckets of the rolling histograms as <upper bound ns>:<count>. All
+ * latencies are in nanoseconds.
+ */
+static void serve(int sock)
+{
+	struct timeval tv = { .tv_sec = 1, .tv_usec = 0 };
+	struct cpu_mon *mon;
+	unsigned i, n;
+	FILE *f;
+	int fd;
+
+	fd = accept(sock, NULL, NULL);
+	if (fd < 0)
+		return;
+
+	/* A stuck client must not stall the sampling windows. */
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+	f = fdopen(fd, "w");
+	if (f == NULL) {
+		close(fd);
+		return;
+	}
+
+	fprintf(f, "rtlatmon period_us=%u window_s=%u windows=%u "
+		"threshold_ns=%Lu uptime_s=%lu\n", period_us, window_sec,
+		nr_slots, threshold_ns, (unsigned long)(time(NULL) - start_time));
+
+	for (i = 0; i < nr_mons; i++) {
+		mon = &mons[i];
+		if (mon->nr_windows == 0)
+			continue;
+		n = (mon->next + nr_slots - 1) % nr_slots;
+		print_stats(f, mon, "window", &mon->windows[n]);
+		print_stats(f, mon, "rolling", &mon->rolling);
+		fprintf(f, "cpu %d alert=%d\n", mon->cpu, mon->alert);
+	}
+
+	for (i = 0; i < nr_mons; i++) {
+		mon = &mons[i];
+		fprintf(f, "hdr %d", mon->cpu);
+		for (n = 0; n < RTTST_HDR_BUCKETS; n++)
+			if (mon->rolling.counts[n])
+				fprintf(f, " %Lu:%Lu", rttst_hdr_value(n),
+					mon->rolling.counts[n]);
+		fputc('\n', f);
+	}
+
+	fclose(f);
+}
+
+static int open_socket(void)
+{
+	struct sockaddr_un addr;
+	int sock;
+
+	if (strlen(sock_path) >= sizeof(addr.sun_path))
+		return -ENAMETOOLONG;
+
+	sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0)
+		return -errno;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, sock_path);
+	unlink(sock_path);
+
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    listen(sock, 8)) {
+		int err = -errno;
+		close(sock);
+		return err;
+	}
+
+	fcntl(sock, F_SETFD, FD_CLOEXEC);
+
+	return sock;
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: rtlatmon [options]\n"
+		"  [-p <period_us>]      # sampling period, default=10000, min=%d\n"
+		"  [-P <priority>]       # sampling task priority, default=1\n"
+		"  [-c <cpu-list>]       # CPUs to monitor, e.g. 0,2-3, default=all\n"
+		"  [-w <window_s>]       # histogram window, default=10\n"
+		"  [-n <windows>]        # windows in the rolling period, default=6\n"
+		"  [-t <threshold_us>]   # p99.99 alert threshold, default=none\n"
+		"  [-s <socket>]         # report socket, default=" DEFAULT_SOCKET "\n"
+		"  [-D <testing_device_no>] # number of testing device, default=0\n"
+		"  [-f]                  # stay in foreground, log to stderr too\n",
+		MIN_PERIOD_US);
+	exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+	int cpus[MAX_CPUS], foreground = 0, sock, err, c, i;
+	struct timeval tv, now, deadline;
+	struct sigaction sa;
+	fd_set rfds;
+
+	nr_mons = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nr_mons > MAX_CPUS)
+		nr_mons = MAX_CPUS;
+	for (i = 0; i < nr_mons; i++)
+		cpus[i] = i;
+
+	while ((c = getopt(argc, argv, "p:P:c:w:n:t:s:D:f")) != EOF)
+		switch (c) {
+		case 'p':
+			period_us = atoi(optarg);
+			break;
+		case 'P':
+			priority = atoi(optarg);
+			break;
+		case 'c':
+			err = parse_cpus(optarg, cpus);
+			if (err <= 0) {
+				fprintf(stderr, "rtlatmon: bad CPU list '%s'\n",
+					optarg);
+				exit(2);
+			}
+			nr_mons = err;
+			break;
+		case 'w':
+			window_sec = atoi(optarg);
+			break;
+		case 'n':
+			nr_slots = atoi(optarg);
+			break;
+		case 't':
+			threshold_ns = strtoull(optarg, NULL, 0) * 1000;
+			break;
+		case 's':
+			sock_path = optarg;
+			break;
+		case 'D':
+			benchdev_no = atoi(optarg);
+			break;
+		case 'f':
+			foreground = 1;
+			break;
+		default:
+			usage();
+		}
+
+	if (period_us < MIN_PERIOD_US || window_sec == 0 || nr_slots == 0 ||
+	    priority < 0 || priority > 99)
+		usage();
+
+	mons = calloc(nr_mons, sizeof(*mons));
+	if (mons == NULL) {
+		fprintf(stderr, "rtlatmon: out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; i < nr_mons; i++) {
+		mons[i].cpu = cpus[i];
+		mons[i].fd = -1;
+		mons[i].windows = calloc(nr_slots, sizeof(*mons[i].windows));
+		if (mons[i].windows == NULL) {
+			fprintf(stderr, "rtlatmon: out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	sock = open_socket();
+	if (sock < 0) {
+		fprintf(stderr, "rtlatmon: cannot listen on %s: %s\n",
+			sock_path, strerror(-sock));
+		exit(EXIT_FAILURE);
+	}
+
+	if (!foreground && daemon(0, 0)) {
+		perror("rtlatmon: daemon");
+		exit(EXIT_FAILURE);
+	}
+
+	openlog("rtlatmon", LOG_PID | (foreground ? LOG_PERROR : 0),
+		LOG_DAEMON);
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = sighand;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGHUP, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	for (i = 0; i < nr_mons; i++) {
+		err = mon_start(&mons[i]);
+		if (err) {
+			syslog(LOG_ERR, "CPU%d: cannot start timerbench "
+			       "(modprobe xeno_timerbench?): %s",
+			       mons[i].cpu, strerror(-err));
+			goto out;
+		}
+	}
+
+	syslog(LOG_INFO, "monitoring %u CPU(s), period %u us, priority %d, "
+	       "window %u s x %u", nr_mons, period_us, priority,
+	       window_sec, nr_slots);
+
+	time(&start_time);
+	gettimeofday(&deadline, NULL);
+	deadline.tv_sec += window_sec;
+
+	while (!finished) {
+		gettimeofday(&now, NULL);
+		if (!timercmp(&now, &deadline, <)) {
+			for (i = 0; i < nr_mons; i++)
+				mon_rotate(&mons[i]);
+			deadline.tv_sec += window_sec;
+			continue;
+		}
+
+		timersub(&deadline, &now, &tv);
+		FD_ZERO(&rfds);
+		FD_SET(sock, &rfds);
+
+		if (select(sock + 1, &rfds, NULL, NULL, &tv) > 0)
+			serve(sock);
+	}
+
+	err = 0;
+
+  out:
+	for (i = 0; i < nr_mons; i++)
+		mon_stop(&mons[i]);
+
+	close(sock);
+	unlink(sock_path);
+
+	syslog(LOG_INFO, "exiting");
+	closelog();
+
+	return err ? EXIT_FAILURE : EXIT_SUCCESS;
+}
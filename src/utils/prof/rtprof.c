@@ -0,0 +1,393 @@
+/*
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * rtprof: drain the sampling profiler rings of the nucleus (see
+ * nucleus/profile.h) and print the sampled call stacks in the folded
+ * format flame graph tools consume, i.e. one line per distinct stack,
+ * outermost frame first, followed by its sample count.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <error.h>
+#include <errno.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <nucleus/heap.h>
+#include <nucleus/profile.h>
+#include <asm/xenomai/syscall.h>
+
+#define PROC_PROFILE  "/proc/xenomai/profile"
+#define PROC_MAPS     "/proc/%d/maps"
+
+#define STACK_HASH_SIZE 4096
+
+void *xeno_map_heap(struct xnheap_desc *hd);
+
+struct region {
+	unsigned long start, end, offset;
+	char *name;
+};
+
+/* Executable mappings of a sampled process, read once. */
+struct process {
+	int pid;
+	unsigned int nr_regions;
+	struct region *regions;
+	struct process *next;
+};
+
+struct stack {
+	char *key;
+	unsigned long count;
+	struct stack *next;
+};
+
+static struct process *processes;
+
+static struct stack *stacks[STACK_HASH_SIZE];
+
+static unsigned long nr_samples, nr_lost;
+
+static volatile sig_atomic_t done;
+
+static int with_root;
+
+static void terminate(int sig)
+{
+	done = 1;
+}
+
+static struct process *get_process(int pid)
+{
+	char path[sizeof(PROC_MAPS) + 16], line[BUFSIZ], perms[8], name[BUFSIZ];
+	unsigned long start, end, offset;
+	struct process *p;
+	struct region *r;
+	FILE *fp;
+
+	for (p = processes; p; p = p->next)
+		if (p->pid == pid)
+			return p;
+
+	p = calloc(1, sizeof(*p));
+	if (p == NULL)
+		error(1, ENOMEM, "cannot allocate process descriptor");
+
+	p->pid = pid;
+	p->next = processes;
+	processes = p;
+
+	snprintf(path, sizeof(path), PROC_MAPS, pid);
+	fp = fopen(path, "r");
+	if (fp == NULL)
+		return p;	/* Gone already, addresses stay raw. */
+
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "%lx-%lx %7s %lx %*s %*s %s",
+			   &start, &end, perms, &offset, name) != 5)
+			continue;
+		if (perms[2] != 'x')
+			continue;
+		r = realloc(p->regions, (p->nr_regions + 1) * sizeof(*r));
+		if (r == NULL)
+			error(1, ENOMEM, "cannot allocate region descriptor");
+		p->regions = r;
+		r += p->nr_regions++;
+		r->start = start;
+		r->end = end;
+		r->offset = offset;
+		r->name = strdup(strrchr(name, '/') ? strrchr(name, '/') + 1 : name);
+	}
+
+	fclose(fp);
+
+	return p;
+}
+
+/* Print a code address as <object>+<offset> when it is mapped. */
+static int format_pc(char *buf, size_t len, struct process *p,
+		     unsigned long long pc)
+{
+	struct region *r;
+	unsigned int n;
+
+	for (n = 0; n < p->nr_regions; n++) {
+		r = &p->regions[n];
+		if (pc >= r->start && pc < r->end)
+			return snprintf(buf, len, "%s+0x%llx", r->name,
+					pc - r->start + r->offset);
+	}
+
+	return snprintf(buf, len, "0x%llx", pc);
+}
+
+static unsigned int hash_key(const char *key)
+{
+	unsigned int h = 2166136261U;
+
+	while (*key)
+		h = (h ^ (unsigned char)*key++) * 16777619U;
+
+	return h % STACK_HASH_SIZE;
+}
+
+static void account_stack(const char *key)
+{
+	unsigned int h = hash_key(key);
+	struct stack *s;
+
+	for (s = stacks[h]; s; s = s->next)
+		if (strcmp(s->key, key) == 0) {
+			s->count++;
+			return;
+		}
+
+	s = malloc(sizeof(*s));
+	if (s == NULL || (s->key = strdup(key)) == NULL)
+		error(1, ENOMEM, "cannot allocate stack record");
+
+	s->count = 1;
+	s->next = stacks[h];
+	stacks[h] = s;
+}
+
+static void account_sample(const struct xnprofile_rec *rec)
+{
+	char key[BUFSIZ];
+	struct process *p;
+	size_t len;
+	int n;
+
+	if ((rec->flags & XNPROFILE_ROOT) && !with_root)
+		return;
+
+	len = snprintf(key, sizeof(key), "%.*s",
+		       (int)sizeof(rec->name), rec->name);
+
+	if (rec->flags & XNPROFILE_ROOT)
+		len += snprintf(key + len, sizeof(key) - len, ";[linux]");
+	else if (rec->flags & XNPROFILE_KERNEL)
+		len += snprintf(key + len, sizeof(key) - len, ";[kernel]");
+	else {
+		p = get_process(rec->pid);
+		for (n = rec->depth - 1; n >= 0 && len < sizeof(key) - 1; n--) {
+			key[len++] = ';';
+			len += format_pc(key + len, sizeof(key) - len,
+					 p, rec->pcs[n]);
+		}
+	}
+
+	account_stack(key);
+	nr_samples++;
+}
+
+static struct xnprofile_area *map_profile(void)
+{
+	struct xnprofile_area *area;
+	struct xnheap_desc hd;
+	unsigned long offset;
+	char buf[BUFSIZ];
+	int ret, found = 0;
+	void *base;
+	FILE *fp;
+
+	fp = fopen(PROC_PROFILE, "r");
+	if (fp == NULL)
+		error(1, errno, "cannot open %s (CONFIG_XENO_OPT_PROFILE?)",
+		      PROC_PROFILE);
+
+	while (fgets(buf, sizeof(buf), fp))
+		if (sscanf(buf, "offset: %lu", &offset) == 1)
+			found = 1;
+
+	fclose(fp);
+
+	if (!found)
+		error(1, 0, "no area offset in %s", PROC_PROFILE);
+
+	ret = XENOMAI_SYSCALL2(__xn_sys_heap_info, &hd, XNHEAP_SYS_PROFILE);
+	if (ret)
+		error(1, -ret, "cannot locate the profiler heap");
+
+	base = xeno_map_heap(&hd);
+	if (base == MAP_FAILED)
+		error(1, errno, "cannot map the profiler heap");
+
+	area = (struct xnprofile_area *)((char *)base + offset);
+	if (area->magic != XNPROFILE_MAGIC)
+		error(1, 0, "bad profiler area magic");
+
+	return area;
+}
+
+static void set_frequency(unsigned int freq)
+{
+	FILE *fp;
+
+	fp = fopen(PROC_PROFILE, "w");
+	if (fp == NULL)
+		error(1, errno, "cannot open %s", PROC_PROFILE);
+
+	fprintf(fp, "%u\n", freq);
+
+	if (fclose(fp))
+		error(1, errno, "cannot set the sampling rate to %u Hz", freq);
+}
+
+static void drain(struct xnprofile_area *area, unsigned int *tails,
+		  struct xnprofile_rec *rec)
+{
+	struct xnprofile_ring *ring;
+	unsigned int cpu, head;
+
+	for (cpu = 0; cpu < area->nr_cpus; cpu++) {
+		ring = xnprofile_ring(area, cpu);
+		head = ring->head;
+		__sync_synchronize();
+
+		if (head - tails[cpu] > area->nr_recs) {
+			nr_lost += head - tails[cpu] - area->nr_recs;
+			tails[cpu] = head - area->nr_recs;
+		}
+
+		for (; tails[cpu] != head; tails[cpu]++) {
+			memcpy(rec, xnprofile_rec(area, ring, tails[cpu]),
+			       area->rec_size);
+			__sync_synchronize();
+			/* Overwritten while we were copying it? */
+			if (ring->head - tails[cpu] >= area->nr_recs) {
+				nr_lost++;
+				continue;
+			}
+			if (rec->depth > area->max_depth + 1)
+				rec->depth = area->max_depth + 1;
+			account_sample(rec);
+		}
+	}
+}
+
+static void dump(FILE *out)
+{
+	struct stack *s;
+	unsigned int h;
+
+	for (h = 0; h < STACK_HASH_SIZE; h++)
+		for (s = stacks[h]; s; s = s->next)
+			fprintf(out, "%s %lu\n", s->key, s->count);
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: rtprof [options]\n"
+		"  --frequency, -f <hz>   # sampling rate, default=997\n"
+		"  --duration, -d <s>     # profiling time, default=0 (until ^C)\n"
+		"  --output, -o <file>    # folded stacks output, default=stdout\n"
+		"  --root, -r             # also count samples of Linux activity\n"
+		"  --attach, -a           # do not start/stop sampling, read only\n");
+	exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option options[] = {
+		{ "frequency", required_argument, NULL, 'f' },
+		{ "duration", required_argument, NULL, 'd' },
+		{ "output", required_argument, NULL, 'o' },
+		{ "root", no_argument, NULL, 'r' },
+		{ "attach", no_argument, NULL, 'a' },
+		{ NULL, 0, NULL, 0 }
+	};
+	unsigned int freq = 997, duration = 0, cpu, *tails;
+	struct timespec ts = { 0, 50000000 };
+	struct xnprofile_area *area;
+	struct xnprofile_rec *rec;
+	const char *output = NULL;
+	int c, attach = 0;
+	time_t stop;
+	FILE *out;
+
+	while ((c = getopt_long(argc, argv, "f:d:o:ra", options, NULL)) != EOF)
+		switch (c) {
+		case 'f':
+			freq = atoi(optarg);
+			break;
+		case 'd':
+			duration = atoi(optarg);
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'r':
+			with_root = 1;
+			break;
+		case 'a':
+			attach = 1;
+			break;
+		default:
+			usage();
+		}
+
+	if (optind < argc || freq == 0)
+		usage();
+
+	area = map_profile();
+
+	tails = calloc(area->nr_cpus, sizeof(*tails));
+	rec = malloc(area->rec_size);
+	if (tails == NULL || rec == NULL)
+		error(1, ENOMEM, "cannot allocate the sample buffers");
+
+	/* Only consider what is sampled from now on. */
+	for (cpu = 0; cpu < area->nr_cpus; cpu++)
+		tails[cpu] = xnprofile_ring(area, cpu)->head;
+
+	signal(SIGINT, terminate);
+	signal(SIGTERM, terminate);
+
+	if (!attach)
+		set_frequency(freq);
+
+	stop = duration ? time(NULL) + duration : 0;
+
+	while (!done && (stop == 0 || time(NULL) < stop)) {
+		nanosleep(&ts, NULL);
+		drain(area, tails, rec);
+	}
+
+	if (!attach)
+		set_frequency(0);
+
+	drain(area, tails, rec);
+
+	out = output ? fopen(output, "w") : stdout;
+	if (out == NULL)
+		error(1, errno, "cannot open %s", output);
+
+	dump(out);
+
+	if (out != stdout)
+		fclose(out);
+
+	fprintf(stderr, "rtprof: %lu samples, %lu lost\n", nr_samples, nr_lost);
+
+	exit(0);
+}
@@ -3,16 +3,26 @@
 #include <error.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <nucleus/heap.h>
+#include <nucleus/statmap.h>
+#include <asm/xenomai/syscall.h>
 
 #define PROC_ACCT  "/proc/xenomai/acct"
 #define PROC_PID  "/proc/%d/cmdline"
+#define PROC_STATMAP  "/proc/xenomai/statmap"
 
 #define ACCT_FMT_1  "%u %d %lu %lu %lu %lx %Lu %Lu %Lu"
 #define ACCT_FMT_2  ACCT_FMT_1 " %[^\n]"
 #define ACCT_NFMT_1 9
 #define ACCT_NFMT_2 10
 
-int main(int argc, char *argv[])
+void *xeno_map_heap(struct xnheap_desc *hd);
+
+static void ps(void)
 {
 	char cmdpath[sizeof(PROC_PID) + 32], cmdbuf[BUFSIZ], acctbuf[BUFSIZ], name[64];
 	unsigned long ssw, csw, pf, state, sec;
@@ -68,6 +78,222 @@ int main(int argc, char *argv[])
 		       hr, min, sec, msec, usec,
 		       name, cmdbuf);
 	}
+}
+
+/*
+ * --top mode: sample the mappable thread statistics (see
+ * nucleus/statmap.h) and display the per-interval deltas, busiest
+ * threads first. This does not involve any syscall per sample.
+ */
+
+struct top_entry {
+	struct xnstatmap_slot cur;
+	double load;
+	unsigned long long dcsw, dssw, dpf;
+};
+
+static struct xnstatmap_area *map_statmap(void)
+{
+	struct xnstatmap_area *area;
+	struct xnheap_desc hd;
+	unsigned long offset;
+	char buf[BUFSIZ];
+	int ret, found = 0;
+	void *base;
+	FILE *fp;
+
+	fp = fopen(PROC_STATMAP, "r");
+	if (fp == NULL)
+		error(1, errno, "cannot open %s (CONFIG_XENO_OPT_STATS_MAP?)",
+		      PROC_STATMAP);
+
+	while (fgets(buf, sizeof(buf), fp))
+		if (sscanf(buf, "offset: %lu", &offset) == 1)
+			found = 1;
+
+	fclose(fp);
+
+	if (!found)
+		error(1, 0, "no area offset in %s", PROC_STATMAP);
+
+	ret = XENOMAI_SYSCALL2(__xn_sys_heap_info, &hd, XNHEAP_SYS_STATMAP);
+	if (ret)
+		error(1, -ret, "cannot locate the statistics heap");
+
+	base = xeno_map_heap(&hd);
+	if (base == MAP_FAILED)
+		error(1, errno, "cannot map the statistics heap");
+
+	area = (struct xnstatmap_area *)((char *)base + offset);
+	if (area->magic != XNSTATMAP_MAGIC)
+		error(1, 0, "bad statistics area magic");
+
+	return area;
+}
+
+static void read_slot(struct xnstatmap_slot *dst,
+		      const struct xnstatmap_slot *src)
+{
+	unsigned int seq;
+
+	do {
+		seq = xnread_seqcount_begin(&src->seq);
+		*dst = *src;
+	} while (xnread_seqcount_retry(&src->seq, seq));
+}
+
+static int compare_load(const void *a, const void *b)
+{
+	const struct top_entry *ea = a, *eb = b;
+
+	if (ea->load != eb->load)
+		return ea->load < eb->load ? 1 : -1;
+
+	return ea->cur.pid - eb->cur.pid;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void top(unsigned int delay_ms, unsigned int iterations,
+		unsigned int lines)
+{
+	struct xnstatmap_slot *prev, *snap;
+	struct xnstatmap_area *area;
+	struct top_entry *entries;
+	double t0, t1, ticks;
+	unsigned int n, nr, loop;
+	struct timespec ts;
+	int tty;
+
+	area = map_statmap();
+	tty = isatty(STDOUT_FILENO);
+
+	prev = calloc(area->nr_slots, sizeof(*prev));
+	snap = calloc(area->nr_slots, sizeof(*snap));
+	entries = calloc(area->nr_slots, sizeof(*entries));
+	if (prev == NULL || snap == NULL || entries == NULL)
+		error(1, ENOMEM, "cannot allocate the sample buffers");
+
+	for (n = 0; n < area->nr_slots; n++)
+		read_slot(&prev[n], &area->slots[n]);
+	t0 = now();
+
+	ts.tv_sec = delay_ms / 1000;
+	ts.tv_nsec = (delay_ms % 1000) * 1000000;
+
+	for (loop = 0; iterations == 0 || loop < iterations; loop++) {
+		nanosleep(&ts, NULL);
+
+		for (n = 0; n < area->nr_slots; n++)
+			read_slot(&snap[n], &area->slots[n]);
+		t1 = now();
+
+		ticks = (t1 - t0) * area->tsc_freq;
+
+		for (n = nr = 0; n < area->nr_slots; n++) {
+			struct xnstatmap_slot *cur = &snap[n], *old = &prev[n];
+			struct top_entry *e;
+
+			if (cur->serial == 0)
+				continue;
+
+			/* The slot went to another thread meanwhile. */
+			if (old->serial != cur->serial) {
+				memset(old, 0, sizeof(*old));
+				old->serial = cur->serial;
+			}
+
+			e = &entries[nr++];
+			e->cur = *cur;
+			e->load = ticks > 0 ?
+				(cur->exectime - old->exectime) * 100.0 / ticks : 0;
+			e->dcsw = cur->csw - old->csw;
+			e->dssw = cur->ssw - old->ssw;
+			e->dpf = cur->pf - old->pf;
+		}
+
+		qsort(entries, nr, sizeof(*entries), compare_load);
+
+		if (tty)
+			printf("\033[H\033[2J");
+
+		printf("%u threads, %.3f s interval\n\n", nr, t1 - t0);
+		printf("%-3s %-6s %6s %8s %8s %8s  %s\n",
+		       "CPU", "PID", "%CPU", "CSW", "MSW", "PF", "NAME");
+
+		for (n = 0; n < nr && (lines == 0 || n < lines); n++) {
+			struct top_entry *e = &entries[n];
+			printf("%-3u %-6d %6.1f %8Lu %8Lu %8Lu  %.*s\n",
+			       e->cur.cpu, e->cur.pid, e->load,
+			       e->dcsw, e->dssw, e->dpf,
+			       (int)sizeof(e->cur.name), e->cur.name);
+		}
+
+		if (!tty)
+			putchar('\n');
+
+		fflush(stdout);
+
+		memcpy(prev, snap, area->nr_slots * sizeof(*prev));
+		t0 = t1;
+	}
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: rtps [--top [options]]\n"
+		"  --top, -t           # display per-interval thread statistics\n"
+		"  --delay, -d <ms>    # sampling interval, default=100\n"
+		"  --iterations, -n <count> # number of samples, default=0 (inf)\n"
+		"  --lines, -l <count> # threads to display, default=0 (all)\n");
+	exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option options[] = {
+		{ "top", no_argument, NULL, 't' },
+		{ "delay", required_argument, NULL, 'd' },
+		{ "iterations", required_argument, NULL, 'n' },
+		{ "lines", required_argument, NULL, 'l' },
+		{ NULL, 0, NULL, 0 }
+	};
+	unsigned int delay_ms = 100, iterations = 0, lines = 0;
+	int c, do_top = 0;
+
+	while ((c = getopt_long(argc, argv, "td:n:l:", options, NULL)) != EOF)
+		switch (c) {
+		case 't':
+			do_top = 1;
+			break;
+		case 'd':
+			delay_ms = atoi(optarg);
+			break;
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		case 'l':
+			lines = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+
+	if (optind < argc || delay_ms == 0)
+		usage();
+
+	if (do_top)
+		top(delay_ms, iterations, lines);
+	else
+		ps();
 
 	exit(0);
 }